@@ -68,23 +68,15 @@ SEXP XGDMatrixCreateFromMat_R(SEXP mat,
   SEXP dim = getAttrib(mat, R_DimSymbol);
   size_t nrow = static_cast<size_t>(INTEGER(dim)[0]);
   size_t ncol = static_cast<size_t>(INTEGER(dim)[1]);
-  const bool is_int = TYPEOF(mat) == INTSXP;
-  double *din;
-  int *iin;
-  if (is_int) {
-    iin = INTEGER(mat);
+  DMatrixHandle handle;
+  // R matrices are column major, read them in place without a transposed copy.
+  if (TYPEOF(mat) == INTSXP) {
+    CHECK_CALL(XGDMatrixCreateFromMatColMajorInt(INTEGER(mat), nrow, ncol, asReal(missing),
+                                                 0, &handle));
   } else {
-    din = REAL(mat);
+    CHECK_CALL(XGDMatrixCreateFromMatColMajor(REAL(mat), nrow, ncol, asReal(missing),
+                                              0, &handle));
   }
-  std::vector<float> data(nrow * ncol);
-  #pragma omp parallel for schedule(static)
-  for (omp_ulong i = 0; i < nrow; ++i) {
-    for (size_t j = 0; j < ncol; ++j) {
-      data[i * ncol +j] = is_int ? static_cast<float>(iin[i + nrow * j]) : din[i + nrow * j];
-    }
-  }
-  DMatrixHandle handle;
-  CHECK_CALL(XGDMatrixCreateFromMat(BeginPtr(data), nrow, ncol, asReal(missing), &handle));
   ret = PROTECT(R_MakeExternalPtr(handle, R_NilValue, R_NilValue));
   R_RegisterCFinalizerEx(ret, _DMatrixFinalizer, TRUE);
   R_API_END();
@@ -104,22 +96,9 @@ SEXP XGDMatrixCreateFromCSC_R(SEXP indptr,
   size_t nindptr = static_cast<size_t>(length(indptr));
   size_t ndata = static_cast<size_t>(length(data));
   size_t nrow = static_cast<size_t>(INTEGER(num_row)[0]);
-  std::vector<size_t> col_ptr_(nindptr);
-  std::vector<unsigned> indices_(ndata);
-  std::vector<float> data_(ndata);
-
-  for (size_t i = 0; i < nindptr; ++i) {
-    col_ptr_[i] = static_cast<size_t>(p_indptr[i]);
-  }
-  #pragma omp parallel for schedule(static)
-  for (int64_t i = 0; i < static_cast<int64_t>(ndata); ++i) {
-    indices_[i] = static_cast<unsigned>(p_indices[i]);
-    data_[i] = static_cast<float>(p_data[i]);
-  }
   DMatrixHandle handle;
-  CHECK_CALL(XGDMatrixCreateFromCSCEx(BeginPtr(col_ptr_), BeginPtr(indices_),
-                                      BeginPtr(data_), nindptr, ndata,
-                                      nrow, &handle));
+  CHECK_CALL(XGDMatrixCreateFromCSCDouble(p_indptr, p_indices, p_data, nindptr, ndata,
+                                          nrow, 0, &handle));
   ret = PROTECT(R_MakeExternalPtr(handle, R_NilValue, R_NilValue));
   R_RegisterCFinalizerEx(ret, _DMatrixFinalizer, TRUE);
   R_API_END();
@@ -39,6 +39,11 @@
 // prediction
 #include "../src/predictor/predictor.cc"
 #include "../src/predictor/cpu_predictor.cc"
+#include "../src/predictor/compiled_model.cc"
+#include "../src/predictor/compiled_predictor.cc"
+#include "../src/predictor/quantized_model.cc"
+#include "../src/predictor/quantized_predictor.cc"
+#include "../src/predictor/flat_model.cc"
 
 #if DMLC_ENABLE_STD_THREAD
 #include "../src/data/sparse_page_dmatrix.cc"
@@ -68,8 +73,13 @@
 #include "../src/logging.cc"
 #include "../src/common/common.cc"
 #include "../src/common/timer.cc"
+#include "../src/common/memory_tracker.cc"
+#include "../src/common/perf_counters.cc"
+#include "../src/common/telemetry.cc"
 #include "../src/common/host_device_vector.cc"
 #include "../src/common/hist_util.cc"
+#include "../src/common/threading_utils.cc"
+#include "../src/common/charconv.cc"
 #include "../src/common/json.cc"
 #include "../src/common/io.cc"
 #include "../src/common/version.cc"
@@ -123,6 +123,8 @@ using bst_row_t = std::size_t;   // NOLINT
 using bst_node_t = int32_t;      // NOLINT
 /*! \brief Type for ranking group index. */
 using bst_group_t = uint32_t;    // NOLINT
+/*! \brief Type for the category of a categorical feature. */
+using bst_cat_t = int32_t;       // NOLINT
 
 namespace detail {
 /*! \brief Implementation of gradient statistics pair. Template specialisation
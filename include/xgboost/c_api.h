@@ -35,6 +35,12 @@ typedef void *BoosterHandle;  // NOLINT(*)
 typedef void *DataIterHandle;  // NOLINT(*)
 /*! \brief handle to a internal data holder. */
 typedef void *DataHolderHandle;  // NOLINT(*)
+/*! \brief handle to a read-only model in the flat format */
+typedef void *FlatModelHandle;  // NOLINT(*)
+/*! \brief handle to a micro-batching front end of a Booster */
+typedef void *PredictionBatcherHandle;  // NOLINT(*)
+/*! \brief handle to a row submitted to a prediction batcher */
+typedef void *PredictionTicketHandle;  // NOLINT(*)
 
 /*! \brief Mini batch used in XGBoost Data Iteration */
 typedef struct {  // NOLINT(*)
@@ -60,6 +66,25 @@ typedef struct {  // NOLINT(*)
   float* value;
 } XGBoostBatchCSR;
 
+/*! \brief Mini batch of columns used in XGBoost columnar data iteration */
+typedef struct {  // NOLINT(*)
+  /*! \brief number of rows in the minibatch */
+  size_t size;
+  /*! \brief number of columns in the minibatch */
+  size_t columns;
+  /*! \brief values of each column, one array of `size' floats per column */
+  float const* const* values;
+  /*!
+   * \brief Arrow validity bitmap of each column, bit i (least significant first) is
+   *  set when row i is valid.  Can be NULL, or NULL for a column without nulls.
+   */
+  uint8_t const* const* valid;
+  /*! \brief labels of each instance, can be NULL */
+  float const* label;
+  /*! \brief weight of each instance, can be NULL */
+  float const* weight;
+} XGBoostBatchColumnar;
+
 /*!
  * \brief Return the version of the XGBoost library being currently used.
  *
@@ -94,6 +119,36 @@ XGB_EXTERN_C typedef int XGBCallbackDataIterNext(  // NOLINT(*)
     DataIterHandle data_handle, XGBCallbackSetData *set_function,
     DataHolderHandle set_function_handle);
 
+/*!
+ * \brief Callback to set a batch of columns to handle,
+ * \param handle The handle to the callback.
+ * \param batch The data content to be set.
+ */
+XGB_EXTERN_C typedef int XGBCallbackSetColumnarData(  // NOLINT(*)
+    DataHolderHandle handle, XGBoostBatchColumnar batch);
+
+/*!
+ * \brief The columnar data reading callback function.  Unlike
+ *  `XGBCallbackDataIterNext', the batch is read in place after set_function returns,
+ *  so its buffers must stay valid until the next call to this callback.
+ *
+ * \param data_handle The handle to the callback.
+ * \param set_function The batch returned by the iterator
+ * \param set_function_handle The handle to be passed to set function.
+ * \return 0 if we are reaching the end and batch is not returned.
+ */
+XGB_EXTERN_C typedef int XGBCallbackColumnarIterNext(  // NOLINT(*)
+    DataIterHandle data_handle, XGBCallbackSetColumnarData *set_function,
+    DataHolderHandle set_function_handle);
+
+/*!
+ * \brief The callback to reset a data iterator, the next call to the reading
+ *  callback starts again from the first batch.
+ * \param data_handle The handle to the callback.
+ */
+XGB_EXTERN_C typedef void XGBCallbackDataIterReset(  // NOLINT(*)
+    DataIterHandle data_handle);
+
 /*!
  * \brief get string message of the last error
  *
@@ -115,6 +170,112 @@ XGB_DLL const char *XGBGetLastError(void);
  */
 XGB_DLL int XGBRegisterLogCallback(void (*callback)(const char*));
 
+/*!
+ * \brief record the internal timers of XGBoost regardless of verbosity, so they can
+ *        be queried with `XGBGetProfile`.  The timers always record when verbosity is 3.
+ *        GPU phases are also timed on the device with CUDA events, reported as
+ *        "<name> (device)".
+ * \param enable 1 to record, 2 to also synchronize the device around the GPU timers so
+ *        the host timers include the device work, 0 to only record with debug verbosity
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBSetProfiling(int enable);
+
+/*!
+ * \brief get the timings and counters of the updaters, predictors, metrics and other
+ *        parts of XGBoost living in this process as JSON, summed over the instances of
+ *        each part.  The result is a list with one object for each worker:
+ *
+ *          [{"<part>": {"timers": {"<name>": {"count": 1, "elapsed": 10}},
+ *                       "counters": {"<name>": 0}},
+ *            "host_memory": {"<component>": {"current": 0, "peak": 0}}}]
+ *
+ *        where elapsed time is in microseconds.  Host memory is counted in bytes for
+ *        the row pages, histogram indices, column matrices, histograms, prediction
+ *        caches and trees.  Must not be called while another
+ *        thread is training or predicting.
+ * \param all_ranks 1 to collect from every worker, which all have to call it
+ * \param out_json the timings, valid until the next call on this thread
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBGetProfile(int all_ranks, char const **out_json);
+
+/*! \brief Time spent in the phases of one training iteration, all in seconds. */
+typedef struct {  // NOLINT(*)
+  /*! \brief the iteration passed to `XGBoosterUpdateOneIter` */
+  int iteration;
+  /*! \brief rank of this worker */
+  int rank;
+  double predict_raw;
+  double get_gradient;
+  /*! \brief building the trees, which includes the tree phases below */
+  double do_boost;
+  double init_data;
+  double build_hist;
+  double evaluate_splits;
+  double apply_split;
+  double sync_histograms;
+  /*! \brief evaluating the metrics since the previous iteration was reported */
+  double evaluation;
+  /*! \brief bytes of histograms and gradient statistics allreduced over the workers */
+  uint64_t allreduce_bytes;
+} XGBIterationTelemetry;
+
+/*!
+ * \brief The callback receiving the telemetry of each iteration.
+ * \param telemetry the phases of the iteration, only valid during the call
+ * \param context user data passed to `XGBRegisterTelemetryCallback`
+ */
+XGB_EXTERN_C typedef void XGBCallbackTelemetry(  // NOLINT(*)
+    XGBIterationTelemetry const *telemetry, void *context);
+
+/*!
+ * \brief register a callback receiving the phase breakdown of every training iteration
+ *        in this process, at the end of `XGBoosterUpdateOneIter` on the training
+ *        thread.  The internal timers record while a callback is registered.  The tree
+ *        phases are those of `hist` and `gpu_hist`, GPU phases only count the time to
+ *        launch the work unless profiling is set to 2 with `XGBSetProfiling`.
+ * \param callback the callback, NULL to unregister
+ * \param context user data passed to the callback
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBRegisterTelemetryCallback(XGBCallbackTelemetry *callback, void *context);
+
+/*!
+ * \brief use an external allocator (e.g. RMM) for all GPU memory of XGBoost.
+ *        Must be called while XGBoost holds no GPU memory, typically before any
+ *        DMatrix or Booster is created.  Pass NULL for both callbacks to restore
+ *        the built-in memory pool.
+ * \param allocate called with the number of bytes, the CUDA stream and `context`;
+ *        returns memory on the current device
+ * \param deallocate called with the pointer, its size in bytes, the CUDA stream
+ *        and `context`
+ * \param context user data passed to both callbacks
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBSetGPUAllocator(void *(*allocate)(size_t, void *, void *),
+                               void (*deallocate)(void *, size_t, void *, void *),
+                               void *context);
+
+/*!
+ * \brief limit the number of bytes the built-in GPU memory pool keeps cached on
+ *        each device after they are freed.  The pool is unlimited by default.
+ * \param max_cached_bytes maximum number of cached bytes per device
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBSetGPUMemoryPoolSize(bst_ulong max_cached_bytes);
+
+/*!
+ * \brief allocate all GPU memory of XGBoost as CUDA managed memory, so training with
+ *        `gpu_hist` can use more memory than the device has before moving to external
+ *        memory.  Pages are prefetched to the device they are allocated on and migrate
+ *        to the host under memory pressure, which is fast with a fast host interconnect.
+ *        Like `XGBSetGPUAllocator`, must be called while XGBoost holds no GPU memory.
+ * \param enable 1 for managed memory, 0 to restore the built-in memory pool
+ * \return 0 for success, -1 for failure
+ */
+XGB_DLL int XGBSetGPUManagedMemory(int enable);
+
 /*!
  * \brief load a data matrix
  * \param fname the name of the file
@@ -140,6 +301,45 @@ XGB_DLL int XGDMatrixCreateFromDataIter(
     const char* cache_info,
     DMatrixHandle *out);
 
+/*!
+ * \brief Create a DMatrix from an iterator over batches of columns.  Each batch is
+ *  pushed into the matrix without an intermediate copy, in parallel over its columns.
+ * \param data_handle The handle to the data.
+ * \param next The callback to get the next batch.
+ * \param num_rows_hint expected number of rows, 0 when unknown.  Used to preallocate
+ *  the matrix, it doesn't need to be exact.
+ * \param num_nonzero_hint expected number of present values, 0 when unknown.
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out The created DMatrix
+ * \return 0 when success, -1 when failure happens.
+ */
+XGB_DLL int XGDMatrixCreateFromColumnarIter(DataIterHandle data_handle,
+                                            XGBCallbackColumnarIterNext* next,
+                                            bst_ulong num_rows_hint,
+                                            bst_ulong num_nonzero_hint,
+                                            float missing,
+                                            int nthread,
+                                            DMatrixHandle *out);
+
+/*!
+ * \brief create a matrix that reads its rows from a data iterator on every pass over the
+ *  data instead of keeping them in memory or in a cache file.  Only the meta info, the
+ *  current batch and one prefetched batch are held, the callbacks may be called from a
+ *  prefetching thread.
+ * \param data_handle The handle to the data.
+ * \param reset The callback to reset the iterator to its first batch.
+ * \param next The callback to get the next batch.
+ * \param missing which value to represent missing value
+ * \param out The created DMatrix
+ * \return 0 when success, -1 when failure happens.
+ */
+XGB_DLL int XGDMatrixCreateFromCallback(DataIterHandle data_handle,
+                                        XGBCallbackDataIterReset* reset,
+                                        XGBCallbackDataIterNext* next,
+                                        float missing,
+                                        DMatrixHandle *out);
+
 /*!
  * \brief create a matrix content from CSR format
  * \param indptr pointer to row headers
@@ -176,6 +376,27 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
                                      size_t nelem,
                                      size_t num_row,
                                      DMatrixHandle* out);
+/*!
+ * \brief create a matrix content from CSC format with int indices and double values, as
+ *  stored by R.  The arrays are read in place and the values converted while building.
+ * \param col_ptr pointer to col headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of columns in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param num_row number of rows; when it's set to 0, then guess from data
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromCSCDouble(const int* col_ptr,
+                                         const int* indices,
+                                         const double* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_row,
+                                         int nthread,
+                                         DMatrixHandle* out);
 
 /*!
  * \brief create matrix content from dense matrix
@@ -205,6 +426,68 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const float *data,  // NOLINT
                                        bst_ulong nrow, bst_ulong ncol,
                                        float missing, DMatrixHandle *out,
                                        int nthread);
+/*!
+ * \brief create matrix content from a column major dense matrix of doubles, as stored by
+ *  R.  The matrix is read in place and the values converted while building.
+ * \param data pointer to the data space, column after column
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromMatColMajor(const double *data,
+                                           bst_ulong nrow, bst_ulong ncol,
+                                           float missing, int nthread,
+                                           DMatrixHandle *out);
+/*!
+ * \brief create matrix content from a column major dense matrix of integers, see
+ *  `XGDMatrixCreateFromMatColMajor'.
+ * \param data pointer to the data space, column after column
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromMatColMajorInt(const int *data,
+                                              bst_ulong nrow, bst_ulong ncol,
+                                              float missing, int nthread,
+                                              DMatrixHandle *out);
+/*!
+ * \brief create a matrix reading a dense matrix in place, without copying it.  The data
+ *  must stay valid and unchanged until the matrix is freed.  Prediction on the CPU reads
+ *  the rows directly, other uses copy the data on first access.
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateDenseView(const float *data,
+                                     bst_ulong nrow, bst_ulong ncol,
+                                     float missing, int nthread,
+                                     DMatrixHandle *out);
+/*!
+ * \brief create a matrix holding only the histogram bins of a dense matrix for the
+ *  `hist' tree method, the data is quantized without a copy in CSR format
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param max_bin maximum number of bins, training must use the same `max_bin'
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateQuantileFromMat(const float *data,
+                                           bst_ulong nrow, bst_ulong ncol,
+                                           float missing, int max_bin, int nthread,
+                                           DMatrixHandle *out);
 /*!
  * \brief create matrix content from python data table
  * \param data pointer to pointer to column data
@@ -221,6 +504,20 @@ XGB_DLL int XGDMatrixCreateFromDT(void** data,
                                   bst_ulong ncol,
                                   DMatrixHandle* out,
                                   int nthread);
+/*!
+ * \brief create matrix content from Apache Arrow record batches in host memory
+ * \param c_json_strs JSON list of record batches, each one a list of
+ *        `__array_interface__' objects for its columns.  The Arrow validity
+ *        bitmap of a column can be passed as `mask', nulls are missing values.
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromArrowColumns(char const* c_json_strs,
+                                            float missing,
+                                            int nthread,
+                                            DMatrixHandle* out);
 /*!
  * \brief create a new dmatrix from sliced content of existing matrix
  * \param handle instance of data matrix to be sliced
@@ -247,6 +544,36 @@ XGB_DLL int XGDMatrixSliceDMatrixEx(DMatrixHandle handle,
                                     bst_ulong len,
                                     DMatrixHandle *out,
                                     int allow_groups);
+/*!
+ * \brief append the rows of a dense matrix to an existing matrix.  The quantized
+ *  matrices already built for it are extended with their current cuts.
+ * \param handle instance of data matrix, must be an in-memory matrix
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param nthread number of threads (up to maximum cores available, if <=0 use all cores)
+ * \param resketch when non-zero, sketch the quantized matrices again on their next use
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixAppendFromMat(DMatrixHandle handle,
+                                   const float *data,
+                                   bst_ulong nrow,
+                                   bst_ulong ncol,
+                                   float missing,
+                                   int nthread,
+                                   int resketch);
+/*!
+ * \brief drop the rows [begin, end) of an existing matrix, e.g. the oldest rows of a
+ *  sliding window.  The range must cover whole query groups.
+ * \param handle instance of data matrix, must be an in-memory matrix
+ * \param begin first row to drop
+ * \param end one past the last row to drop
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixDropRows(DMatrixHandle handle,
+                              bst_ulong begin,
+                              bst_ulong end);
 /*!
  * \brief free space in data matrix
  * \return 0 when success, -1 when failure happens
@@ -273,6 +600,18 @@ XGB_DLL int XGDMatrixSetFloatInfo(DMatrixHandle handle,
                                   const char *field,
                                   const float *array,
                                   bst_ulong len);
+/*!
+ * \brief set a content in info from an array interface.
+ * \param handle a instance of data matrix
+ * \param field field name, one of label, weight, base_margin, group or feature_type
+ * \param c_interface_str JSON string of `__array_interface__' or `__cuda_array_interface__',
+ *        either a single column or a list holding one column.  Device data is copied
+ *        without a round trip through host memory.
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixSetInfoFromInterface(DMatrixHandle handle,
+                                          char const* field,
+                                          char const* c_interface_str);
 /*!
  * \brief set uint32 vector to a content in info
  * \param handle a instance of data matrix
@@ -355,6 +694,24 @@ XGB_DLL int XGBoosterCreate(const DMatrixHandle dmats[],
  */
 XGB_DLL int XGBoosterFree(BoosterHandle handle);
 
+/*!
+ * \brief Slice a model using boosting index.  The slice m:n indicates taking all trees
+ *        that were fit during the boosting rounds m, (m+1), (m+2), ..., (n-1).  The
+ *        trees are shared with the original model instead of copied.
+ *
+ * \param handle Booster to be sliced.
+ * \param begin_layer start of the slice
+ * \param end_layer end of the slice; end_layer=0 is equivalent to
+ *                  end_layer=num_boost_round
+ * \param step step size of the slice
+ * \param out Sliced booster.
+ *
+ * \return 0 when success, -1 when failure happens, -2 when index is out of bound.
+ */
+XGB_DLL int XGBoosterSlice(BoosterHandle handle, int begin_layer,
+                           int end_layer, int step,
+                           BoosterHandle *out);
+
 /*!
  * \brief set parameters
  * \param handle handle
@@ -391,6 +748,21 @@ XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
                                   float *grad,
                                   float *hess,
                                   bst_ulong len);
+/*!
+ * \brief update the model with gradient pairs given by an array interface, like
+ *        XGBoosterBoostOneIter but without splitting gradient and hessian.
+ *        The array is of shape (len, 2) with float32 (gradient, hessian) pairs in
+ *        row major order, either `__array_interface__' for host memory or
+ *        `__cuda_array_interface__' for device memory.  Device memory is copied on
+ *        its device so the gradient never goes through the host.
+ * \param handle handle
+ * \param dtrain training data
+ * \param c_interface_str json string of the array interface
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterBoostOneIterWithGradientPairs(BoosterHandle handle,
+                                                   DMatrixHandle dtrain,
+                                                   char const* c_interface_str);
 /*!
  * \brief get evaluation statistics for xgboost
  * \param handle handle
@@ -407,6 +779,116 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  const char *evnames[],
                                  bst_ulong len,
                                  const char **out_result);
+
+/*!
+ * \brief The callback receiving the evaluation of one iteration of `XGBoosterTrainRounds'.
+ * \param context user data passed to `XGBoosterTrainRounds'
+ * \param iter the iteration just trained
+ * \param results the metrics of the first data set followed by those of the next, only
+ *   valid during the call
+ * \param metric_names name of each metric, only valid during the call
+ * \param n_metrics number of metrics of each data set
+ * \return 0 to continue, 1 to stop training after this iteration, anything else stops
+ *   training with an error
+ */
+XGB_EXTERN_C typedef int XGBCallbackEvalIteration(  // NOLINT(*)
+    void *context, int iter, const float *results, const char *const *metric_names,
+    bst_ulong n_metrics);
+
+/*!
+ * \brief The callback receiving a checkpoint of `XGBoosterTrainRounds', in the format of
+ *  `XGBoosterGetModelRaw'.
+ * \param context user data passed to `XGBoosterTrainRounds'
+ * \param iter the iteration just trained
+ * \param model the model, only valid during the call
+ * \param len length of the model in bytes
+ * \return 0 to continue, anything else stops training with an error
+ */
+XGB_EXTERN_C typedef int XGBCallbackCheckpoint(  // NOLINT(*)
+    void *context, int iter, const char *model, bst_ulong len);
+
+/*!
+ * \brief train for a number of rounds without returning to the caller in between, the
+ *  callbacks are invoked from the calling thread.
+ *
+ *  Early stopping watches the last metric of the last data set like the Python package,
+ *  the best iteration and score are kept in the `best_iteration' and `best_score'
+ *  attributes.  Iterations skipped by `eval_period' are neither reported nor counted.
+ * \param handle handle
+ * \param dtrain training data
+ * \param begin_iteration the first iteration to train
+ * \param num_round number of rounds to train
+ * \param dmats pointers to data to be evaluated
+ * \param len length of dmats
+ * \param early_stopping_rounds stop once the score hasn't improved in this many rounds,
+ *   0 to disable
+ * \param maximize whether a greater score is better
+ * \param checkpoint_period invoke `checkpoint' every this many rounds, 0 to disable
+ * \param eval_callback called with the metrics of each iteration, can be NULL
+ * \param checkpoint called with the model every `checkpoint_period' rounds, can be NULL
+ * \param context user data passed to the callbacks
+ * \param out_end_iteration one past the last trained iteration, can be NULL
+ * \param out_best_iteration best iteration for early stopping, can be NULL
+ * \param out_best_score score of the best iteration, can be NULL
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterTrainRounds(BoosterHandle handle,
+                                 DMatrixHandle dtrain,
+                                 int begin_iteration,
+                                 int num_round,
+                                 DMatrixHandle dmats[],
+                                 bst_ulong len,
+                                 int early_stopping_rounds,
+                                 int maximize,
+                                 int checkpoint_period,
+                                 XGBCallbackEvalIteration *eval_callback,
+                                 XGBCallbackCheckpoint *checkpoint,
+                                 void *context,
+                                 int *out_end_iteration,
+                                 int *out_best_iteration,
+                                 float *out_best_score);
+/*!
+ * \brief k-fold cross validation without slicing the matrix.  The folds share the rows and
+ *  the quantized pages of dtrain, which are built once, and are trained at the same time
+ *  on CPU.  Every round is evaluated.
+ * \param dtrain data matrix of all folds, without query groups
+ * \param c_json_params JSON object of the booster parameters, with a string for each value
+ *   or an array of strings for parameters given several times like `eval_metric'
+ * \param folds fold of each row, from 0 to the number of folds minus one
+ * \param len number of rows in folds, the number of rows of dtrain
+ * \param num_round number of rounds to train
+ * \param out_len length of out_results
+ * \param out_results for each round and each fold, the metrics on the training rows
+ *   followed by those on the rows of the fold, valid until the next call
+ * \param out_n_metrics number of metrics
+ * \param out_metric_names name of each metric
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterCrossValidate(DMatrixHandle dtrain,
+                                   char const *c_json_params,
+                                   int const *folds,
+                                   bst_ulong len,
+                                   int num_round,
+                                   bst_ulong *out_len,
+                                   float const **out_results,
+                                   bst_ulong *out_n_metrics,
+                                   char const ***out_metric_names);
+/*!
+ * \brief Train several boosters on dtrain at the same time, each with a share of the
+ *  threads of the first one.  Boosters with `tree_method' set to `hist' build the root
+ *  histograms of their trees together, reading the quantized matrix once for all of them.
+ * \param handles the boosters
+ * \param len number of boosters
+ * \param dtrain training data of every booster
+ * \param begin_iteration first round to train
+ * \param num_round number of rounds to train
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterTrainBatched(BoosterHandle handles[],
+                                  bst_ulong len,
+                                  DMatrixHandle dtrain,
+                                  int begin_iteration,
+                                  int num_round);
 /*!
  * \brief make prediction based on dmat
  * \param handle handle
@@ -416,6 +898,7 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
  *          1:output margin instead of transformed value
  *          2:output leaf index of trees instead of leaf value, note leaf index is unique per tree
  *          4:output feature contributions to individual predictions
+ *          32:don't keep the prediction of dmat in the booster's prediction cache
  * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
  *    when the parameter is set to 0, we will use all the trees
  * \param training Whether the prediction value is used for training.
@@ -430,6 +913,344 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              int training,
                              bst_ulong *out_len,
                              const float **out_result);
+/*!
+ * \brief free the predictions the booster keeps for dmat, they are computed again by the
+ *        next prediction on it.  The memory of these predictions can also be bounded by
+ *        the `prediction_cache_mb' parameter.
+ * \param handle handle
+ * \param dmat data matrix, NULL for every matrix predicted on
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterReleasePredictionCache(BoosterHandle handle,
+                                           DMatrixHandle dmat);
+/*!
+ * \brief make prediction based on dmat after each of several numbers of boosting
+ *        iterations, walking the trees once instead of calling XGBoosterPredict with a
+ *        different ntree_limit for each of them.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask 0 for transformed predictions, 1 to output margin instead
+ * \param iterations numbers of iterations in increasing order, zero for the base margin
+ * \param n_iterations length of iterations
+ * \param out_len used to store length of returning result, n_iterations times the length
+ *        of a normal prediction
+ * \param out_result used to set a pointer to the predictions of the iterations, one
+ *        after another
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictStaged(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   const unsigned *iterations,
+                                   bst_ulong n_iterations,
+                                   bst_ulong *out_len,
+                                   const float **out_result);
+/*!
+ * \brief Callback receiving the predictions of one page of a matrix.
+ * \param context The context passed to XGBoosterPredictStream.
+ * \param base_row The first row of the page.
+ * \param preds The predictions of the rows of the page, only valid during the call.
+ * \param len Length of preds.
+ * \return 0 to continue, any other value stops the prediction with an error.
+ */
+XGB_EXTERN_C typedef int XGBCallbackPredictionPage(  // NOLINT(*)
+    void *context, bst_ulong base_row, const float *preds, bst_ulong len);
+/*!
+ * \brief make prediction based on dmat one page at a time, calling callback with the
+ *        predictions of each page in the order of the rows instead of returning the
+ *        predictions of all rows.  Memory is bounded by the size of the pages, for
+ *        scoring external memory matrices.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask 0 for transformed predictions, 1 to output margin instead
+ * \param ntree_limit limit number of trees used for prediction, 0 for all trees
+ * \param callback receives the predictions of every page, laid out like the output of
+ *        XGBoosterPredict
+ * \param context passed to callback
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictStream(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   unsigned ntree_limit,
+                                   XGBCallbackPredictionPage *callback,
+                                   void *context);
+/*!
+ * \brief shrink a trained tree model for inference without changing its predictions.
+ *        Splits whose children are leaves of the same value are folded, and the nodes
+ *        of every tree are renumbered densely, dropping the slots of pruned nodes.  Leaf
+ *        indices change accordingly.
+ * \param handle handle
+ * \param out_len length of the report
+ * \param out_report JSON report with the number of trees, the nodes and bytes before
+ *        and after compaction, the folded splits and the features used by any split.
+ *        The string is managed by XGBoost.
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterCompactModel(BoosterHandle handle,
+                                  bst_ulong *out_len,
+                                  char const **out_report);
+/*!
+ * \brief calculate the importance of the features used by a tree model from the split
+ *        statistics, without dumping the model.
+ * \param handle handle
+ * \param importance_type one of "weight", "gain", "cover", "total_gain" and "total_cover"
+ * \param out_length used to store the number of features used in at least one split
+ * \param out_features used to set a pointer to the indices of these features
+ * \param out_scores used to set a pointer to the importance of each feature in out_features
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterFeatureScore(BoosterHandle handle,
+                                  const char *importance_type,
+                                  bst_ulong *out_length,
+                                  const unsigned **out_features,
+                                  const float **out_scores);
+/*!
+ * \brief get the leaf index of every row of dmat in every tree as integers.  The result is
+ *        the transpose of the leaf prediction of XGBoosterPredict, a tree major matrix of
+ *        out_n_trees rows and out_n_rows columns.  For a training matrix with the
+ *        `cache_leaf_index' parameter set, the indices are recorded while the trees are
+ *        built and returned without a copy.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param out_n_trees used to store the number of trees
+ * \param out_n_rows used to store the number of rows
+ * \param out_result used to set a pointer to the leaf indices, held by the booster until
+ *    the next update of or prediction on dmat
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      bst_ulong *out_n_trees,
+                                      bst_ulong *out_n_rows,
+                                      const unsigned **out_result);
+/*!
+ * \brief make prediction based on dmat like XGBoosterPredict, but write the result into
+ *        a caller owned float32 buffer given by an array interface, either
+ *        `__array_interface__' for host memory or `__cuda_array_interface__' for device
+ *        memory.  The result is copied once from where the predictor left it, so device
+ *        predictions never go through the host when the buffer is on device.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, same as XGBoosterPredict
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param training Whether the prediction value is used for training.
+ * \param c_out_interface json string of the array interface of the buffer, a contiguous
+ *    writable array with capacity for at least out_len values
+ * \param out_len used to store the number of values written to the buffer
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictToArray(BoosterHandle handle,
+                                    DMatrixHandle dmat,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    int training,
+                                    char const* c_out_interface,
+                                    bst_ulong *out_len);
+/*!
+ * \brief make prediction straight from a dense host array, without creating a DMatrix.
+ *        It's safe to call this function from multiple threads on one booster as long as
+ *        the booster is not modified at the same time.
+ * \param handle handle
+ * \param c_array_interface json string of the `__array_interface__' of a 2 dimension
+ *    array with one row for each sample
+ * \param missing value in the array to be treated as missing, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to the prediction, held by the calling thread
+ *    until its next inplace prediction
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      char const* c_array_interface,
+                                      float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      bst_ulong *out_len,
+                                      const float **out_result);
+/*!
+ * \brief make prediction straight from a CSR matrix given by array interfaces, without
+ *        creating a DMatrix.  Same as XGBoosterPredictFromDense otherwise.
+ * \param handle handle
+ * \param c_indptr json string of the `__array_interface__' of the uint64 row pointers
+ * \param c_indices json string of the `__array_interface__' of the uint32 feature indices
+ * \param c_values json string of the `__array_interface__' of the float32 values
+ * \param ncol number of columns, at most the number of features of the booster
+ * \param missing value to be treated as missing, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, same as XGBoosterPredictFromDense
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to the prediction, held by the calling thread
+ *    until its next inplace prediction
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    char const* c_indptr,
+                                    char const* c_indices,
+                                    char const* c_values,
+                                    bst_ulong ncol,
+                                    float missing,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    bst_ulong *out_len,
+                                    const float **out_result);
+/*!
+ * \brief make prediction straight from a dense device array given by
+ *        `__cuda_array_interface__', without creating a DMatrix.  The prediction is
+ *        left on the device of the array, out_result is a device pointer.  Same as
+ *        XGBoosterPredictFromDense otherwise.
+ */
+XGB_DLL int XGBoosterPredictFromCudaArray(BoosterHandle handle,
+                                          char const* c_array_interface,
+                                          float missing,
+                                          int option_mask,
+                                          unsigned ntree_limit,
+                                          bst_ulong *out_len,
+                                          const float **out_result);
+/*!
+ * \brief make prediction for one dense row, without creating a DMatrix.  It's safe to
+ *  call this function from multiple threads on one booster as long as the booster is not
+ *  modified at the same time, and it doesn't allocate once the calling thread has made
+ *  its first prediction.
+ * \param handle handle
+ * \param row pointer to the feature values of the row
+ * \param n_features number of values in row
+ * \param missing value in row to be treated as missing, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_result caller owned buffer that receives the prediction
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_len used to store the number of values written to out_result
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromDenseRow(BoosterHandle handle,
+                                         const float *row,
+                                         bst_ulong n_features,
+                                         float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         float *out_result,
+                                         bst_ulong out_size,
+                                         bst_ulong *out_len);
+/*!
+ * \brief make prediction for one sparse row given in CSR format, without creating a
+ *  DMatrix.  Same threading and allocation guarantees as XGBoosterPredictFromDenseRow.
+ * \param handle handle
+ * \param indices feature indices of the present values
+ * \param values present values of the row, NaN is treated as missing
+ * \param nnz number of present values
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_result caller owned buffer that receives the prediction
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_len used to store the number of values written to out_result
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromCSRRow(BoosterHandle handle,
+                                       const unsigned *indices,
+                                       const float *values,
+                                       bst_ulong nnz,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       float *out_result,
+                                       bst_ulong out_size,
+                                       bst_ulong *out_len);
+/*!
+ * \brief create a micro-batching front end for online prediction.  Rows submitted from
+ *  any thread are coalesced by a background worker, which waits at most `window_us'
+ *  after the first pending row, or until `max_batch' rows are pending, then predicts
+ *  them together and completes their tickets.  The booster must outlive the batcher
+ *  and must not be modified while the batcher is in use.
+ * \param handle handle
+ * \param window_us latency window in microseconds
+ * \param max_batch maximum number of rows predicted together
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out handle to the created batcher
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterCreatePredictionBatcher(BoosterHandle handle,
+                                             unsigned window_us,
+                                             bst_ulong max_batch,
+                                             int option_mask,
+                                             unsigned ntree_limit,
+                                             PredictionBatcherHandle *out);
+/*!
+ * \brief free a prediction batcher, rows still pending are predicted first.  Every
+ *  ticket of the batcher must be waited on before this call.
+ * \param handle handle of the batcher
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictionBatcherFree(PredictionBatcherHandle handle);
+/*!
+ * \brief submit one dense row to a prediction batcher.  The row is copied before
+ *  returning, while out_result is written asynchronously and must stay valid until the
+ *  ticket is waited on.
+ * \param handle handle of the batcher
+ * \param row pointer to the feature values of the row
+ * \param n_features number of values in row
+ * \param missing value in row to be treated as missing, NaN is always missing
+ * \param out_result caller owned buffer that receives the prediction
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_ticket ticket of the row, released by XGPredictionTicketWait
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictionBatcherSubmitDenseRow(PredictionBatcherHandle handle,
+                                              const float *row,
+                                              bst_ulong n_features,
+                                              float missing,
+                                              float *out_result,
+                                              bst_ulong out_size,
+                                              PredictionTicketHandle *out_ticket);
+/*!
+ * \brief submit one sparse row given in CSR format to a prediction batcher.  Same as
+ *  XGPredictionBatcherSubmitDenseRow otherwise.
+ * \param handle handle of the batcher
+ * \param indices feature indices of the present values
+ * \param values present values of the row, NaN is treated as missing
+ * \param nnz number of present values
+ * \param out_result caller owned buffer that receives the prediction
+ * \param out_size capacity of out_result, at least the number of output groups
+ * \param out_ticket ticket of the row, released by XGPredictionTicketWait
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictionBatcherSubmitCSRRow(PredictionBatcherHandle handle,
+                                            const unsigned *indices,
+                                            const float *values,
+                                            bst_ulong nnz,
+                                            float *out_result,
+                                            bst_ulong out_size,
+                                            PredictionTicketHandle *out_ticket);
+/*!
+ * \brief check whether the prediction of a submitted row is done, without blocking.
+ * \param handle handle of the ticket
+ * \param out_done set to 1 when the prediction is done, 0 otherwise
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictionTicketDone(PredictionTicketHandle handle, int *out_done);
+/*!
+ * \brief block until the prediction of a submitted row is done, then release the
+ *  ticket.  The ticket is released even when the prediction failed.
+ * \param handle handle of the ticket
+ * \param out_len used to store the number of values written to the output buffer
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictionTicketWait(PredictionTicketHandle handle, bst_ulong *out_len);
 /*
  * Short note for serialization APIs.  There are 3 different sets of serialization API.
  *
@@ -452,7 +1273,8 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
 /*!
  * \brief Load model from existing file
  * \param handle handle
- * \param fname file name
+ * \param fname file name, `.json' and `.ubj' are loaded as text JSON and UBJSON
+ *              respectively, other files are detected from the content.
 * \return 0 when success, -1 when failure happens
  */
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle,
@@ -460,11 +1282,52 @@ XGB_DLL int XGBoosterLoadModel(BoosterHandle handle,
 /*!
  * \brief Save model into existing file
  * \param handle handle
- * \param fname file name
+ * \param fname file name, `.json' saves text JSON and `.ubj' saves UBJSON, the binary
+ *              encoding of the same JSON document.  Other extensions use the binary
+ *              format.
  * \return 0 when success, -1 when failure happens
  */
 XGB_DLL int XGBoosterSaveModel(BoosterHandle handle,
                                const char *fname);
+/*!
+ * \brief Save the trees of a tree model into a flat, versioned file for serving.  The
+ *        file is used by `XGFlatModelLoad' directly from a read-only mapping, so every
+ *        process loading it on a host shares one copy.  The file is read by XGBoost of
+ *        the same byte order only.
+ * \param handle handle
+ * \param fname file name
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSaveFlatModel(BoosterHandle handle,
+                                   const char *fname);
+/*!
+ * \brief Load a model saved by `XGBoosterSaveFlatModel' for prediction.  Local files are
+ *        mapped instead of being read, other files are read into memory.
+ * \param fname file name
+ * \param out handle to the loaded model
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGFlatModelLoad(const char *fname, FlatModelHandle *out);
+/*!
+ * \brief free a flat model, unmapping its file
+ * \param handle the handle to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGFlatModelFree(FlatModelHandle handle);
+/*!
+ * \brief make prediction with a flat model.  Can be called from several threads at once.
+ * \param handle flat model handle
+ * \param dmat data matrix
+ * \param output_margin whether to output the untransformed margin
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array, valid until the next call of the thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGFlatModelPredict(FlatModelHandle handle,
+                               DMatrixHandle dmat,
+                               int output_margin,
+                               bst_ulong *out_len,
+                               const float **out_result);
 /*!
  * \brief load model from in memory buffer
  * \param handle handle
@@ -488,7 +1351,8 @@ XGB_DLL int XGBoosterGetModelRaw(BoosterHandle handle, bst_ulong *out_len,
 
 /*!
  * \brief Memory snapshot based serialization method.  Saves everything states
- * into buffer.
+ * into buffer.  The snapshot is UBJSON, or text JSON when
+ * `enable_experimental_json_serialization' is set.
  *
  * \param handle handle
  * \param out_len the argument to hold the output length
@@ -526,6 +1390,29 @@ XGB_DLL int XGBoosterLoadRabitCheckpoint(BoosterHandle handle,
  */
 XGB_DLL int XGBoosterSaveRabitCheckpoint(BoosterHandle handle);
 
+/*!
+ * \brief Append the trees committed since the last call, along with the current
+ *  configuration, to an append-only checkpoint file.  Unlike the rabit checkpoint, the
+ *  cost doesn't grow with the number of boosting rounds.  The whole model is written by
+ *  the first call, or when existing trees have been modified since the last call.
+ * \param handle handle
+ * \param fname path of the checkpoint, created when it doesn't exist
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterAppendCheckpoint(BoosterHandle handle, const char *fname);
+
+/*!
+ * \brief Load an append-only checkpoint by replaying its segments.  Later calls to
+ *  `XGBoosterAppendCheckpoint' on the same file continue from the loaded model.
+ * \param handle handle
+ * \param fname path of the checkpoint
+ * \param out_n_segments number of segments in the checkpoint, the number of times
+ *  `XGBoosterAppendCheckpoint' was called on it
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterLoadCheckpoint(BoosterHandle handle, const char *fname,
+                                    bst_ulong *out_n_segments);
+
 
 /*!
  * \brief Save XGBoost's internal configuration into a JSON document.  Currently the
@@ -585,6 +1472,51 @@ XGB_DLL int XGBoosterDumpModelEx(BoosterHandle handle,
                                  bst_ulong *out_len,
                                  const char ***out_dump_array);
 
+/*!
+ * \brief dump model into a file, in the format of the command line `dump' task.  Trees
+ *  are formatted in parallel and written a batch at a time, so the dump of the whole
+ *  model is never held in memory.
+ * \param handle handle
+ * \param fmap  name to fmap can be empty string
+ * \param with_stats whether to dump with statistics
+ * \param format the format to dump the model in
+ * \param fname path of the output file
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterDumpModelToFile(BoosterHandle handle,
+                                     const char *fmap,
+                                     int with_stats,
+                                     const char *format,
+                                     const char *fname);
+
+/*!
+ * \brief The callback receiving the dump of one booster.
+ * \param context user data passed to `XGBoosterDumpModelWithCallback'
+ * \param index index of the booster
+ * \param dump the dump of the booster, only valid during the call
+ * \return 0 to continue, anything else stops the dump with an error
+ */
+XGB_EXTERN_C typedef int XGBCallbackDumpModel(  // NOLINT(*)
+    void *context, bst_ulong index, const char *dump);
+
+/*!
+ * \brief dump model one booster at a time, the callback is invoked in order of the
+ *  boosters from the calling thread.
+ * \param handle handle
+ * \param fmap  name to fmap can be empty string
+ * \param with_stats whether to dump with statistics
+ * \param format the format to dump the model in
+ * \param callback called with the dump of each booster
+ * \param context user data passed to the callback
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterDumpModelWithCallback(BoosterHandle handle,
+                                           const char *fmap,
+                                           int with_stats,
+                                           const char *format,
+                                           XGBCallbackDumpModel *callback,
+                                           void *context);
+
 /*!
  * \brief dump model, return array of strings representing model dump
  * \param handle handle
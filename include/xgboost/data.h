@@ -14,6 +14,7 @@
 #include <xgboost/span.h>
 #include <xgboost/host_device_vector.h>
 
+#include <functional>
 #include <memory>
 #include <numeric>
 #include <algorithm>
@@ -33,6 +34,12 @@ enum class DataType : uint8_t {
   kUInt64 = 4
 };
 
+/*! \brief Type of a feature, categories of a categorical feature are non-negative integers. */
+enum class FeatureType : uint8_t {
+  kNumerical = 0,
+  kCategorical = 1
+};
+
 /*!
  * \brief Meta information about dataset, always sit in memory.
  */
@@ -62,6 +69,12 @@ class MetaInfo {
    * can be used to specify initial prediction to boost from.
    */
   HostDeviceVector<bst_float> base_margin_;
+  /*!
+   * \brief type of each feature, empty when all features are numerical.  Set with the
+   *  `feature_type' key of `SetInfo', using 0 for numerical and 1 for categorical.  It's
+   *  not part of the binary format and needs to be set again after loading.
+   */
+  HostDeviceVector<FeatureType> feature_types;
 
   /*! \brief default constructor */
   MetaInfo()  = default;
@@ -79,6 +92,8 @@ class MetaInfo {
     this->weights_.Copy(that.weights_);
     this->base_margin_.Resize(that.base_margin_.Size());
     this->base_margin_.Copy(that.base_margin_);
+    this->feature_types.Resize(that.feature_types.Size());
+    this->feature_types.Copy(that.feature_types);
     return *this;
   }
   /*!
@@ -89,19 +104,33 @@ class MetaInfo {
   inline bst_float GetWeight(size_t i) const {
     return weights_.Size() != 0 ?  weights_.HostVector()[i] : 1.0f;
   }
-  /*! \brief get sorted indexes (argsort) of labels by absolute value (used by cox loss) */
-  inline const std::vector<size_t>& LabelAbsSort() const {
-    if (label_order_cache_.size() == labels_.Size()) {
+  /*! \brief Whether feature `fid' is categorical. */
+  inline bool IsCategorical(bst_feature_t fid) const {
+    return fid < feature_types.Size() &&
+           feature_types.ConstHostVector()[fid] == FeatureType::kCategorical;
+  }
+  /*!
+   * \brief get sorted indexes (argsort) of labels by absolute value (used by cox loss).
+   *  The permutation is computed once and cached until the labels are set again, it can
+   *  be read on device after `SetDevice'.
+   */
+  inline const HostDeviceVector<size_t>& LabelAbsOrder() const {
+    if (label_order_cache_.Size() == labels_.Size()) {
       return label_order_cache_;
     }
-    label_order_cache_.resize(labels_.Size());
-    std::iota(label_order_cache_.begin(), label_order_cache_.end(), 0);
-    const auto& l = labels_.HostVector();
-    XGBOOST_PARALLEL_SORT(label_order_cache_.begin(), label_order_cache_.end(),
+    label_order_cache_.Resize(labels_.Size());
+    auto& order = label_order_cache_.HostVector();
+    std::iota(order.begin(), order.end(), 0);
+    const auto& l = labels_.ConstHostVector();
+    XGBOOST_PARALLEL_SORT(order.begin(), order.end(),
               [&l](size_t i1, size_t i2) {return std::abs(l[i1]) < std::abs(l[i2]);});
 
     return label_order_cache_;
   }
+  /*! \brief host copy of `LabelAbsOrder' */
+  inline const std::vector<size_t>& LabelAbsSort() const {
+    return LabelAbsOrder().ConstHostVector();
+  }
   /*! \brief clear all the information */
   void Clear();
   /*!
@@ -125,17 +154,19 @@ class MetaInfo {
   /*!
    * \brief Set information in the meta info with array interface.
    * \param key The key of the information.
-   * \param interface_str String representation of json format array interface.
+   * \param interface_str String representation of json format array interface, either a
+   *        single column or a list of columns:
    *
    *          [ column_0, column_1, ... column_n ]
    *
-   *        Right now only 1 column is permitted.
+   *        Right now only 1 column is permitted.  The column may live in host or device
+   *        memory; float fields given in device memory are copied device to device.
    */
   void SetInfo(const char* key, std::string const& interface_str);
 
  private:
   /*! \brief argsort of labels */
-  mutable std::vector<size_t> label_order_cache_;
+  mutable HostDeviceVector<size_t> label_order_cache_;
 };
 
 /*! \brief Element from a sparse vector */
@@ -251,18 +282,11 @@ class SparsePage {
 
   SparsePage GetTranspose(int num_columns) const;
 
-  void SortRows() {
-    auto ncol = static_cast<bst_omp_uint>(this->Size());
-#pragma omp parallel for default(none) shared(ncol) schedule(dynamic, 1)
-    for (bst_omp_uint i = 0; i < ncol; ++i) {
-      if (this->offset.HostVector()[i] < this->offset.HostVector()[i + 1]) {
-        std::sort(
-            this->data.HostVector().begin() + this->offset.HostVector()[i],
-            this->data.HostVector().begin() + this->offset.HostVector()[i + 1],
-            Entry::CmpValue);
-      }
-    }
-  }
+  /*!
+   * \brief Sort the entries of each row by value, rows are sorted in parallel with a
+   *  stable radix sort over the float keys.
+   */
+  void SortRows();
 
   /*!
    * \brief Push row block into the page.
@@ -307,6 +331,15 @@ class SortedCSCPage : public SparsePage {
   explicit SortedCSCPage(SparsePage page) : SparsePage(std::move(page)) {}
 };
 
+namespace common {
+/*!
+ * \brief A page of quantized feature values used by the CPU hist updater, defined in
+ *  src/common/hist_util.h.
+ */
+struct GHistIndexMatrix;
+class HistogramCuts;
+}  // namespace common
+
 class EllpackPageImpl;
 /*!
  * \brief A page stored in ELLPACK format.
@@ -341,6 +374,12 @@ class EllpackPage {
   /*! \brief Set the base row id for this page. */
   void SetBaseRowId(size_t row_id);
 
+  /*!
+   * \brief Quantize all rows of `dmat' again with the cuts of this page, skipping the
+   *  sketch.  Used after rows are appended to or dropped from an in-memory DMatrix.
+   */
+  void Requantize(DMatrix* dmat, const BatchParam& param);
+
   const EllpackPageImpl* Impl() const { return impl_.get(); }
   EllpackPageImpl* Impl() { return impl_.get(); }
 
@@ -404,6 +443,14 @@ class BatchSet {
   BatchIterator<T> begin_iter_;
 };
 
+/*!
+ * \brief Receives the predictions of a matrix one page at a time, so they can be written
+ *  out without holding the predictions of every row.  `base_row' is the first row of the
+ *  page and `preds' holds the outputs of its rows, one row after another.
+ */
+using PredictionSink =
+    std::function<void(size_t base_row, common::Span<bst_float const> preds)>;
+
 /*!
  * \brief This is data structure that user can pass to DMatrix::Create
  *  to create a DMatrix for training, user can create this data structure
@@ -459,6 +506,42 @@ class DMatrix {
     return Info().num_nonzero_ == Info().num_row_ * Info().num_col_;
   }
 
+  /*!
+   * \brief The cuts of the quantized matrix built by `GetBatches<GHistIndexMatrix>', used
+   *  for saving them along with a training checkpoint.
+   * \param [out] max_bin The max_bin the cuts are built with.
+   * \return nullptr when no quantized matrix is kept in memory.
+   */
+  virtual common::HistogramCuts const* GHistIndexCuts(int32_t* max_bin) const {
+    return nullptr;
+  }
+  /*!
+   * \brief Quantize the matrix with cuts restored from a training checkpoint instead of
+   *  sketching it again.  `GetBatches<GHistIndexMatrix>' with the same max_bin returns
+   *  the result.
+   * \return Whether the matrix supports restoring the cuts.
+   */
+  virtual bool SetGHistIndexCuts(common::HistogramCuts const& cuts, int32_t max_bin) {
+    return false;
+  }
+  /*!
+   * \brief The quantized matrix built by `GetBatches<GHistIndexMatrix>', for saving it in
+   *  a training cache.
+   * \param [out] max_bin The max_bin the matrix is built with.
+   * \return nullptr when no quantized matrix is kept in memory.
+   */
+  virtual common::GHistIndexMatrix const* GHistIndexPage(int32_t* max_bin) const {
+    return nullptr;
+  }
+  /*!
+   * \brief Restore the quantized matrix written by `GHistIndexMatrix::Save', skipping
+   *  both sketching and quantizing the matrix.
+   * \return Whether the matrix supports restoring it and the page has its rows.
+   */
+  virtual bool LoadGHistIndexPage(dmlc::Stream* fi, int32_t max_bin) {
+    return false;
+  }
+
   /*!
    * \brief Load DMatrix from URI.
    * \param uri The URI of input.
@@ -467,13 +550,15 @@ class DMatrix {
    * \param file_format The format type of the file, used for dmlc::Parser::Create.
    *   By default "auto" will be able to load in both local binary file.
    * \param page_size Page size for external memory.
+   * \param nthread Number of threads used for parsing text input, 0 for all available.
    * \return The created DMatrix.
    */
   static DMatrix* Load(const std::string& uri,
                        bool silent,
                        bool load_row_split,
                        const std::string& file_format = "auto",
-                       size_t page_size = kPageSize);
+                       size_t page_size = kPageSize,
+                       int32_t nthread = 0);
 
   /**
    * \brief Creates a new DMatrix from an external data adapter.
@@ -492,6 +577,22 @@ class DMatrix {
                          const std::string& cache_prefix = "",
                          size_t page_size = kPageSize);
 
+  /**
+   * \brief Creates a DMatrix holding only the data quantized for the hist tree method.
+   *        The adapter is sketched and quantized directly, without a CSR copy of it.
+   *
+   * \tparam  AdapterT  Type of the adapter.
+   * \param [in,out]  adapter  View onto an external data.
+   * \param           missing  Values to count as missing.
+   * \param           nthread  Number of threads for construction.
+   * \param           max_bin  Maximum number of bins, training must use the same value.
+   *
+   * \return  a Created DMatrix.
+   */
+  template <typename AdapterT>
+  static DMatrix* CreateQuantile(AdapterT* adapter, float missing, int nthread,
+                                 int max_bin);
+
 
   /*! \brief page size 32 MB */
   static const size_t kPageSize = 32UL << 20UL;
@@ -501,6 +602,7 @@ class DMatrix {
   virtual BatchSet<CSCPage> GetColumnBatches() = 0;
   virtual BatchSet<SortedCSCPage> GetSortedColumnBatches() = 0;
   virtual BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) = 0;
+  virtual BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) = 0;
 
   virtual bool EllpackExists() const = 0;
   virtual bool SparsePageExists() const = 0;
@@ -535,6 +637,11 @@ template<>
 inline BatchSet<EllpackPage> DMatrix::GetBatches(const BatchParam& param) {
   return GetEllpackBatches(param);
 }
+
+template<>
+inline BatchSet<common::GHistIndexMatrix> DMatrix::GetBatches(const BatchParam& param) {
+  return GetGHistIndexBatches(param);
+}
 }  // namespace xgboost
 
 namespace dmlc {
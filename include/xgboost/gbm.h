@@ -8,6 +8,7 @@
 #ifndef XGBOOST_GBM_H_
 #define XGBOOST_GBM_H_
 
+#include <dmlc/any.h>
 #include <dmlc/registry.h>
 #include <xgboost/base.h>
 #include <xgboost/data.h>
@@ -26,6 +27,7 @@ namespace xgboost {
 class Json;
 class FeatureMap;
 class ObjFunction;
+class ElementWiseGradient;
 
 struct GenericParameter;
 struct LearnerModelParam;
@@ -59,6 +61,47 @@ class GradientBooster : public Model, public Configurable {
    * \param fo output stream
    */
   virtual void Save(dmlc::Stream* fo) const = 0;
+  /*!
+   * \brief Make `out' hold the layers [layer_begin, layer_end) of this booster taken
+   *  every `step' layers, sharing the trees instead of copying them.
+   *
+   * \param layer_begin  First layer, inclusive.
+   * \param layer_end    End layer, exclusive.  0 means the end of the booster.
+   * \param step         Step between the taken layers.
+   * \param out          A booster of the same type.
+   * \param out_of_bound Set to true when the range exceeds the booster, `out' is left
+   *                     untouched.
+   */
+  virtual void Slice(int32_t layer_begin, int32_t layer_end, int32_t step,
+                     GradientBooster* out, bool* out_of_bound) const {
+    LOG(FATAL) << "Slice is not supported by the current booster.";
+  }
+  /*!
+   * \brief Write the trees in the flat format used for serving, see
+   *  `predictor::FlatModel'.
+   *
+   * \param objective Configuration of the objective transforming the predictions.
+   * \param fo        Output stream.
+   */
+  virtual void SaveFlatModel(Json const& objective, dmlc::Stream* fo) const {
+    LOG(FATAL) << "Flat model is not supported by the current booster.";
+  }
+  /*!
+   * \brief Save the model for an append-only checkpoint.  Only the boosters appended since
+   *  the last segment saved or loaded are included, every booster is saved when existing
+   *  ones have been modified or replaced in the meantime.
+   * \param p_out Output JSON object, applied to a model by `LoadModelSegment'.
+   */
+  virtual void SaveModelSegment(Json* p_out) {
+    this->SaveModel(p_out);
+  }
+  /*!
+   * \brief Apply a segment of an append-only checkpoint on top of the current model.
+   * \param in The segment, saved by `SaveModelSegment'.
+   */
+  virtual void LoadModelSegment(Json const& in) {
+    this->LoadModel(in);
+  }
   /*!
    * \brief whether the model allow lazy checkpoint
    * return true if model is only updated in DoBoost
@@ -76,6 +119,13 @@ class GradientBooster : public Model, public Configurable {
    */
   virtual void DoBoost(DMatrix* p_fmat, HostDeviceVector<GradientPair>* in_gpair,
                        PredictionCacheEntry *prediction) = 0;
+  /*!
+   * \brief Same as DoBoost, the gradient is computed from `grad' into `out_gpair' by the
+   *  booster, fused into the first pass of the updater over the rows when possible.
+   */
+  virtual void DoBoostWithGradient(DMatrix* p_fmat, ElementWiseGradient* grad,
+                                   HostDeviceVector<GradientPair>* out_gpair,
+                                   PredictionCacheEntry* prediction);
 
   /*!
    * \brief generate predictions for given feature matrix
@@ -92,6 +142,37 @@ class GradientBooster : public Model, public Configurable {
                             PredictionCacheEntry* out_preds,
                             bool training,
                             unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief predict the margin after each of several numbers of boosting iterations,
+   *        walking the trees once instead of once for every number.
+   * \param dmat feature matrix
+   * \param iterations numbers of iterations in increasing order, zero for the base margin
+   * \param out_preds the margins of the iterations one after another, each an nsample *
+   *        num_output_group matrix
+   */
+  virtual void PredictStaged(DMatrix* dmat, std::vector<unsigned> const& iterations,
+                             HostDeviceVector<bst_float>* out_preds) {
+    LOG(FATAL) << "Staged prediction is not supported by current booster.";
+  }
+  /*!
+   * \brief predict the margin one page of dmat at a time, handing each page to sink
+   *        instead of keeping the margins of all rows.
+   * \param dmat feature matrix
+   * \param ntree_limit limit the number of trees used in prediction, when it equals 0,
+   *        this means we do not limit number of trees
+   * \param sink receives the margins of each page, an nrow * num_output_group matrix
+   */
+  virtual void PredictStream(DMatrix* dmat, unsigned ntree_limit, PredictionSink const& sink) {
+    LOG(FATAL) << "Streaming prediction is not supported by current booster.";
+  }
+  /*!
+   * \brief Shrink the trained model for inference without changing its predictions,
+   *        see `RegTree::Compact'.
+   * \param report statistics of the model before and after compaction.
+   */
+  virtual void Compact(Json* report) {
+    LOG(FATAL) << "Model compaction is not supported by current booster.";
+  }
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -106,6 +187,32 @@ class GradientBooster : public Model, public Configurable {
   virtual void PredictInstance(const SparsePage::Inst& inst,
                                std::vector<bst_float>* out_preds,
                                unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief online prediction of one instance into a caller owned buffer, which must
+   *  hold one value for each output group.  Unlike `PredictInstance' this is threadsafe
+   *  as long as the booster is not modified at the same time.
+   *
+   * \param inst the instance you want to predict
+   * \param out_preds output buffer to hold the predictions
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  virtual void PredictRow(const SparsePage::Inst& inst,
+                          common::Span<bst_float> out_preds,
+                          unsigned ntree_limit = 0) const = 0;
+  /*!
+   * \brief predict straight from a data adapter, without a DMatrix or the prediction
+   *  cache.  Threadsafe as long as the booster is not modified at the same time.
+   *
+   * \param x shared pointer to one of the in memory adapters
+   * \param missing value in x treated as missing
+   * \param out_preds output vector to hold the raw predictions
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  virtual void InplacePredict(dmlc::any const& x, float missing,
+                              HostDeviceVector<bst_float>* out_preds,
+                              unsigned ntree_limit = 0) const {
+    LOG(FATAL) << "Inplace predict is not supported by current booster.";
+  }
   /*!
    * \brief predict the leaf index of each tree, the output will be nsample * ntree vector
    *        this is only valid in gbtree predictor
@@ -117,7 +224,29 @@ class GradientBooster : public Model, public Configurable {
   virtual void PredictLeaf(DMatrix* dmat,
                            std::vector<bst_float>* out_preds,
                            unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief predict the leaf index of each tree as integers into the prediction cache of
+   *        `dmat', the output is a tree major ntree * nsample matrix in `leaf_indices'.
+   *        Leaf indices recorded during training are returned without walking the trees.
+   * \param dmat feature matrix
+   * \param entry prediction cache entry of dmat
+   */
+  virtual void PredictLeafIndex(DMatrix* dmat, PredictionCacheEntry* entry) {
+    LOG(FATAL) << "Leaf index prediction is not supported by current booster.";
+  }
 
+  /*!
+   * \brief importance of the features used by the trees, computed from the split
+   *        statistics without dumping the model.
+   * \param importance_type one of weight, gain, cover, total_gain and total_cover
+   * \param features features used in at least one split
+   * \param scores importance of each feature in `features'
+   */
+  virtual void FeatureScore(std::string const& importance_type,
+                            std::vector<bst_feature_t>* features,
+                            std::vector<float>* scores) const {
+    LOG(FATAL) << "Feature importance is not defined for current booster.";
+  }
   /*!
    * \brief feature contributions to individual predictions; the output will be a vector
    *         of length (nfeats + 1) * num_output_group * nsample, arranged in that order
@@ -149,6 +278,18 @@ class GradientBooster : public Model, public Configurable {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief dump the model one booster at a time, so that the whole dump doesn't need to be
+   *  held in memory.
+   * \param visitor called with the index and the dump of each booster, in order
+   */
+  virtual void StreamDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                               std::function<void(size_t, std::string const&)> visitor) const {
+    auto dump = this->DumpModel(fmap, with_stats, format);
+    for (size_t i = 0; i < dump.size(); ++i) {
+      visitor(i, dump[i]);
+    }
+  }
   /*!
    * \brief Whether the current booster uses GPU.
    */
@@ -30,6 +30,8 @@ struct GenericParameter : public XGBoostParameter<GenericParameter> {
   bool enable_experimental_json_serialization {false};
   bool validate_parameters {false};
   bool validate_features {true};
+  // whether CPU training is bitwise reproducible regardless of the number of threads
+  bool deterministic {false};
 
   void CheckDeprecated() {
     if (this->n_gpus != 0) {
@@ -44,6 +46,11 @@ struct GenericParameter : public XGBoostParameter<GenericParameter> {
    * \param require_gpu  Whether GPU is explicitly required from user.
    */
   void ConfigureGpuId(bool require_gpu);
+  /*!
+   * \brief Number of threads used by the learner, `nthread' or the OpenMP default of the
+   *  calling thread when it's not set.
+   */
+  int32_t Threads() const;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(GenericParameter) {
@@ -70,14 +77,20 @@ struct GenericParameter : public XGBoostParameter<GenericParameter> {
         .describe("GPU page size when running in external memory mode.");
     DMLC_DECLARE_FIELD(enable_experimental_json_serialization)
         .set_default(false)
-        .describe("Enable using JSON for memory serialization (Python Pickle, "
-                  "rabit checkpoints etc.).");
+        .describe("Use text JSON instead of UBJSON for memory serialization (Python "
+                  "Pickle, rabit checkpoints etc.).");
     DMLC_DECLARE_FIELD(validate_parameters)
         .set_default(false)
         .describe("Enable checking whether parameters are used or not.");
     DMLC_DECLARE_FIELD(validate_features)
         .set_default(false)
         .describe("Enable validating input DMatrix.");
+    DMLC_DECLARE_FIELD(deterministic)
+        .set_default(false)
+        .describe("Make CPU training bitwise reproducible regardless of the number of "
+                  "threads.  Work is split into blocks of a fixed size and summed up in "
+                  "a fixed order, and 'hist' sums gradients as 64 bit integers when "
+                  "'gradient_quantization' is not set.");
     DMLC_DECLARE_FIELD(n_gpus)
         .set_default(0)
         .set_range(0, 1)
@@ -49,6 +49,7 @@
 #ifndef XGBOOST_HOST_DEVICE_VECTOR_H_
 #define XGBOOST_HOST_DEVICE_VECTOR_H_
 
+#include <cstdint>
 #include <initializer_list>
 #include <vector>
 
@@ -64,6 +65,20 @@ void SetCudaSetDeviceHandler(void (*handler)(int));
 
 template <typename T> struct HostDeviceVectorImpl;
 
+/*!
+ * \brief Bytes and copies moved between host and device by every `HostDeviceVector',
+ *  for finding the call sites moving data back and forth.  Always zero without CUDA.
+ */
+struct HostDeviceTransfers {
+  uint64_t host_to_device_bytes {0};
+  uint64_t device_to_host_bytes {0};
+  uint64_t n_host_to_device {0};
+  uint64_t n_device_to_host {0};
+};
+/*! \brief Transfers since the process started or the last reset. */
+HostDeviceTransfers GetHostDeviceTransfers();
+void ResetHostDeviceTransfers();
+
 /*!
  * \brief Controls data access from the GPU.
  *
@@ -116,6 +131,12 @@ class HostDeviceVector {
   std::vector<T>& HostVector();
   const std::vector<T>& ConstHostVector() const;
   const std::vector<T>& HostVector() const {return ConstHostVector(); }
+  /*!
+   * \brief Copy `size' elements starting at `begin' into `out', leaving the access of the
+   *  host and device unchanged.  Only the range is transferred when the host can't read,
+   *  use it to peek at a part of data kept on the device.
+   */
+  void CopyRangeToHost(size_t begin, size_t size, T* out) const;
 
   bool HostCanRead() const;
   bool HostCanWrite() const;
@@ -30,7 +30,12 @@ class Value {
     Object,  // std::map
     Array,   // std::vector
     Boolean,
-    Null
+    Null,
+    // typed arrays of numbers, stored contiguously without a Json for each element
+    F32Array,
+    U8Array,
+    I32Array,
+    I64Array
   };
 
   explicit Value(ValueKind _kind) : kind_{_kind} {}
@@ -122,6 +127,51 @@ class JsonArray : public Value {
   }
 };
 
+/*!
+ * \brief Array of numbers of the same type, written as a normal JSON array of numbers.
+ *  Used for large numeric arrays in models, which would otherwise allocate one value
+ *  for each element.
+ */
+template <typename T, Value::ValueKind kind>
+class JsonTypedArray : public Value {
+  std::vector<T> vec_;
+
+ public:
+  using ElemType = T;
+  static constexpr Value::ValueKind kKind = kind;
+
+  JsonTypedArray() : Value(kind) {}
+  explicit JsonTypedArray(size_t n) : Value(kind) { vec_.resize(n); }
+  JsonTypedArray(std::vector<T>&& arr) :  // NOLINT
+      Value(kind), vec_{std::move(arr)} {}
+  JsonTypedArray(JsonTypedArray const& that) = delete;
+  JsonTypedArray(JsonTypedArray&& that) : Value(kind), vec_{std::move(that.vec_)} {}
+
+  void Save(JsonWriter* writer) override;
+
+  Json& operator[](std::string const & key) override;
+  Json& operator[](int ind) override;
+
+  void Set(size_t i, T v) { vec_[i] = v; }
+  size_t Size() const { return vec_.size(); }
+
+  std::vector<T> const& getArray() &&      { return vec_; }
+  std::vector<T> const& getArray() const & { return vec_; }
+  std::vector<T>&       getArray()       & { return vec_; }
+
+  bool operator==(Value const& rhs) const override;
+  Value& operator=(Value const& rhs) override;
+
+  static bool isClassOf(Value const* value) {
+    return value->Type() == kind;
+  }
+};
+
+using F32Array = JsonTypedArray<float, Value::ValueKind::F32Array>;
+using U8Array = JsonTypedArray<uint8_t, Value::ValueKind::U8Array>;
+using I32Array = JsonTypedArray<int32_t, Value::ValueKind::I32Array>;
+using I64Array = JsonTypedArray<int64_t, Value::ValueKind::I64Array>;
+
 class JsonObject : public Value {
   std::map<std::string, Json> object_;
 
@@ -326,8 +376,13 @@ class Json {
   friend JsonWriter;
 
  public:
-  /*! \brief Load a Json object from string. */
-  static Json Load(StringView str);
+  /*!
+   * \brief Load a Json object from string.
+   *
+   * \param typed_arrays Parse arrays of integers or of floating points into I64Array and
+   *                     F32Array instead of Array, readers of the result must accept both.
+   */
+  static Json Load(StringView str, bool typed_arrays = false);
   /*! \brief Pass your own JsonReader. */
   static Json Load(JsonReader* reader);
   /*! \brief Dump json into stream. */
@@ -362,6 +417,16 @@ class Json {
     return *this;
   }
 
+  // typed array
+  template <typename T, Value::ValueKind kind>
+  explicit Json(JsonTypedArray<T, kind> list) :
+      ptr_ {new JsonTypedArray<T, kind>(std::move(list))} {}
+  template <typename T, Value::ValueKind kind>
+  Json& operator=(JsonTypedArray<T, kind> array) {
+    ptr_.reset(new JsonTypedArray<T, kind>(std::move(array)));
+    return *this;
+  }
+
   // object
   explicit Json(JsonObject object) :
       ptr_{new JsonObject(std::move(object))} {}
@@ -518,6 +583,16 @@ std::map<std::string, Json> const& GetImpl(T& val) {  // NOLINT
   return val.getObject();
 }
 
+// Typed array
+template <typename T,
+          typename std::enable_if<
+            std::is_same<T, JsonTypedArray<typename T::ElemType, T::kKind>>::value ||
+            std::is_same<T, JsonTypedArray<typename T::ElemType, T::kKind> const>::value
+            >::type* = nullptr>
+auto GetImpl(T& val) -> decltype(val.getArray()) {  // NOLINT
+  return val.getArray();
+}
+
 }  // namespace detail
 
 /*!
@@ -553,6 +628,49 @@ Object toJson(Parameter const& param) {
   return obj;
 }
 
+/*!
+ * \brief Copy a numeric array into `out', accepting both the typed arrays and an Array of
+ *  Number or Integer.
+ */
+template <typename T>
+void GetNumericArray(Json const& in, std::vector<T>* out) {
+  auto const& value = in.GetValue();
+  switch (value.Type()) {
+    case Value::ValueKind::F32Array: {
+      auto const& arr = Cast<F32Array const>(&value)->getArray();
+      out->assign(arr.cbegin(), arr.cend());
+      break;
+    }
+    case Value::ValueKind::U8Array: {
+      auto const& arr = Cast<U8Array const>(&value)->getArray();
+      out->assign(arr.cbegin(), arr.cend());
+      break;
+    }
+    case Value::ValueKind::I32Array: {
+      auto const& arr = Cast<I32Array const>(&value)->getArray();
+      out->assign(arr.cbegin(), arr.cend());
+      break;
+    }
+    case Value::ValueKind::I64Array: {
+      auto const& arr = Cast<I64Array const>(&value)->getArray();
+      out->assign(arr.cbegin(), arr.cend());
+      break;
+    }
+    default: {
+      auto const& arr = get<Array const>(in);
+      out->resize(arr.size());
+      for (size_t i = 0; i < arr.size(); ++i) {
+        auto const& elem = arr[i];
+        if (IsA<Integer>(elem)) {
+          (*out)[i] = static_cast<T>(get<Integer const>(elem));
+        } else {
+          (*out)[i] = static_cast<T>(get<Number const>(elem));
+        }
+      }
+    }
+  }
+}
+
 template <typename Parameter>
 void fromJson(Json const& obj, Parameter* param) {
   auto const& j_param = get<Object const>(obj);
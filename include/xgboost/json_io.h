@@ -55,6 +55,7 @@ class JsonReader {
   } cursor_;
 
   StringView raw_str_;
+  bool typed_arrays_ {false};
 
  protected:
   void SkipSpaces();
@@ -102,14 +103,22 @@ class JsonReader {
   virtual Json ParseObject();
   virtual Json ParseArray();
   virtual Json ParseNumber();
+  /*!
+   * \brief Parse an array whose first element is a number into a typed array, falls back
+   *  to Array when the elements don't share the same type.  The opening bracket is
+   *  already consumed.
+   */
+  Json ParseNumericArray();
+  // Parse a number without creating a Json value for it.
+  void ParseNumberImpl(bool* is_float, Number::Float* f, int64_t* i);
   virtual Json ParseBoolean();
   virtual Json ParseNull();
 
-  Json Parse();
+  virtual Json Parse();
 
  public:
-  explicit JsonReader(StringView str) :
-      raw_str_{str} {}
+  explicit JsonReader(StringView str, bool typed_arrays = false) :
+      raw_str_{str}, typed_arrays_{typed_arrays} {}
 
   virtual ~JsonReader() = default;
 
@@ -118,21 +127,42 @@ class JsonReader {
 
 class JsonWriter {
   static constexpr size_t kIndentSize = 2;
-  FixedPrecisionStream convertor_;
+  // Output gathered before it's handed to the stream.
+  static constexpr size_t kBufferSize = 1 << 16;
 
   size_t n_spaces_;
   std::ostream* stream_;
+  std::string buffer_;
+  // `buffer_' when writing to a stream, the output string otherwise
+  std::string* out_;
+  // nesting of `Save', the buffer is flushed when the outermost value is saved
+  int32_t depth_ {0};
   bool pretty_;
 
+  void Flush() {
+    if (stream_ != nullptr) {
+      stream_->write(buffer_.data(), buffer_.size());
+      buffer_.clear();
+    }
+  }
+
  public:
   JsonWriter(std::ostream* stream, bool pretty) :
-      n_spaces_{0}, stream_{stream}, pretty_{pretty} {}
+      n_spaces_{0}, stream_{stream}, out_{&buffer_}, pretty_{pretty} {
+    buffer_.reserve(kBufferSize);
+  }
+  /*! \brief Append the output to `out' directly instead of going through a stream. */
+  JsonWriter(std::string* out, bool pretty) :
+      n_spaces_{0}, stream_{nullptr}, out_{out}, pretty_{pretty} {}
+  JsonWriter(JsonWriter const&) = delete;
+  JsonWriter& operator=(JsonWriter const&) = delete;
 
   virtual ~JsonWriter() = default;
 
   void NewLine() {
     if (pretty_) {
-      *stream_ << u8"\n" << std::string(n_spaces_, ' ');
+      out_->push_back('\n');
+      out_->append(n_spaces_, ' ');
     }
   }
 
@@ -143,11 +173,29 @@ class JsonWriter {
     n_spaces_ -= kIndentSize;
   }
 
-  void Write(std::string str) {
-    *stream_ << str;
+  void Write(std::string const& str) {
+    this->Write(StringView{str.c_str(), str.size()});
   }
   void Write(StringView str) {
-    stream_->write(str.c_str(), str.size());
+    out_->append(str.c_str(), str.size());
+    if (stream_ != nullptr && buffer_.size() >= kBufferSize) {
+      this->Flush();
+    }
+  }
+  /*!
+   * \brief Space for writing at most `n' characters in place, `Commit' the number of
+   *  characters actually written afterward.
+   */
+  char* Reserve(size_t n) {
+    size_t const size = out_->size();
+    out_->resize(size + n);
+    return &(*out_)[size];
+  }
+  void Commit(char const* end) {
+    out_->resize(end - out_->data());
+    if (stream_ != nullptr && buffer_.size() >= kBufferSize) {
+      this->Flush();
+    }
   }
 
   void Save(Json json);
@@ -159,7 +207,64 @@ class JsonWriter {
   virtual void Visit(JsonNull   const* null);
   virtual void Visit(JsonString const* str);
   virtual void Visit(JsonBoolean const* boolean);
+  virtual void Visit(F32Array const* arr);
+  virtual void Visit(U8Array const* arr);
+  virtual void Visit(I32Array const* arr);
+  virtual void Visit(I64Array const* arr);
+};
+
+/*
+ * \brief Reader for UBJSON (https://ubjson.org), a binary encoding of the same document
+ *  tree.  Containers with both a type and a count are parsed into typed arrays.
+ */
+class UBJReader : public JsonReader {
+  template <typename T> T ReadPrimitive();
+  int64_t ReadInteger(char marker);
+  std::string DecodeStr();
+  Json DecodeArray();
+  Json DecodeObject();
+  template <typename T, typename TypedArray> Json DecodeTypedArray(int64_t n);
+
+ protected:
+  Json Parse() override;
+
+ public:
+  explicit UBJReader(StringView str) : JsonReader(str, true) {}
 };
+
+/*
+ * \brief Writer for UBJSON, typed arrays are written as containers with a type and a
+ *  count, followed by their elements in big endian.
+ */
+class UBJWriter : public JsonWriter {
+ public:
+  explicit UBJWriter(std::ostream* stream) : JsonWriter(stream, false) {}
+  explicit UBJWriter(std::string* out) : JsonWriter(out, false) {}
+
+  void Visit(JsonArray  const* arr) override;
+  void Visit(JsonObject const* obj) override;
+  void Visit(JsonNumber const* num) override;
+  void Visit(JsonInteger const* num) override;
+  void Visit(JsonNull   const* null) override;
+  void Visit(JsonString const* str) override;
+  void Visit(JsonBoolean const* boolean) override;
+  void Visit(F32Array const* arr) override;
+  void Visit(U8Array const* arr) override;
+  void Visit(I32Array const* arr) override;
+  void Visit(I64Array const* arr) override;
+};
+
+/*!
+ * \brief Whether a buffer starting with `{' is an UBJSON object instead of text, the
+ *  second byte of an UBJSON object is the marker of a key length or of a count.
+ */
+inline bool IsUBJObject(char const* header, size_t size) {
+  if (size < 2 || header[0] != '{') {
+    return false;
+  }
+  char c = header[1];
+  return c == 'i' || c == 'U' || c == 'I' || c == 'l' || c == 'L' || c == '#';
+}
 }      // namespace xgboost
 
 #endif  // XGBOOST_JSON_IO_H_
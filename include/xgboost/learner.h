@@ -8,13 +8,17 @@
 #ifndef XGBOOST_LEARNER_H_
 #define XGBOOST_LEARNER_H_
 
+#include <dmlc/any.h>
 #include <rabit/rabit.h>
 #include <xgboost/base.h>
+#include <xgboost/data.h>
 #include <xgboost/feature_map.h>
 #include <xgboost/generic_parameters.h>
 #include <xgboost/host_device_vector.h>
 #include <xgboost/model.h>
 
+#include <functional>
+#include <future>
 #include <utility>
 #include <map>
 #include <memory>
@@ -80,6 +84,30 @@ class Learner : public Model, public Configurable, public rabit::Serializable {
   virtual std::string EvalOneIter(int iter,
                                   const std::vector<std::shared_ptr<DMatrix>>& data_sets,
                                   const std::vector<std::string>& data_names) = 0;
+  /*!
+   * \brief Same as `EvalOneIter', but only the predictions are made before returning.  The
+   *  metrics run on another thread and training for the next iteration can proceed in the
+   *  meantime, the returned future holds the evaluation result.
+   *
+   *  The data sets must not be changed until the result is ready.  The metrics of
+   *  distributed training are computed before returning, as they synchronize the workers.
+   */
+  virtual std::shared_future<std::string>
+  EvalOneIterAsync(int iter, const std::vector<std::shared_ptr<DMatrix>>& data_sets,
+                   const std::vector<std::string>& data_names) = 0;
+  /*!
+   * \brief Same as `EvalOneIter', but the results are returned as numbers instead of
+   *  being formatted.
+   * \param iter iteration number
+   * \param data_sets datasets to be evaluated.
+   * \param out_results the metrics of the first data set followed by those of the next,
+   *   empty when the iteration is skipped by `eval_period'.
+   * \param out_metric_names name of each metric.
+   */
+  virtual void EvalOneIterValues(int iter,
+                                 const std::vector<std::shared_ptr<DMatrix>>& data_sets,
+                                 std::vector<bst_float>* out_results,
+                                 std::vector<std::string>* out_metric_names) = 0;
   /*!
    * \brief get prediction given the model.
    * \param data input data
@@ -92,6 +120,8 @@ class Learner : public Model, public Configurable, public rabit::Serializable {
    * \param pred_contribs whether to only predict the feature contributions
    * \param approx_contribs whether to approximate the feature contributions for speed
    * \param pred_interactions whether to compute the feature pair contributions
+   * \param cache_prediction whether to keep the prediction of data for later calls, a one
+   *   off prediction without it leaves the prediction cache untouched
    */
   virtual void Predict(std::shared_ptr<DMatrix> data,
                        bool output_margin,
@@ -101,13 +131,161 @@ class Learner : public Model, public Configurable, public rabit::Serializable {
                        bool pred_leaf = false,
                        bool pred_contribs = false,
                        bool approx_contribs = false,
-                       bool pred_interactions = false) = 0;
+                       bool pred_interactions = false,
+                       bool cache_prediction = true) = 0;
+  /*!
+   * \brief free the predictions cached for data, they are computed again from the first
+   *        tree by the next prediction on it.  The size of the cache is bounded by the
+   *        `prediction_cache_mb' parameter.
+   * \param data input data, nullptr for every cached matrix
+   */
+  virtual void ReleasePredictionCache(DMatrix* data) = 0;
+  /*!
+   * \brief get the prediction after each of several numbers of boosting iterations in
+   *        one pass over the trees, for example to pick a number of trees or to plot a
+   *        learning curve without predicting once for every iteration.
+   * \param data input data
+   * \param iterations numbers of iterations in increasing order, zero for the base margin
+   * \param output_margin whether to only predict margin value instead of transformed
+   *        prediction
+   * \param out_preds the predictions of the iterations one after another, each laid out
+   *        like the output of `Predict'
+   */
+  virtual void PredictStaged(std::shared_ptr<DMatrix> data,
+                             std::vector<unsigned> const& iterations, bool output_margin,
+                             HostDeviceVector<bst_float>* out_preds) = 0;
+  /*!
+   * \brief get the prediction one page of data at a time, for example to score an
+   *        external memory matrix with memory bounded by the size of its pages.  Loading
+   *        and predicting a page overlaps with the sink of the previous one.
+   * \param data input data
+   * \param output_margin whether to only predict margin value instead of transformed
+   *        prediction
+   * \param ntree_limit limit number of trees used for boosted tree
+   *        predictor, when it equals 0, this means we are using all the trees
+   * \param sink receives the predictions of each page in the order of the rows, laid out
+   *        like the output of `Predict'
+   */
+  virtual void PredictStream(std::shared_ptr<DMatrix> data, bool output_margin,
+                             unsigned ntree_limit, PredictionSink const& sink) = 0;
+  /*!
+   * \brief get the leaf index of every row in every tree as integers, a tree major
+   *        n_trees * n_rows matrix that is the transpose of the `pred_leaf' output.  With
+   *        `cache_leaf_index' the indices of a training matrix are recorded while the trees
+   *        are built and returned without a copy.
+   * \param data input data
+   * \param out_trees number of trees in the result
+   * \return leaf indices held by the prediction cache of data, valid until the next update
+   *         or prediction on it.
+   */
+  virtual HostDeviceVector<uint32_t> const& PredictLeafIndex(std::shared_ptr<DMatrix> data,
+                                                             size_t* out_trees) = 0;
+  /*!
+   * \brief calculate the importance of the features used by the model, see
+   *        `GradientBooster::FeatureScore'.
+   * \param importance_type one of weight, gain, cover, total_gain and total_cover
+   * \param features features used in at least one split
+   * \param scores importance of each feature in `features'
+   */
+  virtual void CalcFeatureScore(std::string const& importance_type,
+                                std::vector<bst_feature_t>* features,
+                                std::vector<float>* scores) = 0;
+  /*!
+   * \brief predict one row without going through a DMatrix.
+   *
+   *  Safe to call from several threads at once as long as the booster is not modified
+   *  at the same time, and does not allocate once each calling thread has warmed up.
+   *
+   * \param inst the row to predict, with feature indices less than the number of features
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param out_preds caller owned buffer, with at least one value for each output group
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   * \return number of prediction values written to out_preds
+   */
+  virtual size_t PredictRow(SparsePage::Inst const& inst,
+                            bool output_margin,
+                            common::Span<bst_float> out_preds,
+                            unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief predict straight from a data adapter, without creating a DMatrix or going
+   *  through the prediction cache.  Safe to call from several threads at once as long as
+   *  the booster is not modified at the same time.
+   *
+   * \param x shared pointer to one of the in memory adapters in `src/data'
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param missing value in x treated as missing, NaN is always missing
+   * \param out_preds set to the prediction, held by a buffer of the calling thread until
+   *   its next inplace prediction.  It's on the device of x for device adapters.
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   */
+  virtual void InplacePredict(dmlc::any const& x, bool output_margin, float missing,
+                              HostDeviceVector<bst_float>** out_preds,
+                              unsigned ntree_limit = 0) = 0;
 
   void LoadModel(Json const& in) override = 0;
   void SaveModel(Json* out) const override = 0;
 
   virtual void LoadModel(dmlc::Stream* fi) = 0;
   virtual void SaveModel(dmlc::Stream* fo) const = 0;
+  /*!
+   * \brief Save the trees and the objective in the flat, read-only format used for
+   *  serving.  It is loaded by `predictor::FlatModel' and can not be trained further.
+   * \param fo Output stream.
+   */
+  virtual void SaveFlatModel(dmlc::Stream* fo) = 0;
+  /*!
+   * \brief Append a segment to an append-only checkpoint.  A segment holds the current
+   *  configuration and the boosters committed since the last segment this learner saved
+   *  or loaded, so the cost of a checkpoint doesn't grow with the size of the model.
+   *  Every booster is written when there's no previous segment, or when existing boosters
+   *  have been modified since then.
+   * \param fo Output stream, usually a file opened for appending.
+   */
+  virtual void SaveCheckpointSegment(dmlc::Stream* fo) = 0;
+  /*!
+   * \brief Load a checkpoint written by `SaveCheckpointSegment', replaying the segments in
+   *  order.  A truncated last segment, from an interrupted save, is ignored.
+   * \param fi Input stream.
+   * \return The number of segments loaded.
+   */
+  virtual size_t LoadCheckpoint(dmlc::Stream* fi) = 0;
+  /*!
+   * \brief Save the prediction margins of a training matrix and the histogram cuts built
+   *  for it, so that training continued from the current model on the same data can
+   *  skip predicting the existing trees and sketching the data again.
+   * \param data      The training matrix, it must contain rows.
+   * \param fo        Output stream.
+   * \param quantized Whether to save the whole quantized matrix along with the cuts, so
+   *                  quantizing the data is skipped too.
+   */
+  virtual void SaveTrainingCache(std::shared_ptr<DMatrix> data, dmlc::Stream* fo,
+                                 bool quantized) = 0;
+  /*!
+   * \brief Restore what `SaveTrainingCache' wrote.  Nothing is restored when the data
+   *  differ from the ones it was saved with.  The cuts and the quantized matrix are
+   *  restored for any model, like that of a worker recovering from a checkpoint, the
+   *  prediction margins only for the model they were saved with.
+   * \param data The training matrix.
+   * \param fi   Input stream.
+   * \return Whether the prediction margins were restored.
+   */
+  virtual bool LoadTrainingCache(std::shared_ptr<DMatrix> data, dmlc::Stream* fi) = 0;
+
+  /*!
+   * \brief Save the configuration as a JSON string, configuring the learner first.  The
+   *  string is kept until a parameter changes or the learner is trained, so saving again
+   *  in between costs a copy.
+   * \param out Output string.
+   */
+  virtual void SaveJsonConfig(std::string* out) = 0;
+  /*!
+   * \brief Load a configuration saved by `SaveJsonConfig'.  Nothing is done when it equals
+   *  the current configuration.
+   * \param config JSON string.
+   */
+  virtual void LoadJsonConfig(std::string const& config) = 0;
 
   /*!
    * \brief Set multiple parameters at once.
@@ -167,6 +345,38 @@ class Learner : public Model, public Configurable, public rabit::Serializable {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief dump the model one booster at a time, trees are formatted in parallel.
+   * \param visitor called with the index and the dump of each booster, in order
+   */
+  virtual void StreamDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                               std::function<void(size_t, std::string const&)> visitor)
+      const = 0;
+  /*!
+   * \brief Write the dump of all boosters into a stream, as a JSON array of trees for the
+   *  "json" format, or one "booster[i]:" section per booster otherwise.
+   */
+  void SaveDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                     dmlc::Stream* fo) const;
+  /*!
+   * \brief Create a learner holding the layers [begin_layer, end_layer) of this model,
+   *  taken every `step' layers.  The trees are shared with this learner, so no model is
+   *  copied.  The attributes describing early stopping are not kept.
+   * \param begin_layer  First layer, inclusive.
+   * \param end_layer    End layer, exclusive.  0 means the last layer.
+   * \param step         Step between the taken layers.
+   * \param out_of_bound Set to true when the range exceeds the model, nullptr is returned.
+   * \return The sliced learner, owned by the caller.
+   */
+  virtual Learner* Slice(int32_t begin_layer, int32_t end_layer, int32_t step,
+                         bool* out_of_bound) = 0;
+  /*!
+   * \brief Shrink the trained model for inference: splits with two identical leaves are
+   *  folded and the nodes of every tree are renumbered densely.  Predictions are kept,
+   *  leaf indices and the statistics of folded nodes are not.
+   * \param report Number of nodes, bytes and features used, before and after.
+   */
+  virtual void Compact(Json* report) = 0;
   /*!
    * \brief Create a new instance of learner.
    * \param cache_data The matrix to cache the prediction.
@@ -192,6 +402,36 @@ class Learner : public Model, public Configurable, public rabit::Serializable {
   GenericParameter generic_parameters_;
 };
 
+/*!
+ * \brief k-fold cross validation on a single matrix.  Each fold is a view of `data'
+ *  weighting out the rows of the other folds, so the quantized pages are built once and
+ *  shared by the boosters.  On CPU the boosters are trained at the same time, each with
+ *  a share of `nthread'.  Every round is evaluated.
+ * \param params parameters of every booster.
+ * \param data matrix of all folds, without query groups.
+ * \param folds fold of each row of data, from 0 to the number of folds minus one.
+ * \param num_round number of rounds to train.
+ * \param out_results for each round and each fold, the metrics on the training rows
+ *   followed by those on the rows of the fold.
+ * \param out_metric_names name of each metric.
+ */
+void CrossValidate(Args const& params, std::shared_ptr<DMatrix> data,
+                   std::vector<int32_t> const& folds, int32_t num_round,
+                   std::vector<bst_float>* out_results,
+                   std::vector<std::string>* out_metric_names);
+
+/*!
+ * \brief Train several boosters on the same matrix at the same time, each with a share of
+ *  `nthread'.  Boosters growing trees with `hist' on CPU build the root histograms of
+ *  their trees together, in one pass over the quantized matrix, see common::HistBatch.
+ * \param learners boosters to train, the `nthread' of the first one is shared.
+ * \param dtrain training matrix of every booster.
+ * \param begin_iteration first round to train.
+ * \param num_round number of rounds to train.
+ */
+void TrainBatched(std::vector<Learner*> const& learners, std::shared_ptr<DMatrix> dtrain,
+                  int32_t begin_iteration, int32_t num_round);
+
 struct LearnerModelParamLegacy;
 
 /*
@@ -12,6 +12,7 @@
 #include <xgboost/data.h>
 #include <xgboost/base.h>
 #include <xgboost/host_device_vector.h>
+#include <xgboost/logging.h>
 
 #include <vector>
 #include <string>
@@ -45,6 +46,27 @@ class Metric {
   virtual bst_float Eval(const HostDeviceVector<bst_float>& preds,
                          const MetaInfo& info,
                          bool distributed) = 0;
+  /*!
+   * \brief Statistics of the local rows that are summed over the workers to evaluate
+   *  the metric, so that all metrics of an iteration share a single allreduce.
+   * \param preds prediction
+   * \param info information, including label etc.
+   * \param out_stats the statistics are appended to it
+   * \return number of statistics, 0 for metrics that can only be evaluated with `Eval'
+   */
+  virtual size_t EvalStatistics(const HostDeviceVector<bst_float>& preds,
+                                const MetaInfo& info,
+                                std::vector<double>* out_stats) {
+    return 0;
+  }
+  /*!
+   * \brief evaluate the metric from the statistics of `EvalStatistics', summed over the
+   *  workers in distributed evaluation
+   */
+  virtual bst_float EvalFromStatistics(double const* stats) const {
+    LOG(FATAL) << "Metric " << this->Name() << " has no statistics.";
+    return 0;
+  }
   /*! \return name of metric */
   virtual const char* Name() const = 0;
   /*! \brief virtual destructor */
@@ -18,9 +18,31 @@
 #include <utility>
 #include <string>
 #include <functional>
+#include <memory>
 
 namespace xgboost {
 
+/*!
+ * \brief Gradient of an objective whose rows are independent of each other.  Updaters
+ *  compute it on blocks of rows in their first pass over the data instead of reading a
+ *  gradient materialized by a separate pass.
+ */
+class ElementWiseGradient {
+ public:
+  virtual ~ElementWiseGradient() = default;
+  /*! \brief Number of rows of the gradient. */
+  virtual size_t Size() const = 0;
+  /*!
+   * \brief Write the gradient of rows [begin, end) to out_gpair[0, end - begin), can be
+   *  called concurrently for disjoint rows.
+   */
+  virtual void Compute(size_t begin, size_t end, GradientPair* out_gpair) = 0;
+  /*! \brief Fail on invalid labels seen by the calls to Compute. */
+  virtual void Validate() const = 0;
+  /*! \brief Compute and validate the gradient of all rows. */
+  virtual void ComputeAll(HostDeviceVector<GradientPair>* out_gpair) = 0;
+};
+
 /*! \brief interface of objective function */
 class ObjFunction : public Configurable {
  protected:
@@ -72,6 +94,16 @@ class ObjFunction : public Configurable {
   virtual bst_float ProbToMargin(bst_float base_score) const {
     return base_score;
   }
+  /*!
+   * \brief The same gradient as GetGradient, computed lazily by the booster.  `preds' and
+   *  `info' must outlive the returned object.
+   * \return nullptr when the objective has no element-wise gradient for this device.
+   */
+  virtual std::unique_ptr<ElementWiseGradient>
+  GetElementWiseGradient(const HostDeviceVector<bst_float>& preds, const MetaInfo& info,
+                         int iteration) {
+    return nullptr;
+  }
   /*!
    * \brief Create an objective function according to name.
    * \param tparam Generic parameters.
@@ -5,6 +5,7 @@
  *  performs predictions for a gradient booster.
  */
 #pragma once
+#include <dmlc/any.h>
 #include <xgboost/base.h>
 #include <xgboost/data.h>
 #include <xgboost/generic_parameters.h>
@@ -12,6 +13,7 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -38,6 +40,16 @@ struct PredictionCacheEntry {
   uint32_t version;
   // A weak pointer for checking whether the DMatrix object has expired.
   std::weak_ptr< DMatrix > ref;
+  // Held by callers updating `predictions' concurrently.
+  std::mutex lock;
+  // Leaf index of each row in each tree as a tree major matrix, see
+  // `GradientBooster::PredictLeafIndex'.
+  HostDeviceVector<uint32_t> leaf_indices;
+  // Number of trees in `leaf_indices' and the generation of the model they come from.
+  uint32_t leaf_trees {0};
+  uint64_t leaf_generation {0};
+  // When the entry was last returned by `PredictionContainer::Cache'.
+  uint64_t last_use {0};
 
   PredictionCacheEntry() : version { 0 } {}
   /* \brief Update the cache entry by number of versions.
@@ -47,13 +59,34 @@ struct PredictionCacheEntry {
   void Update(uint32_t v) {
     version += v;
   }
+  /* \brief Free the cached values, the next prediction starts again from the first tree.
+   *        Callers other than the owning container hold `lock'.
+   */
+  void Reset() {
+    predictions = HostDeviceVector<bst_float>();
+    leaf_indices = HostDeviceVector<uint32_t>();
+    version = 0;
+    leaf_trees = 0;
+    leaf_generation = 0;
+  }
+  /* \brief Memory held by the cached values. */
+  size_t Bytes() const {
+    return predictions.Size() * sizeof(bst_float) + leaf_indices.Size() * sizeof(uint32_t);
+  }
 };
 
 /* \brief A container for managed prediction caches.
  */
 class PredictionContainer {
   std::unordered_map<DMatrix *, PredictionCacheEntry> container_;
+  // Bound of the cached bytes, zero for no bound.
+  size_t max_bytes_ {0};
+  uint64_t clock_ {0};
   void ClearExpiredEntries();
+  /* \brief Reset the least recently used entries other than `keep' until the cache is
+   *        within `max_bytes_'.  Entries locked by a prediction are skipped.
+   */
+  void EvictLeastRecentlyUsed(DMatrix const* keep);
 
  public:
   PredictionContainer() = default;
@@ -78,6 +111,18 @@ class PredictionContainer {
    *         created.
    */
   PredictionCacheEntry& Cache(std::shared_ptr<DMatrix> m, int32_t device);
+  /* \brief Bound the memory held by the cached predictions.  Once it's exceeded, the
+   *        least recently used entries are reset by `Cache', entries are kept in the
+   *        container so references to them stay valid.
+   *
+   * \param bytes Upper bound in bytes, zero for no bound.
+   */
+  void SetMaxBytes(size_t bytes) { max_bytes_ = bytes; }
+  /* \brief Free the predictions cached for a DMatrix, waiting for the ones in use.
+   *
+   * \param m pointer to the DMatrix, nullptr for every cached DMatrix.
+   */
+  void Release(DMatrix* m);
   /* \brief Get a prediction cache entry.  This entry must be already allocated by `Cache`
    *        method.  Otherwise a dmlc::Error is thrown.
    *
@@ -133,6 +178,47 @@ class Predictor {
                             const gbm::GBTreeModel& model, int tree_begin,
                             uint32_t const ntree_limit = 0) = 0;
 
+  /**
+   * \brief Add the leaf values of some trees, each multiplied by its own weight, to the
+   *  predictions.  Used by the dart booster for its scaled and dropped trees.
+   *
+   * \param           dmat          Feature matrix.
+   * \param [in,out]  out_preds     Margin of each output group for every row.
+   * \param           model         The model to predict from.
+   * \param           trees         Indices of the trees to add.
+   * \param           tree_weights  Weight of each tree in `trees'.
+   */
+  virtual void PredictWeighted(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                               const gbm::GBTreeModel& model,
+                               std::vector<size_t> const& trees,
+                               std::vector<bst_float> const& tree_weights) = 0;
+  /**
+   * \brief Predict the margins of several tree prefixes of the forest in one walk over
+   *  its trees, each tree is visited once for every row whatever the number of stages.
+   *
+   * \param           dmat        Feature matrix.
+   * \param           model       The model to predict from.
+   * \param           tree_ends   Number of trees of each stage, in increasing order.
+   * \param [out]     out_preds   Margins of the stages one after another, each with a
+   *                              value for each row and output group.
+   */
+  virtual void PredictStaged(DMatrix* dmat, const gbm::GBTreeModel& model,
+                             std::vector<uint32_t> const& tree_ends,
+                             HostDeviceVector<bst_float>* out_preds) = 0;
+  /**
+   * \brief Predict the margins of the matrix one page at a time and hand each page to
+   *  `sink', for matrices whose predictions are too large to be held at once.  Loading
+   *  and predicting a page overlaps with the sink of the previous one, the sink is called
+   *  for one page at a time in the order of the rows.
+   *
+   * \param           dmat      Feature matrix.
+   * \param           model     The model to predict from.
+   * \param           tree_end  Number of trees to predict with.
+   * \param           sink      Receives the margins of every page.
+   */
+  virtual void PredictStream(DMatrix* dmat, const gbm::GBTreeModel& model,
+                             uint32_t tree_end, PredictionSink const& sink) = 0;
+
   /**
    * \brief online prediction function, predict score for one instance at a time
    * NOTE: use the batch prediction interface if possible, batch prediction is
@@ -150,6 +236,38 @@ class Predictor {
                                const gbm::GBTreeModel& model,
                                unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \brief Online prediction of one instance into a caller owned buffer.  Unlike
+   *  `PredictInstance' this is safe to call from several threads at once, and does not
+   *  allocate once the calling thread has predicted with a model of the same number of
+   *  features.
+   *
+   * \param           inst        The instance to predict.
+   * \param [out]     out_preds   One value for each output group.
+   * \param           model       The model to predict from
+   * \param           ntree_limit (Optional) The ntree limit.
+   */
+  virtual void PredictRow(const SparsePage::Inst& inst,
+                          common::Span<bst_float> out_preds,
+                          const gbm::GBTreeModel& model,
+                          unsigned ntree_limit = 0) const;
+
+  /**
+   * \brief Predict straight from a data adapter, without a DMatrix or the prediction
+   *  cache.  Predictions start from the base score, there is no base margin.
+   *
+   * \param           x           Shared pointer to one of the in memory adapters.
+   * \param           model       The model to predict from.
+   * \param           missing     Value in x treated as missing, NaN is always missing.
+   * \param [out]     out_preds   One value for each row and output group.
+   * \param           ntree_limit (Optional) The ntree limit.
+   *
+   * \return false when the adapter type is not supported by this predictor.
+   */
+  virtual bool InplacePredict(dmlc::any const& x, const gbm::GBTreeModel& model,
+                              float missing, HostDeviceVector<bst_float>* out_preds,
+                              unsigned ntree_limit = 0);
+
   /**
    * \fn  virtual void Predictor::PredictLeaf(DMatrix* dmat,
    * std::vector<bst_float>* out_preds, const gbm::GBTreeModel& model, unsigned
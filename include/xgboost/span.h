@@ -91,6 +91,14 @@ namespace common {
 #define SPAN_CHECK CHECK  // check from dmlc
 #endif  // __CUDA_ARCH__
 
+// Element access on the host is left unchecked by builds with
+// UNCHECKED_SPAN_ACCESS, so loops over spans can be vectorised.
+#if defined(XGBOOST_SPAN_UNCHECKED_ACCESS) && !defined(__CUDA_ARCH__)
+#define SPAN_ELEMENT_CHECK(cond)
+#else
+#define SPAN_ELEMENT_CHECK SPAN_CHECK
+#endif  // defined(XGBOOST_SPAN_UNCHECKED_ACCESS) && !defined(__CUDA_ARCH__)
+
 namespace detail {
 /*!
  * By default, XGBoost uses uint32_t for indexing data. int64_t covers all
@@ -143,7 +151,7 @@ class SpanIterator {
       : SpanIterator(other_.span_, other_.index_) {}
 
   XGBOOST_DEVICE reference operator*() const {
-    SPAN_CHECK(index_ < span_->size());
+    SPAN_ELEMENT_CHECK(index_ < span_->size());
     return *(span_->data() + index_);
   }
   XGBOOST_DEVICE reference operator[](difference_type n) const {
@@ -505,7 +513,7 @@ class Span {
   }
 
   XGBOOST_DEVICE reference operator[](index_type _idx) const {
-    SPAN_CHECK(_idx < size());
+    SPAN_ELEMENT_CHECK(_idx < size());
     return data()[_idx];
   }
 
@@ -15,6 +15,7 @@
 #include <xgboost/logging.h>
 #include <xgboost/feature_map.h>
 #include <xgboost/model.h>
+#include <xgboost/span.h>
 
 #include <limits>
 #include <vector>
@@ -25,7 +26,19 @@
 
 namespace xgboost {
 
-struct PathElement;  // forward declaration
+// Used by TreeShap
+// data we keep about our decision path
+// note that pweight is included for convenience and is not tied with the other attributes
+// the pweight of the i'th path element is the permuation weight of paths with i-1 ones in them
+struct PathElement {
+  int feature_index;
+  bst_float zero_fraction;
+  bst_float one_fraction;
+  bst_float pweight;
+  PathElement() = default;
+  PathElement(int i, bst_float z, bst_float o, bst_float w) :
+    feature_index(i), zero_fraction(z), one_fraction(o), pweight(w) {}
+};
 
 class Json;
 // FIXME(trivialfis): Once binary IO is gone, make this parameter internal as it should
@@ -102,6 +115,16 @@ class RegTree : public Model {
   using SplitCondT = bst_float;
   static constexpr int32_t kInvalidNodeId {-1};
   static constexpr uint32_t kDeletedNodeMarker = std::numeric_limits<uint32_t>::max();
+  /*! \brief Range of the categories of a categorical split in `GetSplitCategories'. */
+  struct Segment {
+    size_t beg {0};
+    size_t size {0};
+    Segment() = default;
+    XGBOOST_DEVICE Segment(size_t b, size_t s) : beg{b}, size{s} {}
+    XGBOOST_DEVICE bool operator==(Segment const& that) const {
+      return beg == that.beg && size == that.size;
+    }
+  };
 
   /*! \brief tree node */
   class Node {
@@ -275,6 +298,8 @@ class RegTree : public Model {
     param.num_deleted = 0;
     nodes_.resize(param.num_nodes);
     stats_.resize(param.num_nodes);
+    split_types_.resize(param.num_nodes, FeatureType::kNumerical);
+    split_categories_segments_.resize(param.num_nodes);
     for (int i = 0; i < param.num_nodes; i ++) {
       nodes_[i].SetLeaf(0.0f);
       nodes_[i].SetParent(kInvalidNodeId);
@@ -291,6 +316,15 @@ class RegTree : public Model {
 
   /*! \brief get const reference to nodes */
   const std::vector<Node>& GetNodes() const { return nodes_; }
+  /*! \brief bytes held by the nodes and their statistics */
+  size_t MemCostBytes() const {
+    return nodes_.size() * sizeof(Node) + deleted_nodes_.size() * sizeof(int) +
+           stats_.size() * sizeof(RTreeNodeStat) +
+           (leaf_vector_.size() + node_mean_values_.size()) * sizeof(bst_float) +
+           split_types_.size() * sizeof(FeatureType) +
+           split_categories_.size() * sizeof(uint64_t) +
+           split_categories_segments_.size() * sizeof(Segment);
+  }
 
   /*! \brief get node statistics given nid */
   RTreeNodeStat& Stat(int nid) {
@@ -317,7 +351,31 @@ class RegTree : public Model {
 
   bool operator==(const RegTree& b) const {
     return nodes_ == b.nodes_ && stats_ == b.stats_ &&
-           deleted_nodes_ == b.deleted_nodes_ && param == b.param;
+           deleted_nodes_ == b.deleted_nodes_ && param == b.param &&
+           leaf_vector_ == b.leaf_vector_ && split_types_ == b.split_types_ &&
+           split_categories_ == b.split_categories_ &&
+           split_categories_segments_ == b.split_categories_segments_;
+  }
+
+  /*! \brief Whether the leaves hold `param.size_leaf_vector' values instead of one. */
+  bool IsMultiOutput() const { return param.size_leaf_vector != 0; }
+  /*!
+   * \brief Values of a leaf in a multi-output tree, one for each output.  Leaves that
+   *  have never been set hold zeros.
+   */
+  bst_float const* LeafVector(bst_node_t nid) const {
+    CHECK(this->IsMultiOutput());
+    CHECK_EQ(leaf_vector_.size(), static_cast<size_t>(param.num_nodes) * param.size_leaf_vector)
+        << "Leaf vectors have not been set.";
+    return leaf_vector_.data() + static_cast<size_t>(nid) * param.size_leaf_vector;
+  }
+  /*! \brief Set the values of a leaf in a multi-output tree. */
+  void SetLeafVector(bst_node_t nid, std::vector<bst_float> const& values) {
+    CHECK(this->IsMultiOutput());
+    CHECK_EQ(values.size(), static_cast<size_t>(param.size_leaf_vector));
+    leaf_vector_.resize(static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+    std::copy(values.cbegin(), values.cend(),
+              leaf_vector_.begin() + static_cast<size_t>(nid) * param.size_leaf_vector);
   }
 
   /**
@@ -350,6 +408,8 @@ class RegTree : public Model {
     nodes_[node.RightChild()].SetParent(nid, false);
     node.SetSplit(split_index, split_value,
                   default_left);
+    split_types_[nid] = FeatureType::kNumerical;
+    split_categories_segments_[nid] = Segment{};
 
     nodes_[pleft].SetLeaf(left_leaf_weight, leaf_right_child);
     nodes_[pright].SetLeaf(right_leaf_weight, leaf_right_child);
@@ -359,6 +419,51 @@ class RegTree : public Model {
     this->Stat(nid).sum_hess = sum_hess;
   }
 
+  /**
+   * \brief Expands a leaf node with a categorical split, see `ExpandNode'.
+   *
+   * \param split_cat  Bit field of the categories going to the left child, in the layout
+   *                   of `common::CatBitField'.  Other categories go to the right child.
+   * \param split_value The split condition, kept for updaters that need a scalar one.
+   */
+  void ExpandCategorical(bst_node_t nid, unsigned split_index,
+                         common::Span<uint64_t const> split_cat, bst_float split_value,
+                         bool default_left, bst_float base_weight,
+                         bst_float left_leaf_weight, bst_float right_leaf_weight,
+                         bst_float loss_change, float sum_hess) {
+    this->ExpandNode(nid, split_index, split_value, default_left, base_weight,
+                     left_leaf_weight, right_leaf_weight, loss_change, sum_hess);
+    size_t const beg = split_categories_.size();
+    split_categories_.insert(split_categories_.end(), split_cat.cbegin(), split_cat.cend());
+    split_types_[nid] = FeatureType::kCategorical;
+    split_categories_segments_[nid] = Segment{beg, split_cat.size()};
+  }
+
+  /*! \brief Type of the split of node `nid', numerical for leaves. */
+  FeatureType NodeSplitType(bst_node_t nid) const {
+    return split_types_[nid];
+  }
+  /*! \brief Bit field of the categories going left at node `nid', empty if not categorical. */
+  common::Span<uint64_t const> NodeCats(bst_node_t nid) const {
+    auto const& segment = split_categories_segments_[nid];
+    return {split_categories_.data() + segment.beg, segment.size};
+  }
+  /*!
+   * \brief Whether the tree has been given a categorical split.  Nodes pruned afterwards
+   *  are not tracked, so this is only a hint for the fast paths of the predictors.
+   */
+  bool HasCategoricalSplit() const {
+    return !split_categories_.empty();
+  }
+  /*! \brief Split type of every node. */
+  std::vector<FeatureType> const& GetSplitTypes() const { return split_types_; }
+  /*! \brief Bit fields of all categorical splits, concatenated. */
+  std::vector<uint64_t> const& GetSplitCategories() const { return split_categories_; }
+  /*! \brief Range of every node in `GetSplitCategories', empty for numerical splits. */
+  std::vector<Segment> const& GetSplitCategoriesPtr() const {
+    return split_categories_segments_;
+  }
+
   /*!
    * \brief get current depth
    * \param nid node id
@@ -388,6 +493,28 @@ class RegTree : public Model {
     return MaxDepth(0);
   }
 
+  /*!
+   * \brief visit the nodes reachable from the root in depth first order, the ones
+   *        deleted by the pruner are skipped.
+   * \param func called with each node id, returning false stops the walk.
+   */
+  template <typename Func>
+  void WalkTree(Func func) const {
+    std::vector<bst_node_t> nodes {0};  // the root
+    while (!nodes.empty()) {
+      bst_node_t nidx = nodes.back();
+      nodes.pop_back();
+      if (!func(nidx)) {
+        return;
+      }
+      auto const& node = nodes_[nidx];
+      if (!node.IsLeaf()) {
+        nodes.push_back(node.RightChild());
+        nodes.push_back(node.LeftChild());
+      }
+    }
+  }
+
   /*! \brief number of extra nodes besides the root */
   int NumExtraNodes() const {
     return param.num_nodes - 1 - param.num_deleted;
@@ -444,10 +571,12 @@ class RegTree : public Model {
   };
   /*!
    * \brief get the leaf index
-   * \param feat dense feature vector, if the feature is missing the field is set to NaN
+   * \param feat dense feature vector, if the feature is missing the field is set to NaN.
+   *  Any type with the IsMissing and GetFvalue methods of FVec can be used.
    * \return the leaf index of the given feature
    */
-  int GetLeafIndex(const FVec& feat) const;
+  template <typename FVecT>
+  int GetLeafIndex(const FVecT& feat) const;
   /*!
    * \brief calculate the feature contributions (https://arxiv.org/abs/1706.06060) for the tree
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -458,6 +587,22 @@ class RegTree : public Model {
   void CalculateContributions(const RegTree::FVec& feat,
                               bst_float* out_contribs, int condition = 0,
                               unsigned condition_feature = 0) const;
+  /*!
+   * \brief calculate the feature contributions with a path buffer provided by the caller,
+   *  so that no allocation nor depth walk is done per call.
+   * \param unique_path buffer of at least ShapPathSize(MaxDepth(0)) elements
+   */
+  void CalculateContributions(const RegTree::FVec& feat,
+                              bst_float* out_contribs, int condition,
+                              unsigned condition_feature,
+                              PathElement* unique_path) const;
+  /*!
+   * \brief number of path elements used by TreeShap on a tree of the given depth
+   */
+  static size_t ShapPathSize(int depth) {
+    size_t const maxd = depth + 2;
+    return (maxd * (maxd + 1)) / 2;
+  }
   /*!
    * \brief Recursive function that computes the feature attributions for a single tree.
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -481,10 +626,12 @@ class RegTree : public Model {
   /*!
    * \brief calculate the approximate feature contributions for the given root
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
-   * \param out_contribs output vector to hold the contributions
+   * \param out_contribs output vector the contributions are added to
+   * \param weight scale of the added contributions
    */
   void CalculateContributionsApprox(const RegTree::FVec& feat,
-                                    bst_float* out_contribs) const;
+                                    bst_float* out_contribs,
+                                    bst_float weight = 1.0f) const;
   /*!
    * \brief get next position of the tree given current pid
    * \param pid Current node id.
@@ -506,6 +653,19 @@ class RegTree : public Model {
    * \brief calculate the mean value for each node, required for feature contributions
    */
   void FillNodeMeanValues();
+  /*!
+   * \brief Mean value of each node, the average of the leaf values below it weighted by
+   *  their hessian.  Same as `FillNodeMeanValues' without keeping the result in the tree.
+   */
+  void CalcNodeMeanValues(std::vector<bst_float>* out) const;
+  /*!
+   * \brief Shrink a trained tree for inference.  Splits whose children are leaves with
+   *  the same value are folded into leaves, then the remaining nodes are renumbered
+   *  breadth first, dropping the slots of deleted nodes.  Predictions are unchanged, node
+   *  ids and the statistics of folded children are not kept.
+   * \return Number of folded splits.
+   */
+  bst_node_t Compact();
 
  private:
   // vector of nodes
@@ -514,7 +674,14 @@ class RegTree : public Model {
   std::vector<int>  deleted_nodes_;
   // stats of nodes
   std::vector<RTreeNodeStat> stats_;
+  // leaf values of multi-output trees, `param.size_leaf_vector' for each node
+  std::vector<bst_float> leaf_vector_;
   std::vector<bst_float> node_mean_values_;
+  // split type of each node, categories going left are kept as bit fields for categorical
+  // splits: one range of `split_categories_' for each node, empty for the others.
+  std::vector<FeatureType> split_types_;
+  std::vector<uint64_t> split_categories_;
+  std::vector<Segment> split_categories_segments_;
   // allocate a new node,
   // !!!!!! NOTE: may cause BUG here, nodes.resize
   int AllocNode() {
@@ -522,6 +689,8 @@ class RegTree : public Model {
       int nid = deleted_nodes_.back();
       deleted_nodes_.pop_back();
       nodes_[nid].Reuse();
+      split_types_[nid] = FeatureType::kNumerical;
+      split_categories_segments_[nid] = Segment{};
       --param.num_deleted;
       return nid;
     }
@@ -530,6 +699,11 @@ class RegTree : public Model {
         << "number of nodes in the tree exceed 2^31";
     nodes_.resize(param.num_nodes);
     stats_.resize(param.num_nodes);
+    split_types_.resize(param.num_nodes, FeatureType::kNumerical);
+    split_categories_segments_.resize(param.num_nodes);
+    if (!leaf_vector_.empty()) {
+      leaf_vector_.resize(static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+    }
     return nd;
   }
   // delete a tree node, keep the parent field to allow trace back
@@ -546,7 +720,8 @@ class RegTree : public Model {
     nodes_[nid].MarkDelete();
     ++param.num_deleted;
   }
-  bst_float FillNodeMeanValue(int nid);
+  // `GetNext' of a categorical split, defined next to the bit field helpers
+  int GetNextCategorical(int pid, bst_float fvalue) const;
 };
 
 inline void RegTree::FVec::Init(size_t size) {
@@ -585,7 +760,8 @@ inline bool RegTree::FVec::IsMissing(size_t i) const {
   return data_[i].flag == -1;
 }
 
-inline int RegTree::GetLeafIndex(const RegTree::FVec& feat) const {
+template <typename FVecT>
+inline int RegTree::GetLeafIndex(const FVecT& feat) const {
   bst_node_t nid = 0;
   while (!(*this)[nid].IsLeaf()) {
     unsigned split_index = (*this)[nid].SplitIndex();
@@ -599,6 +775,8 @@ inline int RegTree::GetNext(int pid, bst_float fvalue, bool is_unknown) const {
   bst_float split_value = (*this)[pid].SplitCond();
   if (is_unknown) {
     return (*this)[pid].DefaultChild();
+  } else if (split_types_[pid] == FeatureType::kCategorical) {
+    return this->GetNextCategorical(pid, fvalue);
   } else {
     if (fvalue < split_value) {
       return (*this)[pid].LeftChild();
@@ -24,6 +24,7 @@
 namespace xgboost {
 
 class Json;
+class ElementWiseGradient;
 
 /*!
  * \brief interface of tree update module, that performs update of a tree.
@@ -52,6 +53,17 @@ class TreeUpdater : public Configurable {
   virtual void Update(HostDeviceVector<GradientPair>* gpair,
                       DMatrix* data,
                       const std::vector<RegTree*>& trees) = 0;
+  /*!
+   * \brief Same as Update, with the gradient computed from `grad' by the first pass of the
+   *  updater over the rows and written to `gpair'.
+   * \return false when not supported, nothing is done in that case.
+   */
+  virtual bool UpdateWithGradient(ElementWiseGradient* grad,
+                                  HostDeviceVector<GradientPair>* gpair,
+                                  DMatrix* data,
+                                  const std::vector<RegTree*>& trees) {
+    return false;
+  }
 
   /*!
    * \brief determines whether updater has enough knowledge about a given dataset
@@ -67,6 +79,18 @@ class TreeUpdater : public Configurable {
                                      HostDeviceVector<bst_float>* out_preds) {
     return false;
   }
+  /*!
+   * \brief write the leaf index of every row of the training data in the last updated
+   *        tree, for updaters that know the final position of the rows.
+   * \param data: data matrix
+   * \param out_leaf: leaf indices, the ones of this tree start at `offset'
+   * \param offset: offset of the first row in out_leaf
+   * \return boolean indicating whether the leaf indices have been written.
+   */
+  virtual bool UpdateLeafIndices(const DMatrix* data, HostDeviceVector<uint32_t>* out_leaf,
+                                 size_t offset) {
+    return false;
+  }
 
   virtual char const* Name() const = 0;
 
@@ -16,6 +16,7 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
 import java.util.Arrays;
 import java.util.HashMap;
 import java.util.HashSet;
@@ -211,6 +212,26 @@ public class Booster implements Serializable, KryoSerializable {
             dtrain.getHandle(), grad, hess));
   }
 
+  /**
+   * update with give grad and hess held by direct buffers of floats in native byte order,
+   * read in place without copying them to the JVM heap
+   *
+   * @param dtrain training data
+   * @param grad   first order of gradient
+   * @param hess   seconde order of gradient
+   * @throws XGBoostError native error
+   */
+  public void boost(DMatrix dtrain, ByteBuffer grad, ByteBuffer hess) throws XGBoostError {
+    ByteBuffer gradView = XGBoostJNI.directView(grad, 4);
+    ByteBuffer hessView = XGBoostJNI.directView(hess, 4);
+    if (gradView.capacity() != hessView.capacity()) {
+      throw new AssertionError(String.format("grad/hess length mismatch %s / %s",
+              gradView.capacity() / 4, hessView.capacity() / 4));
+    }
+    XGBoostJNI.checkCall(XGBoostJNI.XGBoosterBoostOneIterBuffer(handle,
+            dtrain.getHandle(), gradView, hessView));
+  }
+
   /**
    * evaluate with given dmatrixs.
    *
@@ -277,6 +298,25 @@ public class Booster implements Serializable, KryoSerializable {
     return evalInfo;
   }
 
+  /**
+   * Predict straight into a direct buffer in native byte order, as floats starting from its
+   * position, row after row.  Nothing is allocated on the JVM heap.
+   *
+   * @param data         data
+   * @param out          buffer with room for all predictions
+   * @param outputMargin output margin
+   * @param treeLimit    limit number of trees, 0 means all trees.
+   * @return number of floats written
+   * @throws XGBoostError native error, or if out is too small
+   */
+  public synchronized long predict(DMatrix data, ByteBuffer out, boolean outputMargin,
+                                   int treeLimit) throws XGBoostError {
+    long[] outLen = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGBoosterPredictToBuffer(handle, data.getHandle(),
+            outputMargin ? 1 : 0, treeLimit, XGBoostJNI.directView(out, 4), outLen));
+    return outLen[0];
+  }
+
   /**
    * Advanced predict function with all the options.
    *
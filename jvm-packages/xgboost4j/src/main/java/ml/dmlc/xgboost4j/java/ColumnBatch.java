@@ -0,0 +1,85 @@
+/*
+ Copyright (c) 2020 by Contributors
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+package ml.dmlc.xgboost4j.java;
+
+import java.nio.ByteBuffer;
+
+/**
+ * A mini-batch of columns that can be converted to DMatrix, read in place by native code.
+ *
+ * Each column is a direct buffer of numRows floats in native byte order.  Nulls are given
+ * like in Arrow, by a validity bitmap with bit i (least significant first) set when row i
+ * is valid.  The buffers are not copied, they are kept alive until the next batch is read.
+ */
+public class ColumnBatch {
+  /** number of rows in the batch */
+  final int numRows;
+  /** values of each column */
+  final ByteBuffer[] columns;
+  /** validity bitmap of each column, can be null, or null for a column without nulls */
+  final ByteBuffer[] validity;
+  /** label of each data point, can be null */
+  final ByteBuffer label;
+  /** weight of each data point, can be null */
+  final ByteBuffer weight;
+
+  public ColumnBatch(int numRows, ByteBuffer[] columns, ByteBuffer[] validity,
+                     ByteBuffer label, ByteBuffer weight) {
+    if (validity != null && validity.length != columns.length) {
+      throw new IllegalArgumentException(String.format(
+              "columns/validity length mismatch %s / %s", columns.length, validity.length));
+    }
+    this.numRows = numRows;
+    this.columns = new ByteBuffer[columns.length];
+    for (int i = 0; i < columns.length; i++) {
+      this.columns[i] = floats(columns[i], numRows);
+    }
+    if (validity != null) {
+      this.validity = new ByteBuffer[validity.length];
+      for (int i = 0; i < validity.length; i++) {
+        this.validity[i] = bitmap(validity[i], numRows);
+      }
+    } else {
+      this.validity = null;
+    }
+    this.label = label == null ? null : floats(label, numRows);
+    this.weight = weight == null ? null : floats(weight, numRows);
+  }
+
+  private static ByteBuffer floats(ByteBuffer buffer, int numRows) {
+    ByteBuffer view = XGBoostJNI.directView(buffer, 4);
+    if (view.capacity() < 4L * numRows) {
+      throw new IllegalArgumentException(String.format(
+              "buffer holds %s floats, less than %s rows", view.capacity() / 4, numRows));
+    }
+    return view;
+  }
+
+  private static ByteBuffer bitmap(ByteBuffer buffer, int numRows) {
+    if (buffer == null) {
+      return null;
+    }
+    if (!buffer.isDirect()) {
+      throw new IllegalArgumentException("buffer must be allocated with allocateDirect");
+    }
+    if (buffer.remaining() < (numRows + 7) / 8) {
+      throw new IllegalArgumentException(String.format(
+              "validity bitmap holds %s bytes, less than needed for %s rows",
+              buffer.remaining(), numRows));
+    }
+    return buffer.slice();
+  }
+}
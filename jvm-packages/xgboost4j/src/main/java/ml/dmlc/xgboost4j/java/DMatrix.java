@@ -15,6 +15,7 @@
  */
 package ml.dmlc.xgboost4j.java;
 
+import java.nio.ByteBuffer;
 import java.util.Iterator;
 
 import ml.dmlc.xgboost4j.LabeledPoint;
@@ -55,6 +56,28 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * Create DMatrix from an iterator of column batches, read in place without converting the
+   * rows to LabeledPoint.  Each batch is kept alive until the next one is asked for.
+   *
+   * @param iter The data iterator of column batches.
+   * @param numRowsHint Expected number of rows, 0 when unknown, used to preallocate
+   *                    the matrix.
+   * @param numNonZeroHint Expected number of present values, 0 when unknown.
+   * @param missing the specified value to represent the missing value
+   * @throws XGBoostError native error
+   */
+  public DMatrix(Iterator<ColumnBatch> iter, long numRowsHint, long numNonZeroHint,
+                 float missing) throws XGBoostError {
+    if (iter == null) {
+      throw new NullPointerException("iter: null");
+    }
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromColumnarIter(iter, numRowsHint,
+            numNonZeroHint, missing, out));
+    handle = out[0];
+  }
+
   /**
    * Create DMatrix by loading libsvm file from dataPath
    *
@@ -117,6 +140,30 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * Create DMatrix from Sparse matrix in CSR format held by direct buffers, read in place
+   * without copying them to the JVM heap.  All buffers must be in native byte order.
+   * @param headers The row index of the matrix, in longs.
+   * @param indices The indices of presenting entries, in ints.
+   * @param data The data content, in floats.
+   * @param numColumn The number of columns, 0 to infer it from the indices.
+   * @throws XGBoostError native error
+   */
+  public DMatrix(ByteBuffer headers, ByteBuffer indices, ByteBuffer data, int numColumn)
+          throws XGBoostError {
+    ByteBuffer indicesView = XGBoostJNI.directView(indices, 4);
+    ByteBuffer dataView = XGBoostJNI.directView(data, 4);
+    if (indicesView.capacity() != dataView.capacity()) {
+      throw new IllegalArgumentException(String.format(
+              "indices/data length mismatch %s / %s", indicesView.capacity() / 4,
+              dataView.capacity() / 4));
+    }
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromCSRBuffer(
+            XGBoostJNI.directView(headers, 8), indicesView, dataView, numColumn, out));
+    handle = out[0];
+  }
+
   /**
    * create DMatrix from dense matrix
    *
@@ -154,6 +201,26 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * create DMatrix from a row major dense matrix held by a direct buffer in native byte
+   * order, read in place without copying it to the JVM heap
+   * @param data data values, in floats
+   * @param nrow number of rows
+   * @param ncol number of columns
+   * @param missing the specified value to represent the missing value
+   */
+  public DMatrix(ByteBuffer data, int nrow, int ncol, float missing) throws XGBoostError {
+    ByteBuffer view = XGBoostJNI.directView(data, 4);
+    if ((long) view.capacity() < 4L * nrow * ncol) {
+      throw new IllegalArgumentException(String.format(
+              "data holds %s values, less than %s x %s", view.capacity() / 4, nrow, ncol));
+    }
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromMatBuffer(view, nrow, ncol, missing,
+            out));
+    handle = out[0];
+  }
+
   /**
    * create DMatrix from dense matrix
    * @param matrix instance of BigDenseMatrix
@@ -184,6 +251,17 @@ public class DMatrix {
     XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfo(handle, "label", labels));
   }
 
+  /**
+   * set label of dmatrix from a direct buffer of floats in native byte order
+   *
+   * @param labels labels
+   * @throws XGBoostError native error
+   */
+  public void setLabel(ByteBuffer labels) throws XGBoostError {
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfoBuffer(handle, "label",
+            XGBoostJNI.directView(labels, 4)));
+  }
+
   /**
    * set weight of each instance
    *
@@ -194,6 +272,17 @@ public class DMatrix {
     XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfo(handle, "weight", weights));
   }
 
+  /**
+   * set weight of each instance from a direct buffer of floats in native byte order
+   *
+   * @param weights weights
+   * @throws XGBoostError native error
+   */
+  public void setWeight(ByteBuffer weights) throws XGBoostError {
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixSetFloatInfoBuffer(handle, "weight",
+            XGBoostJNI.directView(weights, 4)));
+  }
+
   /**
    * Set base margin (initial prediction).
    *
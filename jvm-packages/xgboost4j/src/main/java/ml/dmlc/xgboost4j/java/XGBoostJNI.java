@@ -16,6 +16,7 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
@@ -49,6 +50,24 @@ class XGBoostJNI {
     }
   }
 
+  /**
+   * View the remaining bytes of a buffer passed to native code without copying.  The buffer
+   * must be direct, in native byte order and hold a whole number of elements.
+   */
+  static ByteBuffer directView(ByteBuffer buffer, int elementSize) {
+    if (!buffer.isDirect()) {
+      throw new IllegalArgumentException("buffer must be allocated with allocateDirect");
+    }
+    if (buffer.order() != ByteOrder.nativeOrder()) {
+      throw new IllegalArgumentException("buffer must be in ByteOrder.nativeOrder()");
+    }
+    if (buffer.remaining() % elementSize != 0) {
+      throw new IllegalArgumentException(String.format(
+              "buffer holds %s bytes, not a multiple of %s", buffer.remaining(), elementSize));
+    }
+    return buffer.slice();
+  }
+
   public final static native String XGBGetLastError();
 
   public final static native int XGDMatrixCreateFromFile(String fname, int silent, long[] out);
@@ -56,15 +75,27 @@ class XGBoostJNI {
   final static native int XGDMatrixCreateFromDataIter(java.util.Iterator<DataBatch> iter,
                                                              String cache_info, long[] out);
 
+  final static native int XGDMatrixCreateFromColumnarIter(
+    java.util.Iterator<ColumnBatch> iter, long numRowsHint, long numNonZeroHint, float missing,
+    long[] out);
+
   public final static native int XGDMatrixCreateFromCSREx(long[] indptr, int[] indices, float[] data,
                                                         int shapeParam, long[] out);
 
+  // The buffers below are viewed in place, see directView.
+  final static native int XGDMatrixCreateFromCSRBuffer(ByteBuffer indptr, ByteBuffer indices,
+                                                       ByteBuffer data, int shapeParam,
+                                                       long[] out);
+
   public final static native int XGDMatrixCreateFromCSCEx(long[] colptr, int[] indices, float[] data,
                                                           int shapeParam, long[] out);
 
   public final static native int XGDMatrixCreateFromMat(float[] data, int nrow, int ncol,
                                                         float missing, long[] out);
 
+  final static native int XGDMatrixCreateFromMatBuffer(ByteBuffer data, int nrow, int ncol,
+                                                       float missing, long[] out);
+
   public final static native int XGDMatrixCreateFromMatRef(long dataRef, int nrow, int ncol,
                                                            float missing, long[] out);
 
@@ -76,6 +107,9 @@ class XGBoostJNI {
 
   public final static native int XGDMatrixSetFloatInfo(long handle, String field, float[] array);
 
+  final static native int XGDMatrixSetFloatInfoBuffer(long handle, String field,
+                                                      ByteBuffer array);
+
   public final static native int XGDMatrixSetUIntInfo(long handle, String field, int[] array);
 
   public final static native int XGDMatrixGetFloatInfo(long handle, String field, float[][] info);
@@ -95,12 +129,19 @@ class XGBoostJNI {
   public final static native int XGBoosterBoostOneIter(long handle, long dtrain, float[] grad,
                                                        float[] hess);
 
+  final static native int XGBoosterBoostOneIterBuffer(long handle, long dtrain, ByteBuffer grad,
+                                                      ByteBuffer hess);
+
   public final static native int XGBoosterEvalOneIter(long handle, int iter, long[] dmats,
                                                       String[] evnames, String[] eval_info);
 
   public final static native int XGBoosterPredict(long handle, long dmat, int option_mask,
                                                   int ntree_limit, float[][] predicts);
 
+  final static native int XGBoosterPredictToBuffer(long handle, long dmat, int option_mask,
+                                                   int ntree_limit, ByteBuffer out,
+                                                   long[] outLen);
+
   public final static native int XGBoosterLoadModel(long handle, String fname);
 
   public final static native int XGBoosterSaveModel(long handle, String fname);
@@ -43,6 +43,13 @@ void setHandle(JNIEnv *jenv, jlongArray jhandle, void* handle) {
   jenv->SetLongArrayRegion(jhandle, 0, 1, &out);
 }
 
+// view the memory of a direct buffer as elements of T, without copying it
+template <typename T>
+T* getBufferAddress(JNIEnv *jenv, jobject jbuffer, bst_ulong* out_len) {
+  *out_len = static_cast<bst_ulong>(jenv->GetDirectBufferCapacity(jbuffer)) / sizeof(T);
+  return static_cast<T*>(jenv->GetDirectBufferAddress(jbuffer));
+}
+
 // global JVM
 static JavaVM* global_jvm = nullptr;
 
@@ -123,19 +130,19 @@ XGB_EXTERN_C int XGBoost4jCallbackDataIterNext(
           << XGBGetLastError();
       // release the elements.
       jenv->ReleaseLongArrayElements(
-          joffset, reinterpret_cast<jlong *>(cbatch.offset), 0);
+          joffset, reinterpret_cast<jlong *>(cbatch.offset), JNI_ABORT);
       jenv->DeleteLocalRef(joffset);
       if (jlabel != nullptr) {
-        jenv->ReleaseFloatArrayElements(jlabel, cbatch.label, 0);
+        jenv->ReleaseFloatArrayElements(jlabel, cbatch.label, JNI_ABORT);
         jenv->DeleteLocalRef(jlabel);
       }
       if (jweight != nullptr) {
-        jenv->ReleaseFloatArrayElements(jweight, cbatch.weight, 0);
+        jenv->ReleaseFloatArrayElements(jweight, cbatch.weight, JNI_ABORT);
         jenv->DeleteLocalRef(jweight);
       }
-      jenv->ReleaseIntArrayElements(jindex, (jint*) cbatch.index, 0);
+      jenv->ReleaseIntArrayElements(jindex, (jint*) cbatch.index, JNI_ABORT);
       jenv->DeleteLocalRef(jindex);
-      jenv->ReleaseFloatArrayElements(jvalue, cbatch.value, 0);
+      jenv->ReleaseFloatArrayElements(jvalue, cbatch.value, JNI_ABORT);
       jenv->DeleteLocalRef(jvalue);
       jenv->DeleteLocalRef(batch);
       jenv->DeleteLocalRef(batchClass);
@@ -159,6 +166,118 @@ XGB_EXTERN_C int XGBoost4jCallbackDataIterNext(
   }
 }
 
+namespace {
+// Columnar iterator with the batch being read, kept alive until the next one is asked for.
+struct ColumnarIterState {
+  jobject jiter;
+  jobject jbatch {nullptr};
+  std::vector<float const*> values;
+  std::vector<uint8_t const*> valid;
+};
+}  // anonymous namespace
+
+XGB_EXTERN_C int XGBoost4jCallbackColumnarIterNext(
+    DataIterHandle data_handle,
+    XGBCallbackSetColumnarData* set_function,
+    DataHolderHandle set_function_handle) {
+  auto* state = static_cast<ColumnarIterState*>(data_handle);
+  JNIEnv* jenv;
+  int jni_status = global_jvm->GetEnv((void **)&jenv, JNI_VERSION_1_6);
+  if (jni_status == JNI_EDETACHED) {
+    global_jvm->AttachCurrentThread(reinterpret_cast<void **>(&jenv), nullptr);
+  } else {
+    CHECK(jni_status == JNI_OK);
+  }
+  try {
+    if (state->jbatch != nullptr) {
+      jenv->DeleteGlobalRef(state->jbatch);
+      state->jbatch = nullptr;
+    }
+    jclass iterClass = jenv->FindClass("java/util/Iterator");
+    jmethodID hasNext = jenv->GetMethodID(iterClass,
+                                          "hasNext", "()Z");
+    jmethodID next = jenv->GetMethodID(iterClass,
+                                       "next", "()Ljava/lang/Object;");
+    int ret_value;
+    if (jenv->CallBooleanMethod(state->jiter, hasNext)) {
+      jobject batch = jenv->CallObjectMethod(state->jiter, next);
+      if (batch == nullptr) {
+        CHECK(jenv->ExceptionOccurred());
+        jenv->ExceptionDescribe();
+        return -1;
+      }
+      state->jbatch = jenv->NewGlobalRef(batch);
+
+      jclass batchClass = jenv->GetObjectClass(batch);
+      jint jnum_rows = jenv->GetIntField(
+          batch, jenv->GetFieldID(batchClass, "numRows", "I"));
+      jobjectArray jcolumns = (jobjectArray)jenv->GetObjectField(
+          batch, jenv->GetFieldID(batchClass, "columns", "[Ljava/nio/ByteBuffer;"));
+      jobjectArray jvalidity = (jobjectArray)jenv->GetObjectField(
+          batch, jenv->GetFieldID(batchClass, "validity", "[Ljava/nio/ByteBuffer;"));
+      jobject jlabel = jenv->GetObjectField(
+          batch, jenv->GetFieldID(batchClass, "label", "Ljava/nio/ByteBuffer;"));
+      jobject jweight = jenv->GetObjectField(
+          batch, jenv->GetFieldID(batchClass, "weight", "Ljava/nio/ByteBuffer;"));
+
+      // the buffers are direct, only their addresses are taken
+      jsize num_columns = jenv->GetArrayLength(jcolumns);
+      state->values.resize(num_columns);
+      state->valid.resize(num_columns);
+      for (jsize i = 0; i < num_columns; ++i) {
+        jobject jcolumn = jenv->GetObjectArrayElement(jcolumns, i);
+        state->values[i] = static_cast<float const*>(jenv->GetDirectBufferAddress(jcolumn));
+        jenv->DeleteLocalRef(jcolumn);
+        state->valid[i] = nullptr;
+        if (jvalidity != nullptr) {
+          jobject jvalid = jenv->GetObjectArrayElement(jvalidity, i);
+          if (jvalid != nullptr) {
+            state->valid[i] =
+                static_cast<uint8_t const*>(jenv->GetDirectBufferAddress(jvalid));
+            jenv->DeleteLocalRef(jvalid);
+          }
+        }
+      }
+      XGBoostBatchColumnar cbatch;
+      cbatch.size = static_cast<size_t>(jnum_rows);
+      cbatch.columns = static_cast<size_t>(num_columns);
+      cbatch.values = dmlc::BeginPtr(state->values);
+      cbatch.valid = dmlc::BeginPtr(state->valid);
+      cbatch.label = jlabel == nullptr
+                         ? nullptr
+                         : static_cast<float const*>(jenv->GetDirectBufferAddress(jlabel));
+      cbatch.weight = jweight == nullptr
+                          ? nullptr
+                          : static_cast<float const*>(jenv->GetDirectBufferAddress(jweight));
+      // cbatch is ready
+      CHECK_EQ((*set_function)(set_function_handle, cbatch), 0)
+          << XGBGetLastError();
+      jenv->DeleteLocalRef(jcolumns);
+      if (jvalidity != nullptr) jenv->DeleteLocalRef(jvalidity);
+      if (jlabel != nullptr) jenv->DeleteLocalRef(jlabel);
+      if (jweight != nullptr) jenv->DeleteLocalRef(jweight);
+      jenv->DeleteLocalRef(batch);
+      jenv->DeleteLocalRef(batchClass);
+      ret_value = 1;
+    } else {
+      ret_value = 0;
+    }
+    jenv->DeleteLocalRef(iterClass);
+    // only detach if it is a async call.
+    if (jni_status == JNI_EDETACHED) {
+      global_jvm->DetachCurrentThread();
+    }
+    return ret_value;
+  } catch(dmlc::Error e) {
+    // only detach if it is a async call.
+    if (jni_status == JNI_EDETACHED) {
+      global_jvm->DetachCurrentThread();
+    }
+    LOG(FATAL) << e.what();
+    return -1;
+  }
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGBGetLastError
@@ -196,6 +315,28 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromColumnarIter
+ * Signature: (Ljava/util/Iterator;JJF[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromColumnarIter
+  (JNIEnv *jenv, jclass jcls, jobject jiter, jlong jnum_rows_hint, jlong jnum_nonzero_hint,
+   jfloat jmissing, jlongArray jout) {
+  DMatrixHandle result;
+  ColumnarIterState state;
+  state.jiter = jiter;
+  int ret = XGDMatrixCreateFromColumnarIter(
+      &state, XGBoost4jCallbackColumnarIterNext, (bst_ulong) jnum_rows_hint,
+      (bst_ulong) jnum_nonzero_hint, jmissing, 0, &result);
+  if (state.jbatch != nullptr) {
+    jenv->DeleteGlobalRef(state.jbatch);
+  }
+  JVM_CHECK_CALL(ret);
+  setHandle(jenv, jout, result);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGDMatrixCreateFromFile
@@ -234,9 +375,30 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   JVM_CHECK_CALL(ret);
   setHandle(jenv, jout, result);
   //Release
-  jenv->ReleaseLongArrayElements(jindptr, indptr, 0);
-  jenv->ReleaseIntArrayElements(jindices, indices, 0);
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseLongArrayElements(jindptr, indptr, JNI_ABORT);
+  jenv->ReleaseIntArrayElements(jindices, indices, JNI_ABORT);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromCSRBuffer
+ * Signature: (Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;I[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromCSRBuffer
+  (JNIEnv *jenv, jclass jcls, jobject jindptr, jobject jindices, jobject jdata, jint jcol, jlongArray jout) {
+  DMatrixHandle result;
+  bst_ulong nindptr, nindices, nelem;
+  jlong* indptr = getBufferAddress<jlong>(jenv, jindptr, &nindptr);
+  jint* indices = getBufferAddress<jint>(jenv, jindices, &nindices);
+  jfloat* data = getBufferAddress<jfloat>(jenv, jdata, &nelem);
+  jint ret = (jint) XGDMatrixCreateFromCSREx((size_t const *)indptr,
+                                             (unsigned int const *)indices,
+                                             (float const *)data,
+                                             nindptr, nelem, jcol, &result);
+  JVM_CHECK_CALL(ret);
+  setHandle(jenv, jout, result);
   return ret;
 }
 
@@ -261,9 +423,9 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   JVM_CHECK_CALL(ret);
   setHandle(jenv, jout, result);
   //release
-  jenv->ReleaseLongArrayElements(jindptr, indptr, 0);
-  jenv->ReleaseIntArrayElements(jindices, indices, 0);
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseLongArrayElements(jindptr, indptr, JNI_ABORT);
+  jenv->ReleaseIntArrayElements(jindices, indices, JNI_ABORT);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
 
   return ret;
 }
@@ -300,7 +462,25 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   JVM_CHECK_CALL(ret);
   setHandle(jenv, jout, result);
   //release
-  jenv->ReleaseFloatArrayElements(jdata, data, 0);
+  jenv->ReleaseFloatArrayElements(jdata, data, JNI_ABORT);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromMatBuffer
+ * Signature: (Ljava/nio/ByteBuffer;IIF[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromMatBuffer
+  (JNIEnv *jenv, jclass jcls, jobject jdata, jint jnrow, jint jncol, jfloat jmiss, jlongArray jout) {
+  DMatrixHandle result;
+  bst_ulong len;
+  jfloat* data = getBufferAddress<jfloat>(jenv, jdata, &len);
+  bst_ulong nrow = (bst_ulong)jnrow;
+  bst_ulong ncol = (bst_ulong)jncol;
+  jint ret = (jint) XGDMatrixCreateFromMat((float const *)data, nrow, ncol, jmiss, &result);
+  JVM_CHECK_CALL(ret);
+  setHandle(jenv, jout, result);
   return ret;
 }
 
@@ -322,7 +502,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSliceDMat
   JVM_CHECK_CALL(ret);
   setHandle(jenv, jout, result);
   //release
-  jenv->ReleaseIntArrayElements(jindexset, indexset, 0);
+  jenv->ReleaseIntArrayElements(jindexset, indexset, JNI_ABORT);
 
   return ret;
 }
@@ -370,7 +550,24 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetFloatI
   JVM_CHECK_CALL(ret);
   //release
   if (field) jenv->ReleaseStringUTFChars(jfield, field);
-  jenv->ReleaseFloatArrayElements(jarray, array, 0);
+  jenv->ReleaseFloatArrayElements(jarray, array, JNI_ABORT);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixSetFloatInfoBuffer
+ * Signature: (JLjava/lang/String;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetFloatInfoBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jstring jfield, jobject jarray) {
+  DMatrixHandle handle = (DMatrixHandle) jhandle;
+  const char*  field = jenv->GetStringUTFChars(jfield, 0);
+  bst_ulong len;
+  jfloat* array = getBufferAddress<jfloat>(jenv, jarray, &len);
+  int ret = XGDMatrixSetFloatInfo(handle, field, (float const *)array, len);
+  //release
+  if (field) jenv->ReleaseStringUTFChars(jfield, field);
   return ret;
 }
 
@@ -389,7 +586,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixSetUIntIn
   JVM_CHECK_CALL(ret);
   //release
   if (field) jenv->ReleaseStringUTFChars(jfield, (const char *)field);
-  jenv->ReleaseIntArrayElements(jarray, array, 0);
+  jenv->ReleaseIntArrayElements(jarray, array, JNI_ABORT);
 
   return ret;
 }
@@ -468,7 +665,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterCreate
     for (size_t i = 0; i < len; ++i) {
       handles.push_back((DMatrixHandle) cjhandles[i]);
     }
-    jenv->ReleaseLongArrayElements(jhandles, cjhandles, 0);
+    jenv->ReleaseLongArrayElements(jhandles, cjhandles, JNI_ABORT);
   }
   BoosterHandle result;
   int ret = XGBoosterCreate(dmlc::BeginPtr(handles), handles.size(), &result);
@@ -534,11 +731,26 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterBoostOneI
   int ret = XGBoosterBoostOneIter(handle, dtrain, grad, hess, len);
   JVM_CHECK_CALL(ret);
   //release
-  jenv->ReleaseFloatArrayElements(jgrad, grad, 0);
-  jenv->ReleaseFloatArrayElements(jhess, hess, 0);
+  jenv->ReleaseFloatArrayElements(jgrad, grad, JNI_ABORT);
+  jenv->ReleaseFloatArrayElements(jhess, hess, JNI_ABORT);
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGBoosterBoostOneIterBuffer
+ * Signature: (JJLjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterBoostOneIterBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jlong jdtrain, jobject jgrad, jobject jhess) {
+  BoosterHandle handle = (BoosterHandle) jhandle;
+  DMatrixHandle dtrain = (DMatrixHandle) jdtrain;
+  bst_ulong len, hess_len;
+  jfloat* grad = getBufferAddress<jfloat>(jenv, jgrad, &len);
+  jfloat* hess = getBufferAddress<jfloat>(jenv, jhess, &hess_len);
+  return XGBoosterBoostOneIter(handle, dtrain, grad, hess, len);
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGBoosterEvalOneIter
@@ -561,7 +773,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterEvalOneIt
     evnames.push_back(std::string(s, jenv->GetStringLength(jevname)));
     if (s != nullptr) jenv->ReleaseStringUTFChars(jevname, s);
   }
-  jenv->ReleaseLongArrayElements(jdmats, cjdmats, 0);
+  jenv->ReleaseLongArrayElements(jdmats, cjdmats, JNI_ABORT);
   for (size_t i = 0; i < len; ++i) {
     evchars.push_back(evnames[i].c_str());
   }
@@ -603,6 +815,32 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredict
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGBoosterPredictToBuffer
+ * Signature: (JJIILjava/nio/ByteBuffer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredictToBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jlong jdmat, jint joption_mask, jint jntree_limit,
+   jobject jout, jlongArray jout_len) {
+  BoosterHandle handle = (BoosterHandle) jhandle;
+  DMatrixHandle dmat = (DMatrixHandle) jdmat;
+  bst_ulong capacity;
+  jfloat* out = getBufferAddress<jfloat>(jenv, jout, &capacity);
+  // the predictions are written straight into the buffer, described as an array interface
+  std::string out_interface =
+      "{\"data\": [" + std::to_string(reinterpret_cast<uintptr_t>(out)) + ", false], " +
+      "\"shape\": [" + std::to_string(capacity) + "], " +
+      "\"typestr\": \"<f4\", \"version\": 2}";
+  bst_ulong len;
+  int ret = XGBoosterPredictToArray(handle, dmat, joption_mask, (unsigned int) jntree_limit,
+                                    /* training = */ 0, out_interface.c_str(), &len);
+  JVM_CHECK_CALL(ret);
+  jlong jlen = (jlong) len;
+  jenv->SetLongArrayRegion(jout_len, 0, 1, &jlen);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGBoosterLoadModel
@@ -651,7 +889,7 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterLoadModel
   int ret = XGBoosterLoadModelFromBuffer(
       handle, buffer, jenv->GetArrayLength(jbytes));
   JVM_CHECK_CALL(ret);
-  jenv->ReleaseByteArrayElements(jbytes, buffer, 0);
+  jenv->ReleaseByteArrayElements(jbytes, buffer, JNI_ABORT);
   return ret;
 }
 
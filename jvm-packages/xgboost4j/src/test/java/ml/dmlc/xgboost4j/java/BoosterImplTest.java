@@ -16,6 +16,8 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.util.Arrays;
@@ -101,6 +103,46 @@ public class BoosterImplTest {
     TestCase.assertTrue(eval.eval(predicts, testMat) < 0.1f);
   }
 
+  @Test
+  public void testBoosterWithBuffers() throws XGBoostError, IOException {
+    DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
+    DMatrix testMat = new DMatrix("../../demo/data/agaricus.txt.test");
+
+    Booster booster = trainBooster(trainMat, testMat);
+    float[][] predicts = booster.predict(testMat, true, 0);
+
+    int nrow = (int) testMat.rowNum();
+    ByteBuffer out = ByteBuffer.allocateDirect(nrow * 4).order(ByteOrder.nativeOrder());
+    TestCase.assertEquals(nrow, booster.predict(testMat, out, true, 0));
+    for (int i = 0; i < nrow; i++) {
+      TestCase.assertEquals(predicts[i][0], out.getFloat(i * 4));
+    }
+    try {
+      ByteBuffer small = ByteBuffer.allocateDirect((nrow - 1) * 4)
+          .order(ByteOrder.nativeOrder());
+      booster.predict(testMat, small, true, 0);
+      TestCase.fail("buffers too small for the predictions should be rejected");
+    } catch (XGBoostError ex) {
+    }
+
+    // one round with the gradients of squared error, from buffers and from arrays
+    float[] labels = testMat.getLabel();
+    float[] grad = new float[nrow];
+    float[] hess = new float[nrow];
+    ByteBuffer gradBuffer = ByteBuffer.allocateDirect(nrow * 4).order(ByteOrder.nativeOrder());
+    ByteBuffer hessBuffer = ByteBuffer.allocateDirect(nrow * 4).order(ByteOrder.nativeOrder());
+    for (int i = 0; i < nrow; i++) {
+      grad[i] = predicts[i][0] - labels[i];
+      hess[i] = 1.0f;
+      gradBuffer.putFloat(i * 4, grad[i]);
+      hessBuffer.putFloat(i * 4, hess[i]);
+    }
+    Booster copy = XGBoost.loadModel(new ByteArrayInputStream(booster.toByteArray()));
+    booster.boost(testMat, grad, hess);
+    copy.boost(testMat, gradBuffer, hessBuffer);
+    TestCase.assertTrue(Arrays.equals(booster.toByteArray(), copy.toByteArray()));
+  }
+
   @Test
   public void saveLoadModelWithPath() throws XGBoostError, IOException {
     DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
@@ -16,6 +16,8 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.Arrays;
 import java.util.HashMap;
 import java.util.Map;
@@ -57,6 +59,32 @@ public class DMatrixTest {
     }
   }
 
+  private static ByteBuffer floatBuffer(float[] values) {
+    ByteBuffer buffer = ByteBuffer.allocateDirect(values.length * 4)
+        .order(ByteOrder.nativeOrder());
+    buffer.asFloatBuffer().put(values);
+    return buffer;
+  }
+
+  @Test
+  public void testCreateFromColumnBatches() throws XGBoostError {
+    // 3 x 2 and 2 x 2 batches, row 1 of the first column is null
+    ByteBuffer valid = ByteBuffer.allocateDirect(1);
+    valid.put(0, (byte) 0b101);
+    java.util.List<ColumnBatch> batches = Arrays.asList(
+        new ColumnBatch(3, new ByteBuffer[]{floatBuffer(new float[]{1, 2, 3}),
+                                            floatBuffer(new float[]{4, 5, 6})},
+                        new ByteBuffer[]{valid, null}, floatBuffer(new float[]{0, 1, 0}),
+                        null),
+        new ColumnBatch(2, new ByteBuffer[]{floatBuffer(new float[]{7, 8}),
+                                            floatBuffer(new float[]{9, 10})},
+                        null, floatBuffer(new float[]{1, 1}), null));
+    DMatrix dmat = new DMatrix(batches.iterator(), 5, 10, Float.NaN);
+    TestCase.assertTrue(dmat.rowNum() == 5);
+    TestCase.assertTrue(Arrays.equals(new float[]{0, 1, 0, 1, 1}, dmat.getLabel()));
+    dmat.dispose();
+  }
+
   @Test
   public void testCreateFromFile() throws XGBoostError {
     //create DMatrix from file
@@ -117,6 +145,48 @@ public class DMatrixTest {
     TestCase.assertTrue(Arrays.equals(label1, label2));
   }
 
+  @Test
+  public void testCreateFromCSRBuffer() throws XGBoostError {
+    float[] data = new float[]{1, 2, 3, 4, 2, 3, 5, 3, 1, 2, 5};
+    int[] colIndex = new int[]{0, 2, 3, 0, 2, 3, 4, 0, 1, 2, 3};
+    long[] rowHeaders = new long[]{0, 3, 7, 11};
+    ByteBuffer dataBuffer = ByteBuffer.allocateDirect(data.length * 4)
+        .order(ByteOrder.nativeOrder());
+    dataBuffer.asFloatBuffer().put(data);
+    ByteBuffer indexBuffer = ByteBuffer.allocateDirect(colIndex.length * 4)
+        .order(ByteOrder.nativeOrder());
+    indexBuffer.asIntBuffer().put(colIndex);
+    ByteBuffer headerBuffer = ByteBuffer.allocateDirect(rowHeaders.length * 8)
+        .order(ByteOrder.nativeOrder());
+    headerBuffer.asLongBuffer().put(rowHeaders);
+    DMatrix dmat1 = new DMatrix(headerBuffer, indexBuffer, dataBuffer, 5);
+    TestCase.assertTrue(dmat1.rowNum() == 3);
+
+    float[] label = new float[]{1, 0, 1};
+    ByteBuffer labelBuffer = ByteBuffer.allocateDirect(label.length * 4)
+        .order(ByteOrder.nativeOrder());
+    labelBuffer.asFloatBuffer().put(label);
+    dmat1.setLabel(labelBuffer);
+    TestCase.assertTrue(Arrays.equals(label, dmat1.getLabel()));
+    dmat1.setWeight(labelBuffer);
+    TestCase.assertTrue(Arrays.equals(label, dmat1.getWeight()));
+
+    // buffers on the heap, or in the default big endian order, are rejected
+    try {
+      dmat1.setLabel(ByteBuffer.wrap(new byte[12]));
+      TestCase.fail("heap buffers should be rejected");
+    } catch (IllegalArgumentException ex) {
+    }
+    if (ByteOrder.nativeOrder() != ByteOrder.BIG_ENDIAN) {
+      try {
+        dmat1.setLabel(ByteBuffer.allocateDirect(12));
+        TestCase.fail("buffers in the wrong byte order should be rejected");
+      } catch (IllegalArgumentException ex) {
+      }
+    }
+    dmat1.dispose();
+  }
+
   @Test
   public void testCreateFromCSC() throws XGBoostError {
     //create Matrix from csc format sparse Matrix and labels
@@ -202,6 +272,47 @@ public class DMatrixTest {
     TestCase.assertTrue(Arrays.equals(weights, dmat0.getWeight()));
   }
 
+  @Test
+  public void testCreateFromDenseMatrixBuffer() throws XGBoostError {
+    int nrow = 10;
+    int ncol = 5;
+    float[] data0 = new float[nrow * ncol];
+    Random random = new Random();
+    for (int i = 0; i < nrow * ncol; i++) {
+      data0[i] = random.nextFloat();
+    }
+    // the same predictions as a matrix created from the array
+    ByteBuffer buffer = ByteBuffer.allocateDirect(data0.length * 4)
+        .order(ByteOrder.nativeOrder());
+    buffer.asFloatBuffer().put(data0);
+    DMatrix dmat0 = new DMatrix(data0, nrow, ncol, -0.1f);
+    DMatrix dmat1 = new DMatrix(buffer, nrow, ncol, -0.1f);
+    TestCase.assertTrue(dmat1.rowNum() == nrow);
+
+    float[] label0 = new float[nrow];
+    for (int i = 0; i < nrow; i++) {
+      label0[i] = random.nextFloat();
+    }
+    dmat0.setLabel(label0);
+    dmat1.setLabel(label0);
+    Map<String, Object> params = new HashMap<>();
+    params.put("max_depth", 3);
+    params.put("silent", 1);
+    Booster booster = XGBoost.train(dmat0, params, 2, new HashMap<String, DMatrix>(), null, null);
+    float[][] predicts0 = booster.predict(dmat0);
+    float[][] predicts1 = booster.predict(dmat1);
+    for (int i = 0; i < nrow; i++) {
+      assertArrayEquals(predicts0[i], predicts1[i], 0.0f);
+    }
+    try {
+      new DMatrix(buffer, nrow + 1, ncol, -0.1f);
+      TestCase.fail("buffers smaller than the matrix should be rejected");
+    } catch (IllegalArgumentException ex) {
+    }
+    dmat0.dispose();
+    dmat1.dispose();
+  }
+
   @Test
   public void testCreateFromDenseMatrixWithMissingValue() throws XGBoostError {
     //create DMatrix from 10*5 dense matrix
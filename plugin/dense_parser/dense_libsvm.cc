@@ -77,7 +77,7 @@ CreateDenseLibSVMParser(const std::string& path,
                         unsigned num_parts) {
   CHECK_NE(args.count("num_col"), 0) << "expect num_col in dense_libsvm";
   return new DensifyParser<IndexType>(
-            Parser<IndexType>::Create(path.c_str(), part_index, num_parts, "libsvm"),
+            Parser<IndexType>::Create(path.c_str(), part_index, num_parts, "fast_libsvm"),
            uint32_t(atoi(args.at("num_col").c_str())));
 }
 }  // namespace data
@@ -223,6 +223,9 @@ def early_stop(stopping_rounds, maximize=False, verbose=True):
 
     def callback(env):
         """internal function"""
+        if not env.evaluation_result_list:
+            # metrics are skipped on this iteration, see ``eval_period``
+            return
         if not state:
             init(env)
         score = env.evaluation_result_list[-1][1]
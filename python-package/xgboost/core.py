@@ -243,6 +243,18 @@ def _has_cuda_array_interface(data):
         CUDF_INSTALLED and isinstance(data, CUDF_DataFrame))
 
 
+def _gradient_pairs(grad, hess):
+    """Stack gradient and hessian into a C contiguous float32 array of shape (n, 2)."""
+    if hasattr(grad, '__cuda_array_interface__'):
+        import cupy   # pylint: disable=import-error
+        return cupy.ascontiguousarray(
+            cupy.stack([cupy.asarray(grad).ravel(), cupy.asarray(hess).ravel()],
+                       axis=1), dtype=cupy.float32)
+    return np.ascontiguousarray(
+        np.stack([np.asarray(grad).ravel(), np.asarray(hess).ravel()], axis=1),
+        dtype=np.float32)
+
+
 def _maybe_pandas_data(data, feature_names, feature_types,
                        meta=None, meta_type=None):
     """Extract internal data from pd.DataFrame for DMatrix data"""
@@ -741,8 +753,11 @@ class DMatrix(object):
                     'Expecting meta-info to contain a single column')
             data = data[data.columns[0]]
 
-        interface = bytes(json.dumps([data.__cuda_array_interface__],
-                                     indent=2), 'utf-8')
+        if _has_cuda_array_interface(data):
+            interface = data.__cuda_array_interface__
+        else:
+            interface = data.__array_interface__
+        interface = bytes(json.dumps([interface], indent=2), 'utf-8')
         _check_call(_LIB.XGDMatrixSetInfoFromInterface(self.handle,
                                                        c_str(field),
                                                        interface))
@@ -1261,10 +1276,11 @@ class Booster(object):
         ----------
         dtrain : DMatrix
             The training DMatrix.
-        grad : list
+        grad : list, numpy array or cupy array
             The first order of gradient.
-        hess : list
-            The second order of gradient.
+        hess : list, numpy array or cupy array
+            The second order of gradient.  CuPy arrays are passed to the booster
+            without copying them to host.
 
         """
         if len(grad) != len(hess):
@@ -1273,6 +1289,19 @@ class Booster(object):
             raise TypeError('invalid training matrix: {}'.format(type(dtrain).__name__))
         self._validate_features(dtrain)
 
+        if hasattr(grad, '__cuda_array_interface__') or isinstance(grad, np.ndarray):
+            # interleave into one array so the C API takes it with a single copy,
+            # device arrays stay on device.
+            pairs = _gradient_pairs(grad, hess)
+            if hasattr(pairs, '__cuda_array_interface__'):
+                interface = pairs.__cuda_array_interface__
+            else:
+                interface = pairs.__array_interface__
+            _check_call(_LIB.XGBoosterBoostOneIterWithGradientPairs(
+                self.handle, dtrain.handle,
+                bytes(json.dumps(interface), 'utf-8')))
+            return
+
         _check_call(_LIB.XGBoosterBoostOneIter(self.handle, dtrain.handle,
                                                c_array(ctypes.c_float, grad),
                                                c_array(ctypes.c_float, hess),
@@ -1325,6 +1354,108 @@ class Booster(object):
                     res += '\t%s-%s:%f' % (evname, name, val)
         return res
 
+    def train_rounds(self, dtrain, num_boost_round, evals=(), start_iteration=0,
+                     early_stopping_rounds=None, maximize=False, callback=None,
+                     checkpoint=None, checkpoint_period=0):
+        # pylint: disable=too-many-arguments
+        """Train for a number of rounds inside the native library, without returning
+        to Python between the iterations.  Unlike :py:func:`xgboost.train`, custom
+        objectives and evaluation functions are not supported.
+
+        Parameters
+        ----------
+        dtrain : DMatrix
+            The training DMatrix.
+        num_boost_round : int
+            Number of rounds to train.
+        evals : list of tuples (DMatrix, string)
+            Data sets evaluated after each iteration.
+        start_iteration : int
+            The first iteration to train.
+        early_stopping_rounds : int
+            Stop once the last metric of the last data set hasn't improved in this many
+            rounds.  The best iteration and score are kept in ``best_iteration`` and
+            ``best_score``.
+        maximize : bool
+            Whether a greater score is better for early stopping.
+        callback : function
+            Called as ``callback(iteration, results)`` after each evaluation, with the
+            results in the format of ``evals_result`` of :py:func:`xgboost.train`.
+            Returning ``True`` stops training.
+        checkpoint : function
+            Called as ``checkpoint(iteration, raw)`` every ``checkpoint_period`` rounds
+            and after the last, with the model in the format of :py:meth:`save_raw`.
+        checkpoint_period : int
+            Rounds between checkpoints.
+
+        Returns
+        -------
+        end_iteration : int
+            One past the last trained iteration.
+        """
+        if not isinstance(dtrain, DMatrix):
+            raise TypeError('invalid training matrix: {}'.format(type(dtrain).__name__))
+        self._validate_features(dtrain)
+        for d in evals:
+            if not isinstance(d[0], DMatrix):
+                raise TypeError('expected DMatrix, got {}'.format(type(d[0]).__name__))
+            self._validate_features(d[0])
+        if checkpoint is not None and checkpoint_period <= 0:
+            checkpoint_period = num_boost_round
+
+        # Exceptions can't cross the library, they are raised once training returns.
+        errors = []
+
+        def eval_iteration(_, iteration, results, metric_names, n_metrics):
+            try:
+                names = [metric_names[j].decode() for j in range(n_metrics)]
+                evals_result = {}
+                for i, (_, evname) in enumerate(evals):
+                    evals_result[evname] = {
+                        names[j]: results[i * n_metrics + j] for j in range(n_metrics)}
+                return 1 if callback(iteration, evals_result) else 0
+            except Exception as e:  # pylint: disable=broad-except
+                errors.append(e)
+                return -1
+
+        def save_checkpoint(_, iteration, model, length):
+            try:
+                checkpoint(iteration, bytearray(ctypes.string_at(model, length)))
+                return 0
+            except Exception as e:  # pylint: disable=broad-except
+                errors.append(e)
+                return -1
+
+        # pylint: disable=invalid-name
+        EVAL_CALLBACK = ctypes.CFUNCTYPE(
+            ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_float),
+            ctypes.POINTER(ctypes.c_char_p), c_bst_ulong)
+        CHECKPOINT_CALLBACK = ctypes.CFUNCTYPE(
+            ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, c_bst_ulong)
+        eval_func = EVAL_CALLBACK(eval_iteration) if callback is not None \
+            else ctypes.cast(None, EVAL_CALLBACK)
+        checkpoint_func = CHECKPOINT_CALLBACK(save_checkpoint) \
+            if checkpoint is not None else ctypes.cast(None, CHECKPOINT_CALLBACK)
+
+        dmats = c_array(ctypes.c_void_p, [d[0].handle for d in evals])
+        end_iteration = ctypes.c_int()
+        best_iteration = ctypes.c_int()
+        best_score = ctypes.c_float()
+        ret = _LIB.XGBoosterTrainRounds(
+            self.handle, dtrain.handle, ctypes.c_int(start_iteration),
+            ctypes.c_int(num_boost_round), dmats, c_bst_ulong(len(evals)),
+            ctypes.c_int(early_stopping_rounds or 0), ctypes.c_int(int(maximize)),
+            ctypes.c_int(checkpoint_period), eval_func, checkpoint_func, None,
+            ctypes.byref(end_iteration), ctypes.byref(best_iteration),
+            ctypes.byref(best_score))
+        if errors:
+            raise errors[0]
+        _check_call(ret)
+        if early_stopping_rounds:
+            self.best_iteration = best_iteration.value
+            self.best_score = best_score.value
+        return end_iteration.value
+
     def eval(self, data, name='eval', iteration=0):
         """Evaluate the model on mat.
 
@@ -1356,7 +1487,8 @@ class Booster(object):
                 approx_contribs=False,
                 pred_interactions=False,
                 validate_features=True,
-                training=False):
+                training=False,
+                out=None):
         """Predict with data.
 
         .. note:: This function is not thread safe.
@@ -1418,6 +1550,12 @@ class Booster(object):
           dropouts, i.e. all the trees will be evaluated.  If you want to
           obtain result with dropouts, provide `training=True`.
 
+        out : numpy array or cupy array
+            Contiguous float32 array the prediction is written into, with room
+            for at least the number of predicted values.  A device array
+            receives device predictions without going through the host.  The
+            array is returned as is, without reshaping.
+
         Returns
         -------
         prediction : numpy array
@@ -1443,6 +1581,17 @@ class Booster(object):
             self._validate_features(data)
 
         length = c_bst_ulong()
+        if out is not None:
+            if hasattr(out, '__cuda_array_interface__'):
+                interface = out.__cuda_array_interface__
+            else:
+                interface = out.__array_interface__
+            _check_call(_LIB.XGBoosterPredictToArray(
+                self.handle, data.handle, ctypes.c_int(option_mask),
+                ctypes.c_uint(ntree_limit), ctypes.c_int(training),
+                bytes(json.dumps(interface), 'utf-8'), ctypes.byref(length)))
+            return out
+
         preds = ctypes.POINTER(ctypes.c_float)()
         _check_call(_LIB.XGBoosterPredict(self.handle, data.handle,
                                           ctypes.c_int(option_mask),
@@ -1478,6 +1627,105 @@ class Booster(object):
                 preds = preds.reshape(nrow, chunk_size)
         return preds
 
+    def predict_leaf_index(self, data):
+        """Predict the leaf index of each row in each tree as unsigned integers.
+
+        Same as ``predict(data, pred_leaf=True)`` but without the conversion
+        through floats.  When the booster is trained with
+        ``cache_leaf_index=True``, the indices of the training matrix are
+        recorded while the trees are built so the trees are not walked again.
+
+        Parameters
+        ----------
+        data : DMatrix
+            The dmatrix storing the input.
+
+        Returns
+        -------
+        leaves : numpy array of shape (n_rows, n_trees) and type uint32
+        """
+        if not isinstance(data, DMatrix):
+            raise TypeError('Expecting data to be a DMatrix object, got: ',
+                            type(data))
+        n_trees = c_bst_ulong()
+        n_rows = c_bst_ulong()
+        leaves = ctypes.POINTER(ctypes.c_uint)()
+        _check_call(_LIB.XGBoosterPredictLeafIndex(self.handle, data.handle,
+                                                   ctypes.byref(n_trees),
+                                                   ctypes.byref(n_rows),
+                                                   ctypes.byref(leaves)))
+        leaves = ctypes2numpy(leaves, n_trees.value * n_rows.value, np.uint32)
+        # The booster keeps them tree major.
+        return leaves.reshape(n_trees.value, n_rows.value).T
+
+    def inplace_predict(self, data, output_margin=False, ntree_limit=0,
+                        missing=np.nan):
+        """Predict straight from the input data without creating a DMatrix.
+        Unlike ``predict``, this is thread safe as long as the booster is not
+        modified at the same time, and nothing is cached for the data.
+
+        Parameters
+        ----------
+        data : numpy array, scipy.sparse.csr_matrix or cupy array
+            The input data.  Predictions of cupy arrays are made and returned on
+            their device.
+
+        output_margin : bool
+            Whether to output the raw untransformed margin value.
+
+        ntree_limit : int
+            Limit number of trees in the prediction; defaults to 0 (use all
+            trees).
+
+        missing : float
+            Value in the data treated as missing, NaN is always missing.
+
+        Returns
+        -------
+        prediction : numpy array or cupy array
+        """
+        option_mask = 0x01 if output_margin else 0x00
+        length = c_bst_ulong()
+        preds = ctypes.POINTER(ctypes.c_float)()
+        args = (ctypes.c_float(missing), ctypes.c_int(option_mask),
+                ctypes.c_uint(ntree_limit), ctypes.byref(length),
+                ctypes.byref(preds))
+
+        def _interface_str(array):
+            return bytes(json.dumps(array.__array_interface__), 'utf-8')
+
+        if isinstance(data, np.ndarray):
+            data = np.ascontiguousarray(np.atleast_2d(data))
+            n_rows = data.shape[0]
+            _check_call(_LIB.XGBoosterPredictFromDense(
+                self.handle, _interface_str(data), *args))
+        elif isinstance(data, scipy.sparse.csr_matrix):
+            n_rows = data.shape[0]
+            indptr = np.ascontiguousarray(data.indptr, dtype=np.uint64)
+            indices = np.ascontiguousarray(data.indices, dtype=np.uint32)
+            values = np.ascontiguousarray(data.data, dtype=np.float32)
+            _check_call(_LIB.XGBoosterPredictFromCSR(
+                self.handle, _interface_str(indptr), _interface_str(indices),
+                _interface_str(values), c_bst_ulong(data.shape[1]), *args))
+        elif hasattr(data, '__cuda_array_interface__'):
+            import cupy     # pylint: disable=import-error
+            data = cupy.ascontiguousarray(cupy.atleast_2d(data))
+            n_rows = data.shape[0]
+            interface = bytes(json.dumps(data.__cuda_array_interface__), 'utf-8')
+            _check_call(_LIB.XGBoosterPredictFromCudaArray(
+                self.handle, interface, *args))
+            n_bytes = length.value * np.dtype(np.float32).itemsize
+            memory = cupy.cuda.UnownedMemory(
+                ctypes.cast(preds, ctypes.c_void_p).value, n_bytes, self)
+            result = cupy.ndarray((length.value,), dtype=cupy.float32,
+                                  memptr=cupy.cuda.MemoryPointer(memory, 0)).copy()
+            return result.reshape(n_rows, -1) if length.value != n_rows else result
+        else:
+            raise TypeError('Data type: {} is not supported by inplace_predict.'
+                            .format(type(data)))
+        result = ctypes2numpy(preds, length.value, np.float32)
+        return result.reshape(n_rows, -1) if length.value != n_rows else result
+
     def save_model(self, fname):
         """Save the model to a file.
 
@@ -1678,75 +1926,34 @@ class Booster(object):
                    repr(allowed_importance_types))
             raise ValueError(msg.format(importance_type))
 
-        # if it's weight, then omap stores the number of missing values
-        if importance_type == 'weight':
-            # do a simpler tree dump to save time
-            trees = self.get_dump(fmap, with_stats=False)
-
-            fmap = {}
-            for tree in trees:
-                for line in tree.split('\n'):
-                    # look for the opening square bracket
-                    arr = line.split('[')
-                    # if no opening bracket (leaf node), ignore this line
-                    if len(arr) == 1:
-                        continue
-
-                    # extract feature name from string between []
-                    fid = arr[1].split(']')[0].split('<')[0]
-
-                    if fid not in fmap:
-                        # if the feature hasn't been seen yet
-                        fmap[fid] = 1
-                    else:
-                        fmap[fid] += 1
-
-            return fmap
-
-        average_over_splits = True
-        if importance_type == 'total_gain':
-            importance_type = 'gain'
-            average_over_splits = False
-        elif importance_type == 'total_cover':
-            importance_type = 'cover'
-            average_over_splits = False
-
-        trees = self.get_dump(fmap, with_stats=True)
-
-        importance_type += '='
-        fmap = {}
-        gmap = {}
-        for tree in trees:
-            for line in tree.split('\n'):
-                # look for the opening square bracket
-                arr = line.split('[')
-                # if no opening bracket (leaf node), ignore this line
-                if len(arr) == 1:
-                    continue
-
-                # look for the closing bracket, extract only info within that bracket
-                fid = arr[1].split(']')
-
-                # extract gain or cover from string after closing bracket
-                g = float(fid[1].split(importance_type)[1].split(',')[0])
-
-                # extract feature name from string before closing bracket
-                fid = fid[0].split('<')[0]
-
-                if fid not in fmap:
-                    # if the feature hasn't been seen yet
-                    fmap[fid] = 1
-                    gmap[fid] = g
-                else:
-                    fmap[fid] += 1
-                    gmap[fid] += g
+        length = c_bst_ulong()
+        features = ctypes.POINTER(ctypes.c_uint)()
+        scores = ctypes.POINTER(ctypes.c_float)()
+        _check_call(_LIB.XGBoosterFeatureScore(self.handle,
+                                               c_str(importance_type),
+                                               ctypes.byref(length),
+                                               ctypes.byref(features),
+                                               ctypes.byref(scores)))
+        features = ctypes2numpy(features, length.value, np.uint32)
+        scores = ctypes2numpy(scores, length.value, np.float32)
+
+        # Name the features the same way as the model dump does.
+        if fmap != '':
+            if not os.path.exists(fmap):
+                raise ValueError("No such file: {0}".format(fmap))
+            with open(fmap) as fd:
+                names = [line.split()[1] for line in fd if line.strip()]
+        elif self.feature_names is not None:
+            names = self.feature_names
+        else:
+            names = []
 
-        # calculate average value (gain/cover) for each feature
-        if average_over_splits:
-            for fid in gmap:
-                gmap[fid] = gmap[fid] / fmap[fid]
+        def name(fid):
+            return names[fid] if fid < len(names) else 'f{0}'.format(fid)
 
-        return gmap
+        if importance_type == 'weight':
+            return {name(f): int(s) for f, s in zip(features, scores)}
+        return {name(f): float(s) for f, s in zip(features, scores)}
 
     def trees_to_dataframe(self, fmap=''):
         """Parse a boosted tree model text dump into a pandas DataFrame structure.
@@ -10,6 +10,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 #include "xgboost/base.h"
 #include "xgboost/data.h"
@@ -18,11 +21,23 @@
 #include "xgboost/logging.h"
 #include "xgboost/version_config.h"
 #include "xgboost/json.h"
+#include "xgboost/json_io.h"
 
 #include "c_api_error.h"
+#include "c_api_utils.h"
+#include "prediction_batcher.h"
 #include "../common/io.h"
+#include "../common/math.h"
+#include "../common/telemetry.h"
+#include "../common/timer.h"
 #include "../data/adapter.h"
+#include "../data/array_interface.h"
+#include "../data/dense_view_dmatrix.h"
 #include "../data/simple_dmatrix.h"
+#include "../predictor/flat_model.h"
+#if DMLC_ENABLE_STD_THREAD
+#include "../data/streaming_dmatrix.h"
+#endif  // DMLC_ENABLE_STD_THREAD
 
 using namespace xgboost; // NOLINT(*);
 
@@ -36,8 +51,12 @@ struct XGBAPIThreadLocalEntry {
   std::vector<const char *> ret_vec_charp;
   /*! \brief returning float vector. */
   std::vector<bst_float> ret_vec_float;
+  /*! \brief returning feature indices. */
+  std::vector<bst_feature_t> ret_vec_feature;
   /*! \brief temp variable of gradient pairs. */
   std::vector<GradientPair> tmp_gpair;
+  /*! \brief temp variable of the row in single row prediction. */
+  std::vector<Entry> tmp_row;
 };
 
 XGB_DLL void XGBoostVersion(int* major, int* minor, int* patch) {
@@ -62,6 +81,51 @@ int XGBRegisterLogCallback(void (*callback)(const char*)) {
   API_END();
 }
 
+XGB_DLL int XGBSetProfiling(int enable) {
+  API_BEGIN();
+  CHECK(enable >= 0 && enable <= 2) << "Invalid profiling mode: " << enable;
+  common::Monitor::SetProfiling(enable != 0);
+  common::Monitor::SetCudaSynchronize(enable == 2);
+  API_END();
+}
+
+XGB_DLL int XGBGetProfile(int all_ranks, char const** out_json) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  common::Monitor::Profile(all_ranks != 0, &ret_str);
+  *out_json = ret_str.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBRegisterTelemetryCallback(XGBCallbackTelemetry *callback, void *context) {
+  API_BEGIN();
+  if (callback == nullptr) {
+    common::Telemetry::SetCallback(nullptr);
+  } else {
+    common::Telemetry::SetCallback([callback, context](common::IterationTelemetry const& in) {
+      using common::TelemetryPhase;
+      auto seconds = [&](TelemetryPhase phase) {
+        return in.seconds[static_cast<size_t>(phase)];
+      };
+      XGBIterationTelemetry out;
+      out.iteration = in.iteration;
+      out.rank = in.rank;
+      out.predict_raw = seconds(TelemetryPhase::kPredictRaw);
+      out.get_gradient = seconds(TelemetryPhase::kGetGradient);
+      out.do_boost = seconds(TelemetryPhase::kDoBoost);
+      out.init_data = seconds(TelemetryPhase::kInitData);
+      out.build_hist = seconds(TelemetryPhase::kBuildHist);
+      out.evaluate_splits = seconds(TelemetryPhase::kEvaluateSplits);
+      out.apply_split = seconds(TelemetryPhase::kApplySplit);
+      out.sync_histograms = seconds(TelemetryPhase::kSyncHistograms);
+      out.evaluation = seconds(TelemetryPhase::kEvaluation);
+      out.allreduce_bytes = in.allreduce_bytes;
+      callback(&out, context);
+    });
+  }
+  API_END();
+}
+
 int XGDMatrixCreateFromFile(const char *fname,
                             int silent,
                             DMatrixHandle *out) {
@@ -96,6 +160,41 @@ XGB_DLL int XGDMatrixCreateFromDataIter(
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromColumnarIter(DataIterHandle data_handle,
+                                            XGBCallbackColumnarIterNext* next,
+                                            xgboost::bst_ulong num_rows_hint,
+                                            xgboost::bst_ulong num_nonzero_hint,
+                                            float missing,
+                                            int nthread,
+                                            DMatrixHandle* out) {
+  API_BEGIN();
+  data::ColumnarIteratorAdapter adapter(data_handle, next, num_rows_hint, num_nonzero_hint);
+  std::unique_ptr<DMatrix> dmat{DMatrix::Create(&adapter, missing, nthread)};
+  // the batches report their columns as size, so meta info is gathered by the adapter
+  dmat->Info().labels_.HostVector() = std::move(adapter.Labels());
+  dmat->Info().weights_.HostVector() = std::move(adapter.Weights());
+  *out = new std::shared_ptr<DMatrix>(dmat.release());
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromCallback(DataIterHandle data_handle,
+                                        XGBCallbackDataIterReset* reset,
+                                        XGBCallbackDataIterNext* next,
+                                        float missing,
+                                        DMatrixHandle* out) {
+  API_BEGIN();
+  CHECK(reset != nullptr) << "A reset callback is required to stream the data.";
+#if DMLC_ENABLE_STD_THREAD
+  std::unique_ptr<data::IteratorAdapter> adapter{
+      new data::IteratorAdapter(data_handle, next, reset)};
+  *out = new std::shared_ptr<DMatrix>{
+      new data::StreamingDMatrix(std::move(adapter), missing)};
+#else
+  LOG(FATAL) << "Streaming DMatrix is not enabled in mingw";
+#endif  // DMLC_ENABLE_STD_THREAD
+  API_END();
+}
+
 #ifndef XGBOOST_USE_CUDA
 XGB_DLL int XGDMatrixCreateFromArrayInterfaceColumns(char const* c_json_strs,
                                                      bst_float missing,
@@ -115,6 +214,47 @@ XGB_DLL int XGDMatrixCreateFromArrayInterface(char const* c_json_strs,
   API_END();
 }
 
+XGB_DLL int XGBSetGPUAllocator(void* (*allocate)(size_t, void*, void*),
+                               void (*deallocate)(void*, size_t, void*, void*),
+                               void* context) {
+  API_BEGIN();
+  LOG(FATAL) << "Xgboost not compiled with cuda";
+  API_END();
+}
+
+XGB_DLL int XGBSetGPUMemoryPoolSize(bst_ulong max_cached_bytes) {
+  API_BEGIN();
+  LOG(FATAL) << "Xgboost not compiled with cuda";
+  API_END();
+}
+
+XGB_DLL int XGBSetGPUManagedMemory(int enable) {
+  API_BEGIN();
+  LOG(FATAL) << "Xgboost not compiled with cuda";
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCudaArray(BoosterHandle handle,
+                                          char const* c_array_interface,
+                                          float missing,
+                                          int option_mask,
+                                          unsigned ntree_limit,
+                                          xgboost::bst_ulong *out_len,
+                                          const float **out_result) {
+  API_BEGIN();
+  LOG(FATAL) << "Xgboost not compiled with cuda";
+  API_END();
+}
+
+void xgboost::CopyGradientPairs(void const* data, size_t n,
+                                HostDeviceVector<GradientPair>* out_gpair) {
+  out_gpair->Resize(n);
+  std::memcpy(out_gpair->HostPointer(), data, n * sizeof(GradientPair));
+}
+
+void xgboost::CopyPredictions(HostDeviceVector<float> const& preds, void* out) {
+  std::memcpy(out, preds.ConstHostPointer(), preds.Size() * sizeof(float));
+}
 #endif
 
 XGB_DLL int XGDMatrixCreateFromCSREx(const size_t* indptr,
@@ -143,6 +283,21 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromCSCDouble(const int* col_ptr,
+                                         const int* indices,
+                                         const double* data,
+                                         size_t nindptr,
+                                         size_t nelem,
+                                         size_t num_row,
+                                         int nthread,
+                                         DMatrixHandle* out) {
+  API_BEGIN();
+  data::TypedCSCAdapter<int32_t, double> adapter(col_ptr, indices, data, nindptr - 1,
+                                                 num_row);
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(&adapter, std::nan(""), nthread));
+  API_END();
+}
+
 XGB_DLL int XGDMatrixCreateFromMat(const bst_float* data,
                                    xgboost::bst_ulong nrow,
                                    xgboost::bst_ulong ncol, bst_float missing,
@@ -164,6 +319,51 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,  // NOLINT
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromMatColMajor(const double* data,
+                                           xgboost::bst_ulong nrow,
+                                           xgboost::bst_ulong ncol,
+                                           bst_float missing, int nthread,
+                                           DMatrixHandle* out) {
+  API_BEGIN();
+  data::ColMajorDenseAdapter<double> adapter(data, nrow, ncol);
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(&adapter, missing, nthread));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromMatColMajorInt(const int* data,
+                                              xgboost::bst_ulong nrow,
+                                              xgboost::bst_ulong ncol,
+                                              bst_float missing, int nthread,
+                                              DMatrixHandle* out) {
+  API_BEGIN();
+  data::ColMajorDenseAdapter<int32_t> adapter(data, nrow, ncol);
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(&adapter, missing, nthread));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateDenseView(const bst_float* data,
+                                     xgboost::bst_ulong nrow,
+                                     xgboost::bst_ulong ncol,
+                                     bst_float missing, int nthread,
+                                     DMatrixHandle* out) {
+  API_BEGIN();
+  *out = new std::shared_ptr<DMatrix>(
+      new data::DenseViewDMatrix(data, nrow, ncol, missing, nthread));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateQuantileFromMat(const bst_float* data,
+                                           xgboost::bst_ulong nrow,
+                                           xgboost::bst_ulong ncol,
+                                           bst_float missing, int max_bin, int nthread,
+                                           DMatrixHandle* out) {
+  API_BEGIN();
+  data::DenseAdapter adapter(data, nrow, ncol);
+  *out = new std::shared_ptr<DMatrix>(
+      DMatrix::CreateQuantile(&adapter, missing, nthread, max_bin));
+  API_END();
+}
+
 XGB_DLL int XGDMatrixCreateFromDT(void** data, const char** feature_stypes,
                                   xgboost::bst_ulong nrow,
                                   xgboost::bst_ulong ncol, DMatrixHandle* out,
@@ -175,6 +375,18 @@ XGB_DLL int XGDMatrixCreateFromDT(void** data, const char** feature_stypes,
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromArrowColumns(char const* c_json_strs,
+                                            bst_float missing,
+                                            int nthread,
+                                            DMatrixHandle* out) {
+  API_BEGIN();
+  std::string json_str{c_json_strs};
+  data::ArrowAdapter adapter(json_str);
+  *out = new std::shared_ptr<DMatrix>(
+      DMatrix::Create(&adapter, missing, nthread));
+  API_END();
+}
+
 XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int* idxset,
                                   xgboost::bst_ulong len,
@@ -198,11 +410,39 @@ XGB_DLL int XGDMatrixSliceDMatrixEx(DMatrixHandle handle,
         << "slice does not support group structure";
   }
   DMatrix* dmat = static_cast<std::shared_ptr<DMatrix>*>(handle)->get();
-  CHECK(dynamic_cast<data::SimpleDMatrix*>(dmat))
-      << "Slice only supported for SimpleDMatrix currently.";
-  data::DMatrixSliceAdapter adapter(dmat, {idxset, static_cast<size_t>(len)});
-  *out = new std::shared_ptr<DMatrix>(
-      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1));
+  auto* simple = dynamic_cast<data::SimpleDMatrix*>(dmat);
+  CHECK(simple) << "Slice only supported for SimpleDMatrix currently.";
+  *out = new std::shared_ptr<DMatrix>(new data::SimpleDMatrix(
+      *simple, {idxset, static_cast<size_t>(len)}, 0));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixAppendFromMat(DMatrixHandle handle,
+                                   const bst_float* data,
+                                   xgboost::bst_ulong nrow,
+                                   xgboost::bst_ulong ncol,
+                                   bst_float missing,
+                                   int nthread,
+                                   int resketch) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  DMatrix* dmat = static_cast<std::shared_ptr<DMatrix>*>(handle)->get();
+  auto* simple = dynamic_cast<data::SimpleDMatrix*>(dmat);
+  CHECK(simple) << "Appending rows is only supported for SimpleDMatrix currently.";
+  data::DenseAdapter adapter(data, nrow, ncol);
+  simple->Append(&adapter, missing, nthread, resketch != 0);
+  API_END();
+}
+
+XGB_DLL int XGDMatrixDropRows(DMatrixHandle handle,
+                              xgboost::bst_ulong begin,
+                              xgboost::bst_ulong end) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  DMatrix* dmat = static_cast<std::shared_ptr<DMatrix>*>(handle)->get();
+  auto* simple = dynamic_cast<data::SimpleDMatrix*>(dmat);
+  CHECK(simple) << "Dropping rows is only supported for SimpleDMatrix currently.";
+  simple->DropRows(begin, end);
   API_END();
 }
 
@@ -348,6 +588,22 @@ XGB_DLL int XGBoosterFree(BoosterHandle handle) {
   API_END();
 }
 
+XGB_DLL int XGBoosterSlice(BoosterHandle handle, int begin_layer,
+                           int end_layer, int step,
+                           BoosterHandle *out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* learner = static_cast<Learner*>(handle);
+  bool out_of_bound = false;
+  auto* p_out = learner->Slice(begin_layer, end_layer, step, &out_of_bound);
+  if (out_of_bound) {
+    return -2;
+  }
+  CHECK(p_out);
+  *out = p_out;
+  API_END();
+}
+
 XGB_DLL int XGBoosterSetParam(BoosterHandle handle,
                               const char *name,
                               const char *value) {
@@ -360,9 +616,7 @@ XGB_DLL int XGBoosterSetParam(BoosterHandle handle,
 XGB_DLL int XGBoosterLoadJsonConfig(BoosterHandle handle, char const* json_parameters) {
   API_BEGIN();
   CHECK_HANDLE();
-  std::string str {json_parameters};
-  Json config { Json::Load(StringView{str.c_str(), str.size()}) };
-  static_cast<Learner*>(handle)->LoadConfig(config);
+  static_cast<Learner*>(handle)->LoadJsonConfig(json_parameters);
   API_END();
 }
 
@@ -371,12 +625,8 @@ XGB_DLL int XGBoosterSaveJsonConfig(BoosterHandle handle,
                                     char const** out_str) {
   API_BEGIN();
   CHECK_HANDLE();
-  Json config { Object() };
-  auto* learner = static_cast<Learner*>(handle);
-  learner->Configure();
-  learner->SaveConfig(&config);
   std::string& raw_str = XGBAPIThreadLocalStore::Get()->ret_str;
-  Json::Dump(config, &raw_str);
+  static_cast<Learner*>(handle)->SaveJsonConfig(&raw_str);
   *out_str = raw_str.c_str();
   *out_len = static_cast<xgboost::bst_ulong>(raw_str.length());
   API_END();
@@ -416,6 +666,43 @@ XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterBoostOneIterWithGradientPairs(BoosterHandle handle,
+                                                   DMatrixHandle dtrain,
+                                                   char const* c_interface_str) {
+  static_assert(sizeof(GradientPair) == 2 * sizeof(float),
+                "Gradient pairs are copied as interleaved float32 values.");
+  HostDeviceVector<GradientPair> tmp_gpair;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Learner*>(handle);
+  auto* dtr =
+      static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  Json j_interface = Json::Load({c_interface_str, std::strlen(c_interface_str)});
+  auto const& j_array = get<Object const>(j_interface);
+  ArrayInterfaceHandler::Validate(j_array);
+  CHECK_EQ(get<String const>(j_array.at("typestr")).substr(1), "f4")
+      << "Gradient pairs" << ArrayInterfaceErrors::ofType("float32");
+  auto const& j_shape = get<Array const>(j_array.at("shape"));
+  CHECK_EQ(j_shape.size(), 2) << ArrayInterfaceErrors::Dimension(2);
+  CHECK_EQ(get<Integer const>(j_shape.at(1)), 2)
+      << "Gradient pairs should have 2 columns, gradient and hessian.";
+  auto it = j_array.find("strides");
+  if (it != j_array.cend() && !IsA<Null>(it->second)) {
+    auto const& strides = get<Array const>(it->second);
+    CHECK(get<Integer const>(strides.at(0)) == static_cast<int64_t>(2 * sizeof(float)) &&
+          get<Integer const>(strides.at(1)) == static_cast<int64_t>(sizeof(float)))
+        << ArrayInterfaceErrors::Contigious();
+  }
+  CHECK(j_array.find("mask") == j_array.cend() || IsA<Null>(j_array.at("mask")))
+      << "Gradient pairs should be dense, found validity mask";
+  auto const n = static_cast<size_t>(get<Integer const>(j_shape.at(0)));
+  CopyGradientPairs(ArrayInterfaceHandler::GetPtrFromArrayData<void const*>(j_array), n,
+                    &tmp_gpair);
+
+  bst->BoostOneIter(0, *dtr, &tmp_gpair);
+  API_END();
+}
+
 XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  int iter,
                                  DMatrixHandle dmats[],
@@ -439,6 +726,165 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterTrainRounds(BoosterHandle handle,
+                                 DMatrixHandle dtrain,
+                                 int begin_iteration,
+                                 int num_round,
+                                 DMatrixHandle dmats[],
+                                 xgboost::bst_ulong len,
+                                 int early_stopping_rounds,
+                                 int maximize,
+                                 int checkpoint_period,
+                                 XGBCallbackEvalIteration* eval_callback,
+                                 XGBCallbackCheckpoint* checkpoint,
+                                 void* context,
+                                 int* out_end_iteration,
+                                 int* out_best_iteration,
+                                 float* out_best_score) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GE(num_round, 0);
+  CHECK_GE(early_stopping_rounds, 0);
+  CHECK_GE(checkpoint_period, 0);
+  CHECK(early_stopping_rounds == 0 || len != 0)
+      << "Early stopping requires at least one data set for evaluation.";
+  auto* bst = static_cast<Learner*>(handle);
+  auto* dtr = static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  std::vector<std::shared_ptr<DMatrix>> data_sets;
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    data_sets.push_back(*static_cast<std::shared_ptr<DMatrix>*>(dmats[i]));
+  }
+
+  // Resume from the best score kept by an earlier run, like the Python callback.
+  int best_iteration = begin_iteration;
+  float best_score = maximize ? -std::numeric_limits<float>::infinity()
+                              : std::numeric_limits<float>::infinity();
+  std::string value;
+  if (early_stopping_rounds != 0 && bst->GetAttr("best_score", &value)) {
+    best_score = std::stof(value);
+    CHECK(bst->GetAttr("best_iteration", &value));
+    best_iteration = std::stoi(value);
+  }
+
+  std::vector<bst_float> results;
+  std::vector<std::string> metric_names;
+  std::vector<char const*> c_metric_names;
+  std::string raw;
+  int iter = begin_iteration;
+  int const end_iteration = begin_iteration + num_round;
+  bool stop = false;
+  while (iter < end_iteration && !stop) {
+    bst->UpdateOneIter(iter, *dtr);
+    if (!data_sets.empty()) {
+      bst->EvalOneIterValues(iter, data_sets, &results, &metric_names);
+    }
+    if (!results.empty()) {
+      if (eval_callback != nullptr) {
+        c_metric_names.clear();
+        for (auto const& name : metric_names) {
+          c_metric_names.push_back(name.c_str());
+        }
+        int ret = eval_callback(context, iter, results.data(), c_metric_names.data(),
+                                static_cast<xgboost::bst_ulong>(metric_names.size()));
+        CHECK(ret == 0 || ret == 1) << "Training stopped by the evaluation callback.";
+        stop = ret == 1;
+      }
+      if (early_stopping_rounds != 0) {
+        float const score = results.back();
+        if (maximize ? score > best_score : score < best_score) {
+          best_score = score;
+          best_iteration = iter;
+          std::ostringstream os;
+          os << std::setprecision(std::numeric_limits<float>::max_digits10) << best_score;
+          bst->SetAttr("best_score", os.str());
+          bst->SetAttr("best_iteration", std::to_string(best_iteration));
+        } else if (iter - best_iteration >= early_stopping_rounds) {
+          stop = true;
+        }
+      }
+    }
+    ++iter;
+    if (checkpoint != nullptr && checkpoint_period != 0 &&
+        ((iter - begin_iteration) % checkpoint_period == 0 || stop ||
+         iter == end_iteration)) {
+      raw.clear();
+      common::MemoryBufferStream fo(&raw);
+      bst->SaveModel(&fo);
+      CHECK_EQ(checkpoint(context, iter - 1, raw.data(),
+                          static_cast<xgboost::bst_ulong>(raw.size())), 0)
+          << "Training stopped by the checkpoint callback.";
+    }
+  }
+  if (out_end_iteration != nullptr) {
+    *out_end_iteration = iter;
+  }
+  if (out_best_iteration != nullptr) {
+    *out_best_iteration = best_iteration;
+  }
+  if (out_best_score != nullptr) {
+    *out_best_score = best_score;
+  }
+  API_END();
+}
+
+XGB_DLL int XGBoosterCrossValidate(DMatrixHandle dtrain,
+                                   char const* c_json_params,
+                                   int const* folds,
+                                   xgboost::bst_ulong len,
+                                   int num_round,
+                                   xgboost::bst_ulong* out_len,
+                                   float const** out_results,
+                                   xgboost::bst_ulong* out_n_metrics,
+                                   char const*** out_metric_names) {
+  API_BEGIN();
+  CHECK(dtrain != nullptr) << "DMatrix has not been intialized or has already been disposed.";
+  auto* dtr = static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  Json j_params = Json::Load({c_json_params, std::strlen(c_json_params)});
+  Args params;
+  for (auto const& kv : get<Object const>(j_params)) {
+    if (IsA<Array>(kv.second)) {
+      for (auto const& value : get<Array const>(kv.second)) {
+        params.emplace_back(kv.first, get<String const>(value));
+      }
+    } else {
+      params.emplace_back(kv.first, get<String const>(kv.second));
+    }
+  }
+  std::vector<int32_t> h_folds(folds, folds + len);
+
+  auto& results = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  std::vector<std::string>& str_vecs = XGBAPIThreadLocalStore::Get()->ret_vec_str;
+  std::vector<const char*>& charp_vecs = XGBAPIThreadLocalStore::Get()->ret_vec_charp;
+  CrossValidate(params, *dtr, h_folds, num_round, &results, &str_vecs);
+  charp_vecs.resize(str_vecs.size());
+  for (size_t i = 0; i < str_vecs.size(); ++i) {
+    charp_vecs[i] = str_vecs[i].c_str();
+  }
+  *out_len = static_cast<xgboost::bst_ulong>(results.size());
+  *out_results = dmlc::BeginPtr(results);
+  *out_n_metrics = static_cast<xgboost::bst_ulong>(charp_vecs.size());
+  *out_metric_names = dmlc::BeginPtr(charp_vecs);
+  API_END();
+}
+
+XGB_DLL int XGBoosterTrainBatched(BoosterHandle handles[],
+                                  xgboost::bst_ulong len,
+                                  DMatrixHandle dtrain,
+                                  int begin_iteration,
+                                  int num_round) {
+  API_BEGIN();
+  CHECK(dtrain != nullptr) << "DMatrix has not been intialized or has already been disposed.";
+  std::vector<Learner*> learners;
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    CHECK(handles[i] != nullptr)
+        << "Booster has not been intialized or has already been disposed.";
+    learners.push_back(static_cast<Learner*>(handles[i]));
+  }
+  TrainBatched(learners, *static_cast<std::shared_ptr<DMatrix>*>(dtrain), begin_iteration,
+               num_round);
+  API_END();
+}
+
 XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              DMatrixHandle dmat,
                              int option_mask,
@@ -460,13 +906,380 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
       (option_mask & 2) != 0,
       (option_mask & 4) != 0,
       (option_mask & 8) != 0,
-      (option_mask & 16) != 0);
-  preds = tmp_preds.HostVector();
+      (option_mask & 16) != 0,
+      (option_mask & 32) == 0);
+  preds = std::move(tmp_preds.HostVector());
   *out_result = dmlc::BeginPtr(preds);
   *len = static_cast<xgboost::bst_ulong>(preds.size());
   API_END();
 }
 
+XGB_DLL int XGBoosterReleasePredictionCache(BoosterHandle handle,
+                                           DMatrixHandle dmat) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Learner*>(handle);
+  bst->ReleasePredictionCache(
+      dmat == nullptr ? nullptr : static_cast<std::shared_ptr<DMatrix>*>(dmat)->get());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictStaged(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   const unsigned *iterations,
+                                   xgboost::bst_ulong n_iterations,
+                                   xgboost::bst_ulong *out_len,
+                                   const bst_float **out_result) {
+  std::vector<bst_float>& preds =
+      XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK(iterations != nullptr || n_iterations == 0);
+  auto *bst = static_cast<Learner*>(handle);
+  HostDeviceVector<bst_float> tmp_preds;
+  bst->PredictStaged(*static_cast<std::shared_ptr<DMatrix>*>(dmat),
+                     std::vector<unsigned>(iterations, iterations + n_iterations),
+                     (option_mask & 1) != 0, &tmp_preds);
+  preds = std::move(tmp_preds.HostVector());
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictStream(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   unsigned ntree_limit,
+                                   XGBCallbackPredictionPage *callback,
+                                   void *context) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK(callback != nullptr);
+  auto *bst = static_cast<Learner*>(handle);
+  bst->PredictStream(*static_cast<std::shared_ptr<DMatrix>*>(dmat), (option_mask & 1) != 0,
+                     ntree_limit,
+                     [callback, context](size_t base_row, common::Span<bst_float const> preds) {
+                       int ret = callback(context, static_cast<xgboost::bst_ulong>(base_row),
+                                          preds.data(),
+                                          static_cast<xgboost::bst_ulong>(preds.size()));
+                       CHECK_EQ(ret, 0) << "Prediction stopped by the callback at row "
+                                        << base_row << ".";
+                     });
+  API_END();
+}
+
+XGB_DLL int XGBoosterCompactModel(BoosterHandle handle,
+                                  xgboost::bst_ulong *out_len,
+                                  char const **out_report) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  Json report { Object() };
+  static_cast<Learner*>(handle)->Compact(&report);
+  std::string& raw_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  raw_str.clear();
+  Json::Dump(report, &raw_str);
+  *out_report = raw_str.c_str();
+  *out_len = static_cast<xgboost::bst_ulong>(raw_str.length());
+  API_END();
+}
+
+XGB_DLL int XGBoosterFeatureScore(BoosterHandle handle,
+                                  const char *importance_type,
+                                  xgboost::bst_ulong *out_length,
+                                  const unsigned **out_features,
+                                  const float **out_scores) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Learner*>(handle);
+  auto& features = XGBAPIThreadLocalStore::Get()->ret_vec_feature;
+  auto& scores = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  bst->CalcFeatureScore(importance_type, &features, &scores);
+  *out_length = static_cast<xgboost::bst_ulong>(features.size());
+  *out_features = dmlc::BeginPtr(features);
+  *out_scores = dmlc::BeginPtr(scores);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      xgboost::bst_ulong *out_n_trees,
+                                      xgboost::bst_ulong *out_n_rows,
+                                      const unsigned **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Learner*>(handle);
+  auto p_m = *static_cast<std::shared_ptr<DMatrix>*>(dmat);
+  size_t n_trees {0};
+  auto const& leaf_indices = bst->PredictLeafIndex(p_m, &n_trees);
+  *out_result = leaf_indices.ConstHostVector().data();
+  *out_n_trees = static_cast<xgboost::bst_ulong>(n_trees);
+  *out_n_rows = static_cast<xgboost::bst_ulong>(p_m->Info().num_row_);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictToArray(BoosterHandle handle,
+                                    DMatrixHandle dmat,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    int32_t training,
+                                    char const* c_out_interface,
+                                    xgboost::bst_ulong *out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  Json j_interface = Json::Load({c_out_interface, std::strlen(c_out_interface)});
+  auto const& j_array = get<Object const>(j_interface);
+  ArrayInterfaceHandler::Validate(j_array);
+  CHECK_EQ(get<String const>(j_array.at("typestr")).substr(1), "f4")
+      << "Prediction buffer" << ArrayInterfaceErrors::ofType("float32");
+  auto const& j_data = get<Array const>(j_array.at("data"));
+  CHECK(j_data.size() < 2 || !IsA<Boolean>(j_data[1]) || !get<Boolean const>(j_data[1]))
+      << "Prediction buffer is read only.";
+  CHECK(j_array.find("mask") == j_array.cend() || IsA<Null>(j_array.at("mask")))
+      << "Prediction buffer should be dense, found validity mask";
+  auto const& j_shape = get<Array const>(j_array.at("shape"));
+  size_t capacity = 1;
+  for (auto const& dim : j_shape) {
+    capacity *= static_cast<size_t>(get<Integer const>(dim));
+  }
+  auto it = j_array.find("strides");
+  if (it != j_array.cend() && !IsA<Null>(it->second)) {
+    auto const& strides = get<Array const>(it->second);
+    int64_t expected = sizeof(float);
+    for (size_t i = j_shape.size(); i != 0; --i) {
+      CHECK_EQ(get<Integer const>(strides.at(i - 1)), expected)
+          << ArrayInterfaceErrors::Contigious();
+      expected *= get<Integer const>(j_shape.at(i - 1));
+    }
+  }
+
+  auto *bst = static_cast<Learner*>(handle);
+  HostDeviceVector<bst_float> tmp_preds;
+  bst->Predict(
+      *static_cast<std::shared_ptr<DMatrix>*>(dmat),
+      (option_mask & 1) != 0,
+      &tmp_preds, ntree_limit,
+      static_cast<bool>(training),
+      (option_mask & 2) != 0,
+      (option_mask & 4) != 0,
+      (option_mask & 8) != 0,
+      (option_mask & 16) != 0,
+      (option_mask & 32) == 0);
+  CHECK_GE(capacity, tmp_preds.Size())
+      << "Prediction buffer is too small, " << tmp_preds.Size() << " values are required.";
+  CopyPredictions(tmp_preds, ArrayInterfaceHandler::GetPtrFromArrayData<void*>(j_array));
+  *out_len = static_cast<xgboost::bst_ulong>(tmp_preds.Size());
+  API_END();
+}
+
+void xgboost::InplacePredictImpl(Learner* learner, dmlc::any const& x, float missing,
+                                 int option_mask, unsigned ntree_limit,
+                                 xgboost::bst_ulong* out_len, float const** out_result) {
+  CHECK_EQ(option_mask & ~1, 0)
+      << "Inplace prediction only supports normal and margin prediction.";
+  HostDeviceVector<bst_float>* p_preds {nullptr};
+  learner->InplacePredict(x, (option_mask & 1) != 0, missing, &p_preds, ntree_limit);
+  CHECK(p_preds);
+  if (p_preds->DeviceIdx() >= 0 && p_preds->DeviceCanRead()) {
+    *out_result = p_preds->ConstDevicePointer();
+  } else {
+    *out_result = p_preds->ConstHostPointer();
+  }
+  *out_len = static_cast<xgboost::bst_ulong>(p_preds->Size());
+}
+
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      char const* c_array_interface,
+                                      float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      xgboost::bst_ulong *out_len,
+                                      const float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::shared_ptr<data::ArrayAdapter> x {new data::ArrayAdapter(c_array_interface)};
+  InplacePredictImpl(static_cast<Learner*>(handle), x, missing, option_mask, ntree_limit,
+                     out_len, out_result);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    char const* c_indptr,
+                                    char const* c_indices,
+                                    char const* c_values,
+                                    xgboost::bst_ulong ncol,
+                                    float missing,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    xgboost::bst_ulong *out_len,
+                                    const float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  Json j_indptr = Json::Load({c_indptr, std::strlen(c_indptr)});
+  Json j_indices = Json::Load({c_indices, std::strlen(c_indices)});
+  Json j_values = Json::Load({c_values, std::strlen(c_values)});
+  auto indptr = ArrayInterfaceHandler::ExtractData<size_t const>(get<Object const>(j_indptr));
+  auto indices =
+      ArrayInterfaceHandler::ExtractData<unsigned const>(get<Object const>(j_indices));
+  auto values = ArrayInterfaceHandler::ExtractData<float const>(get<Object const>(j_values));
+  CHECK_GE(indptr.size(), 1) << "Row pointers of CSR matrix are empty.";
+  CHECK_EQ(indices.size(), values.size());
+  CHECK_LE(indptr[indptr.size() - 1], values.size());
+  // the predictor indexes features with these unchecked
+  for (auto fidx : indices) {
+    CHECK_LT(fidx, ncol) << "Feature index out of range of CSR matrix.";
+  }
+  std::shared_ptr<data::CSRAdapter> x {new data::CSRAdapter(
+      indptr.data(), indices.data(), values.data(), indptr.size() - 1, values.size(),
+      ncol)};
+  InplacePredictImpl(static_cast<Learner*>(handle), x, missing, option_mask, ntree_limit,
+                     out_len, out_result);
+  API_END();
+}
+
+namespace {
+void PredictRowImpl(BoosterHandle handle, std::vector<Entry> const& row, int option_mask,
+                    unsigned ntree_limit, float *out_result, xgboost::bst_ulong out_size,
+                    xgboost::bst_ulong *out_len) {
+  CHECK_EQ(option_mask & ~1, 0)
+      << "Single row prediction only supports normal and margin prediction.";
+  auto *bst = static_cast<Learner*>(handle);
+  *out_len = static_cast<xgboost::bst_ulong>(
+      bst->PredictRow(common::Span<Entry const>(row.data(), row.size()),
+                      (option_mask & 1) != 0,
+                      common::Span<bst_float>(out_result, out_size), ntree_limit));
+}
+}  // anonymous namespace
+
+XGB_DLL int XGBoosterPredictFromDenseRow(BoosterHandle handle,
+                                         const float *row,
+                                         xgboost::bst_ulong n_features,
+                                         float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         float *out_result,
+                                         xgboost::bst_ulong out_size,
+                                         xgboost::bst_ulong *out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::vector<Entry>& entries = XGBAPIThreadLocalStore::Get()->tmp_row;
+  entries.clear();
+  for (xgboost::bst_ulong i = 0; i < n_features; ++i) {
+    if (!common::CheckNAN(row[i]) && row[i] != missing) {
+      entries.emplace_back(static_cast<bst_feature_t>(i), row[i]);
+    }
+  }
+  PredictRowImpl(handle, entries, option_mask, ntree_limit, out_result, out_size, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCSRRow(BoosterHandle handle,
+                                       const unsigned *indices,
+                                       const float *values,
+                                       xgboost::bst_ulong nnz,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       float *out_result,
+                                       xgboost::bst_ulong out_size,
+                                       xgboost::bst_ulong *out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::vector<Entry>& entries = XGBAPIThreadLocalStore::Get()->tmp_row;
+  entries.clear();
+  for (xgboost::bst_ulong i = 0; i < nnz; ++i) {
+    if (!common::CheckNAN(values[i])) {
+      entries.emplace_back(indices[i], values[i]);
+    }
+  }
+  PredictRowImpl(handle, entries, option_mask, ntree_limit, out_result, out_size, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterCreatePredictionBatcher(BoosterHandle handle,
+                                             unsigned window_us,
+                                             xgboost::bst_ulong max_batch,
+                                             int option_mask,
+                                             unsigned ntree_limit,
+                                             PredictionBatcherHandle *out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "Batched prediction only supports normal and margin prediction.";
+  *out = new PredictionBatcher(static_cast<Learner*>(handle),
+                               std::chrono::microseconds(window_us),
+                               static_cast<size_t>(max_batch), (option_mask & 1) != 0,
+                               ntree_limit);
+  API_END();
+}
+
+XGB_DLL int XGPredictionBatcherFree(PredictionBatcherHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<PredictionBatcher*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGPredictionBatcherSubmitDenseRow(PredictionBatcherHandle handle,
+                                              const float *row,
+                                              xgboost::bst_ulong n_features,
+                                              float missing,
+                                              float *out_result,
+                                              xgboost::bst_ulong out_size,
+                                              PredictionTicketHandle *out_ticket) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::vector<Entry>& entries = XGBAPIThreadLocalStore::Get()->tmp_row;
+  entries.clear();
+  for (xgboost::bst_ulong i = 0; i < n_features; ++i) {
+    if (!common::CheckNAN(row[i]) && row[i] != missing) {
+      entries.emplace_back(static_cast<bst_feature_t>(i), row[i]);
+    }
+  }
+  *out_ticket = static_cast<PredictionBatcher*>(handle)->Submit(
+      common::Span<Entry const>(entries.data(), entries.size()),
+      common::Span<float>(out_result, out_size)).release();
+  API_END();
+}
+
+XGB_DLL int XGPredictionBatcherSubmitCSRRow(PredictionBatcherHandle handle,
+                                            const unsigned *indices,
+                                            const float *values,
+                                            xgboost::bst_ulong nnz,
+                                            float *out_result,
+                                            xgboost::bst_ulong out_size,
+                                            PredictionTicketHandle *out_ticket) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::vector<Entry>& entries = XGBAPIThreadLocalStore::Get()->tmp_row;
+  entries.clear();
+  for (xgboost::bst_ulong i = 0; i < nnz; ++i) {
+    if (!common::CheckNAN(values[i])) {
+      entries.emplace_back(indices[i], values[i]);
+    }
+  }
+  *out_ticket = static_cast<PredictionBatcher*>(handle)->Submit(
+      common::Span<Entry const>(entries.data(), entries.size()),
+      common::Span<float>(out_result, out_size)).release();
+  API_END();
+}
+
+XGB_DLL int XGPredictionTicketDone(PredictionTicketHandle handle, int *out_done) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  *out_done = static_cast<PredictionBatcher::Ticket*>(handle)->Done() ? 1 : 0;
+  API_END();
+}
+
+XGB_DLL int XGPredictionTicketWait(PredictionTicketHandle handle,
+                                   xgboost::bst_ulong *out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::unique_ptr<PredictionBatcher::Ticket> ticket {
+    static_cast<PredictionBatcher::Ticket*>(handle)};
+  *out_len = static_cast<xgboost::bst_ulong>(ticket->Wait());
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -474,8 +1287,13 @@ XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
     auto str = common::LoadSequentialFile(fname);
     CHECK_GT(str.size(), 2);
     CHECK_EQ(str[0], '{');
-    Json in { Json::Load({str.c_str(), str.size()}) };
+    Json in { Json::Load({str.c_str(), str.size()}, true) };
     static_cast<Learner*>(handle)->LoadModel(in);
+  } else if (common::FileExtension(fname) == "ubj") {
+    auto str = common::LoadSequentialFile(fname);
+    CHECK(IsUBJObject(str.c_str(), str.size())) << "Invalid UBJSON model file: " << fname;
+    UBJReader reader{StringView{str.c_str(), str.size()}};
+    static_cast<Learner*>(handle)->LoadModel(Json::Load(&reader));
   } else {
     std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
     static_cast<Learner*>(handle)->LoadModel(fi.get());
@@ -495,6 +1313,13 @@ XGB_DLL int XGBoosterSaveModel(BoosterHandle handle, const char* c_fname) {
     std::string str;
     Json::Dump(out, &str);
     fo->Write(str.c_str(), str.size());
+  } else if (common::FileExtension(c_fname) == "ubj") {
+    Json out { Object() };
+    learner->SaveModel(&out);
+    std::string str;
+    UBJWriter writer{&str};
+    writer.Save(out);
+    fo->Write(str.c_str(), str.size());
   } else {
     auto *bst = static_cast<Learner*>(handle);
     bst->SaveModel(fo.get());
@@ -502,6 +1327,46 @@ XGB_DLL int XGBoosterSaveModel(BoosterHandle handle, const char* c_fname) {
   API_END();
 }
 
+XGB_DLL int XGBoosterSaveFlatModel(BoosterHandle handle, const char* c_fname) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(c_fname, "w"));
+  static_cast<Learner*>(handle)->SaveFlatModel(fo.get());
+  API_END();
+}
+
+XGB_DLL int XGFlatModelLoad(const char* c_fname, FlatModelHandle* out) {
+  API_BEGIN();
+  *out = predictor::FlatModel::Load(c_fname);
+  API_END();
+}
+
+XGB_DLL int XGFlatModelFree(FlatModelHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<predictor::FlatModel*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGFlatModelPredict(FlatModelHandle handle,
+                               DMatrixHandle dmat,
+                               int output_margin,
+                               xgboost::bst_ulong *len,
+                               const bst_float **out_result) {
+  std::vector<bst_float>& preds =
+      XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *model = static_cast<predictor::FlatModel*>(handle);
+  HostDeviceVector<bst_float> tmp_preds;
+  model->Predict(static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(), output_margin != 0,
+                 &tmp_preds);
+  preds = std::move(tmp_preds.HostVector());
+  *out_result = dmlc::BeginPtr(preds);
+  *len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModelFromBuffer(BoosterHandle handle,
                                          const void* buf,
                                          xgboost::bst_ulong len) {
@@ -583,6 +1448,25 @@ XGB_DLL int XGBoosterSaveRabitCheckpoint(BoosterHandle handle) {
   API_END();
 }
 
+XGB_DLL int XGBoosterAppendCheckpoint(BoosterHandle handle, const char* fname) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname, "a"));
+  static_cast<Learner*>(handle)->SaveCheckpointSegment(fo.get());
+  API_END();
+}
+
+XGB_DLL int XGBoosterLoadCheckpoint(BoosterHandle handle, const char* fname,
+                                    xgboost::bst_ulong* out_n_segments) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Learner*>(handle);
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
+  *out_n_segments = static_cast<xgboost::bst_ulong>(bst->LoadCheckpoint(fi.get()));
+  bst->Configure();
+  API_END();
+}
+
 inline void XGBoostDumpModelImpl(
     BoosterHandle handle,
     const FeatureMap& fmap,
@@ -611,6 +1495,17 @@ XGB_DLL int XGBoosterDumpModel(BoosterHandle handle,
   return XGBoosterDumpModelEx(handle, fmap, with_stats, "text", len, out_models);
 }
 
+inline FeatureMap LoadFeatureMap(const char* fmap) {
+  FeatureMap featmap;
+  if (strlen(fmap) != 0) {
+    std::unique_ptr<dmlc::Stream> fs(
+        dmlc::Stream::Create(fmap, "r"));
+    dmlc::istream is(fs.get());
+    featmap.LoadText(is);
+  }
+  return featmap;
+}
+
 XGB_DLL int XGBoosterDumpModelEx(BoosterHandle handle,
                                  const char* fmap,
                                  int with_stats,
@@ -619,17 +1514,46 @@ XGB_DLL int XGBoosterDumpModelEx(BoosterHandle handle,
                                  const char*** out_models) {
   API_BEGIN();
   CHECK_HANDLE();
-  FeatureMap featmap;
-  if (strlen(fmap) != 0) {
-    std::unique_ptr<dmlc::Stream> fs(
-        dmlc::Stream::Create(fmap, "r"));
-    dmlc::istream is(fs.get());
-    featmap.LoadText(is);
-  }
+  FeatureMap featmap = LoadFeatureMap(fmap);
   XGBoostDumpModelImpl(handle, featmap, with_stats, format, len, out_models);
   API_END();
 }
 
+XGB_DLL int XGBoosterDumpModelToFile(BoosterHandle handle,
+                                     const char* fmap,
+                                     int with_stats,
+                                     const char* format,
+                                     const char* fname) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  FeatureMap featmap = LoadFeatureMap(fmap);
+  auto *bst = static_cast<Learner*>(handle);
+  bst->Configure();
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname, "w"));
+  bst->SaveDumpModel(featmap, with_stats != 0, format, fo.get());
+  API_END();
+}
+
+XGB_DLL int XGBoosterDumpModelWithCallback(BoosterHandle handle,
+                                           const char* fmap,
+                                           int with_stats,
+                                           const char* format,
+                                           XGBCallbackDumpModel* callback,
+                                           void* context) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK(callback);
+  FeatureMap featmap = LoadFeatureMap(fmap);
+  auto *bst = static_cast<Learner*>(handle);
+  bst->Configure();
+  bst->StreamDumpModel(featmap, with_stats != 0, format,
+                       [&](size_t i, std::string const& dump) {
+    CHECK_EQ(callback(context, static_cast<xgboost::bst_ulong>(i), dump.c_str()), 0)
+        << "Dumping the model is stopped by the callback at booster " << i;
+  });
+  API_END();
+}
+
 XGB_DLL int XGBoosterDumpModelWithFeatures(BoosterHandle handle,
                                            int fnum,
                                            const char** fname,
@@ -1,11 +1,104 @@
 // Copyright (c) 2014-2019 by Contributors
 
+#include <cstring>
+#include <memory>
+
 #include "xgboost/data.h"
 #include "xgboost/c_api.h"
+#include "xgboost/learner.h"
 #include "c_api_error.h"
+#include "c_api_utils.h"
 #include "../data/device_adapter.cuh"
+#include "../common/device_helpers.cuh"
 
 namespace xgboost {
+namespace {
+/*! \brief Memory resource forwarding to callbacks registered through the C API. */
+class CallbackMemoryResource : public dh::DeviceMemoryResource {
+ public:
+  CallbackMemoryResource(void* (*allocate)(size_t, void*, void*),
+                         void (*deallocate)(void*, size_t, void*, void*),
+                         void* context)
+      : allocate_{allocate}, deallocate_{deallocate}, context_{context} {}
+  void* Allocate(size_t bytes, cudaStream_t stream) override {
+    void* ptr = allocate_(bytes, stream, context_);
+    CHECK(ptr || bytes == 0) << "External allocator failed to allocate " << bytes << " bytes.";
+    return ptr;
+  }
+  void Deallocate(void* ptr, size_t bytes, cudaStream_t stream) override {
+    deallocate_(ptr, bytes, stream, context_);
+  }
+
+ private:
+  void* (*allocate_)(size_t, void*, void*);
+  void (*deallocate_)(void*, size_t, void*, void*);
+  void* context_;
+};
+}  // anonymous namespace
+
+void CopyGradientPairs(void const* data, size_t n, HostDeviceVector<GradientPair>* out_gpair) {
+  int32_t device {-1};
+  if (!dh::IsDevicePointer(data, &device)) {
+    out_gpair->Resize(n);
+    std::memcpy(out_gpair->HostPointer(), data, n * sizeof(GradientPair));
+    return;
+  }
+  dh::safe_cuda(cudaSetDevice(device));
+  out_gpair->SetDevice(device);
+  out_gpair->Resize(n);
+  dh::safe_cuda(cudaMemcpyAsync(out_gpair->DevicePointer(), data, n * sizeof(GradientPair),
+                                cudaMemcpyDeviceToDevice));
+}
+
+void CopyPredictions(HostDeviceVector<float> const& preds, void* out) {
+  size_t const n_bytes = preds.Size() * sizeof(float);
+  if (n_bytes == 0) {
+    return;
+  }
+  int32_t device {-1};
+  if (preds.DeviceIdx() >= 0 && preds.DeviceCanRead()) {
+    // into host or device memory, wherever `out' is
+    dh::safe_cuda(cudaSetDevice(preds.DeviceIdx()));
+    dh::safe_cuda(cudaMemcpy(out, preds.ConstDevicePointer(), n_bytes, cudaMemcpyDefault));
+  } else if (dh::IsDevicePointer(out, &device)) {
+    dh::safe_cuda(cudaSetDevice(device));
+    dh::safe_cuda(cudaMemcpy(out, preds.ConstHostPointer(), n_bytes,
+                             cudaMemcpyHostToDevice));
+  } else {
+    std::memcpy(out, preds.ConstHostPointer(), n_bytes);
+  }
+}
+
+XGB_DLL int XGBSetGPUAllocator(void* (*allocate)(size_t, void*, void*),
+                               void (*deallocate)(void*, size_t, void*, void*),
+                               void* context) {
+  API_BEGIN();
+  CHECK_EQ(allocate == nullptr, deallocate == nullptr)
+      << "Both or neither of the allocation callbacks must be set.";
+  std::shared_ptr<dh::DeviceMemoryResource> resource;
+  if (allocate != nullptr) {
+    resource.reset(new CallbackMemoryResource(allocate, deallocate, context));
+  }
+  dh::SetDeviceMemoryResource(resource);
+  API_END();
+}
+
+XGB_DLL int XGBSetGPUMemoryPoolSize(bst_ulong max_cached_bytes) {
+  API_BEGIN();
+  dh::SetMemoryPoolSize(max_cached_bytes);
+  API_END();
+}
+
+XGB_DLL int XGBSetGPUManagedMemory(int enable) {
+  API_BEGIN();
+  std::shared_ptr<dh::DeviceMemoryResource> resource;
+  if (enable != 0) {
+    resource.reset(new dh::ManagedMemoryResource());
+  }
+  dh::SetDeviceMemoryResource(resource);
+  API_END();
+}
+
 XGB_DLL int XGDMatrixCreateFromArrayInterfaceColumns(char const* c_json_strs,
                                                      bst_float missing,
                                                      int nthread,
@@ -29,4 +122,19 @@ XGB_DLL int XGDMatrixCreateFromArrayInterface(char const* c_json_strs,
   API_END();
 }
 
+XGB_DLL int XGBoosterPredictFromCudaArray(BoosterHandle handle,
+                                          char const* c_array_interface,
+                                          float missing,
+                                          int option_mask,
+                                          unsigned ntree_limit,
+                                          bst_ulong *out_len,
+                                          const float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::shared_ptr<data::CupyAdapter> x {new data::CupyAdapter(c_array_interface)};
+  InplacePredictImpl(static_cast<Learner*>(handle), x, missing, option_mask, ntree_limit,
+                     out_len, out_result);
+  API_END();
+}
+
 }  // namespace xgboost
@@ -0,0 +1,39 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file c_api_utils.h
+ * \brief Helpers shared by the host and the CUDA parts of the C API.
+ */
+#ifndef XGBOOST_C_API_C_API_UTILS_H_
+#define XGBOOST_C_API_C_API_UTILS_H_
+
+#include <dmlc/any.h>
+
+#include <cstddef>
+
+#include "xgboost/base.h"
+#include "xgboost/host_device_vector.h"
+
+namespace xgboost {
+class Learner;
+/*!
+ * \brief Copy `n' interleaved float32 (gradient, hessian) pairs at `data' into
+ *  `out_gpair' with a single memcpy.  In CUDA builds a device pointer is copied on its
+ *  own device and `out_gpair' is left there, without a round-trip through the host.
+ */
+void CopyGradientPairs(void const* data, size_t n, HostDeviceVector<GradientPair>* out_gpair);
+/*!
+ * \brief Copy `preds' into the caller owned buffer `out' with a single memcpy.  In CUDA
+ *  builds predictions kept on device are copied from there, and `out' may be a device
+ *  pointer, so device predictions never go through the host.
+ */
+void CopyPredictions(HostDeviceVector<float> const& preds, void* out);
+/*!
+ * \brief Inplace prediction of the C API on adapter `x', the result is a host pointer
+ *  for host adapters and a device pointer for device adapters.
+ */
+void InplacePredictImpl(Learner* learner, dmlc::any const& x, float missing,
+                        int option_mask, unsigned ntree_limit, bst_ulong* out_len,
+                        float const** out_result);
+}  // namespace xgboost
+
+#endif  // XGBOOST_C_API_C_API_UTILS_H_
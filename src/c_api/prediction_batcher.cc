@@ -0,0 +1,140 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file prediction_batcher.cc
+ */
+#include <dmlc/logging.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "xgboost/host_device_vector.h"
+#include "xgboost/learner.h"
+
+#include "prediction_batcher.h"
+#include "../data/adapter.h"
+
+namespace xgboost {
+
+size_t PredictionBatcher::Ticket::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return done_; });
+  if (!error_.empty()) {
+    LOG(FATAL) << error_;
+  }
+  return out_len_;
+}
+
+bool PredictionBatcher::Ticket::Done() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return done_;
+}
+
+void PredictionBatcher::Ticket::Complete(common::Span<float const> preds,
+                                         std::string const& error) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!error.empty()) {
+    error_ = error;
+  } else if (out_.size() < preds.size()) {
+    error_ = "Output buffer is smaller than the number of output groups.";
+  } else {
+    std::copy(preds.cbegin(), preds.cend(), out_.begin());
+    out_len_ = preds.size();
+  }
+  done_ = true;
+  // The owner may free the ticket once the lock is released.
+  cv_.notify_all();
+}
+
+PredictionBatcher::PredictionBatcher(Learner* learner, std::chrono::microseconds window,
+                                     size_t max_batch, bool output_margin,
+                                     unsigned ntree_limit)
+    : learner_{learner}, window_{window}, max_batch_{std::max(max_batch, size_t(1))},
+      output_margin_{output_margin}, ntree_limit_{ntree_limit} {
+  CHECK(learner_);
+  worker_ = std::thread([this]() { this->Loop(); });
+}
+
+PredictionBatcher::~PredictionBatcher() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  worker_.join();
+}
+
+std::unique_ptr<PredictionBatcher::Ticket> PredictionBatcher::Submit(
+    common::Span<Entry const> row, common::Span<float> out) {
+  std::unique_ptr<Ticket> ticket {new Ticket};
+  ticket->out_ = out;
+  bool notify {false};
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    CHECK(!stop_) << "Prediction batcher is stopped.";
+    if (queue_.tickets.empty()) {
+      first_arrival_ = std::chrono::steady_clock::now();
+      notify = true;
+    }
+    for (auto const& e : row) {
+      queue_.indices.push_back(e.index);
+      queue_.values.push_back(e.fvalue);
+    }
+    queue_.indptr.push_back(queue_.values.size());
+    queue_.tickets.push_back(ticket.get());
+    notify = notify || queue_.tickets.size() >= max_batch_;
+  }
+  if (notify) {
+    cv_.notify_all();
+  }
+  return ticket;
+}
+
+void PredictionBatcher::Loop() {
+  Queue batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || !queue_.tickets.empty(); });
+      if (queue_.tickets.empty()) {
+        return;  // stopped with nothing pending
+      }
+      cv_.wait_until(lock, first_arrival_ + window_, [this]() {
+        return stop_ || queue_.tickets.size() >= max_batch_;
+      });
+      std::swap(batch, queue_);
+      queue_.Clear();
+    }
+    this->Predict(batch);
+  }
+}
+
+void PredictionBatcher::Predict(Queue const& batch) const {
+  auto const n_rows = batch.tickets.size();
+  size_t n_cols {0};
+  for (auto fidx : batch.indices) {
+    n_cols = std::max(n_cols, static_cast<size_t>(fidx) + 1);
+  }
+  std::string error;
+  HostDeviceVector<bst_float>* p_preds {nullptr};
+  try {
+    std::shared_ptr<data::CSRAdapter> x {new data::CSRAdapter(
+        batch.indptr.data(), batch.indices.data(), batch.values.data(), n_rows,
+        batch.values.size(), n_cols)};
+    learner_->InplacePredict(x, output_margin_, std::numeric_limits<float>::quiet_NaN(),
+                             &p_preds, ntree_limit_);
+  } catch (dmlc::Error const& e) {
+    error = e.what();
+  }
+  common::Span<float const> preds;
+  size_t n_groups {0};
+  if (error.empty()) {
+    auto const& h_preds = p_preds->ConstHostVector();
+    preds = {h_preds.data(), h_preds.size()};
+    n_groups = preds.size() / n_rows;
+  }
+  for (size_t i = 0; i < n_rows; ++i) {
+    batch.tickets[i]->Complete(
+        error.empty() ? preds.subspan(i * n_groups, n_groups) : preds, error);
+  }
+}
+}  // namespace xgboost
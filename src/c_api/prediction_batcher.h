@@ -0,0 +1,103 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file prediction_batcher.h
+ * \brief Coalesce concurrent single row predictions into batches.
+ */
+#ifndef XGBOOST_C_API_PREDICTION_BATCHER_H_
+#define XGBOOST_C_API_PREDICTION_BATCHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xgboost/base.h"
+#include "xgboost/data.h"
+#include "xgboost/span.h"
+
+namespace xgboost {
+class Learner;
+/*!
+ * \brief Micro-batching front end of inplace prediction for online serving.
+ *
+ *  Rows submitted from any thread are copied into a queue.  A worker thread waits at
+ *  most `window' after the first queued row, or until `max_batch' rows are queued, then
+ *  predicts the whole queue with a single inplace prediction and completes the tickets
+ *  of the rows.  The booster must outlive the batcher and must not be modified while
+ *  the batcher is in use.
+ */
+class PredictionBatcher {
+ public:
+  /*! \brief A submitted row, completed asynchronously by the worker. */
+  class Ticket {
+   public:
+    /*!
+     * \brief Block until the prediction of the row is done.
+     * \return number of values written to the output buffer of the row.
+     */
+    size_t Wait();
+    /*! \brief Whether the prediction is done, without blocking. */
+    bool Done();
+
+   private:
+    friend class PredictionBatcher;
+    void Complete(common::Span<float const> preds, std::string const& error);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ {false};
+    size_t out_len_ {0};
+    std::string error_;
+    // caller owned, written by the worker
+    common::Span<float> out_;
+  };
+
+  PredictionBatcher(Learner* learner, std::chrono::microseconds window, size_t max_batch,
+                    bool output_margin, unsigned ntree_limit);
+  /*! \brief Predict every pending row, then stop the worker. */
+  ~PredictionBatcher();
+
+  /*!
+   * \brief Queue one row for prediction.  The row is copied, `out' must stay valid until
+   *  the returned ticket is done.  A ticket must be waited on before it's freed.
+   */
+  std::unique_ptr<Ticket> Submit(common::Span<Entry const> row, common::Span<float> out);
+
+ private:
+  // Rows in CSR format along with their tickets.
+  struct Queue {
+    std::vector<size_t> indptr {0};
+    std::vector<unsigned> indices;
+    std::vector<float> values;
+    std::vector<Ticket*> tickets;
+
+    void Clear() {
+      indptr.resize(1);
+      indices.clear();
+      values.clear();
+      tickets.clear();
+    }
+  };
+
+  void Loop();
+  void Predict(Queue const& batch) const;
+
+  Learner* learner_;
+  std::chrono::microseconds window_;
+  size_t max_batch_;
+  bool output_margin_;
+  unsigned ntree_limit_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  Queue queue_;
+  std::chrono::steady_clock::time_point first_arrival_;
+  bool stop_ {false};
+  std::thread worker_;
+};
+}  // namespace xgboost
+
+#endif  // XGBOOST_C_API_PREDICTION_BATCHER_H_
@@ -13,10 +13,15 @@
 #include <xgboost/data.h>
 #include <xgboost/logging.h>
 #include <xgboost/parameter.h>
+#include <xgboost/json.h>
 
+#include <dmlc/omp.h>
 #include <dmlc/timer.h>
+#include <algorithm>
 #include <iomanip>
 #include <ctime>
+#include <future>
+#include <sstream>
 #include <string>
 #include <cstdio>
 #include <cstring>
@@ -29,7 +34,9 @@ namespace xgboost {
 enum CLITask {
   kTrain = 0,
   kDumpModel = 1,
-  kPredict = 2
+  kPredict = 2,
+  kPredictModels = 3,
+  kCompactModel = 4
 };
 
 struct CLIParam : public XGBoostParameter<CLIParam> {
@@ -51,8 +58,18 @@ struct CLIParam : public XGBoostParameter<CLIParam> {
   std::string model_out;
   /*! \brief the path of directory containing the saved models */
   std::string model_dir;
+  /*! \brief the path of the training cache saved with the final model */
+  std::string train_cache;
+  /*! \brief the path of the training cache with quantized data kept by each worker */
+  std::string worker_cache;
   /*! \brief name of predict file */
   std::string name_pred;
+  /*! \brief the path of the list of models to predict with */
+  std::string model_list;
+  /*! \brief format of the prediction files of pred_models */
+  std::string pred_format;
+  /*! \brief number of models predicting at the same time */
+  int model_threads;
   /*! \brief data split mode */
   int dsplit;
   /*!\brief limit number of trees in prediction */
@@ -67,6 +84,8 @@ struct CLIParam : public XGBoostParameter<CLIParam> {
   std::string name_fmap;
   /*! \brief name of dump file */
   std::string name_dump;
+  /*! \brief number of threads used for loading text data */
+  int nthread;
   /*! \brief the paths of validation data sets */
   std::vector<std::string> eval_data_paths;
   /*! \brief the names of the evaluation data used in output log */
@@ -81,6 +100,8 @@ struct CLIParam : public XGBoostParameter<CLIParam> {
         .add_enum("train", kTrain)
         .add_enum("dump", kDumpModel)
         .add_enum("pred", kPredict)
+        .add_enum("pred_models", kPredictModels)
+        .add_enum("compact", kCompactModel)
         .describe("Task to be performed by the CLI program.");
     DMLC_DECLARE_FIELD(eval_train).set_default(false)
         .describe("Whether evaluate on training data during training.");
@@ -98,8 +119,23 @@ struct CLIParam : public XGBoostParameter<CLIParam> {
         .describe("Output model path, if any.");
     DMLC_DECLARE_FIELD(model_dir).set_default("./")
         .describe("Output directory of period checkpoint.");
+    DMLC_DECLARE_FIELD(train_cache).set_default("NULL")
+        .describe("Path of the training prediction margins and histogram cuts, saved with "
+                  "the final model and restored when training continues from model_in.");
+    DMLC_DECLARE_FIELD(worker_cache).set_default("NULL")
+        .describe("Path of a training cache with the quantized training data, saved by "
+                  "each worker after its first round with the rank appended in distributed "
+                  "training, and restored by a worker restarted after a failure.");
     DMLC_DECLARE_FIELD(name_pred).set_default("pred.txt")
         .describe("Name of the prediction file.");
+    DMLC_DECLARE_FIELD(model_list).set_default("NULL")
+        .describe("Path of a file listing the models for pred_models, one per line and "
+                  "optionally followed by the path of its predictions.");
+    DMLC_DECLARE_FIELD(pred_format).set_default("text")
+        .describe("Format of the predictions of pred_models, text or binary float32.");
+    DMLC_DECLARE_FIELD(model_threads).set_default(0).set_lower_bound(0)
+        .describe("Number of models predicting at the same time in pred_models, 0 to share "
+                  "the threads with one model for each.");
     DMLC_DECLARE_FIELD(dsplit).set_default(0)
         .add_enum("auto", 0)
         .add_enum("col", 1)
@@ -117,6 +153,8 @@ struct CLIParam : public XGBoostParameter<CLIParam> {
         .describe("Name of the feature map file.");
     DMLC_DECLARE_FIELD(name_dump).set_default("dump.txt")
         .describe("Name of the output dump text file.");
+    DMLC_DECLARE_FIELD(nthread).set_default(0).set_lower_bound(0)
+        .describe("Number of threads used for loading text data, 0 for all available.");
     // alias
     DMLC_DECLARE_ALIAS(train_path, data);
     DMLC_DECLARE_ALIAS(test_path, test:data);
@@ -162,7 +200,7 @@ void CLITrain(const CLIParam& param) {
       DMatrix::Load(
           param.train_path,
           ConsoleLogger::GlobalVerbosity() > ConsoleLogger::DefaultVerbosity(),
-          param.dsplit == 2));
+          param.dsplit == 2, "auto", DMatrix::kPageSize, param.nthread));
   std::vector<std::shared_ptr<DMatrix> > deval;
   std::vector<std::shared_ptr<DMatrix> > cache_mats;
   std::vector<std::shared_ptr<DMatrix>> eval_datasets;
@@ -172,7 +210,7 @@ void CLITrain(const CLIParam& param) {
         std::shared_ptr<DMatrix>(DMatrix::Load(
             param.eval_data_paths[i],
             ConsoleLogger::GlobalVerbosity() > ConsoleLogger::DefaultVerbosity(),
-            param.dsplit == 2)));
+            param.dsplit == 2, "auto", DMatrix::kPageSize, param.nthread)));
     eval_datasets.push_back(deval.back());
     cache_mats.push_back(deval.back());
   }
@@ -191,12 +229,48 @@ void CLITrain(const CLIParam& param) {
           dmlc::Stream::Create(param.model_in.c_str(), "r"));
       learner->Load(fi.get());
       learner->SetParams(param.cfg);
+      std::unique_ptr<dmlc::Stream> fc;
+      if (param.train_cache != "NULL" && !rabit::IsDistributed()) {
+        fc.reset(dmlc::Stream::Create(param.train_cache.c_str(), "r", true));
+      }
+      if (fc && learner->LoadTrainingCache(dtrain, fc.get())) {
+        LOG(INFO) << "Restored training cache from " << param.train_cache;
+      }
     } else {
       learner->SetParams(param.cfg);
     }
   }
+  // A worker restarted after a failure skips sketching and quantizing its data again.
+  std::string worker_cache;
+  bool worker_cache_saved = false;
+  if (param.worker_cache != "NULL") {
+    worker_cache = param.worker_cache;
+    if (rabit::IsDistributed()) {
+      worker_cache += "." + std::to_string(rabit::GetRank());
+    }
+    std::unique_ptr<dmlc::Stream> fc(dmlc::Stream::Create(worker_cache.c_str(), "r", true));
+    if (fc) {
+      learner->LoadTrainingCache(dtrain, fc.get());
+      int32_t max_bin {0};
+      worker_cache_saved = dtrain->GHistIndexPage(&max_bin) != nullptr;
+      if (worker_cache_saved) {
+        LOG(INFO) << "Restored quantized training data from " << worker_cache;
+      }
+    }
+  }
   LOG(INFO) << "Loading data: " << dmlc::GetTime() - tstart_data_load << " sec";
 
+  auto report = [](std::string const& res) {
+    if (rabit::IsDistributed()) {
+      if (rabit::GetRank() == 0) {
+        LOG(TRACKER) << res;
+      }
+    } else {
+      LOG(CONSOLE) << res;
+    }
+  };
+  // The metrics of a round are evaluated while the next round is trained.
+  std::shared_future<std::string> pending_eval;
   // start training.
   const double start = dmlc::GetTime();
   for (int i = version / 2; i < param.num_round; ++i) {
@@ -204,6 +278,11 @@ void CLITrain(const CLIParam& param) {
     if (version % 2 == 0) {
       LOG(INFO) << "boosting round " << i << ", " << elapsed << " sec elapsed";
       learner->UpdateOneIter(i, dtrain);
+      if (!worker_cache.empty() && !worker_cache_saved) {
+        std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(worker_cache.c_str(), "w"));
+        learner->SaveTrainingCache(dtrain, fo.get(), true);
+        worker_cache_saved = true;
+      }
       if (learner->AllowLazyCheckPoint()) {
         rabit::LazyCheckPoint(learner.get());
       } else {
@@ -212,14 +291,10 @@ void CLITrain(const CLIParam& param) {
       version += 1;
     }
     CHECK_EQ(version, rabit::VersionNumber());
-    std::string res = learner->EvalOneIter(i, eval_datasets, eval_data_names);
-    if (rabit::IsDistributed()) {
-      if (rabit::GetRank() == 0) {
-        LOG(TRACKER) << res;
-      }
-    } else {
-      LOG(CONSOLE) << res;
+    if (pending_eval.valid()) {
+      report(pending_eval.get());
     }
+    pending_eval = learner->EvalOneIterAsync(i, eval_datasets, eval_data_names);
     if (param.save_period != 0 &&
         (i + 1) % param.save_period == 0 &&
         rabit::GetRank() == 0) {
@@ -240,6 +315,9 @@ void CLITrain(const CLIParam& param) {
     version += 1;
     CHECK_EQ(version, rabit::VersionNumber());
   }
+  if (pending_eval.valid()) {
+    report(pending_eval.get());
+  }
   LOG(INFO) << "Complete Training loop time: " << dmlc::GetTime() - start << " sec";
   // always save final round
   if ((param.save_period == 0 || param.num_round % param.save_period != 0) &&
@@ -257,6 +335,11 @@ void CLITrain(const CLIParam& param) {
         dmlc::Stream::Create(os.str().c_str(), "w"));
     learner->Save(fo.get());
   }
+  if (param.train_cache != "NULL" && !rabit::IsDistributed()) {
+    std::unique_ptr<dmlc::Stream> fo(
+        dmlc::Stream::Create(param.train_cache.c_str(), "w"));
+    learner->SaveTrainingCache(dtrain, fo.get(), false);
+  }
 
   double elapsed = dmlc::GetTime() - start;
   LOG(INFO) << "update end, " << elapsed << " sec in all";
@@ -278,27 +361,35 @@ void CLIDumpModel(const CLIParam& param) {
       dmlc::Stream::Create(param.model_in.c_str(), "r"));
   learner->SetParams(param.cfg);
   learner->Load(fi.get());
-  // dump data
-  std::vector<std::string> dump = learner->DumpModel(
-      fmap, param.dump_stats, param.dump_format);
+  // dump data, one batch of trees at a time
   std::unique_ptr<dmlc::Stream> fo(
       dmlc::Stream::Create(param.name_dump.c_str(), "w"));
-  dmlc::ostream os(fo.get());
-  if (param.dump_format == "json") {
-    os << "[" << std::endl;
-    for (size_t i = 0; i < dump.size(); ++i) {
-      if (i != 0) os << "," << std::endl;
-      os << dump[i];  // Dump the previously generated JSON here
-    }
-    os << std::endl << "]" << std::endl;
-  } else {
-    for (size_t i = 0; i < dump.size(); ++i) {
-      os << "booster[" << i << "]:\n";
-      os << dump[i];
-    }
-  }
-  // force flush before fo destruct.
-  os.set_stream(nullptr);
+  learner->SaveDumpModel(fmap, param.dump_stats, param.dump_format, fo.get());
+}
+
+void CLICompactModel(const CLIParam& param) {
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for compact";
+  CHECK_NE(param.model_out, "NULL")
+      << "Must specify model_out for compact";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  std::unique_ptr<dmlc::Stream> fi(
+      dmlc::Stream::Create(param.model_in.c_str(), "r"));
+  learner->Load(fi.get());
+  learner->SetParams(param.cfg);
+
+  Json report { Object() };
+  learner->Compact(&report);
+  LOG(CONSOLE) << "nodes: " << get<Integer const>(report["num_nodes_before"]) << " -> "
+               << get<Integer const>(report["num_nodes_after"])
+               << ", folded splits: " << get<Integer const>(report["folded_splits"])
+               << ", bytes: " << get<Integer const>(report["bytes_before"]) << " -> "
+               << get<Integer const>(report["bytes_after"])
+               << ", used features: " << get<Array const>(report["used_features"]).size()
+               << " of " << get<Integer const>(report["num_feature"]);
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.model_out.c_str(), "w"));
+  learner->Save(fo.get());
 }
 
 void CLIPredict(const CLIParam& param) {
@@ -309,7 +400,7 @@ void CLIPredict(const CLIParam& param) {
       DMatrix::Load(
           param.test_path,
           ConsoleLogger::GlobalVerbosity() > ConsoleLogger::DefaultVerbosity(),
-          param.dsplit == 2));
+          param.dsplit == 2, "auto", DMatrix::kPageSize, param.nthread));
   // load model
   CHECK_NE(param.model_in, "NULL")
       << "Must specify model_in for predict";
@@ -335,6 +426,110 @@ void CLIPredict(const CLIParam& param) {
   os.set_stream(nullptr);
 }
 
+/*!
+ * \brief Write predictions to `fname', formatting them in memory first so there's a single
+ *  write for each file.
+ */
+void WritePredictions(std::vector<bst_float> const& preds, std::string const& fname,
+                      std::string const& format) {
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+  if (format == "binary") {
+    fo->Write(preds.data(), preds.size() * sizeof(bst_float));
+    return;
+  }
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<bst_float>::max_digits10);
+  for (bst_float p : preds) {
+    os << p << '\n';
+  }
+  auto str = os.str();
+  fo->Write(str.data(), str.size());
+}
+
+void CLIPredictModels(const CLIParam& param) {
+  CHECK_NE(param.test_path, "NULL")
+      << "Test dataset parameter test:data must be specified.";
+  CHECK_NE(param.model_list, "NULL")
+      << "Must specify model_list for pred_models";
+  CHECK(param.pred_format == "text" || param.pred_format == "binary")
+      << "Unknown prediction format: " << param.pred_format;
+  std::vector<std::string> model_paths, pred_paths;
+  {
+    std::unique_ptr<dmlc::Stream> fs(dmlc::Stream::Create(param.model_list.c_str(), "r"));
+    dmlc::istream is(fs.get());
+    std::string line;
+    while (std::getline(is, line)) {
+      std::istringstream ls(line);
+      std::string model, pred;
+      if (!(ls >> model)) {
+        continue;
+      }
+      if (!(ls >> pred)) {
+        pred = model + ".pred";
+      }
+      model_paths.push_back(model);
+      pred_paths.push_back(pred);
+    }
+  }
+  CHECK(!model_paths.empty()) << "No model is listed in " << param.model_list;
+
+  // The data is loaded once for all the models.  Binary data saved with alignment is
+  // memory mapped by the loader.
+  std::shared_ptr<DMatrix> dtest(
+      DMatrix::Load(
+          param.test_path,
+          ConsoleLogger::GlobalVerbosity() > ConsoleLogger::DefaultVerbosity(),
+          param.dsplit == 2, "auto", DMatrix::kPageSize, param.nthread));
+  // Models are configured here, so predicting touches no state shared between them.
+  std::vector<std::unique_ptr<Learner>> learners(model_paths.size());
+  for (size_t i = 0; i < model_paths.size(); ++i) {
+    learners[i].reset(Learner::Create({}));
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(model_paths[i].c_str(), "r"));
+    learners[i]->Load(fi.get());
+    learners[i]->SetParams(param.cfg);
+    learners[i]->Configure();
+  }
+
+  LOG(INFO) << "start prediction with " << learners.size() << " models...";
+  const double start = dmlc::GetTime();
+  int const n_threads = omp_get_max_threads();
+  auto n_groups = static_cast<omp_ulong>(
+      param.model_threads == 0 ? std::min<size_t>(learners.size(), n_threads)
+                               : std::min<size_t>(learners.size(), param.model_threads));
+  // Pages of external memory are read by one iterator at a time.
+  if (!dtest->SingleColBlock()) {
+    n_groups = 1;
+  }
+#if defined(_OPENMP)
+  int const max_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(max_levels, 2));
+#endif  // defined(_OPENMP)
+  dmlc::OMPException exc;
+#pragma omp parallel for num_threads(n_groups) schedule(dynamic, 1)
+  for (omp_ulong g = 0; g < n_groups; ++g) {  // NOLINT(*)
+    exc.Run([&]() {
+      // the first groups take the remaining threads
+      int const group_threads = std::max(
+          n_threads / static_cast<int>(n_groups) +
+              (static_cast<int>(g) < n_threads % static_cast<int>(n_groups)),
+          1);
+      omp_set_num_threads(group_threads);
+      HostDeviceVector<bst_float> preds;
+      for (size_t i = g; i < learners.size(); i += n_groups) {
+        learners[i]->Predict(dtest, param.pred_margin, &preds, param.ntree_limit);
+        WritePredictions(preds.ConstHostVector(), pred_paths[i], param.pred_format);
+        LOG(CONSOLE) << "wrote prediction of " << model_paths[i] << " to " << pred_paths[i];
+      }
+    });
+  }
+#if defined(_OPENMP)
+  omp_set_max_active_levels(max_levels);
+#endif  // defined(_OPENMP)
+  exc.Rethrow();
+  LOG(INFO) << "prediction with " << learners.size() << " models: "
+            << dmlc::GetTime() - start << " sec";
+}
+
 int CLIRunTask(int argc, char *argv[]) {
   if (argc < 2) {
     printf("Usage: <config>\n");
@@ -359,6 +554,8 @@ int CLIRunTask(int argc, char *argv[]) {
     case kTrain: CLITrain(param); break;
     case kDumpModel: CLIDumpModel(param); break;
     case kPredict: CLIPredict(param); break;
+    case kPredictModels: CLIPredictModels(param); break;
+    case kCompactModel: CLICompactModel(param); break;
   }
   rabit::Finalize();
   return 0;
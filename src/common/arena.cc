@@ -0,0 +1,54 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file arena.cc
+ */
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "xgboost/logging.h"
+
+namespace xgboost {
+namespace common {
+void* Arena::Allocate(size_t bytes, size_t align) {
+  CHECK_NE(align, 0U);
+  CHECK_EQ(align & (align - 1), 0U) << "Alignment must be a power of 2.";
+  auto aligned = [&](Chunk const& chunk) {
+    auto addr = reinterpret_cast<uintptr_t>(chunk.data.get()) + offset_;
+    return offset_ + ((align - addr % align) % align);
+  };
+  if (chunks_.empty() || aligned(chunks_.back()) + bytes > chunks_.back().size) {
+    if (!chunks_.empty()) {
+      used_ += offset_;
+    }
+    // large requests get a chunk of their own
+    const size_t size = std::max(chunk_bytes_, bytes + align);
+    chunks_.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+    offset_ = 0;
+  }
+  const size_t begin = aligned(chunks_.back());
+  offset_ = begin + bytes;
+  return chunks_.back().data.get() + begin;
+}
+
+void Arena::Reset() {
+  if (chunks_.size() > 1) {
+    // one chunk for everything the next round allocates, if it's the same as this one
+    const size_t size = this->Capacity();
+    chunks_.clear();
+    chunks_.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+  }
+  used_ = 0;
+  offset_ = 0;
+}
+
+size_t Arena::Capacity() const {
+  size_t total {0};
+  for (auto const& chunk : chunks_) {
+    total += chunk.size;
+  }
+  return total;
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,100 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file arena.h
+ * \brief Monotonic allocation of short lived temporaries, like those of growing a tree.
+ */
+#ifndef XGBOOST_COMMON_ARENA_H_
+#define XGBOOST_COMMON_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief Memory handed out by bumping a pointer through large chunks, freed all at once by
+ *  `Reset'.  After a reset the memory is kept in a single chunk as large as everything
+ *  allocated before, so repeating the same work allocates nothing from the heap.  Not
+ *  thread safe.
+ */
+class Arena {
+ public:
+  explicit Arena(size_t chunk_bytes = kDefaultChunkBytes) : chunk_bytes_{chunk_bytes} {}
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+
+  void* Allocate(size_t bytes, size_t align);
+  /*! \brief Free everything allocated so far, memory in use must not be touched again. */
+  void Reset();
+  /*! \brief bytes allocated since the last reset, including the padding for alignment */
+  size_t Used() const { return used_ + offset_; }
+  /*! \brief bytes held by the chunks */
+  size_t Capacity() const;
+
+ private:
+  static constexpr size_t kDefaultChunkBytes = 64 * 1024;
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  size_t chunk_bytes_;
+  std::vector<Chunk> chunks_;
+  // bytes used in the chunks before the last one
+  size_t used_ {0};
+  // position in the last chunk
+  size_t offset_ {0};
+};
+
+/*!
+ * \brief Allocator drawing from an arena, or from the heap when it has none.  Memory is
+ *  only returned by `Arena::Reset', so containers using an arena must not outlive the
+ *  reset.  Copies of a container go to the heap, containers taking over the memory of
+ *  another by moving keep its arena.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;  // NOLINT
+
+  ArenaAllocator() = default;
+  explicit ArenaAllocator(Arena* arena) : arena_{arena} {}
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const& that) : arena_{that.GetArena()} {}  // NOLINT
+
+  T* allocate(size_t n) {  // NOLINT
+    if (arena_ == nullptr) {
+      return std::allocator<T>().allocate(n);
+    }
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* p, size_t n) {  // NOLINT
+    if (arena_ == nullptr) {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+  ArenaAllocator select_on_container_copy_construction() const {  // NOLINT
+    return ArenaAllocator();
+  }
+  Arena* GetArena() const { return arena_; }
+
+ private:
+  Arena* arena_ {nullptr};
+};
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+  return lhs.GetArena() == rhs.GetArena();
+}
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_ARENA_H_
@@ -0,0 +1,40 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file categorical.h
+ * \brief Helpers for the splits of categorical features.
+ */
+#ifndef XGBOOST_COMMON_CATEGORICAL_H_
+#define XGBOOST_COMMON_CATEGORICAL_H_
+
+#include <cinttypes>
+
+#include "xgboost/base.h"
+#include "xgboost/span.h"
+#include "bitfield.h"
+
+namespace xgboost {
+namespace common {
+/*! \brief Categories going to the left child of a categorical split, one bit each. */
+using CatBitField = LBitField64;
+
+/*! \brief Category of a feature value, categories are stored as floats in the data. */
+XGBOOST_DEVICE inline bst_cat_t AsCat(float fvalue) {
+  return static_cast<bst_cat_t>(fvalue);
+}
+
+/*!
+ * \brief Whether rows of category `cat' go to the left child of a categorical split.
+ *  Categories outside of the bit field, including negative ones, go right.
+ */
+XGBOOST_DEVICE inline bool Decision(common::Span<uint64_t const> cats, bst_cat_t cat) {
+  CatBitField const s_cats(
+      common::Span<uint64_t>(const_cast<uint64_t*>(cats.data()), cats.size()));
+  if (cat < 0 || static_cast<size_t>(cat) >= s_cats.Size()) {
+    return false;
+  }
+  return s_cats.Check(static_cast<CatBitField::value_type>(cat));
+}
+}  // namespace common
+}  // namespace xgboost
+
+#endif  // XGBOOST_COMMON_CATEGORICAL_H_
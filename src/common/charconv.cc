@@ -0,0 +1,466 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file charconv.cc
+ * \brief Float printing follows Ryu by Ulf Adams (https://github.com/ulfjack/ryu),
+ *  Apache License 2.0.  Parsing takes the exact Clinger fast path for
+ *  the numbers written by it and falls back to `strtof' for the rest.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "charconv.h"
+
+namespace xgboost {
+namespace common {
+constexpr size_t NumericLimits<float>::kToCharsSize;
+constexpr size_t NumericLimits<int64_t>::kToCharsSize;
+
+namespace {
+constexpr int32_t kFloatMantissaBits = 23;
+constexpr int32_t kFloatExponentBits = 8;
+constexpr int32_t kFloatBias = 127;
+constexpr int32_t kPow5InvBitCount = 59;
+constexpr int32_t kPow5BitCount = 61;
+
+// ceil(2^(bitlength(5^i) - 1 + kPow5InvBitCount) / 5^i)
+constexpr uint64_t kPow5InvSplit[] = {
+    0x0800000000000001ULL, 0x0666666666666667ULL, 0x051eb851eb851eb9ULL,
+    0x04189374bc6a7efaULL, 0x068db8bac710cb2aULL, 0x053e2d6238da3c22ULL,
+    0x0431bde82d7b634eULL, 0x06b5fca6af2bd216ULL, 0x055e63b88c230e78ULL,
+    0x044b82fa09b5a52dULL, 0x06df37f675ef6eaeULL, 0x057f5ff85e592558ULL,
+    0x0465e6604b7a8447ULL, 0x0709709a125da071ULL, 0x05a126e1a84ae6c1ULL,
+    0x0480ebe7b9d58567ULL, 0x0734aca5f6226f0bULL, 0x05c3bd5191b525a3ULL,
+    0x049c97747490eae9ULL, 0x0760f253edb4ab0eULL, 0x05e72843249088d8ULL,
+    0x04b8ed0283a6d3e0ULL, 0x078e480405d7b966ULL, 0x060b6cd004ac9452ULL,
+    0x04d5f0a66a23a9dbULL, 0x07bcb43d769f762bULL, 0x063090312bb2c4efULL,
+    0x04f3a68dbc8f03f3ULL, 0x07ec3daf94180651ULL, 0x065697bfa9acd1daULL,
+    0x051212ffbaf0a7e2ULL};
+
+// the highest kPow5BitCount bits of 5^i
+constexpr uint64_t kPow5Split[] = {
+    0x1000000000000000ULL, 0x1400000000000000ULL, 0x1900000000000000ULL,
+    0x1f40000000000000ULL, 0x1388000000000000ULL, 0x186a000000000000ULL,
+    0x1e84800000000000ULL, 0x1312d00000000000ULL, 0x17d7840000000000ULL,
+    0x1dcd650000000000ULL, 0x12a05f2000000000ULL, 0x174876e800000000ULL,
+    0x1d1a94a200000000ULL, 0x12309ce540000000ULL, 0x16bcc41e90000000ULL,
+    0x1c6bf52634000000ULL, 0x11c37937e0800000ULL, 0x16345785d8a00000ULL,
+    0x1bc16d674ec80000ULL, 0x1158e460913d0000ULL, 0x15af1d78b58c4000ULL,
+    0x1b1ae4d6e2ef5000ULL, 0x10f0cf064dd59200ULL, 0x152d02c7e14af680ULL,
+    0x1a784379d99db420ULL, 0x108b2a2c28029094ULL, 0x14adf4b7320334b9ULL,
+    0x19d971e4fe8401e7ULL, 0x1027e72f1f128130ULL, 0x1431e0fae6d7217cULL,
+    0x193e5939a08ce9dbULL, 0x1f8def8808b02452ULL, 0x13b8b5b5056e16b3ULL,
+    0x18a6e32246c99c60ULL, 0x1ed09bead87c0378ULL, 0x13426172c74d822bULL,
+    0x1812f9cf7920e2b6ULL, 0x1e17b84357691b64ULL, 0x12ced32a16a1b11eULL,
+    0x178287f49c4a1d66ULL, 0x1d6329f1c35ca4bfULL, 0x125dfa371a19e6f7ULL,
+    0x16f578c4e0a060b5ULL, 0x1cb2d6f618c878e3ULL, 0x11efc659cf7d4b8dULL,
+    0x166bb7f0435c9e71ULL, 0x1c06a5ec5433c60dULL, 0x118427b3b4a05bc8ULL};
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// bitlength(5^e) for e in [0, 3528]
+int32_t Pow5Bits(int32_t e) { return static_cast<int32_t>(((e * 1217359) >> 19) + 1); }
+// floor(log10(2^e)) for e in [0, 1650]
+uint32_t Log10Pow2(int32_t e) { return static_cast<uint32_t>((e * 78913) >> 18); }
+// floor(log10(5^e)) for e in [0, 2620]
+uint32_t Log10Pow5(int32_t e) { return static_cast<uint32_t>((e * 732923) >> 20); }
+
+uint32_t Pow5Factor(uint32_t value) {
+  uint32_t count = 0;
+  while (value % 5 == 0) {
+    value /= 5;
+    ++count;
+  }
+  return count;
+}
+bool MultipleOfPowerOf5(uint32_t value, uint32_t p) { return Pow5Factor(value) >= p; }
+bool MultipleOfPowerOf2(uint32_t value, uint32_t p) { return (value & ((1u << p) - 1)) == 0; }
+
+uint32_t MulShift(uint32_t m, uint64_t factor, int32_t shift) {
+  uint64_t const bits0 = static_cast<uint64_t>(m) * static_cast<uint32_t>(factor);
+  uint64_t const bits1 = static_cast<uint64_t>(m) * static_cast<uint32_t>(factor >> 32);
+  uint64_t const sum = (bits0 >> 32) + bits1;
+  return static_cast<uint32_t>(sum >> (shift - 32));
+}
+
+uint32_t DecimalLength(uint32_t v) {
+  uint32_t len = 1;
+  while (v >= 10) {
+    v /= 10;
+    ++len;
+  }
+  return len;
+}
+
+/*!
+ * \brief Shortest decimal `output * 10^exponent' inside the rounding interval of a
+ *  positive finite float given by its IEEE fields.
+ */
+void ShortestDecimal(uint32_t ieee_mantissa, uint32_t ieee_exponent, uint32_t* out_output,
+                     int32_t* out_exponent) {
+  int32_t e2;
+  uint32_t m2;
+  if (ieee_exponent == 0) {
+    e2 = 1 - kFloatBias - kFloatMantissaBits - 2;
+    m2 = ieee_mantissa;
+  } else {
+    e2 = static_cast<int32_t>(ieee_exponent) - kFloatBias - kFloatMantissaBits - 2;
+    m2 = (1u << kFloatMantissaBits) | ieee_mantissa;
+  }
+  bool const accept_bounds = (m2 & 1) == 0;
+
+  // The interval of the decimal representations that round to this float.
+  uint32_t const mv = 4 * m2;
+  uint32_t const mp = 4 * m2 + 2;
+  uint32_t const mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+  uint32_t const mm = 4 * m2 - 1 - mm_shift;
+
+  uint32_t vr, vp, vm;
+  int32_t e10;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  uint32_t last_removed_digit = 0;
+  if (e2 >= 0) {
+    uint32_t const q = Log10Pow2(e2);
+    e10 = static_cast<int32_t>(q);
+    int32_t const k = kPow5InvBitCount + Pow5Bits(static_cast<int32_t>(q)) - 1;
+    int32_t const i = -e2 + static_cast<int32_t>(q) + k;
+    vr = MulShift(mv, kPow5InvSplit[q], i);
+    vp = MulShift(mp, kPow5InvSplit[q], i);
+    vm = MulShift(mm, kPow5InvSplit[q], i);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      // One removed digit is needed even if the loop below doesn't run.
+      int32_t const l = kPow5InvBitCount + Pow5Bits(static_cast<int32_t>(q - 1)) - 1;
+      last_removed_digit =
+          MulShift(mv, kPow5InvSplit[q - 1], -e2 + static_cast<int32_t>(q) - 1 + l) % 10;
+    }
+    if (q <= 9) {
+      // Only one of mp, mv and mm can be a multiple of 5, if any.
+      if (mv % 5 == 0) {
+        vr_trailing_zeros = MultipleOfPowerOf5(mv, q);
+      } else if (accept_bounds) {
+        vm_trailing_zeros = MultipleOfPowerOf5(mm, q);
+      } else {
+        vp -= MultipleOfPowerOf5(mp, q);
+      }
+    }
+  } else {
+    uint32_t const q = Log10Pow5(-e2);
+    e10 = static_cast<int32_t>(q) + e2;
+    int32_t const i = -e2 - static_cast<int32_t>(q);
+    int32_t const k = Pow5Bits(i) - kPow5BitCount;
+    int32_t j = static_cast<int32_t>(q) - k;
+    vr = MulShift(mv, kPow5Split[i], j);
+    vp = MulShift(mp, kPow5Split[i], j);
+    vm = MulShift(mm, kPow5Split[i], j);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      j = static_cast<int32_t>(q) - 1 - (Pow5Bits(i + 1) - kPow5BitCount);
+      last_removed_digit = MulShift(mv, kPow5Split[i + 1], j) % 10;
+    }
+    if (q <= 1) {
+      // mv = 4 * m2 always has at least two trailing zero bits.
+      vr_trailing_zeros = true;
+      if (accept_bounds) {
+        // mm = mv - 1 - mm_shift has one trailing zero bit iff mm_shift is 1.
+        vm_trailing_zeros = mm_shift == 1;
+      } else {
+        // mp = mv + 2 always has at least one trailing zero bit.
+        --vp;
+      }
+    } else if (q < 31) {
+      vr_trailing_zeros = MultipleOfPowerOf2(mv, q - 1);
+    }
+  }
+
+  // Remove digits while the interval still contains a shorter representation.
+  int32_t removed = 0;
+  uint32_t output;
+  if (vm_trailing_zeros || vr_trailing_zeros) {
+    while (vp / 10 > vm / 10) {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed_digit == 0;
+      last_removed_digit = vr % 10;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vm_trailing_zeros) {
+      while (vm % 10 == 0) {
+        vr_trailing_zeros &= last_removed_digit == 0;
+        last_removed_digit = vr % 10;
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+      // Round to even when the exact value is ...50...0.
+      last_removed_digit = 4;
+    }
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+                   last_removed_digit >= 5);
+  } else {
+    // The common case.
+    while (vp / 10 > vm / 10) {
+      last_removed_digit = vr % 10;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || last_removed_digit >= 5);
+  }
+  *out_output = output;
+  *out_exponent = e10 + removed;
+}
+
+char* WriteString(char* first, char const* str) {
+  size_t const n = std::strlen(str);
+  std::memcpy(first, str, n);
+  return first + n;
+}
+
+// Write the decimal digits of `v', which has exactly `len' digits.
+void WriteDigits(uint32_t v, uint32_t len, char* first) {
+  char* p = first + len;
+  while (v >= 100) {
+    uint32_t const pair = (v % 100) * 2;
+    v /= 100;
+    p -= 2;
+    std::memcpy(p, kDigitPairs + pair, 2);
+  }
+  if (v >= 10) {
+    p -= 2;
+    std::memcpy(p, kDigitPairs + v * 2, 2);
+  } else {
+    *--p = static_cast<char>('0' + v);
+  }
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Exact powers of ten for the fast path, 10^22 is the largest one a double holds.
+constexpr double kExactPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+constexpr int32_t kMaxExactPow10 = 22;
+constexpr uint64_t kMaxExactMantissa = static_cast<uint64_t>(1) << 53;
+// Significant digits accumulated into the mantissa, 10^19 < 2^64.
+constexpr int32_t kMaxMantissaDigits = 19;
+
+/*! \brief Whether a double is half way between two adjacent floats. */
+bool IsFloatMidpoint(double d) {
+  uint64_t bits;
+  std::memcpy(&bits, &d, sizeof(bits));
+  uint64_t constexpr kDropped = 52 - kFloatMantissaBits;
+  uint64_t constexpr kMask = (static_cast<uint64_t>(1) << kDropped) - 1;
+  return (bits & kMask) == (static_cast<uint64_t>(1) << (kDropped - 1));
+}
+}  // anonymous namespace
+
+ToCharsResult ToChars(char* first, char* last, float value) {
+  if (last - first < static_cast<std::ptrdiff_t>(NumericLimits<float>::kToCharsSize)) {
+    return {last, std::errc::value_too_large};
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bool const sign = (bits >> (kFloatMantissaBits + kFloatExponentBits)) != 0;
+  uint32_t const ieee_mantissa = bits & ((1u << kFloatMantissaBits) - 1);
+  uint32_t const ieee_exponent = (bits >> kFloatMantissaBits) & ((1u << kFloatExponentBits) - 1);
+
+  if (ieee_exponent == (1u << kFloatExponentBits) - 1) {
+    if (ieee_mantissa != 0) {
+      return {WriteString(first, "NaN"), std::errc()};
+    }
+    return {WriteString(first, sign ? "-Infinity" : "Infinity"), std::errc()};
+  }
+  char* p = first;
+  if (sign) {
+    *p++ = '-';
+  }
+  if (ieee_exponent == 0 && ieee_mantissa == 0) {
+    return {WriteString(p, "0E0"), std::errc()};
+  }
+
+  uint32_t output;
+  int32_t exponent;
+  ShortestDecimal(ieee_mantissa, ieee_exponent, &output, &exponent);
+  uint32_t const len = DecimalLength(output);
+  // Digits are written after a gap for the decimal point, then the first one is moved
+  // in front of it.
+  WriteDigits(output, len, p + 1);
+  p[0] = p[1];
+  if (len > 1) {
+    p[1] = '.';
+    p += len + 1;
+  } else {
+    p += 1;
+  }
+  *p++ = 'E';
+  int32_t sci_exponent = exponent + static_cast<int32_t>(len) - 1;
+  if (sci_exponent < 0) {
+    *p++ = '-';
+    sci_exponent = -sci_exponent;
+  }
+  uint32_t const exp_len = sci_exponent >= 10 ? 2 : 1;
+  WriteDigits(static_cast<uint32_t>(sci_exponent), exp_len, p);
+  return {p + exp_len, std::errc()};
+}
+
+ToCharsResult ToChars(char* first, char* last, int64_t value) {
+  if (last - first < static_cast<std::ptrdiff_t>(NumericLimits<int64_t>::kToCharsSize)) {
+    return {last, std::errc::value_too_large};
+  }
+  char* p = first;
+  // negate in unsigned so that the minimum value doesn't overflow
+  uint64_t magnitude = static_cast<uint64_t>(value);
+  if (value < 0) {
+    *p++ = '-';
+    magnitude = 0 - magnitude;
+  }
+  char buffer[NumericLimits<int64_t>::kToCharsSize];
+  char* end = buffer + sizeof(buffer);
+  char* q = end;
+  while (magnitude >= 100) {
+    uint64_t const pair = (magnitude % 100) * 2;
+    magnitude /= 100;
+    q -= 2;
+    std::memcpy(q, kDigitPairs + pair, 2);
+  }
+  if (magnitude >= 10) {
+    q -= 2;
+    std::memcpy(q, kDigitPairs + magnitude * 2, 2);
+  } else {
+    *--q = static_cast<char>('0' + magnitude);
+  }
+  std::memcpy(p, q, end - q);
+  return {p + (end - q), std::errc()};
+}
+
+FromCharsResult FromChars(char const* first, char const* last, float* value) {
+  char const* p = first;
+  bool negative = false;
+  if (p != last && *p == '-') {
+    negative = true;
+    ++p;
+  }
+  auto match = [&](char const* str) {
+    size_t const n = std::strlen(str);
+    if (static_cast<size_t>(last - p) >= n && std::memcmp(p, str, n) == 0) {
+      p += n;
+      return true;
+    }
+    return false;
+  };
+  if (!negative && match("NaN")) {
+    *value = std::numeric_limits<float>::quiet_NaN();
+    return {p, std::errc()};
+  }
+  if (match("Infinity")) {
+    *value = negative ? -std::numeric_limits<float>::infinity()
+                      : std::numeric_limits<float>::infinity();
+    return {p, std::errc()};
+  }
+
+  // The value is `mantissa * 10^exponent', with the digits past the first 19
+  // significant ones dropped.
+  uint64_t mantissa = 0;
+  int32_t n_digits = 0;
+  int64_t exponent = 0;
+  bool truncated = false;
+  auto accumulate = [&](char c, bool fraction) {
+    uint32_t const digit = c - '0';
+    if (n_digits == 0 && digit == 0) {
+      exponent -= fraction;  // leading zero
+    } else if (n_digits < kMaxMantissaDigits) {
+      mantissa = mantissa * 10 + digit;
+      ++n_digits;
+      exponent -= fraction;
+    } else {
+      truncated |= digit != 0;
+      exponent += !fraction;
+    }
+  };
+
+  char const* int_begin = p;
+  while (p != last && IsDigit(*p)) {
+    accumulate(*p, false);
+    ++p;
+  }
+  char const* int_end = p;
+  if (int_begin == int_end) {
+    return {first, std::errc::invalid_argument};
+  }
+  char const* frac_begin = p;
+  char const* frac_end = p;
+  if (p != last && *p == '.') {
+    ++p;
+    frac_begin = p;
+    while (p != last && IsDigit(*p)) {
+      accumulate(*p, true);
+      ++p;
+    }
+    frac_end = p;
+    if (frac_begin == frac_end) {
+      return {first, std::errc::invalid_argument};
+    }
+  }
+  int64_t exp_value = 0;
+  if (p != last && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exp = false;
+    if (p != last && (*p == '-' || *p == '+')) {
+      negative_exp = *p == '-';
+      ++p;
+    }
+    if (p == last || !IsDigit(*p)) {
+      return {first, std::errc::invalid_argument};
+    }
+    while (p != last && IsDigit(*p)) {
+      // Saturate, anything this large is zero or infinity anyway.
+      if (exp_value < (static_cast<int64_t>(1) << 32)) {
+        exp_value = exp_value * 10 + (*p - '0');
+      }
+      ++p;
+    }
+    exp_value = negative_exp ? -exp_value : exp_value;
+  }
+  exponent += exp_value;
+
+  if (mantissa == 0) {
+    *value = negative ? -0.0f : 0.0f;
+    return {p, std::errc()};
+  }
+  if (!truncated && mantissa <= kMaxExactMantissa && exponent >= -kMaxExactPow10 &&
+      exponent <= kMaxExactPow10) {
+    // Both operands are exact, so the double is the correctly rounded value.  Rounding
+    // it again to float is only wrong when it lands exactly between two floats.
+    double d = static_cast<double>(mantissa);
+    d = exponent < 0 ? d / kExactPow10[-exponent] : d * kExactPow10[exponent];
+    if (!IsFloatMidpoint(d)) {
+      float const f = static_cast<float>(d);
+      *value = negative ? -f : f;
+      return {p, std::errc()};
+    }
+  }
+
+  // All the digits without the decimal point.  A plain exponent is parsed the same way
+  // under every locale.
+  std::string buffer;
+  buffer.reserve((int_end - int_begin) + (frac_end - frac_begin) + 24);
+  buffer.append(int_begin, int_end);
+  buffer.append(frac_begin, frac_end);
+  buffer += 'e';
+  buffer += std::to_string(exp_value - (frac_end - frac_begin));
+  float const f = std::strtof(buffer.c_str(), nullptr);
+  *value = negative ? -f : f;
+  return {p, std::errc()};
+}
+}  // namespace common
+}  // namespace xgboost
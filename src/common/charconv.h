@@ -0,0 +1,52 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file charconv.h
+ * \brief Locale independent conversion between numbers and their text representation
+ *  in JSON, without the C++17 `std::to_chars` and `std::from_chars'.
+ */
+#ifndef XGBOOST_COMMON_CHARCONV_H_
+#define XGBOOST_COMMON_CHARCONV_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace xgboost {
+namespace common {
+struct ToCharsResult {
+  char* ptr;
+  std::errc ec;
+};
+
+struct FromCharsResult {
+  char const* ptr;
+  std::errc ec;
+};
+
+/*! \brief Buffer size large enough for any output of `ToChars'. */
+template <typename T> struct NumericLimits;
+template <> struct NumericLimits<float> {
+  // "-1.23456789E-38"
+  static constexpr size_t kToCharsSize = 16;
+};
+template <> struct NumericLimits<int64_t> {
+  // "-9223372036854775808"
+  static constexpr size_t kToCharsSize = 21;
+};
+
+/*!
+ * \brief Write the shortest representation of `value' that is parsed back to the same
+ *  float, in scientific notation like "1.25E-1".  Non-finite values are written as
+ *  "NaN", "Infinity" and "-Infinity".
+ */
+ToCharsResult ToChars(char* first, char* last, float value);
+ToCharsResult ToChars(char* first, char* last, int64_t value);
+
+/*!
+ * \brief Parse a JSON number into the nearest float, ties to even.  The result is
+ *  correctly rounded however many digits the number has.
+ */
+FromCharsResult FromChars(char const* first, char const* last, float* value);
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_CHARCONV_H_
@@ -8,6 +8,7 @@
 #ifndef XGBOOST_COMMON_COLUMN_MATRIX_H_
 #define XGBOOST_COMMON_COLUMN_MATRIX_H_
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 #include "hist_util.h"
@@ -24,20 +25,28 @@ enum ColumnType {
 };
 
 /*! \brief a column storage, to be used with ApplySplit. Note that each
-    bin id is stored as index[i] + index_base. */
+    bin id is stored as index[i] + index_base.
+    Different types of bin index (uint8, uint16, uint32) are supported through
+    BinIdxType, and missing values of dense columns are flagged separately so that
+    the whole range of BinIdxType is available for bins. */
+template <typename BinIdxType>
 class Column {
  public:
-  Column(ColumnType type, const uint32_t* index, uint32_t index_base,
-         const size_t* row_ind, size_t len)
+  Column(ColumnType type, common::Span<const BinIdxType> index, uint32_t index_base,
+         const size_t* row_ind, const std::vector<bool>* missing_flags,
+         size_t missing_flags_begin)
       : type_(type),
         index_(index),
         index_base_(index_base),
         row_ind_(row_ind),
-        len_(len) {}
-  size_t Size() const { return len_; }
-  uint32_t GetGlobalBinIdx(size_t idx) const { return index_base_ + index_[idx]; }
-  uint32_t GetFeatureBinIdx(size_t idx) const { return index_[idx]; }
-  common::Span<const uint32_t> GetFeatureBinIdxPtr() const { return { index_, len_ }; }
+        missing_flags_(missing_flags),
+        missing_flags_begin_(missing_flags_begin) {}
+  size_t Size() const { return index_.size(); }
+  uint32_t GetGlobalBinIdx(size_t idx) const {
+    return index_base_ + static_cast<uint32_t>(index_[idx]);
+  }
+  BinIdxType GetFeatureBinIdx(size_t idx) const { return index_[idx]; }
+  common::Span<const BinIdxType> GetFeatureBinIdxPtr() const { return index_; }
   // column.GetFeatureBinIdx(idx) + column.GetBaseIdx(idx) ==
   // column.GetGlobalBinIdx(idx)
   uint32_t GetBaseIdx() const { return index_base_; }
@@ -48,16 +57,19 @@ class Column {
     return type_ == ColumnType::kDenseColumn ? idx : row_ind_[idx];  // NOLINT
   }
   bool IsMissing(size_t idx) const {
-    return index_[idx] == std::numeric_limits<uint32_t>::max();
+    // only dense columns keep entries for missing values
+    return type_ == ColumnType::kDenseColumn &&
+           (*missing_flags_)[missing_flags_begin_ + idx];
   }
   const size_t* GetRowData() const { return row_ind_; }
 
  private:
   ColumnType type_;
-  const uint32_t* index_;
+  common::Span<const BinIdxType> index_;
   uint32_t index_base_;
   const size_t* row_ind_;
-  const size_t len_;
+  const std::vector<bool>* missing_flags_;
+  const size_t missing_flags_begin_;
 };
 
 /*! \brief a collection of columns, with support for construction from
@@ -81,8 +93,19 @@ class ColumnMatrix {
     std::fill(feature_counts_.begin(), feature_counts_.end(), 0);
 
     uint32_t max_val = std::numeric_limits<uint32_t>::max();
+    uint32_t max_bins = 0;
     for (int32_t fid = 0; fid < nfeature; ++fid) {
-      CHECK_LE(gmat.cut.Ptrs()[fid + 1] - gmat.cut.Ptrs()[fid], max_val);
+      const uint32_t nbins = gmat.cut.Ptrs()[fid + 1] - gmat.cut.Ptrs()[fid];
+      CHECK_LE(nbins, max_val);
+      max_bins = std::max(max_bins, nbins);
+    }
+    // bins are stored relative to their feature, so the widest feature decides the type
+    if (max_bins <= static_cast<uint32_t>(std::numeric_limits<uint8_t>::max()) + 1) {
+      bins_type_size_ = kUint8BinsTypeSize;
+    } else if (max_bins <= static_cast<uint32_t>(std::numeric_limits<uint16_t>::max()) + 1) {
+      bins_type_size_ = kUint16BinsTypeSize;
+    } else {
+      bins_type_size_ = kUint32BinsTypeSize;
     }
 
     gmat.GetFeatureCounts(&feature_counts_[0]);
@@ -106,7 +129,6 @@ class ColumnMatrix {
       boundary_[fid].row_ind_begin = accum_row_ind_;
       if (type_[fid] == kDenseColumn) {
         accum_index_ += static_cast<size_t>(nrow);
-        accum_row_ind_ += static_cast<size_t>(nrow);
       } else {
         accum_index_ += feature_counts_[fid];
         accum_row_ind_ += feature_counts_[fid];
@@ -115,8 +137,9 @@ class ColumnMatrix {
       boundary_[fid].row_ind_end = accum_row_ind_;
     }
 
-    index_.resize(boundary_[nfeature - 1].index_end);
+    index_.resize(boundary_[nfeature - 1].index_end * bins_type_size_, 0);
     row_ind_.resize(boundary_[nfeature - 1].row_ind_end);
+    missing_flags_.assign(boundary_[nfeature - 1].index_end, false);
 
     // store least bin id for each feature
     index_base_.resize(nfeature);
@@ -124,39 +147,79 @@ class ColumnMatrix {
       index_base_[fid] = gmat.cut.Ptrs()[fid];
     }
 
-    // pre-fill index_ for dense columns
-
-    #pragma omp parallel for
+    // pre-fill missing flags for dense columns
     for (int32_t fid = 0; fid < nfeature; ++fid) {
       if (type_[fid] == kDenseColumn) {
         const size_t ibegin = boundary_[fid].index_begin;
-        uint32_t* begin = &index_[ibegin];
-        uint32_t* end = begin + nrow;
-        std::fill(begin, end, std::numeric_limits<uint32_t>::max());
-        // max() indicates missing values
+        std::fill(missing_flags_.begin() + ibegin,
+                  missing_flags_.begin() + ibegin + nrow, true);
       }
     }
 
+    switch (bins_type_size_) {
+      case kUint8BinsTypeSize:
+        SetIndex<uint8_t>(gmat, nrow, nfeature);
+        break;
+      case kUint16BinsTypeSize:
+        SetIndex<uint16_t>(gmat, nrow, nfeature);
+        break;
+      default:
+        SetIndex<uint32_t>(gmat, nrow, nfeature);
+        break;
+    }
+    tracked_.Set(index_.size() + row_ind_.size() * sizeof(size_t) + missing_flags_.size() / 8 +
+                 boundary_.size() * sizeof(ColumnBoundary));
+  }
+
+  /* Fetch an individual column. BinIdxType must match the storage type
+     reported by GetTypeSize() */
+  template <typename BinIdxType>
+  inline Column<BinIdxType> GetColumn(unsigned fid) const {
+    CHECK_EQ(sizeof(BinIdxType), bins_type_size_);
+    const BinIdxType* index = reinterpret_cast<const BinIdxType*>(index_.data());
+    const size_t ibegin = boundary_[fid].index_begin;
+    const size_t iend = boundary_[fid].index_end;
+    Column<BinIdxType> c(type_[fid], {index + ibegin, iend - ibegin}, index_base_[fid],
+                         (type_[fid] == ColumnType::kSparseColumn ?
+                          &row_ind_[boundary_[fid].row_ind_begin] : nullptr),
+                         &missing_flags_, ibegin);
+    return c;
+  }
+
+  BinTypeSize GetTypeSize() const {
+    return bins_type_size_;
+  }
+
+ private:
+  template <typename BinIdxType>
+  inline void SetIndex(const GHistIndexMatrix& gmat, size_t nrow, int32_t nfeature) {
+    BinIdxType* index = reinterpret_cast<BinIdxType*>(index_.data());
     // loop over all rows and fill column entries
     // num_nonzeros[fid] = how many nonzeros have this feature accumulated so far?
     std::vector<size_t> num_nonzeros;
     num_nonzeros.resize(nfeature);
     std::fill(num_nonzeros.begin(), num_nonzeros.end(), 0);
+    const bool is_dense = gmat.IsDense();
     for (size_t rid = 0; rid < nrow; ++rid) {
       const size_t ibegin = gmat.row_ptr[rid];
       const size_t iend = gmat.row_ptr[rid + 1];
       size_t fid = 0;
       for (size_t i = ibegin; i < iend; ++i) {
         const uint32_t bin_id = gmat.index[i];
-        auto iter = std::upper_bound(gmat.cut.Ptrs().cbegin() + fid,
-                                     gmat.cut.Ptrs().cend(), bin_id);
-        fid = std::distance(gmat.cut.Ptrs().cbegin(), iter) - 1;
+        if (is_dense) {
+          // dense GHistIndexMatrix keeps features in order
+          fid = i - ibegin;
+        } else {
+          auto iter = std::upper_bound(gmat.cut.Ptrs().cbegin() + fid,
+                                       gmat.cut.Ptrs().cend(), bin_id);
+          fid = std::distance(gmat.cut.Ptrs().cbegin(), iter) - 1;
+        }
+        BinIdxType* begin = &index[boundary_[fid].index_begin];
         if (type_[fid] == kDenseColumn) {
-          uint32_t* begin = &index_[boundary_[fid].index_begin];
-          begin[rid] = bin_id - index_base_[fid];
+          begin[rid] = static_cast<BinIdxType>(bin_id - index_base_[fid]);
+          missing_flags_[boundary_[fid].index_begin + rid] = false;
         } else {
-          uint32_t* begin = &index_[boundary_[fid].index_begin];
-          begin[num_nonzeros[fid]] = bin_id - index_base_[fid];
+          begin[num_nonzeros[fid]] = static_cast<BinIdxType>(bin_id - index_base_[fid]);
           row_ind_[boundary_[fid].row_ind_begin + num_nonzeros[fid]] = rid;
           ++num_nonzeros[fid];
         }
@@ -164,21 +227,10 @@ class ColumnMatrix {
     }
   }
 
-  /* Fetch an individual column. This code should be used with XGBOOST_TYPE_SWITCH
-     to determine type of bin id's */
-  inline Column GetColumn(unsigned fid) const {
-    Column c(type_[fid], &index_[boundary_[fid].index_begin], index_base_[fid],
-             (type_[fid] == ColumnType::kSparseColumn ?
-              &row_ind_[boundary_[fid].row_ind_begin] : nullptr),
-             boundary_[fid].index_end - boundary_[fid].index_begin);
-    return c;
-  }
-
- private:
   struct ColumnBoundary {
     // indicate where each column's index and row_ind is stored.
     // index_begin and index_end are logical offsets, so they should be converted to
-    // actual offsets by scaling with packing_factor_
+    // actual offsets by scaling with bins_type_size_
     size_t index_begin;
     size_t index_end;
     size_t row_ind_begin;
@@ -187,12 +239,17 @@ class ColumnMatrix {
 
   std::vector<size_t> feature_counts_;
   std::vector<ColumnType> type_;
-  std::vector<uint32_t> index_;  // index_: may store smaller integers; needs padding
+  // bins of all columns, each stored in bins_type_size_ bytes
+  std::vector<uint8_t> index_;
   std::vector<size_t> row_ind_;
   std::vector<ColumnBoundary> boundary_;
 
   // index_base_[fid]: least bin id for feature fid
   std::vector<uint32_t> index_base_;
+  // missing_flags_[i]: whether entry i of a dense column is missing
+  std::vector<bool> missing_flags_;
+  BinTypeSize bins_type_size_ {kUint32BinsTypeSize};
+  TrackedBytes tracked_ {"ColumnMatrix"};
 };
 
 }  // namespace common
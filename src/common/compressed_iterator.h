@@ -218,5 +218,41 @@ class CompressedIterator {
     return *offset;
   }
 };
+
+/**
+ * \brief Read the symbols [begin, begin + n) of a buffer written by CompressedBufferWriter
+ *  into out, on host.  Each symbol is cut out of a single 8 byte big endian load, so the
+ *  loop has no branches and vectorizes.  Symbols too close to the end of the buffer for
+ *  the load are read with CompressedIterator.
+ *
+ * \param buffer       The compressed buffer.
+ * \param buffer_bytes Size of the buffer, as returned by CalculateBufferSize.
+ * \param num_symbols  Max number of symbols (alphabet size) the buffer is written with.
+ */
+inline void UnpackSymbols(CompressedByteT const *buffer, size_t buffer_bytes,
+                          size_t num_symbols, size_t begin, size_t n, uint32_t *out) {
+  const size_t symbol_bits = detail::SymbolBits(num_symbols);
+  const size_t kLoadBytes = 8;
+  // symbols [begin, fast_end) can be loaded without reading past the buffer
+  size_t fast_end = begin;
+  if (buffer_bytes >= detail::kPadding + kLoadBytes) {
+    fast_end = ((buffer_bytes - detail::kPadding - kLoadBytes) * 8) / symbol_bits + 1;
+    fast_end = std::min(std::max(fast_end, begin), begin + n);
+  }
+  CompressedByteT const *data = buffer + detail::kPadding;
+  for (size_t i = begin; i < fast_end; ++i) {
+    const size_t bit = i * symbol_bits;
+    CompressedByteT const *p = data + bit / 8;
+    uint64_t word = 0;
+    for (size_t k = 0; k < kLoadBytes; ++k) {
+      word = (word << 8) | p[k];
+    }
+    out[i - begin] = static_cast<uint32_t>((word << (bit % 8)) >> (64 - symbol_bits));
+  }
+  CompressedIterator<uint32_t> iter(const_cast<CompressedByteT *>(buffer), num_symbols);
+  for (size_t i = fast_end; i < begin + n; ++i) {
+    out[i - begin] = iter[i];
+  }
+}
 }  // namespace common
 }  // namespace xgboost
@@ -0,0 +1,192 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file cox.cc
+ */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "cox.h"
+
+namespace xgboost {
+namespace common {
+
+namespace {
+/*! \brief Rows scanned by one task, fixed so sums don't depend on the number of threads. */
+constexpr size_t kCoxBlockRows = 4096;
+
+inline bool IsTieHead(float const* labels, size_t const* order, size_t i) {
+  return i == 0 || std::abs(labels[order[i - 1]]) < std::abs(labels[order[i]]);
+}
+
+/*!
+ * \brief Write the sum of `values' over the risk set of each position into `out_sums',
+ *  the risk set of position i starts at the first position tied with i.
+ *
+ *  A first pass sums each block and the part of it after its last tie head, then the
+ *  carries of later blocks (for the suffix sums) and of the tie group open at the start
+ *  of each block are scanned sequentially, a second pass writes the sums.  Summing from
+ *  the end instead of subtracting from the total avoids cancellation for late times.
+ */
+void RiskSetSums(double const* values, float const* labels, size_t const* order, size_t n,
+                 double* out_sums) {
+  auto const n_blocks = static_cast<omp_ulong>(DivRoundUp(n, kCoxBlockRows));
+  std::vector<double> block_sum(n_blocks), block_tail(n_blocks);
+  std::vector<uint8_t> block_has_head(n_blocks);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {  // NOLINT(*)
+    size_t const begin = b * kCoxBlockRows;
+    size_t const end = std::min(begin + kCoxBlockRows, n);
+    double sum = 0, tail = 0;
+    bool has_head = false;
+    for (size_t i = begin; i < end; ++i) {
+      if (IsTieHead(labels, order, i)) {
+        has_head = true;
+        tail = 0;
+      }
+      sum += values[i];
+      tail += values[i];
+    }
+    block_sum[b] = sum;
+    block_tail[b] = tail;
+    block_has_head[b] = has_head;
+  }
+
+  std::vector<double> suffix(n_blocks), open_tie(n_blocks);
+  double carry = 0;
+  for (omp_ulong b = n_blocks; b-- > 0;) {
+    suffix[b] = carry;
+    carry += block_sum[b];
+  }
+  carry = 0;
+  for (omp_ulong b = 0; b < n_blocks; ++b) {
+    open_tie[b] = carry;
+    carry = block_has_head[b] ? block_tail[b] : carry + block_tail[b];
+  }
+
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {  // NOLINT(*)
+    size_t const begin = b * kCoxBlockRows;
+    size_t const end = std::min(begin + kCoxBlockRows, n);
+    double sum = suffix[b];
+    for (size_t i = end; i-- > begin;) {
+      sum += values[i];
+      out_sums[i] = sum;
+    }
+    // add the positions tied with i but before it
+    double tie = open_tie[b];
+    for (size_t i = begin; i < end; ++i) {
+      if (IsTieHead(labels, order, i)) {
+        tie = 0;
+      }
+      out_sums[i] += tie;
+      tie += values[i];
+    }
+  }
+}
+}  // anonymous namespace
+
+void CoxGradient(float const* preds, float const* labels, float const* weights,
+                 size_t const* order, size_t n, std::vector<double>* workspace,
+                 GradientPair* out_gpair) {
+  workspace->resize(2 * n);
+  double* exp_p = workspace->data();
+  double* risk = exp_p + n;
+  auto const ndata = static_cast<omp_ulong>(n);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {  // NOLINT(*)
+    exp_p[i] = std::exp(preds[order[i]]);
+  }
+  RiskSetSums(exp_p, labels, order, n, risk);
+
+  // r_k and s_k sum 1/risk and 1/risk^2 over the events up to a position, scanned the
+  // same way as the risk sets.
+  auto const n_blocks = static_cast<omp_ulong>(DivRoundUp(n, kCoxBlockRows));
+  std::vector<double> block_r(n_blocks), block_s(n_blocks);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {  // NOLINT(*)
+    size_t const begin = b * kCoxBlockRows;
+    size_t const end = std::min(begin + kCoxBlockRows, n);
+    double r_k = 0, s_k = 0;
+    for (size_t i = begin; i < end; ++i) {
+      if (labels[order[i]] > 0) {
+        r_k += 1.0 / risk[i];
+        s_k += 1.0 / (risk[i] * risk[i]);
+      }
+    }
+    block_r[b] = r_k;
+    block_s[b] = s_k;
+  }
+  double r_carry = 0, s_carry = 0;
+  for (omp_ulong b = 0; b < n_blocks; ++b) {
+    double const r = block_r[b], s = block_s[b];
+    block_r[b] = r_carry;
+    block_s[b] = s_carry;
+    r_carry += r;
+    s_carry += s;
+  }
+
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {  // NOLINT(*)
+    size_t const begin = b * kCoxBlockRows;
+    size_t const end = std::min(begin + kCoxBlockRows, n);
+    double r_k = block_r[b], s_k = block_s[b];
+    for (size_t i = begin; i < end; ++i) {
+      size_t const ind = order[i];
+      double const y = labels[ind];
+      if (y > 0) {
+        r_k += 1.0 / risk[i];
+        s_k += 1.0 / (risk[i] * risk[i]);
+      }
+      double const w = weights == nullptr ? 1.0 : weights[ind];
+      double const grad = exp_p[i] * r_k - static_cast<bst_float>(y > 0);
+      double const hess = exp_p[i] * r_k - exp_p[i] * exp_p[i] * s_k;
+      out_gpair[ind] = GradientPair(grad * w, hess * w);
+    }
+  }
+}
+
+double CoxNegLogLik(float const* preds, float const* labels, size_t const* order, size_t n) {
+  std::vector<double> workspace(2 * n);
+  double* hazard = workspace.data();
+  double* risk = hazard + n;
+  auto const ndata = static_cast<omp_ulong>(n);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {  // NOLINT(*)
+    hazard[i] = preds[order[i]];
+  }
+  RiskSetSums(hazard, labels, order, n, risk);
+
+  auto const n_blocks = static_cast<omp_ulong>(DivRoundUp(n, kCoxBlockRows));
+  std::vector<double> block_out(n_blocks);
+  std::vector<size_t> block_events(n_blocks);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {  // NOLINT(*)
+    size_t const begin = b * kCoxBlockRows;
+    size_t const end = std::min(begin + kCoxBlockRows, n);
+    double out = 0;
+    size_t n_events = 0;
+    for (size_t i = begin; i < end; ++i) {
+      if (labels[order[i]] > 0) {
+        out -= std::log(hazard[i]) - std::log(risk[i]);
+        ++n_events;
+      }
+    }
+    block_out[b] = out;
+    block_events[b] = n_events;
+  }
+  double out = 0;
+  size_t n_events = 0;
+  for (omp_ulong b = 0; b < n_blocks; ++b) {
+    out += block_out[b];
+    n_events += block_events[b];
+  }
+  return out / n_events;  // normalize by the number of events
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,127 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file cox.cu
+ * \brief Device risk set sums, the sequential passes of cox.cc become thrust scans.
+ */
+#include <thrust/execution_policy.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/transform_reduce.h>
+
+#include <cmath>
+
+#include "cox.h"
+#include "device_helpers.cuh"
+
+namespace xgboost {
+namespace common {
+
+namespace {
+template <typename T>
+Span<T> ToSpan(dh::caching_device_vector<T>* vec) {
+  return {vec->data().get(), vec->size()};
+}
+
+XGBOOST_DEVICE bool IsTieHead(Span<float const> labels, Span<size_t const> order, size_t i) {
+  return i == 0 || fabsf(labels[order[i - 1]]) < fabsf(labels[order[i]]);
+}
+
+/*!
+ * \brief Sum of `values' over the risk set of each position: a reverse scan gives the
+ *  suffix sums, a max scan over tie heads the first position of each risk set.
+ */
+dh::caching_device_vector<double> RiskSetSums(int device,
+                                              dh::caching_device_vector<double> const& values,
+                                              Span<float const> labels,
+                                              Span<size_t const> order) {
+  size_t const n = values.size();
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  dh::caching_device_vector<double> suffix(n);
+  thrust::inclusive_scan(thrust::cuda::par(alloc), values.rbegin(), values.rend(),
+                         suffix.rbegin());
+
+  dh::caching_device_vector<size_t> tie_head(n);
+  auto d_tie_head = ToSpan(&tie_head);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_tie_head[i] = IsTieHead(labels, order, i) ? i : 0;
+  });
+  thrust::inclusive_scan(thrust::cuda::par(alloc), tie_head.begin(), tie_head.end(),
+                         tie_head.begin(), thrust::maximum<size_t>());
+
+  dh::caching_device_vector<double> risk(n);
+  auto d_risk = ToSpan(&risk);
+  auto d_suffix = ToSpan(&suffix);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_risk[i] = d_suffix[d_tie_head[i]];
+  });
+  return risk;
+}
+}  // anonymous namespace
+
+void CoxGradientDevice(int device, Span<float const> preds, Span<float const> labels,
+                       Span<float const> weights, Span<size_t const> order,
+                       Span<GradientPair> out_gpair) {
+  dh::safe_cuda(cudaSetDevice(device));
+  size_t const n = order.size();
+  dh::caching_device_vector<double> exp_p(n);
+  auto d_exp_p = ToSpan(&exp_p);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_exp_p[i] = exp(static_cast<double>(preds[order[i]]));
+  });
+  auto risk = RiskSetSums(device, exp_p, labels, order);
+  auto d_risk = ToSpan(&risk);
+
+  dh::caching_device_vector<double> r_k(n), s_k(n);
+  auto d_r_k = ToSpan(&r_k);
+  auto d_s_k = ToSpan(&s_k);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    bool const event = labels[order[i]] > 0;
+    d_r_k[i] = event ? 1.0 / d_risk[i] : 0.0;
+    d_s_k[i] = event ? 1.0 / (d_risk[i] * d_risk[i]) : 0.0;
+  });
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  thrust::inclusive_scan(thrust::cuda::par(alloc), r_k.begin(), r_k.end(), r_k.begin());
+  thrust::inclusive_scan(thrust::cuda::par(alloc), s_k.begin(), s_k.end(), s_k.begin());
+
+  bool const is_null_weight = weights.size() == 0;
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    size_t const ind = order[i];
+    double const y = labels[ind];
+    double const w = is_null_weight ? 1.0 : weights[ind];
+    double const grad = d_exp_p[i] * d_r_k[i] - static_cast<bst_float>(y > 0);
+    double const hess = d_exp_p[i] * d_r_k[i] - d_exp_p[i] * d_exp_p[i] * d_s_k[i];
+    out_gpair[ind] = GradientPair(grad * w, hess * w);
+  });
+}
+
+double CoxNegLogLikDevice(int device, Span<float const> preds, Span<float const> labels,
+                          Span<size_t const> order) {
+  dh::safe_cuda(cudaSetDevice(device));
+  size_t const n = order.size();
+  dh::caching_device_vector<double> hazard(n);
+  auto d_hazard = ToSpan(&hazard);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_hazard[i] = preds[order[i]];
+  });
+  auto risk = RiskSetSums(device, hazard, labels, order);
+  auto d_risk = ToSpan(&risk);
+
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  double const out = thrust::transform_reduce(
+      thrust::cuda::par(alloc), thrust::make_counting_iterator<size_t>(0),
+      thrust::make_counting_iterator<size_t>(n),
+      [=] __device__(size_t i) {
+        return labels[order[i]] > 0 ? log(d_risk[i]) - log(d_hazard[i]) : 0.0;
+      },
+      0.0, thrust::plus<double>());
+  size_t const n_events = thrust::transform_reduce(
+      thrust::cuda::par(alloc), thrust::make_counting_iterator<size_t>(0),
+      thrust::make_counting_iterator<size_t>(n),
+      [=] __device__(size_t i) -> size_t { return labels[order[i]] > 0 ? 1 : 0; },
+      size_t(0), thrust::plus<size_t>());
+  return out / n_events;  // normalize by the number of events
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,57 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file cox.h
+ * \brief Risk set sums of the Cox proportional hazards model, shared by the survival:cox
+ *  objective and the cox-nloglik metric.
+ *
+ *  Rows are visited in the order of `MetaInfo::LabelAbsSort', the risk set of a row are
+ *  all rows with the same or a later time.  Sums over risk sets are computed by a
+ *  parallel scan over fixed size blocks, so results don't depend on the number of threads.
+ */
+#ifndef XGBOOST_COMMON_COX_H_
+#define XGBOOST_COMMON_COX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/span.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief Gradient of the negative log partial likelihood, see `CoxRegression'.  Ties are
+ *  handled by Breslow's method.
+ *
+ * \param preds     Margin predictions.
+ * \param labels    Survival times, negative for censored rows.
+ * \param weights   Row weights, or nullptr for unit weights.
+ * \param order     Argsort of the absolute labels.
+ * \param workspace Reused between calls to avoid allocations.
+ */
+void CoxGradient(float const* preds, float const* labels, float const* weights,
+                 size_t const* order, size_t n, std::vector<double>* workspace,
+                 GradientPair* out_gpair);
+
+/*!
+ * \brief Negative log partial likelihood normalized by the number of events.
+ *
+ * \param preds Transformed predictions, the hazard ratios exp(margin).
+ */
+double CoxNegLogLik(float const* preds, float const* labels, size_t const* order, size_t n);
+
+#if defined(XGBOOST_USE_CUDA)
+/*! \brief Device version of `CoxGradient', `weights' is empty for unit weights. */
+void CoxGradientDevice(int device, Span<float const> preds, Span<float const> labels,
+                       Span<float const> weights, Span<size_t const> order,
+                       Span<GradientPair> out_gpair);
+
+/*! \brief Device version of `CoxNegLogLik'. */
+double CoxNegLogLikDevice(int device, Span<float const> preds, Span<float const> labels,
+                          Span<size_t const> order);
+#endif  // defined(XGBOOST_USE_CUDA)
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_COX_H_
@@ -33,6 +33,24 @@ std::string PrintUUID(xgboost::common::Span<uint64_t, kUuidLength> uuid) {
 
 #endif  // __CUDACC_VER_MAJOR__ > 9
 
+void SetDeviceMemoryResource(std::shared_ptr<DeviceMemoryResource> resource) {
+  CHECK_EQ(detail::LiveAllocations().load(), 0)
+      << "The device memory resource can not be replaced while XGBoost holds device memory.";
+  if (!resource) {
+    resource.reset(new PoolMemoryResource());
+  }
+  detail::GlobalMemoryResourcePtr() = std::move(resource);
+}
+
+void SetMemoryPoolSize(size_t max_cached_bytes) {
+  auto pool = dynamic_cast<PoolMemoryResource*>(GlobalMemoryResource());
+  if (pool == nullptr) {
+    LOG(WARNING) << "Pool size is ignored as an external memory resource is used.";
+    return;
+  }
+  pool->SetMaxCachedBytes(max_cached_bytes);
+}
+
 void AllReducer::Init(int _device_ordinal) {
 #ifdef XGBOOST_USE_NCCL
   LOG(DEBUG) << "Running nccl init on: " << __CUDACC_VER_MAJOR__ << "." << __CUDACC_VER_MINOR__;
@@ -78,6 +96,40 @@ void AllReducer::Init(int _device_ordinal) {
 #endif  // XGBOOST_USE_NCCL
 }
 
+void AllReducer::InitGroup(std::vector<int> const& devices,
+                           std::vector<std::unique_ptr<AllReducer>>* reducers) {
+  reducers->clear();
+  for (size_t i = 0; i < devices.size(); ++i) {
+    reducers->emplace_back(new AllReducer());
+  }
+#ifdef XGBOOST_USE_NCCL
+  CHECK(!devices.empty());
+  auto const n_local = static_cast<int32_t>(devices.size());
+  int32_t const world = rabit::GetWorldSize() * n_local;
+  int32_t const rank_begin = rabit::GetRank() * n_local;
+  ncclUniqueId id = reducers->front()->GetUniqueId();
+  // All communicators of a single process must be created in one group.
+  dh::safe_nccl(ncclGroupStart());
+  for (int32_t i = 0; i < n_local; ++i) {
+    auto& reducer = *reducers->at(i);
+    reducer.device_ordinal = devices[i];
+    reducer.id = id;
+    dh::safe_cuda(cudaSetDevice(devices[i]));
+    dh::safe_nccl(ncclCommInitRank(&reducer.comm, world, id, rank_begin + i));
+  }
+  dh::safe_nccl(ncclGroupEnd());
+  for (auto& reducer : *reducers) {
+    dh::safe_cuda(cudaSetDevice(reducer->device_ordinal));
+    safe_cuda(cudaStreamCreate(&reducer->stream));
+    reducer->initialised_ = true;
+  }
+#else
+  if (rabit::IsDistributed() || devices.size() > 1) {
+    LOG(FATAL) << "XGBoost is not compiled with NCCL.";
+  }
+#endif  // XGBOOST_USE_NCCL
+}
+
 AllReducer::~AllReducer() {
 #ifdef XGBOOST_USE_NCCL
   if (initialised_) {
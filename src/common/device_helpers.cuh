@@ -16,8 +16,11 @@
 #include <cub/util_allocator.cuh>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -93,6 +96,21 @@ inline void CudaCheckPointerDevice(void* ptr) {
                                    << "current device: " << cur_device;
 }
 
+/*! \brief Whether `ptr' points to device memory, and the device holding it. */
+inline bool IsDevicePointer(void const* ptr, int32_t* device) {
+  cudaPointerAttributes attr;
+  bool is_device = cudaPointerGetAttributes(&attr, ptr) == cudaSuccess &&
+#if CUDART_VERSION >= 10000
+                   attr.type == cudaMemoryTypeDevice;
+#else
+                   attr.memoryType == cudaMemoryTypeDevice;
+#endif  // CUDART_VERSION >= 10000
+  // unregistered host memory is reported as an error by old runtimes
+  cudaGetLastError();
+  *device = is_device ? attr.device : -1;
+  return is_device;
+}
+
 template <typename T>
 const T *Raw(const thrust::device_vector<T> &v) {  //  NOLINT
   return raw_pointer_cast(v.data());
@@ -359,7 +377,7 @@ class MemoryLogger {
 
 public:
   void RegisterAllocation(void *ptr, size_t n) {
-    if (!xgboost::ConsoleLogger::ShouldLog(xgboost::ConsoleLogger::LV::kDebug))
+    if (!xgboost::common::Monitor::Enabled())
       return;
     std::lock_guard<std::mutex> guard(mutex_);
     int current_device;
@@ -367,7 +385,7 @@ public:
     stats_.RegisterAllocation(ptr, n);
   }
   void RegisterDeallocation(void *ptr, size_t n) {
-    if (!xgboost::ConsoleLogger::ShouldLog(xgboost::ConsoleLogger::LV::kDebug))
+    if (!xgboost::common::Monitor::Enabled())
       return;
     std::lock_guard<std::mutex> guard(mutex_);
     int current_device;
@@ -378,18 +396,7 @@ public:
   {
     return stats_.peak_allocated_bytes;
   }
-  void Log() {
-    if (!xgboost::ConsoleLogger::ShouldLog(xgboost::ConsoleLogger::LV::kDebug))
-      return;
-    std::lock_guard<std::mutex> guard(mutex_);
-    int current_device;
-    safe_cuda(cudaGetDevice(&current_device));
-    LOG(CONSOLE) << "======== Device " << current_device << " Memory Allocations: "
-      << " ========";
-    LOG(CONSOLE) << "Peak memory usage: "
-      << stats_.peak_allocated_bytes / 1048576 << "MiB";
-    LOG(CONSOLE) << "Number of allocations: " << stats_.num_allocations;
-  }
+  void Log();
 };
 };
 
@@ -398,6 +405,161 @@ inline detail::MemoryLogger &GlobalMemoryLogger() {
   return memory_logger;
 }
 
+/*!
+ * \brief Source of device memory for all XGBoost device containers.
+ *
+ * Allocations are stream ordered: memory deallocated on a stream may be handed out again
+ * to work ordered after the deallocation on that stream without synchronising.  A host
+ * application can replace the resource with its own (e.g. RMM) through
+ * `SetDeviceMemoryResource`.
+ */
+class DeviceMemoryResource {
+ public:
+  virtual ~DeviceMemoryResource() = default;
+  /*! \brief Allocate `bytes` on the current device, for use on `stream`. */
+  virtual void* Allocate(size_t bytes, cudaStream_t stream) = 0;
+  /*! \brief Return memory from `Allocate`, the last use being ordered on `stream`. */
+  virtual void Deallocate(void* ptr, size_t bytes, cudaStream_t stream) = 0;
+  /*! \brief Human readable statistics for the memory logger. */
+  virtual std::string Stats() const { return "external"; }
+};
+
+/*!
+ * \brief Default memory resource, a pool using cub::CachingDeviceAllocator as back-end.
+ *
+ * Block sizes are rounded up to powers of two from 512 bytes to 2 GiB, the largest bin
+ * supported by cub; larger blocks are not cached.  Freed blocks are kept until the cached
+ * bytes of a device exceed `max_cached_bytes`, so steady state training does not call
+ * cudaMalloc or cudaFree.
+ */
+class PoolMemoryResource : public DeviceMemoryResource {
+  static constexpr unsigned kBinGrowth = 2;
+  static constexpr unsigned kMinBin = 9;
+  static constexpr unsigned kMaxBin = 31;
+
+ public:
+  explicit PoolMemoryResource(size_t max_cached_bytes =
+                                  cub::CachingDeviceAllocator::INVALID_SIZE)
+      : allocator_{kBinGrowth, kMinBin, kMaxBin, max_cached_bytes,
+                   /*skip_cleanup=*/true} {}
+
+  void SetMaxCachedBytes(size_t max_cached_bytes) {
+    safe_cuda(allocator_.SetMaxCachedBytes(max_cached_bytes));
+  }
+  void* Allocate(size_t bytes, cudaStream_t stream) override {
+    void* ptr {nullptr};
+    safe_cuda(allocator_.DeviceAllocate(&ptr, bytes, stream));
+    return ptr;
+  }
+  void Deallocate(void* ptr, size_t bytes, cudaStream_t stream) override {
+    safe_cuda(allocator_.DeviceFree(ptr));
+  }
+  std::string Stats() const override {
+    int device;
+    safe_cuda(cudaGetDevice(&device));
+    std::stringstream ss;
+    auto it = allocator_.cached_bytes.find(device);
+    if (it == allocator_.cached_bytes.cend()) {
+      ss << "0MiB live, 0MiB cached";
+    } else {
+      ss << (it->second.live >> 20) << "MiB live, " << (it->second.free >> 20)
+         << "MiB cached";
+    }
+    return ss.str();
+  }
+
+ private:
+  cub::CachingDeviceAllocator allocator_;
+};
+
+/*!
+ * \brief Memory resource allocating CUDA managed memory, so the device memory can be
+ *  oversubscribed with pages migrating between host and device on demand.
+ *
+ * The pages are advised to live on the allocating device and prefetched there on the
+ * allocation stream, so data fitting in device memory stays resident.  Without concurrent
+ * managed access (e.g. on Windows) the hints are skipped.  Nothing is cached, each
+ * allocation is a cudaMallocManaged.
+ */
+class ManagedMemoryResource : public DeviceMemoryResource {
+ public:
+  void* Allocate(size_t bytes, cudaStream_t stream) override {
+    void* ptr {nullptr};
+    if (bytes == 0) {
+      return ptr;
+    }
+    safe_cuda(cudaMallocManaged(&ptr, bytes));
+    int device;
+    safe_cuda(cudaGetDevice(&device));
+    int concurrent {0};
+    safe_cuda(cudaDeviceGetAttribute(&concurrent, cudaDevAttrConcurrentManagedAccess,
+                                     device));
+    if (concurrent != 0) {
+      safe_cuda(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation, device));
+      safe_cuda(cudaMemPrefetchAsync(ptr, bytes, device, stream));
+    }
+    allocated_bytes_ += bytes;
+    return ptr;
+  }
+  void Deallocate(void* ptr, size_t bytes, cudaStream_t stream) override {
+    if (ptr == nullptr) {
+      return;
+    }
+    safe_cuda(cudaFree(ptr));
+    allocated_bytes_ -= bytes;
+  }
+  std::string Stats() const override {
+    std::stringstream ss;
+    ss << (allocated_bytes_.load() >> 20) << "MiB managed";
+    return ss.str();
+  }
+
+ private:
+  std::atomic<size_t> allocated_bytes_ {0};
+};
+
+namespace detail {
+inline std::shared_ptr<DeviceMemoryResource>& GlobalMemoryResourcePtr() {
+  // Never destroyed, device containers may outlive static destruction.
+  static auto* resource =
+      new std::shared_ptr<DeviceMemoryResource>(new PoolMemoryResource());
+  return *resource;
+}
+/*! \brief Number of allocations not yet returned to the memory resource. */
+inline std::atomic<int64_t>& LiveAllocations() {
+  static std::atomic<int64_t> n_live {0};
+  return n_live;
+}
+}  // namespace detail
+
+/*! \brief The memory resource used by device containers. */
+inline DeviceMemoryResource* GlobalMemoryResource() {
+  return detail::GlobalMemoryResourcePtr().get();
+}
+
+/*!
+ * \brief Replace the memory resource of device containers.  Must be called while no
+ *        memory from the current resource is in use, typically before training starts.
+ */
+void SetDeviceMemoryResource(std::shared_ptr<DeviceMemoryResource> resource);
+
+/*! \brief Limit the bytes cached by the default pool, on every device. */
+void SetMemoryPoolSize(size_t max_cached_bytes);
+
+inline void detail::MemoryLogger::Log() {
+  if (!xgboost::ConsoleLogger::ShouldLog(xgboost::ConsoleLogger::LV::kDebug))
+    return;
+  std::lock_guard<std::mutex> guard(mutex_);
+  int current_device;
+  safe_cuda(cudaGetDevice(&current_device));
+  LOG(CONSOLE) << "======== Device " << current_device << " Memory Allocations: "
+    << " ========";
+  LOG(CONSOLE) << "Peak memory usage: "
+    << stats_.peak_allocated_bytes / 1048576 << "MiB";
+  LOG(CONSOLE) << "Number of allocations: " << stats_.num_allocations;
+  LOG(CONSOLE) << "Memory pool: " << GlobalMemoryResource()->Stats();
+}
+
 // dh::DebugSyncDevice(__FILE__, __LINE__);
 inline void DebugSyncDevice(std::string file="", int32_t line = -1) {
   if (file != "" && line != -1) {
@@ -410,7 +572,8 @@ inline void DebugSyncDevice(std::string file="", int32_t line = -1) {
 
 namespace detail{
 /**
- * \brief Default memory allocator, uses cudaMalloc/Free and logs allocations if verbose.
+ * \brief Default memory allocator, allocates from the global memory resource and logs
+ * allocations if verbose.
  */
 template <class T>
 struct XGBDefaultDeviceAllocatorImpl : thrust::device_malloc_allocator<T> {
@@ -422,46 +585,30 @@ struct XGBDefaultDeviceAllocatorImpl : thrust::device_malloc_allocator<T> {
     typedef XGBDefaultDeviceAllocatorImpl<U> other;
   };
   pointer allocate(size_t n) {
-    pointer ptr = super_t::allocate(n);
+    pointer ptr(static_cast<T*>(GlobalMemoryResource()->Allocate(n * sizeof(T), nullptr)));
+    LiveAllocations()++;
     GlobalMemoryLogger().RegisterAllocation(ptr.get(), n * sizeof(T));
     return ptr;
   }
   void deallocate(pointer ptr, size_t n) {
     GlobalMemoryLogger().RegisterDeallocation(ptr.get(), n * sizeof(T));
-    return super_t::deallocate(ptr, n);
+    GlobalMemoryResource()->Deallocate(ptr.get(), n * sizeof(T), nullptr);
+    LiveAllocations()--;
   }
 };
 
 /**
- * \brief Caching memory allocator, uses cub::CachingDeviceAllocator as a back-end and logs allocations if verbose. Does not initialise memory on construction.
+ * \brief Caching memory allocator, same as the default allocator but does not initialise
+ * memory on construction.
  */
 template <class T>
-struct XGBCachingDeviceAllocatorImpl : thrust::device_malloc_allocator<T> {
+struct XGBCachingDeviceAllocatorImpl : XGBDefaultDeviceAllocatorImpl<T> {
   using pointer = thrust::device_ptr<T>;
   template<typename U>
   struct rebind
   {
     typedef XGBCachingDeviceAllocatorImpl<U> other;
   };
-   cub::CachingDeviceAllocator& GetGlobalCachingAllocator ()
-   {
-     // Configure allocator with maximum cached bin size of ~1GB and no limit on
-     // maximum cached bytes
-     static cub::CachingDeviceAllocator *allocator = new cub::CachingDeviceAllocator(2, 9, 29);
-     return *allocator;
-   }
-   pointer allocate(size_t n) {
-     T *ptr;
-     GetGlobalCachingAllocator().DeviceAllocate(reinterpret_cast<void **>(&ptr),
-                                                n * sizeof(T));
-     pointer thrust_ptr(ptr);
-     GlobalMemoryLogger().RegisterAllocation(thrust_ptr.get(), n * sizeof(T));
-     return thrust_ptr;
-   }
-   void deallocate(pointer ptr, size_t n) {
-     GlobalMemoryLogger().RegisterDeallocation(ptr.get(), n * sizeof(T));
-     GetGlobalCachingAllocator().DeviceFree(ptr.get());
-   }
   __host__ __device__
     void construct(T *)
   {
@@ -1065,6 +1212,69 @@ class SaveCudaContext {
   }
 };
 
+/**
+ * \brief Cache of CUDA graphs keyed by the launch shape of a recorded sequence.
+ *
+ * A sequence is captured from `stream` the first time its key is seen and replayed
+ * afterwards.  Recorded launches must read everything that changes between replays
+ * from device buffers with stable addresses; the caller clears the cache whenever one
+ * of those buffers is reallocated.
+ */
+class CudaGraphCache {
+ public:
+  using Key = std::vector<size_t>;
+
+  CudaGraphCache() = default;
+  CudaGraphCache(CudaGraphCache const&) = delete;
+  CudaGraphCache& operator=(CudaGraphCache const&) = delete;
+  ~CudaGraphCache() { this->Clear(); }
+
+  /*!
+   * \brief Launch the graph of `key` in `stream`, capturing it from `record` first if
+   *        necessary.  `record` is called with the stream to enqueue its work on.
+   */
+  template <typename RecordFn>
+  void Launch(Key const& key, cudaStream_t stream, RecordFn record) {
+#if CUDART_VERSION >= 10000
+    auto it = graphs_.find(key);
+    if (it == graphs_.cend()) {
+      if (graphs_.size() >= kMaxGraphs) {
+        this->Clear();
+      }
+      cudaGraph_t graph;
+      cudaGraphExec_t exec;
+      safe_cuda(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+      record(stream);
+      safe_cuda(cudaStreamEndCapture(stream, &graph));
+      safe_cuda(cudaGraphInstantiate(&exec, graph, nullptr, nullptr, 0));
+      safe_cuda(cudaGraphDestroy(graph));
+      it = graphs_.emplace(key, exec).first;
+    }
+    safe_cuda(cudaGraphLaunch(it->second, stream));
+#else
+    LOG(FATAL) << "CUDA graphs require CUDA 10.0 or later.";
+#endif  // CUDART_VERSION >= 10000
+  }
+
+  void Clear() {
+#if CUDART_VERSION >= 10000
+    for (auto& kv : graphs_) {
+      safe_cuda(cudaGraphExecDestroy(kv.second));
+    }
+#endif  // CUDART_VERSION >= 10000
+    graphs_.clear();
+  }
+  size_t Size() const { return graphs_.size(); }
+
+ private:
+  static size_t constexpr kMaxGraphs = 256;
+#if CUDART_VERSION >= 10000
+  std::map<Key, cudaGraphExec_t> graphs_;
+#else
+  std::map<Key, void*> graphs_;
+#endif  // CUDART_VERSION >= 10000
+};
+
 /**
  * \class AllReducer
  *
@@ -1076,6 +1286,8 @@ class AllReducer {
   bool initialised_;
   size_t allreduce_bytes_;  // Keep statistics of the number of bytes communicated
   size_t allreduce_calls_;  // Keep statistics of the number of reduce calls
+  bool in_group_ {false};    // Collectives are queued until GroupEnd
+  bool group_used_ {false};
   std::vector<size_t> host_data;  // Used for all reduce on host
 #ifdef XGBOOST_USE_NCCL
   ncclComm_t comm;
@@ -1088,6 +1300,19 @@ class AllReducer {
   AllReducer() : initialised_(false), allreduce_bytes_(0),
                  allreduce_calls_(0) {}
 
+ private:
+  void Record(size_t bytes) {
+    allreduce_bytes_ += bytes;
+    xgboost::common::Telemetry::AddAllreduceBytes(bytes);
+    if (in_group_) {
+      group_used_ = true;
+    } else {
+      allreduce_calls_ += 1;
+    }
+  }
+
+ public:
+
   /**
    * \brief Initialise with the desired device ordinal for this communication
    * group.
@@ -1096,6 +1321,17 @@ class AllReducer {
    */
   void Init(int _device_ordinal);
 
+  /**
+   * \brief Initialise one communication group spanning several devices of this
+   * process, with one reducer for each device.  Every rabit worker must use the
+   * same number of devices.  Reducers are used from one host thread each.
+   *
+   * \param devices   The device ordinals.
+   * \param reducers  Output, one reducer for each device.
+   */
+  static void InitGroup(std::vector<int> const& devices,
+                        std::vector<std::unique_ptr<AllReducer>>* reducers);
+
   ~AllReducer();
 
   /**
@@ -1112,8 +1348,7 @@ class AllReducer {
     CHECK(initialised_);
     dh::safe_cuda(cudaSetDevice(device_ordinal));
     dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclDouble, ncclSum, comm, stream));
-    allreduce_bytes_ += count * sizeof(double);
-    allreduce_calls_ += 1;
+    this->Record(count * sizeof(double));
 #endif
   }
 
@@ -1131,8 +1366,7 @@ class AllReducer {
     CHECK(initialised_);
     dh::safe_cuda(cudaSetDevice(device_ordinal));
     dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclFloat, ncclSum, comm, stream));
-    allreduce_bytes_ += count * sizeof(float);
-    allreduce_calls_ += 1;
+    this->Record(count * sizeof(float));
 #endif
   }
 
@@ -1152,9 +1386,43 @@ class AllReducer {
 
     dh::safe_cuda(cudaSetDevice(device_ordinal));
     dh::safe_nccl(ncclAllReduce(sendbuff, recvbuff, count, ncclInt64, ncclSum, comm, stream));
+    this->Record(count * sizeof(int64_t));
+#endif
+  }
+
+  /**
+   * \brief Queue the following allreduce calls until `GroupEnd', so NCCL launches them
+   *  as one collective instead of paying the latency of each.  Buffers can not be read
+   *  before `GroupEnd' followed by `Synchronize'.
+   */
+  void GroupStart() {
+#ifdef XGBOOST_USE_NCCL
+    CHECK(initialised_);
+    CHECK(!in_group_);
+    dh::safe_nccl(ncclGroupStart());
+    in_group_ = true;
+    group_used_ = false;
 #endif
   }
 
+  /*! \brief Launch the calls queued since `GroupStart', counted as a single call. */
+  void GroupEnd() {
+#ifdef XGBOOST_USE_NCCL
+    CHECK(in_group_);
+    dh::safe_cuda(cudaSetDevice(device_ordinal));
+    dh::safe_nccl(ncclGroupEnd());
+    in_group_ = false;
+    if (group_used_) {
+      allreduce_calls_ += 1;
+    }
+#endif
+  }
+
+  /*! \brief Bytes sent through the allreduce calls so far. */
+  size_t AllReduceBytes() const { return allreduce_bytes_; }
+  /*! \brief Number of collectives launched so far, a group counting as one. */
+  size_t AllReduceCalls() const { return allreduce_calls_; }
+
   /**
    * \fn  void Synchronize()
    *
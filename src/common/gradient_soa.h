@@ -0,0 +1,80 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file gradient_soa.h
+ * \brief Gradient pairs split into an array of gradients and an array of hessians.
+ */
+#ifndef XGBOOST_COMMON_GRADIENT_SOA_H_
+#define XGBOOST_COMMON_GRADIENT_SOA_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
+
+#include <utility>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief Gradients and hessians of the rows in two arrays, so kernels stream each of them
+ *  with unit stride.  When all hessians are the same, as for squared error without
+ *  weights, only that value is kept and reading hessians costs nothing.
+ */
+class GradientSoA {
+ public:
+  /*! \brief Split gpair, keeping a single hessian when they are all equal. */
+  void Init(std::vector<GradientPair> const& gpair, int32_t n_threads) {
+    const size_t n = gpair.size();
+    const float hess0 = n == 0 ? 0.0f : gpair[0].GetHess();
+    grad_.resize(n);
+    bool constant = true;
+    #pragma omp parallel for num_threads(n_threads) schedule(static) reduction(&&: constant)
+    for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+      grad_[i] = gpair[i].GetGrad();
+      constant = constant && gpair[i].GetHess() == hess0;
+    }
+    constant_hess_ = constant;
+    hess_value_ = hess0;
+    if (constant) {
+      hess_.clear();
+      return;
+    }
+    hess_.resize(n);
+    #pragma omp parallel for num_threads(n_threads) schedule(static)
+    for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+      hess_[i] = gpair[i].GetHess();
+    }
+  }
+  /*!
+   * \brief Take the gradients of an objective whose hessian is known to be the same for
+   *  every row, without looking at the hessians.
+   */
+  void Init(std::vector<float>&& grad, float hess) {
+    grad_ = std::move(grad);
+    hess_.clear();
+    constant_hess_ = true;
+    hess_value_ = hess;
+  }
+
+  size_t Size() const { return grad_.size(); }
+  float const* Grad() const { return grad_.data(); }
+  /*! \brief Hessians of the rows, nullptr when they are constant. */
+  float const* Hess() const { return constant_hess_ ? nullptr : hess_.data(); }
+  bool ConstantHess() const { return constant_hess_; }
+  /*! \brief The hessian of every row when ConstantHess() is true. */
+  float HessValue() const { return hess_value_; }
+
+  GradientPair operator[](size_t i) const {
+    return GradientPair(grad_[i], constant_hess_ ? hess_value_ : hess_[i]);
+  }
+
+ private:
+  std::vector<float> grad_;
+  std::vector<float> hess_;
+  bool constant_hess_ {true};
+  float hess_value_ {0.0f};
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_GRADIENT_SOA_H_
@@ -0,0 +1,166 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file hist_batch.cc
+ */
+#include "hist_batch.h"
+
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <utility>
+
+#include "common.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+// Rows of a block are added to the histograms of every booster before the next block.
+constexpr size_t kBlockRows = 256;
+// Bins merged by a task when the histograms of the threads are added up.
+constexpr size_t kReduceBins = 1024;
+
+struct BatchRegistry {
+  std::mutex lock;
+  std::map<std::string, std::shared_ptr<HistBatch>> batches;
+  uint64_t next_id {0};
+};
+
+BatchRegistry& Registry() {
+  static BatchRegistry registry;
+  return registry;
+}
+}  // anonymous namespace
+
+std::string HistBatch::Register(std::shared_ptr<HistBatch> batch) {
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  std::string name = "hist_batch_" + std::to_string(registry.next_id++);
+  registry.batches[name] = std::move(batch);
+  return name;
+}
+
+void HistBatch::Unregister(std::string const& name) {
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.batches.erase(name);
+}
+
+std::shared_ptr<HistBatch> HistBatch::Find(std::string const& name) {
+  if (name.empty()) {
+    return nullptr;
+  }
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  auto it = registry.batches.find(name);
+  return it == registry.batches.cend() ? nullptr : it->second;
+}
+
+void HistBatch::BuildRoot(GHistIndexMatrix const& gmat, std::vector<GradientPair> const* gpair,
+                          GHistRow<double> hist) {
+  std::unique_lock<std::mutex> guard(lock_);
+  if (gpair != nullptr) {
+    pending_.push_back({&gmat, gpair, hist});
+  }
+  ++n_arrived_;
+  if (n_arrived_ < n_participants_) {
+    uint64_t const generation = generation_;
+    done_.wait(guard, [&]() { return generation_ != generation; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return;
+  }
+  auto error = this->Flush();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void HistBatch::Leave() {
+  std::lock_guard<std::mutex> guard(lock_);
+  CHECK_GT(n_participants_, 0);
+  --n_participants_;
+  if (n_arrived_ != 0 && n_arrived_ >= n_participants_) {
+    // the others were only waiting for this booster, errors are raised by them
+    this->Flush();
+  }
+}
+
+std::exception_ptr HistBatch::Flush() {
+  std::exception_ptr error;
+  try {
+    this->Build(pending_);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  pending_.clear();
+  n_arrived_ = 0;
+  error_ = error;
+  ++generation_;
+  done_.notify_all();
+  return error;
+}
+
+void HistBatch::Build(std::vector<Request> const& requests) {
+  std::vector<bool> built(requests.size(), false);
+  for (size_t first = 0; first < requests.size(); ++first) {
+    if (built[first]) {
+      continue;
+    }
+    GHistIndexMatrix const& gmat = *requests[first].gmat;
+    std::vector<Request const*> group;
+    for (size_t i = first; i < requests.size(); ++i) {
+      if (!built[i] && requests[i].gmat == &gmat) {
+        group.push_back(&requests[i]);
+        built[i] = true;
+      }
+    }
+
+    size_t const n_rows = gmat.row_ptr.size() - 1;
+    if (rows_.size() != n_rows) {
+      rows_.resize(n_rows);
+      std::iota(rows_.begin(), rows_.end(), size_t{0});
+    }
+    size_t const n_bins = gmat.cut.Ptrs().back();
+    size_t const n_hists = group.size();
+    GHistBuilder<double> builder(n_threads_, static_cast<uint32_t>(n_bins));
+    // histograms of each thread for every booster, allocated by the threads using them
+    std::vector<std::vector<tree::GradStatsT<double>>> local(n_threads_ * n_hists);
+    size_t const n_blocks = DivRoundUp(n_rows, kBlockRows);
+#pragma omp parallel num_threads(n_threads_)
+    {
+      size_t const tid = omp_get_thread_num();
+#pragma omp for schedule(static)
+      for (omp_ulong block = 0; block < n_blocks; ++block) {  // NOLINT(*)
+        size_t const begin = block * kBlockRows;
+        size_t const end = std::min(begin + kBlockRows, n_rows);
+        RowSetCollection::Elem rows(rows_.data() + begin, rows_.data() + end, 0);
+        for (size_t h = 0; h < n_hists; ++h) {
+          auto& hist = local[tid * n_hists + h];
+          if (hist.empty()) {
+            hist.resize(n_bins);
+          }
+          builder.BuildHist(*group[h]->gpair, rows, gmat, GHistRow<double>{hist.data(), n_bins});
+        }
+      }
+    }
+
+    size_t const n_bin_blocks = DivRoundUp(n_bins, kReduceBins);
+#pragma omp parallel for num_threads(n_threads_) schedule(static)
+    for (omp_ulong task = 0; task < n_hists * n_bin_blocks; ++task) {  // NOLINT(*)
+      size_t const h = task / n_bin_blocks;
+      size_t const begin = (task % n_bin_blocks) * kReduceBins;
+      size_t const end = std::min(begin + kReduceBins, n_bins);
+      for (int32_t tid = 0; tid < n_threads_; ++tid) {
+        auto& hist = local[tid * n_hists + h];
+        if (!hist.empty()) {
+          IncrementHist(group[h]->hist, GHistRow<double>{hist.data(), n_bins}, begin, end);
+        }
+      }
+    }
+  }
+}
+}  // namespace common
+}  // namespace xgboost
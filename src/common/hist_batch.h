@@ -0,0 +1,81 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file hist_batch.h
+ * \brief Root histograms of several boosters training on the same quantized matrix, built
+ *  in one pass over its rows.
+ */
+#ifndef XGBOOST_COMMON_HIST_BATCH_H_
+#define XGBOOST_COMMON_HIST_BATCH_H_
+
+#include <xgboost/base.h>
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hist_util.h"
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief Rendezvous of boosters trained at the same time on one matrix, see `TrainBatched'.
+ *
+ *  The root histogram of a tree covers every row, whatever the parameters of the booster.
+ *  Each booster hands in its gradients and waits, the last one to arrive builds all the
+ *  histograms with the threads of the whole batch.  Rows are taken one block at a time
+ *  and the block is added to the histogram of every booster in turn, so its bins are
+ *  read from memory once instead of once for every booster.
+ *
+ *  Boosters that build a root histogram on their own still arrive, without gradients,
+ *  and those done with training leave, so nobody waits for a booster that won't come.
+ */
+class HistBatch {
+ public:
+  HistBatch(size_t n_participants, int32_t n_threads)
+      : n_participants_{n_participants}, n_threads_{n_threads} {}
+
+  /*! \brief Make the batch available to `Find', under the returned name. */
+  static std::string Register(std::shared_ptr<HistBatch> batch);
+  static void Unregister(std::string const& name);
+  /*! \brief The batch registered under name, nullptr if there's none. */
+  static std::shared_ptr<HistBatch> Find(std::string const& name);
+
+  /*!
+   * \brief Arrive with the root histogram of one booster and return once it's built.
+   * \param gmat  quantized matrix, boosters with different matrices are built separately.
+   * \param gpair gradient of every row, nullptr when the booster builds its own histogram.
+   * \param hist  zero filled histogram to add the rows to.
+   */
+  void BuildRoot(GHistIndexMatrix const& gmat, std::vector<GradientPair> const* gpair,
+                 GHistRow<double> hist);
+  /*! \brief A booster done with training, the batch no longer waits for it. */
+  void Leave();
+
+ private:
+  struct Request {
+    GHistIndexMatrix const* gmat;
+    std::vector<GradientPair> const* gpair;
+    GHistRow<double> hist;
+  };
+  // build the pending histograms and wake the waiting boosters, with lock_ held
+  std::exception_ptr Flush();
+  void Build(std::vector<Request> const& requests);
+
+  std::mutex lock_;
+  std::condition_variable done_;
+  std::vector<Request> pending_;
+  size_t n_arrived_ {0};
+  size_t n_participants_;
+  int32_t n_threads_;
+  // number of times histograms were built, waiting boosters watch it
+  uint64_t generation_ {0};
+  std::exception_ptr error_;
+  // 0, 1, ... n_rows - 1, the rows of the root
+  std::vector<size_t> rows_;
+};
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_HIST_BATCH_H_
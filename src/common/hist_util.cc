@@ -6,7 +6,12 @@
 #include <dmlc/omp.h>
 
 #include <rabit/rabit.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <numeric>
+#include <utility>
 #include <vector>
 
 #include "xgboost/base.h"
@@ -26,6 +31,18 @@
   #define PREFETCH_READ_T0(addr) do {} while (0)
 #endif  // defined(XGBOOST_MM_PREFETCH_PRESENT)
 
+// Histogram kernels are compiled once per instruction set and selected at run time,
+// so the same binary can use AVX2/AVX-512 where the CPU has them.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define XGBOOST_HIST_MULTI_ISA 1
+  #define XGBOOST_HIST_INLINE inline __attribute__((always_inline))
+  #define XGBOOST_TARGET_AVX2 __attribute__((target("avx2")))
+  #define XGBOOST_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+  #define XGBOOST_HIST_MULTI_ISA 0
+  #define XGBOOST_HIST_INLINE inline
+#endif  // x86 with GNU extensions
+
 namespace xgboost {
 namespace common {
 
@@ -55,6 +72,47 @@ void HistogramCuts::Build(DMatrix* dmat, uint32_t const max_num_bins) {
   LOG(INFO) << "Total number of hist bins: " << cut_ptrs_.back();
 }
 
+namespace {
+std::atomic<SketchMethod>& CurrentSketchMethod() {
+  static std::atomic<SketchMethod> method {SketchMethod::kWQ};
+  return method;
+}
+
+/*!
+ * \brief Sketch one column of a CSC page.  The sketch lives only as long as the column
+ *  is sketched, so the compact sketch doesn't need to be kept for every feature.
+ */
+template <typename Sketch>
+void SketchColumn(common::Span<xgboost::Entry const> column, MetaInfo const& info,
+                  size_t base_rowid, bool use_group_ind, double eps,
+                  CutsBuilder::WQSketch::SummaryContainer* out) {
+  std::vector<bst_uint> const& group_ptr = info.group_ptr_;
+  Sketch sketch;
+  sketch.Init(info.num_row_, eps);
+  for (auto const& entry : column) {
+    uint32_t weight_ind = 0;
+    if (use_group_ind) {
+      auto row_idx = entry.index;
+      uint32_t group_ind =
+          CutsBuilder::SearchGroupIndFromRow(group_ptr, base_rowid + row_idx);
+      weight_ind = group_ind;
+    } else {
+      weight_ind = entry.index;
+    }
+    sketch.Push(entry.fvalue, info.GetWeight(weight_ind));
+  }
+  sketch.GetSummary(out);
+}
+}  // anonymous namespace
+
+void SetSketchMethod(SketchMethod method) {
+  CurrentSketchMethod() = method;
+}
+
+SketchMethod GetSketchMethod() {
+  return CurrentSketchMethod();
+}
+
 bool CutsBuilder::UseGroup(DMatrix* dmat) {
   auto& info = dmat->Info();
   size_t const num_groups = info.group_ptr_.size() == 0 ?
@@ -73,13 +131,9 @@ void SparseCuts::SingleThreadBuild(SparsePage const& page, MetaInfo const& info,
   CHECK_GE(end_col, beg_col);
   constexpr float kFactor = 8;
 
-  // Data groups, used in ranking.
-  std::vector<bst_uint> const& group_ptr = info.group_ptr_;
   p_cuts_->min_vals_.resize(end_col - beg_col, 0);
 
   for (uint32_t col_id = beg_col; col_id < page.Size() && col_id < end_col; ++col_id) {
-    // Using a local variable makes things easier, but at the cost of memory trashing.
-    WQSketch sketch;
     common::Span<xgboost::Entry const> const column = page[col_id];
     uint32_t const n_bins = std::min(static_cast<uint32_t>(column.size()),
                                      max_num_bins);
@@ -89,22 +143,16 @@ void SparseCuts::SingleThreadBuild(SparsePage const& page, MetaInfo const& info,
       continue;
     }
 
-    sketch.Init(info.num_row_, 1.0 / (n_bins * kFactor));
-    for (auto const& entry : column) {
-      uint32_t weight_ind = 0;
-      if (use_group_ind) {
-        auto row_idx = entry.index;
-        uint32_t group_ind =
-            this->SearchGroupIndFromRow(group_ptr, page.base_rowid + row_idx);
-        weight_ind = group_ind;
-      } else {
-        weight_ind = entry.index;
-      }
-      sketch.Push(entry.fvalue, info.GetWeight(weight_ind));
-    }
-
+    // Using a local sketch makes things easier, but at the cost of memory trashing.
     WQSketch::SummaryContainer out_summary;
-    sketch.GetSummary(&out_summary);
+    double const eps = 1.0 / (n_bins * kFactor);
+    if (GetSketchMethod() == SketchMethod::kCompact) {
+      SketchColumn<CompactSketch>(column, info, page.base_rowid, use_group_ind, eps,
+                                  &out_summary);
+    } else {
+      SketchColumn<WQSketch>(column, info, page.base_rowid, use_group_ind, eps,
+                             &out_summary);
+    }
     WQSketch::SummaryContainer summary;
     summary.Reserve(n_bins + 1);
     summary.SetPrune(out_summary, n_bins + 1);
@@ -114,13 +162,17 @@ void SparseCuts::SingleThreadBuild(SparsePage const& page, MetaInfo const& info,
     float mval = summary.data[0].value;
     p_cuts_->min_vals_[col_id - beg_col]  = mval - (fabs(mval) + 1e-5);
 
-    this->AddCutPoint(summary, max_num_bins);
+    if (this->IsCategorical(col_id)) {
+      this->AddCategories(summary);
+    } else {
+      this->AddCutPoint(summary, max_num_bins);
 
-    bst_float cpt = (summary.size > 0) ?
-                    summary.data[summary.size - 1].value :
-                    p_cuts_->min_vals_[col_id - beg_col];
-    cpt += fabs(cpt) + 1e-5;
-    p_cuts_->cut_values_.emplace_back(cpt);
+      bst_float cpt = (summary.size > 0) ?
+                      summary.data[summary.size - 1].value :
+                      p_cuts_->min_vals_[col_id - beg_col];
+      cpt += fabs(cpt) + 1e-5;
+      p_cuts_->cut_values_.emplace_back(cpt);
+    }
 
     p_cuts_->cut_ptrs_.emplace_back(p_cuts_->cut_values_.size());
   }
@@ -167,6 +219,7 @@ void SparseCuts::Build(DMatrix* dmat, uint32_t const max_num_bins) {
   std::vector<std::unique_ptr<SparseCuts>> sparse_cuts(nthreads);
   for (size_t i = 0; i < nthreads; ++i) {
     sparse_cuts[i].reset(new SparseCuts(&cuts_containers[i]));
+    sparse_cuts[i]->SetFeatureTypes(dmat->Info().feature_types.ConstHostVector());
   }
 
   for (auto const& page : dmat->GetBatches<CSCPage>()) {
@@ -227,22 +280,31 @@ void SparseCuts::Concat(
   monitor_.Stop(__FUNCTION__);
 }
 
-void DenseCuts::Build(DMatrix* p_fmat, uint32_t max_num_bins) {
-  monitor_.Start(__FUNCTION__);
+template <typename Sketch>
+void DenseCuts::SketchBlocks(DMatrix* p_fmat, uint32_t max_num_bins, size_t n_row_blocks,
+                             std::vector<WQSketch::SummaryContainer>* out) {
   const MetaInfo& info = p_fmat->Info();
-
   // safe factor for better accuracy
   constexpr int kFactor = 8;
-  std::vector<WQSketch> sketchs;
-
   const int nthread = omp_get_max_threads();
-
-  unsigned const nstep =
-      static_cast<unsigned>((info.num_col_ + nthread - 1) / nthread);
   unsigned const ncol = static_cast<unsigned>(info.num_col_);
-  sketchs.resize(info.num_col_);
-  for (auto& s : sketchs) {
-    s.Init(info.num_row_, 1.0 / (max_num_bins * kFactor));
+
+  // Sketch a grid of row blocks x column blocks, one task per cell.  Splitting rows as
+  // well as columns keeps every thread busy on narrow data and stops each thread from
+  // scanning every entry of the batch; each row block owns its own set of sketches.
+  // sketches of different row blocks are merged with rounding
+  size_t const n_col_blocks =
+      std::max<size_t>(std::min<size_t>(common::DivRoundUp(nthread, n_row_blocks), ncol), 1);
+  unsigned const nstep = static_cast<unsigned>(common::DivRoundUp(ncol, n_col_blocks));
+  size_t const block_max_rows =
+      std::max<size_t>(common::DivRoundUp(info.num_row_, n_row_blocks), 1);
+
+  std::vector<std::vector<Sketch>> sketchs(n_row_blocks);
+  for (auto& block : sketchs) {
+    block.resize(info.num_col_);
+    for (auto& s : block) {
+      s.Init(block_max_rows, 1.0 / (max_num_bins * kFactor));
+    }
   }
 
   // Data groups, used in ranking.
@@ -252,44 +314,123 @@ void DenseCuts::Build(DMatrix* p_fmat, uint32_t max_num_bins) {
   bool const use_group = UseGroup(p_fmat);
 
   for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
-    size_t group_ind = 0;
-    if (use_group) {
-      group_ind = this->SearchGroupIndFromRow(group_ptr, batch.base_rowid);
-    }
-#pragma omp parallel num_threads(nthread) firstprivate(group_ind, use_group)
-    {
-      CHECK_EQ(nthread, omp_get_num_threads());
-      auto tid = static_cast<unsigned>(omp_get_thread_num());
-      unsigned begin = std::min(nstep * tid, ncol);
-      unsigned end = std::min(nstep * (tid + 1), ncol);
-
-      // do not iterate if no columns are assigned to the thread
-      if (begin < end && end <= ncol) {
-        for (size_t i = 0; i < batch.Size(); ++i) { // NOLINT(*)
-          size_t const ridx = batch.base_rowid + i;
-          SparsePage::Inst const inst = batch[i];
-          if (use_group &&
-              group_ptr[group_ind] == ridx &&
-              // maximum equals to weights.size() - 1
-              group_ind < num_groups - 1) {
-            // move to next group
-            group_ind++;
-          }
-          for (auto const& entry : inst) {
-            if (entry.index >= begin && entry.index < end) {
-              size_t w_idx = use_group ? group_ind : ridx;
-              sketchs[entry.index].Push(entry.fvalue, info.GetWeight(w_idx));
-            }
+    size_t const batch_size = batch.Size();
+    size_t const rstep = common::DivRoundUp(batch_size, n_row_blocks);
+    size_t const n_tasks = n_row_blocks * n_col_blocks;
+#pragma omp parallel for num_threads(nthread) schedule(dynamic)
+    for (omp_ulong task = 0; task < n_tasks; ++task) {  // NOLINT(*)
+      size_t const rblock = task / n_col_blocks;
+      size_t const cblock = task % n_col_blocks;
+      size_t const rbegin = std::min(rstep * rblock, batch_size);
+      size_t const rend = std::min(rstep * (rblock + 1), batch_size);
+      unsigned const begin = std::min(static_cast<unsigned>(nstep * cblock), ncol);
+      unsigned const end = std::min(static_cast<unsigned>(nstep * (cblock + 1)), ncol);
+      // do not iterate if no rows or columns are assigned to the task
+      if (rbegin >= rend || begin >= end) {
+        continue;
+      }
+      std::vector<Sketch>& block_sketchs = sketchs[rblock];
+      size_t group_ind = 0;
+      if (use_group) {
+        // Same group as a sequential scan of the batch would reach at `rbegin'.
+        auto it = std::lower_bound(group_ptr.cbegin(), group_ptr.cend() - 1,
+                                   batch.base_rowid + rbegin);
+        group_ind = std::min(static_cast<size_t>(std::distance(group_ptr.cbegin(), it)),
+                             num_groups - 1);
+      }
+      for (size_t i = rbegin; i < rend; ++i) {
+        size_t const ridx = batch.base_rowid + i;
+        SparsePage::Inst const inst = batch[i];
+        if (use_group &&
+            group_ptr[group_ind] == ridx &&
+            // maximum equals to weights.size() - 1
+            group_ind < num_groups - 1) {
+          // move to next group
+          group_ind++;
+        }
+        for (auto const& entry : inst) {
+          if (entry.index >= begin && entry.index < end) {
+            size_t w_idx = use_group ? group_ind : ridx;
+            block_sketchs[entry.index].Push(entry.fvalue, info.GetWeight(w_idx));
           }
         }
       }
     }
   }
 
-  Init(&sketchs, max_num_bins, info.num_row_);
+  MergeBlocks(&sketchs, out);
+}
+
+void DenseCuts::Build(DMatrix* p_fmat, uint32_t max_num_bins) {
+  monitor_.Start(__FUNCTION__);
+  const MetaInfo& info = p_fmat->Info();
+  this->SetFeatureTypes(info.feature_types.ConstHostVector());
+  std::vector<WQSketch::SummaryContainer> summaries;
+  if (GetSketchMethod() == SketchMethod::kCompact) {
+    // sharded by feature, each thread holds the sketches of its own features only
+    this->SketchBlocks<CompactSketch>(p_fmat, max_num_bins, 1, &summaries);
+  } else {
+    size_t const nthread = omp_get_max_threads();
+    size_t const n_row_blocks =
+        RowBlocks(IsDeterministic() ? kDeterministicThreads : nthread, info.num_col_,
+                  info.num_row_);
+    this->SketchBlocks<WQSketch>(p_fmat, max_num_bins, n_row_blocks, &summaries);
+  }
+  Init(&summaries, max_num_bins, info.num_row_);
   monitor_.Stop(__FUNCTION__);
 }
 
+template <typename Sketch>
+void DenseCuts::MergeBlocks(std::vector<std::vector<Sketch>>* p_sketchs,
+                            std::vector<WQSketch::SummaryContainer>* out) {
+  auto& sketchs = *p_sketchs;
+  size_t const n_row_blocks = sketchs.size();
+  CHECK_GT(n_row_blocks, 0);
+  size_t const ncol = sketchs.front().size();
+  // Merge the summaries of the row blocks pairwise, in parallel over features.
+  std::vector<WQSketch::SummaryContainer>& summaries = *out;
+  summaries.resize(ncol);
+#pragma omp parallel for schedule(dynamic)
+  for (omp_ulong fid = 0; fid < ncol; ++fid) {  // NOLINT(*)
+    std::vector<WQSketch::SummaryContainer> blocks(n_row_blocks);
+    for (size_t r = 0; r < n_row_blocks; ++r) {
+      sketchs[r][fid].GetSummary(&blocks[r]);
+    }
+    WQSketch::SummaryContainer combined;
+    for (size_t stride = 1; stride < n_row_blocks; stride *= 2) {
+      for (size_t r = 0; r + stride < n_row_blocks; r += 2 * stride) {
+        auto& lhs = blocks[r];
+        auto& rhs = blocks[r + stride];
+        size_t const limit = std::max(lhs.size, rhs.size);
+        combined.Reserve(lhs.size + rhs.size);
+        combined.SetCombine(lhs, rhs);
+        lhs.Reserve(limit);
+        lhs.SetPrune(combined, limit);
+      }
+    }
+    summaries[fid].Reserve(blocks[0].size);
+    summaries[fid].CopyFrom(blocks[0]);
+  }
+}
+
+template void DenseCuts::MergeBlocks(std::vector<std::vector<WQSketch>>* sketchs,
+                                     std::vector<WQSketch::SummaryContainer>* out);
+template void DenseCuts::MergeBlocks(std::vector<std::vector<CompactSketch>>* sketchs,
+                                     std::vector<WQSketch::SummaryContainer>* out);
+
+size_t DenseCuts::RowBlocks(size_t nthread, size_t ncol, size_t nrow) {
+  // Each row block holds a full set of sketches, so only split rows as far as needed to
+  // give every thread a share of the entries: sqrt(nthread) blocks, or more when there
+  // are fewer columns than threads.
+  constexpr size_t kMinBlockRows = 1024;
+  size_t n_blocks = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nthread))));
+  if (ncol != 0 && ncol < nthread) {
+    n_blocks = std::max(n_blocks, common::DivRoundUp(nthread, ncol));
+  }
+  n_blocks = std::min(n_blocks, nrow / kMinBlockRows);
+  return std::max<size_t>(n_blocks, 1);
+}
+
 /**
  * \param [in,out]  in_sketchs
  * \param           max_num_bins  The maximum number bins.
@@ -297,8 +438,24 @@ void DenseCuts::Build(DMatrix* p_fmat, uint32_t max_num_bins) {
  */
 void DenseCuts::Init
 (std::vector<WQSketch>* in_sketchs, uint32_t max_num_bins, size_t max_rows) {
-  monitor_.Start(__func__);
   std::vector<WQSketch>& sketchs = *in_sketchs;
+  std::vector<WQSketch::SummaryContainer> summaries(sketchs.size());
+  for (size_t i = 0; i < sketchs.size(); ++i) {
+    sketchs[i].GetSummary(&summaries[i]);
+  }
+  Init(&summaries, max_num_bins, max_rows);
+}
+
+/**
+ * \param [in,out]  in_summaries  Per feature summaries of the local data.
+ * \param           max_num_bins  The maximum number bins.
+ * \param           max_rows      Number of rows in this DMatrix.
+ */
+void DenseCuts::Init
+(std::vector<WQSketch::SummaryContainer>* in_summaries, uint32_t max_num_bins,
+ size_t max_rows) {
+  monitor_.Start(__func__);
+  std::vector<WQSketch::SummaryContainer>& summaries = *in_summaries;
 
   // Compute how many cuts samples we need at each node
   // Do not require more than the number of total rows  in training data
@@ -308,53 +465,200 @@ void DenseCuts::Init
   constexpr int kFactor = 8;
   size_t intermediate_num_cuts =
       std::min(global_max_rows, static_cast<size_t>(max_num_bins * kFactor));
-  // gather the histogram data
+  // gather the histogram data, a batch of features at a time so only the summaries of
+  // one batch are held at the intermediate size
   rabit::SerializeReducer<WQSketch::SummaryContainer> sreducer;
-  std::vector<WQSketch::SummaryContainer> summary_array;
-  summary_array.resize(sketchs.size());
-  for (size_t i = 0; i < sketchs.size(); ++i) {
-    WQSketch::SummaryContainer out;
-    sketchs[i].GetSummary(&out);
-    summary_array[i].Reserve(intermediate_num_cuts);
-    summary_array[i].SetPrune(out, intermediate_num_cuts);
-  }
-  CHECK_EQ(summary_array.size(), in_sketchs->size());
   size_t nbytes = WQSketch::SummaryContainer::CalcMemCost(intermediate_num_cuts);
-  // TODO(chenqin): rabit failure recovery assumes no boostrap onetime call after loadcheckpoint
-  // we need to move this allreduce before loadcheckpoint call in future
-  sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
-  p_cuts_->min_vals_.resize(sketchs.size());
-
-  for (size_t fid = 0; fid < summary_array.size(); ++fid) {
-    WQSketch::SummaryContainer a;
-    a.Reserve(max_num_bins + 1);
-    a.SetPrune(summary_array[fid], max_num_bins + 1);
-    const bst_float mval = a.data[0].value;
-    p_cuts_->min_vals_[fid] = mval - (fabs(mval) + 1e-5);
-    AddCutPoint(a, max_num_bins);
-    // push a value that is greater than anything
-    const bst_float cpt
-      = (a.size > 0) ? a.data[a.size - 1].value : p_cuts_->min_vals_[fid];
-    // this must be bigger than last value in a scale
-    const bst_float last = cpt + (fabs(cpt) + 1e-5);
-    p_cuts_->cut_values_.push_back(last);
-
-    // Ensure that every feature gets at least one quantile point
-    CHECK_LE(p_cuts_->cut_values_.size(), std::numeric_limits<uint32_t>::max());
-    auto cut_size = static_cast<uint32_t>(p_cuts_->cut_values_.size());
-    CHECK_GT(cut_size, p_cuts_->cut_ptrs_.back());
-    p_cuts_->cut_ptrs_.push_back(cut_size);
+  size_t const batch_size = std::max<size_t>(kMaxSummaryAllreduceBytes / nbytes, 1);
+  std::vector<WQSketch::SummaryContainer> summary_array;
+  p_cuts_->min_vals_.resize(summaries.size());
+
+  for (size_t batch_begin = 0; batch_begin < summaries.size(); batch_begin += batch_size) {
+    size_t const batch_end = std::min(batch_begin + batch_size, summaries.size());
+    summary_array.resize(batch_end - batch_begin);
+    for (size_t i = batch_begin; i < batch_end; ++i) {
+      summary_array[i - batch_begin].Reserve(intermediate_num_cuts);
+      summary_array[i - batch_begin].SetPrune(summaries[i], intermediate_num_cuts);
+    }
+    // TODO(chenqin): rabit failure recovery assumes no boostrap onetime call after loadcheckpoint
+    // we need to move this allreduce before loadcheckpoint call in future
+    AllreduceSummaries(&sreducer, dmlc::BeginPtr(summary_array), nbytes,
+                       summary_array.size());
+
+    for (size_t fid = batch_begin; fid < batch_end; ++fid) {
+      WQSketch::SummaryContainer a;
+      a.Reserve(max_num_bins + 1);
+      a.SetPrune(summary_array[fid - batch_begin], max_num_bins + 1);
+      const bst_float mval = a.data[0].value;
+      p_cuts_->min_vals_[fid] = mval - (fabs(mval) + 1e-5);
+      if (this->IsCategorical(fid)) {
+        this->AddCategories(a);
+      } else {
+        AddCutPoint(a, max_num_bins);
+        // push a value that is greater than anything
+        const bst_float cpt
+          = (a.size > 0) ? a.data[a.size - 1].value : p_cuts_->min_vals_[fid];
+        // this must be bigger than last value in a scale
+        const bst_float last = cpt + (fabs(cpt) + 1e-5);
+        p_cuts_->cut_values_.push_back(last);
+      }
+
+      // Ensure that every feature gets at least one quantile point
+      CHECK_LE(p_cuts_->cut_values_.size(), std::numeric_limits<uint32_t>::max());
+      auto cut_size = static_cast<uint32_t>(p_cuts_->cut_values_.size());
+      CHECK_GT(cut_size, p_cuts_->cut_ptrs_.back());
+      p_cuts_->cut_ptrs_.push_back(cut_size);
+    }
   }
   monitor_.Stop(__func__);
 }
 
+template <typename BinIdxType>
+void GHistIndexMatrix::SetIndexData(BinIdxType* index_data, size_t batch_threads,
+                                    const SparsePage& batch, size_t rbegin, size_t nbins) {
+  const uint32_t* offsets = index.Offset();
+  const size_t nfeatures = index.OffsetSize();
+
+  #pragma omp parallel for num_threads(batch_threads) schedule(static)
+  for (omp_ulong i = 0; i < batch.Size(); ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    size_t ibegin = row_ptr[rbegin + i];
+    size_t iend = row_ptr[rbegin + i + 1];
+    SparsePage::Inst inst = batch[i];
+
+    CHECK_EQ(ibegin + inst.size(), iend);
+    if (offsets != nullptr) {
+      // dense data: the local bin of feature `fid` is kept at position `fid` of the row
+      CHECK_EQ(inst.size(), nfeatures);
+      for (bst_uint j = 0; j < inst.size(); ++j) {
+        const bst_feature_t fid = inst[j].index;
+        uint32_t idx = cut.SearchBin(inst[j]);
+
+        index_data[ibegin + fid] = static_cast<BinIdxType>(idx - offsets[fid]);
+        ++hit_count_tloc_[tid * nbins + idx];
+      }
+    } else {
+      for (bst_uint j = 0; j < inst.size(); ++j) {
+        uint32_t idx = cut.SearchBin(inst[j]);
+
+        index_data[ibegin + j] = static_cast<BinIdxType>(idx);
+        ++hit_count_tloc_[tid * nbins + idx];
+      }
+      std::sort(index_data + ibegin, index_data + iend);
+    }
+  }
+}
+
+void GHistIndexMatrix::InitIndexType(bool is_dense) {
+  const uint32_t nbins = cut.Ptrs().back();
+  isDense_ = is_dense;
+  // For dense data bins are stored relative to their feature, so only the widest
+  // feature decides the storage type.  Sparse data keeps global bin indices.
+  uint32_t max_bins = nbins;
+  if (isDense_) {
+    const size_t nfeatures = cut.Ptrs().size() - 1;
+    index.ResizeOffset(nfeatures);
+    uint32_t* offsets = index.Offset();
+    max_bins = 0;
+    for (size_t fid = 0; fid < nfeatures; ++fid) {
+      offsets[fid] = cut.Ptrs()[fid];
+      max_bins = std::max(max_bins, cut.Ptrs()[fid + 1] - cut.Ptrs()[fid]);
+    }
+  } else {
+    index.ResizeOffset(0);
+  }
+  if (max_bins <= static_cast<uint32_t>(std::numeric_limits<uint8_t>::max()) + 1) {
+    index.SetBinTypeSize(kUint8BinsTypeSize);
+  } else if (max_bins <= static_cast<uint32_t>(std::numeric_limits<uint16_t>::max()) + 1) {
+    index.SetBinTypeSize(kUint16BinsTypeSize);
+  } else {
+    index.SetBinTypeSize(kUint32BinsTypeSize);
+  }
+}
+
+void GHistIndexMatrix::PushBatch(const SparsePage& batch, size_t rbegin, size_t prev_sum,
+                                 uint32_t nbins) {
+  const int32_t nthread = omp_get_max_threads();
+  // The number of threads is pegged to the batch size. If the OMP
+  // block is parallelized on anything other than the batch/block size,
+  // it should be reassigned
+  const size_t batch_threads = std::max(
+      size_t(1),
+      std::min(batch.Size(), static_cast<size_t>(omp_get_max_threads())));
+  MemStackAllocator<size_t, 128> partial_sums(batch_threads);
+  size_t* p_part = partial_sums.Get();
+
+  size_t block_size =  batch.Size() / batch_threads;
+
+  #pragma omp parallel num_threads(batch_threads)
+  {
+    #pragma omp for
+    for (omp_ulong tid = 0; tid < batch_threads; ++tid) {
+      size_t ibegin = block_size * tid;
+      size_t iend = (tid == (batch_threads-1) ? batch.Size() : (block_size * (tid+1)));
+
+      size_t sum = 0;
+      for (size_t i = ibegin; i < iend; ++i) {
+        sum += batch[i].size();
+        row_ptr[rbegin + 1 + i] = sum;
+      }
+    }
+
+    #pragma omp single
+    {
+      p_part[0] = prev_sum;
+      for (size_t i = 1; i < batch_threads; ++i) {
+        p_part[i] = p_part[i - 1] + row_ptr[rbegin + i*block_size];
+      }
+    }
+
+    #pragma omp for
+    for (omp_ulong tid = 0; tid < batch_threads; ++tid) {
+      size_t ibegin = block_size * tid;
+      size_t iend = (tid == (batch_threads-1) ? batch.Size() : (block_size * (tid+1)));
+
+      for (size_t i = ibegin; i < iend; ++i) {
+        row_ptr[rbegin + 1 + i] += p_part[tid];
+      }
+    }
+  }
+
+  index.Resize(row_ptr[rbegin + batch.Size()]);
+
+  CHECK_GT(cut.Values().size(), 0U);
+
+  switch (index.GetBinTypeSize()) {
+    case kUint8BinsTypeSize:
+      SetIndexData(index.data<uint8_t>(), batch_threads, batch, rbegin, nbins);
+      break;
+    case kUint16BinsTypeSize:
+      SetIndexData(index.data<uint16_t>(), batch_threads, batch, rbegin, nbins);
+      break;
+    default:
+      CHECK_EQ(index.GetBinTypeSize(), kUint32BinsTypeSize);
+      SetIndexData(index.data<uint32_t>(), batch_threads, batch, rbegin, nbins);
+      break;
+  }
+
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (int32_t tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+      hit_count_tloc_[tid * nbins + idx] = 0;  // reset for next batch
+    }
+  }
+  tracked_.Set(this->MemCostBytes());
+}
+
 void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
   cut.Build(p_fmat, max_num_bins);
   const int32_t nthread = omp_get_max_threads();
   const uint32_t nbins = cut.Ptrs().back();
   hit_count.resize(nbins, 0);
   hit_count_tloc_.resize(nthread * nbins, 0);
+  base_rowid = 0;
 
+  InitIndexType(p_fmat->IsDense());
 
   size_t new_size = 1;
   for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
@@ -368,91 +672,139 @@ void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
   size_t prev_sum = 0;
 
   for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
-    // The number of threads is pegged to the batch size. If the OMP
-    // block is parallelized on anything other than the batch/block size,
-    // it should be reassigned
-    const size_t batch_threads = std::max(
-        size_t(1),
-        std::min(batch.Size(), static_cast<size_t>(omp_get_max_threads())));
-    MemStackAllocator<size_t, 128> partial_sums(batch_threads);
-    size_t* p_part = partial_sums.Get();
-
-    size_t block_size =  batch.Size() / batch_threads;
-
-    #pragma omp parallel num_threads(batch_threads)
-    {
-      #pragma omp for
-      for (omp_ulong tid = 0; tid < batch_threads; ++tid) {
-        size_t ibegin = block_size * tid;
-        size_t iend = (tid == (batch_threads-1) ? batch.Size() : (block_size * (tid+1)));
-
-        size_t sum = 0;
-        for (size_t i = ibegin; i < iend; ++i) {
-          sum += batch[i].size();
-          row_ptr[rbegin + 1 + i] = sum;
-        }
-      }
+    PushBatch(batch, rbegin, prev_sum, nbins);
+    prev_sum = row_ptr[rbegin + batch.Size()];
+    rbegin += batch.Size();
+  }
+}
 
-      #pragma omp single
-      {
-        p_part[0] = prev_sum;
-        for (size_t i = 1; i < batch_threads; ++i) {
-          p_part[i] = p_part[i - 1] + row_ptr[rbegin + i*block_size];
-        }
-      }
+void GHistIndexMatrix::Init(const SparsePage& batch, const HistogramCuts& cuts,
+                            bool is_dense) {
+  cut = cuts;
+  const int32_t nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.Ptrs().back();
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+  base_rowid = batch.base_rowid;
 
-      #pragma omp for
-      for (omp_ulong tid = 0; tid < batch_threads; ++tid) {
-        size_t ibegin = block_size * tid;
-        size_t iend = (tid == (batch_threads-1) ? batch.Size() : (block_size * (tid+1)));
+  InitIndexType(is_dense);
 
-        for (size_t i = ibegin; i < iend; ++i) {
-          row_ptr[rbegin + 1 + i] += p_part[tid];
-        }
-      }
-    }
+  row_ptr.resize(batch.Size() + 1);
+  row_ptr[0] = 0;
+  PushBatch(batch, 0, 0, nbins);
+}
 
-    index.resize(row_ptr[rbegin + batch.Size()]);
+void GHistIndexMatrix::PushRows(const SparsePage& batch) {
+  const int32_t nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.Ptrs().back();
+  hit_count.resize(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+  if (row_ptr.empty()) {
+    row_ptr.push_back(0);
+  }
+  const size_t rbegin = this->Size();
+  row_ptr.resize(rbegin + batch.Size() + 1);
+  PushBatch(batch, rbegin, row_ptr[rbegin], nbins);
+}
+
+void GHistIndexMatrix::DropRows(size_t begin, size_t end) {
+  CHECK_LE(begin, end);
+  CHECK_LE(end, this->Size());
+  const size_t ibegin = row_ptr[begin];
+  const size_t iend = row_ptr[end];
+  for (size_t i = ibegin; i < iend; ++i) {
+    --hit_count[index[i]];
+  }
+  index.Erase(ibegin, iend);
+  row_ptr.erase(row_ptr.begin() + begin + 1, row_ptr.begin() + end + 1);
+  for (size_t i = begin + 1; i < row_ptr.size(); ++i) {
+    row_ptr[i] -= iend - ibegin;
+  }
+  tracked_.Set(this->MemCostBytes());
+}
+
+void GHistIndexMatrix::InitStorage(const HistogramCuts& cuts, std::vector<size_t>&& rows,
+                                   bool is_dense) {
+  CHECK(!rows.empty());
+  cut = cuts;
+  const int32_t nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.Ptrs().back();
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+  base_rowid = 0;
+  row_ptr = std::move(rows);
+
+  InitIndexType(is_dense);
+  index.Resize(row_ptr.back());
+  tracked_.Set(this->MemCostBytes());
+}
 
-    CHECK_GT(cut.Values().size(), 0U);
+void HistogramCuts::Save(dmlc::Stream* fo) const {
+  fo->Write(cut_ptrs_);
+  fo->Write(cut_values_);
+  fo->Write(min_vals_);
+}
 
-    #pragma omp parallel for num_threads(batch_threads) schedule(static)
-    for (omp_ulong i = 0; i < batch.Size(); ++i) { // NOLINT(*)
-      const int tid = omp_get_thread_num();
-      size_t ibegin = row_ptr[rbegin + i];
-      size_t iend = row_ptr[rbegin + i + 1];
-      SparsePage::Inst inst = batch[i];
+bool HistogramCuts::Load(dmlc::Stream* fi) {
+  return fi->Read(&cut_ptrs_) && fi->Read(&cut_values_) && fi->Read(&min_vals_);
+}
 
-      CHECK_EQ(ibegin + inst.size(), iend);
-      for (bst_uint j = 0; j < inst.size(); ++j) {
-        uint32_t idx = cut.SearchBin(inst[j]);
+void Index::Save(dmlc::Stream* fo) const {
+  fo->Write(static_cast<int32_t>(binTypeSize_));
+  // same layout as a std::vector<uint8_t>
+  const uint64_t n_bytes = data_.size();
+  fo->Write(n_bytes);
+  if (n_bytes != 0) {
+    fo->Write(data_.data(), n_bytes);
+  }
+  fo->Write(offset_);
+}
 
-        index[ibegin + j] = idx;
-        ++hit_count_tloc_[tid * nbins + idx];
-      }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
-    }
+bool Index::Load(dmlc::Stream* fi) {
+  int32_t bin_type_size;
+  if (!fi->Read(&bin_type_size)) {
+    return false;
+  }
+  SetBinTypeSize(static_cast<BinTypeSize>(bin_type_size));
+  uint64_t n_bytes;
+  if (!fi->Read(&n_bytes)) {
+    return false;
+  }
+  data_.resize(n_bytes);
+  if (n_bytes != 0 && fi->Read(data_.data(), n_bytes) != n_bytes) {
+    return false;
+  }
+  return fi->Read(&offset_);
+}
 
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
-      for (int32_t tid = 0; tid < nthread; ++tid) {
-        hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
-        hit_count_tloc_[tid * nbins + idx] = 0;  // reset for next batch
-      }
-    }
+void GHistIndexMatrix::Save(dmlc::Stream* fo) const {
+  fo->Write(row_ptr);
+  index.Save(fo);
+  fo->Write(hit_count);
+  cut.Save(fo);
+  fo->Write(static_cast<int32_t>(isDense_));
+}
 
-    prev_sum = row_ptr[rbegin + batch.Size()];
-    rbegin += batch.Size();
+bool GHistIndexMatrix::Load(dmlc::Stream* fi) {
+  if (!fi->Read(&row_ptr)) {
+    return false;  // end of file
   }
+  int32_t is_dense;
+  CHECK(index.Load(fi) && fi->Read(&hit_count) && cut.Load(fi) && fi->Read(&is_dense))
+      << "Invalid histogram index page";
+  isDense_ = is_dense != 0;
+  tracked_.Set(this->MemCostBytes());
+  return true;
 }
 
+template <typename BinIdxType>
 static size_t GetConflictCount(const std::vector<bool>& mark,
-                               const Column& column,
+                               const Column<BinIdxType>& column,
                                size_t max_cnt) {
   size_t ret = 0;
   if (column.GetType() == xgboost::common::kDenseColumn) {
     for (size_t i = 0; i < column.Size(); ++i) {
-      if (column.GetFeatureBinIdx(i) != std::numeric_limits<uint32_t>::max() && mark[i]) {
+      if (!column.IsMissing(i) && mark[i]) {
         ++ret;
         if (ret > max_cnt) {
           return max_cnt + 1;
@@ -472,12 +824,13 @@ static size_t GetConflictCount(const std::vector<bool>& mark,
   return ret;
 }
 
+template <typename BinIdxType>
 inline void
-MarkUsed(std::vector<bool>* p_mark, const Column& column) {
+MarkUsed(std::vector<bool>* p_mark, const Column<BinIdxType>& column) {
   std::vector<bool>& mark = *p_mark;
   if (column.GetType() == xgboost::common::kDenseColumn) {
     for (size_t i = 0; i < column.Size(); ++i) {
-      if (column.GetFeatureBinIdx(i) != std::numeric_limits<uint32_t>::max()) {
+      if (!column.IsMissing(i)) {
         mark[i] = true;
       }
     }
@@ -488,6 +841,7 @@ MarkUsed(std::vector<bool>* p_mark, const Column& column) {
   }
 }
 
+template <typename BinIdxType>
 inline std::vector<std::vector<unsigned>>
 FindGroups(const std::vector<unsigned>& feature_list,
            const std::vector<size_t>& feature_nnz,
@@ -507,7 +861,7 @@ FindGroups(const std::vector<unsigned>& feature_list,
     = static_cast<size_t>(param.max_conflict_rate * nrow);
 
   for (auto fid : feature_list) {
-    const Column& column = colmat.GetColumn(fid);
+    const Column<BinIdxType> column = colmat.GetColumn<BinIdxType>(fid);
 
     const size_t cur_fid_nnz = feature_nnz[fid];
     bool need_new_group = true;
@@ -552,6 +906,22 @@ FindGroups(const std::vector<unsigned>& feature_list,
   return groups;
 }
 
+inline std::vector<std::vector<unsigned>>
+FindGroups(const std::vector<unsigned>& feature_list,
+           const std::vector<size_t>& feature_nnz,
+           const ColumnMatrix& colmat,
+           size_t nrow,
+           const tree::TrainParam& param) {
+  switch (colmat.GetTypeSize()) {
+    case kUint8BinsTypeSize:
+      return FindGroups<uint8_t>(feature_list, feature_nnz, colmat, nrow, param);
+    case kUint16BinsTypeSize:
+      return FindGroups<uint16_t>(feature_list, feature_nnz, colmat, nrow, param);
+    default:
+      return FindGroups<uint32_t>(feature_list, feature_nnz, colmat, nrow, param);
+  }
+}
+
 inline std::vector<std::vector<unsigned>>
 FastFeatureGrouping(const GHistIndexMatrix& gmat,
                     const ColumnMatrix& colmat,
@@ -607,6 +977,93 @@ FastFeatureGrouping(const GHistIndexMatrix& gmat,
   return groups;
 }
 
+template <typename BinIdxType>
+static void SetBundleIndexData(const GHistIndexMatrix& src,
+                               const std::vector<uint32_t>& bin_bundle,
+                               const std::vector<uint32_t>& bin_local,
+                               size_t n_bundles, BinIdxType* index_data) {
+  const auto nrow = static_cast<omp_ulong>(src.row_ptr.size() - 1);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong rid = 0; rid < nrow; ++rid) {
+    BinIdxType* row = index_data + rid * n_bundles;
+    std::fill(row, row + n_bundles, 0);
+    for (size_t j = src.row_ptr[rid]; j < src.row_ptr[rid + 1]; ++j) {
+      const uint32_t bin = src.index[j];
+      row[bin_bundle[bin]] = static_cast<BinIdxType>(bin_local[bin]);
+    }
+  }
+}
+
+void GHistIndexMatrix::InitBundles(const GHistIndexMatrix& src, const ColumnMatrix& colmat,
+                                   const tree::TrainParam& param,
+                                   std::vector<uint32_t>* p_feature_offset) {
+  // only strictly exclusive features share a bundle, so a row has a value for at most
+  // one feature of each bundle
+  tree::TrainParam exclusive_param = param;
+  exclusive_param.max_conflict_rate = 0;
+  auto bundles = FastFeatureGrouping(src, colmat, exclusive_param);
+  // keep bundles and their features in the order of features
+  for (auto& bundle : bundles) {
+    std::sort(bundle.begin(), bundle.end());
+  }
+  std::sort(bundles.begin(), bundles.end());
+
+  const std::vector<uint32_t>& src_ptrs = src.cut.Ptrs();
+  const size_t n_bundles = bundles.size();
+  std::vector<uint32_t>& feature_offset = *p_feature_offset;
+  feature_offset.resize(src_ptrs.size() - 1);
+  std::vector<uint32_t> bin_bundle(src_ptrs.back());
+  std::vector<uint32_t> bin_local(src_ptrs.back());
+  cut = HistogramCuts();
+  cut.cut_ptrs_.resize(n_bundles + 1);
+  cut.cut_ptrs_[0] = 0;
+  uint32_t max_bundle_bins = 0;
+  for (size_t bid = 0; bid < n_bundles; ++bid) {
+    uint32_t n_bins = 1;  // rows without a value
+    for (auto fid : bundles[bid]) {
+      feature_offset[fid] = cut.cut_ptrs_[bid] + n_bins;
+      for (uint32_t i = src_ptrs[fid]; i < src_ptrs[fid + 1]; ++i) {
+        bin_bundle[i] = static_cast<uint32_t>(bid);
+        bin_local[i] = n_bins++;
+      }
+    }
+    cut.cut_ptrs_[bid + 1] = cut.cut_ptrs_[bid] + n_bins;
+    max_bundle_bins = std::max(max_bundle_bins, n_bins);
+  }
+
+  const size_t nrow = src.row_ptr.size() - 1;
+  base_rowid = src.base_rowid;
+  isDense_ = true;
+  hit_count.clear();
+  row_ptr.resize(nrow + 1);
+  for (size_t i = 0; i <= nrow; ++i) {
+    row_ptr[i] = i * n_bundles;
+  }
+  if (max_bundle_bins - 1 <= static_cast<uint32_t>(std::numeric_limits<uint8_t>::max())) {
+    index.SetBinTypeSize(kUint8BinsTypeSize);
+  } else if (max_bundle_bins - 1 <=
+             static_cast<uint32_t>(std::numeric_limits<uint16_t>::max())) {
+    index.SetBinTypeSize(kUint16BinsTypeSize);
+  } else {
+    index.SetBinTypeSize(kUint32BinsTypeSize);
+  }
+  index.ResizeOffset(n_bundles);
+  std::copy(cut.cut_ptrs_.cbegin(), cut.cut_ptrs_.cend() - 1, index.Offset());
+  index.Resize(nrow * n_bundles);
+
+  switch (index.GetBinTypeSize()) {
+    case kUint8BinsTypeSize:
+      SetBundleIndexData(src, bin_bundle, bin_local, n_bundles, index.data<uint8_t>());
+      break;
+    case kUint16BinsTypeSize:
+      SetBundleIndexData(src, bin_bundle, bin_local, n_bundles, index.data<uint16_t>());
+      break;
+    default:
+      SetBundleIndexData(src, bin_bundle, bin_local, n_bundles, index.data<uint32_t>());
+  }
+  tracked_.Set(this->MemCostBytes());
+}
+
 void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
                                  const ColumnMatrix& colmat,
                                  const tree::TrainParam& param) {
@@ -671,60 +1128,233 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   }
 }
 
+namespace {
+bool IsHistISASupported(HistISA isa) {
+  switch (isa) {
+    case HistISA::kScalar:
+      return true;
+#if XGBOOST_HIST_MULTI_ISA
+    case HistISA::kAVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+    case HistISA::kAVX512:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f");
+#endif  // XGBOOST_HIST_MULTI_ISA
+    default:
+      return false;
+  }
+}
+
+HistISA DetectHistISA() {
+  if (IsHistISASupported(HistISA::kAVX512)) {
+    return HistISA::kAVX512;
+  } else if (IsHistISASupported(HistISA::kAVX2)) {
+    return HistISA::kAVX2;
+  }
+  return HistISA::kScalar;
+}
+
+HistISA& CurrentHistISA() {
+  static HistISA isa = DetectHistISA();
+  return isa;
+}
+}  // anonymous namespace
+
+void SetHistISA(HistISA isa) {
+  if (isa == HistISA::kAuto) {
+    CurrentHistISA() = DetectHistISA();
+    return;
+  }
+  CHECK(IsHistISASupported(isa))
+      << "Instruction set " << static_cast<int>(isa)
+      << " for histogram kernels is not supported by this CPU or build.";
+  CurrentHistISA() = isa;
+}
+
+HistISA GetHistISA() {
+  return CurrentHistISA();
+}
+
 /*!
  * \brief fill a histogram by zeros in range [begin, end)
  */
-void InitilizeHistByZeroes(GHistRow hist, size_t begin, size_t end) {
-  memset(hist.data() + begin, '\0', (end-begin)*sizeof(tree::GradStats));
+template<typename GradientSumT>
+void InitilizeHistByZeroes(GHistRow<GradientSumT> hist, size_t begin, size_t end) {
+  memset(hist.data() + begin, '\0', (end-begin)*sizeof(tree::GradStatsT<GradientSumT>));
+}
+template void InitilizeHistByZeroes(GHistRow<float> hist, size_t begin, size_t end);
+template void InitilizeHistByZeroes(GHistRow<double> hist, size_t begin, size_t end);
+template void InitilizeHistByZeroes(GHistRow<int32_t> hist, size_t begin, size_t end);
+template void InitilizeHistByZeroes(GHistRow<int64_t> hist, size_t begin, size_t end);
+
+template <typename FPType>
+XGBOOST_HIST_INLINE void IncrementHistKernel(FPType* pdst, const FPType* padd,
+                                             size_t begin, size_t end) {
+  for (size_t i = 2 * begin; i < 2 * end; ++i) {
+    pdst[i] += padd[i];
+  }
+}
+
+template <typename FPType>
+XGBOOST_HIST_INLINE void CopyHistKernel(FPType* pdst, const FPType* psrc,
+                                        size_t begin, size_t end) {
+  for (size_t i = 2 * begin; i < 2 * end; ++i) {
+    pdst[i] = psrc[i];
+  }
+}
+
+template <typename FPType>
+XGBOOST_HIST_INLINE void SubtractionHistKernel(FPType* pdst, const FPType* psrc1,
+                                               const FPType* psrc2, size_t begin, size_t end) {
+  for (size_t i = 2 * begin; i < 2 * end; ++i) {
+    pdst[i] = psrc1[i] - psrc2[i];
+  }
 }
 
+#if XGBOOST_HIST_MULTI_ISA
+// Same loops as above, vectorized by the compiler for wider registers.
+template <typename FPType>
+XGBOOST_TARGET_AVX2 void IncrementHistKernelAVX2(FPType* pdst, const FPType* padd,
+                                                 size_t begin, size_t end) {
+  IncrementHistKernel(pdst, padd, begin, end);
+}
+template <typename FPType>
+XGBOOST_TARGET_AVX512 void IncrementHistKernelAVX512(FPType* pdst, const FPType* padd,
+                                                     size_t begin, size_t end) {
+  IncrementHistKernel(pdst, padd, begin, end);
+}
+template <typename FPType>
+XGBOOST_TARGET_AVX2 void CopyHistKernelAVX2(FPType* pdst, const FPType* psrc,
+                                            size_t begin, size_t end) {
+  CopyHistKernel(pdst, psrc, begin, end);
+}
+template <typename FPType>
+XGBOOST_TARGET_AVX512 void CopyHistKernelAVX512(FPType* pdst, const FPType* psrc,
+                                                size_t begin, size_t end) {
+  CopyHistKernel(pdst, psrc, begin, end);
+}
+template <typename FPType>
+XGBOOST_TARGET_AVX2 void SubtractionHistKernelAVX2(FPType* pdst, const FPType* psrc1,
+                                                   const FPType* psrc2, size_t begin,
+                                                   size_t end) {
+  SubtractionHistKernel(pdst, psrc1, psrc2, begin, end);
+}
+template <typename FPType>
+XGBOOST_TARGET_AVX512 void SubtractionHistKernelAVX512(FPType* pdst, const FPType* psrc1,
+                                                       const FPType* psrc2, size_t begin,
+                                                       size_t end) {
+  SubtractionHistKernel(pdst, psrc1, psrc2, begin, end);
+}
+#endif  // XGBOOST_HIST_MULTI_ISA
+
 /*!
  * \brief Increment hist as dst += add in range [begin, end)
  */
-void IncrementHist(GHistRow dst, const GHistRow add, size_t begin, size_t end) {
-  using FPType = decltype(tree::GradStats::sum_grad);
+template<typename GradientSumT>
+void IncrementHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> add,
+                   size_t begin, size_t end) {
+  using FPType = GradientSumT;
   FPType* pdst = reinterpret_cast<FPType*>(dst.data());
   const FPType* padd = reinterpret_cast<const FPType*>(add.data());
 
-  for (size_t i = 2 * begin; i < 2 * end; ++i) {
-    pdst[i] += padd[i];
+  switch (GetHistISA()) {
+#if XGBOOST_HIST_MULTI_ISA
+    case HistISA::kAVX512:
+      IncrementHistKernelAVX512(pdst, padd, begin, end);
+      break;
+    case HistISA::kAVX2:
+      IncrementHistKernelAVX2(pdst, padd, begin, end);
+      break;
+#endif  // XGBOOST_HIST_MULTI_ISA
+    default:
+      IncrementHistKernel(pdst, padd, begin, end);
   }
 }
 
 /*!
  * \brief Copy hist from src to dst in range [begin, end)
  */
-void CopyHist(GHistRow dst, const GHistRow src, size_t begin, size_t end) {
-  using FPType = decltype(tree::GradStats::sum_grad);
+template<typename GradientSumT>
+void CopyHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> src,
+              size_t begin, size_t end) {
+  using FPType = GradientSumT;
   FPType* pdst = reinterpret_cast<FPType*>(dst.data());
   const FPType* psrc = reinterpret_cast<const FPType*>(src.data());
 
-  for (size_t i = 2 * begin; i < 2 * end; ++i) {
-    pdst[i] = psrc[i];
+  switch (GetHistISA()) {
+#if XGBOOST_HIST_MULTI_ISA
+    case HistISA::kAVX512:
+      CopyHistKernelAVX512(pdst, psrc, begin, end);
+      break;
+    case HistISA::kAVX2:
+      CopyHistKernelAVX2(pdst, psrc, begin, end);
+      break;
+#endif  // XGBOOST_HIST_MULTI_ISA
+    default:
+      CopyHistKernel(pdst, psrc, begin, end);
   }
 }
 
 /*!
  * \brief Compute Subtraction: dst = src1 - src2 in range [begin, end)
  */
-void SubtractionHist(GHistRow dst, const GHistRow src1, const GHistRow src2,
+template<typename GradientSumT>
+void SubtractionHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> src1,
+                     const GHistRow<GradientSumT> src2,
                      size_t begin, size_t end) {
-  using FPType = decltype(tree::GradStats::sum_grad);
+  using FPType = GradientSumT;
   FPType* pdst = reinterpret_cast<FPType*>(dst.data());
   const FPType* psrc1 = reinterpret_cast<const FPType*>(src1.data());
   const FPType* psrc2 = reinterpret_cast<const FPType*>(src2.data());
 
-  for (size_t i = 2 * begin; i < 2 * end; ++i) {
-    pdst[i] = psrc1[i] - psrc2[i];
+  switch (GetHistISA()) {
+#if XGBOOST_HIST_MULTI_ISA
+    case HistISA::kAVX512:
+      SubtractionHistKernelAVX512(pdst, psrc1, psrc2, begin, end);
+      break;
+    case HistISA::kAVX2:
+      SubtractionHistKernelAVX2(pdst, psrc1, psrc2, begin, end);
+      break;
+#endif  // XGBOOST_HIST_MULTI_ISA
+    default:
+      SubtractionHistKernel(pdst, psrc1, psrc2, begin, end);
   }
 }
 
+template void IncrementHist(GHistRow<float> dst, const GHistRow<float> add,
+                            size_t begin, size_t end);
+template void IncrementHist(GHistRow<double> dst, const GHistRow<double> add,
+                            size_t begin, size_t end);
+template void IncrementHist(GHistRow<int32_t> dst, const GHistRow<int32_t> add,
+                            size_t begin, size_t end);
+template void IncrementHist(GHistRow<int64_t> dst, const GHistRow<int64_t> add,
+                            size_t begin, size_t end);
+template void CopyHist(GHistRow<float> dst, const GHistRow<float> src,
+                       size_t begin, size_t end);
+template void CopyHist(GHistRow<double> dst, const GHistRow<double> src,
+                       size_t begin, size_t end);
+template void CopyHist(GHistRow<int32_t> dst, const GHistRow<int32_t> src,
+                       size_t begin, size_t end);
+template void CopyHist(GHistRow<int64_t> dst, const GHistRow<int64_t> src,
+                       size_t begin, size_t end);
+template void SubtractionHist(GHistRow<float> dst, const GHistRow<float> src1,
+                              const GHistRow<float> src2,
+                              size_t begin, size_t end);
+template void SubtractionHist(GHistRow<double> dst, const GHistRow<double> src1,
+                              const GHistRow<double> src2,
+                              size_t begin, size_t end);
+template void SubtractionHist(GHistRow<int32_t> dst, const GHistRow<int32_t> src1,
+                              const GHistRow<int32_t> src2,
+                              size_t begin, size_t end);
+template void SubtractionHist(GHistRow<int64_t> dst, const GHistRow<int64_t> src1,
+                              const GHistRow<int64_t> src2,
+                              size_t begin, size_t end);
+
 struct Prefetch {
  public:
   static constexpr size_t kCacheLineSize = 64;
   static constexpr size_t kPrefetchOffset = 10;
-  static constexpr size_t kPrefetchStep =
-      kCacheLineSize / sizeof(decltype(GHistIndexMatrix::index)::value_type);
 
  private:
   static constexpr size_t kNoPrefetchSize =
@@ -735,109 +1365,250 @@ struct Prefetch {
   static size_t NoPrefetchSize(size_t rows) {
     return std::min(rows, kNoPrefetchSize);
   }
+
+  template <typename T>
+  static constexpr size_t GetPrefetchStep() {
+    return Prefetch::kCacheLineSize / sizeof(T);
+  }
 };
 
 constexpr size_t Prefetch::kNoPrefetchSize;
 
-template<typename FPType, bool do_prefetch>
-void BuildHistDenseKernel(const std::vector<GradientPair>& gpair,
+// Gradients read by the histogram kernels, gradient pairs stored one after another.
+struct PairGradients {
+  const float* pgh;
+  explicit PairGradients(const GradientPair* gpair)
+      : pgh{reinterpret_cast<const float*>(gpair)} {}
+  float Grad(size_t i) const { return pgh[2 * i]; }
+  float Hess(size_t i) const { return pgh[2 * i + 1]; }
+  void Prefetch(size_t i) const { PREFETCH_READ_T0(pgh + 2 * i); }
+  PairGradients Advance(size_t n) const {
+    return PairGradients(reinterpret_cast<const GradientPair*>(pgh) + n);
+  }
+};
+
+// Gradients and hessians in arrays of their own.
+struct SplitGradients {
+  const float* grad;
+  const float* hess;
+  float Grad(size_t i) const { return grad[i]; }
+  float Hess(size_t i) const { return hess[i]; }
+  void Prefetch(size_t i) const {
+    PREFETCH_READ_T0(grad + i);
+    PREFETCH_READ_T0(hess + i);
+  }
+  SplitGradients Advance(size_t n) const { return {grad + n, hess + n}; }
+};
+
+// Gradients with the same hessian for every row, hessians are never loaded.
+struct ConstHessGradients {
+  const float* grad;
+  float hess;
+  float Grad(size_t i) const { return grad[i]; }
+  float Hess(size_t) const { return hess; }
+  void Prefetch(size_t i) const { PREFETCH_READ_T0(grad + i); }
+  ConstHessGradients Advance(size_t n) const { return {grad + n, hess}; }
+};
+
+// Features in [fid_begin, fid_end) are built, or only the ones in `fids' when it's not
+// empty.
+template<typename FPType, bool do_prefetch, bool packed, typename BinIdxType,
+         typename Gradients>
+XGBOOST_HIST_INLINE void BuildHistDenseKernel(Gradients gpair,
                           const RowSetCollection::Elem row_indices,
                           const GHistIndexMatrix& gmat,
                           const size_t n_features,
-                          GHistRow hist) {
+                          const size_t fid_begin, const size_t fid_end,
+                          Span<bst_feature_t const> fids,
+                          GHistRow<FPType> hist) {
   const size_t size = row_indices.Size();
   const size_t* rid = row_indices.begin;
-  const float* pgh = reinterpret_cast<const float*>(gpair.data());
-  const uint32_t* gradient_index = gmat.index.data();
+  const BinIdxType* gradient_index = gmat.index.data<BinIdxType>();
+  const uint32_t* offsets = gmat.index.Offset();
+  // rows of an external memory page are stored relative to its first row
+  const size_t base_rowid = gmat.base_rowid;
   FPType* hist_data = reinterpret_cast<FPType*>(hist.data());
 
-  const uint32_t two {2};  // Each element from 'gpair' and 'hist' contains
-                           // 2 FP values: gradient and hessian.
-                           // So we need to multiply each row-index/bin-index by 2
-                           // to work with gradient pairs as a singe row FP array
+  const uint32_t two {2};  // Each element from 'hist' contains 2 FP values: gradient
+                           // and hessian.  So we need to multiply each bin-index by 2
+                           // to work with the histogram as a single FP array
 
   for (size_t i = 0; i < size; ++i) {
-    const size_t icol_start = rid[i] * n_features;
-    const size_t idx_gh = two * rid[i];
+    const size_t icol_start = (rid[i] - base_rowid) * n_features;
+    const size_t idx_gh = packed ? i : rid[i];
 
     if (do_prefetch) {
-      const size_t icol_start_prefetch = rid[i + Prefetch::kPrefetchOffset] * n_features;
+      const size_t icol_start_prefetch =
+          (rid[i + Prefetch::kPrefetchOffset] - base_rowid) * n_features;
 
-      PREFETCH_READ_T0(pgh + two * rid[i + Prefetch::kPrefetchOffset]);
-      for (size_t j = icol_start_prefetch; j < icol_start_prefetch + n_features;
-           j += Prefetch::kPrefetchStep) {
+      if (!packed) {
+        gpair.Prefetch(rid[i + Prefetch::kPrefetchOffset]);
+      }
+      for (size_t j = icol_start_prefetch + fid_begin; j < icol_start_prefetch + fid_end;
+           j += Prefetch::GetPrefetchStep<BinIdxType>()) {
         PREFETCH_READ_T0(gradient_index + j);
       }
     }
+    const BinIdxType* gr_index_local = gradient_index + icol_start;
+    auto add = [&](size_t j) {
+      const uint32_t idx_bin = two * (static_cast<uint32_t>(gr_index_local[j]) + offsets[j]);
 
-    for (size_t j = icol_start; j < icol_start + n_features; ++j) {
-      const uint32_t idx_bin = two * gradient_index[j];
+      hist_data[idx_bin]   += static_cast<FPType>(gpair.Grad(idx_gh));
+      hist_data[idx_bin+1] += static_cast<FPType>(gpair.Hess(idx_gh));
+    };
 
-      hist_data[idx_bin]   += pgh[idx_gh];
-      hist_data[idx_bin+1] += pgh[idx_gh+1];
+    if (fids.empty()) {
+      for (size_t j = fid_begin; j < fid_end; ++j) {
+        add(j);
+      }
+    } else {
+      for (auto j : fids) {
+        add(j);
+      }
     }
   }
 }
 
-template<typename FPType, bool do_prefetch>
-void BuildHistSparseKernel(const std::vector<GradientPair>& gpair,
+#if XGBOOST_HIST_MULTI_ISA
+template<typename FPType, bool do_prefetch, bool packed, typename BinIdxType,
+         typename Gradients>
+XGBOOST_TARGET_AVX2 void BuildHistDenseKernelAVX2(Gradients gpair,
+                                                  const RowSetCollection::Elem row_indices,
+                                                  const GHistIndexMatrix& gmat,
+                                                  const size_t n_features,
+                                                  const size_t fid_begin, const size_t fid_end,
+                                                  Span<bst_feature_t const> fids,
+                                                  GHistRow<FPType> hist) {
+  BuildHistDenseKernel<FPType, do_prefetch, packed, BinIdxType>(gpair, row_indices, gmat,
+                                                        n_features, fid_begin, fid_end, fids,
+                                                        hist);
+}
+
+template<typename FPType, bool do_prefetch, bool packed, typename BinIdxType,
+         typename Gradients>
+XGBOOST_TARGET_AVX512 void BuildHistDenseKernelAVX512(Gradients gpair,
+                                                      const RowSetCollection::Elem row_indices,
+                                                      const GHistIndexMatrix& gmat,
+                                                      const size_t n_features,
+                                                      const size_t fid_begin,
+                                                      const size_t fid_end,
+                                                      Span<bst_feature_t const> fids,
+                                                      GHistRow<FPType> hist) {
+  BuildHistDenseKernel<FPType, do_prefetch, packed, BinIdxType>(gpair, row_indices, gmat,
+                                                        n_features, fid_begin, fid_end, fids,
+                                                        hist);
+}
+#endif  // XGBOOST_HIST_MULTI_ISA
+
+template<typename FPType, bool do_prefetch, bool packed, typename BinIdxType,
+         typename Gradients>
+void BuildHistSparseKernel(Gradients gpair,
                            const RowSetCollection::Elem row_indices,
                            const GHistIndexMatrix& gmat,
-                           GHistRow hist) {
+                           GHistRow<FPType> hist) {
   const size_t size = row_indices.Size();
   const size_t* rid = row_indices.begin;
-  const float* pgh = reinterpret_cast<const float*>(gpair.data());
-  const uint32_t* gradient_index = gmat.index.data();
+  const BinIdxType* gradient_index = gmat.index.data<BinIdxType>();
   const size_t* row_ptr =  gmat.row_ptr.data();
+  // rows of an external memory page are stored relative to its first row
+  const size_t base_rowid = gmat.base_rowid;
   FPType* hist_data = reinterpret_cast<FPType*>(hist.data());
 
-  const uint32_t two {2};  // Each element from 'gpair' and 'hist' contains
-                           // 2 FP values: gradient and hessian.
-                           // So we need to multiply each row-index/bin-index by 2
-                           // to work with gradient pairs as a singe row FP array
+  const uint32_t two {2};  // Each element from 'hist' contains 2 FP values: gradient
+                           // and hessian.  So we need to multiply each bin-index by 2
+                           // to work with the histogram as a single FP array
 
   for (size_t i = 0; i < size; ++i) {
-    const size_t icol_start = row_ptr[rid[i]];
-    const size_t icol_end = row_ptr[rid[i]+1];
-    const size_t idx_gh = two * rid[i];
+    const size_t icol_start = row_ptr[rid[i] - base_rowid];
+    const size_t icol_end = row_ptr[rid[i] - base_rowid + 1];
+    const size_t idx_gh = packed ? i : rid[i];
 
     if (do_prefetch) {
-      const size_t icol_start_prftch = row_ptr[rid[i+Prefetch::kPrefetchOffset]];
-      const size_t icol_end_prefect = row_ptr[rid[i+Prefetch::kPrefetchOffset]+1];
+      const size_t rid_prefetch = rid[i + Prefetch::kPrefetchOffset] - base_rowid;
+      const size_t icol_start_prftch = row_ptr[rid_prefetch];
+      const size_t icol_end_prefect = row_ptr[rid_prefetch + 1];
 
-      PREFETCH_READ_T0(pgh + two * rid[i + Prefetch::kPrefetchOffset]);
-      for (size_t j = icol_start_prftch; j < icol_end_prefect; j+=Prefetch::kPrefetchStep) {
+      if (!packed) {
+        gpair.Prefetch(rid[i + Prefetch::kPrefetchOffset]);
+      }
+      for (size_t j = icol_start_prftch; j < icol_end_prefect;
+           j += Prefetch::GetPrefetchStep<BinIdxType>()) {
         PREFETCH_READ_T0(gradient_index + j);
       }
     }
 
     for (size_t j = icol_start; j < icol_end; ++j) {
-      const uint32_t idx_bin = two * gradient_index[j];
-      hist_data[idx_bin]   += pgh[idx_gh];
-      hist_data[idx_bin+1] += pgh[idx_gh+1];
+      const uint32_t idx_bin = two * static_cast<uint32_t>(gradient_index[j]);
+      hist_data[idx_bin]   += static_cast<FPType>(gpair.Grad(idx_gh));
+      hist_data[idx_bin+1] += static_cast<FPType>(gpair.Hess(idx_gh));
     }
   }
 }
 
-template<typename FPType, bool do_prefetch>
-void BuildHistKernel(const std::vector<GradientPair>& gpair,
-                     const RowSetCollection::Elem row_indices,
-                     const GHistIndexMatrix& gmat, const bool isDense, GHistRow hist) {
-  if (row_indices.Size() && isDense) {
-    const size_t* row_ptr =  gmat.row_ptr.data();
-    const size_t n_features = row_ptr[row_indices.begin[0]+1] - row_ptr[row_indices.begin[0]];
-    BuildHistDenseKernel<FPType, do_prefetch>(gpair, row_indices, gmat, n_features, hist);
+template<typename FPType, bool do_prefetch, bool packed, typename BinIdxType,
+         typename Gradients>
+void BuildHistDispatchKernel(Gradients gpair,
+                             const RowSetCollection::Elem row_indices,
+                             const GHistIndexMatrix& gmat,
+                             const size_t fid_begin, const size_t fid_end,
+                             Span<bst_feature_t const> fids,
+                             GHistRow<FPType> hist) {
+  if (gmat.IsDense()) {
+    const size_t n_features = gmat.index.OffsetSize();
+    switch (GetHistISA()) {
+#if XGBOOST_HIST_MULTI_ISA
+      case HistISA::kAVX512:
+        BuildHistDenseKernelAVX512<FPType, do_prefetch, packed, BinIdxType>(
+            gpair, row_indices, gmat, n_features, fid_begin, fid_end, fids, hist);
+        break;
+      case HistISA::kAVX2:
+        BuildHistDenseKernelAVX2<FPType, do_prefetch, packed, BinIdxType>(
+            gpair, row_indices, gmat, n_features, fid_begin, fid_end, fids, hist);
+        break;
+#endif  // XGBOOST_HIST_MULTI_ISA
+      default:
+        BuildHistDenseKernel<FPType, do_prefetch, packed, BinIdxType>(
+            gpair, row_indices, gmat, n_features, fid_begin, fid_end, fids, hist);
+    }
   } else {
-    BuildHistSparseKernel<FPType, do_prefetch>(gpair, row_indices, gmat, hist);
+    // sparse rows are never split into feature blocks
+
+    BuildHistSparseKernel<FPType, do_prefetch, packed, BinIdxType>(gpair, row_indices, gmat, hist);
   }
 }
 
-void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
-                             const RowSetCollection::Elem row_indices,
-                             const GHistIndexMatrix& gmat,
-                             GHistRow hist,
-                             bool isDense) {
-  using FPType = decltype(tree::GradStats::sum_grad);
+template<typename FPType, bool do_prefetch, bool packed, typename Gradients>
+void BuildHistKernel(Gradients gpair,
+                     const RowSetCollection::Elem row_indices,
+                     const GHistIndexMatrix& gmat,
+                     const size_t fid_begin, const size_t fid_end,
+                     Span<bst_feature_t const> fids,
+                     GHistRow<FPType> hist) {
+  switch (gmat.index.GetBinTypeSize()) {
+    case kUint8BinsTypeSize:
+      BuildHistDispatchKernel<FPType, do_prefetch, packed, uint8_t>(gpair, row_indices, gmat,
+                                                            fid_begin, fid_end, fids, hist);
+      break;
+    case kUint16BinsTypeSize:
+      BuildHistDispatchKernel<FPType, do_prefetch, packed, uint16_t>(gpair, row_indices, gmat,
+                                                             fid_begin, fid_end, fids, hist);
+      break;
+    case kUint32BinsTypeSize:
+      BuildHistDispatchKernel<FPType, do_prefetch, packed, uint32_t>(gpair, row_indices, gmat,
+                                                             fid_begin, fid_end, fids, hist);
+      break;
+    default:
+      LOG(FATAL) << "Unknown bin type size: " << static_cast<int>(gmat.index.GetBinTypeSize());
+  }
+}
+
+template<typename FPType, bool packed, typename Gradients>
+void BuildHistFeatureRange(Gradients gpair,
+                           const RowSetCollection::Elem row_indices,
+                           const GHistIndexMatrix& gmat,
+                           const size_t fid_begin, const size_t fid_end,
+                           Span<bst_feature_t const> fids,
+                           GHistRow<FPType> hist) {
   const size_t nrows = row_indices.Size();
   const size_t no_prefetch_size = Prefetch::NoPrefetchSize(nrows);
 
@@ -846,21 +1617,124 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
 
   if (contiguousBlock) {
     // contiguous memory access, built-in HW prefetching is enough
-    BuildHistKernel<FPType, false>(gpair, row_indices, gmat, isDense, hist);
+    BuildHistKernel<FPType, false, packed>(gpair, row_indices, gmat, fid_begin, fid_end, fids,
+                                           hist);
   } else {
     const RowSetCollection::Elem span1(row_indices.begin, row_indices.end - no_prefetch_size);
     const RowSetCollection::Elem span2(row_indices.end - no_prefetch_size, row_indices.end);
+    // packed gradients are in the order of rows
+    const Gradients gpair2 = packed ? gpair.Advance(span1.Size()) : gpair;
 
-    BuildHistKernel<FPType, true>(gpair, span1, gmat, isDense, hist);
+    BuildHistKernel<FPType, true, packed>(gpair, span1, gmat, fid_begin, fid_end, fids, hist);
     // no prefetching to avoid loading extra memory
-    BuildHistKernel<FPType, false>(gpair, span2, gmat, isDense, hist);
+    BuildHistKernel<FPType, false, packed>(gpair2, span2, gmat, fid_begin, fid_end, fids, hist);
   }
 }
 
-void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
-                                  const RowSetCollection::Elem row_indices,
-                                  const GHistIndexBlockMatrix& gmatb,
-                                  GHistRow hist) {
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHist(const std::vector<GradientPair>& gpair,
+                                           const RowSetCollection::Elem row_indices,
+                                           const GHistIndexMatrix& gmat,
+                                           GHistRowT hist) {
+  const size_t n_features = gmat.cut.Ptrs().size() - 1;
+  auto fids = this->FeaturesInRange(0, n_features);
+  if (gmat.IsDense() && !feature_set_.empty() && fids.empty()) {
+    return;
+  }
+  BuildHistFeatureRange<GradientSumT, false>(PairGradients(gpair.data()), row_indices, gmat,
+                                             0, n_features, fids, hist);
+}
+
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHist(const std::vector<GradientPair>& gpair,
+                                           const RowSetCollection::Elem row_indices,
+                                           const GHistIndexMatrix& gmat,
+                                           GHistRowT hist,
+                                           size_t feature_block) {
+  if (feature_blocks_.empty()) {
+    CHECK_EQ(feature_block, 0);
+    this->BuildHist(gpair, row_indices, gmat, hist);
+  } else {
+    CHECK_LT(feature_block + 1, feature_blocks_.size());
+    size_t const fid_begin = feature_blocks_[feature_block];
+    size_t const fid_end = feature_blocks_[feature_block + 1];
+    auto fids = this->FeaturesInRange(fid_begin, fid_end);
+    if (gmat.IsDense() && !feature_set_.empty() && fids.empty()) {
+      return;
+    }
+    BuildHistFeatureRange<GradientSumT, false>(PairGradients(gpair.data()), row_indices, gmat,
+                                               fid_begin, fid_end, fids, hist);
+  }
+}
+
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHistPacked(const GradientPair* packed_gpair,
+                                                 const RowSetCollection::Elem row_indices,
+                                                 const GHistIndexMatrix& gmat,
+                                                 GHistRowT hist,
+                                                 size_t feature_block) {
+  auto range = this->FeatureBlockRange(gmat, feature_block);
+  auto fids = this->FeaturesInRange(range.first, range.second);
+  if (gmat.IsDense() && !feature_set_.empty() && fids.empty()) {
+    return;
+  }
+  BuildHistFeatureRange<GradientSumT, true>(PairGradients(packed_gpair), row_indices, gmat,
+                                            range.first, range.second, fids, hist);
+}
+
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildHist(const GradientSoA& gpair,
+                                           const RowSetCollection::Elem row_indices,
+                                           const GHistIndexMatrix& gmat,
+                                           GHistRowT hist,
+                                           size_t feature_block) {
+  auto range = this->FeatureBlockRange(gmat, feature_block);
+  auto fids = this->FeaturesInRange(range.first, range.second);
+  if (gmat.IsDense() && !feature_set_.empty() && fids.empty()) {
+    return;
+  }
+  if (gpair.ConstantHess()) {
+    BuildHistFeatureRange<GradientSumT, false>(
+        ConstHessGradients{gpair.Grad(), gpair.HessValue()}, row_indices, gmat, range.first,
+        range.second, fids, hist);
+  } else {
+    BuildHistFeatureRange<GradientSumT, false>(SplitGradients{gpair.Grad(), gpair.Hess()},
+                                               row_indices, gmat, range.first, range.second,
+                                               fids, hist);
+  }
+}
+
+template <typename GradientSumT>
+constexpr size_t GHistBuilder<GradientSumT>::kHistCacheBytes;
+
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::InitFeatureBlocks(const GHistIndexMatrix& gmat,
+                                                   size_t max_block_bytes) {
+  using GradStatsT = tree::GradStatsT<GradientSumT>;
+  const std::vector<uint32_t>& cut_ptrs = gmat.cut.Ptrs();
+  const size_t n_features = cut_ptrs.size() - 1;
+  feature_blocks_.clear();
+  if (!gmat.IsDense() || cut_ptrs.back() * sizeof(GradStatsT) <= max_block_bytes) {
+    return;
+  }
+  feature_blocks_.push_back(0);
+  size_t block_bins = 0;
+  for (size_t fid = 0; fid < n_features; ++fid) {
+    const size_t n_bins = cut_ptrs[fid + 1] - cut_ptrs[fid];
+    if (block_bins != 0 && (block_bins + n_bins) * sizeof(GradStatsT) > max_block_bytes) {
+      feature_blocks_.push_back(fid);
+      block_bins = 0;
+    }
+    block_bins += n_bins;
+  }
+  feature_blocks_.push_back(n_features);
+}
+
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::BuildBlockHist(const std::vector<GradientPair>& gpair,
+                                                const RowSetCollection::Elem row_indices,
+                                                const GHistIndexBlockMatrix& gmatb,
+                                                GHistRowT hist) {
   constexpr int kUnroll = 8;  // loop unrolling factor
   const size_t nblock = gmatb.GetNumBlock();
   const size_t nrows = row_indices.end - row_indices.begin;
@@ -869,7 +1743,7 @@ void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
 #if defined(_OPENMP)
   const auto nthread = static_cast<bst_omp_uint>(this->nthread_);  // NOLINT
 #endif  // defined(_OPENMP)
-  tree::GradStats* p_hist = hist.data();
+  tree::GradStatsT<GradientSumT>* p_hist = hist.data();
 
 #pragma omp parallel for num_threads(nthread) schedule(guided)
   for (bst_omp_uint bid = 0; bid < nblock; ++bid) {
@@ -907,7 +1781,9 @@ void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
   }
 }
 
-void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+template <typename GradientSumT>
+void GHistBuilder<GradientSumT>::SubtractionTrick(GHistRowT self, GHistRowT sibling,
+                                                  GHistRowT parent) {
   const size_t size = self.size();
   CHECK_EQ(sibling.size(), size);
   CHECK_EQ(parent.size(), size);
@@ -923,5 +1799,10 @@ void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow pa
   }
 }
 
+template class GHistBuilder<float>;
+template class GHistBuilder<double>;
+template class GHistBuilder<int32_t>;
+template class GHistBuilder<int64_t>;
+
 }  // namespace common
 }  // namespace xgboost
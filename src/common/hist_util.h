@@ -15,12 +15,15 @@
 #include <memory>
 #include <utility>
 #include <map>
+#include <list>
 
+#include "gradient_soa.h"
 #include "row_set.h"
 #include "threading_utils.h"
 #include "../tree/param.h"
 #include "./quantile.h"
 #include "./timer.h"
+#include "./memory_tracker.h"
 #include "../include/rabit/rabit.h"
 
 namespace xgboost {
@@ -39,6 +42,7 @@ class HistogramCuts {
   friend class SparseCuts;
   friend class DenseCuts;
   friend class CutsBuilder;
+  friend struct GHistIndexMatrix;
 
  protected:
   using BinIdx = uint32_t;
@@ -50,11 +54,19 @@ class HistogramCuts {
 
  public:
   HistogramCuts();
-  HistogramCuts(HistogramCuts const& that) = delete;
+  // Copying is needed by pages of external memory, which share the same cuts.
+  HistogramCuts(HistogramCuts const& that) {
+    *this = that;
+  }
   HistogramCuts(HistogramCuts&& that) noexcept(true) {
     *this = std::forward<HistogramCuts&&>(that);
   }
-  HistogramCuts& operator=(HistogramCuts const& that) = delete;
+  HistogramCuts& operator=(HistogramCuts const& that) {
+    cut_ptrs_ = that.cut_ptrs_;
+    cut_values_ = that.cut_values_;
+    min_vals_ = that.min_vals_;
+    return *this;
+  }
   HistogramCuts& operator=(HistogramCuts&& that) noexcept(true) {
     monitor_ = std::move(that.monitor_);
     cut_ptrs_ = std::move(that.cut_ptrs_);
@@ -65,6 +77,8 @@ class HistogramCuts {
 
   /* \brief Build histogram cuts. */
   void Build(DMatrix* dmat, uint32_t const max_num_bins);
+  void Save(dmlc::Stream* fo) const;
+  bool Load(dmlc::Stream* fi);
   /* \brief How many bins a feature has. */
   uint32_t FeatureBins(uint32_t feature) const {
     return cut_ptrs_.at(feature+1) - cut_ptrs_[feature];
@@ -97,6 +111,22 @@ class HistogramCuts {
   }
 };
 
+/*!
+ * \brief Quantile sketch used by `SparseCuts' and `DenseCuts'.
+ */
+enum class SketchMethod : int {
+  // multi-level summaries, `WQuantileSketch'
+  kWQ = 0,
+  // fixed footprint compactors, `WCompactSketch'
+  kCompact = 1
+};
+
+/*!
+ * \brief Set the quantile sketch of the CPU cuts builders for the whole process.
+ */
+void SetSketchMethod(SketchMethod method);
+SketchMethod GetSketchMethod();
+
 /* \brief An interface for building quantile cuts.
  *
  * `DenseCuts' always assumes there are `max_bins` for each feature, which makes it not
@@ -106,11 +136,17 @@ class HistogramCuts {
 class CutsBuilder {
  public:
   using WQSketch = common::WQuantileSketch<bst_float, bst_float>;
+  using CompactSketch = common::WCompactSketch<bst_float, bst_float>;
 
  protected:
   HistogramCuts* p_cuts_;
+  /* \brief Type of each feature, all features are numerical when it's empty. */
+  std::vector<FeatureType> feature_types_;
   /* \brief return whether group for ranking is used. */
   static bool UseGroup(DMatrix* dmat);
+  bool IsCategorical(size_t fid) const {
+    return fid < feature_types_.size() && feature_types_[fid] == FeatureType::kCategorical;
+  }
 
  public:
   explicit CutsBuilder(HistogramCuts* p_cuts) : p_cuts_{p_cuts} {}
@@ -139,6 +175,27 @@ class CutsBuilder {
     }
   }
 
+  /*
+   * \brief Cut points of a categorical feature: one bin for each category up to the
+   *  largest one, so that category `c' falls in [c, c + 1).  It doesn't depend on
+   *  `max_bin'.
+   */
+  void AddCategories(WQSketch::SummaryContainer const& summary) {
+    if (summary.size == 0) {
+      p_cuts_->cut_values_.push_back(1.0f);
+      return;
+    }
+    CHECK_GE(summary.data[0].value, 0) << "Categories must be non-negative integers.";
+    bst_cat_t const max_cat = static_cast<bst_cat_t>(summary.data[summary.size - 1].value);
+    for (bst_cat_t c = 0; c <= max_cat; ++c) {
+      p_cuts_->cut_values_.push_back(static_cast<float>(c + 1));
+    }
+  }
+
+  void SetFeatureTypes(std::vector<FeatureType> const& feature_types) {
+    feature_types_ = feature_types;
+  }
+
   /* \brief Build histogram indices. */
   virtual void Build(DMatrix* dmat, uint32_t const max_num_bins) = 0;
 };
@@ -176,7 +233,28 @@ class DenseCuts  : public CutsBuilder {
     monitor_.Init(__FUNCTION__);
   }
   void Init(std::vector<WQSketch>* sketchs, uint32_t max_num_bins, size_t max_rows);
+  void Init(std::vector<WQSketch::SummaryContainer>* summaries, uint32_t max_num_bins,
+            size_t max_rows);
+  /*!
+   * \brief Sketch the features in a grid of row blocks and column blocks.  With the
+   *  compact sketch, whose footprint doesn't shrink with fewer rows, features are only
+   *  split among the threads and every sketch covers all rows.
+   */
   void Build(DMatrix* p_fmat, uint32_t max_num_bins) override;
+  /* \brief Number of row blocks sketched independently by `Build'. */
+  static size_t RowBlocks(size_t nthread, size_t ncol, size_t nrow);
+  /*!
+   * \brief Merge the sketches of row blocks into one summary for each feature,
+   *  (*sketchs)[r][fid] is the sketch of feature fid over row block r.
+   */
+  template <typename Sketch>
+  static void MergeBlocks(std::vector<std::vector<Sketch>>* sketchs,
+                          std::vector<WQSketch::SummaryContainer>* out);
+
+ private:
+  template <typename Sketch>
+  void SketchBlocks(DMatrix* p_fmat, uint32_t max_num_bins, size_t n_row_blocks,
+                    std::vector<WQSketch::SummaryContainer>* out);
 };
 
 // FIXME(trivialfis): Merge this into generic cut builder.
@@ -190,6 +268,127 @@ size_t DeviceSketch(int device,
                     DMatrix* dmat,
                     HistogramCuts* hmat);
 
+/*! \brief Builds the cut matrix on the GPU directly from the device columns of a cuDF or
+ *  CuPy adapter, without materializing a `SparsePage'.  Weights are not supported.
+ *
+ *  \param sketch_batch_num_elements Number of elements sketched at once, 0 uses no more
+ *         than 1/16th of the device memory.
+ *  \return The row stride across the entire dataset.
+ */
+template <typename AdapterT>
+size_t AdapterDeviceSketch(AdapterT* adapter, int max_bin, float missing,
+                           HistogramCuts* hmat, size_t sketch_batch_num_elements = 0);
+
+/*!
+ * \brief Size in bytes of a single bin index stored in GHistIndexMatrix.
+ */
+enum BinTypeSize {
+  kUint8BinsTypeSize  = 1,
+  kUint16BinsTypeSize = 2,
+  kUint32BinsTypeSize = 4
+};
+
+/*!
+ * \brief Storage for bin indices of GHistIndexMatrix.
+ *
+ *  Each entry is kept in the narrowest unsigned integer type able to hold it.  For
+ *  dense data the stored bins are local to their feature and the feature offsets
+ *  (HistogramCuts::Ptrs()) are added back on access, so most datasets fit in one byte.
+ */
+struct Index {
+  Index() {
+    SetBinTypeSize(binTypeSize_);
+  }
+  /*! \brief get the global bin index of i-th entry */
+  uint32_t operator[](size_t i) const {
+    const uint32_t bin = GetLocalBin(i);
+    return offset_.empty() ? bin : bin + offset_[i % offset_.size()];
+  }
+  void SetBinTypeSize(BinTypeSize binTypeSize) {
+    binTypeSize_ = binTypeSize;
+    switch (binTypeSize) {
+      case kUint8BinsTypeSize:
+        func_ = &GetValueFromUint8;
+        break;
+      case kUint16BinsTypeSize:
+        func_ = &GetValueFromUint16;
+        break;
+      case kUint32BinsTypeSize:
+        func_ = &GetValueFromUint32;
+        break;
+      default:
+        LOG(FATAL) << "Unknown bin type size: " << static_cast<int>(binTypeSize);
+    }
+  }
+  BinTypeSize GetBinTypeSize() const {
+    return binTypeSize_;
+  }
+  template<typename T>
+  T* data() {  // NOLINT
+    return reinterpret_cast<T*>(data_.data());
+  }
+  template<typename T>
+  const T* data() const {  // NOLINT
+    return reinterpret_cast<const T*>(data_.data());
+  }
+  /*! \brief per-feature offsets, nullptr when bins are stored as global indices */
+  const uint32_t* Offset() const {
+    return offset_.empty() ? nullptr : offset_.data();
+  }
+  uint32_t* Offset() {
+    return offset_.empty() ? nullptr : offset_.data();
+  }
+  size_t OffsetSize() const {
+    return offset_.size();
+  }
+  /*! \brief number of stored entries */
+  size_t Size() const {
+    return data_.size() / binTypeSize_;
+  }
+  void Resize(const size_t nEntries) {
+    data_.resize(nEntries * binTypeSize_);
+  }
+  void ResizeOffset(const size_t nDisps) {
+    offset_.resize(nDisps);
+  }
+  /*! \brief remove the entries [begin, end) */
+  void Erase(size_t begin, size_t end) {
+    data_.erase(data_.begin() + begin * binTypeSize_, data_.begin() + end * binTypeSize_);
+  }
+  /*! \brief size of bin data in bytes */
+  size_t MemCostBytes() const {
+    return data_.size() + offset_.size() * sizeof(uint32_t);
+  }
+  void Save(dmlc::Stream* fo) const;
+  bool Load(dmlc::Stream* fi);
+
+ private:
+  uint32_t GetLocalBin(size_t i) const {
+    return func_(data_.data(), i);
+  }
+  static uint32_t GetValueFromUint8(const uint8_t* t, size_t i) {
+    return t[i];
+  }
+  static uint32_t GetValueFromUint16(const uint8_t* t, size_t i) {
+    return reinterpret_cast<const uint16_t*>(t)[i];
+  }
+  static uint32_t GetValueFromUint32(const uint8_t* t, size_t i) {
+    return reinterpret_cast<const uint32_t*>(t)[i];
+  }
+
+  using Func = uint32_t (*)(const uint8_t*, size_t);
+
+  // filled in parallel by rows, pages are first touched by the threads building
+  // histograms from these rows
+  std::vector<uint8_t, HugePageAllocator<uint8_t>> data_;
+  // per-feature offsets of bin indices, only used for dense data
+  std::vector<uint32_t> offset_;
+  BinTypeSize binTypeSize_ {kUint32BinsTypeSize};
+  Func func_;
+};
+
+class ColumnMatrix;
+
 /*!
  * \brief preprocessed global index matrix, in CSR format
  *
@@ -200,19 +399,86 @@ struct GHistIndexMatrix {
   /*! \brief row pointer to rows by element position */
   std::vector<size_t> row_ptr;
   /*! \brief The index data */
-  std::vector<uint32_t> index;
+  Index index;
   /*! \brief hit count of each index */
   std::vector<size_t> hit_count;
   /*! \brief The corresponding cuts */
   HistogramCuts cut;
+  /*! \brief index of the first row, non zero for pages of external memory */
+  size_t base_rowid {0};
   // Create a global histogram matrix, given cut
   void Init(DMatrix* p_fmat, int max_num_bins);
-  // get i-th row
-  inline GHistIndexRow operator[](size_t i) const {
-    return {&index[0] + row_ptr[i],
-            static_cast<GHistIndexRow::index_type>(
-                row_ptr[i + 1] - row_ptr[i])};
+  /*!
+   * \brief Create a page of the histogram matrix for a single batch of an external
+   *  memory matrix.  Rows are stored relative to batch.base_rowid.
+   * \param is_dense whether the whole matrix is dense, see DMatrix::IsDense()
+   */
+  void Init(const SparsePage& batch, const HistogramCuts& cuts, bool is_dense);
+  /*!
+   * \brief Allocate the rows for data that doesn't come as a SparsePage, they are then
+   *  filled batch by batch with `PushAdapterBatch'.
+   * \param row_ptr offsets of all rows in the index, followed by the total.
+   */
+  void InitStorage(const HistogramCuts& cuts, std::vector<size_t>&& row_ptr, bool is_dense);
+  /*!
+   * \brief Quantize the valid elements of an adapter batch into the rows allocated by
+   *  `InitStorage'.  Rows before `rbegin' must have been pushed by previous batches.
+   * \return One past the last row touched by the batch, at least `rbegin'.
+   */
+  template <typename AdapterBatchT>
+  size_t PushAdapterBatch(const AdapterBatchT& batch, size_t rbegin, float missing);
+  /*!
+   * \brief Quantize the rows of `batch' with the current cuts and append them after the
+   *  existing rows.  Dense matrices only take dense rows.
+   */
+  void PushRows(const SparsePage& batch);
+  /*! \brief Remove the rows [begin, end), later rows are moved forward. */
+  void DropRows(size_t begin, size_t end);
+  /*! \brief number of rows */
+  size_t Size() const {
+    return row_ptr.empty() ? 0 : row_ptr.size() - 1;
+  }
+  void SetBaseRowId(size_t row_id) {
+    base_rowid = row_id;
   }
+  /*! \brief memory held by the rows and the cuts of the page */
+  size_t MemCostBytes() const {
+    return (row_ptr.size() + hit_count.size()) * sizeof(size_t) + index.MemCostBytes() +
+           cut.Ptrs().size() * sizeof(uint32_t) +
+           (cut.Values().size() + cut.MinValues().size()) * sizeof(float);
+  }
+  /*!
+   * \brief Take the cuts and the layout of a page, without any of its rows.  With
+   *  external memory the matrix itself is only used for its cuts, rows are in pages.
+   */
+  void InitFromPageCuts(const GHistIndexMatrix& page) {
+    cut = page.cut;
+    base_rowid = 0;
+    row_ptr.clear();
+    hit_count.clear();
+    InitIndexType(page.IsDense());
+    index.Resize(0);
+    tracked_.Set(this->MemCostBytes());
+  }
+  /*!
+   * \brief Bundle mutually exclusive features of src into the columns of a dense matrix.
+   *
+   *  Bin 0 of a bundle is for rows without a value for any of its features, it's
+   *  followed by the bins of its features.  The cuts only describe the bundles, the
+   *  bins of feature fid of src start at (*p_feature_offset)[fid] in histograms built
+   *  from the bundled matrix.
+   */
+  void InitBundles(const GHistIndexMatrix& src, const ColumnMatrix& colmat,
+                   const tree::TrainParam& param, std::vector<uint32_t>* p_feature_offset);
+  /*! \brief rows and cuts, base_rowid is defined by the position of a page */
+  void Save(dmlc::Stream* fo) const;
+  bool Load(dmlc::Stream* fi);
+
+  // Quantize a batch into index storage of type BinIdxType
+  template <typename BinIdxType>
+  void SetIndexData(BinIdxType* index_data, size_t batch_threads,
+                    const SparsePage& batch, size_t rbegin, size_t nbins);
+
   inline void GetFeatureCounts(size_t* counts) const {
     auto nfeature = cut.Ptrs().size() - 1;
     for (unsigned fid = 0; fid < nfeature; ++fid) {
@@ -223,9 +489,20 @@ struct GHistIndexMatrix {
       }
     }
   }
+  /*! \brief whether every row has an entry for every feature */
+  inline bool IsDense() const {
+    return isDense_;
+  }
 
  private:
+  // select storage of the index from the cuts
+  void InitIndexType(bool is_dense);
+  // quantize a batch into rows [rbegin, rbegin + batch.Size())
+  void PushBatch(const SparsePage& batch, size_t rbegin, size_t prev_sum, uint32_t nbins);
+
   std::vector<size_t> hit_count_tloc_;
+  bool isDense_ {false};
+  TrackedBytes tracked_ {"GHistIndexMatrix"};
 };
 
 struct GHistIndexBlock {
@@ -241,8 +518,6 @@ struct GHistIndexBlock {
   }
 };
 
-class ColumnMatrix;
-
 class GHistIndexBlockMatrix {
  public:
   void Init(const GHistIndexMatrix& gmat,
@@ -276,40 +551,74 @@ class GHistIndexBlockMatrix {
  *     for that particular bin
  *  Uses global bin id so as to represent all features simultaneously
  */
-using GHistRow = Span<tree::GradStats>;
+template <typename GradientSumT>
+using GHistRow = Span<tree::GradStatsT<GradientSumT> >;
+
+/*!
+ * \brief Instruction set used by the histogram kernels.
+ */
+enum class HistISA : int {
+  kAuto = 0,
+  kScalar = 1,
+  kAVX2 = 2,
+  kAVX512 = 3
+};
+
+/*!
+ * \brief Select the instruction set of histogram kernels for the whole process.
+ *  kAuto picks the widest one supported by the running CPU, other values are
+ *  checked against CPU support.
+ */
+void SetHistISA(HistISA isa);
+
+/*!
+ * \brief Instruction set currently used by histogram kernels, never kAuto.
+ */
+HistISA GetHistISA();
 
 /*!
  * \brief fill a histogram by zeros
  */
-void InitilizeHistByZeroes(GHistRow hist, size_t begin, size_t end);
+template <typename GradientSumT>
+void InitilizeHistByZeroes(GHistRow<GradientSumT> hist, size_t begin, size_t end);
 
 /*!
  * \brief Increment hist as dst += add in range [begin, end)
  */
-void IncrementHist(GHistRow dst, const GHistRow add, size_t begin, size_t end);
+template <typename GradientSumT>
+void IncrementHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> add,
+                   size_t begin, size_t end);
 
 /*!
  * \brief Copy hist from src to dst in range [begin, end)
  */
-void CopyHist(GHistRow dst, const GHistRow src, size_t begin, size_t end);
+template <typename GradientSumT>
+void CopyHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> src,
+              size_t begin, size_t end);
 
 /*!
  * \brief Compute Subtraction: dst = src1 - src2 in range [begin, end)
  */
-void SubtractionHist(GHistRow dst, const GHistRow src1, const GHistRow src2,
+template <typename GradientSumT>
+void SubtractionHist(GHistRow<GradientSumT> dst, const GHistRow<GradientSumT> src1,
+                     const GHistRow<GradientSumT> src2,
                      size_t begin, size_t end);
 
 /*!
  * \brief histogram of gradient statistics for multiple nodes
  */
+template<typename GradientSumT>
 class HistCollection {
  public:
+  using GHistRowT = GHistRow<GradientSumT>;
+  using GradientPairT = tree::GradStatsT<GradientSumT>;
+
   // access histogram for i-th node
-  GHistRow operator[](bst_uint nid) const {
+  GHistRowT operator[](bst_uint nid) const {
     constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
     CHECK_NE(row_ptr_[nid], kMax);
-    tree::GradStats* ptr =
-        const_cast<tree::GradStats*>(dmlc::BeginPtr(data_) + row_ptr_[nid]);
+    GradientPairT* ptr =
+        const_cast<GradientPairT*>(data_.data() + row_ptr_[nid]);
     return {ptr, nbins_};
   }
 
@@ -319,7 +628,7 @@ class HistCollection {
     return (nid < row_ptr_.size() && row_ptr_[nid] != k_max);
   }
 
-  // initialize histogram collection
+  // initialize histogram collection, memory of previous histograms is reused
   void Init(uint32_t nbins) {
     if (nbins_ != nbins) {
       nbins_ = nbins;
@@ -327,7 +636,16 @@ class HistCollection {
       data_.clear();
     }
     row_ptr_.clear();
-    n_nodes_added_ = 0;
+    lru_.clear();
+    free_rows_.clear();
+    for (size_t offset = 0; offset < data_.size(); offset += nbins_) {
+      free_rows_.push_back(offset);
+    }
+  }
+
+  // limit memory held by histograms, 0 means no limit
+  void SetMaxBytes(size_t max_bytes) {
+    max_bytes_ = max_bytes;
   }
 
   // create an empty histogram for i-th node
@@ -338,24 +656,86 @@ class HistCollection {
     }
     CHECK_EQ(row_ptr_[nid], kMax);
 
-    if (data_.size() < nbins_ * (nid + 1)) {
-      data_.resize(nbins_ * (nid + 1));
+    if (free_rows_.empty()) {
+      free_rows_.push_back(data_.size());
+      data_.resize(data_.size() + nbins_);
+      tracked_.Set(data_.capacity() * sizeof(GradientPairT));
     }
+    row_ptr_[nid] = free_rows_.back();
+    free_rows_.pop_back();
+    lru_.push_back(nid);
+  }
+
+  // release histogram of i-th node, its memory is recycled by AddHistRow()
+  void FreeHistRow(bst_uint nid) {
+    CHECK(RowExists(nid));
+    free_rows_.push_back(row_ptr_[nid]);
+    row_ptr_[nid] = std::numeric_limits<uint32_t>::max();
+    lru_.erase(std::find(lru_.begin(), lru_.end(), nid));
+  }
 
-    row_ptr_[nid] = nbins_ * n_nodes_added_;
-    n_nodes_added_++;
+  /*!
+   * \brief Make room for n_rows new histograms within the memory limit by freeing
+   *        the least recently added ones.  Histograms of nodes in keep are never
+   *        evicted, so the limit is exceeded if they don't fit.
+   * \return nodes whose histograms were evicted
+   */
+  std::vector<bst_uint> Evict(size_t n_rows, const std::vector<bst_uint>& keep) {
+    std::vector<bst_uint> evicted;
+    if (max_bytes_ == 0 || nbins_ == 0) {
+      return evicted;
+    }
+    const size_t max_rows =
+        std::max(max_bytes_ / (nbins_ * sizeof(GradientPairT)), static_cast<size_t>(1));
+    auto it = lru_.begin();
+    while (lru_.size() + n_rows > max_rows && it != lru_.end()) {
+      const bst_uint nid = *it;
+      ++it;
+      if (std::find(keep.cbegin(), keep.cend(), nid) == keep.cend()) {
+        evicted.push_back(nid);
+        this->FreeHistRow(nid);
+      }
+    }
+    // with a limit, idle memory is given back too
+    const size_t max_free = max_rows > lru_.size() + n_rows ?
+                            max_rows - lru_.size() - n_rows : 0;
+    if (free_rows_.size() > max_free) {
+      this->ShrinkFreeRows(max_free);
+    }
+    return evicted;
   }
 
+  // number of histograms currently held
+  size_t NumRows() const { return lru_.size(); }
+
  private:
+  // drop free rows at the end of data_, others stay as they are surrounded by live ones
+  void ShrinkFreeRows(size_t max_free) {
+    std::sort(free_rows_.begin(), free_rows_.end());
+    while (free_rows_.size() > max_free && !free_rows_.empty() &&
+           free_rows_.back() + nbins_ == data_.size()) {
+      data_.resize(free_rows_.back());
+      free_rows_.pop_back();
+    }
+    data_.shrink_to_fit();
+    tracked_.Set(data_.capacity() * sizeof(GradientPairT));
+  }
+
   /*! \brief number of all bins over all features */
   uint32_t nbins_ = 0;
-  /*! \brief amount of active nodes in hist collection */
-  uint32_t n_nodes_added_ = 0;
+  /*! \brief memory limit of all histograms in bytes, 0 for no limit */
+  size_t max_bytes_ = 0;
 
-  std::vector<tree::GradStats> data_;
+  // GradientPairT zeroes itself, default initialization is the same as value one
+  std::vector<GradientPairT, HugePageAllocator<GradientPairT>> data_;
 
   /*! \brief row_ptr_[nid] locates bin for histogram of node nid */
   std::vector<size_t> row_ptr_;
+  /*! \brief offsets of unused histograms in data_ */
+  std::vector<size_t> free_rows_;
+  /*! \brief nodes holding a histogram, least recently added first */
+  std::list<bst_uint> lru_;
+  TrackedBytes tracked_ {"Histograms"};
 };
 
 /*!
@@ -363,8 +743,11 @@ class HistCollection {
  * Supports processing multiple tree-nodes for nested parallelism
  * Able to reduce histograms across threads in efficient way
  */
+template<typename GradientSumT>
 class ParallelGHistBuilder {
  public:
+  using GHistRowT = GHistRow<GradientSumT>;
+
   void Init(size_t nbins) {
     if (nbins != nbins_) {
       hist_buffer_.Init(nbins);
@@ -375,7 +758,7 @@ class ParallelGHistBuilder {
   // Add new elements if needed, mark all hists as unused
   // targeted_hists - already allocated hists which should contain final results after Reduce() call
   void Reset(size_t nthreads, size_t nodes, const BlockedSpace2d& space,
-             const std::vector<GHistRow>& targeted_hists) {
+             const std::vector<GHistRowT>& targeted_hists) {
     hist_buffer_.Init(nbins_);
     tid_nid_to_hist_.clear();
     hist_memory_.clear();
@@ -394,15 +777,95 @@ class ParallelGHistBuilder {
 
     hist_was_used_.resize(nthreads * nodes_);
     std::fill(hist_was_used_.begin(), hist_was_used_.end(), static_cast<int>(false));
+    is_group_head_.clear();
+  }
+
+  /*!
+   * \brief Group threads, e.g. by socket.  ReduceHistInGroups() sums the histograms of
+   *  each group with threads of the group, ReduceHist() then only merges one histogram
+   *  per group and node.
+   * \param thread_group group of each thread, empty for a single group
+   */
+  void SetThreadGroups(std::vector<size_t> thread_group) {
+    thread_group_ = std::move(thread_group);
+    n_groups_ = thread_group_.empty() ? 1 :
+        *std::max_element(thread_group_.cbegin(), thread_group_.cend()) + 1;
+  }
+  size_t GetNumThreadGroups() const {
+    return n_groups_;
+  }
+
+  /*!
+   * \brief Sum the histograms used by threads of each group into the first one of the
+   *  group, with nthreads threads matching the ones which built them.  Nothing to do for
+   *  a single group.
+   */
+  void ReduceHistInGroups() {
+    if (n_groups_ <= 1) {
+      return;
+    }
+    CHECK_EQ(thread_group_.size(), nthreads_);
+    // the first used histogram of each group and node collects the group
+    is_group_head_.assign(nthreads_ * nodes_, static_cast<int>(false));
+    std::vector<int> group_head(n_groups_ * nodes_, -1);
+    for (size_t tid = 0; tid < nthreads_; ++tid) {
+      for (size_t nid = 0; nid < nodes_; ++nid) {
+        int& head = group_head[thread_group_[tid] * nodes_ + nid];
+        if (hist_was_used_[tid * nodes_ + nid] && head == -1) {
+          head = static_cast<int>(tid);
+          is_group_head_[tid * nodes_ + nid] = static_cast<int>(true);
+        }
+      }
+    }
+    std::vector<size_t> group_size(n_groups_, 0);
+    std::vector<size_t> rank(nthreads_);
+    for (size_t tid = 0; tid < nthreads_; ++tid) {
+      rank[tid] = group_size[thread_group_[tid]]++;
+    }
+
+    constexpr size_t kBlockBins = 1024;
+    const size_t n_blocks = nbins_ / kBlockBins + !!(nbins_ % kBlockBins);
+    const size_t n_tasks = nodes_ * n_blocks;
+    auto reduce = [&](size_t group, size_t task) {
+      const size_t nid = task / n_blocks;
+      const int head = group_head[group * nodes_ + nid];
+      if (head == -1) {
+        return;
+      }
+      const size_t begin = (task % n_blocks) * kBlockBins;
+      const size_t end = std::min(begin + kBlockBins, nbins_);
+      GHistRowT dst = hist_memory_[tid_nid_to_hist_.at({static_cast<size_t>(head), nid})];
+      for (size_t tid = head + 1; tid < nthreads_; ++tid) {
+        if (thread_group_[tid] == group && hist_was_used_[tid * nodes_ + nid]) {
+          IncrementHist(dst, hist_memory_[tid_nid_to_hist_.at({tid, nid})], begin, end);
+        }
+      }
+    };
+#pragma omp parallel num_threads(nthreads_)
+    {
+      const size_t tid = omp_get_thread_num();
+      const size_t nthreads = omp_get_num_threads();
+      if (nthreads == nthreads_) {
+        // threads of a group share its tasks
+        const size_t group = thread_group_[tid];
+        for (size_t task = rank[tid]; task < n_tasks; task += group_size[group]) {
+          reduce(group, task);
+        }
+      } else {
+        for (size_t task = tid; task < n_tasks * n_groups_; task += nthreads) {
+          reduce(task / n_tasks, task % n_tasks);
+        }
+      }
+    }
   }
 
   // Get specified hist, initialize hist by zeros if it wasn't used before
-  GHistRow GetInitializedHist(size_t tid, size_t nid) {
+  GHistRowT GetInitializedHist(size_t tid, size_t nid) {
     CHECK_LT(nid, nodes_);
     CHECK_LT(tid, nthreads_);
 
     size_t idx = tid_nid_to_hist_.at({tid, nid});
-    GHistRow hist = hist_memory_[idx];
+    GHistRowT hist = hist_memory_[idx];
 
     if (!hist_was_used_[tid * nodes_ + nid]) {
       InitilizeHistByZeroes(hist, 0, hist.size());
@@ -417,14 +880,16 @@ class ParallelGHistBuilder {
     CHECK_GT(end, begin);
     CHECK_LT(nid, nodes_);
 
-    GHistRow dst = targeted_hists_[nid];
+    GHistRowT dst = targeted_hists_[nid];
 
     bool is_updated = false;
     for (size_t tid = 0; tid < nthreads_; ++tid) {
-      if (hist_was_used_[tid * nodes_ + nid]) {
+      // after ReduceHistInGroups() only the group sums are left
+      if (hist_was_used_[tid * nodes_ + nid] &&
+          (is_group_head_.empty() || is_group_head_[tid * nodes_ + nid])) {
         is_updated = true;
         const size_t idx = tid_nid_to_hist_.at({tid, nid});
-        GHistRow src = hist_memory_[idx];
+        GHistRowT src = hist_memory_[idx];
 
         if (dst.data() != src.data()) {
           IncrementHist(dst, src, begin, end);
@@ -515,20 +980,25 @@ class ParallelGHistBuilder {
   /*! \brief number of nodes which will be processed in parallel  */
   size_t nodes_ = 0;
   /*! \brief Buffer for additional histograms for Parallel processing  */
-  HistCollection hist_buffer_;
+  HistCollection<GradientSumT> hist_buffer_;
   /*!
    * \brief Marks which hists were used, it means that they should be merged.
    * Contains only {true or false} values
    * but 'int' is used instead of 'bool', because std::vector<bool> isn't thread safe
    */
   std::vector<int> hist_was_used_;
+  /*! \brief group of each thread, empty for a single group */
+  std::vector<size_t> thread_group_;
+  size_t n_groups_ = 1;
+  /*! \brief histograms holding the sum of their group, empty until groups are reduced */
+  std::vector<int> is_group_head_;
 
   /*! \brief Buffer for additional histograms for Parallel processing  */
   std::vector<bool> threads_to_nids_map_;
   /*! \brief Contains histograms for final results  */
-  std::vector<GHistRow> targeted_hists_;
+  std::vector<GHistRowT> targeted_hists_;
   /*! \brief Allocated memory for histograms used for construction  */
-  std::vector<GHistRow> hist_memory_;
+  std::vector<GHistRowT> hist_memory_;
   /*! \brief map pair {tid, nid} to index of allocated histogram from hist_memory_  */
   std::map<std::pair<size_t, size_t>, size_t> tid_nid_to_hist_;
 };
@@ -536,8 +1006,14 @@ class ParallelGHistBuilder {
 /*!
  * \brief builder for histograms of gradient statistics
  */
+template<typename GradientSumT>
 class GHistBuilder {
  public:
+  using GHistRowT = GHistRow<GradientSumT>;
+
+  /*! \brief histograms larger than this are built one feature block at a time */
+  static constexpr size_t kHistCacheBytes = 256 * 1024;
+
   GHistBuilder() : nthread_{0}, nbins_{0} {}
   GHistBuilder(size_t nthread, uint32_t nbins) : nthread_{nthread}, nbins_{nbins} {}
 
@@ -545,15 +1021,56 @@ class GHistBuilder {
   void BuildHist(const std::vector<GradientPair>& gpair,
                  const RowSetCollection::Elem row_indices,
                  const GHistIndexMatrix& gmat,
-                 GHistRow hist,
-                 bool isDense);
+                 GHistRowT hist);
+  // same, but only for the features in one block, see InitFeatureBlocks()
+  void BuildHist(const std::vector<GradientPair>& gpair,
+                 const RowSetCollection::Elem row_indices,
+                 const GHistIndexMatrix& gmat,
+                 GHistRowT hist,
+                 size_t feature_block);
+  /*!
+   * \brief Same as BuildHist() for one feature block, with gradients stored in the
+   *  order of rows: packed_gpair[i] is the gradient of row row_indices.begin[i].
+   *  Gradients are then read as a stream instead of being gathered by row.
+   */
+  void BuildHistPacked(const GradientPair* packed_gpair,
+                       const RowSetCollection::Elem row_indices,
+                       const GHistIndexMatrix& gmat,
+                       GHistRowT hist,
+                       size_t feature_block);
+  /*!
+   * \brief Same as BuildHist() for one feature block, with gradients and hessians read
+   *  from arrays of their own.  Hessians aren't loaded when they are constant.
+   */
+  void BuildHist(const GradientSoA& gpair,
+                 const RowSetCollection::Elem row_indices,
+                 const GHistIndexMatrix& gmat,
+                 GHistRowT hist,
+                 size_t feature_block);
+  /*!
+   * \brief Split features into contiguous blocks whose part of the histogram fits
+   *        into max_block_bytes. Only dense matrices with a histogram bigger than
+   *        max_block_bytes are split, everything else gets a single block.
+   */
+  void InitFeatureBlocks(const GHistIndexMatrix& gmat,
+                         size_t max_block_bytes = kHistCacheBytes);
+  size_t GetNumFeatureBlocks() const {
+    return feature_blocks_.empty() ? 1 : feature_blocks_.size() - 1;
+  }
+  /*!
+   * \brief Restrict histograms of dense matrices to the sorted `features', the bins of
+   *        other features are left untouched.  An empty set builds every feature.
+   */
+  void SetFeatureSet(std::vector<bst_feature_t> features) {
+    feature_set_ = std::move(features);
+  }
   // same, with feature grouping
   void BuildBlockHist(const std::vector<GradientPair>& gpair,
                       const RowSetCollection::Elem row_indices,
                       const GHistIndexBlockMatrix& gmatb,
-                      GHistRow hist);
+                      GHistRowT hist);
   // construct a histogram via subtraction trick
-  void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent);
+  void SubtractionTrick(GHistRowT self, GHistRowT sibling, GHistRowT parent);
 
   uint32_t GetNumBins() const {
       return nbins_;
@@ -564,6 +1081,28 @@ class GHistBuilder {
   size_t nthread_;
   /*! \brief number of all bins over all features */
   uint32_t nbins_;
+  /*! \brief boundaries of feature blocks, block i is [feature_blocks_[i], feature_blocks_[i+1]) */
+  std::vector<size_t> feature_blocks_;
+  /*! \brief features built for dense matrices, all of them when empty */
+  std::vector<bst_feature_t> feature_set_;
+
+  // features [first, second) of a feature block
+  std::pair<size_t, size_t> FeatureBlockRange(const GHistIndexMatrix& gmat,
+                                              size_t feature_block) const {
+    if (feature_blocks_.empty()) {
+      CHECK_EQ(feature_block, 0);
+      return {0, gmat.cut.Ptrs().size() - 1};
+    }
+    CHECK_LT(feature_block + 1, feature_blocks_.size());
+    return {feature_blocks_[feature_block], feature_blocks_[feature_block + 1]};
+  }
+  // features of feature_set_ in [fid_begin, fid_end), empty when all are built
+  Span<bst_feature_t const> FeaturesInRange(size_t fid_begin, size_t fid_end) const {
+    auto beg = std::lower_bound(feature_set_.cbegin(), feature_set_.cend(), fid_begin);
+    auto end = std::lower_bound(beg, feature_set_.cend(), fid_end);
+    return {feature_set_.data() + (beg - feature_set_.cbegin()),
+            static_cast<size_t>(end - beg)};
+  }
 };
 
 
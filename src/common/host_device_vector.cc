@@ -7,6 +7,7 @@
 
 #include <xgboost/base.h>
 #include <xgboost/data.h>
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <utility>
@@ -14,6 +15,9 @@
 
 namespace xgboost {
 
+HostDeviceTransfers GetHostDeviceTransfers() { return {}; }
+void ResetHostDeviceTransfers() {}
+
 template <typename T>
 struct HostDeviceVectorImpl {
   explicit HostDeviceVectorImpl(size_t size, T v) : data_h_(size, v) {}
@@ -108,6 +112,12 @@ const std::vector<T>& HostDeviceVector<T>::ConstHostVector() const {
   return impl_->Vec();
 }
 
+template <typename T>
+void HostDeviceVector<T>::CopyRangeToHost(size_t begin, size_t size, T* out) const {
+  CHECK_LE(begin + size, Size());
+  std::copy_n(impl_->Vec().cbegin() + begin, size, out);
+}
+
 template <typename T>
 void HostDeviceVector<T>::Resize(size_t new_size, T v) {
   impl_->Vec().resize(new_size, v);
@@ -166,6 +176,7 @@ template class HostDeviceVector<int32_t>;   // bst_node_t
 template class HostDeviceVector<Entry>;
 template class HostDeviceVector<uint64_t>;  // bst_row_t
 template class HostDeviceVector<uint32_t>;  // bst_feature_t
+template class HostDeviceVector<FeatureType>;
 
 #if defined(__APPLE__)
 /*
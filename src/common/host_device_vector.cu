@@ -6,6 +6,7 @@
 #include <thrust/device_ptr.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 
@@ -22,6 +23,39 @@ void SetCudaSetDeviceHandler(void (*handler)(int)) {
   cudaSetDeviceHandler = handler;
 }
 
+namespace {
+std::atomic<uint64_t> host_to_device_bytes {0};  // NOLINT
+std::atomic<uint64_t> device_to_host_bytes {0};  // NOLINT
+std::atomic<uint64_t> n_host_to_device {0};      // NOLINT
+std::atomic<uint64_t> n_device_to_host {0};      // NOLINT
+
+void CountTransfer(size_t bytes, cudaMemcpyKind kind) {
+  if (kind == cudaMemcpyHostToDevice) {
+    host_to_device_bytes += bytes;
+    ++n_host_to_device;
+  } else {
+    device_to_host_bytes += bytes;
+    ++n_device_to_host;
+  }
+}
+}  // anonymous namespace
+
+HostDeviceTransfers GetHostDeviceTransfers() {
+  HostDeviceTransfers transfers;
+  transfers.host_to_device_bytes = host_to_device_bytes;
+  transfers.device_to_host_bytes = device_to_host_bytes;
+  transfers.n_host_to_device = n_host_to_device;
+  transfers.n_device_to_host = n_device_to_host;
+  return transfers;
+}
+
+void ResetHostDeviceTransfers() {
+  host_to_device_bytes = 0;
+  device_to_host_bytes = 0;
+  n_host_to_device = 0;
+  n_device_to_host = 0;
+}
+
 template <typename T>
 class HostDeviceVectorImpl {
  public:
@@ -133,6 +167,18 @@ class HostDeviceVectorImpl {
     return data_h_;
   }
 
+  void CopyRangeToHost(size_t begin, size_t size, T* out) {
+    CHECK_LE(begin + size, Size());
+    if (HostCanRead()) {
+      std::copy_n(data_h_.cbegin() + begin, size, out);
+      return;
+    }
+    SetDevice();
+    dh::safe_cuda(cudaMemcpy(out, data_d_->data().get() + begin, size * sizeof(T),
+                             cudaMemcpyDeviceToHost));
+    CountTransfer(size * sizeof(T), cudaMemcpyDeviceToHost);
+  }
+
   void SetDevice(int device) {
     if (device_ == device) { return; }
     if (device_ >= 0) {
@@ -172,6 +218,7 @@ class HostDeviceVectorImpl {
                              data_d_->data().get(),
                              data_d_->size() * sizeof(T),
                              cudaMemcpyDeviceToHost));
+    CountTransfer(data_d_->size() * sizeof(T), cudaMemcpyDeviceToHost);
   }
 
   void LazySyncDevice(GPUAccess access) {
@@ -188,6 +235,7 @@ class HostDeviceVectorImpl {
                              data_h_.data(),
                              data_d_->size() * sizeof(T),
                              cudaMemcpyHostToDevice));
+    CountTransfer(data_d_->size() * sizeof(T), cudaMemcpyHostToDevice);
     gpu_access_ = access;
   }
 
@@ -223,6 +271,7 @@ class HostDeviceVectorImpl {
     SetDevice();
     dh::safe_cuda(cudaMemcpyAsync(data_d_->data().get(), begin,
                                   data_d_->size() * sizeof(T), cudaMemcpyDefault));
+    CountTransfer(data_d_->size() * sizeof(T), cudaMemcpyHostToDevice);
   }
 
   void LazyResizeDevice(size_t new_size) {
@@ -332,6 +381,11 @@ const std::vector<T>& HostDeviceVector<T>::ConstHostVector() const {
   return impl_->ConstHostVector();
 }
 
+template <typename T>
+void HostDeviceVector<T>::CopyRangeToHost(size_t begin, size_t size, T* out) const {
+  impl_->CopyRangeToHost(begin, size, out);
+}
+
 template <typename T>
 bool HostDeviceVector<T>::HostCanRead() const {
   return impl_->HostCanRead();
@@ -374,6 +428,7 @@ template class HostDeviceVector<int32_t>;   // bst_node_t
 template class HostDeviceVector<Entry>;
 template class HostDeviceVector<uint64_t>;  // bst_row_t
 template class HostDeviceVector<uint32_t>;  // bst_feature_t
+template class HostDeviceVector<FeatureType>;
 
 #if defined(__APPLE__)
 /*
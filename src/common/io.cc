@@ -2,12 +2,15 @@
  * Copyright (c) by XGBoost Contributors 2019
  */
 #if defined(__unix__)
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #endif  // defined(__unix__)
 #include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <string>
 #include <utility>
 
@@ -142,5 +145,250 @@ std::string LoadSequentialFile(std::string fname) {
   return buffer;
 }
 
+MmapFile::MmapFile(std::string const& fname) {
+#if defined(__unix__)
+  std::string path = fname;
+  std::string const kFilePrefix = "file://";
+  if (path.compare(0, kFilePrefix.size(), kFilePrefix) == 0) {
+    path = path.substr(kFilePrefix.size());
+  }
+  if (path.find("://") != std::string::npos) {
+    return;  // Remote file system.
+  }
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    return;
+  }
+  struct stat fs;
+  if (fstat(fd_, &fs) != 0 || fs.st_size == 0) {
+    close(fd_);
+    fd_ = -1;
+    return;
+  }
+  size_ = fs.st_size;
+  void* ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (ptr == MAP_FAILED) {
+    close(fd_);
+    fd_ = -1;
+    size_ = 0;
+    return;
+  }
+  madvise(ptr, size_, MADV_SEQUENTIAL);
+  ptr_ = static_cast<char*>(ptr);
+#endif  // defined(__unix__)
+}
+
+MmapFile::~MmapFile() {
+#if defined(__unix__)
+  if (ptr_ != nullptr) {
+    munmap(ptr_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+#endif  // defined(__unix__)
+}
+
+void MmapFile::DropCache() {
+#if defined(__unix__)
+  if (ptr_ != nullptr) {
+    munmap(ptr_, size_);
+    ptr_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+  }
+#endif  // defined(__unix__)
+}
+
+#if DMLC_ENABLE_STD_THREAD
+constexpr size_t AsyncFileReadStream::kDefaultBlockSize;
+
+AsyncFileReadStream* AsyncFileReadStream::Create(std::string const& fname,
+                                                 int32_t queue_depth, bool direct,
+                                                 size_t block_size) {
+  CHECK_GT(queue_depth, 0);
+  // O_DIRECT needs the offsets, sizes and buffers aligned to the logical block size.
+  size_t constexpr kAlignment = 4096;
+  CHECK(block_size != 0 && block_size % kAlignment == 0)
+      << "Block size must be a multiple of " << kAlignment;
+#if defined(__unix__)
+  std::string path = fname;
+  std::string const kFilePrefix = "file://";
+  if (path.compare(0, kFilePrefix.size(), kFilePrefix) == 0) {
+    path = path.substr(kFilePrefix.size());
+  }
+  if (path.find("://") != std::string::npos) {
+    return nullptr;  // Remote file system.
+  }
+  int32_t fd = -1;
+#if defined(O_DIRECT)
+  if (direct) {
+    fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+  }
+#endif  // defined(O_DIRECT)
+  if (fd < 0) {
+    // not requested, or not supported by the file system (e.g. tmpfs)
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return nullptr;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+  struct stat fs;
+  if (fstat(fd, &fs) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  return new AsyncFileReadStream(fd, fs.st_size, queue_depth, block_size);
+#else
+  return nullptr;
+#endif  // defined(__unix__)
+}
+
+AsyncFileReadStream::AsyncFileReadStream(int32_t fd, size_t file_size, int32_t queue_depth,
+                                         size_t block_size)
+    : fd_{fd}, file_size_{file_size}, block_size_{block_size}, queue_depth_{queue_depth} {
+  for (int32_t i = 0; i < queue_depth_; ++i) {
+    readers_.emplace_back([this]() { this->ReadLoop(); });
+  }
+}
+
+AsyncFileReadStream::~AsyncFileReadStream() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& t : readers_) {
+    t.join();
+  }
+  for (auto& kv : ready_) {
+    free_.push_back(kv.second.data);
+  }
+  for (auto ptr : free_) {
+    std::free(ptr);
+  }
+#if defined(__unix__)
+  close(fd_);
+#endif  // defined(__unix__)
+}
+
+void AsyncFileReadStream::ReadLoop() {
+#if defined(__unix__)
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() {
+      return stop_ || (next_read_ < file_size_ && error_.empty() &&
+                       static_cast<int32_t>(ready_.size()) + in_flight_ < queue_depth_);
+    });
+    if (stop_) {
+      return;
+    }
+    size_t const offset = next_read_;
+    uint64_t const generation = generation_;
+    next_read_ += block_size_;
+    ++in_flight_;
+    Block block;
+    if (!free_.empty()) {
+      block.data = free_.back();
+      free_.pop_back();
+    }
+    lock.unlock();
+
+    std::string error;
+    if (block.data == nullptr) {
+      void* ptr = nullptr;
+      if (posix_memalign(&ptr, 4096, block_size_) != 0) {
+        error = "Failed to allocate read buffer";
+      }
+      block.data = static_cast<char*>(ptr);
+    }
+    size_t const expected = std::min(block_size_, file_size_ - offset);
+    while (error.empty() && block.size < expected) {
+      // full blocks are requested, O_DIRECT doesn't allow partial sizes
+      ssize_t n = pread(fd_, block.data + block.size, block_size_ - block.size,
+                        offset + block.size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        error = n == 0 ? "Unexpected end of file" : std::strerror(errno);
+        break;
+      }
+      block.size += n;
+    }
+
+    lock.lock();
+    --in_flight_;
+    if (!error.empty()) {
+      error_ = error;
+    }
+    if (generation != generation_ || offset < consumed_ || !error.empty()) {
+      if (block.data != nullptr) {
+        free_.push_back(block.data);
+      }
+    } else {
+      block.size = std::min(block.size, expected);
+      ready_[offset] = block;
+    }
+    cv_.notify_all();
+  }
+#endif  // defined(__unix__)
+}
+
+size_t AsyncFileReadStream::Read(void* dptr, size_t size) {
+  char* out = static_cast<char*>(dptr);
+  size_t done = 0;
+  while (done < size && pos_ < file_size_) {
+    size_t const base = pos_ / block_size_ * block_size_;
+    Block block;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&]() { return ready_.count(base) != 0 || !error_.empty(); });
+      CHECK(error_.empty()) << "Failed to read the cache file: " << error_;
+      // blocks stay in place until consumed, only the reader threads insert into the map
+      block = ready_.at(base);
+    }
+    size_t const n = std::min(size - done, base + block.size - pos_);
+    std::memcpy(out + done, block.data + (pos_ - base), n);
+    done += n;
+    pos_ += n;
+    if (pos_ == base + block.size) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      ready_.erase(base);
+      free_.push_back(block.data);
+      consumed_ = base + block_size_;
+      cv_.notify_all();
+    }
+  }
+  return done;
+}
+
+void AsyncFileReadStream::Seek(size_t pos) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  size_t const base = pos / block_size_ * block_size_;
+  if (base < consumed_ || base >= next_read_) {
+    // outside of the blocks read ahead, start over at pos
+    ++generation_;
+    for (auto& kv : ready_) {
+      free_.push_back(kv.second.data);
+    }
+    ready_.clear();
+    next_read_ = base;
+    consumed_ = base;
+  } else {
+    // skip forward over the blocks read ahead
+    while (!ready_.empty() && ready_.cbegin()->first < base) {
+      free_.push_back(ready_.cbegin()->second.data);
+      ready_.erase(ready_.cbegin());
+    }
+    consumed_ = base;
+  }
+  pos_ = pos;
+  cv_.notify_all();
+}
+#endif  // DMLC_ENABLE_STD_THREAD
+
 }  // namespace common
 }  // namespace xgboost
@@ -10,8 +10,18 @@
 
 #include <dmlc/io.h>
 #include <rabit/rabit.h>
+#include <xgboost/logging.h>
+
+#include <map>
 #include <string>
 #include <cstring>
+#include <vector>
+
+#if DMLC_ENABLE_STD_THREAD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif  // DMLC_ENABLE_STD_THREAD
 
 #include "common.h"
 
@@ -78,6 +88,91 @@ class FixedSizeStream : public PeekableInStream {
 // Optimized for consecutive file loading in unix like systime.
 std::string LoadSequentialFile(std::string fname);
 
+/*!
+ * \brief Read-only memory mapping of a local file.  Mapping is only supported on unix
+ *        like systems, `Valid` returns false when the file can not be mapped.
+ */
+class MmapFile {
+ public:
+  explicit MmapFile(std::string const& fname);
+  ~MmapFile();
+  MmapFile(MmapFile const&) = delete;
+  MmapFile& operator=(MmapFile const&) = delete;
+
+  bool Valid() const { return ptr_ != nullptr; }
+  char const* Data() const { return ptr_; }
+  size_t Size() const { return size_; }
+  /*!
+   * \brief Unmap the file and evict its pages from the page cache, used once the
+   *        content has been copied so it is not kept in memory twice.
+   */
+  void DropCache();
+
+ private:
+  char* ptr_ {nullptr};
+  size_t size_ {0};
+  int32_t fd_ {-1};
+};
+
+#if DMLC_ENABLE_STD_THREAD
+/*!
+ * \brief Read-only stream of a local file, reading ahead in aligned blocks on background
+ *        threads.  Up to `queue_depth' block reads are in flight or waiting to be
+ *        consumed, so a fast device sees several requests at once.  With `direct' the
+ *        page cache is bypassed through O_DIRECT where the file system supports it.
+ *        Only available on unix like systems, `Create` returns nullptr otherwise.
+ */
+class AsyncFileReadStream : public dmlc::SeekStream {
+ public:
+  static constexpr size_t kDefaultBlockSize = 4UL << 20UL;
+  /*!
+   * \param block_size Size of every read, a multiple of 4096.
+   * \return nullptr when the file can't be opened.
+   */
+  static AsyncFileReadStream* Create(std::string const& fname, int32_t queue_depth,
+                                     bool direct, size_t block_size = kDefaultBlockSize);
+  ~AsyncFileReadStream() override;
+
+  size_t Read(void* dptr, size_t size) override;
+  void Write(const void*, size_t) override {
+    LOG(FATAL) << "AsyncFileReadStream is read only.";
+  }
+  void Seek(size_t pos) override;
+  size_t Tell() override { return pos_; }
+
+ private:
+  struct Block {
+    char* data {nullptr};
+    size_t size {0};
+  };
+  AsyncFileReadStream(int32_t fd, size_t file_size, int32_t queue_depth, size_t block_size);
+  void ReadLoop();
+
+  int32_t fd_;
+  size_t file_size_;
+  size_t block_size_;
+  int32_t queue_depth_;
+  // position of the consumer
+  size_t pos_ {0};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // offset of the next block to be read
+  size_t next_read_ {0};
+  // reads issued but not finished yet
+  int32_t in_flight_ {0};
+  // bumped by seeks that drop every block read ahead
+  uint64_t generation_ {0};
+  // blocks before this offset are no longer needed by the consumer
+  size_t consumed_ {0};
+  std::map<size_t, Block> ready_;
+  std::vector<char*> free_;
+  std::string error_;
+  bool stop_ {false};
+  std::vector<std::thread> readers_;
+};
+#endif  // DMLC_ENABLE_STD_THREAD
+
 inline std::string FileExtension(std::string const& fname) {
   auto splited = Split(fname, '.');
   if (splited.size() > 1) {
@@ -1,21 +1,35 @@
 /*!
  * Copyright (c) by Contributors 2019
  */
+#include <dmlc/endian.h>
+
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <locale>
 #include <sstream>
 #include <limits>
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 #include "xgboost/base.h"
 #include "xgboost/logging.h"
 #include "xgboost/json.h"
 #include "xgboost/json_io.h"
 
+#include "charconv.h"
+
 namespace xgboost {
 
+constexpr size_t JsonWriter::kBufferSize;
+
 void JsonWriter::Save(Json json) {
+  ++depth_;
   json.ptr_->Save(this);
+  if (--depth_ == 0) {
+    this->Flush();
+  }
 }
 
 void JsonWriter::Visit(JsonArray const* arr) {
@@ -39,7 +53,9 @@ void JsonWriter::Visit(JsonObject const* obj) {
   size_t size = obj->getObject().size();
 
   for (auto& value : obj->getObject()) {
-    this->Write("\"" + value.first + "\":");
+    this->Write("\"");
+    this->Write(value.first);
+    this->Write("\":");
     this->Save(value.second);
 
     if (i != size-1) {
@@ -54,17 +70,15 @@ void JsonWriter::Visit(JsonObject const* obj) {
 }
 
 void JsonWriter::Visit(JsonNumber const* num) {
-  convertor_ << num->getNumber();
-  auto const& str = convertor_.str();
-  this->Write(StringView{str.c_str(), str.size()});
-  convertor_.str("");
+  size_t constexpr kSize = common::NumericLimits<Number::Float>::kToCharsSize;
+  char* first = this->Reserve(kSize);
+  this->Commit(common::ToChars(first, first + kSize, num->getNumber()).ptr);
 }
 
 void JsonWriter::Visit(JsonInteger const* num) {
-  convertor_ << num->getInteger();
-  auto const& str = convertor_.str();
-  this->Write(StringView{str.c_str(), str.size()});
-  convertor_.str("");
+  size_t constexpr kSize = common::NumericLimits<Integer::Int>::kToCharsSize;
+  char* first = this->Reserve(kSize);
+  this->Commit(common::ToChars(first, first + kSize, num->getInteger()).ptr);
 }
 
 void JsonWriter::Visit(JsonNull const* null) {
@@ -117,6 +131,45 @@ void JsonWriter::Visit(JsonBoolean const* boolean) {
   }
 }
 
+namespace {
+// Write the whole array in place, integers are promoted so that uint8_t is not written
+// as a character.
+template <typename T>
+void WriteNumbers(std::vector<T> const& vec, JsonWriter* writer) {
+  using Promoted = typename std::conditional<std::is_floating_point<T>::value,
+                                             Number::Float, Integer::Int>::type;
+  size_t constexpr kSize = common::NumericLimits<Promoted>::kToCharsSize;
+  // a separator for each element and the brackets
+  char* const first = writer->Reserve(vec.size() * (kSize + 1) + 2);
+  char* p = first;
+  *p++ = '[';
+  for (size_t i = 0; i < vec.size(); ++i) {
+    p = common::ToChars(p, p + kSize, static_cast<Promoted>(vec[i])).ptr;
+    if (i != vec.size() - 1) {
+      *p++ = ',';
+    }
+  }
+  *p++ = ']';
+  writer->Commit(p);
+}
+}  // anonymous namespace
+
+void JsonWriter::Visit(F32Array const* arr) {
+  WriteNumbers(arr->getArray(), this);
+}
+
+void JsonWriter::Visit(U8Array const* arr) {
+  WriteNumbers(arr->getArray(), this);
+}
+
+void JsonWriter::Visit(I32Array const* arr) {
+  WriteNumbers(arr->getArray(), this);
+}
+
+void JsonWriter::Visit(I64Array const* arr) {
+  WriteNumbers(arr->getArray(), this);
+}
+
 // Value
 std::string Value::TypeStr() const {
   switch (kind_) {
@@ -127,6 +180,10 @@ std::string Value::TypeStr() const {
     case ValueKind::Boolean: return "Boolean"; break;
     case ValueKind::Null:    return "Null";    break;
     case ValueKind::Integer: return "Integer"; break;
+    case ValueKind::F32Array: return "F32Array"; break;
+    case ValueKind::U8Array:  return "U8Array";  break;
+    case ValueKind::I32Array: return "I32Array"; break;
+    case ValueKind::I64Array: return "I64Array"; break;
   }
   return "";
 }
@@ -230,6 +287,49 @@ void JsonArray::Save(JsonWriter* writer) {
   writer->Visit(this);
 }
 
+// Json typed array
+template <typename T, Value::ValueKind kind>
+Json& JsonTypedArray<T, kind>::operator[](std::string const & key) {
+  LOG(FATAL) << "Object of type "
+             << Value::TypeStr() << " can not be indexed by string.";
+  return DummyJsonObject();
+}
+
+template <typename T, Value::ValueKind kind>
+Json& JsonTypedArray<T, kind>::operator[](int ind) {
+  LOG(FATAL) << "Object of type "
+             << Value::TypeStr() << " can not be indexed by Integer."
+             << "  Please try obtaining the typed vector first.";
+  return DummyJsonObject();
+}
+
+template <typename T, Value::ValueKind kind>
+bool JsonTypedArray<T, kind>::operator==(Value const& rhs) const {
+  if (!IsA<JsonTypedArray>(&rhs)) { return false; }
+  auto const& arr = Cast<JsonTypedArray const>(&rhs)->getArray();
+  if (arr.size() != vec_.size()) { return false; }
+  return std::equal(arr.cbegin(), arr.cend(), vec_.cbegin(), [](T l, T r) {
+    return std::is_floating_point<T>::value ? std::abs(l - r) < kRtEps : l == r;
+  });
+}
+
+template <typename T, Value::ValueKind kind>
+Value& JsonTypedArray<T, kind>::operator=(Value const &rhs) {
+  JsonTypedArray const* casted = Cast<JsonTypedArray const>(&rhs);
+  vec_ = casted->getArray();
+  return *this;
+}
+
+template <typename T, Value::ValueKind kind>
+void JsonTypedArray<T, kind>::Save(JsonWriter* writer) {
+  writer->Visit(this);
+}
+
+template class JsonTypedArray<float, Value::ValueKind::F32Array>;
+template class JsonTypedArray<uint8_t, Value::ValueKind::U8Array>;
+template class JsonTypedArray<int32_t, Value::ValueKind::I32Array>;
+template class JsonTypedArray<int64_t, Value::ValueKind::I64Array>;
+
 // Json Number
 Json& JsonNumber::operator[](std::string const & key) {
   LOG(FATAL) << "Object of type "
@@ -310,7 +410,7 @@ Value & JsonNull::operator=(Value const &rhs) {
 }
 
 void JsonNull::Save(JsonWriter* writer) {
-  writer->Write("null");
+  writer->Visit(this);
 }
 
 // Json Boolean
@@ -343,6 +443,13 @@ void JsonBoolean::Save(JsonWriter *writer) {
 
 size_t constexpr JsonReader::kMaxNumLength;
 
+namespace {
+// For now we only accept `NaN`, not `nan` as the later violiates LR(1) with `null`.
+bool IsNumberStart(char c) {
+  return c == '-' || std::isdigit(c) || c == 'N' || c == 'I';
+}
+}  // anonymous namespace
+
 Json JsonReader::Parse() {
   while (true) {
     SkipSpaces();
@@ -353,9 +460,7 @@ Json JsonReader::Parse() {
       return ParseObject();
     } else if ( c == '[' ) {
       return ParseArray();
-    } else if ( c == '-' || std::isdigit(c) ||
-                c == 'N' ) {
-      // For now we only accept `NaN`, not `nan` as the later violiates LR(1) with `null`.
+    } else if (IsNumberStart(c)) {
       return ParseNumber();
     } else if ( c == '\"' ) {
       return ParseString();
@@ -484,6 +589,12 @@ Json JsonReader::ParseArray() {
   std::vector<Json> data;
 
   char ch { GetChar('[') };  // NOLINT
+  if (typed_arrays_) {
+    SkipSpaces();
+    if (IsNumberStart(PeekNextChar())) {
+      return ParseNumericArray();
+    }
+  }
   while (true) {
     if (PeekNextChar() == ']') {
       GetChar(']');
@@ -501,6 +612,77 @@ Json JsonReader::ParseArray() {
   return Json(std::move(data));
 }
 
+Json JsonReader::ParseNumericArray() {
+  // Elements are stored as plain numbers until one of another type shows up.
+  std::vector<float> floats;
+  std::vector<int64_t> ints;
+  bool first_is_float {false};
+  bool is_float {false};
+  Number::Float f {0};
+  int64_t i {0};
+  bool homogeneous {true};
+  char ch {','};
+  while (ch == ',') {
+    SkipSpaces();
+    ch = PeekNextChar();
+    if (!IsNumberStart(ch)) {
+      homogeneous = false;
+      break;
+    }
+    ParseNumberImpl(&is_float, &f, &i);
+    if (floats.empty() && ints.empty()) {
+      first_is_float = is_float;
+    }
+    if (is_float != first_is_float) {
+      homogeneous = false;
+      break;
+    }
+    if (is_float) {
+      floats.push_back(f);
+    } else {
+      ints.push_back(i);
+    }
+    ch = GetNextNonSpaceChar();
+  }
+
+  if (homogeneous) {
+    if (ch != ']') {
+      Expect(']', ch);
+    }
+    if (first_is_float) {
+      return Json{F32Array{std::move(floats)}};
+    }
+    return Json{I64Array{std::move(ints)}};
+  }
+
+  std::vector<Json> data;
+  for (auto v : floats) {
+    data.emplace_back(Number{v});
+  }
+  for (auto v : ints) {
+    data.emplace_back(Integer{v});
+  }
+  if (is_float != first_is_float) {
+    // The last parsed number is of the other type.
+    if (is_float) {
+      data.emplace_back(Number{f});
+    } else {
+      data.emplace_back(Integer{i});
+    }
+  } else {
+    data.push_back(Parse());
+  }
+  ch = GetNextNonSpaceChar();
+  while (ch == ',') {
+    data.push_back(Parse());
+    ch = GetNextNonSpaceChar();
+  }
+  if (ch != ']') {
+    Expect(']', ch);
+  }
+  return Json(std::move(data));
+}
+
 Json JsonReader::ParseObject() {
   GetChar('{');
 
@@ -545,125 +727,53 @@ Json JsonReader::ParseObject() {
 }
 
 Json JsonReader::ParseNumber() {
-  // Adopted from sajson with some simplifications and small optimizations.
-  char const* p = raw_str_.c_str() + cursor_.Pos();
-  char const* const beg = p;  // keep track of current pointer
-
-  // TODO(trivialfis): Add back all the checks for number
-  bool negative = false;
-  if (XGBOOST_EXPECT(*p == 'N', false)) {
-    GetChar('N');
-    GetChar('a');
-    GetChar('N');
-    return Json(static_cast<Number::Float>(std::numeric_limits<float>::quiet_NaN()));
+  bool is_float {false};
+  Number::Float f {0};
+  int64_t i {0};
+  ParseNumberImpl(&is_float, &f, &i);
+  if (is_float) {
+    return Json(f);
+  } else {
+    return Json(JsonInteger(i));
   }
+}
+
+void JsonReader::ParseNumberImpl(bool* out_is_float, Number::Float* out_f, int64_t* out_i) {
+  char const* const beg = raw_str_.c_str() + cursor_.Pos();
+  char const* const end = raw_str_.c_str() + raw_str_.size();
+  char const* p = beg;
 
-  if ('-' == *p) {
+  bool negative = false;
+  if (p != end && '-' == *p) {
     ++p;
     negative = true;
   }
-
-  bool is_float = false;
-
-  using ExpInt = std::remove_const<
-    decltype(std::numeric_limits<Number::Float>::max_exponent)>::type;
-  constexpr auto kExpMax = std::numeric_limits<ExpInt>::max();
-  constexpr auto kExpMin = std::numeric_limits<ExpInt>::min();
-
+  // Integers are accumulated directly, anything with a fraction, an exponent or a
+  // non-finite value is handed to the float parser.
   JsonInteger::Int i = 0;
-  double f = 0.0;  // Use double to maintain accuracy
-
-  if (*p == '0') {
+  if (p != end && *p == '0') {
     ++p;
-  } else {
-    char c = *p;
+  } else if (p != end && std::isdigit(*p)) {
     do {
+      i = 10 * i + (*p - '0');
       ++p;
-      char digit = c - '0';
-      i = 10 * i + digit;
-      c = *p;
-    } while (std::isdigit(c));
+    } while (p != end && std::isdigit(*p));
+  } else if (p == end || (*p != 'N' && *p != 'I')) {
+    Error("Invalid number.");
   }
 
-  ExpInt exponent = 0;
-  const char *const dot_position = p;
-  if ('.' == *p) {
-    is_float = true;
-    f = i;
-    ++p;
-    char c = *p;
-
-    do {
-      ++p;
-      f = f * 10 + (c - '0');
-      c = *p;
-    } while (std::isdigit(c));
+  if (p == end || (*p != '.' && *p != 'e' && *p != 'E' && *p != 'N' && *p != 'I')) {
+    *out_is_float = false;
+    *out_i = negative ? -i : i;
+    cursor_.Forward(static_cast<uint32_t>(p - beg));
+    return;
   }
-  if (is_float) {
-    exponent = dot_position - p + 1;
-  }
-
-  char e = *p;
-  if ('e' == e || 'E' == e) {
-    if (!is_float) {
-      is_float = true;
-      f = i;
-    }
-    ++p;
-
-    bool negative_exponent = false;
-    if ('-' == *p) {
-      negative_exponent = true;
-      ++p;
-    } else if ('+' == *p) {
-      ++p;
-    }
-
-    ExpInt exp = 0;
-
-    char c = *p;
-    while (std::isdigit(c)) {
-      unsigned char digit = c - '0';
-      if (XGBOOST_EXPECT(exp > (kExpMax - digit) / 10, false)) {
-        CHECK_GT(exp, (kExpMax - digit) / 10) << "Overflow";
-      }
-      exp = 10 * exp + digit;
-      ++p;
-      c = *p;
-    }
-    static_assert(-kExpMax >= kExpMin, "exp can be negated without loss or UB");
-    exponent += (negative_exponent ? -exp : exp);
-  }
-
-  if (exponent) {
-    CHECK(is_float);
-    // If d is zero but the exponent is huge, don't
-    // multiply zero by inf which gives nan.
-    if (f != 0.0) {
-      // Only use exp10 from libc on gcc+linux
-#if !defined(__GNUC__) || defined(_WIN32) || defined(__APPLE__) || !defined(__linux__)
-#define exp10(val) std::pow(10, (val))
-#endif  // !defined(__GNUC__) || defined(_WIN32) || defined(__APPLE__) || !defined(__linux__)
-      f *= exp10(exponent);
-#if !defined(__GNUC__) || defined(_WIN32) || defined(__APPLE__) || !defined(__linux__)
-#undef exp10
-#endif  // !defined(__GNUC__) || defined(_WIN32) || defined(__APPLE__) || !defined(__linux__)
-    }
-  }
-
-  if (negative) {
-      f = -f;
-      i = -i;
-  }
-
-  auto moved = std::distance(beg, p);
-  this->cursor_.Forward(moved);
-
-  if (is_float) {
-    return Json(static_cast<Number::Float>(f));
-  } else {
-    return Json(JsonInteger(i));
+  auto res = common::FromChars(beg, end, out_f);
+  if (res.ec != std::errc()) {
+    Error("Invalid number.");
   }
+  *out_is_float = true;
+  cursor_.Forward(static_cast<uint32_t>(res.ptr - beg));
 }
 
 Json JsonReader::ParseBoolean() {
@@ -693,8 +803,8 @@ Json JsonReader::ParseBoolean() {
   return Json{JsonBoolean{result}};
 }
 
-Json Json::Load(StringView str) {
-  JsonReader reader(str);
+Json Json::Load(StringView str, bool typed_arrays) {
+  JsonReader reader(str, typed_arrays);
   Json json{reader.Load()};
   return json;
 }
@@ -710,11 +820,266 @@ void Json::Dump(Json json, std::ostream *stream, bool pretty) {
 }
 
 void Json::Dump(Json json, std::string* str, bool pretty) {
-  std::stringstream ss;
-  JsonWriter writer(&ss, pretty);
+  str->clear();
+  JsonWriter writer(str, pretty);
   writer.Save(json);
-  *str = ss.str();
 }
 
 Json& Json::operator=(Json const &other) = default;
+
+// UBJSON
+namespace {
+template <typename T>
+void SwapBigEndian(T* data, size_t n) {
+#if DMLC_LITTLE_ENDIAN
+  dmlc::ByteSwap(data, sizeof(T), n);
+#endif  // DMLC_LITTLE_ENDIAN
+}
+
+void WriteChar(char c, JsonWriter* writer) {
+  writer->Write(StringView{&c, 1});
+}
+
+template <typename T>
+void WritePrimitive(T v, JsonWriter* writer) {
+  SwapBigEndian(&v, 1);
+  writer->Write(StringView{reinterpret_cast<char const*>(&v), sizeof(v)});
+}
+
+// Integers are written with the smallest type that holds them.
+void WriteInteger(int64_t v, JsonWriter* writer) {
+  if (v >= std::numeric_limits<int8_t>::min() && v <= std::numeric_limits<int8_t>::max()) {
+    WriteChar('i', writer);
+    WritePrimitive(static_cast<int8_t>(v), writer);
+  } else if (v >= 0 && v <= std::numeric_limits<uint8_t>::max()) {
+    WriteChar('U', writer);
+    WritePrimitive(static_cast<uint8_t>(v), writer);
+  } else if (v >= std::numeric_limits<int16_t>::min() &&
+             v <= std::numeric_limits<int16_t>::max()) {
+    WriteChar('I', writer);
+    WritePrimitive(static_cast<int16_t>(v), writer);
+  } else if (v >= std::numeric_limits<int32_t>::min() &&
+             v <= std::numeric_limits<int32_t>::max()) {
+    WriteChar('l', writer);
+    WritePrimitive(static_cast<int32_t>(v), writer);
+  } else {
+    WriteChar('L', writer);
+    WritePrimitive(v, writer);
+  }
+}
+
+void WriteStr(std::string const& str, JsonWriter* writer) {
+  WriteInteger(static_cast<int64_t>(str.size()), writer);
+  writer->Write(StringView{str.c_str(), str.size()});
+}
+
+template <typename T>
+void WriteTypedArray(std::vector<T> const& vec, char marker, JsonWriter* writer) {
+  WriteChar('[', writer);
+  WriteChar('$', writer);
+  WriteChar(marker, writer);
+  WriteChar('#', writer);
+  WriteInteger(static_cast<int64_t>(vec.size()), writer);
+  std::vector<T> buffer(vec);
+  SwapBigEndian(buffer.data(), buffer.size());
+  writer->Write(StringView{reinterpret_cast<char const*>(buffer.data()),
+                           buffer.size() * sizeof(T)});
+}
+}  // anonymous namespace
+
+void UBJWriter::Visit(JsonArray const* arr) {
+  WriteChar('[', this);
+  auto const& vec = arr->getArray();
+  WriteChar('#', this);
+  WriteInteger(static_cast<int64_t>(vec.size()), this);
+  for (auto const& value : vec) {
+    this->Save(value);
+  }
+}
+
+void UBJWriter::Visit(JsonObject const* obj) {
+  WriteChar('{', this);
+  for (auto const& value : obj->getObject()) {
+    WriteStr(value.first, this);
+    this->Save(value.second);
+  }
+  WriteChar('}', this);
+}
+
+void UBJWriter::Visit(JsonNumber const* num) {
+  WriteChar('d', this);
+  WritePrimitive(num->getNumber(), this);
+}
+
+void UBJWriter::Visit(JsonInteger const* num) {
+  WriteInteger(num->getInteger(), this);
+}
+
+void UBJWriter::Visit(JsonNull const* null) {
+  WriteChar('Z', this);
+}
+
+void UBJWriter::Visit(JsonString const* str) {
+  WriteChar('S', this);
+  WriteStr(str->getString(), this);
+}
+
+void UBJWriter::Visit(JsonBoolean const* boolean) {
+  WriteChar(boolean->getBoolean() ? 'T' : 'F', this);
+}
+
+void UBJWriter::Visit(F32Array const* arr) {
+  WriteTypedArray(arr->getArray(), 'd', this);
+}
+
+void UBJWriter::Visit(U8Array const* arr) {
+  WriteTypedArray(arr->getArray(), 'U', this);
+}
+
+void UBJWriter::Visit(I32Array const* arr) {
+  WriteTypedArray(arr->getArray(), 'l', this);
+}
+
+void UBJWriter::Visit(I64Array const* arr) {
+  WriteTypedArray(arr->getArray(), 'L', this);
+}
+
+template <typename T>
+T UBJReader::ReadPrimitive() {
+  if (XGBOOST_EXPECT(cursor_.Pos() + sizeof(T) > raw_str_.size(), false)) {
+    Error("Unexpected end of UBJSON");
+  }
+  T v;
+  std::memcpy(&v, raw_str_.c_str() + cursor_.Pos(), sizeof(T));
+  cursor_.Forward(sizeof(T));
+  SwapBigEndian(&v, 1);
+  return v;
+}
+
+int64_t UBJReader::ReadInteger(char marker) {
+  switch (marker) {
+    case 'i': return ReadPrimitive<int8_t>();
+    case 'U': return ReadPrimitive<uint8_t>();
+    case 'I': return ReadPrimitive<int16_t>();
+    case 'l': return ReadPrimitive<int32_t>();
+    case 'L': return ReadPrimitive<int64_t>();
+    default: Error("Expecting an integer marker");
+  }
+  return 0;
+}
+
+std::string UBJReader::DecodeStr() {
+  int64_t n = ReadInteger(GetNextChar());
+  if (XGBOOST_EXPECT(n < 0 || cursor_.Pos() + n > raw_str_.size(), false)) {
+    Error("Invalid string length");
+  }
+  std::string str{raw_str_.c_str() + cursor_.Pos(), static_cast<size_t>(n)};
+  cursor_.Forward(static_cast<size_t>(n));
+  return str;
+}
+
+template <typename T, typename TypedArray>
+Json UBJReader::DecodeTypedArray(int64_t n) {
+  if (XGBOOST_EXPECT(n < 0 || cursor_.Pos() + n * sizeof(T) > raw_str_.size(), false)) {
+    Error("Invalid length of typed array");
+  }
+  std::vector<T> buffer(static_cast<size_t>(n));
+  std::memcpy(buffer.data(), raw_str_.c_str() + cursor_.Pos(), buffer.size() * sizeof(T));
+  cursor_.Forward(buffer.size() * sizeof(T));
+  SwapBigEndian(buffer.data(), buffer.size());
+  using ElemType = typename TypedArray::ElemType;
+  std::vector<ElemType> vec(buffer.cbegin(), buffer.cend());
+  return Json{TypedArray{std::move(vec)}};
+}
+
+Json UBJReader::DecodeArray() {
+  char type {0};
+  int64_t n {-1};
+  if (PeekNextChar() == '$') {
+    cursor_.Forward();
+    type = GetNextChar();
+    if (PeekNextChar() != '#') {
+      Expect('#', PeekNextChar());
+    }
+  }
+  if (PeekNextChar() == '#') {
+    cursor_.Forward();
+    n = ReadInteger(GetNextChar());
+  }
+  switch (type) {
+    case 0: break;
+    case 'd': return DecodeTypedArray<float, F32Array>(n);
+    case 'D': return DecodeTypedArray<double, F32Array>(n);
+    case 'U': return DecodeTypedArray<uint8_t, U8Array>(n);
+    case 'i': return DecodeTypedArray<int8_t, I32Array>(n);
+    case 'I': return DecodeTypedArray<int16_t, I32Array>(n);
+    case 'l': return DecodeTypedArray<int32_t, I32Array>(n);
+    case 'L': return DecodeTypedArray<int64_t, I64Array>(n);
+    default: Error("Unsupported type of typed array");
+  }
+
+  std::vector<Json> data;
+  if (n >= 0) {
+    data.reserve(static_cast<size_t>(n));
+    for (int64_t i = 0; i < n; ++i) {
+      data.push_back(Parse());
+    }
+    return Json(std::move(data));
+  }
+  while (PeekNextChar() != ']') {
+    data.push_back(Parse());
+  }
+  GetNextChar();
+  return Json(std::move(data));
+}
+
+Json UBJReader::DecodeObject() {
+  std::map<std::string, Json> data;
+  if (PeekNextChar() == '$') {
+    Error("Typed object is not supported");
+  }
+  int64_t n {-1};
+  if (PeekNextChar() == '#') {
+    cursor_.Forward();
+    n = ReadInteger(GetNextChar());
+  }
+  if (n >= 0) {
+    for (int64_t i = 0; i < n; ++i) {
+      auto key = DecodeStr();
+      data[key] = Parse();
+    }
+    return Json(std::move(data));
+  }
+  while (PeekNextChar() != '}') {
+    auto key = DecodeStr();
+    data[key] = Parse();
+  }
+  GetNextChar();
+  return Json(std::move(data));
+}
+
+Json UBJReader::Parse() {
+  while (true) {
+    char c = GetNextChar();
+    switch (c) {
+      case 'N': continue;  // no-op
+      case '{': return DecodeObject();
+      case '[': return DecodeArray();
+      case 'Z': return Json{JsonNull()};
+      case 'T': return Json{JsonBoolean{true}};
+      case 'F': return Json{JsonBoolean{false}};
+      case 'i':
+      case 'U':
+      case 'I':
+      case 'l':
+      case 'L': return Json{JsonInteger{ReadInteger(c)}};
+      case 'd': return Json{JsonNumber{ReadPrimitive<float>()}};
+      case 'D': return Json{JsonNumber{ReadPrimitive<double>()}};
+      case 'S': return Json{JsonString{DecodeStr()}};
+      case 'C': return Json{JsonString{std::string(1, GetNextChar())}};
+      default: Error("Unknown construct");
+    }
+  }
+  return Json();
+}
 }  // namespace xgboost
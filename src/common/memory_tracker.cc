@@ -0,0 +1,71 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file memory_tracker.cc
+ */
+#include <xgboost/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "memory_tracker.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+struct ComponentStats {
+  int64_t current {0};
+  int64_t peak {0};
+};
+
+struct TrackerState {
+  std::mutex lock;
+  std::map<std::string, ComponentStats> components;
+
+  static TrackerState& Get() {
+    // Never destroyed, tracked buffers may outlive static destruction.
+    static auto* state = new TrackerState;
+    return *state;
+  }
+};
+}  // anonymous namespace
+
+void HostMemoryTracker::Add(char const* component, int64_t bytes) {
+  auto& state = TrackerState::Get();
+  std::lock_guard<std::mutex> guard(state.lock);
+  auto& stats = state.components[component];
+  stats.current += bytes;
+  stats.peak = std::max(stats.peak, stats.current);
+}
+
+Json HostMemoryTracker::Stats() {
+  Json out {Object()};
+  auto& state = TrackerState::Get();
+  std::lock_guard<std::mutex> guard(state.lock);
+  for (auto const& kv : state.components) {
+    auto& j_component = out[kv.first];
+    j_component = Object();
+    j_component["current"] = Integer(kv.second.current);
+    j_component["peak"] = Integer(kv.second.peak);
+  }
+  return out;
+}
+
+void HostMemoryTracker::Log() {
+  if (!ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
+    return;
+  }
+  auto& state = TrackerState::Get();
+  std::lock_guard<std::mutex> guard(state.lock);
+  if (state.components.empty()) {
+    return;
+  }
+  LOG(CONSOLE) << "======== Host memory statistics ========";
+  for (auto const& kv : state.components) {
+    LOG(CONSOLE) << kv.first << ": current " << kv.second.current << " bytes, peak "
+                 << kv.second.peak << " bytes";
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,77 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file memory_tracker.h
+ * \brief Accounting of the host memory held by the major data structures.
+ */
+#ifndef XGBOOST_COMMON_MEMORY_TRACKER_H_
+#define XGBOOST_COMMON_MEMORY_TRACKER_H_
+
+#include <xgboost/json.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief Current and peak bytes of each component, like `dh::MemoryLogger' for host
+ *  memory.  Components are named by string literals and their buffers are registered
+ *  with `TrackedBytes', so only the large buffers are accounted for.
+ */
+class HostMemoryTracker {
+ public:
+  static void Add(char const* component, int64_t bytes);
+  /*! \brief {"<component>": {"current": bytes, "peak": bytes}} */
+  static Json Stats();
+  /*! \brief Log the statistics with debug verbosity. */
+  static void Log();
+};
+
+/*!
+ * \brief Bytes held by a buffer of a component, counted by `HostMemoryTracker' as long
+ *  as this lives.  A copy counts the bytes once more, as the buffer is copied too.
+ */
+class TrackedBytes {
+  char const* component_;
+  size_t bytes_ {0};
+
+ public:
+  explicit TrackedBytes(char const* component) : component_{component} {}
+  TrackedBytes(TrackedBytes const& that) : component_{that.component_} {
+    this->Set(that.bytes_);
+  }
+  TrackedBytes(TrackedBytes&& that) noexcept
+      : component_{that.component_}, bytes_{that.bytes_} {
+    that.bytes_ = 0;
+  }
+  TrackedBytes& operator=(TrackedBytes const& that) {
+    if (this != &that) {
+      this->Set(0);
+      component_ = that.component_;
+      this->Set(that.bytes_);
+    }
+    return *this;
+  }
+  TrackedBytes& operator=(TrackedBytes&& that) noexcept {
+    if (this != &that) {
+      this->Set(0);
+      component_ = that.component_;
+      bytes_ = that.bytes_;
+      that.bytes_ = 0;
+    }
+    return *this;
+  }
+  ~TrackedBytes() { this->Set(0); }
+
+  void Set(size_t bytes) {
+    if (bytes != bytes_) {
+      HostMemoryTracker::Add(component_, static_cast<int64_t>(bytes) -
+                                             static_cast<int64_t>(bytes_));
+      bytes_ = bytes;
+    }
+  }
+  size_t Bytes() const { return bytes_; }
+};
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_MEMORY_TRACKER_H_
@@ -0,0 +1,131 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file perf_counters.cc
+ */
+#if defined(XGBOOST_USE_PERF_COUNTERS)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(XGBOOST_USE_PERF_COUNTERS)
+
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "xgboost/logging.h"
+#include "perf_counters.h"
+
+namespace xgboost {
+namespace common {
+#if defined(XGBOOST_USE_PERF_COUNTERS)
+namespace {
+constexpr size_t kEvents = 4;
+
+struct CounterGroups {
+  std::mutex lock;
+  // group leader of each thread, the group is read through it
+  std::vector<int> leaders;
+  int32_t max_threads {0};
+  bool failed {false};
+
+  static CounterGroups& Get() {
+    // Never destroyed, the counters are closed along with the process.
+    static auto* groups = new CounterGroups;
+    return *groups;
+  }
+};
+
+int OpenEvent(uint64_t config, int group) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  // calling thread, on any cpu
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+void OpenThisThread(CounterGroups* groups) {
+  static thread_local bool opened {false};
+  if (opened) {
+    return;
+  }
+  opened = true;
+  uint64_t const configs[kEvents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                     PERF_COUNT_HW_CACHE_REFERENCES,
+                                     PERF_COUNT_HW_CACHE_MISSES};
+  std::vector<int> fds;
+  for (size_t i = 0; i < kEvents; ++i) {
+    int fd = OpenEvent(configs[i], fds.empty() ? -1 : fds.front());
+    if (fd < 0) {
+      break;
+    }
+    fds.push_back(fd);
+  }
+  int const error = errno;
+  std::lock_guard<std::mutex> guard(groups->lock);
+  if (fds.size() != kEvents) {
+    for (auto fd : fds) {
+      close(fd);
+    }
+    if (!groups->failed) {
+      LOG(WARNING) << "Hardware performance counters are not available: "
+                   << std::strerror(error);
+    }
+    groups->failed = true;
+    return;
+  }
+  groups->leaders.push_back(fds.front());
+}
+}  // anonymous namespace
+
+bool ReadPerfCounters(PerfSample* out) {
+  auto& groups = CounterGroups::Get();
+  OpenThisThread(&groups);
+  int32_t const n_threads = omp_get_max_threads();
+  bool open_workers;
+  {
+    std::lock_guard<std::mutex> guard(groups.lock);
+    open_workers = n_threads > groups.max_threads;
+    groups.max_threads = std::max(groups.max_threads, n_threads);
+  }
+  if (open_workers) {
+    // Workers of the pool are reused, so each of them opens its group only once.
+#pragma omp parallel num_threads(n_threads)
+    { OpenThisThread(&groups); }
+  }
+
+  std::lock_guard<std::mutex> guard(groups.lock);
+  if (groups.failed) {
+    return false;
+  }
+  *out = PerfSample{};
+  struct {
+    uint64_t nr;
+    uint64_t values[kEvents];
+  } buffer;
+  for (auto leader : groups.leaders) {
+    if (read(leader, &buffer, sizeof(buffer)) != sizeof(buffer) || buffer.nr != kEvents) {
+      continue;
+    }
+    PerfSample sample;
+    sample.cycles = buffer.values[0];
+    sample.instructions = buffer.values[1];
+    sample.llc_references = buffer.values[2];
+    sample.llc_misses = buffer.values[3];
+    *out += sample;
+  }
+  return true;
+}
+#else
+bool ReadPerfCounters(PerfSample*) { return false; }
+#endif  // defined(XGBOOST_USE_PERF_COUNTERS)
+}  // namespace common
+}  // namespace xgboost
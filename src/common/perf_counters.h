@@ -0,0 +1,52 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file perf_counters.h
+ * \brief Hardware performance counters of the OpenMP threads, built with
+ *  `USE_PERF_COUNTERS' on Linux.
+ */
+#ifndef XGBOOST_COMMON_PERF_COUNTERS_H_
+#define XGBOOST_COMMON_PERF_COUNTERS_H_
+
+#include <cstdint>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief Counters summed over the threads, in user space only. */
+struct PerfSample {
+  uint64_t cycles {0};
+  uint64_t instructions {0};
+  /*! \brief references to the last level cache */
+  uint64_t llc_references {0};
+  uint64_t llc_misses {0};
+
+  PerfSample& operator+=(PerfSample const& that) {
+    cycles += that.cycles;
+    instructions += that.instructions;
+    llc_references += that.llc_references;
+    llc_misses += that.llc_misses;
+    return *this;
+  }
+  PerfSample operator-(PerfSample const& that) const {
+    PerfSample out;
+    out.cycles = cycles - that.cycles;
+    out.instructions = instructions - that.instructions;
+    out.llc_references = llc_references - that.llc_references;
+    out.llc_misses = llc_misses - that.llc_misses;
+    return out;
+  }
+  /*! \brief Estimate of the bytes read from memory, a cache line for each miss. */
+  uint64_t MemoryBytes() const { return llc_misses * 64; }
+};
+
+/*!
+ * \brief Read the counters of this thread and the OpenMP workers, opening them with
+ *  `perf_event_open' on first use by each thread.
+ *
+ * \return Whether the counters are available.  They're not unless built with
+ *  `USE_PERF_COUNTERS', or when the kernel refuses, see `perf_event_paranoid'.
+ */
+bool ReadPerfCounters(PerfSample* out);
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_PERF_COUNTERS_H_
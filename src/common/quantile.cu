@@ -0,0 +1,337 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file quantile.cu
+ */
+#include <thrust/binary_search.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "quantile.cuh"
+
+namespace xgboost {
+namespace common {
+
+using SketchEntry = DeviceSketchContainer::SketchEntry;
+
+namespace {
+template <typename T>
+Span<T> ToSpan(dh::caching_device_vector<T>* vec) {
+  return {vec->data().get(), vec->size()};
+}
+
+// The feature holding the `idx'th entry.
+__device__ bst_feature_t ColumnOf(Span<size_t const> columns_ptr, size_t idx) {
+  return dh::UpperBound(columns_ptr.data(), columns_ptr.size(), idx) - 1;
+}
+
+// First entry with a value not less than `value', or greater than it for `kUpper'.
+template <bool kUpper>
+__device__ size_t SearchValue(SketchEntry const* entries, size_t n, float value) {
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    bool const right = kUpper ? entries[mid].value <= value : entries[mid].value < value;
+    if (right) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/*!
+ * \brief Index of the entry picked for the `k'th of `m' slots when pruning `n' entries,
+ *  the same as the one picked by `WQSummary::SetPrune'.
+ */
+__device__ size_t PruneIndex(SketchEntry const* s, size_t n, size_t m, size_t k) {
+  if (k == 0) {
+    return 0;
+  }
+  if (k == m - 1) {
+    return n - 1;
+  }
+  float const begin = s[0].rmax;
+  float const range = s[n - 1].rmin - s[0].rmax;
+  size_t const last = m - 1;
+  float const dx2 = 2 * ((k * range) / last + begin);
+  // first i such that dx2 < rmax[i + 1] + rmin[i + 1]
+  size_t lo = 2, hi = n;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    if (s[mid].rmax + s[mid].rmin <= dx2) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  size_t const i = std::min(lo - 1, n - 2);
+  return dx2 < s[i].RMinNext() + s[i + 1].RMaxPrev() ? i : i + 1;
+}
+
+/*!
+ * \brief Keeps the slots flagged in `keep', which is overwritten.  `slots_ptr' points to
+ *  the first slot of each feature.
+ */
+void Compact(int device, Span<SketchEntry const> slots, dh::caching_device_vector<size_t>* keep,
+             Span<size_t const> slots_ptr, dh::device_vector<SketchEntry>* out_entries,
+             dh::device_vector<size_t>* out_columns_ptr) {
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  thrust::inclusive_scan(thrust::cuda::par(alloc), keep->begin(), keep->end(), keep->begin());
+  size_t const n_kept = keep->empty() ? 0 : keep->back();
+  out_entries->resize(n_kept);
+  out_columns_ptr->resize(slots_ptr.size());
+  auto d_pos = ToSpan(keep);
+  auto d_out = dh::ToSpan(*out_entries);
+  auto d_out_ptr = dh::ToSpan(*out_columns_ptr);
+  dh::LaunchN(device, slots.size(), [=] __device__(size_t i) {
+    size_t const prev = i == 0 ? 0 : d_pos[i - 1];
+    if (d_pos[i] != prev) {
+      d_out[prev] = slots[i];
+    }
+  });
+  dh::LaunchN(device, slots_ptr.size(), [=] __device__(size_t c) {
+    d_out_ptr[c] = slots_ptr[c] == 0 ? 0 : d_pos[slots_ptr[c] - 1];
+  });
+}
+
+// Re-establishes the rank invariants after merging, see `WQSummary::FixError'.
+void FixError(int device, dh::device_vector<SketchEntry>* entries,
+              Span<size_t const> columns_ptr) {
+  size_t const n = entries->size();
+  if (n == 0) {
+    return;
+  }
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  dh::caching_device_vector<bst_feature_t> columns(n);
+  dh::caching_device_vector<float> rmin(n);
+  dh::caching_device_vector<float> rmax(n);
+  auto d_columns = ToSpan(&columns);
+  auto d_rmin = ToSpan(&rmin);
+  auto d_rmax = ToSpan(&rmax);
+  auto d_entries = dh::ToSpan(*entries);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_columns[i] = ColumnOf(columns_ptr, i);
+    d_rmin[i] = d_entries[i].rmin;
+  });
+  // rmin never decreases
+  thrust::inclusive_scan_by_key(thrust::cuda::par(alloc), columns.begin(), columns.end(),
+                                rmin.begin(), rmin.begin(), thrust::equal_to<bst_feature_t>(),
+                                thrust::maximum<float>());
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_entries[i].rmin = d_rmin[i];
+    d_rmax[i] = std::max(d_entries[i].rmax, d_entries[i].RMinNext());
+  });
+  // neither does rmax, which is at least the next rmin
+  thrust::inclusive_scan_by_key(thrust::cuda::par(alloc), columns.begin(), columns.end(),
+                                rmax.begin(), rmax.begin(), thrust::equal_to<bst_feature_t>(),
+                                thrust::maximum<float>());
+  dh::LaunchN(device, n, [=] __device__(size_t i) { d_entries[i].rmax = d_rmax[i]; });
+}
+}  // anonymous namespace
+
+void PruneSummaries(int device, Span<SketchEntry const> entries, Span<size_t const> columns_ptr,
+                    size_t limit_size, dh::device_vector<SketchEntry>* out_entries,
+                    dh::device_vector<size_t>* out_columns_ptr) {
+  CHECK_GE(limit_size, 2);
+  dh::safe_cuda(cudaSetDevice(device));
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  // every feature gets up to `limit_size' slots, repeated picks are dropped
+  dh::caching_device_vector<size_t> slots_ptr(columns_ptr.size());
+  auto d_slots_ptr = ToSpan(&slots_ptr);
+  dh::LaunchN(device, columns_ptr.size(), [=] __device__(size_t c) {
+    d_slots_ptr[c] =
+        c == 0 ? 0 : std::min(columns_ptr[c] - columns_ptr[c - 1], limit_size);
+  });
+  thrust::inclusive_scan(thrust::cuda::par(alloc), slots_ptr.begin(), slots_ptr.end(),
+                         slots_ptr.begin());
+  size_t const n_slots = slots_ptr.back();
+
+  dh::caching_device_vector<SketchEntry> slots(n_slots);
+  dh::caching_device_vector<size_t> keep(n_slots);
+  auto d_slots = ToSpan(&slots);
+  auto d_keep = ToSpan(&keep);
+  Span<size_t const> c_slots_ptr = d_slots_ptr;
+  dh::LaunchN(device, n_slots, [=] __device__(size_t t) {
+    bst_feature_t const c = ColumnOf(c_slots_ptr, t);
+    size_t const k = t - c_slots_ptr[c];
+    size_t const m = c_slots_ptr[c + 1] - c_slots_ptr[c];
+    SketchEntry const* s = entries.data() + columns_ptr[c];
+    size_t const n = columns_ptr[c + 1] - columns_ptr[c];
+    if (n <= limit_size) {
+      d_slots[t] = s[k];
+      d_keep[t] = 1;
+      return;
+    }
+    size_t const idx = PruneIndex(s, n, m, k);
+    d_slots[t] = s[idx];
+    d_keep[t] = k == 0 || idx != PruneIndex(s, n, m, k - 1);
+  });
+  Compact(device, d_slots, &keep, c_slots_ptr, out_entries, out_columns_ptr);
+}
+
+void MergeSummaries(int device, Span<SketchEntry const> a, Span<size_t const> a_ptr,
+                    Span<SketchEntry const> b, Span<size_t const> b_ptr,
+                    dh::device_vector<SketchEntry>* out_entries,
+                    dh::device_vector<size_t>* out_columns_ptr) {
+  CHECK_EQ(a_ptr.size(), b_ptr.size());
+  dh::safe_cuda(cudaSetDevice(device));
+  // Entries of both inputs are placed where a sequential merge puts them, a value
+  // present in both takes two slots and the second one is dropped.
+  dh::caching_device_vector<size_t> slots_ptr(a_ptr.size());
+  auto d_slots_ptr = ToSpan(&slots_ptr);
+  dh::LaunchN(device, a_ptr.size(), [=] __device__(size_t c) {
+    d_slots_ptr[c] = a_ptr[c] + b_ptr[c];
+  });
+  dh::caching_device_vector<SketchEntry> slots(a.size() + b.size());
+  dh::caching_device_vector<size_t> keep(a.size() + b.size());
+  auto d_slots = ToSpan(&slots);
+  auto d_keep = ToSpan(&keep);
+
+  dh::LaunchN(device, a.size(), [=] __device__(size_t idx) {
+    bst_feature_t const c = ColumnOf(a_ptr, idx);
+    SketchEntry const& e = a[idx];
+    SketchEntry const* other = b.data() + b_ptr[c];
+    size_t const n_other = b_ptr[c + 1] - b_ptr[c];
+    size_t const j = SearchValue<false>(other, n_other, e.value);
+    size_t const pos = d_slots_ptr[c] + (idx - a_ptr[c]) + j;
+    d_keep[pos] = 1;
+    if (n_other == 0) {
+      d_slots[pos] = e;
+    } else if (j < n_other && other[j].value == e.value) {
+      d_slots[pos] = SketchEntry(e.rmin + other[j].rmin, e.rmax + other[j].rmax,
+                                 e.wmin + other[j].wmin, e.value);
+    } else {
+      float const prev_rmin = j > 0 ? other[j - 1].RMinNext() : 0;
+      float const next_rmax = j < n_other ? other[j].RMaxPrev() : other[n_other - 1].rmax;
+      d_slots[pos] = SketchEntry(e.rmin + prev_rmin, e.rmax + next_rmax, e.wmin, e.value);
+    }
+  });
+  dh::LaunchN(device, b.size(), [=] __device__(size_t idx) {
+    bst_feature_t const c = ColumnOf(b_ptr, idx);
+    SketchEntry const& e = b[idx];
+    SketchEntry const* other = a.data() + a_ptr[c];
+    size_t const n_other = a_ptr[c + 1] - a_ptr[c];
+    size_t const i = SearchValue<false>(other, n_other, e.value);
+    size_t const local = idx - b_ptr[c];
+    if (i < n_other && other[i].value == e.value) {
+      // merged into the entry of `a'
+      size_t const pos = d_slots_ptr[c] + local + i + 1;
+      d_slots[pos] = e;
+      d_keep[pos] = 0;
+      return;
+    }
+    size_t const pos = d_slots_ptr[c] + local + i;
+    d_keep[pos] = 1;
+    if (n_other == 0) {
+      d_slots[pos] = e;
+    } else {
+      float const prev_rmin = i > 0 ? other[i - 1].RMinNext() : 0;
+      float const next_rmax = i < n_other ? other[i].RMaxPrev() : other[n_other - 1].rmax;
+      d_slots[pos] = SketchEntry(e.rmin + prev_rmin, e.rmax + next_rmax, e.wmin, e.value);
+    }
+  });
+  Compact(device, d_slots, &keep, d_slots_ptr, out_entries, out_columns_ptr);
+  FixError(device, out_entries, dh::ToSpan(*out_columns_ptr));
+}
+
+DeviceSketchContainer::DeviceSketchContainer(int device, bst_feature_t num_columns,
+                                             size_t limit_size)
+    : device_{device}, num_columns_{num_columns}, limit_size_{limit_size} {
+  dh::safe_cuda(cudaSetDevice(device_));
+  columns_ptr_.resize(num_columns_ + 1, 0);
+}
+
+void DeviceSketchContainer::Push(Span<bst_feature_t> columns, Span<float> values,
+                                 Span<float> weights) {
+  CHECK_EQ(columns.size(), values.size());
+  CHECK_EQ(columns.size(), weights.size());
+  dh::safe_cuda(cudaSetDevice(device_));
+  size_t const n = columns.size();
+  if (n == 0) {
+    return;
+  }
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  auto d_columns = thrust::device_pointer_cast(columns.data());
+  auto d_values = thrust::device_pointer_cast(values.data());
+  auto d_weights = thrust::device_pointer_cast(weights.data());
+  // segmented sort of the values, by value and then stably by feature
+  thrust::stable_sort_by_key(thrust::cuda::par(alloc), d_values, d_values + n,
+                             thrust::make_zip_iterator(thrust::make_tuple(d_columns, d_weights)));
+  thrust::stable_sort_by_key(thrust::cuda::par(alloc), d_columns, d_columns + n,
+                             thrust::make_zip_iterator(thrust::make_tuple(d_values, d_weights)));
+
+  // sum the weights of repeated values
+  dh::caching_device_vector<bst_feature_t> unique_columns(n);
+  dh::caching_device_vector<float> unique_values(n);
+  dh::caching_device_vector<float> unique_weights(n);
+  auto keys = thrust::make_zip_iterator(thrust::make_tuple(d_columns, d_values));
+  auto end = thrust::reduce_by_key(
+      thrust::cuda::par(alloc), keys, keys + n, d_weights,
+      thrust::make_zip_iterator(
+          thrust::make_tuple(unique_columns.begin(), unique_values.begin())),
+      unique_weights.begin());
+  size_t const n_unique = end.second - unique_weights.begin();
+
+  // ranks are the cumulative weights in each feature
+  dh::caching_device_vector<float> ranks(n_unique);
+  thrust::inclusive_scan_by_key(thrust::cuda::par(alloc), unique_columns.begin(),
+                                unique_columns.begin() + n_unique, unique_weights.begin(),
+                                ranks.begin());
+  dh::device_vector<SketchEntry> batch(n_unique);
+  auto d_batch = dh::ToSpan(batch);
+  auto d_ranks = ToSpan(&ranks);
+  auto d_unique_values = ToSpan(&unique_values);
+  auto d_unique_weights = ToSpan(&unique_weights);
+  dh::LaunchN(device_, n_unique, [=] __device__(size_t i) {
+    float const w = d_unique_weights[i];
+    d_batch[i] = SketchEntry(d_ranks[i] - w, d_ranks[i], w, d_unique_values[i]);
+  });
+  dh::device_vector<size_t> batch_ptr(num_columns_ + 1);
+  thrust::lower_bound(thrust::cuda::par(alloc), unique_columns.begin(),
+                      unique_columns.begin() + n_unique,
+                      thrust::make_counting_iterator<bst_feature_t>(0),
+                      thrust::make_counting_iterator<bst_feature_t>(num_columns_ + 1),
+                      batch_ptr.begin());
+
+  dh::device_vector<SketchEntry> pruned;
+  dh::device_vector<size_t> pruned_ptr;
+  PruneSummaries(device_, {d_batch.data(), d_batch.size()},
+                 {batch_ptr.data().get(), batch_ptr.size()}, limit_size_, &pruned,
+                 &pruned_ptr);
+  dh::device_vector<SketchEntry> merged;
+  dh::device_vector<size_t> merged_ptr;
+  MergeSummaries(device_, this->Entries(), this->ColumnsPtr(),
+                 {pruned.data().get(), pruned.size()},
+                 {pruned_ptr.data().get(), pruned_ptr.size()}, &merged, &merged_ptr);
+  PruneSummaries(device_, {merged.data().get(), merged.size()},
+                 {merged_ptr.data().get(), merged_ptr.size()}, limit_size_, &entries_,
+                 &columns_ptr_);
+}
+
+void DeviceSketchContainer::ToSummaries(
+    std::vector<DenseCuts::WQSketch::SummaryContainer>* out) const {
+  dh::safe_cuda(cudaSetDevice(device_));
+  std::vector<SketchEntry> h_entries(entries_.size());
+  std::vector<size_t> h_ptr(columns_ptr_.size());
+  thrust::copy(entries_.begin(), entries_.end(), h_entries.begin());
+  thrust::copy(columns_ptr_.begin(), columns_ptr_.end(), h_ptr.begin());
+  out->resize(num_columns_);
+  for (bst_feature_t c = 0; c < num_columns_; ++c) {
+    auto& summary = out->at(c);
+    size_t const n = h_ptr[c + 1] - h_ptr[c];
+    summary.Reserve(n);
+    std::copy(h_entries.cbegin() + h_ptr[c], h_entries.cbegin() + h_ptr[c + 1],
+              summary.data);
+    summary.size = n;
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,84 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file quantile.cuh
+ * \brief Weighted quantile summaries of all features, built and merged on the device.
+ */
+#ifndef XGBOOST_COMMON_QUANTILE_CUH_
+#define XGBOOST_COMMON_QUANTILE_CUH_
+
+#include <vector>
+
+#include "xgboost/span.h"
+#include "device_helpers.cuh"
+#include "hist_util.h"
+#include "quantile.h"
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief Summaries of all features kept on the device, one after another with
+ *  `columns_ptr' pointing to the first entry of each feature.
+ *
+ *  Every pushed batch is sorted by feature and value, turned into summaries, pruned and
+ *  merged into the current ones with the same rules as `WQSummary::SetPrune' and
+ *  `WQSummary::SetCombine', all features at once.  Only the final summaries are copied to
+ *  the host.
+ */
+class DeviceSketchContainer {
+ public:
+  using SketchEntry = DenseCuts::WQSketch::Entry;
+
+  /*!
+   * \param device       The device holding the summaries.
+   * \param num_columns  Number of features.
+   * \param limit_size   Maximum number of entries kept for each feature.
+   */
+  DeviceSketchContainer(int device, bst_feature_t num_columns, size_t limit_size);
+
+  /*!
+   * \brief Adds a batch of valid entries, NaN values and weights must be filtered out.
+   *  The input is sorted in place.
+   */
+  void Push(Span<bst_feature_t> columns, Span<float> values, Span<float> weights);
+  /*! \brief Copies the summaries to the host, one for each feature. */
+  void ToSummaries(std::vector<DenseCuts::WQSketch::SummaryContainer>* out) const;
+
+  Span<SketchEntry const> Entries() const {
+    return {entries_.data().get(), entries_.size()};
+  }
+  Span<size_t const> ColumnsPtr() const {
+    return {columns_ptr_.data().get(), columns_ptr_.size()};
+  }
+  size_t LimitSize() const { return limit_size_; }
+
+ private:
+  int device_;
+  bst_feature_t num_columns_;
+  size_t limit_size_;
+  dh::device_vector<SketchEntry> entries_;
+  dh::device_vector<size_t> columns_ptr_;
+};
+
+/*!
+ * \brief Prunes each feature of `entries' to at most `limit_size' entries, see
+ *  `WQSummary::SetPrune'.
+ */
+void PruneSummaries(int device, Span<DeviceSketchContainer::SketchEntry const> entries,
+                    Span<size_t const> columns_ptr, size_t limit_size,
+                    dh::device_vector<DeviceSketchContainer::SketchEntry>* out_entries,
+                    dh::device_vector<size_t>* out_columns_ptr);
+/*!
+ * \brief Merges the summaries of each feature in `a' and `b', see
+ *  `WQSummary::SetCombine'.
+ */
+void MergeSummaries(int device, Span<DeviceSketchContainer::SketchEntry const> a,
+                    Span<size_t const> a_ptr,
+                    Span<DeviceSketchContainer::SketchEntry const> b,
+                    Span<size_t const> b_ptr,
+                    dh::device_vector<DeviceSketchContainer::SketchEntry>* out_entries,
+                    dh::device_vector<size_t>* out_columns_ptr);
+}  // namespace common
+}  // namespace xgboost
+
+#endif  // XGBOOST_COMMON_QUANTILE_CUH_
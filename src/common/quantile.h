@@ -8,6 +8,7 @@
 #define XGBOOST_COMMON_QUANTILE_H_
 
 #include <dmlc/base.h>
+#include <rabit/rabit.h>
 #include <xgboost/logging.h>
 #include <cmath>
 #include <vector>
@@ -850,6 +851,176 @@ template<typename DType, typename RType = unsigned>
 class GKQuantileSketch :
       public QuantileSketchTemplate<DType, RType, GKSummary<DType, RType> > {
 };
+
+/*!
+ * \brief Weighted quantile sketch with a fixed footprint, in the spirit of KLL.  Items
+ *  are kept in a stack of compactors whose capacities shrink geometrically from the top
+ *  one down.  A full compactor is sorted and every pair of neighbours is replaced by one
+ *  of them carrying the weight of both, which moves one level up.  It holds about 3k
+ *  items however many are pushed, while the levels of `WQuantileSketch' grow with the
+ *  number of items.  The heavier item of a pair is kept, ties alternate between the
+ *  lower and the upper one, so the result doesn't depend on anything but the input.
+ * \tparam DType type of data content
+ * \tparam RType type of rank
+ */
+template<typename DType, typename RType = unsigned>
+class WCompactSketch {
+ public:
+  using Summary = WQSummary<DType, RType>;
+  using Entry = typename Summary::Entry;
+  using SummaryContainer = typename WQuantileSketch<DType, RType>::SummaryContainer;
+
+  /*!
+   * \brief initialize the sketch, with the same arguments as `WQuantileSketch::Init'
+   * \param maxn maximum number of data points can be feed into sketch
+   * \param eps accuracy level of summary, the top compactor holds 1 / (2 eps) items
+   */
+  inline void Init(size_t maxn, double eps) {
+    k_ = std::max(kMinCapacity,
+                  std::min(maxn, static_cast<size_t>(std::ceil(0.5 / eps))));
+    levels_.clear();
+    flips_.clear();
+    size_ = 0;
+    capacity_ = 0;
+  }
+  /*!
+   * \brief add an element to a sketch
+   * \param x The element added to the sketch
+   * \param w The weight of the element.
+   */
+  inline void Push(DType x, RType w = 1) {
+    if (w == static_cast<RType>(0)) return;
+    if (levels_.empty()) {
+      this->AddLevel();
+    }
+    levels_[0].push_back(Item{x, w});
+    ++size_;
+    if (size_ >= capacity_) {
+      this->Compress();
+    }
+  }
+  /*!
+   * \brief Summary of the items kept, as if they were the data.  Ranks of the summary are
+   *  exact for the items, the error of the compactions isn't tracked.
+   */
+  inline void GetSummary(SummaryContainer *out) const {
+    std::vector<Item> items;
+    items.reserve(size_);
+    for (auto const& level : levels_) {
+      items.insert(items.end(), level.cbegin(), level.cend());
+    }
+    std::sort(items.begin(), items.end(), Item::Less);
+    out->Reserve(items.size());
+    out->size = 0;
+    RType wsum = 0;
+    for (size_t i = 0; i < items.size();) {
+      size_t j = i + 1;
+      RType w = items[i].weight;
+      while (j < items.size() && items[j].value == items[i].value) {
+        w += items[j].weight; ++j;
+      }
+      out->data[out->size++] = Entry(wsum, wsum + w, w, items[i].value);
+      wsum += w; i = j;
+    }
+  }
+  /*! \brief number of items kept */
+  inline size_t Size() const { return size_; }
+
+ private:
+  struct Item {
+    DType value;
+    RType weight;
+    static bool Less(Item const& l, Item const& r) { return l.value < r.value; }
+  };
+  static constexpr size_t kMinCapacity = 8;
+
+  // capacity of level h, k for the top level and 2/3 of the one above for the others
+  inline size_t Capacity(size_t h) const {
+    double const depth = static_cast<double>(levels_.size() - 1 - h);
+    auto const capacity =
+        static_cast<size_t>(std::ceil(k_ * std::pow(2.0 / 3.0, depth)));
+    return std::max(kMinCapacity, capacity);
+  }
+  inline void AddLevel() {
+    levels_.emplace_back();
+    flips_.push_back(false);
+    capacity_ = 0;
+    for (size_t h = 0; h < levels_.size(); ++h) {
+      capacity_ += this->Capacity(h);
+    }
+  }
+  // compact the lowest level that is full
+  inline void Compress() {
+    for (size_t h = 0; h < levels_.size(); ++h) {
+      if (levels_[h].size() >= this->Capacity(h)) {
+        this->Compact(h);
+        return;
+      }
+    }
+  }
+  inline void Compact(size_t h) {
+    if (h + 1 == levels_.size()) {
+      this->AddLevel();
+    }
+    std::vector<Item>& items = levels_[h];
+    std::vector<Item>& upper = levels_[h + 1];
+    std::sort(items.begin(), items.end(), Item::Less);
+    bool const keep_upper = flips_[h];
+    flips_[h] = !flips_[h];
+    size_t const n_pairs = items.size() / 2;
+    for (size_t i = 0; i < n_pairs; ++i) {
+      Item const& lower_item = items[2 * i];
+      Item const& upper_item = items[2 * i + 1];
+      bool const take_upper = upper_item.weight > lower_item.weight ||
+                              (upper_item.weight == lower_item.weight && keep_upper);
+      Item kept = take_upper ? upper_item : lower_item;
+      kept.weight = lower_item.weight + upper_item.weight;
+      upper.push_back(kept);
+    }
+    // the odd item out stays
+    if (items.size() % 2 == 1) {
+      items.front() = items.back();
+      items.resize(1);
+    } else {
+      items.clear();
+    }
+    size_ -= n_pairs;
+  }
+
+  size_t k_ {kMinCapacity};
+  std::vector<std::vector<Item>> levels_;
+  // whether the next compaction of each level keeps the upper item of tied pairs
+  std::vector<bool> flips_;
+  size_t size_ {0};
+  // sum of the capacities of all levels
+  size_t capacity_ {0};
+};
+
+template<typename DType, typename RType>
+constexpr size_t WCompactSketch<DType, RType>::kMinCapacity;
+
+/*! \brief Upper bound of the bytes of summaries reduced at once over the workers. */
+constexpr size_t kMaxSummaryAllreduceBytes = static_cast<size_t>(64) << 20U;
+
+/*!
+ * \brief Allreduce the summaries of many features in batches of features, the reduction
+ *  buffers on each worker of the rabit tree then hold one batch instead of the summaries
+ *  of every feature.  Results are the same as reducing all summaries at once.
+ *
+ * \param reducer   Reducer merging two summaries.
+ * \param summaries Summaries, one for each feature.
+ * \param nbytes    Maximum serialized size of a summary.
+ * \param n         Number of summaries.
+ */
+template <typename SummaryContainer>
+inline void AllreduceSummaries(rabit::SerializeReducer<SummaryContainer>* reducer,
+                               SummaryContainer* summaries, size_t nbytes, size_t n,
+                               size_t max_batch_bytes = kMaxSummaryAllreduceBytes) {
+  size_t const batch = std::max<size_t>(max_batch_bytes / std::max<size_t>(nbytes, 1), 1);
+  for (size_t begin = 0; begin < n; begin += batch) {
+    reducer->Allreduce(summaries + begin, nbytes, std::min(batch, n - begin));
+  }
+}
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_QUANTILE_H_
@@ -159,6 +159,14 @@ class ColumnSampler {
     feature_set_tree_ = ColSample(feature_set_tree_, colsample_bytree_);
   }
 
+  /**
+   * \brief The features sampled for the current tree, level and node samples are drawn
+   *        from them.  Sorted by feature index.
+   */
+  std::shared_ptr<HostDeviceVector<bst_feature_t>> GetTreeFeatureSet() const {
+    return feature_set_tree_;
+  }
+
   /**
    * \brief Resets this object.
    */
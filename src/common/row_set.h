@@ -88,8 +88,49 @@ class RowSetCollection {
     const size_t* begin = dmlc::BeginPtr(row_indices_);
     const size_t* end = dmlc::BeginPtr(row_indices_) + row_indices_.size();
     elem_of_each_node_.emplace_back(Elem(begin, end, 0));
+    // children of a node are written into the other buffer, see GetChildBuffer()
+    row_indices_buffer_.resize(row_indices_.size());
   }
-  // split rowset into two
+  /*!
+   * \brief return the destination for the rows of node_id's children.
+   *  Rows of a node whose parent lives in one buffer are stored at the same
+   *  offsets of the other buffer, so a split scatters the parent's rows
+   *  directly into their final place without copying them back.
+   */
+  inline size_t* GetChildBuffer(unsigned node_id) {
+    const Elem& e = (*this)[node_id];
+    if (e.Size() == 0) {
+      return const_cast<size_t*>(e.begin);
+    }
+    const size_t* p_indices = dmlc::BeginPtr(row_indices_);
+    if (e.begin >= p_indices && e.begin < p_indices + row_indices_.size()) {
+      return dmlc::BeginPtr(row_indices_buffer_) + (e.begin - p_indices);
+    } else {
+      const size_t* p_buffer = dmlc::BeginPtr(row_indices_buffer_);
+      CHECK(e.begin >= p_buffer && e.end <= p_buffer + row_indices_buffer_.size());
+      return dmlc::BeginPtr(row_indices_) + (e.begin - p_buffer);
+    }
+  }
+  /*!
+   * \brief position of the rows of node_id in the buffer holding them and the index of
+   *  this buffer, 0 for row_indices_.  Data stored in the order of rows can follow the
+   *  rows with buffers of its own, written at GetChildBuffer() offsets on splits.
+   */
+  inline std::pair<size_t, int> GetBufferPosition(unsigned node_id) const {
+    const Elem& e = (*this)[node_id];
+    if (e.Size() == 0) {
+      return {0, 0};
+    }
+    const size_t* p_indices = dmlc::BeginPtr(row_indices_);
+    if (e.begin >= p_indices && e.begin < p_indices + row_indices_.size()) {
+      return {static_cast<size_t>(e.begin - p_indices), 0};
+    }
+    const size_t* p_buffer = dmlc::BeginPtr(row_indices_buffer_);
+    CHECK(e.begin >= p_buffer && e.end <= p_buffer + row_indices_buffer_.size());
+    return {static_cast<size_t>(e.begin - p_buffer), 1};
+  }
+  // split rowset into two, the rows of the children are expected to be
+  // already placed in GetChildBuffer(node_id): left rows first, then right rows
   inline void AddSplit(unsigned node_id,
                        unsigned left_node_id,
                        unsigned right_node_id,
@@ -97,12 +138,10 @@ class RowSetCollection {
                        size_t n_right) {
     const Elem e = elem_of_each_node_[node_id];
     CHECK(e.begin != nullptr);
-    size_t* all_begin = dmlc::BeginPtr(row_indices_);
-    size_t* begin = all_begin + (e.begin - all_begin);
+    const size_t* begin = GetChildBuffer(node_id);
+    const size_t* end = begin + e.Size();
 
     CHECK_EQ(n_left + n_right, e.Size());
-    CHECK_LE(begin + n_left, e.end);
-    CHECK_EQ(begin + n_left + n_right, e.end);
 
     if (left_node_id >= elem_of_each_node_.size()) {
       elem_of_each_node_.resize(left_node_id + 1, Elem(nullptr, nullptr, -1));
@@ -112,7 +151,7 @@ class RowSetCollection {
     }
 
     elem_of_each_node_[left_node_id] = Elem(begin, begin + n_left, left_node_id);
-    elem_of_each_node_[right_node_id] = Elem(begin + n_left, e.end, right_node_id);
+    elem_of_each_node_[right_node_id] = Elem(begin + n_left, end, right_node_id);
     elem_of_each_node_[node_id] = Elem(nullptr, nullptr, -1);
   }
 
@@ -120,6 +159,8 @@ class RowSetCollection {
   std::vector<size_t> row_indices_;
 
  private:
+  // second buffer of row indexes, nodes alternate between the two buffers level by level
+  std::vector<size_t> row_indices_buffer_;
   // vector: node_id -> elements
   std::vector<Elem> elem_of_each_node_;
 };
@@ -128,8 +169,11 @@ class RowSetCollection {
 // The builder is required for samples partition to left and rights children for set of nodes
 // Responsible for:
 // 1) Effective memory allocation for intermediate results for multi-thread work
-// 2) Merging partial results produced by threads into original row set (row_set_collection_)
-// BlockSize is template to enable memory alignment easily with C++11 'alignas()' feature
+// 2) Scattering row indexes of each block into their final place of the children row sets
+// Partitioning is done in two passes over each block of BlockSize rows:
+// first a partition kernel records a one byte decision per row and counts rows of both
+// children, then after the prefix sum over block counts (CalculateRowOffsets) rows are
+// written directly into the child buffer. The partition is stable.
 template<size_t BlockSize>
 class PartitionBuilder {
  public:
@@ -145,18 +189,15 @@ class PartitionBuilder {
 
     if (n_tasks > max_n_tasks_) {
       mem_blocks_.resize(n_tasks);
+      decisions_.resize(n_tasks * BlockSize);
       max_n_tasks_ = n_tasks;
     }
   }
 
-  common::Span<size_t> GetLeftBuffer(int nid, size_t begin, size_t end) {
+  // Buffer for decisions of rows [begin, end) of the node: 1 - go left, 0 - go right
+  common::Span<uint8_t> GetDecisionBuffer(int nid, size_t begin, size_t end) {
     const size_t task_idx = GetTaskIdx(nid, begin);
-    return { mem_blocks_.at(task_idx).left(), end - begin };
-  }
-
-  common::Span<size_t> GetRightBuffer(int nid, size_t begin, size_t end) {
-    const size_t task_idx = GetTaskIdx(nid, begin);
-    return { mem_blocks_.at(task_idx).right(), end - begin };
+    return { decisions_.data() + task_idx * BlockSize, end - begin };
   }
 
   void SetNLeftElems(int nid, size_t begin, size_t end, size_t n_left) {
@@ -179,7 +220,7 @@ class PartitionBuilder {
   }
 
   // Each thread has partial results for some set of tree-nodes
-  // The function decides order of merging partial results into final row set
+  // The function decides where rows of each block are placed in the final row set
   void CalculateRowOffsets() {
     for (size_t i = 0; i < blocks_offsets_.size()-1; ++i) {
       size_t n_left = 0;
@@ -196,17 +237,28 @@ class PartitionBuilder {
     }
   }
 
-  void MergeToArray(int nid, size_t begin, size_t* rows_indexes) {
-    size_t task_idx = GetTaskIdx(nid, begin);
-
-    size_t* left_result  = rows_indexes + mem_blocks_[task_idx].n_offset_left;
-    size_t* right_result = rows_indexes + mem_blocks_[task_idx].n_offset_right;
-
-    const size_t* left = mem_blocks_[task_idx].left();
-    const size_t* right = mem_blocks_[task_idx].right();
-
-    std::copy_n(left, mem_blocks_[task_idx].n_left, left_result);
-    std::copy_n(right, mem_blocks_[task_idx].n_right, right_result);
+  // Write rows [begin, end) of the node (rid_span) into rows_indexes, the buffer
+  // of the children: left rows go first, right rows follow them.  Any data stored in
+  // the order of the node's rows is scattered the same way.
+  template <typename T>
+  void Scatter(int nid, size_t begin, common::Span<const T> rid_span,
+               T* rows_indexes) {
+    const size_t task_idx = GetTaskIdx(nid, begin);
+    const uint8_t* decisions = decisions_.data() + task_idx * BlockSize;
+
+    T* left_result  = rows_indexes + mem_blocks_[task_idx].n_offset_left;
+    T* right_result = rows_indexes + mem_blocks_[task_idx].n_offset_right;
+
+    const T* rid = rid_span.data();
+    size_t n_left = 0;
+    size_t n_right = 0;
+    for (size_t i = 0; i < rid_span.size(); ++i) {
+      if (decisions[i]) {
+        left_result[n_left++] = rid[i];
+      } else {
+        right_result[n_right++] = rid[i];
+      }
+    }
   }
 
  protected:
@@ -220,21 +272,11 @@ class PartitionBuilder {
 
     size_t n_offset_left;
     size_t n_offset_right;
-
-    size_t* left() {
-      return &left_data_[0];
-    }
-
-    size_t* right() {
-      return &right_data_[0];
-    }
-   private:
-    alignas(128) size_t left_data_[BlockSize];
-    alignas(128) size_t right_data_[BlockSize];
   };
   std::vector<std::pair<size_t, size_t>> left_right_nodes_sizes_;
   std::vector<size_t> blocks_offsets_;
   std::vector<BlockInfo> mem_blocks_;
+  std::vector<uint8_t> decisions_;
   size_t max_n_tasks_ = 0;
 };
 
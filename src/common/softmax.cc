@@ -0,0 +1,252 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file softmax.cc
+ */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "softmax.h"
+
+// Kernels are compiled once per instruction set and selected at run time, like the
+// histogram kernels in hist_util.cc.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define XGBOOST_SOFTMAX_MULTI_ISA 1
+  #define XGBOOST_SOFTMAX_INLINE inline __attribute__((always_inline))
+  #define XGBOOST_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define XGBOOST_SOFTMAX_MULTI_ISA 0
+  #define XGBOOST_SOFTMAX_INLINE inline
+#endif  // x86 with GNU extensions
+
+namespace xgboost {
+namespace common {
+
+namespace {
+// Cephes style expf: exp(x) = 2^n * exp(r) with |r| <= ln(2)/2, exp(r) from a degree 5
+// polynomial.  The range is clamped so that 2^n stays a normal number, softmax only
+// sees x <= 0 anyway.
+constexpr float kExpLo = -87.0f;
+constexpr float kExpHi = 88.0f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kLn2Hi = 0.693359375f;
+constexpr float kLn2Lo = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500e-4f;
+constexpr float kExpP1 = 1.3981999507e-3f;
+constexpr float kExpP2 = 8.3334519073e-3f;
+constexpr float kExpP3 = 4.1665795894e-2f;
+constexpr float kExpP4 = 1.6666665459e-1f;
+constexpr float kExpP5 = 5.0000001201e-1f;
+
+XGBOOST_SOFTMAX_INLINE float FastExp(float x) {
+  x = std::min(std::max(x, kExpLo), kExpHi);
+  float const n = std::floor(x * kLog2e + 0.5f);
+  float r = x - n * kLn2Hi;
+  r = r - n * kLn2Lo;
+  float p = kExpP0;
+  p = p * r + kExpP1;
+  p = p * r + kExpP2;
+  p = p * r + kExpP3;
+  p = p * r + kExpP4;
+  p = p * r + kExpP5;
+  float const y = p * (r * r) + r + 1.0f;
+  int32_t const bits = (static_cast<int32_t>(n) + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return y * scale;
+}
+
+/*! \brief Maximum of a row, starting from `init'.  NaN values are skipped. */
+using RowMaxFn = float (*)(float const* row, size_t n, float init);
+/*! \brief out[i] = exp(row[i] - max), returns the sum of out. */
+using ExpSumFn = double (*)(float const* row, size_t n, float max, float* out);
+
+float RowMaxScalar(float const* row, size_t n, float init) {
+  float wmax = init;
+  for (size_t i = 0; i < n; ++i) {
+    wmax = std::fmax(row[i], wmax);
+  }
+  return wmax;
+}
+
+double ExpSumExact(float const* row, size_t n, float max, float* out) {
+  double wsum = 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = std::exp(row[i] - max);
+    wsum += out[i];
+  }
+  return wsum;
+}
+
+double ExpSumFastScalar(float const* row, size_t n, float max, float* out) {
+  double wsum = 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = FastExp(row[i] - max);
+    wsum += out[i];
+  }
+  return wsum;
+}
+
+#if XGBOOST_SOFTMAX_MULTI_ISA
+XGBOOST_SOFTMAX_INLINE XGBOOST_TARGET_AVX2 float HorizontalMaxAVX2(__m256 v) {
+  __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+  return _mm_cvtss_f32(m);
+}
+
+XGBOOST_TARGET_AVX2 float RowMaxAVX2(float const* row, size_t n, float init) {
+  // _mm256_max_ps(x, m) returns m when x is NaN, same as fmax(x, m).
+  __m256 vmax = _mm256_set1_ps(init);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    vmax = _mm256_max_ps(_mm256_loadu_ps(row + i), vmax);
+  }
+  float wmax = HorizontalMaxAVX2(vmax);
+  for (; i < n; ++i) {
+    wmax = std::fmax(row[i], wmax);
+  }
+  return wmax;
+}
+
+XGBOOST_SOFTMAX_INLINE XGBOOST_TARGET_AVX2 __m256 FastExpAVX2(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(kExpLo)), _mm256_set1_ps(kExpHi));
+  __m256 const n = _mm256_floor_ps(
+      _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(kLog2e)), _mm256_set1_ps(0.5f)));
+  __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Hi)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Lo)));
+  __m256 p = _mm256_set1_ps(kExpP0);
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP1));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP2));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP3));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP4));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP5));
+  __m256 const y = _mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(p, _mm256_mul_ps(r, r)), r), _mm256_set1_ps(1.0f));
+  __m256i const bits = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(bits));
+}
+
+XGBOOST_TARGET_AVX2 double ExpSumFastAVX2(float const* row, size_t n, float max,
+                                          float* out) {
+  __m256 const vmax = _mm256_set1_ps(max);
+  __m256 vsum = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 const e = FastExpAVX2(_mm256_sub_ps(_mm256_loadu_ps(row + i), vmax));
+    _mm256_storeu_ps(out + i, e);
+    vsum = _mm256_add_ps(vsum, e);
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, vsum);
+  double wsum = 0.0f;
+  for (float lane : lanes) {
+    wsum += lane;
+  }
+  for (; i < n; ++i) {
+    out[i] = FastExp(row[i] - max);
+    wsum += out[i];
+  }
+  return wsum;
+}
+#endif  // XGBOOST_SOFTMAX_MULTI_ISA
+
+struct SoftmaxKernels {
+  RowMaxFn row_max;
+  ExpSumFn exp_sum;
+};
+
+bool HasAVX2() {
+#if XGBOOST_SOFTMAX_MULTI_ISA
+  static bool const supported = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return supported;
+#else
+  return false;
+#endif  // XGBOOST_SOFTMAX_MULTI_ISA
+}
+
+SoftmaxKernels SelectKernels(bool fast_exp) {
+  SoftmaxKernels kernels{RowMaxScalar, fast_exp ? ExpSumFastScalar : ExpSumExact};
+#if XGBOOST_SOFTMAX_MULTI_ISA
+  if (HasAVX2()) {
+    // The maximum doesn't depend on the order of evaluation so the exact path can use
+    // the vector version as well.
+    kernels.row_max = RowMaxAVX2;
+    if (fast_exp) {
+      kernels.exp_sum = ExpSumFastAVX2;
+    }
+  }
+#endif  // XGBOOST_SOFTMAX_MULTI_ISA
+  return kernels;
+}
+}  // anonymous namespace
+
+void SoftmaxRows(float* io_preds, size_t n_rows, size_t n_class, bool fast_exp) {
+  if (n_class == 0) {
+    return;
+  }
+  auto const kernels = SelectKernels(fast_exp);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    float* row = io_preds + i * n_class;
+    float const wmax = kernels.row_max(row + 1, n_class - 1, row[0]);
+    float const wsum = static_cast<float>(kernels.exp_sum(row, n_class, wmax, row));
+    for (size_t k = 0; k < n_class; ++k) {
+      row[k] /= wsum;
+    }
+  }
+}
+
+void ArgMaxRows(float const* preds, size_t n_rows, size_t n_class, float* out_index) {
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    float const* row = preds + i * n_class;
+    out_index[i] = static_cast<float>(std::max_element(row, row + n_class) - row);
+  }
+}
+
+bool SoftmaxGradient(float const* preds, float const* labels, float const* weights,
+                     size_t n_rows, size_t n_class, bool fast_exp,
+                     GradientPair* out_gpair) {
+  auto const kernels = SelectKernels(fast_exp);
+  // Exponentials of the current row, computed once instead of once per output.
+  std::vector<float> buffer(static_cast<size_t>(omp_get_max_threads()) * n_class);
+  size_t n_invalid = 0;
+  float const eps = 1e-16f;
+#pragma omp parallel for schedule(static) reduction(+:n_invalid)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    float* exp_row = buffer.data() + omp_get_thread_num() * n_class;
+    float const* point = preds + i * n_class;
+    // Same reference point as the device kernel.
+    float const wmax =
+        kernels.row_max(point, n_class, std::numeric_limits<bst_float>::min());
+    float const wsum = static_cast<float>(kernels.exp_sum(point, n_class, wmax, exp_row));
+    float label = labels[i];
+    if (label < 0 || label >= n_class) {
+      ++n_invalid;
+      label = 0;
+    }
+    float const wt = weights == nullptr ? 1.0f : weights[i];
+    GradientPair* gpair = out_gpair + i * n_class;
+    for (size_t k = 0; k < n_class; ++k) {
+      float p = exp_row[k] / wsum;
+      float const h = std::fmax(2.0f * p * (1.0f - p) * wt, eps);
+      p = label == k ? p - 1.0f : p;
+      gpair[k] = GradientPair(p * wt, h);
+    }
+  }
+  return n_invalid == 0;
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,45 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file softmax.h
+ * \brief Row wise softmax kernels for the CPU multi-class objective.
+ */
+#ifndef XGBOOST_COMMON_SOFTMAX_H_
+#define XGBOOST_COMMON_SOFTMAX_H_
+
+#include <xgboost/base.h>
+
+#include <cstddef>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief Replace each of the `n_rows' rows of `n_class' values in `io_preds' by its
+ *  softmax.
+ *
+ *  With `fast_exp' false the result is bit-identical to `common::Softmax'.  With
+ *  `fast_exp' true the exponentials come from a vectorized polynomial approximation
+ *  with a relative error of a few ulp.
+ */
+void SoftmaxRows(float* io_preds, size_t n_rows, size_t n_class, bool fast_exp);
+
+/*!
+ * \brief Write the index of the first maximum of each row into `out_index'.
+ */
+void ArgMaxRows(float const* preds, size_t n_rows, size_t n_class, float* out_index);
+
+/*!
+ * \brief Softmax cross entropy gradient, see `SoftmaxMultiClassObj'.
+ *
+ * \param weights Row weights, or nullptr for unit weights.
+ *
+ * \return false if any label is outside of [0, n_class).  Such rows are treated as
+ *  having label 0.
+ */
+bool SoftmaxGradient(float const* preds, float const* labels, float const* weights,
+                     size_t n_rows, size_t n_class, bool fast_exp,
+                     GradientPair* out_gpair);
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_SOFTMAX_H_
@@ -0,0 +1,85 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file telemetry.cc
+ */
+#include <rabit/rabit.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "telemetry.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+struct CallbackState {
+  std::mutex lock;
+  Telemetry::Callback callback;
+
+  static CallbackState& Get() {
+    // Never destroyed, learners may report during static destruction.
+    static auto* state = new CallbackState;
+    return *state;
+  }
+};
+}  // anonymous namespace
+
+void Telemetry::SetCallback(Callback callback) {
+  auto& state = CallbackState::Get();
+  std::lock_guard<std::mutex> guard(state.lock);
+  Active() = static_cast<bool>(callback);
+  state.callback = std::move(callback);
+  // Start the next report from scratch.
+  for (auto& slot : Slots().nanoseconds) {
+    slot = 0;
+  }
+  Slots().allreduce_bytes = 0;
+}
+
+int32_t Telemetry::PhaseOf(std::string const& name) {
+  // Timers of the learner, `hist' and `gpu_hist'.
+  static std::map<std::string, TelemetryPhase> const kPhases {
+    {"PredictRaw", TelemetryPhase::kPredictRaw},
+    {"GetGradient", TelemetryPhase::kGetGradient},
+    {"DoBoost", TelemetryPhase::kDoBoost},
+    {"InitData", TelemetryPhase::kInitData},
+    {"BuildLocalHistograms", TelemetryPhase::kBuildHist},
+    {"BuildHist", TelemetryPhase::kBuildHist},
+    {"EvaluateSplits", TelemetryPhase::kEvaluateSplits},
+    {"ApplySplit", TelemetryPhase::kApplySplit},
+    {"UpdatePosition", TelemetryPhase::kApplySplit},
+    {"SyncHistograms", TelemetryPhase::kSyncHistograms},
+    {"AllReduce", TelemetryPhase::kSyncHistograms},
+    {"EvalOneIter", TelemetryPhase::kEvaluation}
+  };
+  auto it = kPhases.find(name);
+  return it == kPhases.cend() ? -1 : static_cast<int32_t>(it->second);
+}
+
+void Telemetry::Report(int32_t iteration) {
+  if (!Enabled()) {
+    return;
+  }
+  IterationTelemetry telemetry;
+  telemetry.iteration = iteration;
+  telemetry.rank = rabit::GetRank();
+  auto& slots = Slots();
+  for (size_t i = 0; i < telemetry.seconds.size(); ++i) {
+    telemetry.seconds[i] = static_cast<double>(slots.nanoseconds[i].exchange(0)) / 1e9;
+  }
+  telemetry.allreduce_bytes = slots.allreduce_bytes.exchange(0);
+
+  Callback callback;
+  {
+    auto& state = CallbackState::Get();
+    std::lock_guard<std::mutex> guard(state.lock);
+    callback = state.callback;
+  }
+  if (callback) {
+    callback(telemetry);
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,88 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file telemetry.h
+ * \brief Per-iteration breakdown of the training time, reported to a user callback.
+ */
+#ifndef XGBOOST_COMMON_TELEMETRY_H_
+#define XGBOOST_COMMON_TELEMETRY_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief Phases of an iteration, summed over the monitor timers of the same name. */
+enum class TelemetryPhase : int32_t {
+  kPredictRaw = 0,
+  kGetGradient,
+  kDoBoost,
+  kInitData,
+  kBuildHist,
+  kEvaluateSplits,
+  kApplySplit,
+  kSyncHistograms,
+  kEvaluation,
+  kNumPhases
+};
+
+struct IterationTelemetry {
+  int32_t iteration {0};
+  int32_t rank {0};
+  /*! \brief Seconds spent in each phase, indexed by `TelemetryPhase'. */
+  std::array<double, static_cast<size_t>(TelemetryPhase::kNumPhases)> seconds {};
+  /*! \brief Bytes of gradient statistics allreduced over the workers. */
+  uint64_t allreduce_bytes {0};
+};
+
+/*!
+ * \brief Process wide accumulator of the phase timings, emptied by `Report' at the end
+ *  of each iteration.  Nothing is recorded without a callback.
+ *
+ *  The time comes from `Monitor', which enables its timers for as long as a callback is
+ *  set.  Evaluation happens after the iteration is reported, so it's counted in the
+ *  next one.  CUDA timers only measure the launch unless the device is synchronized,
+ *  see `Monitor::SetCudaSynchronize'.
+ */
+class Telemetry {
+ public:
+  using Callback = std::function<void(IterationTelemetry const&)>;
+
+  static bool Enabled() { return Active(); }
+  /*! \brief Set the callback receiving each iteration, an empty one stops recording. */
+  static void SetCallback(Callback callback);
+  /*! \brief Phase timed by monitor timers named `name', -1 if there's none. */
+  static int32_t PhaseOf(std::string const& name);
+
+  static void AddTime(int32_t phase, int64_t nanoseconds) {
+    Slots().nanoseconds[phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+  }
+  static void AddAllreduceBytes(size_t bytes) {
+    if (Enabled()) {
+      Slots().allreduce_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+  /*! \brief Pass the phases recorded since the last report to the callback. */
+  static void Report(int32_t iteration);
+
+ private:
+  struct Accumulator {
+    std::array<std::atomic<int64_t>, static_cast<size_t>(TelemetryPhase::kNumPhases)>
+        nanoseconds {};
+    std::atomic<uint64_t> allreduce_bytes {0};
+  };
+  static Accumulator& Slots() {
+    static Accumulator slots;
+    return slots;
+  }
+  static std::atomic<bool>& Active() {
+    static std::atomic<bool> active {false};
+    return active;
+  }
+};
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_TELEMETRY_H_
@@ -0,0 +1,104 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file threading_utils.cc
+ */
+#include <dmlc/omp.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif  // defined(__linux__)
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "threading_utils.h"
+
+namespace xgboost {
+namespace common {
+
+namespace {
+std::atomic<bool>& Deterministic() {
+  static std::atomic<bool> deterministic {false};
+  return deterministic;
+}
+}  // anonymous namespace
+
+void SetDeterministic(bool deterministic) {
+  Deterministic() = deterministic;
+}
+
+bool IsDeterministic() {
+  return Deterministic();
+}
+
+ThreadPinning::ThreadPinning(int nthreads) {
+  cpus_.assign(nthreads, -1);
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    LOG(WARNING) << "Failed to get the CPU affinity, threads are not pinned.";
+    return;
+  }
+  master_mask_.resize(sizeof(allowed));
+  std::copy(reinterpret_cast<const char*>(&allowed),
+            reinterpret_cast<const char*>(&allowed) + sizeof(allowed), master_mask_.begin());
+  std::vector<int> allowed_cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      allowed_cpus.push_back(cpu);
+    }
+  }
+  if (allowed_cpus.empty()) {
+    return;
+  }
+#pragma omp parallel num_threads(nthreads)
+  {
+    const int tid = omp_get_thread_num();
+    const int cpu = allowed_cpus[tid % allowed_cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 0 is the calling thread
+    if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+      cpus_[tid] = cpu;
+    }
+  }
+#endif  // defined(__linux__)
+}
+
+ThreadPinning::~ThreadPinning() {
+#if defined(__linux__)
+  if (!master_mask_.empty()) {
+    sched_setaffinity(0, sizeof(cpu_set_t),
+                      reinterpret_cast<const cpu_set_t*>(master_mask_.data()));
+  }
+#endif  // defined(__linux__)
+}
+
+std::vector<size_t> ThreadPinning::Sockets() const {
+  std::vector<int> socket_ids;
+  std::vector<size_t> sockets(cpus_.size());
+  for (size_t tid = 0; tid < cpus_.size(); ++tid) {
+    if (cpus_[tid] < 0) {
+      return {};
+    }
+    std::ifstream fin("/sys/devices/system/cpu/cpu" + std::to_string(cpus_[tid]) +
+                      "/topology/physical_package_id");
+    int id = -1;
+    if (!(fin >> id)) {
+      return {};
+    }
+    auto it = std::find(socket_ids.cbegin(), socket_ids.cend(), id);
+    sockets[tid] = it - socket_ids.cbegin();
+    if (it == socket_ids.cend()) {
+      socket_ids.push_back(id);
+    }
+  }
+  return sockets;
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -6,8 +6,19 @@
 #ifndef XGBOOST_COMMON_THREADING_UTILS_H_
 #define XGBOOST_COMMON_THREADING_UTILS_H_
 
+#include <dmlc/common.h>
+#include <dmlc/omp.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif  // defined(__linux__)
+
+#include <cstdlib>
+#include <new>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <utility>
 
 #include "xgboost/logging.h"
 
@@ -108,6 +119,227 @@ class BlockedSpace2d {
 };
 
 
+/*!
+ * \brief Allocator leaving new elements default initialized, so pages of a resized
+ *  vector of trivial types are first touched by the threads that fill it.  On NUMA
+ *  machines the memory then goes to the nodes of these threads instead of the node
+ *  of the thread which resized the vector.
+ */
+template <typename T>
+struct DefaultInitAllocator : public std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    using other = DefaultInitAllocator<U>;
+  };
+  DefaultInitAllocator() = default;
+  template <typename U>
+  DefaultInitAllocator(const DefaultInitAllocator<U>&) {}  // NOLINT
+  template <typename U>
+  void construct(U* p) {
+    ::new (static_cast<void*>(p)) U;
+  }
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+/*!
+ * \brief DefaultInitAllocator backing allocations of a huge page or more with transparent
+ *  huge pages, for large buffers read over and over like the quantized matrix and the
+ *  histograms, so they take fewer TLB entries.  The same as DefaultInitAllocator on
+ *  systems without them.
+ */
+template <typename T>
+struct HugePageAllocator : public DefaultInitAllocator<T> {
+  static constexpr size_t kHugePageBytes = 2 * 1024 * 1024;
+  template <typename U>
+  struct rebind {
+    using other = HugePageAllocator<U>;
+  };
+  HugePageAllocator() = default;
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) {  // NOLINT
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    const size_t bytes = n * sizeof(T);
+    if (bytes >= kHugePageBytes) {
+      void* ptr {nullptr};
+      if (posix_memalign(&ptr, kHugePageBytes, bytes) != 0) {
+        throw std::bad_alloc();
+      }
+      // only a hint, the kernel may still use normal pages
+      madvise(ptr, bytes, MADV_HUGEPAGE);
+      return static_cast<T*>(ptr);
+    }
+#endif  // defined(__linux__) && defined(MADV_HUGEPAGE)
+    return DefaultInitAllocator<T>::allocate(n);
+  }
+  void deallocate(T* p, size_t n) {  // NOLINT
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (n * sizeof(T) >= kHugePageBytes) {
+      free(p);
+      return;
+    }
+#endif  // defined(__linux__) && defined(MADV_HUGEPAGE)
+    DefaultInitAllocator<T>::deallocate(p, n);
+  }
+};
+
+/*!
+ * \brief Pins each thread of an OpenMP team to its own CPU while the object lives.
+ *
+ *  Thread tid runs on the tid-th CPU the process may use, so contiguous threads share a
+ *  socket.  Worker threads of the team stay pinned for following parallel regions of the
+ *  same size, the calling thread gets its original affinity back on destruction, so
+ *  threads it creates later are not confined to a single CPU.  Only supported on Linux,
+ *  elsewhere threads are left alone.
+ */
+class ThreadPinning {
+ public:
+  explicit ThreadPinning(int nthreads);
+  ~ThreadPinning();
+  ThreadPinning(const ThreadPinning&) = delete;
+  ThreadPinning& operator=(const ThreadPinning&) = delete;
+  /*! \brief CPU of each thread, -1 for threads that could not be pinned */
+  const std::vector<int>& Cpus() const {
+    return cpus_;
+  }
+  /*!
+   * \brief Socket of each thread, numbered from 0 in order of first appearance.  Empty
+   *  when sockets of pinned threads are unknown.
+   */
+  std::vector<size_t> Sockets() const;
+
+ private:
+  std::vector<int> cpus_;
+  // affinity of the calling thread before pinning, opaque cpu_set_t
+  std::vector<char> master_mask_;
+};
+
+/*!
+ * \brief Split CPU work independently of the number of threads wherever rounding depends
+ *  on it, set for the whole process by the `deterministic' parameter.
+ */
+void SetDeterministic(bool deterministic);
+bool IsDeterministic();
+/*! \brief Number of threads deterministic decompositions are sized for. */
+constexpr size_t kDeterministicThreads = 16;
+
+/*!
+ * \brief Number of threads of a parallel loop, `n_threads' when it's positive and the
+ *  OpenMP default of the calling thread otherwise.
+ */
+inline int32_t OmpGetNumThreads(int32_t n_threads) {
+  return n_threads > 0 ? n_threads : omp_get_max_threads();
+}
+
+/*!
+ * \brief Sets the number of threads of the parallel regions started by the calling
+ *  thread, and restores the previous one on destruction.  The OpenMP thread count is
+ *  kept per thread, so parallel regions started by other threads of the process, like
+ *  the ones of an application embedding XGBoost, are left alone.
+ */
+class OmpThreadsScope {
+ public:
+  explicit OmpThreadsScope(int32_t n_threads) : original_{omp_get_max_threads()} {
+    if (n_threads > 0 && n_threads != original_) {
+      omp_set_num_threads(n_threads);
+      changed_ = true;
+    }
+  }
+  ~OmpThreadsScope() {
+    if (changed_) {
+      omp_set_num_threads(original_);
+    }
+  }
+  OmpThreadsScope(OmpThreadsScope const&) = delete;
+  OmpThreadsScope& operator=(OmpThreadsScope const&) = delete;
+
+ private:
+  int32_t original_;
+  bool changed_ {false};
+};
+
+/*! \brief Scheduling of the iterations of `ParallelFor'. */
+struct Sched {
+  enum {
+    kAuto,
+    kDynamic,
+    kStatic,
+    kGuided,
+  } sched;
+  size_t chunk;
+
+  static Sched Auto() { return Sched{kAuto, 0}; }
+  /*! \brief Idle threads take the next chunk, for iterations of uneven cost. */
+  static Sched Dyn(size_t n = 0) { return Sched{kDynamic, n}; }
+  static Sched Static(size_t n = 0) { return Sched{kStatic, n}; }
+  static Sched Guided() { return Sched{kGuided, 0}; }
+};
+
+/*!
+ * \brief Runs `fn(i)' for i in [0, size) on `n_threads' threads, rethrowing the first
+ *  exception thrown by `fn' on the calling thread.
+ */
+template <typename Index, typename Func>
+void ParallelFor(Index size, int32_t n_threads, Sched sched, Func fn) {
+  n_threads = OmpGetNumThreads(n_threads);
+  auto const n = static_cast<omp_ulong>(size);
+  dmlc::OMPException exc;
+  switch (sched.sched) {
+  case Sched::kAuto: {
+#pragma omp parallel for num_threads(n_threads)
+    for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+      exc.Run(fn, static_cast<Index>(i));
+    }
+    break;
+  }
+  case Sched::kDynamic: {
+    if (sched.chunk == 0) {
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+      for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+        exc.Run(fn, static_cast<Index>(i));
+      }
+    } else {
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic, sched.chunk)
+      for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+        exc.Run(fn, static_cast<Index>(i));
+      }
+    }
+    break;
+  }
+  case Sched::kStatic: {
+    if (sched.chunk == 0) {
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+      for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+        exc.Run(fn, static_cast<Index>(i));
+      }
+    } else {
+#pragma omp parallel for num_threads(n_threads) schedule(static, sched.chunk)
+      for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+        exc.Run(fn, static_cast<Index>(i));
+      }
+    }
+    break;
+  }
+  case Sched::kGuided: {
+#pragma omp parallel for num_threads(n_threads) schedule(guided)
+    for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+      exc.Run(fn, static_cast<Index>(i));
+    }
+    break;
+  }
+  }
+  exc.Rethrow();
+}
+
+template <typename Index, typename Func>
+void ParallelFor(Index size, int32_t n_threads, Func fn) {
+  ParallelFor(size, n_threads, Sched::Static(), fn);
+}
+
 // Wrapper to implement nested parallelism with simple omp parallel for
 template<typename Func>
 void ParallelFor2d(const BlockedSpace2d& space, const int nthreads, Func func) {
@@ -116,7 +348,9 @@ void ParallelFor2d(const BlockedSpace2d& space, const int nthreads, Func func) {
   #pragma omp parallel num_threads(nthreads)
   {
     size_t tid = omp_get_thread_num();
-    size_t chunck_size = num_blocks_in_space / nthreads + !!(num_blocks_in_space % nthreads);
+    // the team can be smaller than requested
+    size_t const team = omp_get_num_threads();
+    size_t chunck_size = num_blocks_in_space / team + !!(num_blocks_in_space % team);
 
     size_t begin = chunck_size * tid;
     size_t end   = std::min(begin + chunck_size, num_blocks_in_space);
@@ -3,31 +3,172 @@
  */
 #include <rabit/rabit.h>
 #include <algorithm>
+#include <mutex>
+#include <set>
 #include <type_traits>
 #include <utility>
 #include <vector>
 #include <sstream>
 #include "timer.h"
+#include "memory_tracker.h"
 #include "xgboost/json.h"
 
 namespace xgboost {
 namespace common {
 
+namespace {
+struct MonitorRegistry {
+  std::mutex lock;
+  std::set<Monitor const*> monitors;
+
+  static MonitorRegistry& Get() {
+    // Never destroyed, monitors may outlive static destruction.
+    static auto* registry = new MonitorRegistry;
+    return *registry;
+  }
+};
+}  // anonymous namespace
+
+void Monitor::Register() {
+  auto& registry = MonitorRegistry::Get();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.monitors.insert(this);
+}
+
+void Monitor::Unregister() {
+  auto& registry = MonitorRegistry::Get();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.monitors.erase(this);
+}
+
 void Monitor::Start(std::string const &name) {
-  if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
-    statistics_map[name].timer.Start();
+  if (Enabled()) {
+    this->StartTimer(&this->GetStatistics(name));
   }
 }
 
 void Monitor::Stop(const std::string &name) {
-  if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
-    auto &stats = statistics_map[name];
-    stats.timer.Stop();
-    stats.count++;
+  if (Enabled()) {
+    this->StopTimer(&this->GetStatistics(name));
+  }
+}
+
+void Monitor::SetCounter(const std::string &name, size_t value) {
+  if (Enabled()) {
+    counters_map[name] = value;
+  }
+}
+
+Monitor::StatMap Monitor::Collect() const {
+  this->ResolveCudaEvents(true);
+  StatMap stat_map;
+  for (auto const& kv : statistics_map) {
+    stat_map[kv.first] = std::make_pair(
+        kv.second.count, std::chrono::duration_cast<std::chrono::microseconds>(
+            kv.second.timer.elapsed).count());
+  }
+  for (auto const& kv : cuda_events_.elapsed) {
+    stat_map[kv.first + " (device)"] = std::make_pair(
+        kv.second.first, static_cast<size_t>(kv.second.second * 1e3));
+  }
+  return stat_map;
+}
+
+Monitor::CounterMap Monitor::CollectCounters() const {
+  CounterMap counters {counters_map};
+  if (!perf_counters_) {
+    return counters;
+  }
+  for (auto const& kv : statistics_map) {
+    auto const& perf = kv.second.perf_total;
+    if (perf.cycles == 0) {
+      continue;
+    }
+    counters[kv.first + " cycles"] = perf.cycles;
+    counters[kv.first + " instructions"] = perf.instructions;
+    counters[kv.first + " LLC references"] = perf.llc_references;
+    counters[kv.first + " LLC misses"] = perf.llc_misses;
+    counters[kv.first + " memory bytes (est.)"] = perf.MemoryBytes();
+  }
+  return counters;
+}
+
+#if !defined(XGBOOST_USE_CUDA)
+// No event is recorded without CUDA.
+Monitor::CudaEvents::~CudaEvents() = default;
+
+void Monitor::ResolveCudaEvents(bool) const {}
+
+NvtxScope::NvtxScope(char const*, NvtxCategory) {}
+
+NvtxScope::~NvtxScope() = default;
+#endif  // !defined(XGBOOST_USE_CUDA)
+
+void Monitor::Profile(bool all_ranks, std::string* out) {
+  Json j_profile { Object() };
+  {
+    auto& registry = MonitorRegistry::Get();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (auto const* monitor : registry.monitors) {
+      if (monitor->statistics_map.empty() && monitor->counters_map.empty()) {
+        continue;
+      }
+      auto& j_monitor = j_profile[monitor->label];
+      if (IsA<Null>(j_monitor)) {
+        j_monitor = Object();
+        j_monitor["timers"] = Object();
+        j_monitor["counters"] = Object();
+      }
+      auto& timers = j_monitor["timers"];
+      for (auto const& kv : monitor->Collect()) {
+        auto elapsed = static_cast<int64_t>(kv.second.second);
+        auto count = static_cast<int64_t>(kv.second.first);
+        auto& j_timer = timers[kv.first];
+        if (IsA<Null>(j_timer)) {
+          j_timer = Object();
+          j_timer["count"] = Integer(count);
+          j_timer["elapsed"] = Integer(elapsed);
+        } else {
+          j_timer["count"] = Integer(get<Integer const>(j_timer["count"]) + count);
+          j_timer["elapsed"] = Integer(get<Integer const>(j_timer["elapsed"]) + elapsed);
+        }
+      }
+      auto& counters = j_monitor["counters"];
+      for (auto const& kv : monitor->CollectCounters()) {
+        auto value = static_cast<int64_t>(kv.second);
+        auto& j_counter = counters[kv.first];
+        j_counter = IsA<Null>(j_counter) ? Integer(value)
+                                         : Integer(get<Integer const>(j_counter) + value);
+      }
+    }
+  }
+
+  j_profile["host_memory"] = HostMemoryTracker::Stats();
+
+  std::string str;
+  Json::Dump(j_profile, &str);
+  if (!all_ranks || !rabit::IsDistributed()) {
+    *out = "[" + str + "]";
+    return;
+  }
+  // Same as `CollectFromOtherRanks', each worker broadcasts its own profile in turn.
+  size_t str_size = str.size();
+  rabit::Allreduce<rabit::op::Max>(&str_size, 1);
+  std::string buffer;
+  std::ostringstream os;
+  os << '[';
+  for (int i = 0; i < rabit::GetWorldSize(); ++i) {
+    buffer.assign(str_size, ' ');
+    std::copy(str.cbegin(), str.cend(), buffer.begin());
+    rabit::Broadcast(&buffer, i);
+    os << (i == 0 ? "" : ",") << buffer;
   }
+  os << ']';
+  *out = os.str();
 }
 
-std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks() const {
+std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks(
+    std::vector<CounterMap>* counters) const {
   // Since other nodes might have started timers that this one haven't, so
   // we can't simply call all reduce.
   size_t const world_size = rabit::GetWorldSize();
@@ -40,13 +181,15 @@ std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks() const {
   j_statistic["statistic"] = Object();
 
   auto& statistic = j_statistic["statistic"];
-  for (auto const& kv : statistics_map) {
+  for (auto const& kv : this->Collect()) {
     statistic[kv.first] = Object();
     auto& j_pair = statistic[kv.first];
-    j_pair["count"] = Integer(kv.second.count);
-    j_pair["elapsed"] = Integer(static_cast<int64_t>(
-        std::chrono::duration_cast<std::chrono::microseconds>(
-        kv.second.timer.elapsed).count()));
+    j_pair["count"] = Integer(static_cast<int64_t>(kv.second.first));
+    j_pair["elapsed"] = Integer(static_cast<int64_t>(kv.second.second));
+  }
+  j_statistic["counters"] = Object();
+  for (auto const& kv : this->CollectCounters()) {
+    j_statistic["counters"][kv.first] = Integer(static_cast<int64_t>(kv.second));
   }
 
   std::stringstream ss;
@@ -60,6 +203,8 @@ std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks() const {
 
   // vector storing stat from all workers
   std::vector<StatMap> world(world_size);
+  counters->clear();
+  counters->resize(world_size);
 
   // Actually only rank 0 is printing.
   for (size_t i = 0; i < world_size; ++i) {
@@ -75,6 +220,9 @@ std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks() const {
       auto const& pair = kv.second;
       other[timer_name] = {get<Integer>(pair["count"]), get<Integer>(pair["elapsed"])};
     }
+    for (auto const& kv : get<Object>(j_other["counters"])) {
+      counters->at(i)[kv.first] = get<Integer const>(kv.second);
+    }
 
     // FIXME(trivialfis): How to ask rabit to block here?
   }
@@ -82,7 +230,7 @@ std::vector<Monitor::StatMap> Monitor::CollectFromOtherRanks() const {
   return world;
 }
 
-void Monitor::PrintStatistics(StatMap const& statistics) const {
+void Monitor::PrintStatistics(StatMap const& statistics, CounterMap const& counters) const {
   for (auto &kv : statistics) {
     if (kv.second.first == 0) {
       LOG(WARNING) <<
@@ -94,6 +242,9 @@ void Monitor::PrintStatistics(StatMap const& statistics) const {
                  << kv.second.second
                  << "us" << std::endl;
   }
+  for (auto const& kv : counters) {
+    LOG(CONSOLE) << kv.first << ": " << kv.second << std::endl;
+  }
 }
 
 void Monitor::Print() const {
@@ -102,25 +253,20 @@ void Monitor::Print() const {
   bool is_distributed = rabit::IsDistributed();
 
   if (is_distributed) {
-    auto world = this->CollectFromOtherRanks();
+    std::vector<CounterMap> counters;
+    auto world = this->CollectFromOtherRanks(&counters);
     // rank zero is in charge of printing
     if (rabit::GetRank() == 0) {
       LOG(CONSOLE) << "======== Monitor: " << label << " ========";
       for (size_t i = 0; i < world.size(); ++i) {
         LOG(CONSOLE) << "From rank: " << i << ": " << std::endl;
         auto const& statistic = world[i];
-        this->PrintStatistics(statistic);
+        this->PrintStatistics(statistic, counters[i]);
       }
     }
   } else {
-    StatMap stat_map;
-    for (auto const& kv : statistics_map) {
-      stat_map[kv.first] = std::make_pair(
-          kv.second.count, std::chrono::duration_cast<std::chrono::microseconds>(
-              kv.second.timer.elapsed).count());
-    }
     LOG(CONSOLE) << "======== Monitor: " << label << " ========";
-    this->PrintStatistics(stat_map);
+    this->PrintStatistics(this->Collect(), this->CollectCounters());
   }
 }
 
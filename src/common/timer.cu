@@ -6,6 +6,7 @@
 #endif  // defined(XGBOOST_USE_NVTX)
 
 #include <string>
+#include <vector>
 
 #include "xgboost/logging.h"
 #include "device_helpers.cuh"
@@ -14,24 +15,155 @@
 namespace xgboost {
 namespace common {
 
+namespace {
+#if defined(XGBOOST_USE_NVTX)
+nvtxDomainHandle_t NvtxDomain() {
+  static nvtxDomainHandle_t domain = [] {
+    auto handle = nvtxDomainCreateA("xgboost");
+    char const* names[] = {"other", "data", "sketch", "tree", "predict", "metric"};
+    for (uint32_t i = 1; i < sizeof(names) / sizeof(names[0]); ++i) {
+      nvtxDomainNameCategoryA(handle, i, names[i]);
+    }
+    return handle;
+  }();
+  return domain;
+}
+
+nvtxRangeId_t NvtxRangeStart(char const* message, NvtxCategory category) {
+  nvtxEventAttributes_t attributes = {0};
+  attributes.version = NVTX_VERSION;
+  attributes.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+  attributes.category = static_cast<uint32_t>(category);
+  attributes.messageType = NVTX_MESSAGE_TYPE_ASCII;
+  attributes.message.ascii = message;
+  return nvtxDomainRangeStartEx(NvtxDomain(), &attributes);
+}
+#endif  // defined(XGBOOST_USE_NVTX)
+
+/*! \brief Switch to `device' for the lifetime of this object. */
+class DeviceGuard {
+  int32_t previous_;
+
+ public:
+  explicit DeviceGuard(int32_t device) {
+    dh::safe_cuda(cudaGetDevice(&previous_));
+    if (previous_ != device) {
+      dh::safe_cuda(cudaSetDevice(device));
+    }
+  }
+  ~DeviceGuard() { cudaSetDevice(previous_); }
+};
+
+void DestroyEvents(void* start, void* stop) {
+  // Errors are ignored, the driver may be shutting down when monitors are destroyed.
+  cudaEventDestroy(static_cast<cudaEvent_t>(start));
+  cudaEventDestroy(static_cast<cudaEvent_t>(stop));
+}
+}  // anonymous namespace
+
+NvtxScope::NvtxScope(char const* name, NvtxCategory category) {
+#if defined(XGBOOST_USE_NVTX)
+  id_ = NvtxRangeStart(name, category);
+#endif  // defined(XGBOOST_USE_NVTX)
+}
+
+NvtxScope::~NvtxScope() {
+#if defined(XGBOOST_USE_NVTX)
+  nvtxDomainRangeEnd(NvtxDomain(), id_);
+#endif  // defined(XGBOOST_USE_NVTX)
+}
+
+Monitor::CudaEvents::~CudaEvents() {
+  for (auto const& kv : started) {
+    DestroyEvents(kv.second.start, kv.second.stop);
+  }
+  for (auto const& kv : pending) {
+    for (auto const& range : kv.second) {
+      DestroyEvents(range.start, range.stop);
+    }
+  }
+}
+
+void Monitor::ResolveCudaEvents(bool wait) const {
+  for (auto& kv : cuda_events_.pending) {
+    auto& ranges = kv.second;
+    size_t n_waiting = 0;
+    for (auto const& range : ranges) {
+      auto stop = static_cast<cudaEvent_t>(range.stop);
+      if (wait) {
+        dh::safe_cuda(cudaEventSynchronize(stop));
+      } else {
+        auto status = cudaEventQuery(stop);
+        if (status == cudaErrorNotReady) {
+          // Not an error, clear it so it isn't picked up by the next check.
+          cudaGetLastError();
+          ranges[n_waiting++] = range;
+          continue;
+        }
+        dh::safe_cuda(status);
+      }
+      float ms {0};
+      dh::safe_cuda(cudaEventElapsedTime(&ms, static_cast<cudaEvent_t>(range.start), stop));
+      auto& elapsed = cuda_events_.elapsed[kv.first];
+      elapsed.first++;
+      elapsed.second += ms;
+      DestroyEvents(range.start, range.stop);
+    }
+    ranges.resize(n_waiting);
+  }
+}
+
 void Monitor::StartCuda(const std::string& name) {
-  if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
-    auto &stats = statistics_map[name];
-    stats.timer.Start();
+  if (Enabled()) {
+    if (CudaSynchronize()) {
+      dh::safe_cuda(cudaDeviceSynchronize());
+    }
+    auto &stats = this->GetStatistics(name);
+    this->StartTimer(&stats);
+
+    CudaEvents::Range range;
+    dh::safe_cuda(cudaGetDevice(&range.device));
+    cudaEvent_t start, stop;
+    dh::safe_cuda(cudaEventCreate(&start));
+    dh::safe_cuda(cudaEventCreate(&stop));
+    dh::safe_cuda(cudaEventRecord(start));
+    range.start = start;
+    range.stop = stop;
+    auto it = cuda_events_.started.find(name);
+    if (it != cuda_events_.started.cend()) {
+      // Restarted without being stopped, same as the host timer the first start is lost.
+      DestroyEvents(it->second.start, it->second.stop);
+      it->second = range;
+    } else {
+      cuda_events_.started.emplace(name, range);
+    }
 #if defined(XGBOOST_USE_NVTX)
-    stats.nvtx_id = nvtxRangeStartA(name.c_str());
+    stats.nvtx_id = NvtxRangeStart((label + ": " + name).c_str(), category_);
 #endif  // defined(XGBOOST_USE_NVTX)
   }
 }
 
 void Monitor::StopCuda(const std::string& name) {
-  if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
-    auto &stats = statistics_map[name];
-    stats.timer.Stop();
-    stats.count++;
+  if (Enabled()) {
+    auto it = cuda_events_.started.find(name);
+    if (it != cuda_events_.started.cend()) {
+      auto range = it->second;
+      cuda_events_.started.erase(it);
+      // Both events must belong to the same device to measure the time between them.
+      DeviceGuard guard(range.device);
+      dh::safe_cuda(cudaEventRecord(static_cast<cudaEvent_t>(range.stop)));
+      cuda_events_.pending[name].push_back(range);
+    }
+    if (CudaSynchronize()) {
+      dh::safe_cuda(cudaDeviceSynchronize());
+    }
+    auto &stats = this->GetStatistics(name);
+    this->StopTimer(&stats);
 #if defined(XGBOOST_USE_NVTX)
-    nvtxRangeEnd(stats.nvtx_id);
+    nvtxDomainRangeEnd(NvtxDomain(), stats.nvtx_id);
 #endif  // defined(XGBOOST_USE_NVTX)
+    // Keeps the number of pending events bounded without blocking.
+    this->ResolveCudaEvents(false);
   }
 }
 }  // namespace common
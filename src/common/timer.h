@@ -3,13 +3,18 @@
  */
 #pragma once
 #include <xgboost/logging.h>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "perf_counters.h"
+#include "telemetry.h"
+
 namespace xgboost {
 namespace common {
 
@@ -38,11 +43,47 @@ struct Timer {
   }
 };
 
+/*!
+ * \brief Categories of the NVTX ranges in the "xgboost" domain, so a profiler can group
+ *  the device work of each part.
+ */
+enum class NvtxCategory : uint32_t {
+  kOther = 0,
+  kData = 1,
+  kSketch = 2,
+  kTree = 3,
+  kPredict = 4,
+  kMetric = 5
+};
+
+/*!
+ * \brief NVTX range in the "xgboost" domain for the lifetime of this object, for device
+ *  code not timed by a `Monitor'.  Does nothing unless built with NVTX, only available
+ *  in CUDA builds.
+ */
+class NvtxScope {
+  uint64_t id_ {0};
+
+ public:
+  NvtxScope(char const* name, NvtxCategory category);
+  NvtxScope(NvtxScope const&) = delete;
+  NvtxScope& operator=(NvtxScope const&) = delete;
+  ~NvtxScope();
+};
+
 /**
  * \struct  Monitor
  *
  * \brief Timing utility used to measure total method execution time over the
  * lifetime of the containing object.
+ *
+ * Timers record when verbosity is debug or when profiling is enabled with
+ * `SetProfiling'.  Living monitors can then be queried with `Profile'.
+ *
+ * `StartCuda'/`StopCuda' also record CUDA events on the default stream without
+ * synchronizing, the device time between them is reported as the "<name> (device)"
+ * timer.  The host timer then only measures launching the work, unless the device is
+ * synchronized around the timers with `SetCudaSynchronize'.
  */
 struct Monitor {
  private:
@@ -50,40 +91,174 @@ struct Monitor {
     Timer timer;
     size_t count{0};
     uint64_t nvtx_id;
+    // `TelemetryPhase' of the timer, -1 if none
+    int32_t phase{-1};
+    // hardware counters, only sampled with `EnablePerfCounters'
+    PerfSample perf_begin;
+    PerfSample perf_total;
   };
 
   // from left to right, <name <count, elapsed>>
   using StatMap = std::map<std::string, std::pair<size_t, size_t>>;
+  using CounterMap = std::map<std::string, size_t>;
+
+  /*! \brief CUDA events of the device timers, copies of a monitor start without any. */
+  struct CudaEvents {
+    struct Range {
+      void* start;
+      void* stop;
+      int32_t device;
+    };
+    // started timers
+    std::map<std::string, Range> started;
+    // stopped timers whose device work may not be complete
+    std::map<std::string, std::vector<Range>> pending;
+    // <count, elapsed milliseconds> of the complete ones
+    std::map<std::string, std::pair<size_t, double>> elapsed;
+
+    CudaEvents() = default;
+    CudaEvents(CudaEvents const&) {}
+    CudaEvents& operator=(CudaEvents const&) { return *this; }
+    ~CudaEvents();
+  };
 
   std::string label = "";
+  NvtxCategory category_ {NvtxCategory::kOther};
   std::map<std::string, Statistics> statistics_map;
+  CounterMap counters_map;
   Timer self_timer;
+  bool perf_counters_ {false};
+  mutable CudaEvents cuda_events_;
 
-  /*! \brief Collect time statistics across all workers. */
-  std::vector<StatMap> CollectFromOtherRanks() const;
-  void PrintStatistics(StatMap const& statistics) const;
+  /*! \brief Collect time statistics and counters across all workers. */
+  std::vector<StatMap> CollectFromOtherRanks(std::vector<CounterMap>* counters) const;
+  void PrintStatistics(StatMap const& statistics, CounterMap const& counters) const;
+  /*! \brief Count and elapsed microseconds of the host and device timers. */
+  StatMap Collect() const;
+  /*! \brief The counters along with the hardware counters of each timer. */
+  CounterMap CollectCounters() const;
+  /*! \brief Add the time of the complete device timers, waiting for all when `wait'. */
+  void ResolveCudaEvents(bool wait) const;
+
+  static std::atomic<bool>& Profiling() {
+    static std::atomic<bool> profiling {false};
+    return profiling;
+  }
+  static std::atomic<bool>& CudaSynchronize() {
+    static std::atomic<bool> synchronize {false};
+    return synchronize;
+  }
+  void Register();
+  void Unregister();
+
+  Statistics& GetStatistics(std::string const& name) {
+    auto it = statistics_map.find(name);
+    if (it == statistics_map.end()) {
+      it = statistics_map.emplace(name, Statistics{}).first;
+      it->second.phase = Telemetry::PhaseOf(name);
+    }
+    return it->second;
+  }
+  void StartTimer(Statistics* stats) {
+    if (perf_counters_) {
+      ReadPerfCounters(&stats->perf_begin);
+    }
+    stats->timer.Start();
+  }
+  void StopTimer(Statistics* stats) {
+    auto const before = stats->timer.elapsed;
+    stats->timer.Stop();
+    stats->count++;
+    PerfSample perf_end;
+    if (perf_counters_ && ReadPerfCounters(&perf_end)) {
+      stats->perf_total += perf_end - stats->perf_begin;
+    }
+    if (stats->phase >= 0 && Telemetry::Enabled()) {
+      Telemetry::AddTime(stats->phase, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           stats->timer.elapsed - before).count());
+    }
+  }
 
  public:
-  Monitor() { self_timer.Start(); }
+  Monitor() {
+    self_timer.Start();
+    this->Register();
+  }
+  Monitor(Monitor const& that)
+      : label{that.label}, category_{that.category_}, statistics_map{that.statistics_map},
+        counters_map{that.counters_map}, self_timer{that.self_timer},
+        perf_counters_{that.perf_counters_} {
+    this->Register();
+  }
+  Monitor& operator=(Monitor const& that) = default;
   /*\brief Print statistics info during destruction.
    *
    * Please note that this may not work, as with distributed frameworks like Dask, the
    * model is pickled to other workers, and the global parameters like `global_verbosity_`
-   * are not included in the pickle.
+   * are not included in the pickle.  Use `Profile' instead.
    */
   ~Monitor() {
     this->Print();
     self_timer.Stop();
+    this->Unregister();
   }
 
+  /*! \brief Whether the timers are recording. */
+  static bool Enabled() {
+    return Profiling() || Telemetry::Enabled() ||
+           ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug);
+  }
+  /*! \brief Record the timers regardless of verbosity. */
+  static void SetProfiling(bool enable) { Profiling() = enable; }
+  /*!
+   * \brief Synchronize the device when starting and stopping the CUDA timers, so the
+   *  host timers measure the device work too, at the cost of serializing it.
+   */
+  static void SetCudaSynchronize(bool enable) { CudaSynchronize() = enable; }
+  /*!
+   * \brief Timers and counters of all living monitors as JSON, summed over the monitors
+   *  sharing a label:
+   *
+   *    [{"<label>": {"timers": {"<name>": {"count": n, "elapsed": us}},
+   *                  "counters": {"<name>": value}},
+   *      "host_memory": {"<component>": {"current": bytes, "peak": bytes}}}]
+   *
+   *  with one element for each worker when `all_ranks' is set, which makes this a
+   *  collective call.  Only this worker is reported otherwise.
+   */
+  static void Profile(bool all_ranks, std::string* out);
+
   /*! \brief Print all the statistics. */
   void Print() const;
 
-  void Init(std::string label) { this->label = label; }
+  void Init(std::string label, NvtxCategory category = NvtxCategory::kOther) {
+    this->label = label;
+    this->category_ = category;
+  }
   void Start(const std::string &name);
   void Stop(const std::string &name);
+  // No string is built for literals when the timers are off.
+  void Start(char const* name) {
+    if (Enabled()) {
+      this->StartTimer(&this->GetStatistics(name));
+    }
+  }
+  void Stop(char const* name) {
+    if (Enabled()) {
+      this->StopTimer(&this->GetStatistics(name));
+    }
+  }
+  /*!
+   * \brief Sample the hardware counters of the threads around the host timers, reported
+   *  as the "<name> cycles", "<name> instructions", "<name> LLC references",
+   *  "<name> LLC misses" and "<name> memory bytes (est.)" counters.  Requires a build
+   *  with `USE_PERF_COUNTERS', otherwise nothing is reported.
+   */
+  void EnablePerfCounters() { perf_counters_ = true; }
   void StartCuda(const std::string &name);
   void StopCuda(const std::string &name);
+  /*! \brief Set a counter printed along with the timers, like the bytes sent so far. */
+  void SetCounter(const std::string &name, size_t value);
 };
 }  // namespace common
 }  // namespace xgboost
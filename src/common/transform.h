@@ -8,6 +8,7 @@
 #include <dmlc/common.h>
 
 #include <xgboost/data.h>
+#include <algorithm>
 #include <utility>
 #include <vector>
 #include <type_traits>  // enable_if
@@ -25,6 +26,8 @@ namespace xgboost {
 namespace common {
 
 constexpr size_t kBlockThreads = 256;
+/*! \brief Number of consecutive indices run by one iteration of the CPU loop. */
+constexpr omp_ulong kCPUBlockSize = 4096;
 
 namespace detail {
 
@@ -153,10 +156,33 @@ class Transform {
     template <typename... HDV>
     void LaunchCPU(Functor func, HDV*... vectors) const {
       omp_ulong end = static_cast<omp_ulong>(*(range_.end()));
+      // Unpack once, the loops below only see plain pointers and sizes.
+      LaunchCPUBlocks(func, end, UnpackHDV(vectors)...);
+    }
+
+    /*!
+     * \brief Run the functor over contiguous blocks of indices, one block for each
+     *  iteration of the parallel loop, so the inner loop can be vectorised.  Ranges of a
+     *  single block don't enter an OpenMP region.
+     */
+    template <typename... SpanType>
+    void LaunchCPUBlocks(Functor func, omp_ulong end, SpanType... spans) const {
+      auto run = [&](omp_ulong begin, omp_ulong stop) {
+        for (omp_ulong idx = begin; idx < stop; ++idx) {
+          func(idx, spans...);
+        }
+      };
+      if (end <= kCPUBlockSize) {
+        run(0, end);
+        return;
+      }
+      omp_ulong const n_blocks = DivRoundUp(end, kCPUBlockSize);
       dmlc::OMPException omp_exc;
 #pragma omp parallel for schedule(static)
-      for (omp_ulong idx = 0; idx < end; ++idx) {
-        omp_exc.Run(func, idx, UnpackHDV(vectors)...);
+      for (omp_ulong block = 0; block < n_blocks; ++block) {
+        omp_exc.Run([&]() {
+          run(block * kCPUBlockSize, std::min(end, (block + 1) * kCPUBlockSize));
+        });
       }
       omp_exc.Rethrow();
     }
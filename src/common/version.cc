@@ -22,11 +22,10 @@ Version::TripletT Version::Load(Json const& in, bool check) {
   }
   Integer::Int major {0}, minor {0}, patch {0};
   try {
-    auto const& j_version = get<Array const>(in["version"]);
+    std::vector<Integer::Int> j_version;
+    GetNumericArray(in["version"], &j_version);
     std::tie(major, minor, patch) = std::make_tuple(
-        get<Integer const>(j_version.at(0)),
-        get<Integer const>(j_version.at(1)),
-        get<Integer const>(j_version.at(2)));
+        j_version.at(0), j_version.at(1), j_version.at(2));
   } catch (dmlc::Error const& e) {
     LOG(FATAL) << "Invaid version format in loaded JSON object: " << in;
   }
@@ -21,6 +21,7 @@
 #include "xgboost/c_api.h"
 
 #include "../c_api/c_api_error.h"
+#include "array_interface.h"
 
 namespace xgboost {
 namespace data {
@@ -228,6 +229,59 @@ class DenseAdapter : public detail::SingleBatchDataIter<DenseAdapterBatch> {
   size_t num_columns_;
 };
 
+class ArrayAdapterBatch : public detail::NoMetaInfo {
+ public:
+  class Line {
+   public:
+    Line(ArrayInterface const& array, size_t row_idx)
+        : array_(array), row_idx_(row_idx) {}
+
+    size_t Size() const { return array_.num_cols; }
+    COOTuple GetElement(size_t idx) const {
+      return COOTuple{row_idx_, idx, array_.GetElement(row_idx_ * array_.num_cols + idx)};
+    }
+
+   private:
+    ArrayInterface const& array_;
+    size_t row_idx_;
+  };
+
+  ArrayAdapterBatch() = default;
+  explicit ArrayAdapterBatch(ArrayInterface array) : array_(array) {}
+  size_t Size() const { return array_.num_rows; }
+  const Line GetLine(size_t idx) const { return Line(array_, idx); }
+  /*! \brief Values of the rows one after another, when they are stored as float32. */
+  float const* Values() const {
+    return array_.type[1] == 'f' && array_.type[2] == '4'
+               ? static_cast<float const*>(array_.data)
+               : nullptr;
+  }
+
+ private:
+  ArrayInterface array_;
+};
+
+/*! \brief Adapter over a dense host array given by `__array_interface__'. */
+class ArrayAdapter : public detail::SingleBatchDataIter<ArrayAdapterBatch> {
+ public:
+  explicit ArrayAdapter(std::string const& array_interface_str) {
+    Json j_interface =
+        Json::Load({array_interface_str.c_str(), array_interface_str.size()});
+    array_interface_ = ArrayInterface(get<Object const>(j_interface));
+    CHECK(!array_interface_.valid.Data())
+        << "Validity mask is not supported for host arrays.";
+    batch_ = ArrayAdapterBatch(array_interface_);
+  }
+  const ArrayAdapterBatch& Value() const override { return batch_; }
+
+  size_t NumRows() const { return array_interface_.num_rows; }
+  size_t NumColumns() const { return array_interface_.num_cols; }
+
+ private:
+  ArrayInterface array_interface_;
+  ArrayAdapterBatch batch_;
+};
+
 class CSCAdapterBatch : public detail::NoMetaInfo {
  public:
   CSCAdapterBatch(const size_t* col_ptr, const unsigned* row_idx,
@@ -293,6 +347,128 @@ class CSCAdapter : public detail::SingleBatchDataIter<CSCAdapterBatch> {
   size_t num_columns_;
 };
 
+/*!
+ * \brief CSC matrix with the index and value types of the caller, read in place and
+ *  converted on the fly.  The R package stores indices as int and values as double.
+ */
+template <typename IdxT, typename ValueT>
+class TypedCSCAdapterBatch : public detail::NoMetaInfo {
+ public:
+  TypedCSCAdapterBatch(IdxT const* col_ptr, IdxT const* row_idx, ValueT const* values,
+                       size_t num_features)
+      : col_ptr_(col_ptr), row_idx_(row_idx), values_(values),
+        num_features_(num_features) {}
+
+  class Line {
+   public:
+    Line(size_t col_idx, size_t size, IdxT const* row_idx, ValueT const* values)
+        : col_idx_(col_idx), size_(size), row_idx_(row_idx), values_(values) {}
+
+    size_t Size() const { return size_; }
+    COOTuple GetElement(size_t idx) const {
+      return COOTuple{static_cast<size_t>(row_idx_[idx]), col_idx_,
+                      static_cast<float>(values_[idx])};
+    }
+
+   private:
+    size_t col_idx_;
+    size_t size_;
+    IdxT const* row_idx_;
+    ValueT const* values_;
+  };
+
+  size_t Size() const { return num_features_; }
+  const Line GetLine(size_t idx) const {
+    auto begin_offset = static_cast<size_t>(col_ptr_[idx]);
+    auto end_offset = static_cast<size_t>(col_ptr_[idx + 1]);
+    return Line(idx, end_offset - begin_offset, &row_idx_[begin_offset],
+                &values_[begin_offset]);
+  }
+
+ private:
+  IdxT const* col_ptr_;
+  IdxT const* row_idx_;
+  ValueT const* values_;
+  size_t num_features_;
+};
+
+template <typename IdxT, typename ValueT>
+class TypedCSCAdapter
+    : public detail::SingleBatchDataIter<TypedCSCAdapterBatch<IdxT, ValueT>> {
+ public:
+  TypedCSCAdapter(IdxT const* col_ptr, IdxT const* row_idx, ValueT const* values,
+                  size_t num_features, size_t num_rows)
+      : batch_(col_ptr, row_idx, values, num_features),
+        num_rows_(num_rows),
+        num_columns_(num_features) {}
+  const TypedCSCAdapterBatch<IdxT, ValueT>& Value() const override { return batch_; }
+
+  size_t NumRows() const { return num_rows_; }
+  size_t NumColumns() const { return num_columns_; }
+
+ private:
+  TypedCSCAdapterBatch<IdxT, ValueT> batch_;
+  size_t num_rows_;
+  size_t num_columns_;
+};
+
+/*!
+ * \brief Dense matrix stored column after column like R matrices, read in place and
+ *  converted on the fly.  Each line is one column, so pushing the matrix into a page is
+ *  parallel across columns.
+ */
+template <typename T>
+class ColMajorDenseAdapterBatch : public detail::NoMetaInfo {
+ public:
+  ColMajorDenseAdapterBatch(T const* values, size_t num_rows, size_t num_features)
+      : values_(values), num_rows_(num_rows), num_features_(num_features) {}
+
+  class Line {
+   public:
+    Line(T const* values, size_t size, size_t col_idx)
+        : values_(values), size_(size), col_idx_(col_idx) {}
+
+    size_t Size() const { return size_; }
+    COOTuple GetElement(size_t idx) const {
+      return COOTuple{idx, col_idx_, static_cast<float>(values_[idx])};
+    }
+
+   private:
+    T const* values_;
+    size_t size_;
+    size_t col_idx_;
+  };
+
+  size_t Size() const { return num_features_; }
+  const Line GetLine(size_t idx) const {
+    return Line(values_ + idx * num_rows_, num_rows_, idx);
+  }
+
+ private:
+  T const* values_;
+  size_t num_rows_;
+  size_t num_features_;
+};
+
+template <typename T>
+class ColMajorDenseAdapter
+    : public detail::SingleBatchDataIter<ColMajorDenseAdapterBatch<T>> {
+ public:
+  ColMajorDenseAdapter(T const* values, size_t num_rows, size_t num_features)
+      : batch_(values, num_rows, num_features),
+        num_rows_(num_rows),
+        num_columns_(num_features) {}
+  const ColMajorDenseAdapterBatch<T>& Value() const override { return batch_; }
+
+  size_t NumRows() const { return num_rows_; }
+  size_t NumColumns() const { return num_columns_; }
+
+ private:
+  ColMajorDenseAdapterBatch<T> batch_;
+  size_t num_rows_;
+  size_t num_columns_;
+};
+
 class DataTableAdapterBatch : public detail::NoMetaInfo {
  public:
   DataTableAdapterBatch(void** data, const char** feature_stypes,
@@ -422,6 +598,110 @@ class DataTableAdapter
   size_t num_columns_;
 };
 
+/*!
+ * \brief Columns of one or more Arrow record batches.  Each line is one column of one
+ *  record batch, so pushing the batch into a page is parallel across columns.  Nulls
+ *  in the validity bitmap of a column are read as missing values.
+ */
+class ArrowAdapterBatch : public detail::NoMetaInfo {
+ public:
+  class Line {
+   public:
+    Line(ArrayInterface const& column, size_t column_idx, size_t row_offset)
+        : column_{column}, column_idx_{column_idx}, row_offset_{row_offset} {}
+
+    size_t Size() const { return column_.num_rows; }
+    COOTuple GetElement(size_t idx) const {
+      float value = column_.valid.Data() == nullptr || column_.valid.Check(idx)
+                        ? column_.GetElement(idx)
+                        : std::numeric_limits<float>::quiet_NaN();
+      return COOTuple{row_offset_ + idx, column_idx_, value};
+    }
+
+   private:
+    ArrayInterface const& column_;
+    size_t column_idx_;
+    size_t row_offset_;
+  };
+
+  ArrowAdapterBatch() = default;
+  ArrowAdapterBatch(std::vector<ArrayInterface> columns, std::vector<size_t> row_offsets,
+                    size_t num_columns)
+      : columns_(std::move(columns)),
+        row_offsets_(std::move(row_offsets)),
+        num_columns_(num_columns) {}
+
+  size_t Size() const { return columns_.size(); }
+  const Line GetLine(size_t idx) const {
+    return Line(columns_[idx], idx % num_columns_, row_offsets_[idx / num_columns_]);
+  }
+
+ private:
+  // columns of all record batches, record batch major
+  std::vector<ArrayInterface> columns_;
+  // first row of each record batch
+  std::vector<size_t> row_offsets_;
+  size_t num_columns_ {0};
+};
+
+/*!
+ * \brief Reads Arrow columnar data in place.  Input is a JSON list of record batches,
+ *  each one a list of `__array_interface__' objects (one per column) with an optional
+ *  validity bitmap in `mask'.  A single list of columns is read as one record batch.
+ *
+ * Sample input with two record batches of one column:
+ * [
+ *   [{"shape": [3], "data": [140247951138816, true], "typestr": "<f4", "version": 1,
+ *     "mask": {"shape": [3], "data": [140247951139840, true], "typestr": "|t1",
+ *              "version": 1}}],
+ *   [{"shape": [2], "data": [140247951140864, true], "typestr": "<i8", "version": 1}]
+ * ]
+ */
+class ArrowAdapter : public detail::SingleBatchDataIter<ArrowAdapterBatch> {
+ public:
+  explicit ArrowAdapter(std::string const& interfaces_str) {
+    Json interfaces = Json::Load({interfaces_str.c_str(), interfaces_str.size()});
+    std::vector<Json> batches = get<Array const>(interfaces);
+    CHECK_GT(batches.size(), 0) << "Number of record batches must not equal to 0.";
+    if (IsA<Object>(batches.front())) {
+      batches = {interfaces};
+    }
+    std::vector<ArrayInterface> columns;
+    std::vector<size_t> row_offsets;
+    for (auto const& j_batch : batches) {
+      auto const& j_columns = get<Array const>(j_batch);
+      if (row_offsets.empty()) {
+        num_columns_ = j_columns.size();
+        CHECK_GT(num_columns_, 0) << "Number of columns must not equal to 0.";
+      }
+      CHECK_EQ(j_columns.size(), num_columns_)
+          << "All record batches should have the same number of columns.";
+      row_offsets.push_back(num_rows_);
+      size_t batch_rows = 0;
+      for (size_t i = 0; i < j_columns.size(); ++i) {
+        ArrayInterface column(get<Object const>(j_columns[i]));
+        CHECK_EQ(column.num_cols, 1) << ArrayInterfaceErrors::Dimension(1);
+        if (i == 0) {
+          batch_rows = column.num_rows;
+        }
+        CHECK_EQ(batch_rows, column.num_rows)
+            << "All columns of a record batch should have same number of rows.";
+        columns.push_back(column);
+      }
+      num_rows_ += batch_rows;
+    }
+    batch_ = ArrowAdapterBatch(std::move(columns), std::move(row_offsets), num_columns_);
+  }
+  const ArrowAdapterBatch& Value() const override { return batch_; }
+  size_t NumRows() const { return num_rows_; }
+  size_t NumColumns() const { return num_columns_; }
+
+ private:
+  ArrowAdapterBatch batch_;
+  size_t num_rows_ {0};
+  size_t num_columns_ {0};
+};
+
 class FileAdapterBatch {
  public:
   class Line {
@@ -494,18 +774,28 @@ class FileAdapter : dmlc::DataIter<FileAdapterBatch> {
 };
 
 /*! \brief Data iterator that takes callback to return data, used in JVM package for
- *  accepting data iterator. */
+ *  accepting data iterator.  It can only be reset when a reset callback is given. */
 class IteratorAdapter : public dmlc::DataIter<FileAdapterBatch> {
  public:
   IteratorAdapter(DataIterHandle data_handle,
-                  XGBCallbackDataIterNext* next_callback)
+                  XGBCallbackDataIterNext* next_callback,
+                  XGBCallbackDataIterReset* reset_callback = nullptr)
       :  columns_{data::kAdapterUnknownSize}, row_offset_{0},
          at_first_(true),
-         data_handle_(data_handle), next_callback_(next_callback) {}
+         data_handle_(data_handle), next_callback_(next_callback),
+         reset_callback_(reset_callback) {}
 
   // override functions
   void BeforeFirst() override {
-    CHECK(at_first_) << "Cannot reset IteratorAdapter";
+    if (reset_callback_ == nullptr) {
+      CHECK(at_first_) << "Cannot reset IteratorAdapter";
+      return;
+    }
+    if (!at_first_) {
+      (*reset_callback_)(data_handle_);
+      row_offset_ = 0;
+      at_first_ = true;
+    }
   }
 
   bool Next() override {
@@ -594,11 +884,143 @@ class IteratorAdapter : public dmlc::DataIter<FileAdapterBatch> {
   DataIterHandle data_handle_;
   // call back to get the data.
   XGBCallbackDataIterNext *next_callback_;
+  // call back to go back to the first batch, optional.
+  XGBCallbackDataIterReset *reset_callback_;
   // internal Rowblock
   dmlc::RowBlock<uint32_t> block_;
   std::unique_ptr<FileAdapterBatch> batch_;
 };
 
+/*!
+ * \brief One batch of a columnar iterator, read in place.  Each line is one column, so
+ *  pushing the batch into a page is parallel across columns.
+ */
+class ColumnarAdapterBatch : public detail::NoMetaInfo {
+ public:
+  class Line {
+   public:
+    Line(float const* values, uint8_t const* valid, size_t size, size_t column_idx,
+         size_t row_offset)
+        : values_{values}, valid_{valid}, size_{size}, column_idx_{column_idx},
+          row_offset_{row_offset} {}
+
+    size_t Size() const { return size_; }
+    COOTuple GetElement(size_t idx) const {
+      // Arrow validity bitmaps store the first row in the least significant bit.
+      float value = valid_ == nullptr || ((valid_[idx / 8] >> (idx % 8)) & 1) != 0
+                        ? values_[idx]
+                        : std::numeric_limits<float>::quiet_NaN();
+      return COOTuple{row_offset_ + idx, column_idx_, value};
+    }
+
+   private:
+    float const* values_;
+    uint8_t const* valid_;
+    size_t size_;
+    size_t column_idx_;
+    size_t row_offset_;
+  };
+
+  ColumnarAdapterBatch() = default;
+  ColumnarAdapterBatch(XGBoostBatchColumnar const& batch, size_t row_offset)
+      : batch_(batch), row_offset_{row_offset} {}
+
+  size_t Size() const { return batch_.columns; }
+  const Line GetLine(size_t idx) const {
+    uint8_t const* valid = batch_.valid == nullptr ? nullptr : batch_.valid[idx];
+    return Line(batch_.values[idx], valid, batch_.size, idx, row_offset_);
+  }
+
+ private:
+  XGBoostBatchColumnar batch_ {};
+  size_t row_offset_ {0};
+};
+
+/*!
+ * \brief Data iterator over batches of columns given by a callback, used in JVM package.
+ *  Batches are not copied, the iterator must keep one alive until asking for the next.
+ *  Labels and weights are gathered over batches, as the batch itself reports the number
+ *  of columns as its size.
+ */
+class ColumnarIteratorAdapter : public dmlc::DataIter<ColumnarAdapterBatch> {
+ public:
+  ColumnarIteratorAdapter(DataIterHandle data_handle,
+                          XGBCallbackColumnarIterNext* next_callback,
+                          size_t num_rows_hint = 0, size_t num_nonzero_hint = 0)
+      : data_handle_(data_handle), next_callback_(next_callback),
+        num_rows_hint_{num_rows_hint}, num_nonzero_hint_{num_nonzero_hint} {}
+
+  void BeforeFirst() override {
+    CHECK(at_first_) << "Cannot reset ColumnarIteratorAdapter";
+  }
+
+  bool Next() override {
+    if ((*next_callback_)(
+            data_handle_,
+            [](void *handle, XGBoostBatchColumnar batch) -> int {
+              API_BEGIN();
+              static_cast<ColumnarIteratorAdapter *>(handle)->SetData(batch);
+              API_END();
+            },
+            this) != 0) {
+      at_first_ = false;
+      return true;
+    } else {
+      at_end_ = true;
+      return false;
+    }
+  }
+
+  ColumnarAdapterBatch const& Value() const override { return batch_; }
+
+  // callback to set the data
+  void SetData(XGBoostBatchColumnar const& batch) {
+    CHECK(columns_ == kAdapterUnknownSize || columns_ == batch.columns)
+        << "Number of columns between batches changed from " << columns_
+        << " to " << batch.columns;
+    CHECK(batch.values != nullptr || batch.columns == 0);
+    CheckMeta(batch.label, batch.size, &labels_, "label");
+    CheckMeta(batch.weight, batch.size, &weights_, "weight");
+    columns_ = batch.columns;
+    batch_ = ColumnarAdapterBatch(batch, row_offset_);
+    row_offset_ += batch.size;
+  }
+
+  size_t NumColumns() const { return columns_; }
+  // Known once all batches are read, so rows with only missing values at the end are kept.
+  size_t NumRows() const { return at_end_ ? row_offset_ : kAdapterUnknownSize; }
+  size_t NumRowsHint() const { return num_rows_hint_; }
+  size_t NumNonZeroHint() const { return num_nonzero_hint_; }
+
+  std::vector<float>& Labels() { return labels_; }
+  std::vector<float>& Weights() { return weights_; }
+
+ private:
+  void CheckMeta(float const* values, size_t size, std::vector<float>* out,
+                 char const* name) {
+    if (values == nullptr) {
+      CHECK(out->empty()) << "Batch without " << name << " after batches with " << name;
+      return;
+    }
+    CHECK_EQ(out->size(), row_offset_) << "Batch with " << name
+                                       << " after batches without " << name;
+    out->insert(out->end(), values, values + size);
+  }
+
+  DataIterHandle data_handle_;
+  XGBCallbackColumnarIterNext *next_callback_;
+  size_t num_rows_hint_;
+  size_t num_nonzero_hint_;
+
+  size_t columns_ {kAdapterUnknownSize};
+  size_t row_offset_ {0};
+  bool at_first_ {true};
+  bool at_end_ {false};
+  std::vector<float> labels_;
+  std::vector<float> weights_;
+  ColumnarAdapterBatch batch_;
+};
+
 class DMatrixSliceAdapterBatch {
  public:
   // Fetch metainfo values according to sliced rows
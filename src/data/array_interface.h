@@ -10,6 +10,7 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "xgboost/data.h"
 #include "xgboost/json.h"
@@ -320,5 +321,18 @@ class ArrayInterface {
   char type[3];
 };
 
+/*!
+ * \brief Copy a column residing in device memory straight into the device side of `out',
+ *        converting to float on device when needed.
+ * \return false when the column is in host memory or XGBoost is built without CUDA.
+ */
+bool CopyDeviceColumn(ArrayInterface const& column, HostDeviceVector<float>* out);
+/*!
+ * \brief Copy the raw bytes of a column residing in device memory into `staged' and point
+ *        the column at them.
+ * \return false when the column is in host memory or XGBoost is built without CUDA.
+ */
+bool StageDeviceColumn(ArrayInterface* column, std::vector<uint8_t>* staged);
+
 }  // namespace xgboost
 #endif  // XGBOOST_DATA_ARRAY_INTERFACE_H_
@@ -3,7 +3,11 @@
  * \file data.cc
  */
 #include <dmlc/registry.h>
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "dmlc/io.h"
 #include "xgboost/data.h"
@@ -12,12 +16,16 @@
 #include "xgboost/version_config.h"
 #include "sparse_page_writer.h"
 #include "simple_dmatrix.h"
+#include "quantile_dmatrix.h"
+#include "text_parser.h"
 
 #include "../common/io.h"
 #include "../common/math.h"
 #include "../common/version.h"
 #include "../common/group_data.h"
+#include "../common/threading_utils.h"
 #include "../data/adapter.h"
+#include "../data/array_interface.h"
 
 #if DMLC_ENABLE_STD_THREAD
 #include "./sparse_page_source.h"
@@ -29,6 +37,7 @@ DMLC_REGISTRY_ENABLE(::xgboost::data::SparsePageFormatReg<::xgboost::SparsePage>
 DMLC_REGISTRY_ENABLE(::xgboost::data::SparsePageFormatReg<::xgboost::CSCPage>);
 DMLC_REGISTRY_ENABLE(::xgboost::data::SparsePageFormatReg<::xgboost::SortedCSCPage>);
 DMLC_REGISTRY_ENABLE(::xgboost::data::SparsePageFormatReg<::xgboost::EllpackPage>);
+DMLC_REGISTRY_ENABLE(::xgboost::data::SparsePageFormatReg<::xgboost::common::GHistIndexMatrix>);
 }  // namespace dmlc
 
 namespace {
@@ -125,9 +134,11 @@ uint64_t constexpr MetaInfo::kNumField;
 void MetaInfo::Clear() {
   num_row_ = num_col_ = num_nonzero_ = 0;
   labels_.HostVector().clear();
+  label_order_cache_.Resize(0);
   group_ptr_.clear();
   weights_.HostVector().clear();
   base_margin_.HostVector().clear();
+  feature_types.HostVector().clear();
 }
 
 /*
@@ -192,6 +203,7 @@ void MetaInfo::LoadBinary(dmlc::Stream *fi) {
   LoadScalarField(fi, u8"num_col", DataType::kUInt64, &num_col_);
   LoadScalarField(fi, u8"num_nonzero", DataType::kUInt64, &num_nonzero_);
   LoadVectorField(fi, u8"labels", DataType::kFloat32, &labels_);
+  label_order_cache_.Resize(0);
   LoadVectorField(fi, u8"group_ptr", DataType::kUInt32, &group_ptr_);
   LoadVectorField(fi, u8"weights", DataType::kFloat32, &weights_);
   LoadVectorField(fi, u8"base_margin", DataType::kFloat32, &base_margin_);
@@ -250,6 +262,7 @@ void MetaInfo::SetInfo(const char* key, const void* dptr, DataType dtype, size_t
     labels.resize(num);
     DISPATCH_CONST_PTR(dtype, dptr, cast_dptr,
                        std::copy(cast_dptr, cast_dptr + num, labels.begin()));
+    label_order_cache_.Resize(0);
   } else if (!std::strcmp(key, "weight")) {
     auto& weights = weights_.HostVector();
     weights.resize(num);
@@ -268,14 +281,84 @@ void MetaInfo::SetInfo(const char* key, const void* dptr, DataType dtype, size_t
     for (size_t i = 1; i < group_ptr_.size(); ++i) {
       group_ptr_[i] = group_ptr_[i - 1] + group_ptr_[i];
     }
+  } else if (!std::strcmp(key, "feature_type")) {
+    std::vector<float> types(num);
+    DISPATCH_CONST_PTR(dtype, dptr, cast_dptr,
+                       std::copy(cast_dptr, cast_dptr + num, types.begin()));
+    auto& feature_types = this->feature_types.HostVector();
+    feature_types.resize(num);
+    for (size_t i = 0; i < num; ++i) {
+      CHECK(types[i] == 0 || types[i] == 1)
+          << "Feature type must be 0 (numerical) or 1 (categorical), got: " << types[i];
+      feature_types[i] = types[i] == 0 ? FeatureType::kNumerical : FeatureType::kCategorical;
+    }
   } else {
     LOG(FATAL) << "Unknown metainfo: " << key;
   }
 }
 
+void MetaInfo::SetInfo(const char* c_key, std::string const& interface_str) {
+  Json j_interface = Json::Load({interface_str.c_str(), interface_str.size()});
+  // Either a single column or a list holding exactly one column.
+  ArrayInterface column;
+  if (IsA<Array>(j_interface)) {
+    auto const& j_arr = get<Array const>(j_interface);
+    CHECK_EQ(j_arr.size(), 1)
+        << "MetaInfo: " << c_key << ". " << ArrayInterfaceErrors::Dimension(1);
+    column = ArrayInterface(get<Object const>(j_arr[0]));
+  } else {
+    column = ArrayInterface(get<Object const>(j_interface));
+  }
+  std::string key{c_key};
+  CHECK(!column.valid.Data())
+      << "Meta info " << key << " should be dense, found validity mask";
+  CHECK_EQ(column.num_cols, 1)
+      << "Meta info should be a single column.";
+
+  // Float fields from device memory never leave the device.
+  HostDeviceVector<float>* p_dst {nullptr};
+  if (key == "label") {
+    p_dst = &labels_;
+  } else if (key == "weight") {
+    p_dst = &weights_;
+  } else if (key == "base_margin") {
+    p_dst = &base_margin_;
+  }
+  if (p_dst && CopyDeviceColumn(column, p_dst)) {
+    if (key == "label") {
+      label_order_cache_.Resize(0);
+    }
+    return;
+  }
+
+  // Everything else is read from host memory, with a single copy.
+  std::vector<uint8_t> staged;
+  StageDeviceColumn(&column, &staged);
+  size_t const num = column.num_rows;
+  if (column.type[1] == 'f' && column.type[2] == '4') {
+    this->SetInfo(c_key, column.data, DataType::kFloat32, num);
+  } else if (column.type[1] == 'f' && column.type[2] == '8') {
+    this->SetInfo(c_key, column.data, DataType::kDouble, num);
+  } else if (column.type[1] == 'u' && column.type[2] == '4') {
+    this->SetInfo(c_key, column.data, DataType::kUInt32, num);
+  } else if (column.type[1] == 'u' && column.type[2] == '8') {
+    this->SetInfo(c_key, column.data, DataType::kUInt64, num);
+  } else {
+    std::vector<float> converted(num);
+    for (size_t i = 0; i < num; ++i) {
+      converted[i] = column.GetElement(i);
+    }
+    this->SetInfo(c_key, converted.data(), DataType::kFloat32, num);
+  }
+}
+
 #if !defined(XGBOOST_USE_CUDA)
-void MetaInfo::SetInfo(const char * c_key, std::string const& interface_str) {
-  LOG(FATAL) << "XGBoost version is not compiled with GPU support";
+bool CopyDeviceColumn(ArrayInterface const& column, HostDeviceVector<float>* out) {
+  return false;
+}
+
+bool StageDeviceColumn(ArrayInterface* column, std::vector<uint8_t>* staged) {
+  return false;
 }
 #endif  // !defined(XGBOOST_USE_CUDA)
 
@@ -283,7 +366,9 @@ DMatrix* DMatrix::Load(const std::string& uri,
                        bool silent,
                        bool load_row_split,
                        const std::string& file_format,
-                       const size_t page_size) {
+                       const size_t page_size,
+                       int32_t nthread) {
+  nthread = nthread <= 0 ? omp_get_max_threads() : nthread;
   std::string fname, cache_file;
   size_t dlm_pos = uri.find('#');
   if (dlm_pos != std::string::npos) {
@@ -336,8 +421,11 @@ DMatrix* DMatrix::Load(const std::string& uri,
     if (fi != nullptr) {
       common::PeekableInStream is(fi.get());
       if (is.PeekRead(&magic, sizeof(magic)) == sizeof(magic) &&
-        magic == data::SimpleDMatrix::kMagic) {
-        DMatrix* dmat = new data::SimpleDMatrix(&is);
+          (magic == data::SimpleDMatrix::kMagic ||
+           magic == data::SimpleDMatrix::kAlignedMagic)) {
+        DMatrix* dmat = magic == data::SimpleDMatrix::kMagic
+                            ? new data::SimpleDMatrix(&is)
+                            : new data::SimpleDMatrix(fname, &is);
         if (!silent) {
           LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_ << " matrix with "
             << dmat->Info().num_nonzero_ << " entries loaded from " << uri;
@@ -347,14 +435,31 @@ DMatrix* DMatrix::Load(const std::string& uri,
     }
   }
 
-  std::unique_ptr<dmlc::Parser<uint32_t> > parser(
-      dmlc::Parser<uint32_t>::Create(fname.c_str(), partid, npart, file_format.c_str()));
-  data::FileAdapter adapter(parser.get());
   DMatrix* dmat {nullptr};
+  std::string const parser_format = data::TextParserFormat(fname, file_format);
 
   try {
-    dmat = DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1,
-                           cache_file, page_size);
+    if (cache_file.empty() && npart == 1 && nthread > 1) {
+      // Split the text input into one part for each thread, parts are parsed
+      // and converted concurrently then concatenated in order.
+      std::vector<std::unique_ptr<dmlc::Parser<uint32_t>>> parsers;
+      std::vector<std::unique_ptr<data::FileAdapter>> adapters;
+      std::vector<data::FileAdapter*> chunks;
+      for (int32_t i = 0; i < nthread; ++i) {
+        parsers.emplace_back(
+            dmlc::Parser<uint32_t>::Create(fname.c_str(), i, nthread, parser_format.c_str()));
+        adapters.emplace_back(new data::FileAdapter(parsers.back().get()));
+        chunks.push_back(adapters.back().get());
+      }
+      dmat = new data::SimpleDMatrix(chunks, std::numeric_limits<float>::quiet_NaN(),
+                                     nthread);
+    } else {
+      std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+          dmlc::Parser<uint32_t>::Create(fname.c_str(), partid, npart, parser_format.c_str()));
+      data::FileAdapter adapter(parser.get());
+      dmat = DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), nthread,
+                             cache_file, page_size);
+    }
   } catch (dmlc::Error& e) {
     std::vector<std::string> splited = common::Split(fname, '#');
     std::vector<std::string> args = common::Split(splited.front(), '?');
@@ -454,9 +559,21 @@ template DMatrix* DMatrix::Create<data::CSRAdapter>(
 template DMatrix* DMatrix::Create<data::CSCAdapter>(
     data::CSCAdapter* adapter, float missing, int nthread,
     const std::string& cache_prefix, size_t page_size);
+template DMatrix* DMatrix::Create<data::TypedCSCAdapter<int32_t, double>>(
+    data::TypedCSCAdapter<int32_t, double>* adapter, float missing, int nthread,
+    const std::string& cache_prefix, size_t page_size);
+template DMatrix* DMatrix::Create<data::ColMajorDenseAdapter<double>>(
+    data::ColMajorDenseAdapter<double>* adapter, float missing, int nthread,
+    const std::string& cache_prefix, size_t page_size);
+template DMatrix* DMatrix::Create<data::ColMajorDenseAdapter<int32_t>>(
+    data::ColMajorDenseAdapter<int32_t>* adapter, float missing, int nthread,
+    const std::string& cache_prefix, size_t page_size);
 template DMatrix* DMatrix::Create<data::DataTableAdapter>(
     data::DataTableAdapter* adapter, float missing, int nthread,
     const std::string& cache_prefix, size_t page_size);
+template DMatrix* DMatrix::Create<data::ArrowAdapter>(
+    data::ArrowAdapter* adapter, float missing, int nthread,
+    const std::string& cache_prefix, size_t page_size);
 template DMatrix* DMatrix::Create<data::FileAdapter>(
     data::FileAdapter* adapter, float missing, int nthread,
     const std::string& cache_prefix, size_t page_size);
@@ -466,6 +583,96 @@ template DMatrix* DMatrix::Create<data::DMatrixSliceAdapter>(
 template DMatrix* DMatrix::Create<data::IteratorAdapter>(
     data::IteratorAdapter* adapter, float missing, int nthread,
     const std::string& cache_prefix, size_t page_size);
+template DMatrix* DMatrix::Create<data::ColumnarIteratorAdapter>(
+    data::ColumnarIteratorAdapter* adapter, float missing, int nthread,
+    const std::string& cache_prefix, size_t page_size);
+
+template <typename AdapterT>
+DMatrix* DMatrix::CreateQuantile(AdapterT* adapter, float missing, int nthread,
+                                 int max_bin) {
+  return new data::QuantileDMatrix(adapter, missing, nthread, max_bin);
+}
+
+template DMatrix* DMatrix::CreateQuantile<data::DenseAdapter>(
+    data::DenseAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::CSRAdapter>(
+    data::CSRAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::CSCAdapter>(
+    data::CSCAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::DataTableAdapter>(
+    data::DataTableAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::FileAdapter>(
+    data::FileAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::DMatrixSliceAdapter>(
+    data::DMatrixSliceAdapter* adapter, float missing, int nthread, int max_bin);
+template DMatrix* DMatrix::CreateQuantile<data::IteratorAdapter>(
+    data::IteratorAdapter* adapter, float missing, int nthread, int max_bin);
+
+namespace {
+/*! \brief Maps a float onto an unsigned key with the same order. */
+inline uint32_t RadixKey(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+/*!
+ * \brief Stable LSD radix sort of `n' entries by value, one byte per pass.  Passes where
+ *  all keys share the same byte are skipped.
+ */
+void RadixSortByValue(Entry* entries, size_t n, std::vector<Entry>* p_buffer) {
+  constexpr size_t kBits = 8;
+  constexpr size_t kBuckets = 1 << kBits;
+  auto& buffer = *p_buffer;
+  buffer.resize(n);
+  Entry* src = entries;
+  Entry* dst = buffer.data();
+  for (size_t shift = 0; shift < sizeof(uint32_t) * 8; shift += kBits) {
+    std::array<size_t, kBuckets> counts{};
+    for (size_t i = 0; i < n; ++i) {
+      counts[(RadixKey(src[i].fvalue) >> shift) & (kBuckets - 1)]++;
+    }
+    if (std::any_of(counts.cbegin(), counts.cend(), [n](size_t c) { return c == n; })) {
+      continue;
+    }
+    size_t sum = 0;
+    for (auto& c : counts) {
+      size_t tmp = c;
+      c = sum;
+      sum += tmp;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      dst[counts[(RadixKey(src[i].fvalue) >> shift) & (kBuckets - 1)]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != entries) {
+    std::copy(src, src + n, entries);
+  }
+}
+}  // anonymous namespace
+
+void SparsePage::SortRows() {
+  // below this size a comparison sort is cheaper than 4 counting passes
+  constexpr size_t kRadixSortThreshold = 256;
+  auto const& offset_vec = this->offset.ConstHostVector();
+  auto& data_vec = this->data.HostVector();
+  auto nrow = static_cast<bst_omp_uint>(this->Size());
+#pragma omp parallel
+  {
+    std::vector<Entry> buffer;
+#pragma omp for schedule(dynamic, 1)
+    for (bst_omp_uint i = 0; i < nrow; ++i) {
+      size_t n = offset_vec[i + 1] - offset_vec[i];
+      Entry* begin = data_vec.data() + offset_vec[i];
+      if (n < kRadixSortThreshold) {
+        std::stable_sort(begin, begin + n, Entry::CmpValue);
+      } else {
+        RadixSortByValue(begin, n, &buffer);
+      }
+    }
+  }
+}
 
 SparsePage SparsePage::GetTranspose(int num_columns) const {
   SparsePage transpose;
@@ -515,11 +722,7 @@ void SparsePage::Push(const SparsePage &batch) {
 
 template <typename AdapterBatchT>
 uint64_t SparsePage::Push(const AdapterBatchT& batch, float missing, int nthread) {
-  // Set number of threads but keep old value so we can reset it after
-  const int nthreadmax = omp_get_max_threads();
-  if (nthread <= 0) nthread = nthreadmax;
-  int nthread_original = omp_get_max_threads();
-  omp_set_num_threads(nthread);
+  nthread = common::OmpGetNumThreads(nthread);
   auto& offset_vec = offset.HostVector();
   auto& data_vec = data.HostVector();
   size_t builder_base_row_offset = this->Size();
@@ -537,19 +740,20 @@ uint64_t SparsePage::Push(const AdapterBatchT& batch, float missing, int nthread
     }
   }
   builder.InitBudget(expected_rows, nthread);
-  uint64_t max_columns = 0;
+  // Number of columns seen by each thread
+  std::vector<uint64_t> max_columns_local(nthread, 0);
 
   // First-pass over the batch counting valid elements
   size_t num_lines = batch.Size();
-#pragma omp parallel for schedule(static)
+#pragma omp parallel for num_threads(nthread) schedule(static)
   for (omp_ulong i = 0; i < static_cast<omp_ulong>(num_lines);
        ++i) {  // NOLINT(*)
     int tid = omp_get_thread_num();
     auto line = batch.GetLine(i);
     for (auto j = 0ull; j < line.Size(); j++) {
       data::COOTuple element = line.GetElement(j);
-      max_columns =
-          std::max(max_columns, static_cast<uint64_t>(element.column_idx + 1));
+      max_columns_local[tid] = std::max(max_columns_local[tid],
+                                        static_cast<uint64_t>(element.column_idx + 1));
       if (!common::CheckNAN(element.value) && element.value != missing) {
         size_t key = element.row_idx - base_rowid;
         // Adapter row index is absolute, here we want it relative to
@@ -562,7 +766,7 @@ uint64_t SparsePage::Push(const AdapterBatchT& batch, float missing, int nthread
   builder.InitStorage();
 
   // Second pass over batch, placing elements in correct position
-#pragma omp parallel for schedule(static)
+#pragma omp parallel for num_threads(nthread) schedule(static)
   for (omp_ulong i = 0; i < static_cast<omp_ulong>(num_lines);
        ++i) {  // NOLINT(*)
     int tid = omp_get_thread_num();
@@ -577,8 +781,7 @@ uint64_t SparsePage::Push(const AdapterBatchT& batch, float missing, int nthread
       }
     }
   }
-  omp_set_num_threads(nthread_original);
-  return max_columns;
+  return *std::max_element(max_columns_local.cbegin(), max_columns_local.cend());
 }
 
 void SparsePage::PushCSC(const SparsePage &batch) {
@@ -643,5 +846,6 @@ void SparsePage::PushCSC(const SparsePage &batch) {
 namespace data {
 // List of files that will be force linked in static links.
 DMLC_REGISTRY_LINK_TAG(sparse_page_raw_format);
+DMLC_REGISTRY_LINK_TAG(sparse_page_packed_format);
 }  // namespace data
 }  // namespace xgboost
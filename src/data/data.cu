@@ -2,8 +2,10 @@
  * Copyright 2019 by XGBoost Contributors
  *
  * \file data.cu
- * \brief Handles setting metainfo from array interface.
+ * \brief Copies metainfo from device array interface.
  */
+#include <vector>
+
 #include "xgboost/data.h"
 #include "xgboost/logging.h"
 #include "xgboost/json.h"
@@ -14,59 +16,38 @@
 
 namespace xgboost {
 
-void CopyInfoImpl(ArrayInterface column, HostDeviceVector<float>* out) {
-  auto SetDeviceToPtr = [](void* ptr) {
-    cudaPointerAttributes attr;
-    dh::safe_cuda(cudaPointerGetAttributes(&attr, ptr));
-    int32_t ptr_device = attr.device;
-    dh::safe_cuda(cudaSetDevice(ptr_device));
-    return ptr_device;
-  };
-  auto ptr_device = SetDeviceToPtr(column.data);
-
-  out->SetDevice(ptr_device);
+bool CopyDeviceColumn(ArrayInterface const& column, HostDeviceVector<float>* out) {
+  int32_t device {-1};
+  if (!dh::IsDevicePointer(column.data, &device)) {
+    return false;
+  }
+  dh::safe_cuda(cudaSetDevice(device));
+  out->SetDevice(device);
   out->Resize(column.num_rows);
-
-  auto p_dst = thrust::device_pointer_cast(out->DevicePointer());
-
-  dh::LaunchN(ptr_device, column.num_rows, [=] __device__(size_t idx) {
+  if (column.type[1] == 'f' && column.type[2] == '4') {
+    dh::safe_cuda(cudaMemcpyAsync(out->DevicePointer(), column.data,
+                                  column.num_rows * sizeof(float),
+                                  cudaMemcpyDeviceToDevice));
+    return true;
+  }
+  auto p_dst = out->DevicePointer();
+  dh::LaunchN(device, column.num_rows, [=] __device__(size_t idx) {
     p_dst[idx] = column.GetElement(idx);
   });
+  return true;
 }
 
-void MetaInfo::SetInfo(const char * c_key, std::string const& interface_str) {
-  Json j_interface = Json::Load({interface_str.c_str(), interface_str.size()});
-  auto const& j_arr = get<Array>(j_interface);
-  CHECK_EQ(j_arr.size(), 1)
-      << "MetaInfo: " << c_key << ". " << ArrayInterfaceErrors::Dimension(1);
-  ArrayInterface array_interface(get<Object const>(j_arr[0]));
-  std::string key{c_key};
-  CHECK(!array_interface.valid.Data())
-      << "Meta info " << key << " should be dense, found validity mask";
-  CHECK_EQ(array_interface.num_cols, 1)
-      << "Meta info should be a single column.";
-
-  if (key == "label") {
-    CopyInfoImpl(array_interface, &labels_);
-  } else if (key == "weight") {
-    CopyInfoImpl(array_interface, &weights_);
-  } else if (key == "base_margin") {
-    CopyInfoImpl(array_interface, &base_margin_);
-  } else if (key == "group") {
-    // Ranking is not performed on device.
-    thrust::device_ptr<uint32_t> p_src{
-        reinterpret_cast<uint32_t*>(array_interface.data)};
-
-    auto length = array_interface.num_rows;
-    group_ptr_.resize(length + 1);
-    group_ptr_[0] = 0;
-    thrust::copy(p_src, p_src + length, group_ptr_.begin() + 1);
-    std::partial_sum(group_ptr_.begin(), group_ptr_.end(), group_ptr_.begin());
-
-    return;
-  } else {
-    LOG(FATAL) << "Unknown metainfo: " << key;
+bool StageDeviceColumn(ArrayInterface* column, std::vector<uint8_t>* staged) {
+  int32_t device {-1};
+  if (!dh::IsDevicePointer(column->data, &device)) {
+    return false;
   }
+  size_t const n_bytes = column->num_rows * static_cast<size_t>(column->type[2] - '0');
+  staged->resize(n_bytes);
+  dh::safe_cuda(cudaSetDevice(device));
+  dh::safe_cuda(cudaMemcpy(staged->data(), column->data, n_bytes, cudaMemcpyDeviceToHost));
+  column->data = staged->data();
+  return true;
 }
 
 template <typename AdapterT>
@@ -0,0 +1,96 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file dense_view_dmatrix.cc
+ */
+#include "./dense_view_dmatrix.h"
+
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "./adapter.h"
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+DenseViewDMatrix::DenseViewDMatrix(float const* data, size_t nrow, size_t ncol,
+                                   float missing, int nthread)
+    : data_{data}, missing_{missing}, nthread_{nthread} {
+  info_.num_row_ = nrow;
+  info_.num_col_ = ncol;
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  // one pass over the values, nothing is allocated
+  uint64_t nnz = 0;
+#pragma omp parallel for schedule(static) reduction(+:nnz) num_threads(nthread)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    float const* row = this->Row(i);
+    for (size_t j = 0; j < ncol; ++j) {
+      nnz += this->IsValid(row[j]) ? 1 : 0;
+    }
+  }
+  info_.num_nonzero_ = nnz;
+}
+
+DenseViewDMatrix::~DenseViewDMatrix() = default;
+
+bool DenseViewDMatrix::RowsValid(size_t begin, size_t n) const {
+  if (info_.num_nonzero_ == info_.num_row_ * info_.num_col_) {
+    return true;
+  }
+  float const* values = this->Row(begin);
+  return std::all_of(values, values + n * info_.num_col_,
+                     [this](float v) { return this->IsValid(v); });
+}
+
+void DenseViewDMatrix::GatherRows(size_t begin, size_t n, SparsePage* page) const {
+  page->Clear();
+  page->SetBaseRowId(begin);
+  auto& offset = page->offset.HostVector();
+  auto& data = page->data.HostVector();
+  for (size_t i = begin; i < begin + n; ++i) {
+    float const* row = this->Row(i);
+    for (size_t j = 0; j < info_.num_col_; ++j) {
+      if (this->IsValid(row[j])) {
+        data.emplace_back(static_cast<bst_feature_t>(j), row[j]);
+      }
+    }
+    offset.emplace_back(data.size());
+  }
+}
+
+SimpleDMatrix* DenseViewDMatrix::Materialized() {
+  if (!materialized_) {
+    LOG(INFO) << "Copying a dense view into a DMatrix of " << info_.num_row_ << " rows.";
+    DenseAdapter adapter(data_, info_.num_row_, info_.num_col_);
+    materialized_.reset(new SimpleDMatrix(&adapter, missing_, nthread_));
+  }
+  return materialized_.get();
+}
+
+BatchSet<SparsePage> DenseViewDMatrix::GetRowBatches() {
+  return this->Materialized()->GetBatches<SparsePage>();
+}
+
+BatchSet<CSCPage> DenseViewDMatrix::GetColumnBatches() {
+  return this->Materialized()->GetBatches<CSCPage>();
+}
+
+BatchSet<SortedCSCPage> DenseViewDMatrix::GetSortedColumnBatches() {
+  return this->Materialized()->GetBatches<SortedCSCPage>();
+}
+
+BatchSet<EllpackPage> DenseViewDMatrix::GetEllpackBatches(const BatchParam& param) {
+  return this->Materialized()->GetBatches<EllpackPage>(param);
+}
+
+BatchSet<common::GHistIndexMatrix> DenseViewDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  return this->Materialized()->GetBatches<common::GHistIndexMatrix>(param);
+}
+
+bool DenseViewDMatrix::EllpackExists() const {
+  return materialized_ && materialized_->PageExists<EllpackPage>();
+}
+}  // namespace data
+}  // namespace xgboost
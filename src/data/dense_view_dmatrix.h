@@ -0,0 +1,70 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file dense_view_dmatrix.h
+ * \brief DMatrix over a dense row major buffer owned by the caller.
+ */
+#ifndef XGBOOST_DATA_DENSE_VIEW_DMATRIX_H_
+#define XGBOOST_DATA_DENSE_VIEW_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+
+#include <memory>
+
+#include "../common/math.h"
+
+namespace xgboost {
+namespace data {
+class SimpleDMatrix;
+
+/*!
+ * \brief A DMatrix that reads the values of a dense matrix in place, the buffer must
+ *  outlive it.
+ *
+ *  The CPU predictor walks the rows straight from the buffer.  Everything else that asks
+ *  for batches gets them from a SimpleDMatrix built on the first request, so training
+ *  or the GPU on a view costs the same copy as a matrix created from the array.
+ */
+class DenseViewDMatrix : public DMatrix {
+ public:
+  DenseViewDMatrix(float const* data, size_t nrow, size_t ncol, float missing,
+                   int nthread);
+  ~DenseViewDMatrix() override;
+
+  MetaInfo& Info() override { return info_; }
+  const MetaInfo& Info() const override { return info_; }
+
+  bool SingleColBlock() const override { return true; }
+
+  float const* Row(size_t ridx) const { return data_ + ridx * info_.num_col_; }
+  bool IsValid(float value) const {
+    return !common::CheckNAN(value) && value != missing_;
+  }
+  /*! \brief Whether rows [begin, begin + n) have every value present. */
+  bool RowsValid(size_t begin, size_t n) const;
+  /*! \brief Copy the valid values of rows [begin, begin + n) into page. */
+  void GatherRows(size_t begin, size_t n, SparsePage* page) const;
+
+ private:
+  BatchSet<SparsePage> GetRowBatches() override;
+  BatchSet<CSCPage> GetColumnBatches() override;
+  BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
+  BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
+
+  SimpleDMatrix* Materialized();
+
+  MetaInfo info_;
+  float const* data_;
+  float missing_;
+  int nthread_;
+  std::unique_ptr<SimpleDMatrix> materialized_;
+
+  bool EllpackExists() const override;
+  bool SparsePageExists() const override {
+    return static_cast<bool>(materialized_);
+  }
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_DENSE_VIEW_DMATRIX_H_
@@ -1,23 +1,225 @@
 /*!
- * Copyright 2019 XGBoost contributors
+ * Copyright 2019-2020 XGBoost contributors
  */
 #ifndef XGBOOST_USE_CUDA
 
 #include <xgboost/data.h>
 
-// dummy implementation of EllpackPage in case CUDA is not used
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "./ellpack_page_host.h"
+#include "../common/common.h"
+
+// host implementation of EllpackPage in case CUDA is not used
 namespace xgboost {
+namespace {
+// Rows are quantized and unpacked in blocks of this many rows.  It's a multiple of 8 so
+// blocks starting at a multiple of it begin on a byte of their own in the compressed
+// buffer, and threads never write to the same byte.
+constexpr size_t kBlockRows = 256;
+
+size_t MaxRowLength(DMatrix* dmat) {
+  size_t row_stride = 0;
+  for (const auto& batch : dmat->GetBatches<SparsePage>()) {
+    auto const& offset = batch.offset.ConstHostVector();
+    for (size_t i = 1; i < offset.size(); ++i) {
+      row_stride = std::max(row_stride, static_cast<size_t>(offset[i] - offset[i - 1]));
+    }
+  }
+  return row_stride;
+}
+
+template <typename BinIdxType>
+void SetIndexFromBins(EllpackPageImpl const& page, common::GHistIndexMatrix* out) {
+  const size_t row_stride = page.RowStride();
+  const uint32_t null_value = page.NullValue();
+  const uint32_t* offsets = out->index.Offset();
+  BinIdxType* index_data = out->index.data<BinIdxType>();
+  const size_t n_blocks = common::DivRoundUp(page.Size(), kBlockRows);
+  #pragma omp parallel
+  {
+    std::vector<uint32_t> bins(kBlockRows * row_stride);
+    std::vector<size_t> hit_count(null_value, 0);
+    #pragma omp for schedule(static)
+    for (omp_ulong block = 0; block < n_blocks; ++block) {  // NOLINT(*)
+      const size_t rbegin = block * kBlockRows;
+      const size_t rend = std::min(rbegin + kBlockRows, page.Size());
+      page.GetRowBins(rbegin, rend, bins.data());
+      for (size_t i = rbegin; i < rend; ++i) {
+        const uint32_t* row = bins.data() + (i - rbegin) * row_stride;
+        const size_t ibegin = out->row_ptr[i];
+        const size_t length = out->row_ptr[i + 1] - ibegin;
+        for (size_t j = 0; j < length; ++j) {
+          // dense bins are kept relative to the feature at position j
+          const uint32_t local = offsets != nullptr ? row[j] - offsets[j] : row[j];
+          index_data[ibegin + j] = static_cast<BinIdxType>(local);
+          ++hit_count[row[j]];
+        }
+      }
+    }
+    #pragma omp critical
+    for (size_t i = 0; i < hit_count.size(); ++i) {
+      out->hit_count[i] += hit_count[i];
+    }
+  }
+}
+}  // anonymous namespace
+
+EllpackPageImpl::EllpackPageImpl(DMatrix* dmat, const BatchParam& param) {
+  cuts_.Build(dmat, param.max_bin);
+  is_dense_ = dmat->IsDense();
+  row_stride_ = MaxRowLength(dmat);
+  n_rows_ = dmat->Info().num_row_;
+  this->Compress(dmat);
+}
+
+EllpackPageImpl::EllpackPageImpl(DMatrix* dmat, common::HistogramCuts cuts,
+                                 size_t row_stride)
+    : cuts_{std::move(cuts)}, is_dense_{dmat->IsDense()}, row_stride_{row_stride},
+      n_rows_{dmat->Info().num_row_} {
+  this->Compress(dmat);
+}
+
+size_t EllpackPageImpl::NumSymbols() const {
+  if (!is_dense_) {
+    return cuts_.TotalBins() + 1;
+  }
+  auto const& ptrs = cuts_.Ptrs();
+  uint32_t max_feature_bins = 1;
+  for (size_t i = 1; i < ptrs.size(); ++i) {
+    max_feature_bins = std::max(max_feature_bins, ptrs[i] - ptrs[i - 1]);
+  }
+  return max_feature_bins;
+}
 
-class EllpackPageImpl {};
+void EllpackPageImpl::Compress(DMatrix* dmat) {
+  const size_t num_symbols = this->NumSymbols();
+  idx_buffer.assign(common::CompressedBufferWriter::CalculateBufferSize(
+                        row_stride_ * n_rows_, num_symbols), 0);
+  common::CompressedBufferWriter writer(num_symbols);
+  auto const& ptrs = cuts_.Ptrs();
+  const uint32_t null_value = this->NullValue();
 
-EllpackPage::EllpackPage() = default;
+  size_t batch_begin = 0;
+  for (const auto& batch : dmat->GetBatches<SparsePage>()) {
+    const size_t batch_end = batch_begin + batch.Size();
+    CHECK_LE(batch_end, n_rows_);
+    // blocks are aligned to the rows of the whole page, not to the batch
+    const size_t first_block = batch_begin / kBlockRows;
+    const size_t last_block = common::DivRoundUp(batch_end, kBlockRows);
+    #pragma omp parallel
+    {
+      std::vector<uint32_t> row(row_stride_);
+      #pragma omp for schedule(static)
+      for (omp_ulong block = first_block; block < last_block; ++block) {  // NOLINT(*)
+        const size_t rbegin = std::max(static_cast<size_t>(block) * kBlockRows, batch_begin);
+        const size_t rend = std::min(static_cast<size_t>(block + 1) * kBlockRows, batch_end);
+        for (size_t ridx = rbegin; ridx < rend; ++ridx) {
+          auto inst = batch[ridx - batch_begin];
+          CHECK_LE(inst.size(), row_stride_);
+          if (is_dense_) {
+            for (auto const& entry : inst) {
+              row[entry.index] = cuts_.SearchBin(entry) - ptrs[entry.index];
+            }
+          } else {
+            for (size_t j = 0; j < inst.size(); ++j) {
+              row[j] = cuts_.SearchBin(inst[j]);
+            }
+            std::sort(row.begin(), row.begin() + inst.size());
+            std::fill(row.begin() + inst.size(), row.end(), null_value);
+          }
+          for (size_t j = 0; j < row_stride_; ++j) {
+            writer.WriteSymbol(idx_buffer.data(), row[j], ridx * row_stride_ + j);
+          }
+        }
+      }
+    }
+    batch_begin = batch_end;
+  }
+}
+
+void EllpackPageImpl::GetRowBins(size_t begin, size_t end, uint32_t* out) const {
+  CHECK_LE(begin, end);
+  CHECK_LE(end, n_rows_);
+  common::UnpackSymbols(idx_buffer.data(), idx_buffer.size(), this->NumSymbols(),
+                        begin * row_stride_, (end - begin) * row_stride_, out);
+  if (is_dense_) {
+    auto const& ptrs = cuts_.Ptrs();
+    for (size_t i = 0; i < end - begin; ++i) {
+      for (size_t j = 0; j < row_stride_; ++j) {
+        out[i * row_stride_ + j] += ptrs[j];
+      }
+    }
+  }
+}
+
+void EllpackPageImpl::ToGHistIndex(common::GHistIndexMatrix* out) const {
+  CHECK(!cuts_.Values().empty()) << "The ELLPACK page holds no cuts.";
+  std::vector<size_t> row_ptr(n_rows_ + 1, 0);
+  if (is_dense_) {
+    for (size_t i = 0; i < n_rows_; ++i) {
+      row_ptr[i + 1] = row_ptr[i] + row_stride_;
+    }
+  } else {
+    // bins of a sparse row are sorted, so the row ends at its first null value
+    const uint32_t null_value = this->NullValue();
+    const size_t n_blocks = common::DivRoundUp(n_rows_, kBlockRows);
+    #pragma omp parallel
+    {
+      std::vector<uint32_t> bins(kBlockRows * row_stride_);
+      #pragma omp for schedule(static)
+      for (omp_ulong block = 0; block < n_blocks; ++block) {  // NOLINT(*)
+        const size_t rbegin = block * kBlockRows;
+        const size_t rend = std::min(rbegin + kBlockRows, n_rows_);
+        this->GetRowBins(rbegin, rend, bins.data());
+        for (size_t i = rbegin; i < rend; ++i) {
+          auto row = bins.cbegin() + (i - rbegin) * row_stride_;
+          row_ptr[i + 1] = std::find(row, row + row_stride_, null_value) - row;
+        }
+      }
+    }
+    for (size_t i = 0; i < n_rows_; ++i) {
+      row_ptr[i + 1] += row_ptr[i];
+    }
+  }
+
+  out->InitStorage(cuts_, std::move(row_ptr), is_dense_);
+  out->base_rowid = base_rowid_;
+  switch (out->index.GetBinTypeSize()) {
+    case common::kUint8BinsTypeSize:
+      SetIndexFromBins<uint8_t>(*this, out);
+      break;
+    case common::kUint16BinsTypeSize:
+      SetIndexFromBins<uint16_t>(*this, out);
+      break;
+    default:
+      CHECK_EQ(out->index.GetBinTypeSize(), common::kUint32BinsTypeSize);
+      SetIndexFromBins<uint32_t>(*this, out);
+      break;
+  }
+}
+
+EllpackPage::EllpackPage() : impl_{new EllpackPageImpl()} {}
+
+EllpackPage::EllpackPage(DMatrix* dmat, const BatchParam& param)
+    : impl_{new EllpackPageImpl(dmat, param)} {}
+
+EllpackPage::~EllpackPage() = default;
+
+size_t EllpackPage::Size() const {
+  return impl_->Size();
+}
 
-EllpackPage::EllpackPage(DMatrix* dmat, const BatchParam& param) {
-  LOG(FATAL) << "Internal Error: XGBoost is not compiled with CUDA but EllpackPage is required";
+void EllpackPage::SetBaseRowId(size_t row_id) {
+  impl_->SetBaseRowId(row_id);
 }
 
-EllpackPage::~EllpackPage() {
-  LOG(FATAL) << "Internal Error: XGBoost is not compiled with CUDA but EllpackPage is required";
+void EllpackPage::Requantize(DMatrix* dmat, const BatchParam& param) {
+  common::HistogramCuts cuts = impl_->Cuts();
+  CHECK(!cuts.Values().empty()) << "The ELLPACK page holds no cuts to quantize with.";
+  impl_.reset(new EllpackPageImpl(dmat, std::move(cuts), MaxRowLength(dmat)));
 }
 
 }  // namespace xgboost
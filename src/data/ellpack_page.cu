@@ -25,6 +25,20 @@ void EllpackPage::SetBaseRowId(size_t row_id) {
   impl_->SetBaseRowId(row_id);
 }
 
+void EllpackPage::Requantize(DMatrix* dmat, const BatchParam& param) {
+  common::HistogramCuts cuts = impl_->Cuts();
+  CHECK(!cuts.Values().empty()) << "The ELLPACK page holds no cuts to quantize with.";
+  size_t row_stride = 0;
+  for (const auto& batch : dmat->GetBatches<SparsePage>()) {
+    auto const& offset = batch.offset.ConstHostVector();
+    for (size_t i = 1; i < offset.size(); ++i) {
+      row_stride = std::max(row_stride, static_cast<size_t>(offset[i] - offset[i - 1]));
+    }
+  }
+  impl_.reset(new EllpackPageImpl(param.gpu_id, dmat, cuts, row_stride, 0,
+                                  dmat->Info().num_row_));
+}
+
 // Bin each input data entry, store the bin indices in compressed form.
 __global__ void CompressBinEllpackKernel(
     common::CompressedBufferWriter wr,
@@ -36,7 +50,8 @@ __global__ void CompressBinEllpackKernel(
     size_t base_row,                        // batch_row_begin
     size_t n_rows,
     size_t row_stride,
-    unsigned int null_gidx_value) {
+    unsigned int null_gidx_value,
+    bool feature_local_bins) {
   size_t irow = threadIdx.x + blockIdx.x * blockDim.x;
   int ifeature = threadIdx.y + blockIdx.y * blockDim.y;
   if (irow >= n_rows || ifeature >= row_stride) {
@@ -57,8 +72,11 @@ __global__ void CompressBinEllpackKernel(
     if (bin >= ncuts) {
       bin = ncuts - 1;
     }
-    // Add the number of bins in previous features.
-    bin += cut_rows[feature];
+    // Add the number of bins in previous features, unless bins are stored
+    // relative to their feature.
+    if (!feature_local_bins) {
+      bin += cut_rows[feature];
+    }
   }
   // Write to gidx buffer.
   wr.AtomicWriteSymbol(buffer, bin, (irow + base_row) * row_stride + ifeature);
@@ -66,7 +84,7 @@ __global__ void CompressBinEllpackKernel(
 
 // Construct an ELLPACK matrix with the given number of empty rows.
 EllpackPageImpl::EllpackPageImpl(int device, EllpackInfo info, size_t n_rows) {
-  monitor_.Init("ellpack_page");
+  monitor_.Init("ellpack_page", common::NvtxCategory::kData);
   dh::safe_cuda(cudaSetDevice(device));
 
   matrix.info = info;
@@ -80,7 +98,7 @@ EllpackPageImpl::EllpackPageImpl(int device, EllpackInfo info, size_t n_rows) {
 
 // Construct an ELLPACK matrix in memory.
 EllpackPageImpl::EllpackPageImpl(DMatrix* dmat, const BatchParam& param) {
-  monitor_.Init("ellpack_page");
+  monitor_.Init("ellpack_page", common::NvtxCategory::kData);
   dh::safe_cuda(cudaSetDevice(param.gpu_id));
 
   matrix.n_rows = dmat->Info().num_row_;
@@ -94,6 +112,7 @@ EllpackPageImpl::EllpackPageImpl(DMatrix* dmat, const BatchParam& param) {
 
   monitor_.StartCuda("InitEllpackInfo");
   InitInfo(param.gpu_id, dmat->IsDense(), row_stride, hmat);
+  cuts_ = std::move(hmat);
   monitor_.StopCuda("InitEllpackInfo");
 
   monitor_.StartCuda("InitCompressedData");
@@ -110,6 +129,35 @@ EllpackPageImpl::EllpackPageImpl(DMatrix* dmat, const BatchParam& param) {
   monitor_.StopCuda("BinningCompression");
 }
 
+// Construct an ELLPACK matrix in memory for a range of rows.
+EllpackPageImpl::EllpackPageImpl(int device, DMatrix* dmat, const common::HistogramCuts& hmat,
+                                 size_t row_stride, size_t row_begin, size_t row_end) {
+  monitor_.Init("ellpack_page", common::NvtxCategory::kData);
+  dh::safe_cuda(cudaSetDevice(device));
+  CHECK_LE(row_begin, row_end);
+  CHECK_LE(row_end, dmat->Info().num_row_);
+
+  matrix.n_rows = row_end - row_begin;
+
+  monitor_.StartCuda("InitEllpackInfo");
+  InitInfo(device, dmat->IsDense(), row_stride, hmat);
+  cuts_ = hmat;
+  monitor_.StopCuda("InitEllpackInfo");
+
+  monitor_.StartCuda("InitCompressedData");
+  InitCompressedData(device, matrix.n_rows);
+  monitor_.StopCuda("InitCompressedData");
+
+  monitor_.StartCuda("BinningCompression");
+  DeviceHistogramBuilderState hist_builder_row_state(matrix.n_rows, row_begin);
+  for (const auto& batch : dmat->GetBatches<SparsePage>()) {
+    hist_builder_row_state.BeginBatch(batch);
+    CreateHistIndices(device, batch, hist_builder_row_state.GetRowStateOnDevice());
+    hist_builder_row_state.EndBatch();
+  }
+  monitor_.StopCuda("BinningCompression");
+}
+
 // A functor that copies the data from one EllpackPage to another.
 struct CopyPage {
   common::CompressedBufferWriter cbw;
@@ -196,6 +244,10 @@ EllpackInfo::EllpackInfo(int device,
                          const common::HistogramCuts& hmat,
                          dh::BulkAllocator* ba)
     : is_dense(is_dense), row_stride(row_stride), n_bins(hmat.Ptrs().back()) {
+  auto const& ptrs = hmat.Ptrs();
+  for (size_t i = 1; i < ptrs.size(); ++i) {
+    max_feature_bins = std::max(max_feature_bins, static_cast<size_t>(ptrs[i] - ptrs[i - 1]));
+  }
 
   ba->Allocate(device,
                &feature_segments, hmat.Ptrs().size(),
@@ -292,7 +344,8 @@ void EllpackPageImpl::CreateHistIndices(int device,
         device_row_state.total_rows_processed + batch_row_begin,
         batch_nrows,
         row_stride,
-        null_gidx_value);
+        null_gidx_value,
+        matrix.info.is_dense);
   }
 }
 
@@ -306,10 +359,10 @@ void EllpackPageImpl::Clear() {
   ba_.Clear();
   gidx_buffer = {};
   idx_buffer.clear();
+  device_storage_ = {};
   sparse_page_.Clear();
   matrix.base_rowid = 0;
   matrix.n_rows = 0;
-  device_initialized_ = false;
 }
 
 // Push a CSR page to the current page.
@@ -351,21 +404,27 @@ size_t EllpackPageImpl::MemCostBytes() const {
 }
 
 // Copy the compressed features to GPU.
-void EllpackPageImpl::InitDevice(int device, EllpackInfo info) {
-  if (device_initialized_) return;
-
-  monitor_.StartCuda("CopyPageToDevice");
+void EllpackPageImpl::CopyToDeviceAsync(int device, EllpackInfo info,
+                                        const EllpackPageImpl& host_page,
+                                        dh::PinnedMemory* staging, cudaStream_t stream) {
   dh::safe_cuda(cudaSetDevice(device));
+  size_t n_bytes = host_page.idx_buffer.size();
+  CHECK_NE(n_bytes, 0);
+  if (device_storage_.size() < n_bytes) {
+    // Freeing device memory synchronises the device, so the old buffer is no longer in use.
+    ba_.Clear();
+    ba_.Allocate(device, &device_storage_, n_bytes);
+  }
+  gidx_buffer = device_storage_.subspan(0, n_bytes);
 
-  gidx_buffer = {};
-  ba_.Allocate(device, &gidx_buffer, idx_buffer.size());
-  dh::CopyVectorToDeviceSpan(gidx_buffer, idx_buffer);
+  auto h_staging = staging->GetSpan<common::CompressedByteT>(n_bytes);
+  std::copy(host_page.idx_buffer.cbegin(), host_page.idx_buffer.cend(), h_staging.begin());
+  dh::safe_cuda(cudaMemcpyAsync(gidx_buffer.data(), h_staging.data(), n_bytes,
+                                cudaMemcpyHostToDevice, stream));
 
   matrix.info = info;
-  matrix.gidx_iter = common::CompressedIterator<uint32_t>(gidx_buffer.data(), info.n_bins + 1);
-
-  monitor_.StopCuda("CopyPageToDevice");
-
-  device_initialized_ = true;
+  matrix.n_rows = host_page.matrix.n_rows;
+  matrix.base_rowid = host_page.matrix.base_rowid;
+  matrix.gidx_iter = common::CompressedIterator<uint32_t>(gidx_buffer.data(), info.NumSymbols());
 }
 }  // namespace xgboost
@@ -7,6 +7,8 @@
 
 #include <xgboost/data.h>
 
+#include <algorithm>
+
 #include "../common/compressed_iterator.h"
 #include "../common/device_helpers.cuh"
 #include "../common/hist_util.h"
@@ -48,6 +50,11 @@ struct EllpackInfo {
   size_t row_stride;
   /*! \brief Total number of bins, also used as the null index value, . */
   size_t n_bins;
+  /*!
+   * \brief Largest number of bins of a single feature.  Dense matrices store bin indices
+   *        local to each feature, so their symbols only need to cover this range.
+   */
+  size_t max_feature_bins {0};
   /*! \brief Minimum value for each feature. Size equals to number of features. */
   common::Span<bst_float> min_fvalue;
   /*! \brief Histogram cut pointers. Size equals to (number of features + 1). */
@@ -72,9 +79,13 @@ struct EllpackInfo {
                        const common::HistogramCuts& hmat,
                        dh::BulkAllocator* ba);
 
-  /*! \brief Return the total number of symbols (total number of bins plus 1 for not found). */
+  /*!
+   * \brief Return the total number of symbols.  For sparse matrices this is the total number
+   *        of bins plus 1 for not found, dense matrices use feature local bins without a null
+   *        value.
+   */
   size_t NumSymbols() const {
-    return n_bins + 1;
+    return is_dense ? std::max(max_feature_bins, static_cast<size_t>(1)) : n_bins + 1;
   }
   size_t NumFeatures() const {
     return min_fvalue.size();
@@ -98,7 +109,7 @@ struct EllpackMatrix {
     auto row_end = row_begin + info.row_stride;
     auto gidx = -1;
     if (info.is_dense) {
-      gidx = gidx_iter[row_begin + fidx];
+      gidx = gidx_iter[row_begin + fidx] + info.feature_segments[fidx];
     } else {
       gidx = BinarySearchRow(row_begin,
                              row_end,
@@ -158,7 +169,12 @@ struct RowStateOnDevice {
 // to begin processing on each device
 class DeviceHistogramBuilderState {
  public:
-  explicit DeviceHistogramBuilderState(size_t n_rows) : device_row_state_(n_rows) {}
+  /*!
+   * \param n_rows     Number of rows assigned to this device.
+   * \param row_begin  Global index of the first row assigned to this device.
+   */
+  explicit DeviceHistogramBuilderState(size_t n_rows, size_t row_begin = 0)
+      : device_row_state_(n_rows), row_begin_(row_begin) {}
 
   const RowStateOnDevice& GetRowStateOnDevice() const {
     return device_row_state_;
@@ -166,35 +182,37 @@ class DeviceHistogramBuilderState {
 
   // This method is invoked at the beginning of each sparse page batch. This distributes
   // the rows in the sparse page to the device.
-  // TODO(sriramch): Think of a way to utilize *all* the GPUs to build the compressed bins.
   void BeginBatch(const SparsePage &batch) {
-    size_t rem_rows = batch.Size();
-    size_t row_offset_in_current_batch = 0;
+    batch_size_ = batch.Size();
+    // Global range of rows still to be processed by this device
+    size_t device_begin = row_begin_ + device_row_state_.total_rows_processed;
+    size_t device_end = row_begin_ + device_row_state_.total_rows_assigned_to_device;
+    size_t overlap_begin = std::max(device_begin, batch_begin_);
+    size_t overlap_end = std::min(device_end, batch_begin_ + batch_size_);
 
     // Do we have anymore left to process from this batch on this device?
-    if (device_row_state_.total_rows_assigned_to_device > device_row_state_.total_rows_processed) {
-      // There are still some rows that needs to be assigned to this device
-      device_row_state_.rows_to_process_from_batch =
-          std::min(
-              device_row_state_.total_rows_assigned_to_device - device_row_state_.total_rows_processed,
-              rem_rows);
+    if (overlap_end > overlap_begin) {
+      device_row_state_.rows_to_process_from_batch = overlap_end - overlap_begin;
+      device_row_state_.row_offset_in_current_batch = overlap_begin - batch_begin_;
     } else {
-      // All rows have been assigned to this device
+      // No rows of this batch are assigned to this device
       device_row_state_.rows_to_process_from_batch = 0;
+      device_row_state_.row_offset_in_current_batch = 0;
     }
-
-    device_row_state_.row_offset_in_current_batch = row_offset_in_current_batch;
-    row_offset_in_current_batch += device_row_state_.rows_to_process_from_batch;
-    rem_rows -= device_row_state_.rows_to_process_from_batch;
   }
 
   // This method is invoked after completion of each sparse page batch
   void EndBatch() {
     device_row_state_.Advance();
+    batch_begin_ += batch_size_;
   }
 
  private:
   RowStateOnDevice device_row_state_{0};
+  size_t row_begin_ {0};
+  /*! \brief Global index of the first row in the current batch. */
+  size_t batch_begin_ {0};
+  size_t batch_size_ {0};
 };
 
 class EllpackPageImpl {
@@ -228,6 +246,22 @@ class EllpackPageImpl {
    */
   explicit EllpackPageImpl(DMatrix* dmat, const BatchParam& parm);
 
+  /*!
+   * \brief Constructor from a range of rows in an existing DMatrix.
+   *
+   * This is used when rows are sharded over several GPUs. The cuts are computed once and
+   * shared by all shards.
+   *
+   * @param device The GPU device to use.
+   * @param dmat The DMatrix in CSR format.
+   * @param hmat The histogram cuts of all the features.
+   * @param row_stride The number of features between starts of consecutive rows.
+   * @param row_begin The first row of the shard.
+   * @param row_end One past the last row of the shard.
+   */
+  EllpackPageImpl(int device, DMatrix* dmat, const common::HistogramCuts& hmat,
+                  size_t row_stride, size_t row_begin, size_t row_end);
+
   /*! \brief Copy the elements of the given ELLPACK page into this page.
    *
    * @param device The GPU device to use.
@@ -285,6 +319,9 @@ class EllpackPageImpl {
     matrix.base_rowid = row_id;
   }
 
+  /*! \brief The cuts the page is quantized with, empty for pages read from disk. */
+  common::HistogramCuts const& Cuts() const { return cuts_; }
+
   /*! \brief clear the page. */
   void Clear();
 
@@ -298,12 +335,20 @@ class EllpackPageImpl {
   size_t MemCostBytes() const;
 
   /*!
-   * \brief Copy the ELLPACK matrix to GPU.
+   * \brief Copy the ELLPACK matrix of a page read from disk to GPU asynchronously.
+   *
+   * The compressed buffer is staged in pinned host memory and copied on the given stream. The
+   * device buffer is reused across pages and only grows. The staging buffer must not be reused
+   * and this page must not be read before the copy on `stream` has completed.
    *
    * @param device The GPU device to use.
    * @param info The EllpackInfo for the matrix.
+   * @param host_page The page holding the compressed buffer on host.
+   * @param staging Pinned host memory used for the transfer.
+   * @param stream The stream on which the copy is issued.
    */
-  void InitDevice(int device, EllpackInfo info);
+  void CopyToDeviceAsync(int device, EllpackInfo info, const EllpackPageImpl& host_page,
+                         dh::PinnedMemory* staging, cudaStream_t stream);
 
   /*! \brief Compress the accumulated SparsePage into ELLPACK format.
    *
@@ -314,8 +359,10 @@ class EllpackPageImpl {
  private:
   common::Monitor monitor_;
   dh::BulkAllocator ba_;
-  bool device_initialized_{false};
+  /*! \brief Device storage backing gidx_buffer for pages copied from disk. */
+  common::Span<common::CompressedByteT> device_storage_;
   SparsePage sparse_page_{};
+  common::HistogramCuts cuts_;
 };
 
 }  // namespace xgboost
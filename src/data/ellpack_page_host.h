@@ -0,0 +1,79 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ * \file ellpack_page_host.h
+ * \brief ELLPACK pages of CPU builds, the CUDA build uses the device pages of
+ *  ellpack_page.cuh instead.
+ */
+#ifndef XGBOOST_DATA_ELLPACK_PAGE_HOST_H_
+#define XGBOOST_DATA_ELLPACK_PAGE_HOST_H_
+
+#if !defined(XGBOOST_USE_CUDA)
+
+#include <xgboost/data.h>
+
+#include <vector>
+
+#include "../common/compressed_iterator.h"
+#include "../common/hist_util.h"
+
+namespace xgboost {
+/*!
+ * \brief An ELLPACK matrix held in host memory, in the same layout as the device page:
+ *  every row takes `RowStride()' bit packed symbols.  Dense matrices store the bin local
+ *  to each feature at the position of the feature, sparse matrices store the global bins
+ *  of a row in ascending order followed by `NullValue()'.
+ */
+class EllpackPageImpl {
+ public:
+  /*! \brief global index of histogram, stored in ELLPACK format. */
+  std::vector<common::CompressedByteT> idx_buffer;
+
+  EllpackPageImpl() = default;
+  /*! \brief Sketch and quantize all rows of dmat. */
+  EllpackPageImpl(DMatrix* dmat, const BatchParam& param);
+  /*! \brief Quantize all rows of dmat with existing cuts. */
+  EllpackPageImpl(DMatrix* dmat, common::HistogramCuts cuts, size_t row_stride);
+
+  /*! \return Number of instances in the page. */
+  size_t Size() const { return n_rows_; }
+  void SetBaseRowId(size_t row_id) { base_rowid_ = row_id; }
+  size_t BaseRowId() const { return base_rowid_; }
+  bool IsDense() const { return is_dense_; }
+  /*! \brief Number of symbols between the starts of consecutive rows. */
+  size_t RowStride() const { return row_stride_; }
+  /*! \brief Bin of missing values, the total number of bins. */
+  uint32_t NullValue() const { return cuts_.TotalBins(); }
+  /*!
+   * \brief Number of symbols the buffer is packed with, feature local bins for dense
+   *  matrices, all bins and the null value for sparse ones.
+   */
+  size_t NumSymbols() const;
+  common::HistogramCuts const& Cuts() const { return cuts_; }
+
+  /*!
+   * \brief Unpack the global bins of rows [begin, end) into out, `RowStride()' bins for
+   *  every row with `NullValue()' for padding.
+   */
+  void GetRowBins(size_t begin, size_t end, uint32_t* out) const;
+  /*!
+   * \brief Build the quantized matrix of the CPU hist updater from the bins of this page,
+   *  without searching the cuts again.
+   */
+  void ToGHistIndex(common::GHistIndexMatrix* out) const;
+
+  /*! \return Memory cost of the compressed bins. */
+  size_t MemCostBytes() const { return idx_buffer.size(); }
+
+ private:
+  void Compress(DMatrix* dmat);
+
+  common::HistogramCuts cuts_;
+  bool is_dense_ {false};
+  size_t row_stride_ {0};
+  size_t n_rows_ {0};
+  size_t base_rowid_ {0};
+};
+}  // namespace xgboost
+
+#endif  // !defined(XGBOOST_USE_CUDA)
+#endif  // XGBOOST_DATA_ELLPACK_PAGE_HOST_H_
@@ -25,7 +25,7 @@ class EllpackPageSourceImpl : public DataSource<EllpackPage> {
                                  const BatchParam& param) noexcept(false);
 
   /*! \brief destructor */
-  ~EllpackPageSourceImpl() override = default;
+  ~EllpackPageSourceImpl() override;
 
   void BeforeFirst() override;
   bool Next() override;
@@ -35,6 +35,14 @@ class EllpackPageSourceImpl : public DataSource<EllpackPage> {
  private:
   /*! \brief Write Ellpack pages after accumulating them in memory. */
   void WriteEllpackPages(DMatrix* dmat, const std::string& cache_info) const;
+  /*! \brief Read the next page from disk and start copying it into the given buffer. */
+  void Prefetch(size_t buffer);
+  /*! \brief Mark the device buffer of the current page as free once queued work is done. */
+  void ReleaseCurrent();
+
+  /*! \brief Number of device pages, one being processed while the next one is copied. */
+  static constexpr size_t kNumBuffers = 2;
+  static constexpr size_t kNoPage = kNumBuffers;
 
   /*! \brief The page type string for ELLPACK. */
   const std::string kPageType_{".ellpack.page"};
@@ -47,8 +55,24 @@ class EllpackPageSourceImpl : public DataSource<EllpackPage> {
   EllpackInfo ellpack_info_;
   std::unique_ptr<ExternalMemoryPrefetcher<EllpackPage>> source_;
   std::string cache_info_;
+
+  /*! \brief Device resident pages handed out by `Value()`. */
+  EllpackPage pages_[kNumBuffers];
+  /*! \brief Pinned staging buffers for the host to device copies. */
+  dh::PinnedMemory staging_[kNumBuffers];
+  /*! \brief Recorded when a buffer has been copied to the device. */
+  cudaEvent_t copied_[kNumBuffers];
+  /*! \brief Recorded when a buffer is no longer used by the consumer. */
+  cudaEvent_t released_[kNumBuffers];
+  cudaStream_t copy_stream_{nullptr};
+  size_t current_{kNoPage};
+  size_t next_{0};
+  bool has_next_{false};
 };
 
+constexpr size_t EllpackPageSourceImpl::kNumBuffers;
+constexpr size_t EllpackPageSourceImpl::kNoPage;
+
 EllpackPageSource::EllpackPageSource(DMatrix* dmat,
                                      const std::string& cache_info,
                                      const BatchParam& param) noexcept(false)
@@ -81,7 +105,7 @@ EllpackPageSourceImpl::EllpackPageSourceImpl(DMatrix* dmat,
     page_size_ = param.gpu_page_size;
   }
 
-  monitor_.Init("ellpack_page_source");
+  monitor_.Init("ellpack_page_source", common::NvtxCategory::kData);
   dh::safe_cuda(cudaSetDevice(device_));
 
   monitor_.StartCuda("Quantiles");
@@ -98,30 +122,91 @@ EllpackPageSourceImpl::EllpackPageSourceImpl(DMatrix* dmat,
   WriteEllpackPages(dmat, cache_info);
   monitor_.StopCuda("WriteEllpackPages");
 
+  // Copies run on a non-blocking stream so that they overlap with the work
+  // queued on the default stream.
+  dh::safe_cuda(cudaStreamCreateWithFlags(&copy_stream_, cudaStreamNonBlocking));
+  for (size_t i = 0; i < kNumBuffers; ++i) {
+    dh::safe_cuda(cudaEventCreateWithFlags(&copied_[i], cudaEventDisableTiming));
+    dh::safe_cuda(cudaEventCreateWithFlags(&released_[i], cudaEventDisableTiming));
+  }
+
   source_.reset(new ExternalMemoryPrefetcher<EllpackPage>(
       ParseCacheInfo(cache_info_, kPageType_)));
 }
 
+EllpackPageSourceImpl::~EllpackPageSourceImpl() {
+  dh::safe_cuda(cudaSetDevice(device_));
+  dh::safe_cuda(cudaStreamSynchronize(copy_stream_));
+  for (size_t i = 0; i < kNumBuffers; ++i) {
+    dh::safe_cuda(cudaEventDestroy(copied_[i]));
+    dh::safe_cuda(cudaEventDestroy(released_[i]));
+  }
+  dh::safe_cuda(cudaStreamDestroy(copy_stream_));
+}
+
 void EllpackPageSourceImpl::BeforeFirst() {
+  dh::safe_cuda(cudaSetDevice(device_));
+  this->ReleaseCurrent();
+  // Pending copies still read from the staging buffers.
+  dh::safe_cuda(cudaStreamSynchronize(copy_stream_));
   source_.reset(new ExternalMemoryPrefetcher<EllpackPage>(
       ParseCacheInfo(cache_info_, kPageType_)));
   source_->BeforeFirst();
+  next_ = 0;
+  this->Prefetch(next_);
 }
 
+// Hand out the page that was prefetched by the previous call, then start
+// copying the one after it while the current page is being processed.
 bool EllpackPageSourceImpl::Next() {
-  return source_->Next();
+  dh::safe_cuda(cudaSetDevice(device_));
+  this->ReleaseCurrent();
+  if (!has_next_) {
+    return false;
+  }
+  current_ = next_;
+  monitor_.StartCuda("WaitForPage");
+  dh::safe_cuda(cudaEventSynchronize(copied_[current_]));
+  monitor_.StopCuda("WaitForPage");
+  next_ = (current_ + 1) % kNumBuffers;
+  this->Prefetch(next_);
+  return true;
+}
+
+void EllpackPageSourceImpl::Prefetch(size_t buffer) {
+  has_next_ = source_->Next();
+  if (!has_next_) {
+    return;
+  }
+  monitor_.StartCuda("CopyPageToDevice");
+  // The staging buffer may still be the source of the copy issued two pages ago.
+  dh::safe_cuda(cudaEventSynchronize(copied_[buffer]));
+  // The device buffer may still be read by work queued for an earlier page.
+  dh::safe_cuda(cudaStreamWaitEvent(copy_stream_, released_[buffer], 0));
+  pages_[buffer].Impl()->CopyToDeviceAsync(device_, ellpack_info_, *source_->Value().Impl(),
+                                           &staging_[buffer], copy_stream_);
+  dh::safe_cuda(cudaEventRecord(copied_[buffer], copy_stream_));
+  monitor_.StopCuda("CopyPageToDevice");
+}
+
+void EllpackPageSourceImpl::ReleaseCurrent() {
+  if (current_ == kNoPage) {
+    return;
+  }
+  // The legacy default stream waits for all blocking streams, so this covers
+  // everything the consumer has queued so far.
+  dh::safe_cuda(cudaEventRecord(released_[current_], nullptr));
+  current_ = kNoPage;
 }
 
 EllpackPage& EllpackPageSourceImpl::Value() {
-  EllpackPage& page = source_->Value();
-  page.Impl()->InitDevice(device_, ellpack_info_);
-  return page;
+  CHECK_NE(current_, kNoPage);
+  return pages_[current_];
 }
 
 const EllpackPage& EllpackPageSourceImpl::Value() const {
-  EllpackPage& page = source_->Value();
-  page.Impl()->InitDevice(device_, ellpack_info_);
-  return page;
+  CHECK_NE(current_, kNoPage);
+  return pages_[current_];
 }
 
 // Compress each CSR page to ELLPACK, and write the accumulated pages to disk.
@@ -0,0 +1,54 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file fold_dmatrix.cc
+ */
+#include "./fold_dmatrix.h"
+
+#include <utility>
+
+namespace xgboost {
+namespace data {
+FoldDMatrix::FoldDMatrix(std::shared_ptr<DMatrix> parent, std::vector<int32_t> const& folds,
+                         int32_t fold, bool invert)
+    : parent_{std::move(parent)} {
+  auto const& parent_info = parent_->Info();
+  CHECK_EQ(folds.size(), parent_info.num_row_)
+      << "A fold is required for every row of the matrix.";
+  CHECK(parent_info.group_ptr_.empty()) << "Folds of ranking data are not supported.";
+  info_ = parent_info;
+  auto& weights = info_.weights_.HostVector();
+  if (weights.empty()) {
+    weights.resize(folds.size(), 1.0f);
+  }
+  for (size_t i = 0; i < folds.size(); ++i) {
+    bool const in_fold = (folds[i] == fold) != invert;
+    if (in_fold) {
+      ++n_fold_rows_;
+    } else {
+      weights[i] = 0.0f;
+    }
+  }
+}
+
+BatchSet<SparsePage> FoldDMatrix::GetRowBatches() {
+  return parent_->GetBatches<SparsePage>();
+}
+
+BatchSet<CSCPage> FoldDMatrix::GetColumnBatches() {
+  return parent_->GetBatches<CSCPage>();
+}
+
+BatchSet<SortedCSCPage> FoldDMatrix::GetSortedColumnBatches() {
+  return parent_->GetBatches<SortedCSCPage>();
+}
+
+BatchSet<EllpackPage> FoldDMatrix::GetEllpackBatches(const BatchParam& param) {
+  return parent_->GetBatches<EllpackPage>(param);
+}
+
+BatchSet<common::GHistIndexMatrix> FoldDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  return parent_->GetBatches<common::GHistIndexMatrix>(param);
+}
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,74 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file fold_dmatrix.h
+ * \brief DMatrix taking a subset of the rows of another one through their weights.
+ */
+#ifndef XGBOOST_DATA_FOLD_DMATRIX_H_
+#define XGBOOST_DATA_FOLD_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief The rows of a fold of `parent', for cross validation.
+ *
+ *  Nothing is copied but the meta info: rows outside of the fold are kept with a zero
+ *  weight, so they contribute neither gradient to the trees nor error to the metrics.
+ *  Every batch, including the quantized pages, is the one of `parent', so all folds of
+ *  a matrix share a single sketch and index.  The pages are built by `parent' on the
+ *  first request, they must be built before folds are trained on several threads.
+ */
+class FoldDMatrix : public DMatrix {
+ public:
+  /*!
+   * \param parent matrix holding the rows, without query groups.
+   * \param folds  fold of every row of parent.
+   * \param fold   the fold taken.
+   * \param invert take the rows outside of the fold instead.
+   */
+  FoldDMatrix(std::shared_ptr<DMatrix> parent, std::vector<int32_t> const& folds,
+              int32_t fold, bool invert);
+
+  MetaInfo& Info() override { return info_; }
+  const MetaInfo& Info() const override { return info_; }
+
+  bool SingleColBlock() const override { return parent_->SingleColBlock(); }
+
+  common::HistogramCuts const* GHistIndexCuts(int32_t* max_bin) const override {
+    return parent_->GHistIndexCuts(max_bin);
+  }
+  bool SetGHistIndexCuts(common::HistogramCuts const& cuts, int32_t max_bin) override {
+    return parent_->SetGHistIndexCuts(cuts, max_bin);
+  }
+  common::GHistIndexMatrix const* GHistIndexPage(int32_t* max_bin) const override {
+    return parent_->GHistIndexPage(max_bin);
+  }
+  bool LoadGHistIndexPage(dmlc::Stream* fi, int32_t max_bin) override {
+    return parent_->LoadGHistIndexPage(fi, max_bin);
+  }
+
+  /*! \brief Number of rows in the fold, those with a weight. */
+  size_t NumFoldRows() const { return n_fold_rows_; }
+
+ private:
+  BatchSet<SparsePage> GetRowBatches() override;
+  BatchSet<CSCPage> GetColumnBatches() override;
+  BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
+  BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
+
+  bool EllpackExists() const override { return parent_->PageExists<EllpackPage>(); }
+  bool SparsePageExists() const override { return parent_->PageExists<SparsePage>(); }
+
+  std::shared_ptr<DMatrix> parent_;
+  MetaInfo info_;
+  size_t n_fold_rows_ {0};
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_FOLD_DMATRIX_H_
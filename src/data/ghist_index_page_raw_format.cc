@@ -0,0 +1,42 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ * \file ghist_index_page_raw_format.cc
+ *  Raw binary format of pages of the quantized matrix used by the CPU hist updater.
+ */
+#include <xgboost/data.h>
+#include <dmlc/registry.h>
+
+#include "./sparse_page_writer.h"
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(ghist_index_page_raw_format);
+
+class GHistIndexPageRawFormat : public SparsePageFormat<common::GHistIndexMatrix> {
+ public:
+  bool Read(common::GHistIndexMatrix* page, dmlc::SeekStream* fi) override {
+    return page->Load(fi);
+  }
+
+  bool Read(common::GHistIndexMatrix* page,
+            dmlc::SeekStream* fi,
+            const std::vector<bst_uint>& sorted_index_set) override {
+    // pages are stored by rows, all features are always loaded
+    return page->Load(fi);
+  }
+
+  void Write(const common::GHistIndexMatrix& page, dmlc::Stream* fo) override {
+    page.Save(fo);
+  }
+};
+
+XGBOOST_REGISTER_GHIST_INDEX_PAGE_FORMAT(raw)
+    .describe("Raw binary format of histogram index pages.")
+    .set_body([]() {
+      return new GHistIndexPageRawFormat();
+    });
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,85 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file ghist_index_page_source.h
+ * \brief External memory data source of the quantized matrix used by the CPU hist updater.
+ */
+#ifndef XGBOOST_DATA_GHIST_INDEX_PAGE_SOURCE_H_
+#define XGBOOST_DATA_GHIST_INDEX_PAGE_SOURCE_H_
+
+#include <xgboost/data.h>
+#include <dmlc/timer.h>
+
+#include <memory>
+#include <string>
+
+#include "sparse_page_source.h"
+#include "sparse_page_writer.h"
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace data {
+
+/*!
+ * \brief Quantizes each SparsePage batch of the source matrix into one page of
+ *  common::GHistIndexMatrix and caches the pages on disk next to the row pages.
+ *  All pages share the same histogram cuts, built once over the whole matrix.
+ */
+class GHistIndexPageSource {
+ public:
+  GHistIndexPageSource(DMatrix* src, const std::string& cache_info,
+                       const BatchParam& param, PageMemoryBudget* budget = nullptr) {
+    std::string page_type = ".gmat.page";
+    cache_info_ = ParseCacheInfo(cache_info, page_type);
+    for (auto file : cache_info_.name_shards) {
+      CheckCacheFileExists(file);
+    }
+
+    common::HistogramCuts cuts;
+    cuts.Build(src, param.max_bin);
+    const bool is_dense = src->IsDense();
+    {
+      SparsePageWriter<common::GHistIndexMatrix> writer(cache_info_.name_shards,
+                                                        cache_info_.format_shards, 6);
+      size_t bytes_write = 0;
+      double tstart = dmlc::GetTime();
+      for (auto& batch : src->GetBatches<SparsePage>()) {
+        std::shared_ptr<common::GHistIndexMatrix> page;
+        writer.Alloc(&page);
+        page->Init(batch, cuts, is_dense);
+        bytes_write += page->index.MemCostBytes() + page->row_ptr.size() * sizeof(size_t);
+        writer.PushWrite(std::move(page));
+        double tdiff = dmlc::GetTime() - tstart;
+        LOG(INFO) << "Writing to " << cache_info << " in "
+                  << ((bytes_write >> 20UL) / tdiff) << " MB/s, "
+                  << (bytes_write >> 20UL) << " written";
+      }
+      LOG(INFO) << "GHistIndexPageSource: Finished writing to "
+                << cache_info_.name_info;
+    }
+    page_cache_.reset(
+        new ExternalMemoryPageCache<common::GHistIndexMatrix>(cache_info_, budget));
+  }
+
+  ~GHistIndexPageSource() {
+    page_cache_.reset();
+    for (auto file : cache_info_.name_shards) {
+      TryDeleteCacheFile(file);
+    }
+  }
+
+  /*! \brief Thread safe, each batch set reads the pages with a cursor of its own. */
+  BatchSet<common::GHistIndexMatrix> GetBatchSet() {
+    auto begin_iter = BatchIterator<common::GHistIndexMatrix>(
+        new SparseBatchIteratorImpl<ExternalMemoryPrefetcher<common::GHistIndexMatrix>,
+                                    common::GHistIndexMatrix>(page_cache_->Acquire()));
+    return BatchSet<common::GHistIndexMatrix>(begin_iter);
+  }
+
+ private:
+  std::unique_ptr<ExternalMemoryPageCache<common::GHistIndexMatrix>> page_cache_;
+  CacheInfo cache_info_;
+};
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_GHIST_INDEX_PAGE_SOURCE_H_
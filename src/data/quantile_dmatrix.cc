@@ -0,0 +1,433 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file quantile_dmatrix.cc
+ */
+#include "./quantile_dmatrix.h"
+#include <xgboost/data.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "./simple_batch_iterator.h"
+#include "./simple_dmatrix.h"
+#include "../common/common.h"
+#include "../common/math.h"
+#include "../common/threading_utils.h"
+#include "adapter.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+inline bool IsValid(data::COOTuple const& e, float missing) {
+  return !common::CheckNAN(e.value) && e.value != missing;
+}
+
+/*!
+ * \brief Write the bins of rows [rbegin, rend) from a batch, p_pos holds the next
+ *  position of each row for every thread when the index is sparse.
+ */
+template <typename BinIdxType, typename AdapterBatchT>
+void SetAdapterIndexData(AdapterBatchT const& batch, float missing, size_t rbegin, size_t rend,
+                         HistogramCuts const& cut, uint32_t const* offsets,
+                         size_t const* row_ptr, std::vector<std::vector<size_t>>* p_pos,
+                         BinIdxType* index_data, size_t* hit_count_tloc, int32_t nthread) {
+  const uint32_t nbins = cut.Ptrs().back();
+  auto& thread_pos = *p_pos;
+#pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(batch.Size()); ++i) {  // NOLINT(*)
+    int tid = omp_get_thread_num();
+    auto line = batch.GetLine(i);
+    for (size_t j = 0; j < line.Size(); ++j) {
+      data::COOTuple element = line.GetElement(j);
+      if (!IsValid(element, missing)) {
+        continue;
+      }
+      auto const fid = static_cast<uint32_t>(element.column_idx);
+      uint32_t idx = cut.SearchBin(element.value, fid);
+      if (offsets != nullptr) {
+        // dense data: the local bin of feature `fid` is kept at position `fid` of the row
+        index_data[row_ptr[element.row_idx] + fid] =
+            static_cast<BinIdxType>(idx - offsets[fid]);
+      } else {
+        index_data[thread_pos[tid][element.row_idx - rbegin]++] =
+            static_cast<BinIdxType>(idx);
+      }
+      ++hit_count_tloc[tid * nbins + idx];
+    }
+  }
+  // Sparse rows are kept sorted, same as the ones built from a SparsePage.
+  if (offsets == nullptr) {
+#pragma omp parallel for schedule(static) num_threads(nthread)
+    for (omp_ulong r = rbegin; r < rend; ++r) {  // NOLINT(*)
+      std::sort(index_data + row_ptr[r], index_data + row_ptr[r + 1]);
+    }
+  }
+}
+}  // anonymous namespace
+
+template <typename AdapterBatchT>
+size_t GHistIndexMatrix::PushAdapterBatch(const AdapterBatchT& batch, size_t rbegin,
+                                          float missing) {
+  const int32_t nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.Ptrs().back();
+  const uint32_t* offsets = index.Offset();
+  const size_t nrows = Size();
+  CHECK_GT(cut.Values().size(), 0U);
+  // Lines are rows for most adapters but columns for the CSC ones, so a row can be
+  // spread over several threads.  Each thread writes its elements of a row after those
+  // of the threads before it, with the same static schedule in both scans.
+  std::vector<std::vector<size_t>> thread_pos(nthread);
+  std::vector<size_t> thread_end(nthread, rbegin);
+#pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(batch.Size()); ++i) {  // NOLINT(*)
+    int tid = omp_get_thread_num();
+    auto& pos = thread_pos[tid];
+    auto line = batch.GetLine(i);
+    for (size_t j = 0; j < line.Size(); ++j) {
+      data::COOTuple element = line.GetElement(j);
+      if (!IsValid(element, missing)) {
+        continue;
+      }
+      CHECK_GE(element.row_idx, rbegin);
+      CHECK_LT(element.row_idx, nrows);
+      CHECK_LT(element.column_idx, cut.Ptrs().size() - 1);
+      thread_end[tid] = std::max(thread_end[tid], element.row_idx + 1);
+      if (offsets == nullptr) {
+        size_t key = element.row_idx - rbegin;
+        if (pos.size() <= key) {
+          pos.resize(key + 1, 0);
+        }
+        ++pos[key];
+      }
+    }
+  }
+  size_t const rend = *std::max_element(thread_end.cbegin(), thread_end.cend());
+  if (offsets == nullptr) {
+#pragma omp parallel for schedule(static) num_threads(nthread)
+    for (omp_ulong r = rbegin; r < rend; ++r) {  // NOLINT(*)
+      size_t const key = r - rbegin;
+      size_t begin = row_ptr[r];
+      for (auto& pos : thread_pos) {
+        if (key < pos.size()) {
+          size_t const count = pos[key];
+          pos[key] = begin;
+          begin += count;
+        }
+      }
+      CHECK_EQ(begin, row_ptr[r + 1]) << "A row can not be split over batches.";
+    }
+  }
+
+  switch (index.GetBinTypeSize()) {
+    case kUint8BinsTypeSize:
+      SetAdapterIndexData(batch, missing, rbegin, rend, cut, offsets, row_ptr.data(),
+                          &thread_pos, index.data<uint8_t>(), hit_count_tloc_.data(), nthread);
+      break;
+    case kUint16BinsTypeSize:
+      SetAdapterIndexData(batch, missing, rbegin, rend, cut, offsets, row_ptr.data(),
+                          &thread_pos, index.data<uint16_t>(), hit_count_tloc_.data(), nthread);
+      break;
+    default:
+      CHECK_EQ(index.GetBinTypeSize(), kUint32BinsTypeSize);
+      SetAdapterIndexData(batch, missing, rbegin, rend, cut, offsets, row_ptr.data(),
+                          &thread_pos, index.data<uint32_t>(), hit_count_tloc_.data(), nthread);
+      break;
+  }
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (int32_t tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+      hit_count_tloc_[tid * nbins + idx] = 0;  // reset for next batch
+    }
+  }
+  return rend;
+}
+}  // namespace common
+
+namespace data {
+template <typename AdapterT>
+QuantileDMatrix::QuantileDMatrix(AdapterT* adapter, float missing, int nthread, int max_bin)
+    : max_bin_{max_bin} {
+  using WQSketch = common::CutsBuilder::WQSketch;
+  CHECK_GE(max_bin, 2);
+  // The sketch and the quantized index are built by helpers using the default number of
+  // threads, which is set for the calling thread only.
+  nthread = common::OmpGetNumThreads(nthread);
+  common::OmpThreadsScope threads {nthread};
+
+  // safe factor for better accuracy, same as `DenseCuts'
+  constexpr int kFactor = 8;
+  double const eps = 1.0 / (max_bin * kFactor);
+  std::vector<uint64_t> qids;
+  // number of valid elements in each row
+  std::vector<size_t> row_counts;
+  // Lines of each batch are split into the same number of contiguous blocks with their
+  // own sketches, which are sketched by blocks of columns as in `DenseCuts::Build'.
+  std::vector<std::vector<WQSketch>> sketchs;
+  size_t block_max_rows = 1;
+  uint64_t inferred_num_columns = 0;
+  auto grow_sketchs = [&](size_t ncol) {
+    for (auto& block : sketchs) {
+      size_t const n_before = block.size();
+      if (n_before >= ncol) {
+        continue;
+      }
+      block.resize(ncol);
+      for (size_t i = n_before; i < ncol; ++i) {
+        block[i].Init(block_max_rows, eps);
+      }
+    }
+  };
+
+  // First pass, meta info and sketch.
+  adapter->BeforeFirst();
+  while (adapter->Next()) {
+    auto& batch = adapter->Value();
+    // Append meta information if available
+    if (batch.Labels() != nullptr) {
+      auto& labels = info_.labels_.HostVector();
+      labels.insert(labels.end(), batch.Labels(), batch.Labels() + batch.Size());
+    }
+    if (batch.Weights() != nullptr) {
+      auto& weights = info_.weights_.HostVector();
+      weights.insert(weights.end(), batch.Weights(), batch.Weights() + batch.Size());
+    }
+    if (batch.BaseMargin() != nullptr) {
+      auto& base_margin = info_.base_margin_.HostVector();
+      base_margin.insert(base_margin.end(), batch.BaseMargin(),
+                         batch.BaseMargin() + batch.Size());
+    }
+    if (batch.Qid() != nullptr) {
+      qids.insert(qids.end(), batch.Qid(), batch.Qid() + batch.Size());
+    }
+
+    size_t const num_lines = batch.Size();
+    size_t const rbegin = row_counts.size();
+    std::vector<std::vector<size_t>> thread_counts(nthread);
+    std::vector<uint64_t> thread_columns(nthread, 0);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < static_cast<omp_ulong>(num_lines); ++i) {  // NOLINT(*)
+      int tid = omp_get_thread_num();
+      auto& counts = thread_counts[tid];
+      auto line = batch.GetLine(i);
+      for (size_t j = 0; j < line.Size(); ++j) {
+        COOTuple element = line.GetElement(j);
+        thread_columns[tid] = std::max(thread_columns[tid],
+                                       static_cast<uint64_t>(element.column_idx + 1));
+        if (!common::CheckNAN(element.value) && element.value != missing) {
+          // Adapter row index is absolute, same as for `SparsePage::Push'.
+          CHECK_GE(element.row_idx, rbegin);
+          size_t key = element.row_idx - rbegin;
+          if (counts.size() <= key) {
+            counts.resize(key + 1, 0);
+          }
+          ++counts[key];
+        }
+      }
+    }
+    size_t batch_rows = 0;
+    for (auto const& counts : thread_counts) {
+      batch_rows = std::max(batch_rows, counts.size());
+    }
+    row_counts.resize(rbegin + batch_rows, 0);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong r = 0; r < static_cast<omp_ulong>(batch_rows); ++r) {  // NOLINT(*)
+      for (auto const& counts : thread_counts) {
+        if (r < counts.size()) {
+          row_counts[rbegin + r] += counts[r];
+        }
+      }
+    }
+    inferred_num_columns = std::max(
+        inferred_num_columns,
+        *std::max_element(thread_columns.cbegin(), thread_columns.cend()));
+
+    if (sketchs.empty()) {
+      // Without the number of rows from the adapter the sketches are sized by the first
+      // batch.
+      size_t const nrows =
+          adapter->NumRows() == kAdapterUnknownSize ? batch_rows : adapter->NumRows();
+      size_t const n_row_blocks =
+          common::DenseCuts::RowBlocks(nthread, inferred_num_columns, num_lines);
+      block_max_rows = std::max<size_t>(common::DivRoundUp(nrows, n_row_blocks), 1);
+      sketchs.resize(n_row_blocks);
+    }
+    grow_sketchs(inferred_num_columns);
+
+    size_t const n_row_blocks = sketchs.size();
+    auto const ncol = static_cast<unsigned>(inferred_num_columns);
+    size_t const n_col_blocks =
+        std::max<size_t>(std::min<size_t>(common::DivRoundUp(nthread, n_row_blocks), ncol), 1);
+    unsigned const nstep = static_cast<unsigned>(common::DivRoundUp(ncol, n_col_blocks));
+    size_t const lstep = common::DivRoundUp(num_lines, n_row_blocks);
+    size_t const n_tasks = n_row_blocks * n_col_blocks;
+    auto const& weights = info_.weights_.ConstHostVector();
+#pragma omp parallel for schedule(dynamic)
+    for (omp_ulong task = 0; task < n_tasks; ++task) {  // NOLINT(*)
+      size_t const rblock = task / n_col_blocks;
+      size_t const cblock = task % n_col_blocks;
+      size_t const lbegin = std::min(lstep * rblock, num_lines);
+      size_t const lend = std::min(lstep * (rblock + 1), num_lines);
+      unsigned const begin = std::min(static_cast<unsigned>(nstep * cblock), ncol);
+      unsigned const end = std::min(static_cast<unsigned>(nstep * (cblock + 1)), ncol);
+      if (lbegin >= lend || begin >= end) {
+        continue;
+      }
+      std::vector<WQSketch>& block_sketchs = sketchs[rblock];
+      for (size_t i = lbegin; i < lend; ++i) {
+        auto line = batch.GetLine(i);
+        for (size_t j = 0; j < line.Size(); ++j) {
+          COOTuple element = line.GetElement(j);
+          if (element.column_idx >= begin && element.column_idx < end &&
+              !common::CheckNAN(element.value) && element.value != missing) {
+            float w = element.row_idx < weights.size() ? weights[element.row_idx] : 1.0f;
+            block_sketchs[element.column_idx].Push(element.value, w);
+          }
+        }
+      }
+    }
+  }
+  GroupPtrFromQid(qids, &info_.group_ptr_);
+
+  if (adapter->NumColumns() == kAdapterUnknownSize) {
+    info_.num_col_ = inferred_num_columns;
+  } else {
+    info_.num_col_ = adapter->NumColumns();
+  }
+  // Synchronise worker columns
+  rabit::Allreduce<rabit::op::Max>(&info_.num_col_, 1);
+  if (adapter->NumRows() == kAdapterUnknownSize) {
+    info_.num_row_ = row_counts.size();
+  } else {
+    CHECK_LE(row_counts.size(), adapter->NumRows());
+    info_.num_row_ = adapter->NumRows();
+  }
+  row_counts.resize(info_.num_row_, 0);
+
+  if (sketchs.empty()) {
+    sketchs.resize(1);
+  }
+  grow_sketchs(info_.num_col_);
+  std::vector<WQSketch::SummaryContainer> summaries;
+  common::DenseCuts::MergeBlocks(&sketchs, &summaries);
+  sketchs.clear();
+  common::HistogramCuts cuts;
+  common::DenseCuts(&cuts).Init(&summaries, max_bin, info_.num_row_);
+  summaries.clear();
+
+  std::vector<size_t> row_ptr(info_.num_row_ + 1, 0);
+  for (size_t i = 0; i < row_counts.size(); ++i) {
+    row_ptr[i + 1] = row_ptr[i] + row_counts[i];
+  }
+  row_counts.clear();
+  row_counts.shrink_to_fit();
+  info_.num_nonzero_ = row_ptr.back();
+  gmat_.InitStorage(cuts, std::move(row_ptr), this->IsDense());
+
+  // Second pass, quantize into the index.
+  size_t rbegin = 0;
+  adapter->BeforeFirst();
+  while (adapter->Next()) {
+    rbegin = gmat_.PushAdapterBatch(adapter->Value(), rbegin, missing);
+  }
+}
+
+SparsePage const& QuantileDMatrix::RecoveredPage() {
+  if (sparse_page_) {
+    return *sparse_page_;
+  }
+  sparse_page_.reset(new SparsePage());
+  auto const& ptrs = gmat_.cut.Ptrs();
+  auto const& values = gmat_.cut.Values();
+  auto const& mins = gmat_.cut.MinValues();
+  auto& offset_vec = sparse_page_->offset.HostVector();
+  auto& data_vec = sparse_page_->data.HostVector();
+  offset_vec.assign(gmat_.row_ptr.cbegin(), gmat_.row_ptr.cend());
+  data_vec.resize(gmat_.row_ptr.back());
+  uint32_t const* offsets = gmat_.index.Offset();
+  size_t const nfeatures = ptrs.size() - 1;
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(data_vec.size()); ++i) {  // NOLINT(*)
+    uint32_t const bin = gmat_.index[i];
+    bst_feature_t fid;
+    if (offsets != nullptr) {
+      fid = static_cast<bst_feature_t>(i % nfeatures);
+    } else {
+      fid = static_cast<bst_feature_t>(
+          std::upper_bound(ptrs.cbegin(), ptrs.cend(), bin) - ptrs.cbegin() - 1);
+    }
+    // The lower bound of a bin falls into the same bin, hence takes the same branch as
+    // any value of that bin for splits on these cuts.
+    float const value = bin == ptrs[fid] ? mins[fid] : values[bin - 1];
+    data_vec[i] = Entry(fid, value);
+  }
+  return *sparse_page_;
+}
+
+BatchSet<SparsePage> QuantileDMatrix::GetRowBatches() {
+  auto begin_iter = BatchIterator<SparsePage>(new SimpleBatchIteratorImpl<SparsePage>(
+      const_cast<SparsePage*>(&RecoveredPage())));
+  return BatchSet<SparsePage>(begin_iter);
+}
+
+BatchSet<CSCPage> QuantileDMatrix::GetColumnBatches() {
+  if (!column_page_) {
+    column_page_.reset(new CSCPage(RecoveredPage().GetTranspose(info_.num_col_)));
+  }
+  auto begin_iter =
+      BatchIterator<CSCPage>(new SimpleBatchIteratorImpl<CSCPage>(column_page_.get()));
+  return BatchSet<CSCPage>(begin_iter);
+}
+
+BatchSet<SortedCSCPage> QuantileDMatrix::GetSortedColumnBatches() {
+  if (!sorted_column_page_) {
+    sorted_column_page_.reset(
+        new SortedCSCPage(RecoveredPage().GetTranspose(info_.num_col_)));
+    sorted_column_page_->SortRows();
+  }
+  auto begin_iter = BatchIterator<SortedCSCPage>(
+      new SimpleBatchIteratorImpl<SortedCSCPage>(sorted_column_page_.get()));
+  return BatchSet<SortedCSCPage>(begin_iter);
+}
+
+BatchSet<EllpackPage> QuantileDMatrix::GetEllpackBatches(const BatchParam& param) {
+  // Sketched again on device from the recovered rows.
+  if (!ellpack_page_ || (batch_param_ != param && param != BatchParam{})) {
+    CHECK_GE(param.gpu_id, 0);
+    CHECK_GE(param.max_bin, 2);
+    ellpack_page_.reset(new EllpackPage(this, param));
+    batch_param_ = param;
+  }
+  auto begin_iter =
+      BatchIterator<EllpackPage>(new SimpleBatchIteratorImpl<EllpackPage>(ellpack_page_.get()));
+  return BatchSet<EllpackPage>(begin_iter);
+}
+
+BatchSet<common::GHistIndexMatrix> QuantileDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  CHECK_EQ(param.max_bin, max_bin_)
+      << "The quantile DMatrix is quantized with max_bin=" << max_bin_
+      << ", it can't be used for training with a different max_bin.";
+  auto begin_iter = BatchIterator<common::GHistIndexMatrix>(
+      new SimpleBatchIteratorImpl<common::GHistIndexMatrix>(&gmat_));
+  return BatchSet<common::GHistIndexMatrix>(begin_iter);
+}
+
+template QuantileDMatrix::QuantileDMatrix(DenseAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(CSRAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(CSCAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(DataTableAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(FileAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(DMatrixSliceAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+template QuantileDMatrix::QuantileDMatrix(IteratorAdapter* adapter, float missing,
+                                          int nthread, int max_bin);
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,67 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file quantile_dmatrix.h
+ * \brief In-memory DMatrix holding only the quantized data used by the hist method.
+ */
+#ifndef XGBOOST_DATA_QUANTILE_DMATRIX_H_
+#define XGBOOST_DATA_QUANTILE_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+
+#include <memory>
+
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief A DMatrix built straight from an adapter into the histogram index.
+ *
+ *  The adapter is read twice, once for the meta info and the quantile sketch, then
+ *  again to quantize the values into the index.  No CSR page of the input is kept, so
+ *  the memory is that of the bin indices plus the sketch.  When rows are requested, a
+ *  page is recovered from the bins using the lower bound of each bin as value, which
+ *  goes down the same branches as the input for trees grown on these cuts.
+ */
+class QuantileDMatrix : public DMatrix {
+ public:
+  template <typename AdapterT>
+  QuantileDMatrix(AdapterT* adapter, float missing, int nthread, int max_bin);
+
+  MetaInfo& Info() override { return info_; }
+  const MetaInfo& Info() const override { return info_; }
+
+  bool SingleColBlock() const override { return true; }
+
+  int MaxBin() const { return max_bin_; }
+
+ private:
+  BatchSet<SparsePage> GetRowBatches() override;
+  BatchSet<CSCPage> GetColumnBatches() override;
+  BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
+  BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
+
+  /*! \brief Build the row page from the bins, only done on request. */
+  SparsePage const& RecoveredPage();
+
+  MetaInfo info_;
+  int max_bin_;
+  common::GHistIndexMatrix gmat_;
+  std::unique_ptr<SparsePage> sparse_page_;
+  std::unique_ptr<CSCPage> column_page_;
+  std::unique_ptr<SortedCSCPage> sorted_column_page_;
+  std::unique_ptr<EllpackPage> ellpack_page_;
+  BatchParam batch_param_;
+
+  bool EllpackExists() const override {
+    return static_cast<bool>(ellpack_page_);
+  }
+  bool SparsePageExists() const override {
+    return static_cast<bool>(sparse_page_);
+  }
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_QUANTILE_DMATRIX_H_
@@ -6,16 +6,40 @@
  */
 #include "./simple_dmatrix.h"
 #include <xgboost/data.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
 #include "./simple_batch_iterator.h"
+#include "./ellpack_page_host.h"
+#include "../common/io.h"
 #include "../common/random.h"
 #include "adapter.h"
 
 namespace xgboost {
 namespace data {
+const int SimpleDMatrix::kAlignedMagic;
+
 MetaInfo& SimpleDMatrix::Info() { return info; }
 
 const MetaInfo& SimpleDMatrix::Info() const { return info; }
 
+void SimpleDMatrix::TrackPages() {
+  size_t bytes = sparse_page_.MemCostBytes();
+  if (column_page_) {
+    bytes += column_page_->MemCostBytes();
+  }
+  if (sorted_column_page_) {
+    bytes += sorted_column_page_->MemCostBytes();
+  }
+  tracked_pages_.Set(bytes);
+}
+
 BatchSet<SparsePage> SimpleDMatrix::GetRowBatches() {
   // since csr is the default data structure so `source_` is always available.
   auto begin_iter = BatchIterator<SparsePage>(
@@ -27,6 +51,7 @@ BatchSet<CSCPage> SimpleDMatrix::GetColumnBatches() {
   // column page doesn't exist, generate it
   if (!column_page_) {
     column_page_.reset(new CSCPage(sparse_page_.GetTranspose(info.num_col_)));
+    this->TrackPages();
   }
   auto begin_iter =
       BatchIterator<CSCPage>(new SimpleBatchIteratorImpl<CSCPage>(column_page_.get()));
@@ -39,6 +64,7 @@ BatchSet<SortedCSCPage> SimpleDMatrix::GetSortedColumnBatches() {
     sorted_column_page_.reset(
         new SortedCSCPage(sparse_page_.GetTranspose(info.num_col_)));
     sorted_column_page_->SortRows();
+    this->TrackPages();
   }
   auto begin_iter = BatchIterator<SortedCSCPage>(
       new SimpleBatchIteratorImpl<SortedCSCPage>(sorted_column_page_.get()));
@@ -51,7 +77,9 @@ BatchSet<EllpackPage> SimpleDMatrix::GetEllpackBatches(const BatchParam& param)
     CHECK(param != BatchParam{}) << "Batch parameter is not initialized.";
   }
   if (!ellpack_page_  || (batch_param_ != param && param != BatchParam{})) {
+#if defined(XGBOOST_USE_CUDA)
     CHECK_GE(param.gpu_id, 0);
+#endif  // defined(XGBOOST_USE_CUDA)
     CHECK_GE(param.max_bin, 2);
     ellpack_page_.reset(new EllpackPage(this, param));
     batch_param_ = param;
@@ -61,21 +89,109 @@ BatchSet<EllpackPage> SimpleDMatrix::GetEllpackBatches(const BatchParam& param)
   return BatchSet<EllpackPage>(begin_iter);
 }
 
-template <typename AdapterT>
-SimpleDMatrix::SimpleDMatrix(AdapterT* adapter, float missing, int nthread) {
-  // Set number of threads but keep old value so we can reset it after
-  const int nthreadmax = omp_get_max_threads();
-  if (nthread <= 0) nthread = nthreadmax;
-  int nthread_original = omp_get_max_threads();
-  omp_set_num_threads(nthread);
+BatchSet<common::GHistIndexMatrix> SimpleDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  CHECK_GE(param.max_bin, 2);
+  // histogram index doesn't exist or is built with different bins, generate it
+  if (!ghist_index_page_ || ghist_index_max_bin_ != param.max_bin) {
+    ghist_index_page_.reset(new common::GHistIndexMatrix());
+#if !defined(XGBOOST_USE_CUDA)
+    if (ellpack_page_ && batch_param_.max_bin == param.max_bin) {
+      // the same quantized rows, take the bins of the ELLPACK page instead of sketching
+      ellpack_page_->Impl()->ToGHistIndex(ghist_index_page_.get());
+    } else {
+      ghist_index_page_->Init(this, param.max_bin);
+    }
+#else
+    ghist_index_page_->Init(this, param.max_bin);
+#endif  // !defined(XGBOOST_USE_CUDA)
+    ghist_index_max_bin_ = param.max_bin;
+  }
+  auto begin_iter = BatchIterator<common::GHistIndexMatrix>(
+      new SimpleBatchIteratorImpl<common::GHistIndexMatrix>(ghist_index_page_.get()));
+  return BatchSet<common::GHistIndexMatrix>(begin_iter);
+}
 
-  std::vector<uint64_t> qids;
+common::HistogramCuts const* SimpleDMatrix::GHistIndexCuts(int32_t* max_bin) const {
+  if (!ghist_index_page_) {
+    return nullptr;
+  }
+  *max_bin = ghist_index_max_bin_;
+  return &ghist_index_page_->cut;
+}
+
+bool SimpleDMatrix::SetGHistIndexCuts(common::HistogramCuts const& cuts, int32_t max_bin) {
+  CHECK_GE(max_bin, 2);
+  ghist_index_page_.reset(new common::GHistIndexMatrix());
+  ghist_index_page_->Init(sparse_page_, cuts, this->IsDense());
+  ghist_index_max_bin_ = max_bin;
+  return true;
+}
+
+common::GHistIndexMatrix const* SimpleDMatrix::GHistIndexPage(int32_t* max_bin) const {
+  *max_bin = ghist_index_max_bin_;
+  return ghist_index_page_.get();
+}
+
+bool SimpleDMatrix::LoadGHistIndexPage(dmlc::Stream* fi, int32_t max_bin) {
+  CHECK_GE(max_bin, 2);
+  std::unique_ptr<common::GHistIndexMatrix> page{new common::GHistIndexMatrix()};
+  CHECK(page->Load(fi)) << "Invalid histogram index page";
+  if (page->row_ptr.size() != info.num_row_ + 1) {
+    return false;
+  }
+  ghist_index_page_ = std::move(page);
+  ghist_index_max_bin_ = max_bin;
+  return true;
+}
+
+void GroupPtrFromQid(std::vector<uint64_t> const& qids, std::vector<bst_uint>* group_ptr) {
   uint64_t default_max = std::numeric_limits<uint64_t>::max();
   uint64_t last_group_id = default_max;
   bst_uint group_size = 0;
+  for (auto cur_group_id : qids) {
+    if (last_group_id == default_max || last_group_id != cur_group_id) {
+      group_ptr->push_back(group_size);
+    }
+    last_group_id = cur_group_id;
+    ++group_size;
+  }
+  if (last_group_id != default_max) {
+    if (group_size > group_ptr->back()) {
+      group_ptr->push_back(group_size);
+    }
+  }
+}
+
+namespace {
+/*! \brief Rows and meta information read from one chunk of the input. */
+struct ChunkData {
+  SparsePage page;
+  std::vector<float> labels;
+  std::vector<float> weights;
+  std::vector<float> base_margin;
+  std::vector<uint64_t> qids;
+  uint64_t num_col {0};
+  size_t num_row {0};
+};
+
+/*! \brief Preallocate the page for adapters with a hint on the size of their data. */
+template <typename AdapterT>
+void ReservePage(AdapterT const*, SparsePage*) {}
+
+void ReservePage(ColumnarIteratorAdapter const* adapter, SparsePage* page) {
+  page->offset.HostVector().reserve(adapter->NumRowsHint() + 1);
+  page->data.HostVector().reserve(adapter->NumNonZeroHint());
+}
+}  // anonymous namespace
+
+template <typename AdapterT>
+SimpleDMatrix::SimpleDMatrix(AdapterT* adapter, float missing, int nthread) {
+  std::vector<uint64_t> qids;
   auto& offset_vec = sparse_page_.offset.HostVector();
   auto& data_vec = sparse_page_.data.HostVector();
   uint64_t inferred_num_columns = 0;
+  ReservePage(adapter, &sparse_page_);
 
   adapter->BeforeFirst();
   // Iterate over batches of input data
@@ -101,23 +217,9 @@ SimpleDMatrix::SimpleDMatrix(AdapterT* adapter, float missing, int nthread) {
     }
     if (batch.Qid() != nullptr) {
       qids.insert(qids.end(), batch.Qid(), batch.Qid() + batch.Size());
-      // get group
-      for (size_t i = 0; i < batch.Size(); ++i) {
-        const uint64_t cur_group_id = batch.Qid()[i];
-        if (last_group_id == default_max || last_group_id != cur_group_id) {
-          info.group_ptr_.push_back(group_size);
-        }
-        last_group_id = cur_group_id;
-        ++group_size;
-      }
-    }
-  }
-
-  if (last_group_id != default_max) {
-    if (group_size > info.group_ptr_.back()) {
-      info.group_ptr_.push_back(group_size);
     }
   }
+  GroupPtrFromQid(qids, &info.group_ptr_);
 
   // Deal with empty rows/columns if necessary
   if (adapter->NumColumns() == kAdapterUnknownSize) {
@@ -141,7 +243,301 @@ SimpleDMatrix::SimpleDMatrix(AdapterT* adapter, float missing, int nthread) {
     info.num_row_ = adapter->NumRows();
   }
   info.num_nonzero_ = data_vec.size();
-  omp_set_num_threads(nthread_original);
+  this->TrackPages();
+}
+
+template <typename AdapterT>
+SimpleDMatrix::SimpleDMatrix(std::vector<AdapterT*> const& chunks, float missing,
+                             int nthread) {
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  std::vector<ChunkData> chunk_data(chunks.size());
+  std::vector<std::exception_ptr> errors(chunks.size());
+  // Each chunk is parsed and converted by one thread.
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(chunks.size()); ++i) {  // NOLINT(*)
+    try {
+      auto& chunk = chunk_data[i];
+      auto* adapter = chunks[i];
+      adapter->BeforeFirst();
+      while (adapter->Next()) {
+        auto& batch = adapter->Value();
+        chunk.num_col = std::max(chunk.num_col, chunk.page.Push(batch, missing, 1));
+        chunk.num_row += batch.Size();
+        if (batch.Labels() != nullptr) {
+          chunk.labels.insert(chunk.labels.end(), batch.Labels(),
+                              batch.Labels() + batch.Size());
+        }
+        if (batch.Weights() != nullptr) {
+          chunk.weights.insert(chunk.weights.end(), batch.Weights(),
+                               batch.Weights() + batch.Size());
+        }
+        if (batch.BaseMargin() != nullptr) {
+          chunk.base_margin.insert(chunk.base_margin.end(), batch.BaseMargin(),
+                                   batch.BaseMargin() + batch.Size());
+        }
+        if (batch.Qid() != nullptr) {
+          chunk.qids.insert(chunk.qids.end(), batch.Qid(), batch.Qid() + batch.Size());
+        }
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+  for (auto const& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+  // Pages end at their last non-empty row, keep the empty rows at the end of
+  // all chunks but the last one so rows stay aligned with the labels.
+  for (size_t i = 0; i + 1 < chunk_data.size(); ++i) {
+    auto& offset = chunk_data[i].page.offset.HostVector();
+    offset.resize(chunk_data[i].num_row + 1, offset.back());
+  }
+
+  // Concatenate the pages with precomputed row and element offsets.
+  std::vector<size_t> row_begin(chunks.size() + 1, 0);
+  std::vector<size_t> nnz_begin(chunks.size() + 1, 0);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    row_begin[i + 1] = row_begin[i] + chunk_data[i].page.Size();
+    nnz_begin[i + 1] = nnz_begin[i] + chunk_data[i].page.data.Size();
+  }
+  auto& offset_vec = sparse_page_.offset.HostVector();
+  auto& data_vec = sparse_page_.data.HostVector();
+  offset_vec.resize(row_begin.back() + 1);
+  data_vec.resize(nnz_begin.back());
+  offset_vec[0] = 0;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
+  for (omp_ulong i = 0; i < static_cast<omp_ulong>(chunks.size()); ++i) {  // NOLINT(*)
+    auto& page = chunk_data[i].page;
+    auto const& chunk_offset = page.offset.ConstHostVector();
+    auto const& chunk_data_vec = page.data.ConstHostVector();
+    std::copy(chunk_data_vec.cbegin(), chunk_data_vec.cend(),
+              data_vec.begin() + nnz_begin[i]);
+    for (size_t r = 0; r < page.Size(); ++r) {
+      offset_vec[row_begin[i] + r + 1] = chunk_offset[r + 1] + nnz_begin[i];
+    }
+    page.Clear();
+  }
+
+  std::vector<uint64_t> qids;
+  uint64_t inferred_num_columns = 0;
+  for (auto& chunk : chunk_data) {
+    auto& labels = info.labels_.HostVector();
+    labels.insert(labels.end(), chunk.labels.cbegin(), chunk.labels.cend());
+    auto& weights = info.weights_.HostVector();
+    weights.insert(weights.end(), chunk.weights.cbegin(), chunk.weights.cend());
+    auto& base_margin = info.base_margin_.HostVector();
+    base_margin.insert(base_margin.end(), chunk.base_margin.cbegin(),
+                       chunk.base_margin.cend());
+    qids.insert(qids.end(), chunk.qids.cbegin(), chunk.qids.cend());
+    inferred_num_columns = std::max(inferred_num_columns, chunk.num_col);
+  }
+  GroupPtrFromQid(qids, &info.group_ptr_);
+
+  info.num_col_ = inferred_num_columns;
+  // Synchronise worker columns
+  rabit::Allreduce<rabit::op::Max>(&info.num_col_, 1);
+  info.num_row_ = offset_vec.size() - 1;
+  info.num_nonzero_ = data_vec.size();
+  this->TrackPages();
+}
+
+namespace {
+/*!
+ * \brief Append the values of `n_new' rows.  When the rows on either side come without
+ *  values the field is cleared instead, it has to be set again for all rows.
+ */
+void AppendRows(std::vector<float> const& src, size_t n_old, size_t n_new,
+                std::vector<float>* dst) {
+  if ((dst->empty() && n_old != 0) || (src.empty() && n_new != 0)) {
+    dst->clear();
+    return;
+  }
+  dst->insert(dst->end(), src.cbegin(), src.cend());
+}
+
+/*! \brief Erase the values of rows [begin, end). */
+void EraseRows(size_t num_row, size_t begin, size_t end, std::vector<float>* values) {
+  if (values->empty() || num_row == 0) {
+    return;
+  }
+  size_t const stride = values->size() / num_row;
+  values->erase(values->begin() + begin * stride, values->begin() + end * stride);
+}
+}  // anonymous namespace
+
+template <typename AdapterT>
+void SimpleDMatrix::Append(AdapterT* adapter, float missing, int nthread, bool resketch) {
+  SimpleDMatrix rows(adapter, missing, nthread);
+  auto const& new_info = rows.Info();
+  size_t const n_old = info.num_row_;
+  size_t const n_new = new_info.num_row_;
+  bool const was_dense = this->IsDense();
+
+  // Labels go through `SetInfo' to drop their cached order.
+  std::vector<float> labels = info.labels_.HostVector();
+  AppendRows(new_info.labels_.ConstHostVector(), n_old, n_new, &labels);
+  info.SetInfo("label", labels.data(), DataType::kFloat32, labels.size());
+  AppendRows(new_info.weights_.ConstHostVector(), n_old, n_new,
+             &info.weights_.HostVector());
+  AppendRows(new_info.base_margin_.ConstHostVector(), n_old, n_new,
+             &info.base_margin_.HostVector());
+  if (n_old == 0) {
+    info.group_ptr_ = new_info.group_ptr_;
+  } else if (info.group_ptr_.empty() || (n_new != 0 && new_info.group_ptr_.empty())) {
+    info.group_ptr_.clear();
+  } else {
+    for (size_t i = 1; i < new_info.group_ptr_.size(); ++i) {
+      info.group_ptr_.push_back(n_old + new_info.group_ptr_[i]);
+    }
+  }
+
+  sparse_page_.Push(rows.sparse_page_);
+  bool const new_features = new_info.num_col_ > info.num_col_;
+  info.num_col_ = std::max(info.num_col_, new_info.num_col_);
+  info.num_row_ = n_old + n_new;
+  info.num_nonzero_ = sparse_page_.data.Size();
+
+  column_page_.reset();
+  sorted_column_page_.reset();
+  this->TrackPages();
+  if (ghist_index_page_) {
+    if (resketch || new_features) {
+      ghist_index_page_.reset();
+    } else if (was_dense != this->IsDense()) {
+      // dense pages keep bins at the position of their feature, quantize all rows again
+      common::HistogramCuts cuts = ghist_index_page_->cut;
+      ghist_index_page_.reset(new common::GHistIndexMatrix());
+      ghist_index_page_->Init(sparse_page_, cuts, this->IsDense());
+    } else {
+      ghist_index_page_->PushRows(rows.sparse_page_);
+    }
+  }
+  if (ellpack_page_) {
+    if (resketch || new_features) {
+      ellpack_page_.reset();
+    } else {
+      ellpack_page_->Requantize(this, batch_param_);
+    }
+  }
+}
+
+void SimpleDMatrix::DropRows(size_t begin, size_t end) {
+  CHECK_LE(begin, end);
+  CHECK_LE(end, info.num_row_);
+  if (begin == end) {
+    return;
+  }
+  size_t const n_drop = end - begin;
+  bool const was_dense = this->IsDense();
+
+  auto& offset_vec = sparse_page_.offset.HostVector();
+  auto& data_vec = sparse_page_.data.HostVector();
+  size_t const ibegin = offset_vec[begin];
+  size_t const iend = offset_vec[end];
+  data_vec.erase(data_vec.begin() + ibegin, data_vec.begin() + iend);
+  offset_vec.erase(offset_vec.begin() + begin + 1, offset_vec.begin() + end + 1);
+  for (size_t i = begin + 1; i < offset_vec.size(); ++i) {
+    offset_vec[i] -= iend - ibegin;
+  }
+
+  std::vector<float> labels = info.labels_.HostVector();
+  EraseRows(info.num_row_, begin, end, &labels);
+  info.SetInfo("label", labels.data(), DataType::kFloat32, labels.size());
+  EraseRows(info.num_row_, begin, end, &info.weights_.HostVector());
+  EraseRows(info.num_row_, begin, end, &info.base_margin_.HostVector());
+  auto& group_ptr = info.group_ptr_;
+  if (!group_ptr.empty()) {
+    auto g_begin = std::lower_bound(group_ptr.cbegin(), group_ptr.cend(), begin);
+    auto g_end = std::lower_bound(group_ptr.cbegin(), group_ptr.cend(), end);
+    CHECK(g_begin != group_ptr.cend() && *g_begin == begin &&
+          g_end != group_ptr.cend() && *g_end == end)
+        << "Dropped rows must cover whole query groups.";
+    size_t const gidx_begin = g_begin - group_ptr.cbegin();
+    size_t const gidx_end = g_end - group_ptr.cbegin();
+    group_ptr.erase(group_ptr.begin() + gidx_begin + 1, group_ptr.begin() + gidx_end + 1);
+    for (size_t i = gidx_begin + 1; i < group_ptr.size(); ++i) {
+      group_ptr[i] -= n_drop;
+    }
+  }
+  info.num_row_ -= n_drop;
+  info.num_nonzero_ = data_vec.size();
+
+  column_page_.reset();
+  sorted_column_page_.reset();
+  this->TrackPages();
+  if (ghist_index_page_) {
+    if (was_dense != this->IsDense()) {
+      common::HistogramCuts cuts = ghist_index_page_->cut;
+      ghist_index_page_.reset(new common::GHistIndexMatrix());
+      ghist_index_page_->Init(sparse_page_, cuts, this->IsDense());
+    } else {
+      ghist_index_page_->DropRows(begin, end);
+    }
+  }
+  if (ellpack_page_) {
+    ellpack_page_->Requantize(this, batch_param_);
+  }
+}
+
+namespace {
+/*! \brief Gather the values of the selected rows, `values' has the same number per row. */
+void GatherRows(std::vector<float> const& values, size_t num_row,
+                common::Span<int const> ridxs, std::vector<float>* out) {
+  if (values.empty() || num_row == 0) {
+    return;
+  }
+  size_t const stride = values.size() / num_row;
+  out->resize(ridxs.size() * stride);
+  for (size_t i = 0; i < ridxs.size(); ++i) {
+    std::copy_n(values.cbegin() + ridxs[i] * stride, stride, out->begin() + i * stride);
+  }
+}
+}  // anonymous namespace
+
+SimpleDMatrix::SimpleDMatrix(SimpleDMatrix const& parent, common::Span<int const> ridxs,
+                             int nthread) {
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  size_t const parent_rows = parent.info.num_row_;
+  for (auto ridx : ridxs) {
+    CHECK(ridx >= 0 && static_cast<size_t>(ridx) < parent_rows)
+        << "Row index " << ridx << " out of range for a matrix of " << parent_rows
+        << " rows.";
+  }
+  auto const& src_offset = parent.sparse_page_.offset.ConstHostVector();
+  auto const& src_data = parent.sparse_page_.data.ConstHostVector();
+  auto& offset = sparse_page_.offset.HostVector();
+  auto& data = sparse_page_.data.HostVector();
+  auto const n = static_cast<omp_ulong>(ridxs.size());
+
+  // Sizes of the selected rows first, then each row is copied to its final place.
+  offset.resize(ridxs.size() + 1);
+  offset[0] = 0;
+#pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    auto ridx = ridxs[i];
+    offset[i + 1] = src_offset[ridx + 1] - src_offset[ridx];
+  }
+  std::partial_sum(offset.begin(), offset.end(), offset.begin());
+  data.resize(offset.back());
+#pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    auto ridx = ridxs[i];
+    std::copy(src_data.cbegin() + src_offset[ridx], src_data.cbegin() + src_offset[ridx + 1],
+              data.begin() + offset[i]);
+  }
+
+  info.num_row_ = ridxs.size();
+  info.num_col_ = parent.info.num_col_;
+  info.num_nonzero_ = data.size();
+  GatherRows(parent.info.labels_.ConstHostVector(), parent_rows, ridxs,
+             &info.labels_.HostVector());
+  GatherRows(parent.info.weights_.ConstHostVector(), parent_rows, ridxs,
+             &info.weights_.HostVector());
+  GatherRows(parent.info.base_margin_.ConstHostVector(), parent_rows, ridxs,
+             &info.base_margin_.HostVector());
+  this->TrackPages();
 }
 
 SimpleDMatrix::SimpleDMatrix(dmlc::Stream* in_stream) {
@@ -152,15 +548,196 @@ SimpleDMatrix::SimpleDMatrix(dmlc::Stream* in_stream) {
   info.LoadBinary(in_stream);
   in_stream->Read(&sparse_page_.offset.HostVector());
   in_stream->Read(&sparse_page_.data.HostVector());
+  this->TrackPages();
+}
+
+namespace {
+/*! \brief Alignment of the arrays in the aligned binary format. */
+constexpr size_t kBinaryAlignment = 64;
+/*! \brief Version of the aligned binary format. */
+constexpr int32_t kAlignedBinaryVersion = 2;
+
+/*!
+ * \brief Header of the aligned binary format, followed by the serialised meta info and
+ *        the raw row offsets and entries, both aligned to `kBinaryAlignment`.  Positions
+ *        are in bytes from the beginning of the file.  Since version 2 the header is
+ *        followed by a `SortedColumnHeader`.
+ */
+struct AlignedBinaryHeader {
+  int32_t magic;
+  int32_t version;
+  uint64_t info_bytes;
+  uint64_t offset_begin;
+  uint64_t n_offsets;
+  uint64_t data_begin;
+  uint64_t n_entries;
+
+  uint64_t InfoBegin() const;
+  uint64_t End() const { return data_begin + n_entries * sizeof(Entry); }
+};
+
+/*!
+ * \brief Position of the sorted column page used by the exact tree method, stored after
+ *        the row entries with the same alignment.  `n_offsets` is 0 when the page was
+ *        not saved.
+ */
+struct SortedColumnHeader {
+  uint64_t offset_begin;
+  uint64_t n_offsets;
+  uint64_t data_begin;
+  uint64_t n_entries;
+
+  uint64_t End() const { return data_begin + n_entries * sizeof(Entry); }
+};
+
+uint64_t AlignedBinaryHeader::InfoBegin() const {
+  return sizeof(AlignedBinaryHeader) + (version >= 2 ? sizeof(SortedColumnHeader) : 0);
+}
+
+uint64_t AlignUp(uint64_t n) {
+  return common::DivRoundUp(n, kBinaryAlignment) * kBinaryAlignment;
+}
+
+/*! \brief Copy `bytes` from a mapped file with several threads, faulting in pages concurrently. */
+void ParallelCopy(char const* src, size_t bytes, void* dst) {
+  size_t constexpr kBlock = 16 << 20;
+  auto n_blocks = static_cast<omp_ulong>(common::DivRoundUp(bytes, kBlock));
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < n_blocks; ++i) {  // NOLINT(*)
+    size_t begin = i * kBlock;
+    size_t size = std::min(kBlock, bytes - begin);
+    std::memcpy(static_cast<char*>(dst) + begin, src + begin, size);
+  }
+}
+
+/*! \brief Consume `bytes` of alignment padding from a stream. */
+void SkipPadding(dmlc::Stream* fi, size_t bytes) {
+  char padding[kBinaryAlignment];
+  CHECK_LT(bytes, kBinaryAlignment);
+  CHECK_EQ(fi->Read(padding, bytes), bytes) << "invalid binary file, unexpected end";
+}
+}  // anonymous namespace
+
+SimpleDMatrix::SimpleDMatrix(std::string const& fname, dmlc::Stream* in_stream) {
+  AlignedBinaryHeader header;
+  CHECK_EQ(in_stream->Read(&header, sizeof(header)), sizeof(header))
+      << "invalid input file format";
+  CHECK_EQ(header.magic, kAlignedMagic) << "invalid format, magic number mismatch";
+  CHECK_LE(header.version, kAlignedBinaryVersion)
+      << "Binary file is written by a newer version of XGBoost.";
+  SortedColumnHeader sorted_header{0, 0, 0, 0};
+  if (header.version >= 2) {
+    CHECK_EQ(in_stream->Read(&sorted_header, sizeof(sorted_header)), sizeof(sorted_header))
+        << "invalid input file format";
+  }
+  auto& offset_vec = sparse_page_.offset.HostVector();
+  auto& data_vec = sparse_page_.data.HostVector();
+  offset_vec.resize(header.n_offsets);
+  data_vec.resize(header.n_entries);
+  if (sorted_header.n_offsets != 0) {
+    sorted_column_page_.reset(new SortedCSCPage);
+    sorted_column_page_->offset.HostVector().resize(sorted_header.n_offsets);
+    sorted_column_page_->data.HostVector().resize(sorted_header.n_entries);
+  }
+  this->TrackPages();
+
+  common::MmapFile file(fname);
+  if (file.Valid()) {
+    CHECK_GE(file.Size(), header.End()) << "invalid binary file, unexpected end";
+    common::MemoryFixSizeBuffer info_stream(const_cast<char*>(file.Data()) + header.InfoBegin(),
+                                            header.info_bytes);
+    info.LoadBinary(&info_stream);
+    ParallelCopy(file.Data() + header.offset_begin, offset_vec.size() * sizeof(bst_row_t),
+                 offset_vec.data());
+    ParallelCopy(file.Data() + header.data_begin, data_vec.size() * sizeof(Entry),
+                 data_vec.data());
+    if (sorted_column_page_) {
+      CHECK_GE(file.Size(), sorted_header.End()) << "invalid binary file, unexpected end";
+      auto& sorted_offset = sorted_column_page_->offset.HostVector();
+      auto& sorted_data = sorted_column_page_->data.HostVector();
+      ParallelCopy(file.Data() + sorted_header.offset_begin,
+                   sorted_offset.size() * sizeof(bst_row_t), sorted_offset.data());
+      ParallelCopy(file.Data() + sorted_header.data_begin, sorted_data.size() * sizeof(Entry),
+                   sorted_data.data());
+    }
+    file.DropCache();
+    return;
+  }
+
+  // Remote files are read sequentially.
+  std::string info_buffer(header.info_bytes, '\0');
+  CHECK_EQ(in_stream->Read(&info_buffer[0], info_buffer.size()), info_buffer.size())
+      << "invalid binary file, unexpected end";
+  common::MemoryFixSizeBuffer info_stream(&info_buffer[0], info_buffer.size());
+  info.LoadBinary(&info_stream);
+  SkipPadding(in_stream, header.offset_begin - (header.InfoBegin() + header.info_bytes));
+  size_t offset_bytes = offset_vec.size() * sizeof(bst_row_t);
+  CHECK_EQ(in_stream->Read(offset_vec.data(), offset_bytes), offset_bytes)
+      << "invalid binary file, unexpected end";
+  SkipPadding(in_stream, header.data_begin - (header.offset_begin + offset_bytes));
+  size_t data_bytes = data_vec.size() * sizeof(Entry);
+  CHECK_EQ(in_stream->Read(data_vec.data(), data_bytes), data_bytes)
+      << "invalid binary file, unexpected end";
+  if (sorted_column_page_) {
+    auto& sorted_offset = sorted_column_page_->offset.HostVector();
+    auto& sorted_data = sorted_column_page_->data.HostVector();
+    SkipPadding(in_stream, sorted_header.offset_begin - header.End());
+    size_t sorted_offset_bytes = sorted_offset.size() * sizeof(bst_row_t);
+    CHECK_EQ(in_stream->Read(sorted_offset.data(), sorted_offset_bytes), sorted_offset_bytes)
+        << "invalid binary file, unexpected end";
+    SkipPadding(in_stream, sorted_header.data_begin -
+                               (sorted_header.offset_begin + sorted_offset_bytes));
+    size_t sorted_data_bytes = sorted_data.size() * sizeof(Entry);
+    CHECK_EQ(in_stream->Read(sorted_data.data(), sorted_data_bytes), sorted_data_bytes)
+        << "invalid binary file, unexpected end";
+  }
 }
 
 void SimpleDMatrix::SaveToLocalFile(const std::string& fname) {
-    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
-    int tmagic = kMagic;
-    fo->Write(&tmagic, sizeof(tmagic));
-    info.SaveBinary(fo.get());
-    fo->Write(sparse_page_.offset.HostVector());
-    fo->Write(sparse_page_.data.HostVector());
+  std::string info_buffer;
+  common::MemoryBufferStream info_stream(&info_buffer);
+  info.SaveBinary(&info_stream);
+  auto const& offset_vec = sparse_page_.offset.ConstHostVector();
+  auto const& data_vec = sparse_page_.data.ConstHostVector();
+
+  AlignedBinaryHeader header;
+  header.magic = kAlignedMagic;
+  header.version = kAlignedBinaryVersion;
+  header.info_bytes = info_buffer.size();
+  header.offset_begin = AlignUp(header.InfoBegin() + header.info_bytes);
+  header.n_offsets = offset_vec.size();
+  header.data_begin = AlignUp(header.offset_begin + header.n_offsets * sizeof(bst_row_t));
+  header.n_entries = data_vec.size();
+
+  // the sorted column page is kept when it has been built, e.g. by the exact tree method
+  SortedColumnHeader sorted_header{0, 0, 0, 0};
+  if (sorted_column_page_) {
+    sorted_header.offset_begin = AlignUp(header.End());
+    sorted_header.n_offsets = sorted_column_page_->offset.Size();
+    sorted_header.data_begin =
+        AlignUp(sorted_header.offset_begin + sorted_header.n_offsets * sizeof(bst_row_t));
+    sorted_header.n_entries = sorted_column_page_->data.Size();
+  }
+
+  char const padding[kBinaryAlignment] = {0};
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+  fo->Write(&header, sizeof(header));
+  fo->Write(&sorted_header, sizeof(sorted_header));
+  fo->Write(info_buffer.data(), info_buffer.size());
+  fo->Write(padding, header.offset_begin - (header.InfoBegin() + header.info_bytes));
+  fo->Write(offset_vec.data(), offset_vec.size() * sizeof(bst_row_t));
+  fo->Write(padding, header.data_begin - (header.offset_begin +
+                                          header.n_offsets * sizeof(bst_row_t)));
+  fo->Write(data_vec.data(), data_vec.size() * sizeof(Entry));
+  if (sorted_column_page_) {
+    auto const& sorted_offset = sorted_column_page_->offset.ConstHostVector();
+    auto const& sorted_data = sorted_column_page_->data.ConstHostVector();
+    fo->Write(padding, sorted_header.offset_begin - header.End());
+    fo->Write(sorted_offset.data(), sorted_offset.size() * sizeof(bst_row_t));
+    fo->Write(padding, sorted_header.data_begin -
+                           (sorted_header.offset_begin + sorted_offset.size() * sizeof(bst_row_t)));
+    fo->Write(sorted_data.data(), sorted_data.size() * sizeof(Entry));
+  }
 }
 
 template SimpleDMatrix::SimpleDMatrix(DenseAdapter* adapter, float missing,
@@ -169,13 +746,33 @@ template SimpleDMatrix::SimpleDMatrix(CSRAdapter* adapter, float missing,
                                      int nthread);
 template SimpleDMatrix::SimpleDMatrix(CSCAdapter* adapter, float missing,
                                      int nthread);
+template SimpleDMatrix::SimpleDMatrix(TypedCSCAdapter<int32_t, double>* adapter,
+                                     float missing, int nthread);
+template SimpleDMatrix::SimpleDMatrix(ColMajorDenseAdapter<double>* adapter,
+                                     float missing, int nthread);
+template SimpleDMatrix::SimpleDMatrix(ColMajorDenseAdapter<int32_t>* adapter,
+                                     float missing, int nthread);
 template SimpleDMatrix::SimpleDMatrix(DataTableAdapter* adapter, float missing,
                                      int nthread);
+template SimpleDMatrix::SimpleDMatrix(ArrowAdapter* adapter, float missing,
+                                     int nthread);
 template SimpleDMatrix::SimpleDMatrix(FileAdapter* adapter, float missing,
                                      int nthread);
+template SimpleDMatrix::SimpleDMatrix(std::vector<FileAdapter*> const& chunks,
+                                     float missing, int nthread);
 template SimpleDMatrix::SimpleDMatrix(DMatrixSliceAdapter* adapter, float missing,
                                      int nthread);
 template SimpleDMatrix::SimpleDMatrix(IteratorAdapter* adapter, float missing,
                                      int nthread);
+template SimpleDMatrix::SimpleDMatrix(ColumnarIteratorAdapter* adapter, float missing,
+                                     int nthread);
+template void SimpleDMatrix::Append(DenseAdapter* adapter, float missing, int nthread,
+                                    bool resketch);
+template void SimpleDMatrix::Append(CSRAdapter* adapter, float missing, int nthread,
+                                    bool resketch);
+template void SimpleDMatrix::Append(ArrayAdapter* adapter, float missing, int nthread,
+                                    bool resketch);
+template void SimpleDMatrix::Append(DMatrixSliceAdapter* adapter, float missing,
+                                    int nthread, bool resketch);
 }  // namespace data
 }  // namespace xgboost
@@ -12,18 +12,62 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "../common/hist_util.h"
+#include "../common/memory_tracker.h"
 
 namespace xgboost {
 namespace data {
+/*! \brief Build group boundaries from the query id of each row. */
+void GroupPtrFromQid(std::vector<uint64_t> const& qids, std::vector<bst_uint>* group_ptr);
+
 // Used for single batch data.
 class SimpleDMatrix : public DMatrix {
  public:
   template <typename AdapterT>
   explicit SimpleDMatrix(AdapterT* adapter, float missing, int nthread);
+  /*!
+   * \brief Read consecutive chunks of the input concurrently, one chunk for each
+   *        thread, rows of all chunks are concatenated in order.
+   */
+  template <typename AdapterT>
+  explicit SimpleDMatrix(std::vector<AdapterT*> const& chunks, float missing, int nthread);
+
+  /*!
+   * \brief Copy the rows `ridxs' of `parent' in parallel, with their labels, weights and
+   *        base margin.  Rows are copied as they are, without checking for missing
+   *        values again.  Group structure is not kept.
+   */
+  SimpleDMatrix(SimpleDMatrix const& parent, common::Span<int const> ridxs, int nthread);
+
+  /*!
+   * \brief Append the rows of `adapter' after the existing rows, along with their meta
+   *        information.  Meta information missing on either side is cleared and has to
+   *        be set again for all rows.  Quantized pages built before are extended with
+   *        their current cuts, unless `resketch' is set or new features show up, in which
+   *        case they are sketched again the next time they are requested.
+   */
+  template <typename AdapterT>
+  void Append(AdapterT* adapter, float missing, int nthread, bool resketch = false);
+  /*!
+   * \brief Drop the rows [begin, end), usually the oldest rows of a sliding window.  The
+   *        range must cover whole query groups.  Quantized pages keep their cuts.
+   */
+  void DropRows(size_t begin, size_t end);
 
   explicit SimpleDMatrix(dmlc::Stream* in_stream);
+  /*!
+   * \brief Load the aligned binary format written by `SaveToLocalFile`.  Local files
+   *        are memory mapped and copied in parallel, other files are read from
+   *        `in_stream`.
+   */
+  SimpleDMatrix(std::string const& fname, dmlc::Stream* in_stream);
 
+  /*!
+   * \brief Save in the aligned binary format.  The sorted column page is saved as well
+   *        when it has been built, so the exact tree method can reuse it after loading.
+   */
   void SaveToLocalFile(const std::string& fname);
 
   MetaInfo& Info() override;
@@ -32,14 +76,24 @@ class SimpleDMatrix : public DMatrix {
 
   bool SingleColBlock() const override { return true; }
 
+  common::HistogramCuts const* GHistIndexCuts(int32_t* max_bin) const override;
+  bool SetGHistIndexCuts(common::HistogramCuts const& cuts, int32_t max_bin) override;
+  common::GHistIndexMatrix const* GHistIndexPage(int32_t* max_bin) const override;
+  bool LoadGHistIndexPage(dmlc::Stream* fi, int32_t max_bin) override;
+
   /*! \brief magic number used to identify SimpleDMatrix binary files */
   static const int kMagic = 0xffffab01;
+  /*! \brief magic number of the aligned binary format */
+  static const int kAlignedMagic = 0xffffab03;
 
  private:
   BatchSet<SparsePage> GetRowBatches() override;
   BatchSet<CSCPage> GetColumnBatches() override;
   BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
   BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
+  // Count the row and column pages in the host memory statistics.
+  void TrackPages();
 
   MetaInfo info;
   SparsePage sparse_page_;  // Primary storage type
@@ -47,6 +101,9 @@ class SimpleDMatrix : public DMatrix {
   std::unique_ptr<SortedCSCPage> sorted_column_page_;
   std::unique_ptr<EllpackPage> ellpack_page_;
   BatchParam batch_param_;
+  std::unique_ptr<common::GHistIndexMatrix> ghist_index_page_;
+  int ghist_index_max_bin_ {0};
+  common::TrackedBytes tracked_pages_ {"SparsePage"};
 
   bool EllpackExists() const override {
     return static_cast<bool>(ellpack_page_);
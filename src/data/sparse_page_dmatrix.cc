@@ -28,17 +28,21 @@ BatchSet<SparsePage> SparsePageDMatrix::GetRowBatches() {
 }
 
 BatchSet<CSCPage> SparsePageDMatrix::GetColumnBatches() {
+  std::lock_guard<std::mutex> guard(sources_lock_);
   // Lazily instantiate
   if (!column_source_) {
-    column_source_.reset(new CSCPageSource(this, cache_info_));
+    column_source_.reset(new CSCPageSource(this, cache_info_, kPageSize,
+                                             &memory_budget_));
   }
   return column_source_->GetBatchSet();
 }
 
 BatchSet<SortedCSCPage> SparsePageDMatrix::GetSortedColumnBatches() {
+  std::lock_guard<std::mutex> guard(sources_lock_);
   // Lazily instantiate
   if (!sorted_column_source_) {
-    sorted_column_source_.reset(new SortedCSCPageSource(this, cache_info_));
+    sorted_column_source_.reset(new SortedCSCPageSource(this, cache_info_, kPageSize,
+                                                           &memory_budget_));
   }
   return sorted_column_source_->GetBatchSet();
 }
@@ -58,6 +62,21 @@ BatchSet<EllpackPage> SparsePageDMatrix::GetEllpackBatches(const BatchParam& par
   return BatchSet<EllpackPage>(begin_iter);
 }
 
+BatchSet<common::GHistIndexMatrix> SparsePageDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  CHECK_GE(param.max_bin, 2);
+  std::lock_guard<std::mutex> guard(sources_lock_);
+  // Lazily instantiate
+  if (!ghist_index_source_ || ghist_index_max_bin_ != param.max_bin) {
+    // remove the cache files of the previous source before writing new ones
+    ghist_index_source_.reset();
+    ghist_index_source_.reset(new GHistIndexPageSource(this, cache_info_, param,
+                                                       &memory_budget_));
+    ghist_index_max_bin_ = param.max_bin;
+  }
+  return ghist_index_source_->GetBatchSet();
+}
+
 }  // namespace data
 }  // namespace xgboost
 #endif  // DMLC_ENABLE_STD_THREAD
@@ -10,11 +10,13 @@
 #include <xgboost/data.h>
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "ellpack_page_source.h"
+#include "ghist_index_page_source.h"
 #include "sparse_page_source.h"
 
 namespace xgboost {
@@ -25,10 +27,11 @@ class SparsePageDMatrix : public DMatrix {
   template <typename AdapterT>
   explicit SparsePageDMatrix(AdapterT* adapter, float missing, int nthread,
                              const std::string& cache_prefix,
-                             size_t page_size = kPageSize)
-      : cache_info_(std::move(cache_prefix)) {
-    row_source_.reset(new data::SparsePageSource(adapter, missing, nthread,
-                                                 cache_prefix, page_size));
+                             size_t page_size = kPageSize,
+                             size_t memory_budget = PageMemoryBudget::FromEnv())
+      : memory_budget_(memory_budget), cache_info_(std::move(cache_prefix)) {
+    row_source_.reset(new data::SparsePageSource(adapter, missing, nthread, cache_prefix,
+                                                 page_size, &memory_budget_));
   }
   // Set number of threads but keep old value so we can reset it after
   ~SparsePageDMatrix() override = default;
@@ -44,14 +47,22 @@ class SparsePageDMatrix : public DMatrix {
   BatchSet<CSCPage> GetColumnBatches() override;
   BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
   BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
 
+  // memory for keeping pages of all the sources, outlives them.
+  PageMemoryBudget memory_budget_;
   // source data pointers.
   std::unique_ptr<SparsePageSource> row_source_;
   std::unique_ptr<CSCPageSource> column_source_;
   std::unique_ptr<SortedCSCPageSource> sorted_column_source_;
   std::unique_ptr<EllpackPageSource> ellpack_source_;
+  std::unique_ptr<GHistIndexPageSource> ghist_index_source_;
+  // guards the lazy creation of the sources, iterating them is thread safe
+  std::mutex sources_lock_;
   // saved batch param
   BatchParam batch_param_;
+  // number of bins of the histogram index pages
+  int ghist_index_max_bin_ {0};
   // the cache prefix
   std::string cache_info_;
   // Store column densities to avoid recalculating
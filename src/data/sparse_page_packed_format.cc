@@ -0,0 +1,461 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file sparse_page_packed_format.cc
+ *  Column-wise compressed binary format of sparse page.  Indices are delta coded and
+ *  bit-packed in blocks, feature values are stored raw or through a dictionary.
+ */
+#include <xgboost/data.h>
+#include <dmlc/omp.h>
+#include <dmlc/registry.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "./sparse_page_writer.h"
+#include "../common/common.h"
+
+// Unpacking kernels are compiled once per instruction set and selected at run time, same
+// as the histogram kernels of the hist updater.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define XGBOOST_PACKED_MULTI_ISA 1
+  #define XGBOOST_PACKED_INLINE inline __attribute__((always_inline))
+  #define XGBOOST_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define XGBOOST_PACKED_MULTI_ISA 0
+  #define XGBOOST_PACKED_INLINE inline
+#endif  // x86 with GNU extensions
+
+namespace xgboost {
+namespace data {
+
+DMLC_REGISTRY_FILE_TAG(sparse_page_packed_format);
+
+namespace {
+// Number of values sharing one bit width, a multiple of 8 so that every block starts on
+// a byte boundary.
+constexpr size_t kBlockSize = 128;
+// Widest packed value, a zigzag coded difference of two 32 bit indices.
+constexpr int kMaxWidth = 33;
+// Unpacking reads 8 bytes at a time, the packed buffers are padded accordingly.
+constexpr size_t kPadding = sizeof(uint64_t);
+// Pages with more distinct values are stored raw.
+constexpr size_t kMaxDictionarySize = 1 << 16;
+
+enum ValueCodec : uint8_t { kRawValue = 0, kDictionaryValue = 1 };
+
+inline uint64_t ZigZag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+inline int64_t UnZigZag(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+inline int BitWidth(uint64_t v) {
+  int width = 0;
+  while (v != 0) {
+    v >>= 1;
+    ++width;
+  }
+  return width;
+}
+
+inline size_t PackedBytes(size_t n, int width) {
+  return common::DivRoundUp(n * width, 8);
+}
+
+/*! \brief Pack n values of `width' bits into out, which must be zero initialized. */
+void Pack(uint64_t const* in, size_t n, int width, uint8_t* out) {
+  uint64_t acc = 0;
+  int filled = 0;
+  for (size_t i = 0; i < n; ++i) {
+    acc |= in[i] << filled;
+    filled += width;
+    while (filled >= 8) {
+      *out++ = static_cast<uint8_t>(acc & 0xff);
+      acc >>= 8;
+      filled -= 8;
+    }
+  }
+  if (filled > 0) {
+    *out = static_cast<uint8_t>(acc & 0xff);
+  }
+}
+
+template <int kWidth>
+XGBOOST_PACKED_INLINE void UnpackKernel(uint8_t const* in, size_t n, uint64_t* out) {
+  uint64_t constexpr kMask = (static_cast<uint64_t>(1) << kWidth) - 1;
+  // Branch free, so the compiler can vectorize it for a fixed width.
+  for (size_t i = 0; i < n; ++i) {
+    size_t const bit = i * kWidth;
+    uint64_t word;
+    std::memcpy(&word, in + (bit >> 3), sizeof(word));
+    out[i] = (word >> (bit & 7)) & kMask;
+  }
+}
+template <>
+XGBOOST_PACKED_INLINE void UnpackKernel<0>(uint8_t const*, size_t n, uint64_t* out) {
+  std::fill_n(out, n, 0);
+}
+
+template <int kWidth>
+void UnpackScalar(uint8_t const* in, size_t n, uint64_t* out) {
+  UnpackKernel<kWidth>(in, n, out);
+}
+#if XGBOOST_PACKED_MULTI_ISA
+template <int kWidth>
+XGBOOST_TARGET_AVX2 void UnpackAVX2(uint8_t const* in, size_t n, uint64_t* out) {
+  UnpackKernel<kWidth>(in, n, out);
+}
+#endif  // XGBOOST_PACKED_MULTI_ISA
+
+using UnpackFn = void (*)(uint8_t const*, size_t, uint64_t*);
+
+/*! \brief Fill the unpacking kernels of every width up to kWidth. */
+template <int kWidth>
+struct UnpackTable {
+  static void Fill(bool avx2, UnpackFn* table) {
+#if XGBOOST_PACKED_MULTI_ISA
+    table[kWidth] = avx2 ? &UnpackAVX2<kWidth> : &UnpackScalar<kWidth>;
+#else
+    table[kWidth] = &UnpackScalar<kWidth>;
+#endif  // XGBOOST_PACKED_MULTI_ISA
+    UnpackTable<kWidth - 1>::Fill(avx2, table);
+  }
+};
+template <>
+struct UnpackTable<-1> {
+  static void Fill(bool, UnpackFn*) {}
+};
+
+UnpackFn const* GetUnpackTable() {
+  static UnpackFn table[kMaxWidth + 1];
+  static bool const initialized = []() {
+    bool avx2 = false;
+#if XGBOOST_PACKED_MULTI_ISA
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2");
+#endif  // XGBOOST_PACKED_MULTI_ISA
+    UnpackTable<kMaxWidth>::Fill(avx2, table);
+    return true;
+  }();
+  CHECK(initialized);
+  return table;
+}
+
+/*! \brief Unpack n values of `width' bits, the width must be checked by the caller. */
+inline void Unpack(UnpackFn const* table, uint8_t const* in, size_t n, int width,
+                   uint64_t* out) {
+  table[width](in, n, out);
+}
+
+inline uint32_t FloatBits(float v) {
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+inline float BitsFloat(uint32_t bits) {
+  float v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+/*!
+ * \brief Indices in blocks of kBlockSize.  A block stores its first index and the zigzag
+ *  coded differences of the following ones, packed at the width of the largest
+ *  difference.  Rows of a page and columns of a CSC page keep their indices sorted, so
+ *  the differences are small.
+ */
+class PackedIndex {
+ public:
+  void Encode(std::vector<Entry> const& data, dmlc::Stream* fo) {
+    size_t const n_blocks = common::DivRoundUp(data.size(), kBlockSize);
+    first_.resize(n_blocks);
+    width_.resize(n_blocks);
+    std::vector<size_t> block_ptr(n_blocks + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kBlockSize;
+      size_t const end = std::min(data.size(), begin + kBlockSize);
+      uint64_t max_delta = 0;
+      for (size_t i = begin + 1; i < end; ++i) {
+        max_delta = std::max(max_delta, Delta(data, i));
+      }
+      first_[b] = data[begin].index;
+      width_[b] = static_cast<uint8_t>(BitWidth(max_delta));
+      block_ptr[b + 1] = PackedBytes(end - begin - 1, width_[b]);
+    }
+    for (size_t b = 0; b < n_blocks; ++b) {
+      block_ptr[b + 1] += block_ptr[b];
+    }
+    packed_.clear();
+    packed_.resize(block_ptr.back() + kPadding, 0);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kBlockSize;
+      size_t const end = std::min(data.size(), begin + kBlockSize);
+      uint64_t deltas[kBlockSize];
+      for (size_t i = begin + 1; i < end; ++i) {
+        deltas[i - begin - 1] = Delta(data, i);
+      }
+      Pack(deltas, end - begin - 1, width_[b], packed_.data() + block_ptr[b]);
+    }
+    fo->Write(first_);
+    fo->Write(width_);
+    fo->Write(packed_);
+  }
+
+  void Decode(dmlc::Stream* fi, std::vector<Entry>* p_data) {
+    auto& data = *p_data;
+    size_t const n_blocks = common::DivRoundUp(data.size(), kBlockSize);
+    CHECK(fi->Read(&first_)) << "Invalid packed page file";
+    CHECK(fi->Read(&width_)) << "Invalid packed page file";
+    CHECK(fi->Read(&packed_)) << "Invalid packed page file";
+    CHECK_EQ(first_.size(), n_blocks) << "Invalid packed page file";
+    CHECK_EQ(width_.size(), n_blocks) << "Invalid packed page file";
+    std::vector<size_t> block_ptr(n_blocks + 1, 0);
+    for (size_t b = 0; b < n_blocks; ++b) {
+      CHECK_LE(width_[b], kMaxWidth) << "Invalid packed page file";
+      size_t const n = std::min(data.size() - b * kBlockSize, kBlockSize);
+      block_ptr[b + 1] = block_ptr[b] + PackedBytes(n - 1, width_[b]);
+    }
+    CHECK_EQ(block_ptr.back() + kPadding, packed_.size()) << "Invalid packed page file";
+    UnpackFn const* table = GetUnpackTable();
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kBlockSize;
+      size_t const end = std::min(data.size(), begin + kBlockSize);
+      uint64_t deltas[kBlockSize];
+      Unpack(table, packed_.data() + block_ptr[b], end - begin - 1, width_[b], deltas);
+      int64_t index = first_[b];
+      data[begin].index = first_[b];
+      for (size_t i = begin + 1; i < end; ++i) {
+        index += UnZigZag(deltas[i - begin - 1]);
+        data[i].index = static_cast<bst_uint>(index);
+      }
+    }
+  }
+
+ private:
+  static uint64_t Delta(std::vector<Entry> const& data, size_t i) {
+    return ZigZag(static_cast<int64_t>(data[i].index) -
+                  static_cast<int64_t>(data[i - 1].index));
+  }
+
+  std::vector<bst_uint> first_;
+  std::vector<uint8_t> width_;
+  std::vector<uint8_t> packed_;
+};
+
+/*!
+ * \brief Feature values, either raw or as codes into a sorted dictionary of the distinct
+ *  values of the page.  The codes are bit-packed at a fixed width.
+ */
+class PackedValue {
+ public:
+  explicit PackedValue(bool use_dictionary) : use_dictionary_{use_dictionary} {}
+
+  void Encode(std::vector<Entry> const& data, dmlc::Stream* fo) {
+    dictionary_.clear();
+    if (use_dictionary_) {
+      this->BuildDictionary(data);
+    }
+    uint8_t codec = dictionary_.empty() ? kRawValue : kDictionaryValue;
+    fo->Write(&codec, sizeof(codec));
+    if (codec == kRawValue) {
+      raw_.resize(data.size());
+      for (size_t i = 0; i < data.size(); ++i) {
+        raw_[i] = data[i].fvalue;
+      }
+      fo->Write(raw_);
+      return;
+    }
+    uint8_t const width = static_cast<uint8_t>(BitWidth(dictionary_.size() - 1));
+    size_t const n_blocks = common::DivRoundUp(data.size(), kBlockSize);
+    packed_.clear();
+    packed_.resize(PackedBytes(data.size(), width) + kPadding, 0);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kBlockSize;
+      size_t const end = std::min(data.size(), begin + kBlockSize);
+      uint64_t codes[kBlockSize];
+      for (size_t i = begin; i < end; ++i) {
+        codes[i - begin] = std::lower_bound(dictionary_.cbegin(), dictionary_.cend(),
+                                            FloatBits(data[i].fvalue)) -
+                           dictionary_.cbegin();
+      }
+      Pack(codes, end - begin, width, packed_.data() + PackedBytes(begin, width));
+    }
+    fo->Write(dictionary_);
+    fo->Write(&width, sizeof(width));
+    fo->Write(packed_);
+  }
+
+  void Decode(dmlc::Stream* fi, std::vector<Entry>* p_data) {
+    auto& data = *p_data;
+    uint8_t codec;
+    CHECK_EQ(fi->Read(&codec, sizeof(codec)), sizeof(codec)) << "Invalid packed page file";
+    if (codec == kRawValue) {
+      CHECK(fi->Read(&raw_)) << "Invalid packed page file";
+      CHECK_EQ(raw_.size(), data.size()) << "Invalid packed page file";
+      for (size_t i = 0; i < data.size(); ++i) {
+        data[i].fvalue = raw_[i];
+      }
+      return;
+    }
+    CHECK_EQ(codec, kDictionaryValue) << "Invalid packed page file";
+    uint8_t width;
+    CHECK(fi->Read(&dictionary_)) << "Invalid packed page file";
+    CHECK_EQ(fi->Read(&width, sizeof(width)), sizeof(width)) << "Invalid packed page file";
+    CHECK(fi->Read(&packed_)) << "Invalid packed page file";
+    CHECK(!dictionary_.empty() && width == BitWidth(dictionary_.size() - 1))
+        << "Invalid packed page file";
+    CHECK_EQ(packed_.size(), PackedBytes(data.size(), width) + kPadding)
+        << "Invalid packed page file";
+    UnpackFn const* table = GetUnpackTable();
+    size_t const max_code = dictionary_.size() - 1;
+    size_t const n_blocks = common::DivRoundUp(data.size(), kBlockSize);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kBlockSize;
+      size_t const end = std::min(data.size(), begin + kBlockSize);
+      uint64_t codes[kBlockSize];
+      Unpack(table, packed_.data() + PackedBytes(begin, width), end - begin, width, codes);
+      for (size_t i = begin; i < end; ++i) {
+        // codes past the dictionary only come from a corrupted file
+        uint64_t code = std::min<uint64_t>(codes[i - begin], max_code);
+        data[i].fvalue = BitsFloat(dictionary_[code]);
+      }
+    }
+  }
+
+ private:
+  /*! \brief Distinct value bits of the page, left empty when there are too many. */
+  void BuildDictionary(std::vector<Entry> const& data) {
+    dictionary_.resize(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+      dictionary_[i] = FloatBits(data[i].fvalue);
+    }
+    std::sort(dictionary_.begin(), dictionary_.end());
+    dictionary_.erase(std::unique(dictionary_.begin(), dictionary_.end()),
+                      dictionary_.end());
+    // A dictionary larger than half of the page doesn't save anything.
+    if (dictionary_.size() > kMaxDictionarySize || dictionary_.size() * 2 > data.size()) {
+      dictionary_.clear();
+    }
+  }
+
+  bool use_dictionary_;
+  std::vector<uint32_t> dictionary_;
+  std::vector<bst_float> raw_;
+  std::vector<uint8_t> packed_;
+};
+}  // anonymous namespace
+
+template<typename T>
+class SparsePagePackedFormat : public SparsePageFormat<T> {
+ public:
+  explicit SparsePagePackedFormat(bool use_dictionary) : value_{use_dictionary} {}
+
+  bool Read(T* page, dmlc::SeekStream* fi) override {
+    auto& offset_vec = page->offset.HostVector();
+    if (!fi->Read(&offset_vec)) return false;
+    CHECK_NE(page->offset.Size(), 0U) << "Invalid SparsePage file";
+    auto& data_vec = page->data.HostVector();
+    data_vec.resize(offset_vec.back());
+    this->ReadEntries(fi, &data_vec);
+    return true;
+  }
+
+  bool Read(T* page,
+            dmlc::SeekStream* fi,
+            const std::vector<bst_uint>& sorted_index_set) override {
+    if (!fi->Read(&disk_offset_)) return false;
+    CHECK_NE(disk_offset_.size(), 0U) << "Invalid SparsePage file";
+    buffer_.resize(disk_offset_.back());
+    this->ReadEntries(fi, &buffer_);
+    auto& offset_vec = page->offset.HostVector();
+    auto& data_vec = page->data.HostVector();
+    offset_vec.clear();
+    offset_vec.push_back(0);
+    for (bst_uint fid : sorted_index_set) {
+      CHECK_LT(fid + 1, disk_offset_.size());
+      offset_vec.push_back(offset_vec.back() + disk_offset_[fid + 1] - disk_offset_[fid]);
+    }
+    data_vec.resize(offset_vec.back());
+    for (size_t i = 0; i < sorted_index_set.size(); ++i) {
+      bst_uint fid = sorted_index_set[i];
+      std::copy(buffer_.cbegin() + disk_offset_[fid], buffer_.cbegin() + disk_offset_[fid + 1],
+                data_vec.begin() + offset_vec[i]);
+    }
+    return true;
+  }
+
+  void Write(const T& page, dmlc::Stream* fo) override {
+    const auto& offset_vec = page.offset.HostVector();
+    const auto& data_vec = page.data.HostVector();
+    CHECK(page.offset.Size() != 0 && offset_vec[0] == 0);
+    CHECK_EQ(offset_vec.back(), page.data.Size());
+    fo->Write(offset_vec);
+    if (data_vec.empty()) {
+      return;
+    }
+    index_.Encode(data_vec, fo);
+    value_.Encode(data_vec, fo);
+  }
+
+ private:
+  void ReadEntries(dmlc::SeekStream* fi, std::vector<Entry>* data) {
+    if (data->empty()) {
+      return;
+    }
+    index_.Decode(fi, data);
+    value_.Decode(fi, data);
+  }
+
+  PackedIndex index_;
+  PackedValue value_;
+  /*! \brief external memory column offset */
+  std::vector<size_t> disk_offset_;
+  std::vector<Entry> buffer_;
+};
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(packed)
+.describe("Bit-packed indices and dictionary coded values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<SparsePage>(true);
+  });
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(packedraw)
+.describe("Bit-packed indices and raw values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<SparsePage>(false);
+  });
+
+XGBOOST_REGISTER_CSC_PAGE_FORMAT(packed)
+.describe("Bit-packed indices and dictionary coded values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<CSCPage>(true);
+  });
+
+XGBOOST_REGISTER_CSC_PAGE_FORMAT(packedraw)
+.describe("Bit-packed indices and raw values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<CSCPage>(false);
+  });
+
+XGBOOST_REGISTER_SORTED_CSC_PAGE_FORMAT(packed)
+.describe("Bit-packed indices and dictionary coded values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<SortedCSCPage>(true);
+  });
+
+XGBOOST_REGISTER_SORTED_CSC_PAGE_FORMAT(packedraw)
+.describe("Bit-packed indices and raw values.")
+.set_body([]() {
+    return new SparsePagePackedFormat<SortedCSCPage>(false);
+  });
+
+}  // namespace data
+}  // namespace xgboost
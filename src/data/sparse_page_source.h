@@ -11,10 +11,14 @@
 #include <dmlc/timer.h>
 
 #include <algorithm>
+#include <exception>
 #include <limits>
 #include <locale>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <fstream>
@@ -25,6 +29,7 @@
 #include "adapter.h"
 #include "sparse_page_writer.h"
 #include "../common/common.h"
+#include "../common/io.h"
 #include <xgboost/data.h>
 
 namespace {
@@ -59,6 +64,11 @@ class SparseBatchIteratorImpl : public BatchIteratorImpl<T> {
     source_->BeforeFirst();
     source_->Next();
   }
+  /*! \brief Iterate over a source owned by the iterator, like a pooled cursor. */
+  explicit SparseBatchIteratorImpl(std::shared_ptr<S> source)
+      : SparseBatchIteratorImpl(source.get()) {
+    owned_ = std::move(source);
+  }
   T& operator*() override { return source_->Value(); }
   const T& operator*() const override { return source_->Value(); }
   void operator++() override { at_end_ = !source_->Next(); }
@@ -66,6 +76,7 @@ class SparseBatchIteratorImpl : public BatchIteratorImpl<T> {
 
  private:
   S* source_{nullptr};
+  std::shared_ptr<S> owned_;
   bool at_end_{ false };
 };
 
@@ -111,6 +122,23 @@ inline CacheInfo ParseCacheInfo(const std::string& cache_info, const std::string
   return info;
 }
 
+/*!
+ * \brief Open a cache file for reading.  With XGBOOST_EXTERNAL_MEMORY_IO_DEPTH set above 0
+ *  the file is read ahead in large blocks by that many concurrent reads, setting
+ *  XGBOOST_EXTERNAL_MEMORY_DIRECT_IO to 1 also bypasses the page cache.
+ */
+inline dmlc::SeekStream* OpenCacheFileForRead(const std::string& file) {
+  auto depth = dmlc::GetEnv("XGBOOST_EXTERNAL_MEMORY_IO_DEPTH", 0);
+  if (depth > 0) {
+    bool direct = dmlc::GetEnv("XGBOOST_EXTERNAL_MEMORY_DIRECT_IO", 0) != 0;
+    dmlc::SeekStream* fi = common::AsyncFileReadStream::Create(file, depth, direct);
+    if (fi != nullptr) {
+      return fi;
+    }
+  }
+  return dmlc::SeekStream::CreateForRead(file.c_str());
+}
+
 inline void TryDeleteCacheFile(const std::string& file) {
   if (std::remove(file.c_str()) != 0) {
     LOG(WARNING) << "Couldn't remove external memory cache file " << file
@@ -127,52 +155,65 @@ inline void CheckCacheFileExists(const std::string& file) {
   }
 }
 
+/*!
+ * \brief Memory shared by the page caches of a DMatrix for keeping decoded pages, so
+ *  they are only read from disk once.  The size comes from the environment variable
+ *  XGBOOST_EXTERNAL_MEMORY_BUDGET_MB and is 0 (disabled) by default.
+ */
+class PageMemoryBudget {
+ public:
+  explicit PageMemoryBudget(size_t bytes) : remaining_{bytes} {}
+  static size_t FromEnv() {
+    return dmlc::GetEnv("XGBOOST_EXTERNAL_MEMORY_BUDGET_MB", static_cast<size_t>(0)) << 20;
+  }
+  /*! \brief Take `bytes' out of the budget, returns false if they are not left. */
+  bool Reserve(size_t bytes) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (bytes > remaining_) {
+      return false;
+    }
+    remaining_ -= bytes;
+    return true;
+  }
+  void Release(size_t bytes) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    remaining_ += bytes;
+  }
+
+ private:
+  std::mutex mutex_;
+  size_t remaining_;
+};
+
+template <typename PageT> class ExternalMemoryPageCache;
+
   /**
-   * \brief Given a set of cache files and page type, this object iterates over batches using prefetching for improved performance. Not thread safe.
+   * \brief Given a set of cache files and page type, this object iterates over batches using prefetching for improved performance.
+   *
+   *  One prefetcher is a single cursor and is not thread safe, but any number of them
+   *  can read the same ExternalMemoryPageCache concurrently, each with its own files
+   *  and prefetching threads.  Pages kept in memory by the cache are shared by all of
+   *  its cursors.
    *
    * \tparam  PageT Type of the page t.
    */
   template <typename PageT>
 class ExternalMemoryPrefetcher : dmlc::DataIter<PageT> {
  public:
-    explicit ExternalMemoryPrefetcher(const CacheInfo& info) noexcept(false)
-      : base_rowid_(0), page_(nullptr), clock_ptr_(0) {
-    // read in the info files
-    CHECK_NE(info.name_shards.size(), 0U);
-    {
-      std::unique_ptr<dmlc::Stream> finfo(
-          dmlc::Stream::Create(info.name_info.c_str(), "r"));
-      int tmagic;
-      CHECK_EQ(finfo->Read(&tmagic, sizeof(tmagic)), sizeof(tmagic));
-      CHECK_EQ(tmagic, kMagic) << "invalid format, magic number mismatch";
-    }
-    files_.resize(info.name_shards.size());
-    formats_.resize(info.name_shards.size());
-    prefetchers_.resize(info.name_shards.size());
-
-    // read in the cache files.
-    for (size_t i = 0; i < info.name_shards.size(); ++i) {
-      std::string name_row = info.name_shards.at(i);
-      files_[i].reset(dmlc::SeekStream::CreateForRead(name_row.c_str()));
-      std::unique_ptr<dmlc::SeekStream>& fi = files_[i];
-      std::string format;
-      CHECK(fi->Read(&format)) << "Invalid page format";
-      formats_[i].reset(CreatePageFormat<PageT>(format));
-      std::unique_ptr<SparsePageFormat<PageT>>& fmt = formats_[i];
-      size_t fbegin = fi->Tell();
-      prefetchers_[i].reset(new dmlc::ThreadedIter<PageT>(4));
-      prefetchers_[i]->Init(
-          [&fi, &fmt](PageT** dptr) {
-            if (*dptr == nullptr) {
-              *dptr = new PageT();
-            }
-            return fmt->Read(*dptr, fi.get());
-          },
-          [&fi, fbegin]() { fi->Seek(fbegin); });
-    }
+  /*! \brief A cursor over its own cache of the pages in `info'. */
+  explicit ExternalMemoryPrefetcher(const CacheInfo& info,
+                                    PageMemoryBudget* budget = nullptr) noexcept(false)
+      : owned_cache_{new ExternalMemoryPageCache<PageT>(info, budget)} {
+    this->Init(owned_cache_.get());
+  }
+  /*! \brief A cursor over `cache', which must outlive it. */
+  explicit ExternalMemoryPrefetcher(ExternalMemoryPageCache<PageT>* cache) noexcept(false) {
+    this->Init(cache);
   }
   /*! \brief destructor */
   ~ExternalMemoryPrefetcher() override {
+    // stop reading before the pages are released
+    prefetchers_.clear();
     delete page_;
   }
 
@@ -180,16 +221,27 @@ class ExternalMemoryPrefetcher : dmlc::DataIter<PageT> {
   bool Next() override {
     CHECK(mutex_.try_lock()) << "Multiple threads attempting to use prefetcher";
     // doing clock rotation over shards.
+    size_t n = prefetchers_.size();
     if (page_ != nullptr) {
-      size_t n = prefetchers_.size();
       prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
     }
 
-    if (prefetchers_[clock_ptr_]->Next(&page_)) {
-      page_->SetBaseRowId(base_rowid_);
-      base_rowid_ += page_->Size();
+    PageT* page = nullptr;
+    if (position_ < n_pinned_) {
+      page = cache_->Pinned(position_);
+    } else if (prefetchers_[clock_ptr_]->Next(&page_)) {
+      page = page_;
+      page->SetBaseRowId(base_rowid_);
+      if (cache_->TryPin(position_, page_)) {
+        page_ = nullptr;
+      }
+    }
+    if (page != nullptr) {
+      base_rowid_ += page->Size();
+      current_ = page;
+      ++position_;
       // advance clock
-      clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
+      clock_ptr_ = (clock_ptr_ + 1) % n;
       mutex_.unlock();
       return true;
     } else {
@@ -201,41 +253,229 @@ class ExternalMemoryPrefetcher : dmlc::DataIter<PageT> {
   // implement BeforeFirst
   void BeforeFirst() override {
     CHECK(mutex_.try_lock()) << "Multiple threads attempting to use prefetcher";
+    size_t n = prefetchers_.size();
+    if (page_ != nullptr) {
+      prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
+    }
     base_rowid_ = 0;
     clock_ptr_ = 0;
-    for (auto& p : prefetchers_) {
-      p->BeforeFirst();
+    position_ = 0;
+    // pages pinned later in this pass are read from the disk by this cursor
+    n_pinned_ = cache_->NumPinnedPages();
+    for (size_t i = 0; i < n; ++i) {
+      shards_[i]->skip = n_pinned_ / n + (i < n_pinned_ % n ? 1 : 0);
+      prefetchers_[i]->BeforeFirst();
     }
     mutex_.unlock();
   }
 
   // implement Value
-  PageT& Value() { return *page_; }
+  PageT& Value() { return *current_; }
+
+  const PageT& Value() const override { return *current_; }
 
-  const PageT& Value() const override { return *page_; }
+  /*! \brief number of leading pages kept in memory */
+  size_t NumPinnedPages() const { return cache_->NumPinnedPages(); }
 
  private:
+  struct ShardState {
+    std::unique_ptr<dmlc::SeekStream> file;
+    std::unique_ptr<SparsePageFormat<PageT>> format;
+    /*! \brief beginning of the first page in the file */
+    size_t fbegin {0};
+    /*! \brief number of leading pages of this shard taken from memory */
+    size_t skip {0};
+    /*! \brief index of the next page read from the file */
+    size_t next_page {0};
+  };
+
+  void Init(ExternalMemoryPageCache<PageT>* cache) {
+    cache_ = cache;
+    auto const& info = cache_->Info();
+    shards_.resize(info.name_shards.size());
+    prefetchers_.resize(info.name_shards.size());
+    for (size_t i = 0; i < info.name_shards.size(); ++i) {
+      shards_[i].reset(new ShardState());
+      ShardState* shard = shards_[i].get();
+      shard->file.reset(OpenCacheFileForRead(info.name_shards.at(i)));
+      std::string format;
+      CHECK(shard->file->Read(&format)) << "Invalid page format";
+      shard->format.reset(CreatePageFormat<PageT>(format));
+      shard->fbegin = shard->file->Tell();
+      auto* ends = cache_->PageEnds(i);
+      prefetchers_[i].reset(new dmlc::ThreadedIter<PageT>(4));
+      prefetchers_[i]->Init(
+          [shard, ends](PageT** dptr) {
+            if (*dptr == nullptr) {
+              *dptr = new PageT();
+            }
+            if (!shard->format->Read(*dptr, shard->file.get())) {
+              return false;
+            }
+            ends->Record(shard->next_page, shard->file->Tell());
+            ++shard->next_page;
+            return true;
+          },
+          [shard, ends]() {
+            shard->next_page = shard->skip;
+            shard->file->Seek(shard->skip == 0 ? shard->fbegin : ends->End(shard->skip - 1));
+          });
+    }
+  }
+
+  /*! \brief set when this cursor is not part of a shared cache */
+  std::unique_ptr<ExternalMemoryPageCache<PageT>> owned_cache_;
+  ExternalMemoryPageCache<PageT>* cache_ {nullptr};
   std::mutex mutex_;
   /*! \brief number of rows */
-  size_t base_rowid_;
-  /*! \brief page currently on hold. */
-  PageT* page_;
+  size_t base_rowid_ {0};
+  /*! \brief page currently on hold from the disk prefetchers. */
+  PageT* page_ {nullptr};
+  /*! \brief page handed out by Value(). */
+  PageT* current_ {nullptr};
   /*! \brief internal clock ptr */
-  size_t clock_ptr_;
-  /*! \brief file pointer to the row blob file. */
-  std::vector<std::unique_ptr<dmlc::SeekStream>> files_;
-  /*! \brief Sparse page format file. */
-  std::vector<std::unique_ptr<SparsePageFormat<PageT>>> formats_;
+  size_t clock_ptr_ {0};
+  /*! \brief number of pages handed out in the current pass */
+  size_t position_ {0};
+  /*! \brief number of pages taken from memory in the current pass */
+  size_t n_pinned_ {0};
+  /*! \brief files of the shards, used by the prefetching threads */
+  std::vector<std::unique_ptr<ShardState>> shards_;
   /*! \brief internal prefetcher. */
   std::vector<std::unique_ptr<dmlc::ThreadedIter<PageT>>> prefetchers_;
 };
 
+/*!
+ * \brief Pages of one cache shared by the cursors reading it.
+ *
+ *  With a memory budget, the leading pages that fit into it are kept in memory once a
+ *  cursor has read them, and every cursor starting a pass after that only reads the
+ *  disk from the first page after them.  Cursors are pooled, so their files and
+ *  prefetching threads are reused by later passes.
+ */
+template <typename PageT>
+class ExternalMemoryPageCache {
+ public:
+  /*! \brief End offsets of the pages in one cache file, recorded by the first reader. */
+  class PageEndOffsets {
+   public:
+    void Record(size_t page, size_t end) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (page == ends_.size()) {
+        ends_.push_back(end);
+      }
+    }
+    size_t End(size_t page) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      CHECK_LT(page, ends_.size());
+      return ends_[page];
+    }
+
+   private:
+    std::mutex mutex_;
+    std::vector<size_t> ends_;
+  };
+
+  ExternalMemoryPageCache(const CacheInfo& info, PageMemoryBudget* budget) noexcept(false)
+      : info_{info}, budget_{budget} {
+    // read in the info files
+    CHECK_NE(info.name_shards.size(), 0U);
+    {
+      std::unique_ptr<dmlc::Stream> finfo(
+          dmlc::Stream::Create(info.name_info.c_str(), "r"));
+      int tmagic;
+      CHECK_EQ(finfo->Read(&tmagic, sizeof(tmagic)), sizeof(tmagic));
+      CHECK_EQ(tmagic, kMagic) << "invalid format, magic number mismatch";
+    }
+    for (size_t i = 0; i < info.name_shards.size(); ++i) {
+      ends_.emplace_back(new PageEndOffsets());
+    }
+  }
+  ~ExternalMemoryPageCache() {
+    idle_.clear();
+    if (budget_ != nullptr) {
+      budget_->Release(pinned_bytes_);
+    }
+  }
+
+  /*!
+   * \brief Take a cursor that is not used by anyone else, it's put back into the pool
+   *  once the returned pointer is released.
+   */
+  std::shared_ptr<ExternalMemoryPrefetcher<PageT>> Acquire() {
+    std::unique_ptr<ExternalMemoryPrefetcher<PageT>> cursor;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!idle_.empty()) {
+        cursor = std::move(idle_.back());
+        idle_.pop_back();
+      }
+    }
+    if (!cursor) {
+      cursor.reset(new ExternalMemoryPrefetcher<PageT>(this));
+    }
+    return std::shared_ptr<ExternalMemoryPrefetcher<PageT>>(
+        cursor.release(), [this](ExternalMemoryPrefetcher<PageT>* released) {
+          std::lock_guard<std::mutex> guard(mutex_);
+          idle_.emplace_back(released);
+        });
+  }
+
+  CacheInfo const& Info() const { return info_; }
+  PageEndOffsets* PageEnds(size_t shard) { return ends_.at(shard).get(); }
+
+  /*! \brief number of leading pages kept in memory */
+  size_t NumPinnedPages() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return pinned_.size();
+  }
+  /*! \brief The pinned page at `position' in reading order. */
+  PageT* Pinned(size_t position) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    CHECK_LT(position, pinned_.size());
+    return pinned_[position].get();
+  }
+  /*!
+   * \brief Keep `page' read at `position' if it directly follows the pinned pages,
+   *  taking its ownership.  Returns false if it's not kept.
+   */
+  bool TryPin(size_t position, PageT* page) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (budget_ == nullptr || pinning_closed_ || position != pinned_.size()) {
+      return false;
+    }
+    size_t bytes = page->MemCostBytes();
+    if (!budget_->Reserve(bytes)) {
+      // keep the pinned pages a prefix, so the files are read from one position
+      pinning_closed_ = true;
+      return false;
+    }
+    pinned_bytes_ += bytes;
+    pinned_.emplace_back(page);
+    return true;
+  }
+
+ private:
+  CacheInfo info_;
+  PageMemoryBudget* budget_;
+  std::vector<std::unique_ptr<PageEndOffsets>> ends_;
+  std::mutex mutex_;
+  /*! \brief the leading pages of all shards, in reading order */
+  std::vector<std::unique_ptr<PageT>> pinned_;
+  size_t pinned_bytes_ {0};
+  /*! \brief a page didn't fit, no later page is kept */
+  bool pinning_closed_ {false};
+  /*! \brief cursors not used by any iterator */
+  std::vector<std::unique_ptr<ExternalMemoryPrefetcher<PageT>>> idle_;
+};
+
 class SparsePageSource {
  public:
   template <typename AdapterT>
   SparsePageSource(AdapterT* adapter, float missing, int nthread,
                    const std::string& cache_info,
-                   const size_t page_size = DMatrix::kPageSize) {
+                   const size_t page_size = DMatrix::kPageSize,
+                   PageMemoryBudget* budget = nullptr) {
     const std::string page_type = ".row.page";
     cache_info_ = ParseCacheInfo(cache_info, page_type);
 
@@ -366,36 +606,49 @@ class SparsePageSource {
     LOG(INFO) << "SparsePageSource Finished writing to "
               << cache_info_.name_info;
 
-    external_prefetcher_.reset(
-        new ExternalMemoryPrefetcher<SparsePage>(cache_info_));
+    page_cache_.reset(new ExternalMemoryPageCache<SparsePage>(cache_info_, budget));
   }
 
   ~SparsePageSource() {
-    external_prefetcher_.reset();
+    page_cache_.reset();
     TryDeleteCacheFile(cache_info_.name_info);
     for (auto file : cache_info_.name_shards) {
       TryDeleteCacheFile(file);
     }
   }
 
+  /*! \brief Thread safe, each batch set reads the pages with a cursor of its own. */
   BatchSet<SparsePage> GetBatchSet() {
     auto begin_iter = BatchIterator<SparsePage>(
         new SparseBatchIteratorImpl<ExternalMemoryPrefetcher<SparsePage>,
-                                    SparsePage>(external_prefetcher_.get()));
+                                    SparsePage>(page_cache_->Acquire()));
     return BatchSet<SparsePage>(begin_iter);
   }
   MetaInfo info;
 
  private:
-  std::unique_ptr<ExternalMemoryPrefetcher<SparsePage>> external_prefetcher_;
+  std::unique_ptr<ExternalMemoryPageCache<SparsePage>> page_cache_;
   CacheInfo cache_info_;
 };
 
-class CSCPageSource {
+/*!
+ * \brief Column cache of a matrix, built from its row pages.  Pages of SortedCSCPage
+ *  have the entries of every feature sorted by value.
+ *
+ *  Building is pipelined: row pages are prefetched from the row cache and transposed on
+ *  the calling thread, a merging thread gathers the transposed pages into pages of the
+ *  cache size, sorts them once they are full and hands them to the writer threads.  At
+ *  most `kMergeQueueCapacity' transposed pages wait to be merged.
+ *
+ * \tparam PageT CSCPage or SortedCSCPage.
+ */
+template <typename PageT>
+class ColumnPageSource {
  public:
-  CSCPageSource(DMatrix* src, const std::string& cache_info,
-                const size_t page_size = DMatrix::kPageSize) {
-    std::string page_type = ".col.page";
+  ColumnPageSource(DMatrix* src, const std::string& cache_info,
+                   const size_t page_size = DMatrix::kPageSize,
+                   PageMemoryBudget* budget = nullptr) {
+    std::string page_type = kSorted ? ".sorted.col.page" : ".col.page";
     cache_info_ = ParseCacheInfo(cache_info, page_type);
     for (auto file : cache_info_.name_shards) {
       CheckCacheFileExists(file);
@@ -403,117 +656,122 @@ class CSCPageSource {
     {
       SparsePageWriter<SparsePage> writer(cache_info_.name_shards,
                                           cache_info_.format_shards, 6);
-      std::shared_ptr<SparsePage> page;
-      writer.Alloc(&page);
-      page->Clear();
-
-      size_t bytes_write = 0;
-      double tstart = dmlc::GetTime();
-      for (auto& batch : src->GetBatches<SparsePage>()) {
-        page->PushCSC(batch.GetTranspose(src->Info().num_col_));
-
-        if (page->MemCostBytes() >= page_size) {
-          bytes_write += page->MemCostBytes();
-          writer.PushWrite(std::move(page));
-          writer.Alloc(&page);
-          page->Clear();
-          double tdiff = dmlc::GetTime() - tstart;
-          LOG(INFO) << "Writing to " << cache_info << " in "
-                    << ((bytes_write >> 20UL) / tdiff) << " MB/s, "
-                    << (bytes_write >> 20UL) << " written";
+      BoundedBlockingQueue<std::shared_ptr<SparsePage>> transposed(kMergeQueueCapacity);
+      std::exception_ptr merge_error;
+      std::thread merger([&]() {
+        this->MergeAndWrite(&transposed, &writer, page_size, cache_info, &merge_error);
+      });
+      std::exception_ptr transpose_error;
+      try {
+        for (auto& batch : src->GetBatches<SparsePage>()) {
+          std::shared_ptr<SparsePage> page{
+              new SparsePage(batch.GetTranspose(src->Info().num_col_))};
+          transposed.Push(std::move(page));
         }
+      } catch (...) {
+        transpose_error = std::current_exception();
       }
-      if (page->data.Size() != 0) {
-        writer.PushWrite(std::move(page));
+      // use nullptr to signal termination.
+      transposed.Push(std::shared_ptr<SparsePage>(nullptr));
+      merger.join();
+      if (transpose_error) {
+        std::rethrow_exception(transpose_error);
+      }
+      if (merge_error) {
+        std::rethrow_exception(merge_error);
       }
-      LOG(INFO) << "CSCPageSource: Finished writing to "
+      LOG(INFO) << "ColumnPageSource: Finished writing " << page_type << " to "
                 << cache_info_.name_info;
     }
-    external_prefetcher_.reset(
-        new ExternalMemoryPrefetcher<CSCPage>(cache_info_));
+    page_cache_.reset(new ExternalMemoryPageCache<PageT>(cache_info_, budget));
   }
 
-  ~CSCPageSource() {
-    external_prefetcher_.reset();
+  ~ColumnPageSource() {
+    page_cache_.reset();
     for (auto file : cache_info_.name_shards) {
       TryDeleteCacheFile(file);
     }
   }
 
-  BatchSet<CSCPage> GetBatchSet() {
-    auto begin_iter = BatchIterator<CSCPage>(
-        new SparseBatchIteratorImpl<ExternalMemoryPrefetcher<CSCPage>, CSCPage>(
-            external_prefetcher_.get()));
-    return BatchSet<CSCPage>(begin_iter);
+  /*! \brief Thread safe, each batch set reads the pages with a cursor of its own. */
+  BatchSet<PageT> GetBatchSet() {
+    auto begin_iter = BatchIterator<PageT>(
+        new SparseBatchIteratorImpl<ExternalMemoryPrefetcher<PageT>, PageT>(
+            page_cache_->Acquire()));
+    return BatchSet<PageT>(begin_iter);
   }
 
  private:
-  std::unique_ptr<ExternalMemoryPrefetcher<CSCPage>> external_prefetcher_;
-  CacheInfo cache_info_;
-};
-
-class SortedCSCPageSource {
- public:
-  SortedCSCPageSource(DMatrix* src, const std::string& cache_info,
-                      const size_t page_size = DMatrix::kPageSize) {
-    std::string page_type = ".sorted.col.page";
-    cache_info_ = ParseCacheInfo(cache_info, page_type);
-    for (auto file : cache_info_.name_shards) {
-      CheckCacheFileExists(file);
-    }
-    {
-      SparsePageWriter<SparsePage> writer(cache_info_.name_shards,
-                                          cache_info_.format_shards, 6);
-      std::shared_ptr<SparsePage> page;
-      writer.Alloc(&page);
-      page->Clear();
-
-      size_t bytes_write = 0;
-      double tstart = dmlc::GetTime();
-      for (auto& batch : src->GetBatches<SparsePage>()) {
-        SparsePage tmp = batch.GetTranspose(src->Info().num_col_);
-        page->PushCSC(tmp);
+  static bool constexpr kSorted = std::is_same<PageT, SortedCSCPage>::value;
+  static size_t constexpr kMergeQueueCapacity = 2;
+
+  /*! \brief Merging stage, keeps draining the queue after an error so the producer
+   *  never blocks. */
+  void MergeAndWrite(BoundedBlockingQueue<std::shared_ptr<SparsePage>>* transposed,
+                     SparsePageWriter<SparsePage>* writer, size_t page_size,
+                     std::string const& cache_info, std::exception_ptr* p_error) {
+    std::shared_ptr<SparsePage> page;
+    size_t bytes_write = 0;
+    double tstart = dmlc::GetTime();
+    auto push_write = [&]() {
+      if (kSorted) {
         page->SortRows();
-
+      }
+      bytes_write += page->MemCostBytes();
+      writer->PushWrite(std::move(page));
+    };
+    try {
+      writer->Alloc(&page);
+      page->Clear();
+    } catch (...) {
+      *p_error = std::current_exception();
+    }
+    std::shared_ptr<SparsePage> batch;
+    while (true) {
+      transposed->Pop(&batch);
+      if (batch == nullptr) {
+        break;
+      }
+      if (*p_error) {
+        continue;
+      }
+      try {
+        page->PushCSC(*batch);
+        batch.reset();
         if (page->MemCostBytes() >= page_size) {
-          bytes_write += page->MemCostBytes();
-          writer.PushWrite(std::move(page));
-          writer.Alloc(&page);
+          push_write();
+          writer->Alloc(&page);
           page->Clear();
           double tdiff = dmlc::GetTime() - tstart;
           LOG(INFO) << "Writing to " << cache_info << " in "
                     << ((bytes_write >> 20UL) / tdiff) << " MB/s, "
                     << (bytes_write >> 20UL) << " written";
         }
+      } catch (...) {
+        *p_error = std::current_exception();
       }
-      if (page->data.Size() != 0) {
-        writer.PushWrite(std::move(page));
-      }
-      LOG(INFO) << "SortedCSCPageSource: Finished writing to "
-                << cache_info_.name_info;
     }
-    external_prefetcher_.reset(
-        new ExternalMemoryPrefetcher<SortedCSCPage>(cache_info_));
-  }
-  ~SortedCSCPageSource() {
-    external_prefetcher_.reset();
-    for (auto file : cache_info_.name_shards) {
-      TryDeleteCacheFile(file);
+    if (!*p_error && page->data.Size() != 0) {
+      try {
+        push_write();
+      } catch (...) {
+        *p_error = std::current_exception();
+      }
     }
   }
 
-  BatchSet<SortedCSCPage> GetBatchSet() {
-    auto begin_iter = BatchIterator<SortedCSCPage>(
-        new SparseBatchIteratorImpl<ExternalMemoryPrefetcher<SortedCSCPage>,
-                                    SortedCSCPage>(external_prefetcher_.get()));
-    return BatchSet<SortedCSCPage>(begin_iter);
-  }
-
- private:
-  std::unique_ptr<ExternalMemoryPrefetcher<SortedCSCPage>> external_prefetcher_;
+  std::unique_ptr<ExternalMemoryPageCache<PageT>> page_cache_;
   CacheInfo cache_info_;
 };
 
+template <typename PageT>
+bool constexpr ColumnPageSource<PageT>::kSorted;
+template <typename PageT>
+size_t constexpr ColumnPageSource<PageT>::kMergeQueueCapacity;
+
+using CSCPageSource = ColumnPageSource<CSCPage>;
+using SortedCSCPageSource = ColumnPageSource<SortedCSCPage>;
+
 }  // namespace data
 }  // namespace xgboost
 #endif  // XGBOOST_DATA_SPARSE_PAGE_SOURCE_H_
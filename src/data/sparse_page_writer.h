@@ -18,6 +18,9 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include <dmlc/concurrency.h>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
 #include <thread>
 #endif  // DMLC_ENABLE_STD_THREAD
 
@@ -75,6 +78,39 @@ inline SparsePageFormat<T>* CreatePageFormat(const std::string& name) {
 }
 
 #if DMLC_ENABLE_STD_THREAD
+/*!
+ * \brief A blocking queue holding at most `capacity' items, used between the stages of
+ *  building a page cache.  Pushing into a full queue waits for the consumer.
+ * @tparam T Type of the item.
+ */
+template<typename T>
+class BoundedBlockingQueue {
+ public:
+  explicit BoundedBlockingQueue(size_t capacity) : capacity_(capacity) {
+    CHECK_GT(capacity, 0);
+  }
+  void Push(T&& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() { return queue_.size() < capacity_; });
+    queue_.push(std::move(item));
+    not_empty_.notify_one();
+  }
+  void Pop(T* out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return !queue_.empty(); });
+    *out = std::move(queue_.front());
+    queue_.pop();
+    not_full_.notify_one();
+  }
+
+ private:
+  size_t capacity_;
+  std::queue<T> queue_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
 /*!
  * \brief A threaded writer to write sparse batch page to sharded files.
  * @tparam T Type of the page.
@@ -208,6 +244,10 @@ struct SparsePageFormatReg
 #define XGBOOST_REGISTER_ELLPACK_PAGE_FORMAT(Name)                       \
   DMLC_REGISTRY_REGISTER(SparsePageFormatReg<EllpackPage>, EllpackPageFm, Name)
 
+#define GHistIndexPageFmt SparsePageFormat<common::GHistIndexMatrix>
+#define XGBOOST_REGISTER_GHIST_INDEX_PAGE_FORMAT(Name)                   \
+  DMLC_REGISTRY_REGISTER(SparsePageFormatReg<common::GHistIndexMatrix>, GHistIndexPageFmt, Name)
+
 }  // namespace data
 }  // namespace xgboost
 #endif  // XGBOOST_DATA_SPARSE_PAGE_WRITER_H_
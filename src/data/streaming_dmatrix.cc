@@ -0,0 +1,207 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file streaming_dmatrix.cc
+ */
+#include <dmlc/base.h>
+#include <rabit/rabit.h>
+
+#if DMLC_ENABLE_STD_THREAD
+#include "./streaming_dmatrix.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+/*! \brief Restarts the prefetcher and hands out its pages, recycling each one after use. */
+class PrefetchBatchIteratorImpl : public BatchIteratorImpl<SparsePage> {
+ public:
+  explicit PrefetchBatchIteratorImpl(dmlc::ThreadedIter<SparsePage>* prefetcher)
+      : prefetcher_{prefetcher} {
+    prefetcher_->BeforeFirst();
+    at_end_ = !prefetcher_->Next(&page_);
+  }
+  ~PrefetchBatchIteratorImpl() override {
+    if (page_ != nullptr) {
+      prefetcher_->Recycle(&page_);
+    }
+  }
+  SparsePage& operator*() override { return *page_; }
+  const SparsePage& operator*() const override { return *page_; }
+  void operator++() override {
+    prefetcher_->Recycle(&page_);
+    at_end_ = !prefetcher_->Next(&page_);
+  }
+  bool AtEnd() const override { return at_end_; }
+
+ private:
+  dmlc::ThreadedIter<SparsePage>* prefetcher_;
+  SparsePage* page_ {nullptr};
+  bool at_end_ {false};
+};
+
+/*!
+ * \brief Iterates over the row batches of a DMatrix and hands out a page derived from
+ *  each of them, the page is rebuilt in place for every batch.
+ */
+template <typename PageT>
+class DerivedBatchIteratorImpl : public BatchIteratorImpl<PageT> {
+ public:
+  using Derive = std::function<void(SparsePage const&, PageT*)>;
+  DerivedBatchIteratorImpl(BatchSet<SparsePage> rows, Derive derive)
+      : rows_{std::move(rows)}, iter_{rows_.begin()}, derive_{std::move(derive)} {
+    this->Update();
+  }
+  PageT& operator*() override { return page_; }
+  const PageT& operator*() const override { return page_; }
+  void operator++() override {
+    ++iter_;
+    this->Update();
+  }
+  bool AtEnd() const override { return iter_.AtEnd(); }
+
+ private:
+  void Update() {
+    if (!iter_.AtEnd()) {
+      derive_(*iter_, &page_);
+    }
+  }
+
+  BatchSet<SparsePage> rows_;
+  BatchIterator<SparsePage> iter_;
+  Derive derive_;
+  PageT page_;
+};
+}  // anonymous namespace
+
+StreamingDMatrix::StreamingDMatrix(std::unique_ptr<IteratorAdapter>&& adapter, float missing)
+    : missing_{missing}, adapter_{std::move(adapter)} {
+  // Read the meta info, rows are only counted.
+  std::vector<uint64_t> qids;
+  uint64_t inferred_num_columns = 0;
+  size_t num_batches = 0;
+  SparsePage page;
+  adapter_->BeforeFirst();
+  while (adapter_->Next()) {
+    auto const& batch = adapter_->Value();
+    page.Clear();
+    page.SetBaseRowId(info_.num_row_);
+    inferred_num_columns = std::max(page.Push(batch, missing_, 0), inferred_num_columns);
+    if (batch.Labels() != nullptr) {
+      auto& labels = info_.labels_.HostVector();
+      labels.insert(labels.end(), batch.Labels(), batch.Labels() + batch.Size());
+    }
+    if (batch.Weights() != nullptr) {
+      auto& weights = info_.weights_.HostVector();
+      weights.insert(weights.end(), batch.Weights(), batch.Weights() + batch.Size());
+    }
+    if (batch.Qid() != nullptr) {
+      qids.insert(qids.end(), batch.Qid(), batch.Qid() + batch.Size());
+    }
+    info_.num_row_ += batch.Size();
+    info_.num_nonzero_ += page.data.Size();
+    ++num_batches;
+  }
+  GroupPtrFromQid(qids, &info_.group_ptr_);
+  if (adapter_->NumColumns() == kAdapterUnknownSize) {
+    info_.num_col_ = inferred_num_columns;
+  } else {
+    info_.num_col_ = adapter_->NumColumns();
+  }
+  // Synchronise worker columns
+  rabit::Allreduce<rabit::op::Max>(&info_.num_col_, 1);
+  LOG(INFO) << "StreamingDMatrix: " << info_.num_row_ << " rows in " << num_batches
+            << " batches.";
+
+  // The current batch and one being prefetched.
+  prefetcher_.reset(new dmlc::ThreadedIter<SparsePage>(1));
+  prefetcher_->Init(
+      [this](SparsePage** dptr) { return this->NextPage(dptr); },
+      [this]() {
+        adapter_->BeforeFirst();
+        base_rowid_ = 0;
+      });
+}
+
+StreamingDMatrix::~StreamingDMatrix() {
+  // stop the prefetching thread before the adapter goes away
+  prefetcher_.reset();
+}
+
+bool StreamingDMatrix::NextPage(SparsePage** dptr) {
+  if (!adapter_->Next()) {
+    return false;
+  }
+  if (*dptr == nullptr) {
+    *dptr = new SparsePage();
+  }
+  SparsePage* page = *dptr;
+  auto const& batch = adapter_->Value();
+  page->Clear();
+  page->SetBaseRowId(base_rowid_);
+  page->Push(batch, missing_, 0);
+  // Keep the empty rows at the end of a batch.
+  auto& offset_vec = page->offset.HostVector();
+  while (offset_vec.size() - 1 < batch.Size()) {
+    offset_vec.emplace_back(offset_vec.back());
+  }
+  base_rowid_ += batch.Size();
+  return true;
+}
+
+BatchSet<SparsePage> StreamingDMatrix::GetRowBatches() {
+  auto begin_iter = BatchIterator<SparsePage>(new PrefetchBatchIteratorImpl(prefetcher_.get()));
+  return BatchSet<SparsePage>(begin_iter);
+}
+
+BatchSet<CSCPage> StreamingDMatrix::GetColumnBatches() {
+  bst_feature_t const n_features = info_.num_col_;
+  auto begin_iter = BatchIterator<CSCPage>(new DerivedBatchIteratorImpl<CSCPage>(
+      this->GetRowBatches(), [n_features](SparsePage const& rows, CSCPage* page) {
+        *page = CSCPage(rows.GetTranspose(n_features));
+      }));
+  return BatchSet<CSCPage>(begin_iter);
+}
+
+BatchSet<SortedCSCPage> StreamingDMatrix::GetSortedColumnBatches() {
+  bst_feature_t const n_features = info_.num_col_;
+  auto begin_iter = BatchIterator<SortedCSCPage>(new DerivedBatchIteratorImpl<SortedCSCPage>(
+      this->GetRowBatches(), [n_features](SparsePage const& rows, SortedCSCPage* page) {
+        *page = SortedCSCPage(rows.GetTranspose(n_features));
+        page->SortRows();
+      }));
+  return BatchSet<SortedCSCPage>(begin_iter);
+}
+
+BatchSet<EllpackPage> StreamingDMatrix::GetEllpackBatches(const BatchParam&) {
+  LOG(FATAL) << "ELLPACK pages are not supported by a DMatrix streamed from an iterator.";
+  auto begin_iter = BatchIterator<EllpackPage>(nullptr);
+  return BatchSet<EllpackPage>(begin_iter);
+}
+
+BatchSet<common::GHistIndexMatrix> StreamingDMatrix::GetGHistIndexBatches(
+    const BatchParam& param) {
+  CHECK_GE(param.max_bin, 2);
+  if (!cuts_ || cuts_max_bin_ != param.max_bin) {
+    cuts_.reset(new common::HistogramCuts());
+    cuts_->Build(this, param.max_bin);
+    cuts_max_bin_ = param.max_bin;
+  }
+  common::HistogramCuts const* cuts = cuts_.get();
+  bool const is_dense = this->IsDense();
+  auto begin_iter = BatchIterator<common::GHistIndexMatrix>(
+      new DerivedBatchIteratorImpl<common::GHistIndexMatrix>(
+          this->GetRowBatches(),
+          [cuts, is_dense](SparsePage const& rows, common::GHistIndexMatrix* page) {
+            page->Init(rows, *cuts, is_dense);
+          }));
+  return BatchSet<common::GHistIndexMatrix>(begin_iter);
+}
+}  // namespace data
+}  // namespace xgboost
+#endif  // DMLC_ENABLE_STD_THREAD
@@ -0,0 +1,62 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file streaming_dmatrix.h
+ * \brief External memory DMatrix reading its batches from a user iterator.
+ */
+#ifndef XGBOOST_DATA_STREAMING_DMATRIX_H_
+#define XGBOOST_DATA_STREAMING_DMATRIX_H_
+
+#include <dmlc/threadediter.h>
+#include <xgboost/data.h>
+
+#include <memory>
+
+#include "adapter.h"
+#include "../common/hist_util.h"
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief A DMatrix that asks the iterator for its data again on every pass over the
+ *  batches, after resetting it.  Only the meta info is read up front, rows are
+ *  converted by a prefetcher one batch ahead of the consumer and nothing is written to
+ *  disk.  Column and quantized batches are derived from each row batch on the fly, so
+ *  one pass over them is one pass over the iterator.
+ */
+class StreamingDMatrix : public DMatrix {
+ public:
+  /*! \brief Takes the ownership of an adapter that can be reset. */
+  StreamingDMatrix(std::unique_ptr<IteratorAdapter>&& adapter, float missing);
+  ~StreamingDMatrix() override;
+
+  MetaInfo& Info() override { return info_; }
+  const MetaInfo& Info() const override { return info_; }
+
+  bool SingleColBlock() const override { return false; }
+
+ private:
+  BatchSet<SparsePage> GetRowBatches() override;
+  BatchSet<CSCPage> GetColumnBatches() override;
+  BatchSet<SortedCSCPage> GetSortedColumnBatches() override;
+  BatchSet<EllpackPage> GetEllpackBatches(const BatchParam& param) override;
+  BatchSet<common::GHistIndexMatrix> GetGHistIndexBatches(const BatchParam& param) override;
+
+  /*! \brief Convert the next batch of the adapter into a page, starting at base_rowid_. */
+  bool NextPage(SparsePage** dptr);
+
+  MetaInfo info_;
+  float missing_;
+  std::unique_ptr<IteratorAdapter> adapter_;
+  // first row of the next batch read from the adapter
+  size_t base_rowid_ {0};
+  std::unique_ptr<dmlc::ThreadedIter<SparsePage>> prefetcher_;
+  // cuts shared by all quantized batches, built on the first request
+  std::unique_ptr<common::HistogramCuts> cuts_;
+  int cuts_max_bin_ {0};
+
+  bool EllpackExists() const override { return false; }
+  bool SparsePageExists() const override { return true; }
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_STREAMING_DMATRIX_H_
@@ -0,0 +1,379 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file text_parser.cc
+ * \brief Each chunk read by `dmlc::InputSplit' is cut at line breaks into one piece for
+ *  each thread, the pieces are parsed concurrently and concatenated into a single row
+ *  block.  Line breaks are found with `memchr', which is vectorised by the C library,
+ *  and numbers are parsed with `common::FromChars' instead of `strtof'.
+ */
+#include <dmlc/data.h>
+#include <dmlc/io.h>
+#include <dmlc/omp.h>
+#include <dmlc/registry.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xgboost/logging.h"
+
+#include "text_parser.h"
+#include "../common/charconv.h"
+#include "../common/common.h"
+
+namespace xgboost {
+namespace data {
+
+char const* ParseTextFloat(char const* begin, char const* end, float* out) {
+  char const* p = begin;
+  if (p != end && *p == '+') {
+    ++p;
+  }
+  auto res = common::FromChars(p, end, out);
+  if (res.ec == std::errc()) {
+    return res.ptr;
+  }
+  // Forms like ".5", "1." or "nan" that are not JSON numbers.
+  char buffer[64];
+  size_t const n = std::min(static_cast<size_t>(end - begin), sizeof(buffer) - 1);
+  std::memcpy(buffer, begin, n);
+  buffer[n] = '\0';
+  char* stop {nullptr};
+  float const v = std::strtof(buffer, &stop);
+  *out = stop == buffer ? 0.0f : v;
+  return begin + (stop - buffer);
+}
+
+namespace {
+constexpr size_t kMinBytesPerThread = 1 << 16;
+
+// Rows parsed by one thread.
+struct TextBlock {
+  std::vector<size_t> offset {0};
+  std::vector<float> label;
+  std::vector<float> weight;
+  std::vector<uint64_t> qid;
+  std::vector<uint32_t> index;
+  std::vector<float> value;
+  bool has_weight {false};
+  bool has_qid {false};
+
+  void Clear() {
+    offset.resize(1);
+    label.clear();
+    weight.clear();
+    qid.clear();
+    index.clear();
+    value.clear();
+    has_weight = false;
+    has_qid = false;
+  }
+  void Push(uint64_t fidx, float fvalue) {
+    CHECK_LE(fidx, std::numeric_limits<uint32_t>::max()) << "Feature index is too large.";
+    index.push_back(static_cast<uint32_t>(fidx));
+    value.push_back(fvalue);
+  }
+  void EndRow(float row_label, float row_weight, uint64_t row_qid) {
+    label.push_back(row_label);
+    weight.push_back(row_weight);
+    qid.push_back(row_qid);
+    offset.push_back(index.size());
+  }
+};
+
+inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+// Beginning of the line after the one `p' is in.
+inline char const* NextLine(char const* p, char const* end) {
+  auto nl = static_cast<char const*>(std::memchr(p, '\n', end - p));
+  return nl == nullptr ? end : nl + 1;
+}
+
+char const* ParseIndex(char const* begin, char const* end, uint64_t* out) {
+  char const* p = begin;
+  uint64_t v = 0;
+  while (p != end && *p >= '0' && *p <= '9') {
+    v = v * 10 + static_cast<uint64_t>(*p - '0');
+    ++p;
+  }
+  *out = v;
+  return p;
+}
+
+class TextParser : public dmlc::Parser<uint32_t> {
+ public:
+  TextParser(dmlc::InputSplit* source, int32_t nthread)
+      : source_{source}, nthread_{std::max(nthread, 1)} {}
+
+  void BeforeFirst() override {
+    source_->BeforeFirst();
+    bytes_read_ = 0;
+  }
+  bool Next() override {
+    dmlc::InputSplit::Blob chunk;
+    do {
+      if (!source_->NextChunk(&chunk)) {
+        return false;
+      }
+      bytes_read_ += chunk.size;
+      this->ParseChunk(static_cast<char const*>(chunk.dptr), chunk.size);
+    } while (out_.size == 0);
+    return true;
+  }
+  dmlc::RowBlock<uint32_t> const& Value() const override { return out_; }
+  size_t BytesRead() const override { return bytes_read_; }
+
+ protected:
+  // Parse one line without the line break, skipping it when it holds no row.
+  virtual void ParseLine(char const* begin, char const* end, TextBlock* out) const = 0;
+
+ private:
+  void ParseChunk(char const* begin, size_t size) {
+    char const* end = begin + size;
+    int32_t n_threads = omp_in_parallel() ? 1 : nthread_;
+    n_threads = std::max(
+        std::min(n_threads, static_cast<int32_t>(size / kMinBytesPerThread)), 1);
+    std::vector<char const*> cuts(n_threads + 1, end);
+    cuts[0] = begin;
+    for (int32_t t = 1; t < n_threads; ++t) {
+      cuts[t] = std::max(cuts[t - 1], NextLine(begin + size * t / n_threads - 1, end));
+    }
+    blocks_.resize(n_threads);
+    dmlc::OMPException exc;
+#pragma omp parallel for num_threads(n_threads) schedule(static, 1)
+    for (int32_t t = 0; t < n_threads; ++t) {
+      exc.Run([&, t]() {
+        auto& block = blocks_[t];
+        block.Clear();
+        for (char const* line = cuts[t]; line < cuts[t + 1];) {
+          char const* next = NextLine(line, cuts[t + 1]);
+          char const* line_end = next;
+          while (line_end != line && (line_end[-1] == '\n' || line_end[-1] == '\r')) {
+            --line_end;
+          }
+          this->ParseLine(line, line_end, &block);
+          line = next;
+        }
+      });
+    }
+    exc.Rethrow();
+    this->Merge();
+  }
+
+  void Merge() {
+    if (blocks_.size() == 1) {
+      std::swap(merged_, blocks_.front());
+    } else {
+      merged_.Clear();
+      for (auto const& block : blocks_) {
+        size_t const base = merged_.index.size();
+        for (auto it = block.offset.cbegin() + 1; it != block.offset.cend(); ++it) {
+          merged_.offset.push_back(base + *it);
+        }
+        merged_.label.insert(merged_.label.end(), block.label.cbegin(), block.label.cend());
+        merged_.weight.insert(merged_.weight.end(), block.weight.cbegin(),
+                              block.weight.cend());
+        merged_.qid.insert(merged_.qid.end(), block.qid.cbegin(), block.qid.cend());
+        merged_.index.insert(merged_.index.end(), block.index.cbegin(), block.index.cend());
+        merged_.value.insert(merged_.value.end(), block.value.cbegin(), block.value.cend());
+        merged_.has_weight |= block.has_weight;
+        merged_.has_qid |= block.has_qid;
+      }
+    }
+    out_.size = merged_.label.size();
+    out_.offset = merged_.offset.data();
+    out_.label = merged_.label.data();
+    out_.weight = merged_.has_weight ? merged_.weight.data() : nullptr;
+    out_.qid = merged_.has_qid ? merged_.qid.data() : nullptr;
+    out_.field = nullptr;
+    out_.index = merged_.index.data();
+    out_.value = merged_.value.data();
+  }
+
+  std::unique_ptr<dmlc::InputSplit> source_;
+  int32_t nthread_;
+  size_t bytes_read_ {0};
+  std::vector<TextBlock> blocks_;
+  TextBlock merged_;
+  dmlc::RowBlock<uint32_t> out_;
+};
+
+// label[:weight] [qid:id] index[:value] ... [# comment]
+class LibSVMTextParser : public TextParser {
+ public:
+  LibSVMTextParser(dmlc::InputSplit* source, int32_t indexing_mode, int32_t nthread)
+      : TextParser{source, nthread}, indexing_mode_{indexing_mode} {}
+
+ protected:
+  void ParseLine(char const* p, char const* end, TextBlock* out) const override {
+    while (p != end && IsBlank(*p)) {
+      ++p;
+    }
+    if (p == end || *p == '#') {
+      return;
+    }
+    float label {0}, weight {1};
+    char const* q = ParseTextFloat(p, end, &label);
+    CHECK(q != p) << "Invalid libsvm label: " << std::string(p, end);
+    p = q;
+    if (p != end && *p == ':') {
+      p = ParseTextFloat(p + 1, end, &weight);
+      out->has_weight = true;
+    }
+    uint64_t qid {0};
+    while (true) {
+      while (p != end && IsBlank(*p)) {
+        ++p;
+      }
+      if (p == end || *p == '#') {
+        break;
+      }
+      if (end - p > 4 && std::memcmp(p, "qid:", 4) == 0) {
+        p = ParseIndex(p + 4, end, &qid);
+        out->has_qid = true;
+      } else {
+        uint64_t fidx {0};
+        q = ParseIndex(p, end, &fidx);
+        CHECK(q != p) << "Invalid libsvm feature index: " << std::string(p, end);
+        float fvalue {1};
+        if (q != end && *q == ':') {
+          q = ParseTextFloat(q + 1, end, &fvalue);
+        }
+        if (indexing_mode_ == 1) {
+          CHECK_GT(fidx, 0) << "Feature index 0 in libsvm file with one-based indexing.";
+          --fidx;
+        }
+        out->Push(fidx, fvalue);
+        p = q;
+      }
+      while (p != end && !IsBlank(*p)) {
+        ++p;
+      }
+    }
+    out->EndRow(label, weight, qid);
+  }
+
+ private:
+  int32_t indexing_mode_;
+};
+
+// Delimited values, the label and weight columns are not counted as features.
+class CSVTextParser : public TextParser {
+ public:
+  CSVTextParser(dmlc::InputSplit* source, int32_t label_column, int32_t weight_column,
+                char delimiter, int32_t nthread)
+      : TextParser{source, nthread}, label_column_{label_column},
+        weight_column_{weight_column}, delimiter_{delimiter} {}
+
+ protected:
+  void ParseLine(char const* p, char const* end, TextBlock* out) const override {
+    if (p == end) {
+      return;
+    }
+    float label {0}, weight {1};
+    int32_t column {0};
+    uint64_t fidx {0};
+    while (true) {
+      auto field_end = static_cast<char const*>(std::memchr(p, delimiter_, end - p));
+      field_end = field_end == nullptr ? end : field_end;
+      while (p != field_end && IsBlank(*p)) {
+        ++p;
+      }
+      float v {0};
+      ParseTextFloat(p, field_end, &v);
+      if (column == label_column_) {
+        label = v;
+      } else if (column == weight_column_) {
+        weight = v;
+        out->has_weight = true;
+      } else {
+        out->Push(fidx++, v);
+      }
+      ++column;
+      if (field_end == end || field_end + 1 == end) {
+        break;
+      }
+      p = field_end + 1;
+    }
+    out->EndRow(label, weight, 0);
+  }
+
+ private:
+  int32_t label_column_;
+  int32_t weight_column_;
+  char delimiter_;
+};
+
+using ParserArgs = std::map<std::string, std::string>;
+
+int32_t GetIntArg(ParserArgs const& args, std::string const& key, int32_t dft) {
+  auto it = args.find(key);
+  return it == args.cend() ? dft : std::atoi(it->second.c_str());
+}
+
+dmlc::Parser<uint32_t>* CreateDMLCParser(std::string const& format, std::string const& path,
+                                         ParserArgs const& args, unsigned part_index,
+                                         unsigned num_parts) {
+  auto const* reg =
+      dmlc::Registry<dmlc::ParserFactoryReg<uint32_t, dmlc::real_t>>::Find(format);
+  CHECK(reg) << "Unknown data format: " << format;
+  return reg->body(path, args, part_index, num_parts);
+}
+
+dmlc::Parser<uint32_t>* CreateLibSVMTextParser(std::string const& path, ParserArgs const& args,
+                                               unsigned part_index, unsigned num_parts) {
+  int32_t const indexing_mode = GetIntArg(args, "indexing_mode", 0);
+  if (indexing_mode < 0) {
+    // Detecting the base of indices needs the whole block, leave it to dmlc-core.
+    return CreateDMLCParser("libsvm", path, args, part_index, num_parts);
+  }
+  return new LibSVMTextParser(
+      dmlc::InputSplit::Create(path.c_str(), part_index, num_parts, "text"), indexing_mode,
+      omp_get_max_threads());
+}
+
+dmlc::Parser<uint32_t>* CreateCSVTextParser(std::string const& path, ParserArgs const& args,
+                                            unsigned part_index, unsigned num_parts) {
+  auto it = args.find("delimiter");
+  std::string const delimiter = it == args.cend() ? "," : it->second;
+  CHECK_EQ(delimiter.size(), 1) << "CSV delimiter must be a single character.";
+  return new CSVTextParser(
+      dmlc::InputSplit::Create(path.c_str(), part_index, num_parts, "text"),
+      GetIntArg(args, "label_column", -1), GetIntArg(args, "weight_column", -1),
+      delimiter.front(), omp_get_max_threads());
+}
+}  // anonymous namespace
+
+std::string TextParserFormat(std::string const& uri, std::string const& format) {
+  std::string resolved {format};
+  if (resolved == "auto") {
+    resolved = "libsvm";  // default of dmlc-core
+    auto parts = common::Split(common::Split(uri, '#').front(), '?');
+    if (parts.size() == 2) {
+      for (auto const& kv : common::Split(parts.back(), '&')) {
+        auto pair = common::Split(kv, '=');
+        if (pair.size() == 2 && pair.front() == "format") {
+          resolved = pair.back();
+        }
+      }
+    }
+  }
+  if (resolved == "libsvm" || resolved == "csv") {
+    return "fast_" + resolved;
+  }
+  return format;
+}
+}  // namespace data
+}  // namespace xgboost
+
+namespace dmlc {
+DMLC_REGISTER_DATA_PARSER(uint32_t, real_t, fast_libsvm,
+                          ::xgboost::data::CreateLibSVMTextParser);
+DMLC_REGISTER_DATA_PARSER(uint32_t, real_t, fast_csv,
+                          ::xgboost::data::CreateCSVTextParser);
+}  // namespace dmlc
@@ -0,0 +1,33 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ * \file text_parser.h
+ * \brief Parallel libsvm and CSV parsers used by `DMatrix::Load' in place of the text
+ *  parsers of dmlc-core.
+ */
+#ifndef XGBOOST_DATA_TEXT_PARSER_H_
+#define XGBOOST_DATA_TEXT_PARSER_H_
+
+#include <cstddef>
+#include <string>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief Parse the number at [begin, end), a token of a text file.  Numbers written in
+ *  plain decimal or scientific notation take the fast path of `common::FromChars',
+ *  anything else `strtof' accepts is parsed by it.
+ *
+ * \return end of the number, `begin' when there's no number, in which case `out' is 0.
+ */
+char const* ParseTextFloat(char const* begin, char const* end, float* out);
+
+/*!
+ * \brief Name of the dmlc parser `DMatrix::Load' should create for `uri'.  The libsvm
+ *  and CSV formats, picked either by `format' or by the `format' argument of `uri' when
+ *  `format' is "auto", are mapped to the parsers defined in text_parser.cc, other
+ *  formats are left to dmlc-core.
+ */
+std::string TextParserFormat(std::string const& uri, std::string const& format);
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_TEXT_PARSER_H_
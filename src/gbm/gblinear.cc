@@ -21,6 +21,7 @@
 #include "xgboost/learner.h"
 
 #include "gblinear_model.h"
+#include "../common/bitfield.h"
 #include "../common/timer.h"
 
 namespace xgboost {
@@ -74,6 +75,7 @@ class GBLinear : public GradientBooster {
 
   void Load(dmlc::Stream* fi) override {
     model_.Load(fi);
+    this->CommitWeights();
   }
   void Save(dmlc::Stream* fo) const override {
     model_.Save(fo);
@@ -91,6 +93,7 @@ class GBLinear : public GradientBooster {
     CHECK_EQ(get<String>(in["name"]), "gblinear");
     auto const& model = in["model"];
     model_.LoadModel(model);
+    this->CommitWeights();
   }
 
   void LoadConfig(Json const& in) override {
@@ -120,6 +123,7 @@ class GBLinear : public GradientBooster {
 
     if (!this->CheckConvergence()) {
       updater_->Update(in_gpair, p_fmat, &model_, sum_instance_weight_);
+      this->CommitWeights();
     }
 
     monitor_.Stop("DoBoost");
@@ -147,6 +151,22 @@ class GBLinear : public GradientBooster {
     }
   }
 
+  void PredictRow(const SparsePage::Inst &inst,
+                  common::Span<bst_float> out_preds,
+                  unsigned ntree_limit) const override {
+    const int ngroup = model_.learner_model_param_->num_output_group;
+    CHECK_GE(out_preds.size(), ngroup);
+    CHECK(!model_.weight.empty()) << "gblinear model is not initialized.";
+    for (int gid = 0; gid < ngroup; ++gid) {
+      bst_float psum = model_.bias()[gid] + learner_model_param_->base_score;
+      for (const auto& ins : inst) {
+        if (ins.index >= model_.learner_model_param_->num_feature) continue;
+        psum += ins.fvalue * model_[ins.index][gid];
+      }
+      out_preds[gid] = psum;
+    }
+  }
+
   void PredictLeaf(DMatrix *p_fmat,
                    std::vector<bst_float> *out_preds,
                    unsigned ntree_limit) override {
@@ -238,15 +258,23 @@ class GBLinear : public GradientBooster {
       if (base_margin.size() != 0) {
         CHECK_EQ(base_margin.size(), nsize * ngroup);
       }
+      // Features whose weights are all zero are skipped with the bit field built by
+      // `CommitWeights', saving the weight loads when the model is sparse.
+      const bool skip_zero = !active_storage_.empty() && weight_density_ < kDenseWeights;
 #pragma omp parallel for schedule(static)
       for (omp_ulong i = 0; i < nsize; ++i) {
         const size_t ridx = batch.base_rowid + i;
+        bst_float *p_preds = &preds[ridx * ngroup];
         // loop over output groups
         for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float margin =
-              (base_margin.size() != 0) ?
-              base_margin[ridx * ngroup + gid] : learner_model_param_->base_score;
-          this->Pred(batch[i], &preds[ridx * ngroup], gid, margin);
+          p_preds[gid] = model_.bias()[gid] +
+              ((base_margin.size() != 0) ?
+               base_margin[ridx * ngroup + gid] : learner_model_param_->base_score);
+        }
+        if (skip_zero) {
+          this->AddRow<true>(batch[i], p_preds);
+        } else {
+          this->AddRow<false>(batch[i], p_preds);
         }
       }
     }
@@ -281,6 +309,45 @@ class GBLinear : public GradientBooster {
     }
   }
 
+  /*!
+   * \brief Record the features with a non-zero weight in any output group, called
+   *  whenever the weights change.
+   */
+  void CommitWeights() {
+    const auto nfeat = model_.learner_model_param_->num_feature;
+    const int ngroup = model_.learner_model_param_->num_output_group;
+    if (model_.weight.empty() || nfeat == 0) {
+      active_storage_.clear();
+      return;
+    }
+    active_storage_.assign(LBitField64::ComputeStorageSize(nfeat), 0);
+    active_features_ = LBitField64{common::Span<LBitField64::value_type>{active_storage_}};
+    size_t n_active = 0;
+    for (uint32_t fidx = 0; fidx < nfeat; ++fidx) {
+      auto const *w = model_[fidx];
+      if (std::any_of(w, w + ngroup, [](bst_float v) { return v != 0.0f; })) {
+        active_features_.Set(fidx);
+        ++n_active;
+      }
+    }
+    weight_density_ = static_cast<float>(n_active) / nfeat;
+  }
+
+  /*! \brief Add the linear terms of one row to the margin of every output group. */
+  template <bool skip_zero>
+  void AddRow(const SparsePage::Inst &inst, bst_float *preds) const {
+    const int ngroup = model_.learner_model_param_->num_output_group;
+    const auto nfeat = model_.learner_model_param_->num_feature;
+    for (const auto& ins : inst) {
+      if (ins.index >= nfeat) continue;
+      if (skip_zero && !active_features_.Check(ins.index)) continue;
+      auto const *w = model_[ins.index];
+      for (int gid = 0; gid < ngroup; ++gid) {
+        preds[gid] += ins.fvalue * w[gid];
+      }
+    }
+  }
+
   void Pred(const SparsePage::Inst &inst, bst_float *preds, int gid,
             bst_float base) {
     bst_float psum = model_.bias()[gid] + base;
@@ -302,8 +369,15 @@ class GBLinear : public GradientBooster {
   bool sum_weight_complete_;
   common::Monitor monitor_;
   bool is_converged_;
+  // Use the dense prediction loop above this fraction of non-zero features.
+  static constexpr float kDenseWeights = 0.5f;
+  std::vector<LBitField64::value_type> active_storage_;
+  LBitField64 active_features_;
+  float weight_density_ { 1.0f };
 };
 
+constexpr float GBLinear::kDenseWeights;
+
 // register the objective functions
 DMLC_REGISTER_PARAMETER(GBLinearTrainParam);
 
@@ -16,21 +16,11 @@ void GBLinearModel::SaveModel(Json* p_out) const {
                 "Weight type should be of the same type with JSON float");
   auto& out = *p_out;
 
-  size_t const n_weights = weight.size();
-  std::vector<Json> j_weights(n_weights);
-  for (size_t i = 0; i < n_weights; ++i) {
-    j_weights[i] = weight[i];
-  }
-  out["weights"] = std::move(j_weights);
+  out["weights"] = F32Array(std::vector<float>(weight));
 }
 
 void GBLinearModel::LoadModel(Json const& in) {
-  auto const& j_weights = get<Array const>(in["weights"]);
-  auto n_weights = j_weights.size();
-  weight.resize(n_weights);
-  for (size_t i = 0; i < n_weights; ++i) {
-    weight[i] = get<Number const>(j_weights[i]);
-  }
+  GetNumericArray(in["weights"], &weight);
 }
 
 DMLC_REGISTER_PARAMETER(DeprecatedGBLinearModelParam);
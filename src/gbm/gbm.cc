@@ -10,6 +10,7 @@
 
 #include "xgboost/gbm.h"
 #include "xgboost/learner.h"
+#include "xgboost/objective.h"
 #include "xgboost/generic_parameters.h"
 
 namespace dmlc {
@@ -29,6 +30,13 @@ GradientBooster* GradientBooster::Create(
   p_bst->generic_param_ = generic_param;
   return p_bst;
 }
+
+void GradientBooster::DoBoostWithGradient(DMatrix* p_fmat, ElementWiseGradient* grad,
+                                          HostDeviceVector<GradientPair>* out_gpair,
+                                          PredictionCacheEntry* prediction) {
+  grad->ComputeAll(out_gpair);
+  this->DoBoost(p_fmat, out_gpair, prediction);
+}
 }  // namespace xgboost
 
 namespace xgboost {
@@ -13,11 +13,15 @@
 #include <string>
 #include <limits>
 #include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
 
 #include "xgboost/data.h"
 #include "xgboost/gbm.h"
 #include "xgboost/logging.h"
 #include "xgboost/json.h"
+#include "xgboost/objective.h"
 #include "xgboost/predictor.h"
 #include "xgboost/tree_updater.h"
 #include "xgboost/host_device_vector.h"
@@ -27,6 +31,7 @@
 #include "../common/common.h"
 #include "../common/random.h"
 #include "../common/timer.h"
+#include "../predictor/flat_model.h"
 
 namespace xgboost {
 namespace gbm {
@@ -39,6 +44,15 @@ void GBTree::Configure(const Args& cfg) {
   tparam_.UpdateAllowUnknown(cfg);
 
   model_.Configure(cfg);
+  // Trees of a new multi-class model may hold all classes in their leaves, a trained
+  // model keeps the kind of trees it's made of.
+  if (model_.trees.empty()) {
+    bool const multi_output =
+        tparam_.multi_strategy == MultiStrategy::kMultiOutputTree &&
+        model_.learner_model_param_->num_output_group > 1;
+    model_.param.size_leaf_vector =
+        multi_output ? model_.learner_model_param_->num_output_group : 0;
+  }
 
   // for the 'update' process_type, move trees into trees_to_update
   if (tparam_.process_type == TreeProcessType::kUpdate) {
@@ -51,14 +65,28 @@ void GBTree::Configure(const Args& cfg) {
         Predictor::Create("cpu_predictor", this->generic_param_));
   }
   cpu_predictor_->Configure(cfg);
-#if defined(XGBOOST_USE_CUDA)
-  auto n_gpus = common::AllVisibleGPUs();
-  if (!gpu_predictor_ && n_gpus != 0) {
-    gpu_predictor_ = std::unique_ptr<Predictor>(
-        Predictor::Create("gpu_predictor", this->generic_param_));
+  if (tparam_.predictor == PredictorType::kCompiledPredictor) {
+    if (!compiled_predictor_) {
+      compiled_predictor_ = std::unique_ptr<Predictor>(
+          Predictor::Create("compiled_predictor", this->generic_param_));
+    }
+    compiled_predictor_->Configure(cfg);
+  }
+  if (tparam_.predictor == PredictorType::kQuantizedPredictor) {
+    if (!quantized_predictor_) {
+      quantized_predictor_ = std::unique_ptr<Predictor>(
+          Predictor::Create("quantized_predictor", this->generic_param_));
+    }
+    quantized_predictor_->Configure(cfg);
   }
-  if (n_gpus != 0) {
-    gpu_predictor_->Configure(cfg);
+#if defined(XGBOOST_USE_CUDA)
+  // The GPU predictor is created on first use, so prediction on CPU never touches the
+  // device.
+  {
+    std::lock_guard<std::mutex> guard(gpu_predictor_lock_);
+    if (gpu_predictor_) {
+      gpu_predictor_->Configure(cfg);
+    }
   }
 #endif  // defined(XGBOOST_USE_CUDA)
 
@@ -81,8 +109,9 @@ void GBTree::Configure(const Args& cfg) {
 
   this->ConfigureUpdaters();
   if (updater_seq != tparam_.updater_seq) {
+    // The updaters are created by the first boosting round, a booster only used for
+    // prediction doesn't need them.
     updaters_.clear();
-    this->InitUpdater(cfg);
   } else {
     for (auto &up : updaters_) {
       up->Configure(cfg);
@@ -108,8 +137,10 @@ void GBTree::ConfigureWithKnownData(Args const& cfg, DMatrix* fmat) {
 
   // initialize the updaters only when needed.
   if (updater_seq != tparam_.updater_seq) {
-    LOG(DEBUG) << "Using updaters: " << tparam_.updater_seq;
     this->updaters_.clear();
+  }
+  if (this->updaters_.empty()) {
+    LOG(DEBUG) << "Using updaters: " << tparam_.updater_seq;
     this->InitUpdater(cfg);
   }
 }
@@ -124,6 +155,11 @@ void GBTree::PerformTreeMethodHeuristic(DMatrix* fmat) {
   if (tparam_.tree_method != TreeMethod::kAuto) {
     return;
   }
+  if (model_.param.size_leaf_vector != 0) {
+    // Only the `hist' tree method grows multi-output trees.
+    tparam_.tree_method = TreeMethod::kHist;
+    return;
+  }
 
   if (rabit::IsDistributed()) {
     LOG(WARNING) <<
@@ -152,6 +188,12 @@ void GBTree::ConfigureUpdaters() {
     return;
   }
   // `updater` parameter was manually specified
+  if (model_.param.size_leaf_vector != 0) {
+    CHECK(tparam_.tree_method == TreeMethod::kAuto || tparam_.tree_method == TreeMethod::kHist)
+        << "Multi-output trees are only supported by the `hist' tree method.";
+    tparam_.updater_seq = "grow_multi_hist";
+    return;
+  }
   /* Choose updaters according to tree_method parameters */
   switch (tparam_.tree_method) {
     case TreeMethod::kAuto:
@@ -190,7 +232,14 @@ void GBTree::DoBoost(DMatrix* p_fmat,
   ConfigureWithKnownData(this->cfg_, p_fmat);
   monitor_.Start("BoostNewTrees");
   CHECK_NE(ngroup, 0);
-  if (ngroup == 1) {
+  if (model_.param.size_leaf_vector != 0) {
+    // Multi-output trees are grown from the gradients of all groups at once.
+    CHECK_EQ(in_gpair->Size() % ngroup, 0U)
+        << "must have exactly ngroup * nrow gpairs";
+    std::vector<std::unique_ptr<RegTree> > ret;
+    BoostNewTrees(in_gpair, p_fmat, 0, &ret);
+    new_trees.push_back(std::move(ret));
+  } else if (ngroup == 1) {
     std::vector<std::unique_ptr<RegTree> > ret;
     BoostNewTrees(in_gpair, p_fmat, 0, &ret);
     new_trees.push_back(std::move(ret));
@@ -218,6 +267,23 @@ void GBTree::DoBoost(DMatrix* p_fmat,
   this->CommitModel(std::move(new_trees), p_fmat, predt);
 }
 
+void GBTree::DoBoostWithGradient(DMatrix* p_fmat, ElementWiseGradient* grad,
+                                 HostDeviceVector<GradientPair>* out_gpair,
+                                 PredictionCacheEntry* predt) {
+  // Only a single group is grown from the gradient as it is.
+  if (model_.learner_model_param_->num_output_group != 1 ||
+      model_.param.size_leaf_vector != 0) {
+    GradientBooster::DoBoostWithGradient(p_fmat, grad, out_gpair, predt);
+    return;
+  }
+  ConfigureWithKnownData(this->cfg_, p_fmat);
+  monitor_.Start("BoostNewTrees");
+  std::vector<std::vector<std::unique_ptr<RegTree> > > new_trees(1);
+  BoostNewTrees(out_gpair, p_fmat, 0, &new_trees.front(), grad);
+  monitor_.Stop("BoostNewTrees");
+  this->CommitModel(std::move(new_trees), p_fmat, predt);
+}
+
 void GBTree::InitUpdater(Args const& cfg) {
   std::string tval = tparam_.updater_seq;
   std::vector<std::string> ups = common::Split(tval, ',');
@@ -261,7 +327,8 @@ void GBTree::InitUpdater(Args const& cfg) {
 void GBTree::BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
                            DMatrix *p_fmat,
                            int bst_group,
-                           std::vector<std::unique_ptr<RegTree> >* ret) {
+                           std::vector<std::unique_ptr<RegTree> >* ret,
+                           ElementWiseGradient* grad) {
   std::vector<RegTree*> new_trees;
   ret->clear();
   // create the trees
@@ -270,6 +337,7 @@ void GBTree::BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
       // create new tree
       std::unique_ptr<RegTree> ptr(new RegTree());
       ptr->param.UpdateAllowUnknown(this->cfg_);
+      ptr->param.size_leaf_vector = model_.param.size_leaf_vector;
       new_trees.push_back(ptr.get());
       ret->push_back(std::move(ptr));
     } else if (tparam_.process_type == TreeProcessType::kUpdate) {
@@ -281,9 +349,16 @@ void GBTree::BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
       ret->push_back(std::move(t));
     }
   }
-  // update the trees
-  for (auto& up : updaters_) {
-    up->Update(gpair, p_fmat, new_trees);
+  // update the trees, the first updater can compute the gradient in its pass over the rows
+  for (size_t i = 0; i < updaters_.size(); ++i) {
+    if (i == 0 && grad != nullptr &&
+        updaters_[i]->UpdateWithGradient(grad, gpair, p_fmat, new_trees)) {
+      continue;
+    }
+    if (i == 0 && grad != nullptr) {
+      grad->ComputeAll(gpair);
+    }
+    updaters_[i]->Update(gpair, p_fmat, new_trees);
   }
 }
 
@@ -292,26 +367,142 @@ void GBTree::CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& ne
                          PredictionCacheEntry* predts) {
   monitor_.Start("CommitModel");
   int num_new_trees = 0;
-  for (uint32_t gid = 0; gid < model_.learner_model_param_->num_output_group; ++gid) {
+  for (uint32_t gid = 0; gid < new_trees.size(); ++gid) {
     num_new_trees += new_trees[gid].size();
     model_.CommitModel(std::move(new_trees[gid]), gid);
   }
+  // Before the prediction cache, as updating it may release the row positions.
+  if (tparam_.cache_leaf_index) {
+    this->CacheLeafIndex(num_new_trees, m, predts);
+  }
   auto* out = &predts->predictions;
-  if (model_.learner_model_param_->num_output_group == 1 &&
+  if (model_.TreesPerLayer() == 1 &&
       updaters_.size() > 0 &&
       num_new_trees == 1 &&
       out->Size() > 0 &&
       updaters_.back()->UpdatePredictionCache(m, out)) {
-    auto delta = num_new_trees / model_.learner_model_param_->num_output_group;
+    auto delta = num_new_trees / model_.TreesPerLayer();
     predts->Update(delta);
   }
   monitor_.Stop("CommitModel");
 }
 
+void GBTree::CacheLeafIndex(int num_new_trees, DMatrix* m, PredictionCacheEntry* predts) {
+  size_t const n_rows = m->Info().num_row_;
+  size_t const n_trees = model_.trees.size();
+  bool const valid = predts->leaf_trees + num_new_trees == n_trees &&
+                     (predts->leaf_trees == 0 || predts->leaf_generation == model_.Generation());
+  // Updaters only know the row positions in the last tree.
+  if (valid && num_new_trees == 1 && updaters_.size() > 0) {
+    predts->leaf_indices.Resize(n_trees * n_rows);
+    if (updaters_.back()->UpdateLeafIndices(m, &predts->leaf_indices,
+                                            (n_trees - 1) * n_rows)) {
+      predts->leaf_trees = n_trees;
+      predts->leaf_generation = model_.Generation();
+      return;
+    }
+  }
+  // Rebuilt by the next `PredictLeafIndex'.
+  predts->leaf_indices.Resize(0);
+  predts->leaf_trees = 0;
+}
+
+void GBTree::PredictLeafIndex(DMatrix* p_fmat, PredictionCacheEntry* entry) {
+  CHECK(configured_);
+  size_t const n_trees = model_.trees.size();
+  if (entry->leaf_trees == n_trees &&
+      (n_trees == 0 || entry->leaf_generation == model_.Generation())) {
+    return;
+  }
+  std::vector<bst_float> leaves;
+  cpu_predictor_->PredictLeaf(p_fmat, &leaves, model_, 0);
+  auto const n_rows = static_cast<bst_omp_uint>(p_fmat->Info().num_row_);
+  CHECK_EQ(leaves.size(), n_rows * n_trees);
+  entry->leaf_indices.Resize(leaves.size());
+  auto& h_leaf_indices = entry->leaf_indices.HostVector();
+  // `PredictLeaf' is row major.
+#pragma omp parallel for schedule(static)
+  for (bst_omp_uint i = 0; i < n_rows; ++i) {
+    for (size_t j = 0; j < n_trees; ++j) {
+      h_leaf_indices[j * n_rows + i] = static_cast<uint32_t>(leaves[i * n_trees + j]);
+    }
+  }
+  entry->leaf_trees = n_trees;
+  entry->leaf_generation = model_.Generation();
+}
+
+void GBTree::FeatureScore(std::string const& importance_type,
+                          std::vector<bst_feature_t>* features,
+                          std::vector<float>* scores) const {
+  bool const total = importance_type == "total_gain" || importance_type == "total_cover";
+  bool const gain = importance_type == "gain" || importance_type == "total_gain";
+  bool const cover = importance_type == "cover" || importance_type == "total_cover";
+  CHECK(importance_type == "weight" || gain || cover)
+      << "Unknown importance type: " << importance_type;
+
+  size_t const n_features = model_.learner_model_param_->num_feature;
+  auto const n_trees = static_cast<bst_omp_uint>(model_.trees.size());
+  int32_t const n_threads = omp_get_max_threads();
+  // One pair of accumulators for each thread, reduced in order afterward.
+  std::vector<std::vector<size_t>> thread_counts(n_threads);
+  std::vector<std::vector<double>> thread_stats(n_threads);
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+  for (bst_omp_uint i = 0; i < n_trees; ++i) {
+    auto& counts = thread_counts[omp_get_thread_num()];
+    auto& stats = thread_stats[omp_get_thread_num()];
+    counts.resize(n_features, 0);
+    stats.resize(n_features, 0);
+    auto const& tree = *model_.trees[i];
+    tree.WalkTree([&](bst_node_t nidx) {
+      auto const& node = tree[nidx];
+      if (!node.IsLeaf()) {
+        auto split = node.SplitIndex();
+        if (split >= counts.size()) {
+          counts.resize(split + 1, 0);
+          stats.resize(split + 1, 0);
+        }
+        counts[split]++;
+        stats[split] += gain ? tree.Stat(nidx).loss_chg : tree.Stat(nidx).sum_hess;
+      }
+      return true;
+    });
+  }
+
+  std::vector<size_t> split_counts(n_features, 0);
+  std::vector<double> split_stats(n_features, 0);
+  for (int32_t t = 0; t < n_threads; ++t) {
+    if (thread_counts[t].size() > split_counts.size()) {
+      split_counts.resize(thread_counts[t].size(), 0);
+      split_stats.resize(thread_counts[t].size(), 0);
+    }
+    for (size_t f = 0; f < thread_counts[t].size(); ++f) {
+      split_counts[f] += thread_counts[t][f];
+      split_stats[f] += thread_stats[t][f];
+    }
+  }
+
+  features->clear();
+  scores->clear();
+  for (size_t f = 0; f < split_counts.size(); ++f) {
+    if (split_counts[f] == 0) {
+      continue;
+    }
+    features->push_back(f);
+    if (gain || cover) {
+      scores->push_back(total ? split_stats[f] : split_stats[f] / split_counts[f]);
+    } else {
+      scores->push_back(split_counts[f]);
+    }
+  }
+}
+
 void GBTree::LoadConfig(Json const& in) {
   CHECK_EQ(get<String>(in["name"]), "gbtree");
   fromJson(in["gbtree_train_param"], &tparam_);
-  int32_t const n_gpus = xgboost::common::AllVisibleGPUs();
+  // Only GPU models ask for the devices.
+  bool const on_gpu = tparam_.predictor == PredictorType::kGPUPredictor ||
+                      tparam_.tree_method == TreeMethod::kGPUHist;
+  int32_t const n_gpus = on_gpu ? xgboost::common::AllVisibleGPUs() : 0;
   if (n_gpus == 0 && tparam_.predictor == PredictorType::kGPUPredictor) {
     LOG(WARNING)
         << "Loading from a raw memory buffer on CPU only machine.  "
@@ -364,6 +555,43 @@ void GBTree::SaveModel(Json* p_out) const {
   model_.SaveModel(&model);
 }
 
+void GBTree::SaveModelSegment(Json* p_out) {
+  auto& out = *p_out;
+  size_t const tree_begin = model_.Generation() == segment_generation_ ? segment_trees_ : 0;
+  out["name"] = String("gbtree");
+  out["model"] = Object();
+  model_.SaveModelSegment(tree_begin, &out["model"]);
+  segment_generation_ = model_.Generation();
+  segment_trees_ = model_.trees.size();
+}
+
+void GBTree::LoadModelSegment(Json const& in) {
+  CHECK_EQ(get<String>(in["name"]), "gbtree");
+  model_.LoadModelSegment(in["model"]);
+  segment_generation_ = model_.Generation();
+  segment_trees_ = model_.trees.size();
+}
+
+void GBTree::Slice(int32_t layer_begin, int32_t layer_end, int32_t step,
+                   GradientBooster* out, bool* out_of_bound) const {
+  auto* p_gbtree = dynamic_cast<GBTree*>(out);
+  CHECK(p_gbtree) << "Slice requires an output booster of the same type.";
+  CHECK_GE(layer_begin, 0);
+  CHECK_GT(step, 0);
+  auto const n_layers = static_cast<int32_t>(model_.trees.size() / model_.TreesPerLayer());
+  layer_end = layer_end == 0 ? n_layers : layer_end;
+  CHECK_LE(layer_begin, layer_end);
+  *out_of_bound = layer_end > n_layers;
+  if (*out_of_bound) {
+    return;
+  }
+  model_.Slice(layer_begin, layer_end, step, &p_gbtree->model_);
+}
+
+void GBTree::SaveFlatModel(Json const& objective, dmlc::Stream* fo) const {
+  predictor::FlatModel::Save(model_, {}, objective, fo);
+}
+
 void GBTree::PredictBatch(DMatrix* p_fmat,
                           PredictionCacheEntry* out_preds,
                           bool training,
@@ -373,6 +601,63 @@ void GBTree::PredictBatch(DMatrix* p_fmat,
       ->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
 }
 
+void GBTree::PredictStaged(DMatrix* p_fmat, std::vector<unsigned> const& iterations,
+                           HostDeviceVector<bst_float>* out_preds) {
+  CHECK(configured_);
+  uint32_t const layer_trees = model_.TreesPerLayer();
+  std::vector<uint32_t> tree_ends(iterations.size());
+  for (size_t i = 0; i < iterations.size(); ++i) {
+    CHECK_LE(iterations[i] * layer_trees, model_.trees.size())
+        << "Iteration " << iterations[i] << " is beyond the "
+        << model_.trees.size() / std::max(layer_trees, 1u) << " iterations of the model.";
+    tree_ends[i] = iterations[i] * layer_trees;
+  }
+  GetPredictor(nullptr, p_fmat)->PredictStaged(p_fmat, model_, tree_ends, out_preds);
+}
+
+void GBTree::PredictStream(DMatrix* p_fmat, unsigned ntree_limit,
+                           PredictionSink const& sink) {
+  CHECK(configured_);
+  uint32_t tree_end = ntree_limit * model_.TreesPerLayer();
+  if (tree_end == 0 || tree_end > model_.trees.size()) {
+    tree_end = static_cast<uint32_t>(model_.trees.size());
+  }
+  // The pages are handed out on host, so they are predicted there.
+  this->GetRowPredictor()->PredictStream(p_fmat, model_, tree_end, sink);
+}
+
+void GBTree::InplacePredict(dmlc::any const& x, float missing,
+                            HostDeviceVector<bst_float>* out_preds,
+                            unsigned ntree_limit) const {
+  CHECK(configured_);
+  // Each predictor takes the adapters it can read, host ones go to the row predictor.
+  std::vector<Predictor*> predictors {this->GetRowPredictor().get(), cpu_predictor_.get()};
+  for (auto* predictor : predictors) {
+    if (predictor && predictor->InplacePredict(x, model_, missing, out_preds, ntree_limit)) {
+      return;
+    }
+  }
+#if defined(XGBOOST_USE_CUDA)
+  // Only device data is left, the GPU predictor is created for it.
+  if (this->GetGPUPredictor()->InplacePredict(x, model_, missing, out_preds, ntree_limit)) {
+    return;
+  }
+#endif  // defined(XGBOOST_USE_CUDA)
+  LOG(FATAL) << "Unsupported data type for inplace predict.";
+}
+
+#if defined(XGBOOST_USE_CUDA)
+std::unique_ptr<Predictor> const& GBTree::GetGPUPredictor() const {
+  std::lock_guard<std::mutex> guard(gpu_predictor_lock_);
+  if (!gpu_predictor_) {
+    gpu_predictor_ = std::unique_ptr<Predictor>(
+        Predictor::Create("gpu_predictor", this->generic_param_));
+    gpu_predictor_->Configure(cfg_);
+  }
+  return gpu_predictor_;
+}
+#endif  // defined(XGBOOST_USE_CUDA)
+
 std::unique_ptr<Predictor> const &
 GBTree::GetPredictor(HostDeviceVector<float> const *out_pred,
                      DMatrix *f_dmat) const {
@@ -380,25 +665,29 @@ GBTree::GetPredictor(HostDeviceVector<float> const *out_pred,
   if (tparam_.predictor != PredictorType::kAuto) {
     if (tparam_.predictor == PredictorType::kGPUPredictor) {
 #if defined(XGBOOST_USE_CUDA)
-      CHECK(gpu_predictor_);
-      return gpu_predictor_;
+      return this->GetGPUPredictor();
 #else
       this->AssertGPUSupport();
 #endif  // defined(XGBOOST_USE_CUDA)
     }
+    return this->GetRowPredictor();
+  }
+
+  // Multi-output trees are only supported by the CPU predictor.
+  if (model_.param.size_leaf_vector != 0) {
     CHECK(cpu_predictor_);
     return cpu_predictor_;
   }
 
+  // Don't ask for rows that the DMatrix doesn't keep, like a quantile DMatrix.
   auto on_device =
-      f_dmat &&
+      f_dmat && f_dmat->PageExists<SparsePage>() &&
       (*(f_dmat->GetBatches<SparsePage>().begin())).data.DeviceCanRead();
 
   // Use GPU Predictor if data is already on device.
   if (on_device) {
 #if defined(XGBOOST_USE_CUDA)
-    CHECK(gpu_predictor_);
-    return gpu_predictor_;
+    return this->GetGPUPredictor();
 #else
     LOG(FATAL) << "Data is on CUDA device, but XGBoost is not compiled with "
                   "CUDA support.";
@@ -422,8 +711,7 @@ GBTree::GetPredictor(HostDeviceVector<float> const *out_pred,
 
   if (tparam_.tree_method == TreeMethod::kGPUHist) {
 #if defined(XGBOOST_USE_CUDA)
-    CHECK(gpu_predictor_);
-    return gpu_predictor_;
+    return this->GetGPUPredictor();
 #else
     this->AssertGPUSupport();
     return cpu_predictor_;
@@ -441,6 +729,8 @@ class Dart : public GBTree {
 
   void Configure(const Args& cfg) override {
     GBTree::Configure(cfg);
+    CHECK_EQ(model_.param.size_leaf_vector, 0)
+        << "Multi-output trees are not supported by the dart booster.";
     dparam_.UpdateAllowUnknown(cfg);
   }
 
@@ -450,26 +740,37 @@ class Dart : public GBTree {
     out["gbtree"] = Object();
     GBTree::SaveModel(&(out["gbtree"]));
 
-    std::vector<Json> j_weight_drop(weight_drop_.size());
-    for (size_t i = 0; i < weight_drop_.size(); ++i) {
-      j_weight_drop[i] = Number(weight_drop_[i]);
-    }
-    out["weight_drop"] = Array(std::move(j_weight_drop));
+    out["weight_drop"] = F32Array(std::vector<float>(weight_drop_));
   }
   void LoadModel(Json const& in) override {
     CHECK_EQ(get<String>(in["name"]), "dart");
     auto const& gbtree = in["gbtree"];
     GBTree::LoadModel(gbtree);
+    this->ClearMarginCache();
 
-    auto const& j_weight_drop = get<Array>(in["weight_drop"]);
-    weight_drop_.resize(j_weight_drop.size());
-    for (size_t i = 0; i < weight_drop_.size(); ++i) {
-      weight_drop_[i] = get<Number const>(j_weight_drop[i]);
-    }
+    GetNumericArray(in["weight_drop"], &weight_drop_);
+  }
+  // The weights of all trees are saved in every segment, they are rescaled while
+  // training.
+  void SaveModelSegment(Json *p_out) override {
+    auto &out = *p_out;
+    out["name"] = String("dart");
+    out["gbtree"] = Object();
+    GBTree::SaveModelSegment(&(out["gbtree"]));
+
+    out["weight_drop"] = F32Array(std::vector<float>(weight_drop_));
+  }
+  void LoadModelSegment(Json const& in) override {
+    CHECK_EQ(get<String>(in["name"]), "dart");
+    GBTree::LoadModelSegment(in["gbtree"]);
+    this->ClearMarginCache();
+
+    GetNumericArray(in["weight_drop"], &weight_drop_);
   }
 
   void Load(dmlc::Stream* fi) override {
     GBTree::Load(fi);
+    this->ClearMarginCache();
     weight_drop_.resize(model_.param.num_trees);
     if (model_.param.num_trees != 0) {
       fi->Read(&weight_drop_);
@@ -482,6 +783,32 @@ class Dart : public GBTree {
     }
   }
 
+  void Slice(int32_t layer_begin, int32_t layer_end, int32_t step,
+             GradientBooster* out, bool* out_of_bound) const override {
+    GBTree::Slice(layer_begin, layer_end, step, out, out_of_bound);
+    if (*out_of_bound) {
+      return;
+    }
+    auto* p_dart = dynamic_cast<Dart*>(out);
+    CHECK(p_dart) << "Slice requires an output booster of the same type.";
+    uint32_t const layer_trees = model_.TreesPerLayer();
+    if (layer_end == 0) {
+      layer_end = static_cast<int32_t>(model_.trees.size() / layer_trees);
+    }
+    p_dart->weight_drop_.clear();
+    for (int32_t layer = layer_begin; layer < layer_end; layer += step) {
+      for (uint32_t i = layer * layer_trees; i < (layer + 1) * layer_trees; ++i) {
+        p_dart->weight_drop_.push_back(weight_drop_[i]);
+      }
+    }
+    p_dart->ClearMarginCache();
+  }
+
+  void SaveFlatModel(Json const& objective, dmlc::Stream* fo) const override {
+    // The weight of each tree is folded into its leaves.
+    predictor::FlatModel::Save(model_, weight_drop_, objective, fo);
+  }
+
   void LoadConfig(Json const& in) override {
     CHECK_EQ(get<String>(in["name"]), "dart");
     auto const& gbtree = in["gbtree"];
@@ -501,49 +828,96 @@ class Dart : public GBTree {
                     PredictionCacheEntry* p_out_preds,
                     bool training,
                     unsigned ntree_limit) override {
-    DropTrees(training);
+    // Trees are only dropped for the gradient computation of training, other predictions
+    // leave the model untouched and can run concurrently, taking turns on the cached
+    // margins.
+    std::vector<size_t> const no_drop;
+    if (training) {
+      DropTrees(true);
+    }
+    std::vector<size_t> const& idx_drop = training ? idx_drop_ : no_drop;
     int num_group = model_.learner_model_param_->num_output_group;
     ntree_limit *= num_group;
     if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
       ntree_limit = static_cast<unsigned>(model_.trees.size());
     }
-    size_t n = num_group * p_fmat->Info().num_row_;
-    const auto &base_margin = p_fmat->Info().base_margin_.ConstHostVector();
-    auto& out_preds = p_out_preds->predictions.HostVector();
-    out_preds.resize(n);
-    if (base_margin.size() != 0) {
-      CHECK_EQ(out_preds.size(), n);
-      std::copy(base_margin.begin(), base_margin.end(), out_preds.begin());
-    } else {
-      std::fill(out_preds.begin(), out_preds.end(),
-                model_.learner_model_param_->base_score);
+    auto* out_preds = &p_out_preds->predictions;
+    if (ntree_limit == model_.trees.size()) {
+      // The whole ensemble is cached, only the dropped trees are predicted.
+      std::lock_guard<std::mutex> guard(margin_lock_);
+      MarginCache* cache = this->SyncMargin(p_fmat, p_out_preds->ref);
+      if (cache != nullptr) {
+        out_preds->Resize(cache->margin.Size());
+        out_preds->Copy(cache->margin);
+        std::vector<bst_float> neg_weights(idx_drop.size());
+        for (size_t k = 0; k < idx_drop.size(); ++k) {
+          neg_weights[k] = -weight_drop_[idx_drop[k]];
+        }
+        this->GetPredictor(out_preds, p_fmat)
+            ->PredictWeighted(p_fmat, out_preds, model_, idx_drop, neg_weights);
+        cache->idx_dropped = idx_drop;
+        return;
+      }
+    }
+    this->InitMargin(p_fmat, out_preds);
+    std::vector<size_t> trees;
+    std::vector<bst_float> weights;
+    for (size_t i = 0; i < ntree_limit; ++i) {
+      if (!std::binary_search(idx_drop.cbegin(), idx_drop.cend(), i)) {
+        trees.push_back(i);
+        weights.push_back(weight_drop_[i]);
+      }
     }
-    const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread);
-    PredLoopSpecalize(p_fmat, &out_preds, num_group, 0, ntree_limit);
+    this->GetPredictor(out_preds, p_fmat)
+        ->PredictWeighted(p_fmat, out_preds, model_, trees, weights);
   }
 
-  void PredictInstance(const SparsePage::Inst &inst,
-                       std::vector<bst_float> *out_preds,
-                       unsigned ntree_limit) override {
-    DropTrees(false);
-    if (thread_temp_.size() == 0) {
-      thread_temp_.resize(1, RegTree::FVec());
-      thread_temp_[0].Init(model_.learner_model_param_->num_feature);
-    }
-    out_preds->resize(model_.learner_model_param_->num_output_group);
-    ntree_limit *= model_.learner_model_param_->num_output_group;
+  void PredictRow(const SparsePage::Inst &inst,
+                  common::Span<bst_float> out_preds,
+                  unsigned ntree_limit) const override {
+    RegTree::FVec& feats = ThreadTemp(1).front();
+    uint32_t const num_group = model_.learner_model_param_->num_output_group;
+    CHECK_GE(out_preds.size(), num_group);
+    ntree_limit *= num_group;
     if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
       ntree_limit = static_cast<unsigned>(model_.trees.size());
     }
-    // loop over output groups
-    for (uint32_t gid = 0; gid < model_.learner_model_param_->num_output_group; ++gid) {
-      (*out_preds)[gid] =
-          PredValue(inst, gid, &thread_temp_[0], 0, ntree_limit) +
-          model_.learner_model_param_->base_score;
+    // No tree is dropped outside of training.
+    std::fill(out_preds.begin(), out_preds.begin() + num_group, 0.0f);
+    feats.Fill(inst);
+    for (unsigned i = 0; i < ntree_limit; ++i) {
+      int const tid = model_.trees[i]->GetLeafIndex(feats);
+      out_preds[model_.tree_info[i]] += weight_drop_[i] * (*model_.trees[i])[tid].LeafValue();
+    }
+    feats.Drop(inst);
+    for (uint32_t gid = 0; gid < num_group; ++gid) {
+      out_preds[gid] += model_.learner_model_param_->base_score;
     }
   }
 
+  void PredictInstance(const SparsePage::Inst &inst,
+                       std::vector<bst_float> *out_preds,
+                       unsigned ntree_limit) override {
+    out_preds->resize(model_.learner_model_param_->num_output_group);
+    this->PredictRow(inst, common::Span<bst_float>(*out_preds), ntree_limit);
+  }
+
+  void InplacePredict(dmlc::any const& x, float missing,
+                      HostDeviceVector<bst_float>* out_preds,
+                      unsigned ntree_limit) const override {
+    LOG(FATAL) << "Inplace predict is not supported by dart, the trees are weighted.";
+  }
+
+  void PredictStaged(DMatrix* p_fmat, std::vector<unsigned> const& iterations,
+                     HostDeviceVector<bst_float>* out_preds) override {
+    LOG(FATAL) << "Staged prediction is not supported by dart, the trees are weighted.";
+  }
+
+  void PredictStream(DMatrix* p_fmat, unsigned ntree_limit,
+                     PredictionSink const& sink) override {
+    LOG(FATAL) << "Streaming prediction is not supported by dart, the trees are weighted.";
+  }
+
   bool UseGPU() const override {
     return GBTree::UseGPU();
   }
@@ -553,73 +927,22 @@ class Dart : public GBTree {
                            unsigned ntree_limit, bool approximate, int condition,
                            unsigned condition_feature) override {
     CHECK(configured_);
-    cpu_predictor_->PredictContribution(p_fmat, out_contribs, model_,
-                                        ntree_limit, &weight_drop_, approximate);
+    this->GetContributionPredictor(p_fmat, approximate)
+        ->PredictContribution(p_fmat, out_contribs, model_, ntree_limit, &weight_drop_,
+                              approximate);
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat,
                                        std::vector<bst_float>* out_contribs,
                                        unsigned ntree_limit, bool approximate) override {
     CHECK(configured_);
-    cpu_predictor_->PredictInteractionContributions(p_fmat, out_contribs, model_,
-                                                    ntree_limit, &weight_drop_, approximate);
+    this->GetContributionPredictor(p_fmat, approximate)
+        ->PredictInteractionContributions(p_fmat, out_contribs, model_, ntree_limit,
+                                          &weight_drop_, approximate);
   }
 
 
  protected:
-  inline void PredLoopSpecalize(
-      DMatrix* p_fmat,
-      std::vector<bst_float>* out_preds,
-      int num_group,
-      unsigned tree_begin,
-      unsigned tree_end) {
-    CHECK_EQ(num_group, model_.learner_model_param_->num_output_group);
-    std::vector<bst_float>& preds = *out_preds;
-    CHECK_EQ(model_.param.size_leaf_vector, 0)
-        << "size_leaf_vector is enforced to 0 so far";
-    CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
-    // start collecting the prediction
-    for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
-      constexpr int kUnroll = 8;
-      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-      const bst_omp_uint rest = nsize % kUnroll;
-      if (nsize >= kUnroll) {
-#pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
-          const int tid = omp_get_thread_num();
-          RegTree::FVec& feats = thread_temp_[tid];
-          int64_t ridx[kUnroll];
-          SparsePage::Inst inst[kUnroll];
-          for (int k = 0; k < kUnroll; ++k) {
-            ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
-          }
-          for (int k = 0; k < kUnroll; ++k) {
-            inst[k] = batch[i + k];
-          }
-          for (int k = 0; k < kUnroll; ++k) {
-            for (int gid = 0; gid < num_group; ++gid) {
-              const size_t offset = ridx[k] * num_group + gid;
-              preds[offset] +=
-                  this->PredValue(inst[k], gid, &feats, tree_begin, tree_end);
-            }
-          }
-        }
-      }
-
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp_[0];
-        const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
-        const SparsePage::Inst inst = batch[i];
-        for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              this->PredValue(inst, gid,
-                              &feats, tree_begin, tree_end);
-        }
-      }
-    }
-  }
-
   // commit new trees all at once
   void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees,
@@ -630,28 +953,108 @@ class Dart : public GBTree {
       num_new_trees += new_trees[gid].size();
       model_.CommitModel(std::move(new_trees[gid]), gid);
     }
-    size_t num_drop = NormalizeTrees(num_new_trees);
+    std::vector<size_t> const idx_drop = idx_drop_;
+    float factor = 1.0f;
+    size_t num_drop = NormalizeTrees(num_new_trees, &factor);
     LOG(INFO) << "drop " << num_drop << " trees, "
               << "weight = " << weight_drop_.back();
+
+    std::lock_guard<std::mutex> guard(margin_lock_);
+    if (tparam_.process_type == TreeProcessType::kUpdate) {
+      // existing trees are changed in place
+      margin_cache_.clear();
+      return;
+    }
+    auto it = margin_cache_.find(m);
+    if (it == margin_cache_.cend() || it->second.ref.expired()) {
+      return;
+    }
+    MarginCache& cache = it->second;
+    size_t const n_old = model_.trees.size() - num_new_trees;
+    // All dropped trees are scaled by the same factor, their contribution to the margin
+    // of the training data is the margin less the prediction for this gradient.  On
+    // device the next prediction predicts the changed weights again instead.
+    auto const& predt = predts->predictions;
+    if (!idx_drop.empty() && cache.idx_dropped == idx_drop && cache.weights.size() == n_old &&
+        predt.Size() == cache.margin.Size() && predt.HostCanRead() &&
+        cache.margin.HostCanRead()) {
+      auto& margin = cache.margin.HostVector();
+      auto const& h_predt = predt.ConstHostVector();
+      auto const n = static_cast<omp_ulong>(margin.size());
+      float const delta = factor - 1.0f;
+#pragma omp parallel for schedule(static)
+      for (omp_ulong i = 0; i < n; ++i) {  // NOLINT
+        margin[i] += delta * (margin[i] - h_predt[i]);
+      }
+      for (auto i : idx_drop) {
+        cache.weights[i] = weight_drop_[i];
+      }
+    }
+    cache.idx_dropped.clear();
+    // New trees are added by the next prediction.  The leaf positions of the updaters
+    // can't be reused, the hist updaters add them to their own copy of the predictions.
   }
 
-  // predict the leaf scores without dropped trees
-  bst_float PredValue(const SparsePage::Inst &inst, int bst_group,
-                      RegTree::FVec *p_feats, unsigned tree_begin,
-                      unsigned tree_end) const {
-    bst_float psum = 0.0f;
-    p_feats->Fill(inst);
-    for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (model_.tree_info[i] == bst_group) {
-        bool drop = std::binary_search(idx_drop_.begin(), idx_drop_.end(), i);
-        if (!drop) {
-          int tid = model_.trees[i]->GetLeafIndex(*p_feats);
-          psum += weight_drop_[i] * (*model_.trees[i])[tid].LeafValue();
-        }
+  /*! \brief Margin of the whole ensemble on one DMatrix, with the weights of the trees. */
+  struct MarginCache {
+    std::weak_ptr<DMatrix> ref;
+    HostDeviceVector<bst_float> margin;
+    // weight of each tree in `margin', trees past the end aren't included yet
+    std::vector<bst_float> weights;
+    // trees dropped by the last training prediction
+    std::vector<size_t> idx_dropped;
+  };
+
+  void ClearMarginCache() {
+    std::lock_guard<std::mutex> guard(margin_lock_);
+    margin_cache_.clear();
+  }
+
+  /*! \brief Fill `out' with the base margin of `p_fmat', or the global bias. */
+  void InitMargin(DMatrix* p_fmat, HostDeviceVector<bst_float>* out) const {
+    size_t const n = model_.learner_model_param_->num_output_group * p_fmat->Info().num_row_;
+    auto const& base_margin = p_fmat->Info().base_margin_;
+    out->Resize(n);
+    if (base_margin.Size() != 0) {
+      CHECK_EQ(base_margin.Size(), n);
+      out->Copy(base_margin);
+    } else {
+      out->Fill(model_.learner_model_param_->base_score);
+    }
+  }
+
+  /*!
+   * \brief Bring the cached margin of `p_fmat' up to date with the model by adding the
+   *  new trees and the weight changes of old ones.  Returns nullptr if the DMatrix isn't
+   *  held by a prediction cache.  Called with `margin_lock_' held.
+   */
+  MarginCache* SyncMargin(DMatrix* p_fmat, std::weak_ptr<DMatrix> const& ref) {
+    if (ref.expired() || ref.lock().get() != p_fmat) {
+      return nullptr;
+    }
+    for (auto it = margin_cache_.begin(); it != margin_cache_.end();) {
+      it = it->second.ref.expired() ? margin_cache_.erase(it) : std::next(it);
+    }
+    MarginCache& cache = margin_cache_[p_fmat];
+    size_t const n_trees = model_.trees.size();
+    if (cache.ref.lock().get() != p_fmat || cache.weights.size() > n_trees) {
+      cache = MarginCache();
+      cache.ref = ref;
+      this->InitMargin(p_fmat, &cache.margin);
+    }
+    std::vector<size_t> trees;
+    std::vector<bst_float> scale;
+    for (size_t i = 0; i < n_trees; ++i) {
+      bst_float const cached = i < cache.weights.size() ? cache.weights[i] : 0.0f;
+      if (weight_drop_[i] != cached) {
+        trees.push_back(i);
+        scale.push_back(weight_drop_[i] - cached);
       }
     }
-    p_feats->Drop(inst);
-    return psum;
+    this->GetPredictor(&cache.margin, p_fmat)
+        ->PredictWeighted(p_fmat, &cache.margin, model_, trees, scale);
+    cache.weights.assign(weight_drop_.cbegin(), weight_drop_.cbegin() + n_trees);
+    return &cache;
   }
 
   // select which trees to drop
@@ -703,8 +1106,8 @@ class Dart : public GBTree {
     }
   }
 
-  // set normalization factors
-  inline size_t NormalizeTrees(size_t size_new_trees) {
+  // set normalization factors, `out_factor' is the scale of the dropped trees
+  inline size_t NormalizeTrees(size_t size_new_trees, float* out_factor) {
     float lr = 1.0 * dparam_.learning_rate / size_new_trees;
     size_t num_drop = idx_drop_.size();
     if (num_drop == 0) {
@@ -715,6 +1118,7 @@ class Dart : public GBTree {
       if (dparam_.normalize_type == 1) {
         // normalize_type 1
         float factor = 1.0 / (1.0 + lr);
+        *out_factor = factor;
         for (auto i : idx_drop_) {
           weight_drop_[i] *= factor;
         }
@@ -724,6 +1128,7 @@ class Dart : public GBTree {
       } else {
         // normalize_type 0
         float factor = 1.0 * num_drop / (num_drop + lr);
+        *out_factor = factor;
         for (auto i : idx_drop_) {
           weight_drop_[i] *= factor;
         }
@@ -737,15 +1142,20 @@ class Dart : public GBTree {
     return num_drop;
   }
 
-  // init thread buffers
-  inline void InitThreadTemp(int nthread) {
-    int prev_thread_temp_size = thread_temp_.size();
-    if (prev_thread_temp_size < nthread) {
-      thread_temp_.resize(nthread, RegTree::FVec());
-      for (int i = prev_thread_temp_size; i < nthread; ++i) {
-        thread_temp_[i].Init(model_.learner_model_param_->num_feature);
+  // init thread buffers, owned by the calling thread so that concurrent predictions
+  // never share them
+  std::vector<RegTree::FVec>& ThreadTemp(int nthread) const {
+    static thread_local std::vector<RegTree::FVec> thread_temp;
+    if (thread_temp.size() < static_cast<size_t>(nthread)) {
+      thread_temp.resize(nthread, RegTree::FVec());
+    }
+    auto const num_feature = model_.learner_model_param_->num_feature;
+    for (int i = 0; i < nthread; ++i) {
+      if (thread_temp[i].Size() != num_feature) {
+        thread_temp[i].Init(num_feature);
       }
     }
+    return thread_temp;
   }
 
   // --- data structure ---
@@ -755,8 +1165,9 @@ class Dart : public GBTree {
   std::vector<bst_float> weight_drop_;
   // indexes of dropped trees
   std::vector<size_t> idx_drop_;
-  // temporal storage for per thread
-  std::vector<RegTree::FVec> thread_temp_;
+  // margin of the whole ensemble for each cached DMatrix
+  std::unordered_map<DMatrix*, MarginCache> margin_cache_;
+  std::mutex margin_lock_;
 };
 
 // register the objective functions
@@ -12,6 +12,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <string>
 #include <unordered_map>
@@ -44,13 +45,22 @@ enum class TreeProcessType : int {
 enum class PredictorType : int {
   kAuto = 0,
   kCPUPredictor,
-  kGPUPredictor
+  kGPUPredictor,
+  kCompiledPredictor,
+  kQuantizedPredictor
+};
+
+// how trees of a multi-class model are organised
+enum class MultiStrategy : int {
+  kOneOutputPerTree = 0,
+  kMultiOutputTree = 1
 };
 }  // namespace xgboost
 
 DECLARE_FIELD_ENUM_CLASS(xgboost::TreeMethod);
 DECLARE_FIELD_ENUM_CLASS(xgboost::TreeProcessType);
 DECLARE_FIELD_ENUM_CLASS(xgboost::PredictorType);
+DECLARE_FIELD_ENUM_CLASS(xgboost::MultiStrategy);
 
 namespace xgboost {
 namespace gbm {
@@ -70,6 +80,10 @@ struct GBTreeTrainParam : public XGBoostParameter<GBTreeTrainParam> {
   PredictorType predictor;
   // tree construction method
   TreeMethod tree_method;
+  // whether a multi-class model grows one tree for each class or trees with vector leaves
+  MultiStrategy multi_strategy;
+  // whether to record the leaf index of the training rows in each new tree
+  bool cache_leaf_index;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GBTreeTrainParam) {
     DMLC_DECLARE_FIELD(num_parallel_tree)
@@ -92,6 +106,8 @@ struct GBTreeTrainParam : public XGBoostParameter<GBTreeTrainParam> {
         .add_enum("auto", PredictorType::kAuto)
         .add_enum("cpu_predictor", PredictorType::kCPUPredictor)
         .add_enum("gpu_predictor", PredictorType::kGPUPredictor)
+        .add_enum("compiled_predictor", PredictorType::kCompiledPredictor)
+        .add_enum("quantized_predictor", PredictorType::kQuantizedPredictor)
         .describe("Predictor algorithm type");
     DMLC_DECLARE_FIELD(tree_method)
         .set_default(TreeMethod::kAuto)
@@ -101,6 +117,16 @@ struct GBTreeTrainParam : public XGBoostParameter<GBTreeTrainParam> {
         .add_enum("hist",      TreeMethod::kHist)
         .add_enum("gpu_hist",  TreeMethod::kGPUHist)
         .describe("Choice of tree construction method.");
+    DMLC_DECLARE_FIELD(multi_strategy)
+        .set_default(MultiStrategy::kOneOutputPerTree)
+        .add_enum("one_output_per_tree", MultiStrategy::kOneOutputPerTree)
+        .add_enum("multi_output_tree", MultiStrategy::kMultiOutputTree)
+        .describe("Grow one tree for each class in every iteration, or a single tree "
+                  "whose leaves hold the values of all classes.");
+    DMLC_DECLARE_FIELD(cache_leaf_index)
+        .set_default(false)
+        .describe("Record the leaf index of every training row in each new tree, so leaf "
+                  "index prediction on the training matrix doesn't walk the trees.");
   }
 };
 
@@ -167,6 +193,9 @@ class GBTree : public GradientBooster {
   void DoBoost(DMatrix* p_fmat,
                HostDeviceVector<GradientPair>* in_gpair,
                PredictionCacheEntry* predt) override;
+  void DoBoostWithGradient(DMatrix* p_fmat, ElementWiseGradient* grad,
+                           HostDeviceVector<GradientPair>* out_gpair,
+                           PredictionCacheEntry* predt) override;
 
   bool UseGPU() const override {
     return
@@ -187,11 +216,17 @@ class GBTree : public GradientBooster {
     model_.Save(fo);
   }
 
+  void Slice(int32_t layer_begin, int32_t layer_end, int32_t step,
+             GradientBooster* out, bool* out_of_bound) const override;
+  void SaveFlatModel(Json const& objective, dmlc::Stream* fo) const override;
+
   void LoadConfig(Json const& in) override;
   void SaveConfig(Json* p_out) const override;
 
   void SaveModel(Json* p_out) const override;
   void LoadModel(Json const& in) override;
+  void SaveModelSegment(Json* p_out) override;
+  void LoadModelSegment(Json const& in) override;
 
   bool AllowLazyCheckPoint() const override {
     return model_.learner_model_param_->num_output_group == 1 ||
@@ -203,14 +238,34 @@ class GBTree : public GradientBooster {
                     bool training,
                     unsigned ntree_limit) override;
 
+  void PredictStaged(DMatrix* p_fmat, std::vector<unsigned> const& iterations,
+                     HostDeviceVector<bst_float>* out_preds) override;
+
+  void PredictStream(DMatrix* p_fmat, unsigned ntree_limit,
+                     PredictionSink const& sink) override;
+
+  void Compact(Json* report) override {
+    model_.Compact(report);
+  }
+
   void PredictInstance(const SparsePage::Inst& inst,
                        std::vector<bst_float>* out_preds,
                        unsigned ntree_limit) override {
     CHECK(configured_);
-    cpu_predictor_->PredictInstance(inst, out_preds, model_,
-                                    ntree_limit);
+    this->GetRowPredictor()->PredictInstance(inst, out_preds, model_, ntree_limit);
   }
 
+  void PredictRow(const SparsePage::Inst& inst,
+                  common::Span<bst_float> out_preds,
+                  unsigned ntree_limit) const override {
+    CHECK(configured_);
+    this->GetRowPredictor()->PredictRow(inst, out_preds, model_, ntree_limit);
+  }
+
+  void InplacePredict(dmlc::any const& x, float missing,
+                      HostDeviceVector<bst_float>* out_preds,
+                      unsigned ntree_limit) const override;
+
   void PredictLeaf(DMatrix* p_fmat,
                    std::vector<bst_float>* out_preds,
                    unsigned ntree_limit) override {
@@ -218,21 +273,29 @@ class GBTree : public GradientBooster {
     cpu_predictor_->PredictLeaf(p_fmat, out_preds, model_, ntree_limit);
   }
 
+  void PredictLeafIndex(DMatrix* p_fmat, PredictionCacheEntry* entry) override;
+
+  void FeatureScore(std::string const& importance_type,
+                    std::vector<bst_feature_t>* features,
+                    std::vector<float>* scores) const override;
+
   void PredictContribution(DMatrix* p_fmat,
                            std::vector<bst_float>* out_contribs,
                            unsigned ntree_limit, bool approximate, int condition,
                            unsigned condition_feature) override {
     CHECK(configured_);
-    cpu_predictor_->PredictContribution(p_fmat, out_contribs, model_,
-                                        ntree_limit, nullptr, approximate);
+    this->GetContributionPredictor(p_fmat, approximate)
+        ->PredictContribution(p_fmat, out_contribs, model_, ntree_limit, nullptr,
+                              approximate);
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat,
                                        std::vector<bst_float>* out_contribs,
                                        unsigned ntree_limit, bool approximate) override {
     CHECK(configured_);
-    cpu_predictor_->PredictInteractionContributions(p_fmat, out_contribs, model_,
-                                                    ntree_limit, nullptr, approximate);
+    this->GetContributionPredictor(p_fmat, approximate)
+        ->PredictInteractionContributions(p_fmat, out_contribs, model_, ntree_limit,
+                                          nullptr, approximate);
   }
 
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
@@ -240,27 +303,59 @@ class GBTree : public GradientBooster {
                                      std::string format) const override {
     return model_.DumpModel(fmap, with_stats, format);
   }
+  void StreamDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                       std::function<void(size_t, std::string const&)> visitor) const override {
+    model_.StreamDumpModel(fmap, with_stats, format, visitor);
+  }
 
  protected:
   // initialize updater before using them
   void InitUpdater(Args const& cfg);
 
-  // do group specific group
+  // do group specific group, the gradient is computed from `grad' when it's not null
   void BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
                      DMatrix *p_fmat,
                      int bst_group,
-                     std::vector<std::unique_ptr<RegTree> >* ret);
+                     std::vector<std::unique_ptr<RegTree> >* ret,
+                     ElementWiseGradient* grad = nullptr);
 
   std::unique_ptr<Predictor> const& GetPredictor(HostDeviceVector<float> const* out_pred = nullptr,
                                                  DMatrix* f_dmat = nullptr) const;
+#if defined(XGBOOST_USE_CUDA)
+  // Creates the GPU predictor on first use.
+  std::unique_ptr<Predictor> const& GetGPUPredictor() const;
+#endif  // defined(XGBOOST_USE_CUDA)
+  // Single rows are predicted on CPU, by the compiled or quantized model when selected.
+  std::unique_ptr<Predictor> const& GetRowPredictor() const {
+    if (tparam_.predictor == PredictorType::kCompiledPredictor) {
+      CHECK(compiled_predictor_);
+      return compiled_predictor_;
+    }
+    if (tparam_.predictor == PredictorType::kQuantizedPredictor) {
+      CHECK(quantized_predictor_);
+      return quantized_predictor_;
+    }
+    CHECK(cpu_predictor_);
+    return cpu_predictor_;
+  }
+  // Contributions, exact or approximated, are computed on device along with predictions.
+  std::unique_ptr<Predictor> const& GetContributionPredictor(DMatrix* f_dmat,
+                                                             bool approximate) const {
+    return this->GetPredictor(nullptr, f_dmat);
+  }
 
   // commit new trees all at once
   virtual void CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees,
                            DMatrix* m,
                            PredictionCacheEntry* predts);
+  // append the leaf indices of the new trees to the cache when the updater knows them
+  void CacheLeafIndex(int num_new_trees, DMatrix* m, PredictionCacheEntry* predts);
 
   // --- data structure ---
   GBTreeModel model_;
+  // trees in the last checkpoint segment, valid while the model keeps its generation
+  uint64_t segment_generation_ {0};
+  size_t segment_trees_ {0};
   // training parameter
   GBTreeTrainParam tparam_;
   // ----training fields----
@@ -273,8 +368,12 @@ class GBTree : public GradientBooster {
   std::vector<std::unique_ptr<TreeUpdater>> updaters_;
   // Predictors
   std::unique_ptr<Predictor> cpu_predictor_;
+  std::unique_ptr<Predictor> compiled_predictor_;
+  std::unique_ptr<Predictor> quantized_predictor_;
 #if defined(XGBOOST_USE_CUDA)
-  std::unique_ptr<Predictor> gpu_predictor_;
+  // created by `GetGPUPredictor'
+  mutable std::unique_ptr<Predictor> gpu_predictor_;
+  mutable std::mutex gpu_predictor_lock_;
 #endif  // defined(XGBOOST_USE_CUDA)
   common::Monitor monitor_;
 };
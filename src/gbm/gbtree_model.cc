@@ -1,6 +1,12 @@
 /*!
  * Copyright 2019 by Contributors
  */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
 #include "xgboost/json.h"
 #include "xgboost/logging.h"
 #include "gbtree_model.h"
@@ -8,6 +14,11 @@
 namespace xgboost {
 namespace gbm {
 
+uint64_t GBTreeModel::NextGeneration() {
+  static std::atomic<uint64_t> generation {0};
+  return ++generation;
+}
+
 void GBTreeModel::Save(dmlc::Stream* fo) const {
   CHECK_EQ(param.num_trees, static_cast<int32_t>(trees.size()));
   fo->Write(&param, sizeof(param));
@@ -24,6 +35,7 @@ void GBTreeModel::Load(dmlc::Stream* fi) {
       << "GBTree: invalid model file";
   trees.clear();
   trees_to_update.clear();
+  generation_ = NextGeneration();
   for (int32_t i = 0; i < param.num_trees; ++i) {
     std::unique_ptr<RegTree> ptr(new RegTree());
     ptr->Load(fi);
@@ -35,30 +47,145 @@ void GBTreeModel::Load(dmlc::Stream* fi) {
         fi->Read(dmlc::BeginPtr(tree_info), sizeof(int32_t) * param.num_trees),
         sizeof(int32_t) * param.num_trees);
   }
+  this->TrackTrees();
 }
 
-void GBTreeModel::SaveModel(Json* p_out) const {
-  auto& out = *p_out;
-  CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
-  out["gbtree_model_param"] = toJson(param);
-  std::vector<Json> trees_json;
-  size_t t = 0;
+void GBTreeModel::TrackTrees() {
+  size_t bytes = tree_info.size() * sizeof(int);
   for (auto const& tree : trees) {
-    Json tree_json{Object()};
-    tree->SaveModel(&tree_json);
-    // The field is not used in XGBoost, but might be useful for external project.
-    tree_json["id"] = Integer(t);
-    trees_json.emplace_back(tree_json);
-    t++;
+    bytes += tree->MemCostBytes();
+  }
+  for (auto const& tree : trees_to_update) {
+    bytes += tree->MemCostBytes();
+  }
+  tracked_.Set(bytes);
+}
+
+void GBTreeModel::Slice(uint32_t layer_begin, uint32_t layer_end, uint32_t step,
+                        GBTreeModel* out) const {
+  CHECK_GT(step, 0U);
+  CHECK_LE(layer_begin, layer_end);
+  uint32_t const layer_trees = this->TreesPerLayer();
+  CHECK_LE(layer_end * layer_trees, trees.size());
+  out->param = param;
+  out->trees.clear();
+  out->trees_to_update.clear();
+  out->tree_info.clear();
+  out->tracked_.Set(0);
+  out->generation_ = NextGeneration();
+  for (uint32_t layer = layer_begin; layer < layer_end; layer += step) {
+    for (uint32_t i = layer * layer_trees; i < (layer + 1) * layer_trees; ++i) {
+      out->trees.push_back(trees[i]);
+      out->tree_info.push_back(tree_info[i]);
+    }
+  }
+  out->param.num_trees = static_cast<int32_t>(out->trees.size());
+}
+
+void GBTreeModel::Compact(Json* p_report) {
+  CHECK(trees_to_update.empty()) << "Can not compact a model while it's being updated.";
+  size_t nodes_before = 0, nodes_after = 0, bytes_before = 0, bytes_after = 0;
+  for (auto const& tree : trees) {
+    nodes_before += tree->param.num_nodes;
+    bytes_before += tree->MemCostBytes();
+  }
+  std::vector<bst_node_t> folded(trees.size(), 0);
+  dmlc::OMPException exc;
+  auto const n_trees = static_cast<omp_ulong>(trees.size());
+#pragma omp parallel for schedule(dynamic)
+  for (omp_ulong t = 0; t < n_trees; ++t) {
+    exc.Run([&]() {
+      // the trees can be shared with slices of this model
+      std::shared_ptr<RegTree> tree{new RegTree(*trees[t])};
+      folded[t] = tree->Compact();
+      trees[t] = std::move(tree);
+    });
+  }
+  exc.Rethrow();
+  generation_ = NextGeneration();
+
+  std::vector<bool> used(learner_model_param_->num_feature, false);
+  for (auto const& tree : trees) {
+    nodes_after += tree->param.num_nodes;
+    bytes_after += tree->MemCostBytes();
+    for (auto const& node : tree->GetNodes()) {
+      if (!node.IsLeaf()) {
+        auto const fidx = node.SplitIndex();
+        if (fidx >= used.size()) {
+          used.resize(fidx + 1, false);
+        }
+        used[fidx] = true;
+      }
+    }
+  }
+  std::vector<Json> used_features;
+  for (size_t fidx = 0; fidx < used.size(); ++fidx) {
+    if (used[fidx]) {
+      used_features.emplace_back(Integer(static_cast<Integer::Int>(fidx)));
+    }
+  }
+  this->TrackTrees();
+
+  auto& report = *p_report;
+  report = Object();
+  report["num_trees"] = Integer(static_cast<Integer::Int>(trees.size()));
+  report["num_nodes_before"] = Integer(static_cast<Integer::Int>(nodes_before));
+  report["num_nodes_after"] = Integer(static_cast<Integer::Int>(nodes_after));
+  report["folded_splits"] = Integer(static_cast<Integer::Int>(
+      std::accumulate(folded.cbegin(), folded.cend(), static_cast<size_t>(0))));
+  report["bytes_before"] = Integer(static_cast<Integer::Int>(bytes_before));
+  report["bytes_after"] = Integer(static_cast<Integer::Int>(bytes_after));
+  report["num_feature"] = Integer(static_cast<Integer::Int>(learner_model_param_->num_feature));
+  report["used_features"] = Array(std::move(used_features));
+}
+
+namespace {
+// Trees are independent documents, each thread fills its own elements.
+std::vector<Json> SaveTrees(std::vector<std::shared_ptr<RegTree>> const& trees,
+                            size_t tree_begin) {
+  std::vector<Json> trees_json(trees.size() - tree_begin);
+  dmlc::OMPException exc;
+  auto const n_trees = static_cast<omp_ulong>(trees_json.size());
+#pragma omp parallel for schedule(dynamic)
+  for (omp_ulong t = 0; t < n_trees; ++t) {
+    exc.Run([&]() {
+      Json tree_json{Object()};
+      trees[tree_begin + t]->SaveModel(&tree_json);
+      // The field is not used in XGBoost, but might be useful for external project.
+      tree_json["id"] = Integer(static_cast<size_t>(tree_begin + t));
+      trees_json[t] = std::move(tree_json);
+    });
   }
+  exc.Rethrow();
+  return trees_json;
+}
+
+void LoadTrees(Json const& in, size_t tree_begin,
+               std::vector<std::shared_ptr<RegTree>>* p_trees) {
+  auto const& trees_json = get<Array const>(in["trees"]);
+  auto& trees = *p_trees;
+  trees.resize(tree_begin + trees_json.size());
 
-  std::vector<Json> tree_info_json(tree_info.size());
-  for (size_t i = 0; i < tree_info.size(); ++i) {
-    tree_info_json[i] = Integer(tree_info[i]);
+  dmlc::OMPException exc;
+  auto const n_trees = static_cast<omp_ulong>(trees_json.size());
+#pragma omp parallel for schedule(dynamic)
+  for (omp_ulong t = 0; t < n_trees; ++t) {
+    exc.Run([&]() {
+      std::shared_ptr<RegTree> tree{new RegTree()};
+      tree->LoadModel(trees_json[t]);
+      trees[tree_begin + t] = std::move(tree);
+    });
   }
+  exc.Rethrow();
+}
+}  // anonymous namespace
 
-  out["trees"] = Array(std::move(trees_json));
-  out["tree_info"] = Array(std::move(tree_info_json));
+void GBTreeModel::SaveModel(Json* p_out) const {
+  auto& out = *p_out;
+  CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
+  out["gbtree_model_param"] = toJson(param);
+  out["trees"] = Array(SaveTrees(trees, 0));
+  out["tree_info"] = I32Array(std::vector<int32_t>(tree_info.cbegin(), tree_info.cend()));
 }
 
 void GBTreeModel::LoadModel(Json const& in) {
@@ -66,19 +193,74 @@ void GBTreeModel::LoadModel(Json const& in) {
 
   trees.clear();
   trees_to_update.clear();
+  generation_ = NextGeneration();
+  LoadTrees(in, 0, &trees);
 
-  auto const& trees_json = get<Array const>(in["trees"]);
-  trees.resize(trees_json.size());
+  GetNumericArray(in["tree_info"], &tree_info);
+  CHECK_EQ(tree_info.size(), static_cast<size_t>(param.num_trees));
+  this->TrackTrees();
+}
 
-  for (size_t t = 0; t < trees.size(); ++t) {
-    trees[t].reset( new RegTree() );
-    trees[t]->LoadModel(trees_json[t]);
+void GBTreeModel::SaveModelSegment(size_t tree_begin, Json* p_out) const {
+  auto& out = *p_out;
+  CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
+  CHECK_LE(tree_begin, trees.size());
+  out["gbtree_model_param"] = toJson(param);
+  out["tree_begin"] = Integer(static_cast<int64_t>(tree_begin));
+  out["trees"] = Array(SaveTrees(trees, tree_begin));
+  out["tree_info"] = I32Array(std::vector<int32_t>(tree_info.cbegin(), tree_info.cend()));
+}
+
+void GBTreeModel::LoadModelSegment(Json const& in) {
+  auto const tree_begin = static_cast<size_t>(get<Integer const>(in["tree_begin"]));
+  CHECK_LE(tree_begin, trees.size())
+      << "Invalid checkpoint, the segment begins after the last tree loaded so far.";
+  fromJson(in["gbtree_model_param"], &param);
+
+  trees_to_update.clear();
+  if (tree_begin != trees.size()) {
+    generation_ = NextGeneration();
   }
+  LoadTrees(in, tree_begin, &trees);
 
-  tree_info.resize(param.num_trees);
-  auto const& tree_info_json = get<Array const>(in["tree_info"]);
-  for (int32_t i = 0; i < param.num_trees; ++i) {
-    tree_info[i] = get<Integer const>(tree_info_json[i]);
+  GetNumericArray(in["tree_info"], &tree_info);
+  CHECK_EQ(tree_info.size(), static_cast<size_t>(param.num_trees));
+  CHECK_EQ(trees.size(), static_cast<size_t>(param.num_trees))
+      << "Invalid checkpoint, the number of trees doesn't match the model parameter.";
+  this->TrackTrees();
+}
+
+std::vector<std::string> GBTreeModel::DumpModel(const FeatureMap& fmap, bool with_stats,
+                                                std::string format) const {
+  std::vector<std::string> dump(trees.size());
+  dmlc::OMPException exc;
+  auto const n_trees = static_cast<omp_ulong>(trees.size());
+#pragma omp parallel for schedule(dynamic)
+  for (omp_ulong t = 0; t < n_trees; ++t) {
+    exc.Run([&]() { dump[t] = trees[t]->DumpModel(fmap, with_stats, format); });
+  }
+  exc.Rethrow();
+  return dump;
+}
+
+void GBTreeModel::StreamDumpModel(
+    const FeatureMap& fmap, bool with_stats, std::string format,
+    std::function<void(size_t, std::string const&)> visitor) const {
+  size_t const batch_size = std::max(omp_get_max_threads(), 1) * 8;
+  std::vector<std::string> dump;
+  for (size_t begin = 0; begin < trees.size(); begin += batch_size) {
+    size_t const end = std::min(begin + batch_size, trees.size());
+    dump.resize(end - begin);
+    dmlc::OMPException exc;
+    auto const n_trees = static_cast<omp_ulong>(end - begin);
+#pragma omp parallel for schedule(dynamic)
+    for (omp_ulong t = 0; t < n_trees; ++t) {
+      exc.Run([&]() { dump[t] = trees[begin + t]->DumpModel(fmap, with_stats, format); });
+    }
+    exc.Rethrow();
+    for (size_t t = 0; t < dump.size(); ++t) {
+      visitor(begin + t, dump[t]);
+    }
   }
 }
 
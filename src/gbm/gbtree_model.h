@@ -12,11 +12,14 @@
 #include <xgboost/parameter.h>
 #include <xgboost/learner.h>
 
+#include <functional>
 #include <memory>
 #include <utility>
 #include <string>
 #include <vector>
 
+#include "../common/memory_tracker.h"
+
 namespace xgboost {
 
 class Json;
@@ -59,14 +62,15 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
     DMLC_DECLARE_FIELD(size_leaf_vector)
         .set_lower_bound(0)
         .set_default(0)
-        .describe("Reserved option for vector tree.");
+        .describe("Number of outputs held by the leaves of multi-output trees, 0 for "
+                  "trees of a single output group.");
   }
 };
 
 struct GBTreeModel : public Model {
  public:
   explicit GBTreeModel(LearnerModelParam const* learner_model_param) :
-      learner_model_param_{learner_model_param} {}
+      learner_model_param_{learner_model_param}, generation_{NextGeneration()} {}
   void Configure(const Args& cfg) {
     // initialize model parameters if not yet been initialized.
     if (trees.size() == 0) {
@@ -76,29 +80,55 @@ struct GBTreeModel : public Model {
 
   void InitTreesToUpdate() {
     if (trees_to_update.size() == 0u) {
+      generation_ = NextGeneration();
       for (auto & tree : trees) {
-        trees_to_update.push_back(std::move(tree));
+        // the trees can be shared with slices of this model
+        trees_to_update.emplace_back(new RegTree(*tree));
       }
       trees.clear();
       param.num_trees = 0;
       tree_info.clear();
+      this->TrackTrees();
     }
   }
 
   void Load(dmlc::Stream* fi);
   void Save(dmlc::Stream* fo) const;
+  /*!
+   * \brief Make `out' a view of the layers [layer_begin, layer_end) taken every `step'
+   *  layers.  The trees are shared with this model instead of copied.
+   */
+  void Slice(uint32_t layer_begin, uint32_t layer_end, uint32_t step,
+             GBTreeModel* out) const;
 
   void SaveModel(Json* p_out) const override;
   void LoadModel(Json const& p_out) override;
+  /*!
+   * \brief Save the model like `SaveModel', but with only the trees from `tree_begin' on.
+   *  Used by append-only checkpoints.
+   */
+  void SaveModelSegment(size_t tree_begin, Json* p_out) const;
+  /*!
+   * \brief Apply a segment saved by `SaveModelSegment': trees from the beginning of the
+   *  segment on are replaced by the ones in it.  The generation is kept when trees are
+   *  only appended.
+   */
+  void LoadModelSegment(Json const& in);
 
   std::vector<std::string> DumpModel(const FeatureMap& fmap, bool with_stats,
-                                     std::string format) const {
-    std::vector<std::string> dump;
-    for (const auto & tree : trees) {
-      dump.push_back(tree->DumpModel(fmap, with_stats, format));
-    }
-    return dump;
-  }
+                                     std::string format) const;
+  /*!
+   * \brief Dump the trees in parallel, a batch at a time, passing the dump of each tree
+   *  to `visitor' in order.  Only one batch of dumps is held in memory.
+   */
+  void StreamDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                       std::function<void(size_t, std::string const&)> visitor) const;
+  /*!
+   * \brief Compact every tree with `RegTree::Compact'.  Trees shared with slices are
+   *  copied first.  The statistics written into `report' are the number of nodes, the
+   *  folded splits, the bytes held by the trees and the features used by any split.
+   */
+  void Compact(Json* report);
   void CommitModel(std::vector<std::unique_ptr<RegTree> >&& new_trees,
                    int bst_group) {
     for (auto & new_tree : new_trees) {
@@ -106,18 +136,40 @@ struct GBTreeModel : public Model {
       tree_info.push_back(bst_group);
     }
     param.num_trees += static_cast<int>(new_trees.size());
+    this->TrackTrees();
   }
+  /*!
+   * \brief Number of trees in one layer of the forest, one for each output group unless
+   *  the trees are multi-output ones holding every output in their leaves.
+   */
+  uint32_t TreesPerLayer() const {
+    return param.size_leaf_vector == 0 ? learner_model_param_->num_output_group : 1;
+  }
+  /*!
+   * \brief Identifies the current trees of the model, for caches built from them.  It's
+   *  unique among models and renewed whenever existing trees are replaced or loaded,
+   *  while appending new trees with `CommitModel' keeps it.
+   */
+  uint64_t Generation() const { return generation_; }
 
   // base margin
   LearnerModelParam const* learner_model_param_;
   // model parameter
   GBTreeModelParam param;
-  /*! \brief vector of trees stored in the model */
-  std::vector<std::unique_ptr<RegTree> > trees;
+  /*! \brief vector of trees stored in the model, shared with the slices of the model */
+  std::vector<std::shared_ptr<RegTree> > trees;
   /*! \brief for the update process, a place to keep the initial trees */
   std::vector<std::unique_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+
+ private:
+  static uint64_t NextGeneration();
+  // Count the trees owned by this model, slices sharing them are not counted.
+  void TrackTrees();
+
+  uint64_t generation_;
+  common::TrackedBytes tracked_ {"Model"};
 };
 }  // namespace gbm
 }  // namespace xgboost
@@ -8,9 +8,12 @@
 #include <dmlc/parameter.h>
 
 #include <algorithm>
+#include <atomic>
+#include <future>
 #include <iomanip>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <stack>
@@ -25,6 +28,7 @@
 #include "xgboost/generic_parameters.h"
 #include "xgboost/host_device_vector.h"
 #include "xgboost/json.h"
+#include "xgboost/json_io.h"
 #include "xgboost/learner.h"
 #include "xgboost/logging.h"
 #include "xgboost/metric.h"
@@ -32,15 +36,33 @@
 #include "xgboost/parameter.h"
 
 #include "common/common.h"
+#include "common/hist_batch.h"
+#include "common/hist_util.h"
 #include "common/io.h"
+#include "common/memory_tracker.h"
 #include "common/observer.h"
 #include "common/random.h"
+#include "common/threading_utils.h"
 #include "common/timer.h"
 #include "common/version.h"
+#include "data/fold_dmatrix.h"
+#include "metric/metric_common.h"
 
 namespace {
 
 const char* kMaxDeltaStepDefaultValue = "0.7";
+
+constexpr int32_t kCheckpointSegmentMagic = 0x504b4358;  // "XCKP"
+constexpr int32_t kCheckpointSegmentVersion = 1;
+/*!
+ * \brief Header of a segment in an append-only checkpoint, followed by the segment
+ *  encoded in UBJSON.
+ */
+struct CheckpointSegmentHeader {
+  int32_t magic;
+  int32_t version;
+  uint64_t size;
+};
 }  // anonymous namespace
 
 namespace xgboost {
@@ -58,6 +80,31 @@ bool Learner::AllowLazyCheckPoint() const {
   return gbm_->AllowLazyCheckPoint();
 }
 
+void Learner::SaveDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                            dmlc::Stream* fo) const {
+  bool const is_json = format == "json";
+  std::string buffer;
+  if (is_json) {
+    fo->Write("[\n", 2);
+  }
+  this->StreamDumpModel(fmap, with_stats, format,
+                        [&](size_t i, std::string const& dump) {
+    buffer.clear();
+    if (is_json) {
+      if (i != 0) {
+        buffer += ",\n";
+      }
+    } else {
+      buffer += "booster[" + std::to_string(i) + "]:\n";
+    }
+    buffer += dump;
+    fo->Write(buffer.data(), buffer.size());
+  });
+  if (is_json) {
+    fo->Write("\n]\n", 3);
+  }
+}
+
 Learner::~Learner() = default;
 
 /*! \brief training parameter for regression
@@ -136,6 +183,12 @@ struct LearnerTrainParam : public XGBoostParameter<LearnerTrainParam> {
   DataSplitMode dsplit;
   // flag to disable default metric
   int disable_default_eval_metric;
+  // evaluate the metrics once in this many iterations
+  int eval_period;
+  // bound of the prediction caches in MB
+  int prediction_cache_mb;
+  // evaluate with a CPU copy of the model while training on GPU
+  int eval_on_cpu;
   // FIXME(trivialfis): The following parameters belong to model itself, but can be
   // specified by users.  Move them to model parameter once we can get rid of binary IO.
   std::string booster;
@@ -152,6 +205,19 @@ struct LearnerTrainParam : public XGBoostParameter<LearnerTrainParam> {
     DMLC_DECLARE_FIELD(disable_default_eval_metric)
         .set_default(0)
         .describe("Flag to disable default metric. Set to >0 to disable");
+    DMLC_DECLARE_FIELD(eval_period)
+        .set_default(1)
+        .set_lower_bound(1)
+        .describe("Evaluate the metrics only on iterations that are a multiple of it.");
+    DMLC_DECLARE_FIELD(prediction_cache_mb)
+        .set_default(0)
+        .set_lower_bound(0)
+        .describe("Upper bound in MB of the predictions kept for the matrices predicted "
+                  "on, least recently used ones are freed first.  0 for no bound.");
+    DMLC_DECLARE_FIELD(eval_on_cpu)
+        .set_default(0)
+        .describe("Evaluate asynchronously with a CPU copy of the model while the trees "
+                  "are built on GPU.  Set to >0 to enable.");
     DMLC_DECLARE_FIELD(booster)
         .set_default("gbtree")
         .describe("Gradient booster used for training.");
@@ -178,6 +244,10 @@ void GenericParameter::ConfigureGpuId(bool require_gpu) {
     }
   }
 
+  // CPU only training and prediction don't touch the devices.
+  if (gpu_id == kCpuId) {
+    return;
+  }
   // 3. When booster is loaded from a memory image (Python pickle or R
   // raw model), number of available GPUs could be different.  Wrap around it.
   int32_t n_gpus = common::AllVisibleGPUs();
@@ -192,6 +262,10 @@ void GenericParameter::ConfigureGpuId(bool require_gpu) {
 #endif  // defined(XGBOOST_USE_CUDA)
 }
 
+int32_t GenericParameter::Threads() const {
+  return common::OmpGetNumThreads(nthread);
+}
+
 /*!
  * \brief learner that performs gradient boosting for a specific objective
  * function. It does training and prediction.
@@ -205,24 +279,38 @@ class LearnerImpl : public Learner {
       cache_.Cache(d, GenericParameter::kCpuId);
     }
   }
+  ~LearnerImpl() override {
+    this->WaitPendingEval();
+    common::HostMemoryTracker::Log();
+  }
   // Configuration before data is known.
   void Configure() override {
     if (!this->need_configuration_) { return; }
+    // metrics and parameters may be replaced
+    this->WaitPendingEval();
+    cpu_replica_.reset();
+    json_config_.clear();
+    // the gradient computed during evaluation may use stale parameters
+    gpair_dmat_ = nullptr;
 
     monitor_.Start("Configure");
     auto old_tparam = tparam_;
     Args args = {cfg_.cbegin(), cfg_.cend()};
 
     tparam_.UpdateAllowUnknown(args);
+    {
+      std::lock_guard<std::mutex> guard(cache_lock_);
+      size_t const cache_bytes = static_cast<size_t>(tparam_.prediction_cache_mb) << 20;
+      cache_.SetMaxBytes(cache_bytes);
+      output_predictions_.SetMaxBytes(cache_bytes);
+    }
     auto mparam_backup = mparam_;
     mparam_.UpdateAllowUnknown(args);
     generic_parameters_.UpdateAllowUnknown(args);
     generic_parameters_.CheckDeprecated();
+    common::SetDeterministic(generic_parameters_.deterministic);
 
     ConsoleLogger::Configure(args);
-    if (generic_parameters_.nthread != 0) {
-      omp_set_num_threads(generic_parameters_.nthread);
-    }
 
     // add additional parameters
     // These are cosntraints that need to be satisfied.
@@ -342,12 +430,25 @@ class LearnerImpl : public Learner {
       if (tparam_.dsplit == DataSplitMode::kCol) {
         // 'distcol' updater hidden until it becomes functional again
         // See discussion at https://github.com/dmlc/xgboost/issues/1832
-        LOG(FATAL) << "Column-wise data split is currently not supported.";
+        auto it = cfg_.find("tree_method");
+        CHECK(it != cfg_.cend() && it->second == "hist")
+            << "Column-wise data split is only supported by `tree_method='hist'`.";
       }
     }
   }
 
   void LoadModel(Json const& in) override {
+    this->LoadModelImpl(in, false);
+  }
+
+  void SaveModel(Json* p_out) const override {
+    CHECK(!this->need_configuration_) << "Call Configure before saving model.";
+    this->SaveModelImpl(p_out, false);
+  }
+
+  // The model of a checkpoint segment has the booster saved as a segment, loaded on top
+  // of the booster of the previous segments.
+  void LoadModelImpl(Json const& in, bool segment) {
     CHECK(IsA<Object>(in));
     Version::Load(in, false);
     auto const& learner = get<Object>(in["learner"]);
@@ -363,9 +464,14 @@ class LearnerImpl : public Learner {
     auto const& gradient_booster = learner.at("gradient_booster");
     name = get<String>(gradient_booster["name"]);
     tparam_.UpdateAllowUnknown(Args{{"booster", name}});
-    gbm_.reset(GradientBooster::Create(tparam_.booster,
-                                       &generic_parameters_, &learner_model_param_));
-    gbm_->LoadModel(gradient_booster);
+    if (segment) {
+      CHECK(gbm_) << "Invalid checkpoint, no booster is loaded before the segment.";
+      gbm_->LoadModelSegment(gradient_booster);
+    } else {
+      gbm_.reset(GradientBooster::Create(tparam_.booster,
+                                         &generic_parameters_, &learner_model_param_));
+      gbm_->LoadModel(gradient_booster);
+    }
 
     auto const& j_attributes = get<Object const>(learner.at("attributes"));
     attributes_.clear();
@@ -376,9 +482,7 @@ class LearnerImpl : public Learner {
     this->need_configuration_ = true;
   }
 
-  void SaveModel(Json* p_out) const override {
-    CHECK(!this->need_configuration_) << "Call Configure before saving model.";
-
+  void SaveModelImpl(Json* p_out, bool segment) const {
     Version::Save(p_out);
     Json& out { *p_out };
 
@@ -388,7 +492,11 @@ class LearnerImpl : public Learner {
     learner["learner_model_param"] = mparam_.ToJson();
     learner["gradient_booster"] = Object();
     auto& gradient_booster = learner["gradient_booster"];
-    gbm_->SaveModel(&gradient_booster);
+    if (segment) {
+      gbm_->SaveModelSegment(&gradient_booster);
+    } else {
+      gbm_->SaveModel(&gradient_booster);
+    }
 
     learner["objective"] = Object();
     auto& objective_fn = learner["objective"];
@@ -402,6 +510,7 @@ class LearnerImpl : public Learner {
 
   void LoadConfig(Json const& in) override {
     CHECK(IsA<Object>(in));
+    this->WaitPendingEval();
     Version::Load(in, true);
 
     auto const& learner_parameters = get<Object>(in["learner"]);
@@ -466,6 +575,25 @@ class LearnerImpl : public Learner {
     learner_parameters["generic_param"] = toJson(generic_parameters_);
   }
 
+  void SaveJsonConfig(std::string* out) override {
+    this->Configure();
+    if (json_config_.empty()) {
+      Json config { Object() };
+      this->SaveConfig(&config);
+      Json::Dump(config, &json_config_);
+    }
+    *out = json_config_;
+  }
+
+  void LoadJsonConfig(std::string const& config) override {
+    // Loading the configuration just saved, like a round trip through the C API or
+    // pickle, changes nothing.
+    if (!this->need_configuration_ && !json_config_.empty() && config == json_config_) {
+      return;
+    }
+    this->LoadConfig(Json::Load(StringView{config.c_str(), config.size()}));
+  }
+
   // About to be deprecated by JSON format
   void LoadModel(dmlc::Stream* fi) override {
     generic_parameters_.UpdateAllowUnknown(Args{});
@@ -485,12 +613,17 @@ class LearnerImpl : public Learner {
     }
 
     if (header[0] == '{') {
-      // Dispatch to JSON
+      // Dispatch to JSON, either text or UBJSON
       auto json_stream = common::FixedSizeStream(&fp);
       std::string buffer;
       json_stream.Take(&buffer);
-      auto model = Json::Load({buffer.c_str(), buffer.size()});
-      this->LoadModel(model);
+      if (IsUBJObject(buffer.c_str(), buffer.size())) {
+        UBJReader reader{StringView{buffer.c_str(), buffer.size()}};
+        this->LoadModel(Json::Load(&reader));
+      } else {
+        auto model = Json::Load({buffer.c_str(), buffer.size()}, true);
+        this->LoadModel(model);
+      }
       return;
     }
     // use the peekable reader.
@@ -576,6 +709,8 @@ class LearnerImpl : public Learner {
       tparam_.dsplit = DataSplitMode::kRow;
     }
 
+    gpair_dmat_ = nullptr;
+    this->need_configuration_ = true;
     this->Configure();
   }
 
@@ -637,35 +772,25 @@ class LearnerImpl : public Learner {
     }
   }
 
+  // Memory snapshot is written as UBJSON, or as text JSON when
+  // `enable_experimental_json_serialization' is set.  Snapshots of binary model followed
+  // by the JSON configuration from older versions can still be loaded.
   void Save(dmlc::Stream* fo) const override {
+    Json memory_snapshot{Object()};
+    memory_snapshot["Model"] = Object();
+    auto &model = memory_snapshot["Model"];
+    this->SaveModel(&model);
+    memory_snapshot["Config"] = Object();
+    auto &config = memory_snapshot["Config"];
+    this->SaveConfig(&config);
+    std::string out_str;
     if (generic_parameters_.enable_experimental_json_serialization) {
-      Json memory_snapshot{Object()};
-      memory_snapshot["Model"] = Object();
-      auto &model = memory_snapshot["Model"];
-      this->SaveModel(&model);
-      memory_snapshot["Config"] = Object();
-      auto &config = memory_snapshot["Config"];
-      this->SaveConfig(&config);
-      std::string out_str;
       Json::Dump(memory_snapshot, &out_str);
-      fo->Write(out_str.c_str(), out_str.size());
     } else {
-      std::string binary_buf;
-      common::MemoryBufferStream s(&binary_buf);
-      this->SaveModel(&s);
-      Json config{ Object() };
-      // Do not use std::size_t as it's not portable.
-      int64_t const json_offset = binary_buf.size();
-      this->SaveConfig(&config);
-      std::string config_str;
-      Json::Dump(config, &config_str);
-      // concatonate the model and config at final output, it's a temporary solution for
-      // continuing support for binary model format
-      fo->Write(&serialisation_header_[0], serialisation_header_.size());
-      fo->Write(&json_offset, sizeof(json_offset));
-      fo->Write(&binary_buf[0], binary_buf.size());
-      fo->Write(&config_str[0], config_str.size());
+      UBJWriter writer{&out_str};
+      writer.Save(memory_snapshot);
     }
+    fo->Write(out_str.c_str(), out_str.size());
   }
 
   void Load(dmlc::Stream* fi) override {
@@ -675,7 +800,13 @@ class LearnerImpl : public Learner {
     if (c == '{') {
       std::string buffer;
       common::FixedSizeStream{&fp}.Take(&buffer);
-      auto memory_snapshot = Json::Load({buffer.c_str(), buffer.size()});
+      Json memory_snapshot;
+      if (IsUBJObject(buffer.c_str(), buffer.size())) {
+        UBJReader reader{StringView{buffer.c_str(), buffer.size()}};
+        memory_snapshot = Json::Load(&reader);
+      } else {
+        memory_snapshot = Json::Load({buffer.c_str(), buffer.size()}, true);
+      }
       this->LoadModel(memory_snapshot["Model"]);
       this->LoadConfig(memory_snapshot["Config"]);
     } else {
@@ -712,6 +843,168 @@ class LearnerImpl : public Learner {
     }
   }
 
+  void SaveCheckpointSegment(dmlc::Stream* fo) override {
+    this->Configure();
+    Json segment{Object()};
+    segment["Model"] = Object();
+    this->SaveModelImpl(&segment["Model"], true);
+    segment["Config"] = Object();
+    this->SaveConfig(&segment["Config"]);
+    std::string out_str;
+    UBJWriter writer{&out_str};
+    writer.Save(segment);
+
+    CheckpointSegmentHeader header;
+    header.magic = kCheckpointSegmentMagic;
+    header.version = kCheckpointSegmentVersion;
+    header.size = out_str.size();
+    fo->Write(&header, sizeof(header));
+    fo->Write(out_str.c_str(), out_str.size());
+  }
+
+  size_t LoadCheckpoint(dmlc::Stream* fi) override {
+    std::string buffer;
+    Json config;
+    size_t n_segments = 0;
+    while (true) {
+      CheckpointSegmentHeader header;
+      size_t const n_read = fi->Read(&header, sizeof(header));
+      if (n_read == 0) {
+        break;
+      }
+      bool complete = n_read == sizeof(header);
+      if (complete) {
+        CHECK_EQ(header.magic, kCheckpointSegmentMagic)
+            << "Invalid checkpoint, magic number mismatch at segment " << n_segments;
+        CHECK_LE(header.version, kCheckpointSegmentVersion)
+            << "Checkpoint is written by a newer version of XGBoost.";
+        buffer.resize(header.size);
+        complete = buffer.empty() || fi->Read(&buffer[0], buffer.size()) == buffer.size();
+      }
+      if (!complete) {
+        // The last segment is incomplete when saving it is interrupted.
+        LOG(WARNING) << "Ignoring the truncated segment " << n_segments << " of checkpoint.";
+        break;
+      }
+      UBJReader reader{StringView{buffer.c_str(), buffer.size()}};
+      Json segment = Json::Load(&reader);
+      if (n_segments == 0) {
+        gbm_.reset();
+      }
+      this->LoadModelImpl(segment["Model"], true);
+      config = std::move(segment["Config"]);
+      ++n_segments;
+    }
+    CHECK_NE(n_segments, 0) << "Invalid checkpoint, no segment is found.";
+    this->LoadConfig(config);
+    return n_segments;
+  }
+
+  void SaveFlatModel(dmlc::Stream* fo) override {
+    this->Configure();
+    Json objective { Object() };
+    obj_->SaveConfig(&objective);
+    gbm_->SaveFlatModel(objective, fo);
+  }
+
+  Learner* Slice(int32_t begin_layer, int32_t end_layer, int32_t step,
+                 bool* out_of_bound) override {
+    this->Configure();
+    CHECK_GE(begin_layer, 0);
+    std::unique_ptr<LearnerImpl> out_impl{new LearnerImpl({})};
+    out_impl->learner_model_param_ = this->learner_model_param_;
+    out_impl->generic_parameters_ = this->generic_parameters_;
+    std::unique_ptr<GradientBooster> gbm{GradientBooster::Create(
+        tparam_.booster, &out_impl->generic_parameters_, &out_impl->learner_model_param_)};
+    gbm_->Slice(begin_layer, end_layer, step, gbm.get(), out_of_bound);
+    if (*out_of_bound) {
+      return nullptr;
+    }
+    out_impl->gbm_ = std::move(gbm);
+
+    Json config { Object() };
+    this->SaveConfig(&config);
+    out_impl->mparam_ = this->mparam_;
+    out_impl->attributes_ = this->attributes_;
+    out_impl->LoadConfig(config);
+    out_impl->Configure();
+    // They describe the layers of the original model.
+    out_impl->attributes_.erase("best_iteration");
+    out_impl->attributes_.erase("best_ntree_limit");
+    out_impl->attributes_.erase("best_score");
+    return out_impl.release();
+  }
+
+  void Compact(Json* report) override {
+    this->Configure();
+    // an evaluation may still be reading the trees
+    this->WaitPendingEval();
+    gbm_->Compact(report);
+  }
+
+  void SaveTrainingCache(std::shared_ptr<DMatrix> data, dmlc::Stream* fo,
+                         bool quantized) override {
+    this->Configure();
+    // an evaluation may still be reading the predictions
+    this->WaitPendingEval();
+    auto& entry = this->CacheEntry(data);
+    int32_t const magic {kTrainingCacheMagic};
+    fo->Write(magic);
+    fo->Write(this->ModelFingerprint());
+    fo->Write(DataFingerprint(data.get()));
+    fo->Write(entry.version);
+    fo->Write(entry.predictions.ConstHostVector());
+    int32_t max_bin {0};
+    auto const* cuts = data->GHistIndexCuts(&max_bin);
+    fo->Write(cuts ? max_bin : int32_t{0});
+    if (cuts) {
+      cuts->Save(fo);
+      // Caches without the quantized matrix may end after the cuts.
+      auto const* page = quantized ? data->GHistIndexPage(&max_bin) : nullptr;
+      fo->Write(static_cast<int32_t>(page != nullptr));
+      if (page) {
+        page->Save(fo);
+      }
+    }
+  }
+
+  bool LoadTrainingCache(std::shared_ptr<DMatrix> data, dmlc::Stream* fi) override {
+    this->Configure();
+    int32_t magic {0};
+    CHECK(fi->Read(&magic) && magic == kTrainingCacheMagic) << "Invalid training cache.";
+    uint64_t model_hash {0}, data_hash {0};
+    CHECK(fi->Read(&model_hash) && fi->Read(&data_hash)) << "Invalid training cache.";
+    if (data_hash != DataFingerprint(data.get())) {
+      LOG(INFO) << "Training cache is saved for different data, ignored.";
+      return false;
+    }
+    uint32_t version {0};
+    std::vector<bst_float> predt;
+    int32_t max_bin {0};
+    CHECK(fi->Read(&version) && fi->Read(&predt) && fi->Read(&max_bin))
+        << "Invalid training cache.";
+    if (max_bin != 0) {
+      common::HistogramCuts cuts;
+      CHECK(cuts.Load(fi)) << "Invalid training cache.";
+      int32_t has_page {0};
+      bool const restored = fi->Read(&has_page) && has_page != 0 &&
+                            data->LoadGHistIndexPage(fi, max_bin);
+      if (!restored) {
+        data->SetGHistIndexCuts(cuts, max_bin);
+      }
+    }
+    if (model_hash != this->ModelFingerprint()) {
+      LOG(INFO) << "Training cache is saved for a different model, only the quantized "
+                   "data is restored.";
+      return false;
+    }
+    this->WaitPendingEval();
+    auto& entry = this->CacheEntry(data);
+    entry.predictions.HostVector() = std::move(predt);
+    entry.version = version;
+    return true;
+  }
+
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                      bool with_stats,
                                      std::string format) const override {
@@ -719,89 +1012,118 @@ class LearnerImpl : public Learner {
         << "The model hasn't been built yet.  Are you using raw Booster interface?";
     return gbm_->DumpModel(fmap, with_stats, format);
   }
+  void StreamDumpModel(const FeatureMap& fmap, bool with_stats, std::string format,
+                       std::function<void(size_t, std::string const&)> visitor)
+      const override {
+    CHECK(!this->need_configuration_)
+        << "The model hasn't been built yet.  Are you using raw Booster interface?";
+    gbm_->StreamDumpModel(fmap, with_stats, format, visitor);
+  }
 
   void UpdateOneIter(int iter, std::shared_ptr<DMatrix> train) override {
     monitor_.Start("UpdateOneIter");
     TrainingObserver::Instance().Update(iter);
     this->Configure();
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
     if (generic_parameters_.seed_per_iteration || rabit::IsDistributed()) {
       common::GlobalRandom().seed(generic_parameters_.seed * kRandSeedMagic + iter);
     }
     this->CheckDataSplitMode();
     this->ValidateDMatrix(train.get());
 
-    auto& predt = this->cache_.Cache(train, generic_parameters_.gpu_id);
+    auto& predt = this->CacheEntry(train);
 
     monitor_.Start("PredictRaw");
     this->PredictRaw(train.get(), &predt, true);
     monitor_.Stop("PredictRaw");
 
     monitor_.Start("GetGradient");
-    obj_->GetGradient(predt.predictions, train->Info(), iter, &gpair_);
+    // The last evaluation might have computed the gradient along with the metrics.
+    bool const has_gpair = gpair_dmat_ == train.get() && gpair_version_ == predt.version;
+    // Otherwise an element-wise gradient is left to the booster, which computes it along
+    // with its first pass over the rows.
+    std::unique_ptr<ElementWiseGradient> grad;
+    if (!has_gpair) {
+      grad = obj_->GetElementWiseGradient(predt.predictions, train->Info(), iter);
+    }
+    if (!has_gpair && !grad) {
+      obj_->GetGradient(predt.predictions, train->Info(), iter, &gpair_);
+    }
+    gpair_dmat_ = nullptr;
+    last_train_ = train.get();
     monitor_.Stop("GetGradient");
-    TrainingObserver::Instance().Observe(gpair_, "Gradients");
 
-    gbm_->DoBoost(train.get(), &gpair_, &predt);
+    monitor_.Start("DoBoost");
+    if (grad) {
+      gbm_->DoBoostWithGradient(train.get(), grad.get(), &gpair_, &predt);
+      TrainingObserver::Instance().Observe(gpair_, "Gradients");
+    } else {
+      TrainingObserver::Instance().Observe(gpair_, "Gradients");
+      gbm_->DoBoost(train.get(), &gpair_, &predt);
+    }
+    monitor_.Stop("DoBoost");
+    // The booster may pick its updaters once it sees the data.
+    json_config_.clear();
+    this->TrackPredictionCache();
     monitor_.Stop("UpdateOneIter");
+    common::Telemetry::Report(iter);
   }
 
   void BoostOneIter(int iter, std::shared_ptr<DMatrix> train,
                     HostDeviceVector<GradientPair>* in_gpair) override {
     monitor_.Start("BoostOneIter");
     this->Configure();
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
     if (generic_parameters_.seed_per_iteration || rabit::IsDistributed()) {
       common::GlobalRandom().seed(generic_parameters_.seed * kRandSeedMagic + iter);
     }
     this->CheckDataSplitMode();
     this->ValidateDMatrix(train.get());
-    this->cache_.Cache(train, generic_parameters_.gpu_id);
-
-    gbm_->DoBoost(train.get(), in_gpair, &cache_.Entry(train.get()));
+    gbm_->DoBoost(train.get(), in_gpair, &this->CacheEntry(train));
+    json_config_.clear();
     monitor_.Stop("BoostOneIter");
   }
 
   std::string EvalOneIter(int iter,
                           const std::vector<std::shared_ptr<DMatrix>>& data_sets,
                           const std::vector<std::string>& data_names) override {
-    monitor_.Start("EvalOneIter");
-    this->Configure();
-
-    std::ostringstream os;
-    os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
-    if (metrics_.size() == 0 && tparam_.disable_default_eval_metric <= 0) {
-      metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric(), &generic_parameters_));
-      metrics_.back()->Configure({cfg_.begin(), cfg_.end()});
-    }
-    for (size_t i = 0; i < data_sets.size(); ++i) {
-      std::shared_ptr<DMatrix> m = data_sets[i];
-      auto &predt = this->cache_.Cache(m, generic_parameters_.gpu_id);
-      this->ValidateDMatrix(m.get());
-      this->PredictRaw(m.get(), &predt, false);
+    return this->EvalImpl(iter, data_sets, data_names, false).get();
+  }
 
-      auto &out = output_predictions_.Cache(m, generic_parameters_.gpu_id).predictions;
-      out.Resize(predt.predictions.Size());
-      out.Copy(predt.predictions);
+  std::shared_future<std::string>
+  EvalOneIterAsync(int iter, const std::vector<std::shared_ptr<DMatrix>>& data_sets,
+                   const std::vector<std::string>& data_names) override {
+    return this->EvalImpl(iter, data_sets, data_names, true);
+  }
 
-      obj_->EvalTransform(&out);
-      for (auto& ev : metrics_) {
-        os << '\t' << data_names[i] << '-' << ev->Name() << ':'
-           << ev->Eval(out, m->Info(), tparam_.dsplit == DataSplitMode::kRow);
+  void EvalOneIterValues(int iter, const std::vector<std::shared_ptr<DMatrix>>& data_sets,
+                         std::vector<bst_float>* out_results,
+                         std::vector<std::string>* out_metric_names) override {
+    std::vector<std::string> data_names(data_sets.size());
+    out_results->clear();
+    this->EvalImpl(iter, data_sets, data_names, false, out_results).get();
+    out_metric_names->clear();
+    if (!out_results->empty()) {
+      for (auto const& ev : metrics_) {
+        out_metric_names->emplace_back(ev->Name());
       }
     }
-
-    monitor_.Stop("EvalOneIter");
-    return os.str();
   }
 
+  // Setting a parameter to its current value leaves the learner configured.
   void SetParam(const std::string& key, const std::string& value) override {
-    this->need_configuration_ = true;
     if (key == kEvalMetric) {
       if (std::find(metric_names_.cbegin(), metric_names_.cend(),
                     value) == metric_names_.cend()) {
         metric_names_.emplace_back(value);
+        this->need_configuration_ = true;
       }
     } else {
-      cfg_[key] = value;
+      auto it = cfg_.find(key);
+      if (it == cfg_.cend() || it->second != value) {
+        cfg_[key] = value;
+        this->need_configuration_ = true;
+      }
     }
   }
   // Short hand for setting multiple parameters
@@ -846,12 +1168,16 @@ class LearnerImpl : public Learner {
                HostDeviceVector<bst_float>* out_preds, unsigned ntree_limit,
                bool training,
                bool pred_leaf, bool pred_contribs, bool approx_contribs,
-               bool pred_interactions) override {
+               bool pred_interactions, bool cache_prediction) override {
     int multiple_predictions = static_cast<int>(pred_leaf) +
                                static_cast<int>(pred_interactions) +
                                static_cast<int>(pred_contribs);
-    this->Configure();
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
     CHECK_LE(multiple_predictions, 1) << "Perform one kind of prediction at a time.";
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
     if (pred_contribs) {
       gbm_->PredictContribution(data.get(), &out_preds->HostVector(), ntree_limit, approx_contribs);
     } else if (pred_interactions) {
@@ -859,8 +1185,20 @@ class LearnerImpl : public Learner {
                                             approx_contribs);
     } else if (pred_leaf) {
       gbm_->PredictLeaf(data.get(), &out_preds->HostVector(), ntree_limit);
+    } else if (!cache_prediction) {
+      PredictionCacheEntry prediction;
+      prediction.ref = data;
+      prediction.predictions.SetDevice(generic_parameters_.gpu_id);
+      this->PredictRaw(data.get(), &prediction, training, ntree_limit);
+      *out_preds = std::move(prediction.predictions);
+      if (!output_margin) {
+        obj_->PredTransform(out_preds);
+      }
     } else {
-      auto& prediction = cache_.Cache(data, generic_parameters_.gpu_id);
+      auto& prediction = this->CacheEntry(data);
+      // Predictions on different matrices run concurrently, the ones sharing a cache
+      // entry take turns.
+      std::lock_guard<std::mutex> guard(prediction.lock);
       this->PredictRaw(data.get(), &prediction, training, ntree_limit);
       // Copy the prediction cache to output prediction. out_preds comes from C API
       out_preds->SetDevice(generic_parameters_.gpu_id);
@@ -872,6 +1210,131 @@ class LearnerImpl : public Learner {
     }
   }
 
+  void PredictStaged(std::shared_ptr<DMatrix> data, std::vector<unsigned> const& iterations,
+                     bool output_margin, HostDeviceVector<bst_float>* out_preds) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    this->ValidateDMatrix(data.get());
+    gbm_->PredictStaged(data.get(), iterations, out_preds);
+    if (!output_margin) {
+      // the stages are laid out one after another like the rows of a bigger matrix
+      obj_->PredTransform(out_preds);
+    }
+  }
+
+  void PredictStream(std::shared_ptr<DMatrix> data, bool output_margin,
+                     unsigned ntree_limit, PredictionSink const& sink) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    this->ValidateDMatrix(data.get());
+    if (output_margin) {
+      gbm_->PredictStream(data.get(), ntree_limit, sink);
+      return;
+    }
+    // The transform runs with the sink, on the pages of margins.
+    gbm_->PredictStream(data.get(), ntree_limit,
+                        [this, &sink](size_t base_row, common::Span<bst_float const> margin) {
+                          HostDeviceVector<bst_float> preds;
+                          preds.HostVector().assign(margin.cbegin(), margin.cend());
+                          obj_->PredTransform(&preds);
+                          auto const& h_preds = preds.ConstHostVector();
+                          sink(base_row, common::Span<bst_float const>{h_preds.data(),
+                                                                      h_preds.size()});
+                        });
+  }
+
+  void ReleasePredictionCache(DMatrix* data) override {
+    if (cpu_replica_) {
+      this->WaitPendingEval();
+      cpu_replica_->ReleasePredictionCache(data);
+    }
+    {
+      std::lock_guard<std::mutex> guard(cache_lock_);
+      cache_.Release(data);
+      output_predictions_.Release(data);
+    }
+    this->TrackPredictionCache();
+  }
+
+  HostDeviceVector<uint32_t> const& PredictLeafIndex(std::shared_ptr<DMatrix> data,
+                                                     size_t* out_trees) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    auto& entry = this->CacheEntry(data);
+    std::lock_guard<std::mutex> guard(entry.lock);
+    gbm_->PredictLeafIndex(data.get(), &entry);
+    *out_trees = entry.leaf_trees;
+    return entry.leaf_indices;
+  }
+
+  void CalcFeatureScore(std::string const& importance_type,
+                        std::vector<bst_feature_t>* features,
+                        std::vector<float>* scores) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    gbm_->FeatureScore(importance_type, features, scores);
+  }
+
+  size_t PredictRow(SparsePage::Inst const& inst, bool output_margin,
+                    common::Span<bst_float> out_preds, unsigned ntree_limit) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    CHECK(gbm_ != nullptr) << "Predict must happen after Load or configuration";
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    for (auto const& entry : inst) {
+      CHECK_LT(entry.index, learner_model_param_.num_feature)
+          << "Number of columns does not match number of features in booster.";
+    }
+    size_t const n_groups = learner_model_param_.num_output_group;
+    CHECK_GE(out_preds.size(), n_groups);
+    gbm_->PredictRow(inst, out_preds, ntree_limit);
+    if (output_margin) {
+      return n_groups;
+    }
+    // The objective transforms a vector in place, which can change its length.  Reuse
+    // one buffer per thread so steady state prediction stays free of allocation.
+    static thread_local HostDeviceVector<bst_float> transformed;
+    transformed.Resize(n_groups);
+    auto& h_transformed = transformed.HostVector();
+    std::copy(out_preds.cbegin(), out_preds.cbegin() + n_groups, h_transformed.begin());
+    obj_->PredTransform(&transformed);
+    auto const& h_out = transformed.ConstHostVector();
+    CHECK_LE(h_out.size(), out_preds.size());
+    std::copy(h_out.cbegin(), h_out.cend(), out_preds.begin());
+    return h_out.size();
+  }
+
+  void InplacePredict(dmlc::any const& x, bool output_margin, float missing,
+                      HostDeviceVector<bst_float>** out_preds,
+                      unsigned ntree_limit) override {
+    if (this->need_configuration_) {
+      std::lock_guard<std::mutex> guard(config_lock_);
+      this->Configure();
+    }
+    CHECK(gbm_ != nullptr) << "Predict must happen after Load or configuration";
+    common::OmpThreadsScope threads {generic_parameters_.Threads()};
+    static thread_local HostDeviceVector<bst_float> predictions;
+    gbm_->InplacePredict(x, missing, &predictions, ntree_limit);
+    if (!output_margin) {
+      obj_->PredTransform(&predictions);
+    }
+    *out_preds = &predictions;
+  }
+
   const std::map<std::string, std::string>& GetConfigurationArguments() const override {
     return cfg_;
   }
@@ -960,6 +1423,12 @@ class LearnerImpl : public Learner {
     if (num_feature > mparam_.num_feature) {
       mparam_.num_feature = num_feature;
     }
+    if (tparam_.dsplit == DataSplitMode::kCol && rabit::IsDistributed()) {
+      // Each worker has a share of the columns, the others are missing locally.
+      for (auto& matrix : cache_.Container()) {
+        matrix.first->Info().num_col_ = mparam_.num_feature;
+      }
+    }
     CHECK_NE(mparam_.num_feature, 0)
         << "0 feature is supplied.  Are you using raw Booster interface?";
     // Remove these once binary IO is gone.
@@ -1003,9 +1472,8 @@ class LearnerImpl : public Learner {
   LearnerModelParamLegacy mparam_;
   LearnerModelParam learner_model_param_;
   LearnerTrainParam tparam_;
-  // Used to identify the offset of JSON string when
-  // `enable_experimental_json_serialization' is set to false.  Will be removed once JSON
-  // takes over.
+  // Used to identify the offset of JSON string in memory snapshots of older versions,
+  // which have a binary model followed by the JSON configuration.
   std::string const serialisation_header_ { u8"CONFIG-offset:" };
   // User provided configurations
   std::map<std::string, std::string> cfg_;
@@ -1015,16 +1483,434 @@ class LearnerImpl : public Learner {
   static std::string const kEvalMetric;  // NOLINT
   // gradient pairs
   HostDeviceVector<GradientPair> gpair_;
-  bool need_configuration_;
+  // `gpair_' was computed by the last evaluation on this DMatrix and prediction version
+  DMatrix const* gpair_dmat_ {nullptr};
+  uint32_t gpair_version_ {0};
+  // the DMatrix of the last UpdateOneIter
+  DMatrix const* last_train_ {nullptr};
+  // Set whenever a parameter changes, cleared by `Configure'.  Read without the lock by
+  // `Predict' and `PredictRow' to skip configuring an already configured learner.
+  std::atomic<bool> need_configuration_;
+  // serializes the lazy configuration of concurrent `Predict' and `PredictRow' calls
+  std::mutex config_lock_;
+  // configuration saved by `SaveJsonConfig', empty when it may be out of date
+  std::string json_config_;
 
  private:
   /*! \brief random number transformation seed. */
   static int32_t constexpr kRandSeedMagic = 127;
+  static size_t constexpr kNoStatistics = std::numeric_limits<size_t>::max();
   // internal cached dmatrix for prediction.
   PredictionContainer cache_;
+  // guards the look up and insertion of `cache_' entries
+  std::mutex cache_lock_;
+  common::TrackedBytes tracked_cache_ {"PredictionCache"};
+
+  void TrackPredictionCache() {
+    std::lock_guard<std::mutex> guard(cache_lock_);
+    size_t bytes = 0;
+    for (auto const& kv : cache_.Container()) {
+      bytes += kv.second.predictions.Size() * sizeof(bst_float);
+    }
+    tracked_cache_.Set(bytes);
+  }
+
+  static int32_t constexpr kTrainingCacheMagic = 0x54434843;  // "TCHC"
+
+  /*! \brief FNV-1a, telling whether a training cache belongs to a model and data. */
+  static uint64_t HashBytes(void const* ptr, size_t n_bytes, uint64_t hash) {
+    auto const* bytes = static_cast<uint8_t const*>(ptr);
+    for (size_t i = 0; i < n_bytes; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+  template <typename T>
+  static uint64_t HashVector(std::vector<T> const& vec, uint64_t hash) {
+    return HashBytes(vec.data(), vec.size() * sizeof(T), hash);
+  }
+  static uint64_t constexpr kHashOffset = 14695981039346656037ULL;
+
+  // Attributes are left out, they don't change the predictions.
+  uint64_t ModelFingerprint() const {
+    std::string buf;
+    common::MemoryBufferStream fo(&buf);
+    fo.Write(&mparam_, sizeof(mparam_));
+    fo.Write(tparam_.booster);
+    gbm_->Save(&fo);
+    return HashBytes(buf.data(), buf.size(), kHashOffset);
+  }
+  // Hashes what the margins and the cuts are computed from: the rows, the base margin
+  // and the weights.
+  static uint64_t DataFingerprint(DMatrix* data) {
+    CHECK(data->PageExists<SparsePage>())
+        << "Training cache requires the rows of the training data.";
+    auto const& info = data->Info();
+    uint64_t hash = HashBytes(&info.num_row_, sizeof(info.num_row_), kHashOffset);
+    hash = HashBytes(&info.num_col_, sizeof(info.num_col_), hash);
+    for (auto const& page : data->GetBatches<SparsePage>()) {
+      hash = HashVector(page.offset.ConstHostVector(), hash);
+      hash = HashVector(page.data.ConstHostVector(), hash);
+    }
+    hash = HashVector(info.base_margin_.ConstHostVector(), hash);
+    hash = HashVector(info.weights_.ConstHostVector(), hash);
+    return hash;
+  }
+
+  PredictionCacheEntry& CacheEntry(std::shared_ptr<DMatrix> m) {
+    std::lock_guard<std::mutex> guard(cache_lock_);
+    return cache_.Cache(m, generic_parameters_.gpu_id);
+  }
+
+  /*! \brief Block until metrics launched by `EvalOneIterAsync' are done with `metrics_'. */
+  void WaitPendingEval() const {
+    if (pending_eval_.valid()) {
+      pending_eval_.wait();
+    }
+  }
+
+  /*! \brief Metrics of one data set during evaluation. */
+  struct PendingSet {
+    std::shared_ptr<DMatrix> m;
+    std::vector<bst_float> results;
+    // transformed predictions, when the metrics are yet to be evaluated
+    std::shared_ptr<HostDeviceVector<bst_float>> out;
+    // local statistics of the metrics, see Metric::EvalStatistics
+    std::vector<double> stats;
+    // begin of the statistics of each metric, kNoStatistics for those already evaluated
+    std::vector<size_t> stats_begin;
+  };
+
+  /*!
+   * \brief Evaluate the metrics on the transformed predictions of one data set.  Metrics
+   *  having statistics only store them in `set', see `FinishMetrics'.
+   */
+  void EvalMetrics(HostDeviceVector<bst_float> const& out, MetaInfo const& info,
+                   bool distributed, PendingSet* set) const {
+    set->results.assign(metrics_.size(), 0.0f);
+    set->stats.clear();
+    set->stats_begin.assign(metrics_.size(), kNoStatistics);
+    // Element-wise metrics share one pass over the predictions on CPU.
+    std::vector<metric::ElementWiseMetric*> fused;
+    std::vector<size_t> fused_idx;
+    if (generic_parameters_.gpu_id == GenericParameter::kCpuId) {
+      for (size_t j = 0; j < metrics_.size(); ++j) {
+        auto* ev = dynamic_cast<metric::ElementWiseMetric*>(metrics_[j].get());
+        if (ev != nullptr) {
+          fused.push_back(ev);
+          fused_idx.push_back(j);
+        }
+      }
+    }
+    if (fused.size() > 1) {
+      set->stats = metric::ElementWiseStatistics(fused, out, info);
+      for (size_t j = 0; j < fused.size(); ++j) {
+        set->stats_begin[fused_idx[j]] = j * 2;
+      }
+    }
+    for (size_t j = 0; j < metrics_.size(); ++j) {
+      if (set->stats_begin[j] != kNoStatistics) {
+        continue;
+      }
+      size_t const begin = set->stats.size();
+      if (metrics_[j]->EvalStatistics(out, info, &set->stats) != 0) {
+        set->stats_begin[j] = begin;
+      } else {
+        // Metrics without statistics reduce over the workers by themselves.
+        set->results[j] = metrics_[j]->Eval(out, info, distributed);
+      }
+    }
+  }
+
+  /*!
+   * \brief Evaluate the metrics from their statistics, summed over the workers with a
+   *  single allreduce for all data sets in distributed evaluation.
+   */
+  void FinishMetrics(std::vector<PendingSet>* sets, bool distributed) const {
+    if (distributed) {
+      size_t n_stats = 0;
+      for (auto const& set : *sets) {
+        n_stats += set.stats.size();
+      }
+      std::vector<double> stats;
+      stats.reserve(n_stats);
+      for (auto const& set : *sets) {
+        stats.insert(stats.end(), set.stats.cbegin(), set.stats.cend());
+      }
+      if (!stats.empty()) {
+        rabit::Allreduce<rabit::op::Sum>(stats.data(), stats.size());
+      }
+      auto it = stats.cbegin();
+      for (auto& set : *sets) {
+        std::copy(it, it + set.stats.size(), set.stats.begin());
+        it += set.stats.size();
+      }
+    }
+    for (auto& set : *sets) {
+      for (size_t j = 0; j < set.stats_begin.size(); ++j) {
+        if (set.stats_begin[j] != kNoStatistics) {
+          set.results[j] = metrics_[j]->EvalFromStatistics(set.stats.data() + set.stats_begin[j]);
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Whether the sets of `tasks' can be predicted and evaluated concurrently.  That
+   *  takes distinct CPU data sets outside of distributed training, where the metrics are
+   *  reduced over the workers in the same order, and a tree booster, as the linear one
+   *  initializes its model during prediction.
+   */
+  bool ConcurrentEval(std::vector<size_t> const& tasks, std::vector<PendingSet> const& sets,
+                      bool distributed, int32_t n_threads) const {
+    if (tasks.size() < 2 || n_threads < 2 || distributed ||
+        generic_parameters_.gpu_id != GenericParameter::kCpuId ||
+        tparam_.booster == "gblinear") {
+      return false;
+    }
+    std::vector<DMatrix const*> dmats;
+    for (auto i : tasks) {
+      dmats.push_back(sets[i].m.get());
+    }
+    std::sort(dmats.begin(), dmats.end());
+    return std::adjacent_find(dmats.cbegin(), dmats.cend()) == dmats.cend();
+  }
+
+  /*!
+   * \brief Whether asynchronous evaluation goes to the CPU replica: GPU training of a tree
+   *  booster with `eval_on_cpu' set, outside of distributed training, on sets that keep
+   *  their rows for the CPU predictor.
+   */
+  bool UseCPUReplica(std::vector<std::shared_ptr<DMatrix>> const& data_sets) const {
+    if (tparam_.eval_on_cpu <= 0 || generic_parameters_.gpu_id == GenericParameter::kCpuId ||
+        tparam_.dsplit == DataSplitMode::kRow || tparam_.booster != "gbtree") {
+      return false;
+    }
+    // updating existing trees would change them under the replica
+    auto process_type = cfg_.find("process_type");
+    if (process_type != cfg_.cend() && process_type->second != "default") {
+      return false;
+    }
+    return std::all_of(data_sets.cbegin(), data_sets.cend(),
+                       [](std::shared_ptr<DMatrix> const& m) {
+                         return m->PageExists<SparsePage>();
+                       });
+  }
+
+  /*!
+   * \brief Evaluate on the CPU replica of the model, on another thread, leaving the device
+   *  to the next iteration.  The replica shares the trees, it takes the ones committed
+   *  since the last evaluation and keeps its own predictions of the sets.
+   */
+  std::shared_future<std::string>
+  EvalOnReplica(int iter, std::vector<std::shared_ptr<DMatrix>> const& data_sets,
+                std::vector<std::string> const& data_names) {
+    bool out_of_bound {false};
+    if (!cpu_replica_) {
+      cpu_replica_.reset(static_cast<LearnerImpl*>(this->Slice(0, 0, 1, &out_of_bound)));
+      CHECK(!out_of_bound);
+      cpu_replica_->SetParams({{"gpu_id", std::to_string(GenericParameter::kCpuId)},
+                               {"tree_method", "hist"},
+                               {"predictor", "cpu_predictor"}});
+      cpu_replica_->Configure();
+    } else {
+      gbm_->Slice(0, 0, 1, cpu_replica_->gbm_.get(), &out_of_bound);
+      CHECK(!out_of_bound);
+    }
+    // Make the host copies readable here, so the replica doesn't change the access of
+    // data the device may be reading during the next iteration.
+    for (auto const& m : data_sets) {
+      auto const& info = m->Info();
+      info.labels_.ConstHostVector();
+      info.weights_.ConstHostVector();
+      info.base_margin_.ConstHostVector();
+      // external memory reads its pages again for every pass
+      if (m->SingleColBlock()) {
+        for (auto const& page : m->GetBatches<SparsePage>()) {
+          page.data.ConstHostVector();
+          page.offset.ConstHostVector();
+        }
+      }
+    }
+    LearnerImpl* replica = cpu_replica_.get();
+    pending_eval_ = std::async(std::launch::async, [replica, iter, data_sets, data_names]() {
+      return replica->EvalImpl(iter, data_sets, data_names, false).get();
+    }).share();
+    return pending_eval_;
+  }
+
+  /*!
+   * \brief Predict every data set, then evaluate the metrics, on another thread when
+   *  `async' is set.  Only the metrics touch the learner after returning, each data set
+   *  gets its own copy of the transformed predictions.  The results are also stored in
+   *  `out_results' when it's not null, which requires `async' to be unset.
+   */
+  std::shared_future<std::string>
+  EvalImpl(int iter, const std::vector<std::shared_ptr<DMatrix>>& data_sets,
+           const std::vector<std::string>& data_names, bool async,
+           std::vector<bst_float>* out_results = nullptr) {
+    CHECK(!async || out_results == nullptr);
+    monitor_.Start("EvalOneIter");
+    // metrics of the last asynchronous evaluation may still be running
+    this->WaitPendingEval();
+    this->Configure();
+    int32_t const n_threads = generic_parameters_.Threads();
+    common::OmpThreadsScope threads {n_threads};
+
+    std::ostringstream os;
+    os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
+    std::promise<std::string> ready;
+    if (iter % tparam_.eval_period != 0) {
+      monitor_.Stop("EvalOneIter");
+      ready.set_value(os.str());
+      return ready.get_future().share();
+    }
+    if (async && this->UseCPUReplica(data_sets)) {
+      monitor_.Stop("EvalOneIter");
+      return this->EvalOnReplica(iter, data_sets, data_names);
+    }
+    if (metrics_.size() == 0 && tparam_.disable_default_eval_metric <= 0) {
+      metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric(), &generic_parameters_));
+      metrics_.back()->Configure({cfg_.begin(), cfg_.end()});
+    }
+    bool const distributed = tparam_.dsplit == DataSplitMode::kRow;
+    // Metrics of distributed training are reduced over the workers, in the same order on
+    // every worker.
+    async = async && !distributed;
+
+    std::vector<PendingSet> pending(data_sets.size());
+    // Prediction and output of the sets left to the per set tasks below, the caches are
+    // looked up here as that inserts into them.
+    std::vector<PredictionCacheEntry*> entries(data_sets.size(), nullptr);
+    std::vector<HostDeviceVector<bst_float>*> outs(data_sets.size(), nullptr);
+    std::vector<size_t> tasks;
+    for (size_t i = 0; i < data_sets.size(); ++i) {
+      std::shared_ptr<DMatrix> m = data_sets[i];
+      auto &predt = this->CacheEntry(m);
+      this->ValidateDMatrix(m.get());
+      pending[i].m = m;
+      entries[i] = &predt;
+
+      // The next iteration computes its gradient on the same predictions of the training
+      // set, so the objective does it here in the pass over the metrics.  Dart drops trees
+      // for the gradient, which makes the predictions differ.
+      auto* fused_obj = dynamic_cast<metric::FusedMetricObjective*>(obj_.get());
+      bool const all_element_wise =
+          generic_parameters_.gpu_id == GenericParameter::kCpuId &&
+          std::all_of(metrics_.cbegin(), metrics_.cend(), [](std::unique_ptr<Metric> const& ev) {
+            return dynamic_cast<metric::ElementWiseMetric*>(ev.get()) != nullptr;
+          });
+      if (fused_obj != nullptr && m.get() == last_train_ && !metrics_.empty() &&
+          all_element_wise && tparam_.booster != "dart") {
+        this->PredictRaw(m.get(), &predt, false);
+        std::vector<metric::ElementWiseMetric*> fused;
+        for (auto const& ev : metrics_) {
+          fused.push_back(dynamic_cast<metric::ElementWiseMetric*>(ev.get()));
+        }
+        std::vector<metric::PackedReduceResult> blocks;
+        fused_obj->GetGradientWithMetrics(predt.predictions, m->Info(), fused, &gpair_,
+                                          &blocks);
+        gpair_dmat_ = m.get();
+        gpair_version_ = predt.version;
+        pending[i].results.assign(metrics_.size(), 0.0f);
+        pending[i].stats = metric::SumElementWiseBlocks(fused, blocks);
+        pending[i].stats_begin.resize(metrics_.size());
+        for (size_t j = 0; j < metrics_.size(); ++j) {
+          pending[i].stats_begin[j] = j * 2;
+        }
+        continue;
+      }
+      if (async) {
+        pending[i].out = std::make_shared<HostDeviceVector<bst_float>>();
+        outs[i] = pending[i].out.get();
+        outs[i]->SetDevice(generic_parameters_.gpu_id);
+      } else {
+        outs[i] = &output_predictions_.Cache(m, generic_parameters_.gpu_id).predictions;
+      }
+      tasks.push_back(i);
+    }
+
+    // The transform runs here, the objective is used by training.
+    auto eval_set = [&](size_t i) {
+      auto const& m = pending[i].m;
+      this->PredictRaw(m.get(), entries[i], false);
+      auto* out = outs[i];
+      out->Resize(entries[i]->predictions.Size());
+      out->Copy(entries[i]->predictions);
+      obj_->EvalTransform(out);
+      if (!async) {
+        this->EvalMetrics(*out, m->Info(), distributed, &pending[i]);
+      }
+    };
+    if (this->ConcurrentEval(tasks, pending, distributed, n_threads)) {
+      // Small sets leave most threads idle, so the sets are predicted and evaluated at
+      // the same time, each worker taking its share of the threads.
+      int32_t const n_workers = std::min(static_cast<int32_t>(tasks.size()), n_threads);
+      std::atomic<size_t> next {0};
+      std::vector<std::future<void>> workers;
+      for (int32_t w = 0; w < n_workers; ++w) {
+        int32_t const worker_threads = n_threads / n_workers +
+            static_cast<int32_t>(w < n_threads % n_workers);
+        workers.emplace_back(std::async(std::launch::async, [&, worker_threads]() {
+          common::OmpThreadsScope scope {worker_threads};
+          for (size_t t = next++; t < tasks.size(); t = next++) {
+            eval_set(tasks[t]);
+          }
+        }));
+      }
+      for (auto& worker : workers) {
+        worker.wait();
+      }
+      for (auto& worker : workers) {
+        worker.get();
+      }
+    } else {
+      for (auto i : tasks) {
+        eval_set(i);
+      }
+    }
+    monitor_.Stop("EvalOneIter");
+
+    auto header = os.str();
+    auto finish = [this, header, data_names, distributed, n_threads](
+                      std::vector<PendingSet> sets, std::vector<bst_float>* results) {
+      common::OmpThreadsScope threads {n_threads};
+      std::ostringstream os;
+      os << header << std::setiosflags(std::ios::fixed);
+      for (auto& set : sets) {
+        if (set.out) {
+          this->EvalMetrics(*set.out, set.m->Info(), distributed, &set);
+        }
+      }
+      this->FinishMetrics(&sets, distributed);
+      for (size_t i = 0; i < sets.size(); ++i) {
+        for (size_t j = 0; j < metrics_.size(); ++j) {
+          os << '\t' << data_names[i] << '-' << metrics_[j]->Name() << ':'
+             << sets[i].results[j];
+        }
+        if (results != nullptr) {
+          results->insert(results->end(), sets[i].results.cbegin(), sets[i].results.cend());
+        }
+      }
+      return os.str();
+    };
+    if (!async) {
+      ready.set_value(finish(std::move(pending), out_results));
+      return ready.get_future().share();
+    }
+    pending_eval_ = std::async(std::launch::async, finish, std::move(pending),
+                               static_cast<std::vector<bst_float>*>(nullptr)).share();
+    return pending_eval_;
+  }
+
   /*! \brief Temporary storage to prediction.  Useful for storing data transformed by
    *  objective function */
   PredictionContainer output_predictions_;
+  // metrics of the last `EvalOneIterAsync', they use `metrics_'
+  std::shared_future<std::string> pending_eval_;
+  // copy of the model evaluating on CPU while training on GPU, see `eval_on_cpu'
+  std::unique_ptr<LearnerImpl> cpu_replica_;
 
   common::Monitor monitor_;
 
@@ -1035,9 +1921,175 @@ class LearnerImpl : public Learner {
 std::string const LearnerImpl::kEvalMetric {"eval_metric"};  // NOLINT
 
 constexpr int32_t LearnerImpl::kRandSeedMagic;
+constexpr size_t LearnerImpl::kNoStatistics;
 
 Learner* Learner::Create(
     const std::vector<std::shared_ptr<DMatrix> >& cache_data) {
   return new LearnerImpl(cache_data);
 }
+
+void CrossValidate(Args const& params, std::shared_ptr<DMatrix> data,
+                   std::vector<int32_t> const& folds, int32_t num_round,
+                   std::vector<bst_float>* out_results,
+                   std::vector<std::string>* out_metric_names) {
+  CHECK_GE(num_round, 0);
+  CHECK(!folds.empty()) << "A fold is required for every row of the matrix.";
+  CHECK_GE(*std::min_element(folds.cbegin(), folds.cend()), 0)
+      << "Folds must be non-negative.";
+  int32_t const n_folds = *std::max_element(folds.cbegin(), folds.cend()) + 1;
+  CHECK_GE(n_folds, 2) << "Cross validation requires at least 2 folds.";
+
+  std::vector<std::shared_ptr<DMatrix>> train(n_folds), test(n_folds);
+  std::vector<std::unique_ptr<Learner>> learners(n_folds);
+  for (int32_t f = 0; f < n_folds; ++f) {
+    train[f].reset(new data::FoldDMatrix(data, folds, f, true));
+    test[f].reset(new data::FoldDMatrix(data, folds, f, false));
+    learners[f].reset(Learner::Create({train[f], test[f]}));
+    learners[f]->SetParams(params);
+    learners[f]->SetParam("eval_period", "1");
+  }
+  // Configured here, as configuring seeds the random engine of the calling thread and
+  // sets up the logger.
+  learners.front()->Configure();
+  int32_t const n_threads = learners.front()->GetGenericParameter().Threads();
+  // Folds on CPU are trained at the same time, each worker taking its share of the
+  // threads, folds on GPU one after another on the device.
+  bool const concurrent =
+      learners.front()->GetGenericParameter().gpu_id == GenericParameter::kCpuId &&
+      n_threads >= 2;
+  int32_t const n_workers = concurrent ? std::min(n_folds, n_threads) : 1;
+  for (auto& learner : learners) {
+    learner->SetParam("nthread", std::to_string(std::max(n_threads / n_workers, 1)));
+    learner->Configure();
+  }
+
+  std::vector<std::vector<bst_float>> results(n_folds);
+  std::vector<std::string> metric_names;
+  auto train_fold = [&](int32_t f, int32_t begin, int32_t end) {
+    std::vector<bst_float> values;
+    std::vector<std::string> names;
+    for (int32_t iter = begin; iter < end; ++iter) {
+      learners[f]->UpdateOneIter(iter, train[f]);
+      learners[f]->EvalOneIterValues(iter, {train[f], test[f]}, &values, &names);
+      results[f].insert(results[f].end(), values.cbegin(), values.cend());
+      if (f == 0 && iter == 0) {
+        metric_names = names;
+      }
+    }
+  };
+  // The first round of the first fold builds the pages shared by all folds.
+  train_fold(0, 0, std::min(num_round, 1));
+  if (concurrent) {
+    std::atomic<int32_t> next {0};
+    std::vector<std::future<void>> workers;
+    for (int32_t w = 0; w < n_workers; ++w) {
+      workers.emplace_back(std::async(std::launch::async, [&]() {
+        for (int32_t f = next++; f < n_folds; f = next++) {
+          train_fold(f, f == 0 ? 1 : 0, num_round);
+        }
+      }));
+    }
+    for (auto& worker : workers) {
+      worker.wait();
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
+  } else {
+    for (int32_t iter = 0; iter < num_round; ++iter) {
+      for (int32_t f = 0; f < n_folds; ++f) {
+        if (f != 0 || iter != 0) {
+          train_fold(f, iter, iter + 1);
+        }
+      }
+    }
+  }
+
+  // rounds of each fold to folds of each round
+  size_t const n_values = 2 * metric_names.size();
+  out_results->resize(static_cast<size_t>(num_round) * n_folds * n_values);
+  for (int32_t f = 0; f < n_folds; ++f) {
+    CHECK_EQ(results[f].size(), static_cast<size_t>(num_round) * n_values);
+    for (int32_t iter = 0; iter < num_round; ++iter) {
+      std::copy_n(results[f].cbegin() + iter * n_values, n_values,
+                  out_results->begin() + (static_cast<size_t>(iter) * n_folds + f) * n_values);
+    }
+  }
+  *out_metric_names = std::move(metric_names);
+}
+
+void TrainBatched(std::vector<Learner*> const& learners, std::shared_ptr<DMatrix> dtrain,
+                  int32_t begin_iteration, int32_t num_round) {
+  CHECK(!learners.empty());
+  CHECK_GE(num_round, 0);
+  CHECK(!rabit::IsDistributed()) << "Batched training is not supported in distributed mode.";
+  for (auto learner : learners) {
+    CHECK(learner != nullptr);
+    learner->Configure();
+  }
+  if (num_round == 0) {
+    return;
+  }
+  int32_t const n_threads = learners.front()->GetGenericParameter().Threads();
+  int32_t const end_iteration = begin_iteration + num_round;
+  // The first round of the first booster builds the pages shared by all boosters.
+  learners.front()->UpdateOneIter(begin_iteration, dtrain);
+
+  // Only boosters growing trees with `hist' on CPU build root histograms on the batch,
+  // the others are trained alongside.
+  std::vector<std::string> nthread(learners.size());
+  std::vector<bool> in_batch(learners.size());
+  size_t n_participants = 0;
+  for (size_t i = 0; i < learners.size(); ++i) {
+    auto const& args = learners[i]->GetConfigurationArguments();
+    auto it = args.find("nthread");
+    nthread[i] = it == args.cend() ? "0" : it->second;
+    it = args.find("tree_method");
+    in_batch[i] = it != args.cend() && it->second == "hist" &&
+                  learners[i]->GetGenericParameter().gpu_id == GenericParameter::kCpuId;
+    n_participants += in_batch[i];
+  }
+  auto batch = std::make_shared<common::HistBatch>(n_participants, n_threads);
+  std::string const name = common::HistBatch::Register(batch);
+  int32_t const n_workers = static_cast<int32_t>(learners.size());
+  for (size_t i = 0; i < learners.size(); ++i) {
+    learners[i]->SetParam("nthread", std::to_string(std::max(n_threads / n_workers, 1)));
+    if (in_batch[i]) {
+      learners[i]->SetParam("hist_batch", name);
+    }
+    learners[i]->Configure();
+  }
+
+  std::vector<std::future<void>> workers;
+  for (size_t i = 0; i < learners.size(); ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&, i]() {
+      try {
+        for (int32_t iter = begin_iteration + (i == 0); iter < end_iteration; ++iter) {
+          learners[i]->UpdateOneIter(iter, dtrain);
+        }
+      } catch (...) {
+        if (in_batch[i]) {
+          batch->Leave();
+        }
+        throw;
+      }
+      if (in_batch[i]) {
+        batch->Leave();
+      }
+    }));
+  }
+  for (auto& worker : workers) {
+    worker.wait();
+  }
+  common::HistBatch::Unregister(name);
+  for (size_t i = 0; i < learners.size(); ++i) {
+    learners[i]->SetParam("nthread", nthread[i]);
+    if (in_batch[i]) {
+      learners[i]->SetParam("hist_batch", "");
+    }
+  }
+  for (auto& worker : workers) {
+    worker.get();
+  }
+}
 }  // namespace xgboost
@@ -9,6 +9,7 @@
 #include <vector>
 #include <limits>
 
+#include "dmlc/omp.h"
 #include "xgboost/data.h"
 #include "xgboost/parameter.h"
 #include "./param.h"
@@ -20,12 +21,19 @@ namespace linear {
 
 struct CoordinateParam : public XGBoostParameter<CoordinateParam> {
   int top_k;
+  int feature_block_size;
   DMLC_DECLARE_PARAMETER(CoordinateParam) {
     DMLC_DECLARE_FIELD(top_k)
         .set_lower_bound(0)
         .set_default(0)
         .describe("The number of top features to select in 'thrifty' feature_selector. "
                   "The value of zero means using all the features.");
+    DMLC_DECLARE_FIELD(feature_block_size)
+        .set_lower_bound(1)
+        .set_default(1)
+        .describe("Number of features updated at once by gpu_coord_descent, from the "
+                  "gradient before any of them is updated.  Larger blocks take fewer "
+                  "kernel launches, the value of one is exact coordinate descent.");
   }
 };
 
@@ -66,6 +74,117 @@ inline double CoordinateDeltaBias(double sum_grad, double sum_hess) {
   return -sum_grad / sum_hess;
 }
 
+/**
+ * \brief A column of the feature matrix stored as separate row index and value arrays.
+ */
+struct ColumnView {
+  const bst_uint *index;
+  const bst_float *value;
+  size_t size;
+};
+
+/**
+ * \brief Compact column major copy of a single page feature matrix.  Coordinate descent
+ *        scans every selected column in each round, reading contiguous index and value
+ *        arrays is cheaper than walking the `Entry' array of a CSC page.
+ */
+class ColumnCache {
+ public:
+  /*! \brief Whether the cache holds the columns of `p_fmat'. */
+  bool Matches(DMatrix const *p_fmat) const {
+    return p_fmat == p_last_fmat_ && p_fmat->Info().num_row_ == n_rows_ &&
+           p_fmat->Info().num_nonzero_ == index_.size();
+  }
+
+  void Init(DMatrix *p_fmat) {
+    CHECK(p_fmat->SingleColBlock());
+    offset_.clear();
+    index_.clear();
+    value_.clear();
+    for (const auto &batch : p_fmat->GetBatches<CSCPage>()) {
+      const auto &h_offset = batch.offset.ConstHostVector();
+      const auto &h_data = batch.data.ConstHostVector();
+      offset_ = h_offset;
+      index_.resize(h_data.size());
+      value_.resize(h_data.size());
+      const auto n_entries = static_cast<bst_omp_uint>(h_data.size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < n_entries; ++i) {
+        index_[i] = h_data[i].index;
+        value_[i] = h_data[i].fvalue;
+      }
+    }
+    p_last_fmat_ = p_fmat;
+    n_rows_ = p_fmat->Info().num_row_;
+  }
+
+  size_t Size() const { return offset_.empty() ? 0 : offset_.size() - 1; }
+
+  ColumnView operator[](size_t fidx) const {
+    const size_t beg = offset_[fidx];
+    return {index_.data() + beg, value_.data() + beg, offset_[fidx + 1] - beg};
+  }
+
+ private:
+  std::vector<size_t> offset_;
+  std::vector<bst_uint> index_;
+  std::vector<bst_float> value_;
+  DMatrix const *p_last_fmat_ { nullptr };
+  uint64_t n_rows_ { 0 };
+};
+
+/**
+ * \brief Gradient sums of one cached column, single threaded.
+ */
+inline std::pair<double, double> GetColumnGradient(int group_idx, int num_group,
+                                                   ColumnView col,
+                                                   const std::vector<GradientPair> &gpair) {
+  double sum_grad = 0.0, sum_hess = 0.0;
+  for (size_t j = 0; j < col.size; ++j) {
+    const auto &p = gpair[col.index[j] * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    const bst_float v = col.value[j];
+    sum_grad += p.GetGrad() * v;
+    sum_hess += p.GetHess() * v * v;
+  }
+  return std::make_pair(sum_grad, sum_hess);
+}
+
+/**
+ * \brief Gradient sums of one cached column.  Row-wise multithreaded.
+ */
+inline std::pair<double, double> GetGradientParallel(int group_idx, int num_group,
+                                                     ColumnView col,
+                                                     const std::vector<GradientPair> &gpair) {
+  double sum_grad = 0.0, sum_hess = 0.0;
+  const auto ndata = static_cast<bst_omp_uint>(col.size);
+#pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
+  for (bst_omp_uint j = 0; j < ndata; ++j) {
+    const auto &p = gpair[col.index[j] * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    const bst_float v = col.value[j];
+    sum_grad += p.GetGrad() * v;
+    sum_hess += p.GetHess() * v * v;
+  }
+  return std::make_pair(sum_grad, sum_hess);
+}
+
+/**
+ * \brief Updates the gradient vector with respect to a change in the weight of one cached
+ *        column.  Rows are unique within a column, each thread writes its own entries.
+ */
+inline void UpdateResidualParallel(int group_idx, int num_group, float dw, ColumnView col,
+                                   std::vector<GradientPair> *in_gpair) {
+  if (dw == 0.0f) return;
+  const auto ndata = static_cast<bst_omp_uint>(col.size);
+#pragma omp parallel for schedule(static)
+  for (bst_omp_uint j = 0; j < ndata; ++j) {
+    GradientPair &p = (*in_gpair)[col.index[j] * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    p += GradientPair(p.GetHess() * col.value[j] * dw, 0);
+  }
+}
+
 /**
  * \brief Get the gradient with respect to a single feature.
  *
@@ -331,9 +450,10 @@ class GreedyFeatureSelector : public FeatureSelector {
 
     const int ngroup = model.learner_model_param_->num_output_group;
     const bst_omp_uint nfeat = model.learner_model_param_->num_feature;
-    // Calculate univariate gradient sums
-    std::fill(gpair_sums_.begin(), gpair_sums_.end(), std::make_pair(0., 0.));
-  for (const auto &batch : p_fmat->GetBatches<CSCPage>()) {
+    // Calculate univariate gradient sums, only this group's are read
+    auto group_sums = gpair_sums_.begin() + group_idx * nfeat;
+    std::fill(group_sums, group_sums + nfeat, std::make_pair(0., 0.));
+    for (const auto &batch : p_fmat->GetBatches<CSCPage>()) {
       #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nfeat; ++i) {
         const auto col = batch[i];
@@ -348,16 +468,30 @@ class GreedyFeatureSelector : public FeatureSelector {
         }
       }
     }
-    // Find a feature with the largest magnitude of weight change
+    // Find a feature with the largest magnitude of weight change.  Each thread scans a
+    // contiguous range, so merging in thread order keeps the first of equal maxima.
+    const int nthread = omp_get_max_threads();
+    thread_best_.assign(nthread, std::make_pair(0.0, 0));
+#pragma omp parallel num_threads(nthread)
+    {
+      std::pair<double, int> best {0.0, 0};
+#pragma omp for schedule(static)
+      for (bst_omp_uint fidx = 0; fidx < nfeat; ++fidx) {
+        auto &s = gpair_sums_[group_idx * nfeat + fidx];
+        float dw = std::abs(static_cast<bst_float>(
+                   CoordinateDelta(s.first, s.second, model[fidx][group_idx], alpha, lambda)));
+        if (dw > best.first) {
+          best = std::make_pair(static_cast<double>(dw), static_cast<int>(fidx));
+        }
+      }
+      thread_best_[omp_get_thread_num()] = best;
+    }
     int best_fidx = 0;
     double best_weight_update = 0.0f;
-    for (bst_omp_uint fidx = 0; fidx < nfeat; ++fidx) {
-      auto &s = gpair_sums_[group_idx * nfeat + fidx];
-      float dw = std::abs(static_cast<bst_float>(
-                 CoordinateDelta(s.first, s.second, model[fidx][group_idx], alpha, lambda)));
-      if (dw > best_weight_update) {
-        best_weight_update = dw;
-        best_fidx = fidx;
+    for (auto const& best : thread_best_) {
+      if (best.first > best_weight_update) {
+        best_weight_update = best.first;
+        best_fidx = best.second;
       }
     }
     return best_fidx;
@@ -367,6 +501,7 @@ class GreedyFeatureSelector : public FeatureSelector {
   bst_uint top_k_;
   std::vector<bst_uint> counter_;
   std::vector<std::pair<double, double>> gpair_sums_;
+  std::vector<std::pair<double, int>> thread_best_;
 };
 
 /**
@@ -416,12 +551,17 @@ class ThriftyFeatureSelector : public FeatureSelector {
         }
       }
     }
-    // rank by descending weight magnitude within the groups
-    std::fill(deltaw_.begin(), deltaw_.end(), 0.f);
+    // rank by descending weight magnitude within the groups, only the first top_k
+    // features of a group are ever selected so the rest is left unordered
+    const size_t nselect = std::min(static_cast<size_t>(top_k_), static_cast<size_t>(nfeat));
     std::iota(sorted_idx_.begin(), sorted_idx_.end(), 0);
     bst_float *pdeltaw = &deltaw_[0];
+    auto by_magnitude = [pdeltaw](size_t i, size_t j) {
+      return std::abs(*(pdeltaw + i)) > std::abs(*(pdeltaw + j));
+    };
     for (bst_uint gid = 0u; gid < ngroup; ++gid) {
       // Calculate univariate weight changes
+#pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nfeat; ++i) {
         auto ii = gid * nfeat + i;
         auto &s = gpair_sums_[ii];
@@ -430,10 +570,11 @@ class ThriftyFeatureSelector : public FeatureSelector {
       }
       // sort in descending order of deltaw abs values
       auto start = sorted_idx_.begin() + gid * nfeat;
-      std::sort(start, start + nfeat,
-                [pdeltaw](size_t i, size_t j) {
-                  return std::abs(*(pdeltaw + i)) > std::abs(*(pdeltaw + j));
-                });
+      if (nselect < nfeat) {
+        std::partial_sort(start, start + nselect, start + nfeat, by_magnitude);
+      } else {
+        std::sort(start, start + nfeat, by_magnitude);
+      }
       counter_[gid] = 0u;
     }
   }
@@ -49,6 +49,10 @@ class CoordinateUpdater : public LinearUpdater {
               gbm::GBLinearModel *model, double sum_instance_weight) override {
     tparam_.DenormalizePenalties(sum_instance_weight);
     const int ngroup = model->learner_model_param_->num_output_group;
+    use_cache_ = p_fmat->SingleColBlock();
+    if (use_cache_ && !columns_.Matches(p_fmat)) {
+      columns_.Init(p_fmat);
+    }
     // update bias
     for (int group_idx = 0; group_idx < ngroup; ++group_idx) {
       auto grad = GetBiasGradientParallel(group_idx, ngroup,
@@ -80,14 +84,19 @@ class CoordinateUpdater : public LinearUpdater {
                             DMatrix *p_fmat, gbm::GBLinearModel *model) {
     const int ngroup = model->learner_model_param_->num_output_group;
     bst_float &w = (*model)[fidx][group_idx];
-    auto gradient =
-        GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
+    auto gradient = use_cache_
+                        ? GetGradientParallel(group_idx, ngroup, columns_[fidx], *in_gpair)
+                        : GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
     auto dw = static_cast<float>(
         tparam_.learning_rate *
         CoordinateDelta(gradient.first, gradient.second, w, tparam_.reg_alpha_denorm,
                         tparam_.reg_lambda_denorm));
     w += dw;
-    UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
+    if (use_cache_) {
+      UpdateResidualParallel(group_idx, ngroup, dw, columns_[fidx], in_gpair);
+    } else {
+      UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
+    }
   }
 
  private:
@@ -95,6 +104,9 @@ class CoordinateUpdater : public LinearUpdater {
   // training parameter
   LinearTrainParam tparam_;
   std::unique_ptr<FeatureSelector> selector_;
+  // columns of a single page training matrix, kept across rounds
+  ColumnCache columns_;
+  bool use_cache_ { false };
   common::Monitor monitor_;
 };
 
@@ -2,6 +2,8 @@
  * Copyright 2018-2019 by Contributors
  * \author Rory Mitchell
  */
+#include <algorithm>
+#include <vector>
 
 #include <thrust/execution_policy.h>
 #include <thrust/inner_product.h>
@@ -20,6 +22,56 @@ namespace linear {
 
 DMLC_REGISTRY_FILE_TAG(updater_gpu_coordinate);
 
+constexpr int kFeatureBlockThreads = 256;
+
+/*! \brief Gradient statistics of each feature in `d_fidx', one thread block for each. */
+__global__ void FeatureGradientKernel(common::Span<Entry const> d_data,
+                                      common::Span<size_t const> d_row_ptr,
+                                      common::Span<int const> d_fidx,
+                                      common::Span<GradientPair const> d_gpair,
+                                      int group_idx, int num_group,
+                                      common::Span<GradientPairPrecise> d_out) {
+  using BlockReduceT = cub::BlockReduce<GradientPairPrecise, kFeatureBlockThreads>;
+  __shared__ typename BlockReduceT::TempStorage temp_storage;
+  int const fidx = d_fidx[blockIdx.x];
+  GradientPairPrecise sum;
+  for (size_t i = d_row_ptr[fidx] + threadIdx.x; i < d_row_ptr[fidx + 1];
+       i += kFeatureBlockThreads) {
+    auto entry = d_data[i];
+    auto g = d_gpair[entry.index * num_group + group_idx];
+    sum += GradientPairPrecise(g.GetGrad() * entry.fvalue,
+                               g.GetHess() * entry.fvalue * entry.fvalue);
+  }
+  sum = BlockReduceT(temp_storage).Sum(sum);
+  if (threadIdx.x == 0) {
+    d_out[blockIdx.x] = sum;
+  }
+}
+
+/*!
+ * \brief Residual update of the weight changes `d_dw' of the features in `d_fidx', one
+ *  thread block for each.  Features share rows, so the gradients are added atomically.
+ */
+__global__ void FeatureResidualKernel(common::Span<Entry const> d_data,
+                                      common::Span<size_t const> d_row_ptr,
+                                      common::Span<int const> d_fidx,
+                                      common::Span<float const> d_dw,
+                                      common::Span<GradientPair> d_gpair,
+                                      int group_idx, int num_group) {
+  int const fidx = d_fidx[blockIdx.x];
+  float const dw = d_dw[blockIdx.x];
+  if (dw == 0.0f) {
+    return;
+  }
+  for (size_t i = d_row_ptr[fidx] + threadIdx.x; i < d_row_ptr[fidx + 1];
+       i += kFeatureBlockThreads) {
+    auto entry = d_data[i];
+    auto& g = d_gpair[entry.index * num_group + group_idx];
+    // only the gradient changes, the hessian is read concurrently
+    atomicAdd(reinterpret_cast<float*>(&g), g.GetHess() * dw * entry.fvalue);
+  }
+}
+
 /**
  * \class GPUCoordinateUpdater
  *
@@ -88,6 +140,7 @@ class GPUCoordinateUpdater : public LinearUpdater {  // NOLINT
     }
     ba_.Allocate(learner_param_->gpu_id, &data_, row_ptr_.back(), &gpair_,
                  num_row_ * model_param.num_output_group);
+    d_row_ptr_ = row_ptr_;
 
     for (size_t fidx = 0; fidx < batch.Size(); fidx++) {
       auto col = batch[fidx];
@@ -124,6 +177,10 @@ class GPUCoordinateUpdater : public LinearUpdater {  // NOLINT
     monitor_.Start("UpdateFeature");
     for (auto group_idx = 0; group_idx < model->learner_model_param_->num_output_group;
          ++group_idx) {
+      if (coord_param_.feature_block_size > 1 && learner_param_->gpu_id >= 0) {
+        this->UpdateFeatureBlocks(group_idx, in_gpair, p_fmat, model);
+        continue;
+      }
       for (auto i = 0U; i < model->learner_model_param_->num_feature; i++) {
         auto fidx = selector_->NextFeature(
             i, *model, group_idx, in_gpair->ConstHostVector(), p_fmat,
@@ -175,6 +232,69 @@ class GPUCoordinateUpdater : public LinearUpdater {  // NOLINT
     }
   }
 
+  /*!
+   * \brief Update the features chosen by the selector in blocks of
+   *  `feature_block_size', each block taking two kernel launches and one copy.
+   */
+  void UpdateFeatureBlocks(int group_idx, HostDeviceVector<GradientPair> *in_gpair,
+                           DMatrix *p_fmat, gbm::GBLinearModel *model) {
+    auto const num_feature = model->learner_model_param_->num_feature;
+    auto const block_size = static_cast<size_t>(coord_param_.feature_block_size);
+    std::vector<int> block;
+    bool exhausted = false;
+    for (auto i = 0U; i < num_feature && !exhausted;) {
+      block.clear();
+      for (; i < num_feature && block.size() < block_size; ++i) {
+        auto fidx = selector_->NextFeature(
+            i, *model, group_idx, in_gpair->ConstHostVector(), p_fmat,
+            tparam_.reg_alpha_denorm, tparam_.reg_lambda_denorm);
+        if (fidx < 0) {
+          exhausted = true;
+          break;
+        }
+        // a feature selected twice would take its step twice
+        if (std::find(block.cbegin(), block.cend(), fidx) == block.cend()) {
+          block.push_back(fidx);
+        }
+      }
+      if (!block.empty()) {
+        this->UpdateFeatureBlock(block, group_idx, model);
+      }
+    }
+  }
+
+  void UpdateFeatureBlock(std::vector<int> const& block, int group_idx,
+                          gbm::GBLinearModel *model) {
+    dh::safe_cuda(cudaSetDevice(learner_param_->gpu_id));
+    int const num_group = model->learner_model_param_->num_output_group;
+    auto const n = static_cast<uint32_t>(block.size());
+    block_fidx_.resize(n);
+    block_grad_.resize(n);
+    block_dw_.resize(n);
+    dh::safe_cuda(cudaMemcpyAsync(block_fidx_.data().get(), block.data(), sizeof(int) * n,
+                                  cudaMemcpyHostToDevice));
+    dh::LaunchKernel {n, kFeatureBlockThreads} (
+        FeatureGradientKernel, data_, dh::ToSpan(d_row_ptr_), dh::ToSpan(block_fidx_),
+        gpair_, group_idx, num_group, dh::ToSpan(block_grad_));
+    std::vector<GradientPairPrecise> grad(n);
+    dh::safe_cuda(cudaMemcpy(grad.data(), block_grad_.data().get(),
+                             sizeof(GradientPairPrecise) * n, cudaMemcpyDeviceToHost));
+    std::vector<float> dw(n);
+    for (uint32_t k = 0; k < n; ++k) {
+      bst_float &w = (*model)[block[k]][group_idx];
+      dw[k] = static_cast<float>(tparam_.learning_rate *
+                                 CoordinateDelta(grad[k].GetGrad(), grad[k].GetHess(),
+                                                 w, tparam_.reg_alpha_denorm,
+                                                 tparam_.reg_lambda_denorm));
+      w += dw[k];
+    }
+    dh::safe_cuda(cudaMemcpyAsync(block_dw_.data().get(), dw.data(), sizeof(float) * n,
+                                  cudaMemcpyHostToDevice));
+    dh::LaunchKernel {n, kFeatureBlockThreads} (
+        FeatureResidualKernel, data_, dh::ToSpan(d_row_ptr_), dh::ToSpan(block_fidx_),
+        dh::ToSpan(block_dw_), gpair_, group_idx, num_group);
+  }
+
   // This needs to be public because of the __device__ lambda.
   GradientPair GetBiasGradient(int group_idx, int num_group) {
     dh::safe_cuda(cudaSetDevice(learner_param_->gpu_id));
@@ -249,6 +369,11 @@ class GPUCoordinateUpdater : public LinearUpdater {  // NOLINT
 
   dh::BulkAllocator ba_;
   std::vector<size_t> row_ptr_;
+  dh::device_vector<size_t> d_row_ptr_;
+  // features of the block being updated with their gradients and weight changes
+  dh::device_vector<int> block_fidx_;
+  dh::device_vector<GradientPairPrecise> block_grad_;
+  dh::device_vector<float> block_dw_;
   common::Span<xgboost::Entry> data_;
   common::Span<GradientPair> gpair_;
   dh::CubMemory temp_;
@@ -51,6 +51,38 @@ class ShotgunUpdater : public LinearUpdater {
     // lock-free parallel updates of weights
     selector_->Setup(*model, in_gpair->ConstHostVector(), p_fmat,
                      param_.reg_alpha_denorm, param_.reg_lambda_denorm, 0);
+    if (p_fmat->SingleColBlock()) {
+      if (!columns_.Matches(p_fmat)) {
+        columns_.Init(p_fmat);
+      }
+      const auto nfeat = static_cast<bst_omp_uint>(columns_.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nfeat; ++i) {
+        int ii = selector_->NextFeature
+          (i, *model, 0, in_gpair->ConstHostVector(), p_fmat, param_.reg_alpha_denorm,
+           param_.reg_lambda_denorm);
+        if (ii < 0) continue;
+        const bst_uint fid = ii;
+        auto col = columns_[ii];
+        for (int gid = 0; gid < ngroup; ++gid) {
+          auto grad = GetColumnGradient(gid, ngroup, col, gpair);
+          bst_float &w = (*model)[fid][gid];
+          auto dw = static_cast<bst_float>(
+              param_.learning_rate *
+              CoordinateDelta(grad.first, grad.second, w, param_.reg_alpha_denorm,
+                              param_.reg_lambda_denorm));
+          if (dw == 0.f) continue;
+          w += dw;
+          // update grad values
+          for (size_t j = 0; j < col.size; ++j) {
+            GradientPair &p = gpair[col.index[j] * ngroup + gid];
+            if (p.GetHess() < 0.0f) continue;
+            p += GradientPair(p.GetHess() * col.value[j] * dw, 0);
+          }
+        }
+      }
+      return;
+    }
     for (const auto &batch : p_fmat->GetBatches<CSCPage>()) {
       const auto nfeat = static_cast<bst_omp_uint>(batch.Size());
 #pragma omp parallel for schedule(static)
@@ -93,6 +125,8 @@ class ShotgunUpdater : public LinearUpdater {
   LinearTrainParam param_;
 
   std::unique_ptr<FeatureSelector> selector_;
+  // columns of a single page training matrix, kept across rounds
+  ColumnCache columns_;
 };
 
 XGBOOST_REGISTER_LINEAR_UPDATER(ShotgunUpdater, "shotgun")
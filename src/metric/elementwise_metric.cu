@@ -9,7 +9,9 @@
 #include <rabit/rabit.h>
 #include <xgboost/metric.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include "metric_common.h"
 #include "../common/math.h"
@@ -22,6 +24,7 @@
 #include <thrust/iterator/counting_iterator.h>
 
 #include "../common/device_helpers.cuh"
+#include "../common/timer.h"
 #endif  // XGBOOST_USE_CUDA
 
 namespace xgboost {
@@ -34,6 +37,18 @@ class ElementWiseMetricsReduction {
  public:
   explicit ElementWiseMetricsReduction(EvalRow policy) : policy_(std::move(policy)) {}
 
+  PackedReduceResult CpuReduceRows(bst_float const* labels, bst_float const* preds,
+                                   bst_float const* weights, size_t n) const {
+    double residue_sum = 0;
+    double weights_sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const bst_float wt = weights != nullptr ? weights[i] : 1.0f;
+      residue_sum += policy_.EvalRow(labels[i], preds[i]) * wt;
+      weights_sum += wt;
+    }
+    return PackedReduceResult{residue_sum, weights_sum};
+  }
+
   PackedReduceResult CpuReduceMetrics(
       const HostDeviceVector<bst_float>& weights,
       const HostDeviceVector<bst_float>& labels,
@@ -43,17 +58,22 @@ class ElementWiseMetricsReduction {
     const auto& h_labels = labels.HostVector();
     const auto& h_weights = weights.HostVector();
     const auto& h_preds = preds.HostVector();
-
-    bst_float residue_sum = 0;
-    bst_float weights_sum = 0;
-
-#pragma omp parallel for reduction(+: residue_sum, weights_sum) schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) {
-      const bst_float wt = h_weights.size() > 0 ? h_weights[i] : 1.0f;
-      residue_sum += policy_.EvalRow(h_labels[i], h_preds[i]) * wt;
-      weights_sum += wt;
+    bst_float const* p_weights = h_weights.size() > 0 ? h_weights.data() : nullptr;
+
+    auto const n_blocks =
+        static_cast<omp_ulong>(common::DivRoundUp(ndata, kElementWiseBlockRows));
+    std::vector<PackedReduceResult> blocks(n_blocks);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kElementWiseBlockRows;
+      size_t const n = std::min(kElementWiseBlockRows, ndata - begin);
+      blocks[b] = this->CpuReduceRows(h_labels.data() + begin, h_preds.data() + begin,
+                                      p_weights == nullptr ? nullptr : p_weights + begin, n);
+    }
+    PackedReduceResult res;
+    for (auto const& block : blocks) {
+      res += block;
     }
-    PackedReduceResult res { residue_sum, weights_sum };
     return res;
   }
 
@@ -70,6 +90,7 @@ class ElementWiseMetricsReduction {
       const HostDeviceVector<bst_float>& weights,
       const HostDeviceVector<bst_float>& labels,
       const HostDeviceVector<bst_float>& preds) {
+    common::NvtxScope nvtx {"ElementWiseMetricsReduction", common::NvtxCategory::kMetric};
     size_t n_data = preds.Size();
 
     thrust::counting_iterator<size_t> begin(0);
@@ -318,7 +339,7 @@ struct EvalTweedieNLogLik {
  * \tparam Derived the name of subclass
  */
 template<typename Policy>
-struct EvalEWiseBase : public Metric {
+struct EvalEWiseBase : public ElementWiseMetric {
   EvalEWiseBase() : policy_{}, reducer_{policy_} {}
   explicit EvalEWiseBase(char const* policy_param) :
     policy_{policy_param}, reducer_{policy_} {}
@@ -326,6 +347,16 @@ struct EvalEWiseBase : public Metric {
   bst_float Eval(const HostDeviceVector<bst_float>& preds,
                  const MetaInfo& info,
                  bool distributed) override {
+    std::vector<double> dat;
+    this->EvalStatistics(preds, info, &dat);
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Sum>(dat.data(), dat.size());
+    }
+    return this->EvalFromStatistics(dat.data());
+  }
+
+  size_t EvalStatistics(const HostDeviceVector<bst_float>& preds, const MetaInfo& info,
+                        std::vector<double>* out_stats) override {
     if (info.labels_.Size() == 0) {
       LOG(WARNING) << "label set is empty";
     }
@@ -333,28 +364,108 @@ struct EvalEWiseBase : public Metric {
         << "label and prediction size not match, "
         << "hint: use merror or mlogloss for multi-class classification";
     int device = tparam_->gpu_id;
-
     auto result =
         reducer_.Reduce(*tparam_, device, info.weights_, info.labels_, preds);
-
-    double dat[2] { result.Residue(), result.Weights() };
-
-    if (distributed) {
-      rabit::Allreduce<rabit::op::Sum>(dat, 2);
-    }
-    return Policy::GetFinal(dat[0], dat[1]);
+    out_stats->push_back(result.Residue());
+    out_stats->push_back(result.Weights());
+    return 2;
   }
 
   const char* Name() const override {
     return policy_.Name();
   }
 
+  PackedReduceResult CpuReduceRows(bst_float const* labels, bst_float const* preds,
+                                   bst_float const* weights, size_t n) const override {
+    return reducer_.CpuReduceRows(labels, preds, weights, n);
+  }
+  bst_float Final(double esum, double wsum) const override {
+    return Policy::GetFinal(esum, wsum);
+  }
+
  private:
   Policy policy_;
 
   ElementWiseMetricsReduction<Policy> reducer_;
 };
 
+namespace {
+std::vector<bst_float> FinalElementWise(std::vector<ElementWiseMetric*> const& metrics,
+                                        std::vector<double>* p_dat, bool distributed) {
+  auto& dat = *p_dat;
+  if (distributed) {
+    rabit::Allreduce<rabit::op::Sum>(dat.data(), dat.size());
+  }
+  std::vector<bst_float> results(metrics.size());
+  for (size_t m = 0; m < metrics.size(); ++m) {
+    results[m] = metrics[m]->EvalFromStatistics(dat.data() + m * 2);
+  }
+  return results;
+}
+}  // anonymous namespace
+
+std::vector<bst_float> EvalElementWise(std::vector<ElementWiseMetric*> const& metrics,
+                                       HostDeviceVector<bst_float> const& preds,
+                                       MetaInfo const& info, bool distributed) {
+  auto dat = ElementWiseStatistics(metrics, preds, info);
+  return FinalElementWise(metrics, &dat, distributed);
+}
+
+std::vector<double> ElementWiseStatistics(std::vector<ElementWiseMetric*> const& metrics,
+                                          HostDeviceVector<bst_float> const& preds,
+                                          MetaInfo const& info) {
+  if (info.labels_.Size() == 0) {
+    LOG(WARNING) << "label set is empty";
+  }
+  CHECK_EQ(preds.Size(), info.labels_.Size())
+      << "label and prediction size not match, "
+      << "hint: use merror or mlogloss for multi-class classification";
+  size_t const ndata = preds.Size();
+  size_t const n_metrics = metrics.size();
+  const auto& h_labels = info.labels_.ConstHostVector();
+  const auto& h_weights = info.weights_.ConstHostVector();
+  const auto& h_preds = preds.ConstHostVector();
+  bst_float const* p_weights = h_weights.size() > 0 ? h_weights.data() : nullptr;
+
+  auto const n_blocks =
+      static_cast<omp_ulong>(common::DivRoundUp(ndata, kElementWiseBlockRows));
+  std::vector<PackedReduceResult> blocks(n_blocks * n_metrics);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong b = 0; b < n_blocks; ++b) {
+    size_t const begin = b * kElementWiseBlockRows;
+    size_t const n = std::min(kElementWiseBlockRows, ndata - begin);
+    for (size_t m = 0; m < n_metrics; ++m) {
+      blocks[b * n_metrics + m] = metrics[m]->CpuReduceRows(
+          h_labels.data() + begin, h_preds.data() + begin,
+          p_weights == nullptr ? nullptr : p_weights + begin, n);
+    }
+  }
+  return SumElementWiseBlocks(metrics, blocks);
+}
+
+std::vector<bst_float> FinalizeElementWise(std::vector<ElementWiseMetric*> const& metrics,
+                                           std::vector<PackedReduceResult> const& blocks,
+                                           bool distributed) {
+  auto dat = SumElementWiseBlocks(metrics, blocks);
+  return FinalElementWise(metrics, &dat, distributed);
+}
+
+std::vector<double> SumElementWiseBlocks(std::vector<ElementWiseMetric*> const& metrics,
+                                         std::vector<PackedReduceResult> const& blocks) {
+  size_t const n_metrics = metrics.size();
+  size_t const n_blocks = n_metrics == 0 ? 0 : blocks.size() / n_metrics;
+  std::vector<double> dat(n_metrics * 2, 0.0);
+  for (size_t m = 0; m < n_metrics; ++m) {
+    PackedReduceResult res;
+    for (size_t b = 0; b < n_blocks; ++b) {
+      res += blocks[b * n_metrics + m];
+    }
+    dat[m * 2] = res.Residue();
+    dat[m * 2 + 1] = res.Weights();
+  }
+  return dat;
+}
+
 XGBOOST_REGISTER_METRIC(RMSE, "rmse")
 .describe("Rooted mean square error.")
 .set_body([](const char* param) { return new EvalEWiseBase<EvalRowRMSE>(); });
@@ -7,12 +7,17 @@
 #include <xgboost/metric.h>
 #include <xgboost/generic_parameters.h>
 
+#include "metric_common.h"
+
 namespace dmlc {
 DMLC_REGISTRY_ENABLE(::xgboost::MetricReg);
+DMLC_REGISTRY_ENABLE(::xgboost::MetricGPUReg);
 }
 
 namespace xgboost {
-Metric* Metric::Create(const std::string& name, GenericParameter const* tparam) {
+namespace {
+template <typename MetricRegistry>
+Metric* CreateMetricImpl(const std::string& name) {
   std::string buf = name;
   std::string prefix = name;
   const char* param;
@@ -26,23 +31,38 @@ Metric* Metric::Create(const std::string& name, GenericParameter const* tparam)
       prefix = buf;
       param = nullptr;
     }
-    auto *e = ::dmlc::Registry< ::xgboost::MetricReg>::Get()->Find(prefix.c_str());
+    auto *e = ::dmlc::Registry<MetricRegistry>::Get()->Find(prefix.c_str());
     if (e == nullptr) {
-      LOG(FATAL) << "Unknown metric function " << name;
+      return nullptr;
     }
-    auto p_metric = (e->body)(param);
-    p_metric->tparam_ = tparam;
-    return p_metric;
+    return (e->body)(param);
   } else {
     std::string prefix = buf.substr(0, pos);
-    auto *e = ::dmlc::Registry< ::xgboost::MetricReg>::Get()->Find(prefix.c_str());
+    auto *e = ::dmlc::Registry<MetricRegistry>::Get()->Find(prefix.c_str());
     if (e == nullptr) {
-      LOG(FATAL) << "Unknown metric function " << name;
+      return nullptr;
     }
-    auto p_metric = (e->body)(buf.substr(pos + 1, buf.length()).c_str());
-    p_metric->tparam_ = tparam;
-    return p_metric;
+    return (e->body)(buf.substr(pos + 1, buf.length()).c_str());
+  }
+}
+}  // anonymous namespace
+
+Metric* Metric::Create(const std::string& name, GenericParameter const* tparam) {
+  auto p_metric = CreateMetricImpl<MetricReg>(name);
+  if (p_metric == nullptr) {
+    LOG(FATAL) << "Unknown metric function " << name;
+  }
+  p_metric->tparam_ = tparam;
+  return p_metric;
+}
+
+Metric* GPUMetric::CreateGPUMetric(const std::string& name, GenericParameter const* tparam) {
+  auto p_metric = static_cast<GPUMetric*>(CreateMetricImpl<MetricGPUReg>(name));
+  if (p_metric == nullptr) {
+    return nullptr;
   }
+  p_metric->tparam_ = tparam;
+  return p_metric;
 }
 }  // namespace xgboost
 
@@ -53,5 +73,8 @@ namespace metric {
 DMLC_REGISTRY_LINK_TAG(elementwise_metric);
 DMLC_REGISTRY_LINK_TAG(multiclass_metric);
 DMLC_REGISTRY_LINK_TAG(rank_metric);
+#ifdef XGBOOST_USE_CUDA
+DMLC_REGISTRY_LINK_TAG(rank_metric_gpu);
+#endif  // XGBOOST_USE_CUDA
 }  // namespace metric
 }  // namespace xgboost
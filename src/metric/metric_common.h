@@ -10,9 +10,33 @@
 #include <limits>
 #include <string>
 
+#include "xgboost/metric.h"
 #include "../common/common.h"
 
 namespace xgboost {
+/*!
+ * \brief Device implementations of metrics, a CPU metric creates the one with its name
+ *  when there's a device ordinal.  The registry is empty without CUDA, all entries derive
+ *  from this class.
+ */
+struct GPUMetric : Metric {
+  /*! \brief Return nullptr when there's no device implementation of the metric. */
+  static Metric *CreateGPUMetric(const std::string& name, GenericParameter const* tparam);
+};
+
+/*!
+ * \brief Registry entry for device metric factory functions.
+ *  The additional parameter const char* param gives the value after @, can be null.
+ */
+struct MetricGPUReg
+    : public dmlc::FunctionRegEntryBase<MetricGPUReg,
+                                        std::function<Metric * (const char*)> > {
+};
+
+#define XGBOOST_REGISTER_GPU_METRIC(UniqueId, Name)                             \
+  ::xgboost::MetricGPUReg&  __make_ ## MetricGPUReg ## _ ## UniqueId ## __ =    \
+      ::dmlc::Registry< ::xgboost::MetricGPUReg>::Get()->__REGISTER__(Name)
+
 namespace metric {
 
 // Ranking config to be used on device and host
@@ -48,6 +72,74 @@ class PackedReduceResult {
   double Weights() const { return weights_sum_; }
 };
 
+/*!
+ * \brief Rows reduced by one CPU task in element-wise metrics, the sums of blocks are added
+ *  in order so the result doesn't depend on the number of threads.
+ */
+constexpr size_t kElementWiseBlockRows = 2048;
+
+/*!
+ * \brief A metric that's a weighted sum of a loss over the rows, so several of them can
+ *  share one pass over the predictions, see EvalElementWise.
+ */
+struct ElementWiseMetric : public Metric {
+  /*! \brief Weighted loss and weight of `n' rows on CPU, `weights' is null without weight. */
+  virtual PackedReduceResult CpuReduceRows(bst_float const* labels, bst_float const* preds,
+                                           bst_float const* weights, size_t n) const = 0;
+  /*! \brief The metric from the sums over all rows. */
+  virtual bst_float Final(double esum, double wsum) const = 0;
+  bst_float EvalFromStatistics(double const* stats) const override {
+    return this->Final(stats[0], stats[1]);
+  }
+};
+
+/*!
+ * \brief Evaluate element-wise metrics on CPU with one pass over the predictions.  Rows
+ *  are visited in blocks that stay in cache for all the metrics, the results are the same
+ *  as evaluating each metric on its own.
+ */
+std::vector<bst_float> EvalElementWise(std::vector<ElementWiseMetric*> const& metrics,
+                                       HostDeviceVector<bst_float> const& preds,
+                                       MetaInfo const& info, bool distributed);
+
+/*!
+ * \brief The metrics from sums of row blocks, `blocks[b * metrics.size() + m]' holds the
+ *  sums of metric `m' over the `b'th block of kElementWiseBlockRows rows.
+ */
+std::vector<bst_float> FinalizeElementWise(std::vector<ElementWiseMetric*> const& metrics,
+                                           std::vector<PackedReduceResult> const& blocks,
+                                           bool distributed);
+
+/*!
+ * \brief Local statistics of element-wise metrics with one pass over the predictions,
+ *  laid out as those of `Metric::EvalStatistics' of each metric one after another.
+ */
+std::vector<double> ElementWiseStatistics(std::vector<ElementWiseMetric*> const& metrics,
+                                          HostDeviceVector<bst_float> const& preds,
+                                          MetaInfo const& info);
+
+/*! \brief Same as ElementWiseStatistics, from the sums of row blocks. */
+std::vector<double> SumElementWiseBlocks(std::vector<ElementWiseMetric*> const& metrics,
+                                         std::vector<PackedReduceResult> const& blocks);
+
+/*!
+ * \brief An objective that reduces element-wise metrics while computing the gradient on
+ *  CPU, which saves the training set a pass over its labels and predictions.
+ */
+class FusedMetricObjective {
+ public:
+  virtual ~FusedMetricObjective() = default;
+  /*!
+   * \brief Compute the same gradient as ObjFunction::GetGradient, and the block sums of
+   *  `metrics' over the predictions after EvalTransform for FinalizeElementWise.
+   */
+  virtual void GetGradientWithMetrics(HostDeviceVector<bst_float> const& preds,
+                                      MetaInfo const& info,
+                                      std::vector<ElementWiseMetric*> const& metrics,
+                                      HostDeviceVector<GradientPair>* out_gpair,
+                                      std::vector<PackedReduceResult>* out_blocks) = 0;
+};
+
 }  // namespace metric
 }  // namespace xgboost
 
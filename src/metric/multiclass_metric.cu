@@ -6,7 +6,9 @@
  */
 #include <rabit/rabit.h>
 #include <xgboost/metric.h>
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include "metric_common.h"
 #include "../common/math.h"
@@ -19,6 +21,7 @@
 #include <thrust/iterator/counting_iterator.h>
 
 #include "../common/device_helpers.cuh"
+#include "../common/timer.h"
 #endif  // XGBOOST_USE_CUDA
 
 namespace xgboost {
@@ -48,25 +51,38 @@ class MultiClassMetricsReduction {
     const auto& h_weights = weights.HostVector();
     const auto& h_preds = preds.HostVector();
 
-    bst_float residue_sum = 0;
-    bst_float weights_sum = 0;
     int label_error = 0;
     bool const is_null_weight = weights.Size() == 0;
 
-#pragma omp parallel for reduction(+: residue_sum, weights_sum) schedule(static)
-    for (omp_ulong idx = 0; idx < ndata; ++idx) {
-      bst_float weight = is_null_weight ? 1.0f : h_weights[idx];
-      auto label = static_cast<int>(h_labels[idx]);
-      if (label >= 0 && label < static_cast<int>(n_class)) {
-        residue_sum += EvalRowPolicy::EvalRow(
-            label, h_preds.data() + idx * n_class, n_class) * weight;
-        weights_sum += weight;
-      } else {
-        label_error = label;
+    // Rows are summed in fixed blocks and the blocks in order, so the result doesn't
+    // depend on the number of threads.
+    auto const n_blocks =
+        static_cast<omp_ulong>(common::DivRoundUp(ndata, kElementWiseBlockRows));
+    std::vector<PackedReduceResult> blocks(n_blocks);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * kElementWiseBlockRows;
+      size_t const end = std::min(begin + kElementWiseBlockRows, ndata);
+      double residue_sum = 0;
+      double weights_sum = 0;
+      for (size_t idx = begin; idx < end; ++idx) {
+        bst_float weight = is_null_weight ? 1.0f : h_weights[idx];
+        auto label = static_cast<int>(h_labels[idx]);
+        if (label >= 0 && label < static_cast<int>(n_class)) {
+          residue_sum += EvalRowPolicy::EvalRow(
+              label, h_preds.data() + idx * n_class, n_class) * weight;
+          weights_sum += weight;
+        } else {
+          label_error = label;
+        }
       }
+      blocks[b] = PackedReduceResult{residue_sum, weights_sum};
     }
     CheckLabelError(label_error, n_class);
-    PackedReduceResult res { residue_sum, weights_sum };
+    PackedReduceResult res;
+    for (auto const& block : blocks) {
+      res += block;
+    }
 
     return res;
   }
@@ -85,6 +101,7 @@ class MultiClassMetricsReduction {
       const HostDeviceVector<bst_float>& labels,
       const HostDeviceVector<bst_float>& preds,
       const size_t n_class) {
+    common::NvtxScope nvtx {"MultiClassMetricsReduction", common::NvtxCategory::kMetric};
     size_t n_data = labels.Size();
 
     thrust::counting_iterator<size_t> begin(0);
@@ -165,6 +182,16 @@ struct EvalMClassBase : public Metric {
   bst_float Eval(const HostDeviceVector<bst_float> &preds,
                  const MetaInfo &info,
                  bool distributed) override {
+    std::vector<double> dat;
+    this->EvalStatistics(preds, info, &dat);
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Sum>(dat.data(), dat.size());
+    }
+    return this->EvalFromStatistics(dat.data());
+  }
+
+  size_t EvalStatistics(const HostDeviceVector<bst_float> &preds, const MetaInfo &info,
+                        std::vector<double>* out_stats) override {
     CHECK_NE(info.labels_.Size(), 0U) << "label set cannot be empty";
     CHECK(preds.Size() % info.labels_.Size() == 0)
         << "label and prediction size not match";
@@ -175,12 +202,13 @@ struct EvalMClassBase : public Metric {
 
     int device = tparam_->gpu_id;
     auto result = reducer_.Reduce(*tparam_, device, nclass, info.weights_, info.labels_, preds);
-    double dat[2] { result.Residue(), result.Weights() };
+    out_stats->push_back(result.Residue());
+    out_stats->push_back(result.Weights());
+    return 2;
+  }
 
-    if (distributed) {
-      rabit::Allreduce<rabit::op::Sum>(dat, 2);
-    }
-    return Derived::GetFinal(dat[0], dat[1]);
+  bst_float EvalFromStatistics(double const* stats) const override {
+    return Derived::GetFinal(stats[0], stats[1]);
   }
   /*!
    * \brief to be implemented by subclass,
@@ -9,9 +9,16 @@
 #include <dmlc/registry.h>
 #include <cmath>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "xgboost/host_device_vector.h"
+#include "../common/cox.h"
 #include "../common/math.h"
 #include "metric_common.h"
 
@@ -140,9 +147,109 @@ struct EvalAMS : public Metric {
   float ratio_;
 };
 
-/*! \brief Area Under Curve, for both classification and rank computed on CPU */
+/*!
+ * \brief Area Under Curve, for both classification and rank, computed on device when
+ *  there is one.
+ *
+ *  `auc@hist' (or `auc@hist:<bins>') bins the predictions into a fixed histogram instead
+ *  of sorting them, ties within a bin are counted as half correctly ordered.  It's linear
+ *  in the number of predictions and distributed workers only exchange the histogram, so
+ *  the result is the AUC of the whole dataset.  Ranking groups are still sorted.
+ */
 struct EvalAuc : public Metric {
+ public:
+  explicit EvalAuc(const char* param) {
+    if (param == nullptr || std::strcmp(param, "exact") == 0) {
+      return;
+    }
+    unsigned n_bins = 0;
+    if (std::strcmp(param, "hist") == 0) {
+      n_bins = kDefaultBins;
+    } else {
+      char tail = 0;
+      CHECK(std::sscanf(param, "hist:%u%c", &n_bins, &tail) == 1 && n_bins > 0)
+          << "AUC must be in format auc, auc@exact, auc@hist or auc@hist:<bins>, got auc@"
+          << param;
+    }
+    n_bins_ = n_bins;
+    name_ += "@";
+    name_ += param;
+  }
+
  private:
+  static constexpr size_t kDefaultBins = 1 << 16;
+
+  bst_float EvalHist(const HostDeviceVector<bst_float> &preds,
+                     const MetaInfo &info,
+                     bool distributed) const {
+    const auto& labels = info.labels_.ConstHostVector();
+    const auto& h_preds = preds.ConstHostVector();
+    const auto ndata = static_cast<bst_omp_uint>(h_preds.size());
+    const int32_t n_threads = omp_get_max_threads();
+
+    std::vector<float> t_lower(n_threads, std::numeric_limits<float>::max());
+    std::vector<float> t_upper(n_threads, std::numeric_limits<float>::lowest());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < ndata; ++i) {
+      const int32_t tid = omp_get_thread_num();
+      // NaN predictions are skipped
+      t_lower[tid] = std::min(t_lower[tid], h_preds[i]);
+      t_upper[tid] = std::max(t_upper[tid], h_preds[i]);
+    }
+    // negated lower bound, so both are reduced by max
+    float bounds[2] = {std::numeric_limits<float>::lowest(),
+                       std::numeric_limits<float>::lowest()};
+    for (int32_t tid = 0; tid < n_threads; ++tid) {
+      bounds[0] = std::max(bounds[0], -t_lower[tid]);
+      bounds[1] = std::max(bounds[1], t_upper[tid]);
+    }
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Max>(bounds, 2);
+    }
+    const double lower = -bounds[0];
+    const double upper = bounds[1];
+    const double scale = upper > lower ? n_bins_ / (upper - lower) : 0.0;
+
+    // positive and negative weight of each bin, one histogram per thread
+    const size_t n_stats = 2 * n_bins_;
+    std::vector<double> hist(n_threads * n_stats, 0.0);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < ndata; ++i) {
+      const bst_float pred = h_preds[i];
+      if (common::CheckNAN(pred)) {
+        continue;
+      }
+      const size_t bin =
+          std::min(static_cast<size_t>((pred - lower) * scale), n_bins_ - 1);
+      const bst_float wt = info.GetWeight(i);
+      double* stats = hist.data() + omp_get_thread_num() * n_stats + 2 * bin;
+      stats[0] += labels[i] * wt;
+      stats[1] += (1.0f - labels[i]) * wt;
+    }
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint j = 0; j < static_cast<bst_omp_uint>(n_stats); ++j) {
+      for (int32_t tid = 1; tid < n_threads; ++tid) {
+        hist[j] += hist[tid * n_stats + j];
+      }
+    }
+    hist.resize(n_stats);
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Sum>(hist.data(), hist.size());
+    }
+
+    // same as the sorted records, from the highest prediction down
+    double sum_pospair = 0.0, sum_npos = 0.0, sum_nneg = 0.0;
+    for (size_t bin = n_bins_; bin-- > 0;) {
+      const double buf_pos = hist[2 * bin], buf_neg = hist[2 * bin + 1];
+      sum_pospair += buf_neg * (sum_npos + buf_pos * 0.5);
+      sum_npos += buf_pos;
+      sum_nneg += buf_neg;
+    }
+    CHECK(sum_npos > 0.0 && sum_nneg > 0.0)
+        << "AUC: the dataset only contains pos or neg samples";
+    return static_cast<bst_float>(sum_pospair / (sum_npos * sum_nneg));
+  }
+
   template <typename WeightPolicy>
   bst_float Eval(const HostDeviceVector<bst_float> &preds,
                  const MetaInfo &info,
@@ -239,6 +346,17 @@ struct EvalAuc : public Metric {
     const bool is_ranking_task =
       !info.group_ptr_.empty() && info.weights_.Size() != info.num_row_;
 
+    if (n_bins_ != 0 && gptr.size() == 2 && !is_ranking_task) {
+      return EvalHist(preds, info, distributed);
+    }
+    if (n_bins_ == 0 && tparam_->gpu_id >= 0) {
+      if (!auc_gpu_) {
+        auc_gpu_.reset(GPUMetric::CreateGPUMetric(this->Name(), tparam_));
+      }
+      if (auc_gpu_) {
+        return auc_gpu_->Eval(preds, info, distributed);
+      }
+    }
     if (is_ranking_task) {
       return Eval<PerGroupWeightPolicy>(preds, info, distributed, gptr);
     } else {
@@ -246,48 +364,38 @@ struct EvalAuc : public Metric {
     }
   }
 
-  const char *Name() const override { return "auc"; }
+  const char *Name() const override { return name_.c_str(); }
+
+ private:
+  std::string name_ {"auc"};
+  // 0 for sorting the predictions
+  size_t n_bins_ {0};
+  std::unique_ptr<Metric> auc_gpu_;
 };
 
+constexpr size_t EvalAuc::kDefaultBins;
+
 /*! \brief Evaluate rank list */
 struct EvalRank : public Metric, public EvalRankConfig {
  public:
   bst_float Eval(const HostDeviceVector<bst_float> &preds,
                  const MetaInfo &info,
                  bool distributed) override {
-    CHECK_EQ(preds.Size(), info.labels_.Size())
-        << "label size predict size not match";
-
-    // quick consistency when group is not available
-    std::vector<unsigned> tgptr(2, 0);
-    tgptr[1] = static_cast<unsigned>(preds.Size());
-    const auto &gptr = info.group_ptr_.size() == 0 ? tgptr : info.group_ptr_;
+    std::vector<unsigned> tgptr;
+    const auto &gptr = this->GroupPtr(preds, info, &tgptr);
 
-    CHECK_NE(gptr.size(), 0U) << "must specify group when constructing rank file";
-    CHECK_EQ(gptr.back(), preds.Size())
-        << "EvalRank: group structure must match number of prediction";
-
-    const auto ngroups = static_cast<bst_omp_uint>(gptr.size() - 1);
-    // sum statistics
-    double sum_metric = 0.0f;
-
-    const auto &labels = info.labels_.ConstHostVector();
-    const auto &h_preds = preds.ConstHostVector();
-
-    #pragma omp parallel reduction(+:sum_metric)
-    {
-      // each thread takes a local rec
-      PredIndPairContainer rec;
-      #pragma omp for schedule(static)
-      for (bst_omp_uint k = 0; k < ngroups; ++k) {
-        rec.clear();
-        for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-          rec.emplace_back(h_preds[j], static_cast<int>(labels[j]));
-        }
-        sum_metric += this->EvalGroup(&rec);
+    if (tparam_->gpu_id >= 0) {
+      if (!rank_gpu_) {
+        rank_gpu_.reset(GPUMetric::CreateGPUMetric(this->Name(), tparam_));
+      }
+      if (rank_gpu_) {
+        return rank_gpu_->Eval(preds, info, distributed);
       }
     }
 
+    const auto ngroups = static_cast<bst_omp_uint>(gptr.size() - 1);
+    double sum_metric = this->SumOverGroups(preds, info, gptr);
+
     if (distributed) {
       bst_float dat[2];
       dat[0] = static_cast<bst_float>(sum_metric);
@@ -300,6 +408,24 @@ struct EvalRank : public Metric, public EvalRankConfig {
     }
   }
 
+  size_t EvalStatistics(const HostDeviceVector<bst_float> &preds, const MetaInfo &info,
+                        std::vector<double>* out_stats) override {
+    // the GPU metric reduces its own statistics
+    if (tparam_->gpu_id >= 0) {
+      return 0;
+    }
+    std::vector<unsigned> tgptr;
+    const auto &gptr = this->GroupPtr(preds, info, &tgptr);
+    out_stats->push_back(this->SumOverGroups(preds, info, gptr));
+    out_stats->push_back(static_cast<double>(gptr.size() - 1));
+    return 2;
+  }
+
+  bst_float EvalFromStatistics(double const* stats) const override {
+    // approximately estimate the metric using mean
+    return static_cast<bst_float>(stats[0]) / static_cast<bst_float>(stats[1]);
+  }
+
   const char* Name() const override {
     return name.c_str();
   }
@@ -326,6 +452,55 @@ struct EvalRank : public Metric, public EvalRankConfig {
   }
 
   virtual double EvalGroup(PredIndPairContainer *recptr) const = 0;
+
+ private:
+  // the groups of the predictions, one group of all of them when not given
+  static std::vector<unsigned> const& GroupPtr(const HostDeviceVector<bst_float> &preds,
+                                               const MetaInfo &info,
+                                               std::vector<unsigned>* tgptr) {
+    CHECK_EQ(preds.Size(), info.labels_.Size())
+        << "label size predict size not match";
+
+    // quick consistency when group is not available
+    *tgptr = {0, static_cast<unsigned>(preds.Size())};
+    const auto &gptr = info.group_ptr_.size() == 0 ? *tgptr : info.group_ptr_;
+
+    CHECK_NE(gptr.size(), 0U) << "must specify group when constructing rank file";
+    CHECK_EQ(gptr.back(), preds.Size())
+        << "EvalRank: group structure must match number of prediction";
+    return gptr;
+  }
+
+  // sum of the metric over the local groups
+  double SumOverGroups(const HostDeviceVector<bst_float> &preds, const MetaInfo &info,
+                       std::vector<unsigned> const& gptr) const {
+    const auto ngroups = static_cast<bst_omp_uint>(gptr.size() - 1);
+    const auto &labels = info.labels_.ConstHostVector();
+    const auto &h_preds = preds.ConstHostVector();
+
+    // Groups are summed in order, so the result doesn't depend on the number of threads.
+    std::vector<double> group_metric(ngroups);
+    #pragma omp parallel
+    {
+      // each thread takes a local rec
+      PredIndPairContainer rec;
+      #pragma omp for schedule(static)
+      for (bst_omp_uint k = 0; k < ngroups; ++k) {
+        rec.clear();
+        for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+          rec.emplace_back(h_preds[j], static_cast<int>(labels[j]));
+        }
+        group_metric[k] = this->EvalGroup(&rec);
+      }
+    }
+    double sum_metric = 0.0;
+    for (auto v : group_metric) {
+      sum_metric += v;
+    }
+    return sum_metric;
+  }
+
+  std::unique_ptr<Metric> rank_gpu_;
 };
 
 /*! \brief Precision at N, for both classification and rank */
@@ -418,48 +593,34 @@ struct EvalCox : public Metric {
                  const MetaInfo &info,
                  bool distributed) override {
     CHECK(!distributed) << "Cox metric does not support distributed evaluation";
-    using namespace std;  // NOLINT(*)
-
-    const auto ndata = static_cast<bst_omp_uint>(info.labels_.Size());
-    const auto &label_order = info.LabelAbsSort();
-
-    // pre-compute a sum for the denominator
-    double exp_p_sum = 0;  // we use double because we might need the precision with large datasets
-
-    const auto &h_preds = preds.ConstHostVector();
-    for (omp_ulong i = 0; i < ndata; ++i) {
-      exp_p_sum += h_preds[i];
-    }
-
-    double out = 0;
-    double accumulated_sum = 0;
-    bst_omp_uint num_events = 0;
-    const auto& labels = info.labels_.ConstHostVector();
-    for (bst_omp_uint i = 0; i < ndata; ++i) {
-      const size_t ind = label_order[i];
-      const auto label = labels[ind];
-      if (label > 0) {
-        out -= log(h_preds[ind]) - log(exp_p_sum);
-        ++num_events;
+    CHECK_EQ(preds.Size(), info.labels_.Size())
+        << "label size predict size not match";
+    // the argsort is cached by the DMatrix, computed once per training
+    const auto& label_order = info.LabelAbsOrder();
+    if (tparam_->gpu_id >= 0) {
+      if (!cox_gpu_) {
+        cox_gpu_.reset(GPUMetric::CreateGPUMetric(this->Name(), tparam_));
       }
-
-      // only update the denominator after we move forward in time (labels are sorted)
-      accumulated_sum += h_preds[ind];
-      if (i == ndata - 1 || std::abs(label) < std::abs(labels[label_order[i + 1]])) {
-        exp_p_sum -= accumulated_sum;
-        accumulated_sum = 0;
+      if (cox_gpu_) {
+        return cox_gpu_->Eval(preds, info, distributed);
       }
     }
-
-    return out/num_events;  // normalize by the number of events
+    return common::CoxNegLogLik(preds.ConstHostPointer(), info.labels_.ConstHostPointer(),
+                                label_order.ConstHostPointer(), preds.Size());
   }
 
   const char* Name() const override {
     return "cox-nloglik";
   }
+
+ private:
+  std::unique_ptr<Metric> cox_gpu_;
 };
 
-/*! \brief Area Under PR Curve, for both classification and rank computed on CPU */
+/*!
+ * \brief Area Under PR Curve, for both classification and rank, computed on device when
+ *  there is one.
+ */
 struct EvalAucPR : public Metric {
   // implementation of AUC-PR for weighted data
   // translated from PRROC R Package
@@ -580,6 +741,14 @@ struct EvalAucPR : public Metric {
     const bool is_ranking_task =
       !info.group_ptr_.empty() && info.weights_.Size() != info.num_row_;
 
+    if (tparam_->gpu_id >= 0) {
+      if (!aucpr_gpu_) {
+        aucpr_gpu_.reset(GPUMetric::CreateGPUMetric(this->Name(), tparam_));
+      }
+      if (aucpr_gpu_) {
+        return aucpr_gpu_->Eval(preds, info, distributed);
+      }
+    }
     if (is_ranking_task) {
       return Eval<PerGroupWeightPolicy>(preds, info, distributed, gptr);
     } else {
@@ -588,6 +757,9 @@ struct EvalAucPR : public Metric {
   }
 
   const char *Name() const override { return "aucpr"; }
+
+ private:
+  std::unique_ptr<Metric> aucpr_gpu_;
 };
 
 XGBOOST_REGISTER_METRIC(AMS, "ams")
@@ -595,8 +767,8 @@ XGBOOST_REGISTER_METRIC(AMS, "ams")
 .set_body([](const char* param) { return new EvalAMS(param); });
 
 XGBOOST_REGISTER_METRIC(Auc, "auc")
-.describe("Area under curve for both classification and rank.")
-.set_body([](const char* param) { return new EvalAuc(); });
+.describe("Area under curve for both classification and rank, auc@hist bins the predictions.")
+.set_body([](const char* param) { return new EvalAuc(param); });
 
 XGBOOST_REGISTER_METRIC(AucPR, "aucpr")
 .describe("Area under PR curve for both classification and rank.")
@@ -0,0 +1,535 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file rank_metric.cu
+ * \brief Device implementations of the prediction rank based metrics.  Predictions are
+ *  sorted within each group by dh::SegmentSorter, the same order as the stable sort of
+ *  the CPU metrics, and the statistics are reduced by group on device.
+ */
+#include <rabit/rabit.h>
+#include <dmlc/registry.h>
+
+#include <thrust/execution_policy.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/discard_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/scatter.h>
+#include <thrust/transform_reduce.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xgboost/host_device_vector.h"
+#include "xgboost/metric.h"
+#include "metric_common.h"
+#include "../common/cox.h"
+#include "../common/device_helpers.cuh"
+
+namespace xgboost {
+namespace metric {
+// tag the this file, used by force static link later.
+DMLC_REGISTRY_FILE_TAG(rank_metric_gpu);
+
+namespace {
+template <typename T>
+common::Span<T> ToSpan(dh::caching_device_vector<T>* vec) {
+  return {vec->data().get(), vec->size()};
+}
+
+/*! \brief The whole dataset is one group when there's no query group. */
+std::vector<uint32_t> GroupPtr(MetaInfo const& info, size_t n) {
+  if (info.group_ptr_.empty()) {
+    return {0, static_cast<uint32_t>(n)};
+  }
+  return info.group_ptr_;
+}
+
+/*! \brief Group of each position, positions of a group are contiguous. */
+dh::caching_device_vector<uint32_t> PositionGroups(int32_t device,
+                                                    common::Span<uint32_t const> d_gptr,
+                                                    uint32_t n) {
+  dh::caching_device_vector<uint32_t> group(n);
+  auto d_group = ToSpan(&group);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    d_group[i] = dh::UpperBound(d_gptr.data(), d_gptr.size(), static_cast<uint32_t>(i)) - 1;
+  });
+  return group;
+}
+
+/*! \brief Sum the values of each group, groups without any value are 0. */
+dh::caching_device_vector<double> SumByGroup(dh::caching_device_vector<uint32_t> const& group,
+                                             dh::caching_device_vector<double> const& values,
+                                             uint32_t n_groups) {
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  dh::caching_device_vector<uint32_t> keys(group.size());
+  dh::caching_device_vector<double> sums(group.size());
+  auto end = thrust::reduce_by_key(thrust::cuda::par(alloc), group.begin(), group.end(),
+                                   values.begin(), keys.begin(), sums.begin());
+  dh::caching_device_vector<double> out(n_groups, 0.0);
+  thrust::scatter(thrust::cuda::par(alloc), sums.begin(), end.second, keys.begin(),
+                  out.begin());
+  return out;
+}
+
+/*!
+ * \brief Weight of the positive and negative labels in each run of tied predictions, runs
+ *  are ordered by descending prediction within each group.
+ */
+struct TiedRuns {
+  dh::caching_device_vector<uint32_t> group;
+  dh::caching_device_vector<double> pos;
+  dh::caching_device_vector<double> neg;
+  // weight of the runs ranked above in the same group
+  dh::caching_device_vector<double> pos_above;
+  dh::caching_device_vector<double> neg_above;
+  // weight of each group
+  dh::caching_device_vector<double> total_pos;
+  dh::caching_device_vector<double> total_neg;
+
+  uint32_t NumRuns() const { return group.size(); }
+  uint32_t NumGroups() const { return total_pos.size(); }
+};
+
+void BuildTiedRuns(int32_t device, HostDeviceVector<bst_float> const& preds,
+                   MetaInfo const& info, TiedRuns* out) {
+  auto gptr = GroupPtr(info, preds.Size());
+  // For ranking task, weights are per-group
+  // For binary classification task, weights are per-instance
+  bool const per_group_weight =
+      !info.group_ptr_.empty() && info.weights_.Size() != info.num_row_;
+  dh::SegmentSorter<float> sorter;
+  sorter.SortItems(preds.ConstDevicePointer(), preds.Size(), gptr);
+
+  uint32_t const n = sorter.GetNumItems();
+  uint32_t const n_groups = sorter.GetNumGroups();
+  auto d_sorted = sorter.GetItemsSpan();
+  auto d_orig = sorter.GetOriginalPositionsSpan();
+  auto d_gptr = sorter.GetGroupsSpan();
+  auto d_labels = info.labels_.ConstDeviceSpan();
+  auto d_weights = info.weights_.ConstDeviceSpan();
+  bool const null_weight = info.weights_.Size() == 0;
+
+  auto position_group = PositionGroups(device, d_gptr, n);
+  dh::caching_device_vector<uint32_t> run(n);
+  dh::caching_device_vector<double> position_pos(n), position_neg(n);
+  auto d_group = ToSpan(&position_group);
+  auto d_run = ToSpan(&run);
+  auto d_pos = ToSpan(&position_pos);
+  auto d_neg = ToSpan(&position_neg);
+  dh::LaunchN(device, n, [=] __device__(size_t i) {
+    uint32_t g = d_group[i];
+    d_run[i] = (i == d_gptr[g] || d_sorted[i] != d_sorted[i - 1]) ? 1 : 0;
+    uint32_t idx = d_orig[i];
+    float wt = null_weight ? 1.0f : d_weights[per_group_weight ? g : idx];
+    d_pos[i] = d_labels[idx] * wt;
+    d_neg[i] = (1.0f - d_labels[idx]) * wt;
+  });
+
+  dh::XGBCachingDeviceAllocator<char> alloc;
+  // 1 based run index of each position
+  thrust::inclusive_scan(thrust::cuda::par(alloc), run.begin(), run.end(), run.begin());
+  uint32_t const n_runs = n == 0 ? 0 : run.back();
+  out->group.resize(n_runs);
+  out->pos.resize(n_runs);
+  out->neg.resize(n_runs);
+  thrust::reduce_by_key(thrust::cuda::par(alloc), run.begin(), run.end(),
+                        position_pos.begin(), thrust::make_discard_iterator(), out->pos.begin());
+  thrust::reduce_by_key(thrust::cuda::par(alloc), run.begin(), run.end(),
+                        position_neg.begin(), thrust::make_discard_iterator(), out->neg.begin());
+  thrust::reduce_by_key(thrust::cuda::par(alloc), run.begin(), run.end(),
+                        position_group.begin(), thrust::make_discard_iterator(),
+                        out->group.begin(), thrust::equal_to<uint32_t>(),
+                        thrust::maximum<uint32_t>());
+
+  out->pos_above.resize(n_runs);
+  out->neg_above.resize(n_runs);
+  thrust::exclusive_scan_by_key(thrust::cuda::par(alloc), out->group.begin(), out->group.end(),
+                                out->pos.begin(), out->pos_above.begin());
+  thrust::exclusive_scan_by_key(thrust::cuda::par(alloc), out->group.begin(), out->group.end(),
+                                out->neg.begin(), out->neg_above.begin());
+  out->total_pos = SumByGroup(out->group, out->pos, n_groups);
+  out->total_neg = SumByGroup(out->group, out->neg, n_groups);
+}
+
+/*! \brief Average over the groups having both labels, same as the CPU metrics. */
+bst_float AverageOverGroups(PackedReduceResult result, bool distributed, char const* name) {
+  bst_float dat[2] = {static_cast<bst_float>(result.Residue()),
+                      static_cast<bst_float>(result.Weights())};
+  if (distributed) {
+    rabit::Allreduce<rabit::op::Sum>(dat, 2);
+  }
+  CHECK_GT(dat[1], 0.0f)
+      << name << ": the dataset only contains pos or neg samples";
+  return dat[0] / dat[1];
+}
+}  // anonymous namespace
+
+/*! \brief Area Under Curve, for both classification and rank computed on device. */
+struct EvalAucGpu : public GPUMetric {
+  bst_float Eval(const HostDeviceVector<bst_float> &preds,
+                 const MetaInfo &info,
+                 bool distributed) override {
+    int32_t const device = tparam_->gpu_id;
+    dh::safe_cuda(cudaSetDevice(device));
+    preds.SetDevice(device);
+    info.labels_.SetDevice(device);
+    info.weights_.SetDevice(device);
+
+    TiedRuns runs;
+    BuildTiedRuns(device, preds, info, &runs);
+    // ties are counted as half ordered
+    dh::caching_device_vector<double> pairs(runs.NumRuns());
+    auto d_pairs = ToSpan(&pairs);
+    auto d_pos = ToSpan(&runs.pos);
+    auto d_neg = ToSpan(&runs.neg);
+    auto d_pos_above = ToSpan(&runs.pos_above);
+    dh::LaunchN(device, runs.NumRuns(), [=] __device__(size_t r) {
+      d_pairs[r] = d_neg[r] * (d_pos_above[r] + d_pos[r] * 0.5);
+    });
+    auto group_pairs = SumByGroup(runs.group, pairs, runs.NumGroups());
+
+    auto d_group_pairs = ToSpan(&group_pairs);
+    auto d_total_pos = ToSpan(&runs.total_pos);
+    auto d_total_neg = ToSpan(&runs.total_neg);
+    dh::XGBCachingDeviceAllocator<char> alloc;
+    auto result = thrust::transform_reduce(
+        thrust::cuda::par(alloc), thrust::make_counting_iterator(0u),
+        thrust::make_counting_iterator(runs.NumGroups()),
+        [=] XGBOOST_DEVICE(uint32_t g) {
+          if (d_total_pos[g] <= 0.0 || d_total_neg[g] <= 0.0) {
+            return PackedReduceResult{};
+          }
+          return PackedReduceResult{d_group_pairs[g] / (d_total_pos[g] * d_total_neg[g]), 1.0};
+        },
+        PackedReduceResult{}, thrust::plus<PackedReduceResult>());
+    return AverageOverGroups(result, distributed, "AUC");
+  }
+
+  const char *Name() const override { return "auc"; }
+};
+
+/*! \brief Area Under PR Curve, for both classification and rank computed on device. */
+struct EvalAucPRGpu : public GPUMetric {
+  bst_float Eval(const HostDeviceVector<bst_float> &preds,
+                 const MetaInfo &info,
+                 bool distributed) override {
+    int32_t const device = tparam_->gpu_id;
+    dh::safe_cuda(cudaSetDevice(device));
+    preds.SetDevice(device);
+    info.labels_.SetDevice(device);
+    info.weights_.SetDevice(device);
+
+    TiedRuns runs;
+    BuildTiedRuns(device, preds, info, &runs);
+    // area of each run, see the CPU metric for the interpolation
+    dh::caching_device_vector<double> area(runs.NumRuns());
+    auto d_area = ToSpan(&area);
+    auto d_group = ToSpan(&runs.group);
+    auto d_pos = ToSpan(&runs.pos);
+    auto d_neg = ToSpan(&runs.neg);
+    auto d_pos_above = ToSpan(&runs.pos_above);
+    auto d_neg_above = ToSpan(&runs.neg_above);
+    auto d_total_pos = ToSpan(&runs.total_pos);
+    auto d_total_neg = ToSpan(&runs.total_neg);
+    dh::LaunchN(device, runs.NumRuns(), [=] __device__(size_t r) {
+      uint32_t g = d_group[r];
+      double const total_pos = d_total_pos[g];
+      if (total_pos <= 0.0 || d_total_neg[g] <= 0.0) {
+        d_area[r] = 0.0;
+        return;
+      }
+      double const prevtp = d_pos_above[r], tp = prevtp + d_pos[r];
+      double const prevfp = d_neg_above[r], fp = prevfp + d_neg[r];
+      double a = 1.0, b = 0.0;
+      if (tp != prevtp) {
+        double h = (fp - prevfp) / (tp - prevtp);
+        a = 1.0 + h;
+        b = (prevfp - h * prevtp) / total_pos;
+      }
+      if (0.0 != b) {
+        d_area[r] = (tp / total_pos - prevtp / total_pos -
+                     b / a * (log(a * tp / total_pos + b) -
+                              log(a * prevtp / total_pos + b))) / a;
+      } else {
+        d_area[r] = (tp / total_pos - prevtp / total_pos) / a;
+      }
+    });
+    auto group_area = SumByGroup(runs.group, area, runs.NumGroups());
+
+    auto d_group_area = ToSpan(&group_area);
+    dh::XGBCachingDeviceAllocator<char> alloc;
+    auto result = thrust::transform_reduce(
+        thrust::cuda::par(alloc), thrust::make_counting_iterator(0u),
+        thrust::make_counting_iterator(runs.NumGroups()),
+        [=] XGBOOST_DEVICE(uint32_t g) {
+          if (d_total_pos[g] <= 0.0 || d_total_neg[g] <= 0.0) {
+            return PackedReduceResult{};
+          }
+          return PackedReduceResult{d_group_area[g], 1.0};
+        },
+        PackedReduceResult{}, thrust::plus<PackedReduceResult>());
+    CHECK_LE(result.Residue(), result.Weights()) << "AUC-PR: AUC > 1.0";
+    return AverageOverGroups(result, distributed, "AUC-PR");
+  }
+
+  const char *Name() const override { return "aucpr"; }
+};
+
+/*! \brief Evaluate rank list on device, the metric of each group is defined by subclass. */
+struct EvalRankGpu : public GPUMetric, public EvalRankConfig {
+ public:
+  bst_float Eval(const HostDeviceVector<bst_float> &preds,
+                 const MetaInfo &info,
+                 bool distributed) override {
+    int32_t const device = tparam_->gpu_id;
+    dh::safe_cuda(cudaSetDevice(device));
+    preds.SetDevice(device);
+    info.labels_.SetDevice(device);
+
+    auto gptr = GroupPtr(info, preds.Size());
+    dh::SegmentSorter<float> sorter;
+    sorter.SortItems(preds.ConstDevicePointer(), preds.Size(), gptr);
+    auto group = PositionGroups(device, sorter.GetGroupsSpan(), sorter.GetNumItems());
+    double sum_metric = this->EvalGroups(device, sorter, gptr, group, info.labels_);
+
+    auto const ngroups = static_cast<bst_float>(gptr.size() - 1);
+    if (distributed) {
+      bst_float dat[2];
+      dat[0] = static_cast<bst_float>(sum_metric);
+      dat[1] = ngroups;
+      // approximately estimate the metric using mean
+      rabit::Allreduce<rabit::op::Sum>(dat, 2);
+      return dat[0] / dat[1];
+    } else {
+      return static_cast<bst_float>(sum_metric) / ngroups;
+    }
+  }
+
+  const char* Name() const override {
+    return name.c_str();
+  }
+
+  /*!
+   * \brief Sum of the metric over all groups.
+   * \param sorter predictions sorted within each group.
+   * \param gptr   group pointer on host.
+   * \param group  group of each sorted position.
+   */
+  virtual double EvalGroups(int32_t device, dh::SegmentSorter<float> const& sorter,
+                            std::vector<uint32_t> const& gptr,
+                            dh::caching_device_vector<uint32_t> const& group,
+                            HostDeviceVector<bst_float> const& labels) = 0;
+
+ protected:
+  explicit EvalRankGpu(const char* name, const char* param) {
+    using namespace std;  // NOLINT(*)
+
+    if (param != nullptr) {
+      std::ostringstream os;
+      if (sscanf(param, "%u[-]?", &topn) == 1) {
+        os << name << '@' << param;
+        this->name = os.str();
+      } else {
+        os << name << param;
+        this->name = os.str();
+      }
+      if (param[strlen(param) - 1] == '-') {
+        minus = true;
+      }
+    } else {
+      this->name = name;
+    }
+  }
+};
+
+/*! \brief Precision at N, for both classification and rank */
+struct EvalPrecisionGpu : public EvalRankGpu {
+ public:
+  explicit EvalPrecisionGpu(const char* name, const char* param) : EvalRankGpu(name, param) {}
+
+  double EvalGroups(int32_t device, dh::SegmentSorter<float> const& sorter,
+                    std::vector<uint32_t> const& gptr,
+                    dh::caching_device_vector<uint32_t> const& group,
+                    HostDeviceVector<bst_float> const& labels) override {
+    auto d_orig = sorter.GetOriginalPositionsSpan();
+    auto d_gptr = sorter.GetGroupsSpan();
+    auto d_group = group.data().get();
+    auto d_labels = labels.ConstDeviceSpan();
+    uint32_t const topn = this->topn;
+    dh::XGBCachingDeviceAllocator<char> alloc;
+    double nhit = thrust::transform_reduce(
+        thrust::cuda::par(alloc), thrust::make_counting_iterator(0u),
+        thrust::make_counting_iterator(sorter.GetNumItems()),
+        [=] XGBOOST_DEVICE(uint32_t i) {
+          uint32_t rank = i - d_gptr[d_group[i]];
+          return rank < topn && static_cast<int>(d_labels[d_orig[i]]) != 0 ? 1.0 : 0.0;
+        },
+        0.0, thrust::plus<double>());
+    return nhit / this->topn;
+  }
+};
+
+/*! \brief NDCG: Normalized Discounted Cumulative Gain at N */
+struct EvalNDCGGpu : public EvalRankGpu {
+ public:
+  explicit EvalNDCGGpu(const char* name, const char* param) : EvalRankGpu(name, param) {}
+
+  /*! \brief DCG of each position, `rel' gives the relevance degree of a sorted position. */
+  template <typename Relevance>
+  static dh::caching_device_vector<double> DCG(int32_t device, uint32_t n, uint32_t topn,
+                                               common::Span<uint32_t const> d_gptr,
+                                               uint32_t const* d_group, Relevance rel) {
+    dh::caching_device_vector<double> dcg(n);
+    auto d_dcg = ToSpan(&dcg);
+    dh::LaunchN(device, n, [=] __device__(size_t i) {
+      uint32_t rank = i - d_gptr[d_group[i]];
+      unsigned r = rel(i);
+      d_dcg[i] = rank < topn && r != 0 ? ((1 << r) - 1) / log2(rank + 2.0) : 0.0;
+    });
+    return dcg;
+  }
+
+  double EvalGroups(int32_t device, dh::SegmentSorter<float> const& sorter,
+                    std::vector<uint32_t> const& gptr,
+                    dh::caching_device_vector<uint32_t> const& group,
+                    HostDeviceVector<bst_float> const& labels) override {
+    uint32_t const n = sorter.GetNumItems();
+    uint32_t const n_groups = sorter.GetNumGroups();
+    auto d_orig = sorter.GetOriginalPositionsSpan();
+    auto d_gptr = sorter.GetGroupsSpan();
+    auto d_group = group.data().get();
+    auto d_labels = labels.ConstDeviceSpan();
+    auto dcg = DCG(device, n, this->topn, d_gptr, d_group, [=] __device__(size_t i) {
+      return static_cast<unsigned>(static_cast<int>(d_labels[d_orig[i]]));
+    });
+    // labels sorted within each group for the ideal DCG
+    dh::SegmentSorter<float> label_sorter;
+    label_sorter.SortItems(labels.ConstDevicePointer(), n, gptr);
+    auto d_sorted_labels = label_sorter.GetItemsSpan();
+    auto idcg = DCG(device, n, this->topn, d_gptr, d_group, [=] __device__(size_t i) {
+      return static_cast<unsigned>(static_cast<int>(d_sorted_labels[i]));
+    });
+
+    auto group_dcg = SumByGroup(group, dcg, n_groups);
+    auto group_idcg = SumByGroup(group, idcg, n_groups);
+    auto d_group_dcg = ToSpan(&group_dcg);
+    auto d_group_idcg = ToSpan(&group_idcg);
+    bool const minus = this->minus;
+    dh::XGBCachingDeviceAllocator<char> alloc;
+    return thrust::transform_reduce(
+        thrust::cuda::par(alloc), thrust::make_counting_iterator(0u),
+        thrust::make_counting_iterator(n_groups),
+        [=] XGBOOST_DEVICE(uint32_t g) {
+          if (d_group_idcg[g] == 0.0) {
+            return minus ? 0.0 : 1.0;
+          }
+          return d_group_dcg[g] / d_group_idcg[g];
+        },
+        0.0, thrust::plus<double>());
+  }
+};
+
+/*! \brief Mean Average Precision at N, for both classification and rank */
+struct EvalMAPGpu : public EvalRankGpu {
+ public:
+  explicit EvalMAPGpu(const char* name, const char* param) : EvalRankGpu(name, param) {}
+
+  double EvalGroups(int32_t device, dh::SegmentSorter<float> const& sorter,
+                    std::vector<uint32_t> const& gptr,
+                    dh::caching_device_vector<uint32_t> const& group,
+                    HostDeviceVector<bst_float> const& labels) override {
+    uint32_t const n = sorter.GetNumItems();
+    uint32_t const n_groups = sorter.GetNumGroups();
+    auto d_orig = sorter.GetOriginalPositionsSpan();
+    auto d_gptr = sorter.GetGroupsSpan();
+    auto d_group = group.data().get();
+    auto d_labels = labels.ConstDeviceSpan();
+
+    dh::caching_device_vector<double> hits(n);
+    auto d_hits = ToSpan(&hits);
+    dh::LaunchN(device, n, [=] __device__(size_t i) {
+      d_hits[i] = static_cast<int>(d_labels[d_orig[i]]) != 0 ? 1.0 : 0.0;
+    });
+    // number of hits up to each position of its group
+    dh::XGBCachingDeviceAllocator<char> alloc;
+    dh::caching_device_vector<double> cum_hits(n);
+    thrust::inclusive_scan_by_key(thrust::cuda::par(alloc), group.begin(), group.end(),
+                                  hits.begin(), cum_hits.begin());
+    dh::caching_device_vector<double> precision(n);
+    auto d_cum_hits = ToSpan(&cum_hits);
+    auto d_precision = ToSpan(&precision);
+    uint32_t const topn = this->topn;
+    dh::LaunchN(device, n, [=] __device__(size_t i) {
+      uint32_t rank = i - d_gptr[d_group[i]];
+      d_precision[i] = d_hits[i] != 0.0 && rank < topn ? d_cum_hits[i] / (rank + 1) : 0.0;
+    });
+
+    auto group_ap = SumByGroup(group, precision, n_groups);
+    auto group_hits = SumByGroup(group, hits, n_groups);
+    auto d_group_ap = ToSpan(&group_ap);
+    auto d_group_hits = ToSpan(&group_hits);
+    bool const minus = this->minus;
+    return thrust::transform_reduce(
+        thrust::cuda::par(alloc), thrust::make_counting_iterator(0u),
+        thrust::make_counting_iterator(n_groups),
+        [=] XGBOOST_DEVICE(uint32_t g) {
+          if (d_group_hits[g] == 0.0) {
+            return minus ? 0.0 : 1.0;
+          }
+          return d_group_ap[g] / d_group_hits[g];
+        },
+        0.0, thrust::plus<double>());
+  }
+};
+
+/*! \brief Cox: Partial likelihood of the Cox proportional hazards model, on device. */
+struct EvalCoxGpu : public GPUMetric {
+  bst_float Eval(const HostDeviceVector<bst_float> &preds,
+                 const MetaInfo &info,
+                 bool distributed) override {
+    CHECK(!distributed) << "Cox metric does not support distributed evaluation";
+    int32_t const device = tparam_->gpu_id;
+    auto const& label_order = info.LabelAbsOrder();
+    preds.SetDevice(device);
+    info.labels_.SetDevice(device);
+    label_order.SetDevice(device);
+    return common::CoxNegLogLikDevice(device, preds.ConstDeviceSpan(),
+                                      info.labels_.ConstDeviceSpan(),
+                                      label_order.ConstDeviceSpan());
+  }
+
+  const char* Name() const override {
+    return "cox-nloglik";
+  }
+};
+
+XGBOOST_REGISTER_GPU_METRIC(AucGpu, "auc")
+.describe("Area under curve for both classification and rank.")
+.set_body([](const char* param) { return new EvalAucGpu(); });
+
+XGBOOST_REGISTER_GPU_METRIC(AucPRGpu, "aucpr")
+.describe("Area under PR curve for both classification and rank.")
+.set_body([](const char* param) { return new EvalAucPRGpu(); });
+
+XGBOOST_REGISTER_GPU_METRIC(PrecisionGpu, "pre")
+.describe("precision@k for rank.")
+.set_body([](const char* param) { return new EvalPrecisionGpu("pre", param); });
+
+XGBOOST_REGISTER_GPU_METRIC(NDCGGpu, "ndcg")
+.describe("ndcg@k for rank.")
+.set_body([](const char* param) { return new EvalNDCGGpu("ndcg", param); });
+
+XGBOOST_REGISTER_GPU_METRIC(MAPGpu, "map")
+.describe("map@k for rank.")
+.set_body([](const char* param) { return new EvalMAPGpu("map", param); });
+
+XGBOOST_REGISTER_GPU_METRIC(CoxGpu, "cox-nloglik")
+.describe("Negative log partial likelihood of Cox proportional hazards model.")
+.set_body([](const char* param) { return new EvalCoxGpu(); });
+}  // namespace metric
+}  // namespace xgboost
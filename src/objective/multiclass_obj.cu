@@ -19,8 +19,13 @@
 
 #include "../common/common.h"
 #include "../common/math.h"
+#include "../common/softmax.h"
 #include "../common/transform.h"
 
+#if defined(__CUDACC__)
+#include "../common/device_helpers.cuh"
+#endif  // defined(__CUDACC__)
+
 namespace xgboost {
 namespace obj {
 
@@ -30,13 +35,116 @@ DMLC_REGISTRY_FILE_TAG(multiclass_obj_gpu);
 
 struct SoftmaxMultiClassParam : public XGBoostParameter<SoftmaxMultiClassParam> {
   int num_class;
+  bool fast_softmax;
   // declare parameters
   DMLC_DECLARE_PARAMETER(SoftmaxMultiClassParam) {
     DMLC_DECLARE_FIELD(num_class).set_lower_bound(1)
         .describe("Number of output class in the multi-class classification.");
+    DMLC_DECLARE_FIELD(fast_softmax).set_default(false)
+        .describe("Use a vectorized approximation of exp for softmax on CPU.");
   }
 };
 
+#if defined(__CUDACC__)
+namespace {
+constexpr int kWarpSize = 32;
+constexpr uint32_t kWarpBlockThreads = 256;
+// From this number of classes a row is handled by a warp instead of a single thread.
+constexpr int kWarpPerRowClasses = 32;
+
+__device__ float WarpMax(float value) {
+  for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+    value = fmaxf(value, __shfl_xor_sync(0xffffffff, value, offset));
+  }
+  return value;
+}
+
+__device__ double WarpSum(double value) {
+  for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+    value += __shfl_xor_sync(0xffffffff, value, offset);
+  }
+  return value;
+}
+
+__global__ void SoftmaxGradientWarpKernel(common::Span<bst_float const> preds,
+                                          common::Span<bst_float const> labels,
+                                          common::Span<bst_float const> weights,
+                                          int nclass, common::Span<GradientPair> gpair,
+                                          int* label_correct) {
+  size_t const idx =
+      (static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kWarpSize;
+  int const lane = threadIdx.x % kWarpSize;
+  // All lanes of a warp share the row so the warp either exits or stays whole.
+  if (idx >= labels.size()) {
+    return;
+  }
+  common::Span<bst_float const> point = preds.subspan(idx * nclass, nclass);
+  bst_float wmax = std::numeric_limits<bst_float>::min();
+  for (int k = lane; k < nclass; k += kWarpSize) { wmax = fmaxf(point[k], wmax); }
+  wmax = WarpMax(wmax);
+  double wsum = 0.0f;
+  for (int k = lane; k < nclass; k += kWarpSize) { wsum += expf(point[k] - wmax); }
+  wsum = WarpSum(wsum);
+  auto label = labels[idx];
+  if (label < 0 || label >= nclass) {
+    label_correct[0] = 0;
+    label = 0;
+  }
+  bst_float wt = weights.empty() ? 1.0f : weights[idx];
+  for (int k = lane; k < nclass; k += kWarpSize) {
+    bst_float p = expf(point[k] - wmax) / static_cast<float>(wsum);
+    const float eps = 1e-16f;
+    const bst_float h = fmax(2.0f * p * (1.0f - p) * wt, eps);
+    p = label == k ? p - 1.0f : p;
+    gpair[idx * nclass + k] = GradientPair(p * wt, h);
+  }
+}
+
+__global__ void SoftmaxWarpKernel(common::Span<bst_float> preds, size_t n_rows,
+                                  int nclass) {
+  size_t const idx =
+      (static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kWarpSize;
+  int const lane = threadIdx.x % kWarpSize;
+  if (idx >= n_rows) {
+    return;
+  }
+  common::Span<bst_float> point = preds.subspan(idx * nclass, nclass);
+  bst_float wmax = point[0];
+  for (int k = lane; k < nclass; k += kWarpSize) { wmax = fmaxf(point[k], wmax); }
+  wmax = WarpMax(wmax);
+  double wsum = 0.0f;
+  for (int k = lane; k < nclass; k += kWarpSize) {
+    point[k] = expf(point[k] - wmax);
+    wsum += point[k];
+  }
+  wsum = WarpSum(wsum);
+  for (int k = lane; k < nclass; k += kWarpSize) { point[k] /= static_cast<float>(wsum); }
+}
+
+uint32_t WarpPerRowGrids(size_t n_rows) {
+  return static_cast<uint32_t>(common::DivRoundUp(n_rows * kWarpSize, kWarpBlockThreads));
+}
+
+void SoftmaxGradientWarp(int device, HostDeviceVector<bst_float> const& preds,
+                         MetaInfo const& info, int nclass,
+                         HostDeviceVector<GradientPair>* out_gpair,
+                         HostDeviceVector<int>* label_correct) {
+  dh::safe_cuda(cudaSetDevice(device));
+  dh::LaunchKernel {WarpPerRowGrids(info.labels_.Size()), kWarpBlockThreads} (
+      SoftmaxGradientWarpKernel, preds.ConstDeviceSpan(), info.labels_.ConstDeviceSpan(),
+      info.weights_.ConstDeviceSpan(), nclass, out_gpair->DeviceSpan(),
+      label_correct->DevicePointer());
+}
+
+void SoftmaxWarp(int device, HostDeviceVector<bst_float>* io_preds, size_t n_rows,
+                 int nclass) {
+  dh::safe_cuda(cudaSetDevice(device));
+  dh::LaunchKernel {WarpPerRowGrids(n_rows), kWarpBlockThreads} (
+      SoftmaxWarpKernel, io_preds->DeviceSpan(), n_rows, nclass);
+}
+}  // anonymous namespace
+#endif  // defined(__CUDACC__)
+
 class SoftmaxMultiClassObj : public ObjFunction {
  public:
   explicit SoftmaxMultiClassObj(bool output_prob)
@@ -78,36 +186,48 @@ class SoftmaxMultiClassObj : public ObjFunction {
           << "Number of weights should be equal to number of data points.";
     }
 
-    common::Transform<>::Init(
-        [=] XGBOOST_DEVICE(size_t idx,
-                           common::Span<GradientPair> gpair,
-                           common::Span<bst_float const> labels,
-                           common::Span<bst_float const> preds,
-                           common::Span<bst_float const> weights,
-                           common::Span<int> _label_correct) {
-          common::Span<bst_float const> point = preds.subspan(idx * nclass, nclass);
-
-          // Part of Softmax function
-          bst_float wmax = std::numeric_limits<bst_float>::min();
-          for (auto const i : point) { wmax = fmaxf(i, wmax); }
-          double wsum = 0.0f;
-          for (auto const i : point) { wsum += expf(i - wmax); }
-          auto label = labels[idx];
-          if (label < 0 || label >= nclass) {
-            _label_correct[0] = 0;
-            label = 0;
-          }
-          bst_float wt = is_null_weight ? 1.0f : weights[idx];
-          for (int k = 0; k < nclass; ++k) {
-            // Computation duplicated to avoid creating a cache.
-            bst_float p = expf(point[k] - wmax) / static_cast<float>(wsum);
-            const float eps = 1e-16f;
-            const bst_float h = fmax(2.0f * p * (1.0f - p) * wt, eps);
-            p = label == k ? p - 1.0f : p;
-            gpair[idx * nclass + k] = GradientPair(p * wt, h);
-          }
-        }, common::Range{0, ndata}, device, false)
-        .Eval(out_gpair, &info.labels_, &preds, &info.weights_, &label_correct_);
+    if (device < 0) {
+      // Vectorized kernels, the exponentials are computed once per value.
+      label_correct_.HostVector()[0] = common::SoftmaxGradient(
+          preds.ConstHostPointer(), info.labels_.ConstHostPointer(),
+          is_null_weight ? nullptr : info.weights_.ConstHostPointer(), ndata, nclass,
+          param_.fast_softmax, out_gpair->HostPointer());
+#if defined(__CUDACC__)
+    } else if (nclass >= kWarpPerRowClasses) {
+      SoftmaxGradientWarp(device, preds, info, nclass, out_gpair, &label_correct_);
+#endif  // defined(__CUDACC__)
+    } else {
+      common::Transform<>::Init(
+          [=] XGBOOST_DEVICE(size_t idx,
+                             common::Span<GradientPair> gpair,
+                             common::Span<bst_float const> labels,
+                             common::Span<bst_float const> preds,
+                             common::Span<bst_float const> weights,
+                             common::Span<int> _label_correct) {
+            common::Span<bst_float const> point = preds.subspan(idx * nclass, nclass);
+
+            // Part of Softmax function
+            bst_float wmax = std::numeric_limits<bst_float>::min();
+            for (auto const i : point) { wmax = fmaxf(i, wmax); }
+            double wsum = 0.0f;
+            for (auto const i : point) { wsum += expf(i - wmax); }
+            auto label = labels[idx];
+            if (label < 0 || label >= nclass) {
+              _label_correct[0] = 0;
+              label = 0;
+            }
+            bst_float wt = is_null_weight ? 1.0f : weights[idx];
+            for (int k = 0; k < nclass; ++k) {
+              // Computation duplicated to avoid creating a cache.
+              bst_float p = expf(point[k] - wmax) / static_cast<float>(wsum);
+              const float eps = 1e-16f;
+              const bst_float h = fmax(2.0f * p * (1.0f - p) * wt, eps);
+              p = label == k ? p - 1.0f : p;
+              gpair[idx * nclass + k] = GradientPair(p * wt, h);
+            }
+          }, common::Range{0, ndata}, device, false)
+          .Eval(out_gpair, &info.labels_, &preds, &info.weights_, &label_correct_);
+    }
 
     std::vector<int>& label_correct_h = label_correct_.HostVector();
     for (auto const flag : label_correct_h) {
@@ -129,37 +249,49 @@ class SoftmaxMultiClassObj : public ObjFunction {
   inline void Transform(HostDeviceVector<bst_float> *io_preds, bool prob) {
     const int nclass = param_.num_class;
     const auto ndata = static_cast<int64_t>(io_preds->Size() / nclass);
-    max_preds_.Resize(ndata);
 
     auto device = tparam_->gpu_id;
     if (prob) {
-      common::Transform<>::Init(
-          [=] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
-            common::Span<bst_float> point =
-                _preds.subspan(_idx * nclass, nclass);
-            common::Softmax(point.begin(), point.end());
-          },
-          common::Range{0, ndata}, device)
-        .Eval(io_preds);
+      if (device < 0) {
+        common::SoftmaxRows(io_preds->HostPointer(), ndata, nclass, param_.fast_softmax);
+#if defined(__CUDACC__)
+      } else if (nclass >= kWarpPerRowClasses) {
+        io_preds->SetDevice(device);
+        SoftmaxWarp(device, io_preds, ndata, nclass);
+#endif  // defined(__CUDACC__)
+      } else {
+        common::Transform<>::Init(
+            [=] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
+              common::Span<bst_float> point =
+                  _preds.subspan(_idx * nclass, nclass);
+              common::Softmax(point.begin(), point.end());
+            },
+            common::Range{0, ndata}, device)
+          .Eval(io_preds);
+      }
     } else {
+      // local to the call, transforming is done by concurrent predictions
+      HostDeviceVector<bst_float> max_preds(ndata, 0.0f, device);
       io_preds->SetDevice(device);
-      max_preds_.SetDevice(device);
-      common::Transform<>::Init(
-          [=] XGBOOST_DEVICE(size_t _idx,
-                             common::Span<const bst_float> _preds,
-                             common::Span<bst_float> _max_preds) {
-            common::Span<const bst_float> point =
-                _preds.subspan(_idx * nclass, nclass);
-            _max_preds[_idx] =
-                common::FindMaxIndex(point.cbegin(),
-                                     point.cend()) - point.cbegin();
-          },
-          common::Range{0, ndata}, device, false)
-        .Eval(io_preds, &max_preds_);
-    }
-    if (!prob) {
-      io_preds->Resize(max_preds_.Size());
-      io_preds->Copy(max_preds_);
+      if (device < 0) {
+        common::ArgMaxRows(io_preds->ConstHostPointer(), ndata, nclass,
+                           max_preds.HostPointer());
+      } else {
+        common::Transform<>::Init(
+            [=] XGBOOST_DEVICE(size_t _idx,
+                               common::Span<const bst_float> _preds,
+                               common::Span<bst_float> _max_preds) {
+              common::Span<const bst_float> point =
+                  _preds.subspan(_idx * nclass, nclass);
+              _max_preds[_idx] =
+                  common::FindMaxIndex(point.cbegin(),
+                                       point.cend()) - point.cbegin();
+            },
+            common::Range{0, ndata}, device, false)
+          .Eval(io_preds, &max_preds);
+      }
+      io_preds->Resize(max_preds.Size());
+      io_preds->Copy(max_preds);
     }
   }
 
@@ -183,7 +315,6 @@ class SoftmaxMultiClassObj : public ObjFunction {
   // parameter
   SoftmaxMultiClassParam param_;
   // Cache for max_preds
-  HostDeviceVector<bst_float> max_preds_;
   HostDeviceVector<int> label_correct_;
 };
 
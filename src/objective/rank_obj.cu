@@ -7,6 +7,7 @@
 #include <xgboost/objective.h>
 #include <vector>
 #include <algorithm>
+#include <type_traits>
 #include <utility>
 
 #include "xgboost/json.h"
@@ -37,6 +38,7 @@ DMLC_REGISTRY_FILE_TAG(rank_obj_gpu);
 struct LambdaRankParam : public XGBoostParameter<LambdaRankParam> {
   size_t num_pairsample;
   float fix_list_weight;
+  int lambdarank_truncation;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LambdaRankParam) {
     DMLC_DECLARE_FIELD(num_pairsample).set_lower_bound(1).set_default(1)
@@ -44,6 +46,10 @@ struct LambdaRankParam : public XGBoostParameter<LambdaRankParam> {
     DMLC_DECLARE_FIELD(fix_list_weight).set_lower_bound(0.0f).set_default(0.0f)
         .describe("Normalize the weight of each list by this value,"
                   " if equals 0, no effect will happen");
+    DMLC_DECLARE_FIELD(lambdarank_truncation).set_lower_bound(0).set_default(0)
+        .describe("Enumerate every pair with an item ranked in this many top positions by"
+                  " prediction instead of sampling pairs, rank:ndcg then optimizes NDCG at"
+                  " this position.  0 samples num_pairsample pairs for each item.");
   }
 };
 
@@ -102,17 +108,23 @@ struct LambdaPair {
 
 class PairwiseLambdaWeightComputer {
  public:
+  /*! \brief buffers reused by GetLambdaWeight across groups */
+  struct Workspace {};
   /*!
    * \brief get lambda weight for existing pairs - for pairwise objective
    * \param list a list that is sorted by pred score
+   * \param top_k only the first top_k entries of the list are sorted
    * \param io_pairs record of pairs, containing the pairs to fill in weights
+   * \param ws buffers for the computation
    */
-  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                              std::vector<LambdaPair> *io_pairs) {}
+  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list, size_t top_k,
+                              std::vector<LambdaPair> *io_pairs, Workspace* ws) {}
 
   static char const* Name() {
     return "rank:pairwise";
   }
+  /*! \brief whether the weights only need the top positions sorted */
+  static bool CanTruncate() { return true; }
 
 #if defined(__CUDACC__)
   PairwiseLambdaWeightComputer(const bst_float *dpreds,
@@ -301,29 +313,47 @@ class NDCGLambdaWeightComputer
   }
 #endif
 
-  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                              std::vector<LambdaPair> *io_pairs) {
+  struct Workspace {
+    std::vector<bst_float> labels;
+    // discount of each top position
+    std::vector<float> loginv;
+  };
+
+  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list, size_t top_k,
+                              std::vector<LambdaPair> *io_pairs, Workspace* ws) {
     std::vector<LambdaPair> &pairs = *io_pairs;
     float IDCG;  // NOLINT
     {
-      std::vector<bst_float> labels(sorted_list.size());
+      std::vector<bst_float>& labels = ws->labels;
+      labels.resize(sorted_list.size());
       for (size_t i = 0; i < sorted_list.size(); ++i) {
         labels[i] = sorted_list[i].label;
       }
-      std::stable_sort(labels.begin(), labels.end(), std::greater<bst_float>());
-      IDCG = ComputeGroupDCGWeight(&labels[0], labels.size());
+      if (top_k == labels.size()) {
+        std::sort(labels.begin(), labels.end(), std::greater<bst_float>());
+      } else {
+        std::partial_sort(labels.begin(), labels.begin() + top_k, labels.end(),
+                          std::greater<bst_float>());
+      }
+      IDCG = ComputeGroupDCGWeight(labels.data(), static_cast<uint32_t>(top_k));
     }
     if (IDCG == 0.0) {
       for (auto & pair : pairs) {
         pair.weight = 0.0f;
       }
     } else {
+      // positions after top_k have no discount
+      std::vector<float>& loginv = ws->loginv;
+      loginv.resize(top_k);
+      for (size_t i = 0; i < top_k; ++i) {
+        loginv[i] = 1.0f / std::log2(static_cast<uint32_t>(i) + 2.0f);
+      }
       for (auto & pair : pairs) {
         unsigned pos_idx = pair.pos_index;
         unsigned neg_idx = pair.neg_index;
-        pair.weight *= ComputeDeltaWeight(pos_idx, neg_idx,
-                                          sorted_list[pos_idx].label, sorted_list[neg_idx].label,
-                                          IDCG);
+        pair.weight *= DeltaWeightFromDiscounts(
+            pos_idx < top_k ? loginv[pos_idx] : 0.0f, neg_idx < top_k ? loginv[neg_idx] : 0.0f,
+            sorted_list[pos_idx].label, sorted_list[neg_idx].label, IDCG);
       }
     }
   }
@@ -331,8 +361,10 @@ class NDCGLambdaWeightComputer
   static char const* Name() {
     return "rank:ndcg";
   }
+  static bool CanTruncate() { return true; }
 
-  inline static bst_float ComputeGroupDCGWeight(const float *sorted_labels, uint32_t size) {
+  XGBOOST_DEVICE inline static bst_float ComputeGroupDCGWeight(const float *sorted_labels,
+                                                               uint32_t size) {
     double sumdcg = 0.0;
     for (uint32_t i = 0; i < size; ++i) {
       sumdcg += ComputeItemDCGWeight(sorted_labels[i], i);
@@ -355,8 +387,17 @@ class NDCGLambdaWeightComputer
                                                             uint32_t neg_pred_pos,
                                                             int pos_label, int neg_label,
                                                             float idcg) {
-    float pos_loginv = 1.0f / std::log2(pos_pred_pos + 2.0f);
-    float neg_loginv = 1.0f / std::log2(neg_pred_pos + 2.0f);
+    return DeltaWeightFromDiscounts(1.0f / std::log2(pos_pred_pos + 2.0f),
+                                    1.0f / std::log2(neg_pred_pos + 2.0f),
+                                    pos_label, neg_label, idcg);
+  }
+
+ public:
+  // Same as above, with the discounts of both positions.
+  XGBOOST_DEVICE inline static bst_float DeltaWeightFromDiscounts(float pos_loginv,
+                                                                  float neg_loginv,
+                                                                  int pos_label, int neg_label,
+                                                                  float idcg) {
     bst_float original = ((1 << pos_label) - 1) * pos_loginv + ((1 << neg_label) - 1) * neg_loginv;
     float changed = ((1 << neg_label) - 1) * pos_loginv + ((1 << pos_label) - 1) * neg_loginv;
     bst_float delta = (original - changed) * (1.0f / idcg);
@@ -364,6 +405,7 @@ class NDCGLambdaWeightComputer
     return delta;
   }
 
+ private:
 #if defined(__CUDACC__)
   dh::caching_device_vector<float> dgroup_dcg_;
   // This computes the adjustment to the weight
@@ -486,11 +528,17 @@ class MAPLambdaWeightComputer
   static char const* Name() {
     return "rank:map";
   }
+  // The accumulated precisions need the whole list sorted.
+  static bool CanTruncate() { return false; }
 
-  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
-                              std::vector<LambdaPair> *io_pairs) {
-    std::vector<LambdaPair> &pairs = *io_pairs;
+  struct Workspace {
     std::vector<MAPStats> map_stats;
+  };
+
+  static void GetLambdaWeight(const std::vector<ListEntry> &sorted_list, size_t top_k,
+                              std::vector<LambdaPair> *io_pairs, Workspace* ws) {
+    std::vector<LambdaPair> &pairs = *io_pairs;
+    std::vector<MAPStats>& map_stats = ws->map_stats;
     GetMAPStats(sorted_list, &map_stats);
     for (auto & pair : pairs) {
       pair.weight *=
@@ -740,12 +788,102 @@ class SortedLabelList : dh::SegmentSorter<float> {
 };
 #endif
 
+#if defined(__CUDACC__)
+/*!
+ * \brief Gradient of every pair with an item in the top `truncation' predictions of its group.
+ *  A thread handles the pairs of one item with the top items ranked above it, so the work is
+ *  O(truncation) for each item.
+ * \param ndcg whether the pairs are weighted by the change of NDCG@truncation
+ */
+inline void ComputeTruncatedGradientsOnGPU(int device, bool ndcg, uint32_t truncation,
+                                           float fix_list_weight,
+                                           const HostDeviceVector<bst_float>& preds,
+                                           const MetaInfo& info,
+                                           const std::vector<unsigned>& gptr,
+                                           bst_float weight_normalization_factor,
+                                           HostDeviceVector<GradientPair>* out_gpair) {
+  auto n_items = static_cast<uint32_t>(preds.Size());
+  dh::SegmentSorter<float> pred_sorter;
+  pred_sorter.SortItems(preds.ConstDevicePointer(), n_items, gptr);
+  auto d_sorted_preds = pred_sorter.GetItemsSpan();
+  auto d_orig_pos = pred_sorter.GetOriginalPositionsSpan();
+  auto d_group_segments = pred_sorter.GetGroupSegmentsSpan();
+  auto d_groups = pred_sorter.GetGroupsSpan();
+  uint32_t ngroups = pred_sorter.GetNumGroups();
+
+  // IDCG@truncation of each group
+  dh::caching_device_vector<float> idcg(ngroups, 1.0f);
+  common::Span<float> d_idcg { idcg.data().get(), idcg.size() };
+  if (ndcg) {
+    dh::SegmentSorter<float> label_sorter;
+    label_sorter.SortItems(info.labels_.ConstDevicePointer(), n_items, gptr);
+    auto d_sorted_labels = label_sorter.GetItemsSpan();
+    dh::LaunchN(device, ngroups, [=] __device__(size_t g) {
+      uint32_t begin = d_groups[g];
+      uint32_t top_k = min(truncation, d_groups[g + 1] - begin);
+      d_idcg[g] = NDCGLambdaWeightComputer::ComputeGroupDCGWeight(
+          d_sorted_labels.data() + begin, top_k);
+    });
+  }
+
+  auto d_labels = info.labels_.ConstDeviceSpan();
+  auto d_weights = info.weights_.ConstDeviceSpan();
+  auto d_gpair = out_gpair->DeviceSpan();
+  dh::LaunchN(device, n_items, [=] __device__(size_t idx) {
+    uint32_t g = d_group_segments[idx];
+    uint32_t begin = d_groups[g];
+    uint32_t group_size = d_groups[g + 1] - begin;
+    uint32_t j = idx - begin;
+    uint32_t top_k = min(truncation, group_size);
+    if (ndcg && d_idcg[g] == 0.0f) {
+      return;
+    }
+    float w_group = (d_weights.size() != 0 ? d_weights[g] : 1.0f) * weight_normalization_factor;
+    if (fix_list_weight != 0.0f) {
+      w_group *= fix_list_weight / group_size;
+    }
+    float label_j = d_labels[d_orig_pos[idx]];
+    float pred_j = d_sorted_preds[idx];
+    float loginv_j = j < top_k ? 1.0f / log2(j + 2.0f) : 0.0f;
+    GradientPair acc;
+    for (uint32_t i = 0; i < min(top_k, j); ++i) {
+      uint32_t i_idx = begin + i;
+      float label_i = d_labels[d_orig_pos[i_idx]];
+      if (label_i == label_j) {
+        continue;
+      }
+      bool i_is_pos = label_i > label_j;
+      float w = w_group;
+      if (ndcg) {
+        float loginv_i = 1.0f / log2(i + 2.0f);
+        w *= i_is_pos ? NDCGLambdaWeightComputer::DeltaWeightFromDiscounts(
+                            loginv_i, loginv_j, label_i, label_j, d_idcg[g])
+                      : NDCGLambdaWeightComputer::DeltaWeightFromDiscounts(
+                            loginv_j, loginv_i, label_j, label_i, d_idcg[g]);
+      }
+      const float eps = 1e-16f;
+      float pred_i = d_sorted_preds[i_idx];
+      float p = common::Sigmoid(i_is_pos ? pred_i - pred_j : pred_j - pred_i);
+      float grad = p - 1.0f;
+      float hess = max(p * (1.0f - p), eps);
+      GradientPair pos_gpair(grad * w, 2.0f * w * hess);
+      GradientPair neg_gpair(-grad * w, 2.0f * w * hess);
+      dh::AtomicAddGpair(&d_gpair[d_orig_pos[i_idx]], i_is_pos ? pos_gpair : neg_gpair);
+      acc += i_is_pos ? neg_gpair : pos_gpair;
+    }
+    dh::AtomicAddGpair(&d_gpair[d_orig_pos[idx]], acc);
+  });
+}
+#endif  // defined(__CUDACC__)
+
 // objective for lambda rank
 template <typename LambdaWeightComputerT>
 class LambdaRankObj : public ObjFunction {
  public:
   void Configure(const std::vector<std::pair<std::string, std::string> >& args) override {
     param_.UpdateAllowUnknown(args);
+    CHECK(param_.lambdarank_truncation == 0 || LambdaWeightComputerT::CanTruncate())
+        << "lambdarank_truncation is not supported by " << LambdaWeightComputerT::Name();
   }
 
   void GetGradient(const HostDeviceVector<bst_float>& preds,
@@ -795,6 +933,15 @@ class LambdaRankObj : public ObjFunction {
   }
 
  private:
+  /*! \brief buffers of a thread, kept across groups and iterations */
+  struct Workspace {
+    std::vector<LambdaPair> pairs;
+    std::vector<ListEntry> lst;
+    std::vector< std::pair<bst_float, unsigned> > rec;
+    std::vector<GradientPair> list_gpair;
+    typename LambdaWeightComputerT::Workspace lambda;
+  };
+
   bst_float ComputeWeightNormalizationFactor(const MetaInfo& info,
                                              const std::vector<unsigned> &gptr) {
     const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
@@ -819,59 +966,81 @@ class LambdaRankObj : public ObjFunction {
     std::vector<GradientPair>& gpair = out_gpair->HostVector();
     const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
     out_gpair->Resize(preds.Size());
+    workspaces_.resize(omp_get_max_threads());
 
     #pragma omp parallel
     {
       // parallel construct, declare random number generator here, so that each
       // thread use its own random number generator, seed by thread id and current iteration
       std::minstd_rand rnd((iter + 1) * 1111);
-      std::vector<LambdaPair> pairs;
-      std::vector<ListEntry>  lst;
-      std::vector< std::pair<bst_float, unsigned> > rec;
+      Workspace& ws = workspaces_[omp_get_thread_num()];
+      std::vector<LambdaPair>& pairs = ws.pairs;
+      std::vector<ListEntry>& lst = ws.lst;
+      std::vector< std::pair<bst_float, unsigned> >& rec = ws.rec;
+      std::vector<GradientPair>& list_gpair = ws.list_gpair;
 
       #pragma omp for schedule(static)
       for (bst_omp_uint k = 0; k < ngroup; ++k) {
         lst.clear(); pairs.clear();
         for (unsigned j = gptr[k]; j < gptr[k+1]; ++j) {
           lst.emplace_back(preds_h[j], labels[j], j);
-          gpair[j] = GradientPair(0.0f, 0.0f);
-        }
-        std::stable_sort(lst.begin(), lst.end(), ListEntry::CmpPred);
-        rec.resize(lst.size());
-        for (unsigned i = 0; i < lst.size(); ++i) {
-          rec[i] = std::make_pair(lst[i].label, i);
         }
-        std::stable_sort(rec.begin(), rec.end(), common::CmpFirst);
-        // enumerate buckets with same label, for each item in the lst, grab another sample randomly
-        for (unsigned i = 0; i < rec.size(); ) {
-          unsigned j = i + 1;
-          while (j < rec.size() && rec[j].first == rec[i].first) ++j;
-          // bucket in [i,j), get a sample outside bucket
-          unsigned nleft = i, nright = static_cast<unsigned>(rec.size() - j);
-          if (nleft + nright != 0) {
-            int nsample = param_.num_pairsample;
-            while (nsample --) {
-              for (unsigned pid = i; pid < j; ++pid) {
-                unsigned ridx = std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(rnd);
-                if (ridx < nleft) {
-                  pairs.emplace_back(rec[ridx].second, rec[pid].second,
-                      info.GetWeight(k) * weight_normalization_factor);
-                } else {
-                  pairs.emplace_back(rec[pid].second, rec[ridx+j-i].second,
-                      info.GetWeight(k) * weight_normalization_factor);
+        bst_float const group_weight = info.GetWeight(k) * weight_normalization_factor;
+        size_t top_k = lst.size();
+        float scale = 1.0f;
+        if (param_.lambdarank_truncation != 0) {
+          // Only the top of the list is sorted, every pair with an item in it is used.
+          top_k = std::min(static_cast<size_t>(param_.lambdarank_truncation), lst.size());
+          std::partial_sort(lst.begin(), lst.begin() + top_k, lst.end(), ListEntry::CmpPred);
+          for (unsigned j = 1; j < lst.size(); ++j) {
+            for (unsigned i = 0; i < std::min(top_k, static_cast<size_t>(j)); ++i) {
+              if (lst[i].label > lst[j].label) {
+                pairs.emplace_back(i, j, group_weight);
+              } else if (lst[i].label < lst[j].label) {
+                pairs.emplace_back(j, i, group_weight);
+              }
+            }
+          }
+        } else {
+          std::stable_sort(lst.begin(), lst.end(), ListEntry::CmpPred);
+          rec.resize(lst.size());
+          for (unsigned i = 0; i < lst.size(); ++i) {
+            rec[i] = std::make_pair(lst[i].label, i);
+          }
+          std::stable_sort(rec.begin(), rec.end(), common::CmpFirst);
+          // enumerate buckets with same label, for each item in the lst, grab another sample
+          // randomly
+          for (unsigned i = 0; i < rec.size(); ) {
+            unsigned j = i + 1;
+            while (j < rec.size() && rec[j].first == rec[i].first) ++j;
+            // bucket in [i,j), get a sample outside bucket
+            unsigned nleft = i, nright = static_cast<unsigned>(rec.size() - j);
+            if (nleft + nright != 0) {
+              int nsample = param_.num_pairsample;
+              while (nsample --) {
+                for (unsigned pid = i; pid < j; ++pid) {
+                  unsigned ridx =
+                      std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(rnd);
+                  if (ridx < nleft) {
+                    pairs.emplace_back(rec[ridx].second, rec[pid].second, group_weight);
+                  } else {
+                    pairs.emplace_back(rec[pid].second, rec[ridx+j-i].second, group_weight);
+                  }
                 }
               }
             }
+            i = j;
           }
-          i = j;
+          scale = 1.0f / param_.num_pairsample;
         }
         // get lambda weight for the pairs
-        LambdaWeightComputerT::GetLambdaWeight(lst, &pairs);
+        LambdaWeightComputerT::GetLambdaWeight(lst, top_k, &pairs, &ws.lambda);
         // rescale each gradient and hessian so that the lst have constant weighted
-        float scale = 1.0f / param_.num_pairsample;
         if (param_.fix_list_weight != 0.0f) {
           scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
         }
+        // accumulate by list position, which stays in cache, then scatter to the rows once
+        list_gpair.assign(lst.size(), GradientPair(0.0f, 0.0f));
         for (auto & pair : pairs) {
           const ListEntry &pos = lst[pair.pos_index];
           const ListEntry &neg = lst[pair.neg_index];
@@ -881,8 +1050,11 @@ class LambdaRankObj : public ObjFunction {
           bst_float g = p - 1.0f;
           bst_float h = std::max(p * (1.0f - p), eps);
           // accumulate gradient and hessian in both pid, and nid
-          gpair[pos.rindex] += GradientPair(g * w, 2.0f*w*h);
-          gpair[neg.rindex] += GradientPair(-g * w, 2.0f*w*h);
+          list_gpair[pair.pos_index] += GradientPair(g * w, 2.0f*w*h);
+          list_gpair[pair.neg_index] += GradientPair(-g * w, 2.0f*w*h);
+        }
+        for (size_t i = 0; i < lst.size(); ++i) {
+          gpair[lst[i].rindex] = list_gpair[i];
         }
       }
     }
@@ -909,6 +1081,15 @@ class LambdaRankObj : public ObjFunction {
 
     out_gpair->Resize(preds.Size());
 
+    if (param_.lambdarank_truncation != 0) {
+      out_gpair->Fill(GradientPair(0.0f, 0.0f));
+      ComputeTruncatedGradientsOnGPU(
+          device, std::is_same<LambdaWeightComputerT, NDCGLambdaWeightComputer>::value,
+          param_.lambdarank_truncation, param_.fix_list_weight, preds, info, gptr,
+          weight_normalization_factor, out_gpair);
+      return;
+    }
+
     auto d_preds = preds.ConstDevicePointer();
     auto d_gpair = out_gpair->DevicePointer();
     auto d_labels = info.labels_.ConstDevicePointer();
@@ -928,6 +1109,7 @@ class LambdaRankObj : public ObjFunction {
 #endif
 
   LambdaRankParam param_;
+  std::vector<Workspace> workspaces_;
 };
 
 #if !defined(GTEST_TEST)
@@ -8,6 +8,8 @@
 #include <dmlc/omp.h>
 #include <xgboost/logging.h>
 #include <xgboost/objective.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <vector>
@@ -19,6 +21,8 @@
 
 #include "../common/transform.h"
 #include "../common/common.h"
+#include "../common/cox.h"
+#include "../metric/metric_common.h"
 #include "./regression_loss.h"
 
 
@@ -38,8 +42,66 @@ struct RegLossParam : public XGBoostParameter<RegLossParam> {
   }
 };
 
+/*! \brief Gradient of RegLossObj computed on host for blocks of rows. */
+template <typename Loss>
+class RegLossGradient : public ElementWiseGradient {
+  bst_float const* preds_;
+  bst_float const* labels_;
+  bst_float const* weights_;
+  size_t n_;
+  float scale_pos_weight_;
+  std::atomic<bool> label_correct_ {true};
+
+ public:
+  RegLossGradient(HostDeviceVector<bst_float> const& preds, MetaInfo const& info,
+                  float scale_pos_weight)
+      : preds_{preds.ConstHostPointer()}, labels_{info.labels_.ConstHostPointer()},
+        weights_{info.weights_.Size() == 0 ? nullptr : info.weights_.ConstHostPointer()},
+        n_{preds.Size()}, scale_pos_weight_{scale_pos_weight} {}
+
+  size_t Size() const override { return n_; }
+
+  void Compute(size_t begin, size_t end, GradientPair* out_gpair) override {
+    bool correct = true;
+    for (size_t i = begin; i < end; ++i) {
+      bst_float p = Loss::PredTransform(preds_[i]);
+      bst_float w = weights_ == nullptr ? 1.0f : weights_[i];
+      bst_float label = labels_[i];
+      if (label == 1.0f) {
+        w *= scale_pos_weight_;
+      }
+      correct = correct && Loss::CheckLabel(label);
+      out_gpair[i - begin] = GradientPair(Loss::FirstOrderGradient(p, label) * w,
+                                          Loss::SecondOrderGradient(p, label) * w);
+    }
+    if (!correct) {
+      label_correct_ = false;
+    }
+  }
+
+  void Validate() const override {
+    if (!label_correct_) {
+      LOG(FATAL) << Loss::LabelErrorMsg();
+    }
+  }
+
+  void ComputeAll(HostDeviceVector<GradientPair>* out_gpair) override {
+    out_gpair->Resize(n_);
+    GradientPair* h_gpair = out_gpair->HostPointer();
+    auto const n_blocks =
+        static_cast<omp_ulong>(common::DivRoundUp(n_, metric::kElementWiseBlockRows));
+#pragma omp parallel for schedule(static)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      size_t const begin = b * metric::kElementWiseBlockRows;
+      size_t const end = std::min(begin + metric::kElementWiseBlockRows, n_);
+      this->Compute(begin, end, h_gpair + begin);
+    }
+    this->Validate();
+  }
+};
+
 template<typename Loss>
-class RegLossObj : public ObjFunction {
+class RegLossObj : public ObjFunction, public metric::FusedMetricObjective {
  protected:
   HostDeviceVector<int> label_correct_;
 
@@ -105,6 +167,90 @@ class RegLossObj : public ObjFunction {
     }
   }
 
+  std::unique_ptr<ElementWiseGradient>
+  GetElementWiseGradient(HostDeviceVector<bst_float> const& preds, MetaInfo const& info,
+                         int iteration) override {
+    // Device gradients are a single kernel over coalesced rows already.
+    if (tparam_->gpu_id != GenericParameter::kCpuId) {
+      return nullptr;
+    }
+    if (info.labels_.Size() == 0U) {
+      LOG(WARNING) << "Label set is empty.";
+    }
+    CHECK_EQ(preds.Size(), info.labels_.Size())
+        << " " << "labels are not correctly provided"
+        << "preds.size=" << preds.Size() << ", label.size=" << info.labels_.Size() << ", "
+        << "Loss: " << Loss::Name();
+    if (info.weights_.Size() != 0) {
+      CHECK_EQ(info.weights_.Size(), preds.Size())
+          << "Number of weights should be equal to number of data points.";
+    }
+    return std::unique_ptr<ElementWiseGradient>(
+        new RegLossGradient<Loss>(preds, info, param_.scale_pos_weight));
+  }
+
+  void GetGradientWithMetrics(HostDeviceVector<bst_float> const& preds,
+                              MetaInfo const& info,
+                              std::vector<metric::ElementWiseMetric*> const& metrics,
+                              HostDeviceVector<GradientPair>* out_gpair,
+                              std::vector<metric::PackedReduceResult>* out_blocks) override {
+    if (info.labels_.Size() == 0U) {
+      LOG(WARNING) << "Label set is empty.";
+    }
+    CHECK_EQ(preds.Size(), info.labels_.Size())
+        << " " << "labels are not correctly provided"
+        << "preds.size=" << preds.Size() << ", label.size=" << info.labels_.Size() << ", "
+        << "Loss: " << Loss::Name();
+    size_t const ndata = preds.Size();
+    out_gpair->Resize(ndata);
+    bool is_null_weight = info.weights_.Size() == 0;
+    if (!is_null_weight) {
+      CHECK_EQ(info.weights_.Size(), ndata)
+          << "Number of weights should be equal to number of data points.";
+    }
+    auto const& h_preds = preds.ConstHostVector();
+    auto const& h_labels = info.labels_.ConstHostVector();
+    bst_float const* p_weights = is_null_weight ? nullptr : info.weights_.ConstHostPointer();
+    auto& h_gpair = out_gpair->HostVector();
+    auto scale_pos_weight = param_.scale_pos_weight;
+
+    size_t const n_metrics = metrics.size();
+    auto const n_blocks =
+        static_cast<omp_ulong>(common::DivRoundUp(ndata, metric::kElementWiseBlockRows));
+    out_blocks->assign(n_blocks * n_metrics, metric::PackedReduceResult{});
+    int n_invalid = 0;
+#pragma omp parallel for schedule(static) reduction(+: n_invalid)
+    for (omp_ulong b = 0; b < n_blocks; ++b) {
+      // transformed predictions of the block, seen by the metrics while still in cache
+      bst_float transformed[metric::kElementWiseBlockRows];
+      size_t const begin = b * metric::kElementWiseBlockRows;
+      size_t const n = std::min(metric::kElementWiseBlockRows, ndata - begin);
+      for (size_t k = 0; k < n; ++k) {
+        size_t const i = begin + k;
+        bst_float p = Loss::PredTransform(h_preds[i]);
+        transformed[k] = p;
+        bst_float w = is_null_weight ? 1.0f : p_weights[i];
+        bst_float label = h_labels[i];
+        if (label == 1.0f) {
+          w *= scale_pos_weight;
+        }
+        if (!Loss::CheckLabel(label)) {
+          ++n_invalid;
+        }
+        h_gpair[i] = GradientPair(Loss::FirstOrderGradient(p, label) * w,
+                                  Loss::SecondOrderGradient(p, label) * w);
+      }
+      for (size_t m = 0; m < n_metrics; ++m) {
+        (*out_blocks)[b * n_metrics + m] = metrics[m]->CpuReduceRows(
+            h_labels.data() + begin, transformed,
+            p_weights == nullptr ? nullptr : p_weights + begin, n);
+      }
+    }
+    if (n_invalid != 0) {
+      LOG(FATAL) << Loss::LabelErrorMsg();
+    }
+  }
+
  public:
   const char* DefaultEvalMetric() const override {
     return Loss::DefaultEvalMetric();
@@ -285,62 +431,36 @@ class CoxRegression : public ObjFunction {
                    HostDeviceVector<GradientPair> *out_gpair) override {
     CHECK_NE(info.labels_.Size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds.Size(), info.labels_.Size()) << "labels are not correctly provided";
-    const auto& preds_h = preds.HostVector();
-    out_gpair->Resize(preds_h.size());
-    auto& gpair = out_gpair->HostVector();
-    const std::vector<size_t> &label_order = info.LabelAbsSort();
-
-    const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
+    const size_t ndata = preds.Size();
     const bool is_null_weight = info.weights_.Size() == 0;
     if (!is_null_weight) {
       CHECK_EQ(info.weights_.Size(), ndata)
           << "Number of weights should be equal to number of data points.";
     }
+    out_gpair->Resize(ndata);
+    // the argsort is cached by the DMatrix, computed once per training
+    const auto& label_order = info.LabelAbsOrder();
 
-    // pre-compute a sum
-    double exp_p_sum = 0;  // we use double because we might need the precision with large datasets
-    for (omp_ulong i = 0; i < ndata; ++i) {
-      exp_p_sum += std::exp(preds_h[label_order[i]]);
+#if defined(XGBOOST_USE_CUDA)
+    const int device = tparam_->gpu_id;
+    if (device >= 0) {
+      preds.SetDevice(device);
+      info.labels_.SetDevice(device);
+      info.weights_.SetDevice(device);
+      label_order.SetDevice(device);
+      out_gpair->SetDevice(device);
+      common::CoxGradientDevice(device, preds.ConstDeviceSpan(),
+                                info.labels_.ConstDeviceSpan(),
+                                info.weights_.ConstDeviceSpan(),
+                                label_order.ConstDeviceSpan(), out_gpair->DeviceSpan());
+      return;
     }
+#endif  // defined(XGBOOST_USE_CUDA)
 
-    // start calculating grad and hess
-    const auto& labels = info.labels_.HostVector();
-    double r_k = 0;
-    double s_k = 0;
-    double last_exp_p = 0.0;
-    double last_abs_y = 0.0;
-    double accumulated_sum = 0;
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
-      const size_t ind = label_order[i];
-      const double p = preds_h[ind];
-      const double exp_p = std::exp(p);
-      const double w = info.GetWeight(ind);
-      const double y = labels[ind];
-      const double abs_y = std::abs(y);
-
-      // only update the denominator after we move forward in time (labels are sorted)
-      // this is Breslow's method for ties
-      accumulated_sum += last_exp_p;
-      if (last_abs_y < abs_y) {
-        exp_p_sum -= accumulated_sum;
-        accumulated_sum = 0;
-      } else {
-        CHECK(last_abs_y <= abs_y) << "CoxRegression: labels must be in sorted order, " <<
-                                      "MetaInfo::LabelArgsort failed!";
-      }
-
-      if (y > 0) {
-        r_k += 1.0/exp_p_sum;
-        s_k += 1.0/(exp_p_sum*exp_p_sum);
-      }
-
-      const double grad = exp_p*r_k - static_cast<bst_float>(y > 0);
-      const double hess = exp_p*r_k - exp_p*exp_p * s_k;
-      gpair.at(ind) = GradientPair(grad * w, hess * w);
-
-      last_abs_y = abs_y;
-      last_exp_p = exp_p;
-    }
+    common::CoxGradient(preds.ConstHostPointer(), info.labels_.ConstHostPointer(),
+                        is_null_weight ? nullptr : info.weights_.ConstHostPointer(),
+                        label_order.ConstHostPointer(), ndata, &workspace_,
+                        out_gpair->HostPointer());
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
@@ -365,6 +485,9 @@ class CoxRegression : public ObjFunction {
     out["name"] = String("survival:cox");
   }
   void LoadConfig(Json const&) override {}
+
+ private:
+  std::vector<double> workspace_;
 };
 
 // register the objective function
@@ -0,0 +1,188 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file compiled_model.cc
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif  // defined(__unix__) || defined(__APPLE__)
+#include <dmlc/filesystem.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xgboost/logging.h"
+
+#include "compiled_model.h"
+#include "../common/charconv.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+namespace {
+// Shortest literal parsed back to the same float, independent of the locale.
+std::string FloatLiteral(float value) {
+  if (std::isnan(value)) {
+    return "NAN";
+  }
+  if (std::isinf(value)) {
+    return value > 0 ? "INFINITY" : "(-INFINITY)";
+  }
+  char buffer[common::NumericLimits<float>::kToCharsSize];
+  auto res = common::ToChars(buffer, buffer + sizeof(buffer), value);
+  CHECK(res.ec == std::errc());
+  std::string literal{buffer, res.ptr};
+  literal += 'f';
+  return value < 0 ? "(" + literal + ")" : literal;
+}
+
+void GenerateNode(RegTree const& tree, bst_node_t nid, int32_t depth, std::ostream* os) {
+  RegTree::Node const& node = tree[nid];
+  std::string const indent(2 * depth, ' ');
+  if (node.IsLeaf()) {
+    *os << indent << "return " << FloatLiteral(node.LeafValue()) << ";\n";
+    return;
+  }
+  CHECK(tree.NodeSplitType(nid) != FeatureType::kCategorical)
+      << "Trees with categorical splits can not be compiled.";
+  // A NaN fails every comparison, which sends missing values to the default child.
+  std::string const value = "f[" + std::to_string(node.SplitIndex()) + "]";
+  std::string const cond = FloatLiteral(node.SplitCond());
+  if (node.DefaultLeft()) {
+    *os << indent << "if (!(" << value << " >= " << cond << ")) {\n";
+  } else {
+    *os << indent << "if (" << value << " < " << cond << ") {\n";
+  }
+  GenerateNode(tree, node.LeftChild(), depth + 1, os);
+  *os << indent << "} else {\n";
+  GenerateNode(tree, node.RightChild(), depth + 1, os);
+  *os << indent << "}\n";
+}
+}  // anonymous namespace
+
+std::string GenerateModelSource(gbm::GBTreeModel const& model) {
+  CHECK_EQ(model.param.size_leaf_vector, 0)
+      << "Trees with vector leaves can not be compiled.";
+  CHECK(!model.trees.empty());
+  size_t const n_trees = model.trees.size();
+  auto const num_feature = model.learner_model_param_->num_feature;
+  auto const num_group = model.learner_model_param_->num_output_group;
+
+  std::ostringstream os;
+  os << "/* Generated by XGBoost from a model of " << n_trees << " trees. */\n"
+     << "#include <math.h>\n"
+     << "#include <stddef.h>\n\n";
+  for (size_t i = 0; i < n_trees; ++i) {
+    os << "static float tree_" << i << "(const float* f) {\n";
+    GenerateNode(*model.trees[i], 0, 1, &os);
+    os << "}\n\n";
+  }
+
+  os << "typedef float (*xgboost_tree_fn)(const float*);\n"
+     << "const xgboost_tree_fn xgboost_compiled_trees[" << n_trees << "] = {\n";
+  for (size_t i = 0; i < n_trees; ++i) {
+    os << "  tree_" << i << ",\n";
+  }
+  os << "};\n"
+     << "const int xgboost_compiled_tree_group[" << n_trees << "] = {\n";
+  for (size_t i = 0; i < n_trees; ++i) {
+    os << "  " << model.tree_info[i] << ",\n";
+  }
+  os << "};\n\n";
+
+  // Trees are summed in order from zero before being added to the output, same as the
+  // CPU predictor.
+  os << "void xgboost_compiled_predict(const float* rows, size_t n_rows, float* out) {\n"
+     << "  size_t r;\n"
+     << "  for (r = 0; r < n_rows; ++r) {\n"
+     << "    const float* f = rows + r * " << num_feature << ";\n"
+     << "    float* o = out + r * " << num_group << ";\n"
+     << "    float s[" << num_group << "] = {0};\n";
+  for (size_t i = 0; i < n_trees; ++i) {
+    os << "    s[" << model.tree_info[i] << "] += tree_" << i << "(f);\n";
+  }
+  for (uint32_t gid = 0; gid < num_group; ++gid) {
+    os << "    o[" << gid << "] += s[" << gid << "];\n";
+  }
+  os << "  }\n"
+     << "}\n";
+  return os.str();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+std::unique_ptr<CompiledModel> CompiledModel::Compile(gbm::GBTreeModel const& model) {
+  std::unique_ptr<CompiledModel> out{new CompiledModel};
+  out->generation_ = model.Generation();
+  out->num_trees_ = model.trees.size();
+  out->num_feature_ = model.learner_model_param_->num_feature;
+  out->num_group_ = static_cast<int32_t>(model.learner_model_param_->num_output_group);
+
+  // The library stays mapped after the directory is removed.
+  dmlc::TemporaryDirectory tempdir;
+  std::string const source = tempdir.path + "/model.c";
+  std::string const library = tempdir.path + "/model.so";
+  std::string const log = tempdir.path + "/compile.log";
+  {
+    std::ofstream fo(source);
+    fo << GenerateModelSource(model);
+    CHECK(fo) << "Failed to write the source of compiled model: " << source;
+  }
+  char const* env_cc = std::getenv("CC");
+  std::string const cc = env_cc != nullptr && env_cc[0] != '\0' ? env_cc : "cc";
+  std::string const command = cc + " -O2 -std=c99 -shared -fPIC -o \"" + library +
+                              "\" \"" + source + "\" > \"" + log + "\" 2>&1";
+  if (std::system(command.c_str()) != 0) {
+    std::string message;
+    std::ifstream fi(log);
+    message.assign(std::istreambuf_iterator<char>(fi), std::istreambuf_iterator<char>());
+    LOG(FATAL) << "Failed to compile the model with `" << command << "`:\n" << message;
+  }
+
+  out->handle_ = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  CHECK(out->handle_) << "Failed to load the compiled model: " << dlerror();
+  auto symbol = [&](char const* name) {
+    void* ptr = dlsym(out->handle_, name);
+    CHECK(ptr) << "Invalid compiled model, missing symbol " << name;
+    return ptr;
+  };
+  out->trees_ = static_cast<TreeFn const*>(symbol("xgboost_compiled_trees"));
+  out->tree_group_ = static_cast<int32_t const*>(symbol("xgboost_compiled_tree_group"));
+  out->predict_ = reinterpret_cast<PredictFn>(symbol("xgboost_compiled_predict"));
+  return out;
+}
+
+CompiledModel::~CompiledModel() {
+  if (handle_ != nullptr) {
+    dlclose(handle_);
+  }
+}
+#else
+std::unique_ptr<CompiledModel> CompiledModel::Compile(gbm::GBTreeModel const& model) {
+  LOG(FATAL) << "Compiled model is not supported on this platform.";
+  return nullptr;
+}
+
+CompiledModel::~CompiledModel() = default;
+#endif  // defined(__unix__) || defined(__APPLE__)
+
+void CompiledModel::PredictTrees(float const* row, int32_t tree_begin, int32_t tree_end,
+                                 float* out) const {
+  static thread_local std::vector<float> sum;
+  sum.assign(num_group_, 0.0f);
+  for (int32_t i = tree_begin; i < tree_end; ++i) {
+    sum[tree_group_[i]] += trees_[i](row);
+  }
+  for (int32_t gid = 0; gid < num_group_; ++gid) {
+    out[gid] += sum[gid];
+  }
+}
+
+bool CompiledModel::Matches(gbm::GBTreeModel const& model) const {
+  return generation_ == model.Generation() && num_trees_ == model.trees.size();
+}
+}  // namespace predictor
+}  // namespace xgboost
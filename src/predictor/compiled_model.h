@@ -0,0 +1,77 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file compiled_model.h
+ * \brief Trees translated into C, one function of nested branches for each tree, and
+ *  built into a shared library by the C compiler of the host.
+ */
+#ifndef XGBOOST_PREDICTOR_COMPILED_MODEL_H_
+#define XGBOOST_PREDICTOR_COMPILED_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "xgboost/base.h"
+
+namespace xgboost {
+namespace gbm {
+struct GBTreeModel;
+}  // namespace gbm
+
+namespace predictor {
+/*!
+ * \brief Generate the C source of a model.  Besides a function for each tree, the source
+ *  defines:
+ *
+ *  - xgboost_compiled_trees:      Table of the functions of every tree.
+ *  - xgboost_compiled_predict:    Sum of all trees for a number of dense rows.
+ *
+ *  Rows are dense with a value for each feature of the model, missing values are NaN.
+ *  The sums of the trees are added to `num_output_group' outputs of each row.
+ */
+std::string GenerateModelSource(gbm::GBTreeModel const& model);
+
+/*!
+ * \brief A model compiled into native code.  The compiler is taken from the `CC'
+ *  environment variable, "cc" by default.  Only supported on hosts with `dlopen'.
+ */
+class CompiledModel {
+ public:
+  using TreeFn = float (*)(float const* row);
+  using PredictFn = void (*)(float const* rows, size_t n_rows, float* out);
+
+  static std::unique_ptr<CompiledModel> Compile(gbm::GBTreeModel const& model);
+  ~CompiledModel();
+
+  /*!
+   * \brief Add the sum of all trees to the outputs of `n_rows' dense rows, stored one
+   *  after another.
+   */
+  void Predict(float const* rows, size_t n_rows, float* out) const {
+    predict_(rows, n_rows, out);
+  }
+  /*! \brief Add the sum of trees [tree_begin, tree_end) to the outputs of one row. */
+  void PredictTrees(float const* row, int32_t tree_begin, int32_t tree_end,
+                    float* out) const;
+
+  /*! \brief Whether this is compiled from the current trees of the model. */
+  bool Matches(gbm::GBTreeModel const& model) const;
+  bst_feature_t NumFeature() const { return num_feature_; }
+  int32_t NumGroup() const { return num_group_; }
+
+ private:
+  CompiledModel() = default;
+
+  void* handle_ {nullptr};
+  TreeFn const* trees_ {nullptr};
+  int32_t const* tree_group_ {nullptr};
+  PredictFn predict_ {nullptr};
+  uint64_t generation_ {0};
+  size_t num_trees_ {0};
+  bst_feature_t num_feature_ {0};
+  int32_t num_group_ {0};
+};
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_COMPILED_MODEL_H_
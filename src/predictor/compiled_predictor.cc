@@ -0,0 +1,278 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file compiled_predictor.cc
+ * \brief Predictor running the trees compiled into native code, see `CompiledModel'.
+ */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "xgboost/predictor.h"
+#include "xgboost/tree_model.h"
+#include "xgboost/logging.h"
+#include "xgboost/host_device_vector.h"
+
+#include "../gbm/gbtree_model.h"
+#include "../common/common.h"
+#include "../data/dense_view_dmatrix.h"
+#include "compiled_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+DMLC_REGISTRY_FILE_TAG(compiled_predictor);
+
+/*!
+ * \brief Predicts with the model compiled into a shared library, which is built on the
+ *  first prediction and again whenever the trees change.  Compiling takes seconds for a
+ *  large model, so this is meant for serving a fixed model, not for training.  Leaf
+ *  indices, contributions and weighted trees are left to the CPU predictor.
+ *
+ *  Rows are expanded into dense rows with NaN for missing values, so a feature present
+ *  with a NaN value is treated as missing.
+ */
+class CompiledPredictor : public Predictor {
+  // Rows of a block are expanded into dense rows before calling the compiled model.
+  static constexpr size_t kBlockOfRowsSize = 64;
+
+  std::unique_ptr<Predictor> cpu_predictor_;
+  mutable std::mutex compile_lock_;
+  mutable std::shared_ptr<CompiledModel> compiled_;
+
+  std::shared_ptr<CompiledModel> GetCompiled(gbm::GBTreeModel const& model) const {
+    std::lock_guard<std::mutex> guard(compile_lock_);
+    if (!compiled_ || !compiled_->Matches(model)) {
+      compiled_ = CompiledModel::Compile(model);
+    }
+    return compiled_;
+  }
+
+  static std::vector<float>& ThreadRows(size_t n) {
+    static thread_local std::vector<float> rows;
+    rows.resize(n);
+    return rows;
+  }
+
+  static void FillRow(SparsePage::Inst const& inst, bst_feature_t num_feature, float* row) {
+    std::fill(row, row + num_feature, std::numeric_limits<float>::quiet_NaN());
+    for (auto const& entry : inst) {
+      if (entry.index < num_feature) {
+        row[entry.index] = entry.fvalue;
+      }
+    }
+  }
+
+  static void PredictRows(CompiledModel const& compiled, float const* rows, size_t n_rows,
+                          int32_t tree_begin, int32_t tree_end, int32_t n_trees,
+                          float* out) {
+    if (tree_begin == 0 && tree_end == n_trees) {
+      compiled.Predict(rows, n_rows, out);
+      return;
+    }
+    for (size_t r = 0; r < n_rows; ++r) {
+      compiled.PredictTrees(rows + r * compiled.NumFeature(), tree_begin, tree_end,
+                            out + r * compiled.NumGroup());
+    }
+  }
+
+  void PredInternal(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                    gbm::GBTreeModel const& model, int32_t tree_begin,
+                    int32_t tree_end) const {
+    auto compiled = this->GetCompiled(model);
+    bst_feature_t const num_feature = compiled->NumFeature();
+    int32_t const num_group = compiled->NumGroup();
+    auto const n_trees = static_cast<int32_t>(model.trees.size());
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+
+    // Blocks of a dense view without missing values are used in place.
+    auto const* view = dynamic_cast<data::DenseViewDMatrix const*>(p_fmat);
+    if (view && view->Info().num_col_ == num_feature) {
+      size_t const nrow = view->Info().num_row_;
+      auto const nblocks =
+          static_cast<bst_omp_uint>(common::DivRoundUp(nrow, kBlockOfRowsSize));
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+        size_t const begin = block_id * kBlockOfRowsSize;
+        size_t const block_size = std::min(nrow - begin, kBlockOfRowsSize);
+        float const* rows = view->Row(begin);
+        if (!view->RowsValid(begin, block_size)) {
+          auto& dense = ThreadRows(block_size * num_feature);
+          for (size_t k = 0; k < block_size; ++k) {
+            float const* row = view->Row(begin + k);
+            for (bst_feature_t f = 0; f < num_feature; ++f) {
+              dense[k * num_feature + f] = view->IsValid(row[f])
+                                               ? row[f]
+                                               : std::numeric_limits<float>::quiet_NaN();
+            }
+          }
+          rows = dense.data();
+        }
+        PredictRows(*compiled, rows, block_size, tree_begin, tree_end, n_trees,
+                    &preds[begin * num_group]);
+      }
+      return;
+    }
+
+    for (auto const& batch : p_fmat->GetBatches<SparsePage>()) {
+      auto const nsize = batch.Size();
+      auto const nblocks =
+          static_cast<bst_omp_uint>(common::DivRoundUp(nsize, kBlockOfRowsSize));
+      // Pull to host before entering omp block, as this is not thread safe.
+      batch.data.HostVector();
+      batch.offset.HostVector();
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+        size_t const offset = block_id * kBlockOfRowsSize;
+        size_t const block_size = std::min(nsize - offset, kBlockOfRowsSize);
+        auto& dense = ThreadRows(block_size * num_feature);
+        for (size_t k = 0; k < block_size; ++k) {
+          FillRow(batch[offset + k], num_feature, &dense[k * num_feature]);
+        }
+        PredictRows(*compiled, dense.data(), block_size, tree_begin, tree_end, n_trees,
+                    &preds[(batch.base_rowid + offset) * num_group]);
+      }
+    }
+  }
+
+  void InitOutPredictions(MetaInfo const& info, HostDeviceVector<bst_float>* out_preds,
+                          gbm::GBTreeModel const& model) const {
+    size_t const n = model.learner_model_param_->num_output_group * info.num_row_;
+    auto const& base_margin = info.base_margin_.ConstHostVector();
+    out_preds->Resize(n);
+    auto& h_preds = out_preds->HostVector();
+    if (base_margin.size() == n) {
+      std::copy(base_margin.cbegin(), base_margin.cend(), h_preds.begin());
+    } else {
+      if (!base_margin.empty()) {
+        LOG(WARNING) << "Ignoring the base margin, since it has incorrect length.";
+      }
+      std::fill(h_preds.begin(), h_preds.end(), model.learner_model_param_->base_score);
+    }
+  }
+
+ public:
+  explicit CompiledPredictor(GenericParameter const* generic_param) :
+      Predictor::Predictor{generic_param},
+      cpu_predictor_{Predictor::Create("cpu_predictor", generic_param)} {}
+
+  void Configure(const std::vector<std::pair<std::string, std::string>>& cfg) override {
+    cpu_predictor_->Configure(cfg);
+  }
+
+  void PredictBatch(DMatrix* dmat, PredictionCacheEntry* predts,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    uint32_t const ntree_limit = 0) override {
+    if (model.param.size_leaf_vector != 0) {
+      cpu_predictor_->PredictBatch(dmat, predts, model, tree_begin, ntree_limit);
+      return;
+    }
+    CHECK_EQ(tree_begin, 0);
+    auto* out_preds = &predts->predictions;
+    if (predts->version == 0) {
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
+    }
+    uint32_t const layer_trees = model.TreesPerLayer();
+    uint32_t real_ntree_limit = ntree_limit * layer_trees;
+    if (real_ntree_limit == 0 || real_ntree_limit > model.trees.size()) {
+      real_ntree_limit = static_cast<uint32_t>(model.trees.size());
+    }
+    uint32_t const end_version = real_ntree_limit / layer_trees;
+    // When users have provided ntree_limit, end_version can be lesser, cache is violated
+    if (predts->version > end_version) {
+      CHECK_NE(ntree_limit, 0);
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
+      predts->version = 0;
+    }
+    uint32_t const beg_version = predts->version;
+    if (beg_version < end_version) {
+      this->PredInternal(dmat, &out_preds->HostVector(), model, beg_version * layer_trees,
+                         end_version * layer_trees);
+    }
+    predts->Update(end_version - beg_version);
+  }
+
+  void PredictWeighted(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, std::vector<size_t> const& trees,
+                       std::vector<bst_float> const& tree_weights) override {
+    cpu_predictor_->PredictWeighted(dmat, out_preds, model, trees, tree_weights);
+  }
+
+  void PredictStaged(DMatrix* dmat, const gbm::GBTreeModel& model,
+                     std::vector<uint32_t> const& tree_ends,
+                     HostDeviceVector<bst_float>* out_preds) override {
+    cpu_predictor_->PredictStaged(dmat, model, tree_ends, out_preds);
+  }
+
+  void PredictStream(DMatrix* dmat, const gbm::GBTreeModel& model, uint32_t tree_end,
+                     PredictionSink const& sink) override {
+    cpu_predictor_->PredictStream(dmat, model, tree_end, sink);
+  }
+
+  void PredictInstance(const SparsePage::Inst& inst, std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    out_preds->resize(model.learner_model_param_->num_output_group);
+    this->PredictRow(inst, common::Span<bst_float>(*out_preds), model, ntree_limit);
+  }
+
+  void PredictRow(const SparsePage::Inst& inst, common::Span<bst_float> out_preds,
+                  const gbm::GBTreeModel& model, unsigned ntree_limit) const override {
+    if (model.param.size_leaf_vector != 0) {
+      cpu_predictor_->PredictRow(inst, out_preds, model, ntree_limit);
+      return;
+    }
+    uint32_t const num_group = model.learner_model_param_->num_output_group;
+    CHECK_GE(out_preds.size(), num_group);
+    std::fill(out_preds.begin(), out_preds.begin() + num_group, 0.0f);
+    uint32_t n_trees = ntree_limit * model.TreesPerLayer();
+    if (n_trees == 0 || n_trees > model.trees.size()) {
+      n_trees = static_cast<uint32_t>(model.trees.size());
+    }
+    if (n_trees != 0) {
+      auto compiled = this->GetCompiled(model);
+      auto& row = ThreadRows(compiled->NumFeature());
+      FillRow(inst, compiled->NumFeature(), row.data());
+      PredictRows(*compiled, row.data(), 1, 0, n_trees,
+                  static_cast<int32_t>(model.trees.size()), out_preds.data());
+    }
+    for (uint32_t gid = 0; gid < num_group; ++gid) {
+      out_preds[gid] += model.learner_model_param_->base_score;
+    }
+  }
+
+  void PredictLeaf(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                   const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    cpu_predictor_->PredictLeaf(dmat, out_preds, model, ntree_limit);
+  }
+
+  void PredictContribution(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                           const gbm::GBTreeModel& model, uint32_t ntree_limit,
+                           std::vector<bst_float>* tree_weights, bool approximate,
+                           int condition, unsigned condition_feature) override {
+    cpu_predictor_->PredictContribution(dmat, out_contribs, model, ntree_limit,
+                                        tree_weights, approximate, condition,
+                                        condition_feature);
+  }
+
+  void PredictInteractionContributions(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                                       std::vector<bst_float>* tree_weights,
+                                       bool approximate) override {
+    cpu_predictor_->PredictInteractionContributions(dmat, out_contribs, model, ntree_limit,
+                                                    tree_weights, approximate);
+  }
+};
+
+constexpr size_t CompiledPredictor::kBlockOfRowsSize;
+
+XGBOOST_REGISTER_PREDICTOR(CompiledPredictor, "compiled_predictor")
+.describe("Make predictions using trees compiled into native code.")
+.set_body([](GenericParameter const* generic_param) {
+            return new CompiledPredictor(generic_param);
+          });
+}  // namespace predictor
+}  // namespace xgboost
@@ -3,6 +3,14 @@
  */
 #include <dmlc/omp.h>
 
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
 #include "xgboost/predictor.h"
 #include "xgboost/tree_model.h"
 #include "xgboost/tree_updater.h"
@@ -10,96 +18,1011 @@
 #include "xgboost/host_device_vector.h"
 
 #include "../gbm/gbtree_model.h"
+#include "../common/common.h"
+#include "../data/adapter.h"
+#include "../data/dense_view_dmatrix.h"
+#include "flat_model.h"
+
+// Dense traversal kernels are compiled once per instruction set and selected at run
+// time, same as the histogram kernels of the hist updater.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define XGBOOST_PREDICT_MULTI_ISA 1
+  #define XGBOOST_TARGET_AVX2 __attribute__((target("avx2")))
+  #define XGBOOST_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+  #define XGBOOST_PREDICT_MULTI_ISA 0
+#endif  // x86 with GNU extensions
 
 namespace xgboost {
 namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(cpu_predictor);
 
+// Rows are predicted in blocks of `kBlockOfRowsSize', walking a block of
+// `kBlockOfTreesSize' trees over every row of the block before moving on to the next
+// trees, so the nodes of those trees stay in cache for the whole row block.
+constexpr size_t kBlockOfRowsSize = 64;
+constexpr size_t kBlockOfTreesSize = 8;
+// Batches needing fewer row by tree visits than this are walked by the calling thread,
+// forking the thread team would cost more than the traversal itself.
+constexpr size_t kParallelPredictWork = 1 << 14;
+// Small batches against large forests are split into chunks of this many trees instead
+// of blocks of rows.  The chunks are fixed so results don't depend on the thread count.
+constexpr size_t kTreeChunkSize = 64;
+// Contribution buffers of each thread used by the interaction values: main effects, one
+// tree and the tree conditioned on and off a feature.
+constexpr size_t kShapBuffers = 4;
+// Rows of matrices with at least `kSparseMinFeatures' features and on average fewer than
+// one value in `kSparseDensityRatio' present are looked up in place instead of being
+// expanded into a dense vector, filling and clearing the vector would cost more than
+// walking the trees.
+constexpr size_t kSparseMinFeatures = 1 << 16;
+constexpr size_t kSparseDensityRatio = 64;
+
+/*!
+ * \brief Structure of arrays view of one flattened tree for inputs without missing
+ *  values.  Leaves point back at themselves, so every row can take exactly `depth'
+ *  steps through the tree without checking for leaves.
+ */
+struct DenseTreeView {
+  int32_t const* fid;
+  // split condition, NaN for leaves so that the comparison always moves right
+  float const* value;
+  // absolute position of the left child, one before itself for a leaf
+  int32_t const* next;
+  float const* leaf_value;
+  int32_t root;
+  int32_t depth;
+};
+
+// Deeper trees are walked row by row, since the vector kernels take `depth' steps for
+// every row regardless of the leaf it reaches.
+constexpr int32_t kMaxVectorTreeDepth = 12;
+
+/*!
+ * \brief Leaf values of `n_rows' dense rows, row r starting at rows[r * ncol].
+ */
+using DenseTraverseFn = void (*)(DenseTreeView const& tree, float const* rows,
+                                 int32_t ncol, size_t n_rows, float* out);
+
+void DenseTraverseScalar(DenseTreeView const& tree, float const* rows, int32_t ncol,
+                         size_t n_rows, float* out) {
+  for (size_t r = 0; r < n_rows; ++r) {
+    float const* row = rows + r * ncol;
+    int32_t idx = tree.root;
+    // a split node always points past itself
+    while (tree.next[idx] > idx) {
+      idx = tree.next[idx] + (row[tree.fid[idx]] < tree.value[idx] ? 0 : 1);
+    }
+    out[r] = tree.leaf_value[idx];
+  }
+}
+
+#if XGBOOST_PREDICT_MULTI_ISA
+XGBOOST_TARGET_AVX2
+void DenseTraverseAVX2(DenseTreeView const& tree, float const* rows, int32_t ncol,
+                       size_t n_rows, float* out) {
+  constexpr size_t kLanes = 8;
+  __m256i const one = _mm256_set1_epi32(1);
+  __m256i const lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  size_t r = 0;
+  for (; r + kLanes <= n_rows; r += kLanes) {
+    __m256i const row_offset =
+        _mm256_mullo_epi32(_mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(r))),
+                           _mm256_set1_epi32(ncol));
+    __m256i idx = _mm256_set1_epi32(tree.root);
+    for (int32_t d = 0; d < tree.depth; ++d) {
+      __m256i const fid = _mm256_i32gather_epi32(tree.fid, idx, 4);
+      __m256 const split = _mm256_i32gather_ps(tree.value, idx, 4);
+      __m256 const x = _mm256_i32gather_ps(rows, _mm256_add_epi32(row_offset, fid), 4);
+      // all bits set (-1) where the row goes left
+      __m256i const left = _mm256_castps_si256(_mm256_cmp_ps(x, split, _CMP_LT_OQ));
+      __m256i const next = _mm256_i32gather_epi32(tree.next, idx, 4);
+      idx = _mm256_add_epi32(_mm256_add_epi32(next, one), left);
+    }
+    _mm256_storeu_ps(out + r, _mm256_i32gather_ps(tree.leaf_value, idx, 4));
+  }
+  DenseTraverseScalar(tree, rows + r * ncol, ncol, n_rows - r, out + r);
+}
+
+XGBOOST_TARGET_AVX512
+void DenseTraverseAVX512(DenseTreeView const& tree, float const* rows, int32_t ncol,
+                         size_t n_rows, float* out) {
+  constexpr size_t kLanes = 16;
+  __m512i const one = _mm512_set1_epi32(1);
+  __m512i const zero = _mm512_setzero_si512();
+  __m512i const lanes =
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  size_t r = 0;
+  for (; r + kLanes <= n_rows; r += kLanes) {
+    __m512i const row_offset =
+        _mm512_mullo_epi32(_mm512_add_epi32(lanes, _mm512_set1_epi32(static_cast<int>(r))),
+                           _mm512_set1_epi32(ncol));
+    __m512i idx = _mm512_set1_epi32(tree.root);
+    for (int32_t d = 0; d < tree.depth; ++d) {
+      __m512i const fid = _mm512_i32gather_epi32(idx, tree.fid, 4);
+      __m512 const split = _mm512_i32gather_ps(idx, tree.value, 4);
+      __m512 const x = _mm512_i32gather_ps(_mm512_add_epi32(row_offset, fid), rows, 4);
+      __mmask16 const left = _mm512_cmp_ps_mask(x, split, _CMP_LT_OQ);
+      __m512i const next = _mm512_i32gather_epi32(idx, tree.next, 4);
+      idx = _mm512_add_epi32(next, _mm512_mask_blend_epi32(left, one, zero));
+    }
+    _mm512_storeu_ps(out + r, _mm512_i32gather_ps(idx, tree.leaf_value, 4));
+  }
+  DenseTraverseScalar(tree, rows + r * ncol, ncol, n_rows - r, out + r);
+}
+#endif  // XGBOOST_PREDICT_MULTI_ISA
+
+DenseTraverseFn SelectDenseTraverse() {
+#if XGBOOST_PREDICT_MULTI_ISA
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return DenseTraverseAVX512;
+  } else if (__builtin_cpu_supports("avx2")) {
+    return DenseTraverseAVX2;
+  }
+#endif  // XGBOOST_PREDICT_MULTI_ISA
+  return DenseTraverseScalar;
+}
+
+// Categorical splits are only evaluated by the trees themselves, not by the flat forest.
+bool HasCategoricalSplit(gbm::GBTreeModel const& model, int32_t tree_begin,
+                         int32_t tree_end) {
+  for (int32_t i = tree_begin; i < tree_end; ++i) {
+    if (model.trees[i]->HasCategoricalSplit()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * \brief Inference only copy of a range of trees, flattened into one arena.
+ *
+ *  Trees are flattened the same way as in the flat model format, see `FlatNode'.
+ */
+class FlatForest {
+  static uint32_t constexpr kDefaultLeftBit = FlatNode::kDefaultLeftBit;
+  using Node = FlatNode;
+
+  std::vector<Node> nodes_;
+  std::vector<size_t> tree_ptr_;
+  int32_t tree_begin_ {0};
+  // structure of arrays copy of `nodes_' used by the dense kernels
+  std::vector<int32_t> dense_fid_;
+  std::vector<float> dense_value_;
+  std::vector<int32_t> dense_next_;
+  std::vector<float> dense_leaf_value_;
+  std::vector<int32_t> tree_depth_;
+  // Complete trees, and trees that can be padded to complete at most doubling their
+  // size, are also kept as an implicit heap: split i has children 2i + 1 and 2i + 2,
+  // and the 2^depth leaves follow the 2^depth - 1 splits of the tree.
+  static constexpr int32_t kMaxHeapDepth = 10;
+  static constexpr size_t kNoHeap = std::numeric_limits<size_t>::max();
+  std::vector<size_t> heap_ptr_;
+  std::vector<uint32_t> heap_sindex_;
+  std::vector<bst_float> heap_value_;
+
+  // Place flat node `pos' of the tree starting at `root' at heap slot `slot'.  Leaves
+  // above the last level are padded with splits whose both children are the leaf.
+  void FillHeap(size_t root, size_t pos, size_t slot, int32_t level, int32_t depth,
+                size_t heap_root) {
+    Node const& node = nodes_[root + pos];
+    if (level == depth) {
+      heap_value_[heap_root + slot] = node.value;
+      return;
+    }
+    if (node.left == 0) {
+      heap_sindex_[heap_root + slot] = kDefaultLeftBit;
+      heap_value_[heap_root + slot] = std::numeric_limits<bst_float>::infinity();
+      FillHeap(root, pos, 2 * slot + 1, level + 1, depth, heap_root);
+      FillHeap(root, pos, 2 * slot + 2, level + 1, depth, heap_root);
+    } else {
+      heap_sindex_[heap_root + slot] = node.sindex;
+      heap_value_[heap_root + slot] = node.value;
+      FillHeap(root, node.left, 2 * slot + 1, level + 1, depth, heap_root);
+      FillHeap(root, node.left + 1, 2 * slot + 2, level + 1, depth, heap_root);
+    }
+  }
+
+ public:
+  /*! \brief Flatten trees [tree_begin, tree_end) of the model. */
+  void Compile(gbm::GBTreeModel const& model, int32_t tree_begin, int32_t tree_end) {
+    tree_begin_ = tree_begin;
+    nodes_.clear();
+    tree_ptr_.assign(1, 0);
+    tree_depth_.clear();
+    for (int32_t i = tree_begin; i < tree_end; ++i) {
+      tree_depth_.push_back(FlattenTree(*model.trees[i], 1.0f, &nodes_));
+      tree_ptr_.push_back(nodes_.size());
+    }
+    CHECK_LE(nodes_.size(), static_cast<size_t>(std::numeric_limits<int32_t>::max()));
+    dense_fid_.resize(nodes_.size());
+    dense_value_.resize(nodes_.size());
+    dense_next_.resize(nodes_.size());
+    dense_leaf_value_.resize(nodes_.size());
+    for (size_t t = 0; t + 1 < tree_ptr_.size(); ++t) {
+      for (size_t j = tree_ptr_[t]; j < tree_ptr_[t + 1]; ++j) {
+        Node const& node = nodes_[j];
+        if (node.left == 0) {
+          dense_fid_[j] = 0;
+          dense_value_[j] = std::numeric_limits<float>::quiet_NaN();
+          dense_next_[j] = static_cast<int32_t>(j) - 1;
+          dense_leaf_value_[j] = node.value;
+        } else {
+          dense_fid_[j] = static_cast<int32_t>(node.sindex & ~kDefaultLeftBit);
+          dense_value_[j] = node.value;
+          dense_next_[j] = static_cast<int32_t>(tree_ptr_[t] + node.left);
+          dense_leaf_value_[j] = 0;
+        }
+      }
+    }
+
+    heap_ptr_.assign(tree_depth_.size(), kNoHeap);
+    heap_sindex_.clear();
+    heap_value_.clear();
+    for (size_t t = 0; t < tree_depth_.size(); ++t) {
+      int32_t const depth = tree_depth_[t];
+      size_t const n_nodes = tree_ptr_[t + 1] - tree_ptr_[t];
+      size_t const n_heap = (static_cast<size_t>(1) << (depth + 1)) - 1;
+      if (depth == 0 || depth > kMaxHeapDepth || n_heap > 2 * n_nodes) {
+        continue;
+      }
+      heap_ptr_[t] = heap_value_.size();
+      heap_sindex_.resize(heap_ptr_[t] + n_heap);
+      heap_value_.resize(heap_ptr_[t] + n_heap);
+      FillHeap(tree_ptr_[t], 0, 0, 0, depth, heap_ptr_[t]);
+    }
+  }
+
+  /*! \brief View of model tree `tree_idx' for the dense kernels. */
+  DenseTreeView DenseTree(int32_t tree_idx) const {
+    DenseTreeView view;
+    view.fid = dense_fid_.data();
+    view.value = dense_value_.data();
+    view.next = dense_next_.data();
+    view.leaf_value = dense_leaf_value_.data();
+    view.root = static_cast<int32_t>(tree_ptr_[tree_idx - tree_begin_]);
+    view.depth = tree_depth_[tree_idx - tree_begin_];
+    return view;
+  }
+
+  /*! \brief Leaf value of model tree `tree_idx' for one row. */
+  template <typename FVecT>
+  bst_float LeafValue(int32_t tree_idx, FVecT const& feats) const {
+    size_t const heap_root = heap_ptr_[tree_idx - tree_begin_];
+    if (heap_root != kNoHeap) {
+      uint32_t const* sindex = heap_sindex_.data() + heap_root;
+      bst_float const* value = heap_value_.data() + heap_root;
+      int32_t const depth = tree_depth_[tree_idx - tree_begin_];
+      size_t idx = 0;
+      for (int32_t d = 0; d < depth; ++d) {
+        uint32_t const fid = sindex[idx] & ~kDefaultLeftBit;
+        bool const missing = feats.IsMissing(fid);
+        bool const default_right = (sindex[idx] & kDefaultLeftBit) == 0;
+        bool const right = missing ? default_right : !(feats.GetFvalue(fid) < value[idx]);
+        idx = 2 * idx + 1 + static_cast<size_t>(right);
+      }
+      return value[idx];
+    }
+    return FlatLeafValue(nodes_.data() + tree_ptr_[tree_idx - tree_begin_], feats);
+  }
+};
+
+constexpr int32_t FlatForest::kMaxHeapDepth;
+constexpr size_t FlatForest::kNoHeap;
+
+/*! \brief Walks the trees of the model itself. */
+/*!
+ * \brief Rows of an adapter batch read in place, the same way as those of a dense view.
+ *  Only dense float32 rows can be walked by the dense kernels straight from the buffer,
+ *  others are always gathered.
+ */
+template <typename Batch>
+class AdapterView {
+ public:
+  AdapterView(Batch const& batch, size_t ncol, float missing, float const* dense)
+      : batch_{batch}, ncol_{ncol}, missing_{missing}, dense_{dense} {}
+
+  float const* Row(size_t ridx) const { return dense_ + ridx * ncol_; }
+  bool IsValid(float value) const {
+    return !common::CheckNAN(value) && value != missing_;
+  }
+  bool RowsValid(size_t begin, size_t n) const {
+    if (dense_ == nullptr) {
+      return false;
+    }
+    float const* values = this->Row(begin);
+    return std::all_of(values, values + n * ncol_,
+                       [this](float v) { return this->IsValid(v); });
+  }
+  void GatherRows(size_t begin, size_t n, SparsePage* page) const {
+    page->Clear();
+    page->SetBaseRowId(begin);
+    auto& offset = page->offset.HostVector();
+    auto& data = page->data.HostVector();
+    for (size_t i = begin; i < begin + n; ++i) {
+      auto const line = batch_.GetLine(i);
+      for (size_t j = 0; j < line.Size(); ++j) {
+        auto const element = line.GetElement(j);
+        if (this->IsValid(element.value)) {
+          data.emplace_back(static_cast<bst_feature_t>(element.column_idx), element.value);
+        }
+      }
+      offset.emplace_back(data.size());
+    }
+  }
+
+ private:
+  Batch const& batch_;
+  size_t ncol_;
+  float missing_;
+  float const* dense_;
+};
+
+/*!
+ * \brief Feature lookup of one row straight from its sparse entries, a drop in
+ *  replacement for RegTree::FVec on very wide and sparse inputs.  Entries not sorted by
+ *  feature index are sorted into a copy of the row.
+ */
+class SparseFVec {
+ public:
+  void Fill(SparsePage::Inst const& inst) {
+    Entry const* begin = inst.data();
+    Entry const* end = begin + inst.size();
+    auto by_index = [](Entry const& l, Entry const& r) { return l.index < r.index; };
+    if (std::is_sorted(begin, end, by_index)) {
+      begin_ = begin;
+      end_ = end;
+    } else {
+      sorted_.assign(begin, end);
+      std::sort(sorted_.begin(), sorted_.end(), by_index);
+      begin_ = sorted_.data();
+      end_ = begin_ + sorted_.size();
+    }
+    last_fid_ = kNoFeature;
+  }
+  void Drop(SparsePage::Inst const&) {
+    begin_ = end_ = nullptr;
+    last_fid_ = kNoFeature;
+  }
+  bool IsMissing(size_t i) const { return this->Find(i) == nullptr; }
+  bst_float GetFvalue(size_t i) const {
+    Entry const* entry = this->Find(i);
+    return entry == nullptr ? std::numeric_limits<bst_float>::quiet_NaN() : entry->fvalue;
+  }
+
+ private:
+  static constexpr size_t kNoFeature = std::numeric_limits<size_t>::max();
+  // The value and the missing flag of a split are read one after another, so the last
+  // lookup is kept.
+  Entry const* Find(size_t i) const {
+    if (i != last_fid_) {
+      Entry const* it = std::lower_bound(
+          begin_, end_, i, [](Entry const& e, size_t fid) { return e.index < fid; });
+      last_ = (it != end_ && it->index == i) ? it : nullptr;
+      last_fid_ = i;
+    }
+    return last_;
+  }
+
+  Entry const* begin_ {nullptr};
+  Entry const* end_ {nullptr};
+  std::vector<Entry> sorted_;
+  mutable size_t last_fid_ {kNoFeature};
+  mutable Entry const* last_ {nullptr};
+};
+
+constexpr size_t SparseFVec::kNoFeature;
+
+struct ModelForest {
+  gbm::GBTreeModel const& model;
+  template <typename FVecT>
+  bst_float LeafValue(int32_t tree_idx, FVecT const& feats) const {
+    int const tid = model.trees[tree_idx]->GetLeafIndex(feats);
+    return (*model.trees[tree_idx])[tid].LeafValue();
+  }
+};
+
 class CPUPredictor : public Predictor {
  protected:
-  static bst_float PredValue(const SparsePage::Inst& inst,
-                             const std::vector<std::unique_ptr<RegTree>>& trees,
-                             const std::vector<int>& tree_info, int bst_group,
-                             RegTree::FVec* p_feats,
-                             unsigned tree_begin, unsigned tree_end) {
-    bst_float psum = 0.0f;
-    p_feats->Fill(inst);
-    for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (tree_info[i] == bst_group) {
-        int tid = trees[i]->GetLeafIndex(*p_feats);
-        psum += (*trees[i])[tid].LeafValue();
-      }
+  /*! \brief Indices of the trees in [0, tree_end) that belong to each output group. */
+  static std::vector<std::vector<unsigned>> GroupTrees(gbm::GBTreeModel const& model,
+                                                       unsigned tree_end) {
+    std::vector<std::vector<unsigned>> group_trees(
+        model.learner_model_param_->num_output_group);
+    for (unsigned i = 0; i < tree_end; ++i) {
+      group_trees.at(model.tree_info[i]).push_back(i);
     }
-    p_feats->Drop(inst);
-    return psum;
+    return group_trees;
   }
 
+  /*!
+   * \brief Scratch space of one prediction call.  It is owned by the calling thread and
+   *  reused by its later calls, so concurrent predictions on one predictor never share
+   *  buffers and the predictor itself is not written to.
+   */
+  struct Scratch {
+    std::vector<RegTree::FVec> feats;
+    // used instead of `feats' for wide and sparse matrices
+    std::vector<SparseFVec> sparse_feats;
+    FlatForest flat_forest;
+    std::vector<float> dense_rows;
+    // row blocks gathered from a dense view, one for each thread
+    std::vector<SparsePage> view_pages;
+    std::vector<bst_float> psum;
+    std::vector<bst_float> chunk_psum;
+    std::vector<PathElement> shap_paths;
+    std::vector<bst_float> shap_contribs;
+  };
+
   // init thread buffers
-  inline void InitThreadTemp(int nthread, int num_feature) {
-    int prev_thread_temp_size = thread_temp.size();
-    if (prev_thread_temp_size < nthread) {
-      thread_temp.resize(nthread, RegTree::FVec());
-      for (int i = prev_thread_temp_size; i < nthread; ++i) {
-        thread_temp[i].Init(num_feature);
+  static Scratch& ThreadScratch(size_t n_feats, bst_feature_t num_feature) {
+    static thread_local Scratch scratch;
+    if (scratch.feats.size() < n_feats) {
+      scratch.feats.resize(n_feats, RegTree::FVec());
+    }
+    for (size_t i = 0; i < n_feats; ++i) {
+      if (scratch.feats[i].Size() != num_feature) {
+        scratch.feats[i].Init(num_feature);
       }
     }
+    return scratch;
   }
 
-  void PredInternal(DMatrix *p_fmat, std::vector<bst_float> *out_preds,
-                    gbm::GBTreeModel const &model, int32_t tree_begin,
-                    int32_t tree_end) {
-    int32_t const num_group = model.learner_model_param_->num_output_group;
+  // number of trees used for the prediction
+  static uint32_t ValidTrees(gbm::GBTreeModel const& model, uint32_t ntree_limit) {
+    ntree_limit *= model.TreesPerLayer();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<uint32_t>(model.trees.size());
+    }
+    return ntree_limit;
+  }
+
+  // initialize tree node mean values, the only write to the model.  Concurrent callers
+  // wait for the first one to finish filling.
+  void FillNodeMeanValues(gbm::GBTreeModel const& model, uint32_t ntree_limit) {
+    std::lock_guard<std::mutex> guard(mean_values_lock_);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
+      model.trees[i]->FillNodeMeanValues();
+    }
+  }
+
+  /*!
+   * \brief Size the per thread TreeShap path arenas for the deepest tree, and the per
+   *  thread contribution buffers.
+   * \return number of path elements of each thread.
+   */
+  static size_t InitShapScratch(gbm::GBTreeModel const& model, uint32_t ntree_limit,
+                                int nthread, size_t ncolumns, Scratch* scratch) {
+    int max_depth = 0;
+#pragma omp parallel for schedule(dynamic) reduction(max:max_depth)
+    for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
+      max_depth = std::max(max_depth, model.trees[i]->MaxDepth(0));
+    }
+    size_t const path_size = RegTree::ShapPathSize(max_depth);
+    scratch->shap_paths.resize(nthread * path_size);
+    scratch->shap_contribs.resize(nthread * kShapBuffers * ncolumns);
+    return path_size;
+  }
+
+  // SHAP values of every row, one row at a time through the trees of each group
+  void PredictShapContribution(DMatrix* p_fmat, gbm::GBTreeModel const& model,
+                               uint32_t ntree_limit, std::vector<bst_float>* tree_weights,
+                               int condition, unsigned condition_feature, size_t ncolumns,
+                               std::vector<bst_float>* out_contribs) {
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.learner_model_param_->num_feature);
-    std::vector<bst_float>& preds = *out_preds;
-    CHECK_EQ(model.param.size_leaf_vector, 0)
-        << "size_leaf_vector is enforced to 0 so far";
-    CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
-    // start collecting the prediction
+    Scratch& scratch = ThreadScratch(nthread, model.learner_model_param_->num_feature);
+    const int ngroup = model.learner_model_param_->num_output_group;
+    std::vector<bst_float>& contribs = *out_contribs;
+    size_t const path_size = this->InitShapScratch(model, ntree_limit, nthread, ncolumns,
+                                                   &scratch);
+    auto const group_trees = GroupTrees(model, ntree_limit);
+    // start collecting the contributions
     for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
       // parallel over local batch
-      constexpr int kUnroll = 8;
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-      const bst_omp_uint rest = nsize % kUnroll;
-      // Pull to host before entering omp block, as this is not thread safe.
-      batch.data.HostVector();
-      batch.offset.HostVector();
-      if (nsize >= kUnroll) {
 #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
-          const int tid = omp_get_thread_num();
-          RegTree::FVec& feats = thread_temp[tid];
-          int64_t ridx[kUnroll];
-          SparsePage::Inst inst[kUnroll];
-          for (int k = 0; k < kUnroll; ++k) {
-            ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
-          }
-          for (int k = 0; k < kUnroll; ++k) {
-            inst[k] = batch[i + k];
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
+        RegTree::FVec& feats = scratch.feats[tid];
+        PathElement* path = &scratch.shap_paths[tid * path_size];
+        bst_float* this_tree_contribs = &scratch.shap_contribs[tid * kShapBuffers * ncolumns];
+        feats.Fill(batch[i]);
+        // loop over all classes
+        for (int gid = 0; gid < ngroup; ++gid) {
+          bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * ncolumns];
+          // calculate contributions
+          for (unsigned j : group_trees[gid]) {
+            TreeContributions(*model.trees[j], feats, false, condition,
+                              condition_feature, path, ncolumns, this_tree_contribs);
+            bst_float const w = tree_weights == nullptr ? 1 : (*tree_weights)[j];
+            for (size_t ci = 0 ; ci < ncolumns ; ++ci) {
+                p_contribs[ci] += this_tree_contribs[ci] * w;
+            }
           }
-          for (int k = 0; k < kUnroll; ++k) {
-            for (int gid = 0; gid < num_group; ++gid) {
-              const size_t offset = ridx[k] * num_group + gid;
-              preds[offset] += this->PredValue(
-                  inst[k], model.trees, model.tree_info, gid,
-                  &feats, tree_begin, tree_end);
+        }
+        feats.Drop(batch[i]);
+      }
+    }
+  }
+
+  // approximate contributions of every row, in blocks of `kBlockOfRowsSize' rows
+  void PredictApproxContribution(DMatrix* p_fmat, gbm::GBTreeModel const& model,
+                                 uint32_t ntree_limit, std::vector<bst_float>* tree_weights,
+                                 size_t ncolumns, std::vector<bst_float>* out_contribs) {
+    Scratch& scratch = ThreadScratch(omp_get_max_threads() * kBlockOfRowsSize,
+                                     model.learner_model_param_->num_feature);
+    const int ngroup = model.learner_model_param_->num_output_group;
+    std::vector<bst_float>& contribs = *out_contribs;
+    for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      auto const nblocks =
+          static_cast<bst_omp_uint>(common::DivRoundUp(nsize, kBlockOfRowsSize));
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+        size_t const batch_offset = block_id * kBlockOfRowsSize;
+        size_t const block_size =
+            std::min(static_cast<size_t>(nsize) - batch_offset, kBlockOfRowsSize);
+        RegTree::FVec* p_feats = &scratch.feats[omp_get_thread_num() * kBlockOfRowsSize];
+        bst_float* p_contribs =
+            &contribs[(batch.base_rowid + batch_offset) * ngroup * ncolumns];
+        ApproxContributionsBlock(batch, batch_offset, block_size, model, ntree_limit,
+                                 tree_weights, ncolumns, p_feats, p_contribs);
+      }
+    }
+  }
+
+  // contributions of a single tree, overwriting `out'
+  static void TreeContributions(RegTree const& tree, RegTree::FVec const& feats,
+                                bool approximate, int condition, unsigned condition_feature,
+                                PathElement* path, size_t ncolumns, bst_float* out) {
+    std::fill(out, out + ncolumns, 0);
+    if (!approximate) {
+      tree.CalculateContributions(feats, out, condition, condition_feature, path);
+    } else {
+      tree.CalculateContributionsApprox(feats, out);
+    }
+  }
+  /*!
+   * \brief Approximate contributions of a block of rows, added to the output of the
+   *  block's first row.  Each tree walks every row of the block before the next block of
+   *  trees is loaded, the weighted changes of node mean along a path go straight into the
+   *  output instead of a per tree buffer.
+   */
+  static void ApproxContributionsBlock(SparsePage const& batch, size_t batch_offset,
+                                       size_t block_size, gbm::GBTreeModel const& model,
+                                       uint32_t ntree_limit,
+                                       std::vector<bst_float> const* tree_weights,
+                                       size_t ncolumns, RegTree::FVec* p_feats,
+                                       bst_float* contribs) {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    for (size_t k = 0; k < block_size; ++k) {
+      p_feats[k].Fill(batch[batch_offset + k]);
+    }
+    for (uint32_t tree_block = 0; tree_block < ntree_limit; tree_block += kBlockOfTreesSize) {
+      uint32_t const tree_block_end =
+          std::min(ntree_limit, static_cast<uint32_t>(tree_block + kBlockOfTreesSize));
+      for (size_t k = 0; k < block_size; ++k) {
+        for (uint32_t j = tree_block; j < tree_block_end; ++j) {
+          bst_float const w = tree_weights == nullptr ? 1 : (*tree_weights)[j];
+          bst_float* p_contribs = contribs + (k * num_group + model.tree_info[j]) * ncolumns;
+          model.trees[j]->CalculateContributionsApprox(p_feats[k], p_contribs, w);
+        }
+      }
+    }
+    for (size_t k = 0; k < block_size; ++k) {
+      p_feats[k].Drop(batch[batch_offset + k]);
+    }
+  }
+
+  // sum the leaf values of trees [tree_begin, tree_end) for every row of the block
+  template <typename Forest, typename FVecT>
+  void AccumulateBlock(SparsePage const& batch, size_t batch_offset, size_t block_size,
+                       gbm::GBTreeModel const& model, Forest const& forest,
+                       int32_t tree_begin, int32_t tree_end,
+                       FVecT* p_feats, bst_float* psum) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    std::fill(psum, psum + block_size * num_group, 0.0f);
+    for (size_t k = 0; k < block_size; ++k) {
+      p_feats[k].Fill(batch[batch_offset + k]);
+    }
+    for (int32_t tree_block = tree_begin; tree_block < tree_end;
+         tree_block += kBlockOfTreesSize) {
+      int32_t const tree_block_end =
+          std::min(tree_end, static_cast<int32_t>(tree_block + kBlockOfTreesSize));
+      if (model.param.size_leaf_vector != 0) {
+        // leaves of multi-output trees hold the values of every group
+        for (size_t k = 0; k < block_size; ++k) {
+          for (int32_t i = tree_block; i < tree_block_end; ++i) {
+            RegTree const& tree = *model.trees[i];
+            bst_float const* leaf = tree.LeafVector(tree.GetLeafIndex(p_feats[k]));
+            for (int32_t gid = 0; gid < num_group; ++gid) {
+              psum[k * num_group + gid] += leaf[gid];
             }
           }
         }
+        continue;
       }
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp[0];
-        const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
-        auto inst = batch[i];
-        for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              this->PredValue(inst, model.trees, model.tree_info, gid,
-                              &feats, tree_begin, tree_end);
+      for (size_t k = 0; k < block_size; ++k) {
+        for (int32_t i = tree_block; i < tree_block_end; ++i) {
+          psum[k * num_group + model.tree_info[i]] += forest.LeafValue(i, p_feats[k]);
         }
       }
     }
+    for (size_t k = 0; k < block_size; ++k) {
+      p_feats[k].Drop(batch[batch_offset + k]);
+    }
+  }
+
+  template <typename Forest, typename FVecT>
+  void PredictBlock(SparsePage const& batch, size_t batch_offset, size_t block_size,
+                    gbm::GBTreeModel const& model, Forest const& forest,
+                    int32_t tree_begin, int32_t tree_end,
+                    FVecT* p_feats, bst_float* psum,
+                    std::vector<bst_float>* out_preds, size_t out_base_row = 0) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    this->AccumulateBlock(batch, batch_offset, block_size, model, forest, tree_begin,
+                          tree_end, p_feats, psum);
+    std::vector<bst_float>& preds = *out_preds;
+    for (size_t k = 0; k < block_size; ++k) {
+      size_t const ridx = batch.base_rowid - out_base_row + batch_offset + k;
+      for (int32_t gid = 0; gid < num_group; ++gid) {
+        preds[ridx * num_group + gid] += psum[k * num_group + gid];
+      }
+    }
+  }
+
+  /*!
+   * \brief Predict a row block with its trees split among the threads in chunks of
+   *  `kTreeChunkSize', for batches too small to keep every thread busy with rows.
+   *  Partial sums of the chunks are added in chunk order.  `feats' holds
+   *  `kBlockOfRowsSize' feature vectors for each thread.
+   */
+  template <typename Forest, typename FVecT>
+  void PredictBlockOverTrees(SparsePage const& batch, size_t batch_offset,
+                             size_t block_size, gbm::GBTreeModel const& model,
+                             Forest const& forest, int32_t tree_begin, int32_t tree_end,
+                             FVecT* feats, Scratch* scratch,
+                             std::vector<bst_float>* out_preds,
+                             size_t out_base_row = 0) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    auto const nchunks = static_cast<bst_omp_uint>(
+        common::DivRoundUp(tree_end - tree_begin, kTreeChunkSize));
+    size_t const chunk_stride = kBlockOfRowsSize * num_group;
+    scratch->chunk_psum.resize(nchunks * chunk_stride);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint chunk = 0; chunk < nchunks; ++chunk) {
+      const int tid = omp_get_thread_num();
+      auto const chunk_begin = static_cast<int32_t>(tree_begin + chunk * kTreeChunkSize);
+      int32_t const chunk_end =
+          std::min(tree_end, static_cast<int32_t>(chunk_begin + kTreeChunkSize));
+      this->AccumulateBlock(batch, batch_offset, block_size, model, forest, chunk_begin,
+                            chunk_end, feats + tid * kBlockOfRowsSize,
+                            &scratch->chunk_psum[chunk * chunk_stride]);
+    }
+    std::vector<bst_float>& preds = *out_preds;
+    for (size_t k = 0; k < block_size; ++k) {
+      size_t const ridx = batch.base_rowid - out_base_row + batch_offset + k;
+      for (int32_t gid = 0; gid < num_group; ++gid) {
+        bst_float sum = 0.0f;
+        for (bst_omp_uint chunk = 0; chunk < nchunks; ++chunk) {
+          sum += scratch->chunk_psum[chunk * chunk_stride + k * num_group + gid];
+        }
+        preds[ridx * num_group + gid] += sum;
+      }
+    }
+  }
+
+  /*!
+   * \brief Predict a row block whose rows have every feature present, walking each
+   *  tree for all rows at once with the dense kernels.
+   * \return false if the block has a missing value.
+   */
+  bool PredictDenseBlock(SparsePage const& batch, size_t batch_offset, size_t block_size,
+                         gbm::GBTreeModel const& model, FlatForest const& forest,
+                         int32_t tree_begin, int32_t tree_end, float* rows,
+                         bst_float* psum, std::vector<bst_float>* out_preds,
+                         size_t out_base_row = 0) const {
+    auto const ncol = static_cast<int32_t>(model.learner_model_param_->num_feature);
+    for (size_t k = 0; k < block_size; ++k) {
+      auto const inst = batch[batch_offset + k];
+      if (inst.size() != static_cast<size_t>(ncol)) {
+        return false;
+      }
+      for (auto const& entry : inst) {
+        rows[k * ncol + entry.index] = entry.fvalue;
+      }
+    }
+    this->PredictDenseRows(rows, batch.base_rowid - out_base_row + batch_offset, block_size,
+                           model, forest, tree_begin, tree_end, psum, out_preds);
+    return true;
+  }
+
+  /*!
+   * \brief Predict `block_size' rows without missing values stored one after another
+   *  from `rows', with num_feature values each.  The first one is row `base_row'.
+   */
+  void PredictDenseRows(float const* rows, size_t base_row, size_t block_size,
+                        gbm::GBTreeModel const& model, FlatForest const& forest,
+                        int32_t tree_begin, int32_t tree_end, bst_float* psum,
+                        std::vector<bst_float>* out_preds) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    auto const ncol = static_cast<int32_t>(model.learner_model_param_->num_feature);
+    std::fill(psum, psum + block_size * num_group, 0.0f);
+    bst_float leaf_values[kBlockOfRowsSize];
+    for (int32_t i = tree_begin; i < tree_end; ++i) {
+      DenseTreeView const tree = forest.DenseTree(i);
+      if (tree.depth <= kMaxVectorTreeDepth) {
+        dense_traverse_(tree, rows, ncol, block_size, leaf_values);
+      } else {
+        DenseTraverseScalar(tree, rows, ncol, block_size, leaf_values);
+      }
+      int const gid = model.tree_info[i];
+      for (size_t k = 0; k < block_size; ++k) {
+        psum[k * num_group + gid] += leaf_values[k];
+      }
+    }
+    std::vector<bst_float>& preds = *out_preds;
+    for (size_t k = 0; k < block_size; ++k) {
+      size_t const ridx = base_row + k;
+      for (int32_t gid = 0; gid < num_group; ++gid) {
+        preds[ridx * num_group + gid] += psum[k * num_group + gid];
+      }
+    }
+  }
+
+  /*!
+   * \brief Predict the `nrow' rows of a dense view or an adapter without converting the
+   *  whole matrix.  Row blocks without missing values are walked by the dense kernels
+   *  straight from the caller's buffer, other blocks are gathered into a small page of
+   *  the thread.
+   */
+  template <typename View>
+  void PredView(View const& view, size_t nrow, size_t ncol, std::vector<bst_float>* out_preds,
+                gbm::GBTreeModel const& model, int32_t tree_begin, int32_t tree_end,
+                Scratch* scratch) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    const int nthread = omp_get_max_threads();
+    size_t const num_feature = model.learner_model_param_->num_feature;
+    // The flat forest keeps a single value for each leaf.
+    bool const use_flat = nrow >= kBlockOfRowsSize && model.param.size_leaf_vector == 0 &&
+                          !HasCategoricalSplit(model, tree_begin, tree_end);
+    FlatForest& flat_forest = scratch->flat_forest;
+    if (use_flat) {
+      flat_forest.Compile(model, tree_begin, tree_end);
+    }
+    ModelForest const model_forest {model};
+    bool const use_dense = use_flat && ncol == num_feature;
+    scratch->view_pages.resize(nthread);
+    std::vector<bst_float>& psum = scratch->psum;
+    psum.resize(nthread * kBlockOfRowsSize * num_group);
+
+    auto const nblocks = static_cast<bst_omp_uint>(common::DivRoundUp(nrow, kBlockOfRowsSize));
+    size_t const num_trees = tree_end - tree_begin;
+    bool const serial = nthread == 1 || nrow * num_trees < kParallelPredictWork;
+    size_t const nchunks = common::DivRoundUp(num_trees, kTreeChunkSize);
+    bool const over_trees = !serial && nblocks < static_cast<bst_omp_uint>(nthread) &&
+                            nchunks > nblocks;
+    if (over_trees) {
+      SparsePage& page = scratch->view_pages.front();
+      for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+        size_t const begin = block_id * kBlockOfRowsSize;
+        size_t const block_size = std::min(nrow - begin, kBlockOfRowsSize);
+        view.GatherRows(begin, block_size, &page);
+        if (use_flat) {
+          this->PredictBlockOverTrees(page, 0, block_size, model, flat_forest, tree_begin,
+                                      tree_end, scratch->feats.data(), scratch, out_preds);
+        } else {
+          this->PredictBlockOverTrees(page, 0, block_size, model, model_forest, tree_begin,
+                                      tree_end, scratch->feats.data(), scratch, out_preds);
+        }
+      }
+      return;
+    }
+#pragma omp parallel for schedule(static) if (!serial)
+    for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+      const int tid = omp_get_thread_num();
+      size_t const begin = block_id * kBlockOfRowsSize;
+      size_t const block_size = std::min(nrow - begin, kBlockOfRowsSize);
+      bst_float* p_psum = &psum[tid * kBlockOfRowsSize * num_group];
+      if (use_dense && view.RowsValid(begin, block_size)) {
+        this->PredictDenseRows(view.Row(begin), begin, block_size, model, flat_forest,
+                               tree_begin, tree_end, p_psum, out_preds);
+        continue;
+      }
+      SparsePage& page = scratch->view_pages[tid];
+      view.GatherRows(begin, block_size, &page);
+      RegTree::FVec* p_feats = &scratch->feats[tid * kBlockOfRowsSize];
+      if (use_flat) {
+        this->PredictBlock(page, 0, block_size, model, flat_forest, tree_begin, tree_end,
+                           p_feats, p_psum, out_preds);
+      } else {
+        this->PredictBlock(page, 0, block_size, model, model_forest, tree_begin, tree_end,
+                           p_feats, p_psum, out_preds);
+      }
+    }
+  }
+
+  /*!
+   * \brief Predict the rows of one batch, `feats' holds `kBlockOfRowsSize' feature
+   *  vectors for each thread.  Row `out_base_row' of the matrix is the first row of
+   *  `out_preds'.
+   */
+  template <typename FVecT>
+  void PredictPage(SparsePage const& batch, gbm::GBTreeModel const& model,
+                   int32_t tree_begin, int32_t tree_end, bool use_flat, bool use_dense,
+                   FVecT* feats, Scratch* scratch, std::vector<bst_float>* out_preds,
+                   size_t out_base_row) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    size_t const num_feature = model.learner_model_param_->num_feature;
+    const int nthread = omp_get_max_threads();
+    FlatForest const& flat_forest = scratch->flat_forest;
+    ModelForest const model_forest {model};
+    std::vector<bst_float>& psum = scratch->psum;
+    const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+    const auto nblocks =
+        static_cast<bst_omp_uint>(common::DivRoundUp(nsize, kBlockOfRowsSize));
+    // Pull to host before entering omp block, as this is not thread safe.
+    batch.data.ConstHostVector();
+    batch.offset.ConstHostVector();
+    // Pick the schedule: serial for little work, over tree chunks when there are fewer
+    // row blocks than threads but more chunks than row blocks, over row blocks otherwise.
+    size_t const num_trees = tree_end - tree_begin;
+    bool const serial =
+        nthread == 1 || static_cast<size_t>(nsize) * num_trees < kParallelPredictWork;
+    size_t const nchunks = common::DivRoundUp(num_trees, kTreeChunkSize);
+    bool const over_trees = !serial && nblocks < static_cast<bst_omp_uint>(nthread) &&
+                            nchunks > nblocks;
+    if (over_trees) {
+      for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+        size_t const batch_offset = block_id * kBlockOfRowsSize;
+        size_t const block_size =
+            std::min(static_cast<size_t>(nsize) - batch_offset, kBlockOfRowsSize);
+        if (use_flat) {
+          this->PredictBlockOverTrees(batch, batch_offset, block_size, model, flat_forest,
+                                      tree_begin, tree_end, feats, scratch, out_preds,
+                                      out_base_row);
+        } else {
+          this->PredictBlockOverTrees(batch, batch_offset, block_size, model, model_forest,
+                                      tree_begin, tree_end, feats, scratch, out_preds,
+                                      out_base_row);
+        }
+      }
+      return;
+    }
+    // parallel over row blocks of the local batch
+#pragma omp parallel for schedule(static) if (!serial)
+    for (bst_omp_uint block_id = 0; block_id < nblocks; ++block_id) {
+      const int tid = omp_get_thread_num();
+      size_t const batch_offset = block_id * kBlockOfRowsSize;
+      size_t const block_size =
+          std::min(static_cast<size_t>(nsize) - batch_offset, kBlockOfRowsSize);
+      FVecT* p_feats = feats + tid * kBlockOfRowsSize;
+      bst_float* p_psum = &psum[tid * kBlockOfRowsSize * num_group];
+      if (use_dense &&
+          this->PredictDenseBlock(batch, batch_offset, block_size, model, flat_forest,
+                                  tree_begin, tree_end,
+                                  &scratch->dense_rows[tid * kBlockOfRowsSize * num_feature],
+                                  p_psum, out_preds, out_base_row)) {
+        continue;
+      }
+      if (use_flat) {
+        this->PredictBlock(batch, batch_offset, block_size, model, flat_forest,
+                           tree_begin, tree_end, p_feats, p_psum, out_preds, out_base_row);
+      } else {
+        this->PredictBlock(batch, batch_offset, block_size, model, model_forest,
+                           tree_begin, tree_end, p_feats, p_psum, out_preds, out_base_row);
+      }
+    }
+  }
+
+  /*! \brief Kernels picked for all pages of a matrix, see `PreparePages'. */
+  struct PagePlan {
+    bool use_sparse {false};
+    bool use_flat {false};
+    bool use_dense {false};
+  };
+
+  /*! \brief Pick the kernels for the pages of p_fmat and size the scratch for them. */
+  PagePlan PreparePages(DMatrix* p_fmat, gbm::GBTreeModel const& model, int32_t tree_begin,
+                        int32_t tree_end, Scratch** p_scratch) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    const int nthread = omp_get_max_threads();
+    auto const& info = p_fmat->Info();
+    size_t const num_feature = model.learner_model_param_->num_feature;
+    PagePlan plan;
+    // Very wide and sparse rows are read from their entries without a dense vector.
+    plan.use_sparse = num_feature >= kSparseMinFeatures &&
+                      info.num_nonzero_ * kSparseDensityRatio < info.num_row_ * num_feature;
+    Scratch& scratch =
+        ThreadScratch(plan.use_sparse ? 0 : nthread * kBlockOfRowsSize, num_feature);
+    *p_scratch = &scratch;
+    // per thread sums of the row block, kept apart from `preds' so that every row
+    // accumulates its trees in the same order as `PredictInstance'.
+    scratch.psum.resize(nthread * kBlockOfRowsSize * num_group);
+    // Flattening costs one pass over the nodes, only worth it for more than a few rows.
+    // It is redone on every call since trees can be replaced or updated in place.
+    // The flat forest keeps a single value for each leaf.
+    plan.use_flat =
+        info.num_row_ >= kBlockOfRowsSize && model.param.size_leaf_vector == 0 &&
+        !HasCategoricalSplit(model, tree_begin, tree_end);
+    if (plan.use_flat) {
+      scratch.flat_forest.Compile(model, tree_begin, tree_end);
+    }
+    // Without missing values every row takes the same number of steps through a tree,
+    // which lets the dense kernels walk several rows at once.
+    plan.use_dense = plan.use_flat && !plan.use_sparse && info.num_col_ == num_feature &&
+                     info.num_nonzero_ == info.num_row_ * info.num_col_;
+    if (plan.use_dense) {
+      scratch.dense_rows.resize(nthread * kBlockOfRowsSize * num_feature);
+    }
+    if (plan.use_sparse) {
+      scratch.sparse_feats.resize(nthread * kBlockOfRowsSize);
+    }
+    return plan;
+  }
+
+  void PredictPage(SparsePage const& batch, gbm::GBTreeModel const& model,
+                   int32_t tree_begin, int32_t tree_end, PagePlan const& plan,
+                   Scratch* scratch, std::vector<bst_float>* out_preds,
+                   size_t out_base_row = 0) const {
+    if (plan.use_sparse) {
+      this->PredictPage(batch, model, tree_begin, tree_end, plan.use_flat, plan.use_dense,
+                        scratch->sparse_feats.data(), scratch, out_preds, out_base_row);
+    } else {
+      this->PredictPage(batch, model, tree_begin, tree_end, plan.use_flat, plan.use_dense,
+                        scratch->feats.data(), scratch, out_preds, out_base_row);
+    }
+  }
+
+  void PredInternal(DMatrix *p_fmat, std::vector<bst_float> *out_preds,
+                    gbm::GBTreeModel const &model, int32_t tree_begin,
+                    int32_t tree_end) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    auto const& info = p_fmat->Info();
+    CHECK(model.param.size_leaf_vector == 0 || model.param.size_leaf_vector == num_group)
+        << "Leaves of multi-output trees must hold a value for each output group.";
+    CHECK_EQ(out_preds->size(), info.num_row_ * num_group);
+    auto const* view = dynamic_cast<data::DenseViewDMatrix const*>(p_fmat);
+    if (view != nullptr) {
+      Scratch& scratch = ThreadScratch(omp_get_max_threads() * kBlockOfRowsSize,
+                                       model.learner_model_param_->num_feature);
+      this->PredView(*view, info.num_row_, info.num_col_, out_preds, model, tree_begin,
+                     tree_end, &scratch);
+      return;
+    }
+    Scratch* scratch {nullptr};
+    PagePlan const plan = this->PreparePages(p_fmat, model, tree_begin, tree_end, &scratch);
+    // start collecting the prediction
+    for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
+      this->PredictPage(batch, model, tree_begin, tree_end, plan, scratch, out_preds);
+    }
+  }
+
+  template <typename View>
+  void InplacePredictView(View const& view, size_t nrow, size_t ncol,
+                          gbm::GBTreeModel const& model,
+                          HostDeviceVector<bst_float>* out_preds,
+                          unsigned ntree_limit) const {
+    int32_t const num_group = model.learner_model_param_->num_output_group;
+    CHECK_LE(ncol, model.learner_model_param_->num_feature)
+        << "Number of columns does not match number of features in booster.";
+    CHECK(model.param.size_leaf_vector == 0 || model.param.size_leaf_vector == num_group)
+        << "Leaves of multi-output trees must hold a value for each output group.";
+    out_preds->Resize(nrow * num_group);
+    auto& h_preds = out_preds->HostVector();
+    std::fill(h_preds.begin(), h_preds.end(), model.learner_model_param_->base_score);
+    auto const tree_end = static_cast<int32_t>(ValidTrees(model, ntree_limit));
+    if (tree_end == 0 || nrow == 0) {
+      return;
+    }
+    Scratch& scratch = ThreadScratch(omp_get_max_threads() * kBlockOfRowsSize,
+                                     model.learner_model_param_->num_feature);
+    this->PredView(view, nrow, ncol, &h_preds, model, 0, tree_end, &scratch);
   }
 
   void InitOutPredictions(const MetaInfo& info,
@@ -107,7 +1030,7 @@ class CPUPredictor : public Predictor {
                           const gbm::GBTreeModel& model) const {
     CHECK_NE(model.learner_model_param_->num_output_group, 0);
     size_t n = model.learner_model_param_->num_output_group * info.num_row_;
-    const auto& base_margin = info.base_margin_.HostVector();
+    const auto& base_margin = info.base_margin_.ConstHostVector();
     out_preds->Resize(n);
     std::vector<bst_float>& out_preds_h = out_preds->HostVector();
     if (base_margin.size() == n) {
@@ -159,12 +1082,13 @@ class CPUPredictor : public Predictor {
     CHECK_NE(output_groups, 0);
     // Right now we just assume ntree_limit provided by users means number of tree layers
     // in the context of multi-output model
-    uint32_t real_ntree_limit = ntree_limit * output_groups;
+    uint32_t const layer_trees = model.TreesPerLayer();
+    uint32_t real_ntree_limit = ntree_limit * layer_trees;
     if (real_ntree_limit == 0 || real_ntree_limit > model.trees.size()) {
       real_ntree_limit = static_cast<uint32_t>(model.trees.size());
     }
 
-    uint32_t const end_version = (tree_begin + real_ntree_limit) / output_groups;
+    uint32_t const end_version = (tree_begin + real_ntree_limit) / layer_trees;
     // When users have provided ntree_limit, end_version can be lesser, cache is violated
     if (predts->version > end_version) {
       CHECK_NE(ntree_limit, 0);
@@ -176,8 +1100,8 @@ class CPUPredictor : public Predictor {
 
     if (beg_version < end_version) {
       this->PredInternal(dmat, &out_preds->HostVector(), model,
-                         beg_version * output_groups,
-                         end_version * output_groups);
+                         beg_version * layer_trees,
+                         end_version * layer_trees);
     }
 
     // delta means {size of forest} * {number of newly accumulated layers}
@@ -189,37 +1113,185 @@ class CPUPredictor : public Predictor {
           out_preds->Size() == dmat->Info().num_row_);
   }
 
+  void PredictWeighted(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, std::vector<size_t> const& trees,
+                       std::vector<bst_float> const& tree_weights) override {
+    CHECK_EQ(trees.size(), tree_weights.size());
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "Weighted trees don't support multi-output leaves.";
+    if (trees.empty()) {
+      return;
+    }
+    int const num_group = model.learner_model_param_->num_output_group;
+    Scratch& scratch =
+        ThreadScratch(omp_get_max_threads(), model.learner_model_param_->num_feature);
+    std::vector<bst_float>& preds = out_preds->HostVector();
+    CHECK_EQ(preds.size(), dmat->Info().num_row_ * num_group);
+    for (const auto &batch : dmat->GetBatches<SparsePage>()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      // Pull to host before entering omp block, as this is not thread safe.
+      batch.data.ConstHostVector();
+      batch.offset.ConstHostVector();
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        RegTree::FVec& feats = scratch.feats[omp_get_thread_num()];
+        const SparsePage::Inst inst = batch[i];
+        const size_t offset = (batch.base_rowid + i) * num_group;
+        feats.Fill(inst);
+        for (size_t k = 0; k < trees.size(); ++k) {
+          RegTree const& tree = *model.trees[trees[k]];
+          int const tid = tree.GetLeafIndex(feats);
+          preds[offset + model.tree_info[trees[k]]] += tree_weights[k] * tree[tid].LeafValue();
+        }
+        feats.Drop(inst);
+      }
+    }
+  }
+
+  void PredictStaged(DMatrix* dmat, const gbm::GBTreeModel& model,
+                     std::vector<uint32_t> const& tree_ends,
+                     HostDeviceVector<bst_float>* out_preds) override {
+    auto const& info = dmat->Info();
+    size_t const n = info.num_row_ * model.learner_model_param_->num_output_group;
+    // the margin of the trees so far, copied out at the end of each stage
+    HostDeviceVector<bst_float> margin;
+    this->InitOutPredictions(info, &margin, model);
+    std::vector<bst_float>& h_margin = margin.HostVector();
+    out_preds->Resize(n * tree_ends.size());
+    std::vector<bst_float>& h_out = out_preds->HostVector();
+    uint32_t tree_begin = 0;
+    for (size_t s = 0; s < tree_ends.size(); ++s) {
+      CHECK_GE(tree_ends[s], tree_begin) << "Stages must be in increasing order.";
+      CHECK_LE(tree_ends[s], model.trees.size());
+      if (tree_ends[s] > tree_begin) {
+        this->PredInternal(dmat, &h_margin, model, tree_begin, tree_ends[s]);
+      }
+      std::copy(h_margin.cbegin(), h_margin.cend(), h_out.begin() + s * n);
+      tree_begin = tree_ends[s];
+    }
+  }
+
+  void PredictStream(DMatrix* dmat, const gbm::GBTreeModel& model, uint32_t tree_end,
+                     PredictionSink const& sink) override {
+    CHECK_LE(tree_end, model.trees.size());
+    auto const& info = dmat->Info();
+    size_t const num_group = model.learner_model_param_->num_output_group;
+    CHECK(model.param.size_leaf_vector == 0 ||
+          static_cast<size_t>(model.param.size_leaf_vector) == num_group)
+        << "Leaves of multi-output trees must hold a value for each output group.";
+    if (dynamic_cast<data::DenseViewDMatrix const*>(dmat) != nullptr) {
+      // the rows are already in memory, and so are their predictions
+      HostDeviceVector<bst_float> preds;
+      this->InitOutPredictions(info, &preds, model);
+      if (tree_end != 0) {
+        this->PredInternal(dmat, &preds.HostVector(), model, 0, tree_end);
+      }
+      auto const& h_preds = preds.ConstHostVector();
+      sink(0, common::Span<bst_float const>{h_preds.data(), h_preds.size()});
+      return;
+    }
+    auto const& base_margin = info.base_margin_.ConstHostVector();
+    bool const use_margin = base_margin.size() == info.num_row_ * num_group;
+    if (!base_margin.empty() && !use_margin) {
+      LOG(WARNING) << "Ignoring the base margin, since it has incorrect length.";
+    }
+    Scratch* scratch {nullptr};
+    PagePlan plan;
+    if (tree_end != 0) {
+      plan = this->PreparePages(dmat, model, 0, tree_end, &scratch);
+    }
+    // A page is handed to the sink on another thread while the next one is loaded and
+    // predicted, each of them takes one of the two buffers.
+    std::vector<bst_float> buffers[2];
+    std::future<void> pending;
+    size_t n_pages = 0;
+    for (const auto &batch : dmat->GetBatches<SparsePage>()) {
+      std::vector<bst_float>& preds = buffers[n_pages % 2];
+      size_t const base_row = batch.base_rowid;
+      preds.resize(batch.Size() * num_group);
+      if (use_margin) {
+        std::copy_n(base_margin.cbegin() + base_row * num_group, preds.size(), preds.begin());
+      } else {
+        std::fill(preds.begin(), preds.end(), model.learner_model_param_->base_score);
+      }
+      if (tree_end != 0) {
+        this->PredictPage(batch, model, 0, tree_end, plan, scratch, &preds, base_row);
+      }
+      // The sink of the previous page is done with the other buffer before it's refilled.
+      if (pending.valid()) {
+        pending.get();
+      }
+      pending = std::async(std::launch::async, [&sink, &preds, base_row]() {
+        sink(base_row, common::Span<bst_float const>{preds.data(), preds.size()});
+      });
+      ++n_pages;
+    }
+    if (pending.valid()) {
+      pending.get();
+    }
+  }
+
   void PredictInstance(const SparsePage::Inst& inst,
                        std::vector<bst_float>* out_preds,
                        const gbm::GBTreeModel& model, unsigned ntree_limit) override {
-    if (thread_temp.size() == 0) {
-      thread_temp.resize(1, RegTree::FVec());
-      thread_temp[0].Init(model.learner_model_param_->num_feature);
+    out_preds->resize(model.learner_model_param_->num_output_group);
+    this->PredictRow(inst, common::Span<bst_float>(*out_preds), model, ntree_limit);
+  }
+  void PredictRow(const SparsePage::Inst& inst, common::Span<bst_float> out_preds,
+                  const gbm::GBTreeModel& model, unsigned ntree_limit) const override {
+    RegTree::FVec& feats =
+        ThreadScratch(1, model.learner_model_param_->num_feature).feats.front();
+    uint32_t const num_group = model.learner_model_param_->num_output_group;
+    CHECK_GE(out_preds.size(), num_group);
+    ntree_limit = ValidTrees(model, ntree_limit);
+    std::fill(out_preds.begin(), out_preds.begin() + num_group, 0.0f);
+    feats.Fill(inst);
+    for (unsigned i = 0; i < ntree_limit; ++i) {
+      int const tid = model.trees[i]->GetLeafIndex(feats);
+      if (model.param.size_leaf_vector != 0) {
+        bst_float const* leaf = model.trees[i]->LeafVector(tid);
+        for (uint32_t gid = 0; gid < num_group; ++gid) {
+          out_preds[gid] += leaf[gid];
+        }
+      } else {
+        out_preds[model.tree_info[i]] += (*model.trees[i])[tid].LeafValue();
+      }
     }
-    ntree_limit *= model.learner_model_param_->num_output_group;
-    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
-      ntree_limit = static_cast<unsigned>(model.trees.size());
+    feats.Drop(inst);
+    for (uint32_t gid = 0; gid < num_group; ++gid) {
+      out_preds[gid] += model.learner_model_param_->base_score;
     }
-    out_preds->resize(model.learner_model_param_->num_output_group *
-                      (model.param.size_leaf_vector + 1));
-    // loop over output groups
-    for (uint32_t gid = 0; gid < model.learner_model_param_->num_output_group; ++gid) {
-      (*out_preds)[gid] =
-          PredValue(inst, model.trees, model.tree_info, gid,
-                    &thread_temp[0], 0, ntree_limit) +
-          model.learner_model_param_->base_score;
+  }
+
+  bool InplacePredict(dmlc::any const& x, const gbm::GBTreeModel& model, float missing,
+                      HostDeviceVector<bst_float>* out_preds,
+                      unsigned ntree_limit) override {
+    if (x.type() == typeid(std::shared_ptr<data::ArrayAdapter>)) {
+      auto const& adapter = dmlc::get<std::shared_ptr<data::ArrayAdapter>>(x);
+      auto const& batch = adapter->Value();
+      AdapterView<data::ArrayAdapterBatch> view{batch, adapter->NumColumns(), missing,
+                                                batch.Values()};
+      this->InplacePredictView(view, adapter->NumRows(), adapter->NumColumns(), model,
+                               out_preds, ntree_limit);
+    } else if (x.type() == typeid(std::shared_ptr<data::CSRAdapter>)) {
+      auto const& adapter = dmlc::get<std::shared_ptr<data::CSRAdapter>>(x);
+      AdapterView<data::CSRAdapterBatch> view{adapter->Value(), adapter->NumColumns(),
+                                              missing, nullptr};
+      this->InplacePredictView(view, adapter->NumRows(), adapter->NumColumns(), model,
+                               out_preds, ntree_limit);
+    } else {
+      return false;
     }
+    return true;
   }
+
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model, unsigned ntree_limit) override {
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.learner_model_param_->num_feature);
+    Scratch& scratch = ThreadScratch(nthread, model.learner_model_param_->num_feature);
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
-    ntree_limit *= model.learner_model_param_->num_output_group;
-    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
-      ntree_limit = static_cast<unsigned>(model.trees.size());
-    }
+    ntree_limit = this->ValidTrees(model, ntree_limit);
     std::vector<bst_float>& preds = *out_preds;
     preds.resize(info.num_row_ * ntree_limit);
     // start collecting the prediction
@@ -230,7 +1302,7 @@ class CPUPredictor : public Predictor {
       for (bst_omp_uint i = 0; i < nsize; ++i) {
         const int tid = omp_get_thread_num();
         auto ridx = static_cast<size_t>(batch.base_rowid + i);
-        RegTree::FVec& feats = thread_temp[tid];
+        RegTree::FVec& feats = scratch.feats[tid];
         feats.Fill(batch[i]);
         for (unsigned j = 0; j < ntree_limit; ++j) {
           int tid = model.trees[j]->GetLeafIndex(feats);
@@ -246,14 +1318,11 @@ class CPUPredictor : public Predictor {
                            std::vector<bst_float>* tree_weights,
                            bool approximate, int condition,
                            unsigned condition_feature) override {
-    const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread,  model.learner_model_param_->num_feature);
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "Feature contributions are not supported by multi-output trees.";
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
-    ntree_limit *= model.learner_model_param_->num_output_group;
-    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
-      ntree_limit = static_cast<unsigned>(model.trees.size());
-    }
+    ntree_limit = this->ValidTrees(model, ntree_limit);
     const int ngroup = model.learner_model_param_->num_output_group;
     CHECK_NE(ngroup, 0);
     size_t const ncolumns = model.learner_model_param_->num_feature + 1;
@@ -264,102 +1333,138 @@ class CPUPredictor : public Predictor {
     // make sure contributions is zeroed, we could be reusing a previously
     // allocated one
     std::fill(contribs.begin(), contribs.end(), 0);
-    // initialize tree node mean values
-    #pragma omp parallel for schedule(static)
-    for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
-      model.trees[i]->FillNodeMeanValues();
+    this->FillNodeMeanValues(model, ntree_limit);
+    if (approximate) {
+      this->PredictApproxContribution(p_fmat, model, ntree_limit, tree_weights, ncolumns,
+                                      &contribs);
+    } else {
+      this->PredictShapContribution(p_fmat, model, ntree_limit, tree_weights, condition,
+                                    condition_feature, ncolumns, &contribs);
     }
-    const std::vector<bst_float>& base_margin = info.base_margin_.HostVector();
-    // start collecting the contributions
-    for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
-      // parallel over local batch
-      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+    // add base margin to BIAS
+    const std::vector<bst_float>& base_margin = info.base_margin_.ConstHostVector();
+    const auto nrow = static_cast<omp_ulong>(info.num_row_);
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
-        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
-        std::vector<bst_float> this_tree_contribs(ncolumns);
-        // loop over all classes
-        for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * ncolumns];
-          feats.Fill(batch[i]);
-          // calculate contributions
-          for (unsigned j = 0; j < ntree_limit; ++j) {
-            std::fill(this_tree_contribs.begin(), this_tree_contribs.end(), 0);
-            if (model.tree_info[j] != gid) {
-              continue;
-            }
-            if (!approximate) {
-              model.trees[j]->CalculateContributions(feats, &this_tree_contribs[0],
-                                                     condition, condition_feature);
-            } else {
-              model.trees[j]->CalculateContributionsApprox(feats, &this_tree_contribs[0]);
-            }
-            for (size_t ci = 0 ; ci < ncolumns ; ++ci) {
-                p_contribs[ci] += this_tree_contribs[ci] *
-                    (tree_weights == nullptr ? 1 : (*tree_weights)[j]);
-            }
-          }
-          feats.Drop(batch[i]);
-          // add base margin to BIAS
-          if (base_margin.size() != 0) {
-            p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
-          } else {
-            p_contribs[ncolumns - 1] += model.learner_model_param_->base_score;
-          }
+    for (omp_ulong i = 0; i < nrow; ++i) {
+      for (int gid = 0; gid < ngroup; ++gid) {
+        bst_float* p_contribs = &contribs[(i * ngroup + gid) * ncolumns];
+        if (base_margin.size() != 0) {
+          p_contribs[ncolumns - 1] += base_margin[i * ngroup + gid];
+        } else {
+          p_contribs[ncolumns - 1] += model.learner_model_param_->base_score;
         }
       }
     }
   }
 
+  /*!
+   * \brief SHAP interaction values.  The interaction of feature i with k is half the
+   *  difference of k's contributions with i conditioned on and off.  Conditioning on a
+   *  feature a tree doesn't split on leaves its contributions unchanged, so each tree is
+   *  only conditioned on its own split features instead of recomputing the contributions
+   *  of the whole forest for every feature.  Diagonals take the remaining main effects.
+   */
   void PredictInteractionContributions(DMatrix* p_fmat, std::vector<bst_float>* out_contribs,
                                        const gbm::GBTreeModel& model, unsigned ntree_limit,
                                        std::vector<bst_float>* tree_weights,
                                        bool approximate) override {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "Feature interactions are not supported by multi-output trees.";
+    const int nthread = omp_get_max_threads();
+    Scratch& scratch = ThreadScratch(nthread, model.learner_model_param_->num_feature);
     const MetaInfo& info = p_fmat->Info();
+    ntree_limit = this->ValidTrees(model, ntree_limit);
     const int ngroup = model.learner_model_param_->num_output_group;
-    size_t const ncolumns = model.learner_model_param_->num_feature;
-    const unsigned row_chunk = ngroup * (ncolumns + 1) * (ncolumns + 1);
-    const unsigned mrow_chunk = (ncolumns + 1) * (ncolumns + 1);
-    const unsigned crow_chunk = ngroup * (ncolumns + 1);
+    CHECK_NE(ngroup, 0);
+    size_t const ncolumns = model.learner_model_param_->num_feature + 1;
+    size_t const mrow_chunk = ncolumns * ncolumns;
 
-    // allocate space for (number of features^2) times the number of rows and tmp off/on contribs
+    // allocate space for (number of features^2) times the number of rows
     std::vector<bst_float>& contribs = *out_contribs;
-    contribs.resize(info.num_row_ * ngroup * (ncolumns + 1) * (ncolumns + 1));
-    std::vector<bst_float> contribs_off(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_on(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_diag(info.num_row_ * ngroup * (ncolumns + 1));
-
-    // Compute the difference in effects when conditioning on each of the features on and off
-    // see: Axiomatic characterizations of probabilistic and
-    //      cardinal-probabilistic interaction indices
-    PredictContribution(p_fmat, &contribs_diag, model, ntree_limit,
-                        tree_weights, approximate, 0, 0);
-    for (size_t i = 0; i < ncolumns + 1; ++i) {
-      PredictContribution(p_fmat, &contribs_off, model, ntree_limit,
-                          tree_weights, approximate, -1, i);
-      PredictContribution(p_fmat, &contribs_on, model, ntree_limit,
-                          tree_weights, approximate, 1, i);
-
-      for (size_t j = 0; j < info.num_row_; ++j) {
-        for (int l = 0; l < ngroup; ++l) {
-          const unsigned o_offset = j * row_chunk + l * mrow_chunk + i * (ncolumns + 1);
-          const unsigned c_offset = j * crow_chunk + l * (ncolumns + 1);
-          contribs[o_offset + i] = 0;
-          for (size_t k = 0; k < ncolumns + 1; ++k) {
-            // fill in the diagonal with additive effects, and off-diagonal with the interactions
-            if (k == i) {
-              contribs[o_offset + i] += contribs_diag[c_offset + k];
-            } else {
-              contribs[o_offset + k] = (contribs_on[c_offset + k] - contribs_off[c_offset + k])/2.0;
-              contribs[o_offset + i] -= contribs[o_offset + k];
+    contribs.resize(info.num_row_ * ngroup * mrow_chunk);
+    std::fill(contribs.begin(), contribs.end(), 0);
+    this->FillNodeMeanValues(model, ntree_limit);
+    size_t const path_size = this->InitShapScratch(model, ntree_limit, nthread, ncolumns,
+                                                   &scratch);
+    // split features of every tree; the approximate contributions ignore conditioning,
+    // leaving no interaction to compute
+    std::vector<std::vector<bst_feature_t>> tree_features(ntree_limit);
+    if (!approximate) {
+#pragma omp parallel for schedule(dynamic)
+      for (bst_omp_uint j = 0; j < ntree_limit; ++j) {
+        RegTree const& tree = *model.trees[j];
+        auto& features = tree_features[j];
+        for (bst_node_t nid = 0; nid < tree.param.num_nodes; ++nid) {
+          if (!tree[nid].IsLeaf() && !tree[nid].IsDeleted()) {
+            features.push_back(tree[nid].SplitIndex());
+          }
+        }
+        std::sort(features.begin(), features.end());
+        features.erase(std::unique(features.begin(), features.end()), features.end());
+      }
+    }
+    const std::vector<bst_float>& base_margin = info.base_margin_.ConstHostVector();
+    auto const group_trees = GroupTrees(model, ntree_limit);
+    for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
+        RegTree::FVec& feats = scratch.feats[tid];
+        PathElement* path = &scratch.shap_paths[tid * path_size];
+        bst_float* main_effects = &scratch.shap_contribs[tid * kShapBuffers * ncolumns];
+        bst_float* tree_contribs = main_effects + ncolumns;
+        bst_float* contribs_on = tree_contribs + ncolumns;
+        bst_float* contribs_off = contribs_on + ncolumns;
+        feats.Fill(batch[i]);
+        for (int gid = 0; gid < ngroup; ++gid) {
+          bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * mrow_chunk];
+          std::fill(main_effects, main_effects + ncolumns, 0);
+          for (unsigned j : group_trees[gid]) {
+            bst_float const w = tree_weights == nullptr ? 1 : (*tree_weights)[j];
+            TreeContributions(*model.trees[j], feats, approximate, 0, 0, path, ncolumns,
+                              tree_contribs);
+            for (size_t k = 0; k < ncolumns; ++k) {
+              main_effects[k] += tree_contribs[k] * w;
+            }
+            for (bst_feature_t f : tree_features[j]) {
+              TreeContributions(*model.trees[j], feats, false, 1, f, path, ncolumns,
+                                contribs_on);
+              TreeContributions(*model.trees[j], feats, false, -1, f, path, ncolumns,
+                                contribs_off);
+              bst_float* p_row = p_contribs + f * ncolumns;
+              for (size_t k = 0; k < ncolumns; ++k) {
+                if (k != f) {
+                  p_row[k] += (contribs_on[k] - contribs_off[k]) / 2.0 * w;
+                }
+              }
+            }
+          }
+          // add base margin to BIAS
+          if (base_margin.size() != 0) {
+            main_effects[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
+          } else {
+            main_effects[ncolumns - 1] += model.learner_model_param_->base_score;
+          }
+          // fill in the diagonal with additive effects
+          for (size_t f = 0; f < ncolumns; ++f) {
+            bst_float* p_row = p_contribs + f * ncolumns;
+            p_row[f] = main_effects[f];
+            for (size_t k = 0; k < ncolumns; ++k) {
+              if (k != f) {
+                p_row[f] -= p_row[k];
+              }
             }
           }
         }
+        feats.Drop(batch[i]);
       }
     }
   }
-  std::vector<RegTree::FVec> thread_temp;
+
+  std::mutex mean_values_lock_;
+  DenseTraverseFn const dense_traverse_ {SelectDenseTraverse()};
 };
 
 XGBOOST_REGISTER_PREDICTOR(CPUPredictor, "cpu_predictor")
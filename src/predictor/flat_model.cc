@@ -0,0 +1,246 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file flat_model.cc
+ */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "xgboost/logging.h"
+
+#include "flat_model.h"
+#include "../common/common.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+constexpr uint32_t FlatNode::kDefaultLeftBit;
+
+int32_t FlattenTree(RegTree const& tree, bst_float scale, std::vector<FlatNode>* nodes) {
+  size_t const root = nodes->size();
+  std::vector<bst_node_t> queue(1, 0);
+  std::vector<int32_t> depth(1, 0);
+  nodes->emplace_back();
+  // nodes are flattened in the order they are queued
+  for (size_t pos = 0; pos < queue.size(); ++pos) {
+    RegTree::Node const& node = tree[queue[pos]];
+    FlatNode& flat = (*nodes)[root + pos];
+    if (node.IsLeaf()) {
+      flat.sindex = 0;
+      flat.value = node.LeafValue() * scale;
+      flat.left = 0;
+    } else {
+      CHECK(tree.NodeSplitType(queue[pos]) != FeatureType::kCategorical)
+          << "Trees with categorical splits can not be flattened.";
+      depth.push_back(depth[pos] + 1);
+      depth.push_back(depth[pos] + 1);
+      flat.sindex = node.SplitIndex();
+      if (node.DefaultLeft()) {
+        flat.sindex |= FlatNode::kDefaultLeftBit;
+      }
+      flat.value = node.SplitCond();
+      flat.left = static_cast<uint32_t>(queue.size());
+      queue.push_back(node.LeftChild());
+      queue.push_back(node.RightChild());
+      nodes->emplace_back();
+      nodes->emplace_back();
+    }
+  }
+  return *std::max_element(depth.cbegin(), depth.cend());
+}
+
+namespace {
+constexpr int32_t kFlatModelMagic = 0x4c544658;  // "XFTL"
+constexpr int32_t kFlatModelVersion = 1;
+/*! \brief Alignment of the sections of the flat format. */
+constexpr size_t kFlatAlignment = 64;
+
+/*!
+ * \brief Header of the flat format.  Positions are in bytes from the beginning of the
+ *  file, all values are in the byte order of the host writing it.
+ */
+struct FlatModelHeader {
+  int32_t magic;
+  int32_t version;
+  uint32_t num_feature;
+  uint32_t num_group;
+  bst_float base_score;
+  uint32_t reserved;
+  uint64_t num_trees;
+  uint64_t num_nodes;
+  uint64_t tree_ptr_begin;
+  uint64_t tree_group_begin;
+  uint64_t nodes_begin;
+  uint64_t objective_begin;
+  uint64_t objective_bytes;
+
+  uint64_t End() const { return objective_begin + objective_bytes; }
+};
+
+uint64_t AlignUp(uint64_t n) {
+  return common::DivRoundUp(n, kFlatAlignment) * kFlatAlignment;
+}
+}  // anonymous namespace
+
+void FlatModel::Save(gbm::GBTreeModel const& model, std::vector<bst_float> const& tree_weights,
+                     Json const& objective, dmlc::Stream* fo) {
+  CHECK_EQ(model.param.size_leaf_vector, 0)
+      << "Flat model doesn't support trees with vector leaves.";
+  CHECK(tree_weights.empty() || tree_weights.size() == model.trees.size());
+  std::vector<uint64_t> tree_ptr(1, 0);
+  std::vector<uint32_t> tree_group(model.trees.size());
+  std::vector<FlatNode> nodes;
+  for (size_t i = 0; i < model.trees.size(); ++i) {
+    FlattenTree(*model.trees[i], tree_weights.empty() ? 1.0f : tree_weights[i], &nodes);
+    tree_ptr.push_back(nodes.size());
+    tree_group[i] = static_cast<uint32_t>(model.tree_info[i]);
+  }
+  std::string objective_str;
+  Json::Dump(objective, &objective_str);
+
+  FlatModelHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kFlatModelMagic;
+  header.version = kFlatModelVersion;
+  header.num_feature = model.learner_model_param_->num_feature;
+  header.num_group = model.learner_model_param_->num_output_group;
+  header.base_score = model.learner_model_param_->base_score;
+  header.num_trees = model.trees.size();
+  header.num_nodes = nodes.size();
+  header.tree_ptr_begin = AlignUp(sizeof(header));
+  header.tree_group_begin = AlignUp(header.tree_ptr_begin + tree_ptr.size() * sizeof(uint64_t));
+  header.nodes_begin = AlignUp(header.tree_group_begin + tree_group.size() * sizeof(uint32_t));
+  header.objective_begin = AlignUp(header.nodes_begin + nodes.size() * sizeof(FlatNode));
+  header.objective_bytes = objective_str.size();
+
+  char const padding[kFlatAlignment] = {0};
+  uint64_t written = 0;
+  auto write = [&](void const* ptr, uint64_t begin, uint64_t bytes) {
+    CHECK_GE(begin, written);
+    fo->Write(padding, begin - written);
+    fo->Write(ptr, bytes);
+    written = begin + bytes;
+  };
+  write(&header, 0, sizeof(header));
+  write(tree_ptr.data(), header.tree_ptr_begin, tree_ptr.size() * sizeof(uint64_t));
+  write(tree_group.data(), header.tree_group_begin, tree_group.size() * sizeof(uint32_t));
+  write(nodes.data(), header.nodes_begin, nodes.size() * sizeof(FlatNode));
+  write(objective_str.data(), header.objective_begin, objective_str.size());
+}
+
+FlatModel* FlatModel::Load(std::string const& fname) {
+  std::unique_ptr<FlatModel> out {new FlatModel};
+  std::unique_ptr<common::MmapFile> file {new common::MmapFile(fname)};
+  if (file->Valid()) {
+    out->file_ = std::move(file);
+    out->Init(out->file_->Data(), out->file_->Size());
+  } else {
+    // Remote files are read into memory.
+    std::unique_ptr<dmlc::Stream> fi {dmlc::Stream::Create(fname.c_str(), "r")};
+    size_t constexpr kChunk = 1 << 20;
+    size_t size = 0;
+    while (true) {
+      out->buffer_.resize(size + kChunk);
+      size_t const n_read = fi->Read(&out->buffer_[size], kChunk);
+      size += n_read;
+      if (n_read < kChunk) {
+        break;
+      }
+    }
+    out->buffer_.resize(size);
+    out->Init(out->buffer_.data(), out->buffer_.size());
+  }
+  return out.release();
+}
+
+void FlatModel::Init(char const* data, size_t size) {
+  FlatModelHeader header;
+  CHECK_GE(size, sizeof(header)) << "invalid flat model, unexpected end";
+  std::memcpy(&header, data, sizeof(header));
+  CHECK_EQ(header.magic, kFlatModelMagic) << "invalid flat model, magic number mismatch";
+  CHECK_LE(header.version, kFlatModelVersion)
+      << "Flat model is written by a newer version of XGBoost.";
+  CHECK_GE(size, header.End()) << "invalid flat model, unexpected end";
+  CHECK(header.tree_group_begin >=
+            header.tree_ptr_begin + (header.num_trees + 1) * sizeof(uint64_t) &&
+        header.nodes_begin >= header.tree_group_begin + header.num_trees * sizeof(uint32_t) &&
+        header.objective_begin >= header.nodes_begin + header.num_nodes * sizeof(FlatNode))
+      << "invalid flat model, overlapping sections";
+  CHECK(header.tree_ptr_begin % alignof(uint64_t) == 0 &&
+        header.nodes_begin % alignof(FlatNode) == 0)
+      << "invalid flat model, misaligned sections";
+  CHECK_NE(header.num_group, 0);
+
+  num_feature_ = header.num_feature;
+  num_group_ = header.num_group;
+  base_score_ = header.base_score;
+  tree_ptr_ = {reinterpret_cast<uint64_t const*>(data + header.tree_ptr_begin),
+               static_cast<size_t>(header.num_trees + 1)};
+  tree_group_ = {reinterpret_cast<uint32_t const*>(data + header.tree_group_begin),
+                 static_cast<size_t>(header.num_trees)};
+  nodes_ = {reinterpret_cast<FlatNode const*>(data + header.nodes_begin),
+            static_cast<size_t>(header.num_nodes)};
+
+  // The table of trees is small, the nodes are left for the first prediction to fault in.
+  CHECK_EQ(tree_ptr_.front(), 0);
+  CHECK_EQ(tree_ptr_.back(), header.num_nodes);
+  for (size_t i = 0; i < tree_group_.size(); ++i) {
+    CHECK_LT(tree_ptr_[i], tree_ptr_[i + 1]) << "invalid flat model, empty tree";
+    CHECK_LT(tree_group_[i], num_group_) << "invalid flat model, output group out of range";
+  }
+
+  generic_param_.UpdateAllowUnknown(Args{});
+  auto objective = Json::Load({data + header.objective_begin,
+                               static_cast<size_t>(header.objective_bytes)});
+  obj_.reset(ObjFunction::Create(get<String const>(objective["name"]), &generic_param_));
+  obj_->LoadConfig(objective);
+}
+
+void FlatModel::Predict(DMatrix* dmat, bool output_margin,
+                        HostDeviceVector<bst_float>* out_preds) const {
+  auto const& info = dmat->Info();
+  CHECK_LE(info.num_col_, num_feature_)
+      << "Number of columns does not match number of features in the model.";
+  size_t const n = info.num_row_ * num_group_;
+  auto const& base_margin = info.base_margin_.ConstHostVector();
+  out_preds->Resize(n);
+  auto& h_preds = out_preds->HostVector();
+  if (base_margin.size() == n) {
+    std::copy(base_margin.cbegin(), base_margin.cend(), h_preds.begin());
+  } else {
+    if (!base_margin.empty()) {
+      LOG(WARNING) << "Ignoring the base margin, since it has incorrect length.";
+    }
+    std::fill(h_preds.begin(), h_preds.end(), base_score_);
+  }
+
+  std::vector<RegTree::FVec> feats(omp_get_max_threads());
+  for (auto& f : feats) {
+    f.Init(num_feature_);
+  }
+  size_t const n_trees = this->NumTrees();
+  for (auto const& batch : dmat->GetBatches<SparsePage>()) {
+    auto const batch_size = static_cast<omp_ulong>(batch.Size());
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < batch_size; ++i) {  // NOLINT(*)
+      RegTree::FVec& f = feats[omp_get_thread_num()];
+      auto inst = batch[i];
+      f.Fill(inst);
+      bst_float* out = h_preds.data() + (batch.base_rowid + i) * num_group_;
+      for (size_t t = 0; t < n_trees; ++t) {
+        FlatNode const* root = nodes_.data() + tree_ptr_[t];
+        out[tree_group_[t]] += FlatLeafValue(root, f);
+      }
+      f.Drop(inst);
+    }
+  }
+  if (!output_margin) {
+    obj_->PredTransform(out_preds);
+  }
+}
+}  // namespace predictor
+}  // namespace xgboost
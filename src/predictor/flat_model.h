@@ -0,0 +1,141 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file flat_model.h
+ * \brief Flat, versioned format of a tree model for serving.  The trees are used
+ *  directly from a read-only mapping of the file, so loading costs next to nothing and
+ *  every process of a host serving the same file shares one physical copy.
+ */
+#ifndef XGBOOST_PREDICTOR_FLAT_MODEL_H_
+#define XGBOOST_PREDICTOR_FLAT_MODEL_H_
+
+#include <dmlc/io.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xgboost/base.h"
+#include "xgboost/data.h"
+#include "xgboost/generic_parameters.h"
+#include "xgboost/host_device_vector.h"
+#include "xgboost/json.h"
+#include "xgboost/objective.h"
+#include "xgboost/span.h"
+#include "xgboost/tree_model.h"
+
+#include "../common/io.h"
+
+namespace xgboost {
+namespace gbm {
+struct GBTreeModel;
+}  // namespace gbm
+
+namespace predictor {
+/*!
+ * \brief Node of a flattened tree.  A tree is laid out breadth first with the two
+ *  children of a split next to each other, so a node only needs the position of its left
+ *  child.  Nodes are 12 bytes and carry no statistics.
+ */
+struct FlatNode {
+  static uint32_t constexpr kDefaultLeftBit = 1U << 31U;
+  // split feature, with the default direction in the highest bit
+  uint32_t sindex;
+  // split condition for a split node, leaf value for a leaf
+  bst_float value;
+  // position of the left child relative to the tree root, 0 for a leaf
+  uint32_t left;
+
+  bool IsLeaf() const { return left == 0; }
+  uint32_t SplitIndex() const { return sindex & ~kDefaultLeftBit; }
+  bool DefaultLeft() const { return (sindex & kDefaultLeftBit) != 0; }
+};
+static_assert(sizeof(FlatNode) == 12, "Unexpected size of flat tree node.");
+
+/*!
+ * \brief Append the nodes of `tree' to `nodes', with the leaf values multiplied by
+ *  `scale'.
+ * \return Depth of the tree.
+ */
+int32_t FlattenTree(RegTree const& tree, bst_float scale, std::vector<FlatNode>* nodes);
+
+/*!
+ * \brief Leaf value of the flattened tree starting at `root' for one row, `feats' is a
+ *  RegTree::FVec or has the same lookup methods.
+ */
+template <typename FVecT>
+inline bst_float FlatLeafValue(FlatNode const* root, FVecT const& feats) {
+  FlatNode const* node = root;
+  while (!node->IsLeaf()) {
+    uint32_t const fid = node->SplitIndex();
+    uint32_t offset;
+    if (feats.IsMissing(fid)) {
+      offset = node->DefaultLeft() ? 0 : 1;
+    } else {
+      offset = feats.GetFvalue(fid) < node->value ? 0 : 1;
+    }
+    node = root + node->left + offset;
+  }
+  return node->value;
+}
+
+/*!
+ * \brief Read-only tree model in the flat format.
+ *
+ *  The file is a fixed header followed by the tree offsets, the output group of each tree,
+ *  the nodes of all trees and the configuration of the objective, each section aligned to
+ *  64 bytes.  Local files are mapped and never copied, other files are read into memory.
+ */
+class FlatModel {
+ public:
+  /*!
+   * \brief Write the trees of `model' in the flat format.
+   *
+   * \param model        The model, with single output trees.
+   * \param tree_weights Weight multiplied into the leaves of each tree, empty for none.
+   * \param objective    Configuration of the objective transforming the predictions.
+   * \param fo           Output stream.
+   */
+  static void Save(gbm::GBTreeModel const& model, std::vector<bst_float> const& tree_weights,
+                   Json const& objective, dmlc::Stream* fo);
+  /*! \brief Open a model written by `Save'. */
+  static FlatModel* Load(std::string const& fname);
+
+  FlatModel(FlatModel const&) = delete;
+  FlatModel& operator=(FlatModel const&) = delete;
+
+  uint32_t NumFeature() const { return num_feature_; }
+  uint32_t NumGroup() const { return num_group_; }
+  size_t NumTrees() const { return tree_group_.size(); }
+  /*! \brief Whether the trees are used from a mapping of the file. */
+  bool Mapped() const { return file_ != nullptr; }
+
+  /*!
+   * \brief Predict every row of `dmat'.  Safe to call from several threads at once.
+   *
+   * \param dmat          Feature matrix.
+   * \param output_margin Whether to skip the transformation of the objective.
+   * \param out_preds     One value for each output group of every row.
+   */
+  void Predict(DMatrix* dmat, bool output_margin, HostDeviceVector<bst_float>* out_preds) const;
+
+ private:
+  FlatModel() = default;
+  void Init(char const* data, size_t size);
+
+  std::unique_ptr<common::MmapFile> file_;
+  // content of the files that can't be mapped
+  std::string buffer_;
+
+  uint32_t num_feature_ {0};
+  uint32_t num_group_ {0};
+  bst_float base_score_ {0};
+  common::Span<uint64_t const> tree_ptr_;
+  common::Span<uint32_t const> tree_group_;
+  common::Span<FlatNode const> nodes_;
+
+  GenericParameter generic_param_;
+  std::unique_ptr<ObjFunction> obj_;
+};
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_FLAT_MODEL_H_
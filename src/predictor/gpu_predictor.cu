@@ -5,7 +5,11 @@
 #include <thrust/device_ptr.h>
 #include <thrust/device_vector.h>
 #include <thrust/fill.h>
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "xgboost/data.h"
 #include "xgboost/predictor.h"
@@ -14,7 +18,9 @@
 #include "xgboost/host_device_vector.h"
 
 #include "../gbm/gbtree_model.h"
+#include "../data/device_adapter.cuh"
 #include "../data/ellpack_page.cuh"
+#include "../common/categorical.h"
 #include "../common/common.h"
 #include "../common/device_helpers.cuh"
 
@@ -23,19 +29,30 @@ namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(gpu_predictor);
 
+// Features not used by any split of the model are not staged in shared memory.
+constexpr bst_feature_t kUnusedFeature = std::numeric_limits<bst_feature_t>::max();
+// Smallest thread block used to stage rows in shared memory.
+constexpr uint32_t kMinSharedBlockThreads = 32;
+
 struct SparsePageView {
   common::Span<const Entry> d_data;
   common::Span<const bst_row_t> d_row_ptr;
+  // Column of each feature in shared memory, or kUnusedFeature.  Features are staged in
+  // their own column when it's empty.
+  common::Span<const bst_feature_t> d_feature_map;
 
   XGBOOST_DEVICE SparsePageView(common::Span<const Entry> data,
-                                common::Span<const bst_row_t> row_ptr) :
-      d_data{data}, d_row_ptr{row_ptr} {}
+                                common::Span<const bst_row_t> row_ptr,
+                                common::Span<const bst_feature_t> feature_map = {}) :
+      d_data{data}, d_row_ptr{row_ptr}, d_feature_map{feature_map} {}
 };
 
 struct SparsePageLoader {
   bool use_shared;
   common::Span<const bst_row_t> d_row_ptr;
   common::Span<const Entry> d_data;
+  common::Span<const bst_feature_t> d_feature_map;
+  // number of columns staged for each row
   bst_feature_t num_features;
   float* smem;
   size_t entry_start;
@@ -45,6 +62,7 @@ struct SparsePageLoader {
       : use_shared(use_shared),
         d_row_ptr(data.d_row_ptr),
         d_data(data.d_data),
+        d_feature_map(data.d_feature_map),
         num_features(num_features),
         entry_start(entry_start) {
     extern __shared__ float _smem[];
@@ -60,7 +78,14 @@ struct SparsePageLoader {
         bst_uint elem_end = d_row_ptr[global_idx + 1];
         for (bst_uint elem_idx = elem_begin; elem_idx < elem_end; elem_idx++) {
           Entry elem = d_data[elem_idx - entry_start];
-          smem[threadIdx.x * num_features + elem.index] = elem.fvalue;
+          bst_feature_t column = elem.index;
+          if (!d_feature_map.empty()) {
+            column = elem.index < d_feature_map.size() ? d_feature_map[elem.index]
+                                                       : kUnusedFeature;
+          }
+          if (column < num_features) {
+            smem[threadIdx.x * num_features + column] = elem.fvalue;
+          }
         }
       }
       __syncthreads();
@@ -68,7 +93,8 @@ struct SparsePageLoader {
   }
   __device__ float GetFvalue(int ridx, int fidx) const {
     if (use_shared) {
-      return smem[threadIdx.x * num_features + fidx];
+      bst_feature_t const column = d_feature_map.empty() ? fidx : d_feature_map[fidx];
+      return smem[threadIdx.x * num_features + column];
     } else {
       // Binary search
       auto begin_ptr = d_data.begin() + (d_row_ptr[ridx] - entry_start);
@@ -114,22 +140,76 @@ struct EllpackLoader {
   }
 };
 
+/*! \brief Dense device array read in place for inplace prediction. */
+struct DeviceAdapterView {
+  data::CupyAdapterBatch batch;
+  size_t columns;
+  float missing;
+};
+
+struct DeviceAdapterLoader {
+  DeviceAdapterView data;
+  __device__ DeviceAdapterLoader(DeviceAdapterView const& d, bool use_shared,
+                                 bst_feature_t num_features, bst_row_t num_rows,
+                                 size_t entry_start) : data{d} {}
+  __device__ __forceinline__ float GetFvalue(int ridx, int fidx) const {
+    if (static_cast<size_t>(fidx) >= data.columns) {
+      return nanf("");
+    }
+    float const value = data.batch.GetElement(ridx * data.columns + fidx).value;
+    return value == data.missing ? nanf("") : value;
+  }
+};
+
+/*!
+ * \brief Categorical splits of the nodes on device, indexed like the nodes.  All spans
+ *  are empty when the trees have no categorical split.
+ */
+struct CategoricalSplits {
+  common::Span<FeatureType const> split_types;
+  // segments of the nodes in `categories'
+  common::Span<RegTree::Segment const> segments;
+  common::Span<uint64_t const> categories;
+
+  XGBOOST_DEVICE bool IsCategorical(size_t node) const {
+    return !split_types.empty() && split_types[node] == FeatureType::kCategorical;
+  }
+  XGBOOST_DEVICE common::Span<uint64_t const> NodeCats(size_t node) const {
+    auto const& segment = segments[node];
+    return categories.subspan(segment.beg, segment.size);
+  }
+};
+
+// Child of the split `n' at `nidx' followed by `fvalue'.
+__device__ bst_node_t GetNextNode(RegTree::Node const& n, bst_node_t nidx, float fvalue,
+                                  size_t tree_begin, CategoricalSplits const& cats) {
+  // Missing value
+  if (isnan(fvalue)) {
+    return n.DefaultChild();
+  } else if (cats.IsCategorical(tree_begin + nidx)) {
+    // Ellpack values are the lower bound of the bin, which is the category
+    return common::Decision(cats.NodeCats(tree_begin + nidx), common::AsCat(fvalue))
+               ? n.LeftChild()
+               : n.RightChild();
+  } else {
+    if (fvalue < n.SplitCond()) {
+      return n.LeftChild();
+    } else {
+      return n.RightChild();
+    }
+  }
+}
+
 template <typename Loader>
 __device__ float GetLeafWeight(bst_uint ridx, const RegTree::Node* tree,
+                               size_t tree_begin, CategoricalSplits const& cats,
                                Loader* loader) {
+  bst_node_t nidx = 0;
   RegTree::Node n = tree[0];
   while (!n.IsLeaf()) {
     float fvalue = loader->GetFvalue(ridx, n.SplitIndex());
-    // Missing value
-    if (isnan(fvalue)) {
-      n = tree[n.DefaultChild()];
-    } else {
-      if (fvalue < n.SplitCond()) {
-        n = tree[n.LeftChild()];
-      } else {
-        n = tree[n.RightChild()];
-      }
-    }
+    nidx = GetNextNode(n, nidx, fvalue, tree_begin, cats);
+    n = tree[nidx];
   }
   return n.LeafValue();
 }
@@ -137,6 +217,7 @@ __device__ float GetLeafWeight(bst_uint ridx, const RegTree::Node* tree,
 template <typename Loader, typename Data>
 __global__ void PredictKernel(Data data,
                               common::Span<const RegTree::Node> d_nodes,
+                              CategoricalSplits d_cats,
                               common::Span<float> d_out_predictions,
                               common::Span<size_t> d_tree_segments,
                               common::Span<int> d_tree_group,
@@ -149,110 +230,642 @@ __global__ void PredictKernel(Data data,
   if (num_group == 1) {
     float sum = 0;
     for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
-      const RegTree::Node* d_tree =
-          &d_nodes[d_tree_segments[tree_idx - tree_begin]];
-      float leaf = GetLeafWeight(global_idx, d_tree, &loader);
+      const RegTree::Node* d_tree = &d_nodes[d_tree_segments[tree_idx]];
+      float leaf = GetLeafWeight(global_idx, d_tree, d_tree_segments[tree_idx], d_cats,
+                                 &loader);
       sum += leaf;
     }
     d_out_predictions[global_idx] += sum;
   } else {
     for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       int tree_group = d_tree_group[tree_idx];
-      const RegTree::Node* d_tree =
-          &d_nodes[d_tree_segments[tree_idx - tree_begin]];
+      const RegTree::Node* d_tree = &d_nodes[d_tree_segments[tree_idx]];
       bst_uint out_prediction_idx = global_idx * num_group + tree_group;
       d_out_predictions[out_prediction_idx] +=
-          GetLeafWeight(global_idx, d_tree, &loader);
+          GetLeafWeight(global_idx, d_tree, d_tree_segments[tree_idx], d_cats, &loader);
     }
   }
 }
 
-class GPUPredictor : public xgboost::Predictor {
+// Add the leaf values of the trees listed in `d_trees', scaled by `d_tree_weights'.
+template <typename Loader, typename Data>
+__global__ void PredictWeightedKernel(Data data,
+                                      common::Span<const RegTree::Node> d_nodes,
+                                      CategoricalSplits d_cats,
+                                      common::Span<float> d_out_predictions,
+                                      common::Span<size_t> d_tree_segments,
+                                      common::Span<int> d_tree_group,
+                                      common::Span<size_t const> d_trees,
+                                      common::Span<float const> d_tree_weights,
+                                      size_t num_features, size_t num_rows,
+                                      size_t entry_start, bool use_shared, int num_group) {
+  bst_uint global_idx = blockDim.x * blockIdx.x + threadIdx.x;
+  Loader loader(data, use_shared, num_features, num_rows, entry_start);
+  if (global_idx >= num_rows) return;
+  for (size_t k = 0; k < d_trees.size(); ++k) {
+    size_t const tree_idx = d_trees[k];
+    const RegTree::Node* d_tree = &d_nodes[d_tree_segments[tree_idx]];
+    bst_uint out_prediction_idx = global_idx * num_group + d_tree_group[tree_idx];
+    d_out_predictions[out_prediction_idx] +=
+        d_tree_weights[k] *
+        GetLeafWeight(global_idx, d_tree, d_tree_segments[tree_idx], d_cats, &loader);
+  }
+}
+
+// Upper bound of unique features (plus the bias) along a root to leaf path handled by the
+// SHAP kernels, the permutation weights of a path are kept in registers.
+constexpr int kMaxShapPathLength = 32;
+constexpr bst_feature_t kShapBiasFeature = std::numeric_limits<bst_feature_t>::max();
+
+/*!
+ * \brief One unique feature of a root to leaf path.  Repeated splits on a feature are
+ *  merged into the interval a value must fall in to follow them all.
+ */
+struct ShapPathElement {
+  bst_feature_t feature_idx;
+  float lower_bound;
+  float upper_bound;
+  // whether a missing value follows every split on this feature
+  bool is_missing_branch;
+  // fraction of the training cover coming down the path through this feature's splits
+  float zero_fraction;
+
+  __device__ float OneFraction(float fvalue) const {
+    if (isnan(fvalue)) {
+      return is_missing_branch;
+    }
+    return fvalue >= lower_bound && fvalue < upper_bound;
+  }
+};
+
+struct ShapPath {
+  size_t begin;
+  int length;
+  int group;
+  // leaf value multiplied by the tree weight
+  float leaf_value;
+};
+
+/*!
+ * \brief Root to leaf paths of a forest, the decomposition TreeShap sums over implicitly.
+ *  The expected value of each output group is accumulated on the way.
+ */
+struct ShapPaths {
+  std::vector<ShapPathElement> elements;
+  std::vector<ShapPath> paths;
+  std::vector<float> expected_values;
+
+  explicit ShapPaths(uint32_t num_group) : expected_values(num_group, 0.0f) {}
+
+  void Add(RegTree const& tree, int group, float weight) {
+    std::vector<ShapPathElement> path{
+        {kShapBiasFeature, -std::numeric_limits<float>::infinity(),
+         std::numeric_limits<float>::infinity(), true, 1.0f}};
+    this->Walk(tree, 0, group, weight, &path);
+  }
+
  private:
-  void InitModel(const gbm::GBTreeModel& model,
-                 const thrust::host_vector<size_t>& h_tree_segments,
-                 const thrust::host_vector<RegTree::Node>& h_nodes,
-                 size_t tree_begin, size_t tree_end) {
-    dh::safe_cuda(cudaSetDevice(generic_param_->gpu_id));
-    nodes_.resize(h_nodes.size());
-    dh::safe_cuda(cudaMemcpyAsync(nodes_.data().get(), h_nodes.data(),
-                                  sizeof(RegTree::Node) * h_nodes.size(),
-                                  cudaMemcpyHostToDevice));
-    tree_segments_.resize(h_tree_segments.size());
-    dh::safe_cuda(cudaMemcpyAsync(tree_segments_.data().get(), h_tree_segments.data(),
-                                  sizeof(size_t) * h_tree_segments.size(),
-                                  cudaMemcpyHostToDevice));
-    tree_group_.resize(model.tree_info.size());
-    dh::safe_cuda(cudaMemcpyAsync(tree_group_.data().get(), model.tree_info.data(),
-                                  sizeof(int) * model.tree_info.size(),
-                                  cudaMemcpyHostToDevice));
-    this->tree_begin_ = tree_begin;
-    this->tree_end_ = tree_end;
-    this->num_group_ = model.learner_model_param_->num_output_group;
+  void Walk(RegTree const& tree, bst_node_t nid, int group, float weight,
+            std::vector<ShapPathElement>* path) {
+    auto const& node = tree[nid];
+    if (node.IsLeaf()) {
+      float cover = 1.0f;
+      for (auto const& elem : *path) {
+        cover *= elem.zero_fraction;
+      }
+      expected_values[group] += weight * node.LeafValue() * cover;
+      if (path->size() > 1) {
+        CHECK_LE(path->size(), kMaxShapPathLength)
+            << "Trees with more than " << kMaxShapPathLength - 1
+            << " unique features on a path are not supported by GPU SHAP.";
+        paths.push_back({elements.size(), static_cast<int>(path->size()), group,
+                         weight * node.LeafValue()});
+        elements.insert(elements.end(), path->cbegin(), path->cend());
+      }
+      return;
+    }
+    float const cover = tree.Stat(nid).sum_hess;
+    for (bst_node_t child : {node.LeftChild(), node.RightChild()}) {
+      std::vector<ShapPathElement> child_path = *path;
+      auto it = std::find_if(child_path.begin(), child_path.end(),
+                             [&](ShapPathElement const& elem) {
+                               return elem.feature_idx == node.SplitIndex();
+                             });
+      if (it == child_path.end()) {
+        child_path.push_back({node.SplitIndex(), -std::numeric_limits<float>::infinity(),
+                              std::numeric_limits<float>::infinity(), true, 1.0f});
+        it = child_path.end() - 1;
+      }
+      it->zero_fraction *= tree.Stat(child).sum_hess / cover;
+      it->is_missing_branch = it->is_missing_branch && child == node.DefaultChild();
+      if (child == node.LeftChild()) {
+        it->upper_bound = std::min(it->upper_bound, node.SplitCond());
+      } else {
+        it->lower_bound = std::max(it->lower_bound, node.SplitCond());
+      }
+      this->Walk(tree, child, group, weight, &child_path);
+    }
   }
+};
 
-  void PredictInternal(const SparsePage& batch, size_t num_features,
-                       HostDeviceVector<bst_float>* predictions,
-                       size_t batch_offset) {
-    batch.offset.SetDevice(generic_param_->gpu_id);
-    batch.data.SetDevice(generic_param_->gpu_id);
-    const uint32_t BLOCK_THREADS = 128;
-    size_t num_rows = batch.Size();
-    auto GRID_SIZE = static_cast<uint32_t>(common::DivRoundUp(num_rows, BLOCK_THREADS));
+// Same as `ExtendPath' of tree_model.cc, on the permutation weights alone.
+__device__ void ExtendShapPath(float* pweight, int unique_depth, float zero_fraction,
+                               float one_fraction) {
+  pweight[unique_depth] = unique_depth == 0 ? 1.0f : 0.0f;
+  for (int i = unique_depth - 1; i >= 0; i--) {
+    pweight[i + 1] += one_fraction * pweight[i] * (i + 1)
+                      / static_cast<float>(unique_depth + 1);
+    pweight[i] = zero_fraction * pweight[i] * (unique_depth - i)
+                 / static_cast<float>(unique_depth + 1);
+  }
+}
+
+// Same as `UnwoundPathSum' of tree_model.cc.
+__device__ float UnwoundShapPathSum(float const* pweight, int unique_depth,
+                                    float zero_fraction, float one_fraction) {
+  float next_one_portion = pweight[unique_depth];
+  float total = 0;
+  for (int i = unique_depth - 1; i >= 0; --i) {
+    if (one_fraction != 0) {
+      const float tmp = next_one_portion * (unique_depth + 1)
+                        / static_cast<float>((i + 1) * one_fraction);
+      total += tmp;
+      next_one_portion = pweight[i] - tmp * zero_fraction * ((unique_depth - i)
+                         / static_cast<float>(unique_depth + 1));
+    } else if (zero_fraction != 0) {
+      total += (pweight[i] / zero_fraction) / ((unique_depth - i)
+               / static_cast<float>(unique_depth + 1));
+    }
+  }
+  return total;
+}
+
+/*!
+ * \brief Add the SHAP values of one path to phi[feature * stride], leaving out the
+ *  element `skip' (-1 for none) as TreeShap does for a conditioned feature.
+ * \return sum of the added values.
+ */
+__device__ float PathShap(ShapPathElement const* path, float const* one_fractions,
+                          int length, int skip, float scale, float* phi, size_t stride) {
+  if (scale == 0) {
+    return 0;
+  }
+  float pweight[kMaxShapPathLength];
+  int unique_depth = 0;
+  for (int i = 0; i < length; ++i) {
+    if (i != skip) {
+      ExtendShapPath(pweight, unique_depth, path[i].zero_fraction, one_fractions[i]);
+      ++unique_depth;
+    }
+  }
+  unique_depth -= 1;
+  float sum = 0;
+  // the bias element leads every path and takes no value
+  for (int i = 1; i < length; ++i) {
+    if (i != skip) {
+      float const w = UnwoundShapPathSum(pweight, unique_depth, path[i].zero_fraction,
+                                         one_fractions[i]);
+      float const value = w * (one_fractions[i] - path[i].zero_fraction) * scale;
+      atomicAdd(&phi[path[i].feature_idx * stride], value);
+      sum += value;
+    }
+  }
+  return sum;
+}
+
+/*!
+ * \brief One thread per row and path.  Writes either the contributions, optionally with
+ *  a conditioned feature, or the interaction values.  The bias column is left to the
+ *  caller.
+ */
+template <typename Loader, typename Data>
+__global__ void ShapKernel(Data data, common::Span<const ShapPathElement> d_elements,
+                           common::Span<const ShapPath> d_paths, common::Span<float> d_phis,
+                           size_t num_features, size_t num_rows, size_t entry_start,
+                           int num_group, int condition, unsigned condition_feature,
+                           bool interactions) {
+  size_t const idx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  Loader loader(data, false, num_features, num_rows, entry_start);
+  if (idx >= num_rows * d_paths.size()) return;
+  size_t const ridx = idx / d_paths.size();
+  ShapPath const path = d_paths[idx % d_paths.size()];
+  ShapPathElement const* elements = &d_elements[path.begin];
+
+  float one_fractions[kMaxShapPathLength];
+  one_fractions[0] = 1.0f;
+  for (int i = 1; i < path.length; ++i) {
+    one_fractions[i] = elements[i].OneFraction(loader.GetFvalue(ridx, elements[i].feature_idx));
+  }
+
+  size_t const ncolumns = num_features + 1;
+  if (!interactions) {
+    float* phi = &d_phis[(ridx * num_group + path.group) * ncolumns];
+    int skip = -1;
+    float scale = path.leaf_value;
+    if (condition != 0) {
+      for (int i = 1; i < path.length; ++i) {
+        if (elements[i].feature_idx == condition_feature) {
+          skip = i;
+          scale *= condition > 0 ? one_fractions[i] : elements[i].zero_fraction;
+        }
+      }
+    }
+    PathShap(elements, one_fractions, path.length, skip, scale, phi, 1);
+    return;
+  }
+
+  float* phi = &d_phis[(ridx * num_group + path.group) * ncolumns * ncolumns];
+  // main effects on the diagonal
+  PathShap(elements, one_fractions, path.length, -1, path.leaf_value, phi, ncolumns + 1);
+  // Conditioning a feature on and off only changes the paths it is on, the difference
+  // of their values without it is the one/zero fractions' difference.
+  for (int i = 1; i < path.length; ++i) {
+    float const scale =
+        path.leaf_value * (one_fractions[i] - elements[i].zero_fraction) / 2.0f;
+    float* phi_row = phi + elements[i].feature_idx * ncolumns;
+    float const sum = PathShap(elements, one_fractions, path.length, i, scale, phi_row, 1);
+    atomicAdd(&phi_row[elements[i].feature_idx], -sum);
+  }
+}
+
+/*!
+ * \brief One thread per row and tree, adding the approximate contributions of the tree:
+ *  the root mean goes to the bias and the change of node mean at each split along the
+ *  row's path goes to the split feature, all scaled by the tree weight.
+ */
+template <typename Loader, typename Data>
+__global__ void ApproxShapKernel(Data data, common::Span<const RegTree::Node> d_nodes,
+                                 common::Span<const float> d_mean_values,
+                                 CategoricalSplits d_cats,
+                                 common::Span<const size_t> d_tree_segments,
+                                 common::Span<const int> d_tree_group,
+                                 common::Span<const float> d_tree_weights,
+                                 common::Span<float> d_phis, size_t num_trees,
+                                 size_t num_features, size_t num_rows, size_t entry_start,
+                                 int num_group) {
+  size_t const idx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  Loader loader(data, false, num_features, num_rows, entry_start);
+  if (idx >= num_rows * num_trees) return;
+  size_t const ridx = idx / num_trees;
+  size_t const tree_idx = idx % num_trees;
+  size_t const tree_begin = d_tree_segments[tree_idx];
+  RegTree::Node const* tree = &d_nodes[tree_begin];
+  float const* means = &d_mean_values[tree_begin];
+  float const weight = d_tree_weights.empty() ? 1.0f : d_tree_weights[tree_idx];
+  float* phi = &d_phis[(ridx * num_group + d_tree_group[tree_idx]) * (num_features + 1)];
+
+  float node_value = means[0];
+  atomicAdd(&phi[num_features], node_value * weight);
+  bst_node_t nidx = 0;
+  RegTree::Node n = tree[0];
+  while (!n.IsLeaf()) {
+    bst_feature_t const split_index = n.SplitIndex();
+    nidx = GetNextNode(n, nidx, loader.GetFvalue(ridx, split_index), tree_begin, d_cats);
+    n = tree[nidx];
+    // the mean of a leaf is its value
+    float const new_value = means[nidx];
+    atomicAdd(&phi[split_index], (new_value - node_value) * weight);
+    node_value = new_value;
+  }
+}
+
+/*!
+ * \brief Device copy of the trees of a model.  It's shared by the prediction calls
+ *  running on it and never written to while any of them holds it.
+ */
+struct DeviceModel {
+  dh::device_vector<RegTree::Node> nodes;
+  // mean value of each node for the approximate contributions, parallel to `nodes'
+  dh::device_vector<float> mean_values;
+  dh::device_vector<size_t> tree_segments;
+  dh::device_vector<int> tree_group;
+  // categorical splits of the nodes, parallel to `nodes'
+  dh::device_vector<FeatureType> split_types;
+  dh::device_vector<RegTree::Segment> categories_segments;
+  dh::device_vector<uint64_t> categories;
+  bool has_categorical {false};
+  // shared memory column of each feature, see SparsePageView
+  std::vector<bst_feature_t> h_feature_map;
+  dh::device_vector<bst_feature_t> feature_map;
+  bst_feature_t num_used_features {0};
+  // model generation and device of the copy
+  uint64_t generation {0};
+  int device {-1};
+
+  /*! \brief Categorical splits of the device copy of the model. */
+  CategoricalSplits Categories() const {
+    if (!has_categorical) {
+      return {};
+    }
+    return {{split_types.data().get(), split_types.size()},
+            {categories_segments.data().get(), categories_segments.size()},
+            {categories.data().get(), categories.size()}};
+  }
+};
+
+/*!
+ * \brief Stream of the calling thread on `device', so that predictions from several
+ *  threads run concurrently.  The stream doesn't synchronize with the default stream,
+ *  see `WaitDefaultStream'.
+ */
+cudaStream_t ThreadStream(int device) {
+  struct ThreadStreams {
+    std::vector<cudaStream_t> streams;
+    ~ThreadStreams() {
+      // the runtime may be shut down already at exit, errors are ignored
+      for (auto stream : streams) {
+        if (stream != nullptr) {
+          cudaStreamDestroy(stream);
+        }
+      }
+    }
+  };
+  static thread_local ThreadStreams thread_streams;
+  auto& streams = thread_streams.streams;
+  if (streams.size() <= static_cast<size_t>(device)) {
+    streams.resize(device + 1, nullptr);
+  }
+  if (streams[device] == nullptr) {
+    dh::safe_cuda(cudaStreamCreateWithFlags(&streams[device], cudaStreamNonBlocking));
+  }
+  return streams[device];
+}
+
+/*!
+ * \brief Make `stream' wait for the work queued on the default stream so far, which is
+ *  where HostDeviceVector and thrust write the inputs and outputs.
+ */
+void WaitDefaultStream(cudaStream_t stream) {
+  cudaEvent_t event;
+  dh::safe_cuda(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+  dh::safe_cuda(cudaEventRecord(event, nullptr));
+  dh::safe_cuda(cudaStreamWaitEvent(stream, event, 0));
+  dh::safe_cuda(cudaEventDestroy(event));
+}
+
+/*!
+ * \brief Pinned and device buffers of a page read from external memory.  Pages are
+ *  copied on the stream of the prediction, so the copy of a page overlaps with the
+ *  kernel of the one before.
+ */
+struct PageStaging {
+  dh::PinnedMemory h_data;
+  dh::PinnedMemory h_offset;
+  dh::caching_device_vector<Entry> d_data;
+  dh::caching_device_vector<bst_row_t> d_offset;
+  // recorded after the kernel reading the buffers
+  cudaEvent_t done;
+
+  PageStaging() {
+    dh::safe_cuda(cudaEventCreateWithFlags(&done, cudaEventDisableTiming));
+  }
+  ~PageStaging() { cudaEventDestroy(done); }
+
+  SparsePageView Stage(SparsePage const& batch, cudaStream_t stream) {
+    // the buffers are still read by the previous kernel launched on them
+    dh::safe_cuda(cudaEventSynchronize(done));
+    auto const& data = batch.data.ConstHostVector();
+    auto const& offset = batch.offset.ConstHostVector();
+    auto h_data_span = h_data.GetSpan<Entry>(data.size());
+    auto h_offset_span = h_offset.GetSpan<bst_row_t>(offset.size());
+    std::copy(data.cbegin(), data.cend(), h_data_span.begin());
+    std::copy(offset.cbegin(), offset.cend(), h_offset_span.begin());
+    if (d_data.size() < data.size() || d_offset.size() < offset.size()) {
+      d_data.resize(std::max(d_data.size(), data.size()));
+      d_offset.resize(std::max(d_offset.size(), offset.size()));
+      // resizing initializes the new elements on the default stream
+      WaitDefaultStream(stream);
+    }
+    dh::safe_cuda(cudaMemcpyAsync(d_data.data().get(), h_data_span.data(),
+                                  sizeof(Entry) * data.size(), cudaMemcpyHostToDevice,
+                                  stream));
+    dh::safe_cuda(cudaMemcpyAsync(d_offset.data().get(), h_offset_span.data(),
+                                  sizeof(bst_row_t) * offset.size(),
+                                  cudaMemcpyHostToDevice, stream));
+    return {{d_data.data().get(), data.size()}, {d_offset.data().get(), offset.size()}};
+  }
+};
+
+class GPUPredictor : public xgboost::Predictor {
+ private:
+  /*! \brief Trees added by one prediction call and the stream it runs on. */
+  struct PredictCall {
+    DeviceModel* model;
+    // `trees' lists the trees to add with their `tree_weights', when it's empty trees
+    // [tree_begin, tree_end) are added with unit weights.
+    size_t tree_begin;
+    size_t tree_end;
+    common::Span<size_t const> trees;
+    common::Span<float const> tree_weights;
+    int num_group;
+    cudaStream_t stream;
+  };
 
-    auto shared_memory_bytes =
-        static_cast<size_t>(sizeof(float) * num_features * BLOCK_THREADS);
+  void PredictInternal(SparsePageView data, size_t num_rows, size_t num_features,
+                       HostDeviceVector<bst_float>* predictions, size_t batch_offset,
+                       PredictCall const& call) {
+    DeviceModel& d_model = *call.model;
+    uint32_t BLOCK_THREADS = 128;
+
+    // Rows too wide for shared memory only stage the features used by the model, then
+    // fewer rows are staged by each block down to a warp.  Rows still too wide are
+    // searched in global memory.
+    common::Span<bst_feature_t const> feature_map;
+    auto shared_bytes = [&](size_t columns) {
+      return static_cast<size_t>(sizeof(float) * columns * BLOCK_THREADS);
+    };
+    if (shared_bytes(num_features) > max_shared_memory_bytes_ &&
+        d_model.num_used_features < num_features) {
+      num_features = d_model.num_used_features;
+      feature_map = dh::ToSpan(d_model.feature_map);
+    }
+    while (BLOCK_THREADS > kMinSharedBlockThreads &&
+           shared_bytes(num_features) > max_shared_memory_bytes_) {
+      BLOCK_THREADS /= 2;
+    }
+    auto shared_memory_bytes = shared_bytes(num_features);
     bool use_shared = true;
     if (shared_memory_bytes > max_shared_memory_bytes_) {
       shared_memory_bytes = 0;
       use_shared = false;
+      BLOCK_THREADS = 128;
+      feature_map = {};
     }
+    auto GRID_SIZE = static_cast<uint32_t>(common::DivRoundUp(num_rows, BLOCK_THREADS));
     size_t entry_start = 0;
-    SparsePageView data{batch.data.DeviceSpan(), batch.offset.DeviceSpan()};
-    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, shared_memory_bytes} (
+    data.d_feature_map = feature_map;
+    if (!call.trees.empty()) {
+      dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, shared_memory_bytes, call.stream} (
+          PredictWeightedKernel<SparsePageLoader, SparsePageView>,
+          data,
+          dh::ToSpan(d_model.nodes), d_model.Categories(),
+          predictions->DeviceSpan().subspan(batch_offset),
+          dh::ToSpan(d_model.tree_segments), dh::ToSpan(d_model.tree_group), call.trees,
+          call.tree_weights, num_features, num_rows, entry_start, use_shared,
+          call.num_group);
+      return;
+    }
+    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, shared_memory_bytes, call.stream} (
         PredictKernel<SparsePageLoader, SparsePageView>,
         data,
-        dh::ToSpan(nodes_), predictions->DeviceSpan().subspan(batch_offset),
-        dh::ToSpan(tree_segments_), dh::ToSpan(tree_group_),
-        this->tree_begin_, this->tree_end_, num_features, num_rows,
-        entry_start, use_shared, this->num_group_);
+        dh::ToSpan(d_model.nodes), d_model.Categories(),
+        predictions->DeviceSpan().subspan(batch_offset),
+        dh::ToSpan(d_model.tree_segments), dh::ToSpan(d_model.tree_group),
+        call.tree_begin, call.tree_end, num_features, num_rows,
+        entry_start, use_shared, call.num_group);
   }
   void PredictInternal(EllpackMatrix const& batch, HostDeviceVector<bst_float>* out_preds,
-                       size_t batch_offset) {
+                       size_t batch_offset, PredictCall const& call) {
+    DeviceModel& d_model = *call.model;
     const uint32_t BLOCK_THREADS = 256;
     size_t num_rows = batch.n_rows;
     auto GRID_SIZE = static_cast<uint32_t>(common::DivRoundUp(num_rows, BLOCK_THREADS));
 
     bool use_shared = false;
     size_t entry_start = 0;
-    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS} (
+    if (!call.trees.empty()) {
+      dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, 0, call.stream} (
+          PredictWeightedKernel<EllpackLoader, EllpackMatrix>,
+          batch,
+          dh::ToSpan(d_model.nodes), d_model.Categories(),
+          out_preds->DeviceSpan().subspan(batch_offset),
+          dh::ToSpan(d_model.tree_segments), dh::ToSpan(d_model.tree_group), call.trees,
+          call.tree_weights, batch.info.NumFeatures(), num_rows, entry_start, use_shared,
+          call.num_group);
+      return;
+    }
+    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, 0, call.stream} (
         PredictKernel<EllpackLoader, EllpackMatrix>,
         batch,
-        dh::ToSpan(nodes_), out_preds->DeviceSpan().subspan(batch_offset),
-        dh::ToSpan(tree_segments_), dh::ToSpan(tree_group_),
-        this->tree_begin_, this->tree_end_, batch.info.NumFeatures(), num_rows,
-        entry_start, use_shared, this->num_group_);
+        dh::ToSpan(d_model.nodes), d_model.Categories(),
+        out_preds->DeviceSpan().subspan(batch_offset),
+        dh::ToSpan(d_model.tree_segments), dh::ToSpan(d_model.tree_group),
+        call.tree_begin, call.tree_end, batch.info.NumFeatures(), num_rows,
+        entry_start, use_shared, call.num_group);
   }
 
-  void InitModel(const gbm::GBTreeModel& model, size_t tree_begin, size_t tree_end) {
-    CHECK_EQ(model.param.size_leaf_vector, 0);
-    // Copy decision trees to device
+  /*!
+   * \brief Make trees [0, tree_end) of the model available on device.  The device copy is
+   *  kept between calls and only the trees committed since are uploaded, unless the
+   *  model's generation or the device changed.  A copy still used by other calls is
+   *  left alone and a new one is made instead.
+   */
+  std::shared_ptr<DeviceModel> InitModel(const gbm::GBTreeModel& model, size_t tree_end) {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "Multi-output trees are only supported by the CPU predictor.";
+    dh::safe_cuda(cudaSetDevice(generic_param_->gpu_id));
+    std::lock_guard<std::mutex> guard(model_lock_);
+    bool const stale = !d_model_ || model.Generation() != d_model_->generation ||
+                       generic_param_->gpu_id != d_model_->device ||
+                       d_model_->tree_group.size() > model.trees.size();
+    if (stale) {
+      d_model_ = std::make_shared<DeviceModel>();
+      d_model_->generation = model.Generation();
+      d_model_->device = generic_param_->gpu_id;
+    }
+    size_t const tree_begin = d_model_->tree_group.size();
+    if (tree_end <= tree_begin) {
+      return d_model_;
+    }
+    if (d_model_.use_count() > 1) {
+      d_model_ = std::make_shared<DeviceModel>(*d_model_);
+    }
+    DeviceModel& d_model = *d_model_;
+    // Copy new decision trees to device
     thrust::host_vector<size_t> h_tree_segments{};
     h_tree_segments.reserve((tree_end - tree_begin) + 1);
-    size_t sum = 0;
-    h_tree_segments.push_back(sum);
+    size_t sum = d_model.nodes.size();
+    if (tree_begin == 0) {
+      h_tree_segments.push_back(sum);
+    }
     for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       sum += model.trees.at(tree_idx)->GetNodes().size();
       h_tree_segments.push_back(sum);
     }
 
-    thrust::host_vector<RegTree::Node> h_nodes(h_tree_segments.back());
+    size_t const nodes_begin = d_model.nodes.size();
+    thrust::host_vector<RegTree::Node> h_nodes(sum - nodes_begin);
+    auto h_nodes_it = h_nodes.begin();
     for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       auto& src_nodes = model.trees.at(tree_idx)->GetNodes();
-      std::copy(src_nodes.begin(), src_nodes.end(),
-                h_nodes.begin() + h_tree_segments[tree_idx - tree_begin]);
+      h_nodes_it = std::copy(src_nodes.begin(), src_nodes.end(), h_nodes_it);
     }
-    InitModel(model, h_tree_segments, h_nodes, tree_begin, tree_end);
+
+    d_model.nodes.resize(sum);
+    dh::safe_cuda(cudaMemcpyAsync(d_model.nodes.data().get() + nodes_begin, h_nodes.data(),
+                                  sizeof(RegTree::Node) * h_nodes.size(),
+                                  cudaMemcpyHostToDevice));
+    // Node means are computed once for each tree uploaded, without writing to the trees.
+    thrust::host_vector<float> h_mean_values;
+    h_mean_values.reserve(h_nodes.size());
+    std::vector<bst_float> tree_means;
+    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+      model.trees.at(tree_idx)->CalcNodeMeanValues(&tree_means);
+      h_mean_values.insert(h_mean_values.end(), tree_means.cbegin(), tree_means.cend());
+    }
+    d_model.mean_values.resize(sum);
+    dh::safe_cuda(cudaMemcpyAsync(d_model.mean_values.data().get() + nodes_begin,
+                                  h_mean_values.data(), sizeof(float) * h_mean_values.size(),
+                                  cudaMemcpyHostToDevice));
+    size_t const segments_begin = d_model.tree_segments.size();
+    d_model.tree_segments.resize(segments_begin + h_tree_segments.size());
+    dh::safe_cuda(cudaMemcpyAsync(d_model.tree_segments.data().get() + segments_begin,
+                                  h_tree_segments.data(),
+                                  sizeof(size_t) * h_tree_segments.size(),
+                                  cudaMemcpyHostToDevice));
+    d_model.tree_group.resize(tree_end);
+    dh::safe_cuda(cudaMemcpyAsync(d_model.tree_group.data().get() + tree_begin,
+                                  model.tree_info.data() + tree_begin,
+                                  sizeof(int) * (tree_end - tree_begin),
+                                  cudaMemcpyHostToDevice));
+
+    // Categorical splits, with the segments rebased on all categories of the model
+    std::vector<FeatureType> h_split_types;
+    std::vector<RegTree::Segment> h_segments;
+    std::vector<uint64_t> h_categories;
+    h_split_types.reserve(h_nodes.size());
+    h_segments.reserve(h_nodes.size());
+    size_t const categories_begin = d_model.categories.size();
+    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+      auto const& tree = *model.trees.at(tree_idx);
+      d_model.has_categorical = d_model.has_categorical || tree.HasCategoricalSplit();
+      size_t const offset = categories_begin + h_categories.size();
+      auto const& split_types = tree.GetSplitTypes();
+      h_split_types.insert(h_split_types.end(), split_types.cbegin(), split_types.cend());
+      for (auto const& segment : tree.GetSplitCategoriesPtr()) {
+        h_segments.emplace_back(segment.beg + offset, segment.size);
+      }
+      auto const& categories = tree.GetSplitCategories();
+      h_categories.insert(h_categories.end(), categories.cbegin(), categories.cend());
+    }
+    d_model.split_types.insert(d_model.split_types.end(), h_split_types.cbegin(),
+                               h_split_types.cend());
+    d_model.categories_segments.insert(d_model.categories_segments.end(),
+                                       h_segments.cbegin(), h_segments.cend());
+    d_model.categories.insert(d_model.categories.end(), h_categories.cbegin(),
+                              h_categories.cend());
+
+    // Shared memory columns of the split features, new features are added at the end so
+    // the columns of earlier trees are kept.
+    bst_feature_t const num_used = d_model.num_used_features;
+    auto& h_feature_map = d_model.h_feature_map;
+    for (auto const& node : h_nodes) {
+      if (node.IsLeaf()) {
+        continue;
+      }
+      bst_feature_t const fidx = node.SplitIndex();
+      if (fidx >= h_feature_map.size()) {
+        h_feature_map.resize(fidx + 1, kUnusedFeature);
+      }
+      if (h_feature_map[fidx] == kUnusedFeature) {
+        h_feature_map[fidx] = d_model.num_used_features++;
+      }
+    }
+    if (d_model.num_used_features != num_used ||
+        d_model.feature_map.size() != h_feature_map.size()) {
+      d_model.feature_map = h_feature_map;
+    }
+    return d_model_;
   }
 
   void DevicePredictInternal(DMatrix* dmat, HostDeviceVector<float>* out_preds,
@@ -263,29 +876,195 @@ class GPUPredictor : public xgboost::Predictor {
       return;
     }
     monitor_.StartCuda("DevicePredictInternal");
-    InitModel(model, tree_begin, tree_end);
-    out_preds->SetDevice(generic_param_->gpu_id);
+    auto d_model = InitModel(model, tree_end);
+    PredictCall call {d_model.get(), tree_begin, tree_end, {}, {},
+                      static_cast<int>(model.learner_model_param_->num_output_group),
+                      ThreadStream(generic_param_->gpu_id)};
+    this->PredictPages(dmat, out_preds, model, call);
+    monitor_.StopCuda("DevicePredictInternal");
+  }
 
+  /*!
+   * \brief Run the prediction kernel over every page on the stream of `call', returns
+   *  once the predictions are written.
+   */
+  void PredictPages(DMatrix* dmat, HostDeviceVector<float>* out_preds,
+                    const gbm::GBTreeModel& model, PredictCall const& call) {
+    out_preds->SetDevice(generic_param_->gpu_id);
+    out_preds->DeviceSpan();
+    WaitDefaultStream(call.stream);
     if (dmat->PageExists<EllpackPage>()) {
       size_t batch_offset = 0;
       for (auto const& page : dmat->GetBatches<EllpackPage>()) {
-        this->PredictInternal(page.Impl()->matrix, out_preds, batch_offset);
+        this->PredictInternal(page.Impl()->matrix, out_preds, batch_offset, call);
         batch_offset += page.Impl()->matrix.n_rows;
       }
+    } else if (dmat->SingleColBlock()) {
+      size_t batch_offset = 0;
+      for (auto &batch : dmat->GetBatches<SparsePage>()) {
+        batch.offset.SetDevice(generic_param_->gpu_id);
+        batch.data.SetDevice(generic_param_->gpu_id);
+        SparsePageView data{batch.data.DeviceSpan(), batch.offset.DeviceSpan()};
+        WaitDefaultStream(call.stream);
+        this->PredictInternal(data, batch.Size(), model.learner_model_param_->num_feature,
+                              out_preds, batch_offset, call);
+        batch_offset += batch.Size() * model.learner_model_param_->num_output_group;
+      }
     } else {
+      // Pages of external memory are read once, they are not kept on device.
+      PageStaging staging[2];
       size_t batch_offset = 0;
+      size_t n_pages = 0;
       for (auto &batch : dmat->GetBatches<SparsePage>()) {
-        this->PredictInternal(batch, model.learner_model_param_->num_feature,
-                              out_preds, batch_offset);
+        PageStaging& slot = staging[n_pages % 2];
+        SparsePageView data = slot.Stage(batch, call.stream);
+        this->PredictInternal(data, batch.Size(), model.learner_model_param_->num_feature,
+                              out_preds, batch_offset, call);
+        dh::safe_cuda(cudaEventRecord(slot.done, call.stream));
         batch_offset += batch.Size() * model.learner_model_param_->num_output_group;
+        ++n_pages;
       }
     }
-    monitor_.StopCuda("DevicePredictInternal");
+    dh::safe_cuda(cudaStreamSynchronize(call.stream));
+  }
+
+  template <typename Loader, typename Data>
+  void ShapInternal(Data const& data, size_t num_rows, size_t num_features,
+                    size_t entry_start, dh::device_vector<ShapPathElement>* d_elements,
+                    dh::device_vector<ShapPath>* d_paths, common::Span<float> d_phis,
+                    int num_group, int condition, unsigned condition_feature,
+                    bool interactions) {
+    const uint32_t BLOCK_THREADS = 256;
+    auto GRID_SIZE = static_cast<uint32_t>(
+        common::DivRoundUp(num_rows * d_paths->size(), BLOCK_THREADS));
+    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS} (
+        ShapKernel<Loader, Data>, data, dh::ToSpan(*d_elements), dh::ToSpan(*d_paths),
+        d_phis, num_features, num_rows, entry_start, num_group, condition,
+        condition_feature, interactions);
+  }
+
+  template <typename Loader, typename Data>
+  void ApproxShapInternal(Data const& data, size_t num_rows, size_t num_features,
+                          size_t entry_start, DeviceModel* d_model, size_t num_trees,
+                          common::Span<float const> d_tree_weights,
+                          common::Span<float> d_phis, int num_group) {
+    const uint32_t BLOCK_THREADS = 256;
+    auto GRID_SIZE = static_cast<uint32_t>(
+        common::DivRoundUp(num_rows * num_trees, BLOCK_THREADS));
+    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS} (
+        ApproxShapKernel<Loader, Data>, data, dh::ToSpan(d_model->nodes),
+        dh::ToSpan(d_model->mean_values), d_model->Categories(),
+        dh::ToSpan(d_model->tree_segments), dh::ToSpan(d_model->tree_group), d_tree_weights,
+        d_phis, num_trees, num_features, num_rows, entry_start, num_group);
+  }
+
+  /*!
+   * \brief Approximate contributions use the node means kept with the device model, the
+   *  exact ones the root to leaf paths of the trees.
+   */
+  void DeviceShapInternal(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                          const gbm::GBTreeModel& model, unsigned ntree_limit,
+                          std::vector<bst_float>* tree_weights, bool approximate,
+                          int condition, unsigned condition_feature, bool interactions) {
+    dh::safe_cuda(cudaSetDevice(generic_param_->gpu_id));
+    monitor_.StartCuda("DeviceShapInternal");
+    CHECK_EQ(model.param.size_leaf_vector, 0);
+    uint32_t const num_group = model.learner_model_param_->num_output_group;
+    ntree_limit *= num_group;
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    CHECK(!approximate || !interactions);
+    ShapPaths paths(num_group);
+    std::shared_ptr<DeviceModel> d_model;
+    dh::device_vector<float> d_tree_weights;
+    if (approximate) {
+      d_model = InitModel(model, ntree_limit);
+      if (tree_weights != nullptr) {
+        d_tree_weights.assign(tree_weights->cbegin(), tree_weights->cbegin() + ntree_limit);
+      }
+    } else {
+      for (unsigned i = 0; i < ntree_limit; ++i) {
+        CHECK(!model.trees[i]->HasCategoricalSplit())
+            << "SHAP values of trees with categorical splits are only computed on CPU.";
+        paths.Add(*model.trees[i], model.tree_info[i],
+                  tree_weights == nullptr ? 1.0f : (*tree_weights)[i]);
+      }
+    }
+    dh::device_vector<ShapPathElement> d_elements(paths.elements);
+    dh::device_vector<ShapPath> d_paths(paths.paths);
+    bool const has_work = approximate ? ntree_limit != 0 : !paths.paths.empty();
+
+    size_t const num_features = model.learner_model_param_->num_feature;
+    size_t const ncolumns = num_features + 1;
+    size_t const row_chunk = num_group * (interactions ? ncolumns * ncolumns : ncolumns);
+    size_t const num_rows = dmat->Info().num_row_;
+    dh::device_vector<float> phis(num_rows * row_chunk, 0.0f);
+    if (has_work) {
+      if (dmat->PageExists<EllpackPage>()) {
+        size_t batch_offset = 0;
+        for (auto const& page : dmat->GetBatches<EllpackPage>()) {
+          auto const& matrix = page.Impl()->matrix;
+          auto d_phis = dh::ToSpan(phis).subspan(batch_offset * row_chunk);
+          if (approximate) {
+            this->ApproxShapInternal<EllpackLoader>(
+                matrix, matrix.n_rows, num_features, 0, d_model.get(), ntree_limit,
+                dh::ToSpan(d_tree_weights), d_phis, num_group);
+          } else {
+            this->ShapInternal<EllpackLoader>(
+                matrix, matrix.n_rows, num_features, 0, &d_elements, &d_paths, d_phis,
+                num_group, condition, condition_feature, interactions);
+          }
+          batch_offset += matrix.n_rows;
+        }
+      } else {
+        size_t batch_offset = 0;
+        for (auto& batch : dmat->GetBatches<SparsePage>()) {
+          batch.offset.SetDevice(generic_param_->gpu_id);
+          batch.data.SetDevice(generic_param_->gpu_id);
+          SparsePageView data{batch.data.DeviceSpan(), batch.offset.DeviceSpan()};
+          auto d_phis = dh::ToSpan(phis).subspan(batch_offset * row_chunk);
+          if (approximate) {
+            this->ApproxShapInternal<SparsePageLoader>(
+                data, batch.Size(), num_features, 0, d_model.get(), ntree_limit,
+                dh::ToSpan(d_tree_weights), d_phis, num_group);
+          } else {
+            this->ShapInternal<SparsePageLoader>(
+                data, batch.Size(), num_features, 0, &d_elements, &d_paths, d_phis,
+                num_group, condition, condition_feature, interactions);
+          }
+          batch_offset += batch.Size();
+        }
+      }
+    }
+
+    std::vector<bst_float>& contribs = *out_contribs;
+    contribs.resize(phis.size());
+    dh::safe_cuda(cudaMemcpy(contribs.data(), phis.data().get(),
+                             sizeof(float) * phis.size(), cudaMemcpyDeviceToHost));
+    // add base margin and the expected value of the trees to BIAS
+    auto const& base_margin = dmat->Info().base_margin_.ConstHostVector();
+    size_t const bias_idx = interactions ? (ncolumns - 1) * ncolumns + ncolumns - 1
+                                         : ncolumns - 1;
+    size_t const group_chunk = row_chunk / num_group;
+    for (size_t ridx = 0; ridx < num_rows; ++ridx) {
+      for (uint32_t gid = 0; gid < num_group; ++gid) {
+        float bias = base_margin.size() != 0 ? base_margin[ridx * num_group + gid]
+                                             : model.learner_model_param_->base_score;
+        if (condition == 0) {
+          bias += paths.expected_values[gid];
+        }
+        contribs[(ridx * num_group + gid) * group_chunk + bias_idx] += bias;
+      }
+    }
+    monitor_.StopCuda("DeviceShapInternal");
   }
 
  public:
   explicit GPUPredictor(GenericParameter const* generic_param) :
-      Predictor::Predictor{generic_param} {}
+      Predictor::Predictor{generic_param} {
+    monitor_.Init("gpu_predictor", common::NvtxCategory::kPredict);
+  }
 
   ~GPUPredictor() override {
     if (generic_param_->gpu_id >= 0) {
@@ -344,6 +1123,127 @@ class GPUPredictor : public xgboost::Predictor {
           out_preds->Size() == dmat->Info().num_row_);
   }
 
+  bool InplacePredict(dmlc::any const& x, const gbm::GBTreeModel& model, float missing,
+                      HostDeviceVector<bst_float>* out_preds,
+                      unsigned ntree_limit) override {
+    if (x.type() != typeid(std::shared_ptr<data::CupyAdapter>)) {
+      return false;
+    }
+    auto const& adapter = dmlc::get<std::shared_ptr<data::CupyAdapter>>(x);
+    int device = generic_param_->gpu_id;
+    CHECK_GE(device, 0) << "Set `gpu_id' to positive value for processing GPU data.";
+    CHECK_EQ(static_cast<int>(adapter->DeviceIdx()), device)
+        << "Data is on device " << adapter->DeviceIdx() << ", but `gpu_id' is " << device;
+    CHECK_LE(adapter->NumColumns(), model.learner_model_param_->num_feature)
+        << "Number of columns does not match number of features in booster.";
+    ConfigureDevice(device);
+    uint32_t const output_groups = model.learner_model_param_->num_output_group;
+    size_t tree_end = ntree_limit * output_groups;
+    if (tree_end == 0 || tree_end > model.trees.size()) {
+      tree_end = model.trees.size();
+    }
+    size_t const num_rows = adapter->NumRows();
+    out_preds->SetDevice(device);
+    out_preds->Resize(num_rows * output_groups);
+    out_preds->Fill(model.learner_model_param_->base_score);
+    if (tree_end == 0 || num_rows == 0) {
+      return true;
+    }
+    dh::safe_cuda(cudaSetDevice(device));
+    auto d_model = InitModel(model, tree_end);
+    cudaStream_t stream = ThreadStream(device);
+    WaitDefaultStream(stream);
+    DeviceAdapterView data {adapter->Value(), adapter->NumColumns(), missing};
+    const uint32_t BLOCK_THREADS = 128;
+    auto GRID_SIZE = static_cast<uint32_t>(common::DivRoundUp(num_rows, BLOCK_THREADS));
+    dh::LaunchKernel {GRID_SIZE, BLOCK_THREADS, 0, stream} (
+        PredictKernel<DeviceAdapterLoader, DeviceAdapterView>,
+        data,
+        dh::ToSpan(d_model->nodes), d_model->Categories(), out_preds->DeviceSpan(),
+        dh::ToSpan(d_model->tree_segments), dh::ToSpan(d_model->tree_group),
+        0, tree_end, model.learner_model_param_->num_feature, num_rows, 0, false,
+        static_cast<int>(output_groups));
+    dh::safe_cuda(cudaStreamSynchronize(stream));
+    return true;
+  }
+
+  void PredictWeighted(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, std::vector<size_t> const& trees,
+                       std::vector<bst_float> const& tree_weights) override {
+    int device = generic_param_->gpu_id;
+    CHECK_GE(device, 0) << "Set `gpu_id' to positive value for processing GPU data.";
+    CHECK_EQ(trees.size(), tree_weights.size());
+    ConfigureDevice(device);
+    if (trees.empty()) {
+      return;
+    }
+    CHECK_EQ(out_preds->Size(),
+             dmat->Info().num_row_ * model.learner_model_param_->num_output_group);
+    dh::safe_cuda(cudaSetDevice(device));
+    monitor_.StartCuda("PredictWeighted");
+    auto d_model = InitModel(model, *std::max_element(trees.cbegin(), trees.cend()) + 1);
+    dh::caching_device_vector<size_t> d_trees(trees.size());
+    dh::caching_device_vector<float> d_tree_weights(tree_weights.size());
+    dh::safe_cuda(cudaMemcpyAsync(d_trees.data().get(), trees.data(),
+                                  sizeof(size_t) * trees.size(), cudaMemcpyHostToDevice));
+    dh::safe_cuda(cudaMemcpyAsync(d_tree_weights.data().get(), tree_weights.data(),
+                                  sizeof(float) * tree_weights.size(),
+                                  cudaMemcpyHostToDevice));
+    PredictCall call {d_model.get(), 0, 0, {d_trees.data().get(), d_trees.size()},
+                      {d_tree_weights.data().get(), d_tree_weights.size()},
+                      static_cast<int>(model.learner_model_param_->num_output_group),
+                      ThreadStream(device)};
+    this->PredictPages(dmat, out_preds, model, call);
+    monitor_.StopCuda("PredictWeighted");
+  }
+
+  void PredictStaged(DMatrix* dmat, const gbm::GBTreeModel& model,
+                     std::vector<uint32_t> const& tree_ends,
+                     HostDeviceVector<bst_float>* out_preds) override {
+    int device = generic_param_->gpu_id;
+    CHECK_GE(device, 0) << "Set `gpu_id' to positive value for processing GPU data.";
+    ConfigureDevice(device);
+    uint32_t tree_begin = 0;
+    for (auto tree_end : tree_ends) {
+      CHECK_GE(tree_end, tree_begin) << "Stages must be in increasing order.";
+      CHECK_LE(tree_end, model.trees.size());
+      tree_begin = tree_end;
+    }
+    auto const& info = dmat->Info();
+    size_t const n = info.num_row_ * model.learner_model_param_->num_output_group;
+    // the margin of the trees so far, copied out at the end of each stage
+    HostDeviceVector<bst_float> margin;
+    this->InitOutPredictions(info, &margin, model);
+    out_preds->SetDevice(device);
+    out_preds->Resize(n * tree_ends.size());
+    if (tree_ends.empty() || n == 0) {
+      return;
+    }
+    dh::safe_cuda(cudaSetDevice(device));
+    monitor_.StartCuda("PredictStaged");
+    auto d_model = InitModel(model, tree_ends.back());
+    bst_float* d_out = out_preds->DevicePointer();
+    tree_begin = 0;
+    for (size_t s = 0; s < tree_ends.size(); ++s) {
+      if (tree_ends[s] > tree_begin) {
+        PredictCall call {d_model.get(), tree_begin, tree_ends[s], {}, {},
+                          static_cast<int>(model.learner_model_param_->num_output_group),
+                          ThreadStream(device)};
+        this->PredictPages(dmat, &margin, model, call);
+      }
+      dh::safe_cuda(cudaMemcpy(d_out + s * n, margin.ConstDevicePointer(),
+                               sizeof(bst_float) * n, cudaMemcpyDeviceToDevice));
+      tree_begin = tree_ends[s];
+    }
+    monitor_.StopCuda("PredictStaged");
+  }
+
+  void PredictStream(DMatrix* dmat, const gbm::GBTreeModel& model, uint32_t tree_end,
+                     PredictionSink const& sink) override {
+    LOG(FATAL) << "Streaming prediction is not supported by the GPU predictor, "
+               << "set `predictor' to `cpu_predictor'.";
+  }
+
  protected:
   void InitOutPredictions(const MetaInfo& info,
                           HostDeviceVector<bst_float>* out_preds,
@@ -381,8 +1281,8 @@ class GPUPredictor : public xgboost::Predictor {
                            std::vector<bst_float>* tree_weights,
                            bool approximate, int condition,
                            unsigned condition_feature) override {
-    LOG(FATAL) << "[Internal error]: " << __func__
-               << " is not implemented in GPU Predictor.";
+    this->DeviceShapInternal(p_fmat, out_contribs, model, ntree_limit, tree_weights,
+                             approximate, condition, condition_feature, false);
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat,
@@ -391,8 +1291,25 @@ class GPUPredictor : public xgboost::Predictor {
                                        unsigned ntree_limit,
                                        std::vector<bst_float>* tree_weights,
                                        bool approximate) override {
-    LOG(FATAL) << "[Internal error]: " << __func__
-               << " is not implemented in GPU Predictor.";
+    if (!approximate) {
+      this->DeviceShapInternal(p_fmat, out_contribs, model, ntree_limit, tree_weights,
+                               false, 0, 0, true);
+      return;
+    }
+    // The approximate contributions ignore conditioning, leaving the main effects on the
+    // diagonal.
+    std::vector<bst_float> contribs;
+    this->DeviceShapInternal(p_fmat, &contribs, model, ntree_limit, tree_weights, true, 0,
+                             0, false);
+    size_t const ncolumns = model.learner_model_param_->num_feature + 1;
+    size_t const n = contribs.size() / ncolumns;
+    out_contribs->resize(contribs.size() * ncolumns);
+    std::fill(out_contribs->begin(), out_contribs->end(), 0);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t f = 0; f < ncolumns; ++f) {
+        (*out_contribs)[(i * ncolumns + f) * ncolumns + f] = contribs[i * ncolumns + f];
+      }
+    }
   }
 
   void Configure(const std::vector<std::pair<std::string, std::string>>& cfg) override {
@@ -408,13 +1325,10 @@ class GPUPredictor : public xgboost::Predictor {
   }
 
   common::Monitor monitor_;
-  dh::device_vector<RegTree::Node> nodes_;
-  dh::device_vector<size_t> tree_segments_;
-  dh::device_vector<int> tree_group_;
+  // device copy of the latest model, replaced under `model_lock_'
+  std::shared_ptr<DeviceModel> d_model_;
+  std::mutex model_lock_;
   size_t max_shared_memory_bytes_;
-  size_t tree_begin_;
-  size_t tree_end_;
-  int num_group_;
 };
 
 XGBOOST_REGISTER_PREDICTOR(GPUPredictor, "gpu_predictor")
@@ -4,6 +4,11 @@
 #include <dmlc/registry.h>
 #include <xgboost/predictor.h>
 
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "xgboost/data.h"
 #include "xgboost/generic_parameters.h"
 
@@ -24,13 +29,56 @@ void PredictionContainer::ClearExpiredEntries() {
   }
 }
 
+void PredictionContainer::EvictLeastRecentlyUsed(DMatrix const* keep) {
+  if (max_bytes_ == 0) {
+    return;
+  }
+  size_t total = 0;
+  std::vector<std::pair<uint64_t, DMatrix*>> by_use;
+  for (auto& kv : container_) {
+    total += kv.second.Bytes();
+    by_use.emplace_back(kv.second.last_use, kv.first);
+  }
+  if (total <= max_bytes_) {
+    return;
+  }
+  std::sort(by_use.begin(), by_use.end());
+  for (auto const& use : by_use) {
+    if (total <= max_bytes_) {
+      break;
+    }
+    if (use.second == keep) {
+      continue;
+    }
+    auto& entry = container_.at(use.second);
+    std::unique_lock<std::mutex> guard(entry.lock, std::try_to_lock);
+    if (!guard.owns_lock()) {
+      continue;
+    }
+    total -= entry.Bytes();
+    entry.Reset();
+  }
+}
+
 PredictionCacheEntry &PredictionContainer::Cache(std::shared_ptr<DMatrix> m, int32_t device) {
   this->ClearExpiredEntries();
-  container_[m.get()].ref = m;
+  auto& entry = container_[m.get()];
+  entry.ref = m;
+  entry.last_use = ++clock_;
   if (device != GenericParameter::kCpuId) {
-    container_[m.get()].predictions.SetDevice(device);
+    entry.predictions.SetDevice(device);
+  }
+  this->EvictLeastRecentlyUsed(m.get());
+  return entry;
+}
+
+void PredictionContainer::Release(DMatrix* m) {
+  for (auto& kv : container_) {
+    if (m == nullptr || kv.first == m) {
+      std::lock_guard<std::mutex> guard(kv.second.lock);
+      kv.second.Reset();
+    }
   }
-  return container_[m.get()];
 }
 
 PredictionCacheEntry &PredictionContainer::Entry(DMatrix *m) {
@@ -48,6 +96,17 @@ decltype(PredictionContainer::container_) const& PredictionContainer::Container(
 void Predictor::Configure(
     const std::vector<std::pair<std::string, std::string>>& cfg) {
 }
+void Predictor::PredictRow(const SparsePage::Inst& inst,
+                           common::Span<bst_float> out_preds,
+                           const gbm::GBTreeModel& model,
+                           unsigned ntree_limit) const {
+  LOG(FATAL) << "Single row prediction is not supported by this predictor.";
+}
+bool Predictor::InplacePredict(dmlc::any const& x, const gbm::GBTreeModel& model,
+                               float missing, HostDeviceVector<bst_float>* out_preds,
+                               unsigned ntree_limit) {
+  return false;
+}
 Predictor* Predictor::Create(
     std::string const& name, GenericParameter const* generic_param) {
   auto* e = ::dmlc::Registry<PredictorReg>::Get()->Find(name);
@@ -66,5 +125,7 @@ namespace predictor {
 DMLC_REGISTRY_LINK_TAG(gpu_predictor);
 #endif  // XGBOOST_USE_CUDA
 DMLC_REGISTRY_LINK_TAG(cpu_predictor);
+DMLC_REGISTRY_LINK_TAG(compiled_predictor);
+DMLC_REGISTRY_LINK_TAG(quantized_predictor);
 }  // namespace predictor
 }  // namespace xgboost
@@ -0,0 +1,180 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file quantized_model.cc
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "xgboost/logging.h"
+#include "xgboost/tree_model.h"
+
+#include "quantized_model.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+constexpr uint32_t QuantizedNode::kDefaultLeftBit;
+constexpr uint16_t QuantizedModel::kMissingBin;
+
+uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t const sign = (bits >> 16U) & 0x8000U;
+  uint32_t const exponent = (bits >> 23U) & 0xffU;
+  uint32_t mantissa = bits & 0x7fffffU;
+  if (exponent == 0xffU) {
+    // infinity, or a quiet NaN
+    return static_cast<uint16_t>(sign | 0x7c00U | (mantissa != 0 ? 0x200U : 0U));
+  }
+  int32_t const half_exponent = static_cast<int32_t>(exponent) - 127 + 15;
+  if (half_exponent >= 0x1f) {
+    return static_cast<uint16_t>(sign | 0x7c00U);
+  }
+  uint32_t half;
+  uint32_t shift;
+  if (half_exponent <= 0) {
+    // subnormal half, or zero
+    if (half_exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000U;
+    shift = static_cast<uint32_t>(14 - half_exponent);
+    half = mantissa >> shift;
+  } else {
+    shift = 13;
+    half = (static_cast<uint32_t>(half_exponent) << 10U) | (mantissa >> shift);
+  }
+  // A carry out of the mantissa increments the exponent, up to infinity.
+  uint32_t const rest = mantissa & ((1U << shift) - 1U);
+  uint32_t const halfway = 1U << (shift - 1U);
+  if (rest > halfway || (rest == halfway && (half & 1U) != 0)) {
+    ++half;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+  uint32_t const sign = static_cast<uint32_t>(value & 0x8000U) << 16U;
+  uint32_t const exponent = (value >> 10U) & 0x1fU;
+  uint32_t const mantissa = value & 0x3ffU;
+  uint32_t bits;
+  if (exponent == 0) {
+    float const magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign != 0 ? -magnitude : magnitude;
+  } else if (exponent == 0x1f) {
+    bits = sign | 0x7f800000U | (mantissa << 13U);
+  } else {
+    bits = sign | ((exponent + 112) << 23U) | (mantissa << 13U);
+  }
+  float out;
+  std::memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+QuantizedModel::QuantizedModel(gbm::GBTreeModel const& model)
+    : num_group_{model.learner_model_param_->num_output_group},
+      generation_{model.Generation()}, num_trees_{model.trees.size()} {
+  CHECK_EQ(model.param.size_leaf_vector, 0)
+      << "Trees with vector leaves can not be quantized.";
+  // Collect the distinct split conditions of each feature.
+  auto const num_feature = model.learner_model_param_->num_feature;
+  std::vector<std::vector<bst_float>> conds(num_feature);
+  for (auto const& tree : model.trees) {
+    for (bst_node_t nid = 0; nid < tree->param.num_nodes; ++nid) {
+      auto const& node = (*tree)[nid];
+      if (!node.IsLeaf() && !node.IsDeleted()) {
+        CHECK_LT(node.SplitIndex(), num_feature);
+        CHECK(tree->NodeSplitType(nid) != FeatureType::kCategorical)
+            << "Trees with categorical splits can not be quantized.";
+        conds[node.SplitIndex()].push_back(node.SplitCond());
+      }
+    }
+  }
+  feature_slot_.resize(num_feature, -1);
+  cut_ptr_.push_back(0);
+  for (bst_feature_t fidx = 0; fidx < num_feature; ++fidx) {
+    auto& feature_conds = conds[fidx];
+    if (feature_conds.empty()) {
+      continue;
+    }
+    std::sort(feature_conds.begin(), feature_conds.end());
+    feature_conds.erase(std::unique(feature_conds.begin(), feature_conds.end()),
+                        feature_conds.end());
+    // Bins go up to the number of cuts, one less than the missing bin.
+    CHECK_LT(feature_conds.size(), static_cast<size_t>(kMissingBin))
+        << "Too many distinct split conditions of feature " << fidx << " to quantize.";
+    CHECK_LT(cut_ptr_.size(), static_cast<size_t>(std::numeric_limits<uint16_t>::max()))
+        << "Too many features used by the model to quantize.";
+    feature_slot_[fidx] = static_cast<int32_t>(cut_ptr_.size() - 1);
+    cut_values_.insert(cut_values_.end(), feature_conds.cbegin(), feature_conds.cend());
+    cut_ptr_.push_back(static_cast<uint32_t>(cut_values_.size()));
+  }
+
+  tree_ptr_.push_back(0);
+  for (size_t i = 0; i < model.trees.size(); ++i) {
+    RegTree const& tree = *model.trees[i];
+    size_t const root = nodes_.size();
+    std::vector<bst_node_t> queue(1, 0);
+    nodes_.emplace_back();
+    for (size_t pos = 0; pos < queue.size(); ++pos) {
+      RegTree::Node const& node = tree[queue[pos]];
+      QuantizedNode& quantized = nodes_[root + pos];
+      if (node.IsLeaf()) {
+        quantized.left = 0;
+        quantized.feature = 0;
+        quantized.value = FloatToHalf(node.LeafValue());
+        continue;
+      }
+      CHECK_LT(queue.size(), static_cast<size_t>(QuantizedNode::kDefaultLeftBit));
+      int32_t const slot = feature_slot_[node.SplitIndex()];
+      auto cuts_begin = cut_values_.cbegin() + cut_ptr_[slot];
+      auto cuts_end = cut_values_.cbegin() + cut_ptr_[slot + 1];
+      // x < cuts[j] exactly when fewer than j + 1 cuts are not greater than x.
+      auto it = std::lower_bound(cuts_begin, cuts_end, node.SplitCond());
+      quantized.left = static_cast<uint32_t>(queue.size());
+      if (node.DefaultLeft()) {
+        quantized.left |= QuantizedNode::kDefaultLeftBit;
+      }
+      quantized.feature = static_cast<uint16_t>(slot);
+      quantized.value = static_cast<uint16_t>(it - cuts_begin);
+      queue.push_back(node.LeftChild());
+      queue.push_back(node.RightChild());
+      nodes_.emplace_back();
+      nodes_.emplace_back();
+    }
+    tree_ptr_.push_back(nodes_.size());
+    tree_group_.push_back(static_cast<uint32_t>(model.tree_info[i]));
+  }
+}
+
+size_t QuantizedModel::MemoryCost() const {
+  return nodes_.size() * sizeof(QuantizedNode) + cut_values_.size() * sizeof(bst_float) +
+         cut_ptr_.size() * sizeof(uint32_t);
+}
+
+void QuantizedModel::QuantizeRow(SparsePage::Inst const& inst, uint16_t* bins) const {
+  std::fill(bins, bins + this->NumUsedFeatures(), kMissingBin);
+  for (auto const& entry : inst) {
+    if (entry.index >= feature_slot_.size() || std::isnan(entry.fvalue)) {
+      continue;
+    }
+    int32_t const slot = feature_slot_[entry.index];
+    if (slot < 0) {
+      continue;
+    }
+    auto cuts_begin = cut_values_.cbegin() + cut_ptr_[slot];
+    auto cuts_end = cut_values_.cbegin() + cut_ptr_[slot + 1];
+    bins[slot] = static_cast<uint16_t>(
+        std::upper_bound(cuts_begin, cuts_end, entry.fvalue) - cuts_begin);
+  }
+}
+
+bool QuantizedModel::Matches(gbm::GBTreeModel const& model) const {
+  return generation_ == model.Generation() && num_trees_ == model.trees.size();
+}
+}  // namespace predictor
+}  // namespace xgboost
@@ -0,0 +1,114 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file quantized_model.h
+ * \brief Trees with split conditions replaced by bin indices and leaves stored as half
+ *  precision floats, for predicting with a smaller footprint in cache.
+ */
+#ifndef XGBOOST_PREDICTOR_QUANTIZED_MODEL_H_
+#define XGBOOST_PREDICTOR_QUANTIZED_MODEL_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xgboost/base.h"
+#include "xgboost/data.h"
+
+namespace xgboost {
+namespace gbm {
+struct GBTreeModel;
+}  // namespace gbm
+
+namespace predictor {
+/*! \brief Convert to IEEE half precision, rounding to nearest even. */
+uint16_t FloatToHalf(float value);
+/*! \brief Convert from IEEE half precision, exact. */
+float HalfToFloat(uint16_t value);
+
+/*!
+ * \brief Node of a quantized tree, laid out breadth first like `FlatNode' with the two
+ *  children of a split next to each other.  Nodes are 8 bytes.
+ */
+struct QuantizedNode {
+  static uint32_t constexpr kDefaultLeftBit = 1U << 31U;
+  // position of the left child relative to the tree root with the default direction in
+  // the highest bit, 0 for a leaf
+  uint32_t left;
+  // position of the split feature among the features used by the model
+  uint16_t feature;
+  // rows with a bin not greater than this go left for a split, leaf value in half
+  // precision for a leaf
+  uint16_t value;
+
+  bool IsLeaf() const { return left == 0; }
+  uint32_t LeftChild() const { return left & ~kDefaultLeftBit; }
+  bool DefaultLeft() const { return (left & kDefaultLeftBit) != 0; }
+};
+static_assert(sizeof(QuantizedNode) == 8, "Unexpected size of quantized tree node.");
+
+/*!
+ * \brief Model with the thresholds of each feature stored once as sorted cuts, and the
+ *  splits comparing bin indices instead of feature values.  A row is quantized once, by
+ *  a binary search over the cuts of each of its features, before walking every tree with
+ *  integer comparisons.
+ *
+ *  The cuts are the distinct split conditions of the model, so the decisions are exactly
+ *  those of the trees.  Leaf values are rounded to half precision, which keeps about 3
+ *  significant digits.  A feature present with a NaN value is treated as missing.
+ */
+class QuantizedModel {
+ public:
+  /*! \brief Bin of missing values. */
+  static uint16_t constexpr kMissingBin = std::numeric_limits<uint16_t>::max();
+
+  explicit QuantizedModel(gbm::GBTreeModel const& model);
+
+  /*! \brief Number of features used by the splits, length of a quantized row. */
+  size_t NumUsedFeatures() const { return cut_ptr_.size() - 1; }
+  uint32_t NumGroup() const { return num_group_; }
+  /*! \brief Bytes taken by the trees and the cuts. */
+  size_t MemoryCost() const;
+
+  /*! \brief Bins of a row for each used feature, `kMissingBin' for the missing ones. */
+  void QuantizeRow(SparsePage::Inst const& inst, uint16_t* bins) const;
+  /*! \brief Add the sum of trees [tree_begin, tree_end) of a quantized row to `out'. */
+  void PredictRow(uint16_t const* bins, size_t tree_begin, size_t tree_end,
+                  bst_float* out) const {
+    for (size_t t = tree_begin; t < tree_end; ++t) {
+      QuantizedNode const* root = nodes_.data() + tree_ptr_[t];
+      QuantizedNode const* node = root;
+      while (!node->IsLeaf()) {
+        uint16_t const bin = bins[node->feature];
+        uint32_t offset;
+        if (bin == kMissingBin) {
+          offset = node->DefaultLeft() ? 0 : 1;
+        } else {
+          offset = bin <= node->value ? 0 : 1;
+        }
+        node = root + node->LeftChild() + offset;
+      }
+      out[tree_group_[t]] += HalfToFloat(node->value);
+    }
+  }
+
+  /*! \brief Whether this is built from the current trees of the model. */
+  bool Matches(gbm::GBTreeModel const& model) const;
+
+ private:
+  // position of each feature among the used ones, -1 for the unused
+  std::vector<int32_t> feature_slot_;
+  // sorted cuts of each used feature
+  std::vector<uint32_t> cut_ptr_;
+  std::vector<bst_float> cut_values_;
+
+  std::vector<size_t> tree_ptr_;
+  std::vector<uint32_t> tree_group_;
+  std::vector<QuantizedNode> nodes_;
+
+  uint32_t num_group_ {0};
+  uint64_t generation_ {0};
+  size_t num_trees_ {0};
+};
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_QUANTIZED_MODEL_H_
@@ -0,0 +1,205 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file quantized_predictor.cc
+ * \brief Predictor walking the trees with bin indices, see `QuantizedModel'.
+ */
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "xgboost/predictor.h"
+#include "xgboost/tree_model.h"
+#include "xgboost/logging.h"
+#include "xgboost/host_device_vector.h"
+
+#include "../gbm/gbtree_model.h"
+#include "quantized_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+DMLC_REGISTRY_FILE_TAG(quantized_predictor);
+
+/*!
+ * \brief Predicts with the quantized trees, built on the first prediction and again
+ *  whenever the trees change.  Leaves are rounded to half precision, so predictions differ
+ *  slightly from the CPU predictor.  Leaf indices, contributions and weighted trees are
+ *  left to the CPU predictor.
+ */
+class QuantizedPredictor : public Predictor {
+  std::unique_ptr<Predictor> cpu_predictor_;
+  mutable std::mutex build_lock_;
+  mutable std::shared_ptr<QuantizedModel> quantized_;
+
+  std::shared_ptr<QuantizedModel> GetQuantized(gbm::GBTreeModel const& model) const {
+    std::lock_guard<std::mutex> guard(build_lock_);
+    if (!quantized_ || !quantized_->Matches(model)) {
+      quantized_.reset(new QuantizedModel(model));
+    }
+    return quantized_;
+  }
+
+  static std::vector<uint16_t>& ThreadBins(size_t n) {
+    static thread_local std::vector<uint16_t> bins;
+    bins.resize(n);
+    return bins;
+  }
+
+  void PredInternal(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                    gbm::GBTreeModel const& model, size_t tree_begin,
+                    size_t tree_end) const {
+    auto quantized = this->GetQuantized(model);
+    uint32_t const num_group = quantized->NumGroup();
+    size_t const n_used = quantized->NumUsedFeatures();
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+    for (auto const& batch : p_fmat->GetBatches<SparsePage>()) {
+      auto const nsize = static_cast<omp_ulong>(batch.Size());
+      // Pull to host before entering omp block, as this is not thread safe.
+      batch.data.HostVector();
+      batch.offset.HostVector();
+#pragma omp parallel for schedule(static)
+      for (omp_ulong i = 0; i < nsize; ++i) {  // NOLINT(*)
+        auto& bins = ThreadBins(n_used);
+        quantized->QuantizeRow(batch[i], bins.data());
+        quantized->PredictRow(bins.data(), tree_begin, tree_end,
+                              &preds[(batch.base_rowid + i) * num_group]);
+      }
+    }
+  }
+
+  void InitOutPredictions(MetaInfo const& info, HostDeviceVector<bst_float>* out_preds,
+                          gbm::GBTreeModel const& model) const {
+    size_t const n = model.learner_model_param_->num_output_group * info.num_row_;
+    auto const& base_margin = info.base_margin_.ConstHostVector();
+    out_preds->Resize(n);
+    auto& h_preds = out_preds->HostVector();
+    if (base_margin.size() == n) {
+      std::copy(base_margin.cbegin(), base_margin.cend(), h_preds.begin());
+    } else {
+      if (!base_margin.empty()) {
+        LOG(WARNING) << "Ignoring the base margin, since it has incorrect length.";
+      }
+      std::fill(h_preds.begin(), h_preds.end(), model.learner_model_param_->base_score);
+    }
+  }
+
+ public:
+  explicit QuantizedPredictor(GenericParameter const* generic_param) :
+      Predictor::Predictor{generic_param},
+      cpu_predictor_{Predictor::Create("cpu_predictor", generic_param)} {}
+
+  void Configure(const std::vector<std::pair<std::string, std::string>>& cfg) override {
+    cpu_predictor_->Configure(cfg);
+  }
+
+  void PredictBatch(DMatrix* dmat, PredictionCacheEntry* predts,
+                    const gbm::GBTreeModel& model, int tree_begin,
+                    uint32_t const ntree_limit = 0) override {
+    if (model.param.size_leaf_vector != 0) {
+      cpu_predictor_->PredictBatch(dmat, predts, model, tree_begin, ntree_limit);
+      return;
+    }
+    CHECK_EQ(tree_begin, 0);
+    auto* out_preds = &predts->predictions;
+    if (predts->version == 0) {
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
+    }
+    uint32_t const layer_trees = model.TreesPerLayer();
+    uint32_t real_ntree_limit = ntree_limit * layer_trees;
+    if (real_ntree_limit == 0 || real_ntree_limit > model.trees.size()) {
+      real_ntree_limit = static_cast<uint32_t>(model.trees.size());
+    }
+    uint32_t const end_version = real_ntree_limit / layer_trees;
+    // When users have provided ntree_limit, end_version can be lesser, cache is violated
+    if (predts->version > end_version) {
+      CHECK_NE(ntree_limit, 0);
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
+      predts->version = 0;
+    }
+    uint32_t const beg_version = predts->version;
+    if (beg_version < end_version) {
+      this->PredInternal(dmat, &out_preds->HostVector(), model, beg_version * layer_trees,
+                         end_version * layer_trees);
+    }
+    predts->Update(end_version - beg_version);
+  }
+
+  void PredictWeighted(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, std::vector<size_t> const& trees,
+                       std::vector<bst_float> const& tree_weights) override {
+    cpu_predictor_->PredictWeighted(dmat, out_preds, model, trees, tree_weights);
+  }
+
+  void PredictStaged(DMatrix* dmat, const gbm::GBTreeModel& model,
+                     std::vector<uint32_t> const& tree_ends,
+                     HostDeviceVector<bst_float>* out_preds) override {
+    cpu_predictor_->PredictStaged(dmat, model, tree_ends, out_preds);
+  }
+
+  void PredictStream(DMatrix* dmat, const gbm::GBTreeModel& model, uint32_t tree_end,
+                     PredictionSink const& sink) override {
+    cpu_predictor_->PredictStream(dmat, model, tree_end, sink);
+  }
+
+  void PredictInstance(const SparsePage::Inst& inst, std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    out_preds->resize(model.learner_model_param_->num_output_group);
+    this->PredictRow(inst, common::Span<bst_float>(*out_preds), model, ntree_limit);
+  }
+
+  void PredictRow(const SparsePage::Inst& inst, common::Span<bst_float> out_preds,
+                  const gbm::GBTreeModel& model, unsigned ntree_limit) const override {
+    if (model.param.size_leaf_vector != 0) {
+      cpu_predictor_->PredictRow(inst, out_preds, model, ntree_limit);
+      return;
+    }
+    uint32_t const num_group = model.learner_model_param_->num_output_group;
+    CHECK_GE(out_preds.size(), num_group);
+    std::fill(out_preds.begin(), out_preds.begin() + num_group,
+              model.learner_model_param_->base_score);
+    size_t n_trees = ntree_limit * model.TreesPerLayer();
+    if (n_trees == 0 || n_trees > model.trees.size()) {
+      n_trees = model.trees.size();
+    }
+    if (n_trees != 0) {
+      auto quantized = this->GetQuantized(model);
+      auto& bins = ThreadBins(quantized->NumUsedFeatures());
+      quantized->QuantizeRow(inst, bins.data());
+      quantized->PredictRow(bins.data(), 0, n_trees, out_preds.data());
+    }
+  }
+
+  void PredictLeaf(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                   const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    cpu_predictor_->PredictLeaf(dmat, out_preds, model, ntree_limit);
+  }
+
+  void PredictContribution(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                           const gbm::GBTreeModel& model, uint32_t ntree_limit,
+                           std::vector<bst_float>* tree_weights, bool approximate,
+                           int condition, unsigned condition_feature) override {
+    cpu_predictor_->PredictContribution(dmat, out_contribs, model, ntree_limit,
+                                        tree_weights, approximate, condition,
+                                        condition_feature);
+  }
+
+  void PredictInteractionContributions(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                                       const gbm::GBTreeModel& model, unsigned ntree_limit,
+                                       std::vector<bst_float>* tree_weights,
+                                       bool approximate) override {
+    cpu_predictor_->PredictInteractionContributions(dmat, out_contribs, model, ntree_limit,
+                                                    tree_weights, approximate);
+  }
+};
+
+XGBOOST_REGISTER_PREDICTOR(QuantizedPredictor, "quantized_predictor")
+.describe("Make predictions using trees with quantized splits and half precision leaves.")
+.set_body([](GenericParameter const* generic_param) {
+            return new QuantizedPredictor(generic_param);
+          });
+}  // namespace predictor
+}  // namespace xgboost
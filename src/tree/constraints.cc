@@ -2,7 +2,6 @@
  * Copyright 2018-2019 by Contributors
  */
 #include <algorithm>
-#include <unordered_set>
 #include <vector>
 
 #include "xgboost/span.h"
@@ -31,7 +30,7 @@ void FeatureInteractionConstraintHost::Reset() {
   std::istringstream iss(this->interaction_constraint_str_);
   dmlc::JSONReader reader(&iss);
   // Read std::vector<std::vector<bst_uint>> first and then
-  //   convert to std::vector<std::unordered_set<bst_uint>>
+  //   convert to bit fields
   std::vector<std::vector<bst_uint>> tmp;
   try {
     reader.Read(&tmp);
@@ -40,66 +39,77 @@ void FeatureInteractionConstraintHost::Reset() {
                << this->interaction_constraint_str_ << "\n"
                << "With error:\n" << e.what();
   }
-  for (const auto& e : tmp) {
-    interaction_constraints_.emplace_back(e.begin(), e.end());
+  n_words_ = BitField::ComputeStorageSize(n_features_);
+  interaction_constraints_storage_.assign(tmp.size() * n_words_, 0);
+  MakeViews(&interaction_constraints_storage_, n_words_, &interaction_constraints_);
+  for (size_t i = 0; i < tmp.size(); ++i) {
+    for (auto fid : tmp[i]) {
+      // features out of range are never used for a split
+      if (fid < n_features_) {
+        interaction_constraints_[i].Set(fid);
+      }
+    }
   }
 
-  // Initialise interaction constraints record with all variables permitted for the first node
-  node_constraints_.clear();
-  node_constraints_.resize(1, std::unordered_set<bst_feature_t>());
-  node_constraints_[0].reserve(n_features_);
+  // Initialise interaction constraints record with all variables permitted for the first
+  // node, and an empty splits record.
+  node_constraints_storage_.clear();
+  splits_storage_.clear();
+  this->ResizeNodes(1);
   for (bst_feature_t i = 0; i < n_features_; ++i) {
-    node_constraints_[0].insert(i);
+    node_constraints_[0].Set(i);
   }
+}
 
-  // Initialise splits record
-  splits_.clear();
-  splits_.resize(1, std::unordered_set<bst_feature_t>());
+void FeatureInteractionConstraintHost::ResizeNodes(size_t n_nodes) {
+  // new nodes start with no feature permitted
+  node_constraints_storage_.resize(n_nodes * n_words_, 0);
+  splits_storage_.resize(n_nodes * n_words_, 0);
+  MakeViews(&node_constraints_storage_, n_words_, &node_constraints_);
+  MakeViews(&splits_storage_, n_words_, &splits_);
 }
 
 void FeatureInteractionConstraintHost::SplitImpl(
     bst_node_t node_id, bst_feature_t feature_id, bst_node_t left_id, bst_node_t right_id) {
   bst_node_t newsize = std::max(left_id, right_id) + 1;
+  CHECK_NE(newsize, 0);
+  if (static_cast<size_t>(newsize) > node_constraints_.size()) {
+    this->ResizeNodes(newsize);
+  }
 
   // Record previous splits for child nodes
-  auto feature_splits = splits_[node_id];  // fid history of current node
-  feature_splits.insert(feature_id);  // add feature of current node
-  splits_.resize(newsize);
-  splits_[left_id] = feature_splits;
-  splits_[right_id] = feature_splits;
-
-  // Resize constraints record, initialise all features to be not permitted for new nodes
-  CHECK_NE(newsize, 0);
-  node_constraints_.resize(newsize, std::unordered_set<bst_feature_t>());
+  auto feature_splits = splits_[left_id];
+  std::copy(splits_[node_id].bits_.cbegin(), splits_[node_id].bits_.cend(),
+            feature_splits.bits_.begin());  // fid history of current node
+  feature_splits.Set(feature_id);  // add feature of current node
 
   // Permit features used in previous splits
-  for (bst_feature_t fid : feature_splits) {
-    node_constraints_[left_id].insert(fid);
-    node_constraints_[right_id].insert(fid);
-  }
+  auto permitted = node_constraints_[left_id];
+  std::copy(feature_splits.bits_.cbegin(), feature_splits.bits_.cend(),
+            permitted.bits_.begin());
 
   // Loop across specified interactions in constraints
-  for (const auto &constraint : interaction_constraints_) {
-    // flags whether the specified interaction is still relevant
-    bst_uint flag = 1;
-
+  for (auto const& constraint : interaction_constraints_) {
     // Test relevance of specified interaction by checking all previous
     // features are included
-    for (bst_uint checkvar : feature_splits) {
-      if (constraint.count(checkvar) == 0) {
-        flag = 0;
+    bool relevant = true;
+    for (size_t i = 0; i < n_words_; ++i) {
+      if ((feature_splits.bits_[i] & ~constraint.bits_[i]) != 0) {
+        relevant = false;
         break;   // interaction is not relevant due to unmet constraint
       }
     }
-
     // If interaction is still relevant, permit all other features in the
     // interaction
-    if (flag == 1) {
-      for (bst_uint k : constraint) {
-        node_constraints_[left_id].insert(k);
-        node_constraints_[right_id].insert(k);
-      }
+    if (relevant) {
+      permitted |= constraint;
     }
   }
+
+  // both children share the records
+  std::copy(feature_splits.bits_.cbegin(), feature_splits.bits_.cend(),
+            splits_[right_id].bits_.begin());
+  std::copy(permitted.bits_.cbegin(), permitted.bits_.cend(),
+            node_constraints_[right_id].bits_.begin());
 }
 }  // namespace xgboost
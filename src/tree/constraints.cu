@@ -253,6 +253,14 @@ common::Span<bst_feature_t> FeatureInteractionConstraint::Query(
   return result;
 }
 
+LBitField64 FeatureInteractionConstraint::NodeConstraints(bst_node_t nid) const {
+  if (!has_constraint_ || nid == 0) {
+    return LBitField64{};
+  }
+  CHECK_LT(nid, s_node_constraints_.size());
+  return s_node_constraints_[nid];
+}
+
 // Find interaction sets for each feature, then store all features in
 // those sets in a buffer.
 __global__ void RestoreFeatureListFromSetsKernel(
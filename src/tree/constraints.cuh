@@ -160,6 +160,12 @@ struct FeatureInteractionConstraint {
    * node.
    */
   common::Span<bst_feature_t> Query(common::Span<bst_feature_t> feature_list, int32_t nid);
+  /*!
+   * \brief Return the device bitfield of features allowed in node `nid'.  The bitfield is
+   *        empty when every feature is allowed, which is the case for the root and when
+   *        no constraint is specified.  It's updated asynchronously by `Split'.
+   */
+  LBitField64 NodeConstraints(bst_node_t nid) const;
   /*! \brief Apply split for node_id. */
   void Split(bst_node_t node_id, bst_feature_t feature_id, bst_node_t left_id, bst_node_t right_id);
 };
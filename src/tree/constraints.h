@@ -5,13 +5,13 @@
 #define XGBOOST_TREE_CONSTRAINTS_H_
 
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "xgboost/span.h"
 #include "xgboost/base.h"
 
 #include "param.h"
+#include "../common/bitfield.h"
 
 namespace xgboost {
 /*!
@@ -21,24 +21,41 @@ namespace xgboost {
  */
 class FeatureInteractionConstraintHost {
  protected:
+  using BitField = LBitField64;
+  using Storage = BitField::value_type;
+  // Each set of features below is a dense bit field of `n_words_' words, the bit
+  // fields of the same kind are pooled in one storage vector.
+
   // interaction_constraints_[constraint_id] contains a single interaction
   //   constraint, which specifies a group of feature IDs that can interact
   //   with each other
-  std::vector< std::unordered_set<bst_feature_t> > interaction_constraints_;
-  // int_cont_[nid] contains the set of all feature IDs that are allowed to
+  std::vector<Storage> interaction_constraints_storage_;
+  std::vector<BitField> interaction_constraints_;
+  // node_constraints_[nid] contains the set of all feature IDs that are allowed to
   //   be used for a split at node nid
-  std::vector< std::unordered_set<bst_feature_t> > node_constraints_;
+  std::vector<Storage> node_constraints_storage_;
+  std::vector<BitField> node_constraints_;
   // splits_[nid] contains the set of all feature IDs that have been used for
   //   splits in node nid and its parents
-  std::vector< std::unordered_set<bst_feature_t> > splits_;
+  std::vector<Storage> splits_storage_;
+  std::vector<BitField> splits_;
+  size_t n_words_ {0};
 
-  std::vector<bst_feature_t> return_buffer;
   // string passed by user.
   std::string interaction_constraint_str_;
   // number of features in DMatrix/Booster
   bst_feature_t n_features_;
   bool enabled_{false};
 
+  static void MakeViews(std::vector<Storage>* storage, size_t n_words,
+                        std::vector<BitField>* views) {
+    size_t const n = n_words == 0 ? 0 : storage->size() / n_words;
+    views->resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      (*views)[i] = BitField{common::Span<Storage>{storage->data() + i * n_words, n_words}};
+    }
+  }
+  void ResizeNodes(size_t n_nodes);
   void SplitImpl(int32_t node_id, bst_feature_t feature_id, bst_node_t left_id,
                  bst_node_t right_id);
 
@@ -55,7 +72,7 @@ class FeatureInteractionConstraintHost {
 
   bool Query(bst_node_t nid, bst_feature_t fid) const {
     if (!enabled_) { return true; }
-    return node_constraints_.at(nid).find(fid) != node_constraints_.at(nid).cend();
+    return fid < n_features_ && node_constraints_.at(nid).Check(fid);
   }
 
   void Reset();
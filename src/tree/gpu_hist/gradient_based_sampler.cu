@@ -1,6 +1,7 @@
 /*!
  * Copyright 2019 by XGBoost Contributors
  */
+#include <thrust/copy.h>
 #include <thrust/functional.h>
 #include <thrust/random.h>
 #include <thrust/transform.h>
@@ -143,10 +144,21 @@ class PoissonSampling : public thrust::binary_function<GradientPair, size_t, Gra
   CombineGradientPair combine_;
 };
 
+common::Span<const bst_uint> SampledRows(common::Span<GradientPair> gpair,
+                                         dh::caching_device_vector<bst_uint>* rows) {
+  rows->resize(gpair.size());
+  auto end = thrust::copy_if(thrust::counting_iterator<bst_uint>(0),
+                             thrust::counting_iterator<bst_uint>(gpair.size()),
+                             dh::tbegin(gpair), rows->begin(), IsNonZero());
+  size_t n_sampled = thrust::distance(rows->begin(), end);
+  return {rows->data().get(), n_sampled};
+}
+
 NoSampling::NoSampling(EllpackPageImpl* page) : page_(page) {}
 
 GradientBasedSample NoSampling::Sample(common::Span<GradientPair> gpair, DMatrix* dmat) {
-  return {dmat->Info().num_row_, page_, gpair};
+  // The page may hold only a shard of the rows when training on several GPUs.
+  return {page_->matrix.n_rows, page_, gpair};
 }
 
 ExternalMemoryNoSampling::ExternalMemoryNoSampling(EllpackPageImpl* page,
@@ -179,7 +191,8 @@ GradientBasedSample UniformSampling::Sample(common::Span<GradientPair> gpair, DM
                      thrust::counting_iterator<size_t>(0),
                      BernoulliTrial(common::GlobalRandom()(), subsample_),
                      GradientPair());
-  return {dmat->Info().num_row_, page_, gpair};
+  auto rows = SampledRows(gpair, &rows_);
+  return {rows.size(), page_, gpair, rows};
 }
 
 ExternalMemoryUniformSampling::ExternalMemoryUniformSampling(EllpackPageImpl* page,
@@ -252,7 +265,8 @@ GradientBasedSample GradientBasedSampling::Sample(common::Span<GradientPair> gpa
                     PoissonSampling(threshold_,
                                     threshold_index,
                                     RandomWeight(common::GlobalRandom()())));
-  return {n_rows, page_, gpair};
+  auto rows = SampledRows(gpair, &rows_);
+  return {rows.size(), page_, gpair, rows};
 }
 
 ExternalMemoryGradientBasedSampling::ExternalMemoryGradientBasedSampling(
@@ -316,7 +330,7 @@ GradientBasedSampler::GradientBasedSampler(EllpackPageImpl* page,
                                            const BatchParam& batch_param,
                                            float subsample,
                                            int sampling_method) {
-  monitor_.Init("gradient_based_sampler");
+  monitor_.Init("gradient_based_sampler", common::NvtxCategory::kTree);
 
   bool is_sampling = subsample < 1.0;
   bool is_external_memory = page->matrix.n_rows != n_rows;
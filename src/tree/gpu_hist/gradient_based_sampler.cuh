@@ -19,8 +19,17 @@ struct GradientBasedSample {
   EllpackPageImpl* page;
   /*!\brief Gradient pairs for the sampled rows. */
   common::Span<GradientPair> gpair;
+  /*!
+   * \brief Indexes of the sampled rows in `page`, empty when every row of the page is used.
+   *        Unsampled rows keep zero gradients in `gpair`, so the page is not compacted.
+   */
+  common::Span<const bst_uint> rows;
 };
 
+/*! \brief Collect the indexes of rows with non-zero gradient pairs into `rows`. */
+common::Span<const bst_uint> SampledRows(common::Span<GradientPair> gpair,
+                                         dh::caching_device_vector<bst_uint>* rows);
+
 class SamplingStrategy {
  public:
   /*! \brief Sample from a DMatrix based on the given gradient pairs. */
@@ -60,6 +69,7 @@ class UniformSampling : public SamplingStrategy {
  private:
   EllpackPageImpl* page_;
   float subsample_;
+  dh::caching_device_vector<bst_uint> rows_;
 };
 
 /*! \brief No sampling in external memory mode. */
@@ -96,6 +106,7 @@ class GradientBasedSampling : public SamplingStrategy {
   dh::BulkAllocator ba_;
   common::Span<float> threshold_;
   common::Span<float> grad_sum_;
+  dh::caching_device_vector<bst_uint> rows_;
 };
 
 /*! \brief Gradient-based sampling in external memory mode.. */
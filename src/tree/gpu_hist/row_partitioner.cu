@@ -1,6 +1,7 @@
 /*!
  * Copyright 2017-2019 XGBoost contributors
  */
+#include <thrust/copy.h>
 #include <thrust/sequence.h>
 #include <vector>
 #include "../../common/device_helpers.cuh"
@@ -88,6 +89,13 @@ RowPartitioner::RowPartitioner(int device_idx, size_t num_rows)
     dh::safe_cuda(cudaStreamCreate(&stream));
   }
 }
+RowPartitioner::RowPartitioner(int device_idx,
+                               common::Span<const RowIndexT> rows)
+    : RowPartitioner(device_idx, rows.size()) {
+  thrust::copy(thrust::device_pointer_cast(rows.data()),
+               thrust::device_pointer_cast(rows.data() + rows.size()),
+               thrust::device_pointer_cast(ridx.CurrentSpan().data()));
+}
 RowPartitioner::~RowPartitioner() {
   dh::safe_cuda(cudaSetDevice(device_idx));
   for (auto& stream : streams) {
@@ -103,16 +111,54 @@ common::Span<const RowPartitioner::RowIndexT> RowPartitioner::GetRows(
   if (segment.Size() == 0) {
     return common::Span<const RowPartitioner::RowIndexT>();
   }
-  return ridx.CurrentSpan().subspan(segment.begin, segment.Size());
+  return common::Span<const RowIndexT>(RidxBuffer(segment.buffer) + segment.begin,
+                                       segment.Size());
 }
 
 common::Span<const RowPartitioner::RowIndexT> RowPartitioner::GetRows() {
+  this->GatherSegments();
   return ridx.CurrentSpan();
 }
 
 common::Span<const bst_node_t> RowPartitioner::GetPosition() {
+  this->GatherSegments();
   return position.CurrentSpan();
 }
+
+void RowPartitioner::GatherSegments() {
+  // Nodes not split yet cover all rows exactly once.
+  std::vector<size_t> h_offsets {0};
+  std::vector<size_t> h_begins;
+  for (auto& segment : ridx_segments) {
+    if (segment.partitioned || segment.buffer == 0) {
+      continue;
+    }
+    if (segment.Size() != 0) {
+      h_begins.push_back(segment.begin);
+      h_offsets.push_back(h_offsets.back() + segment.Size());
+    }
+    segment.buffer = 0;
+  }
+  if (h_begins.empty()) {
+    return;
+  }
+  dh::safe_cuda(cudaSetDevice(device_idx));
+  dh::caching_device_vector<size_t> offsets(h_offsets);
+  dh::caching_device_vector<size_t> begins(h_begins);
+  auto d_offsets = offsets.data().get();
+  auto d_begins = begins.data().get();
+  auto n_segments = static_cast<uint32_t>(h_begins.size());
+  auto d_position_current = position.Current();
+  auto d_position_other = position.other();
+  auto d_ridx_current = ridx.Current();
+  auto d_ridx_other = ridx.other();
+  dh::LaunchN(device_idx, h_offsets.back(), [=] __device__(size_t idx) {
+    uint32_t segment = dh::UpperBound(d_offsets, n_segments + 1, idx) - 1;
+    size_t ridx_idx = d_begins[segment] + (idx - d_offsets[segment]);
+    d_position_current[ridx_idx] = d_position_other[ridx_idx];
+    d_ridx_current[ridx_idx] = d_ridx_other[ridx_idx];
+  });
+}
 std::vector<RowPartitioner::RowIndexT> RowPartitioner::GetRowsHost(
     bst_node_t nidx) {
   auto span = GetRows(nidx);
@@ -133,27 +179,83 @@ void RowPartitioner::SortPositionAndCopy(const Segment& segment,
                                          bst_node_t right_nidx,
                                          int64_t* d_left_count,
                                          cudaStream_t stream) {
+  int const other = 1 - segment.buffer;
   SortPosition(
       // position_in
-      common::Span<bst_node_t>(position.Current() + segment.begin,
+      common::Span<bst_node_t>(PositionBuffer(segment.buffer) + segment.begin,
                                   segment.Size()),
       // position_out
-      common::Span<bst_node_t>(position.other() + segment.begin,
+      common::Span<bst_node_t>(PositionBuffer(other) + segment.begin,
                                   segment.Size()),
       // row index in
-      common::Span<RowIndexT>(ridx.Current() + segment.begin, segment.Size()),
+      common::Span<RowIndexT>(RidxBuffer(segment.buffer) + segment.begin, segment.Size()),
       // row index out
-      common::Span<RowIndexT>(ridx.other() + segment.begin, segment.Size()),
+      common::Span<RowIndexT>(RidxBuffer(other) + segment.begin, segment.Size()),
       left_nidx, right_nidx, d_left_count, stream);
   // Copy back key/value
-  const auto d_position_current = position.Current() + segment.begin;
-  const auto d_position_other = position.other() + segment.begin;
-  const auto d_ridx_current = ridx.Current() + segment.begin;
-  const auto d_ridx_other = ridx.other() + segment.begin;
+  const auto d_position_current = PositionBuffer(segment.buffer) + segment.begin;
+  const auto d_position_other = PositionBuffer(other) + segment.begin;
+  const auto d_ridx_current = RidxBuffer(segment.buffer) + segment.begin;
+  const auto d_ridx_other = RidxBuffer(other) + segment.begin;
   dh::LaunchN(device_idx, segment.Size(), stream, [=] __device__(size_t idx) {
     d_position_current[idx] = d_position_other[idx];
     d_ridx_current[idx] = d_ridx_other[idx];
   });
 }
+
+std::vector<int64_t> RowPartitioner::SortPositionBatch(
+    common::Span<size_t> offsets, common::Span<size_t> begins,
+    common::Span<int> buffers, common::Span<int64_t> is_left, uint32_t n_nodes) {
+  CHECK_EQ(offsets.size(), n_nodes + 1);
+  size_t total = is_left.size() - 1;
+  // Number of left rows before each flattened element.  The scan of the
+  // trailing zero is the total number of left rows.
+  dh::caching_device_vector<int64_t> scan(is_left.size());
+  auto d_scan = scan.data().get();
+  size_t temp_storage_bytes = 0;
+  cub::DeviceScan::ExclusiveSum(nullptr, temp_storage_bytes, is_left.data(),
+                                d_scan, is_left.size());
+  dh::caching_device_vector<uint8_t> temp_storage(temp_storage_bytes);
+  cub::DeviceScan::ExclusiveSum(temp_storage.data().get(), temp_storage_bytes,
+                                is_left.data(), d_scan, is_left.size());
+
+  dh::caching_device_vector<int64_t> left_counts_batch(n_nodes);
+  auto d_left_counts = left_counts_batch.data().get();
+  auto d_offsets = offsets.data();
+  auto d_begins = begins.data();
+  dh::LaunchN(device_idx, n_nodes, [=] __device__(size_t node) {
+    d_left_counts[node] = d_scan[d_offsets[node + 1]] - d_scan[d_offsets[node]];
+  });
+
+  // Scatter every node's rows into its left and right halves in the other
+  // buffer, same as `SortPosition` but with the scan restarted at each segment.
+  auto d_buffers = buffers.data();
+  auto d_position_a = position.Current();
+  auto d_position_b = position.other();
+  auto d_ridx_a = ridx.Current();
+  auto d_ridx_b = ridx.other();
+  dh::LaunchN(device_idx, total, [=] __device__(size_t idx) {
+    uint32_t node = dh::UpperBound(d_offsets, n_nodes + 1, idx) - 1;
+    bool const in_a = d_buffers[node] == 0;
+    auto d_position_in = in_a ? d_position_a : d_position_b;
+    auto d_position_out = in_a ? d_position_b : d_position_a;
+    auto d_ridx_in = in_a ? d_ridx_a : d_ridx_b;
+    auto d_ridx_out = in_a ? d_ridx_b : d_ridx_a;
+    size_t local_idx = idx - d_offsets[node];
+    int64_t left_before = d_scan[idx] - d_scan[d_offsets[node]];
+    bool left = d_scan[idx + 1] != d_scan[idx];
+    size_t scatter_address = left ? left_before
+                                  : local_idx - left_before + d_left_counts[node];
+    d_position_out[d_begins[node] + scatter_address] =
+        d_position_in[d_begins[node] + local_idx];
+    d_ridx_out[d_begins[node] + scatter_address] =
+        d_ridx_in[d_begins[node] + local_idx];
+  });
+
+  std::vector<int64_t> left_count(n_nodes);
+  dh::safe_cuda(cudaMemcpy(left_count.data(), d_left_counts,
+                           n_nodes * sizeof(int64_t), cudaMemcpyDeviceToHost));
+  return left_count;
+}
 };  // namespace tree
 };  // namespace xgboost
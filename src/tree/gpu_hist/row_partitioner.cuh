@@ -2,6 +2,8 @@
  * Copyright 2017-2019 XGBoost contributors
  */
 #pragma once
+#include <algorithm>
+#include <vector>
 #include "xgboost/base.h"
 #include "../../common/device_helpers.cuh"
 
@@ -44,7 +46,9 @@ class RowPartitioner {
    *
    * node id -> segment -> indices of rows belonging to node
    */
-  /*! \brief Range of row index for each node, pointers into ridx below. */
+  /*! \brief Range of row index for each node, pointers into ridx below.  Rows of a
+   * node are held by one of the two buffers of ridx and position, see `Segment::buffer`.
+   */
   std::vector<Segment> ridx_segments;
   dh::caching_device_vector<RowIndexT> ridx_a;
   dh::caching_device_vector<RowIndexT> ridx_b;
@@ -62,14 +66,30 @@ class RowPartitioner {
       left_counts;  // Useful to keep a bunch of zeroed memory for sort position
   std::vector<cudaStream_t> streams;
 
+  /*! \brief Row indices held by `buffer`, 0 for the current one of ridx. */
+  RowIndexT* RidxBuffer(int buffer) {
+    return buffer == 0 ? ridx.Current() : ridx.other();
+  }
+  /*! \brief Positions held by `buffer`, 0 for the current one of position. */
+  bst_node_t* PositionBuffer(int buffer) {
+    return buffer == 0 ? position.Current() : position.other();
+  }
+  /*! \brief Copy the rows of nodes held by the alternate buffers into the current ones,
+   * so that the whole of ridx and position can be read. */
+  void GatherSegments();
+
  public:
   RowPartitioner(int device_idx, size_t num_rows);
+  /*! \brief Partition only the given subset of rows, e.g. the rows kept by sampling. */
+  RowPartitioner(int device_idx, common::Span<const RowIndexT> rows);
   ~RowPartitioner();
   RowPartitioner(const RowPartitioner&) = delete;
   RowPartitioner& operator=(const RowPartitioner&) = delete;
 
   /**
-   * \brief Gets the row indices of training instances in a given node.
+   * \brief Gets the row indices of training instances in a given node.  Nodes already
+   * split by `UpdatePositionBatch` hold no rows of their own, their rows are those
+   * of the children.
    */
   common::Span<const RowIndexT> GetRows(bst_node_t nidx);
 
@@ -79,7 +99,8 @@ class RowPartitioner {
   common::Span<const RowIndexT> GetRows();
 
   /**
-   * \brief Gets the tree position of all training instances.
+   * \brief Gets the tree position of all training instances, in the same order as
+   * `GetRows()`.
    */
   common::Span<const bst_node_t> GetPosition();
 
@@ -110,8 +131,8 @@ class RowPartitioner {
                       bst_node_t right_nidx, UpdatePositionOpT op) {
     dh::safe_cuda(cudaSetDevice(device_idx));
     Segment segment = ridx_segments.at(nidx);  // rows belongs to node nidx
-    auto d_ridx = ridx.CurrentSpan();
-    auto d_position = position.CurrentSpan();
+    auto d_ridx = common::Span<RowIndexT>(RidxBuffer(segment.buffer), ridx.Size());
+    auto d_position = common::Span<bst_node_t>(PositionBuffer(segment.buffer), ridx.Size());
     if (left_counts.size() <= nidx) {
       left_counts.resize((nidx * 2) + 1);
       thrust::fill(left_counts.begin(), left_counts.end(), 0);
@@ -142,10 +163,105 @@ class RowPartitioner {
     CHECK_GE(left_count, 0);
     ridx_segments.resize(std::max(int(ridx_segments.size()),
                                   std::max(left_nidx, right_nidx) + 1));
+    ridx_segments[nidx].partitioned = true;
     ridx_segments[left_nidx] =
-        Segment(segment.begin, segment.begin + left_count);
+        Segment(segment.begin, segment.begin + left_count, segment.buffer);
     ridx_segments[right_nidx] =
-        Segment(segment.begin + left_count, segment.end);
+        Segment(segment.begin + left_count, segment.end, segment.buffer);
+  }
+
+  /**
+   * \brief Updates the tree position for the training instances of several
+   * nodes at once.  Segments of all nodes are flattened into a single index
+   * space so that partitioning and sorting take a fixed number of kernel
+   * launches and one device to host copy, regardless of the number of nodes.
+   * The rows of the children are left in the buffer the node's rows are not
+   * in, instead of being copied back.
+   *
+   * \tparam  UpdatePositionOpT
+   * \param nidx        Indices of the nodes being split, must be distinct.
+   * \param left_nidx   The left child index of each node.
+   * \param right_nidx  The right child index of each node.
+   * \param op          Device lambda. Should provide the row index and the
+   * position of the node inside `nidx` as arguments and return the new
+   * position for this training instance.
+   */
+  template <typename UpdatePositionOpT>
+  void UpdatePositionBatch(std::vector<bst_node_t> const& nidx,
+                           std::vector<bst_node_t> const& left_nidx,
+                           std::vector<bst_node_t> const& right_nidx,
+                           UpdatePositionOpT op) {
+    CHECK_EQ(nidx.size(), left_nidx.size());
+    CHECK_EQ(nidx.size(), right_nidx.size());
+    if (nidx.empty()) {
+      return;
+    }
+    dh::safe_cuda(cudaSetDevice(device_idx));
+    // Offset of every node in the flattened index space, plus the total.
+    std::vector<size_t> h_offsets(nidx.size() + 1, 0);
+    std::vector<size_t> h_begins(nidx.size());
+    std::vector<int> h_buffers(nidx.size());
+    for (size_t i = 0; i < nidx.size(); ++i) {
+      Segment segment = ridx_segments.at(nidx[i]);
+      h_begins[i] = segment.begin;
+      h_buffers[i] = segment.buffer;
+      h_offsets[i + 1] = h_offsets[i] + segment.Size();
+    }
+    size_t total = h_offsets.back();
+    dh::caching_device_vector<size_t> offsets(h_offsets);
+    dh::caching_device_vector<size_t> begins(h_begins);
+    dh::caching_device_vector<int> buffers(h_buffers);
+    dh::caching_device_vector<bst_node_t> lefts(left_nidx);
+    dh::caching_device_vector<bst_node_t> rights(right_nidx);
+    // One extra zero at the end so the scan also yields the total per node.
+    dh::caching_device_vector<int64_t> is_left(total + 1, 0);
+
+    auto d_offsets = offsets.data().get();
+    auto d_begins = begins.data().get();
+    auto d_buffers = buffers.data().get();
+    auto d_lefts = lefts.data().get();
+    auto d_rights = rights.data().get();
+    auto d_is_left = is_left.data().get();
+    auto d_ridx_a = ridx.Current();
+    auto d_ridx_b = ridx.other();
+    auto d_position_a = position.Current();
+    auto d_position_b = position.other();
+    uint32_t n_nodes = static_cast<uint32_t>(nidx.size());
+    dh::LaunchN<1, 128>(device_idx, total, [=] __device__(size_t idx) {
+      // Find the node owning this element, empty segments are skipped as
+      // they share the offset of the next node.
+      uint32_t node = dh::UpperBound(d_offsets, n_nodes + 1, idx) - 1;
+      size_t ridx_idx = d_begins[node] + (idx - d_offsets[node]);
+      auto d_ridx = d_buffers[node] == 0 ? d_ridx_a : d_ridx_b;
+      auto d_position = d_buffers[node] == 0 ? d_position_a : d_position_b;
+      RowIndexT ridx = d_ridx[ridx_idx];
+      bst_node_t new_position = op(ridx, node);  // new node id
+      KERNEL_CHECK(new_position == d_lefts[node] || new_position == d_rights[node]);
+      d_is_left[idx] = new_position == d_lefts[node];
+      d_position[ridx_idx] = new_position;
+    });
+
+    std::vector<int64_t> left_count = SortPositionBatch(
+        common::Span<size_t>(d_offsets, offsets.size()),
+        common::Span<size_t>(d_begins, begins.size()),
+        common::Span<int>(d_buffers, buffers.size()),
+        common::Span<int64_t>(d_is_left, is_left.size()), n_nodes);
+
+    bst_node_t max_nidx = std::max(
+        *std::max_element(left_nidx.cbegin(), left_nidx.cend()),
+        *std::max_element(right_nidx.cbegin(), right_nidx.cend()));
+    ridx_segments.resize(std::max(static_cast<bst_node_t>(ridx_segments.size()),
+                                  max_nidx + 1));
+    for (size_t i = 0; i < nidx.size(); ++i) {
+      size_t begin = h_begins[i];
+      size_t end = h_begins[i] + (h_offsets[i + 1] - h_offsets[i]);
+      CHECK_LE(left_count[i], end - begin);
+      CHECK_GE(left_count[i], 0);
+      int const buffer = 1 - h_buffers[i];
+      ridx_segments[nidx[i]].partitioned = true;
+      ridx_segments[left_nidx[i]] = Segment(begin, begin + left_count[i], buffer);
+      ridx_segments[right_nidx[i]] = Segment(begin + left_count[i], end, buffer);
+    }
   }
 
   /**
@@ -159,6 +275,7 @@ class RowPartitioner {
    */
   template <typename FinalisePositionOpT>
   void FinalisePosition(FinalisePositionOpT op) {
+    this->GatherSegments();
     auto d_position = position.Current();
     const auto d_ridx = ridx.Current();
     dh::LaunchN(device_idx, position.Size(), [=] __device__(size_t idx) {
@@ -182,19 +299,46 @@ class RowPartitioner {
                     bst_node_t right_nidx, int64_t* d_left_count,
                     cudaStream_t stream = nullptr);
 
-  /*! \brief Sort row indices according to position. */
+  /*! \brief Sort row indices according to position, within the buffer holding the
+   * segment. */
   void SortPositionAndCopy(const Segment& segment, bst_node_t left_nidx,
                            bst_node_t right_nidx, int64_t* d_left_count,
                            cudaStream_t stream);
+
+  /**
+   * \brief Stable partition of the segments of several nodes into left and
+   * right children, using one scan over the flattened segments.  The rows of
+   * each node are moved from its buffer into the other one.
+   *
+   * \param offsets  Offset of each node in the flattened index space, with the
+   *                 total number of elements as last item.
+   * \param begins   Begin of each node's segment in ridx.
+   * \param buffers  Buffer holding the rows of each node.
+   * \param is_left  Left indicator for every flattened element, followed by
+   *                 a zero.
+   * \param n_nodes  Number of nodes in the batch.
+   *
+   * \return Number of rows assigned to the left child of each node.
+   */
+  std::vector<int64_t> SortPositionBatch(common::Span<size_t> offsets,
+                                         common::Span<size_t> begins,
+                                         common::Span<int> buffers,
+                                         common::Span<int64_t> is_left,
+                                         uint32_t n_nodes);
   /** \brief Used to demarcate a contiguous set of row indices associated with
    * some tree node. */
   struct Segment {
     size_t begin;
     size_t end;
+    // buffer of ridx and position holding the rows, 0 for the current one
+    int buffer {0};
+    // whether the rows were moved to the children
+    bool partitioned {false};
 
     Segment() : begin{0}, end{0} {}
 
-    Segment(size_t begin, size_t end) : begin(begin), end(end) {
+    Segment(size_t begin, size_t end, int buffer = 0)
+        : begin(begin), end(end), buffer(buffer) {
       CHECK_GE(end, begin);
     }
     size_t Size() const { return end - begin; }
@@ -63,6 +63,8 @@ struct TrainParam : public XGBoostParameter<TrainParam> {
   float sketch_eps;
   // accuracy of sketch
   float sketch_ratio;
+  // number of trees sharing the candidate splits of approximate algorithm
+  int sketch_refresh_period;
   // option to open cacheline optimization
   bool cache_opt;
   // whether refresh updater needs to update the leaf values
@@ -175,6 +177,11 @@ struct TrainParam : public XGBoostParameter<TrainParam> {
         .set_lower_bound(0.0f)
         .set_default(2.0f)
         .describe("EXP Param: Sketch accuracy related parameter of approximate algorithm.");
+    DMLC_DECLARE_FIELD(sketch_refresh_period)
+        .set_lower_bound(0)
+        .set_default(1)
+        .describe("EXP Param: Number of trees sharing the candidate splits proposed by "
+                  "approximate algorithm, 0 sketches only once.");
     DMLC_DECLARE_FIELD(cache_opt)
         .set_default(true)
         .describe("EXP Param: Cache aware optimization.");
@@ -329,26 +336,28 @@ XGBOOST_DEVICE inline float CalcWeight(const TrainingParams &p, GpairT sum_grad)
   return CalcWeight(p, sum_grad.GetGrad(), sum_grad.GetHess());
 }
 
-/*! \brief core statistics used for tree construction */
-struct XGBOOST_ALIGNAS(16) GradStats {
+/*! \brief core statistics used for tree construction, accumulated in type T */
+template <typename T>
+struct XGBOOST_ALIGNAS(2 * sizeof(T)) GradStatsT {
+  using ValueT = T;
   /*! \brief sum gradient statistics */
-  double sum_grad;
+  T sum_grad;
   /*! \brief sum hessian statistics */
-  double sum_hess;
+  T sum_hess;
 
  public:
-  XGBOOST_DEVICE double GetGrad() const { return sum_grad; }
-  XGBOOST_DEVICE double GetHess() const { return sum_hess; }
+  XGBOOST_DEVICE T GetGrad() const { return sum_grad; }
+  XGBOOST_DEVICE T GetHess() const { return sum_hess; }
 
-  XGBOOST_DEVICE GradStats() : sum_grad{0}, sum_hess{0} {
-    static_assert(sizeof(GradStats) == 16,
-                  "Size of GradStats is not 16 bytes.");
+  XGBOOST_DEVICE GradStatsT() : sum_grad{0}, sum_hess{0} {
+    static_assert(sizeof(GradStatsT) == 2 * sizeof(T),
+                  "Size of GradStatsT is not 2 * sizeof(T).");
   }
 
   template <typename GpairT>
-  XGBOOST_DEVICE explicit GradStats(const GpairT &sum)
+  XGBOOST_DEVICE explicit GradStatsT(const GpairT &sum)
       : sum_grad(sum.GetGrad()), sum_hess(sum.GetHess()) {}
-  explicit GradStats(const double grad, const double hess)
+  explicit GradStatsT(const T grad, const T hess)
       : sum_grad(grad), sum_hess(hess) {}
   /*!
    * \brief accumulate statistics
@@ -357,28 +366,31 @@ struct XGBOOST_ALIGNAS(16) GradStats {
   inline void Add(GradientPair p) { this->Add(p.GetGrad(), p.GetHess()); }
 
   /*! \brief add statistics to the data */
-  inline void Add(const GradStats& b) {
+  inline void Add(const GradStatsT& b) {
     sum_grad += b.sum_grad;
     sum_hess += b.sum_hess;
   }
   /*! \brief same as add, reduce is used in All Reduce */
-  inline static void Reduce(GradStats& a, const GradStats& b) { // NOLINT(*)
+  inline static void Reduce(GradStatsT& a, const GradStatsT& b) { // NOLINT(*)
     a.Add(b);
   }
   /*! \brief set current value to a - b */
-  inline void SetSubstract(const GradStats& a, const GradStats& b) {
+  inline void SetSubstract(const GradStatsT& a, const GradStatsT& b) {
     sum_grad = a.sum_grad - b.sum_grad;
     sum_hess = a.sum_hess - b.sum_hess;
   }
   /*! \return whether the statistics is not used yet */
   inline bool Empty() const { return sum_hess == 0.0; }
   /*! \brief add statistics to the data */
-  inline void Add(double grad, double hess) {
+  inline void Add(T grad, T hess) {
     sum_grad += grad;
     sum_hess += hess;
   }
 };
 
+/*! \brief statistics in double precision, used by split evaluation */
+using GradStats = GradStatsT<double>;
+
 /*!
  * \brief statistics that is helpful to store
  *   and represent a split solution for the tree
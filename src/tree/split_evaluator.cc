@@ -103,40 +103,32 @@ class ElasticNet final : public SplitEvaluator {
 
   bst_float ComputeScore(bst_uint parentID, const GradStats &stats, bst_float weight)
       const override {
-    auto loss = weight * (2.0 * stats.sum_grad + stats.sum_hess * weight
-        + params_->reg_lambda * weight)
-        + 2.0 * params_->reg_alpha * std::abs(weight);
-    return -loss;
+    return Score().Score(stats, weight);
   }
 
   bst_float ComputeScore(bst_uint parentID, const GradStats &stats) const {
-    if (params_->max_delta_step == 0.0f) {
-      return Sqr(ThresholdL1(stats.sum_grad)) / (stats.sum_hess + params_->reg_lambda);
-    } else {
-      return ComputeScore(parentID, stats, ComputeWeight(parentID, stats));
-    }
+    return Score().Score(stats);
   }
 
   bst_float ComputeWeight(bst_uint parentID, const GradStats& stats)
       const override {
-    bst_float w = -ThresholdL1(stats.sum_grad) / (stats.sum_hess + params_->reg_lambda);
-    if (params_->max_delta_step != 0.0f && std::abs(w) > params_->max_delta_step) {
-      w = std::copysign(params_->max_delta_step, w);
-    }
-    return w;
+    return Score().Weight(stats);
+  }
+
+  bool GetStaticState(StaticEvaluatorState* out) const override {
+    out->score = Score();
+    out->lower = nullptr;
+    out->upper = nullptr;
+    return true;
   }
 
  private:
   TrainParam const* params_;
 
-  inline double ThresholdL1(double g) const {
-    if (g > params_->reg_alpha) {
-      return g - params_->reg_alpha;
-    } else if (g < -params_->reg_alpha) {
-      return g + params_->reg_alpha;
-    } else {
-      return 0.0;
-    }
+  ElasticNetScore Score() const {
+    ElasticNetScore score;
+    score.param = params_;
+    return score;
   }
 };
 
@@ -224,6 +216,15 @@ class MonotonicConstraint final : public SplitEvaluator {
     }
   }
 
+  bool GetStaticState(StaticEvaluatorState* out) const override {
+    if (!inner_->GetStaticState(out) || out->lower != nullptr) {
+      return false;
+    }
+    out->lower = &lower_;
+    out->upper = &upper_;
+    return true;
+  }
+
   void AddSplit(bst_uint nodeid,
                 bst_uint leftid,
                 bst_uint rightid,
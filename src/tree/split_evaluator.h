@@ -10,7 +10,9 @@
 
 #include <dmlc/registry.h>
 #include <xgboost/base.h>
+#include <cmath>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -24,7 +26,54 @@ namespace xgboost {
 namespace tree {
 
 // Should GradStats be in this header, rather than param.h?
-struct GradStats;
+template <typename T> struct GradStatsT;
+using GradStats = GradStatsT<double>;
+
+/*! \brief Elastic net penalty of the leaf weights, the arithmetic of "elastic_net". */
+struct ElasticNetScore {
+  TrainParam const* param {nullptr};
+
+  double ThresholdL1(double g) const {
+    if (g > param->reg_alpha) {
+      return g - param->reg_alpha;
+    } else if (g < -param->reg_alpha) {
+      return g + param->reg_alpha;
+    } else {
+      return 0.0;
+    }
+  }
+  bst_float Weight(const GradStats& stats) const {
+    bst_float w = -ThresholdL1(stats.sum_grad) / (stats.sum_hess + param->reg_lambda);
+    if (param->max_delta_step != 0.0f && std::abs(w) > param->max_delta_step) {
+      w = std::copysign(param->max_delta_step, w);
+    }
+    return w;
+  }
+  bst_float Score(const GradStats& stats, bst_float weight) const {
+    auto loss = weight * (2.0 * stats.sum_grad + stats.sum_hess * weight
+        + param->reg_lambda * weight)
+        + 2.0 * param->reg_alpha * std::abs(weight);
+    return -loss;
+  }
+  bst_float Score(const GradStats& stats) const {
+    if (param->max_delta_step == 0.0f) {
+      return Sqr(ThresholdL1(stats.sum_grad)) / (stats.sum_hess + param->reg_lambda);
+    } else {
+      return Score(stats, Weight(stats));
+    }
+  }
+};
+
+/*!
+ * \brief State of the built-in chains "elastic_net" and "elastic_net,monotonic", from
+ *  which they are composed statically.  The weight bounds are null without monotone
+ *  constraints.
+ */
+struct StaticEvaluatorState {
+  ElasticNetScore score;
+  std::vector<bst_float> const* lower {nullptr};
+  std::vector<bst_float> const* upper {nullptr};
+};
 
 class SplitEvaluator {
  public:
@@ -70,6 +119,79 @@ class SplitEvaluator {
                         bst_uint featureid,
                         bst_float leftweight,
                         bst_float rightweight);
+
+  /*!
+   * \brief Get the state of a built-in chain, see `StaticSplitEvaluator'.  The state
+   *  refers to this evaluator and follows its splits.
+   * \return false for chains with other evaluators, which are only called virtually.
+   */
+  virtual bool GetStaticState(StaticEvaluatorState* out) const { return false; }
+};
+
+/*!
+ * \brief Statically composed form of a built-in evaluator chain, for the inner loops of
+ *  split enumeration.  It computes the same scores as the chain without a virtual call
+ *  for every candidate, `kMonotone' selects the monotonic constraint.
+ */
+template <bool kMonotone>
+class StaticSplitEvaluator {
+ public:
+  explicit StaticSplitEvaluator(StaticEvaluatorState const& state) : state_{state} {}
+
+  bst_float ComputeWeight(bst_uint parentid, const GradStats& stats) const {
+    bst_float weight = state_.score.Weight(stats);
+    if (!kMonotone || parentid == ROOT_PARENT_ID) {
+      return weight;
+    } else if (weight < (*state_.lower)[parentid]) {
+      return (*state_.lower)[parentid];
+    } else if (weight > (*state_.upper)[parentid]) {
+      return (*state_.upper)[parentid];
+    } else {
+      return weight;
+    }
+  }
+
+  bst_float ComputeSplitScore(bst_uint nodeid, bst_uint featureid,
+                              const GradStats& left_stats,
+                              const GradStats& right_stats) const {
+    if (!kMonotone) {
+      return state_.score.Score(left_stats) + state_.score.Score(right_stats);
+    }
+    bst_float left_weight = ComputeWeight(nodeid, left_stats);
+    bst_float right_weight = ComputeWeight(nodeid, right_stats);
+    bst_float score = state_.score.Score(left_stats, left_weight) +
+                      state_.score.Score(right_stats, right_weight);
+    auto const& constraints = state_.score.param->monotone_constraints;
+    bst_int constraint = featureid < constraints.size() ? constraints[featureid] : 0;
+    if (constraint == 0) {
+      return score;
+    } else if (constraint > 0) {
+      return left_weight <= right_weight ? score : -std::numeric_limits<bst_float>::infinity();
+    } else {
+      return left_weight >= right_weight ? score : -std::numeric_limits<bst_float>::infinity();
+    }
+  }
+
+ private:
+  StaticEvaluatorState state_;
+};
+
+/*! \brief Calls any evaluator chain through its virtual interface. */
+class VirtualSplitEvaluator {
+ public:
+  explicit VirtualSplitEvaluator(SplitEvaluator const* eval) : eval_{eval} {}
+
+  bst_float ComputeWeight(bst_uint parentid, const GradStats& stats) const {
+    return eval_->ComputeWeight(parentid, stats);
+  }
+  bst_float ComputeSplitScore(bst_uint nodeid, bst_uint featureid,
+                              const GradStats& left_stats,
+                              const GradStats& right_stats) const {
+    return eval_->ComputeSplitScore(nodeid, featureid, left_stats, right_stats);
+  }
+
+ private:
+  SplitEvaluator const* eval_;
 };
 
 struct SplitEvaluatorReg
@@ -10,12 +10,15 @@
 #include <xgboost/logging.h>
 #include <xgboost/json.h>
 
+#include <algorithm>
 #include <sstream>
 #include <limits>
 #include <cmath>
 #include <iomanip>
 
 #include "param.h"
+#include "../common/categorical.h"
+#include "../common/charconv.h"
 #include "../common/common.h"
 
 namespace xgboost {
@@ -46,6 +49,19 @@ class TreeGenerator {
     return ss.str();
   }
 
+  /* \brief Value of a leaf, a bracketed list for the leaves of multi-output trees. */
+  static std::string LeafStr(RegTree const& tree, int32_t nid) {
+    if (!tree.IsMultiOutput()) {
+      return ToStr(tree[nid].LeafValue());
+    }
+    auto const* values = tree.LeafVector(nid);
+    std::string res = "[";
+    for (int32_t i = 0; i < tree.param.size_leaf_vector; ++i) {
+      res += (i == 0 ? "" : ",") + ToStr(values[i]);
+    }
+    return res + "]";
+  }
+
   static std::string Tabs(uint32_t n) {
     std::string res;
     for (uint32_t i = 0; i < n; ++i) {
@@ -79,13 +95,29 @@ class TreeGenerator {
   virtual std::string NodeStat(RegTree const& tree, int32_t nid) {
     return "";
   }
+  // Categories going left at a categorical split, separated by `sep'.
+  static std::string CategoriesStr(RegTree const& tree, int32_t nid, std::string const& sep) {
+    auto const cats = tree.NodeCats(nid);
+    std::string result;
+    for (size_t c = 0; c < cats.size() * common::CatBitField::kValueSize; ++c) {
+      if (common::Decision(cats, static_cast<bst_cat_t>(c))) {
+        result += (result.empty() ? "" : sep) + std::to_string(c);
+      }
+    }
+    return result;
+  }
 
   virtual std::string PlainNode(RegTree const& tree, int32_t nid, uint32_t depth) = 0;
+  virtual std::string Categorical(RegTree const& tree, int32_t nid, uint32_t depth) {
+    return this->PlainNode(tree, nid, depth);
+  }
 
   virtual std::string SplitNode(RegTree const& tree, int32_t nid, uint32_t depth) {
     auto const split_index = tree[nid].SplitIndex();
     std::string result;
-    if (split_index < fmap_.Size()) {
+    if (tree.NodeSplitType(nid) == FeatureType::kCategorical) {
+      result = this->Categorical(tree, nid, depth);
+    } else if (split_index < fmap_.Size()) {
       switch (fmap_.type(split_index)) {
         case FeatureMap::kIndicator: {
           result = this->Indicator(tree, nid, depth);
@@ -187,7 +219,7 @@ class TextGenerator : public TreeGenerator {
         kLeafTemplate,
         {{"{tabs}",  SuperT::Tabs(depth)},
          {"{nid}",   std::to_string(nid)},
-         {"{leaf}",  SuperT::ToStr(tree[nid].LeafValue())},
+         {"{leaf}",  SuperT::LeafStr(tree, nid)},
          {"{stats}", with_stats_ ?
           SuperT::Match(kStatTemplate,
                         {{"{cover}", SuperT::ToStr(tree.Stat(nid).sum_hess)}}) : ""}});
@@ -251,6 +283,13 @@ class TextGenerator : public TreeGenerator {
     return SplitNodeImpl(tree, nid, kNodeTemplate, SuperT::ToStr(cond), depth);
   }
 
+  std::string Categorical(RegTree const& tree, int32_t nid, uint32_t depth) override {
+    static std::string const kNodeTemplate =
+        "{tabs}{nid}:[f{fname}:{{cond}}] yes={left},no={right},missing={missing}";
+    return SplitNodeImpl(tree, nid, kNodeTemplate, SuperT::CategoriesStr(tree, nid, ","),
+                         depth);
+  }
+
   std::string NodeStat(RegTree const& tree, int32_t nid) override {
     static std::string const kStatTemplate = ",gain={loss_chg},cover={sum_hess}";
     std::string const result = SuperT::Match(
@@ -296,6 +335,26 @@ class JsonGenerator : public TreeGenerator {
   JsonGenerator(FeatureMap const& fmap, std::string attrs, bool with_stats) :
       TreeGenerator(fmap, with_stats) {}
 
+  // Floats are written the same way as in JSON models, the shortest form parsed back
+  // to the same value.
+  static std::string ToStr(bst_float value) {
+    char buffer[common::NumericLimits<bst_float>::kToCharsSize];
+    auto res = common::ToChars(buffer, buffer + sizeof(buffer), value);
+    return std::string{buffer, res.ptr};
+  }
+
+  static std::string LeafStr(RegTree const& tree, int32_t nid) {
+    if (!tree.IsMultiOutput()) {
+      return ToStr(tree[nid].LeafValue());
+    }
+    auto const* values = tree.LeafVector(nid);
+    std::string res = "[";
+    for (int32_t i = 0; i < tree.param.size_leaf_vector; ++i) {
+      res += (i == 0 ? "" : ",") + ToStr(values[i]);
+    }
+    return res + "]";
+  }
+
   std::string Indent(uint32_t depth) {
     std::string result;
     for (uint32_t i = 0; i < depth + 1; ++i) {
@@ -312,11 +371,11 @@ class JsonGenerator : public TreeGenerator {
     std::string result = SuperT::Match(
         kLeafTemplate,
         {{"{nid}",  std::to_string(nid)},
-         {"{leaf}", SuperT::ToStr(tree[nid].LeafValue())},
+         {"{leaf}", LeafStr(tree, nid)},
          {"{stat}", with_stats_ ? SuperT::Match(
              kStatTemplate,
              {{"{sum_hess}",
-               SuperT::ToStr(tree.Stat(nid).sum_hess)}})  : ""}});
+               ToStr(tree.Stat(nid).sum_hess)}})  : ""}});
     return result;
   }
 
@@ -372,7 +431,7 @@ class JsonGenerator : public TreeGenerator {
         R"I("split_condition": {cond}, "yes": {left}, "no": {right}, )I"
         R"I("missing": {missing})I";
     bst_float cond = tree[nid].SplitCond();
-    return SplitNodeImpl(tree, nid, kQuantitiveTemplate, SuperT::ToStr(cond), depth);
+    return SplitNodeImpl(tree, nid, kQuantitiveTemplate, ToStr(cond), depth);
   }
 
   std::string PlainNode(RegTree const& tree, int32_t nid, uint32_t depth) override {
@@ -381,7 +440,16 @@ class JsonGenerator : public TreeGenerator {
         R"I( "nodeid": {nid}, "depth": {depth}, "split": {fname}, )I"
         R"I("split_condition": {cond}, "yes": {left}, "no": {right}, )I"
         R"I("missing": {missing})I";
-    return SplitNodeImpl(tree, nid, kNodeTemplate, SuperT::ToStr(cond), depth);
+    return SplitNodeImpl(tree, nid, kNodeTemplate, ToStr(cond), depth);
+  }
+
+  std::string Categorical(RegTree const& tree, int32_t nid, uint32_t depth) override {
+    static std::string const kNodeTemplate =
+        R"I( "nodeid": {nid}, "depth": {depth}, "split": {fname}, )I"
+        R"I("split_condition": [{cond}], "yes": {left}, "no": {right}, )I"
+        R"I("missing": {missing})I";
+    return SplitNodeImpl(tree, nid, kNodeTemplate, SuperT::CategoriesStr(tree, nid, ", "),
+                         depth);
   }
 
   std::string NodeStat(RegTree const& tree, int32_t nid) override {
@@ -389,8 +457,8 @@ class JsonGenerator : public TreeGenerator {
         R"S(, "gain": {loss_chg}, "cover": {sum_hess})S";
     auto result = SuperT::Match(
         kStatTemplate,
-        {{"{loss_chg}", SuperT::ToStr(tree.Stat(nid).loss_chg)},
-         {"{sum_hess}", SuperT::ToStr(tree.Stat(nid).sum_hess)}});
+        {{"{loss_chg}", ToStr(tree.Stat(nid).loss_chg)},
+         {"{sum_hess}", ToStr(tree.Stat(nid).sum_hess)}});
     return result;
   }
 
@@ -536,12 +604,20 @@ class GraphvizGenerator : public TreeGenerator {
 
     // Indicator only has fname.
     bool has_less = (split >= fmap_.Size()) || fmap_.type(split) != FeatureMap::kIndicator;
+    // Categorical splits list the categories going left.
+    bool const is_cat = tree.NodeSplitType(nid) == FeatureType::kCategorical;
+    std::string cond_str;
+    if (is_cat) {
+      cond_str = "{" + SuperT::CategoriesStr(tree, nid, ",") + "}";
+    } else if (has_less) {
+      cond_str = SuperT::ToStr(cond);
+    }
     std::string result = SuperT::Match(kNodeTemplate, {
         {"{nid}",    std::to_string(nid)},
         {"{fname}",  split < fmap_.Size() ? fmap_.Name(split) :
                                            'f' + std::to_string(split)},
-        {"{<}",      has_less ? "<" : ""},
-        {"{cond}",   has_less ? SuperT::ToStr(cond) : ""},
+        {"{<}",      is_cat ? ":" : (has_less ? "<" : "")},
+        {"{cond}",   cond_str},
         {"{params}", param_.condition_node_params}});
 
     static std::string const kEdgeTemplate =
@@ -567,7 +643,7 @@ class GraphvizGenerator : public TreeGenerator {
         "    {nid} [ label=\"leaf={leaf-value}\" {params}]\n";
     auto result = SuperT::Match(kLeafTemplate, {
         {"{nid}",        std::to_string(nid)},
-        {"{leaf-value}", ToStr(tree[nid].LeafValue())},
+        {"{leaf-value}", LeafStr(tree, nid)},
         {"{params}",     param_.leaf_node_params}});
     return result;
   };
@@ -627,6 +703,16 @@ void RegTree::Load(dmlc::Stream* fi) {
            sizeof(Node) * nodes_.size());
   CHECK_EQ(fi->Read(dmlc::BeginPtr(stats_), sizeof(RTreeNodeStat) * stats_.size()),
            sizeof(RTreeNodeStat) * stats_.size());
+  leaf_vector_.clear();
+  if (param.size_leaf_vector != 0) {
+    CHECK(fi->Read(&leaf_vector_));
+    CHECK_EQ(leaf_vector_.size(),
+             static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+  }
+  // the binary format has no categorical split
+  split_types_.assign(param.num_nodes, FeatureType::kNumerical);
+  split_categories_.clear();
+  split_categories_segments_.assign(param.num_nodes, Segment{});
   // chg deleted nodes
   deleted_nodes_.resize(0);
   for (int i = 1; i < param.num_nodes; ++i) {
@@ -639,36 +725,53 @@ void RegTree::Load(dmlc::Stream* fi) {
 void RegTree::Save(dmlc::Stream* fo) const {
   CHECK_EQ(param.num_nodes, static_cast<int>(nodes_.size()));
   CHECK_EQ(param.num_nodes, static_cast<int>(stats_.size()));
+  for (bst_node_t i = 0; i < param.num_nodes; ++i) {
+    CHECK(nodes_[i].IsLeaf() || nodes_[i].IsDeleted() ||
+          split_types_[i] != FeatureType::kCategorical)
+        << "Categorical splits can only be saved in JSON format.";
+  }
   fo->Write(&param, sizeof(TreeParam));
   CHECK_EQ(param.deprecated_num_roots, 1);
   CHECK_NE(param.num_nodes, 0);
   fo->Write(dmlc::BeginPtr(nodes_), sizeof(Node) * nodes_.size());
   fo->Write(dmlc::BeginPtr(stats_), sizeof(RTreeNodeStat) * nodes_.size());
+  if (param.size_leaf_vector != 0) {
+    CHECK_EQ(leaf_vector_.size(),
+             static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+    fo->Write(leaf_vector_);
+  }
 }
 
 void RegTree::LoadModel(Json const& in) {
   fromJson(in["tree_param"], &param);
   auto n_nodes = param.num_nodes;
   CHECK_NE(n_nodes, 0);
+  // Arrays are typed when the model comes from `SaveModel' or a reader parsing typed
+  // arrays, otherwise they are arrays of Json numbers.
   // stats
-  auto const& loss_changes = get<Array const>(in["loss_changes"]);
+  std::vector<float> loss_changes, sum_hessian, base_weights;
+  std::vector<int32_t> leaf_child_counts;
+  GetNumericArray(in["loss_changes"], &loss_changes);
   CHECK_EQ(loss_changes.size(), n_nodes);
-  auto const& sum_hessian = get<Array const>(in["sum_hessian"]);
+  GetNumericArray(in["sum_hessian"], &sum_hessian);
   CHECK_EQ(sum_hessian.size(), n_nodes);
-  auto const& base_weights = get<Array const>(in["base_weights"]);
+  GetNumericArray(in["base_weights"], &base_weights);
   CHECK_EQ(base_weights.size(), n_nodes);
-  auto const& leaf_child_counts = get<Array const>(in["leaf_child_counts"]);
+  GetNumericArray(in["leaf_child_counts"], &leaf_child_counts);
   CHECK_EQ(leaf_child_counts.size(), n_nodes);
   // nodes
-  auto const& lefts = get<Array const>(in["left_children"]);
+  std::vector<bst_node_t> lefts, rights, parents;
+  std::vector<bst_feature_t> indices;
+  std::vector<float> conds;
+  GetNumericArray(in["left_children"], &lefts);
   CHECK_EQ(lefts.size(), n_nodes);
-  auto const& rights = get<Array const>(in["right_children"]);
+  GetNumericArray(in["right_children"], &rights);
   CHECK_EQ(rights.size(), n_nodes);
-  auto const& parents = get<Array const>(in["parents"]);
+  GetNumericArray(in["parents"], &parents);
   CHECK_EQ(parents.size(), n_nodes);
-  auto const& indices = get<Array const>(in["split_indices"]);
+  GetNumericArray(in["split_indices"], &indices);
   CHECK_EQ(indices.size(), n_nodes);
-  auto const& conds = get<Array const>(in["split_conditions"]);
+  GetNumericArray(in["split_conditions"], &conds);
   CHECK_EQ(conds.size(), n_nodes);
   auto const& default_left = get<Array const>(in["default_left"]);
   CHECK_EQ(default_left.size(), n_nodes);
@@ -677,21 +780,55 @@ void RegTree::LoadModel(Json const& in) {
   nodes_.resize(n_nodes);
   for (int32_t i = 0; i < n_nodes; ++i) {
     auto& s = stats_[i];
-    s.loss_chg = get<Number const>(loss_changes[i]);
-    s.sum_hess = get<Number const>(sum_hessian[i]);
-    s.base_weight = get<Number const>(base_weights[i]);
-    s.leaf_child_cnt = get<Integer const>(leaf_child_counts[i]);
+    s.loss_chg = loss_changes[i];
+    s.sum_hess = sum_hessian[i];
+    s.base_weight = base_weights[i];
+    s.leaf_child_cnt = leaf_child_counts[i];
 
     auto& n = nodes_[i];
-    bst_node_t left = get<Integer const>(lefts[i]);
-    bst_node_t right = get<Integer const>(rights[i]);
-    bst_node_t parent = get<Integer const>(parents[i]);
-    bst_feature_t ind = get<Integer const>(indices[i]);
-    float cond { get<Number const>(conds[i]) };
     bool dft_left { get<Boolean const>(default_left[i]) };
-    n = Node{left, right, parent, ind, cond, dft_left};
+    n = Node{lefts[i], rights[i], parents[i], indices[i], conds[i], dft_left};
+  }
+  leaf_vector_.clear();
+  if (param.size_leaf_vector != 0) {
+    GetNumericArray(in["leaf_vector"], &leaf_vector_);
+    CHECK_EQ(leaf_vector_.size(), static_cast<size_t>(n_nodes) * param.size_leaf_vector);
+  }
+  // categorical splits are only present in models that have them
+  split_types_.assign(n_nodes, FeatureType::kNumerical);
+  split_categories_.clear();
+  split_categories_segments_.assign(n_nodes, Segment{});
+  auto const& obj = get<Object const>(in);
+  if (obj.find("categories_nodes") != obj.cend()) {
+    std::vector<bst_node_t> cat_nodes;
+    std::vector<int64_t> cat_sizes;
+    std::vector<bst_cat_t> cats;
+    GetNumericArray(in["categories_nodes"], &cat_nodes);
+    GetNumericArray(in["categories_sizes"], &cat_sizes);
+    GetNumericArray(in["categories"], &cats);
+    CHECK_EQ(cat_nodes.size(), cat_sizes.size());
+    size_t cat_beg = 0;
+    for (size_t i = 0; i < cat_nodes.size(); ++i) {
+      bst_node_t const nid = cat_nodes[i];
+      CHECK_LT(nid, n_nodes);
+      CHECK_LE(cat_beg + cat_sizes[i], cats.size());
+      // categories are saved as a list, the bit field covers the largest one
+      auto const node_beg = cats.cbegin() + cat_beg;
+      auto const node_end = node_beg + cat_sizes[i];
+      bst_cat_t const max_cat = node_beg == node_end ? 0 : *std::max_element(node_beg, node_end);
+      size_t const beg = split_categories_.size();
+      size_t const size = common::CatBitField::ComputeStorageSize(max_cat + 1);
+      split_categories_.resize(beg + size, 0);
+      common::CatBitField bits(common::Span<uint64_t>(split_categories_.data() + beg, size));
+      for (auto it = node_beg; it != node_end; ++it) {
+        CHECK_GE(*it, 0) << "Invalid category: " << *it;
+        bits.Set(*it);
+      }
+      cat_beg += cat_sizes[i];
+      split_types_[nid] = FeatureType::kCategorical;
+      split_categories_segments_[nid] = Segment{beg, size};
+    }
   }
-
 
   deleted_nodes_.resize(0);
   for (bst_node_t i = 1; i < param.num_nodes; ++i) {
@@ -708,37 +845,39 @@ void RegTree::SaveModel(Json* p_out) const {
   CHECK_EQ(param.num_nodes, static_cast<int>(stats_.size()));
   out["tree_param"] = toJson(param);
   CHECK_EQ(get<String>(out["tree_param"]["num_nodes"]), std::to_string(param.num_nodes));
-  using I = Integer::Int;
-  auto n_nodes = param.num_nodes;
+  auto n_nodes = static_cast<size_t>(param.num_nodes);
 
   // stats
-  std::vector<Json> loss_changes(n_nodes);
-  std::vector<Json> sum_hessian(n_nodes);
-  std::vector<Json> base_weights(n_nodes);
-  std::vector<Json> leaf_child_counts(n_nodes);
+  F32Array loss_changes(n_nodes);
+  F32Array sum_hessian(n_nodes);
+  F32Array base_weights(n_nodes);
+  I32Array leaf_child_counts(n_nodes);
 
   // nodes
-  std::vector<Json> lefts(n_nodes);
-  std::vector<Json> rights(n_nodes);
-  std::vector<Json> parents(n_nodes);
-  std::vector<Json> indices(n_nodes);
-  std::vector<Json> conds(n_nodes);
+  I32Array lefts(n_nodes);
+  I32Array rights(n_nodes);
+  I32Array parents(n_nodes);
+  I32Array indices(n_nodes);
+  F32Array conds(n_nodes);
+  // Kept as booleans for the schema, all elements share the two values.
+  Json const j_true {Boolean{true}};
+  Json const j_false {Boolean{false}};
   std::vector<Json> default_left(n_nodes);
 
-  for (int32_t i = 0; i < n_nodes; ++i) {
+  for (size_t i = 0; i < n_nodes; ++i) {
     auto const& s = stats_[i];
-    loss_changes[i] = s.loss_chg;
-    sum_hessian[i] = s.sum_hess;
-    base_weights[i] = s.base_weight;
-    leaf_child_counts[i] = static_cast<I>(s.leaf_child_cnt);
+    loss_changes.Set(i, s.loss_chg);
+    sum_hessian.Set(i, s.sum_hess);
+    base_weights.Set(i, s.base_weight);
+    leaf_child_counts.Set(i, s.leaf_child_cnt);
 
     auto const& n = nodes_[i];
-    lefts[i] = static_cast<I>(n.LeftChild());
-    rights[i] = static_cast<I>(n.RightChild());
-    parents[i] = static_cast<I>(n.Parent());
-    indices[i] = static_cast<I>(n.SplitIndex());
-    conds[i] = n.SplitCond();
-    default_left[i] = n.DefaultLeft();
+    lefts.Set(i, n.LeftChild());
+    rights.Set(i, n.RightChild());
+    parents.Set(i, n.Parent());
+    indices.Set(i, static_cast<int32_t>(n.SplitIndex()));
+    conds.Set(i, n.SplitCond());
+    default_left[i] = n.DefaultLeft() ? j_true : j_false;
   }
 
   out["loss_changes"] = std::move(loss_changes);
@@ -752,6 +891,127 @@ void RegTree::SaveModel(Json* p_out) const {
   out["split_indices"] = std::move(indices);
   out["split_conditions"] = std::move(conds);
   out["default_left"] = std::move(default_left);
+  if (param.size_leaf_vector != 0) {
+    CHECK_EQ(leaf_vector_.size(), n_nodes * param.size_leaf_vector);
+    out["leaf_vector"] = F32Array(std::vector<float>(leaf_vector_));
+  }
+  // categories going left at each categorical split, as a list for each node
+  if (this->HasCategoricalSplit()) {
+    std::vector<int32_t> cat_nodes, cat_sizes, cats;
+    for (size_t i = 0; i < n_nodes; ++i) {
+      if (nodes_[i].IsLeaf() || split_types_[i] != FeatureType::kCategorical) {
+        continue;
+      }
+      auto const node_cats = this->NodeCats(i);
+      size_t const n_before = cats.size();
+      for (size_t c = 0; c < node_cats.size() * common::CatBitField::kValueSize; ++c) {
+        if (common::Decision(node_cats, static_cast<bst_cat_t>(c))) {
+          cats.push_back(static_cast<int32_t>(c));
+        }
+      }
+      cat_nodes.push_back(static_cast<int32_t>(i));
+      cat_sizes.push_back(static_cast<int32_t>(cats.size() - n_before));
+    }
+    out["categories_nodes"] = I32Array(std::move(cat_nodes));
+    out["categories_sizes"] = I32Array(std::move(cat_sizes));
+    out["categories"] = I32Array(std::move(cats));
+  }
+}
+
+int RegTree::GetNextCategorical(int pid, bst_float fvalue) const {
+  return common::Decision(this->NodeCats(pid), common::AsCat(fvalue)) ?
+         (*this)[pid].LeftChild() : (*this)[pid].RightChild();
+}
+
+bst_node_t RegTree::Compact() {
+  // Nodes reachable from the root, breadth first.
+  std::vector<bst_node_t> order;
+  auto traverse = [&]() {
+    order.assign(1, 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+      auto const& node = nodes_[order[i]];
+      if (!node.IsLeaf()) {
+        order.push_back(node.LeftChild());
+        order.push_back(node.RightChild());
+      }
+    }
+  };
+  traverse();
+  bool const has_vectors = !leaf_vector_.empty();
+  auto same_leaves = [&](bst_node_t a, bst_node_t b) {
+    if (has_vectors) {
+      return std::equal(this->LeafVector(a), this->LeafVector(a) + param.size_leaf_vector,
+                        this->LeafVector(b));
+    }
+    return nodes_[a].LeafValue() == nodes_[b].LeafValue();
+  };
+  // Children come after their parent, so folding in reverse order cascades upwards.
+  bst_node_t n_folded = 0;
+  for (auto it = order.crbegin(); it != order.crend(); ++it) {
+    auto const& node = nodes_[*it];
+    if (node.IsLeaf()) {
+      continue;
+    }
+    bst_node_t const left = node.LeftChild(), right = node.RightChild();
+    if (!nodes_[left].IsLeaf() || !nodes_[right].IsLeaf() || !same_leaves(left, right)) {
+      continue;
+    }
+    if (has_vectors) {
+      std::vector<bst_float> values(this->LeafVector(left),
+                                    this->LeafVector(left) + param.size_leaf_vector);
+      this->SetLeafVector(*it, values);
+    }
+    this->ChangeToLeaf(*it, nodes_[left].LeafValue());
+    split_types_[*it] = FeatureType::kNumerical;
+    ++n_folded;
+  }
+
+  traverse();
+  std::vector<bst_node_t> new_id(nodes_.size(), kInvalidNodeId);
+  for (size_t i = 0; i < order.size(); ++i) {
+    new_id[order[i]] = static_cast<bst_node_t>(i);
+  }
+  std::vector<Node> nodes(order.size());
+  std::vector<RTreeNodeStat> stats(order.size());
+  std::vector<FeatureType> split_types(order.size(), FeatureType::kNumerical);
+  std::vector<Segment> segments(order.size());
+  std::vector<uint64_t> categories;
+  std::vector<bst_float> leaf_vector;
+  for (size_t i = 0; i < order.size(); ++i) {
+    bst_node_t const nid = order[i];
+    auto const& node = nodes_[nid];
+    nodes[i] = node;
+    if (!node.IsLeaf()) {
+      nodes[i].SetLeftChild(new_id[node.LeftChild()]);
+      nodes[i].SetRightChild(new_id[node.RightChild()]);
+      split_types[i] = split_types_[nid];
+    }
+    if (i != 0) {
+      nodes[i].SetParent(new_id[node.Parent()], node.IsLeftChild());
+    }
+    stats[i] = stats_[nid];
+    if (split_types[i] == FeatureType::kCategorical) {
+      auto const& seg = split_categories_segments_[nid];
+      segments[i] = Segment{categories.size(), seg.size};
+      categories.insert(categories.end(), split_categories_.cbegin() + seg.beg,
+                        split_categories_.cbegin() + seg.beg + seg.size);
+    }
+    if (has_vectors) {
+      leaf_vector.insert(leaf_vector.end(), this->LeafVector(nid),
+                         this->LeafVector(nid) + param.size_leaf_vector);
+    }
+  }
+  nodes_ = std::move(nodes);
+  stats_ = std::move(stats);
+  split_types_ = std::move(split_types);
+  split_categories_segments_ = std::move(segments);
+  split_categories_ = std::move(categories);
+  leaf_vector_ = std::move(leaf_vector);
+  deleted_nodes_.clear();
+  node_mean_values_.clear();
+  param.num_nodes = static_cast<int>(nodes_.size());
+  param.num_deleted = 0;
+  return n_folded;
 }
 
 void RegTree::FillNodeMeanValues() {
@@ -759,32 +1019,41 @@ void RegTree::FillNodeMeanValues() {
   if (this->node_mean_values_.size() == num_nodes) {
     return;
   }
-  this->node_mean_values_.resize(num_nodes);
-  this->FillNodeMeanValue(0);
+  this->CalcNodeMeanValues(&this->node_mean_values_);
 }
 
-bst_float RegTree::FillNodeMeanValue(int nid) {
+namespace {
+bst_float FillNodeMeanValue(RegTree const& tree, bst_node_t nid, bst_float* out) {
   bst_float result;
-  auto& node = (*this)[nid];
+  auto& node = tree[nid];
   if (node.IsLeaf()) {
     result = node.LeafValue();
   } else {
-    result  = this->FillNodeMeanValue(node.LeftChild()) * this->Stat(node.LeftChild()).sum_hess;
-    result += this->FillNodeMeanValue(node.RightChild()) * this->Stat(node.RightChild()).sum_hess;
-    result /= this->Stat(nid).sum_hess;
+    result  = FillNodeMeanValue(tree, node.LeftChild(), out) *
+              tree.Stat(node.LeftChild()).sum_hess;
+    result += FillNodeMeanValue(tree, node.RightChild(), out) *
+              tree.Stat(node.RightChild()).sum_hess;
+    result /= tree.Stat(nid).sum_hess;
   }
-  this->node_mean_values_[nid] = result;
+  out[nid] = result;
   return result;
 }
+}  // anonymous namespace
+
+void RegTree::CalcNodeMeanValues(std::vector<bst_float>* out) const {
+  out->resize(this->param.num_nodes);
+  FillNodeMeanValue(*this, 0, out->data());
+}
 
 void RegTree::CalculateContributionsApprox(const RegTree::FVec &feat,
-                                           bst_float *out_contribs) const {
+                                           bst_float *out_contribs,
+                                           bst_float weight) const {
   CHECK_GT(this->node_mean_values_.size(), 0U);
   // this follows the idea of http://blog.datadive.net/interpreting-random-forests/
   unsigned split_index = 0;
   // update bias value
   bst_float node_value = this->node_mean_values_[0];
-  out_contribs[feat.Size()] += node_value;
+  out_contribs[feat.Size()] += node_value * weight;
   if ((*this)[0].IsLeaf()) {
     // nothing to do anymore
     return;
@@ -795,28 +1064,14 @@ void RegTree::CalculateContributionsApprox(const RegTree::FVec &feat,
     nid = this->GetNext(nid, feat.GetFvalue(split_index), feat.IsMissing(split_index));
     bst_float new_value = this->node_mean_values_[nid];
     // update feature weight
-    out_contribs[split_index] += new_value - node_value;
+    out_contribs[split_index] += (new_value - node_value) * weight;
     node_value = new_value;
   }
   bst_float leaf_value = (*this)[nid].LeafValue();
   // update leaf feature weight
-  out_contribs[split_index] += leaf_value - node_value;
+  out_contribs[split_index] += (leaf_value - node_value) * weight;
 }
 
-// Used by TreeShap
-// data we keep about our decision path
-// note that pweight is included for convenience and is not tied with the other attributes
-// the pweight of the i'th path element is the permuation weight of paths with i-1 ones in them
-struct PathElement {
-  int feature_index;
-  bst_float zero_fraction;
-  bst_float one_fraction;
-  bst_float pweight;
-  PathElement() = default;
-  PathElement(int i, bst_float z, bst_float o, bst_float w) :
-    feature_index(i), zero_fraction(z), one_fraction(o), pweight(w) {}
-};
-
 // extend our decision path with a fraction of one and zero extensions
 void ExtendPath(PathElement *unique_path, unsigned unique_depth,
                 bst_float zero_fraction, bst_float one_fraction,
@@ -921,14 +1176,8 @@ void RegTree::TreeShap(const RegTree::FVec &feat, bst_float *phi,
   // internal node
   } else {
     // find which branch is "hot" (meaning x would follow it)
-    unsigned hot_index = 0;
-    if (feat.IsMissing(split_index)) {
-      hot_index = node.DefaultChild();
-    } else if (feat.GetFvalue(split_index) < node.SplitCond()) {
-      hot_index = node.LeftChild();
-    } else {
-      hot_index = node.RightChild();
-    }
+    unsigned hot_index = this->GetNext(node_index, feat.GetFvalue(split_index),
+                                       feat.IsMissing(split_index));
     const unsigned cold_index = (static_cast<int>(hot_index) == node.LeftChild() ?
                                  node.RightChild() : node.LeftChild());
     const bst_float w = this->Stat(node_index).sum_hess;
@@ -976,17 +1225,24 @@ void RegTree::CalculateContributions(const RegTree::FVec &feat,
                                      bst_float *out_contribs,
                                      int condition,
                                      unsigned condition_feature) const {
+  // Preallocate space for the unique path data
+  std::vector<PathElement> unique_path_data(ShapPathSize(this->MaxDepth(0)));
+  this->CalculateContributions(feat, out_contribs, condition, condition_feature,
+                               unique_path_data.data());
+}
+
+void RegTree::CalculateContributions(const RegTree::FVec &feat,
+                                     bst_float *out_contribs,
+                                     int condition,
+                                     unsigned condition_feature,
+                                     PathElement *unique_path) const {
   // find the expected value of the tree's predictions
   if (condition == 0) {
     bst_float node_value = this->node_mean_values_[0];
     out_contribs[feat.Size()] += node_value;
   }
 
-  // Preallocate space for the unique path data
-  const int maxd = this->MaxDepth(0) + 2;
-  std::vector<PathElement> unique_path_data((maxd * (maxd + 1)) / 2);
-
-  TreeShap(feat, out_contribs, 0, 0, unique_path_data.data(),
+  TreeShap(feat, out_contribs, 0, 0, unique_path,
            1, 1, -1, condition, condition_feature, 1);
 }
 }  // namespace xgboost
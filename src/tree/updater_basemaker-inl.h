@@ -22,9 +22,11 @@
 #include "param.h"
 #include "constraints.h"
 
+#include "../common/common.h"
 #include "../common/io.h"
 #include "../common/random.h"
 #include "../common/quantile.h"
+#include "../common/threading_utils.h"
 
 namespace xgboost {
 namespace tree {
@@ -338,6 +340,10 @@ class BaseMaker: public TreeUpdater {
     std::vector< std::vector<TStats> > &thread_temp = *p_thread_temp;
     thread_temp.resize(omp_get_max_threads());
     p_node_stats->resize(tree.param.num_nodes);
+    if (common::IsDeterministic()) {
+      this->GetNodeStatsInBlocks(gpair, fmat, p_node_stats);
+      return;
+    }
 #pragma omp parallel
     {
       const int tid = omp_get_thread_num();
@@ -365,6 +371,38 @@ class BaseMaker: public TreeUpdater {
       }
     }
   }
+  /*! \brief Same as `GetNodeStats', summing fixed blocks of rows in order. */
+  template <typename TStats>
+  inline void GetNodeStatsInBlocks(const std::vector<GradientPair> &gpair,
+                                   const DMatrix &fmat,
+                                   std::vector<TStats> *p_node_stats) {
+    constexpr size_t kBlockRows = 4096;
+    std::vector<int> slot(p_node_stats->size(), -1);
+    for (size_t i = 0; i < qexpand_.size(); ++i) {
+      slot[qexpand_[i]] = static_cast<int>(i);
+    }
+    const size_t nexpand = qexpand_.size();
+    const size_t ndata = fmat.Info().num_row_;
+    const auto n_blocks = static_cast<bst_omp_uint>(common::DivRoundUp(ndata, kBlockRows));
+    std::vector<TStats> block_stats(n_blocks * nexpand, TStats());
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint iblock = 0; iblock < n_blocks; ++iblock) {
+      const size_t iend = std::min((iblock + 1) * kBlockRows, ndata);
+      for (size_t ridx = iblock * kBlockRows; ridx < iend; ++ridx) {
+        const int nid = position_[ridx];
+        if (nid >= 0 && slot[nid] >= 0) {
+          block_stats[iblock * nexpand + slot[nid]].Add(gpair[ridx]);
+        }
+      }
+    }
+    for (size_t i = 0; i < nexpand; ++i) {
+      TStats &s = (*p_node_stats)[qexpand_[i]];
+      s = TStats();
+      for (size_t iblock = 0; iblock < n_blocks; ++iblock) {
+        s.Add(block_stats[iblock * nexpand + i]);
+      }
+    }
+  }
   /*! \brief common helper data structure to build sketch */
   struct SketchEntry {
     /*! \brief total sum of amount to be met */
@@ -106,7 +106,7 @@ class ColMaker: public TreeUpdater {
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
-    interaction_constraints_.Configure(param_, dmat->Info().num_row_);
+    interaction_constraints_.Configure(param_, dmat->Info().num_col_);
     // build tree
     for (auto tree : trees) {
       Builder builder(
@@ -175,9 +175,10 @@ class ColMaker: public TreeUpdater {
       this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
       for (int depth = 0; depth < param_.max_depth; ++depth) {
         this->FindSplit(depth, qexpand_, gpair, p_fmat, p_tree);
-        this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        // also collects the per thread statistics of the new nodes
+        this->ResetPosition(qexpand_, gpair, p_fmat, *p_tree);
         this->UpdateQueueExpand(*p_tree, qexpand_, &newnodes);
-        this->InitNewNode(newnodes, gpair, *p_fmat, *p_tree);
+        this->InitNodeEntries(newnodes, *p_tree);
         for (auto nid : qexpand_) {
           if ((*p_tree)[nid].IsLeaf()) {
             continue;
@@ -263,13 +264,7 @@ class ColMaker: public TreeUpdater {
                             const std::vector<GradientPair>& gpair,
                             const DMatrix& fmat,
                             const RegTree& tree) {
-      {
-        // setup statistics space for each tree node
-        for (auto& i : stemp_) {
-          i.resize(tree.param.num_nodes, ThreadEntry());
-        }
-        snode_.resize(tree.param.num_nodes, NodeEntry());
-      }
+      this->ResizeNodeEntries(tree);
       const MetaInfo& info = fmat.Info();
       // setup position
       const auto ndata = static_cast<bst_omp_uint>(info.num_row_);
@@ -279,6 +274,20 @@ class ColMaker: public TreeUpdater {
         if (position_[ridx] < 0) continue;
         stemp_[tid][position_[ridx]].stats.Add(gpair[ridx]);
       }
+      this->InitNodeEntries(qexpand, tree);
+    }
+    /*! \brief setup statistics space for each tree node */
+    inline void ResizeNodeEntries(const RegTree& tree) {
+      for (auto& i : stemp_) {
+        i.resize(tree.param.num_nodes, ThreadEntry());
+      }
+      snode_.resize(tree.param.num_nodes, NodeEntry());
+    }
+    /*!
+     * \brief sum the per thread statistics of the nodes in qexpand, then compute their
+     *  base_weight and root_gain
+     */
+    inline void InitNodeEntries(const std::vector<int>& qexpand, const RegTree& tree) {
       // sum the per thread statistics together
       for (int nid : qexpand) {
         GradStats stats;
@@ -505,10 +514,16 @@ class ColMaker: public TreeUpdater {
         }
       }
     }
-    // reset position of each data points after split is created in the tree
+    /*!
+     * \brief reset position of each data points after split is created in the tree, the
+     *  pass over the rows also sums the per thread statistics of the new nodes, so no
+     *  separate pass is needed before InitNodeEntries.
+     */
     inline void ResetPosition(const std::vector<int> &qexpand,
+                              const std::vector<GradientPair>& gpair,
                               DMatrix* p_fmat,
                               const RegTree& tree) {
+      this->ResizeNodeEntries(tree);
       // set the positions in the nondefault
       this->SetNonDefaultPosition(qexpand, p_fmat, tree);
       // set rest of instances to default position
@@ -535,6 +550,9 @@ class ColMaker: public TreeUpdater {
             this->SetEncodePosition(ridx, tree[nid].RightChild());
           }
         }
+        if (position_[ridx] >= 0) {
+          stemp_[omp_get_thread_num()][position_[ridx]].stats.Add(gpair[ridx]);
+        }
       }
     }
     // customization part
@@ -9,9 +9,11 @@
 #include <xgboost/tree_updater.h>
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include <memory>
 #include <limits>
 #include <queue>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -20,6 +22,7 @@
 #include "xgboost/span.h"
 #include "xgboost/json.h"
 
+#include "../common/categorical.h"
 #include "../common/common.h"
 #include "../common/compressed_iterator.h"
 #include "../common/device_helpers.cuh"
@@ -28,6 +31,7 @@
 #include "../data/ellpack_page.cuh"
 #include "param.h"
 #include "updater_gpu_common.cuh"
+#include "updater_sync.h"
 #include "constraints.cuh"
 #include "gpu_hist/gradient_based_sampler.cuh"
 #include "gpu_hist/row_partitioner.cuh"
@@ -47,6 +51,12 @@ struct GPUHistMakerTrainParam
   int gpu_batch_nrows;
   bool debug_synchronize;
   // declare parameters
+  // maximum number of nodes expanded together
+  int max_expand_batch;
+  // number of local GPUs used by this process
+  int n_gpus;
+  // replay node expansion from CUDA graphs
+  bool use_cuda_graph;
   DMLC_DECLARE_PARAMETER(GPUHistMakerTrainParam) {
     DMLC_DECLARE_FIELD(single_precision_histogram).set_default(false).describe(
         "Use single precision to build histograms.");
@@ -57,6 +67,23 @@ struct GPUHistMakerTrainParam
                   "-1 to use all rows assignted to a GPU, and 0 to auto-deduce");
     DMLC_DECLARE_FIELD(debug_synchronize).set_default(false).describe(
         "Check if all distributed tree are identical after tree construction.");
+    DMLC_DECLARE_FIELD(max_expand_batch)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("Maximum number of nodes expanded together with one set of kernel "
+                  "launches; 0 expands a whole level for depthwise growth and one "
+                  "node at a time for lossguide growth.");
+    DMLC_DECLARE_FIELD(n_gpus)
+        .set_lower_bound(-1)
+        .set_default(1)
+        .describe("Number of GPUs used by this process, starting from gpu_id; -1 to use "
+                  "all visible GPUs. Rows are sharded over the GPUs and histograms are "
+                  "reduced with NCCL.");
+    DMLC_DECLARE_FIELD(use_cuda_graph)
+        .set_default(false)
+        .describe("Capture the histogram and split evaluation launches of each expansion "
+                  "batch into CUDA graphs and replay them for batches of the same shape. "
+                  "Only used for single GPU, non-distributed training.");
   }
 };
 #if !defined(GTEST_TEST)
@@ -100,6 +127,13 @@ struct ExpandEntry {
   }
 };
 
+/*! \brief Upper bound of candidates in one expansion batch, keeps the number
+ *  of children within the y dimension limit of a CUDA grid. */
+constexpr size_t kMaxExpandBatch = 1 << 14;
+/*! \brief Launch configuration of the histogram kernel. */
+constexpr uint32_t kHistBlockThreads = 256;
+constexpr uint32_t kHistItemsPerThread = 8;
+
 inline static bool DepthWise(const ExpandEntry& lhs, const ExpandEntry& rhs) {
   if (lhs.depth == rhs.depth) {
     return lhs.timestamp > rhs.timestamp;  // favor small timestamp
@@ -182,17 +216,23 @@ __device__ void EvaluateFeature(
     const DeviceNodeStats& node, const GPUTrainingParam& param,
     TempStorageT* temp_storage,  // temp memory for cub operations
     int constraint,              // monotonic_constraints
-    const ValueConstraint& value_constraint) {
+    const ValueConstraint& value_constraint,
+    FeatureType feature_type) {
   // Use pointer from cut to indicate begin and end of bins for each feature.
   uint32_t gidx_begin = matrix.info.feature_segments[fidx];  // begining bin
   uint32_t gidx_end = matrix.info.feature_segments[fidx + 1];  // end bin for i^th feature
 
-  // Sum histogram bins for current feature
-  GradientSumT const feature_sum = ReduceFeature<BLOCK_THREADS, ReduceT>(
-      node_histogram.subspan(gidx_begin, gidx_end - gidx_begin), temp_storage);
-
   GradientSumT const parent_sum = GradientSumT(node.sum_gradients);
-  GradientSumT const missing = parent_sum - feature_sum;
+  // Without missing values there is no default direction to choose and the feature
+  // doesn't need to be summed, its sum is the parent sum.
+  bool const has_missing = !matrix.info.is_dense;
+  GradientSumT missing = GradientSumT();
+  if (has_missing) {
+    // Sum histogram bins for current feature
+    GradientSumT const feature_sum = ReduceFeature<BLOCK_THREADS, ReduceT>(
+        node_histogram.subspan(gidx_begin, gidx_end - gidx_begin), temp_storage);
+    missing = parent_sum - feature_sum;
+  }
   float const null_gain = -std::numeric_limits<bst_float>::infinity();
 
   SumCallbackOp<GradientSumT> prefix_op =
@@ -204,14 +244,22 @@ __device__ void EvaluateFeature(
     // Gradient value for current bin.
     GradientSumT bin =
         thread_active ? node_histogram[scan_begin + threadIdx.x] : GradientSumT();
-    ScanT(temp_storage->scan).ExclusiveScan(bin, bin, cub::Sum(), prefix_op);
+    // A categorical split sends a single category to the left, the rows of its bin.
+    bool const is_cat = feature_type == FeatureType::kCategorical;
+    if (!is_cat) {
+      ScanT(temp_storage->scan).ExclusiveScan(bin, bin, cub::Sum(), prefix_op);
+    }
 
     // Whether the gradient of missing values is put to the left side.
     bool missing_left = true;
     float gain = null_gain;
-    if (thread_active) {
+    if (thread_active && has_missing) {
       gain = LossChangeMissing(bin, missing, parent_sum, node.root_gain, param,
                                constraint, value_constraint, missing_left);
+    } else if (thread_active) {
+      gain = value_constraint.CalcSplitGain(param, constraint, GradStats(bin),
+                                            GradStats(parent_sum - bin)) -
+             node.root_gain;
     }
 
     __syncthreads();
@@ -232,12 +280,14 @@ __device__ void EvaluateFeature(
     if (threadIdx.x == block_max.key) {
       int split_gidx = (scan_begin + threadIdx.x) - 1;
       float fvalue;
-      if (split_gidx < static_cast<int>(gidx_begin)) {
+      if (is_cat) {
+        fvalue = static_cast<float>(scan_begin + threadIdx.x - gidx_begin);
+      } else if (split_gidx < static_cast<int>(gidx_begin)) {
         fvalue =  matrix.info.min_fvalue[fidx];
       } else {
         fvalue = matrix.info.gidx_fvalue_map[split_gidx];
       }
-      GradientSumT left = missing_left ? bin + missing : bin;
+      GradientSumT left = missing_left && has_missing ? bin + missing : bin;
       GradientSumT right = parent_sum - left;
       best_split->Update(gain, missing_left ? kLeftDir : kRightDir, fvalue,
                          fidx, GradientPair(left), GradientPair(right), param);
@@ -246,16 +296,26 @@ __device__ void EvaluateFeature(
   }
 }
 
+/*! \brief Inputs for evaluating the split of one node in a batched launch. */
+template <typename GradientSumT>
+struct EvaluateSplitInputs {
+  const GradientSumT* d_node_histogram;
+  size_t histogram_size;
+  const bst_feature_t* d_feature_set;  // Selected features
+  size_t n_features;
+  LBitField64 feature_constraints;  // Allowed features, empty when all are allowed
+  DeviceNodeStats node;
+  ValueConstraint value_constraint;
+  DeviceSplitCandidate* d_split_candidates;  // best split of each feature
+};
+
 template <int BLOCK_THREADS, typename GradientSumT>
 __global__ void EvaluateSplitKernel(
-    common::Span<const GradientSumT> node_histogram,  // histogram for gradients
-    common::Span<const bst_feature_t> feature_set,    // Selected features
-    DeviceNodeStats node,
+    common::Span<const EvaluateSplitInputs<GradientSumT>> d_inputs,  // one for each node
     xgboost::EllpackMatrix matrix,
     GPUTrainingParam gpu_param,
-    common::Span<DeviceSplitCandidate> split_candidates,  // resulting split
-    ValueConstraint value_constraint,
-    common::Span<int> d_monotonic_constraints) {
+    common::Span<int> d_monotonic_constraints,
+    common::Span<FeatureType const> d_feature_types) {
   // KeyValuePair here used as threadIdx.x -> gain_value
   using ArgMaxT = cub::KeyValuePair<int, float>;
   using BlockScanT =
@@ -275,6 +335,13 @@ __global__ void EvaluateSplitKernel(
   DeviceSplitCandidate& best_split = uninitialized_split.Alias();
   __shared__ TempStorage temp_storage;
 
+  // One row of blocks for each node, the grid is sized for the node with the
+  // most features.
+  EvaluateSplitInputs<GradientSumT> const inputs = d_inputs[blockIdx.y];
+  if (blockIdx.x >= inputs.n_features) {
+    return;
+  }
+
   if (threadIdx.x == 0) {
     best_split = DeviceSplitCandidate();
   }
@@ -282,18 +349,29 @@ __global__ void EvaluateSplitKernel(
   __syncthreads();
 
   // One block for each feature. Features are sampled, so fidx != blockIdx.x
-  int fidx = feature_set[blockIdx.x];
+  int fidx = inputs.d_feature_set[blockIdx.x];
+  // Features excluded by interaction constraints keep the invalid candidate.
+  if (inputs.feature_constraints.Size() != 0 && !inputs.feature_constraints.Check(fidx)) {
+    if (threadIdx.x == 0) {
+      inputs.d_split_candidates[blockIdx.x] = best_split;
+    }
+    return;
+  }
 
   int constraint = d_monotonic_constraints[fidx];
+  FeatureType const feature_type =
+      d_feature_types.empty() ? FeatureType::kNumerical : d_feature_types[fidx];
+  common::Span<const GradientSumT> node_histogram(inputs.d_node_histogram,
+                                                  inputs.histogram_size);
   EvaluateFeature<BLOCK_THREADS, SumReduceT, BlockScanT, MaxReduceT>(
-      fidx, node_histogram, matrix, &best_split, node, gpu_param, &temp_storage,
-      constraint, value_constraint);
+      fidx, node_histogram, matrix, &best_split, inputs.node, gpu_param,
+      &temp_storage, constraint, inputs.value_constraint, feature_type);
 
   __syncthreads();
 
   if (threadIdx.x == 0) {
     // Record best loss for each feature
-    split_candidates[blockIdx.x] = best_split;
+    inputs.d_split_candidates[blockIdx.x] = best_split;
   }
 }
 
@@ -340,6 +418,11 @@ class DeviceHistogram {
     return n_bins_ * kNumItemsInGradientSum;
   }
 
+  /*! \brief Number of histograms that are kept before recycling starts. */
+  size_t MaxCachedHistograms() const {
+    return kStopGrowingSize / HistogramSize();
+  }
+
   dh::device_vector<typename GradientSumT::ValueT>& Data() {
     return data_;
   }
@@ -402,40 +485,196 @@ struct CalcWeightTrainParam {
         learning_rate(p.learning_rate) {}
 };
 
+/*! \brief Consecutive features whose histogram bins are built together. */
+struct FeatureGroup {
+  /*! \brief Range of ELLPACK columns read, all columns for sparse data. */
+  uint32_t column_begin;
+  uint32_t column_end;
+  /*! \brief Range of histogram bins of the features. */
+  uint32_t bin_begin;
+  uint32_t bin_end;
+  /*! \brief False only for a single feature with more bins than shared memory. */
+  bool use_shared_memory;
+};
+
+/**
+ * \brief Split features into groups whose bins fit into shared memory, so that
+ *        histograms of wide datasets are still accumulated with shared memory
+ *        atomics, one group at a time.
+ */
+struct FeatureGroups {
+  std::vector<FeatureGroup> groups;
+  dh::device_vector<FeatureGroup> d_groups;
+  /*! \brief Most bins of a group built in shared memory. */
+  uint32_t max_group_bins {0};
+  /*! \brief Most ELLPACK columns read by a group. */
+  uint32_t max_group_columns {0};
+  /*! \brief Whether each feature is stored at its own ELLPACK column. */
+  bool dense {false};
+  /**
+   * \brief Sampled columns of each group, group i reads
+   *        [d_sampled_ptr[i], d_sampled_ptr[i+1]).  Sized once so that the
+   *        buffers captured by CUDA graphs stay valid, unused when empty.
+   */
+  dh::device_vector<uint32_t> d_sampled_columns;
+  dh::device_vector<uint32_t> d_sampled_ptr;
+
+  void Init(EllpackInfo const& info, size_t max_smem_bytes, size_t bin_bytes) {
+    std::vector<uint32_t> feature_segments(info.feature_segments.size());
+    dh::CopyDeviceSpanToVector(&feature_segments, info.feature_segments);
+    size_t const max_bins_in_smem = max_smem_bytes / bin_bytes;
+    size_t const n_features = feature_segments.size() - 1;
+
+    groups.clear();
+    max_group_bins = 0;
+    max_group_columns = 0;
+    size_t begin = 0;
+    while (begin < n_features) {
+      size_t end = begin + 1;
+      while (end < n_features &&
+             feature_segments[end + 1] - feature_segments[begin] <= max_bins_in_smem) {
+        ++end;
+      }
+      FeatureGroup group;
+      group.bin_begin = feature_segments[begin];
+      group.bin_end = feature_segments[end];
+      group.use_shared_memory = group.bin_end - group.bin_begin <= max_bins_in_smem;
+      // Dense rows store every feature at its own column, sparse rows need a
+      // full scan.
+      dense = info.is_dense && info.row_stride == n_features;
+      group.column_begin = static_cast<uint32_t>(dense ? begin : 0);
+      group.column_end = static_cast<uint32_t>(dense ? end : info.row_stride);
+      if (group.use_shared_memory) {
+        max_group_bins = std::max(max_group_bins, group.bin_end - group.bin_begin);
+      }
+      max_group_columns =
+          std::max(max_group_columns, group.column_end - group.column_begin);
+      groups.push_back(group);
+      begin = end;
+    }
+    d_groups = groups;
+    d_sampled_columns.clear();
+    d_sampled_ptr.clear();
+  }
+
+  /**
+   * \brief Only read the sorted columns `features` of dense data, sparse rows
+   *        are always scanned in full.
+   */
+  void SetSampledColumns(std::vector<bst_feature_t> const& features) {
+    if (!dense) {
+      return;
+    }
+    std::vector<uint32_t> columns;
+    std::vector<uint32_t> ptr{0};
+    for (auto const& group : groups) {
+      auto beg = std::lower_bound(features.cbegin(), features.cend(), group.column_begin);
+      auto end = std::lower_bound(beg, features.cend(), group.column_end);
+      columns.insert(columns.end(), beg, end);
+      ptr.push_back(static_cast<uint32_t>(columns.size()));
+    }
+    if (d_sampled_columns.empty()) {
+      d_sampled_columns.resize(groups.back().column_end);
+      d_sampled_ptr.resize(groups.size() + 1);
+    }
+    thrust::copy(columns.cbegin(), columns.cend(), d_sampled_columns.begin());
+    thrust::copy(ptr.cbegin(), ptr.cend(), d_sampled_ptr.begin());
+  }
+};
+
 template <typename GradientSumT>
-__global__ void SharedMemHistKernel(xgboost::EllpackMatrix matrix,
-                                    common::Span<const RowPartitioner::RowIndexT> d_ridx,
-                                    GradientSumT* d_node_hist,
-                                    const GradientPair* d_gpair, size_t n_elements,
-                                    bool use_shared_memory_histograms) {
+__device__ void BuildNodeHistogram(const xgboost::EllpackMatrix& matrix,
+                                   const RowPartitioner::RowIndexT* d_ridx,
+                                   size_t n_rows, GradientSumT* d_node_hist,
+                                   const GradientPair* d_gpair,
+                                   FeatureGroup const& group,
+                                   const uint32_t* d_columns, size_t n_columns,
+                                   bool use_shared_memory_histograms) {
   extern __shared__ char smem[];
   GradientSumT* smem_arr = reinterpret_cast<GradientSumT*>(smem);  // NOLINT
+  uint32_t const n_group_bins = group.bin_end - group.bin_begin;
   if (use_shared_memory_histograms) {
-    dh::BlockFill(smem_arr, matrix.info.n_bins, GradientSumT());
+    dh::BlockFill(smem_arr, n_group_bins, GradientSumT());
     __syncthreads();
   }
+  size_t const n_elements = n_rows * n_columns;
   for (auto idx : dh::GridStrideRange(static_cast<size_t>(0), n_elements)) {
-    int ridx = d_ridx[idx / matrix.info.row_stride];
-    int gidx =
-        matrix.gidx_iter[ridx * matrix.info.row_stride + idx % matrix.info.row_stride];
-    if (gidx != matrix.info.n_bins) {
+    int ridx = d_ridx[idx / n_columns];
+    size_t column = d_columns == nullptr ? group.column_begin + idx % n_columns
+                                         : d_columns[idx % n_columns];
+    uint32_t gidx = matrix.gidx_iter[ridx * matrix.info.row_stride + column];
+    if (matrix.info.is_dense) {
+      // Dense matrices store bins relative to the feature of each column.
+      gidx += matrix.info.feature_segments[column];
+    }
+    // Null entries are n_bins, outside of any group.
+    if (gidx >= group.bin_begin && gidx < group.bin_end) {
       // If we are not using shared memory, accumulate the values directly into
       // global memory
-      GradientSumT* atomic_add_ptr =
-          use_shared_memory_histograms ? smem_arr : d_node_hist;
-      dh::AtomicAddGpair(atomic_add_ptr + gidx, d_gpair[ridx]);
+      GradientSumT* atomic_add_ptr = use_shared_memory_histograms
+                                         ? smem_arr + (gidx - group.bin_begin)
+                                         : d_node_hist + gidx;
+      dh::AtomicAddGpair(atomic_add_ptr, d_gpair[ridx]);
     }
   }
 
   if (use_shared_memory_histograms) {
     // Write shared memory back to global memory
     __syncthreads();
-    for (auto i : dh::BlockStrideRange(static_cast<size_t>(0), matrix.info.n_bins)) {
-      dh::AtomicAddGpair(d_node_hist + i, smem_arr[i]);
+    for (auto i : dh::BlockStrideRange(static_cast<uint32_t>(0), n_group_bins)) {
+      dh::AtomicAddGpair(d_node_hist + group.bin_begin + i, smem_arr[i]);
     }
   }
 }
 
+/*! \brief Rows and output histogram of one node in a batched histogram build. */
+template <typename GradientSumT>
+struct HistogramBuildNode {
+  const RowPartitioner::RowIndexT* d_ridx;
+  size_t n_rows;
+  GradientSumT* d_node_hist;
+};
+
+/**
+ * \brief Build histograms of several nodes in one launch, `blockIdx.y` selects
+ *        the node and `blockIdx.z` the feature group.  When `d_sampled_ptr` is not
+ *        empty only the sampled columns of each group are read.
+ */
+template <typename GradientSumT>
+__global__ void SharedMemHistKernel(xgboost::EllpackMatrix matrix,
+                                    common::Span<const HistogramBuildNode<GradientSumT>> d_nodes,
+                                    common::Span<const FeatureGroup> d_groups,
+                                    common::Span<const uint32_t> d_sampled_columns,
+                                    common::Span<const uint32_t> d_sampled_ptr,
+                                    const GradientPair* d_gpair,
+                                    bool use_shared_memory_histograms) {
+  HistogramBuildNode<GradientSumT> const node = d_nodes[blockIdx.y];
+  FeatureGroup const group = d_groups[blockIdx.z];
+  const uint32_t* d_columns = nullptr;
+  size_t n_columns = group.column_end - group.column_begin;
+  if (!d_sampled_ptr.empty()) {
+    d_columns = d_sampled_columns.data() + d_sampled_ptr[blockIdx.z];
+    n_columns = d_sampled_ptr[blockIdx.z + 1] - d_sampled_ptr[blockIdx.z];
+  }
+  // The grid is sized for the largest node and group, blocks without any work
+  // leave before touching shared memory.
+  size_t n_elements = node.n_rows * n_columns;
+  if (static_cast<size_t>(blockIdx.x) * blockDim.x >= n_elements) {
+    return;
+  }
+  BuildNodeHistogram(matrix, node.d_ridx, node.n_rows, node.d_node_hist, d_gpair,
+                     group, d_columns, n_columns,
+                     use_shared_memory_histograms && group.use_shared_memory);
+}
+
+/*! \brief Histograms of a node pair for the batched subtraction trick. */
+template <typename GradientSumT>
+struct HistogramSubtractionNode {
+  const GradientSumT* d_parent;
+  const GradientSumT* d_histogram;
+  GradientSumT* d_subtraction;
+};
+
 // Manage memory for a single GPU
 template <typename GradientSumT>
 struct GPUHistMakerDevice {
@@ -453,20 +692,43 @@ struct GPUHistMakerDevice {
 
   common::Span<int> monotone_constraints;
   common::Span<bst_float> prediction_cache;
+  /*! \brief Types of the features, empty when all of them are numerical. */
+  std::vector<FeatureType> h_feature_types;
+  dh::device_vector<FeatureType> d_feature_types;
 
   /*! \brief Sum gradient for each node. */
   std::vector<GradientPair> node_sum_gradients;
   common::Span<GradientPair> node_sum_gradients_d;
   bst_uint n_rows;
+  /*! \brief Number of training rows on this device, all rows unless sharded. */
+  bst_uint n_device_rows;
 
   TrainParam param;
   bool prediction_cache_initialised;
   bool use_shared_memory_histograms {false};
+  FeatureGroups feature_groups;
+  /*! \brief Maximum number of candidates expanded in one batch, 0 for automatic. */
+  int max_expand_batch {0};
 
   dh::CubMemory temp_memory;
   dh::PinnedMemory pinned_memory;
-
-  std::vector<cudaStream_t> streams{};
+  /*! \brief Staging buffer for the split evaluation inputs of a batch. */
+  dh::PinnedMemory pinned_inputs;
+
+  /*! \brief Replay histogram building and split evaluation from CUDA graphs. */
+  bool use_cuda_graph {false};
+  cudaStream_t graph_stream {nullptr};
+  cudaEvent_t graph_ready {nullptr};
+  dh::CudaGraphCache graphs;
+  /*! \brief Inputs of the graph launches, reallocating them clears `graphs`. */
+  dh::device_vector<HistogramBuildNode<GradientSumT>> graph_build_nodes;
+  dh::device_vector<HistogramSubtractionNode<GradientSumT>> graph_subtraction_nodes;
+  dh::device_vector<EvaluateSplitInputs<GradientSumT>> graph_split_inputs;
+  dh::device_vector<int> graph_offsets;
+  dh::device_vector<DeviceSplitCandidate> graph_candidates;
+  dh::device_vector<uint8_t> graph_temp_storage;
+  /*! \brief Buffers baked into the captured kernel arguments. */
+  std::vector<size_t> graph_inputs;
 
   common::Monitor monitor;
   std::vector<ValueConstraint> node_value_constraints;
@@ -490,6 +752,7 @@ struct GPUHistMakerDevice {
       : device_id(_device_id),
         page(_page),
         n_rows(_n_rows),
+        n_device_rows(_n_rows),
         param(std::move(_param)),
         prediction_cache_initialised(false),
         column_sampler(column_sampler_seed),
@@ -500,34 +763,19 @@ struct GPUHistMakerDevice {
                                            batch_param,
                                            param.subsample,
                                            param.sampling_method));
-    monitor.Init(std::string("GPUHistMakerDevice") + std::to_string(device_id));
+    monitor.Init(std::string("GPUHistMakerDevice") + std::to_string(device_id),
+                 common::NvtxCategory::kTree);
   }
 
   void InitHistogram();
 
   ~GPUHistMakerDevice() {  // NOLINT
     dh::safe_cuda(cudaSetDevice(device_id));
-    for (auto& stream : streams) {
-      dh::safe_cuda(cudaStreamDestroy(stream));
-    }
-  }
-
-  // Get vector of at least n initialised streams
-  std::vector<cudaStream_t>& GetStreams(int n) {
-    if (n > streams.size()) {
-      for (auto& stream : streams) {
-        dh::safe_cuda(cudaStreamDestroy(stream));
-      }
-
-      streams.clear();
-      streams.resize(n);
-
-      for (auto& stream : streams) {
-        dh::safe_cuda(cudaStreamCreate(&stream));
-      }
+    graphs.Clear();
+    if (graph_stream != nullptr) {
+      dh::safe_cuda(cudaEventDestroy(graph_ready));
+      dh::safe_cuda(cudaStreamDestroy(graph_stream));
     }
-
-    return streams;
   }
 
   // Reset values for each update iteration
@@ -542,6 +790,12 @@ struct GPUHistMakerDevice {
     this->column_sampler.Init(num_columns, param.colsample_bynode,
       param.colsample_bylevel, param.colsample_bytree);
     dh::safe_cuda(cudaSetDevice(device_id));
+    if (param.colsample_bytree < 1.0f) {
+      // Splits only use features of the tree, level sets are resampled per depth
+      // and would break the subtraction trick.
+      feature_groups.SetSampledColumns(
+          this->column_sampler.GetTreeFeatureSet()->ConstHostVector());
+    }
     this->interaction_constraints.Reset();
     std::fill(node_sum_gradients.begin(), node_sum_gradients.end(),
               GradientPair());
@@ -551,86 +805,155 @@ struct GPUHistMakerDevice {
     page = sample.page;
     gpair = sample.gpair;
 
+    auto const& feature_types = dmat->Info().feature_types.ConstHostVector();
+    if (std::any_of(feature_types.cbegin(), feature_types.cend(),
+                    [](FeatureType t) { return t == FeatureType::kCategorical; })) {
+      h_feature_types = feature_types;
+    } else {
+      h_feature_types.clear();
+    }
+    d_feature_types = h_feature_types;
+
+    // Graphs capture the page, gradients and feature types as kernel arguments.
+    std::vector<size_t> inputs{reinterpret_cast<size_t>(page->gidx_buffer.data()),
+                               page->matrix.n_rows,
+                               reinterpret_cast<size_t>(gpair.data()),
+                               reinterpret_cast<size_t>(d_feature_types.data().get()),
+                               d_feature_types.size()};
+    if (inputs != graph_inputs) {
+      graphs.Clear();
+      graph_inputs = inputs;
+    }
+
     row_partitioner.reset();  // Release the device memory first before reallocating
-    row_partitioner.reset(new RowPartitioner(device_id, n_rows));
+    if (sample.rows.empty()) {
+      row_partitioner.reset(new RowPartitioner(device_id, n_rows));
+    } else {
+      row_partitioner.reset(new RowPartitioner(device_id, sample.rows));
+    }
     hist.Reset();
   }
 
-  std::vector<DeviceSplitCandidate> EvaluateSplits(
-      std::vector<int> nidxs, const RegTree& tree,
-      size_t num_columns) {
-    dh::safe_cuda(cudaSetDevice(device_id));
-    auto result_all = pinned_memory.GetSpan<DeviceSplitCandidate>(nidxs.size());
+  /**
+   * \brief Fill the split evaluation inputs of all nodes in `nidxs` and return the
+   *        largest number of features of a node.  Sampled feature sets are read in
+   *        place from `sampled_sets`, which must be kept alive until the evaluation
+   *        finished.  Interaction constraints are applied inside the evaluation kernel
+   *        from the node bitfields, so no per node query is launched here.
+   */
+  size_t PrepareSplitInputs(
+      std::vector<int> const& nidxs, const RegTree& tree, size_t num_columns,
+      common::Span<DeviceSplitCandidate> d_split_candidates_all,
+      std::vector<std::shared_ptr<HostDeviceVector<bst_feature_t>>>* sampled_sets,
+      common::Span<EvaluateSplitInputs<GradientSumT>> h_inputs) {
+    sampled_sets->resize(nidxs.size());
+    size_t max_features = 0;
+    for (auto i = 0ull; i < nidxs.size(); i++) {
+      auto nidx = nidxs[i];
+      auto& sampled_set = sampled_sets->at(i);
+      sampled_set = column_sampler.GetFeatureSet(tree.GetDepth(nidx));
+      sampled_set->SetDevice(device_id);
+      common::Span<bst_feature_t> d_sampled_features = sampled_set->DeviceSpan();
+      auto d_node_hist = hist.GetNodeHistogram(nidx);
+      h_inputs[i] = {d_node_hist.data(), d_node_hist.size(), d_sampled_features.data(),
+                     d_sampled_features.size(),
+                     interaction_constraints.NodeConstraints(nidx),
+                     DeviceNodeStats(node_sum_gradients[nidx], nidx, param),
+                     node_value_constraints[nidx],
+                     d_split_candidates_all.data() + i * num_columns};
+      max_features = std::max(max_features, d_sampled_features.size());
+    }
+    return max_features;
+  }
 
-    // Work out cub temporary memory requirement
+  /*! \brief Bytes of temporary storage used by `LaunchEvaluateSplits` for `n_nodes` nodes. */
+  size_t EvaluateSplitsTempBytes(size_t n_nodes) const {
     GPUTrainingParam gpu_param(param);
     DeviceSplitCandidateReduceOp op(gpu_param);
     size_t temp_storage_bytes = 0;
-    DeviceSplitCandidate*dummy = nullptr;
-    cub::DeviceReduce::Reduce(
-        nullptr, temp_storage_bytes, dummy,
-        dummy, num_columns, op,
+    cub::DeviceSegmentedReduce::Reduce(
+        nullptr, temp_storage_bytes, static_cast<DeviceSplitCandidate*>(nullptr),
+        static_cast<DeviceSplitCandidate*>(nullptr), static_cast<int>(n_nodes),
+        static_cast<int*>(nullptr), static_cast<int*>(nullptr), op,
         DeviceSplitCandidate());
-    // size in terms of DeviceSplitCandidate
-    size_t cub_memory_size =
-      std::ceil(static_cast<double>(temp_storage_bytes) /
-        sizeof(DeviceSplitCandidate));
+    return temp_storage_bytes;
+  }
+
+  /**
+   * \brief Evaluate the best split of all nodes with one kernel launch and one
+   *        segmented reduction over features.  `d_offsets` holds two offsets for
+   *        each node.
+   */
+  void LaunchEvaluateSplits(common::Span<const EvaluateSplitInputs<GradientSumT>> d_inputs,
+                            size_t num_columns, size_t max_features,
+                            common::Span<int> d_offsets,
+                            common::Span<DeviceSplitCandidate> d_split_candidates_all,
+                            common::Span<DeviceSplitCandidate> d_result_all,
+                            common::Span<uint8_t> temp_storage, cudaStream_t stream) {
+    // Begin offsets of every node's candidates followed by end offsets
+    auto d_inputs_ptr = d_inputs.data();
+    auto d_offsets_ptr = d_offsets.data();
+    size_t n_nodes = d_inputs.size();
+    dh::LaunchN(device_id, n_nodes, stream, [=] __device__(size_t i) {
+      d_offsets_ptr[i] = static_cast<int>(i * num_columns);
+      d_offsets_ptr[n_nodes + i] =
+          static_cast<int>(i * num_columns + d_inputs_ptr[i].n_features);
+    });
+
+    // One block for each feature of each node
+    GPUTrainingParam gpu_param(param);
+    uint32_t constexpr kBlockThreads = 256;
+    dim3 grid(static_cast<uint32_t>(max_features), static_cast<uint32_t>(n_nodes));
+    dh::LaunchKernel {grid, dim3(kBlockThreads), 0, stream} (
+        EvaluateSplitKernel<kBlockThreads, GradientSumT>, d_inputs,
+        page->matrix, gpu_param, monotone_constraints,
+        common::Span<FeatureType const>(d_feature_types.data().get(),
+                                        d_feature_types.size()));
+
+    // Reduce over features to find best feature of each node.  Nodes without
+    // any feature get the default DeviceSplitCandidate, which is invalid so
+    // that ApplySplit can reject it.
+    DeviceSplitCandidateReduceOp op(gpu_param);
+    size_t temp_storage_bytes = temp_storage.size();
+    cub::DeviceSegmentedReduce::Reduce(
+        temp_storage.data(), temp_storage_bytes,
+        d_split_candidates_all.data(), d_result_all.data(),
+        static_cast<int>(n_nodes), d_offsets_ptr, d_offsets_ptr + n_nodes, op,
+        DeviceSplitCandidate(), stream);
+  }
+
+  /**
+   * \brief Evaluate the best split of all nodes in `nidxs` with a single kernel
+   *        launch and a single segmented reduction over features.
+   */
+  std::vector<DeviceSplitCandidate> EvaluateSplits(
+      std::vector<int> nidxs, const RegTree& tree,
+      size_t num_columns) {
+    dh::safe_cuda(cudaSetDevice(device_id));
+    auto result_all = pinned_memory.GetSpan<DeviceSplitCandidate>(nidxs.size());
 
-    // Allocate enough temporary memory
     // Result for each nidx
     // + intermediate result for each column
-    // + cub reduce memory
     auto temp_span = temp_memory.GetSpan<DeviceSplitCandidate>(
-        nidxs.size() + nidxs.size() * num_columns +cub_memory_size*nidxs.size());
+        nidxs.size() + nidxs.size() * num_columns);
     auto d_result_all = temp_span.subspan(0, nidxs.size());
     auto d_split_candidates_all =
         temp_span.subspan(d_result_all.size(), nidxs.size() * num_columns);
-    auto d_cub_memory_all =
-        temp_span.subspan(d_result_all.size() + d_split_candidates_all.size(),
-                          cub_memory_size * nidxs.size());
 
-    auto& streams = this->GetStreams(nidxs.size());
-    for (auto i = 0ull; i < nidxs.size(); i++) {
-      auto nidx = nidxs[i];
-      auto p_feature_set = column_sampler.GetFeatureSet(tree.GetDepth(nidx));
-      p_feature_set->SetDevice(device_id);
-      common::Span<bst_feature_t> d_sampled_features = p_feature_set->DeviceSpan();
-      common::Span<bst_feature_t> d_feature_set =
-          interaction_constraints.Query(d_sampled_features, nidx);
-      auto d_split_candidates =
-          d_split_candidates_all.subspan(i * num_columns, d_feature_set.size());
-
-      DeviceNodeStats node(node_sum_gradients[nidx], nidx, param);
-
-      auto d_result = d_result_all.subspan(i, 1);
-      if (d_feature_set.empty()) {
-        // Acting as a device side constructor for DeviceSplitCandidate.
-        // DeviceSplitCandidate::IsValid is false so that ApplySplit can reject this
-        // candidate.
-        auto worst_candidate = DeviceSplitCandidate();
-        dh::safe_cuda(cudaMemcpyAsync(d_result.data(), &worst_candidate,
-                                      sizeof(DeviceSplitCandidate),
-                                      cudaMemcpyHostToDevice));
-        continue;
-      }
-
-      // One block for each feature
-      uint32_t constexpr kBlockThreads = 256;
-      dh::LaunchKernel {uint32_t(d_feature_set.size()), kBlockThreads, 0, streams[i]} (
-          EvaluateSplitKernel<kBlockThreads, GradientSumT>,
-          hist.GetNodeHistogram(nidx), d_feature_set, node, page->matrix,
-          gpu_param, d_split_candidates, node_value_constraints[nidx],
-          monotone_constraints);
-
-      // Reduce over features to find best feature
-      auto d_cub_memory =
-          d_cub_memory_all.subspan(i * cub_memory_size, cub_memory_size);
-      size_t cub_bytes = d_cub_memory.size() * sizeof(DeviceSplitCandidate);
-      cub::DeviceReduce::Reduce(reinterpret_cast<void*>(d_cub_memory.data()),
-                                cub_bytes, d_split_candidates.data(),
-                                d_result.data(), d_split_candidates.size(), op,
-                                DeviceSplitCandidate(), streams[i]);
-    }
+    std::vector<std::shared_ptr<HostDeviceVector<bst_feature_t>>> sampled_sets;
+    auto h_inputs = pinned_inputs.GetSpan<EvaluateSplitInputs<GradientSumT>>(nidxs.size());
+    size_t max_features = this->PrepareSplitInputs(
+        nidxs, tree, num_columns, d_split_candidates_all, &sampled_sets, h_inputs);
+    // All inputs of the batch are sent with one asynchronous copy.
+    dh::caching_device_vector<EvaluateSplitInputs<GradientSumT>> inputs(h_inputs.size());
+    dh::safe_cuda(cudaMemcpyAsync(inputs.data().get(), h_inputs.data(),
+                                  h_inputs.size_bytes(), cudaMemcpyHostToDevice));
+    dh::caching_device_vector<int> offsets(nidxs.size() * 2);
+    dh::caching_device_vector<uint8_t> cub_memory(this->EvaluateSplitsTempBytes(nidxs.size()));
+    this->LaunchEvaluateSplits(
+        {inputs.data().get(), inputs.size()}, num_columns, max_features,
+        {offsets.data().get(), offsets.size()}, d_split_candidates_all, d_result_all,
+        {cub_memory.data().get(), cub_memory.size()}, nullptr);
 
     dh::safe_cuda(cudaMemcpy(result_all.data(), d_result_all.data(),
                              sizeof(DeviceSplitCandidate) * d_result_all.size(),
@@ -640,52 +963,149 @@ struct GPUHistMakerDevice {
 
   void BuildHist(int nidx) {
     hist.AllocateHistogram(nidx);
-    auto d_node_hist = hist.GetNodeHistogram(nidx);
-    auto d_ridx = row_partitioner->GetRows(nidx);
-    auto d_gpair = gpair.data();
+    this->BuildHistBatch({nidx});
+  }
 
-    auto n_elements = d_ridx.size() * page->matrix.info.row_stride;
+  /*! \brief Rows and histograms of `nidxs` for a batched build, returns the most rows of a node. */
+  size_t PrepareHistNodes(std::vector<int> const& nidxs,
+                          std::vector<HistogramBuildNode<GradientSumT>>* h_nodes) {
+    h_nodes->resize(nidxs.size());
+    size_t max_rows = 0;
+    for (size_t i = 0; i < nidxs.size(); ++i) {
+      auto d_ridx = row_partitioner->GetRows(nidxs[i]);
+      h_nodes->at(i) = {d_ridx.data(), d_ridx.size(),
+                        hist.GetNodeHistogram(nidxs[i]).data()};
+      max_rows = std::max(max_rows, d_ridx.size());
+    }
+    return max_rows;
+  }
 
+  /*! \brief Number of blocks along x for histograms of nodes with at most `max_rows` rows. */
+  uint32_t BuildHistGridX(size_t max_rows) const {
+    size_t max_elements = max_rows * feature_groups.max_group_columns;
+    return static_cast<uint32_t>(
+        common::DivRoundUp(max_elements, kHistItemsPerThread * kHistBlockThreads));
+  }
+
+  void LaunchBuildHist(common::Span<const HistogramBuildNode<GradientSumT>> d_nodes,
+                       uint32_t grid_x, cudaStream_t stream) {
     const size_t smem_size =
         use_shared_memory_histograms
-            ? sizeof(GradientSumT) * page->matrix.info.n_bins
+            ? sizeof(GradientSumT) * feature_groups.max_group_bins
             : 0;
-    uint32_t items_per_thread = 8;
-    uint32_t block_threads = 256;
-    auto grid_size = static_cast<uint32_t>(
-        common::DivRoundUp(n_elements, items_per_thread * block_threads));
-    dh::LaunchKernel {grid_size, block_threads, smem_size} (
-        SharedMemHistKernel<GradientSumT>,
-        page->matrix, d_ridx, d_node_hist.data(), d_gpair, n_elements,
-        use_shared_memory_histograms);
-  }
-
-  void SubtractionTrick(int nidx_parent, int nidx_histogram,
-                        int nidx_subtraction) {
-    auto d_node_hist_parent = hist.GetNodeHistogram(nidx_parent);
-    auto d_node_hist_histogram = hist.GetNodeHistogram(nidx_histogram);
-    auto d_node_hist_subtraction = hist.GetNodeHistogram(nidx_subtraction);
-
-    dh::LaunchN(device_id, page->matrix.info.n_bins, [=] __device__(size_t idx) {
-      d_node_hist_subtraction[idx] =
-          d_node_hist_parent[idx] - d_node_hist_histogram[idx];
+    dim3 grid(grid_x, static_cast<uint32_t>(d_nodes.size()),
+              static_cast<uint32_t>(feature_groups.groups.size()));
+    dh::LaunchKernel {grid, dim3(kHistBlockThreads), smem_size, stream} (
+        SharedMemHistKernel<GradientSumT>, page->matrix, d_nodes,
+        common::Span<const FeatureGroup>(feature_groups.d_groups.data().get(),
+                                         feature_groups.d_groups.size()),
+        common::Span<const uint32_t>(feature_groups.d_sampled_columns.data().get(),
+                                     feature_groups.d_sampled_columns.size()),
+        common::Span<const uint32_t>(feature_groups.d_sampled_ptr.data().get(),
+                                     feature_groups.d_sampled_ptr.size()),
+        gpair.data(), use_shared_memory_histograms);
+  }
+
+  /**
+   * \brief Build histograms of all nodes in `nidxs` with a single launch.  The
+   *        histograms must be allocated.
+   */
+  void BuildHistBatch(std::vector<int> const& nidxs) {
+    if (nidxs.empty()) {
+      return;
+    }
+    std::vector<HistogramBuildNode<GradientSumT>> h_nodes;
+    size_t max_rows = this->PrepareHistNodes(nidxs, &h_nodes);
+    dh::caching_device_vector<HistogramBuildNode<GradientSumT>> nodes(h_nodes.size());
+    dh::safe_cuda(cudaMemcpyAsync(nodes.data().get(), h_nodes.data(),
+                                  h_nodes.size() * sizeof(h_nodes.front()),
+                                  cudaMemcpyHostToDevice));
+    this->LaunchBuildHist({nodes.data().get(), nodes.size()},
+                          this->BuildHistGridX(max_rows), nullptr);
+  }
+
+  std::vector<HistogramSubtractionNode<GradientSumT>> PrepareSubtractionNodes(
+      std::vector<int> const& nidx_parent, std::vector<int> const& nidx_histogram,
+      std::vector<int> const& nidx_subtraction) {
+    std::vector<HistogramSubtractionNode<GradientSumT>> h_nodes(nidx_parent.size());
+    for (size_t i = 0; i < nidx_parent.size(); ++i) {
+      h_nodes[i] = {hist.GetNodeHistogram(nidx_parent[i]).data(),
+                    hist.GetNodeHistogram(nidx_histogram[i]).data(),
+                    hist.GetNodeHistogram(nidx_subtraction[i]).data()};
+    }
+    return h_nodes;
+  }
+
+  void LaunchSubtraction(common::Span<const HistogramSubtractionNode<GradientSumT>> d_nodes,
+                         cudaStream_t stream) {
+    auto d_nodes_ptr = d_nodes.data();
+    size_t n_bins = page->matrix.info.n_bins;
+    dh::LaunchN(device_id, n_bins * d_nodes.size(), stream, [=] __device__(size_t idx) {
+      auto const& node = d_nodes_ptr[idx / n_bins];
+      size_t bin = idx % n_bins;
+      node.d_subtraction[bin] = node.d_parent[bin] - node.d_histogram[bin];
     });
   }
 
-  bool CanDoSubtractionTrick(int nidx_parent, int nidx_histogram,
-                             int nidx_subtraction) {
-    // Make sure histograms are already allocated
-    hist.AllocateHistogram(nidx_subtraction);
-    return hist.HistogramExists(nidx_histogram) &&
-           hist.HistogramExists(nidx_parent);
+  /**
+   * \brief Batched version of `SubtractionTrick`, all histograms must exist.
+   */
+  void SubtractionTrickBatch(std::vector<int> const& nidx_parent,
+                             std::vector<int> const& nidx_histogram,
+                             std::vector<int> const& nidx_subtraction) {
+    if (nidx_parent.empty()) {
+      return;
+    }
+    auto h_nodes = this->PrepareSubtractionNodes(nidx_parent, nidx_histogram, nidx_subtraction);
+    dh::caching_device_vector<HistogramSubtractionNode<GradientSumT>> nodes(h_nodes.size());
+    dh::safe_cuda(cudaMemcpyAsync(nodes.data().get(), h_nodes.data(),
+                                  h_nodes.size() * sizeof(h_nodes.front()),
+                                  cudaMemcpyHostToDevice));
+    this->LaunchSubtraction({nodes.data().get(), nodes.size()}, nullptr);
   }
 
-  void UpdatePosition(int nidx, RegTree::Node split_node) {
+  /**
+   * \brief Partition the rows of all expanded candidates into their children.
+   */
+  void UpdatePosition(std::vector<ExpandEntry> const& candidates, RegTree const& tree) {
+    std::vector<bst_node_t> nidx(candidates.size());
+    std::vector<bst_node_t> left_nidx(candidates.size());
+    std::vector<bst_node_t> right_nidx(candidates.size());
+    std::vector<RegTree::Node> h_split_nodes(candidates.size());
+    std::vector<FeatureType> h_split_types(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      nidx[i] = candidates[i].nid;
+      h_split_nodes[i] = tree[candidates[i].nid];
+      h_split_types[i] = tree.NodeSplitType(candidates[i].nid);
+      left_nidx[i] = h_split_nodes[i].LeftChild();
+      right_nidx[i] = h_split_nodes[i].RightChild();
+    }
+    const auto d_split_nodes =
+        temp_memory.GetSpan<RegTree::Node>(h_split_nodes.size());
+    dh::safe_cuda(cudaMemcpyAsync(d_split_nodes.data(), h_split_nodes.data(),
+                                  d_split_nodes.size() * sizeof(RegTree::Node),
+                                  cudaMemcpyHostToDevice));
+    dh::caching_device_vector<FeatureType> split_types(h_split_types);
+    auto d_split_types = split_types.data().get();
     auto d_matrix = page->matrix;
 
-    row_partitioner->UpdatePosition(
-        nidx, split_node.LeftChild(), split_node.RightChild(),
-        [=] __device__(bst_uint ridx) {
+    row_partitioner->UpdatePositionBatch(
+        nidx, left_nidx, right_nidx,
+        [=] __device__(bst_uint ridx, uint32_t node_idx) {
+          RegTree::Node const split_node = d_split_nodes[node_idx];
+          if (d_split_types[node_idx] == FeatureType::kCategorical) {
+            // the category of a row is its bin within the feature, the split sends a
+            // single category to the left
+            auto const fidx = split_node.SplitIndex();
+            auto const gidx = d_matrix.GetBinIndex(ridx, fidx);
+            if (gidx == -1) {
+              return split_node.DefaultChild();
+            }
+            auto const cat = static_cast<bst_cat_t>(
+                gidx - static_cast<int>(d_matrix.info.feature_segments[fidx]));
+            return cat == common::AsCat(split_node.SplitCond()) ? split_node.LeftChild()
+                                                               : split_node.RightChild();
+          }
           // given a row index, returns the node id it belongs to
           bst_float cut_value =
               d_matrix.GetFvalue(ridx, split_node.SplitIndex());
@@ -714,11 +1134,11 @@ struct GPUHistMakerDevice {
                              d_nodes.size() * sizeof(RegTree::Node),
                              cudaMemcpyHostToDevice));
 
-    if (row_partitioner->GetRows().size() != p_fmat->Info().num_row_) {
+    if (row_partitioner->GetRows().size() != n_device_rows) {
       row_partitioner.reset();  // Release the device memory first before reallocating
-      row_partitioner.reset(new RowPartitioner(device_id, p_fmat->Info().num_row_));
+      row_partitioner.reset(new RowPartitioner(device_id, n_device_rows));
     }
-    if (page->matrix.n_rows == p_fmat->Info().num_row_) {
+    if (page->matrix.n_rows == n_device_rows) {
       FinalisePositionInPage(page, d_nodes);
     } else {
       for (auto& batch : p_fmat->GetBatches<EllpackPage>(batch_param)) {
@@ -754,6 +1174,20 @@ struct GPUHistMakerDevice {
     });
   }
 
+  /*! \brief Write the final leaf of each row, before the prediction cache releases them. */
+  bool UpdateLeafIndices(uint32_t* d_out_leaf) {
+    if (!row_partitioner) {
+      return false;
+    }
+    dh::safe_cuda(cudaSetDevice(device_id));
+    auto d_position = row_partitioner->GetPosition();
+    auto d_ridx = row_partitioner->GetRows();
+    dh::LaunchN(device_id, d_ridx.size(), [=] __device__(size_t idx) {
+      d_out_leaf[d_ridx[idx]] = static_cast<uint32_t>(d_position[idx]);
+    });
+    return true;
+  }
+
   void UpdatePredictionCache(bst_float* out_preds_d) {
     dh::safe_cuda(cudaSetDevice(device_id));
     if (!prediction_cache_initialised) {
@@ -788,49 +1222,191 @@ struct GPUHistMakerDevice {
     row_partitioner.reset();
   }
 
-  void AllReduceHist(int nidx, dh::AllReducer* reducer) {
-    monitor.StartCuda("AllReduce");
+  /*! \brief Queue the allreduce of a node histogram, see `AllReduceHistBatch'. */
+  void EnqueueAllReduceHist(int nidx, dh::AllReducer* reducer) {
     auto d_node_hist = hist.GetNodeHistogram(nidx).data();
     reducer->AllReduceSum(
         reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
         reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
-        page->matrix.info.n_bins * (sizeof(GradientSumT) / sizeof(typename GradientSumT::ValueT)));
+        page->matrix.info.n_bins *
+            (sizeof(GradientSumT) / sizeof(typename GradientSumT::ValueT)));
+  }
+
+  /**
+   * \brief Reduce the histograms of all nodes in `nidxs` as one NCCL group, so a level
+   *        pays the latency of a single collective and synchronises only once.
+   */
+  void AllReduceHistBatch(std::vector<int> const& nidxs, dh::AllReducer* reducer) {
+    if (nidxs.empty()) {
+      return;
+    }
+    monitor.StartCuda("AllReduce");
+    reducer->GroupStart();
+    for (auto nidx : nidxs) {
+      this->EnqueueAllReduceHist(nidx, reducer);
+    }
+    reducer->GroupEnd();
     reducer->Synchronize();
 
     monitor.StopCuda("AllReduce");
   }
 
   /**
-   * \brief Build GPU local histograms for the left and right child of some parent node
+   * \brief Choose the smaller child of every expanded candidate for building its
+   *        histogram, the sibling is obtained with the subtraction trick.  All
+   *        child histograms are allocated.
    */
-  void BuildHistLeftRight(const ExpandEntry &candidate, int nidx_left,
-        int nidx_right, dh::AllReducer* reducer) {
-    auto build_hist_nidx = nidx_left;
-    auto subtraction_trick_nidx = nidx_right;
-
-    // Decide whether to build the left histogram or right histogram
-    // Use sum of Hessian as a heuristic to select node with fewest training instances
-    bool fewer_right = candidate.split.right_sum.GetHess() < candidate.split.left_sum.GetHess();
-    if (fewer_right) {
-      std::swap(build_hist_nidx, subtraction_trick_nidx);
+  void AllocateChildHistograms(std::vector<ExpandEntry> const& candidates,
+                               RegTree const& tree, std::vector<int>* build_hist_nidx,
+                               std::vector<int>* subtraction_trick_nidx) {
+    build_hist_nidx->resize(candidates.size());
+    subtraction_trick_nidx->resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      auto const& candidate = candidates[i];
+      build_hist_nidx->at(i) = tree[candidate.nid].LeftChild();
+      subtraction_trick_nidx->at(i) = tree[candidate.nid].RightChild();
+      // Use sum of Hessian as a heuristic to select node with fewest training instances
+      bool fewer_right =
+          candidate.split.right_sum.GetHess() < candidate.split.left_sum.GetHess();
+      if (fewer_right) {
+        std::swap(build_hist_nidx->at(i), subtraction_trick_nidx->at(i));
+      }
+    }
+    // Allocate all histograms before taking pointers into the storage, which
+    // may grow or recycle existing histograms.
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      hist.AllocateHistogram(build_hist_nidx->at(i));
+      hist.AllocateHistogram(subtraction_trick_nidx->at(i));
     }
+    // The batch size is bounded by the histogram capacity, so recycling can
+    // only evict histograms of older nodes.
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      CHECK(hist.HistogramExists(build_hist_nidx->at(i)));
+      CHECK(hist.HistogramExists(subtraction_trick_nidx->at(i)));
+    }
+  }
 
-    this->BuildHist(build_hist_nidx);
-    this->AllReduceHist(build_hist_nidx, reducer);
+  /**
+   * \brief Build GPU local histograms for the children of all expanded
+   *        candidates.  The smaller children are built in one launch and their
+   *        siblings are obtained from the parents with one subtraction launch.
+   */
+  void BuildHistLeftRight(std::vector<ExpandEntry> const& candidates,
+                          std::vector<int> const& build_hist_nidx,
+                          std::vector<int> const& subtraction_trick_nidx,
+                          dh::AllReducer* reducer) {
+    this->BuildHistBatch(build_hist_nidx);
+    this->AllReduceHistBatch(build_hist_nidx, reducer);
+
+    std::vector<int> parent, histogram, subtraction, direct;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (hist.HistogramExists(candidates[i].nid)) {
+        parent.push_back(candidates[i].nid);
+        histogram.push_back(build_hist_nidx[i]);
+        subtraction.push_back(subtraction_trick_nidx[i]);
+      } else {
+        direct.push_back(subtraction_trick_nidx[i]);
+      }
+    }
+    // Calculate other histogram using subtraction trick
+    this->SubtractionTrickBatch(parent, histogram, subtraction);
+    // Calculate other histogram manually where the parent has been recycled
+    this->BuildHistBatch(direct);
+    this->AllReduceHistBatch(direct, reducer);
+  }
 
-    // Check whether we can use the subtraction trick to calculate the other
-    bool do_subtraction_trick = this->CanDoSubtractionTrick(
-        candidate.nid, build_hist_nidx, subtraction_trick_nidx);
+  /*! \brief Pointer to a persistent graph buffer of at least `n` elements. */
+  template <typename T>
+  T* GraphBuffer(dh::device_vector<T>* buffer, size_t n) {
+    if (buffer->size() < n) {
+      // Captured graphs refer to the old allocation.
+      graphs.Clear();
+      buffer->resize(std::max(n, buffer->size() * 2));
+    }
+    return buffer->data().get();
+  }
 
-    if (do_subtraction_trick) {
-      // Calculate other histogram using subtraction trick
-      this->SubtractionTrick(candidate.nid, build_hist_nidx,
-                             subtraction_trick_nidx);
-    } else {
-      // Calculate other histogram manually
-      this->BuildHist(subtraction_trick_nidx);
-      this->AllReduceHist(subtraction_trick_nidx, reducer);
+  /**
+   * \brief Same as `BuildHistLeftRight` followed by `EvaluateSplits` of the
+   *        children, but replays the launch sequence from a CUDA graph.  Node
+   *        specific inputs are copied into persistent device buffers before each
+   *        replay, so graphs only depend on the launch shape.  Histograms are not
+   *        reduced, graphs are only used for single device training.  All parent
+   *        histograms must exist.
+   */
+  std::vector<DeviceSplitCandidate> ExpandWithGraph(
+      std::vector<ExpandEntry> const& candidates,
+      std::vector<int> const& build_hist_nidx,
+      std::vector<int> const& subtraction_trick_nidx,
+      std::vector<int> const& children, RegTree const& tree, size_t num_columns) {
+    dh::safe_cuda(cudaSetDevice(device_id));
+    if (graph_stream == nullptr) {
+      dh::safe_cuda(cudaStreamCreateWithFlags(&graph_stream, cudaStreamNonBlocking));
+      dh::safe_cuda(cudaEventCreateWithFlags(&graph_ready, cudaEventDisableTiming));
+    }
+    std::vector<int> parent(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      parent[i] = candidates[i].nid;
     }
+    std::vector<HistogramBuildNode<GradientSumT>> h_build_nodes;
+    size_t max_rows = this->PrepareHistNodes(build_hist_nidx, &h_build_nodes);
+    auto h_subtraction_nodes =
+        this->PrepareSubtractionNodes(parent, build_hist_nidx, subtraction_trick_nidx);
+
+    size_t n_children = children.size();
+    auto d_build_nodes = this->GraphBuffer(&graph_build_nodes, h_build_nodes.size());
+    auto d_subtraction_nodes =
+        this->GraphBuffer(&graph_subtraction_nodes, h_subtraction_nodes.size());
+    auto d_split_inputs = this->GraphBuffer(&graph_split_inputs, n_children);
+    auto d_offsets = this->GraphBuffer(&graph_offsets, n_children * 2);
+    auto d_candidates =
+        this->GraphBuffer(&graph_candidates, n_children + n_children * num_columns);
+    size_t temp_bytes = this->EvaluateSplitsTempBytes(n_children);
+    auto d_temp = this->GraphBuffer(&graph_temp_storage, temp_bytes);
+    common::Span<DeviceSplitCandidate> d_result_all(d_candidates, n_children);
+    common::Span<DeviceSplitCandidate> d_split_candidates_all(
+        d_candidates + n_children, n_children * num_columns);
+
+    std::vector<std::shared_ptr<HostDeviceVector<bst_feature_t>>> sampled_sets;
+    auto h_inputs = pinned_inputs.GetSpan<EvaluateSplitInputs<GradientSumT>>(n_children);
+    size_t max_features = this->PrepareSplitInputs(
+        children, tree, num_columns, d_split_candidates_all, &sampled_sets, h_inputs);
+
+    // Order the graph after the partitioning and constraint updates of the
+    // default stream.
+    dh::safe_cuda(cudaEventRecord(graph_ready, nullptr));
+    dh::safe_cuda(cudaStreamWaitEvent(graph_stream, graph_ready, 0));
+    dh::safe_cuda(cudaMemcpyAsync(d_build_nodes, h_build_nodes.data(),
+                                  h_build_nodes.size() * sizeof(h_build_nodes.front()),
+                                  cudaMemcpyHostToDevice, graph_stream));
+    dh::safe_cuda(cudaMemcpyAsync(d_subtraction_nodes, h_subtraction_nodes.data(),
+                                  h_subtraction_nodes.size() *
+                                      sizeof(h_subtraction_nodes.front()),
+                                  cudaMemcpyHostToDevice, graph_stream));
+    dh::safe_cuda(cudaMemcpyAsync(d_split_inputs, h_inputs.data(), h_inputs.size_bytes(),
+                                  cudaMemcpyHostToDevice, graph_stream));
+
+    // Round the histogram grid up to a power of two to bound the number of
+    // distinct shapes, the kernel strides over any remaining rows.
+    uint32_t grid_x = 1;
+    while (grid_x < this->BuildHistGridX(max_rows)) {
+      grid_x *= 2;
+    }
+    dh::CudaGraphCache::Key key{h_build_nodes.size(), grid_x, n_children, max_features};
+    graphs.Launch(key, graph_stream, [&](cudaStream_t stream) {
+      this->LaunchBuildHist({d_build_nodes, h_build_nodes.size()}, grid_x, stream);
+      this->LaunchSubtraction({d_subtraction_nodes, h_subtraction_nodes.size()}, stream);
+      this->LaunchEvaluateSplits({d_split_inputs, n_children}, num_columns, max_features,
+                                 {d_offsets, n_children * 2}, d_split_candidates_all,
+                                 d_result_all, {d_temp, temp_bytes}, stream);
+    });
+
+    auto result_all = pinned_memory.GetSpan<DeviceSplitCandidate>(n_children);
+    dh::safe_cuda(cudaMemcpyAsync(result_all.data(), d_result_all.data(),
+                                  d_result_all.size_bytes(), cudaMemcpyDeviceToHost,
+                                  graph_stream));
+    dh::safe_cuda(cudaStreamSynchronize(graph_stream));
+    return std::vector<DeviceSplitCandidate>(result_all.begin(), result_all.end());
   }
 
   void ApplySplit(const ExpandEntry& candidate, RegTree* p_tree) {
@@ -849,10 +1425,23 @@ struct GPUHistMakerDevice {
         node_value_constraints[candidate.nid].CalcWeight(param, left_stats)*param.learning_rate;
     auto right_weight =
         node_value_constraints[candidate.nid].CalcWeight(param, right_stats)*param.learning_rate;
-    tree.ExpandNode(candidate.nid, candidate.split.findex,
-                    candidate.split.fvalue, candidate.split.dir == kLeftDir,
-                    base_weight, left_weight, right_weight,
-                    candidate.split.loss_chg, parent_sum.sum_hess);
+    if (!h_feature_types.empty() &&
+        h_feature_types[candidate.split.findex] == FeatureType::kCategorical) {
+      // one category goes to the left
+      auto const cat = common::AsCat(candidate.split.fvalue);
+      std::vector<uint64_t> split_cats(common::CatBitField::ComputeStorageSize(cat + 1), 0);
+      common::CatBitField{common::Span<uint64_t>{split_cats}}.Set(cat);
+      tree.ExpandCategorical(candidate.nid, candidate.split.findex,
+                             common::Span<uint64_t const>{split_cats},
+                             candidate.split.fvalue, candidate.split.dir == kLeftDir,
+                             base_weight, left_weight, right_weight,
+                             candidate.split.loss_chg, parent_sum.sum_hess);
+    } else {
+      tree.ExpandNode(candidate.nid, candidate.split.findex,
+                      candidate.split.fvalue, candidate.split.dir == kLeftDir,
+                      base_weight, left_weight, right_weight,
+                      candidate.split.loss_chg, parent_sum.sum_hess);
+    }
     // Set up child constraints
     node_value_constraints.resize(tree.GetNodes().size());
     node_value_constraints[candidate.nid].SetChild(
@@ -873,17 +1462,21 @@ struct GPUHistMakerDevice {
     constexpr int kRootNIdx = 0;
 
     dh::SumReduction(temp_memory, gpair, node_sum_gradients_d, gpair.size());
+    this->BuildHist(kRootNIdx);
+    // Reduce the root sum along with the root histogram in one group.
+    monitor.StartCuda("AllReduce");
+    reducer->GroupStart();
     reducer->AllReduceSum(
         reinterpret_cast<float*>(node_sum_gradients_d.data()),
         reinterpret_cast<float*>(node_sum_gradients_d.data()), 2);
+    this->EnqueueAllReduceHist(kRootNIdx, reducer);
+    reducer->GroupEnd();
     reducer->Synchronize();
+    monitor.StopCuda("AllReduce");
     dh::safe_cuda(cudaMemcpy(node_sum_gradients.data(),
                              node_sum_gradients_d.data(), sizeof(GradientPair),
                              cudaMemcpyDeviceToHost));
 
-    this->BuildHist(kRootNIdx);
-    this->AllReduceHist(kRootNIdx, reducer);
-
     // Remember root stats
     p_tree->Stat(kRootNIdx).sum_hess = node_sum_gradients[kRootNIdx].GetHess();
     auto weight = CalcWeight(param, node_sum_gradients[kRootNIdx]);
@@ -899,6 +1492,33 @@ struct GPUHistMakerDevice {
         ExpandEntry(kRootNIdx, p_tree->GetDepth(kRootNIdx), split.at(0), 0));
   }
 
+  /**
+   * \brief Pop the candidates expanded together in one batch: the whole level
+   *        for depthwise growth or the best `max_expand_batch` entries for
+   *        lossguide growth.
+   */
+  std::vector<ExpandEntry> PopExpandBatch() {
+    // Children of the whole batch must fit into the histogram storage at once.
+    size_t batch_size = std::max(std::min(kMaxExpandBatch, hist.MaxCachedHistograms() / 2),
+                                 static_cast<size_t>(1));
+    if (max_expand_batch > 0) {
+      batch_size = std::min(batch_size, static_cast<size_t>(max_expand_batch));
+    } else if (param.grow_policy == TrainParam::kLossGuide) {
+      batch_size = 1;
+    }
+    std::vector<ExpandEntry> batch{qexpand->top()};
+    qexpand->pop();
+    while (!qexpand->empty() && batch.size() < batch_size) {
+      if (param.grow_policy != TrainParam::kLossGuide &&
+          qexpand->top().depth != batch.front().depth) {
+        break;
+      }
+      batch.push_back(qexpand->top());
+      qexpand->pop();
+    }
+    return batch;
+  }
+
   void UpdateTree(HostDeviceVector<GradientPair>* gpair_all, DMatrix* p_fmat,
                   RegTree* p_tree, dh::AllReducer* reducer) {
     auto& tree = *p_tree;
@@ -915,39 +1535,62 @@ struct GPUHistMakerDevice {
     auto num_leaves = 1;
 
     while (!qexpand->empty()) {
-      ExpandEntry candidate = qexpand->top();
-      qexpand->pop();
-      if (!candidate.IsValid(param, num_leaves)) {
+      std::vector<ExpandEntry> batch = this->PopExpandBatch();
+      // Candidates whose children are expanded further
+      std::vector<ExpandEntry> expand;
+      for (auto const& candidate : batch) {
+        if (!candidate.IsValid(param, num_leaves)) {
+          continue;
+        }
+        this->ApplySplit(candidate, p_tree);
+
+        num_leaves++;
+
+        int left_child_nidx = tree[candidate.nid].LeftChild();
+        // Only create child entries if needed
+        if (ExpandEntry::ChildIsValid(param, tree.GetDepth(left_child_nidx),
+                                      num_leaves)) {
+          expand.push_back(candidate);
+        }
+      }
+      if (expand.empty()) {
         continue;
       }
-      this->ApplySplit(candidate, p_tree);
-
-      num_leaves++;
 
-      int left_child_nidx = tree[candidate.nid].LeftChild();
-      int right_child_nidx = tree[candidate.nid].RightChild();
-      // Only create child entries if needed
-      if (ExpandEntry::ChildIsValid(param, tree.GetDepth(left_child_nidx),
-                                    num_leaves)) {
-        monitor.StartCuda("UpdatePosition");
-        this->UpdatePosition(candidate.nid, (*p_tree)[candidate.nid]);
-        monitor.StopCuda("UpdatePosition");
+      monitor.StartCuda("UpdatePosition");
+      this->UpdatePosition(expand, tree);
+      monitor.StopCuda("UpdatePosition");
 
+      std::vector<int> children;
+      for (auto const& candidate : expand) {
+        children.push_back(tree[candidate.nid].LeftChild());
+        children.push_back(tree[candidate.nid].RightChild());
+      }
+      std::vector<int> build_hist_nidx, subtraction_trick_nidx;
+      this->AllocateChildHistograms(expand, tree, &build_hist_nidx, &subtraction_trick_nidx);
+      bool parents_cached = std::all_of(
+          expand.cbegin(), expand.cend(),
+          [&](ExpandEntry const& e) { return hist.HistogramExists(e.nid); });
+
+      std::vector<DeviceSplitCandidate> splits;
+      if (use_cuda_graph && parents_cached) {
+        monitor.StartCuda("ExpandWithGraph");
+        splits = this->ExpandWithGraph(expand, build_hist_nidx, subtraction_trick_nidx,
+                                       children, tree, p_fmat->Info().num_col_);
+        monitor.StopCuda("ExpandWithGraph");
+      } else {
         monitor.StartCuda("BuildHist");
-        this->BuildHistLeftRight(candidate, left_child_nidx, right_child_nidx, reducer);
+        this->BuildHistLeftRight(expand, build_hist_nidx, subtraction_trick_nidx, reducer);
         monitor.StopCuda("BuildHist");
 
         monitor.StartCuda("EvaluateSplits");
-        auto splits = this->EvaluateSplits({left_child_nidx, right_child_nidx},
-                                           *p_tree, p_fmat->Info().num_col_);
+        splits = this->EvaluateSplits(children, *p_tree, p_fmat->Info().num_col_);
         monitor.StopCuda("EvaluateSplits");
+      }
 
-        qexpand->push(ExpandEntry(left_child_nidx,
-                                   tree.GetDepth(left_child_nidx), splits.at(0),
-                                   timestamp++));
-        qexpand->push(ExpandEntry(right_child_nidx,
-                                   tree.GetDepth(right_child_nidx),
-                                   splits.at(1), timestamp++));
+      for (size_t i = 0; i < children.size(); ++i) {
+        qexpand->push(ExpandEntry(children[i], tree.GetDepth(children[i]),
+                                  splits.at(i), timestamp++));
       }
     }
 
@@ -975,14 +1618,11 @@ inline void GPUHistMakerDevice<GradientSumT>::InitHistogram() {
 
   node_sum_gradients.resize(max_nodes);
 
-  // check if we can use shared memory for building histograms
-  // (assuming atleast we need 2 CTAs per SM to maintain decent latency
-  // hiding)
-  auto histogram_size = sizeof(GradientSumT) * page->matrix.info.n_bins;
+  // Features are split into groups whose bins fit into shared memory, so
+  // shared memory is used unless every feature alone is too large.
   auto max_smem = dh::MaxSharedMemory(device_id);
-  if (histogram_size <= max_smem) {
-    use_shared_memory_histograms = true;
-  }
+  feature_groups.Init(page->matrix.info, max_smem, sizeof(GradientSumT));
+  use_shared_memory_histograms = feature_groups.max_group_bins > 0;
 
   // Init histogram
   hist.Init(device_id, page->matrix.info.n_bins);
@@ -998,7 +1638,7 @@ class GPUHistMakerSpecialised {
     hist_maker_param_.UpdateAllowUnknown(args);
     dh::CheckComputeCapability();
 
-    monitor_.Init("updater_gpu_hist");
+    monitor_.Init("updater_gpu_hist", common::NvtxCategory::kTree);
   }
 
   ~GPUHistMakerSpecialised() {  // NOLINT
@@ -1028,14 +1668,42 @@ class GPUHistMakerSpecialised {
     }
 
     param_.learning_rate = lr;
+    size_t allreduce_bytes = 0, allreduce_calls = 0;
+    for (auto const& reducer : reducers_) {
+      allreduce_bytes += reducer->AllReduceBytes();
+      allreduce_calls += reducer->AllReduceCalls();
+    }
+    monitor_.SetCounter("AllReduce bytes", allreduce_bytes);
+    monitor_.SetCounter("AllReduce calls", allreduce_calls);
+    monitor_.SetCounter("Peak device bytes", dh::GlobalMemoryLogger().PeakMemory());
     monitor_.StopCuda("Update");
   }
 
+  /*! \brief Devices used by this process, starting from `gpu_id`. */
+  std::vector<int> LocalDevices() const {
+    int32_t n_visible = common::AllVisibleGPUs();
+    int32_t n_gpus = hist_maker_param_.n_gpus == -1 ? n_visible : hist_maker_param_.n_gpus;
+    CHECK_NE(n_gpus, 0) << "n_gpus must be positive or -1 for all visible GPUs.";
+    CHECK_LE(n_gpus, n_visible) << "Only " << n_visible << " GPUs are visible.";
+    std::vector<int> devices;
+    for (int32_t i = 0; i < n_gpus; ++i) {
+      devices.push_back((device_ + i) % n_visible);
+    }
+    return devices;
+  }
+
   void InitDataOnce(DMatrix* dmat) {
     device_ = generic_param_->gpu_id;
     CHECK_GE(device_, 0) << "Must have at least one device";
     info_ = &dmat->Info();
-    reducer_.Init({device_});
+    devices_ = this->LocalDevices();
+    if (devices_.size() == 1) {
+      reducers_.clear();
+      reducers_.emplace_back(new dh::AllReducer());
+      reducers_.front()->Init(device_);
+    } else {
+      dh::AllReducer::InitGroup(devices_, &reducers_);
+    }
 
     // Synchronise the column sampling seed
     uint32_t column_sampling_seed = common::GlobalRandom()();
@@ -1047,25 +1715,78 @@ class GPUHistMakerSpecialised {
       hist_maker_param_.gpu_batch_nrows,
       generic_param_->gpu_page_size
     };
-    auto page = (*dmat->GetBatches<EllpackPage>(batch_param).begin()).Impl();
-    dh::safe_cuda(cudaSetDevice(device_));
-    maker.reset(new GPUHistMakerDevice<GradientSumT>(device_,
-                                                     page,
-                                                     info_->num_row_,
-                                                     param_,
-                                                     column_sampling_seed,
-                                                     info_->num_col_,
-                                                     batch_param));
+    makers.clear();
+    shard_pages_.clear();
+    shard_rows_begin_ = {0};
+    if (devices_.size() == 1) {
+      auto page = (*dmat->GetBatches<EllpackPage>(batch_param).begin()).Impl();
+      dh::safe_cuda(cudaSetDevice(device_));
+      makers.emplace_back(new GPUHistMakerDevice<GradientSumT>(device_,
+                                                               page,
+                                                               info_->num_row_,
+                                                               param_,
+                                                               column_sampling_seed,
+                                                               info_->num_col_,
+                                                               batch_param));
+    } else {
+      this->InitShards(dmat, batch_param, column_sampling_seed);
+    }
 
     monitor_.StartCuda("InitHistogram");
-    dh::safe_cuda(cudaSetDevice(device_));
-    maker->InitHistogram();
+    for (auto& maker : makers) {
+      dh::safe_cuda(cudaSetDevice(maker->device_id));
+      maker->InitHistogram();
+    }
     monitor_.StopCuda("InitHistogram");
 
+    use_cuda_graph_ = hist_maker_param_.use_cuda_graph;
+    if (use_cuda_graph_ && (makers.size() != 1 || rabit::IsDistributed())) {
+      LOG(WARNING) << "use_cuda_graph is ignored for multi-GPU and distributed training.";
+      use_cuda_graph_ = false;
+    }
+
     p_last_fmat_ = dmat;
     initialised_ = true;
   }
 
+  /**
+   * \brief Split the rows into one contiguous shard for each local device.
+   *        Quantile cuts are computed once and copied to every device.
+   */
+  void InitShards(DMatrix* dmat, BatchParam const& batch_param,
+                  uint32_t column_sampling_seed) {
+    CHECK_EQ(generic_param_->gpu_page_size, 0)
+        << "External memory is not supported with n_gpus > 1.";
+    CHECK_EQ(param_.subsample, 1.0f) << "subsample is not supported with n_gpus > 1.";
+    monitor_.StartCuda("Quantiles");
+    common::HistogramCuts hmat;
+    size_t row_stride = common::DeviceSketch(device_, param_.max_bin,
+                                             hist_maker_param_.gpu_batch_nrows, dmat, &hmat);
+    monitor_.StopCuda("Quantiles");
+
+    size_t const n_rows = info_->num_row_;
+    size_t const shard_size = common::DivRoundUp(n_rows, devices_.size());
+    shard_rows_begin_.clear();
+    for (size_t i = 0; i < devices_.size(); ++i) {
+      size_t row_begin = std::min(i * shard_size, n_rows);
+      size_t row_end = std::min(row_begin + shard_size, n_rows);
+      shard_rows_begin_.push_back(row_begin);
+      BatchParam shard_param = batch_param;
+      shard_param.gpu_id = devices_[i];
+      dh::safe_cuda(cudaSetDevice(devices_[i]));
+      shard_pages_.emplace_back(
+          new EllpackPageImpl(devices_[i], dmat, hmat, row_stride, row_begin, row_end));
+      makers.emplace_back(new GPUHistMakerDevice<GradientSumT>(devices_[i],
+                                                               shard_pages_.back().get(),
+                                                               row_end - row_begin,
+                                                               param_,
+                                                               column_sampling_seed,
+                                                               info_->num_col_,
+                                                               shard_param));
+    }
+    shard_gpair_.resize(devices_.size());
+  }
+
   void InitData(DMatrix* dmat) {
     if (!initialised_) {
       monitor_.StartCuda("InitDataOnce");
@@ -1076,17 +1797,7 @@ class GPUHistMakerSpecialised {
 
   // Only call this method for testing
   void CheckTreesSynchronized(RegTree* local_tree) const {
-    std::string s_model;
-    common::MemoryBufferStream fs(&s_model);
-    int rank = rabit::GetRank();
-    if (rank == 0) {
-      local_tree->Save(&fs);
-    }
-    fs.Seek(0);
-    rabit::Broadcast(&s_model, 0);
-    RegTree reference_tree {};  // rank 0 tree
-    reference_tree.Load(&fs);
-    CHECK(*local_tree == reference_tree);
+    CHECK(TreesSynchronized({local_tree})) << "Trees differ over the workers.";
   }
 
   void UpdateTree(HostDeviceVector<GradientPair>* gpair, DMatrix* p_fmat,
@@ -1096,32 +1807,103 @@ class GPUHistMakerSpecialised {
     monitor_.StopCuda("InitData");
 
     gpair->SetDevice(device_);
-    maker->UpdateTree(gpair, p_fmat, p_tree, &reducer_);
+    for (auto& maker : makers) {
+      maker->max_expand_batch = hist_maker_param_.max_expand_batch;
+      maker->use_cuda_graph = use_cuda_graph_;
+    }
+    if (makers.size() == 1) {
+      makers.front()->UpdateTree(gpair, p_fmat, p_tree, reducers_.front().get());
+      return;
+    }
+
+    // Every device grows the same tree from its own shard, as histograms and
+    // node sums are reduced over all devices.  One host thread drives each
+    // device.
+    monitor_.StartCuda("ShardGradients");
+    for (size_t i = 0; i < makers.size(); ++i) {
+      size_t n_shard_rows = makers[i]->n_device_rows;
+      shard_gpair_[i].SetDevice(devices_[i]);
+      shard_gpair_[i].Resize(n_shard_rows);
+      dh::safe_cuda(cudaMemcpy(shard_gpair_[i].DevicePointer(),
+                               gpair->ConstDevicePointer() + shard_rows_begin_[i],
+                               n_shard_rows * sizeof(GradientPair), cudaMemcpyDefault));
+    }
+    monitor_.StopCuda("ShardGradients");
+
+    std::vector<RegTree> trees(makers.size(), *p_tree);
+    std::vector<std::exception_ptr> errors(makers.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < makers.size(); ++i) {
+      workers.emplace_back([&, i]() {
+        try {
+          dh::safe_cuda(cudaSetDevice(devices_[i]));
+          makers[i]->UpdateTree(&shard_gpair_[i], p_fmat, &trees[i], reducers_[i].get());
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (auto const& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    dh::safe_cuda(cudaSetDevice(device_));
+    CHECK(trees.front() == trees.back()) << "Trees on local devices are not identical.";
+    *p_tree = trees.front();
   }
 
   bool UpdatePredictionCache(const DMatrix* data, HostDeviceVector<bst_float>* p_out_preds) {
-    if (maker == nullptr || p_last_fmat_ == nullptr || p_last_fmat_ != data) {
+    if (makers.empty() || p_last_fmat_ == nullptr || p_last_fmat_ != data) {
       return false;
     }
     monitor_.StartCuda("UpdatePredictionCache");
     p_out_preds->SetDevice(device_);
-    maker->UpdatePredictionCache(p_out_preds->DevicePointer());
+    for (size_t i = 0; i < makers.size(); ++i) {
+      makers[i]->UpdatePredictionCache(p_out_preds->DevicePointer() + shard_rows_begin_[i]);
+    }
+    dh::safe_cuda(cudaSetDevice(device_));
     monitor_.StopCuda("UpdatePredictionCache");
     return true;
   }
 
+  bool UpdateLeafIndices(const DMatrix* data, HostDeviceVector<uint32_t>* out_leaf,
+                         size_t offset) {
+    if (makers.empty() || p_last_fmat_ == nullptr || p_last_fmat_ != data) {
+      return false;
+    }
+    out_leaf->SetDevice(device_);
+    bool written = true;
+    for (size_t i = 0; i < makers.size(); ++i) {
+      written = written && makers[i]->UpdateLeafIndices(out_leaf->DevicePointer() + offset +
+                                                          shard_rows_begin_[i]);
+    }
+    dh::safe_cuda(cudaSetDevice(device_));
+    return written;
+  }
+
   TrainParam param_;   // NOLINT
   MetaInfo* info_{};   // NOLINT
 
-  std::unique_ptr<GPUHistMakerDevice<GradientSumT>> maker;  // NOLINT
+  /*! \brief One maker for each local device. */
+  std::vector<std::unique_ptr<GPUHistMakerDevice<GradientSumT>>> makers;  // NOLINT
 
  private:
   bool initialised_;
+  bool use_cuda_graph_ {false};
 
   GPUHistMakerTrainParam hist_maker_param_;
   GenericParameter const* generic_param_;
 
-  dh::AllReducer reducer_;
+  std::vector<std::unique_ptr<dh::AllReducer>> reducers_;
+  std::vector<int> devices_;
+  /*! \brief ELLPACK pages owned by the shards when training on several devices. */
+  std::vector<std::unique_ptr<EllpackPageImpl>> shard_pages_;
+  std::vector<size_t> shard_rows_begin_;
+  std::vector<HostDeviceVector<GradientPair>> shard_gpair_;
 
   DMatrix* p_last_fmat_;
   int device_{-1};
@@ -1193,6 +1975,15 @@ class GPUHistMaker : public TreeUpdater {
     }
   }
 
+  bool UpdateLeafIndices(const DMatrix* data, HostDeviceVector<uint32_t>* out_leaf,
+                         size_t offset) override {
+    if (hist_maker_param_.single_precision_histogram) {
+      return float_maker_->UpdateLeafIndices(data, out_leaf, offset);
+    } else {
+      return double_maker_->UpdateLeafIndices(data, out_leaf, offset);
+    }
+  }
+
   char const* Name() const override {
     return "grow_gpu_hist";
   }
@@ -446,7 +446,8 @@ class CQHistMaker: public HistMaker {
     }
     if (summary_array_.size() != 0) {
       size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_size);
-      sreducer_.Allreduce(dmlc::BeginPtr(summary_array_), nbytes, summary_array_.size());
+      common::AllreduceSummaries(&sreducer_, dmlc::BeginPtr(summary_array_), nbytes,
+                                 summary_array_.size());
     }
     // now we get the final result of sketch, setup the cut
     this->wspace_.cut.clear();
@@ -648,7 +649,7 @@ class GlobalProposalHistMaker: public CQHistMaker {
                           DMatrix *p_fmat,
                           const std::vector<bst_feature_t> &fset,
                           const RegTree &tree) override {
-    if (this->qexpand_.size() == 1) {
+    if (this->qexpand_.size() == 1 && this->NeedSketch(p_fmat, fset)) {
       cached_rptr_.clear();
       cached_cut_.clear();
     }
@@ -657,6 +658,8 @@ class GlobalProposalHistMaker: public CQHistMaker {
       CQHistMaker::ResetPosAndPropose(gpair, p_fmat, fset, tree);
       cached_rptr_ = this->wspace_.rptr;
       cached_cut_ = this->wspace_.cut;
+      cached_dmatrix_ = p_fmat;
+      cached_fset_ = fset;
     } else {
       this->wspace_.cut.clear();
       this->wspace_.rptr.clear();
@@ -674,6 +677,25 @@ class GlobalProposalHistMaker: public CQHistMaker {
     }
   }
 
+  /*!
+   * \brief Whether the candidate splits are sketched again when a single node is
+   *  expanded.  At the root of a tree the cached ones are kept for
+   *  `sketch_refresh_period` trees, as long as the data and features stay the same.
+   */
+  bool NeedSketch(DMatrix *p_fmat, const std::vector<bst_feature_t> &fset) {
+    int32_t const period = this->param_.sketch_refresh_period;
+    if (this->qexpand_.front() != 0) {
+      return period == 1;
+    }
+    if (p_fmat != cached_dmatrix_ || fset != cached_fset_ ||
+        (period != 0 && n_reused_trees_ + 1 >= period)) {
+      n_reused_trees_ = 0;
+      return true;
+    }
+    ++n_reused_trees_;
+    return false;
+  }
+
   // code to create histogram
   void CreateHist(const std::vector<GradientPair> &gpair,
                   DMatrix *p_fmat,
@@ -738,6 +760,11 @@ class GlobalProposalHistMaker: public CQHistMaker {
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
   std::vector<bst_float> cached_cut_;
+  // data and features the cached cuts are proposed for.
+  DMatrix const* cached_dmatrix_{nullptr};
+  std::vector<bst_feature_t> cached_fset_;
+  // number of trees reusing the cached cuts since they are sketched.
+  int32_t n_reused_trees_{0};
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(LocalHistMaker, "grow_local_histmaker")
@@ -0,0 +1,447 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file updater_multi_hist.cc
+ * \brief Grow multi-output trees from quantized histograms.  The leaves hold a value for
+ *  each output, so rows are partitioned and histograms are built once for all outputs
+ *  instead of once for every output group.
+ */
+#include <dmlc/omp.h>
+#include <rabit/rabit.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "xgboost/base.h"
+#include "xgboost/json.h"
+#include "xgboost/tree_updater.h"
+#include "./param.h"
+#include "../common/hist_util.h"
+#include "../common/random.h"
+#include "../common/timer.h"
+
+namespace xgboost {
+namespace tree {
+
+DMLC_REGISTRY_FILE_TAG(updater_multi_hist);
+
+/*!
+ * \brief Depthwise builder of multi-output trees.  The gradient of row `r' for output `k'
+ *  is `gpair[r * n_targets + k]', histograms store the bins of an output contiguously.
+ */
+class MultiHistMaker : public TreeUpdater {
+  /*! \brief Best split found for a node. */
+  struct SplitCandidate {
+    double loss_chg {0.0};
+    bst_feature_t fidx {std::numeric_limits<bst_feature_t>::max()};
+    // last bin going to the left child
+    uint32_t split_bin {0};
+    float split_value {0.0f};
+    bool default_left {false};
+    std::vector<GradientPairPrecise> left_sum;
+
+    // ties are broken by feature index so the result doesn't depend on thread order
+    bool NeedReplace(double gain, bst_feature_t feature) const {
+      return gain > loss_chg || (gain == loss_chg && feature < fidx);
+    }
+  };
+
+  struct NodeEntry {
+    bst_node_t nid;
+    // rows of the node in `row_indices_'
+    size_t begin;
+    size_t end;
+    std::vector<GradientPairPrecise> sum;
+    std::vector<GradientPairPrecise> hist;
+    SplitCandidate split;
+  };
+
+ public:
+  MultiHistMaker() {
+    monitor_.Init("MultiHistMaker");
+  }
+  char const* Name() const override {
+    return "grow_multi_hist";
+  }
+
+  void Configure(const Args& args) override {
+    param_.UpdateAllowUnknown(args);
+  }
+
+  void LoadConfig(Json const& in) override {
+    auto const& config = get<Object const>(in);
+    fromJson(config.at("train_param"), &this->param_);
+  }
+  void SaveConfig(Json* p_out) const override {
+    auto& out = *p_out;
+    out["train_param"] = toJson(param_);
+  }
+
+  void Update(HostDeviceVector<GradientPair>* gpair, DMatrix* p_fmat,
+              const std::vector<RegTree*>& trees) override {
+    CHECK(p_fmat->SingleColBlock())
+        << "Multi-output trees are not supported with external memory.";
+    CHECK_NE(param_.max_depth, 0) << "Multi-output trees require a positive max_depth.";
+    BatchParam const batch_param{GenericParameter::kCpuId, param_.max_bin, 0};
+    gmat_ = &(*p_fmat->GetBatches<common::GHistIndexMatrix>(batch_param).begin());
+    p_last_fmat_ = nullptr;
+    // rescale learning rate according to size of trees
+    float lr = param_.learning_rate;
+    param_.learning_rate = lr / trees.size();
+    for (auto tree : trees) {
+      this->BuildTree(gpair->ConstHostVector(), p_fmat->Info(), tree);
+    }
+    param_.learning_rate = lr;
+    p_last_fmat_ = p_fmat;
+    p_last_tree_ = trees.size() == 1 ? trees.front() : nullptr;
+  }
+
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    if (data != p_last_fmat_ || p_last_tree_ == nullptr || !all_rows_) {
+      return false;
+    }
+    RegTree const& tree = *p_last_tree_;
+    auto const n_targets = static_cast<size_t>(tree.param.size_leaf_vector);
+    auto& preds = out_preds->HostVector();
+    if (preds.size() != data->Info().num_row_ * n_targets) {
+      return false;
+    }
+    monitor_.Start("UpdatePredictionCache");
+    auto const n_leaves = static_cast<bst_omp_uint>(leaves_.size());
+#pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < n_leaves; ++i) {
+      NodeEntry const& leaf = leaves_[i];
+      bst_float const* values = tree.LeafVector(leaf.nid);
+      for (size_t j = leaf.begin; j < leaf.end; ++j) {
+        size_t const ridx = row_indices_[j];
+        for (size_t k = 0; k < n_targets; ++k) {
+          preds[ridx * n_targets + k] += values[k];
+        }
+      }
+    }
+    monitor_.Stop("UpdatePredictionCache");
+    return true;
+  }
+
+ private:
+  void InitRows(size_t n_rows) {
+    row_indices_.clear();
+    all_rows_ = param_.subsample >= 1.0f;
+    if (all_rows_) {
+      row_indices_.resize(n_rows);
+      std::iota(row_indices_.begin(), row_indices_.end(), 0);
+      return;
+    }
+    auto& rnd = common::GlobalRandom();
+    std::bernoulli_distribution coin_flip(param_.subsample);
+    for (size_t i = 0; i < n_rows; ++i) {
+      if (coin_flip(rnd)) {
+        row_indices_.push_back(i);
+      }
+    }
+  }
+
+  // bin of feature `fidx' in a row, or -1 when the value is missing
+  int64_t RowBin(size_t ridx, bst_feature_t fidx) const {
+    auto const& ptrs = gmat_->cut.Ptrs();
+    size_t const row_begin = gmat_->row_ptr[ridx];
+    size_t const row_end = gmat_->row_ptr[ridx + 1];
+    if (is_dense_) {
+      return gmat_->index[row_begin + fidx];
+    }
+    // bins of a row are sorted by feature
+    size_t lo = row_begin, hi = row_end;
+    while (lo < hi) {
+      size_t const mid = lo + (hi - lo) / 2;
+      if (gmat_->index[mid] < ptrs[fidx]) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == row_end || gmat_->index[lo] >= ptrs[fidx + 1]) {
+      return -1;
+    }
+    return gmat_->index[lo];
+  }
+
+  /*!
+   * \brief Build the histogram of a node.  With fewer outputs than threads the rows are
+   *  split into parts, each having a histogram of its own that is summed afterwards.
+   */
+  void BuildHist(std::vector<GradientPair> const& gpair, size_t n_targets,
+                 NodeEntry* node) {
+    monitor_.Start("BuildHist");
+    size_t const n_bins = gmat_->cut.TotalBins();
+    size_t const hist_size = n_bins * n_targets;
+    size_t const n_rows = node->end - node->begin;
+    auto const nthread = static_cast<size_t>(omp_get_max_threads());
+    size_t const n_parts = std::max(static_cast<size_t>(1),
+                                    std::min(nthread / n_targets, n_rows / kMinPartRows));
+    part_hist_.resize(n_parts * hist_size);
+    std::fill(part_hist_.begin(), part_hist_.end(), GradientPairPrecise());
+    size_t const part_rows = common::DivRoundUp(n_rows, n_parts);
+    auto const n_tasks = static_cast<bst_omp_uint>(n_parts * n_targets);
+#pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint t = 0; t < n_tasks; ++t) {
+      size_t const part = t / n_targets;
+      size_t const k = t % n_targets;
+      GradientPairPrecise* hist = &part_hist_[part * hist_size + k * n_bins];
+      size_t const begin = node->begin + part * part_rows;
+      size_t const end = std::min(node->end, begin + part_rows);
+      for (size_t j = begin; j < end; ++j) {
+        size_t const ridx = row_indices_[j];
+        GradientPairPrecise const g {gpair[ridx * n_targets + k]};
+        for (size_t e = gmat_->row_ptr[ridx]; e < gmat_->row_ptr[ridx + 1]; ++e) {
+          hist[gmat_->index[e]] += g;
+        }
+      }
+    }
+    node->hist.resize(hist_size);
+    auto const n_elements = static_cast<bst_omp_uint>(hist_size);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < n_elements; ++i) {
+      GradientPairPrecise sum;
+      for (size_t part = 0; part < n_parts; ++part) {
+        sum += part_hist_[part * hist_size + i];
+      }
+      node->hist[i] = sum;
+    }
+    rabit::Allreduce<rabit::op::Sum, double>(reinterpret_cast<double*>(node->hist.data()),
+                                             node->hist.size() * 2);
+    monitor_.Stop("BuildHist");
+  }
+
+  double NodeGain(std::vector<GradientPairPrecise> const& sum) const {
+    double gain = 0.0;
+    for (auto const& s : sum) {
+      gain += CalcGain(param_, s.GetGrad(), s.GetHess());
+    }
+    return gain;
+  }
+  static double SumHess(std::vector<GradientPairPrecise> const& sum) {
+    double hess = 0.0;
+    for (auto const& s : sum) {
+      hess += s.GetHess();
+    }
+    return hess;
+  }
+
+  /*!
+   * \brief Evaluate splitting a node at the bin `bin' of `fidx', given the sums of gradient
+   *  of one child.  The sums of the other child are the remainder of the node.
+   */
+  void TryCandidate(NodeEntry const& node, double node_gain, bst_feature_t fidx,
+                    uint32_t bin, bool default_left,
+                    std::vector<GradientPairPrecise> const& child, bool child_is_left,
+                    std::vector<GradientPairPrecise>* p_other, SplitCandidate* best) const {
+    auto& other = *p_other;
+    for (size_t k = 0; k < child.size(); ++k) {
+      other[k] = node.sum[k] - child[k];
+    }
+    if (SumHess(child) < param_.min_child_weight || SumHess(other) < param_.min_child_weight) {
+      return;
+    }
+    double const gain = NodeGain(child) + NodeGain(other) - node_gain;
+    if (!best->NeedReplace(gain, fidx)) {
+      return;
+    }
+    best->loss_chg = gain;
+    best->fidx = fidx;
+    best->split_bin = bin;
+    best->split_value = gmat_->cut.Values()[bin];
+    best->default_left = default_left;
+    best->left_sum = child_is_left ? child : other;
+  }
+
+  /*!
+   * \brief Find the best split of a node.  Missing values go right in the forward scan
+   *  over the bins and left in the backward one, which is skipped for dense data.
+   */
+  void EvaluateSplit(std::vector<bst_feature_t> const& features, NodeEntry* node) {
+    monitor_.Start("EvaluateSplit");
+    size_t const n_targets = node->sum.size();
+    size_t const n_bins = gmat_->cut.TotalBins();
+    auto const& ptrs = gmat_->cut.Ptrs();
+    double const node_gain = this->NodeGain(node->sum);
+    auto const nthread = omp_get_max_threads();
+    std::vector<SplitCandidate> best(nthread);
+    auto const n_features = static_cast<bst_omp_uint>(features.size());
+#pragma omp parallel
+    {
+      std::vector<GradientPairPrecise> child(n_targets), other(n_targets);
+      SplitCandidate& thread_best = best[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+      for (bst_omp_uint i = 0; i < n_features; ++i) {
+        bst_feature_t const fidx = features[i];
+        uint32_t const beg = ptrs[fidx];
+        uint32_t const end = ptrs[fidx + 1];
+        std::fill(child.begin(), child.end(), GradientPairPrecise());
+        for (uint32_t bin = beg; bin + 1 < end; ++bin) {
+          for (size_t k = 0; k < n_targets; ++k) {
+            child[k] += node->hist[k * n_bins + bin];
+          }
+          this->TryCandidate(*node, node_gain, fidx, bin, false, child, true, &other,
+                             &thread_best);
+        }
+        if (is_dense_) {
+          continue;
+        }
+        std::fill(child.begin(), child.end(), GradientPairPrecise());
+        for (uint32_t bin = end - 1; bin > beg; --bin) {
+          for (size_t k = 0; k < n_targets; ++k) {
+            child[k] += node->hist[k * n_bins + bin];
+          }
+          this->TryCandidate(*node, node_gain, fidx, bin - 1, true, child, false, &other,
+                             &thread_best);
+        }
+      }
+    }
+    for (auto& candidate : best) {
+      if (node->split.NeedReplace(candidate.loss_chg, candidate.fidx)) {
+        node->split = std::move(candidate);
+      }
+    }
+    monitor_.Stop("EvaluateSplit");
+  }
+
+  void SetLeaf(NodeEntry const& node, RegTree* p_tree) const {
+    std::vector<bst_float> values(node.sum.size());
+    for (size_t k = 0; k < node.sum.size(); ++k) {
+      values[k] = CalcWeight(param_, node.sum[k].GetGrad(), node.sum[k].GetHess()) *
+                  param_.learning_rate;
+    }
+    p_tree->SetLeafVector(node.nid, values);
+  }
+
+  void BuildTree(std::vector<GradientPair> const& gpair, MetaInfo const& info,
+                 RegTree* p_tree) {
+    monitor_.Start("BuildTree");
+    RegTree& tree = *p_tree;
+    auto const n_targets = static_cast<size_t>(tree.param.size_leaf_vector);
+    CHECK_NE(n_targets, 0) << "grow_multi_hist only grows multi-output trees.";
+    CHECK_EQ(gpair.size(), info.num_row_ * n_targets);
+    is_dense_ = gmat_->IsDense();
+    this->InitRows(info.num_row_);
+    column_sampler_.Init(info.num_col_, param_.colsample_bynode, param_.colsample_bylevel,
+                         param_.colsample_bytree);
+
+    std::vector<NodeEntry> level(1);
+    NodeEntry& root = level.front();
+    root.nid = 0;
+    root.begin = 0;
+    root.end = row_indices_.size();
+    root.sum.resize(n_targets);
+    for (size_t ridx : row_indices_) {
+      for (size_t k = 0; k < n_targets; ++k) {
+        root.sum[k] += GradientPairPrecise{gpair[ridx * n_targets + k]};
+      }
+    }
+    rabit::Allreduce<rabit::op::Sum, double>(reinterpret_cast<double*>(root.sum.data()),
+                                             root.sum.size() * 2);
+    this->BuildHist(gpair, n_targets, &root);
+    leaves_.clear();
+
+    for (int32_t depth = 0; !level.empty(); ++depth) {
+      std::vector<NodeEntry> next;
+      for (auto& node : level) {
+        tree.Stat(node.nid).sum_hess = static_cast<bst_float>(SumHess(node.sum));
+        if (depth < param_.max_depth) {
+          auto const& features = column_sampler_.GetFeatureSet(depth)->ConstHostVector();
+          this->EvaluateSplit(features, &node);
+        }
+        SplitCandidate const& split = node.split;
+        if (depth >= param_.max_depth || split.loss_chg <= kRtEps ||
+            split.loss_chg < param_.min_split_loss) {
+          this->SetLeaf(node, p_tree);
+          node.hist.clear();
+          node.hist.shrink_to_fit();
+          leaves_.push_back(std::move(node));
+          continue;
+        }
+        this->ApplySplit(gpair, n_targets, &node, p_tree, &next);
+      }
+      level = std::move(next);
+    }
+    monitor_.Stop("BuildTree");
+  }
+
+  /*!
+   * \brief Expand a node and partition its rows.  Only the histogram of the smaller child
+   *  is built, the other one is the remainder of the parent.
+   */
+  void ApplySplit(std::vector<GradientPair> const& gpair, size_t n_targets, NodeEntry* p_node,
+                  RegTree* p_tree, std::vector<NodeEntry>* p_next) {
+    NodeEntry& node = *p_node;
+    SplitCandidate const& split = node.split;
+    monitor_.Start("ApplySplit");
+    p_tree->ExpandNode(node.nid, split.fidx, split.split_value, split.default_left, 0.0f,
+                       0.0f, 0.0f, static_cast<bst_float>(split.loss_chg),
+                       static_cast<bst_float>(SumHess(node.sum)));
+    auto mid = std::stable_partition(
+        row_indices_.begin() + node.begin, row_indices_.begin() + node.end,
+        [&](size_t ridx) {
+          int64_t const bin = this->RowBin(ridx, split.fidx);
+          return bin < 0 ? split.default_left : bin <= static_cast<int64_t>(split.split_bin);
+        });
+    size_t const split_pos = mid - row_indices_.begin();
+    monitor_.Stop("ApplySplit");
+
+    NodeEntry left, right;
+    left.nid = (*p_tree)[node.nid].LeftChild();
+    left.begin = node.begin;
+    left.end = split_pos;
+    left.sum = split.left_sum;
+    right.nid = (*p_tree)[node.nid].RightChild();
+    right.begin = split_pos;
+    right.end = node.end;
+    right.sum.resize(n_targets);
+    for (size_t k = 0; k < n_targets; ++k) {
+      right.sum[k] = node.sum[k] - left.sum[k];
+    }
+    // workers must agree on the built child
+    bool const build_left =
+        rabit::IsDistributed() || left.end - left.begin <= right.end - right.begin;
+    NodeEntry& built = build_left ? left : right;
+    NodeEntry& subtracted = build_left ? right : left;
+    this->BuildHist(gpair, n_targets, &built);
+    subtracted.hist = std::move(node.hist);
+    for (size_t i = 0; i < subtracted.hist.size(); ++i) {
+      subtracted.hist[i] = subtracted.hist[i] - built.hist[i];
+    }
+    p_next->push_back(std::move(left));
+    p_next->push_back(std::move(right));
+  }
+
+  // minimum number of rows for a part of the histogram built by one thread
+  static constexpr size_t kMinPartRows = 1024;
+
+  TrainParam param_;
+  common::GHistIndexMatrix const* gmat_ {nullptr};
+  bool is_dense_ {false};
+  common::ColumnSampler column_sampler_;
+  // rows of the tree grouped by node, sampled rows only when subsample is used
+  std::vector<size_t> row_indices_;
+  bool all_rows_ {true};
+  // leaves of the last tree and their rows, for updating the prediction cache
+  std::vector<NodeEntry> leaves_;
+  std::vector<GradientPairPrecise> part_hist_;
+  DMatrix const* p_last_fmat_ {nullptr};
+  RegTree const* p_last_tree_ {nullptr};
+  common::Monitor monitor_;
+};
+
+constexpr size_t MultiHistMaker::kMinPartRows;
+
+XGBOOST_REGISTER_TREE_UPDATER(MultiHistMaker, "grow_multi_hist")
+.describe("Grow multi-output trees using quantized histograms.")
+.set_body(
+    []() {
+      return new MultiHistMaker();
+    });
+}  // namespace tree
+}  // namespace xgboost
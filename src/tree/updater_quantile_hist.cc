@@ -8,13 +8,16 @@
 #include <rabit/rabit.h>
 
 #include <cmath>
+#include <future>
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <queue>
 #include <iomanip>
+#include <limits>
 #include <numeric>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include "xgboost/logging.h"
@@ -28,6 +31,8 @@
 #include "../common/hist_util.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#include "../common/categorical.h"
+#include "../common/hist_batch.h"
 #include "../common/threading_utils.h"
 
 
@@ -36,13 +41,19 @@ namespace tree {
 
 DMLC_REGISTRY_FILE_TAG(updater_quantile_hist);
 
+DMLC_REGISTER_PARAMETER(CPUHistMakerTrainParam);
+
 void QuantileHistMaker::Configure(const Args& args) {
-  // initialize pruner
-  if (!pruner_) {
-    pruner_.reset(TreeUpdater::Create("prune", tparam_));
+  // Splits gaining less than `min_split_loss' are not expanded, as by gpu_hist, so there's
+  // nothing left for the pruner and the trees only need to be synchronized.
+  if (!syncher_) {
+    syncher_.reset(TreeUpdater::Create("sync", tparam_));
   }
-  pruner_->Configure(args);
+  syncher_->Configure(args);
   param_.UpdateAllowUnknown(args);
+  hist_maker_param_.UpdateAllowUnknown(args);
+  common::SetHistISA(static_cast<common::HistISA>(hist_maker_param_.hist_isa));
+  common::SetSketchMethod(static_cast<common::SketchMethod>(hist_maker_param_.sketch_method));
 
   // initialize the split evaluator
   if (!spliteval_) {
@@ -52,17 +63,180 @@ void QuantileHistMaker::Configure(const Args& args) {
   spliteval_->Init(&param_);
 }
 
+int QuantileHistMaker::GradientQuantization() const {
+  if (hist_maker_param_.gradient_quantization == CPUHistMakerTrainParam::kNoQuantization &&
+      tparam_->deterministic) {
+    return CPUHistMakerTrainParam::kInt32Quantization;
+  }
+  return hist_maker_param_.gradient_quantization;
+}
+
+template<typename GradientSumT>
+void QuantileHistMaker::SetBuilder(std::unique_ptr<Builder<GradientSumT>>* builder,
+                                   DMatrix *dmat) {
+  builder->reset(new Builder<GradientSumT>(
+                param_,
+                hist_maker_param_,
+                std::move(syncher_),
+                std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
+                int_constraint_, dmat));
+}
+
+template<typename GradientSumT>
+void QuantileHistMaker::CallBuilderUpdate(const std::unique_ptr<Builder<GradientSumT>>& builder,
+                                          ForestBuilders<GradientSumT>* forest,
+                                          HostDeviceVector<GradientPair> *gpair,
+                                          ElementWiseGradient* grad,
+                                          DMatrix *dmat,
+                                          const std::vector<RegTree *> &trees) {
+  builder->SetThreadGroups(thread_socket_);
+  builder->SetFeatureBundles(hist_maker_param_.feature_bundling ? &bundled_gmat_ : nullptr,
+                             &bundle_feature_offset_);
+  // each concurrent tree needs a few threads for its histograms to pay off
+  size_t const n_groups = std::min({static_cast<size_t>(hist_maker_param_.concurrent_trees),
+                                    trees.size(),
+                                    static_cast<size_t>(omp_get_max_threads())});
+  if (n_groups > 1 && dmat->SingleColBlock() && !rabit::IsDistributed()) {
+    CHECK(grad == nullptr);
+    this->ForestUpdate(builder, forest, n_groups, gpair, dmat, trees);
+    return;
+  }
+  for (auto tree : trees) {
+    builder->SetGradient(grad);
+    builder->Update(*p_gmat_, gmatb_, column_matrix_, gpair, dmat, tree);
+    grad = nullptr;
+  }
+}
+
+template<typename GradientSumT>
+void QuantileHistMaker::ForestUpdate(const std::unique_ptr<Builder<GradientSumT>>& builder,
+                                     ForestBuilders<GradientSumT>* forest, size_t n_groups,
+                                     HostDeviceVector<GradientPair> *gpair,
+                                     DMatrix *dmat,
+                                     const std::vector<RegTree *> &trees) {
+  while (forest->size() < n_groups - 1) {
+    // the syncher of the first builder was taken from `syncher_'
+    std::unique_ptr<TreeUpdater> syncher(TreeUpdater::Create("sync", tparam_));
+    auto const dict = param_.__DICT__();
+    syncher->Configure(Args{dict.cbegin(), dict.cend()});
+    forest->emplace_back(new Builder<GradientSumT>(
+        param_, hist_maker_param_, std::move(syncher),
+        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()), int_constraint_, dmat));
+  }
+  std::vector<Builder<GradientSumT>*> builders {builder.get()};
+  for (size_t g = 0; g + 1 < n_groups; ++g) {
+    builders.push_back((*forest)[g].get());
+  }
+  for (auto* b : builders) {
+    // histograms of a group are reduced together, pinned sockets don't apply
+    b->SetThreadGroups({});
+    b->SetFeatureBundles(hist_maker_param_.feature_bundling ? &bundled_gmat_ : nullptr,
+                         &bundle_feature_offset_);
+  }
+  // Row samples are seeded in the order of trees so they don't depend on the scheduling.
+  std::vector<uint32_t> seeds(trees.size());
+  if (param_.subsample < 1.0f) {
+    for (auto& seed : seeds) {
+      seed = static_cast<uint32_t>(common::GlobalRandom()());
+    }
+  }
+  // synchronized once, the builders only read it
+  gpair->ConstHostVector();
+
+  int const n_threads = omp_get_max_threads();
+#if defined(_OPENMP)
+  int const max_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(max_levels, 2));
+#endif  // defined(_OPENMP)
+  dmlc::OMPException exc;
+#pragma omp parallel for num_threads(n_groups) schedule(static, 1)
+  for (omp_ulong g = 0; g < n_groups; ++g) {  // NOLINT(*)
+    exc.Run([&]() {
+      // the first groups take the remaining threads
+      int const group_threads = n_threads / static_cast<int>(n_groups) +
+                                (static_cast<int>(g) < n_threads % static_cast<int>(n_groups));
+      omp_set_num_threads(group_threads);
+      for (size_t i = g; i < trees.size(); i += n_groups) {
+        if (param_.subsample < 1.0f) {
+          builders[g]->SetSampleSeed(seeds[i]);
+        }
+        builders[g]->Update(*p_gmat_, gmatb_, column_matrix_, gpair, dmat, trees[i]);
+      }
+    });
+  }
+#if defined(_OPENMP)
+  omp_set_max_active_levels(max_levels);
+#endif  // defined(_OPENMP)
+  exc.Rethrow();
+}
+
 void QuantileHistMaker::Update(HostDeviceVector<GradientPair> *gpair,
                                DMatrix *dmat,
                                const std::vector<RegTree *> &trees) {
-  if (dmat != p_last_dmat_ || is_gmat_initialized_ == false) {
-    gmat_.Init(dmat, static_cast<uint32_t>(param_.max_bin));
-    column_matrix_.Init(gmat_, param_.sparse_threshold);
-    if (param_.enable_feature_grouping > 0) {
-      gmatb_.Init(gmat_, column_matrix_, param_);
-    }
-    // A proper solution is puting cut matrix in DMatrix, see:
-    // https://github.com/dmlc/xgboost/issues/5143
+  this->UpdateTrees(gpair, nullptr, dmat, trees);
+}
+
+bool QuantileHistMaker::UpdateWithGradient(ElementWiseGradient* grad,
+                                           HostDeviceVector<GradientPair>* gpair,
+                                           DMatrix* dmat,
+                                           const std::vector<RegTree*>& trees) {
+  // Row sampling and concurrent trees read the whole gradient before the rows are visited.
+  if (param_.subsample < 1.0f || trees.size() != 1) {
+    return false;
+  }
+  gpair->Resize(grad->Size());
+  this->UpdateTrees(gpair, grad, dmat, trees);
+  return true;
+}
+
+void QuantileHistMaker::UpdateTrees(HostDeviceVector<GradientPair>* gpair,
+                                    ElementWiseGradient* grad,
+                                    DMatrix* dmat,
+                                    const std::vector<RegTree*>& trees) {
+  const BatchParam batch_param{GenericParameter::kCpuId, param_.max_bin, 0};
+  // pinned before the quantized matrix is built, so its rows are first touched by the
+  // threads building histograms from them
+  std::unique_ptr<common::ThreadPinning> pinning;
+  thread_socket_.clear();
+  if (hist_maker_param_.numa_aware) {
+    pinning.reset(new common::ThreadPinning(omp_get_max_threads()));
+    thread_socket_ = pinning->Sockets();
+  }
+  if (dmat->SingleColBlock()) {
+    // The quantized matrix is cached by the DMatrix and shared by every booster
+    // training on it, so it's only built once for a given max_bin.
+    GHistIndexMatrix const* p_gmat =
+        &(*dmat->GetBatches<GHistIndexMatrix>(batch_param).begin());
+    if (dmat != p_last_dmat_ || p_gmat != p_gmat_ || is_gmat_initialized_ == false) {
+      p_gmat_ = p_gmat;
+      column_matrix_.Init(*p_gmat_, param_.sparse_threshold);
+      if (param_.enable_feature_grouping > 0) {
+        gmatb_.Init(*p_gmat_, column_matrix_, param_);
+      }
+      if (hist_maker_param_.feature_bundling) {
+        CHECK_EQ(param_.enable_feature_grouping, 0)
+            << "Feature bundling can't be used together with feature grouping.";
+        CHECK(!rabit::IsDistributed())
+            << "Feature bundling is not supported in distributed training.";
+        bundled_gmat_.InitBundles(*p_gmat_, column_matrix_, param_, &bundle_feature_offset_);
+      }
+      is_gmat_initialized_ = true;
+    }
+  } else if (dmat != p_last_dmat_ || is_gmat_initialized_ == false) {
+    // external memory: rows are streamed from quantized pages cached on disk,
+    // only the cuts are kept here
+    CHECK_EQ(param_.enable_feature_grouping, 0)
+        << "Feature grouping is not supported with external memory.";
+    CHECK(!hist_maker_param_.feature_bundling)
+        << "Feature bundling is not supported with external memory.";
+    CHECK(hist_maker_param_.dsplit != CPUHistMakerTrainParam::kColSplit ||
+          !rabit::IsDistributed())
+        << "Column-wise data split is not supported with external memory.";
+    for (auto const& page : dmat->GetBatches<GHistIndexMatrix>(batch_param)) {
+      page_cuts_.InitFromPageCuts(page);
+      break;
+    }
+    p_gmat_ = &page_cuts_;
     is_gmat_initialized_ = true;
   }
   // rescale learning rate according to size of trees
@@ -70,15 +244,27 @@ void QuantileHistMaker::Update(HostDeviceVector<GradientPair> *gpair,
   param_.learning_rate = lr / trees.size();
   int_constraint_.Configure(param_, dmat->Info().num_col_);
   // build tree
-  if (!builder_) {
-    builder_.reset(new Builder(
-        param_,
-        std::move(pruner_),
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
-        int_constraint_, dmat));
-  }
-  for (auto tree : trees) {
-    builder_->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, tree);
+  const int quantization = this->GradientQuantization();
+  if (quantization == CPUHistMakerTrainParam::kInt16Quantization) {
+    if (!int32_builder_) {
+      SetBuilder(&int32_builder_, dmat);
+    }
+    CallBuilderUpdate(int32_builder_, &int32_forest_, gpair, grad, dmat, trees);
+  } else if (quantization == CPUHistMakerTrainParam::kInt32Quantization) {
+    if (!int64_builder_) {
+      SetBuilder(&int64_builder_, dmat);
+    }
+    CallBuilderUpdate(int64_builder_, &int64_forest_, gpair, grad, dmat, trees);
+  } else if (hist_maker_param_.single_precision_histogram) {
+    if (!float_builder_) {
+      SetBuilder(&float_builder_, dmat);
+    }
+    CallBuilderUpdate(float_builder_, &float_forest_, gpair, grad, dmat, trees);
+  } else {
+    if (!double_builder_) {
+      SetBuilder(&double_builder_, dmat);
+    }
+    CallBuilderUpdate(double_builder_, &double_forest_, gpair, grad, dmat, trees);
   }
   param_.learning_rate = lr;
 
@@ -88,42 +274,83 @@ void QuantileHistMaker::Update(HostDeviceVector<GradientPair> *gpair,
 bool QuantileHistMaker::UpdatePredictionCache(
     const DMatrix* data,
     HostDeviceVector<bst_float>* out_preds) {
-  if (!builder_ || param_.subsample < 1.0f) {
+  const int quantization = this->GradientQuantization();
+  if (quantization == CPUHistMakerTrainParam::kInt16Quantization && int32_builder_) {
+    return int32_builder_->UpdatePredictionCache(data, out_preds);
+  } else if (quantization == CPUHistMakerTrainParam::kInt32Quantization && int64_builder_) {
+    return int64_builder_->UpdatePredictionCache(data, out_preds);
+  } else if (quantization != CPUHistMakerTrainParam::kNoQuantization) {
     return false;
+  } else if (hist_maker_param_.single_precision_histogram && float_builder_) {
+    return float_builder_->UpdatePredictionCache(data, out_preds);
+  } else if (double_builder_) {
+    return double_builder_->UpdatePredictionCache(data, out_preds);
   } else {
-    return builder_->UpdatePredictionCache(data, out_preds);
+    return false;
   }
 }
 
-void QuantileHistMaker::Builder::SyncHistograms(
-    int starting_index,
-    int sync_count,
-    RegTree *p_tree) {
-  builder_monitor_.Start("SyncHistograms");
+bool QuantileHistMaker::UpdateLeafIndices(const DMatrix* data,
+                                          HostDeviceVector<uint32_t>* out_leaf,
+                                          size_t offset) {
+  auto& h_leaf = out_leaf->HostVector();
+  CHECK_LE(offset, h_leaf.size());
+  common::Span<uint32_t> leaf(h_leaf.data() + offset, h_leaf.size() - offset);
+  const int quantization = this->GradientQuantization();
+  if (quantization == CPUHistMakerTrainParam::kInt16Quantization && int32_builder_) {
+    return int32_builder_->UpdateLeafIndices(data, leaf);
+  } else if (quantization == CPUHistMakerTrainParam::kInt32Quantization && int64_builder_) {
+    return int64_builder_->UpdateLeafIndices(data, leaf);
+  } else if (quantization != CPUHistMakerTrainParam::kNoQuantization) {
+    return false;
+  } else if (hist_maker_param_.single_precision_histogram && float_builder_) {
+    return float_builder_->UpdateLeafIndices(data, leaf);
+  } else if (double_builder_) {
+    return double_builder_->UpdateLeafIndices(data, leaf);
+  } else {
+    return false;
+  }
+}
 
-  const bool isDistributed = rabit::IsDistributed();
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::MergeLocalHistograms(RegTree *p_tree) {
+  const bool isDistributed = this->RowSplit();
 
   const size_t nbins = hist_builder_.GetNumBins();
   common::BlockedSpace2d space(nodes_for_explicit_hist_build_.size(), [&](size_t node) {
     return nbins;
   }, 1024);
 
+  // sum up histograms within each socket first, the merge below reads one per socket
+  hist_buffer_.ReduceHistInGroups();
   common::ParallelFor2d(space, this->nthread_, [&](size_t node, common::Range1d r) {
     const auto entry = nodes_for_explicit_hist_build_[node];
     auto this_hist = hist_[entry.nid];
     // Merging histograms from each thread into once
     hist_buffer_.ReduceHist(node, r.begin(), r.end());
 
-    if (!(*p_tree)[entry.nid].IsRoot() && entry.sibling_nid > -1 && !isDistributed) {
+    if (!(*p_tree)[entry.nid].IsRoot() && entry.sibling_nid > -1 && !isDistributed &&
+        hist_.RowExists((*p_tree)[entry.nid].Parent())) {
       auto parent_hist = hist_[(*p_tree)[entry.nid].Parent()];
       auto sibling_hist = hist_[entry.sibling_nid];
 
       SubtractionHist(sibling_hist, parent_hist, this_hist, r.begin(), r.end());
     }
   });
+}
 
-  if (isDistributed) {
-    this->histred_.Allreduce(hist_[starting_index].data(), hist_builder_.GetNumBins() * sync_count);
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::SyncHistograms(
+    int starting_index,
+    int sync_count,
+    RegTree *p_tree) {
+  builder_monitor_.Start("SyncHistograms");
+
+  this->MergeLocalHistograms(p_tree);
+
+  if (this->RowSplit()) {
+    CHECK_EQ(static_cast<size_t>(sync_count), nodes_for_explicit_hist_build_.size());
+    this->AllreduceHistograms(nodes_for_explicit_hist_build_);
     // use Subtraction Trick
     for (auto const& node : nodes_for_subtraction_trick_) {
       SubtractionTrick(hist_[node.nid], hist_[node.sibling_nid],
@@ -134,33 +361,249 @@ void QuantileHistMaker::Builder::SyncHistograms(
   builder_monitor_.Stop("SyncHistograms");
 }
 
-void QuantileHistMaker::Builder::BuildHistogramsLossGuide(
-                        ExpandEntry entry,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BuildAndSyncHistogramsPipelined(
+    const GHistIndexMatrix &gmat,
+    const GHistIndexBlockMatrix &gmatb,
+    RegTree *p_tree,
+    const std::vector<GradientPair> &gpair_h) {
+  builder_monitor_.Start("BuildAndSyncHistogramsPipelined");
+  const ExpandList nodes = nodes_for_explicit_hist_build_;
+  // every worker has the same nodes, so the collectives of the chunks line up
+  const size_t n_chunks = std::min(nodes.size(),
+                                   static_cast<size_t>(hist_maker_param_.hist_allreduce_chunks));
+  std::vector<ExpandList> chunks(n_chunks);
+  for (size_t c = 0; c < n_chunks; ++c) {
+    chunks[c].assign(nodes.cbegin() + c * nodes.size() / n_chunks,
+                     nodes.cbegin() + (c + 1) * nodes.size() / n_chunks);
+  }
+
+  // The helper thread is the only one touching nodes_for_explicit_hist_build_ and the
+  // per thread buffers, while the calling thread reads the rows of finished chunks.
+  auto build = [&](size_t c) {
+    nodes_for_explicit_hist_build_ = chunks[c];
+    this->BuildLocalHistograms(gmat, gmatb, p_tree, gpair_h);
+    this->MergeLocalHistograms(p_tree);
+  };
+  if (n_chunks != 0) {
+    build(0);
+  }
+  for (size_t c = 0; c < n_chunks; ++c) {
+    std::future<void> next;
+    if (c + 1 < n_chunks) {
+      next = std::async(std::launch::async, build, c + 1);
+    }
+    this->AllreduceHistograms(chunks[c]);
+    if (next.valid()) {
+      next.get();
+    }
+  }
+  nodes_for_explicit_hist_build_ = nodes;
+
+  // use Subtraction Trick
+  for (auto const& node : nodes_for_subtraction_trick_) {
+    SubtractionTrick(hist_[node.nid], hist_[node.sibling_nid],
+                     hist_[(*p_tree)[node.nid].Parent()]);
+  }
+  builder_monitor_.Stop("BuildAndSyncHistogramsPipelined");
+}
+
+namespace {
+// Call `fn' with every bin of the features of 32 features of a node selected by `mask',
+// and its position in the packed buffer.
+template <typename Fn>
+void ForEachSelectedBin(size_t word, std::vector<uint32_t> const& feature_ptrs,
+                        std::vector<uint32_t> const& mask,
+                        std::vector<size_t> const& offsets, Fn&& fn) {
+  size_t const n_features = feature_ptrs.size() - 1;
+  size_t const n_words = common::DivRoundUp(n_features, 32);
+  size_t const fbegin = (word % n_words) * 32;
+  size_t const fend = std::min(fbegin + 32, n_features);
+  size_t pos = offsets[word];
+  for (size_t fid = fbegin; fid < fend; ++fid) {
+    if ((mask[word] >> (fid - fbegin)) & 1U) {
+      for (uint32_t bin = feature_ptrs[fid]; bin < feature_ptrs[fid + 1]; ++bin) {
+        fn(bin, pos++);
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Allreduce the bins of the features selected by `mask' in `hists', packed one
+ *  after another into `p_buffer' as `WireSumT'.
+ */
+template <typename GradientSumT, typename WireSumT>
+void PackedHistAllreduce(std::vector<GHistRow<GradientSumT>> const& hists,
+                         std::vector<uint32_t> const& feature_ptrs,
+                         std::vector<uint32_t> const& mask,
+                         std::vector<size_t> const& offsets, int nthread,
+                         rabit::Reducer<GradStatsT<WireSumT>,
+                                        GradStatsT<WireSumT>::Reduce>* reducer,
+                         std::vector<GradStatsT<WireSumT>>* p_buffer) {
+  size_t const n_words = common::DivRoundUp(feature_ptrs.size() - 1, 32);
+  auto& buffer = *p_buffer;
+  buffer.resize(offsets.back());
+  if (buffer.empty()) {
+    return;
+  }
+  auto const n_total_words = static_cast<omp_ulong>(mask.size());
+#pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong word = 0; word < n_total_words; ++word) {
+    auto const& hist = hists[word / n_words];
+    ForEachSelectedBin(word, feature_ptrs, mask, offsets, [&](uint32_t bin, size_t pos) {
+      buffer[pos].sum_grad = static_cast<WireSumT>(hist[bin].sum_grad);
+      buffer[pos].sum_hess = static_cast<WireSumT>(hist[bin].sum_hess);
+    });
+  }
+  reducer->Allreduce(buffer.data(), buffer.size());
+  common::Telemetry::AddAllreduceBytes(buffer.size() * sizeof(buffer[0]));
+#pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong word = 0; word < n_total_words; ++word) {
+    auto const& hist = hists[word / n_words];
+    ForEachSelectedBin(word, feature_ptrs, mask, offsets, [&](uint32_t bin, size_t pos) {
+      hist[bin].sum_grad = static_cast<GradientSumT>(buffer[pos].sum_grad);
+      hist[bin].sum_hess = static_cast<GradientSumT>(buffer[pos].sum_hess);
+    });
+  }
+}
+}  // anonymous namespace
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::AllreduceHistograms(
+    const ExpandList& nodes) {
+  if (nodes.empty()) {
+    return;
+  }
+  const size_t nbins = hist_builder_.GetNumBins();
+  const bool to_float =
+      hist_maker_param_.hist_allreduce_precision == CPUHistMakerTrainParam::kFloatPrecision &&
+      std::is_same<GradientSumT, double>::value;
+  const bool skip_empty = hist_maker_param_.hist_allreduce_skip_empty;
+  if (!to_float && !skip_empty) {
+    // recycled histograms are not necessarily adjacent
+    bool contiguous = true;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      contiguous = contiguous && hist_[nodes[i].nid].data() ==
+                                 hist_[nodes[0].nid].data() + i * nbins;
+    }
+    if (contiguous) {
+      this->histred_.Allreduce(hist_[nodes[0].nid].data(), nbins * nodes.size());
+    } else {
+      for (auto const& entry : nodes) {
+        this->histred_.Allreduce(hist_[entry.nid].data(), nbins);
+      }
+    }
+    common::Telemetry::AddAllreduceBytes(nbins * nodes.size() *
+                                         sizeof(*hist_[nodes[0].nid].data()));
+    return;
+  }
+
+  CHECK_EQ(hist_feature_ptrs_.back(), nbins);
+  size_t const n_features = hist_feature_ptrs_.size() - 1;
+  size_t const n_words = common::DivRoundUp(n_features, 32);
+  std::vector<GHistRowT> hists(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    hists[i] = hist_[nodes[i].nid];
+  }
+
+  // A feature is left out only when all its bins in the node are zero on every worker,
+  // so the result is the same as reducing it.
+  hist_allreduce_mask_.assign(nodes.size() * n_words, skip_empty ? 0U : ~0U);
+  auto const n_total_words = static_cast<omp_ulong>(hist_allreduce_mask_.size());
+  if (skip_empty) {
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+    for (omp_ulong word = 0; word < n_total_words; ++word) {
+      auto const& hist = hists[word / n_words];
+      size_t const fbegin = (word % n_words) * 32;
+      size_t const fend = std::min(fbegin + 32, n_features);
+      uint32_t bits = 0;
+      for (size_t fid = fbegin; fid < fend; ++fid) {
+        for (uint32_t bin = hist_feature_ptrs_[fid]; bin < hist_feature_ptrs_[fid + 1]; ++bin) {
+          if (hist[bin].sum_grad != 0 || hist[bin].sum_hess != 0) {
+            bits |= 1U << (fid - fbegin);
+            break;
+          }
+        }
+      }
+      hist_allreduce_mask_[word] = bits;
+    }
+    rabit::Allreduce<rabit::op::BitOR>(hist_allreduce_mask_.data(),
+                                       hist_allreduce_mask_.size());
+    common::Telemetry::AddAllreduceBytes(hist_allreduce_mask_.size() * sizeof(uint32_t));
+  }
+
+  hist_allreduce_offsets_.resize(hist_allreduce_mask_.size() + 1);
+  hist_allreduce_offsets_[0] = 0;
+  for (size_t word = 0; word < hist_allreduce_mask_.size(); ++word) {
+    size_t const fbegin = (word % n_words) * 32;
+    size_t const fend = std::min(fbegin + 32, n_features);
+    size_t n_selected = 0;
+    for (size_t fid = fbegin; fid < fend; ++fid) {
+      if ((hist_allreduce_mask_[word] >> (fid - fbegin)) & 1U) {
+        n_selected += hist_feature_ptrs_[fid + 1] - hist_feature_ptrs_[fid];
+      }
+    }
+    hist_allreduce_offsets_[word + 1] = hist_allreduce_offsets_[word] + n_selected;
+  }
+
+  if (to_float) {
+    PackedHistAllreduce(hists, hist_feature_ptrs_, hist_allreduce_mask_,
+                        hist_allreduce_offsets_, this->nthread_, &float_histred_,
+                        &hist_allreduce_float_buffer_);
+  } else {
+    PackedHistAllreduce(hists, hist_feature_ptrs_, hist_allreduce_mask_,
+                        hist_allreduce_offsets_, this->nthread_, &histred_,
+                        &hist_allreduce_buffer_);
+  }
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BuildHistogramsLossGuide(
+                        const ExpandList& entries,
                         const GHistIndexMatrix &gmat,
                         const GHistIndexBlockMatrix &gmatb,
                         RegTree *p_tree,
                         const std::vector<GradientPair> &gpair_h) {
   nodes_for_explicit_hist_build_.clear();
   nodes_for_subtraction_trick_.clear();
-  nodes_for_explicit_hist_build_.push_back(entry);
-
-  if (entry.sibling_nid > -1) {
-    nodes_for_subtraction_trick_.emplace_back(entry.sibling_nid, entry.nid,
-        p_tree->GetDepth(entry.sibling_nid), 0.0f, 0);
+  for (auto const& entry : entries) {
+    nodes_for_explicit_hist_build_.push_back(entry);
+    if (entry.sibling_nid > -1) {
+      ExpandEntry sibling(entry.sibling_nid, entry.nid,
+                          p_tree->GetDepth(entry.sibling_nid), 0.0f, 0);
+      if (hist_.RowExists((*p_tree)[entry.nid].Parent())) {
+        nodes_for_subtraction_trick_.push_back(sibling);
+      } else {
+        // parent histogram was evicted, build both children
+        nodes_for_explicit_hist_build_.push_back(sibling);
+      }
+    }
   }
 
   int starting_index = std::numeric_limits<int>::max();
   int sync_count = 0;
 
-  AddHistRows(&starting_index, &sync_count);
+  AddHistRows(&starting_index, &sync_count, *p_tree);
   BuildLocalHistograms(gmat, gmatb, p_tree, gpair_h);
   SyncHistograms(starting_index, sync_count, p_tree);
+  FreeParentHistograms(nodes_for_explicit_hist_build_, *p_tree);
+  FreeParentHistograms(nodes_for_subtraction_trick_, *p_tree);
 }
 
 
-void QuantileHistMaker::Builder::AddHistRows(int *starting_index, int *sync_count) {
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::AddHistRows(int *starting_index, int *sync_count,
+                                                          const RegTree& tree) {
   builder_monitor_.Start("AddHistRows");
 
+  // parents are needed for the subtraction trick, everything else may be evicted
+  std::vector<bst_uint> keep;
+  for (auto const& node : nodes_for_subtraction_trick_) {
+    keep.push_back(tree[node.nid].Parent());
+  }
+  hist_.Evict(nodes_for_explicit_hist_build_.size() + nodes_for_subtraction_trick_.size(), keep);
+
   for (auto const& entry : nodes_for_explicit_hist_build_) {
     int nid = entry.nid;
     hist_.AddHistRow(nid);
@@ -176,7 +619,187 @@ void QuantileHistMaker::Builder::AddHistRows(int *starting_index, int *sync_coun
 }
 
 
-void QuantileHistMaker::Builder::BuildLocalHistograms(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::FreeParentHistograms(
+    const ExpandList& nodes, const RegTree& tree) {
+  // expanded nodes are never visited again
+  for (auto const& entry : nodes) {
+    if (!tree[entry.nid].IsRoot() && hist_.RowExists(tree[entry.nid].Parent())) {
+      hist_.FreeHistRow(tree[entry.nid].Parent());
+    }
+  }
+}
+
+template <typename GradientSumT>
+bool QuantileHistMaker::Builder<GradientSumT>::CanSplit(int nid, const RegTree& tree) const {
+  if (tree[nid].IsRoot()) {
+    return true;
+  }
+  if (param_.max_depth > 0 && tree.GetDepth(nid) >= param_.max_depth) {
+    return false;
+  }
+  // the sums of children come with the split of the parent
+  const SplitEntry& split = snode_[tree[nid].Parent()].best;
+  const GradStats& stats = tree[nid].IsLeftChild() ? split.left_sum : split.right_sum;
+  // with some slack for rounding, as the hessian of a child is computed as a difference
+  return stats.sum_hess >= 2.0 * param_.min_child_weight * (1.0 - kRtEps);
+}
+
+template <typename GradientSumT>
+typename QuantileHistMaker::Builder<GradientSumT>::ExpandList
+QuantileHistMaker::Builder<GradientSumT>::NodesToSplit(const ExpandList& nodes,
+                                                       const RegTree& tree) const {
+  ExpandList result(TreeAlloc());
+  for (auto const& entry : nodes) {
+    if (!CanSplit(entry.nid, tree)) {
+      continue;
+    }
+    result.push_back(entry);
+    if (entry.sibling_nid != ExpandEntry::kEmptyNid && !CanSplit(entry.sibling_nid, tree)) {
+      // no subtraction trick for a sibling without a histogram
+      result.back().sibling_nid = ExpandEntry::kEmptyNid;
+    }
+  }
+  return result;
+}
+
+template <typename GradientSumT>
+typename QuantileHistMaker::Builder<GradientSumT>::ExpandList
+QuantileHistMaker::Builder<GradientSumT>::SelectSmallNodes(
+    const ExpandList& nodes) {
+  for (auto const& entry : nodes_for_enumeration_) {
+    enumerated_pos_[entry.nid] = -1;
+  }
+  nodes_for_enumeration_.clear();
+  if (!this->EnumerateSmallNodes()) {
+    return nodes;
+  }
+  ExpandList result(TreeAlloc());
+  for (auto const& entry : nodes) {
+    // the root histogram gives the root statistics of dense data
+    const bool small = entry.nid != ExpandEntry::kRootNid && IsSmallNode(entry.nid) &&
+                       (entry.sibling_nid == ExpandEntry::kEmptyNid ||
+                        IsSmallNode(entry.sibling_nid));
+    if (!small) {
+      result.push_back(entry);
+      continue;
+    }
+    if (enumerated_pos_.size() <= static_cast<size_t>(entry.nid)) {
+      enumerated_pos_.resize(entry.nid + 1, -1);
+    }
+    enumerated_pos_[entry.nid] = static_cast<int32_t>(nodes_for_enumeration_.size());
+    nodes_for_enumeration_.push_back(entry);
+  }
+  return result;
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BuildNodeBins(
+    const GHistIndexMatrix& gmat, const std::vector<GradientPair>& gpair) {
+  if (nodes_for_enumeration_.empty()) {
+    return;
+  }
+  builder_monitor_.Start("BuildNodeBins");
+  const size_t n_nodes = nodes_for_enumeration_.size();
+  node_bins_ptr_.resize(n_nodes + 1);
+  node_bins_size_.resize(n_nodes);
+  node_bins_ptr_[0] = 0;
+  for (size_t i = 0; i < n_nodes; ++i) {
+    const RowSetCollection::Elem rows = row_set_collection_[nodes_for_enumeration_[i].nid];
+    size_t n_entries = 0;
+    for (const size_t* it = rows.begin; it < rows.end; ++it) {
+      n_entries += gmat.row_ptr[*it + 1] - gmat.row_ptr[*it];
+    }
+    node_bins_ptr_[i + 1] = node_bins_ptr_[i] + n_entries;
+  }
+  node_entries_.resize(node_bins_ptr_.back());
+  node_bins_.resize(node_bins_ptr_.back());
+  node_bin_sums_.resize(node_bins_ptr_.back());
+
+  using BinEntry = std::pair<uint32_t, GradientPair>;
+  const auto n = static_cast<omp_ulong>(n_nodes);
+#pragma omp parallel for num_threads(this->nthread_) schedule(dynamic)
+  for (omp_ulong i = 0; i < n; ++i) {
+    const RowSetCollection::Elem rows = row_set_collection_[nodes_for_enumeration_[i].nid];
+    BinEntry* entries = node_entries_.data() + node_bins_ptr_[i];
+    BinEntry* entries_end = entries;
+    for (const size_t* it = rows.begin; it < rows.end; ++it) {
+      for (size_t j = gmat.row_ptr[*it]; j < gmat.row_ptr[*it + 1]; ++j) {
+        *entries_end++ = BinEntry(gmat.index[j], gpair[*it]);
+      }
+    }
+    // stable, so each bin sums up its rows in order like a histogram does
+    std::stable_sort(entries, entries_end, [](BinEntry const& l, BinEntry const& r) {
+      return l.first < r.first;
+    });
+    uint32_t* bins = node_bins_.data() + node_bins_ptr_[i];
+    auto* sums = node_bin_sums_.data() + node_bins_ptr_[i];
+    size_t n_bins = 0;
+    for (const BinEntry* it = entries; it != entries_end; ++it) {
+      if (n_bins == 0 || bins[n_bins - 1] != it->first) {
+        bins[n_bins] = it->first;
+        sums[n_bins] = GradStatsT<GradientSumT>();
+        ++n_bins;
+      }
+      sums[n_bins - 1].Add(static_cast<GradientSumT>(it->second.GetGrad()),
+                           static_cast<GradientSumT>(it->second.GetHess()));
+    }
+    node_bins_size_[i] = n_bins;
+  }
+  builder_monitor_.Stop("BuildNodeBins");
+}
+
+// Convert the floating-point split point of a node into its bin id, -1 indicates that
+// the split point is less than all known cut points.
+inline int32_t SplitCondBin(const RegTree& tree, const int32_t nid,
+                            const common::HistogramCuts& cut) {
+  const bst_uint fid = tree[nid].SplitIndex();
+  const bst_float split_pt = tree[nid].SplitCond();
+  const uint32_t lower_bound = cut.Ptrs()[fid];
+  const uint32_t upper_bound = cut.Ptrs()[fid + 1];
+  int32_t split_cond = -1;
+  CHECK_LT(upper_bound,
+           static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
+  for (uint32_t i = lower_bound; i < upper_bound; ++i) {
+    if (split_pt == cut.Values()[i]) {
+      split_cond = static_cast<int32_t>(i);
+    }
+  }
+  return split_cond;
+}
+
+// Rows of a row set stored in the page.  Rows of every node are sorted, as they are
+// sorted for the root and partitioning is stable.
+inline RowSetCollection::Elem PageRows(const RowSetCollection::Elem rows,
+                                       const GHistIndexMatrix& page) {
+  const size_t page_begin = page.base_rowid;
+  const size_t page_end = page.base_rowid + page.Size();
+  if (rows.Size() == 0 || (*rows.begin >= page_begin && *(rows.end - 1) < page_end)) {
+    return rows;
+  }
+  const size_t* begin = std::lower_bound(rows.begin, rows.end, page_begin);
+  const size_t* end = std::lower_bound(begin, rows.end, page_end);
+  return RowSetCollection::Elem(begin, end, rows.node_id);
+}
+
+namespace {
+// Only double precision histograms are built by a batch, other builders just arrive.
+template <typename GradientSumT>
+bool BuildBatchedRoot(common::HistBatch* batch, GHistIndexMatrix const& gmat,
+                      std::vector<GradientPair> const*, GHistRow<GradientSumT>) {
+  batch->BuildRoot(gmat, nullptr, {});
+  return false;
+}
+
+bool BuildBatchedRoot(common::HistBatch* batch, GHistIndexMatrix const& gmat,
+                      std::vector<GradientPair> const* gpair, GHistRow<double> hist) {
+  batch->BuildRoot(gmat, gpair, hist);
+  return gpair != nullptr;
+}
+}  // anonymous namespace
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BuildLocalHistograms(
     const GHistIndexMatrix &gmat,
     const GHistIndexBlockMatrix &gmatb,
     RegTree *p_tree,
@@ -184,14 +807,22 @@ void QuantileHistMaker::Builder::BuildLocalHistograms(
   builder_monitor_.Start("BuildLocalHistograms");
 
   const size_t n_nodes = nodes_for_explicit_hist_build_.size();
+  const size_t n_feature_blocks = hist_builder_.GetNumFeatureBlocks();
+  constexpr size_t kRowBlockSize = 256;
+  auto n_row_blocks = [&](size_t node) {
+    const int32_t nid = nodes_for_explicit_hist_build_[node].nid;
+    const size_t n_rows = row_set_collection_[nid].Size();
+    return n_rows / kRowBlockSize + !!(n_rows % kRowBlockSize);
+  };
 
-  // create space of size (# rows in each node)
+  // create space of size (# row blocks in each node) x (# feature blocks), one task per
+  // pair. Tasks are ordered feature block major, so a thread keeps updating the same
+  // cache sized slice of its histogram over consecutive row blocks.
   common::BlockedSpace2d space(n_nodes, [&](size_t node) {
-    const int32_t nid = nodes_for_explicit_hist_build_[node].nid;
-    return row_set_collection_[nid].Size();
-  }, 256);
+    return n_row_blocks(node) * n_feature_blocks;
+  }, 1);
 
-  std::vector<GHistRow> target_hists(n_nodes);
+  std::vector<GHistRowT> target_hists(n_nodes);
   for (size_t i = 0; i < n_nodes; ++i) {
     const int32_t nid = nodes_for_explicit_hist_build_[i].nid;
     target_hists[i] = hist_[nid];
@@ -199,23 +830,72 @@ void QuantileHistMaker::Builder::BuildLocalHistograms(
 
   hist_buffer_.Reset(this->nthread_, n_nodes, space, target_hists);
 
-  // Parallel processing by nodes and data in each node
-  common::ParallelFor2d(space, this->nthread_, [&](size_t nid_in_set, common::Range1d r) {
+  // The root covers every row for every booster of a batch, they share the pass.
+  auto batch = common::HistBatch::Find(hist_maker_param_.hist_batch);
+  if (batch && n_nodes == 1 &&
+      nodes_for_explicit_hist_build_.front().nid == ExpandEntry::kRootNid) {
+    const bool whole_matrix = p_paged_fmat_ == nullptr && !UsePackedGradients() &&
+        param_.enable_feature_grouping == 0 && p_bundled_gmat_ == nullptr &&
+        !rabit::IsDistributed() && gmat.row_ptr.size() > 1 &&
+        row_set_collection_[ExpandEntry::kRootNid].Size() + 1 == gmat.row_ptr.size();
+    GHistRowT hist = whole_matrix ? hist_buffer_.GetInitializedHist(0, 0) : GHistRowT{};
+    if (BuildBatchedRoot(batch.get(), gmat, whole_matrix ? &gpair_h : nullptr, hist)) {
+      builder_monitor_.Stop("BuildLocalHistograms");
+      return;
+    }
+  }
+
+  const bool use_packed = UsePackedGradients();
+  const bool use_split = gpair_soa_.Size() != 0;
+  auto build_hist = [&](const GHistIndexMatrix& page, size_t nid_in_set, common::Range1d r) {
     const auto tid = static_cast<unsigned>(omp_get_thread_num());
     const int32_t nid = nodes_for_explicit_hist_build_[nid_in_set].nid;
+    const size_t n_blocks = n_row_blocks(nid_in_set);
+    const size_t feature_block = r.begin() / n_blocks;
+    const size_t row_begin = (r.begin() % n_blocks) * kRowBlockSize;
+    const size_t row_end = std::min(row_begin + kRowBlockSize, row_set_collection_[nid].Size());
 
     auto start_of_row_set = row_set_collection_[nid].begin;
-    auto rid_set = RowSetCollection::Elem(start_of_row_set + r.begin(),
-                                      start_of_row_set + r.end(),
-                                      nid);
-    BuildHist(gpair_h, rid_set, gmat, gmatb, hist_buffer_.GetInitializedHist(tid, nid_in_set));
-  });
+    auto rid_set = PageRows(RowSetCollection::Elem(start_of_row_set + row_begin,
+                                                   start_of_row_set + row_end,
+                                                   nid), page);
+    if (rid_set.Size() == 0) {
+      return;
+    }
+    if (use_packed) {
+      hist_builder_.BuildHistPacked(PackedGradients(nid) + row_begin, rid_set, HistIndex(page),
+                                    hist_buffer_.GetInitializedHist(tid, nid_in_set),
+                                    feature_block);
+    } else if (use_split) {
+      hist_builder_.BuildHist(gpair_soa_, rid_set, HistIndex(page),
+                              hist_buffer_.GetInitializedHist(tid, nid_in_set), feature_block);
+    } else {
+      BuildHist(gpair_h, rid_set, page, gmatb,
+                hist_buffer_.GetInitializedHist(tid, nid_in_set), feature_block);
+    }
+  };
+
+  // Parallel processing by nodes and data in each node, page by page for external memory.
+  // Threads get the same tasks for every page, so they keep accumulating into the same
+  // local histograms.
+  if (p_paged_fmat_) {
+    for (auto const& page : p_paged_fmat_->GetBatches<GHistIndexMatrix>(PageParam())) {
+      common::ParallelFor2d(space, this->nthread_, [&](size_t nid_in_set, common::Range1d r) {
+        build_hist(page, nid_in_set, r);
+      });
+    }
+  } else {
+    common::ParallelFor2d(space, this->nthread_, [&](size_t nid_in_set, common::Range1d r) {
+      build_hist(gmat, nid_in_set, r);
+    });
+  }
 
   builder_monitor_.Stop("BuildLocalHistograms");
 }
 
 
-void QuantileHistMaker::Builder::BuildNodeStats(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BuildNodeStats(
     const GHistIndexMatrix &gmat,
     DMatrix *p_fmat,
     RegTree *p_tree,
@@ -239,18 +919,20 @@ void QuantileHistMaker::Builder::BuildNodeStats(
   builder_monitor_.Stop("BuildNodeStats");
 }
 
-void QuantileHistMaker::Builder::AddSplitsToTree(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::AddSplitsToTree(
           const GHistIndexMatrix &gmat,
           RegTree *p_tree,
           int *num_leaves,
           int depth,
           unsigned *timestamp,
-          std::vector<ExpandEntry>* nodes_for_apply_split,
-          std::vector<ExpandEntry>* temp_qexpand_depth) {
+          ExpandList* nodes_for_apply_split,
+          ExpandList* temp_qexpand_depth) {
   for (auto const& entry : qexpand_depth_wise_) {
     int nid = entry.nid;
 
     if (snode_[nid].best.loss_chg < kRtEps ||
+        snode_[nid].best.loss_chg < param_.min_split_loss ||
         (param_.max_depth > 0 && depth == param_.max_depth) ||
         (param_.max_leaves > 0 && (*num_leaves) == param_.max_leaves)) {
       (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
@@ -262,9 +944,7 @@ void QuantileHistMaker::Builder::AddSplitsToTree(
           spliteval_->ComputeWeight(nid, e.best.left_sum) * param_.learning_rate;
       bst_float right_leaf_weight =
           spliteval_->ComputeWeight(nid, e.best.right_sum) * param_.learning_rate;
-      p_tree->ExpandNode(nid, e.best.SplitIndex(), e.best.split_value,
-                         e.best.DefaultLeft(), e.weight, left_leaf_weight,
-                         right_leaf_weight, e.best.loss_chg, e.stats.sum_hess);
+      this->ExpandBestSplit(nid, left_leaf_weight, right_leaf_weight, p_tree);
 
       int left_id = (*p_tree)[nid].LeftChild();
       int right_id = (*p_tree)[nid].RightChild();
@@ -279,17 +959,20 @@ void QuantileHistMaker::Builder::AddSplitsToTree(
 }
 
 
-void QuantileHistMaker::Builder::EvaluateAndApplySplits(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::EvaluateAndApplySplits(
+    const ExpandList& nodes_to_evaluate,
     const GHistIndexMatrix &gmat,
     const ColumnMatrix &column_matrix,
     RegTree *p_tree,
     int *num_leaves,
     int depth,
     unsigned *timestamp,
-    std::vector<ExpandEntry> *temp_qexpand_depth) {
-  EvaluateSplits(qexpand_depth_wise_, gmat, hist_, *p_tree);
+    ExpandList *temp_qexpand_depth) {
+  // nodes left out keep a best split without gain and become leaves
+  EvaluateSplits(nodes_to_evaluate, gmat, hist_, *p_tree);
 
-  std::vector<ExpandEntry> nodes_for_apply_split;
+  ExpandList nodes_for_apply_split(TreeAlloc());
   AddSplitsToTree(gmat, p_tree, num_leaves, depth, timestamp,
                   &nodes_for_apply_split, temp_qexpand_depth);
 
@@ -302,14 +985,21 @@ void QuantileHistMaker::Builder::EvaluateAndApplySplits(
 // Exception: in distributed setting, we always build the histogram for the left child node
 //    and use 'Subtraction Trick' to built the histogram for the right child node.
 //    This ensures that the workers operate on the same set of tree nodes.
-void QuantileHistMaker::Builder::SplitSiblings(const std::vector<ExpandEntry>& nodes,
-                   std::vector<ExpandEntry>* small_siblings,
-                   std::vector<ExpandEntry>* big_siblings,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::SplitSiblings(const ExpandList& nodes,
+                   ExpandList* small_siblings,
+                   ExpandList* big_siblings,
                    RegTree *p_tree) {
   for (auto const& entry : nodes) {
     int nid = entry.nid;
     RegTree::Node &node = (*p_tree)[nid];
-    if (rabit::IsDistributed()) {
+    if (!node.IsRoot() && !hist_.RowExists(node.Parent())) {
+      // parent histogram was evicted, no subtraction trick
+      small_siblings->push_back(entry);
+    } else if (!node.IsRoot() && entry.sibling_nid == ExpandEntry::kEmptyNid) {
+      // the sibling needs no histogram
+      small_siblings->push_back(entry);
+    } else if (rabit::IsDistributed()) {
       if (node.IsRoot() || node.IsLeftChild()) {
         small_siblings->push_back(entry);
       } else {
@@ -333,7 +1023,8 @@ void QuantileHistMaker::Builder::SplitSiblings(const std::vector<ExpandEntry>& n
   }
 }
 
-void QuantileHistMaker::Builder::ExpandWithDepthWise(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::ExpandWithDepthWise(
   const GHistIndexMatrix &gmat,
   const GHistIndexBlockMatrix &gmatb,
   const ColumnMatrix &column_matrix,
@@ -350,18 +1041,28 @@ void QuantileHistMaker::Builder::ExpandWithDepthWise(
   for (int depth = 0; depth < param_.max_depth + 1; depth++) {
     int starting_index = std::numeric_limits<int>::max();
     int sync_count = 0;
-    std::vector<ExpandEntry> temp_qexpand_depth;
+    ExpandList temp_qexpand_depth(TreeAlloc());
 
-    SplitSiblings(qexpand_depth_wise_, &nodes_for_explicit_hist_build_,
+    // only nodes which may be split get a histogram, unless they are small
+    const ExpandList nodes_to_split = NodesToSplit(qexpand_depth_wise_, *p_tree);
+    const ExpandList nodes_to_build = SelectSmallNodes(nodes_to_split);
+    SplitSiblings(nodes_to_build, &nodes_for_explicit_hist_build_,
                   &nodes_for_subtraction_trick_, p_tree);
-    AddHistRows(&starting_index, &sync_count);
-
-    BuildLocalHistograms(gmat, gmatb, p_tree, gpair_h);
-    SyncHistograms(starting_index, sync_count, p_tree);
+    if (!nodes_to_build.empty()) {
+      AddHistRows(&starting_index, &sync_count, *p_tree);
+      if (PipelinedHistAllreduce()) {
+        BuildAndSyncHistogramsPipelined(gmat, gmatb, p_tree, gpair_h);
+      } else {
+        BuildLocalHistograms(gmat, gmatb, p_tree, gpair_h);
+        SyncHistograms(starting_index, sync_count, p_tree);
+      }
+    }
+    BuildNodeBins(gmat, gpair_h);
+    FreeParentHistograms(qexpand_depth_wise_, *p_tree);
 
     BuildNodeStats(gmat, p_fmat, p_tree, gpair_h);
-    EvaluateAndApplySplits(gmat, column_matrix, p_tree, &num_leaves, depth, &timestamp,
-                   &temp_qexpand_depth);
+    EvaluateAndApplySplits(nodes_to_split, gmat, column_matrix, p_tree, &num_leaves, depth,
+                           &timestamp, &temp_qexpand_depth);
     // clean up
     qexpand_depth_wise_.clear();
     nodes_for_subtraction_trick_.clear();
@@ -375,7 +1076,8 @@ void QuantileHistMaker::Builder::ExpandWithDepthWise(
   }
 }
 
-void QuantileHistMaker::Builder::ExpandWithLossGuide(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::ExpandWithLossGuide(
     const GHistIndexMatrix& gmat,
     const GHistIndexBlockMatrix& gmatb,
     const ColumnMatrix& column_matrix,
@@ -388,7 +1090,7 @@ void QuantileHistMaker::Builder::ExpandWithLossGuide(
 
   ExpandEntry node(ExpandEntry::kRootNid, ExpandEntry::kEmptyNid,
       p_tree->GetDepth(0), 0.0f, timestamp++);
-  BuildHistogramsLossGuide(node, gmat, gmatb, p_tree, gpair_h);
+  BuildHistogramsLossGuide({node}, gmat, gmatb, p_tree, gpair_h);
 
   this->InitNewNode(ExpandEntry::kRootNid, gmat, gpair_h, *p_fmat, *p_tree);
 
@@ -398,63 +1100,114 @@ void QuantileHistMaker::Builder::ExpandWithLossGuide(
   qexpand_loss_guided_->push(node);
   ++num_leaves;
 
+  const auto batch_size = static_cast<size_t>(hist_maker_param_.lossguide_batch_size);
+  ExpandList batch(TreeAlloc());
+  ExpandList children(TreeAlloc());
+  ExpandList split_children(TreeAlloc());
+  ExpandList hist_nodes(TreeAlloc());
   while (!qexpand_loss_guided_->empty()) {
-    const ExpandEntry candidate = qexpand_loss_guided_->top();
-    const int nid = candidate.nid;
-    qexpand_loss_guided_->pop();
-    if (candidate.IsValid(param_, num_leaves)) {
-      (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
-    } else {
-      NodeEntry& e = snode_[nid];
-      bst_float left_leaf_weight =
-          spliteval_->ComputeWeight(nid, e.best.left_sum) * param_.learning_rate;
-      bst_float right_leaf_weight =
-          spliteval_->ComputeWeight(nid, e.best.right_sum) * param_.learning_rate;
-      p_tree->ExpandNode(nid, e.best.SplitIndex(), e.best.split_value,
-                         e.best.DefaultLeft(), e.weight, left_leaf_weight,
-                         right_leaf_weight, e.best.loss_chg, e.stats.sum_hess);
+    // pop the best candidates, small nodes of a batch share parallel loops
+    batch.clear();
+    while (!qexpand_loss_guided_->empty() && batch.size() < batch_size) {
+      const ExpandEntry candidate = qexpand_loss_guided_->top();
+      const int nid = candidate.nid;
+      qexpand_loss_guided_->pop();
+      if (candidate.IsValid(param_, num_leaves)) {
+        (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+      } else {
+        NodeEntry& e = snode_[nid];
+        bst_float left_leaf_weight =
+            spliteval_->ComputeWeight(nid, e.best.left_sum) * param_.learning_rate;
+        bst_float right_leaf_weight =
+            spliteval_->ComputeWeight(nid, e.best.right_sum) * param_.learning_rate;
+        this->ExpandBestSplit(nid, left_leaf_weight, right_leaf_weight, p_tree);
+        batch.push_back(candidate);
+        ++num_leaves;  // give two and take one, as parent is no longer a leaf
+      }
+    }
+    if (batch.empty()) {
+      continue;
+    }
 
-      this->ApplySplit({candidate}, gmat, column_matrix, hist_, p_tree);
+    this->ApplySplit(batch, gmat, column_matrix, hist_, p_tree);
 
-      const int cleft = (*p_tree)[nid].LeftChild();
-      const int cright = (*p_tree)[nid].RightChild();
+    children.clear();
+    split_children.clear();
+    hist_nodes.clear();
+    for (auto const& candidate : batch) {
+      const int cleft = (*p_tree)[candidate.nid].LeftChild();
+      const int cright = (*p_tree)[candidate.nid].RightChild();
 
       ExpandEntry left_node(cleft, cright, p_tree->GetDepth(cleft),
                             0.0f, timestamp++);
       ExpandEntry right_node(cright, cleft, p_tree->GetDepth(cright),
                             0.0f, timestamp++);
 
-      if (rabit::IsDistributed()) {
+      const bool split_left = CanSplit(cleft, *p_tree);
+      const bool split_right = CanSplit(cright, *p_tree);
+      if (split_left != split_right) {
+        // only the child which may be split gets a histogram
+        ExpandEntry& node = split_left ? left_node : right_node;
+        node.sibling_nid = ExpandEntry::kEmptyNid;
+        hist_nodes.push_back(node);
+      } else if (!split_left) {
+        // both children are leaves
+      } else if (rabit::IsDistributed()) {
         // in distributed mode, we need to keep consistent across workers
-        BuildHistogramsLossGuide(left_node, gmat, gmatb, p_tree, gpair_h);
+        hist_nodes.push_back(left_node);
       } else {
         if (row_set_collection_[cleft].Size() < row_set_collection_[cright].Size()) {
-          BuildHistogramsLossGuide(left_node, gmat, gmatb, p_tree, gpair_h);
+          hist_nodes.push_back(left_node);
         } else {
-          BuildHistogramsLossGuide(right_node, gmat, gmatb, p_tree, gpair_h);
+          hist_nodes.push_back(right_node);
         }
       }
+      children.push_back(left_node);
+      children.push_back(right_node);
+      if (split_left) {
+        split_children.push_back(left_node);
+      }
+      if (split_right) {
+        split_children.push_back(right_node);
+      }
+    }
+    // small children whose siblings are small as well have no histograms
+    SelectSmallNodes(split_children);
+    hist_nodes.erase(std::remove_if(hist_nodes.begin(), hist_nodes.end(),
+                                    [this](ExpandEntry const& e) {
+                                      return this->EnumeratedPos(e.nid) >= 0;
+                                    }),
+                     hist_nodes.end());
+    if (!hist_nodes.empty()) {
+      BuildHistogramsLossGuide(hist_nodes, gmat, gmatb, p_tree, gpair_h);
+    }
+    BuildNodeBins(gmat, gpair_h);
+    // parents of children without histograms
+    FreeParentHistograms(children, *p_tree);
 
+    for (auto const& candidate : batch) {
+      const int nid = candidate.nid;
+      const int cleft = (*p_tree)[nid].LeftChild();
+      const int cright = (*p_tree)[nid].RightChild();
       this->InitNewNode(cleft, gmat, gpair_h, *p_fmat, *p_tree);
       this->InitNewNode(cright, gmat, gpair_h, *p_fmat, *p_tree);
       bst_uint featureid = snode_[nid].best.SplitIndex();
       spliteval_->AddSplit(nid, cleft, cright, featureid,
                            snode_[cleft].weight, snode_[cright].weight);
       interaction_constraints_.Split(nid, featureid, cleft, cright);
+    }
 
-      this->EvaluateSplits({left_node, right_node}, gmat, hist_, *p_tree);
-      left_node.loss_chg = snode_[cleft].best.loss_chg;
-      right_node.loss_chg = snode_[cright].best.loss_chg;
-
-      qexpand_loss_guided_->push(left_node);
-      qexpand_loss_guided_->push(right_node);
-
-      ++num_leaves;  // give two and take one, as parent is no longer a leaf
+    // other children keep a best split without gain and become leaves
+    this->EvaluateSplits(split_children, gmat, hist_, *p_tree);
+    for (auto& child : children) {
+      child.loss_chg = snode_[child.nid].best.loss_chg;
+      qexpand_loss_guided_->push(child);
     }
   }
 }
 
-void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::Update(const GHistIndexMatrix& gmat,
                                         const GHistIndexBlockMatrix& gmatb,
                                         const ColumnMatrix& column_matrix,
                                         HostDeviceVector<GradientPair>* gpair,
@@ -462,17 +1215,29 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
                                         RegTree* p_tree) {
   builder_monitor_.Start("Update");
 
+  // written by the first pass of InitData over the rows
+  p_fused_gpair_ = p_gradient_ == nullptr ? nullptr : gpair->HostPointer();
   const std::vector<GradientPair>& gpair_h = gpair->ConstHostVector();
 
   spliteval_->Reset();
   interaction_constraints_.Reset();
 
+  p_paged_fmat_ = p_fmat->SingleColBlock() ? nullptr : p_fmat;
+  p_last_gmat_ = &gmat;
   this->InitData(gmat, gpair_h, *p_fmat, *p_tree);
+  // gradient based sampling reweights the sampled rows
+  const std::vector<GradientPair>& gpair_tree = gpair_sampled_.empty() ? gpair_h : gpair_sampled_;
+  this->QuantizeGradients(gpair_tree);
+  // integer histograms are built from the quantized gradients
+  const std::vector<GradientPair>& gpair_hist =
+      std::is_integral<GradientSumT>::value ? gpair_quantized_ : gpair_tree;
+  this->PackGradients(gpair_hist);
+  this->SplitGradients(gpair_hist);
 
   if (param_.grow_policy == TrainParam::kLossGuide) {
-    ExpandWithLossGuide(gmat, gmatb, column_matrix, p_fmat, p_tree, gpair_h);
+    ExpandWithLossGuide(gmat, gmatb, column_matrix, p_fmat, p_tree, gpair_hist);
   } else {
-    ExpandWithDepthWise(gmat, gmatb, column_matrix, p_fmat, p_tree, gpair_h);
+    ExpandWithDepthWise(gmat, gmatb, column_matrix, p_fmat, p_tree, gpair_hist);
   }
 
   for (int nid = 0; nid < p_tree->param.num_nodes; ++nid) {
@@ -481,12 +1246,204 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
     p_tree->Stat(nid).sum_hess = static_cast<float>(snode_[nid].stats.sum_hess);
   }
 
-  pruner_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
+  syncher_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
+
+  // the queue is the last one holding temporaries of the tree
+  qexpand_loss_guided_.reset();
+  arena_.Reset();
 
   builder_monitor_.Stop("Update");
 }
 
-bool QuantileHistMaker::Builder::UpdatePredictionCache(
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::PackGradients(
+    const std::vector<GradientPair>& gpair) {
+  if (!UsePackedGradients()) {
+    packed_gpair_.clear();
+    packed_gpair_buffer_.clear();
+    return;
+  }
+  builder_monitor_.Start("PackGradients");
+  const std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
+  const auto n_rows = static_cast<omp_ulong>(row_indices.size());
+  packed_gpair_.resize(n_rows);
+  packed_gpair_buffer_.resize(n_rows);
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    packed_gpair_[i] = gpair[row_indices[i]];
+  }
+  builder_monitor_.Stop("PackGradients");
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::SplitGradients(
+    const std::vector<GradientPair>& gpair) {
+  if (UsePackedGradients() || param_.enable_feature_grouping > 0) {
+    gpair_soa_ = common::GradientSoA();
+    return;
+  }
+  builder_monitor_.Start("SplitGradients");
+  gpair_soa_.Init(gpair, this->nthread_);
+  // Without a constant hessian a gathered pair shares its cache line and the interleaved
+  // gradients are as cheap to read, only constant hessians save memory traffic.
+  if (!gpair_soa_.ConstantHess()) {
+    gpair_soa_ = common::GradientSoA();
+  }
+  builder_monitor_.Stop("SplitGradients");
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::QuantizeGradients(
+    const std::vector<GradientPair>& gpair) {
+  if (!std::is_integral<GradientSumT>::value) {
+    return;
+  }
+  builder_monitor_.Start("QuantizeGradients");
+  const size_t n_rows = gpair.size();
+  std::vector<double> max_abs_tloc(2 * this->nthread_, 0.0);
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    const size_t tid = omp_get_thread_num();
+    max_abs_tloc[2 * tid] = std::max(max_abs_tloc[2 * tid],
+                                     static_cast<double>(std::abs(gpair[i].GetGrad())));
+    max_abs_tloc[2 * tid + 1] = std::max(max_abs_tloc[2 * tid + 1],
+                                         static_cast<double>(std::abs(gpair[i].GetHess())));
+  }
+  double max_abs[2] = {0.0, 0.0};
+  for (int tid = 0; tid < this->nthread_; ++tid) {
+    max_abs[0] = std::max(max_abs[0], max_abs_tloc[2 * tid]);
+    max_abs[1] = std::max(max_abs[1], max_abs_tloc[2 * tid + 1]);
+  }
+  double total_rows = static_cast<double>(n_rows);
+  rabit::Allreduce<rabit::op::Max>(max_abs, 2);
+  rabit::Allreduce<rabit::op::Sum>(&total_rows, 1);
+
+  // Quantized values are kept in the float gradient buffer, so they must be exactly
+  // representable by float.  Histogram sums must neither overflow the integer bins
+  // nor lose precision when they are summed up in double during split evaluation.
+  const double max_level = sizeof(GradientSumT) == sizeof(int32_t) ?
+                           std::numeric_limits<int16_t>::max() : static_cast<double>(1 << 24);
+  const double max_sum = std::min(static_cast<double>(std::numeric_limits<GradientSumT>::max()),
+                                  9007199254740992.0 /* 2^53 */);
+  const double level = std::min(max_level, std::floor(max_sum / std::max(total_rows, 1.0)));
+  CHECK_GE(level, 1.0) << "Too many rows for " << sizeof(GradientSumT) * 4
+                       << " bit gradient quantization.";
+  const double grad_scale = max_abs[0] > 0 ? level / max_abs[0] : 1.0;
+  const double hess_scale = max_abs[1] > 0 ? level / max_abs[1] : 1.0;
+  grad_dequant_ = 1.0 / grad_scale;
+  hess_dequant_ = 1.0 / hess_scale;
+
+  gpair_quantized_.resize(n_rows);
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    gpair_quantized_[i] = GradientPair(
+        static_cast<float>(std::round(gpair[i].GetGrad() * grad_scale)),
+        static_cast<float>(std::round(gpair[i].GetHess() * hess_scale)));
+  }
+  builder_monitor_.Stop("QuantizeGradients");
+}
+
+// Global bin of feature fid in a row of the page, -1 when the value is missing.
+template <typename BinIdxType>
+inline int32_t GetRowBin(const GHistIndexMatrix& page, const size_t row, const bst_uint fid) {
+  const BinIdxType* gradient_index = page.index.data<BinIdxType>();
+  const size_t local_row = row - page.base_rowid;
+  if (page.IsDense()) {
+    const size_t n_features = page.index.OffsetSize();
+    return static_cast<int32_t>(gradient_index[local_row * n_features + fid]) +
+           static_cast<int32_t>(page.index.Offset()[fid]);
+  }
+  // bins of a sparse row are sorted, so the ones of feature fid are consecutive
+  const BinIdxType* row_begin = gradient_index + page.row_ptr[local_row];
+  const BinIdxType* row_end = gradient_index + page.row_ptr[local_row + 1];
+  const BinIdxType* it = std::lower_bound(row_begin, row_end, page.cut.Ptrs()[fid]);
+  if (it != row_end && static_cast<uint32_t>(*it) < page.cut.Ptrs()[fid + 1]) {
+    return static_cast<int32_t>(*it);
+  }
+  return -1;
+}
+
+// Walk the given rows of the page down the tree on their bins, as the rows of training
+// are partitioned, and pass the leaf reached by each row to `on_leaf'.
+template <typename BinIdxType, typename Fn>
+inline void WalkPageKernel(const RowSetCollection::Elem rows, const GHistIndexMatrix& page,
+                           const RegTree& tree, const std::vector<int32_t>& split_bins,
+                           const int32_t n_threads, Fn on_leaf) {
+  const auto n_rows = static_cast<omp_ulong>(rows.Size());
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+  for (omp_ulong i = 0; i < n_rows; ++i) {
+    const size_t row = rows.begin[i];
+    int nid = 0;
+    while (!tree[nid].IsLeaf()) {
+      const bst_uint fid = tree[nid].SplitIndex();
+      const int32_t bin = GetRowBin<BinIdxType>(page, row, fid);
+      if (bin < 0) {
+        nid = tree[nid].DefaultChild();
+      } else if (tree.NodeSplitType(nid) == FeatureType::kCategorical) {
+        // the category of a row is its bin within the feature
+        const auto cat = static_cast<bst_cat_t>(bin - page.cut.Ptrs()[fid]);
+        nid = common::Decision(tree.NodeCats(nid), cat) ? tree[nid].LeftChild()
+                                                        : tree[nid].RightChild();
+      } else {
+        nid = bin <= split_bins[nid] ? tree[nid].LeftChild() : tree[nid].RightChild();
+      }
+    }
+    on_leaf(row, nid);
+  }
+}
+
+template <typename GradientSumT>
+template <typename Fn>
+void QuantileHistMaker::Builder<GradientSumT>::WalkUnsampledRows(Fn on_leaf) {
+  const RegTree& tree = *p_last_tree_;
+  std::vector<int32_t> split_bins(tree.param.num_nodes, -1);
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    if (!tree[nid].IsLeaf() && !tree[nid].IsDeleted()) {
+      split_bins[nid] = SplitCondBin(tree, nid, p_last_gmat_->cut);
+    }
+  }
+  const RowSetCollection::Elem unsampled(dmlc::BeginPtr(unsampled_rows_),
+                                         dmlc::BeginPtr(unsampled_rows_) + unsampled_rows_.size());
+  auto predict_page = [&](const GHistIndexMatrix& page) {
+    auto rows = PageRows(unsampled, page);
+    switch (page.index.GetBinTypeSize()) {
+      case common::kUint8BinsTypeSize:
+        WalkPageKernel<uint8_t>(rows, page, tree, split_bins, this->nthread_, on_leaf);
+        break;
+      case common::kUint16BinsTypeSize:
+        WalkPageKernel<uint16_t>(rows, page, tree, split_bins, this->nthread_, on_leaf);
+        break;
+      case common::kUint32BinsTypeSize:
+        WalkPageKernel<uint32_t>(rows, page, tree, split_bins, this->nthread_, on_leaf);
+        break;
+      default:
+        CHECK(false);  // no default behavior
+    }
+  };
+  if (p_paged_fmat_) {
+    for (auto const& page : p_paged_fmat_->GetBatches<GHistIndexMatrix>(PageParam())) {
+      predict_page(page);
+    }
+  } else {
+    predict_page(*p_last_gmat_);
+  }
+}
+
+template <typename GradientSumT>
+int QuantileHistMaker::Builder<GradientSumT>::LastLeaf(int nid) const {
+  // if a node is marked as deleted by the pruner, traverse upward to locate
+  // a non-deleted leaf.
+  if ((*p_last_tree_)[nid].IsDeleted()) {
+    while ((*p_last_tree_)[nid].IsDeleted()) {
+      nid = (*p_last_tree_)[nid].Parent();
+    }
+    CHECK((*p_last_tree_)[nid].IsLeaf());
+  }
+  return nid;
+}
+
+template <typename GradientSumT>
+bool QuantileHistMaker::Builder<GradientSumT>::UpdatePredictionCache(
     const DMatrix* data,
     HostDeviceVector<bst_float>* p_out_preds) {
   // p_last_fmat_ is a valid pointer as long as UpdatePredictionCache() is called in
@@ -514,29 +1471,248 @@ bool QuantileHistMaker::Builder::UpdatePredictionCache(
   common::ParallelFor2d(space, this->nthread_, [&](size_t node, common::Range1d r) {
     const RowSetCollection::Elem rowset = row_set_collection_[node];
     if (rowset.begin != nullptr && rowset.end != nullptr) {
-      int nid = rowset.node_id;
-      bst_float leaf_value;
-      // if a node is marked as deleted by the pruner, traverse upward to locate
-      // a non-deleted leaf.
-      if ((*p_last_tree_)[nid].IsDeleted()) {
-        while ((*p_last_tree_)[nid].IsDeleted()) {
-          nid = (*p_last_tree_)[nid].Parent();
-        }
-        CHECK((*p_last_tree_)[nid].IsLeaf());
-      }
-      leaf_value = (*p_last_tree_)[nid].LeafValue();
+      bst_float leaf_value = (*p_last_tree_)[LastLeaf(rowset.node_id)].LeafValue();
 
       for (const size_t* it = rowset.begin + r.begin(); it < rowset.begin + r.end(); ++it) {
         out_preds[*it] += leaf_value;
       }
     }
   });
+  // rows left out by subsampling aren't in any node
+  if (!unsampled_rows_.empty()) {
+    const RegTree& tree = *p_last_tree_;
+    WalkUnsampledRows([&](size_t row, int nid) { out_preds[row] += tree[nid].LeafValue(); });
+  }
 
   builder_monitor_.Stop("UpdatePredictionCache");
   return true;
 }
 
-void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
+template <typename GradientSumT>
+bool QuantileHistMaker::Builder<GradientSumT>::UpdateLeafIndices(
+    const DMatrix* data, common::Span<uint32_t> out_leaf) {
+  if (!p_last_fmat_ || !p_last_tree_ || data != p_last_fmat_) {
+    return false;
+  }
+  builder_monitor_.Start("UpdateLeafIndices");
+  size_t n_nodes = row_set_collection_.end() - row_set_collection_.begin();
+  common::BlockedSpace2d space(n_nodes, [&](size_t node) {
+    return row_set_collection_[node].Size();
+  }, 1024);
+  common::ParallelFor2d(space, this->nthread_, [&](size_t node, common::Range1d r) {
+    const RowSetCollection::Elem rowset = row_set_collection_[node];
+    if (rowset.begin != nullptr && rowset.end != nullptr) {
+      auto const leaf = static_cast<uint32_t>(LastLeaf(rowset.node_id));
+      for (const size_t* it = rowset.begin + r.begin(); it < rowset.begin + r.end(); ++it) {
+        out_leaf[*it] = leaf;
+      }
+    }
+  });
+  if (!unsampled_rows_.empty()) {
+    WalkUnsampledRows([&](size_t row, int nid) { out_leaf[row] = static_cast<uint32_t>(nid); });
+  }
+  builder_monitor_.Stop("UpdateLeafIndices");
+  return true;
+}
+
+/*!
+ * \brief Combine the gradient pair into a single value, the selection probability of
+ *  gradient based sampling is proportional to it.
+ *
+ * The approach here is based on Minimal Variance Sampling (MVS), with lambda set to 0.1,
+ * same as gpu_hist.
+ *
+ * \see Ibragimov, B., & Gusev, G. (2019). Minimal Variance Sampling in Stochastic Gradient
+ * Boosting. In Advances in Neural Information Processing Systems (pp. 15061-15071).
+ */
+inline double CombineGradientPair(const GradientPair& gpair) {
+  constexpr double kLambda = 0.1;
+  const double grad = gpair.GetGrad();
+  const double hess = gpair.GetHess();
+  return std::sqrt(grad * grad + kLambda * hess * hess);
+}
+
+inline bool IsGradientBasedCandidate(const GradientPair& gpair) {
+  return gpair.GetHess() >= 0.0f && (gpair.GetGrad() != 0.0f || gpair.GetHess() != 0.0f);
+}
+
+/*!
+ * \brief Find the threshold u such that selecting each row with probability
+ *  min(1, combined_gradient / u) samples sample_rows rows in expectation.  Returns 0 when
+ *  all the candidate rows fit into the sample.
+ */
+inline double GradientBasedThreshold(const std::vector<GradientPair>& gpair,
+                                     const double sample_rows, const size_t block_size,
+                                     const int32_t n_threads) {
+  const size_t n_rows = gpair.size();
+  const size_t n_blocks = common::DivRoundUp(n_rows, block_size);
+  std::vector<double> block_sum(n_blocks);
+  std::vector<size_t> block_count(n_blocks);
+  // sum of the combined gradients below u and number of candidates at or above u, blocks
+  // are reduced in order so the result doesn't depend on the number of threads
+  auto reduce = [&](const double u, double* p_sum_below, size_t* p_n_above) {
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+    for (omp_ulong iblock = 0; iblock < n_blocks; ++iblock) {
+      const size_t iend = std::min((iblock + 1) * block_size, n_rows);
+      double sum = 0;
+      size_t count = 0;
+      for (size_t i = iblock * block_size; i < iend; ++i) {
+        if (IsGradientBasedCandidate(gpair[i])) {
+          const double combined = CombineGradientPair(gpair[i]);
+          if (combined >= u) {
+            ++count;
+          } else {
+            sum += combined;
+          }
+        }
+      }
+      block_sum[iblock] = sum;
+      block_count[iblock] = count;
+    }
+    *p_sum_below = std::accumulate(block_sum.cbegin(), block_sum.cend(), 0.0);
+    *p_n_above = std::accumulate(block_count.cbegin(), block_count.cend(), size_t(0));
+  };
+
+  double sum_below;
+  size_t n_candidates;
+  reduce(0.0, &sum_below, &n_candidates);
+  if (static_cast<double>(n_candidates) <= sample_rows) {
+    return 0.0;
+  }
+  // Solve n_above(u) + sum_below(u) / u = sample_rows.  Starting with no row selected
+  // for sure, each step only adds rows to those at or above u, so this stops once the
+  // set of them is stable.
+  reduce(std::numeric_limits<double>::infinity(), &sum_below, &n_candidates);
+  double u = sum_below / sample_rows;
+  size_t n_above_prev = 0;
+  while (true) {
+    size_t n_above;
+    reduce(u, &sum_below, &n_above);
+    if (n_above == n_above_prev || static_cast<double>(n_above) >= sample_rows) {
+      break;
+    }
+    n_above_prev = n_above;
+    u = sum_below / (sample_rows - static_cast<double>(n_above));
+  }
+  return u;
+}
+
+/*!
+ * \brief Rate a worker with n_rows rows samples them with, so that all workers sample
+ *  about the same number of rows and sample_ratio of all rows in total.  Workers having
+ *  fewer rows than their share keep all of them, and the rest of their share is spread
+ *  over the others.
+ */
+inline double BalancedSampleRate(const size_t n_rows, const double sample_ratio) {
+  const auto world = static_cast<size_t>(rabit::GetWorldSize());
+  std::vector<double> counts(world, 0.0);
+  counts[rabit::GetRank()] = static_cast<double>(n_rows);
+  rabit::Allreduce<rabit::op::Sum>(counts.data(), counts.size());
+  // Find the cap c with sum of min(counts, c) equal to the total sample, raising it over
+  // the workers from the smallest.
+  std::sort(counts.begin(), counts.end());
+  double remaining = sample_ratio * std::accumulate(counts.cbegin(), counts.cend(), 0.0);
+  double cap = 0;
+  for (size_t i = 0; i < world; ++i) {
+    cap = remaining / static_cast<double>(world - i);
+    if (cap <= counts[i]) {
+      break;
+    }
+    remaining -= counts[i];
+  }
+  return n_rows == 0 ? 1.0 : std::min(1.0, cap / static_cast<double>(n_rows));
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::SampleRows(
+    const std::vector<GradientPair>& gpair, size_t n_rows,
+    std::vector<size_t>* p_row_indices) {
+  builder_monitor_.Start("SampleRows");
+  std::vector<size_t>& row_indices = *p_row_indices;
+  row_indices.resize(n_rows);
+  const size_t n_blocks = common::DivRoundUp(n_rows, kSampleBlockSize);
+  // a single draw from the global engine per tree keeps the sample tied to `seed`
+  const auto seed =
+      has_sample_seed_ ? sample_seed_ : static_cast<uint32_t>(common::GlobalRandom()());
+  has_sample_seed_ = false;
+  std::vector<size_t> block_offsets(n_blocks + 1, 0);
+
+  const bool gradient_based = param_.sampling_method == TrainParam::kGradientBased;
+  double rate = param_.subsample;
+  if (hist_maker_param_.balanced_sampling && this->RowSplit()) {
+    rate = BalancedSampleRate(n_rows, param_.subsample);
+  }
+  // uniformly sampled gradients are scaled back to a sample rate of `subsample'
+  const bool rescale = !gradient_based && rate != static_cast<double>(param_.subsample);
+  const auto rate_ratio = static_cast<float>(rate / param_.subsample);
+  double threshold = 0;
+  if (gradient_based) {
+    threshold = GradientBasedThreshold(gpair, static_cast<double>(n_rows) * rate,
+                                       kSampleBlockSize, this->nthread_);
+  }
+  if (gradient_based || rescale) {
+    gpair_sampled_.resize(n_rows);
+  }
+
+  // sample each block into its own range of row_indices, sampled rows from the
+  // front and the others from the back
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+  for (omp_ulong iblock = 0; iblock < n_blocks; ++iblock) {
+    common::RandomEngine rnd(seed + static_cast<uint32_t>(iblock));
+    std::bernoulli_distribution coin_flip(rate);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const size_t ibegin = iblock * kSampleBlockSize;
+    const size_t iend = std::min(ibegin + kSampleBlockSize, n_rows);
+    size_t j = ibegin;
+    size_t k = iend;
+    for (size_t i = ibegin; i < iend; ++i) {
+      bool selected;
+      if (gradient_based) {
+        // select rows with probability proportional to their combined gradient,
+        // scaling the gradients by 1/p keeps the histograms unbiased
+        selected = IsGradientBasedCandidate(gpair[i]);
+        const double p = threshold > 0 ? CombineGradientPair(gpair[i]) / threshold : 1.0;
+        if (selected && p < 1.0) {
+          selected = uniform(rnd) <= p;
+          gpair_sampled_[i] = gpair[i] / static_cast<float>(p);
+        } else {
+          gpair_sampled_[i] = gpair[i];
+        }
+      } else {
+        selected = gpair[i].GetHess() >= 0.0f && coin_flip(rnd);
+        if (rescale) {
+          gpair_sampled_[i] = selected ? gpair[i] / rate_ratio : gpair[i];
+        }
+      }
+      if (selected) {
+        row_indices[j++] = i;
+      } else {
+        row_indices[--k] = i;
+      }
+    }
+    block_offsets[iblock + 1] = j - ibegin;
+  }
+  std::partial_sum(block_offsets.begin(), block_offsets.end(), block_offsets.begin());
+
+  // compact the blocks, rows stay sorted
+  sampled_rows_buffer_.resize(block_offsets.back());
+  unsampled_rows_.resize(n_rows - block_offsets.back());
+#pragma omp parallel for num_threads(this->nthread_) schedule(static)
+  for (omp_ulong iblock = 0; iblock < n_blocks; ++iblock) {
+    const size_t ibegin = iblock * kSampleBlockSize;
+    const size_t iend = std::min(ibegin + kSampleBlockSize, n_rows);
+    const size_t n_sampled = block_offsets[iblock + 1] - block_offsets[iblock];
+    std::copy(row_indices.begin() + ibegin, row_indices.begin() + ibegin + n_sampled,
+              sampled_rows_buffer_.begin() + block_offsets[iblock]);
+    std::reverse_copy(row_indices.begin() + ibegin + n_sampled, row_indices.begin() + iend,
+                      unsampled_rows_.begin() + (ibegin - block_offsets[iblock]));
+  }
+  row_indices.swap(sampled_rows_buffer_);
+  builder_monitor_.Stop("SampleRows");
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::InitData(const GHistIndexMatrix& gmat,
                                           const std::vector<GradientPair>& gpair,
                                           const DMatrix& fmat,
                                           const RegTree& tree) {
@@ -549,6 +1725,20 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
   }
   builder_monitor_.Start("InitData");
   const auto& info = fmat.Info();
+  // rows left out of the sample are predicted with the local features only
+  CHECK(!this->ColumnSplit() || param_.subsample == 1.0f)
+      << "Row subsampling is not supported with column-wise data split.";
+  feature_types_.clear();
+  auto const& h_feature_types = info.feature_types.ConstHostVector();
+  if (std::any_of(h_feature_types.cbegin(), h_feature_types.cend(),
+                  [](FeatureType t) { return t == FeatureType::kCategorical; })) {
+    CHECK(!this->ColumnSplit())
+        << "Categorical features are not supported with column-wise data split.";
+    feature_types_ = h_feature_types;
+  }
+  split_cats_.clear();
+  enumerated_pos_.clear();
+  nodes_for_enumeration_.clear();
 
   {
     // initialize the row set
@@ -556,8 +1746,9 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     // clear local prediction cache
     leaf_value_cache_.clear();
     // initialize histogram collection
-    uint32_t nbins = gmat.cut.Ptrs().back();
+    uint32_t nbins = HistIndex(gmat).cut.Ptrs().back();
     hist_.Init(nbins);
+    hist_.SetMaxBytes(hist_maker_param_.max_hist_bytes);
     hist_buffer_.Init(nbins);
 
     // initialize histogram builder
@@ -565,26 +1756,24 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     {
       this->nthread_ = omp_get_num_threads();
     }
-    hist_builder_ = GHistBuilder(this->nthread_, nbins);
+    hist_builder_ = GHistBuilder<GradientSumT>(this->nthread_, nbins);
+    hist_buffer_.SetThreadGroups(thread_group_.size() == static_cast<size_t>(this->nthread_) ?
+                                 thread_group_ : std::vector<size_t>());
+    if (param_.enable_feature_grouping == 0) {
+      // wide dense histograms are built in cache sized feature blocks
+      hist_builder_.InitFeatureBlocks(HistIndex(gmat));
+    }
 
     std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
     row_indices.resize(info.num_row_);
     auto* p_row_indices = row_indices.data();
     // mark subsample and build list of member rows
+    unsampled_rows_.clear();
+    gpair_sampled_.clear();
 
     if (param_.subsample < 1.0f) {
-      CHECK_EQ(param_.sampling_method, TrainParam::kUniform)
-        << "Only uniform sampling is supported, "
-        << "gradient-based sampling is only support by GPU Hist.";
-      std::bernoulli_distribution coin_flip(param_.subsample);
-      auto& rnd = common::GlobalRandom();
-      size_t j = 0;
-      for (size_t i = 0; i < info.num_row_; ++i) {
-        if (gpair[i].GetHess() >= 0.0f && coin_flip(rnd)) {
-          p_row_indices[j++] = i;
-        }
-      }
-      row_indices.resize(j);
+      CHECK(p_gradient_ == nullptr) << "Sampled rows need the gradient beforehand.";
+      SampleRows(gpair, info.num_row_, &row_indices);
     } else {
       MemStackAllocator<bool, 128> buff(this->nthread_);
       bool* p_buff = buff.Get();
@@ -599,12 +1788,25 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
         const size_t iend = std::min(static_cast<size_t>(ibegin + block_size),
             static_cast<size_t>(info.num_row_));
 
-        for (size_t i = ibegin; i < iend; ++i) {
-          if (gpair[i].GetHess() < 0.0f) {
-            p_buff[tid] = true;
+        // A fused gradient is computed in blocks that are checked while still in cache,
+        // then every row has to be visited.
+        bool has_neg = false;
+        for (size_t begin = ibegin; begin < iend; begin += kGradientBlockSize) {
+          size_t const end = std::min(begin + kGradientBlockSize, iend);
+          if (p_gradient_ != nullptr) {
+            p_gradient_->Compute(begin, end, p_fused_gpair_ + begin);
+          } else if (has_neg) {
             break;
           }
+          for (size_t i = begin; i < end && !has_neg; ++i) {
+            has_neg = gpair[i].GetHess() < 0.0f;
+          }
         }
+        p_buff[tid] = has_neg;
+      }
+      if (p_gradient_ != nullptr) {
+        p_gradient_->Validate();
+        p_gradient_ = nullptr;
       }
 
       bool has_neg_hess = false;
@@ -646,6 +1848,7 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     const size_t nnz = info.num_nonzero_;
     // number of discrete bins for feature 0
     const uint32_t nbins_f0 = gmat.cut.Ptrs()[1] - gmat.cut.Ptrs()[0];
+
     if (nrow * ncol == nnz) {
       // dense data with zero-based indexing
       data_layout_ = kDenseDataZeroBased;
@@ -657,6 +1860,51 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
       data_layout_ = kSparseData;
     }
   }
+  {
+    /* Features that are constant or missing for all rows can never be split, don't
+       enumerate them for every node.  With rows split over the workers bins are only
+       counted on the local rows, so no feature is skipped.  With features split over
+       the workers, those of other workers are missing for all local rows. */
+    const size_t n_features = gmat.cut.Ptrs().size() - 1;
+    feature_splittable_.assign(n_features, 1);
+    feature_missing_.assign(n_features, 1);
+    if (!this->RowSplit() && !gmat.hit_count.empty()) {
+      for (size_t fid = 0; fid < n_features; ++fid) {
+        size_t n_entries = 0;
+        size_t n_nonempty_bins = 0;
+        for (uint32_t i = gmat.cut.Ptrs()[fid]; i < gmat.cut.Ptrs()[fid + 1]; ++i) {
+          n_entries += gmat.hit_count[i];
+          n_nonempty_bins += gmat.hit_count[i] != 0;
+        }
+        // a single bin without missing values leaves nothing to separate
+        feature_splittable_[fid] =
+            n_nonempty_bins > 1 || (n_nonempty_bins == 1 && n_entries < info.num_row_);
+        // Missing-free features have no default direction to choose, and rounding of
+        // the node sums can't make them look otherwise.
+        feature_missing_[fid] = n_entries < info.num_row_;
+      }
+    }
+    if (this->RowSplit()) {
+      auto const& hist_ptrs = this->HistIndex(gmat).cut.Ptrs();
+      hist_feature_ptrs_.assign(hist_ptrs.cbegin(), hist_ptrs.cend());
+    }
+    if (this->DistributedSplitEvaluation() && !this->ColumnSplit()) {
+      // Workers own contiguous ranges of features with about the same number of bins,
+      // a feature goes to the worker holding the middle of its bins.
+      auto const& ptrs = gmat.cut.Ptrs();
+      auto const world = static_cast<uint64_t>(rabit::GetWorldSize());
+      auto const rank = static_cast<uint64_t>(rabit::GetRank());
+      uint64_t const total_bins = std::max<uint64_t>(ptrs.back(), 1);
+      for (size_t fid = 0; fid < n_features; ++fid) {
+        uint64_t const middle = (static_cast<uint64_t>(ptrs[fid]) + ptrs[fid + 1]) / 2;
+        uint64_t const owner = std::min(middle * world / total_bins, world - 1);
+        if (owner != rank) {
+          feature_splittable_[fid] = 0;
+        }
+      }
+    }
+  }
+  split_owner_.clear();
   // store a pointer to the tree
   p_last_tree_ = &tree;
   if (data_layout_ == kDenseDataOneBased) {
@@ -685,13 +1933,28 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     }
     CHECK_GT(min_nbins_per_feature, 0U);
   }
+  // Split candidates are drawn from the per tree feature set, so histograms of the other
+  // features are never read.  Level and node sets are resampled independently and can't be
+  // used here as the subtraction trick needs the parent and sibling built on the same set.
+  std::vector<bst_feature_t> hist_features;
+  if (param_.colsample_bytree < 1.0f && data_layout_ != kSparseData &&
+      HistIndex(gmat).IsDense() && p_bundled_gmat_ == nullptr &&
+      param_.enable_feature_grouping == 0) {
+    hist_features = column_sampler_.GetTreeFeatureSet()->ConstHostVector();
+    // the root statistics are taken from this histogram
+    auto it = std::lower_bound(hist_features.begin(), hist_features.end(), fid_least_bins_);
+    if (it == hist_features.end() || *it != fid_least_bins_) {
+      hist_features.insert(it, fid_least_bins_);
+    }
+  }
+  hist_builder_.SetFeatureSet(std::move(hist_features));
   {
     snode_.reserve(256);
     snode_.clear();
   }
   {
     if (param_.grow_policy == TrainParam::kLossGuide) {
-      qexpand_loss_guided_.reset(new ExpandQueue(LossGuide));
+      qexpand_loss_guided_.reset(new ExpandQueue(LossGuide, ExpandList(TreeAlloc())));
     } else {
       qexpand_depth_wise_.clear();
     }
@@ -703,7 +1966,8 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
 // is equal to sum of statistics for all values:
 // then - there are no missing values
 // else - there are missing values
-bool QuantileHistMaker::Builder::SplitContainsMissingValues(const GradStats e,
+template <typename GradientSumT>
+bool QuantileHistMaker::Builder<GradientSumT>::SplitContainsMissingValues(const GradStats e,
                                                             const NodeEntry& snode) {
   if (e.GetGrad() == snode.stats.GetGrad() && e.GetHess() == snode.stats.GetHess()) {
     return false;
@@ -712,24 +1976,79 @@ bool QuantileHistMaker::Builder::SplitContainsMissingValues(const GradStats e,
   }
 }
 
+template <typename GradientSumT>
+template <typename Evaluator>
+void QuantileHistMaker::Builder<GradientSumT>::EnumerateFeatures(
+    const ExpandList& nodes_set, const GHistIndexMatrix& gmat,
+    const HistCollection<GradientSumT>& hist, const common::BlockedSpace2d& space,
+    const Evaluator& evaluator) {
+  const size_t nthread = std::max(1, this->nthread_);
+  common::ParallelFor2d(space, this->nthread_, [&](size_t nid_in_set, common::Range1d r) {
+    const int32_t nid = nodes_set[nid_in_set].nid;
+    const auto tid = static_cast<unsigned>(omp_get_thread_num());
+    // small nodes have the bins of their rows instead of a histogram
+    const int32_t pos = this->EnumeratedPos(nid);
+    GHistRowT node_hist = pos < 0 ? hist[nid] : GHistRowT();
+    auto const& features = node_features_[nid_in_set];
+
+    for (auto idx_in_feature_set = r.begin(); idx_in_feature_set < r.end(); ++idx_in_feature_set) {
+      const auto fid = features[idx_in_feature_set];
+      if (pos >= 0) {
+        auto grad_stats = this->EnumerateNodeBins<+1>(gmat, pos, snode_[nid],
+            &best_split_tloc_[nthread*nid_in_set + tid], fid, nid, evaluator);
+        if (feature_missing_[fid] && SplitContainsMissingValues(grad_stats, snode_[nid])) {
+          this->EnumerateNodeBins<-1>(gmat, pos, snode_[nid],
+              &best_split_tloc_[nthread*nid_in_set + tid], fid, nid, evaluator);
+        }
+        continue;
+      }
+      if (this->IsCategorical(fid)) {
+        this->EnumerateCategoricalSplit(gmat, node_hist, snode_[nid],
+            &best_split_tloc_[nthread*nid_in_set + tid], fid, nid, evaluator);
+        continue;
+      }
+      auto grad_stats = this->EnumerateSplit<+1>(gmat, node_hist, snode_[nid],
+          &best_split_tloc_[nthread*nid_in_set + tid], fid, nid, evaluator);
+      if (feature_missing_[fid] && SplitContainsMissingValues(grad_stats, snode_[nid])) {
+        this->EnumerateSplit<-1>(gmat, node_hist, snode_[nid],
+            &best_split_tloc_[nthread*nid_in_set + tid], fid, nid, evaluator);
+      }
+    }
+  });
+}
+
 // nodes_set - set of nodes to be processed in parallel
-void QuantileHistMaker::Builder::EvaluateSplits(const std::vector<ExpandEntry>& nodes_set,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::EvaluateSplits(const ExpandList& nodes_set,
                                                const GHistIndexMatrix& gmat,
-                                               const HistCollection& hist,
+                                               const HistCollection<GradientSumT>& hist,
                                                const RegTree& tree) {
+  if (nodes_set.empty()) {
+    return;
+  }
   builder_monitor_.Start("EvaluateSplits");
 
   const size_t n_nodes_in_set = nodes_set.size();
   const size_t nthread = std::max(1, this->nthread_);
 
-  using FeatureSetType = std::shared_ptr<HostDeviceVector<bst_feature_t>>;
-  std::vector<FeatureSetType> features_sets(n_nodes_in_set);
+  // The sampled features of each node are filtered by the interaction constraints and
+  // the splittable features once, so the enumeration only visits the candidates.
+  if (node_features_.size() < n_nodes_in_set) {
+    node_features_.resize(n_nodes_in_set);
+  }
   best_split_tloc_.resize(nthread * n_nodes_in_set);
 
   // Generate feature set for each tree node
   for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
     const int32_t nid = nodes_set[nid_in_set].nid;
-    features_sets[nid_in_set] = column_sampler_.GetFeatureSet(tree.GetDepth(nid));
+    auto sampled = column_sampler_.GetFeatureSet(tree.GetDepth(nid));
+    auto& features = node_features_[nid_in_set];
+    features.clear();
+    for (auto fid : sampled->ConstHostVector()) {
+      if (feature_splittable_[fid] && interaction_constraints_.Query(nid, fid)) {
+        features.push_back(fid);
+      }
+    }
 
     for (unsigned tid = 0; tid < nthread; ++tid) {
       best_split_tloc_[nthread*nid_in_set + tid] = snode_[nid].best;
@@ -738,29 +2057,24 @@ void QuantileHistMaker::Builder::EvaluateSplits(const std::vector<ExpandEntry>&
 
   // Create 2D space (# of nodes to process x # of features to process)
   // to process them in parallel
-  const size_t grain_size = std::max<size_t>(1, features_sets[0]->Size() / nthread);
+  const size_t grain_size = std::max<size_t>(1, node_features_[0].size() / nthread);
   common::BlockedSpace2d space(n_nodes_in_set, [&](size_t nid_in_set) {
-      return features_sets[nid_in_set]->Size();
+      return node_features_[nid_in_set].size();
   }, grain_size);
 
-  // Start parallel enumeration for all tree nodes in the set and all features
-  common::ParallelFor2d(space, this->nthread_, [&](size_t nid_in_set, common::Range1d r) {
-    const int32_t nid = nodes_set[nid_in_set].nid;
-    const auto tid = static_cast<unsigned>(omp_get_thread_num());
-    GHistRow node_hist = hist[nid];
-
-    for (auto idx_in_feature_set = r.begin(); idx_in_feature_set < r.end(); ++idx_in_feature_set) {
-      const auto fid = features_sets[nid_in_set]->ConstHostVector()[idx_in_feature_set];
-      if (interaction_constraints_.Query(nid, fid)) {
-        auto grad_stats = this->EnumerateSplit<+1>(gmat, node_hist, snode_[nid],
-            &best_split_tloc_[nthread*nid_in_set + tid], fid, nid);
-        if (SplitContainsMissingValues(grad_stats, snode_[nid])) {
-          this->EnumerateSplit<-1>(gmat, node_hist, snode_[nid],
-              &best_split_tloc_[nthread*nid_in_set + tid], fid, nid);
-        }
-      }
-    }
-  });
+  // Start parallel enumeration for all tree nodes in the set and all features, the
+  // built-in evaluators are composed statically so the score is inlined in the loops.
+  StaticEvaluatorState state;
+  if (!spliteval_->GetStaticState(&state)) {
+    this->EnumerateFeatures(nodes_set, gmat, hist, space,
+                            VirtualSplitEvaluator{spliteval_.get()});
+  } else if (state.lower != nullptr) {
+    this->EnumerateFeatures(nodes_set, gmat, hist, space,
+                            StaticSplitEvaluator<true>{state});
+  } else {
+    this->EnumerateFeatures(nodes_set, gmat, hist, space,
+                            StaticSplitEvaluator<false>{state});
+  }
 
   // Find Best Split across threads for each node in nodes set
   for (unsigned nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
@@ -770,57 +2084,122 @@ void QuantileHistMaker::Builder::EvaluateSplits(const std::vector<ExpandEntry>&
     }
   }
 
+  // and across workers, each having evaluated its own features
+  if (this->DistributedSplitEvaluation() || this->ColumnSplit()) {
+    best_splits_.resize(n_nodes_in_set);
+    for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
+      best_splits_[nid_in_set] = snode_[nodes_set[nid_in_set].nid].best;
+    }
+    splitred_.Allreduce(best_splits_.data(), n_nodes_in_set);
+    if (this->ColumnSplit()) {
+      // The worker which found the winning split has the values of its feature, and
+      // partitions the rows for the others.
+      const int32_t rank = rabit::GetRank();
+      std::vector<int32_t> owners(n_nodes_in_set);
+      for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
+        SplitEntry const& local = snode_[nodes_set[nid_in_set].nid].best;
+        SplitEntry const& global = best_splits_[nid_in_set];
+        const bool found = local.sindex == global.sindex &&
+                           local.split_value == global.split_value &&
+                           local.loss_chg == global.loss_chg;
+        owners[nid_in_set] = found ? rank : -1;
+      }
+      rabit::Allreduce<rabit::op::Max>(owners.data(), owners.size());
+      split_owner_.resize(std::max(split_owner_.size(),
+                                   static_cast<size_t>(tree.param.num_nodes)), -1);
+      for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
+        split_owner_[nodes_set[nid_in_set].nid] = owners[nid_in_set];
+      }
+    }
+    for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
+      snode_[nodes_set[nid_in_set].nid].best = best_splits_[nid_in_set];
+    }
+  }
+
+  // Only the length of the prefix of categories going left is reduced, the order is
+  // the same on all workers as they share the histograms.
+  if (!feature_types_.empty()) {
+    split_cats_.resize(std::max(split_cats_.size(),
+                                static_cast<size_t>(tree.param.num_nodes)));
+    std::vector<std::pair<bst_cat_t, GradStats>> sorted;
+    for (size_t nid_in_set = 0; nid_in_set < n_nodes_in_set; ++nid_in_set) {
+      const int32_t nid = nodes_set[nid_in_set].nid;
+      SplitEntry const& best = snode_[nid].best;
+      auto& cats = split_cats_[nid];
+      cats.clear();
+      if (!this->IsCategorical(best.SplitIndex()) || best.loss_chg < kRtEps) {
+        continue;
+      }
+      const bst_feature_t fid = best.SplitIndex();
+      this->SortCategories(gmat, hist[nid], fid, &sorted);
+      const size_t n_cats = gmat.cut.Ptrs()[fid + 1] - gmat.cut.Ptrs()[fid];
+      cats.resize(common::CatBitField::ComputeStorageSize(n_cats), 0);
+      common::CatBitField bits{common::Span<uint64_t>{cats}};
+      const size_t n_left = std::min(static_cast<size_t>(common::AsCat(best.split_value)),
+                                     sorted.size());
+      for (size_t i = 0; i < n_left; ++i) {
+        bits.Set(sorted[i].first);
+      }
+    }
+  }
+
   builder_monitor_.Stop("EvaluateSplits");
 }
 
-// split row indexes (rid_span) to 2 parts (left_part, right_part) depending
-// on comparison of indexes values (idx_span) and split point (split_cond)
+// Decision of a numerical split on the global bin of a row.
+struct NumericalDecision {
+  int32_t split_cond;
+  bool operator()(int32_t bin) const { return bin <= split_cond; }
+};
+
+// Decision of a categorical split on the global bin of a row, the category of a row is
+// its bin within the feature.
+struct CategoricalDecision {
+  common::Span<uint64_t const> cats;
+  uint32_t feature_base;
+  bool operator()(int32_t bin) const {
+    return common::Decision(cats, static_cast<bst_cat_t>(static_cast<uint32_t>(bin) -
+                                                         feature_base));
+  }
+};
+
+// mark row indexes (rid_span) going to the left child (decisions[i] = 1) or the right one
+// depending on the decision of the split (go_left) on indexes values (idx_span)
 // Handle dense columns
-// Analog of std::stable_partition, but in no-inplace manner
-template <bool default_left>
+// Rows are moved to children later by PartitionBuilder::Scatter
+template <bool default_left, typename BinIdxType, typename DecisionT>
 inline std::pair<size_t, size_t> PartitionDenseKernel(
-      common::Span<const size_t> rid_span, common::Span<const uint32_t> idx_span,
-      const int32_t split_cond, const uint32_t offset,
-      common::Span<size_t> left_part, common::Span<size_t> right_part) {
-  const uint32_t* idx = idx_span.data();
-  size_t* p_left_part = left_part.data();
-  size_t* p_right_part = right_part.data();
+      common::Span<const size_t> rid_span, const Column<BinIdxType>& column,
+      DecisionT go_left_of, common::Span<uint8_t> decisions) {
+  const BinIdxType* idx = column.GetFeatureBinIdxPtr().data();
+  const uint32_t offset = column.GetBaseIdx();
+  const size_t* rid = rid_span.data();
+  uint8_t* p_decisions = decisions.data();
   size_t nleft_elems = 0;
-  size_t nright_elems = 0;
 
-  const uint32_t missing_val = std::numeric_limits<uint32_t>::max();
-
-  for (auto rid : rid_span) {
-    if (idx[rid] == missing_val) {
-      if (default_left) {
-        p_left_part[nleft_elems++] = rid;
-      } else {
-        p_right_part[nright_elems++] = rid;
-      }
+  for (size_t i = 0; i < rid_span.size(); ++i) {
+    bool go_left;
+    if (column.IsMissing(rid[i])) {
+      go_left = default_left;
     } else {
-      if (static_cast<int32_t>(idx[rid] + offset) <= split_cond) {
-        p_left_part[nleft_elems++] = rid;
-      } else {
-        p_right_part[nright_elems++] = rid;
-      }
+      go_left = go_left_of(static_cast<int32_t>(static_cast<uint32_t>(idx[rid[i]]) + offset));
     }
+    p_decisions[i] = go_left;
+    nleft_elems += go_left;
   }
 
-  return {nleft_elems, nright_elems};
+  return {nleft_elems, rid_span.size() - nleft_elems};
 }
 
-// Split row indexes (rid_span) to 2 parts (left_part, right_part) depending
-// on comparison of indexes values (idx_span) and split point (split_cond).
+// Mark row indexes (rid_span) going to the left child (decisions[i] = 1) or the right one
+// depending on the decision of the split (go_left) on indexes values (idx_span).
 // Handle sparse columns
-template<bool default_left>
+template<bool default_left, typename BinIdxType, typename DecisionT>
 inline std::pair<size_t, size_t> PartitionSparseKernel(
-      common::Span<const size_t> rid_span, const int32_t split_cond, const Column& column,
-      common::Span<size_t> left_part, common::Span<size_t> right_part) {
-  size_t* p_left_part  = left_part.data();
-  size_t* p_right_part = right_part.data();
-
+      common::Span<const size_t> rid_span, DecisionT go_left_of,
+      const Column<BinIdxType>& column, common::Span<uint8_t> decisions) {
+  uint8_t* p_decisions = decisions.data();
   size_t nleft_elems = 0;
-  size_t nright_elems = 0;
 
   if (rid_span.size()) {  // ensure that rid_span is nonempty range
     // search first nonzero row with index >= rid_span.front()
@@ -831,75 +2210,133 @@ inline std::pair<size_t, size_t> PartitionSparseKernel(
     if (p != column.GetRowData() + column.Size() && *p <= rid_span.back()) {
       size_t cursor = p - column.GetRowData();
 
-      for (auto rid : rid_span) {
+      for (size_t i = 0; i < rid_span.size(); ++i) {
+        const size_t rid = rid_span[i];
         while (cursor < column.Size()
                && column.GetRowIdx(cursor) < rid
                && column.GetRowIdx(cursor) <= rid_span.back()) {
           ++cursor;
         }
+        bool go_left;
         if (cursor < column.Size() && column.GetRowIdx(cursor) == rid) {
           const uint32_t rbin = column.GetFeatureBinIdx(cursor);
-          if (static_cast<int32_t>(rbin + column.GetBaseIdx()) <= split_cond) {
-            p_left_part[nleft_elems++] = rid;
-          } else {
-            p_right_part[nright_elems++] = rid;
-          }
+          go_left = go_left_of(static_cast<int32_t>(rbin + column.GetBaseIdx()));
           ++cursor;
         } else {
           // missing value
-          if (default_left) {
-            p_left_part[nleft_elems++] = rid;
-          } else {
-            p_right_part[nright_elems++] = rid;
-          }
+          go_left = default_left;
         }
+        p_decisions[i] = go_left;
+        nleft_elems += go_left;
       }
     } else {  // all rows in rid_span have missing values
-      if (default_left) {
-        std::copy(rid_span.begin(), rid_span.end(), p_left_part);
-        nleft_elems = rid_span.size();
+      std::fill(p_decisions, p_decisions + rid_span.size(), default_left);
+      nleft_elems = default_left ? rid_span.size() : 0;
+    }
+  }
+
+  return {nleft_elems, rid_span.size() - nleft_elems};
+}
+
+template <typename BinIdxType, typename DecisionT>
+inline std::pair<size_t, size_t> PartitionColumnKernel(
+      common::Span<const size_t> rid_span, const Column<BinIdxType>& column,
+      const bool default_left, DecisionT go_left_of, common::Span<uint8_t> decisions) {
+  if (column.GetType() == xgboost::common::kDenseColumn) {
+    if (default_left) {
+      return PartitionDenseKernel<true>(rid_span, column, go_left_of, decisions);
+    } else {
+      return PartitionDenseKernel<false>(rid_span, column, go_left_of, decisions);
+    }
+  } else {
+    if (default_left) {
+      return PartitionSparseKernel<true>(rid_span, go_left_of, column, decisions);
+    } else {
+      return PartitionSparseKernel<false>(rid_span, go_left_of, column, decisions);
+    }
+  }
+}
+
+// Mark row indexes (rid_span) going to the left child (decisions[i] = 1) or the right one.
+// Rows are looked up in a page of the row-wise histogram index, used for external memory
+// where no column matrix is kept.
+template <typename BinIdxType, typename DecisionT>
+inline void PartitionPageKernel(
+      common::Span<const size_t> rid_span, const GHistIndexMatrix& page,
+      const bst_uint fid, DecisionT go_left_of, const bool default_left,
+      common::Span<uint8_t> decisions) {
+  const BinIdxType* gradient_index = page.index.data<BinIdxType>();
+  const size_t base_rowid = page.base_rowid;
+  uint8_t* p_decisions = decisions.data();
+
+  if (page.IsDense()) {
+    const size_t n_features = page.index.OffsetSize();
+    const uint32_t offset = page.index.Offset()[fid];
+    for (size_t i = 0; i < rid_span.size(); ++i) {
+      const size_t row = rid_span[i] - base_rowid;
+      const uint32_t bin = static_cast<uint32_t>(gradient_index[row * n_features + fid]) + offset;
+      p_decisions[i] = go_left_of(static_cast<int32_t>(bin));
+    }
+  } else {
+    // bins of a sparse row are sorted, so the ones of feature fid are consecutive
+    const uint32_t fid_begin = page.cut.Ptrs()[fid];
+    const uint32_t fid_end = page.cut.Ptrs()[fid + 1];
+    for (size_t i = 0; i < rid_span.size(); ++i) {
+      const size_t row = rid_span[i] - base_rowid;
+      const BinIdxType* row_begin = gradient_index + page.row_ptr[row];
+      const BinIdxType* row_end = gradient_index + page.row_ptr[row + 1];
+      const BinIdxType* it = std::lower_bound(row_begin, row_end, fid_begin);
+      if (it != row_end && static_cast<uint32_t>(*it) < fid_end) {
+        p_decisions[i] = go_left_of(static_cast<int32_t>(*it));
       } else {
-        std::copy(rid_span.begin(), rid_span.end(), p_right_part);
-        nright_elems = rid_span.size();
+        // missing value
+        p_decisions[i] = default_left;
       }
     }
   }
+}
 
-  return {nleft_elems, nright_elems};
+template <typename DecisionT>
+inline void PartitionPage(
+      common::Span<const size_t> rid_span, const GHistIndexMatrix& page,
+      const bst_uint fid, DecisionT go_left_of, const bool default_left,
+      common::Span<uint8_t> decisions) {
+  switch (page.index.GetBinTypeSize()) {
+    case common::kUint8BinsTypeSize:
+      PartitionPageKernel<uint8_t>(rid_span, page, fid, go_left_of, default_left, decisions);
+      break;
+    case common::kUint16BinsTypeSize:
+      PartitionPageKernel<uint16_t>(rid_span, page, fid, go_left_of, default_left, decisions);
+      break;
+    case common::kUint32BinsTypeSize:
+      PartitionPageKernel<uint32_t>(rid_span, page, fid, go_left_of, default_left, decisions);
+      break;
+    default:
+      CHECK(false);  // no default behavior
+  }
 }
 
-void QuantileHistMaker::Builder::PartitionKernel(
+template <typename GradientSumT>
+template <typename BinIdxType>
+void QuantileHistMaker::Builder<GradientSumT>::PartitionKernel(
     const size_t node_in_set, const size_t nid, common::Range1d range,
-    const int32_t split_cond, const ColumnMatrix& column_matrix,
-    const GHistIndexMatrix& gmat, const RegTree& tree) {
+    const int32_t split_cond, const ColumnMatrix& column_matrix, const RegTree& tree) {
   const size_t* rid = row_set_collection_[nid].begin;
   common::Span<const size_t> rid_span(rid + range.begin(), rid + range.end());
-  common::Span<size_t> left  = partition_builder_.GetLeftBuffer(node_in_set,
-                                                                range.begin(), range.end());
-  common::Span<size_t> right = partition_builder_.GetRightBuffer(node_in_set,
-                                                                 range.begin(), range.end());
+  common::Span<uint8_t> decisions = partition_builder_.GetDecisionBuffer(node_in_set,
+                                                                         range.begin(), range.end());
   const bst_uint fid = tree[nid].SplitIndex();
   const bool default_left = tree[nid].DefaultLeft();
-  const auto column = column_matrix.GetColumn(fid);
-  const uint32_t offset = column.GetBaseIdx();
-  common::Span<const uint32_t> idx_spin = column.GetFeatureBinIdxPtr();
+  const auto column = column_matrix.GetColumn<BinIdxType>(fid);
 
   std::pair<size_t, size_t> child_nodes_sizes;
-
-  if (column.GetType() == xgboost::common::kDenseColumn) {
-    if (default_left) {
-      child_nodes_sizes = PartitionDenseKernel<true>(
-                            rid_span, idx_spin, split_cond, offset, left, right);
-    } else {
-      child_nodes_sizes = PartitionDenseKernel<false>(
-                            rid_span, idx_spin, split_cond, offset, left, right);
-    }
+  if (tree.NodeSplitType(nid) == FeatureType::kCategorical) {
+    child_nodes_sizes = PartitionColumnKernel(
+        rid_span, column, default_left,
+        CategoricalDecision{tree.NodeCats(nid), column.GetBaseIdx()}, decisions);
   } else {
-    if (default_left) {
-      child_nodes_sizes = PartitionSparseKernel<true>(rid_span, split_cond, column, left, right);
-    } else {
-      child_nodes_sizes = PartitionSparseKernel<false>(rid_span, split_cond, column, left, right);
-    }
+    child_nodes_sizes = PartitionColumnKernel(rid_span, column, default_left,
+                                              NumericalDecision{split_cond}, decisions);
   }
 
   const size_t n_left  = child_nodes_sizes.first;
@@ -910,7 +2347,49 @@ void QuantileHistMaker::Builder::PartitionKernel(
 }
 
 
-void QuantileHistMaker::Builder::FindSplitConditions(const std::vector<ExpandEntry>& nodes,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::PartitionPages(
+    const ExpandList& nodes, const common::BlockedSpace2d& space,
+    const std::vector<int32_t>& split_conditions, const RegTree& tree) {
+  // decisions are made page by page, each page fills its rows of every block
+  for (auto const& page : p_paged_fmat_->GetBatches<GHistIndexMatrix>(PageParam())) {
+    common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
+      const int32_t nid = nodes[node_in_set].nid;
+      const size_t* rid = row_set_collection_[nid].begin;
+      const RowSetCollection::Elem rows = PageRows(
+          RowSetCollection::Elem(rid + r.begin(), rid + r.end(), nid), page);
+      if (rows.Size() == 0) {
+        return;
+      }
+      common::Span<uint8_t> decisions =
+          partition_builder_.GetDecisionBuffer(node_in_set, r.begin(), r.end())
+              .subspan(rows.begin - (rid + r.begin()), rows.Size());
+      common::Span<const size_t> rid_span(rows.begin, rows.end);
+      const bst_uint fid = tree[nid].SplitIndex();
+      const bool default_left = tree[nid].DefaultLeft();
+      if (tree.NodeSplitType(nid) == FeatureType::kCategorical) {
+        PartitionPage(rid_span, page, fid,
+                      CategoricalDecision{tree.NodeCats(nid), page.cut.Ptrs()[fid]},
+                      default_left, decisions);
+      } else {
+        PartitionPage(rid_span, page, fid, NumericalDecision{split_conditions[node_in_set]},
+                      default_left, decisions);
+      }
+    });
+  }
+  // count children rows of each block once all of its decisions are known
+  common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
+    common::Span<uint8_t> decisions =
+        partition_builder_.GetDecisionBuffer(node_in_set, r.begin(), r.end());
+    const size_t n_left = std::accumulate(decisions.begin(), decisions.end(), size_t(0));
+    partition_builder_.SetNLeftElems(node_in_set, r.begin(), r.end(), n_left);
+    partition_builder_.SetNRightElems(node_in_set, r.begin(), r.end(),
+                                      r.end() - r.begin() - n_left);
+  });
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::FindSplitConditions(const ExpandList& nodes,
                                                      const RegTree& tree,
                                                      const GHistIndexMatrix& gmat,
                                                      std::vector<int32_t>* split_conditions) {
@@ -918,26 +2397,12 @@ void QuantileHistMaker::Builder::FindSplitConditions(const std::vector<ExpandEnt
   split_conditions->resize(n_nodes);
 
   for (size_t i = 0; i < nodes.size(); ++i) {
-    const int32_t nid = nodes[i].nid;
-    const bst_uint fid = tree[nid].SplitIndex();
-    const bst_float split_pt = tree[nid].SplitCond();
-    const uint32_t lower_bound = gmat.cut.Ptrs()[fid];
-    const uint32_t upper_bound = gmat.cut.Ptrs()[fid + 1];
-    int32_t split_cond = -1;
-    // convert floating-point split_pt into corresponding bin_id
-    // split_cond = -1 indicates that split_pt is less than all known cut points
-    CHECK_LT(upper_bound,
-             static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-    for (uint32_t i = lower_bound; i < upper_bound; ++i) {
-      if (split_pt == gmat.cut.Values()[i]) {
-        split_cond = static_cast<int32_t>(i);
-      }
-    }
-    (*split_conditions)[i] = split_cond;
+    (*split_conditions)[i] = SplitCondBin(tree, nodes[i].nid, gmat.cut);
   }
 }
 
-void QuantileHistMaker::Builder::AddSplitsToRowSet(const std::vector<ExpandEntry>& nodes,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::AddSplitsToRowSet(const ExpandList& nodes,
                                                    RegTree* p_tree) {
   const size_t n_nodes = nodes.size();
   for (size_t i = 0; i < n_nodes; ++i) {
@@ -951,10 +2416,76 @@ void QuantileHistMaker::Builder::AddSplitsToRowSet(const std::vector<ExpandEntry
 }
 
 
-void QuantileHistMaker::Builder::ApplySplit(const std::vector<ExpandEntry> nodes,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::BroadcastPartitions(
+    const ExpandList& nodes, const common::BlockedSpace2d& space) {
+  builder_monitor_.Start("BroadcastPartitions");
+  // blocks of a node start at a word of bits
+  static_assert(kPartitionBlockSize % 32 == 0, "Partition blocks must be whole words.");
+  const int32_t rank = rabit::GetRank();
+  std::vector<int32_t> owners;
+  for (auto const& entry : nodes) {
+    CHECK(static_cast<size_t>(entry.nid) < split_owner_.size() && split_owner_[entry.nid] >= 0)
+        << "No worker has the feature splitting node " << entry.nid;
+    owners.push_back(split_owner_[entry.nid]);
+  }
+  std::sort(owners.begin(), owners.end());
+  owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+
+  std::vector<size_t> word_offsets(nodes.size());
+  for (int32_t owner : owners) {
+    // rows of the nodes split by the owner, each node starting a new word
+    size_t n_words = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      word_offsets[i] = n_words;
+      if (split_owner_[nodes[i].nid] == owner) {
+        n_words += common::DivRoundUp(row_set_collection_[nodes[i].nid].Size(), 32);
+      }
+    }
+    if (n_words == 0) {
+      continue;
+    }
+    partition_bits_.assign(n_words, 0);
+    if (owner == rank) {
+      common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
+        if (split_owner_[nodes[node_in_set].nid] != owner) {
+          return;
+        }
+        auto decisions = partition_builder_.GetDecisionBuffer(node_in_set, r.begin(), r.end());
+        uint32_t* words = partition_bits_.data() + word_offsets[node_in_set] + r.begin() / 32;
+        for (size_t i = 0; i < decisions.size(); ++i) {
+          words[i / 32] |= static_cast<uint32_t>(decisions[i] != 0) << (i % 32);
+        }
+      });
+    }
+    rabit::Broadcast(partition_bits_.data(), partition_bits_.size() * sizeof(uint32_t), owner);
+    if (owner != rank) {
+      common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
+        if (split_owner_[nodes[node_in_set].nid] != owner) {
+          return;
+        }
+        auto decisions = partition_builder_.GetDecisionBuffer(node_in_set, r.begin(), r.end());
+        const uint32_t* words =
+            partition_bits_.data() + word_offsets[node_in_set] + r.begin() / 32;
+        size_t n_left = 0;
+        for (size_t i = 0; i < decisions.size(); ++i) {
+          decisions[i] = (words[i / 32] >> (i % 32)) & 1U;
+          n_left += decisions[i];
+        }
+        partition_builder_.SetNLeftElems(node_in_set, r.begin(), r.end(), n_left);
+        partition_builder_.SetNRightElems(node_in_set, r.begin(), r.end(),
+                                          decisions.size() - n_left);
+      });
+    }
+  }
+  builder_monitor_.Stop("BroadcastPartitions");
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::ApplySplit(const ExpandList nodes,
                                             const GHistIndexMatrix& gmat,
                                             const ColumnMatrix& column_matrix,
-                                            const HistCollection& hist,
+                                            const HistCollection<GradientSumT>& hist,
                                             RegTree* p_tree) {
   builder_monitor_.Start("ApplySplit");
 
@@ -970,7 +2501,7 @@ void QuantileHistMaker::Builder::ApplySplit(const std::vector<ExpandEntry> nodes
   }, kPartitionBlockSize);
 
   // 2.2 Initialize the partition builder
-  // allocate buffers for storage intermediate results by each thread
+  // allocate buffers for per row decisions made by each thread
   partition_builder_.Init(space.Size(), n_nodes, [&](size_t node_in_set) {
     const int32_t nid = nodes[node_in_set].nid;
     const size_t size = row_set_collection_[nid].Size();
@@ -979,23 +2510,59 @@ void QuantileHistMaker::Builder::ApplySplit(const std::vector<ExpandEntry> nodes
   });
 
   // 2.3 Split elements of row_set_collection_ to left and right child-nodes for each node
-  // Store results in intermediate buffers from partition_builder_
-  common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
-    const int32_t nid = nodes[node_in_set].nid;
-    PartitionKernel(node_in_set, nid, r,
-                    split_conditions[node_in_set], column_matrix, gmat, *p_tree);
-  });
+  // Store per row decisions and counts of each block in partition_builder_
+  if (p_paged_fmat_) {
+    PartitionPages(nodes, space, split_conditions, *p_tree);
+  } else {
+    const bool column_split = this->ColumnSplit();
+    const int32_t rank = rabit::GetRank();
+    common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
+      const int32_t nid = nodes[node_in_set].nid;
+      if (column_split && split_owner_[nid] != rank) {
+        // the feature is on another worker, see BroadcastPartitions()
+        return;
+      }
+      switch (column_matrix.GetTypeSize()) {
+        case common::kUint8BinsTypeSize:
+          PartitionKernel<uint8_t>(node_in_set, nid, r,
+                                   split_conditions[node_in_set], column_matrix, *p_tree);
+          break;
+        case common::kUint16BinsTypeSize:
+          PartitionKernel<uint16_t>(node_in_set, nid, r,
+                                    split_conditions[node_in_set], column_matrix, *p_tree);
+          break;
+        case common::kUint32BinsTypeSize:
+          PartitionKernel<uint32_t>(node_in_set, nid, r,
+                                    split_conditions[node_in_set], column_matrix, *p_tree);
+          break;
+        default:
+          CHECK(false);  // no default behavior
+      }
+    });
+    if (column_split) {
+      this->BroadcastPartitions(nodes, space);
+    }
+  }
 
-  // 3. Compute offsets to copy blocks of row-indexes
-  // from partition_builder_ to row_set_collection_
+  // 3. Compute offsets of each block of row-indexes in the children row sets
   partition_builder_.CalculateRowOffsets();
 
-  // 4. Copy elements from partition_builder_ to row_set_collection_ back
-  // with updated row-indexes for each tree-node
+  const bool use_packed = !packed_gpair_.empty();
+  // 4. Scatter row-indexes of each block directly into the buffer of the children,
+  // it is the other buffer of row_set_collection_, so no copy back is needed
   common::ParallelFor2d(space, this->nthread_, [&](size_t node_in_set, common::Range1d r) {
     const int32_t nid = nodes[node_in_set].nid;
-    partition_builder_.MergeToArray(node_in_set, r.begin(),
-        const_cast<size_t*>(row_set_collection_[nid].begin));
+    const size_t* rid = row_set_collection_[nid].begin;
+    partition_builder_.Scatter(node_in_set, r.begin(),
+        common::Span<const size_t>(rid + r.begin(), rid + r.end()),
+        row_set_collection_.GetChildBuffer(nid));
+    if (use_packed) {
+      // gradients follow their rows, streamed instead of gathered
+      const GradientPair* gpair = PackedGradients(nid);
+      partition_builder_.Scatter(node_in_set, r.begin(),
+          common::Span<const GradientPair>(gpair + r.begin(), gpair + r.end()),
+          PackedGradients(nid, true));
+    }
   });
 
   // 5. Add info about splits into row_set_collection_
@@ -1004,7 +2571,8 @@ void QuantileHistMaker::Builder::ApplySplit(const std::vector<ExpandEntry> nodes
   builder_monitor_.Stop("ApplySplit");
 }
 
-void QuantileHistMaker::Builder::InitNewNode(int nid,
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::InitNewNode(int nid,
                                              const GHistIndexMatrix& gmat,
                                              const std::vector<GradientPair>& gpair,
                                              const DMatrix& fmat,
@@ -1016,15 +2584,16 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
 
   {
     auto& stats = snode_[nid].stats;
-    GHistRow hist = hist_[nid];
     if (tree[nid].IsRoot()) {
       if (data_layout_ == kDenseDataZeroBased || data_layout_ == kDenseDataOneBased) {
+        GHistRowT hist = hist_[nid];
         const std::vector<uint32_t>& row_ptr = gmat.cut.Ptrs();
         const uint32_t ibegin = row_ptr[fid_least_bins_];
         const uint32_t iend = row_ptr[fid_least_bins_ + 1];
+        const int32_t shift = HistShift(gmat, fid_least_bins_);
         auto begin = hist.data();
         for (uint32_t i = ibegin; i < iend; ++i) {
-          const GradStats et = begin[i];
+          const GradStats et(begin[i + shift]);
           stats.Add(et.sum_grad, et.sum_hess);
         }
       } else {
@@ -1033,7 +2602,13 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
           stats.Add(gpair[*it]);
         }
       }
-      histred_.Allreduce(&snode_[nid].stats, 1);
+      if (this->ColumnSplit()) {
+        // every worker has all rows, but may sum them up in a different order
+        rabit::Broadcast(&snode_[nid].stats, sizeof(snode_[nid].stats), 0);
+      } else {
+        statsred_.Allreduce(&snode_[nid].stats, 1);
+      }
+      snode_[nid].stats = this->Dequantize(snode_[nid].stats);
     } else {
       int parent_id = tree[nid].Parent();
       if (tree[nid].IsLeftChild()) {
@@ -1059,19 +2634,20 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
 // Enumerate the split values of specific feature.
 // Returns the sum of gradients corresponding to the data points that contains a non-missing value
 // for the particular feature fid.
-template <int d_step>
-GradStats QuantileHistMaker::Builder::EnumerateSplit(
-    const GHistIndexMatrix &gmat, const GHistRow &hist, const NodeEntry &snode,
-    SplitEntry *p_best, bst_uint fid, bst_uint nodeID) const {
+template <typename GradientSumT>
+template <int d_step, typename Evaluator>
+GradStats QuantileHistMaker::Builder<GradientSumT>::EnumerateSplit(
+    const GHistIndexMatrix &gmat, const GHistRowT &hist, const NodeEntry &snode,
+    SplitEntry *p_best, bst_uint fid, bst_uint nodeID, const Evaluator& evaluator) const {
   CHECK(d_step == +1 || d_step == -1);
 
   // aliases
   const std::vector<uint32_t>& cut_ptr = gmat.cut.Ptrs();
-  const std::vector<bst_float>& cut_val = gmat.cut.Values();
 
-  // statistics on both sides of split
-  GradStats c;
+  // statistics of the bins enumerated so far
   GradStats e;
+  // running sum in histogram units, exact for integer histograms
+  GradStats sum;
   // best split so far
   SplitEntry best;
 
@@ -1080,9 +2656,6 @@ GradStats QuantileHistMaker::Builder::EnumerateSplit(
            static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
   CHECK_LE(cut_ptr[fid + 1],
            static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-  // imin: index (offset) of the minimum value for feature fid
-  //       need this for backward enumeration
-  const auto imin = static_cast<int32_t>(cut_ptr[fid]);
   // ibegin, iend: smallest/largest cut points for feature fid
   // use int to allow for value -1
   int32_t ibegin, iend;
@@ -1094,43 +2667,199 @@ GradStats QuantileHistMaker::Builder::EnumerateSplit(
     iend = static_cast<int32_t>(cut_ptr[fid]) - 1;
   }
 
+  // bins of fid are elsewhere in hist when features are bundled
+  const int32_t shift = HistShift(gmat, fid);
   for (int32_t i = ibegin; i != iend; i += d_step) {
-    // start working
+    // An empty bin leaves both sides as they are after the previous bin, so the split at
+    // its bound has the same gain and can't replace the earlier one.  Small nodes deep
+    // in the tree have mostly empty bins.
+    const auto& bin = hist[i + shift];
+    if (i != ibegin && bin.GetGrad() == 0 && bin.GetHess() == 0) {
+      continue;
+    }
     // try to find a split
-    e.Add(hist[i].GetGrad(), hist[i].GetHess());
-    if (e.sum_hess >= param_.min_child_weight) {
-      c.SetSubstract(snode.stats, e);
-      if (c.sum_hess >= param_.min_child_weight) {
-        bst_float loss_chg;
-        bst_float split_pt;
-        if (d_step > 0) {
-          // forward enumeration: split at right bound of each bin
-          loss_chg = static_cast<bst_float>(
-              spliteval_->ComputeSplitScore(nodeID, fid, e, c) -
-              snode.root_gain);
-          split_pt = cut_val[i];
-          best.Update(loss_chg, fid, split_pt, d_step == -1, e, c);
-        } else {
-          // backward enumeration: split at left bound of each bin
-          loss_chg = static_cast<bst_float>(
-              spliteval_->ComputeSplitScore(nodeID, fid, c, e) -
-              snode.root_gain);
-          if (i == imin) {
-            // for leftmost bin, left bound is the smallest feature value
-            split_pt = gmat.cut.MinValues()[fid];
-          } else {
-            split_pt = cut_val[i - 1];
-          }
-          best.Update(loss_chg, fid, split_pt, d_step == -1, c, e);
-        }
-      }
+    sum.Add(bin.GetGrad(), bin.GetHess());
+    e = this->Dequantize(sum);
+    this->UpdateBestSplit<d_step>(gmat, snode, fid, nodeID, i, e, evaluator, &best);
+  }
+  p_best->Update(best);
+
+  return e;
+}
+
+template <typename GradientSumT>
+template <int d_step, typename Evaluator>
+GradStats QuantileHistMaker::Builder<GradientSumT>::EnumerateNodeBins(
+    const GHistIndexMatrix &gmat, size_t pos, const NodeEntry &snode,
+    SplitEntry *p_best, bst_uint fid, bst_uint nodeID, const Evaluator& evaluator) const {
+  const std::vector<uint32_t>& cut_ptr = gmat.cut.Ptrs();
+  const uint32_t* node_begin = node_bins_.data() + node_bins_ptr_[pos];
+  const uint32_t* node_end = node_begin + node_bins_size_[pos];
+  // non-empty bins of fid in the node
+  const uint32_t* first = std::lower_bound(node_begin, node_end, cut_ptr[fid]);
+  const uint32_t* last = std::lower_bound(first, node_end, cut_ptr[fid + 1]);
+  const auto* sums = node_bin_sums_.data() + node_bins_ptr_[pos];
+  const auto n = static_cast<int32_t>(last - first);
+  const auto offset = static_cast<int32_t>(first - node_begin);
+
+  GradStats e;
+  GradStats sum;
+  SplitEntry best;
+  // The same bins as the histogram enumeration visits: the first bin of the feature
+  // even when it's empty, then the non-empty ones.
+  const auto ibegin = static_cast<int32_t>(d_step > 0 ? cut_ptr[fid] : cut_ptr[fid + 1] - 1);
+  const int32_t kbegin = d_step > 0 ? 0 : n - 1;
+  if (cut_ptr[fid + 1] != cut_ptr[fid] &&
+      (n == 0 || static_cast<int32_t>(first[kbegin]) != ibegin)) {
+    this->UpdateBestSplit<d_step>(gmat, snode, fid, nodeID, ibegin, e, evaluator, &best);
+  }
+  for (int32_t k = kbegin; k >= 0 && k < n; k += d_step) {
+    const auto& bin = sums[offset + k];
+    const auto i = static_cast<int32_t>(first[k]);
+    if (i != ibegin && bin.GetGrad() == 0 && bin.GetHess() == 0) {
+      continue;
     }
+    sum.Add(bin.GetGrad(), bin.GetHess());
+    e = this->Dequantize(sum);
+    this->UpdateBestSplit<d_step>(gmat, snode, fid, nodeID, i, e, evaluator, &best);
   }
   p_best->Update(best);
 
   return e;
 }
 
+template <typename GradientSumT>
+template <int d_step, typename Evaluator>
+void QuantileHistMaker::Builder<GradientSumT>::UpdateBestSplit(
+    const GHistIndexMatrix &gmat, const NodeEntry &snode, bst_uint fid, bst_uint nodeID,
+    int32_t i, const GradStats &e, const Evaluator& evaluator, SplitEntry *best) const {
+  if (e.sum_hess < param_.min_child_weight) {
+    return;
+  }
+  GradStats c;
+  c.SetSubstract(snode.stats, e);
+  if (c.sum_hess < param_.min_child_weight) {
+    return;
+  }
+  const std::vector<bst_float>& cut_val = gmat.cut.Values();
+  bst_float loss_chg;
+  bst_float split_pt;
+  if (d_step > 0) {
+    // forward enumeration: split at right bound of each bin
+    loss_chg = static_cast<bst_float>(
+        evaluator.ComputeSplitScore(nodeID, fid, e, c) -
+        snode.root_gain);
+    split_pt = cut_val[i];
+    best->Update(loss_chg, fid, split_pt, d_step == -1, e, c);
+  } else {
+    // backward enumeration: split at left bound of each bin
+    loss_chg = static_cast<bst_float>(
+        evaluator.ComputeSplitScore(nodeID, fid, c, e) -
+        snode.root_gain);
+    if (i == static_cast<int32_t>(gmat.cut.Ptrs()[fid])) {
+      // for leftmost bin, left bound is the smallest feature value
+      split_pt = gmat.cut.MinValues()[fid];
+    } else {
+      split_pt = cut_val[i - 1];
+    }
+    best->Update(loss_chg, fid, split_pt, d_step == -1, c, e);
+  }
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::ExpandBestSplit(int nid, bst_float left_weight,
+                                                               bst_float right_weight,
+                                                               RegTree* p_tree) {
+  NodeEntry const& e = snode_[nid];
+  if (this->IsCategorical(e.best.SplitIndex())) {
+    common::Span<uint64_t const> cats{split_cats_[nid]};
+    p_tree->ExpandCategorical(nid, e.best.SplitIndex(), cats, e.best.split_value, e.best.DefaultLeft(), e.weight,
+                              left_weight, right_weight, e.best.loss_chg, e.stats.sum_hess);
+  } else {
+    p_tree->ExpandNode(nid, e.best.SplitIndex(), e.best.split_value, e.best.DefaultLeft(),
+                       e.weight, left_weight, right_weight, e.best.loss_chg,
+                       e.stats.sum_hess);
+  }
+}
+
+template <typename GradientSumT>
+void QuantileHistMaker::Builder<GradientSumT>::SortCategories(
+    const GHistIndexMatrix &gmat, const GHistRowT &hist, bst_uint fid,
+    std::vector<std::pair<bst_cat_t, GradStats>>* p_sorted) const {
+  auto& sorted = *p_sorted;
+  sorted.clear();
+  const auto& cut_ptr = gmat.cut.Ptrs();
+  const int32_t shift = HistShift(gmat, fid);
+  for (uint32_t i = cut_ptr[fid]; i < cut_ptr[fid + 1]; ++i) {
+    const auto& bin = hist[i + shift];
+    if (bin.GetGrad() == 0 && bin.GetHess() == 0) {
+      continue;
+    }
+    GradStats stats;
+    stats.Add(bin.GetGrad(), bin.GetHess());
+    sorted.emplace_back(static_cast<bst_cat_t>(i - cut_ptr[fid]), this->Dequantize(stats));
+  }
+  // The optimal partition of the categories for a convex loss is a prefix of the order
+  // by weight (Fisher, 1958), stable so that all workers agree on it.
+  const double lambda = param_.reg_lambda;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [lambda](std::pair<bst_cat_t, GradStats> const& l,
+                            std::pair<bst_cat_t, GradStats> const& r) {
+                     return l.second.GetGrad() / (l.second.GetHess() + lambda) <
+                            r.second.GetGrad() / (r.second.GetHess() + lambda);
+                   });
+}
+
+template <typename GradientSumT>
+template <typename Evaluator>
+GradStats QuantileHistMaker::Builder<GradientSumT>::EnumerateCategoricalSplit(
+    const GHistIndexMatrix &gmat, const GHistRowT &hist, const NodeEntry &snode,
+    SplitEntry *p_best, bst_uint fid, bst_uint nodeID, const Evaluator& evaluator) const {
+  std::vector<std::pair<bst_cat_t, GradStats>> sorted;
+  this->SortCategories(gmat, hist, fid, &sorted);
+  // statistics of the rows having a category, the rest is missing
+  GradStats present;
+  for (auto const& cat : sorted) {
+    present.Add(cat.second);
+  }
+  GradStats missing;
+  missing.SetSubstract(snode.stats, present);
+  const bool has_missing = present.GetGrad() != snode.stats.GetGrad() ||
+                           present.GetHess() != snode.stats.GetHess();
+
+  SplitEntry best;
+  GradStats left;
+  GradStats right;
+  auto try_split = [&](GradStats const& l, GradStats const& r, size_t n_left,
+                       bool default_left) {
+    if (l.sum_hess < param_.min_child_weight || r.sum_hess < param_.min_child_weight) {
+      return;
+    }
+    auto loss_chg = static_cast<bst_float>(
+        evaluator.ComputeSplitScore(nodeID, fid, l, r) - snode.root_gain);
+    best.Update(loss_chg, fid, static_cast<bst_float>(n_left), default_left, l, r);
+  };
+  for (size_t n_left = 1; n_left < sorted.size() + (has_missing ? 1 : 0); ++n_left) {
+    left.Add(sorted[n_left - 1].second);
+    right.SetSubstract(present, left);
+    GradStats l = left;
+    l.Add(missing);
+    try_split(l, right, n_left, true);
+    if (has_missing) {
+      GradStats r = right;
+      r.Add(missing);
+      try_split(left, r, n_left, false);
+    }
+  }
+  p_best->Update(best);
+  return present;
+}
+
+template struct QuantileHistMaker::Builder<float>;
+template struct QuantileHistMaker::Builder<double>;
+template struct QuantileHistMaker::Builder<int32_t>;
+template struct QuantileHistMaker::Builder<int64_t>;
+
 XGBOOST_REGISTER_TREE_UPDATER(FastHistMaker, "grow_fast_histmaker")
 .describe("(Deprecated, use grow_quantile_histmaker instead.)"
           " Grow tree using quantized histogram.")
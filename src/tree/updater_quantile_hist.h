@@ -21,6 +21,7 @@
 
 #include "xgboost/data.h"
 #include "xgboost/json.h"
+#include "xgboost/objective.h"
 #include "constraints.h"
 #include "./param.h"
 #include "./split_evaluator.h"
@@ -29,6 +30,8 @@
 #include "../common/hist_util.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#include "../common/gradient_soa.h"
+#include "../common/arena.h"
 
 namespace xgboost {
 
@@ -78,6 +81,171 @@ using xgboost::common::GHistBuilder;
 using xgboost::common::ColumnMatrix;
 using xgboost::common::Column;
 
+struct CPUHistMakerTrainParam
+    : public XGBoostParameter<CPUHistMakerTrainParam> {
+  // instruction set of histogram kernels, see common::HistISA
+  int hist_isa;
+  bool single_precision_histogram;
+  // whether and into how many bits gradients are quantized before building histograms
+  enum GradientQuantization {
+    kNoQuantization = 0, kInt16Quantization = 16, kInt32Quantization = 32
+  };
+  int gradient_quantization;
+  // memory limit of cached node histograms
+  size_t max_hist_bytes;
+  // number of lossguide candidates expanded together
+  int lossguide_batch_size;
+  // whether to histogram exclusive features as bundles
+  bool feature_bundling;
+  // whether to pin threads and reduce histograms by socket
+  bool numa_aware;
+  // whether to keep gradients in the order of rows of each node
+  bool packed_gradients;
+  // number of trees of a forest grown at the same time
+  int concurrent_trees;
+  // whether each worker only enumerates the splits of its share of features
+  bool distributed_split_evaluation;
+  // precision of the histograms sent over the network
+  enum HistAllreducePrecision { kNativePrecision = 0, kFloatPrecision = 1 };
+  int hist_allreduce_precision;
+  // whether the histogram allreduce skips feature ranges empty in a node on every worker
+  bool hist_allreduce_skip_empty;
+  // number of chunks the histograms of a depthwise level are built and allreduced in
+  int hist_allreduce_chunks;
+  // how the data is split over the workers, same as the learner's `dsplit'
+  enum DataSplitMode { kAutoSplit = 0, kColSplit = 1, kRowSplit = 2 };
+  int dsplit;
+  // whether workers sample the same number of rows regardless of their share of rows
+  bool balanced_sampling;
+  // nodes with fewer rows than this times the bins of a histogram enumerate their rows
+  float small_node_ratio;
+  // quantile sketch of the cuts, see common::SketchMethod
+  int sketch_method;
+  // name of the batch building root histograms together with other boosters
+  std::string hist_batch;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(CPUHistMakerTrainParam) {
+    DMLC_DECLARE_FIELD(hist_isa)
+        .set_default(static_cast<int>(common::HistISA::kAuto))
+        .add_enum("auto", static_cast<int>(common::HistISA::kAuto))
+        .add_enum("scalar", static_cast<int>(common::HistISA::kScalar))
+        .add_enum("avx2", static_cast<int>(common::HistISA::kAVX2))
+        .add_enum("avx512", static_cast<int>(common::HistISA::kAVX512))
+        .describe("Instruction set used by histogram kernels. 'auto' detects the CPU, "
+                  "other values force a specific one, mostly for benchmarking.");
+    DMLC_DECLARE_FIELD(single_precision_histogram).set_default(false).describe(
+        "Use single precision to build histograms.");
+    DMLC_DECLARE_FIELD(gradient_quantization)
+        .set_default(kNoQuantization)
+        .add_enum("none", kNoQuantization)
+        .add_enum("int16", kInt16Quantization)
+        .add_enum("int32", kInt32Quantization)
+        .describe("Round gradients to fixed point integers once per tree and build "
+                  "histograms with integer additions, making them reproducible "
+                  "regardless of the number of threads.  'int16' uses 32 bit "
+                  "histogram bins, 'int32' uses 64 bit ones.");
+    DMLC_DECLARE_FIELD(max_hist_bytes)
+        .set_default(0)
+        .describe("Maximum memory in bytes used for histograms of tree nodes, 0 means "
+                  "no limit.  Histograms of leaves waiting for expansion are evicted "
+                  "when it is reached and their children are then built without the "
+                  "subtraction trick.");
+    DMLC_DECLARE_FIELD(lossguide_batch_size)
+        .set_default(1)
+        .set_lower_bound(1)
+        .describe("Number of top candidates of the lossguide queue split together, "
+                  "their children histograms are built and evaluated in a single "
+                  "parallel pass.  1 expands nodes strictly one at a time.");
+    DMLC_DECLARE_FIELD(feature_bundling)
+        .set_default(false)
+        .describe("Bundle mutually exclusive features, such as one-hot encoded ones, "
+                  "into the columns of a compact dense matrix histograms are built "
+                  "from.  Trees are the same as without bundling.");
+    DMLC_DECLARE_FIELD(numa_aware)
+        .set_default(false)
+        .describe("Pin threads to CPUs during training, so the quantized matrix and "
+                  "histograms stay on the memory of the socket using them, and sum up "
+                  "per thread histograms within each socket before merging them.");
+    DMLC_DECLARE_FIELD(packed_gradients)
+        .set_default(false)
+        .describe("Keep a copy of gradients in the order of rows of each node, "
+                  "permuted along with the rows on every split, so histograms read "
+                  "gradients sequentially.  Only for in-memory data without feature "
+                  "grouping.");
+    DMLC_DECLARE_FIELD(concurrent_trees)
+        .set_default(1)
+        .set_lower_bound(1)
+        .describe("Number of trees of a forest (num_parallel_tree) grown at the same "
+                  "time, each by its own group of threads with its own row sets and "
+                  "histograms, sharing the quantized matrix.  Only for in-memory data "
+                  "on a single worker, 1 grows the trees one after another.");
+    DMLC_DECLARE_FIELD(distributed_split_evaluation)
+        .set_default(false)
+        .describe("In distributed training, let each worker enumerate the splits of "
+                  "a share of the features, balanced by their number of bins, and "
+                  "allreduce the best split of each node instead of every worker "
+                  "evaluating every feature.  Trees are the same either way.");
+    DMLC_DECLARE_FIELD(hist_allreduce_precision)
+        .set_default(kNativePrecision)
+        .add_enum("native", kNativePrecision)
+        .add_enum("float", kFloatPrecision)
+        .describe("Precision double precision histograms are sent with in distributed "
+                  "training.  'float' halves the bytes of the allreduce, at the cost of "
+                  "rounding the sums.  Single precision and integer histograms are "
+                  "always sent as they are.");
+    DMLC_DECLARE_FIELD(hist_allreduce_skip_empty)
+        .set_default(false)
+        .describe("In distributed training, first agree on the features having "
+                  "a non-zero bin in each node on any worker, then allreduce the bins "
+                  "of only those features.  Lossless, it pays off when nodes leave many "
+                  "features empty, like sparse features in deep nodes.");
+    DMLC_DECLARE_FIELD(hist_allreduce_chunks)
+        .set_default(1)
+        .set_lower_bound(1)
+        .describe("In distributed training with depthwise growing, split the nodes of "
+                  "a level into this many chunks, and build the local histograms of a "
+                  "chunk while the previous one is allreduced.  Trees are the same as "
+                  "with 1, which builds the whole level before a single allreduce.");
+    DMLC_DECLARE_FIELD(dsplit)
+        .set_default(kAutoSplit)
+        .add_enum("auto", kAutoSplit)
+        .add_enum("col", kColSplit)
+        .add_enum("row", kRowSplit)
+        .describe("Data split mode of distributed training, shared with the learner.  "
+                  "With 'col' every worker has all rows of its own features, finds the "
+                  "best splits among them, and the worker owning the winning feature "
+                  "sends the partition of the rows to the others.");
+    DMLC_DECLARE_FIELD(balanced_sampling)
+        .set_default(false)
+        .describe("In distributed training with row subsampling, adapt the sampling "
+                  "rate of each worker to its number of rows so all workers sample "
+                  "about the same number of rows, subsample of all rows in total.  "
+                  "Sampled gradients are reweighted to keep the histograms unbiased.");
+    DMLC_DECLARE_FIELD(small_node_ratio)
+        .set_default(0.0f)
+        .set_lower_bound(0.0f)
+        .describe("Find the splits of a node with fewer rows than this times the number "
+                  "of histogram bins from the sorted bins of its rows, without "
+                  "allocating, building or scanning a histogram.  Both children of a "
+                  "split need to be small, as the subtraction trick needs the histogram "
+                  "of the other.  Only for in-memory data on a single worker without "
+                  "categorical features, 0 always builds histograms.");
+    DMLC_DECLARE_FIELD(sketch_method)
+        .set_default(static_cast<int>(common::SketchMethod::kWQ))
+        .add_enum("wq", static_cast<int>(common::SketchMethod::kWQ))
+        .add_enum("compact", static_cast<int>(common::SketchMethod::kCompact))
+        .describe("Quantile sketch finding the histogram cuts.  'compact' keeps a few "
+                  "thousand items per feature however many rows there are, and gives "
+                  "each thread its own features instead of a copy of every sketch, for "
+                  "wide data where the multi-level 'wq' sketches outgrow the data.");
+    DMLC_DECLARE_FIELD(hist_batch)
+        .set_default("")
+        .describe("Set by batched training of several boosters on the same data, the "
+                  "root histograms of their trees are built together in one pass over "
+                  "the quantized matrix.  See common::HistBatch.");
+  }
+};
+
 /*! \brief construct a tree using quantized feature values */
 class QuantileHistMaker: public TreeUpdater {
  public:
@@ -87,17 +255,28 @@ class QuantileHistMaker: public TreeUpdater {
   void Update(HostDeviceVector<GradientPair>* gpair,
               DMatrix* dmat,
               const std::vector<RegTree*>& trees) override;
+  bool UpdateWithGradient(ElementWiseGradient* grad,
+                          HostDeviceVector<GradientPair>* gpair,
+                          DMatrix* dmat,
+                          const std::vector<RegTree*>& trees) override;
 
   bool UpdatePredictionCache(const DMatrix* data,
                              HostDeviceVector<bst_float>* out_preds) override;
+  bool UpdateLeafIndices(const DMatrix* data, HostDeviceVector<uint32_t>* out_leaf,
+                         size_t offset) override;
 
   void LoadConfig(Json const& in) override {
     auto const& config = get<Object const>(in);
     fromJson(config.at("train_param"), &this->param_);
+    auto it = config.find("cpu_hist_train_param");
+    if (it != config.cend()) {
+      fromJson(it->second, &this->hist_maker_param_);
+    }
   }
   void SaveConfig(Json* p_out) const override {
     auto& out = *p_out;
     out["train_param"] = toJson(param_);
+    out["cpu_hist_train_param"] = toJson(hist_maker_param_);
   }
 
   char const* Name() const override {
@@ -107,12 +286,20 @@ class QuantileHistMaker: public TreeUpdater {
  protected:
   // training parameter
   TrainParam param_;
-  // quantized data matrix
-  GHistIndexMatrix gmat_;
+  CPUHistMakerTrainParam hist_maker_param_;
+  // quantized data matrix, owned and cached by the DMatrix
+  GHistIndexMatrix const* p_gmat_ {nullptr};
+  // cuts of the quantized pages of an external memory matrix
+  GHistIndexMatrix page_cuts_;
   // (optional) data matrix with feature grouping
   GHistIndexBlockMatrix gmatb_;
   // column accessor
   ColumnMatrix column_matrix_;
+  // (optional) exclusive feature bundles of the quantized matrix
+  GHistIndexMatrix bundled_gmat_;
+  std::vector<uint32_t> bundle_feature_offset_;
+  // socket of each thread while threads are pinned, empty otherwise
+  std::vector<size_t> thread_socket_;
   DMatrix const* p_last_dmat_ {nullptr};
   bool is_gmat_initialized_ {false};
 
@@ -131,19 +318,22 @@ class QuantileHistMaker: public TreeUpdater {
         : root_gain(0.0f), weight(0.0f) {}
   };
   // actual builder that runs the algorithm
-
+  template<typename GradientSumT>
   struct Builder {
    public:
+    using GHistRowT = GHistRow<GradientSumT>;
     // constructor
     explicit Builder(const TrainParam& param,
-                     std::unique_ptr<TreeUpdater> pruner,
+                     const CPUHistMakerTrainParam& hist_maker_param,
+                     std::unique_ptr<TreeUpdater> syncher,
                      std::unique_ptr<SplitEvaluator> spliteval,
                      FeatureInteractionConstraintHost int_constraints_,
                      DMatrix const* fmat)
-      : param_(param), pruner_(std::move(pruner)),
+      : param_(param), hist_maker_param_(hist_maker_param), syncher_(std::move(syncher)),
         spliteval_(std::move(spliteval)), interaction_constraints_{int_constraints_},
         p_last_tree_(nullptr), p_last_fmat_(fmat) {
       builder_monitor_.Init("Quantile::Builder");
+      builder_monitor_.EnablePerfCounters();
     }
     // update one tree, growing
     virtual void Update(const GHistIndexMatrix& gmat,
@@ -153,19 +343,69 @@ class QuantileHistMaker: public TreeUpdater {
                         DMatrix* p_fmat,
                         RegTree* p_tree);
 
+    /*!
+     * \brief Build histograms from exclusive feature bundles of the quantized matrix
+     *  instead of the matrix itself, nullptr to stop using bundles.
+     * \param p_feature_offset start of the bins of each feature in the histograms
+     */
+    /*!
+     * \brief Reduce per thread histograms of each group first, see
+     *  ParallelGHistBuilder::SetThreadGroups().  Ignored unless there is a group for
+     *  every thread.
+     */
+    void SetThreadGroups(const std::vector<size_t>& thread_group) {
+      thread_group_ = thread_group;
+    }
+
+    /*!
+     * \brief Sample the rows of the next tree with `seed' instead of a draw from the
+     *  global random engine, which trees grown concurrently can't share.
+     */
+    void SetSampleSeed(uint32_t seed) {
+      sample_seed_ = seed;
+      has_sample_seed_ = true;
+    }
+
+    /*!
+     * \brief Compute the gradient of the next tree from `grad' in the first pass over the
+     *  rows instead of reading it, rows can't be sampled.
+     */
+    void SetGradient(ElementWiseGradient* grad) {
+      p_gradient_ = grad;
+    }
+
+    void SetFeatureBundles(const GHistIndexMatrix* p_bundled_gmat,
+                           const std::vector<uint32_t>* p_feature_offset) {
+      p_bundled_gmat_ = p_bundled_gmat;
+      p_feature_offset_ = p_bundled_gmat == nullptr ? nullptr : p_feature_offset;
+    }
+
     inline void BuildHist(const std::vector<GradientPair>& gpair,
                           const RowSetCollection::Elem row_indices,
                           const GHistIndexMatrix& gmat,
                           const GHistIndexBlockMatrix& gmatb,
-                          GHistRow hist) {
+                          GHistRowT hist) {
       if (param_.enable_feature_grouping > 0) {
         hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, hist);
       } else {
-        hist_builder_.BuildHist(gpair, row_indices, gmat, hist, data_layout_ != kSparseData);
+        hist_builder_.BuildHist(gpair, row_indices, HistIndex(gmat), hist);
+      }
+    }
+    // same, only for the given feature block of hist_builder_
+    inline void BuildHist(const std::vector<GradientPair>& gpair,
+                          const RowSetCollection::Elem row_indices,
+                          const GHistIndexMatrix& gmat,
+                          const GHistIndexBlockMatrix& gmatb,
+                          GHistRowT hist,
+                          size_t feature_block) {
+      if (param_.enable_feature_grouping > 0) {
+        hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, hist);
+      } else {
+        hist_builder_.BuildHist(gpair, row_indices, HistIndex(gmat), hist, feature_block);
       }
     }
 
-    inline void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+    inline void SubtractionTrick(GHistRowT self, GHistRowT sibling, GHistRowT parent) {
       builder_monitor_.Start("SubtractionTrick");
       hist_builder_.SubtractionTrick(self, sibling, parent);
       builder_monitor_.Stop("SubtractionTrick");
@@ -173,6 +413,7 @@ class QuantileHistMaker: public TreeUpdater {
 
     bool UpdatePredictionCache(const DMatrix* data,
                                HostDeviceVector<bst_float>* p_out_preds);
+    bool UpdateLeafIndices(const DMatrix* data, common::Span<uint32_t> out_leaf);
 
    protected:
     /* tree growing policies */
@@ -188,12 +429,17 @@ class QuantileHistMaker: public TreeUpdater {
         nid(nid), sibling_nid(sibling_nid), depth(depth), loss_chg(loss_chg), timestamp(tstmp) {}
 
       bool IsValid(TrainParam const& param, int32_t num_leaves) const {
-        bool ret = loss_chg <= kRtEps ||
+        bool ret = loss_chg <= kRtEps || loss_chg < param.min_split_loss ||
                    (param.max_depth > 0 && this->depth == param.max_depth) ||
                    (param.max_leaves > 0 && num_leaves == param.max_leaves);
         return ret;
       }
     };
+    // nodes of the tree being grown, locals take their memory from arena_
+    using ExpandList = common::ArenaVector<ExpandEntry>;
+    common::ArenaAllocator<ExpandEntry> TreeAlloc() const {
+      return common::ArenaAllocator<ExpandEntry>(&arena_);
+    }
 
     // initialize temp data structure
     void InitData(const GHistIndexMatrix& gmat,
@@ -201,26 +447,53 @@ class QuantileHistMaker: public TreeUpdater {
                   const DMatrix& fmat,
                   const RegTree& tree);
 
-    void EvaluateSplits(const std::vector<ExpandEntry>& nodes_set,
+    /*!
+     * \brief Sample rows with non-negative hessian into row_indices, uniformly or based
+     *  on their gradients.  Each block of rows draws from its own engine, seeded from the
+     *  global one, so the sample doesn't depend on the number of threads.
+     */
+    void SampleRows(const std::vector<GradientPair>& gpair, size_t n_rows,
+                    std::vector<size_t>* p_row_indices);
+    // pass the leaf of the last tree reached by each row left out by subsampling to
+    // `on_leaf(row, nid)'
+    template <typename Fn>
+    void WalkUnsampledRows(Fn on_leaf);
+    // the leaf of the last tree holding the rows of node `nid', skipping pruned nodes
+    int LastLeaf(int nid) const;
+
+    void EvaluateSplits(const ExpandList& nodes_set,
                         const GHistIndexMatrix& gmat,
-                        const HistCollection& hist,
+                        const HistCollection<GradientSumT>& hist,
                         const RegTree& tree);
 
-    void ApplySplit(std::vector<ExpandEntry> nodes,
+    /*!
+     * \brief Send the row decisions of the splits of each worker to the others, as one
+     *  bit for each row, when features are split over the workers.  Only the worker
+     *  owning the split feature has its values.
+     */
+    void BroadcastPartitions(const ExpandList& nodes,
+                             const common::BlockedSpace2d& space);
+
+    void ApplySplit(ExpandList nodes,
                         const GHistIndexMatrix& gmat,
                         const ColumnMatrix& column_matrix,
-                        const HistCollection& hist,
+                        const HistCollection<GradientSumT>& hist,
                         RegTree* p_tree);
 
+    template <typename BinIdxType>
     void PartitionKernel(const size_t node_in_set, const size_t nid, common::Range1d range,
                          const int32_t split_cond,
-                         const ColumnMatrix& column_matrix, const GHistIndexMatrix& gmat,
-                         const RegTree& tree);
+                         const ColumnMatrix& column_matrix, const RegTree& tree);
 
-    void AddSplitsToRowSet(const std::vector<ExpandEntry>& nodes, RegTree* p_tree);
+    // make split decisions for rows of external memory, page by page
+    void PartitionPages(const ExpandList& nodes,
+                        const common::BlockedSpace2d& space,
+                        const std::vector<int32_t>& split_conditions, const RegTree& tree);
 
+    void AddSplitsToRowSet(const ExpandList& nodes, RegTree* p_tree);
 
-    void FindSplitConditions(const std::vector<ExpandEntry>& nodes, const RegTree& tree,
+
+    void FindSplitConditions(const ExpandList& nodes, const RegTree& tree,
                              const GHistIndexMatrix& gmat, std::vector<int32_t>* split_conditions);
 
     void InitNewNode(int nid,
@@ -232,10 +505,56 @@ class QuantileHistMaker: public TreeUpdater {
     // Enumerate the split values of specific feature
     // Returns the sum of gradients corresponding to the data points that contains a non-missing
     // value for the particular feature fid.
-    template <int d_step>
-    GradStats EnumerateSplit(const GHistIndexMatrix &gmat, const GHistRow &hist,
+    template <int d_step, typename Evaluator>
+    GradStats EnumerateSplit(const GHistIndexMatrix &gmat, const GHistRowT &hist,
                              const NodeEntry &snode, SplitEntry *p_best,
-                             bst_uint fid, bst_uint nodeID) const;
+                             bst_uint fid, bst_uint nodeID,
+                             const Evaluator& evaluator) const;
+    // Same as EnumerateSplit, over the non-empty bins of node pos in
+    // nodes_for_enumeration_ instead of a histogram.
+    template <int d_step, typename Evaluator>
+    GradStats EnumerateNodeBins(const GHistIndexMatrix &gmat, size_t pos,
+                                const NodeEntry &snode, SplitEntry *p_best,
+                                bst_uint fid, bst_uint nodeID,
+                                const Evaluator& evaluator) const;
+    // try the split at the bound of bin i, with e the sum of the bins enumerated so far
+    template <int d_step, typename Evaluator>
+    void UpdateBestSplit(const GHistIndexMatrix &gmat, const NodeEntry &snode,
+                         bst_uint fid, bst_uint nodeID, int32_t i, const GradStats &e,
+                         const Evaluator& evaluator, SplitEntry *best) const;
+    // Enumerate the splits of a categorical feature, the categories are ordered by the
+    // weight of their rows and the split sends a prefix of the order to the left.  The
+    // split value of the entry is the length of the prefix.
+    template <typename Evaluator>
+    GradStats EnumerateCategoricalSplit(const GHistIndexMatrix &gmat, const GHistRowT &hist,
+                                        const NodeEntry &snode, SplitEntry *p_best,
+                                        bst_uint fid, bst_uint nodeID,
+                                        const Evaluator& evaluator) const;
+    // Enumerate the splits of the candidate features of every node in the set with the
+    // evaluator, which is resolved statically for the built-in evaluators.
+    template <typename Evaluator>
+    void EnumerateFeatures(const ExpandList& nodes_set,
+                           const GHistIndexMatrix& gmat,
+                           const HistCollection<GradientSumT>& hist,
+                           const common::BlockedSpace2d& space,
+                           const Evaluator& evaluator);
+    // non-empty categories of feature fid in the node, in the order of the enumeration
+    void SortCategories(const GHistIndexMatrix &gmat, const GHistRowT &hist, bst_uint fid,
+                        std::vector<std::pair<bst_cat_t, GradStats>>* p_sorted) const;
+    // expand node nid with its best split, categorical or numerical
+    void ExpandBestSplit(int nid, bst_float left_weight, bst_float right_weight,
+                         RegTree* p_tree);
+    bool IsCategorical(bst_feature_t fid) const {
+      return !feature_types_.empty() && feature_types_[fid] == FeatureType::kCategorical;
+    }
+
+    // Round the gradients to integers for integer histograms, a no-op for floating point
+    // ones.  The scale is shared by all workers.
+    void QuantizeGradients(const std::vector<GradientPair>& gpair);
+    // turn a sum of histogram bins into gradient statistics
+    GradStats Dequantize(const GradStats& sum) const {
+      return GradStats{sum.sum_grad * grad_dequant_, sum.sum_hess * hess_dequant_};
+    }
 
     // if sum of statistics for non-missing values in the node
     // is equal to sum of statistics for all values:
@@ -255,10 +574,45 @@ class QuantileHistMaker: public TreeUpdater {
                               RegTree *p_tree,
                               const std::vector<GradientPair> &gpair_h);
 
-    void AddHistRows(int *starting_index, int *sync_count);
+    void AddHistRows(int *starting_index, int *sync_count, const RegTree& tree);
+    // release histograms of the parents of nodes, once histograms of the level are built
+    void FreeParentHistograms(const ExpandList& nodes, const RegTree& tree);
+    /*!
+     * \brief Whether a new node may still be split.  Others become leaves without a
+     *  histogram: they are at the depth limit, or their hessian is too small for two
+     *  children of min_child_weight.
+     */
+    bool CanSplit(int nid, const RegTree& tree) const;
+    // nodes which need a histogram, siblings of dropped nodes lose their sibling_nid
+    ExpandList NodesToSplit(const ExpandList& nodes,
+                                          const RegTree& tree) const;
+
+    // whether splits of small nodes may be found without histograms, see `small_node_ratio'
+    bool EnumerateSmallNodes() const {
+      return hist_maker_param_.small_node_ratio > 0.0f && !rabit::IsDistributed() &&
+             p_paged_fmat_ == nullptr && feature_types_.empty();
+    }
+    bool IsSmallNode(int nid) const {
+      return static_cast<double>(row_set_collection_[nid].Size()) <
+             static_cast<double>(hist_maker_param_.small_node_ratio) *
+             hist_builder_.GetNumBins();
+    }
+    /*!
+     * \brief Move the small nodes among `nodes', whose siblings are either small or not
+     *  split, to nodes_for_enumeration_ and return the others.  The previous nodes of
+     *  nodes_for_enumeration_ are dropped.
+     */
+    ExpandList SelectSmallNodes(const ExpandList& nodes);
+    // position of node nid in nodes_for_enumeration_, -1 if it has a histogram
+    int32_t EnumeratedPos(int nid) const {
+      return static_cast<size_t>(nid) < enumerated_pos_.size() ? enumerated_pos_[nid] : -1;
+    }
+    // gather and sort the bins of the rows of every node in nodes_for_enumeration_
+    void BuildNodeBins(const GHistIndexMatrix& gmat, const std::vector<GradientPair>& gpair);
 
+    // build histograms of the given nodes, and of their siblings by subtraction
     void BuildHistogramsLossGuide(
-                        ExpandEntry entry,
+                        const ExpandList& entries,
                         const GHistIndexMatrix &gmat,
                         const GHistIndexBlockMatrix &gmatb,
                         RegTree *p_tree,
@@ -267,27 +621,41 @@ class QuantileHistMaker: public TreeUpdater {
     // Split nodes to 2 sets depending on amount of rows in each node
     // Histograms for small nodes will be built explicitly
     // Histograms for big nodes will be built by 'Subtraction Trick'
-    void SplitSiblings(const std::vector<ExpandEntry>& nodes,
-                   std::vector<ExpandEntry>* small_siblings,
-                   std::vector<ExpandEntry>* big_siblings,
+    void SplitSiblings(const ExpandList& nodes,
+                   ExpandList* small_siblings,
+                   ExpandList* big_siblings,
                    RegTree *p_tree);
 
     void SyncHistograms(int starting_index,
                         int sync_count,
                         RegTree *p_tree);
+    // merge the per thread histograms of nodes_for_explicit_hist_build_
+    void MergeLocalHistograms(RegTree *p_tree);
+    // sum the histograms of the nodes over the workers
+    void AllreduceHistograms(const ExpandList& nodes);
+    /*!
+     * \brief Build and allreduce the histograms of nodes_for_explicit_hist_build_ chunk by
+     *  chunk, building the next chunk on a helper thread while the current one is on the
+     *  network, see `hist_allreduce_chunks'.  Collectives stay on the calling thread.
+     */
+    void BuildAndSyncHistogramsPipelined(const GHistIndexMatrix &gmat,
+                                         const GHistIndexBlockMatrix &gmatb,
+                                         RegTree *p_tree,
+                                         const std::vector<GradientPair> &gpair_h);
 
     void BuildNodeStats(const GHistIndexMatrix &gmat,
                         DMatrix *p_fmat,
                         RegTree *p_tree,
                         const std::vector<GradientPair> &gpair_h);
 
-    void EvaluateAndApplySplits(const GHistIndexMatrix &gmat,
+    void EvaluateAndApplySplits(const ExpandList& nodes_to_evaluate,
+                                const GHistIndexMatrix &gmat,
                                 const ColumnMatrix &column_matrix,
                                 RegTree *p_tree,
                                 int *num_leaves,
                                 int depth,
                                 unsigned *timestamp,
-                                std::vector<ExpandEntry> *temp_qexpand_depth);
+                                ExpandList *temp_qexpand_depth);
 
     void AddSplitsToTree(
               const GHistIndexMatrix &gmat,
@@ -295,8 +663,8 @@ class QuantileHistMaker: public TreeUpdater {
               int *num_leaves,
               int depth,
               unsigned *timestamp,
-              std::vector<ExpandEntry>* nodes_for_apply_split,
-              std::vector<ExpandEntry>* temp_qexpand_depth);
+              ExpandList* nodes_for_apply_split,
+              ExpandList* temp_qexpand_depth);
 
     void ExpandWithLossGuide(const GHistIndexMatrix& gmat,
                              const GHistIndexBlockMatrix& gmatb,
@@ -305,6 +673,49 @@ class QuantileHistMaker: public TreeUpdater {
                              RegTree* p_tree,
                              const std::vector<GradientPair>& gpair_h);
 
+    // whether each worker evaluates its own features, see `distributed_split_evaluation'
+    bool DistributedSplitEvaluation() const {
+      return hist_maker_param_.distributed_split_evaluation && rabit::IsDistributed();
+    }
+    // whether each worker has all rows of a share of the features, see `dsplit'
+    bool ColumnSplit() const {
+      return hist_maker_param_.dsplit == CPUHistMakerTrainParam::kColSplit &&
+             rabit::IsDistributed();
+    }
+    // whether each worker has a share of the rows, so histograms are summed over workers
+    bool RowSplit() const {
+      return rabit::IsDistributed() && !this->ColumnSplit();
+    }
+    // whether a depthwise level is built in chunks, see `hist_allreduce_chunks'
+    bool PipelinedHistAllreduce() const {
+      return hist_maker_param_.hist_allreduce_chunks > 1 && this->RowSplit();
+    }
+    // whether gradients are kept in the order of rows, see PackGradients()
+    bool UsePackedGradients() const {
+      return hist_maker_param_.packed_gradients && param_.enable_feature_grouping == 0 &&
+             p_paged_fmat_ == nullptr;
+    }
+    // copy gradients into the order of rows of the root
+    void PackGradients(const std::vector<GradientPair>& gpair);
+    // keep the gradients in gpair_soa_ when their hessians are constant, see SplitGradients()
+    void SplitGradients(const std::vector<GradientPair>& gpair);
+    // gradients of the rows of node nid in their order, or of its children after a split
+    GradientPair* PackedGradients(int nid, bool children = false) {
+      auto pos = row_set_collection_.GetBufferPosition(nid);
+      const bool second = (pos.second == 1) != children;
+      return (second ? packed_gpair_buffer_ : packed_gpair_).data() + pos.first;
+    }
+    // matrix histograms are built from
+    const GHistIndexMatrix& HistIndex(const GHistIndexMatrix& gmat) const {
+      return p_bundled_gmat_ == nullptr ? gmat : *p_bundled_gmat_;
+    }
+    // distance from the global bins of feature fid to its bins in the histograms
+    int32_t HistShift(const GHistIndexMatrix& gmat, bst_uint fid) const {
+      return p_feature_offset_ == nullptr ? 0 :
+          static_cast<int32_t>((*p_feature_offset_)[fid]) -
+          static_cast<int32_t>(gmat.cut.Ptrs()[fid]);
+    }
+
     inline static bool LossGuide(ExpandEntry lhs, ExpandEntry rhs) {
       if (lhs.loss_chg == rhs.loss_chg) {
         return lhs.timestamp > rhs.timestamp;  // favor small timestamp
@@ -315,6 +726,7 @@ class QuantileHistMaker: public TreeUpdater {
 
     //  --data fields--
     const TrainParam& param_;
+    const CPUHistMakerTrainParam& hist_maker_param_;
     // number of omp thread used during training
     int nthread_;
     common::ColumnSampler column_sampler_;
@@ -323,50 +735,173 @@ class QuantileHistMaker: public TreeUpdater {
     // the temp space for split
     std::vector<RowSetCollection::Split> row_split_tloc_;
     std::vector<SplitEntry> best_split_tloc_;
+    // candidate features of each node in the set being evaluated, reused across levels
+    std::vector<std::vector<bst_feature_t>> node_features_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode_;
+    /*! \brief types of the features, empty when all of them are numerical */
+    std::vector<FeatureType> feature_types_;
+    /*! \brief categories going left in the best split of each node, if categorical */
+    std::vector<std::vector<uint64_t>> split_cats_;
     /*! \brief culmulative histogram of gradients. */
-    HistCollection hist_;
+    HistCollection<GradientSumT> hist_;
     /*! \brief feature with least # of bins. to be used for dense specialization
                of InitNewNode() */
     uint32_t fid_least_bins_;
     /*! \brief local prediction cache; maps node id to leaf value */
     std::vector<float> leaf_value_cache_;
-
-    GHistBuilder hist_builder_;
-    std::unique_ptr<TreeUpdater> pruner_;
+    /*! \brief gradients rounded to integers, used to build integer histograms */
+    std::vector<GradientPair> gpair_quantized_;
+    /*! \brief multipliers from histogram units back to gradient and hessian */
+    double grad_dequant_ {1.0};
+    double hess_dequant_ {1.0};
+
+    GHistBuilder<GradientSumT> hist_builder_;
+    // splits below `min_split_loss' are never grown, trees only need to be synchronized
+    std::unique_ptr<TreeUpdater> syncher_;
     std::unique_ptr<SplitEvaluator> spliteval_;
     FeatureInteractionConstraintHost interaction_constraints_;
 
     static constexpr size_t kPartitionBlockSize = 2048;
     common::PartitionBuilder<kPartitionBlockSize> partition_builder_;
+    // rows sampled with one random engine
+    static constexpr size_t kSampleBlockSize = 16384;
+    // rows of a fused gradient computed at once, see SetGradient()
+    static constexpr size_t kGradientBlockSize = 2048;
+    std::vector<size_t> sampled_rows_buffer_;
+    // sorted rows that are not in the sample of the last tree
+    std::vector<size_t> unsampled_rows_;
+    // gradients reweighted by gradient based sampling, empty for other sampling methods
+    std::vector<GradientPair> gpair_sampled_;
+    // whether a feature has more than one distinct value (missing included) in the data
+    std::vector<uint8_t> feature_splittable_;
+    // whether a feature can be missing, only features without need the backward enumeration
+    std::vector<uint8_t> feature_missing_;
+    // gradients in the order of row_set_collection_ rows, double buffered the same way
+    std::vector<GradientPair> packed_gpair_;
+    std::vector<GradientPair> packed_gpair_buffer_;
+    // gradients with a constant hessian histograms are built from, empty otherwise
+    common::GradientSoA gpair_soa_;
+    // group of each thread for reducing histograms, see SetThreadGroups()
+    std::vector<size_t> thread_group_;
+    // seed of the next row sample, see SetSampleSeed()
+    uint32_t sample_seed_ {0};
+    bool has_sample_seed_ {false};
+    // gradient of the next tree and where it's written, see SetGradient()
+    ElementWiseGradient* p_gradient_ {nullptr};
+    GradientPair* p_fused_gpair_ {nullptr};
+    // exclusive feature bundles histograms are built from, see SetFeatureBundles()
+    const GHistIndexMatrix* p_bundled_gmat_ {nullptr};
+    const std::vector<uint32_t>* p_feature_offset_ {nullptr};
+
+    // temporaries of the tree being grown, reset once the tree is done
+    mutable common::Arena arena_;
 
     // back pointers to tree and data matrix
     const RegTree* p_last_tree_;
     DMatrix const* const p_last_fmat_;
+    const GHistIndexMatrix* p_last_gmat_ {nullptr};
+    // external memory matrix whose histogram index pages are streamed,
+    // nullptr when the whole histogram index is in memory
+    DMatrix* p_paged_fmat_ {nullptr};
+    BatchParam PageParam() const {
+      return BatchParam{GenericParameter::kCpuId, param_.max_bin, 0};
+    }
 
     using ExpandQueue =
-       std::priority_queue<ExpandEntry, std::vector<ExpandEntry>,
+       std::priority_queue<ExpandEntry, ExpandList,
                            std::function<bool(ExpandEntry, ExpandEntry)>>;
 
     std::unique_ptr<ExpandQueue> qexpand_loss_guided_;
-    std::vector<ExpandEntry> qexpand_depth_wise_;
+    ExpandList qexpand_depth_wise_;
     // key is the node id which should be calculated by Subtraction Trick, value is the node which
     // provides the evidence for substracts
-    std::vector<ExpandEntry> nodes_for_subtraction_trick_;
+    ExpandList nodes_for_subtraction_trick_;
     // list of nodes whose histograms would be built explicitly.
-    std::vector<ExpandEntry> nodes_for_explicit_hist_build_;
+    ExpandList nodes_for_explicit_hist_build_;
+    // nodes whose splits are found from the bins of their rows, without histograms
+    ExpandList nodes_for_enumeration_;
+    // position of each node in nodes_for_enumeration_, -1 for others
+    std::vector<int32_t> enumerated_pos_;
+    // Bins of the rows of nodes_for_enumeration_ with their gradients, node i has the
+    // slice [node_bins_ptr_[i], node_bins_ptr_[i + 1]).  The first node_bins_size_[i]
+    // entries of the slice in node_bins_ and node_bin_sums_ are its non-empty bins in
+    // order and their sums.
+    std::vector<size_t> node_bins_ptr_;
+    std::vector<size_t> node_bins_size_;
+    std::vector<std::pair<uint32_t, GradientPair>> node_entries_;
+    std::vector<uint32_t> node_bins_;
+    std::vector<GradStatsT<GradientSumT>> node_bin_sums_;
 
     enum DataLayout { kDenseDataZeroBased, kDenseDataOneBased, kSparseData };
     DataLayout data_layout_;
 
     common::Monitor builder_monitor_;
-    common::ParallelGHistBuilder hist_buffer_;
-    rabit::Reducer<GradStats, GradStats::Reduce> histred_;
+    common::ParallelGHistBuilder<GradientSumT> hist_buffer_;
+    rabit::Reducer<GradStatsT<GradientSumT>, GradStatsT<GradientSumT>::Reduce> histred_;
+    // node statistics are always reduced in double precision
+    rabit::Reducer<GradStats, GradStats::Reduce> statsred_;
+    // histograms sent in single precision, see `hist_allreduce_precision'
+    rabit::Reducer<GradStatsT<float>, GradStatsT<float>::Reduce> float_histred_;
+    // bins of each feature in the histograms, for `hist_allreduce_skip_empty'
+    std::vector<uint32_t> hist_feature_ptrs_;
+    // features of each node with a non-zero bin on any worker, one bit for each
+    std::vector<uint32_t> hist_allreduce_mask_;
+    // position in the allreduce buffer of every 32 features of each node
+    std::vector<size_t> hist_allreduce_offsets_;
+    std::vector<GradStatsT<GradientSumT>> hist_allreduce_buffer_;
+    std::vector<GradStatsT<float>> hist_allreduce_float_buffer_;
+    // best splits of the nodes evaluated by each worker on its share of features
+    rabit::Reducer<SplitEntry, SplitEntry::Reduce> splitred_;
+    std::vector<SplitEntry> best_splits_;
+    // worker whose feature splits each node when features are split over the workers
+    std::vector<int32_t> split_owner_;
+    // row decisions of the splits of one worker, one bit for each row
+    std::vector<uint32_t> partition_bits_;
   };
 
-  std::unique_ptr<Builder> builder_;
-  std::unique_ptr<TreeUpdater> pruner_;
+  // builders of the trees grown next to the first one, see `concurrent_trees'
+  template<typename GradientSumT>
+  using ForestBuilders = std::vector<std::unique_ptr<Builder<GradientSumT>>>;
+
+  /*! \brief Quantization of the builders, integer sums don't depend on the order of
+   *   additions so deterministic training uses them. */
+  int GradientQuantization() const;
+
+  template<typename GradientSumT>
+  void SetBuilder(std::unique_ptr<Builder<GradientSumT>>*, DMatrix *dmat);
+
+  /*! \brief Update, with the gradient computed from `grad' by the builder when not null. */
+  void UpdateTrees(HostDeviceVector<GradientPair>* gpair, ElementWiseGradient* grad,
+                   DMatrix* dmat, const std::vector<RegTree*>& trees);
+
+  template<typename GradientSumT>
+  void CallBuilderUpdate(const std::unique_ptr<Builder<GradientSumT>>& builder,
+                         ForestBuilders<GradientSumT>* forest,
+                         HostDeviceVector<GradientPair> *gpair,
+                         ElementWiseGradient* grad,
+                         DMatrix *dmat,
+                         const std::vector<RegTree *> &trees);
+
+  /*! \brief Grow `trees' concurrently, the first builder and those of `forest' each
+   *   take every n-th tree with a group of the threads. */
+  template<typename GradientSumT>
+  void ForestUpdate(const std::unique_ptr<Builder<GradientSumT>>& builder,
+                    ForestBuilders<GradientSumT>* forest, size_t n_groups,
+                    HostDeviceVector<GradientPair> *gpair,
+                    DMatrix *dmat,
+                    const std::vector<RegTree *> &trees);
+
+  std::unique_ptr<Builder<float>> float_builder_;
+  std::unique_ptr<Builder<double>> double_builder_;
+  // builders over quantized gradients
+  std::unique_ptr<Builder<int32_t>> int32_builder_;
+  std::unique_ptr<Builder<int64_t>> int64_builder_;
+  ForestBuilders<float> float_forest_;
+  ForestBuilders<double> double_forest_;
+  ForestBuilders<int32_t> int32_forest_;
+  ForestBuilders<int64_t> int64_forest_;
+  std::unique_ptr<TreeUpdater> syncher_;
   std::unique_ptr<SplitEvaluator> spliteval_;
   FeatureInteractionConstraintHost int_constraint_;
 };
@@ -7,12 +7,14 @@
 #include <rabit/rabit.h>
 #include <xgboost/tree_updater.h>
 
+#include <algorithm>
 #include <vector>
 #include <limits>
 
 #include "xgboost/json.h"
 #include "./param.h"
 #include "../common/io.h"
+#include "../common/hist_util.h"
 
 namespace xgboost {
 namespace tree {
@@ -60,28 +62,38 @@ class TreeRefresher: public TreeUpdater {
       std::fill(stemp[tid].begin(), stemp[tid].end(), GradStats());
       fvec_temp[tid].Init(trees[0]->param.num_feature);
     }
+    // Use the quantized matrix when the data already has one and every split condition
+    // is a cut value, then the traversal compares bins instead of feature values.
+    int32_t max_bin {0};
+    auto const* cuts = p_fmat->GHistIndexCuts(&max_bin);
+    std::vector<uint32_t> split_bins;
+    const bool use_bins = cuts != nullptr && FindSplitBins(trees, *cuts, &split_bins);
     // if it is C++11, use lazy evaluation for Allreduce,
     // to gain speedup in recovery
     auto lazy_get_stats = [&]() {
       const MetaInfo &info = p_fmat->Info();
       // start accumulating statistics
-      for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
-        CHECK_LT(batch.Size(), std::numeric_limits<unsigned>::max());
-        const auto nbatch = static_cast<bst_omp_uint>(batch.Size());
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nbatch; ++i) {
-          SparsePage::Inst inst = batch[i];
-          const int tid = omp_get_thread_num();
-          const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
-          RegTree::FVec &feats = fvec_temp[tid];
-          feats.Fill(inst);
-          int offset = 0;
-          for (auto tree : trees) {
-            AddStats(*tree, feats, gpair_h, info, ridx,
-                     dmlc::BeginPtr(stemp[tid]) + offset);
-            offset += tree->param.num_nodes;
+      if (use_bins) {
+        this->AccumulateQuantized(p_fmat, max_bin, trees, split_bins, gpair_h, &stemp);
+      } else {
+        for (const auto &batch : p_fmat->GetBatches<SparsePage>()) {
+          CHECK_LT(batch.Size(), std::numeric_limits<unsigned>::max());
+          const auto nbatch = static_cast<bst_omp_uint>(batch.Size());
+          #pragma omp parallel for schedule(static)
+          for (bst_omp_uint i = 0; i < nbatch; ++i) {
+            SparsePage::Inst inst = batch[i];
+            const int tid = omp_get_thread_num();
+            const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
+            RegTree::FVec &feats = fvec_temp[tid];
+            feats.Fill(inst);
+            int offset = 0;
+            for (auto tree : trees) {
+              AddStats(*tree, feats, gpair_h, info, ridx,
+                       dmlc::BeginPtr(stemp[tid]) + offset);
+              offset += tree->param.num_nodes;
+            }
+            feats.Drop(inst);
           }
-          feats.Drop(inst);
         }
       }
       // aggregate the statistics
@@ -107,6 +119,105 @@ class TreeRefresher: public TreeUpdater {
   }
 
  private:
+  /*!
+   * \brief Find the global bin of each split condition in the cuts.  Row goes left at
+   *  node `nid' when its bin is not greater than the split bin.
+   * \return false when a split condition is not a cut value, or is the last cut of its
+   *  feature which also holds the values beyond it, or the split is categorical.
+   */
+  static bool FindSplitBins(const std::vector<RegTree*> &trees,
+                            common::HistogramCuts const& cuts,
+                            std::vector<uint32_t>* p_split_bins) {
+    auto const& ptrs = cuts.Ptrs();
+    auto const& values = cuts.Values();
+    auto& split_bins = *p_split_bins;
+    split_bins.clear();
+    for (auto tree : trees) {
+      for (int nid = 0; nid < tree->param.num_nodes; ++nid) {
+        auto const& node = (*tree)[nid];
+        if (node.IsLeaf() || node.IsDeleted()) {
+          split_bins.push_back(0);
+          continue;
+        }
+        auto fid = node.SplitIndex();
+        if (tree->NodeSplitType(nid) == FeatureType::kCategorical || fid + 1 >= ptrs.size()) {
+          return false;
+        }
+        auto beg = values.cbegin() + ptrs[fid];
+        auto end = values.cbegin() + ptrs[fid + 1];
+        auto it = std::lower_bound(beg, end, node.SplitCond());
+        if (end - beg < 2 || it >= end - 1 || *it != node.SplitCond()) {
+          return false;
+        }
+        split_bins.push_back(static_cast<uint32_t>(it - values.cbegin()));
+      }
+    }
+    return true;
+  }
+
+  void AccumulateQuantized(DMatrix *p_fmat, int32_t max_bin,
+                           const std::vector<RegTree*> &trees,
+                           std::vector<uint32_t> const& split_bins,
+                           const std::vector<GradientPair> &gpair,
+                           std::vector<std::vector<GradStats>>* p_stemp) {
+    auto& stemp = *p_stemp;
+    const auto n_features = static_cast<size_t>(trees[0]->param.num_feature);
+    for (auto const& page : p_fmat->GetBatches<common::GHistIndexMatrix>(
+             BatchParam{GenericParameter::kCpuId, max_bin, 0})) {
+      // feature of each global bin
+      auto const& ptrs = page.cut.Ptrs();
+      std::vector<bst_feature_t> bin_feature(page.cut.TotalBins());
+      for (size_t fid = 0; fid + 1 < ptrs.size(); ++fid) {
+        std::fill(bin_feature.begin() + ptrs[fid], bin_feature.begin() + ptrs[fid + 1],
+                  static_cast<bst_feature_t>(fid));
+      }
+      const auto nrows = static_cast<omp_ulong>(page.row_ptr.size() - 1);
+      #pragma omp parallel
+      {
+        // bin of each feature in the current row, kMissing if it's absent
+        std::vector<uint32_t> row_bins(std::max(n_features, ptrs.size() - 1), kMissing);
+        GradStats* stats = dmlc::BeginPtr(stemp[omp_get_thread_num()]);
+        #pragma omp for schedule(static)
+        for (omp_ulong i = 0; i < nrows; ++i) {
+          const size_t ibegin = page.row_ptr[i];
+          const size_t iend = page.row_ptr[i + 1];
+          for (size_t j = ibegin; j < iend; ++j) {
+            const uint32_t bin = page.index[j];
+            row_bins[bin_feature[bin]] = bin;
+          }
+          auto const& g = gpair[page.base_rowid + i];
+          size_t offset = 0;
+          for (auto tree : trees) {
+            AddQuantizedStats(*tree, row_bins, split_bins.data() + offset, g,
+                              stats + offset);
+            offset += tree->param.num_nodes;
+          }
+          for (size_t j = ibegin; j < iend; ++j) {
+            row_bins[bin_feature[page.index[j]]] = kMissing;
+          }
+        }
+      }
+    }
+  }
+
+  static void AddQuantizedStats(const RegTree &tree,
+                                std::vector<uint32_t> const& row_bins,
+                                uint32_t const* split_bins,
+                                GradientPair const& g,
+                                GradStats *gstats) {
+    auto pid = 0;
+    gstats[pid].Add(g);
+    while (!tree[pid].IsLeaf()) {
+      const uint32_t bin = row_bins[tree[pid].SplitIndex()];
+      if (bin == kMissing) {
+        pid = tree[pid].DefaultChild();
+      } else {
+        pid = bin <= split_bins[pid] ? tree[pid].LeftChild() : tree[pid].RightChild();
+      }
+      gstats[pid].Add(g);
+    }
+  }
+
   inline static void AddStats(const RegTree &tree,
                               const RegTree::FVec &feat,
                               const std::vector<GradientPair> &gpair,
@@ -142,12 +253,15 @@ class TreeRefresher: public TreeUpdater {
       this->Refresh(gstats, tree[nid].RightChild(), p_tree);
     }
   }
+  static constexpr uint32_t kMissing = std::numeric_limits<uint32_t>::max();
   // training parameter
   TrainParam param_;
   // reducer
   rabit::Reducer<GradStats, GradStats::Reduce> reducer_;
 };
 
+constexpr uint32_t TreeRefresher::kMissing;
+
 XGBOOST_REGISTER_TREE_UPDATER(TreeRefresher, "refresh")
 .describe("Refresher that refreshes the weight and statistics according to data.")
 .set_body([]() {
@@ -158,7 +158,8 @@ class SketchMaker: public BaseMaker {
       summary_array_[i].SetPrune(out, max_size);
     }
     size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_size);
-    sketch_reducer_.Allreduce(dmlc::BeginPtr(summary_array_), nbytes, summary_array_.size());
+    common::AllreduceSummaries(&sketch_reducer_, dmlc::BeginPtr(summary_array_), nbytes,
+                               summary_array_.size());
   }
   // update sketch information in column fid
   inline void UpdateSketchCol(const std::vector<GradientPair> &gpair,
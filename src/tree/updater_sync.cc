@@ -1,31 +1,106 @@
 /*!
- * Copyright 2014-2019 by Contributors
+ * Copyright 2014-2020 by Contributors
  * \file updater_sync.cc
  * \brief synchronize the tree in all distributed nodes
  */
+#include <rabit/rabit.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <limits>
 
 #include "xgboost/json.h"
+#include "xgboost/parameter.h"
 #include "../common/io.h"
+#include "updater_sync.h"
 
 namespace xgboost {
 namespace tree {
 
 DMLC_REGISTRY_FILE_TAG(updater_sync);
 
+namespace {
+// FNV-1a
+uint64_t HashBytes(void const* ptr, size_t n_bytes, uint64_t hash) {
+  constexpr uint64_t kPrime = 1099511628211ULL;
+  auto const* bytes = static_cast<uint8_t const*>(ptr);
+  for (size_t i = 0; i < n_bytes; ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash;
+}
+}  // anonymous namespace
+
+uint64_t TreeHash(RegTree const& tree) {
+  uint64_t hash = 14695981039346656037ULL;
+  hash = HashBytes(&tree.param, sizeof(tree.param), hash);
+  auto const& nodes = tree.GetNodes();
+  hash = HashBytes(nodes.data(), nodes.size() * sizeof(RegTree::Node), hash);
+  for (bst_node_t nid = 0; nid < tree.param.num_nodes; ++nid) {
+    hash = HashBytes(&tree.Stat(nid), sizeof(RTreeNodeStat), hash);
+    if (tree.IsMultiOutput() && tree[nid].IsLeaf() && !tree[nid].IsDeleted()) {
+      hash = HashBytes(tree.LeafVector(nid), tree.param.size_leaf_vector * sizeof(bst_float),
+                       hash);
+    }
+  }
+  if (tree.HasCategoricalSplit()) {
+    auto const& types = tree.GetSplitTypes();
+    auto const& categories = tree.GetSplitCategories();
+    hash = HashBytes(types.data(), types.size() * sizeof(FeatureType), hash);
+    hash = HashBytes(categories.data(), categories.size() * sizeof(uint64_t), hash);
+  }
+  return hash;
+}
+
+bool TreesSynchronized(std::vector<RegTree*> const& trees) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto tree : trees) {
+    uint64_t const tree_hash = TreeHash(*tree);
+    hash = HashBytes(&tree_hash, sizeof(tree_hash), hash);
+  }
+  // the maximum and the minimum are the same only when every worker has the same hash
+  uint64_t extremes[2] = {hash, ~hash};
+  rabit::Allreduce<rabit::op::Max>(extremes, 2);
+  return extremes[0] == ~extremes[1];
+}
+
+/*! \brief How trees are synchronized over the workers. */
+struct TreeSyncParam : public XGBoostParameter<TreeSyncParam> {
+  enum Mode { kHash = 0, kFull = 1 };
+  int tree_sync;
+  DMLC_DECLARE_PARAMETER(TreeSyncParam) {
+    DMLC_DECLARE_FIELD(tree_sync)
+        .set_default(kHash)
+        .add_enum("hash", kHash)
+        .add_enum("full", kFull)
+        .describe("'hash' only compares a hash of the trees over the workers, and sends "
+                  "the trees of worker 0 when they differ.  'full' always sends them.");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(TreeSyncParam);
+
 /*!
  * \brief syncher that synchronize the tree in all distributed nodes
  * can implement various strategies, so far it is always set to node 0's tree
  */
 class TreeSyncher: public TreeUpdater {
  public:
-  void Configure(const Args& args) override {}
+  void Configure(const Args& args) override {
+    param_.UpdateAllowUnknown(args);
+  }
 
-  void LoadConfig(Json const& in) override {}
-  void SaveConfig(Json* p_out) const override {}
+  void LoadConfig(Json const& in) override {
+    auto const& config = get<Object const>(in);
+    if (config.find("sync_param") != config.cend()) {
+      fromJson(config.at("sync_param"), &this->param_);
+    }
+  }
+  void SaveConfig(Json* p_out) const override {
+    auto& out = *p_out;
+    out["sync_param"] = toJson(param_);
+  }
 
   char const* Name() const override {
     return "prune";
@@ -35,9 +110,24 @@ class TreeSyncher: public TreeUpdater {
               DMatrix* dmat,
               const std::vector<RegTree*> &trees) override {
     if (rabit::GetWorldSize() == 1) return;
+    // Workers grow the same trees from the same statistics, checking is enough.
+    if (param_.tree_sync == TreeSyncParam::kHash && TreesSynchronized(trees)) {
+      return;
+    }
+    int rank = rabit::GetRank();
+    // Categorical splits are only kept by the JSON format.
+    int32_t use_json = 0;
+    if (rank == 0) {
+      use_json = std::any_of(trees.cbegin(), trees.cend(),
+                             [](RegTree const* tree) { return tree->HasCategoricalSplit(); });
+    }
+    rabit::Broadcast(&use_json, sizeof(use_json), 0);
+    if (use_json) {
+      this->BroadcastJson(trees);
+      return;
+    }
     std::string s_model;
     common::MemoryBufferStream fs(&s_model);
-    int rank = rabit::GetRank();
     if (rank == 0) {
       for (auto tree : trees) {
         tree->Save(&fs);
@@ -49,6 +139,29 @@ class TreeSyncher: public TreeUpdater {
       tree->Load(&fs);
     }
   }
+
+ private:
+  void BroadcastJson(const std::vector<RegTree*> &trees) const {
+    std::string s_model;
+    if (rabit::GetRank() == 0) {
+      Json j_trees{Array{}};
+      for (auto tree : trees) {
+        Json j_tree{Object{}};
+        tree->SaveModel(&j_tree);
+        get<Array>(j_trees).emplace_back(j_tree);
+      }
+      Json::Dump(j_trees, &s_model);
+    }
+    rabit::Broadcast(&s_model, 0);
+    auto j_trees = Json::Load(StringView{s_model.c_str(), s_model.size()});
+    auto const& arr = get<Array const>(j_trees);
+    CHECK_EQ(arr.size(), trees.size());
+    for (size_t i = 0; i < trees.size(); ++i) {
+      trees[i]->LoadModel(arr[i]);
+    }
+  }
+
+  TreeSyncParam param_;
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(TreeSyncher, "sync")
@@ -0,0 +1,25 @@
+/*!
+ * Copyright 2020 by Contributors
+ * \file updater_sync.h
+ * \brief Checking that the trees grown by distributed workers are the same.
+ */
+#ifndef XGBOOST_TREE_UPDATER_SYNC_H_
+#define XGBOOST_TREE_UPDATER_SYNC_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "xgboost/tree_model.h"
+
+namespace xgboost {
+namespace tree {
+/*! \brief Hash of the structure, statistics and leaves of a tree, equal for equal trees. */
+uint64_t TreeHash(RegTree const& tree);
+/*!
+ * \brief Whether every worker has the same trees, with a single allreduce of their hash.
+ *  A collective, so all workers must call it.
+ */
+bool TreesSynchronized(std::vector<RegTree*> const& trees);
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_UPDATER_SYNC_H_
@@ -0,0 +1,229 @@
+"""Train and predict on a catalog of synthetic datasets and write the results as JSON.
+
+Each case runs in its own process so the peak resident memory belongs to that case
+alone.  Timings of the internal phases come from the profile of XGBoost's monitors,
+device memory from the peak recorded by `gpu_hist`.
+
+Example:
+
+    python benchmark_suite.py --tree_method hist,gpu_hist --dataset higgs,criteo \
+        --output results.json
+"""
+
+import argparse
+import ctypes
+import json
+import multiprocessing
+import os
+import platform
+from queue import Empty
+import resource
+import shutil
+import tempfile
+import time
+
+import numpy as np
+from scipy import sparse
+from sklearn.datasets import dump_svmlight_file
+import xgboost as xgb
+from xgboost.core import _LIB, _check_call
+
+TREE_METHODS = ['exact', 'approx', 'hist', 'gpu_hist', 'external']
+
+
+def higgs_like(rows, rng):
+    """Dense binary classification, 28 features of which 7 are derived."""
+    X = rng.randn(rows, 28).astype(np.float32)
+    X[:, 21:] = X[:, :7] * X[:, 7:14] + X[:, 14:21]
+    y = (X[:, :7].sum(axis=1) + 0.5 * rng.randn(rows) > 0).astype(np.float32)
+    return X, y, None, {'objective': 'binary:logistic', 'eval_metric': 'auc'}
+
+
+def criteo_like(rows, rng):
+    """Sparse binary classification, 13 counts and 26 hashed categories per row."""
+    n_numeric, n_categories, n_buckets = 13, 26, 4096
+    numeric = np.log1p(rng.poisson(3.0, (rows, n_numeric))).astype(np.float32)
+    numeric[rng.rand(rows, n_numeric) < 0.3] = 0
+    buckets = rng.zipf(1.5, (rows, n_categories)) % n_buckets
+    cols = n_numeric + np.arange(n_categories) * n_buckets + buckets
+    onehot = sparse.csr_matrix(
+        (np.ones(rows * n_categories, dtype=np.float32), cols.ravel(),
+         np.arange(0, rows * n_categories + 1, n_categories)),
+        shape=(rows, n_numeric + n_categories * n_buckets))
+    X = sparse.hstack([sparse.csr_matrix(numeric), onehot[:, n_numeric:]]).tocsr()
+    logits = numeric[:, 0] - numeric[:, 1] + (buckets[:, 0] % 7 == 0)
+    y = (logits + rng.randn(rows) > 1.0).astype(np.float32)
+    return X, y, None, {'objective': 'binary:logistic', 'eval_metric': 'auc'}
+
+
+def ranking_like(rows, rng):
+    """Dense learning to rank with 136 features, relevance 0-4 and 100 rows per query."""
+    X = rng.rand(rows, 136).astype(np.float32)
+    score = X[:, :10].sum(axis=1) + 0.5 * rng.randn(rows)
+    y = np.clip(np.floor(score - 3), 0, 4).astype(np.float32)
+    return X, y, 100, {'objective': 'rank:pairwise', 'eval_metric': 'ndcg@10'}
+
+
+def multiclass_like(rows, rng):
+    """Dense classification with 100 classes and 50 features."""
+    n_classes = 100
+    X = rng.randn(rows, 50).astype(np.float32)
+    y = (np.abs(X[:, :3].sum(axis=1)) * 20 + rng.randint(0, 5, rows)) % n_classes
+    return X, y.astype(np.float32), None, {'objective': 'multi:softprob',
+                                           'num_class': n_classes,
+                                           'eval_metric': 'mlogloss'}
+
+
+DATASETS = {'higgs': higgs_like, 'criteo': criteo_like,
+            'ranking': ranking_like, 'multiclass': multiclass_like}
+
+
+def get_profile():
+    """Timings and counters of XGBoost's monitors, see `XGBGetProfile`."""
+    out = ctypes.c_char_p()
+    _check_call(_LIB.XGBGetProfile(ctypes.c_int(0), ctypes.byref(out)))
+    return json.loads(out.value.decode('utf-8'))[0]
+
+
+def peak_rss_bytes():
+    """Peak resident memory of this process."""
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    return rss if platform.system() == 'Darwin' else rss * 1024
+
+
+def query_groups(rows, group_size):
+    """Sizes of consecutive queries with `group_size` rows, the last one may be smaller."""
+    if group_size is None:
+        return None
+    groups = [group_size] * (rows // group_size)
+    if rows % group_size:
+        groups.append(rows % group_size)
+    return groups
+
+
+def make_dmatrix(X, y, groups, tree_method, tmpdir, name):
+    """DMatrix in memory, or loaded from LibSVM with a cache for external memory."""
+    if tree_method != 'external':
+        dmat = xgb.DMatrix(X, y, nthread=-1)
+    else:
+        path = os.path.join(tmpdir, name + '.libsvm')
+        dump_svmlight_file(X, y, path)
+        dmat = xgb.DMatrix(path + '#' + os.path.join(tmpdir, name + '.cache'))
+    if groups is not None:
+        dmat.set_group(groups)
+    return dmat
+
+
+def run_case(args, dataset, tree_method):
+    """Returns the record of one dataset and tree method."""
+    rng = np.random.RandomState(args.seed)
+    rows = args.rows + args.test_rows
+    X, y, group_size, params = DATASETS[dataset](rows, rng)
+    train_groups = query_groups(args.rows, group_size)
+    test_groups = query_groups(args.test_rows, group_size)
+    params.update(json.loads(args.params))
+    params['tree_method'] = 'hist' if tree_method == 'external' else tree_method
+    params['nthread'] = args.nthread
+
+    record = {'dataset': dataset, 'tree_method': tree_method, 'rows': args.rows,
+              'test_rows': args.test_rows, 'columns': X.shape[1],
+              'rounds': args.rounds, 'params': params}
+    _check_call(_LIB.XGBSetProfiling(ctypes.c_int(1)))
+    tmpdir = tempfile.mkdtemp()
+    try:
+        start = time.time()
+        dtrain = make_dmatrix(X[:args.rows], y[:args.rows], train_groups, tree_method,
+                              tmpdir, 'train')
+        dtest = make_dmatrix(X[args.rows:], y[args.rows:], test_groups, tree_method,
+                             tmpdir, 'test')
+        dmatrix_time = time.time() - start
+        del X, y
+
+        start = time.time()
+        evals_result = {}
+        booster = xgb.train(params, dtrain, args.rounds, evals=[(dtest, 'test')],
+                            evals_result=evals_result, verbose_eval=False)
+        train_time = time.time() - start
+
+        start = time.time()
+        booster.predict(dtest)
+        predict_time = time.time() - start
+
+        profile = get_profile()
+        gpu_counters = profile.get('updater_gpu_hist', {}).get('counters', {})
+        metric = list(evals_result['test'].items())[0]
+        record.update({
+            'time': {'dmatrix': dmatrix_time, 'train': train_time,
+                     'predict': predict_time},
+            'throughput': {'train_rows_per_second': args.rows * args.rounds / train_time,
+                           'predict_rows_per_second': args.test_rows / predict_time},
+            'metric': {metric[0]: metric[1][-1]},
+            'peak_rss_bytes': peak_rss_bytes(),
+            'peak_device_bytes': gpu_counters.get('Peak device bytes'),
+            'profile': profile})
+    except xgb.core.XGBoostError as e:
+        record['error'] = str(e)
+    finally:
+        shutil.rmtree(tmpdir)
+    return record
+
+
+def _run_case_in_child(queue, args, dataset, tree_method):
+    queue.put(run_case(args, dataset, tree_method))
+
+
+def main():
+    """The main function.
+
+    Defines and parses command line arguments and runs the benchmarks.
+    """
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--dataset', default=','.join(DATASETS),
+                        help='Comma separated datasets from ' + ', '.join(DATASETS))
+    parser.add_argument('--tree_method', default='exact,approx,hist,external',
+                        help='Comma separated tree methods from ' + ', '.join(TREE_METHODS))
+    parser.add_argument('--rows', type=int, default=200000)
+    parser.add_argument('--test_rows', type=int, default=50000)
+    parser.add_argument('--rounds', type=int, default=100)
+    parser.add_argument('--nthread', type=int, default=0)
+    parser.add_argument('--seed', type=int, default=1994)
+    parser.add_argument('--params', default='{}',
+                        help='Additional parameters as a JSON object, e.g. '
+                             '\'{"max_depth": 8}\'')
+    parser.add_argument('--output', default='benchmark_results.json')
+    args = parser.parse_args()
+
+    records = []
+    ctx = multiprocessing.get_context('spawn')
+    for dataset in args.dataset.split(','):
+        for tree_method in args.tree_method.split(','):
+            if dataset not in DATASETS or tree_method not in TREE_METHODS:
+                raise ValueError('Unknown case: {} {}'.format(dataset, tree_method))
+            print('Running {} with {}'.format(dataset, tree_method))
+            queue = ctx.Queue()
+            process = ctx.Process(target=_run_case_in_child,
+                                  args=(queue, args, dataset, tree_method))
+            process.start()
+            record = None
+            while record is None and (process.is_alive() or not queue.empty()):
+                try:
+                    record = queue.get(timeout=1)
+                except Empty:
+                    pass
+            process.join()
+            if record is None:
+                record = {'dataset': dataset, 'tree_method': tree_method,
+                          'error': 'exit code {}'.format(process.exitcode)}
+            print('  ' + json.dumps(record.get('time', record.get('error'))))
+            records.append(record)
+
+    results = {'xgboost': xgb.__version__, 'machine': platform.machine(),
+               'cpus': multiprocessing.cpu_count(), 'results': records}
+    with open(args.output, 'w') as fd:
+        json.dump(results, fd, indent=2)
+    print('Results written to {}'.format(args.output))
+
+
+if __name__ == '__main__':
+    main()
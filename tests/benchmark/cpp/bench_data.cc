@@ -0,0 +1,45 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <benchmark/benchmark.h>
+#include <xgboost/data.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../../../src/data/adapter.h"
+#include "../../cpp/helpers.h"
+#include "bench_helpers.h"
+
+namespace xgboost {
+namespace data {
+
+static void BM_SparsePagePush(benchmark::State& state) {
+  auto const n_rows = static_cast<size_t>(state.range(0));
+  auto const n_cols = static_cast<size_t>(state.range(1));
+  float const sparsity = state.range(2) / 100.0f;
+  auto const n_threads = static_cast<int>(state.range(3));
+  float const missing = std::numeric_limits<float>::quiet_NaN();
+
+  SimpleLCG gen;
+  SimpleRealUniformDistribution<bst_float> dist(0.0f, 1.0f);
+  std::vector<float> values(n_rows * n_cols);
+  size_t n_valid = 0;
+  for (auto& v : values) {
+    v = dist(&gen) < sparsity ? missing : dist(&gen);
+    n_valid += !std::isnan(v);
+  }
+  DenseAdapter adapter(values.data(), n_rows, n_cols);
+
+  for (auto _ : state) {
+    SparsePage page;
+    page.Push(adapter.Value(), missing, n_threads);
+    benchmark::DoNotOptimize(page.data.ConstHostPointer());
+  }
+  state.SetItemsProcessed(state.iterations() * n_rows);
+  state.SetBytesProcessed(state.iterations() * n_valid * sizeof(Entry));
+}
+BENCHMARK(BM_SparsePagePush)->Apply(bench::DataShapes);
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,65 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "bench_helpers.h"
+#include "../../cpp/helpers.h"
+
+namespace xgboost {
+namespace bench {
+
+void DataShapes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"rows", "cols", "sparsity", "threads"});
+  int64_t const n_procs = omp_get_num_procs();
+  std::vector<std::vector<int64_t>> shapes {
+    {1 << 16, 64, 0},     // dense
+    {1 << 16, 64, 90},    // sparse
+    {1 << 12, 2048, 50},  // wide
+    {1 << 20, 8, 0}       // tall
+  };
+  for (auto const& shape : shapes) {
+    for (int64_t n_threads : {static_cast<int64_t>(1), n_procs}) {
+      b->Args({shape[0], shape[1], shape[2], n_threads});
+      if (n_procs == 1) {
+        break;
+      }
+    }
+  }
+  b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+std::shared_ptr<DMatrix> GetDMatrix(benchmark::State const& state) {
+  using Shape = std::tuple<int64_t, int64_t, int64_t>;
+  static std::map<Shape, std::shared_ptr<DMatrix>> cache;
+  Shape shape {state.range(0), state.range(1), state.range(2)};
+  auto it = cache.find(shape);
+  if (it != cache.cend()) {
+    return it->second;
+  }
+  auto rows = static_cast<int>(state.range(0));
+  auto pp_dmat = CreateDMatrix(rows, static_cast<int>(state.range(1)),
+                               state.range(2) / 100.0f, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  delete pp_dmat;
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(rows);
+  SimpleLCG gen;
+  SimpleRealUniformDistribution<bst_float> dist(0.0f, 1.0f);
+  for (auto& label : h_labels) {
+    label = dist(&gen);
+  }
+  cache[shape] = p_dmat;
+  return p_dmat;
+}
+
+void SetProcessed(benchmark::State* state, DMatrix const& dmat) {
+  auto const& info = dmat.Info();
+  state->SetItemsProcessed(state->iterations() * info.num_row_);
+  state->SetBytesProcessed(state->iterations() * info.num_nonzero_ * sizeof(Entry));
+}
+}  // namespace bench
+}  // namespace xgboost
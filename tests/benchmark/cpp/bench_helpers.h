@@ -0,0 +1,46 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ * \file bench_helpers.h
+ * \brief Shapes of the synthetic data shared by the micro benchmarks.
+ */
+#ifndef XGBOOST_BENCH_HELPERS_H_
+#define XGBOOST_BENCH_HELPERS_H_
+
+#include <benchmark/benchmark.h>
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+
+#include <memory>
+
+namespace xgboost {
+namespace bench {
+/*!
+ * \brief Register the arguments {rows, columns, sparsity in percent, threads} of a
+ *  benchmark for dense, sparse, wide and tall data, each with one thread and with all
+ *  the threads of the machine.
+ */
+void DataShapes(benchmark::internal::Benchmark* b);
+
+/*!
+ * \brief Data with the shape of the first three arguments, created once for each shape.
+ *  Labels are set for training.
+ */
+std::shared_ptr<DMatrix> GetDMatrix(benchmark::State const& state);
+
+/*! \brief Set the number of OpenMP threads to the 4th argument during a benchmark. */
+class ScopedThreads {
+  int32_t n_threads_;
+
+ public:
+  explicit ScopedThreads(benchmark::State const& state)
+      : n_threads_{omp_get_max_threads()} {
+    omp_set_num_threads(static_cast<int32_t>(state.range(3)));
+  }
+  ~ScopedThreads() { omp_set_num_threads(n_threads_); }
+};
+
+/*! \brief Report the throughput in rows and bytes of the data. */
+void SetProcessed(benchmark::State* state, DMatrix const& dmat);
+}  // namespace bench
+}  // namespace xgboost
+#endif  // XGBOOST_BENCH_HELPERS_H_
@@ -0,0 +1,137 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <benchmark/benchmark.h>
+#include <dmlc/omp.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "../../../src/common/hist_util.h"
+#include "../../../src/common/row_set.h"
+#include "../../../src/tree/param.h"
+#include "../../cpp/helpers.h"
+#include "bench_helpers.h"
+
+namespace xgboost {
+namespace common {
+
+constexpr int32_t kMaxBins = 256;
+
+static void BM_HistogramCuts(benchmark::State& state) {
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  for (auto _ : state) {
+    HistogramCuts cuts;
+    cuts.Build(p_dmat.get(), kMaxBins);
+    benchmark::DoNotOptimize(cuts.TotalBins());
+  }
+  bench::SetProcessed(&state, *p_dmat);
+}
+BENCHMARK(BM_HistogramCuts)->Apply(bench::DataShapes);
+
+static void BM_GHistIndexMatrixInit(benchmark::State& state) {
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  HistogramCuts cuts;
+  cuts.Build(p_dmat.get(), kMaxBins);
+  GHistIndexMatrix gmat;
+  for (auto _ : state) {
+    for (auto const& batch : p_dmat->GetBatches<SparsePage>()) {
+      gmat.Init(batch, cuts, p_dmat->IsDense());
+    }
+    benchmark::DoNotOptimize(gmat.index.Size());
+  }
+  bench::SetProcessed(&state, *p_dmat);
+}
+BENCHMARK(BM_GHistIndexMatrixInit)->Apply(bench::DataShapes);
+
+/*
+ * Histogram of the root, each thread building the histogram of a contiguous range of
+ * rows into its own buffer as the quantile hist updater does.
+ */
+static void BM_BuildHist(benchmark::State& state) {
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  GHistIndexMatrix gmat;
+  gmat.Init(p_dmat.get(), kMaxBins);
+  size_t const n_rows = p_dmat->Info().num_row_;
+  auto const nbins = static_cast<uint32_t>(gmat.cut.TotalBins());
+  auto gpair = GenerateRandomGradients(n_rows).HostVector();
+  std::vector<size_t> row_indices(n_rows);
+  std::iota(row_indices.begin(), row_indices.end(), 0);
+
+  auto const n_threads = static_cast<size_t>(state.range(3));
+  GHistBuilder<double> builder(n_threads, nbins);
+  std::vector<std::vector<tree::GradStats>> hists(n_threads,
+                                                  std::vector<tree::GradStats>(nbins));
+  size_t const chunk = common::DivRoundUp(n_rows, n_threads);
+  for (auto _ : state) {
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+    for (omp_ulong tid = 0; tid < n_threads; ++tid) {  // NOLINT(*)
+      auto& hist = hists[tid];
+      std::fill(hist.begin(), hist.end(), tree::GradStats{});
+      size_t const begin = std::min(tid * chunk, n_rows);
+      size_t const end = std::min(begin + chunk, n_rows);
+      RowSetCollection::Elem rows(row_indices.data() + begin, row_indices.data() + end, 0);
+      builder.BuildHist(gpair, rows, gmat, GHistRow<double>(hist.data(), nbins));
+    }
+    benchmark::DoNotOptimize(hists.front().data());
+  }
+  bench::SetProcessed(&state, *p_dmat);
+}
+BENCHMARK(BM_BuildHist)->Apply(bench::DataShapes);
+
+/*
+ * Partition of all the rows by the bin of their first entry, in blocks of rows like the
+ * quantile hist updater.
+ */
+static void BM_PartitionBuilder(benchmark::State& state) {
+  constexpr size_t kBlockSize = 2048;
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  GHistIndexMatrix gmat;
+  gmat.Init(p_dmat.get(), kMaxBins);
+  size_t const n_rows = p_dmat->Info().num_row_;
+  uint32_t const split_bin = gmat.cut.Ptrs().at(1) / 2;
+  std::vector<size_t> row_indices(n_rows);
+  std::iota(row_indices.begin(), row_indices.end(), 0);
+  std::vector<size_t> child(n_rows);
+
+  size_t const n_blocks = common::DivRoundUp(n_rows, kBlockSize);
+  PartitionBuilder<kBlockSize> builder;
+  for (auto _ : state) {
+    builder.Init(n_blocks, 1, [&](size_t) { return n_blocks; });
+#pragma omp parallel for schedule(static)
+    for (omp_ulong block = 0; block < n_blocks; ++block) {  // NOLINT(*)
+      size_t const begin = block * kBlockSize;
+      size_t const end = std::min(begin + kBlockSize, n_rows);
+      auto decisions = builder.GetDecisionBuffer(0, begin, end);
+      size_t n_left = 0;
+      for (size_t i = begin; i < end; ++i) {
+        size_t const rid = row_indices[i];
+        bool const go_left = gmat.row_ptr[rid] == gmat.row_ptr[rid + 1] ||
+                             gmat.index[gmat.row_ptr[rid]] <= split_bin;
+        decisions[i - begin] = go_left;
+        n_left += go_left;
+      }
+      builder.SetNLeftElems(0, begin, end, n_left);
+      builder.SetNRightElems(0, begin, end, end - begin - n_left);
+    }
+    builder.CalculateRowOffsets();
+#pragma omp parallel for schedule(static)
+    for (omp_ulong block = 0; block < n_blocks; ++block) {  // NOLINT(*)
+      size_t const begin = block * kBlockSize;
+      size_t const end = std::min(begin + kBlockSize, n_rows);
+      builder.Scatter(0, begin,
+                      common::Span<size_t const>(row_indices.data() + begin, end - begin),
+                      child.data());
+    }
+    benchmark::DoNotOptimize(child.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n_rows);
+}
+BENCHMARK(BM_PartitionBuilder)->Apply(bench::DataShapes);
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,16 @@
+// Copyright by Contributors
+#include <benchmark/benchmark.h>
+#include <xgboost/base.h>
+#include <xgboost/logging.h>
+
+int main(int argc, char ** argv) {
+  xgboost::Args args {{"verbosity", "1"}};
+  xgboost::ConsoleLogger::Configure(args);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <benchmark/benchmark.h>
+#include <xgboost/json.h>
+#include <xgboost/learner.h>
+#include <xgboost/predictor.h>
+
+#include <memory>
+#include <string>
+
+#include "../../../src/gbm/gbtree_model.h"
+#include "../../cpp/helpers.h"
+#include "bench_helpers.h"
+
+namespace xgboost {
+namespace {
+constexpr int32_t kRounds = 32;
+
+/*! \brief JSON model with kRounds trees of depth 6 trained on the data. */
+Json TrainModel(std::shared_ptr<DMatrix> p_dmat) {
+  std::unique_ptr<Learner> learner {Learner::Create({p_dmat})};
+  learner->SetParams({{"tree_method", "hist"}, {"max_depth", "6"}});
+  for (int32_t iter = 0; iter < kRounds; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+  Json model {Object()};
+  learner->SaveModel(&model);
+  return model;
+}
+}  // anonymous namespace
+
+static void BM_CPUPredictor(benchmark::State& state) {
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  Json j_model = TrainModel(p_dmat);
+
+  LearnerModelParam param;
+  param.num_feature = p_dmat->Info().num_col_;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+  gbm::GBTreeModel model(&param);
+  model.LoadModel(j_model["learner"]["gradient_booster"]["model"]);
+
+  auto generic_param = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> predictor {
+    Predictor::Create("cpu_predictor", &generic_param)};
+  predictor->Configure({});
+  for (auto _ : state) {
+    // A fresh cache entry, so all the trees are predicted.
+    PredictionCacheEntry predts;
+    predictor->PredictBatch(p_dmat.get(), &predts, model, 0);
+    benchmark::DoNotOptimize(predts.predictions.ConstHostPointer());
+  }
+  bench::SetProcessed(&state, *p_dmat);
+}
+BENCHMARK(BM_CPUPredictor)->Apply(bench::DataShapes);
+
+static void BM_LoadJsonModel(benchmark::State& state) {
+  auto p_dmat = bench::GetDMatrix(state);
+  bench::ScopedThreads threads {state};
+  std::string str;
+  Json::Dump(TrainModel(p_dmat), &str);
+  for (auto _ : state) {
+    std::unique_ptr<Learner> learner {Learner::Create({})};
+    learner->LoadModel(Json::Load({str.c_str(), str.size()}));
+    benchmark::DoNotOptimize(learner.get());
+  }
+  state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK(BM_LoadJsonModel)->Apply(bench::DataShapes);
+}  // namespace xgboost
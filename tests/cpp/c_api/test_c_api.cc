@@ -7,8 +7,11 @@
 #include <xgboost/data.h>
 #include <xgboost/learner.h>
 
+#include <limits>
+
 #include "../helpers.h"
 #include "../../../src/common/io.h"
+#include "../../../src/data/adapter.h"
 
 
 TEST(c_api, XGDMatrixCreateFromMatDT) {
@@ -146,4 +149,483 @@ TEST(c_api, JsonModelIO) {
   ASSERT_EQ(model_str_0, model_str_1);
   delete pp_dmat;
 }
+
+TEST(c_api, PredictFromRow) {
+  size_t constexpr kRows = 64, kCols = 8, kClasses = 3;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto p_dmat = *pp_dmat;
+  std::vector<std::shared_ptr<DMatrix>> mat {p_dmat};
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = i % kClasses;
+  }
+  p_dmat->Info().labels_.HostVector() = labels;
+
+  std::shared_ptr<Learner> learner { Learner::Create(mat) };
+  learner->SetParams({{"objective", "multi:softprob"},
+                      {"num_class", std::to_string(kClasses)}});
+  for (int32_t i = 0; i < 3; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  BoosterHandle handle = learner.get();
+
+  DMatrixHandle dmat_handle = pp_dmat;
+  for (int option_mask : {0, 1}) {
+    bst_ulong out_len {0};
+    const float* expected {nullptr};
+    XGBoosterPredict(handle, dmat_handle, option_mask, 0, 0, &out_len, &expected);
+    ASSERT_EQ(out_len, kRows * kClasses);
+    std::vector<float> h_expected(expected, expected + out_len);
+
+    auto const& batch = *p_dmat->GetBatches<SparsePage>().begin();
+    std::vector<int> failed(kRows, 0);
+    // concurrent callers on one booster
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < kRows; ++i) {  // NOLINT
+      auto inst = batch[i];
+      std::vector<float> dense(kCols, std::numeric_limits<float>::quiet_NaN());
+      std::vector<unsigned> indices;
+      std::vector<float> values;
+      for (auto const& e : inst) {
+        dense[e.index] = e.fvalue;
+        indices.push_back(e.index);
+        values.push_back(e.fvalue);
+      }
+      float out_dense[kClasses], out_csr[kClasses];
+      bst_ulong len_dense {0}, len_csr {0};
+      failed[i] += XGBoosterPredictFromDenseRow(
+          handle, dense.data(), kCols, std::numeric_limits<float>::quiet_NaN(),
+          option_mask, 0, out_dense, kClasses, &len_dense) != 0;
+      failed[i] += XGBoosterPredictFromCSRRow(
+          handle, indices.data(), values.data(), indices.size(), option_mask, 0,
+          out_csr, kClasses, &len_csr) != 0;
+      failed[i] += len_dense != kClasses || len_csr != kClasses;
+      for (size_t c = 0; c < kClasses; ++c) {
+        failed[i] += std::abs(out_dense[c] - h_expected[i * kClasses + c]) > 1e-6;
+        failed[i] += out_csr[c] != out_dense[c];
+      }
+    }
+    for (auto f : failed) {
+      ASSERT_EQ(f, 0);
+    }
+  }
+
+  // Output buffer too small for the number of classes.
+  std::vector<float> row(kCols, 1.0f);
+  float out[kClasses];
+  bst_ulong out_len {0};
+  ASSERT_NE(XGBoosterPredictFromDenseRow(handle, row.data(), kCols, 0, 0, 0, out,
+                                         kClasses - 1, &out_len), 0);
+  delete pp_dmat;
+}
+
+TEST(c_api, PredictionBatcher) {
+  size_t constexpr kRows = 64, kCols = 8, kClasses = 3;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto p_dmat = *pp_dmat;
+  std::vector<std::shared_ptr<DMatrix>> mat {p_dmat};
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = i % kClasses;
+  }
+  p_dmat->Info().labels_.HostVector() = labels;
+
+  std::shared_ptr<Learner> learner { Learner::Create(mat) };
+  learner->SetParams({{"objective", "multi:softprob"},
+                      {"num_class", std::to_string(kClasses)}});
+  for (int32_t i = 0; i < 3; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  BoosterHandle handle = learner.get();
+  DMatrixHandle dmat_handle = pp_dmat;
+  bst_ulong out_len {0};
+  const float* expected {nullptr};
+  XGBoosterPredict(handle, dmat_handle, 0, 0, 0, &out_len, &expected);
+  ASSERT_EQ(out_len, kRows * kClasses);
+  std::vector<float> h_expected(expected, expected + out_len);
+
+  PredictionBatcherHandle batcher;
+  ASSERT_EQ(XGBoosterCreatePredictionBatcher(handle, 200, 16, 0, 0, &batcher), 0);
+  auto const& batch = *p_dmat->GetBatches<SparsePage>().begin();
+  std::vector<float> out_dense(kRows * kClasses), out_csr(kRows * kClasses);
+  std::vector<int> failed(kRows, 0);
+  // concurrent callers on one batcher
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < kRows; ++i) {  // NOLINT
+    auto inst = batch[i];
+    std::vector<float> dense(kCols, std::numeric_limits<float>::quiet_NaN());
+    std::vector<unsigned> indices;
+    std::vector<float> values;
+    for (auto const& e : inst) {
+      dense[e.index] = e.fvalue;
+      indices.push_back(e.index);
+      values.push_back(e.fvalue);
+    }
+    PredictionTicketHandle t_dense {nullptr}, t_csr {nullptr};
+    failed[i] += XGPredictionBatcherSubmitDenseRow(
+        batcher, dense.data(), kCols, std::numeric_limits<float>::quiet_NaN(),
+        out_dense.data() + i * kClasses, kClasses, &t_dense) != 0;
+    failed[i] += XGPredictionBatcherSubmitCSRRow(
+        batcher, indices.data(), values.data(), indices.size(),
+        out_csr.data() + i * kClasses, kClasses, &t_csr) != 0;
+    bst_ulong len_dense {0}, len_csr {0};
+    failed[i] += XGPredictionTicketWait(t_dense, &len_dense) != 0;
+    failed[i] += XGPredictionTicketWait(t_csr, &len_csr) != 0;
+    failed[i] += len_dense != kClasses || len_csr != kClasses;
+  }
+  for (auto f : failed) {
+    ASSERT_EQ(f, 0);
+  }
+  for (size_t i = 0; i < h_expected.size(); ++i) {
+    ASSERT_NEAR(out_dense[i], h_expected[i], 1e-6);
+    ASSERT_EQ(out_csr[i], out_dense[i]);
+  }
+
+  // Output buffer too small for the number of classes, reported by the ticket.
+  std::vector<float> row(kCols, 1.0f);
+  float out[kClasses];
+  PredictionTicketHandle ticket {nullptr};
+  ASSERT_EQ(XGPredictionBatcherSubmitDenseRow(batcher, row.data(), kCols, 0, out,
+                                              kClasses - 1, &ticket), 0);
+  ASSERT_NE(XGPredictionTicketWait(ticket, &out_len), 0);
+  ASSERT_EQ(XGPredictionBatcherFree(batcher), 0);
+  delete pp_dmat;
+}
+
+TEST(c_api, BoostOneIterWithGradientPairs) {
+  size_t constexpr kRows = 64;
+  auto pp_dmat = CreateDMatrix(kRows, 8, 0);
+  auto p_dmat = *pp_dmat;
+  std::vector<std::shared_ptr<DMatrix>> mat {p_dmat};
+  p_dmat->Info().labels_.HostVector().resize(kRows);
+
+  std::vector<float> grad(kRows), hess(kRows), pairs;
+  for (size_t i = 0; i < kRows; ++i) {
+    grad[i] = static_cast<float>(i % 7) - 3.0f;
+    hess[i] = 1.0f + static_cast<float>(i % 3);
+    pairs.push_back(grad[i]);
+    pairs.push_back(hess[i]);
+  }
+  Json j_interface {Object()};
+  j_interface["data"] = Array(std::vector<Json>{
+      Json{Integer(reinterpret_cast<int64_t>(pairs.data()))}, Json{Boolean(true)}});
+  j_interface["shape"] = Array(std::vector<Json>{
+      Json{Integer(static_cast<int64_t>(kRows))}, Json{Integer(static_cast<int64_t>(2))}});
+  j_interface["typestr"] = String("<f4");
+  j_interface["version"] = Integer(static_cast<int64_t>(2));
+  std::string interface_str;
+  Json::Dump(j_interface, &interface_str);
+
+  std::shared_ptr<Learner> separate { Learner::Create(mat) };
+  std::shared_ptr<Learner> interleaved { Learner::Create(mat) };
+  DMatrixHandle dmat_handle = pp_dmat;
+  for (int32_t i = 0; i < 2; ++i) {
+    ASSERT_EQ(XGBoosterBoostOneIter(separate.get(), dmat_handle, grad.data(), hess.data(),
+                                    kRows), 0);
+    ASSERT_EQ(XGBoosterBoostOneIterWithGradientPairs(interleaved.get(), dmat_handle,
+                                                     interface_str.c_str()), 0);
+  }
+
+  HostDeviceVector<float> expected, got;
+  separate->Predict(p_dmat, false, &expected);
+  interleaved->Predict(p_dmat, false, &got);
+  ASSERT_EQ(expected.ConstHostVector(), got.ConstHostVector());
+
+  // hessian column is missing
+  j_interface["shape"] = Array(std::vector<Json>{Json{Integer(static_cast<int64_t>(kRows))}});
+  Json::Dump(j_interface, &interface_str);
+  ASSERT_NE(XGBoosterBoostOneIterWithGradientPairs(interleaved.get(), dmat_handle,
+                                                   interface_str.c_str()), 0);
+  delete pp_dmat;
+}
+
+TEST(c_api, PredictToArray) {
+  size_t constexpr kRows = 32;
+  auto pp_dmat = CreateDMatrix(kRows, 4, 0);
+  auto p_dmat = *pp_dmat;
+  p_dmat->Info().labels_.HostVector().resize(kRows, 1.0f);
+  std::shared_ptr<Learner> learner { Learner::Create({p_dmat}) };
+  for (int32_t i = 0; i < 2; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  BoosterHandle handle = learner.get();
+  DMatrixHandle dmat_handle = pp_dmat;
+
+  bst_ulong expected_len {0};
+  float const* expected {nullptr};
+  ASSERT_EQ(XGBoosterPredict(handle, dmat_handle, 0, 0, 0, &expected_len, &expected), 0);
+  std::vector<float> h_expected(expected, expected + expected_len);
+
+  std::vector<float> buffer(kRows + 1, -1.0f);
+  Json j_interface {Object()};
+  j_interface["data"] = Array(std::vector<Json>{
+      Json{Integer(reinterpret_cast<int64_t>(buffer.data()))}, Json{Boolean(false)}});
+  j_interface["shape"] = Array(std::vector<Json>{
+      Json{Integer(static_cast<int64_t>(buffer.size()))}});
+  j_interface["typestr"] = String("<f4");
+  j_interface["version"] = Integer(static_cast<int64_t>(2));
+  std::string interface_str;
+  Json::Dump(j_interface, &interface_str);
+
+  bst_ulong len {0};
+  ASSERT_EQ(XGBoosterPredictToArray(handle, dmat_handle, 0, 0, 0, interface_str.c_str(),
+                                    &len), 0);
+  ASSERT_EQ(len, expected_len);
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_EQ(buffer[i], h_expected[i]);
+  }
+  ASSERT_EQ(buffer[kRows], -1.0f);
+
+  // too small
+  j_interface["shape"] = Array(std::vector<Json>{
+      Json{Integer(static_cast<int64_t>(kRows - 1))}});
+  Json::Dump(j_interface, &interface_str);
+  ASSERT_NE(XGBoosterPredictToArray(handle, dmat_handle, 0, 0, 0, interface_str.c_str(),
+                                    &len), 0);
+  // read only
+  j_interface["shape"] = Array(std::vector<Json>{
+      Json{Integer(static_cast<int64_t>(kRows))}});
+  j_interface["data"] = Array(std::vector<Json>{
+      Json{Integer(reinterpret_cast<int64_t>(buffer.data()))}, Json{Boolean(true)}});
+  Json::Dump(j_interface, &interface_str);
+  ASSERT_NE(XGBoosterPredictToArray(handle, dmat_handle, 0, 0, 0, interface_str.c_str(),
+                                    &len), 0);
+  delete pp_dmat;
+}
+
+TEST(c_api, InplacePredict) {
+  size_t constexpr kRows = 80, kCols = 4;
+  std::vector<float> values(kRows * kCols);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<float>((i * 5) % 13);
+  }
+  values[7] = std::numeric_limits<float>::quiet_NaN();
+  data::DenseAdapter adapter(values.data(), kRows, kCols);
+  std::shared_ptr<DMatrix> p_dmat {
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1)};
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_labels[i] = static_cast<float>(i % 2);
+  }
+  std::shared_ptr<Learner> learner { Learner::Create({p_dmat}) };
+  learner->SetParam("objective", "binary:logistic");
+  for (int32_t i = 0; i < 3; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  HostDeviceVector<float> expected;
+  learner->Predict(p_dmat, false, &expected);
+  auto const& h_expected = expected.ConstHostVector();
+  BoosterHandle handle = learner.get();
+
+  auto make_interface = [](void const* ptr, std::vector<int64_t> const& shape,
+                           std::string typestr) {
+    Json j_interface {Object()};
+    j_interface["data"] = Array(std::vector<Json>{
+        Json{Integer(reinterpret_cast<int64_t>(ptr))}, Json{Boolean(true)}});
+    std::vector<Json> j_shape;
+    for (auto dim : shape) {
+      j_shape.emplace_back(Integer(dim));
+    }
+    j_interface["shape"] = Array(std::move(j_shape));
+    j_interface["typestr"] = String(std::move(typestr));
+    j_interface["version"] = Integer(static_cast<int64_t>(2));
+    std::string str;
+    Json::Dump(j_interface, &str);
+    return str;
+  };
+
+  bst_ulong len {0};
+  float const* result {nullptr};
+  auto dense = make_interface(values.data(), {kRows, kCols}, "<f4");
+  ASSERT_EQ(XGBoosterPredictFromDense(handle, dense.c_str(),
+                                      std::numeric_limits<float>::quiet_NaN(), 0, 0, &len,
+                                      &result), 0);
+  ASSERT_EQ(len, kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_NEAR(result[i], h_expected[i], 1e-6);
+  }
+  // other element types are converted while predicting
+  std::vector<double> f8_values(values.cbegin(), values.cend());
+  auto f8_dense = make_interface(f8_values.data(), {kRows, kCols}, "<f8");
+  ASSERT_EQ(XGBoosterPredictFromDense(handle, f8_dense.c_str(),
+                                      std::numeric_limits<float>::quiet_NaN(), 0, 0, &len,
+                                      &result), 0);
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_NEAR(result[i], h_expected[i], 1e-6);
+  }
+
+  auto const& page = *p_dmat->GetBatches<SparsePage>().begin();
+  std::vector<size_t> indptr(page.offset.ConstHostVector().cbegin(),
+                             page.offset.ConstHostVector().cend());
+  std::vector<unsigned> indices;
+  std::vector<float> csr_values;
+  for (auto const& entry : page.data.ConstHostVector()) {
+    indices.push_back(entry.index);
+    csr_values.push_back(entry.fvalue);
+  }
+  auto j_indptr = make_interface(indptr.data(), {static_cast<int64_t>(indptr.size())}, "<u8");
+  auto j_indices =
+      make_interface(indices.data(), {static_cast<int64_t>(indices.size())}, "<u4");
+  auto j_values =
+      make_interface(csr_values.data(), {static_cast<int64_t>(csr_values.size())}, "<f4");
+  ASSERT_EQ(XGBoosterPredictFromCSR(handle, j_indptr.c_str(), j_indices.c_str(),
+                                    j_values.c_str(), kCols,
+                                    std::numeric_limits<float>::quiet_NaN(), 1, 0, &len,
+                                    &result), 0);
+  HostDeviceVector<float> margin;
+  learner->Predict(p_dmat, true, &margin);
+  ASSERT_EQ(len, kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_NEAR(result[i], margin.ConstHostVector()[i], 1e-6);
+  }
+  // a feature index past the number of columns
+  ASSERT_NE(XGBoosterPredictFromCSR(handle, j_indptr.c_str(), j_indices.c_str(),
+                                    j_values.c_str(), 1,
+                                    std::numeric_limits<float>::quiet_NaN(), 0, 0, &len,
+                                    &result), 0);
+}
+
+namespace {
+int DumpModelCallback(void* context, bst_ulong index, char const* dump) {
+  auto* dumps = static_cast<std::vector<std::string>*>(context);
+  EXPECT_EQ(index, dumps->size());
+  dumps->emplace_back(dump);
+  return dumps->size() == 3 ? 1 : 0;
+}
+}  // anonymous namespace
+
+TEST(c_api, StreamDumpModel) {
+  size_t constexpr kRows = 32;
+  dmlc::TemporaryDirectory tempdir;
+  auto pp_dmat = CreateDMatrix(kRows, 4, 0);
+  auto p_dmat = *pp_dmat;
+  p_dmat->Info().labels_.HostVector().resize(kRows, 1.0f);
+  std::shared_ptr<Learner> learner { Learner::Create({p_dmat}) };
+  for (int32_t i = 0; i < 4; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  BoosterHandle handle = learner.get();
+
+  for (auto format : {"text", "json"}) {
+    bst_ulong len {0};
+    char const** out_models {nullptr};
+    ASSERT_EQ(XGBoosterDumpModelEx(handle, "", 1, format, &len, &out_models), 0);
+    ASSERT_EQ(len, 4u);
+    std::vector<std::string> expected(out_models, out_models + len);
+
+    std::string fname = tempdir.path + "/dump.txt";
+    ASSERT_EQ(XGBoosterDumpModelToFile(handle, "", 1, format, fname.c_str()), 0);
+    std::string joined;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      if (std::string{format} == "json") {
+        joined += i == 0 ? "[\n" : ",\n";
+      } else {
+        joined += "booster[" + std::to_string(i) + "]:\n";
+      }
+      joined += expected[i];
+    }
+    if (std::string{format} == "json") {
+      joined += "\n]\n";
+    }
+    ASSERT_EQ(common::LoadSequentialFile(fname), joined);
+
+    // the callback stops the dump after 3 boosters
+    std::vector<std::string> dumps;
+    ASSERT_NE(XGBoosterDumpModelWithCallback(handle, "", 1, format, DumpModelCallback,
+                                             &dumps), 0);
+    ASSERT_EQ(dumps.size(), 3u);
+    for (size_t i = 0; i < dumps.size(); ++i) {
+      ASSERT_EQ(dumps[i], expected[i]);
+    }
+  }
+  delete pp_dmat;
+}
+
+namespace {
+struct TrainRoundsLog {
+  std::vector<int> iters;
+  std::vector<float> results;
+  std::vector<std::string> metric_names;
+  std::vector<int> checkpoints;
+  std::string last_model;
+};
+
+int EvalIterationCallback(void* context, int iter, float const* results,
+                          char const* const* metric_names, bst_ulong n_metrics) {
+  auto* log = static_cast<TrainRoundsLog*>(context);
+  log->iters.push_back(iter);
+  // two data sets
+  log->results.insert(log->results.end(), results, results + n_metrics * 2);
+  log->metric_names.assign(metric_names, metric_names + n_metrics);
+  return 0;
+}
+
+int CheckpointCallback(void* context, int iter, char const* model, bst_ulong len) {
+  auto* log = static_cast<TrainRoundsLog*>(context);
+  log->checkpoints.push_back(iter);
+  log->last_model.assign(model, len);
+  return 0;
+}
+}  // anonymous namespace
+
+TEST(c_api, TrainRounds) {
+  size_t constexpr kRows = 64;
+  int32_t constexpr kRounds = 5;
+  auto pp_dmat = CreateDMatrix(kRows, 4, 0);
+  auto p_dmat = *pp_dmat;
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_labels[i] = static_cast<float>(i % 4);
+  }
+  std::vector<std::shared_ptr<DMatrix>> mat {p_dmat};
+  DMatrixHandle dmat_handle = pp_dmat;
+  std::vector<DMatrixHandle> evals {dmat_handle, dmat_handle};
+
+  std::unique_ptr<Learner> expected { Learner::Create(mat) };
+  std::unique_ptr<Learner> learner { Learner::Create(mat) };
+  for (auto* bst : {expected.get(), learner.get()}) {
+    bst->SetParams({{"eval_metric", "rmse"}, {"eval_metric", "mae"}});
+  }
+  std::vector<bst_float> expected_results, results;
+  std::vector<std::string> names;
+  for (int32_t i = 0; i < kRounds; ++i) {
+    expected->UpdateOneIter(i, p_dmat);
+    expected->EvalOneIterValues(i, {p_dmat, p_dmat}, &results, &names);
+    expected_results.insert(expected_results.end(), results.cbegin(), results.cend());
+  }
+
+  TrainRoundsLog log;
+  int end_iteration {0}, best_iteration {0};
+  float best_score {0};
+  ASSERT_EQ(XGBoosterTrainRounds(learner.get(), dmat_handle, 0, kRounds, evals.data(),
+                                 evals.size(), 0, 0, 2, EvalIterationCallback,
+                                 CheckpointCallback, &log, &end_iteration, &best_iteration,
+                                 &best_score), 0);
+  ASSERT_EQ(end_iteration, kRounds);
+  ASSERT_EQ(log.iters, std::vector<int>({0, 1, 2, 3, 4}));
+  ASSERT_EQ(log.metric_names, std::vector<std::string>({"rmse", "mae"}));
+  ASSERT_EQ(log.results, expected_results);
+  ASSERT_EQ(log.checkpoints, std::vector<int>({1, 3, 4}));
+
+  std::string raw;
+  common::MemoryBufferStream fo(&raw);
+  learner->SaveModel(&fo);
+  ASSERT_EQ(log.last_model, raw);
+
+  // The training error keeps going down, so maximizing it stops after 2 more rounds.
+  std::unique_ptr<Learner> stopped { Learner::Create(mat) };
+  ASSERT_EQ(XGBoosterTrainRounds(stopped.get(), dmat_handle, 0, kRounds, evals.data(),
+                                 evals.size(), 2, 1, 0, nullptr, nullptr, nullptr,
+                                 &end_iteration, &best_iteration, &best_score), 0);
+  ASSERT_EQ(end_iteration, 3);
+  ASSERT_EQ(best_iteration, 0);
+  std::string attr;
+  ASSERT_TRUE(stopped->GetAttr("best_iteration", &attr));
+  ASSERT_EQ(attr, "0");
+  ASSERT_TRUE(stopped->GetAttr("best_score", &attr));
+  ASSERT_EQ(std::stof(attr), best_score);
+  delete pp_dmat;
+}
 }  // namespace xgboost
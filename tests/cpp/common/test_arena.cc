@@ -0,0 +1,62 @@
+/*!
+ * Copyright 2020 by Contributors
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../../../src/common/arena.h"
+
+namespace xgboost {
+namespace common {
+TEST(Arena, Allocate) {
+  Arena arena(256);
+  auto* c = static_cast<char*>(arena.Allocate(3, 1));
+  auto* d = static_cast<double*>(arena.Allocate(sizeof(double), alignof(double)));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0U);
+  ASSERT_GE(arena.Used(), 3 + sizeof(double));
+  c[2] = 1;
+  *d = 1.0;
+  // larger than a chunk
+  auto* big = static_cast<char*>(arena.Allocate(1000, 64));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(big) % 64, 0U);
+  big[999] = 1;
+  ASSERT_GE(arena.Capacity(), 1000 + 256);
+
+  // the same allocations fit in the chunk kept by the reset
+  const size_t capacity = arena.Capacity();
+  arena.Reset();
+  ASSERT_EQ(arena.Used(), 0U);
+  ASSERT_EQ(arena.Capacity(), capacity);
+  arena.Allocate(3, 1);
+  arena.Allocate(sizeof(double), alignof(double));
+  arena.Allocate(1000, 64);
+  ASSERT_EQ(arena.Capacity(), capacity);
+
+  EXPECT_ANY_THROW(arena.Allocate(8, 3));
+}
+
+TEST(Arena, Vector) {
+  Arena arena;
+  ArenaVector<int32_t> vec((ArenaAllocator<int32_t>(&arena)));
+  for (int32_t i = 0; i < 1000; ++i) {
+    vec.push_back(i);
+  }
+  ASSERT_GE(arena.Used(), 1000 * sizeof(int32_t));
+  ASSERT_EQ(vec.get_allocator().GetArena(), &arena);
+  // copies may outlive the arena
+  ArenaVector<int32_t> copy(vec);
+  ASSERT_EQ(copy.get_allocator().GetArena(), nullptr);
+  ASSERT_EQ(copy, vec);
+  // copy assignment keeps the allocator of the target
+  ArenaVector<int32_t> heap;
+  heap = vec;
+  ASSERT_EQ(heap.get_allocator().GetArena(), nullptr);
+  ArenaVector<int32_t> moved(std::move(vec));
+  ASSERT_EQ(moved.get_allocator().GetArena(), &arena);
+  ASSERT_EQ(moved, copy);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,137 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include "../../../src/common/charconv.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+std::string ToStr(float value) {
+  char buffer[NumericLimits<float>::kToCharsSize];
+  auto res = ToChars(buffer, buffer + sizeof(buffer), value);
+  EXPECT_EQ(res.ec, std::errc());
+  return std::string{buffer, res.ptr};
+}
+
+uint32_t Bits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float Parse(std::string const& str) {
+  float value;
+  auto res = FromChars(str.data(), str.data() + str.size(), &value);
+  EXPECT_EQ(res.ec, std::errc());
+  EXPECT_EQ(res.ptr, str.data() + str.size());
+  return value;
+}
+}  // anonymous namespace
+
+TEST(CharConv, FloatToChars) {
+  ASSERT_EQ(ToStr(0.5f), "5E-1");
+  ASSERT_EQ(ToStr(1.0f), "1E0");
+  ASSERT_EQ(ToStr(0.1f), "1E-1");
+  ASSERT_EQ(ToStr(-31.8892f), "-3.18892E1");
+  ASSERT_EQ(ToStr(0.0f), "0E0");
+  ASSERT_EQ(ToStr(-0.0f), "-0E0");
+  ASSERT_EQ(ToStr(std::numeric_limits<float>::max()), "3.4028235E38");
+  ASSERT_EQ(ToStr(std::numeric_limits<float>::denorm_min()), "1E-45");
+  ASSERT_EQ(ToStr(std::numeric_limits<float>::quiet_NaN()), "NaN");
+  ASSERT_EQ(ToStr(std::numeric_limits<float>::infinity()), "Infinity");
+  ASSERT_EQ(ToStr(-std::numeric_limits<float>::infinity()), "-Infinity");
+
+  char small[4];
+  ASSERT_EQ(ToChars(small, small + sizeof(small), 1.0f).ec, std::errc::value_too_large);
+}
+
+TEST(CharConv, FloatRoundTrip) {
+  std::mt19937 rng(3);
+  for (size_t i = 0; i < 1 << 20; ++i) {
+    uint32_t bits = rng();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (std::isnan(value)) {
+      continue;
+    }
+    auto str = ToStr(value);
+    ASSERT_EQ(Bits(std::strtof(str.c_str(), nullptr)), bits) << str;
+    ASSERT_EQ(Bits(Parse(str)), bits) << str;
+
+    // No shorter representation parses back to the same value.
+    size_t digits = 0;
+    for (char c : str) {
+      if (c == 'E') {
+        break;
+      }
+      digits += std::isdigit(c) != 0;
+    }
+    if (digits > 1) {
+      char shorter[32];
+      snprintf(shorter, sizeof(shorter), "%.*e", static_cast<int>(digits) - 2, value);
+      ASSERT_NE(Bits(std::strtof(shorter, nullptr)), bits) << str << " " << shorter;
+    }
+  }
+}
+
+TEST(CharConv, FromChars) {
+  ASSERT_EQ(Parse("31.8892"), 31.8892f);
+  ASSERT_EQ(Parse("-2e-4"), -2e-4f);
+  ASSERT_EQ(Parse("2E+4"), 2e4f);
+  ASSERT_EQ(Parse("0.0"), 0.0f);
+  ASSERT_TRUE(std::signbit(Parse("-0.0")));
+  ASSERT_TRUE(std::isnan(Parse("NaN")));
+  ASSERT_EQ(Parse("-Infinity"), -std::numeric_limits<float>::infinity());
+  ASSERT_EQ(Parse("1e39"), std::numeric_limits<float>::infinity());
+  ASSERT_EQ(Parse("1e-50"), 0.0f);
+  // written by older versions with the precision of a double
+  ASSERT_EQ(Parse("3.18892002105712891e+01"), 31.8892f);
+  // more digits than the fast path takes, and the first float above 1 + 2^-24
+  ASSERT_EQ(Parse("1.00000005960464477539062500000000000000001"),
+            std::nextafter(1.0f, 2.0f));
+  ASSERT_EQ(Parse("1.000000059604644775390625"), 1.0f);
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int32_t> digit(0, 9);
+  std::uniform_int_distribution<int32_t> exponent(-60, 40);
+  for (size_t i = 0; i < 1 << 16; ++i) {
+    std::string str = rng() % 2 == 0 ? "-" : "";
+    str += std::to_string(digit(rng));
+    str += '.';
+    auto n_digits = 1 + rng() % 24;
+    for (size_t k = 0; k < n_digits; ++k) {
+      str += static_cast<char>('0' + digit(rng));
+    }
+    str += 'e' + std::to_string(exponent(rng));
+    ASSERT_EQ(Bits(Parse(str)), Bits(std::strtof(str.c_str(), nullptr))) << str;
+  }
+
+  float value;
+  std::string invalid[] = {"", "-", ".5", "1.", "1e", "nan"};
+  for (auto const& str : invalid) {
+    ASSERT_EQ(FromChars(str.data(), str.data() + str.size(), &value).ec,
+              std::errc::invalid_argument) << str;
+  }
+}
+
+TEST(CharConv, IntegerToChars) {
+  int64_t values[] = {0, 7, -7, 10, -99, 100, 1234567890123,
+                      std::numeric_limits<int64_t>::max(),
+                      std::numeric_limits<int64_t>::min()};
+  for (auto v : values) {
+    char buffer[NumericLimits<int64_t>::kToCharsSize];
+    auto res = ToChars(buffer, buffer + sizeof(buffer), v);
+    ASSERT_EQ(std::string(buffer, res.ptr), std::to_string(v));
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -1,5 +1,6 @@
 #include <dmlc/filesystem.h>
 #include <gtest/gtest.h>
+#include <limits>
 
 #include "../../../src/common/column_matrix.h"
 #include "../helpers.h"
@@ -8,21 +9,43 @@
 namespace xgboost {
 namespace common {
 
+template <typename BinIdxType>
+void CheckDenseColumn(const GHistIndexMatrix& gmat, const ColumnMatrix& column_matrix,
+                      size_t n_rows, size_t n_cols) {
+  for (auto i = 0ull; i < n_rows; i++) {
+    for (auto j = 0ull; j < n_cols; j++) {
+      auto col = column_matrix.GetColumn<BinIdxType>(j);
+      ASSERT_EQ(gmat.index[i * n_cols + j], col.GetGlobalBinIdx(i));
+    }
+  }
+}
+
 TEST(DenseColumn, Test) {
-  auto dmat = CreateDMatrix(100, 10, 0.0);
-  GHistIndexMatrix gmat;
-  gmat.Init((*dmat).get(), 256);
-  ColumnMatrix column_matrix;
-  column_matrix.Init(gmat, 0.2);
+  uint64_t max_num_bins[] = {static_cast<uint64_t>(std::numeric_limits<uint8_t>::max()) + 1,
+                             static_cast<uint64_t>(std::numeric_limits<uint8_t>::max()) + 2};
+  for (size_t max_num_bin : max_num_bins) {
+    auto dmat = CreateDMatrix(1000, 10, 0.0);
+    GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), max_num_bin);
+    ColumnMatrix column_matrix;
+    column_matrix.Init(gmat, 0.2);
 
-  for (auto i = 0ull; i < (*dmat)->Info().num_row_; i++) {
-    for (auto j = 0ull; j < (*dmat)->Info().num_col_; j++) {
-        auto col = column_matrix.GetColumn(j);
-        ASSERT_EQ(gmat.index[i * (*dmat)->Info().num_col_ + j],
-                  col.GetGlobalBinIdx(i));
+    uint32_t max_feature_bins = 0;
+    for (size_t fid = 0; fid + 1 < gmat.cut.Ptrs().size(); ++fid) {
+      max_feature_bins = std::max(max_feature_bins,
+                                  gmat.cut.Ptrs()[fid + 1] - gmat.cut.Ptrs()[fid]);
     }
+    const size_t n_rows = (*dmat)->Info().num_row_;
+    const size_t n_cols = (*dmat)->Info().num_col_;
+    if (max_feature_bins <= static_cast<uint32_t>(std::numeric_limits<uint8_t>::max()) + 1) {
+      ASSERT_EQ(column_matrix.GetTypeSize(), kUint8BinsTypeSize);
+      CheckDenseColumn<uint8_t>(gmat, column_matrix, n_rows, n_cols);
+    } else {
+      ASSERT_EQ(column_matrix.GetTypeSize(), kUint16BinsTypeSize);
+      CheckDenseColumn<uint16_t>(gmat, column_matrix, n_rows, n_cols);
+    }
+    delete dmat;
   }
-  delete dmat;
 }
 
 TEST(SparseColumn, Test) {
@@ -31,9 +54,11 @@ TEST(SparseColumn, Test) {
   gmat.Init((*dmat).get(), 256);
   ColumnMatrix column_matrix;
   column_matrix.Init(gmat, 0.5);
-  auto col = column_matrix.GetColumn(0);
-  ASSERT_EQ(col.Size(), gmat.index.size());
+  ASSERT_EQ(column_matrix.GetTypeSize(), kUint8BinsTypeSize);
+  auto col = column_matrix.GetColumn<uint8_t>(0);
+  ASSERT_EQ(col.Size(), gmat.index.Size());
   for (auto i = 0ull; i < col.Size(); i++) {
+    ASSERT_FALSE(col.IsMissing(i));
     ASSERT_EQ(gmat.index[gmat.row_ptr[col.GetRowIdx(i)]],
               col.GetGlobalBinIdx(i));
   }
@@ -46,12 +71,16 @@ TEST(DenseColumnWithMissing, Test) {
   gmat.Init((*dmat).get(), 256);
   ColumnMatrix column_matrix;
   column_matrix.Init(gmat, 0.2);
-  auto col = column_matrix.GetColumn(0);
+  ASSERT_EQ(column_matrix.GetTypeSize(), kUint8BinsTypeSize);
+  auto col = column_matrix.GetColumn<uint8_t>(0);
+  size_t n_present = 0;
   for (auto i = 0ull; i < col.Size(); i++) {
     if (col.IsMissing(i)) continue;
+    ++n_present;
     EXPECT_EQ(gmat.index[gmat.row_ptr[col.GetRowIdx(i)]],
               col.GetGlobalBinIdx(i));
   }
+  EXPECT_EQ(n_present, gmat.index.Size());
   delete dmat;
 }
 
@@ -51,5 +51,27 @@ TEST(CompressedIterator, Test) {
   }
 }
 
+TEST(CompressedIterator, Unpack) {
+  std::vector<size_t> test_cases = {1, 3, 255, 256, 426, 65536, 100000, INT32_MAX};
+  size_t num_elements = 1000;
+  srand(9);
+  for (auto alphabet_size : test_cases) {
+    std::vector<uint32_t> input(num_elements);
+    std::generate(input.begin(), input.end(),
+                  [=]() { return static_cast<uint32_t>(rand() % alphabet_size); });
+    CompressedBufferWriter cbw(alphabet_size);
+    std::vector<unsigned char> buffer(
+        CompressedBufferWriter::CalculateBufferSize(input.size(), alphabet_size));
+    cbw.Write(buffer.data(), input.begin(), input.end());
+    // every start, including those whose symbols are read close to the end of the buffer
+    for (size_t begin : {size_t(0), size_t(1), size_t(7), size_t(500), num_elements - 3}) {
+      std::vector<uint32_t> output(num_elements - begin);
+      UnpackSymbols(buffer.data(), buffer.size(), alphabet_size, begin, output.size(),
+                    output.data());
+      ASSERT_TRUE(std::equal(output.cbegin(), output.cend(), input.cbegin() + begin));
+    }
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
@@ -3,6 +3,7 @@
  * Copyright 2017 XGBoost contributors
  */
 #include <thrust/device_vector.h>
+#include <thrust/sequence.h>
 #include <xgboost/base.h>
 #include "../../../src/common/device_helpers.cuh"
 #include "../helpers.h"
@@ -162,3 +163,36 @@ TEST(LowerBound, DataDescending) {
   TestLowerBoundImpl(hvec, 4, comparator);  // Result 7
   TestLowerBoundImpl(hvec, 8, comparator);  // Result 3
 }
+
+TEST(PoolMemoryResource, Reuse) {
+  dh::PoolMemoryResource pool;
+  // Freed blocks are handed out again on the same stream.
+  void* first = pool.Allocate(1000, nullptr);
+  pool.Deallocate(first, 1000, nullptr);
+  void* second = pool.Allocate(900, nullptr);
+  EXPECT_EQ(first, second);
+  void* third = pool.Allocate(1000, nullptr);
+  EXPECT_NE(second, third);
+  pool.Deallocate(second, 900, nullptr);
+  pool.Deallocate(third, 1000, nullptr);
+}
+
+TEST(ManagedMemoryResource, Basic) {
+  dh::ManagedMemoryResource managed;
+  size_t constexpr kSize = 1000;
+  auto* ptr = static_cast<int*>(managed.Allocate(kSize * sizeof(int), nullptr));
+  ASSERT_NE(ptr, nullptr);
+  cudaPointerAttributes attr;
+  dh::safe_cuda(cudaPointerGetAttributes(&attr, ptr));
+#if CUDART_VERSION >= 10000
+  ASSERT_EQ(attr.type, cudaMemoryTypeManaged);
+#endif  // CUDART_VERSION >= 10000
+  // readable on device and host
+  thrust::sequence(thrust::device_ptr<int>(ptr), thrust::device_ptr<int>(ptr) + kSize);
+  dh::safe_cuda(cudaDeviceSynchronize());
+  for (size_t i = 0; i < kSize; ++i) {
+    ASSERT_EQ(ptr[i], static_cast<int>(i));
+  }
+  managed.Deallocate(ptr, kSize * sizeof(int), nullptr);
+  ASSERT_EQ(managed.Allocate(0, nullptr), nullptr);
+}
@@ -12,8 +12,11 @@
 
 #include "../../../src/common/device_helpers.cuh"
 #include "../../../src/common/hist_util.h"
+#include "../../../src/data/device_adapter.cuh"
+#include "../../../src/data/simple_dmatrix.h"
 
 #include "../helpers.h"
+#include "../data/test_array_interface.h"
 
 namespace xgboost {
 namespace common {
@@ -87,5 +90,35 @@ TEST(gpu_hist_util, DeviceSketch_ExternalMemory) {
   TestDeviceSketch(true);
 }
 
+TEST(gpu_hist_util, AdapterDeviceSketch) {
+  int constexpr kRows = 1000, kCols = 10;
+  int constexpr kMaxBin = 16;
+  float constexpr kMissing = 7;
+  thrust::device_vector<float> data(kRows * kCols);
+  auto json_array_interface = Generate2dArrayInterface(kRows, kCols, "<f4", &data);
+  // a few missing values, both NaN and `kMissing'
+  data[1] = std::numeric_limits<float>::quiet_NaN();
+  data[kCols + 2] = std::numeric_limits<float>::quiet_NaN();
+  std::stringstream ss;
+  Json::Dump(json_array_interface, &ss);
+  data::CupyAdapter adapter(ss.str());
+
+  HistogramCuts adapter_cuts;
+  size_t row_stride = AdapterDeviceSketch(&adapter, kMaxBin, kMissing, &adapter_cuts);
+
+  data::SimpleDMatrix dmat(&adapter, kMissing, 1);
+  HistogramCuts dmat_cuts;
+  size_t dmat_row_stride = DeviceSketch(0, kMaxBin, -1, &dmat, &dmat_cuts);
+
+  ASSERT_EQ(row_stride, kCols);
+  ASSERT_EQ(row_stride, dmat_row_stride);
+  ASSERT_EQ(adapter_cuts.Ptrs(), dmat_cuts.Ptrs());
+  ASSERT_EQ(adapter_cuts.MinValues().size(), dmat_cuts.MinValues().size());
+  ASSERT_EQ(adapter_cuts.Values().size(), dmat_cuts.Values().size());
+  for (size_t i = 0; i < adapter_cuts.Values().size(); ++i) {
+    ASSERT_NEAR(adapter_cuts.Values()[i], dmat_cuts.Values()[i], kRows * 1e-2);
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
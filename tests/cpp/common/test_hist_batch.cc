@@ -0,0 +1,69 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <gtest/gtest.h>
+
+#include <future>
+#include <numeric>
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/common/hist_batch.h"
+
+namespace xgboost {
+namespace common {
+TEST(HistBatch, BuildRoot) {
+  size_t constexpr kRows = 1000, kCols = 8, kBoosters = 3;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2);
+  GHistIndexMatrix gmat;
+  gmat.Init((*pp_dmat).get(), 64);
+  size_t const n_bins = gmat.cut.Ptrs().back();
+
+  std::vector<std::vector<GradientPair>> gpairs(kBoosters);
+  std::vector<std::vector<tree::GradStatsT<double>>> hists(kBoosters);
+  for (size_t b = 0; b < kBoosters; ++b) {
+    gpairs[b] = GenerateRandomGradients(kRows).HostVector();
+    hists[b].resize(n_bins);
+  }
+  // the last booster builds its histogram on its own
+  auto batch = std::make_shared<HistBatch>(kBoosters, 2);
+  std::vector<std::future<void>> boosters;
+  for (size_t b = 0; b < kBoosters; ++b) {
+    boosters.emplace_back(std::async(std::launch::async, [&, b]() {
+      bool const own = b + 1 == kBoosters;
+      batch->BuildRoot(gmat, own ? nullptr : &gpairs[b],
+                       own ? GHistRow<double>{} : GHistRow<double>{hists[b].data(), n_bins});
+      batch->Leave();
+    }));
+  }
+  for (auto& booster : boosters) {
+    booster.get();
+  }
+
+  std::vector<size_t> rows(kRows);
+  std::iota(rows.begin(), rows.end(), size_t{0});
+  GHistBuilder<double> builder(1, static_cast<uint32_t>(n_bins));
+  for (size_t b = 0; b < kBoosters; ++b) {
+    std::vector<tree::GradStatsT<double>> expected(n_bins);
+    if (b + 1 != kBoosters) {
+      builder.BuildHist(gpairs[b], RowSetCollection::Elem(rows.data(), rows.data() + kRows, 0),
+                        gmat, GHistRow<double>{expected.data(), n_bins});
+    }
+    for (size_t i = 0; i < n_bins; ++i) {
+      EXPECT_NEAR(hists[b][i].GetGrad(), expected[i].GetGrad(), 1e-6);
+      EXPECT_NEAR(hists[b][i].GetHess(), expected[i].GetHess(), 1e-6);
+    }
+  }
+  delete pp_dmat;
+}
+
+TEST(HistBatch, Registry) {
+  ASSERT_EQ(HistBatch::Find(""), nullptr);
+  auto batch = std::make_shared<HistBatch>(1, 1);
+  auto name = HistBatch::Register(batch);
+  ASSERT_EQ(HistBatch::Find(name), batch);
+  HistBatch::Unregister(name);
+  ASSERT_EQ(HistBatch::Find(name), nullptr);
+}
+}  // namespace common
+}  // namespace xgboost
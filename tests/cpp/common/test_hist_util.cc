@@ -1,9 +1,16 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <vector>
 #include <string>
 #include <utility>
 
 #include "../../../src/common/hist_util.h"
+#include "../../../src/common/column_matrix.h"
+#include "../../../src/common/io.h"
+#include "../../../src/tree/param.h"
 #include "../helpers.h"
 #include "test_hist_util.h"
 
@@ -29,16 +36,16 @@ TEST(ParallelGHistBuilder, Reset) {
   constexpr double kValue = 1.0;
   const size_t nthreads = GetNThreads();
 
-  HistCollection collection;
+  HistCollection<double> collection;
   collection.Init(kBins);
 
   for(size_t inode = 0; inode < kNodesExtended; inode++) {
     collection.AddHistRow(inode);
   }
 
-  ParallelGHistBuilder hist_builder;
+  ParallelGHistBuilder<double> hist_builder;
   hist_builder.Init(kBins);
-  std::vector<GHistRow> target_hist(kNodes);
+  std::vector<GHistRow<double>> target_hist(kNodes);
   for(size_t i = 0; i < target_hist.size(); ++i) {
     target_hist[i] = collection[i];
   }
@@ -49,7 +56,7 @@ TEST(ParallelGHistBuilder, Reset) {
   common::ParallelFor2d(space, nthreads, [&](size_t inode, common::Range1d r) {
     const size_t tid = omp_get_thread_num();
 
-    GHistRow hist = hist_builder.GetInitializedHist(tid, inode);
+    GHistRow<double> hist = hist_builder.GetInitializedHist(tid, inode);
     // fill hist by some non-null values
     for(size_t j = 0; j < kBins; ++j) {
       hist[j].Add(kValue, kValue);
@@ -67,7 +74,7 @@ TEST(ParallelGHistBuilder, Reset) {
   common::ParallelFor2d(space2, nthreads, [&](size_t inode, common::Range1d r) {
     const size_t tid = omp_get_thread_num();
 
-    GHistRow hist = hist_builder.GetInitializedHist(tid, inode);
+    GHistRow<double> hist = hist_builder.GetInitializedHist(tid, inode);
     // fill hist by some non-null values
     for(size_t j = 0; j < kBins; ++j) {
       ASSERT_EQ(0.0, hist[j].GetGrad());
@@ -83,16 +90,16 @@ TEST(ParallelGHistBuilder, ReduceHist) {
   constexpr double kValue = 1.0;
   const size_t nthreads = GetNThreads();
 
-  HistCollection collection;
+  HistCollection<double> collection;
   collection.Init(kBins);
 
   for(size_t inode = 0; inode < kNodes; inode++) {
     collection.AddHistRow(inode);
   }
 
-  ParallelGHistBuilder hist_builder;
+  ParallelGHistBuilder<double> hist_builder;
   hist_builder.Init(kBins);
-  std::vector<GHistRow> target_hist(kNodes);
+  std::vector<GHistRow<double>> target_hist(kNodes);
   for(size_t i = 0; i < target_hist.size(); ++i) {
     target_hist[i] = collection[i];
   }
@@ -104,7 +111,7 @@ TEST(ParallelGHistBuilder, ReduceHist) {
   common::ParallelFor2d(space, nthreads, [&](size_t inode, common::Range1d r) {
     const size_t tid = omp_get_thread_num();
 
-    GHistRow hist = hist_builder.GetInitializedHist(tid, inode);
+    GHistRow<double> hist = hist_builder.GetInitializedHist(tid, inode);
     for(size_t i = 0; i < kBins; ++i) {
       hist[i].Add(kValue, kValue);
     }
@@ -123,6 +130,81 @@ TEST(ParallelGHistBuilder, ReduceHist) {
 }
 
 
+TEST(ParallelGHistBuilder, ReduceHistInGroups) {
+  constexpr size_t kBins = 2500;  // several blocks of bins
+  constexpr size_t kNodes = 3;
+  constexpr size_t kTasksPerNode = 8;
+  constexpr size_t kThreads = 6;
+
+  HistCollection<double> collection;
+  collection.Init(kBins);
+  for (size_t inode = 0; inode < kNodes; inode++) {
+    collection.AddHistRow(inode);
+  }
+  std::vector<GHistRow<double>> target_hist(kNodes);
+  for (size_t inode = 0; inode < kNodes; inode++) {
+    target_hist[inode] = collection[inode];
+  }
+
+  ParallelGHistBuilder<double> hist_builder;
+  hist_builder.Init(kBins);
+  hist_builder.SetThreadGroups({0, 0, 0, 1, 1, 1});
+  ASSERT_EQ(hist_builder.GetNumThreadGroups(), 2);
+  common::BlockedSpace2d space(kNodes, [&](size_t node) { return kTasksPerNode; }, 1);
+  hist_builder.Reset(kThreads, kNodes, space, target_hist);
+
+  common::ParallelFor2d(space, kThreads, [&](size_t inode, common::Range1d r) {
+    const size_t tid = omp_get_thread_num();
+    GHistRow<double> hist = hist_builder.GetInitializedHist(tid, inode);
+    for (size_t i = 0; i < kBins; ++i) {
+      hist[i].Add(inode + 1.0, 1.0);
+    }
+  });
+
+  hist_builder.ReduceHistInGroups();
+  for (size_t inode = 0; inode < kNodes; inode++) {
+    hist_builder.ReduceHist(inode, 0, kBins);
+    for (size_t i = 0; i < kBins; ++i) {
+      ASSERT_EQ((inode + 1.0) * kTasksPerNode, collection[inode][i].GetGrad());
+      ASSERT_EQ(1.0 * kTasksPerNode, collection[inode][i].GetHess());
+    }
+  }
+}
+
+
+TEST(HistCollection, Recycle) {
+  constexpr uint32_t kBins = 16;
+  HistCollection<double> collection;
+  collection.Init(kBins);
+  for (bst_uint nid : {0, 1, 2}) {
+    collection.AddHistRow(nid);
+  }
+  auto* freed = collection[1].data();
+  collection.FreeHistRow(1);
+  ASSERT_FALSE(collection.RowExists(1));
+  collection.AddHistRow(3);
+  ASSERT_EQ(collection[3].data(), freed);
+  ASSERT_EQ(collection.NumRows(), 3);
+
+  // no limit, nothing is evicted
+  ASSERT_TRUE(collection.Evict(1, {}).empty());
+
+  // room for two histograms, one of them is requested, node 2 must be kept
+  collection.SetMaxBytes(2 * kBins * sizeof(tree::GradStats));
+  auto evicted = collection.Evict(1, {2});
+  ASSERT_EQ(evicted, std::vector<bst_uint>({0, 3}));
+  ASSERT_TRUE(collection.RowExists(2));
+  ASSERT_EQ(collection.NumRows(), 1);
+  collection.AddHistRow(4);
+  ASSERT_TRUE(collection.RowExists(4));
+
+  // memory is reused by the next tree
+  collection.Init(kBins);
+  ASSERT_EQ(collection.NumRows(), 0);
+  collection.AddHistRow(0);
+  ASSERT_EQ(collection[0].size(), kBins);
+}
+
 TEST(CutsBuilder, SearchGroupInd) {
   size_t constexpr kNumGroups = 4;
   size_t constexpr kRows = 17;
@@ -284,6 +366,29 @@ TEST(hist_util, DenseCutsExternalMemory) {
   }
 }
 
+TEST(hist_util, DenseCutsRowBlocks) {
+  EXPECT_EQ(DenseCuts::RowBlocks(16, 100, 1 << 20), 4);
+  EXPECT_EQ(DenseCuts::RowBlocks(16, 2, 1 << 20), 8);
+  EXPECT_EQ(DenseCuts::RowBlocks(16, 2, 100), 1);
+  EXPECT_EQ(DenseCuts::RowBlocks(1, 100, 1 << 20), 1);
+
+  int32_t ori_nthreads = omp_get_max_threads();
+  omp_set_num_threads(8);
+  int bin_sizes[] = {2, 16, 256};
+  int num_rows = 10000;
+  int num_columns = 3;
+  auto x = GenerateRandom(num_rows, num_columns);
+  auto dmat = GetDMatrixFromData(x, num_rows, num_columns);
+  ASSERT_GT(DenseCuts::RowBlocks(omp_get_max_threads(), num_columns, num_rows), 1);
+  for (auto num_bins : bin_sizes) {
+    HistogramCuts cuts;
+    DenseCuts dense(&cuts);
+    dense.Build(dmat.get(), num_bins);
+    ValidateCuts(cuts, x, num_rows, num_columns, num_bins);
+  }
+  omp_set_num_threads(ori_nthreads);
+}
+
 TEST(hist_util, SparseCutsAccuracyTest) {
   int bin_sizes[] = {2, 16, 256, 512};
   int sizes[] = {100, 1000, 1500};
@@ -300,6 +405,73 @@ TEST(hist_util, SparseCutsAccuracyTest) {
   }
 }
 
+TEST(hist_util, CompactSketchCuts) {
+  int bin_sizes[] = {2, 16, 256, 512};
+  int sizes[] = {100, 1000, 10000};
+  int num_columns = 5;
+  SetSketchMethod(SketchMethod::kCompact);
+  for (auto num_rows : sizes) {
+    auto x = GenerateRandom(num_rows, num_columns);
+    auto dmat = GetDMatrixFromData(x, num_rows, num_columns);
+    for (auto num_bins : bin_sizes) {
+      HistogramCuts dense_cuts;
+      DenseCuts dense(&dense_cuts);
+      dense.Build(dmat.get(), num_bins);
+      ValidateCuts(dense_cuts, x, num_rows, num_columns, num_bins);
+
+      HistogramCuts sparse_cuts;
+      SparseCuts sparse(&sparse_cuts);
+      sparse.Build(dmat.get(), num_bins);
+      ValidateCuts(sparse_cuts, x, num_rows, num_columns, num_bins);
+    }
+  }
+  SetSketchMethod(SketchMethod::kWQ);
+}
+
+TEST(hist_util, CompactSketch) {
+  constexpr size_t kRows = 100000;
+  constexpr double kEps = 1.0 / 512;
+  auto x = GenerateRandom(kRows, 1);
+  WCompactSketch<bst_float, bst_float> sketch;
+  sketch.Init(kRows, kEps);
+  double total {0};
+  for (size_t i = 0; i < kRows; ++i) {
+    float w = 1.0f + i % 3;
+    sketch.Push(x[i], w);
+    total += w;
+  }
+  // far fewer items than the data, bounded by the capacity of the compactors
+  ASSERT_LT(sketch.Size(), static_cast<size_t>(8 / kEps));
+
+  WCompactSketch<bst_float, bst_float>::SummaryContainer summary;
+  sketch.GetSummary(&summary);
+  ASSERT_GT(summary.size, 0);
+  EXPECT_NEAR(summary.data[summary.size - 1].rmax, total, total * 1e-6);
+  EXPECT_TRUE(std::is_sorted(summary.data, summary.data + summary.size,
+                             [](WQSummary<bst_float, bst_float>::Entry const& l,
+                                WQSummary<bst_float, bst_float>::Entry const& r) {
+                               return l.value < r.value;
+                             }));
+
+  // weighted rank of the summary entries against the data
+  std::vector<std::pair<float, float>> sorted(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    sorted[i] = {x[i], 1.0f + i % 3};
+  }
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<double> prefix(kRows + 1, 0.0);
+  for (size_t i = 0; i < kRows; ++i) {
+    prefix[i + 1] = prefix[i] + sorted[i].second;
+  }
+  for (size_t i = 0; i < summary.size; ++i) {
+    auto const& e = summary.data[i];
+    auto it = std::lower_bound(sorted.begin(), sorted.end(),
+                               std::make_pair(e.value, -1.0f));
+    double rank = prefix[it - sorted.begin()];
+    ASSERT_NEAR(e.rmin, rank, total * 0.02);
+  }
+}
+
 TEST(hist_util, SparseCutsCategorical) {
   int categorical_sizes[] = {2, 6, 8, 12};
   int num_bins = 256;
@@ -339,5 +511,352 @@ TEST(hist_util, SparseCutsExternalMemory) {
     }
   }
 }
+
+TEST(hist_util, IndexBinBound) {
+  size_t constexpr kRows = 100;
+  size_t constexpr kCols = 10;
+  // dense data stores feature local bins, sparse data stores global bins
+  for (float sparsity : {0.0f, 0.5f}) {
+    auto dmat = CreateDMatrix(kRows, kCols, sparsity);
+    GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), 256);
+
+    auto const& ptrs = gmat.cut.Ptrs();
+    uint32_t max_bins = ptrs.back();
+    if (gmat.IsDense()) {
+      ASSERT_EQ(gmat.index.OffsetSize(), kCols);
+      max_bins = 0;
+      for (size_t fid = 0; fid < kCols; ++fid) {
+        ASSERT_EQ(gmat.index.Offset()[fid], ptrs[fid]);
+        max_bins = std::max(max_bins, ptrs[fid + 1] - ptrs[fid]);
+      }
+    } else {
+      ASSERT_EQ(gmat.index.Offset(), nullptr);
+    }
+    BinTypeSize expected = max_bins <= 256 ? kUint8BinsTypeSize :
+                           max_bins <= 65536 ? kUint16BinsTypeSize : kUint32BinsTypeSize;
+    ASSERT_EQ(gmat.index.GetBinTypeSize(), expected);
+    ASSERT_EQ(gmat.index.Size(), gmat.row_ptr.back());
+    for (size_t i = 0; i < gmat.index.Size(); ++i) {
+      ASSERT_LT(gmat.index[i], ptrs.back());
+    }
+    delete dmat;
+  }
+  // a wide sparse matrix needs more than one byte for global bins
+  auto dmat = CreateDMatrix(kRows, 100, 0.1);
+  GHistIndexMatrix gmat;
+  gmat.Init((*dmat).get(), 256);
+  ASSERT_FALSE(gmat.IsDense());
+  ASSERT_GT(gmat.cut.Ptrs().back(), 256);
+  ASSERT_EQ(gmat.index.GetBinTypeSize(), kUint16BinsTypeSize);
+  delete dmat;
+}
+
+TEST(hist_util, HistISA) {
+  constexpr size_t kBins = 67;
+  const HistISA origin = GetHistISA();
+  ASSERT_NE(origin, HistISA::kAuto);
+
+  std::vector<tree::GradStats> lhs(kBins), rhs(kBins);
+  for (size_t i = 0; i < kBins; ++i) {
+    lhs[i] = tree::GradStats(0.5 * i, 1.0 + i);
+    rhs[i] = tree::GradStats(-0.25 * i, 2.0 * i);
+  }
+
+  auto run = [&](HistISA isa) {
+    SetHistISA(isa);
+    std::vector<tree::GradStats> result(kBins);
+    GHistRow<double> dst(result.data(), kBins);
+    CopyHist(dst, GHistRow<double>(lhs.data(), kBins), 0, kBins);
+    IncrementHist(dst, GHistRow<double>(rhs.data(), kBins), 1, kBins);
+    SubtractionHist(dst, dst, GHistRow<double>(lhs.data(), kBins), kBins / 2, kBins);
+    return result;
+  };
+
+  SetHistISA(HistISA::kScalar);
+  ASSERT_EQ(GetHistISA(), HistISA::kScalar);
+  auto expected = run(HistISA::kScalar);
+  for (auto isa : {HistISA::kAVX2, HistISA::kAVX512, HistISA::kAuto}) {
+    std::vector<tree::GradStats> result;
+    try {
+      result = run(isa);
+    } catch (dmlc::Error const&) {
+      // not supported by this CPU
+      continue;
+    }
+    for (size_t i = 0; i < kBins; ++i) {
+      ASSERT_EQ(result[i].GetGrad(), expected[i].GetGrad());
+      ASSERT_EQ(result[i].GetHess(), expected[i].GetHess());
+    }
+  }
+  SetHistISA(origin);
+}
+
+TEST(hist_util, FeatureBlockedBuildHist) {
+  size_t constexpr kRows = 300;
+  size_t constexpr kCols = 16;
+  auto dmat = CreateDMatrix(kRows, kCols, 0);
+  GHistIndexMatrix gmat;
+  gmat.Init((*dmat).get(), 64);
+  ASSERT_TRUE(gmat.IsDense());
+  const uint32_t nbins = gmat.cut.Ptrs().back();
+
+  std::vector<GradientPair> gpair(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    gpair[i] = GradientPair(0.1f * (i % 7) - 0.3f, 0.05f * (i % 5) + 0.1f);
+  }
+  std::vector<size_t> row_indices(kRows);
+  std::iota(row_indices.begin(), row_indices.end(), 0);
+  RowSetCollection::Elem rows(row_indices.data(), row_indices.data() + kRows, 0);
+
+  GHistBuilder<double> builder(1, nbins);
+  std::vector<tree::GradStats> expected(nbins);
+  builder.BuildHist(gpair, rows, gmat, GHistRow<double>(expected.data(), nbins));
+
+  // small histograms are not split
+  builder.InitFeatureBlocks(gmat);
+  ASSERT_EQ(builder.GetNumFeatureBlocks(), 1);
+
+  // about three features per block
+  const size_t block_bytes = 3 * (nbins / kCols) * sizeof(tree::GradStats);
+  builder.InitFeatureBlocks(gmat, block_bytes);
+  ASSERT_GT(builder.GetNumFeatureBlocks(), 1);
+  std::vector<tree::GradStats> result(nbins);
+  for (size_t i = 0; i < builder.GetNumFeatureBlocks(); ++i) {
+    builder.BuildHist(gpair, rows, gmat, GHistRow<double>(result.data(), nbins), i);
+  }
+  for (size_t i = 0; i < nbins; ++i) {
+    ASSERT_EQ(result[i].GetGrad(), expected[i].GetGrad());
+    ASSERT_EQ(result[i].GetHess(), expected[i].GetHess());
+  }
+
+  // sparse matrices are never split
+  auto sparse = CreateDMatrix(kRows, kCols, 0.5);
+  GHistIndexMatrix sparse_gmat;
+  sparse_gmat.Init((*sparse).get(), 64);
+  builder.InitFeatureBlocks(sparse_gmat, block_bytes);
+  ASSERT_EQ(builder.GetNumFeatureBlocks(), 1);
+
+  delete sparse;
+  delete dmat;
+}
+
+TEST(hist_util, GradientSoABuildHist) {
+  size_t constexpr kRows = 300;
+  size_t constexpr kCols = 16;
+  for (float sparsity : {0.0f, 0.5f}) {
+    auto dmat = CreateDMatrix(kRows, kCols, sparsity);
+    GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), 64);
+    const uint32_t nbins = gmat.cut.Ptrs().back();
+
+    // every other row, so gradients are gathered
+    std::vector<size_t> row_indices;
+    for (size_t i = 0; i < kRows; i += 2) {
+      row_indices.push_back(i);
+    }
+    RowSetCollection::Elem rows(row_indices.data(),
+                                row_indices.data() + row_indices.size(), 0);
+    GHistBuilder<double> builder(1, nbins);
+
+    for (bool constant_hess : {true, false}) {
+      std::vector<GradientPair> gpair(kRows);
+      for (size_t i = 0; i < kRows; ++i) {
+        float hess = constant_hess ? 1.0f : 0.05f * (i % 5) + 0.1f;
+        gpair[i] = GradientPair(0.1f * (i % 7) - 0.3f, hess);
+      }
+      GradientSoA soa;
+      soa.Init(gpair, 2);
+      ASSERT_EQ(soa.ConstantHess(), constant_hess);
+      ASSERT_EQ(soa.Hess() == nullptr, constant_hess);
+      for (size_t i = 0; i < kRows; ++i) {
+        ASSERT_EQ(soa[i].GetGrad(), gpair[i].GetGrad());
+        ASSERT_EQ(soa[i].GetHess(), gpair[i].GetHess());
+      }
+
+      std::vector<tree::GradStats> expected(nbins);
+      builder.BuildHist(gpair, rows, gmat, GHistRow<double>(expected.data(), nbins));
+      std::vector<tree::GradStats> result(nbins);
+      builder.BuildHist(soa, rows, gmat, GHistRow<double>(result.data(), nbins), 0);
+      for (size_t i = 0; i < nbins; ++i) {
+        ASSERT_EQ(result[i].GetGrad(), expected[i].GetGrad());
+        ASSERT_EQ(result[i].GetHess(), expected[i].GetHess());
+      }
+    }
+    delete dmat;
+  }
+}
+
+TEST(hist_util, FeatureSampledBuildHist) {
+  size_t constexpr kRows = 300;
+  size_t constexpr kCols = 16;
+  auto dmat = CreateDMatrix(kRows, kCols, 0);
+  GHistIndexMatrix gmat;
+  gmat.Init((*dmat).get(), 64);
+  auto const& ptrs = gmat.cut.Ptrs();
+  const uint32_t nbins = ptrs.back();
+
+  std::vector<GradientPair> gpair(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    gpair[i] = GradientPair(0.1f * (i % 7) - 0.3f, 0.05f * (i % 5) + 0.1f);
+  }
+  std::vector<size_t> row_indices(kRows);
+  std::iota(row_indices.begin(), row_indices.end(), 0);
+  RowSetCollection::Elem rows(row_indices.data(), row_indices.data() + kRows, 0);
+
+  GHistBuilder<double> builder(1, nbins);
+  std::vector<tree::GradStats> expected(nbins);
+  builder.BuildHist(gpair, rows, gmat, GHistRow<double>(expected.data(), nbins));
+
+  std::vector<bst_feature_t> features{1, 4, 5, 11};
+  builder.SetFeatureSet(features);
+  const size_t block_bytes = 3 * (nbins / kCols) * sizeof(tree::GradStats);
+  for (size_t n_block_bytes : {static_cast<size_t>(0), block_bytes}) {
+    if (n_block_bytes == 0) {
+      builder.InitFeatureBlocks(gmat);
+    } else {
+      builder.InitFeatureBlocks(gmat, n_block_bytes);
+    }
+    std::vector<tree::GradStats> result(nbins);
+    for (size_t i = 0; i < builder.GetNumFeatureBlocks(); ++i) {
+      builder.BuildHist(gpair, rows, gmat, GHistRow<double>(result.data(), nbins), i);
+    }
+    for (bst_feature_t fid = 0; fid < kCols; ++fid) {
+      bool sampled = std::binary_search(features.cbegin(), features.cend(), fid);
+      for (uint32_t i = ptrs[fid]; i < ptrs[fid + 1]; ++i) {
+        ASSERT_EQ(result[i].GetGrad(), sampled ? expected[i].GetGrad() : 0.0);
+        ASSERT_EQ(result[i].GetHess(), sampled ? expected[i].GetHess() : 0.0);
+      }
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(hist_util, GHistIndexPages) {
+  constexpr size_t kRows = 128, kCols = 8;
+  constexpr size_t kPageRows = 48;
+  for (float sparsity : {0.0f, 0.4f}) {
+    auto dmat = CreateDMatrix(kRows, kCols, sparsity);
+    GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), 16);
+    const SparsePage& batch = *(*dmat)->GetBatches<SparsePage>().begin();
+    const bool is_dense = (*dmat)->IsDense();
+
+    std::vector<GradientPair> gpair(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      gpair[i] = GradientPair(static_cast<float>(i % 7) - 3.0f, 1.0f + (i % 3));
+    }
+    std::vector<size_t> rows(kRows);
+    std::iota(rows.begin(), rows.end(), 0);
+    const uint32_t nbins = gmat.cut.Ptrs().back();
+
+    GHistBuilder<double> builder(1, nbins);
+    std::vector<tree::GradStats> expected(nbins);
+    builder.BuildHist(gpair, {rows.data(), rows.data() + kRows}, gmat,
+                      GHistRow<double>(expected.data(), nbins));
+
+    // quantize the matrix page by page with the cuts of the whole matrix
+    std::vector<tree::GradStats> result(nbins);
+    auto const& offset = batch.offset.HostVector();
+    auto const& data = batch.data.HostVector();
+    for (size_t begin = 0; begin < kRows; begin += kPageRows) {
+      const size_t end = std::min(begin + kPageRows, kRows);
+      SparsePage part;
+      part.SetBaseRowId(begin);
+      auto& part_offset = part.offset.HostVector();
+      auto& part_data = part.data.HostVector();
+      part_offset.clear();
+      part_offset.push_back(0);
+      for (size_t i = begin; i < end; ++i) {
+        part_data.insert(part_data.end(), data.begin() + offset[i],
+                         data.begin() + offset[i + 1]);
+        part_offset.push_back(part_data.size());
+      }
+      GHistIndexMatrix page;
+      page.Init(part, gmat.cut, is_dense);
+      ASSERT_EQ(page.base_rowid, begin);
+      ASSERT_EQ(page.Size(), end - begin);
+
+      // pages survive a round trip through a stream, except for base_rowid which
+      // the reader of external memory assigns
+      std::string buffer;
+      {
+        MemoryBufferStream fo(&buffer);
+        page.Save(&fo);
+      }
+      GHistIndexMatrix loaded;
+      {
+        MemoryBufferStream fi(&buffer);
+        ASSERT_TRUE(loaded.Load(&fi));
+        ASSERT_FALSE(loaded.Load(&fi));
+      }
+      loaded.SetBaseRowId(begin);
+      ASSERT_EQ(loaded.row_ptr, page.row_ptr);
+      ASSERT_EQ(loaded.IsDense(), page.IsDense());
+      ASSERT_EQ(loaded.index.GetBinTypeSize(), page.index.GetBinTypeSize());
+      ASSERT_EQ(loaded.cut.Values(), gmat.cut.Values());
+
+      builder.BuildHist(gpair, {rows.data() + begin, rows.data() + end}, loaded,
+                        GHistRow<double>(result.data(), nbins));
+    }
+    for (size_t i = 0; i < nbins; ++i) {
+      ASSERT_NEAR(result[i].GetGrad(), expected[i].GetGrad(), 1e-6);
+      ASSERT_NEAR(result[i].GetHess(), expected[i].GetHess(), 1e-6);
+    }
+    delete dmat;
+  }
+}
+
+TEST(hist_util, FeatureBundles) {
+  // a dense feature followed by a one-hot encoded feature with 6 categories
+  constexpr size_t kRows = 120, kCategories = 6;
+  std::vector<float> data;
+  std::vector<unsigned> feature_idx;
+  std::vector<size_t> row_ptr {0};
+  for (size_t i = 0; i < kRows; ++i) {
+    data.push_back(static_cast<float>(i % 17));
+    feature_idx.push_back(0);
+    data.push_back(1.0f);
+    feature_idx.push_back(1 + (i * 7) % kCategories);
+    row_ptr.push_back(data.size());
+  }
+  data::CSRAdapter adapter(row_ptr.data(), feature_idx.data(), data.data(), kRows,
+                           data.size(), 1 + kCategories);
+  std::unique_ptr<DMatrix> dmat(
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1));
+
+  GHistIndexMatrix gmat;
+  gmat.Init(dmat.get(), 16);
+  tree::TrainParam param;
+  param.UpdateAllowUnknown(Args{});
+  ColumnMatrix colmat;
+  colmat.Init(gmat, param.sparse_threshold);
+
+  GHistIndexMatrix bundled;
+  std::vector<uint32_t> feature_offset;
+  bundled.InitBundles(gmat, colmat, param, &feature_offset);
+  const std::vector<uint32_t>& ptrs = gmat.cut.Ptrs();
+  const size_t n_bundles = bundled.cut.Ptrs().size() - 1;
+  ASSERT_TRUE(bundled.IsDense());
+  ASSERT_EQ(n_bundles, 2);
+  ASSERT_EQ(bundled.index.GetBinTypeSize(), kUint8BinsTypeSize);
+  // one bin for rows without a value in each bundle
+  ASSERT_EQ(bundled.cut.Ptrs().back(), ptrs.back() + n_bundles);
+
+  for (size_t rid = 0; rid < kRows; ++rid) {
+    std::vector<uint32_t> expected;
+    for (size_t j = gmat.row_ptr[rid]; j < gmat.row_ptr[rid + 1]; ++j) {
+      const uint32_t bin = gmat.index[j];
+      const auto fid = std::upper_bound(ptrs.cbegin(), ptrs.cend(), bin) - ptrs.cbegin() - 1;
+      expected.push_back(feature_offset[fid] + bin - ptrs[fid]);
+    }
+    std::vector<uint32_t> result;
+    for (size_t j = bundled.row_ptr[rid]; j < bundled.row_ptr[rid + 1]; ++j) {
+      result.push_back(bundled.index[j]);
+    }
+    ASSERT_EQ(result, expected);
+  }
+}
 }  // namespace common
 }  // namespace xgboost
@@ -167,6 +167,40 @@ TEST(HostDeviceVector, Span) {
   ASSERT_EQ(vec.ConstDevicePointer(), const_span.data());
 }
 
+TEST(HostDeviceVector, CopyRangeToHost) {
+  size_t n = 1001;
+  int device = 0;
+  HostDeviceVectorSetDeviceHandler hdvec_dev_hndlr(SetDevice);
+  HostDeviceVector<int> v;
+  InitHostDeviceVector(n, device, &v);
+  PlusOne(&v);
+  ASSERT_EQ(v.DeviceAccess(), GPUAccess::kWrite);
+
+  ResetHostDeviceTransfers();
+  std::vector<int> out(10);
+  v.CopyRangeToHost(500, out.size(), out.data());
+  for (size_t i = 0; i < out.size(); ++i) {
+    ASSERT_EQ(out[i], static_cast<int>(500 + i + 1));
+  }
+  // only the range is copied, the device keeps the data
+  ASSERT_EQ(v.DeviceAccess(), GPUAccess::kWrite);
+  auto transfers = GetHostDeviceTransfers();
+  ASSERT_EQ(transfers.device_to_host_bytes, out.size() * sizeof(int));
+  ASSERT_EQ(transfers.n_device_to_host, 1u);
+  ASSERT_EQ(transfers.n_host_to_device, 0u);
+
+  v.ConstHostVector();
+  transfers = GetHostDeviceTransfers();
+  ASSERT_EQ(transfers.device_to_host_bytes, (out.size() + n) * sizeof(int));
+  ASSERT_EQ(transfers.n_device_to_host, 2u);
+  // the host and device can both read, nothing is moved
+  v.ConstDeviceSpan();
+  v.CopyRangeToHost(0, out.size(), out.data());
+  ASSERT_EQ(GetHostDeviceTransfers().n_device_to_host, 2u);
+  ASSERT_EQ(GetHostDeviceTransfers().n_host_to_device, 0u);
+  ASSERT_EQ(out.front(), 1);
+}
+
 TEST(HostDeviceVector, MGPU_Basic) {
   if (AllVisibleGPUs() < 2) {
     LOG(WARNING) << "Not testing in multi-gpu environment.";
@@ -1,7 +1,13 @@
 /*!
  * Copyright (c) by XGBoost Contributors 2019
  */
+#include <dmlc/filesystem.h>
 #include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
 #include "../../../src/common/io.h"
 
 namespace xgboost {
@@ -39,5 +45,59 @@ TEST(IO, FixedSizeStream) {
     ASSERT_EQ(huge_buffer, out_buffer);
   }
 }
+
+#if DMLC_ENABLE_STD_THREAD && defined(__unix__)
+TEST(IO, AsyncFileReadStream) {
+  dmlc::TemporaryDirectory tempdir;
+  std::string path = tempdir.path + "/blob";
+  std::string content;
+  for (size_t i = 0; i < 100003; ++i) {
+    content.push_back(static_cast<char>(i * 31 % 251));
+  }
+  {
+    std::ofstream fout(path, std::ios::binary);
+    fout.write(content.data(), content.size());
+  }
+  size_t constexpr kBlockSize = 4096;
+  for (bool direct : {false, true}) {
+    std::unique_ptr<AsyncFileReadStream> fi{
+        AsyncFileReadStream::Create(path, 3, direct, kBlockSize)};
+    ASSERT_TRUE(fi);
+    std::string out;
+    // reads crossing block boundaries
+    size_t chunk = 1;
+    while (true) {
+      std::string buf(chunk, '\0');
+      size_t n = fi->Read(&buf[0], chunk);
+      out.append(buf.data(), n);
+      if (n < chunk) {
+        break;
+      }
+      chunk = chunk * 3 + 7;
+    }
+    ASSERT_EQ(out, content);
+    ASSERT_EQ(fi->Tell(), content.size());
+
+    for (size_t pos : {size_t(0), size_t(5000), size_t(70000), size_t(12), size_t(99999)}) {
+      fi->Seek(pos);
+      ASSERT_EQ(fi->Tell(), pos);
+      std::string buf(10, '\0');
+      size_t n = fi->Read(&buf[0], buf.size());
+      ASSERT_EQ(n, std::min(buf.size(), content.size() - pos));
+      ASSERT_EQ(buf.substr(0, n), content.substr(pos, n));
+      // skip forward within the blocks read ahead
+      fi->Seek(pos + 3 * kBlockSize / 2);
+      n = fi->Read(&buf[0], buf.size());
+      size_t expected = pos + 3 * kBlockSize / 2 >= content.size()
+                            ? 0
+                            : std::min(buf.size(), content.size() - pos - 3 * kBlockSize / 2);
+      ASSERT_EQ(n, expected);
+      ASSERT_EQ(buf.substr(0, n), content.substr(std::min(content.size(),
+                                                          pos + 3 * kBlockSize / 2), n));
+    }
+  }
+  ASSERT_EQ(AsyncFileReadStream::Create(tempdir.path + "/missing", 2, false), nullptr);
+}
+#endif  // DMLC_ENABLE_STD_THREAD && defined(__unix__)
 }  // namespace common
 }  // namespace xgboost
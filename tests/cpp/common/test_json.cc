@@ -3,8 +3,11 @@
  */
 #include <gtest/gtest.h>
 #include <dmlc/filesystem.h>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <map>
+#include <random>
 
 #include "xgboost/json.h"
 #include "xgboost/logging.h"
@@ -432,4 +435,140 @@ TEST(Json, Int_vs_Float) {
     ASSERT_EQ(ptr, 2503595760);
   }
 }
+
+TEST(Json, TypedArray) {
+  F32Array f32(3);
+  f32.Set(0, 1.5f);
+  f32.Set(1, -2.0f);
+  f32.Set(2, 3.25f);
+  Json obj{Object()};
+  obj["f32"] = std::move(f32);
+  obj["u8"] = U8Array(std::vector<uint8_t>{0, 255});
+  obj["i32"] = I32Array(std::vector<int32_t>{-1, 2});
+  obj["i64"] = I64Array(std::vector<int64_t>{2503595760});
+  ASSERT_EQ(get<F32Array const>(obj["f32"]).size(), 3);
+  ASSERT_EQ(get<F32Array>(obj["f32"])[1], -2.0f);
+
+  std::string str;
+  Json::Dump(obj, &str);
+  // Written as plain JSON arrays.
+  Json untyped = Json::Load({str.c_str(), str.size()});
+  auto const& u8 = get<Array const>(untyped["u8"]);
+  ASSERT_EQ(get<Integer const>(u8[1]), 255);
+  ASSERT_NEAR(get<Number const>(get<Array const>(untyped["f32"])[2]), 3.25f, kRtEps);
+
+  Json typed = Json::Load({str.c_str(), str.size()}, true);
+  ASSERT_EQ(get<F32Array const>(typed["f32"]), get<F32Array const>(obj["f32"]));
+  ASSERT_EQ(get<I64Array const>(typed["u8"]), (std::vector<int64_t>{0, 255}));
+  ASSERT_EQ(get<I64Array const>(typed["i32"]), (std::vector<int64_t>{-1, 2}));
+  ASSERT_EQ(get<I64Array const>(typed["i64"]), (std::vector<int64_t>{2503595760}));
+
+  for (auto const& j : {untyped, typed}) {
+    std::vector<int32_t> i32;
+    GetNumericArray(j["i32"], &i32);
+    ASSERT_EQ(i32, (std::vector<int32_t>{-1, 2}));
+    std::vector<float> values;
+    GetNumericArray(j["f32"], &values);
+    ASSERT_EQ(values, get<F32Array const>(obj["f32"]));
+  }
+
+  // Arrays not sharing one numeric type are kept as Array.
+  str = R"json({"mixed": [1, 2.5, "str", [3]], "floats": [NaN, 1.0], "empty": []})json";
+  Json mixed = Json::Load({str.c_str(), str.size()}, true);
+  auto const& arr = get<Array const>(mixed["mixed"]);
+  ASSERT_EQ(arr.size(), 4);
+  ASSERT_EQ(get<Integer const>(arr[0]), 1);
+  ASSERT_NEAR(get<Number const>(arr[1]), 2.5f, kRtEps);
+  ASSERT_EQ(get<String const>(arr[2]), "str");
+  ASSERT_EQ(get<I64Array const>(arr[3]), (std::vector<int64_t>{3}));
+  ASSERT_TRUE(std::isnan(get<F32Array const>(mixed["floats"])[0]));
+  ASSERT_TRUE(IsA<Array>(mixed["empty"]));
+}
+
+TEST(Json, UBJSON) {
+  Json obj{Object()};
+  obj["str"] = String("string");
+  obj["number"] = Number(3.1415f);
+  obj["negative"] = Integer(static_cast<Integer::Int>(-7));
+  obj["int16"] = Integer(static_cast<Integer::Int>(1000));
+  obj["int32"] = Integer(static_cast<Integer::Int>(-100000));
+  obj["int64"] = Integer(static_cast<Integer::Int>(2503595760));
+  obj["true"] = Boolean(true);
+  obj["false"] = Boolean(false);
+  obj["null"] = Null();
+  obj["arr"] = Array(std::vector<Json>{Json{Integer(static_cast<Integer::Int>(200))},
+                                       Json{String("")}, Json{Object()}});
+  obj["f32"] = F32Array(std::vector<float>{1.0f, -0.5f});
+  obj["u8"] = U8Array(std::vector<uint8_t>{0, 255});
+  obj["i32"] = I32Array(std::vector<int32_t>{-1, 1 << 20});
+  obj["i64"] = I64Array(std::vector<int64_t>{});
+
+  std::stringstream ss;
+  UBJWriter writer{&ss};
+  writer.Save(obj);
+  std::string str = ss.str();
+  ASSERT_TRUE(IsUBJObject(str.c_str(), str.size()));
+
+  UBJReader reader{StringView{str.c_str(), str.size()}};
+  Json loaded = Json::Load(&reader);
+  ASSERT_EQ(loaded, obj);
+  ASSERT_EQ(get<Integer>(loaded["int64"]), 2503595760);
+  ASSERT_EQ(get<I32Array const>(loaded["i32"]), (std::vector<int32_t>{-1, 1 << 20}));
+  ASSERT_TRUE(IsA<Null>(loaded["null"]));
+
+  std::string text;
+  Json::Dump(obj, &text);
+  ASSERT_FALSE(IsUBJObject(text.c_str(), text.size()));
+
+  // Truncated input is an error instead of reading out of bound.
+  UBJReader truncated{StringView{str.c_str(), str.size() - 4}};
+  ASSERT_ANY_THROW(Json::Load(&truncated));
+}
+
+TEST(Json, RoundTripFloat) {
+  std::mt19937 rng(1);
+  std::vector<float> values{0.1f, -0.0f, 1.0f, std::numeric_limits<float>::max(),
+                            std::numeric_limits<float>::denorm_min(),
+                            std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity()};
+  for (size_t i = 0; i < 4096; ++i) {
+    uint32_t bits = rng();
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    if (!std::isnan(v)) {
+      values.push_back(v);
+    }
+  }
+  Json arr{Array()};
+  for (auto v : values) {
+    get<Array>(arr).emplace_back(Number{v});
+  }
+  Json obj{Object()};
+  obj["numbers"] = arr;
+  obj["typed"] = F32Array(std::vector<float>(values));
+  obj["nan"] = Number{std::numeric_limits<float>::quiet_NaN()};
+
+  std::string str;
+  Json::Dump(obj, &str);
+  ASSERT_NE(str.find(R"("nan":NaN)"), std::string::npos);
+  ASSERT_NE(str.find("Infinity,-Infinity"), std::string::npos);
+  // Streams get the same output as strings.
+  std::stringstream ss;
+  Json::Dump(obj, &ss);
+  ASSERT_EQ(ss.str(), str);
+
+  for (bool typed : {false, true}) {
+    auto loaded = Json::Load(StringView{str.c_str(), str.size()}, typed);
+    std::vector<float> numbers, typed_numbers;
+    GetNumericArray(loaded["numbers"], &numbers);
+    GetNumericArray(loaded["typed"], &typed_numbers);
+    ASSERT_EQ(numbers.size(), values.size());
+    ASSERT_EQ(typed_numbers.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      ASSERT_EQ(std::memcmp(&numbers[i], &values[i], sizeof(float)), 0) << i;
+      ASSERT_EQ(std::memcmp(&typed_numbers[i], &values[i], sizeof(float)), 0) << i;
+    }
+    ASSERT_TRUE(std::isnan(get<Number const>(loaded["nan"])));
+  }
+}
 }  // namespace xgboost
@@ -0,0 +1,62 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/json.h>
+
+#include <utility>
+
+#include "../../../src/common/memory_tracker.h"
+#include "../../../src/common/hist_util.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+int64_t Current(char const* component) {
+  auto stats = HostMemoryTracker::Stats();
+  return get<Integer const>(stats[component]["current"]);
+}
+int64_t Peak(char const* component) {
+  auto stats = HostMemoryTracker::Stats();
+  return get<Integer const>(stats[component]["peak"]);
+}
+}  // anonymous namespace
+
+TEST(HostMemoryTracker, TrackedBytes) {
+  char const* kComponent = "test-tracked-bytes";
+  {
+    TrackedBytes first {kComponent};
+    first.Set(100);
+    ASSERT_EQ(Current(kComponent), 100);
+    {
+      // a copy holds its own buffer
+      TrackedBytes second {first};
+      ASSERT_EQ(Current(kComponent), 200);
+      TrackedBytes third {std::move(second)};
+      ASSERT_EQ(Current(kComponent), 200);
+      third.Set(50);
+      ASSERT_EQ(Current(kComponent), 150);
+    }
+    ASSERT_EQ(Current(kComponent), 100);
+    first.Set(10);
+    ASSERT_EQ(Current(kComponent), 10);
+  }
+  ASSERT_EQ(Current(kComponent), 0);
+  ASSERT_EQ(Peak(kComponent), 200);
+}
+
+TEST(HostMemoryTracker, GHistIndexMatrix) {
+  auto dmat = CreateDMatrix(64, 8, 0);
+  auto before = Current("GHistIndexMatrix");
+  {
+    GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), 16);
+    ASSERT_EQ(Current("GHistIndexMatrix") - before,
+              static_cast<int64_t>(gmat.MemCostBytes()));
+  }
+  ASSERT_EQ(Current("GHistIndexMatrix"), before);
+  delete dmat;
+}
+}  // namespace common
+}  // namespace xgboost
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <xgboost/logging.h>
+#include <xgboost/json.h>
 #include <string>
 #include "../../../src/common/timer.h"
 
@@ -12,6 +13,7 @@ TEST(Monitor, Logging) {
         monitor_.Init("Monitor test");
         monitor_.Start("basic");
         monitor_.Stop("basic");
+        monitor_.SetCounter("basic bytes", 42);
       };
 
   Args args = {std::make_pair("verbosity", "3")};
@@ -22,6 +24,7 @@ TEST(Monitor, Logging) {
   run_monitor();
   std::string output = testing::internal::GetCapturedStderr();
   ASSERT_NE(output.find("Monitor"), std::string::npos);
+  ASSERT_NE(output.find("basic bytes: 42"), std::string::npos);
 
   // Monitor only prints messages when set to DEBUG.
   args = {std::make_pair("verbosity", "2")};
@@ -31,5 +34,71 @@ TEST(Monitor, Logging) {
   output = testing::internal::GetCapturedStderr();
   ASSERT_EQ(output.size(), 0);
 }
+
+TEST(Monitor, Profile) {
+  Args args = {std::make_pair("verbosity", "1")};
+  ConsoleLogger::Configure(args);
+  std::string str;
+  {
+    Monitor first, second;
+    first.Init("profile");
+    second.Init("profile");
+    // Nothing is recorded without profiling.
+    first.Start("basic");
+    first.Stop("basic");
+    Monitor::Profile(false, &str);
+    auto j_profile = Json::Load({str.c_str(), str.size()});
+    ASSERT_EQ(get<Array const>(j_profile).size(), 1);
+    ASSERT_EQ(get<Object const>(j_profile[0]).count("profile"), 0);
+
+    Monitor::SetProfiling(true);
+    for (auto* monitor : {&first, &second}) {
+      monitor->Start("basic");
+      monitor->Stop("basic");
+    }
+    first.SetCounter("bytes", 40);
+    second.SetCounter("bytes", 2);
+    Monitor::Profile(false, &str);
+    j_profile = Json::Load({str.c_str(), str.size()});
+    auto const& j_monitor = j_profile[0]["profile"];
+    ASSERT_EQ(get<Integer const>(j_monitor["timers"]["basic"]["count"]), 2);
+    ASSERT_GE(get<Integer const>(j_monitor["timers"]["basic"]["elapsed"]), 0);
+    ASSERT_EQ(get<Integer const>(j_monitor["counters"]["bytes"]), 42);
+  }
+  // Destroyed monitors are gone.
+  Monitor::Profile(false, &str);
+  auto j_profile = Json::Load({str.c_str(), str.size()});
+  ASSERT_EQ(get<Object const>(j_profile[0]).count("profile"), 0);
+  Monitor::SetProfiling(false);
+}
+
+TEST(Monitor, PerfCounters) {
+  std::string str;
+  Monitor::SetProfiling(true);
+  {
+    Monitor monitor;
+    monitor.Init("perf counters");
+    monitor.EnablePerfCounters();
+    monitor.Start("sum");
+    double sum = 0;
+    for (size_t i = 0; i < 1 << 20; ++i) {
+      sum += static_cast<double>(i);
+    }
+    monitor.Stop("sum");
+    ASSERT_GT(sum, 0);
+    Monitor::Profile(false, &str);
+  }
+  Monitor::SetProfiling(false);
+  auto j_profile = Json::Load({str.c_str(), str.size()});
+  auto const& counters = get<Object const>(j_profile[0]["perf counters"]["counters"]);
+  PerfSample sample;
+  if (ReadPerfCounters(&sample)) {
+    ASSERT_GT(get<Integer const>(counters.at("sum cycles")), 0);
+    ASSERT_GT(get<Integer const>(counters.at("sum instructions")), 0);
+    ASSERT_EQ(counters.count("sum memory bytes (est.)"), 1);
+  } else {
+    ASSERT_EQ(counters.size(), 0);
+  }
+}
 }  // namespace common
 }  // namespace xgboost
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <xgboost/json.h>
+#include <string>
+#include "../../../src/common/device_helpers.cuh"
+#include "../../../src/common/timer.h"
+
+namespace xgboost {
+namespace common {
+TEST(Monitor, CudaEvents) {
+  std::string str;
+  Monitor::SetProfiling(true);
+  {
+    Monitor monitor;
+    monitor.Init("cuda events", NvtxCategory::kOther);
+    dh::device_vector<float> data(1 << 16);
+    for (size_t i = 0; i < 3; ++i) {
+      monitor.StartCuda("fill");
+      thrust::fill(data.begin(), data.end(), static_cast<float>(i));
+      monitor.StopCuda("fill");
+    }
+    // A copy doesn't take the events of the original.
+    Monitor copy {monitor};
+    copy.Init("cuda events copy");
+
+    Monitor::Profile(false, &str);
+    auto j_profile = Json::Load({str.c_str(), str.size()});
+    auto const& timers = j_profile[0]["cuda events"]["timers"];
+    ASSERT_EQ(get<Integer const>(timers["fill"]["count"]), 3);
+    ASSERT_EQ(get<Integer const>(timers["fill (device)"]["count"]), 3);
+    ASSERT_GE(get<Integer const>(timers["fill (device)"]["elapsed"]), 0);
+    auto const& copy_timers = get<Object const>(j_profile[0]["cuda events copy"]["timers"]);
+    ASSERT_EQ(copy_timers.count("fill (device)"), 0);
+  }
+  Monitor::SetProfiling(false);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -1,76 +1,119 @@
-#include <gtest/gtest.h>
-#include <vector>
-#include <string>
-#include <utility>
-
-#include "../../../src/common/row_set.h"
-#include "../helpers.h"
-
-namespace xgboost {
-namespace common {
-
-TEST(PartitionBuilder, BasicTest) {
-  constexpr size_t kBlockSize = 16;
-  constexpr size_t kNodes = 5;
-  constexpr size_t kTasks = 3 + 5 + 10 + 1 + 2;
-
-  std::vector<size_t> tasks = { 3, 5, 10, 1, 2 };
-
-  PartitionBuilder<kBlockSize> builder;
-  builder.Init(kTasks, kNodes, [&](size_t i) {
-    return tasks[i];
-  });
-
-  std::vector<size_t> rows_for_left_node = { 2, 12, 0, 16, 8 };
-
-  for(size_t nid = 0; nid < kNodes; ++nid) {
-    size_t value_left = 0;
-    size_t value_right = 0;
-
-    size_t left_total = tasks[nid] * rows_for_left_node[nid];
-
-    for(size_t j = 0; j < tasks[nid]; ++j) {
-      size_t begin = kBlockSize*j;
-      size_t end = kBlockSize*(j+1);
-
-      auto left  = builder.GetLeftBuffer(nid, begin, end);
-      auto right = builder.GetRightBuffer(nid, begin, end);
-
-      size_t n_left   = rows_for_left_node[nid];
-      size_t n_right = kBlockSize - rows_for_left_node[nid];
-
-      for(size_t i = 0; i < n_left; i++) {
-        left[i] = value_left++;
-      }
-
-      for(size_t i = 0; i < n_right; i++) {
-        right[i] = left_total + value_right++;
-      }
-
-      builder.SetNLeftElems(nid, begin, end, n_left);
-      builder.SetNRightElems(nid, begin, end, n_right);
-    }
-  }
-  builder.CalculateRowOffsets();
-
-  std::vector<size_t> v(*std::max_element(tasks.begin(), tasks.end()) * kBlockSize);
-
-  for(size_t nid = 0; nid < kNodes; ++nid) {
-
-    for(size_t j = 0; j < tasks[nid]; ++j) {
-      builder.MergeToArray(nid, kBlockSize*j, v.data());
-    }
-
-    for(size_t j = 0; j < tasks[nid] * kBlockSize; ++j) {
-      ASSERT_EQ(v[j], j);
-    }
-    size_t n_left  = builder.GetNLeftElems(nid);
-    size_t n_right = builder.GetNRightElems(nid);
-
-    ASSERT_EQ(n_left, rows_for_left_node[nid] * tasks[nid]);
-    ASSERT_EQ(n_right, (kBlockSize - rows_for_left_node[nid]) * tasks[nid]);
-  }
-}
-
-}  // namespace common
-}  // namespace xgboost
+#include <gtest/gtest.h>
+#include <vector>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#include "../../../src/common/row_set.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(PartitionBuilder, BasicTest) {
+  constexpr size_t kBlockSize = 16;
+  constexpr size_t kNodes = 5;
+  constexpr size_t kTasks = 3 + 5 + 10 + 1 + 2;
+
+  std::vector<size_t> tasks = { 3, 5, 10, 1, 2 };
+
+  PartitionBuilder<kBlockSize> builder;
+  builder.Init(kTasks, kNodes, [&](size_t i) {
+    return tasks[i];
+  });
+
+  std::vector<size_t> rows_for_left_node = { 2, 12, 0, 16, 8 };
+
+  // rows of node nid are [0, tasks[nid] * kBlockSize), the first
+  // rows_for_left_node[nid] rows of each block go to the left child
+  std::vector<std::vector<size_t>> rows(kNodes);
+  for(size_t nid = 0; nid < kNodes; ++nid) {
+    rows[nid].resize(tasks[nid] * kBlockSize);
+    std::iota(rows[nid].begin(), rows[nid].end(), 0);
+
+    for(size_t j = 0; j < tasks[nid]; ++j) {
+      size_t begin = kBlockSize*j;
+      size_t end = kBlockSize*(j+1);
+
+      auto decisions = builder.GetDecisionBuffer(nid, begin, end);
+
+      size_t n_left   = rows_for_left_node[nid];
+      size_t n_right = kBlockSize - rows_for_left_node[nid];
+
+      for(size_t i = 0; i < kBlockSize; i++) {
+        decisions[i] = i < n_left;
+      }
+
+      builder.SetNLeftElems(nid, begin, end, n_left);
+      builder.SetNRightElems(nid, begin, end, n_right);
+    }
+  }
+  builder.CalculateRowOffsets();
+
+  std::vector<size_t> v(*std::max_element(tasks.begin(), tasks.end()) * kBlockSize);
+
+  for(size_t nid = 0; nid < kNodes; ++nid) {
+    for(size_t j = 0; j < tasks[nid]; ++j) {
+      const size_t* rid = rows[nid].data() + kBlockSize*j;
+      builder.Scatter(nid, kBlockSize*j,
+                      common::Span<const size_t>(rid, rid + kBlockSize), v.data());
+    }
+
+    size_t n_left  = builder.GetNLeftElems(nid);
+    size_t n_right = builder.GetNRightElems(nid);
+
+    ASSERT_EQ(n_left, rows_for_left_node[nid] * tasks[nid]);
+    ASSERT_EQ(n_right, (kBlockSize - rows_for_left_node[nid]) * tasks[nid]);
+
+    // the partition is stable
+    for(size_t j = 0; j < n_left; ++j) {
+      const size_t block = j / rows_for_left_node[nid];
+      ASSERT_EQ(v[j], block * kBlockSize + j % rows_for_left_node[nid]);
+    }
+    for(size_t j = 0; j < n_right; ++j) {
+      const size_t n_block_right = kBlockSize - rows_for_left_node[nid];
+      const size_t block = j / n_block_right;
+      ASSERT_EQ(v[n_left + j],
+                block * kBlockSize + rows_for_left_node[nid] + j % n_block_right);
+    }
+  }
+}
+
+TEST(RowSetCollection, DoubleBuffer) {
+  constexpr size_t kRows = 8;
+  RowSetCollection row_set;
+  row_set.row_indices_.resize(kRows);
+  std::iota(row_set.row_indices_.begin(), row_set.row_indices_.end(), 0);
+  row_set.Init();
+
+  // children of the root are placed in the second buffer
+  size_t* p_child = row_set.GetChildBuffer(0);
+  ASSERT_NE(p_child, row_set[0].begin);
+  for (size_t i = 0; i < kRows; ++i) {
+    p_child[i] = kRows - 1 - i;
+  }
+  row_set.AddSplit(0, 1, 2, 3, kRows - 3);
+  ASSERT_EQ(row_set[1].begin, p_child);
+  ASSERT_EQ(row_set[1].Size(), 3U);
+  ASSERT_EQ(row_set[2].Size(), kRows - 3);
+  ASSERT_EQ(*row_set[2].begin, kRows - 4);
+
+  // grand children of the root return to the original buffer at the same offsets
+  size_t* p_grand_child = row_set.GetChildBuffer(2);
+  ASSERT_EQ(p_grand_child, row_set.row_indices_.data() + 3);
+  p_grand_child[0] = 0;
+  p_grand_child[1] = 2;
+  p_grand_child[2] = 1;
+  p_grand_child[3] = 3;
+  p_grand_child[4] = 4;
+  row_set.AddSplit(2, 3, 4, 2, 3);
+  ASSERT_EQ(row_set[3].begin, row_set.row_indices_.data() + 3);
+  ASSERT_EQ(row_set[4].begin, row_set.row_indices_.data() + 5);
+  ASSERT_EQ(row_set[4].Size(), 3U);
+  ASSERT_EQ(*row_set[4].begin, 1U);
+  // rows of the sibling are untouched
+  ASSERT_EQ(*row_set[1].begin, kRows - 1);
+}
+
+}  // namespace common
+}  // namespace xgboost
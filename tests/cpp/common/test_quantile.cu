@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../../../src/common/quantile.cuh"
+
+namespace xgboost {
+namespace common {
+namespace {
+using SketchEntry = DeviceSketchContainer::SketchEntry;
+using Summary = WQSummary<float, float>;
+
+// Two features of `n' unique values each with uniform weights.
+std::vector<SketchEntry> MakeEntries(size_t n, float offset, std::vector<size_t>* ptr) {
+  std::vector<SketchEntry> entries;
+  ptr->assign({0});
+  for (size_t c = 0; c < 2; ++c) {
+    for (size_t i = 0; i < n; ++i) {
+      float const w = c + 1;
+      entries.emplace_back(i * w, (i + 1) * w, w, offset + static_cast<float>(i * (c + 1)));
+    }
+    ptr->push_back(entries.size());
+  }
+  return entries;
+}
+
+void CheckEqual(Summary const& expected, dh::device_vector<SketchEntry> const& entries,
+                dh::device_vector<size_t> const& ptr, size_t c) {
+  std::vector<SketchEntry> h_entries(entries.size());
+  std::vector<size_t> h_ptr(ptr.size());
+  thrust::copy(entries.begin(), entries.end(), h_entries.begin());
+  thrust::copy(ptr.begin(), ptr.end(), h_ptr.begin());
+  ASSERT_EQ(h_ptr[c + 1] - h_ptr[c], expected.size);
+  for (size_t i = 0; i < expected.size; ++i) {
+    auto const& e = h_entries[h_ptr[c] + i];
+    ASSERT_EQ(e.value, expected.data[i].value);
+    ASSERT_FLOAT_EQ(e.rmin, expected.data[i].rmin);
+    ASSERT_FLOAT_EQ(e.rmax, expected.data[i].rmax);
+    ASSERT_FLOAT_EQ(e.wmin, expected.data[i].wmin);
+  }
+}
+}  // anonymous namespace
+
+TEST(GPUQuantile, Prune) {
+  int32_t constexpr kDevice = 0;
+  size_t constexpr kLimit = 16;
+  std::vector<size_t> h_ptr;
+  auto h_entries = MakeEntries(100, 0, &h_ptr);
+  dh::device_vector<SketchEntry> entries(h_entries);
+  dh::device_vector<size_t> ptr(h_ptr);
+
+  dh::device_vector<SketchEntry> out;
+  dh::device_vector<size_t> out_ptr;
+  PruneSummaries(kDevice, dh::ToSpan(entries), dh::ToSpan(ptr), kLimit, &out, &out_ptr);
+  for (size_t c = 0; c < 2; ++c) {
+    Summary src(h_entries.data() + h_ptr[c], h_ptr[c + 1] - h_ptr[c]);
+    std::vector<SketchEntry> space(kLimit);
+    Summary expected(space.data(), 0);
+    expected.SetPrune(src, kLimit);
+    CheckEqual(expected, out, out_ptr, c);
+  }
+}
+
+TEST(GPUQuantile, Merge) {
+  int32_t constexpr kDevice = 0;
+  std::vector<size_t> h_a_ptr, h_b_ptr;
+  // overlapping values, some of them shared by both summaries
+  auto h_a = MakeEntries(40, 0, &h_a_ptr);
+  auto h_b = MakeEntries(50, 10, &h_b_ptr);
+  dh::device_vector<SketchEntry> a(h_a), b(h_b);
+  dh::device_vector<size_t> a_ptr(h_a_ptr), b_ptr(h_b_ptr);
+
+  dh::device_vector<SketchEntry> out;
+  dh::device_vector<size_t> out_ptr;
+  MergeSummaries(kDevice, dh::ToSpan(a), dh::ToSpan(a_ptr), dh::ToSpan(b), dh::ToSpan(b_ptr),
+                 &out, &out_ptr);
+  for (size_t c = 0; c < 2; ++c) {
+    Summary sa(h_a.data() + h_a_ptr[c], h_a_ptr[c + 1] - h_a_ptr[c]);
+    Summary sb(h_b.data() + h_b_ptr[c], h_b_ptr[c + 1] - h_b_ptr[c]);
+    std::vector<SketchEntry> space(sa.size + sb.size);
+    Summary expected(space.data(), 0);
+    expected.SetCombine(sa, sb);
+    CheckEqual(expected, out, out_ptr, c);
+  }
+}
+}  // namespace common
+}  // namespace xgboost
@@ -79,5 +79,52 @@ TEST(ParallelFor2dNonUniform, Test) {
   }
 }
 
+TEST(ParallelFor, Sched) {
+  size_t constexpr kSize = 1000;
+  for (auto sched : {Sched::Auto(), Sched::Dyn(), Sched::Dyn(7), Sched::Static(),
+                     Sched::Static(3), Sched::Guided()}) {
+    std::vector<int> visited(kSize, 0);
+    ParallelFor(kSize, 4, sched, [&](size_t i) { visited[i] += 1; });
+    for (auto v : visited) {
+      ASSERT_EQ(v, 1);
+    }
+  }
+  ASSERT_THROW(ParallelFor(kSize, 4, [](size_t i) {
+                 if (i == 10) {
+                   LOG(FATAL) << "out of range";
+                 }
+               }),
+               dmlc::Error);
+}
+
+TEST(OmpThreadsScope, Restore) {
+  int32_t const original = omp_get_max_threads();
+  {
+    OmpThreadsScope threads {original + 1};
+    ASSERT_EQ(omp_get_max_threads(), original + 1);
+  }
+  ASSERT_EQ(omp_get_max_threads(), original);
+  {
+    OmpThreadsScope threads {0};
+    ASSERT_EQ(omp_get_max_threads(), original);
+  }
+  ASSERT_EQ(OmpGetNumThreads(0), original);
+  ASSERT_EQ(OmpGetNumThreads(3), 3);
+}
+
+TEST(HugePageAllocator, Vector) {
+  // small enough for the default allocator, then large enough for huge pages
+  for (size_t n : {size_t(16), size_t(1) << 21}) {
+    std::vector<uint32_t, HugePageAllocator<uint32_t>> vec(n);
+    for (size_t i = 0; i < n; ++i) {
+      vec[i] = static_cast<uint32_t>(i);
+    }
+    vec.resize(2 * n);
+    ASSERT_EQ(vec[n - 1], n - 1);
+    vec.clear();
+    vec.shrink_to_fit();
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
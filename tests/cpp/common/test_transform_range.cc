@@ -59,6 +59,7 @@ TEST(Transform, DeclareUnifiedTest(Basic)) {
 }
 
 #if !defined(__CUDACC__)
+#if !defined(XGBOOST_SPAN_UNCHECKED_ACCESS)
 TEST(Transform, Exception) {
   size_t const kSize {16};
   std::vector<bst_float> h_in(kSize);
@@ -69,6 +70,32 @@ TEST(Transform, Exception) {
         .Eval(&in_vec);
   });
 }
+#endif  // !defined(XGBOOST_SPAN_UNCHECKED_ACCESS)
+
+TEST(Transform, Blocks) {
+  // a single block, several blocks and a partial last block
+  for (size_t size : {size_t(10), size_t(kCPUBlockSize * 4), size_t(kCPUBlockSize * 3 + 7)}) {
+    std::vector<bst_float> h_in(size);
+    InitializeRange(h_in.begin(), h_in.end());
+    const HostDeviceVector<bst_float> in_vec{h_in, -1};
+    HostDeviceVector<bst_float> out_vec{std::vector<bst_float>(size, -1.0f), -1};
+    Transform<>::Init(TestTransformRange<bst_float>{},
+                      Range{0, static_cast<Range::DifferenceType>(size)}, -1)
+        .Eval(&out_vec, &in_vec);
+    ASSERT_EQ(out_vec.HostVector(), h_in);
+
+    EXPECT_ANY_THROW({
+      Transform<>::Init(
+          [size](size_t idx, common::Span<float const>) {
+            if (idx == size - 1) {
+              LOG(FATAL) << "Last index.";
+            }
+          },
+          Range(0, static_cast<Range::DifferenceType>(size)), -1)
+          .Eval(&in_vec);
+    });
+  }
+}
 #endif
 
 } // namespace common
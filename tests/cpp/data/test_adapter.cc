@@ -1,5 +1,6 @@
 // Copyright (c) 2019 by Contributors
 #include <gtest/gtest.h>
+#include <cmath>
 #include <type_traits>
 #include <utility>
 #include <xgboost/data.h>
@@ -10,6 +11,7 @@
 
 #include "xgboost/base.h"
 #include "xgboost/c_api.h"
+#include "xgboost/json.h"
 
 namespace xgboost {
 TEST(Adapter, CSRAdapter) {
@@ -67,6 +69,149 @@ TEST(Adapter, CSCAdapterColsMoreThanRows) {
   EXPECT_EQ(inst[3].index, 3);
 }
 
+TEST(Adapter, TypedCSCAdapter) {
+  // R stores dgCMatrix indices as int and values as double.
+  std::vector<double> data = {1, 2, 3, 4, 5};
+  std::vector<int32_t> row_idx = {0, 2, 1, 0, 2};
+  std::vector<int32_t> col_ptr = {0, 2, 3, 5};
+  data::TypedCSCAdapter<int32_t, double> adapter(col_ptr.data(), row_idx.data(),
+                                                 data.data(), 3, 0);
+  data::SimpleDMatrix dmat(&adapter, std::numeric_limits<float>::quiet_NaN(), 2);
+  EXPECT_EQ(dmat.Info().num_col_, 3);
+  EXPECT_EQ(dmat.Info().num_row_, 3);
+  EXPECT_EQ(dmat.Info().num_nonzero_, 5);
+
+  auto &batch = *dmat.GetBatches<SparsePage>().begin();
+  ASSERT_EQ(batch[0].size(), 2);
+  EXPECT_EQ(batch[0][0].fvalue, 1);
+  EXPECT_EQ(batch[0][1].fvalue, 4);
+  EXPECT_EQ(batch[0][1].index, 2);
+  ASSERT_EQ(batch[1].size(), 1);
+  EXPECT_EQ(batch[1][0].fvalue, 3);
+  EXPECT_EQ(batch[1][0].index, 1);
+  ASSERT_EQ(batch[2].size(), 2);
+  EXPECT_EQ(batch[2][0].fvalue, 2);
+  EXPECT_EQ(batch[2][1].fvalue, 5);
+}
+
+TEST(Adapter, ColMajorDenseAdapter) {
+  size_t constexpr kRows = 3, kCols = 2;
+  float constexpr kMissing = -1;
+  std::vector<float> row_major = {1, 2, kMissing, 4, 5, 6};
+  std::vector<double> col_major(kRows * kCols);
+  std::vector<int32_t> col_major_int(kRows * kCols);
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t j = 0; j < kCols; ++j) {
+      col_major[j * kRows + i] = row_major[i * kCols + j];
+      col_major_int[j * kRows + i] = static_cast<int32_t>(row_major[i * kCols + j]);
+    }
+  }
+
+  data::DenseAdapter expected_adapter(row_major.data(), kRows, kCols);
+  data::SimpleDMatrix expected(&expected_adapter, kMissing, 1);
+  data::ColMajorDenseAdapter<double> adapter(col_major.data(), kRows, kCols);
+  data::SimpleDMatrix dmat(&adapter, kMissing, 2);
+  data::ColMajorDenseAdapter<int32_t> int_adapter(col_major_int.data(), kRows, kCols);
+  data::SimpleDMatrix int_dmat(&int_adapter, kMissing, 2);
+
+  auto const& h_expected = expected.GetBatches<SparsePage>().begin()->data.HostVector();
+  for (auto* p_fmat : {&dmat, &int_dmat}) {
+    EXPECT_EQ(p_fmat->Info().num_row_, kRows);
+    EXPECT_EQ(p_fmat->Info().num_col_, kCols);
+    EXPECT_EQ(p_fmat->Info().num_nonzero_, 5);
+    auto const& page = *p_fmat->GetBatches<SparsePage>().begin();
+    EXPECT_EQ(page.offset.HostVector(),
+              expected.GetBatches<SparsePage>().begin()->offset.HostVector());
+    auto const& h_data = page.data.HostVector();
+    ASSERT_EQ(h_data.size(), h_expected.size());
+    for (size_t i = 0; i < h_data.size(); ++i) {
+      EXPECT_EQ(h_data[i].index, h_expected[i].index);
+      EXPECT_EQ(h_data[i].fvalue, h_expected[i].fvalue);
+    }
+  }
+}
+
+namespace {
+Json ArrowColumn(void const* data, std::string const& typestr, size_t rows,
+                 uint8_t const* validity) {
+  Json column{Object()};
+  column["shape"] = Array(std::vector<Json>{Json(Integer(static_cast<Integer::Int>(rows)))});
+  column["data"] = Array(std::vector<Json>{
+      Json(Integer(reinterpret_cast<Integer::Int>(data))), Json(Boolean(true))});
+  column["typestr"] = String(typestr);
+  column["version"] = Integer(static_cast<Integer::Int>(1));
+  if (validity != nullptr) {
+    Json mask{Object()};
+    mask["shape"] = Array(std::vector<Json>{Json(Integer(static_cast<Integer::Int>(rows)))});
+    mask["data"] = Array(std::vector<Json>{
+        Json(Integer(reinterpret_cast<Integer::Int>(validity))), Json(Boolean(true))});
+    mask["typestr"] = String("|t1");
+    mask["version"] = Integer(static_cast<Integer::Int>(1));
+    column["mask"] = mask;
+  }
+  return column;
+}
+}  // anonymous namespace
+
+TEST(Adapter, ArrowAdapter) {
+  // two record batches of a float column with nulls and an integer column
+  std::vector<float> f0{1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<int64_t> i0{10, 11, 12, 13, 14, 15, 16, 17, 18};
+  std::vector<uint8_t> valid0{0b11110101, 0b1};  // rows 1 and 3 are null
+  std::vector<float> f1{-1, -2};
+  std::vector<int64_t> i1{-10, 0};
+
+  std::vector<Json> batches;
+  batches.emplace_back(Array(std::vector<Json>{
+      ArrowColumn(f0.data(), "<f4", f0.size(), valid0.data()),
+      ArrowColumn(i0.data(), "<i8", i0.size(), nullptr)}));
+  batches.emplace_back(Array(std::vector<Json>{
+      ArrowColumn(f1.data(), "<f4", f1.size(), nullptr),
+      ArrowColumn(i1.data(), "<i8", i1.size(), nullptr)}));
+  std::string str;
+  Json::Dump(Json(Array(std::move(batches))), &str);
+
+  data::ArrowAdapter adapter(str);
+  ASSERT_EQ(adapter.NumRows(), 11);
+  ASSERT_EQ(adapter.NumColumns(), 2);
+
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromArrowColumns(str.c_str(), 0, 2, &handle), 0);
+  auto dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  ASSERT_EQ(dmat->Info().num_row_, 11);
+  ASSERT_EQ(dmat->Info().num_col_, 2);
+  // 2 nulls and the zero treated as missing
+  ASSERT_EQ(dmat->Info().num_nonzero_, 22 - 3);
+
+  auto const& page = *dmat->GetBatches<SparsePage>().begin();
+  auto row1 = page[1];
+  ASSERT_EQ(row1.size(), 1);
+  ASSERT_EQ(row1[0].index, 1);
+  ASSERT_EQ(row1[0].fvalue, 11);
+  auto row8 = page[8];
+  ASSERT_EQ(row8.size(), 2);
+  ASSERT_EQ(row8[0].fvalue, 9);
+  ASSERT_EQ(row8[1].fvalue, 18);
+  auto row9 = page[9];
+  ASSERT_EQ(row9.size(), 2);
+  ASSERT_EQ(row9[0].fvalue, -1);
+  ASSERT_EQ(row9[1].fvalue, -10);
+  auto row10 = page[10];
+  ASSERT_EQ(row10.size(), 1);
+  ASSERT_EQ(row10[0].index, 0);
+  ASSERT_EQ(row10[0].fvalue, -2);
+  ASSERT_EQ(XGDMatrixFree(handle), 0);
+
+  // a single list of columns is one record batch
+  std::string one;
+  Json::Dump(Json(Array(std::vector<Json>{
+                 ArrowColumn(f1.data(), "<f4", f1.size(), nullptr)})),
+             &one);
+  data::ArrowAdapter single(one);
+  ASSERT_EQ(single.NumRows(), 2);
+  ASSERT_EQ(single.NumColumns(), 1);
+}
+
 TEST(c_api, DMatrixSliceAdapterFromSimpleDMatrix) {
   auto pp_dmat = CreateDMatrix(6, 2, 1.0);
   auto p_dmat = *pp_dmat;
@@ -157,4 +302,69 @@ TEST(Adapter, IteratorAdaper) {
   ASSERT_EQ(data->Info().num_row_, kRows);
 }
 
+
+// A mock for JVM columnar iterator, with batches kept alive until the next one.
+class ColumnarIterForTest {
+  std::vector<std::vector<float>> columns_ {{1, 2, 3}, {4, 0, 6}, {7, NAN}, {8, NAN}};
+  std::vector<float> labels_ {0, 1, 0, 1, 1};
+  std::vector<uint8_t> valid0_ {0b101};  // row 1 of the first column is null
+  std::vector<float const*> values_;
+  std::vector<uint8_t const*> valid_;
+  size_t iter_ {0};
+
+ public:
+  static int Next(DataIterHandle data_handle, XGBCallbackSetColumnarData *set_function,
+                  DataHolderHandle set_function_handle) {
+    auto self = static_cast<ColumnarIterForTest *>(data_handle);
+    if (self->iter_ == 2) {
+      return 0;
+    }
+    XGBoostBatchColumnar batch;
+    batch.columns = 2;
+    self->values_ = {self->columns_[self->iter_ * 2].data(),
+                     self->columns_[self->iter_ * 2 + 1].data()};
+    batch.values = self->values_.data();
+    if (self->iter_ == 0) {
+      batch.size = 3;
+      self->valid_ = {self->valid0_.data(), nullptr};
+      batch.valid = self->valid_.data();
+      batch.label = self->labels_.data();
+    } else {
+      batch.size = 2;
+      batch.valid = nullptr;
+      batch.label = self->labels_.data() + 3;
+    }
+    batch.weight = nullptr;
+    self->iter_++;
+    set_function(set_function_handle, batch);
+    return 1;
+  }
+};
+
+TEST(Adapter, ColumnarIteratorAdapter) {
+  ColumnarIterForTest iter;
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromColumnarIter(&iter, ColumnarIterForTest::Next, 5, 6, 0, 2,
+                                            &handle), 0);
+  auto dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  // the last row only has missing values
+  ASSERT_EQ(dmat->Info().num_row_, 5);
+  ASSERT_EQ(dmat->Info().num_col_, 2);
+  // the null and the zero treated as missing
+  ASSERT_EQ(dmat->Info().num_nonzero_, 6);
+  ASSERT_EQ(dmat->Info().labels_.ConstHostVector(),
+            std::vector<float>({0, 1, 0, 1, 1}));
+
+  auto const& page = *dmat->GetBatches<SparsePage>().begin();
+  ASSERT_EQ(page[0].size(), 2);
+  ASSERT_EQ(page[0][1].fvalue, 4);
+  ASSERT_EQ(page[1].size(), 0);
+  ASSERT_EQ(page[2].size(), 2);
+  ASSERT_EQ(page[2][0].fvalue, 3);
+  ASSERT_EQ(page[3].size(), 2);
+  ASSERT_EQ(page[3][0].fvalue, 7);
+  ASSERT_EQ(page[3][1].fvalue, 8);
+  ASSERT_EQ(page[4].size(), 0);
+  ASSERT_EQ(XGDMatrixFree(handle), 0);
+}
 }  // namespace xgboost
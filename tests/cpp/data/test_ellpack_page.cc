@@ -0,0 +1,78 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#if !defined(XGBOOST_USE_CUDA)
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/common/hist_util.h"
+#include "../../../src/data/ellpack_page_host.h"
+
+namespace xgboost {
+namespace {
+void TestHostEllpack(float sparsity) {
+  constexpr int kRows = 1000, kCols = 13, kMaxBins = 64;
+  auto p_dmat = CreateDMatrix(kRows, kCols, sparsity, 3);
+  auto dmat = p_dmat->get();
+
+  auto& page = *dmat->GetBatches<EllpackPage>({GenericParameter::kCpuId, kMaxBins, 0}).begin();
+  auto impl = page.Impl();
+  ASSERT_EQ(page.Size(), kRows);
+  ASSERT_EQ(impl->IsDense(), sparsity == 0);
+  auto const& cuts = impl->Cuts();
+
+  // bins of every row match the cuts
+  std::vector<uint32_t> bins(kRows * impl->RowStride());
+  impl->GetRowBins(0, kRows, bins.data());
+  for (auto const& batch : dmat->GetBatches<SparsePage>()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      auto inst = batch[i];
+      std::vector<uint32_t> expected;
+      for (auto const& entry : inst) {
+        expected.push_back(cuts.SearchBin(entry));
+      }
+      std::sort(expected.begin(), expected.end());
+      expected.resize(impl->RowStride(), impl->NullValue());
+      auto row = bins.cbegin() + (batch.base_rowid + i) * impl->RowStride();
+      ASSERT_TRUE(std::equal(expected.cbegin(), expected.cend(), row));
+    }
+  }
+
+  // the quantized matrix of hist is the same as quantizing the rows again
+  common::GHistIndexMatrix from_ellpack;
+  impl->ToGHistIndex(&from_ellpack);
+  common::GHistIndexMatrix gmat;
+  gmat.Init(dmat, kMaxBins);
+  ASSERT_EQ(from_ellpack.IsDense(), gmat.IsDense());
+  ASSERT_EQ(from_ellpack.row_ptr, gmat.row_ptr);
+  ASSERT_EQ(from_ellpack.hit_count, gmat.hit_count);
+  ASSERT_EQ(from_ellpack.index.GetBinTypeSize(), gmat.index.GetBinTypeSize());
+  ASSERT_EQ(from_ellpack.index.Size(), gmat.index.Size());
+  for (size_t i = 0; i < gmat.index.Size(); ++i) {
+    ASSERT_EQ(from_ellpack.index[i], gmat.index[i]);
+  }
+
+  // hist takes the bins of the existing page
+  auto const& hist_page =
+      *dmat->GetBatches<common::GHistIndexMatrix>({GenericParameter::kCpuId, kMaxBins, 0})
+           .begin();
+  ASSERT_EQ(hist_page.cut.Values(), cuts.Values());
+  ASSERT_EQ(hist_page.hit_count, gmat.hit_count);
+
+  delete p_dmat;
+}
+}  // anonymous namespace
+
+TEST(EllpackPage, HostDense) {
+  TestHostEllpack(0.0f);
+}
+
+TEST(EllpackPage, HostSparse) {
+  TestHostEllpack(0.4f);
+}
+}  // namespace xgboost
+#endif  // !defined(XGBOOST_USE_CUDA)
@@ -33,7 +33,9 @@ TEST(EllpackPage, BuildGidxDense) {
 
   std::vector<common::CompressedByteT> h_gidx_buffer(page->gidx_buffer.size());
   dh::CopyDeviceSpanToVector(&h_gidx_buffer, page->gidx_buffer);
-  common::CompressedIterator<uint32_t> gidx(h_gidx_buffer.data(), 25);
+  // Dense pages store bins local to each feature, 3 bins for every feature.
+  ASSERT_EQ(page->matrix.info.NumSymbols(), 3);
+  common::CompressedIterator<uint32_t> gidx(h_gidx_buffer.data(), 3);
 
   ASSERT_EQ(page->matrix.info.row_stride, kNCols);
 
@@ -56,7 +58,7 @@ TEST(EllpackPage, BuildGidxDense) {
     1, 4, 7, 10, 14, 16, 19, 21,
   };
   for (size_t i = 0; i < kNRows * kNCols; ++i) {
-    ASSERT_EQ(solution[i], gidx[i]);
+    ASSERT_EQ(solution[i], gidx[i] + 3 * (i % kNCols));
   }
 }
 
@@ -0,0 +1,48 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/common/hist_util.h"
+#include "../../../src/data/fold_dmatrix.h"
+
+namespace xgboost {
+TEST(FoldDMatrix, Weights) {
+  size_t constexpr kRows = 64, kCols = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2);
+  auto p_dmat = *pp_dmat;
+  auto& weights = p_dmat->Info().weights_.HostVector();
+  weights.resize(kRows);
+  std::vector<int32_t> folds(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    weights[i] = static_cast<float>(i % 4 + 1);
+    folds[i] = static_cast<int32_t>(i % 3);
+  }
+
+  data::FoldDMatrix test(p_dmat, folds, 1, false);
+  data::FoldDMatrix train(p_dmat, folds, 1, true);
+  ASSERT_EQ(test.Info().num_row_, kRows);
+  ASSERT_EQ(test.NumFoldRows() + train.NumFoldRows(), kRows);
+  auto const& test_weights = test.Info().weights_.ConstHostVector();
+  auto const& train_weights = train.Info().weights_.ConstHostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_EQ(test_weights[i], folds[i] == 1 ? weights[i] : 0.0f);
+    ASSERT_EQ(train_weights[i], folds[i] == 1 ? 0.0f : weights[i]);
+  }
+  ASSERT_EQ(weights[1], 2.0f);
+
+  // the quantized matrix is built once by the parent
+  BatchParam param{GenericParameter::kCpuId, 16, 0};
+  auto const* from_train = &(*train.GetBatches<common::GHistIndexMatrix>(param).begin());
+  auto const* from_test = &(*test.GetBatches<common::GHistIndexMatrix>(param).begin());
+  auto const* from_parent = &(*p_dmat->GetBatches<common::GHistIndexMatrix>(param).begin());
+  ASSERT_EQ(from_train, from_parent);
+  ASSERT_EQ(from_test, from_parent);
+
+  delete pp_dmat;
+}
+}  // namespace xgboost
@@ -2,8 +2,10 @@
 #include <dmlc/io.h>
 #include <dmlc/filesystem.h>
 #include <xgboost/data.h>
+#include <xgboost/json.h>
 #include <string>
 #include <memory>
+#include <vector>
 #include "../../../src/common/version.h"
 
 #include "../helpers.h"
@@ -39,6 +41,48 @@ TEST(MetaInfo, GetSet) {
   ASSERT_EQ(info.group_ptr_.size(), 0);
 }
 
+namespace {
+std::string HostColumn(void const* data, std::string const& typestr, size_t rows) {
+  using xgboost::Json;
+  using xgboost::Integer;
+  Json column{xgboost::Object()};
+  column["shape"] = xgboost::Array(
+      std::vector<Json>{Json(Integer(static_cast<Integer::Int>(rows)))});
+  column["data"] = xgboost::Array(std::vector<Json>{
+      Json(Integer(reinterpret_cast<Integer::Int>(data))), Json(xgboost::Boolean(true))});
+  column["typestr"] = xgboost::String(typestr);
+  column["version"] = Integer(static_cast<Integer::Int>(1));
+  std::string str;
+  Json::Dump(column, &str);
+  return str;
+}
+}  // anonymous namespace
+
+TEST(MetaInfo, SetInfoFromHostInterface) {
+  xgboost::MetaInfo info;
+  std::vector<float> labels{0.5f, 1.5f, 2.5f, 3.5f};
+  info.SetInfo("label", HostColumn(labels.data(), "<f4", labels.size()));
+  ASSERT_EQ(info.labels_.HostVector(), labels);
+
+  std::vector<double> margin{-1.0, 0.0, 1.0, 2.0};
+  info.SetInfo("base_margin", HostColumn(margin.data(), "<f8", margin.size()));
+  ASSERT_EQ(info.base_margin_.Size(), margin.size());
+  for (size_t i = 0; i < margin.size(); ++i) {
+    ASSERT_FLOAT_EQ(info.base_margin_.HostVector()[i], margin[i]);
+  }
+
+  // converted through float
+  std::vector<int8_t> weights{1, 2, 3, 4};
+  info.SetInfo("weight", HostColumn(weights.data(), "|i1", weights.size()));
+  ASSERT_EQ(info.GetWeight(3), 4.0f);
+
+  // a list of one column is accepted as well
+  std::vector<uint32_t> groups{1, 3};
+  info.SetInfo("group", "[" + HostColumn(groups.data(), "<u4", groups.size()) + "]");
+  std::vector<xgboost::bst_group_t> expected_ptr{0, 1, 4};
+  ASSERT_EQ(info.group_ptr_, expected_ptr);
+}
+
 TEST(MetaInfo, SaveLoadBinary) {
   xgboost::MetaInfo info;
   uint64_t constexpr kRows { 64 }, kCols { 32 };
@@ -0,0 +1,154 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+#include <xgboost/learner.h>
+
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../../../src/data/adapter.h"
+#include "../../../src/data/quantile_dmatrix.h"
+#include "../../../src/data/simple_dmatrix.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+std::vector<float> GenerateData(size_t rows, size_t cols, float missing_ratio) {
+  std::mt19937 rng(2020);
+  std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+  std::bernoulli_distribution is_missing(missing_ratio);
+  std::vector<float> data(rows * cols);
+  for (auto& v : data) {
+    v = is_missing(rng) ? std::numeric_limits<float>::quiet_NaN() : dist(rng);
+  }
+  return data;
+}
+
+void CheckSameIndex(DMatrix* expected, DMatrix* quantile, int max_bin) {
+  BatchParam param{GenericParameter::kCpuId, max_bin, 0};
+  auto const& lhs = *expected->GetBatches<common::GHistIndexMatrix>(param).begin();
+  auto const& rhs = *quantile->GetBatches<common::GHistIndexMatrix>(param).begin();
+  ASSERT_EQ(lhs.cut.Ptrs(), rhs.cut.Ptrs());
+  ASSERT_EQ(lhs.cut.Values(), rhs.cut.Values());
+  ASSERT_EQ(lhs.cut.MinValues(), rhs.cut.MinValues());
+  ASSERT_EQ(lhs.row_ptr, rhs.row_ptr);
+  ASSERT_EQ(lhs.IsDense(), rhs.IsDense());
+  ASSERT_EQ(lhs.index.GetBinTypeSize(), rhs.index.GetBinTypeSize());
+  for (size_t i = 0; i < lhs.row_ptr.back(); ++i) {
+    ASSERT_EQ(lhs.index[i], rhs.index[i]);
+  }
+  ASSERT_EQ(lhs.hit_count, rhs.hit_count);
+}
+}  // anonymous namespace
+
+TEST(QuantileDMatrix, Dense) {
+  size_t constexpr kRows = 3000, kCols = 7;
+  int constexpr kBins = 64;
+  auto data = GenerateData(kRows, kCols, 0.0f);
+  DenseAdapter adapter(data.data(), kRows, kCols);
+  SimpleDMatrix simple(&adapter, std::numeric_limits<float>::quiet_NaN(), 0);
+  QuantileDMatrix quantile(&adapter, std::numeric_limits<float>::quiet_NaN(), 0, kBins);
+  ASSERT_EQ(quantile.Info().num_row_, kRows);
+  ASSERT_EQ(quantile.Info().num_col_, kCols);
+  ASSERT_TRUE(quantile.IsDense());
+  ASSERT_FALSE(quantile.PageExists<SparsePage>());
+  CheckSameIndex(&simple, &quantile, kBins);
+  // the rows are never stored
+  ASSERT_FALSE(quantile.PageExists<SparsePage>());
+
+  BatchParam other{GenericParameter::kCpuId, kBins * 2, 0};
+  EXPECT_ANY_THROW(quantile.GetBatches<common::GHistIndexMatrix>(other));
+}
+
+TEST(QuantileDMatrix, Sparse) {
+  size_t constexpr kRows = 2000, kCols = 11;
+  int constexpr kBins = 256;
+  auto data = GenerateData(kRows, kCols, 0.4f);
+  // the csc adapter has a line for each column, rows are spread over lines
+  std::vector<size_t> col_ptr{0};
+  std::vector<unsigned> row_idx;
+  std::vector<float> values;
+  for (size_t c = 0; c < kCols; ++c) {
+    for (size_t r = 0; r < kRows; ++r) {
+      float v = data[r * kCols + c];
+      if (!std::isnan(v)) {
+        row_idx.push_back(r);
+        values.push_back(v);
+      }
+    }
+    col_ptr.push_back(values.size());
+  }
+  DenseAdapter dense(data.data(), kRows, kCols);
+  SimpleDMatrix simple(&dense, std::numeric_limits<float>::quiet_NaN(), 0);
+  CSCAdapter csc(col_ptr.data(), row_idx.data(), values.data(), kCols, kRows);
+  QuantileDMatrix from_csc(&csc, std::numeric_limits<float>::quiet_NaN(), 0, kBins);
+  QuantileDMatrix from_dense(&dense, std::numeric_limits<float>::quiet_NaN(), 0, kBins);
+  ASSERT_FALSE(from_csc.IsDense());
+  ASSERT_EQ(from_csc.Info().num_nonzero_, values.size());
+  CheckSameIndex(&simple, &from_dense, kBins);
+  CheckSameIndex(&from_dense, &from_csc, kBins);
+}
+
+TEST(QuantileDMatrix, RecoveredRows) {
+  size_t constexpr kRows = 500, kCols = 5;
+  int constexpr kBins = 16;
+  auto data = GenerateData(kRows, kCols, 0.2f);
+  DenseAdapter adapter(data.data(), kRows, kCols);
+  SimpleDMatrix simple(&adapter, std::numeric_limits<float>::quiet_NaN(), 0);
+  QuantileDMatrix quantile(&adapter, std::numeric_limits<float>::quiet_NaN(), 0, kBins);
+  BatchParam param{GenericParameter::kCpuId, kBins, 0};
+  auto const& gmat = *quantile.GetBatches<common::GHistIndexMatrix>(param).begin();
+  auto const& expected = *simple.GetBatches<SparsePage>().begin();
+  auto const& recovered = *quantile.GetBatches<SparsePage>().begin();
+  ASSERT_TRUE(quantile.PageExists<SparsePage>());
+  ASSERT_EQ(recovered.Size(), kRows);
+  ASSERT_EQ(recovered.offset.ConstHostVector(), expected.offset.ConstHostVector());
+  for (size_t i = 0; i < kRows; ++i) {
+    auto lhs = expected[i];
+    auto rhs = recovered[i];
+    ASSERT_EQ(lhs.size(), rhs.size());
+    for (size_t j = 0; j < lhs.size(); ++j) {
+      ASSERT_EQ(lhs[j].index, rhs[j].index);
+      ASSERT_EQ(gmat.cut.SearchBin(lhs[j]), gmat.cut.SearchBin(rhs[j]));
+    }
+  }
+}
+
+TEST(QuantileDMatrix, Train) {
+  size_t constexpr kRows = 1000, kCols = 6;
+  auto data = GenerateData(kRows, kCols, 0.1f);
+  std::vector<float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 3);
+  }
+  DenseAdapter adapter(data.data(), kRows, kCols);
+  std::shared_ptr<DMatrix> simple{
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 0)};
+  std::shared_ptr<DMatrix> quantile{
+      DMatrix::CreateQuantile(&adapter, std::numeric_limits<float>::quiet_NaN(), 0, 256)};
+  simple->Info().labels_.HostVector() = labels;
+  quantile->Info().labels_.HostVector() = labels;
+
+  std::vector<HostDeviceVector<float>> predictions(2);
+  std::vector<std::shared_ptr<DMatrix>> dmats{simple, quantile};
+  for (size_t i = 0; i < dmats.size(); ++i) {
+    std::unique_ptr<Learner> learner{Learner::Create({dmats[i]})};
+    learner->SetParams(Args{{"tree_method", "hist"}, {"max_bin", "256"}});
+    for (int32_t iter = 0; iter < 4; ++iter) {
+      learner->UpdateOneIter(iter, dmats[i]);
+    }
+    // predictions on the original data
+    learner->Predict(simple, false, &predictions[i]);
+  }
+  auto const& lhs = predictions[0].ConstHostVector();
+  auto const& rhs = predictions[1].ConstHostVector();
+  ASSERT_EQ(lhs.size(), rhs.size());
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    ASSERT_NEAR(lhs[i], rhs[i], 1e-6);
+  }
+}
+}  // namespace data
+}  // namespace xgboost
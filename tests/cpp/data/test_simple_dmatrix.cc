@@ -217,6 +217,43 @@ TEST(SimpleDMatrix, FromFile) {
   }
 }
 
+TEST(SimpleDMatrix, LoadParallel) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/parallel.libsvm";
+  {
+    std::ofstream fo(tmp_file.c_str());
+    for (size_t i = 0; i < 101; ++i) {
+      fo << i % 2 << " qid:" << i / 7;
+      // Empty rows, including some at the end of a chunk
+      for (size_t j = 0; j < i % 3; ++j) {
+        fo << " " << (i + j) % 13 << ":" << i + j;
+      }
+      fo << "\n";
+    }
+  }
+  std::unique_ptr<DMatrix> serial(DMatrix::Load(tmp_file, true, false, "auto",
+                                                DMatrix::kPageSize, 1));
+  std::unique_ptr<DMatrix> parallel(DMatrix::Load(tmp_file, true, false, "auto",
+                                                  DMatrix::kPageSize, 4));
+  ASSERT_EQ(serial->Info().num_row_, 101);
+  ASSERT_EQ(parallel->Info().num_row_, serial->Info().num_row_);
+  ASSERT_EQ(parallel->Info().num_col_, serial->Info().num_col_);
+  ASSERT_EQ(parallel->Info().num_nonzero_, serial->Info().num_nonzero_);
+  ASSERT_EQ(parallel->Info().labels_.HostVector(), serial->Info().labels_.HostVector());
+  ASSERT_EQ(parallel->Info().group_ptr_, serial->Info().group_ptr_);
+
+  auto const& serial_page = *serial->GetBatches<SparsePage>().begin();
+  auto const& parallel_page = *parallel->GetBatches<SparsePage>().begin();
+  ASSERT_EQ(parallel_page.offset.HostVector(), serial_page.offset.HostVector());
+  auto const& serial_data = serial_page.data.HostVector();
+  auto const& parallel_data = parallel_page.data.HostVector();
+  ASSERT_EQ(parallel_data.size(), serial_data.size());
+  for (size_t i = 0; i < serial_data.size(); ++i) {
+    ASSERT_EQ(parallel_data[i].index, serial_data[i].index);
+    ASSERT_EQ(parallel_data[i].fvalue, serial_data[i].fvalue);
+  }
+}
+
 TEST(SimpleDMatrix, Slice) {
   const int kRows = 6;
   const int kCols = 2;
@@ -261,6 +298,48 @@ TEST(SimpleDMatrix, Slice) {
   delete pp_dmat;
 };
 
+TEST(SimpleDMatrix, SliceRows) {
+  size_t constexpr kRows = 64, kCols = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.5);
+  auto p_dmat = *pp_dmat;
+  auto& labels = p_dmat->Info().labels_.HostVector();
+  auto& base_margin = p_dmat->Info().base_margin_.HostVector();
+  labels.resize(kRows);
+  base_margin.resize(kRows * 2);  // 2 output groups
+  std::iota(labels.begin(), labels.end(), 0);
+  std::iota(base_margin.begin(), base_margin.end(), 0);
+
+  std::vector<int> ridx_set = {63, 1, 1, 40, 7};
+  data::SimpleDMatrix sliced(*dynamic_cast<data::SimpleDMatrix*>(p_dmat.get()),
+                             {ridx_set.data(), ridx_set.size()}, 2);
+  ASSERT_EQ(sliced.Info().num_row_, ridx_set.size());
+  ASSERT_EQ(sliced.Info().num_col_, kCols);
+  ASSERT_TRUE(sliced.Info().weights_.ConstHostVector().empty());
+
+  auto const& old_batch = *p_dmat->GetBatches<SparsePage>().begin();
+  auto const& new_batch = *sliced.GetBatches<SparsePage>().begin();
+  size_t nnz = 0;
+  for (size_t i = 0; i < ridx_set.size(); ++i) {
+    auto const ridx = ridx_set[i];
+    ASSERT_EQ(sliced.Info().labels_.ConstHostVector()[i], ridx);
+    ASSERT_EQ(sliced.Info().base_margin_.ConstHostVector()[i * 2], ridx * 2);
+    ASSERT_EQ(sliced.Info().base_margin_.ConstHostVector()[i * 2 + 1], ridx * 2 + 1);
+    auto old_inst = old_batch[ridx];
+    auto new_inst = new_batch[i];
+    ASSERT_EQ(old_inst.size(), new_inst.size());
+    for (size_t j = 0; j < old_inst.size(); ++j) {
+      ASSERT_EQ(old_inst[j], new_inst[j]);
+    }
+    nnz += new_inst.size();
+  }
+  ASSERT_EQ(sliced.Info().num_nonzero_, nnz);
+
+  std::vector<int> out_of_range = {0, static_cast<int>(kRows)};
+  EXPECT_ANY_THROW(data::SimpleDMatrix(*dynamic_cast<data::SimpleDMatrix*>(p_dmat.get()),
+                                       {out_of_range.data(), out_of_range.size()}, 1));
+  delete pp_dmat;
+}
+
 TEST(SimpleDMatrix, SaveLoadBinary) {
   dmlc::TemporaryDirectory tempdir;
   const std::string tmp_file = tempdir.path + "/simple.libsvm";
@@ -290,3 +369,166 @@ TEST(SimpleDMatrix, SaveLoadBinary) {
   delete dmat;
   delete dmat_read;
 }
+
+TEST(SimpleDMatrix, LoadLegacyBinary) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  std::unique_ptr<DMatrix> dmat(DMatrix::Load(tmp_file, true, false));
+  auto const& page = *dmat->GetBatches<SparsePage>().begin();
+
+  // Binary files written before the aligned format was introduced.
+  const std::string tmp_binfile = tempdir.path + "/legacy.binary";
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(tmp_binfile.c_str(), "w"));
+    int tmagic = data::SimpleDMatrix::kMagic;
+    fo->Write(&tmagic, sizeof(tmagic));
+    dmat->Info().SaveBinary(fo.get());
+    fo->Write(page.offset.ConstHostVector());
+    fo->Write(page.data.ConstHostVector());
+  }
+  std::unique_ptr<DMatrix> dmat_read(DMatrix::Load(tmp_binfile, true, false));
+  auto const& page_read = *dmat_read->GetBatches<SparsePage>().begin();
+  EXPECT_EQ(dmat_read->Info().num_row_, dmat->Info().num_row_);
+  EXPECT_EQ(dmat_read->Info().labels_.HostVector(), dmat->Info().labels_.HostVector());
+  EXPECT_EQ(page_read.offset.HostVector(), page.offset.HostVector());
+  EXPECT_EQ(page_read.data.Size(), page.data.Size());
+}
+
+TEST(SimpleDMatrix, SaveLoadAlignedBinary) {
+  dmlc::TemporaryDirectory tempdir;
+  auto pp_dmat = CreateDMatrix(97, 7, 0.3);
+  auto p_dmat = *pp_dmat;
+  p_dmat->Info().labels_.HostVector().resize(97, 1.0f);
+  auto simple = dynamic_cast<data::SimpleDMatrix*>(p_dmat.get());
+  ASSERT_TRUE(simple);
+  const std::string tmp_binfile = tempdir.path + "/aligned.binary";
+  simple->SaveToLocalFile(tmp_binfile);
+
+  int32_t magic;
+  {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_binfile.c_str(), "r"));
+    fi->Read(&magic, sizeof(magic));
+  }
+  ASSERT_EQ(magic, data::SimpleDMatrix::kAlignedMagic);
+
+  // Read from the memory mapped file and through a stream.
+  std::unique_ptr<DMatrix> mapped(DMatrix::Load(tmp_binfile, true, false));
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_binfile.c_str(), "r"));
+  data::SimpleDMatrix streamed("not-a-local-file://" + tmp_binfile, fi.get());
+  for (DMatrix* loaded : {mapped.get(), static_cast<DMatrix*>(&streamed)}) {
+    EXPECT_EQ(loaded->Info().num_row_, p_dmat->Info().num_row_);
+    EXPECT_EQ(loaded->Info().num_col_, p_dmat->Info().num_col_);
+    EXPECT_EQ(loaded->Info().labels_.HostVector(), p_dmat->Info().labels_.HostVector());
+    auto const& page = *p_dmat->GetBatches<SparsePage>().begin();
+    auto const& loaded_page = *loaded->GetBatches<SparsePage>().begin();
+    ASSERT_EQ(loaded_page.offset.HostVector(), page.offset.HostVector());
+    auto const& data = page.data.HostVector();
+    auto const& loaded_data = loaded_page.data.HostVector();
+    ASSERT_EQ(loaded_data.size(), data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+      ASSERT_EQ(loaded_data[i], data[i]);
+    }
+  }
+  delete pp_dmat;
+}
+
+TEST(SimpleDMatrix, SaveLoadSortedColumns) {
+  dmlc::TemporaryDirectory tempdir;
+  auto pp_dmat = CreateDMatrix(301, 5, 0.1);
+  auto p_dmat = *pp_dmat;
+  auto simple = dynamic_cast<data::SimpleDMatrix*>(p_dmat.get());
+  ASSERT_TRUE(simple);
+  // builds the sorted column page, which is then saved along with the rows
+  auto const& sorted = *p_dmat->GetBatches<SortedCSCPage>().begin();
+  for (size_t fid = 0; fid < sorted.Size(); ++fid) {
+    auto column = sorted[fid];
+    for (size_t i = 1; i < column.size(); ++i) {
+      ASSERT_LE(column[i - 1].fvalue, column[i].fvalue);
+    }
+  }
+  const std::string tmp_binfile = tempdir.path + "/sorted.binary";
+  simple->SaveToLocalFile(tmp_binfile);
+
+  std::unique_ptr<DMatrix> mapped(DMatrix::Load(tmp_binfile, true, false));
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_binfile.c_str(), "r"));
+  data::SimpleDMatrix streamed("not-a-local-file://" + tmp_binfile, fi.get());
+  for (DMatrix* loaded : {mapped.get(), static_cast<DMatrix*>(&streamed)}) {
+    auto const& loaded_sorted = *loaded->GetBatches<SortedCSCPage>().begin();
+    ASSERT_EQ(loaded_sorted.offset.HostVector(), sorted.offset.HostVector());
+    auto const& data = sorted.data.HostVector();
+    auto const& loaded_data = loaded_sorted.data.HostVector();
+    ASSERT_EQ(loaded_data.size(), data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+      ASSERT_EQ(loaded_data[i], data[i]);
+    }
+  }
+  delete pp_dmat;
+}
+
+TEST(SimpleDMatrix, GHistIndexCache) {
+  auto pp_dmat = CreateDMatrix(32, 4, 0.2);
+  auto p_dmat = *pp_dmat;
+  BatchParam param{GenericParameter::kCpuId, 16, 0};
+  auto const* first = &(*p_dmat->GetBatches<common::GHistIndexMatrix>(param).begin());
+  size_t n_batches = 0;
+  for (auto const& page : p_dmat->GetBatches<common::GHistIndexMatrix>(param)) {
+    // the quantized matrix is built once and shared by later requests
+    EXPECT_EQ(&page, first);
+    EXPECT_EQ(page.Size(), p_dmat->Info().num_row_);
+    ++n_batches;
+  }
+  EXPECT_EQ(n_batches, 1);
+
+  param.max_bin = 4;
+  auto const& rebuilt = *p_dmat->GetBatches<common::GHistIndexMatrix>(param).begin();
+  for (size_t fid = 0; fid < p_dmat->Info().num_col_; ++fid) {
+    EXPECT_LE(rebuilt.cut.Ptrs()[fid + 1] - rebuilt.cut.Ptrs()[fid], 4);
+  }
+  delete pp_dmat;
+}
+
+TEST(SimpleDMatrix, AppendDropRows) {
+  size_t constexpr kCols = 2;
+  std::vector<float> data {1, 2, 3, 4, 5, 6, 7, 8};
+  data::DenseAdapter adapter(data.data(), 4, kCols);
+  data::SimpleDMatrix dmat(&adapter, std::numeric_limits<float>::quiet_NaN(), 1);
+  std::vector<float> labels {0, 1, 2, 3};
+  dmat.Info().SetInfo("label", labels.data(), DataType::kFloat32, labels.size());
+
+  BatchParam param{GenericParameter::kCpuId, 16, 0};
+  auto cuts = (*dmat.GetBatches<common::GHistIndexMatrix>(param).begin()).cut;
+
+  auto check_page = [&]() {
+    auto const& page = *dmat.GetBatches<common::GHistIndexMatrix>(param).begin();
+    // extended with the original cuts, same as quantizing all rows again
+    ASSERT_EQ(page.cut.Values(), cuts.Values());
+    common::GHistIndexMatrix expected;
+    expected.Init(*dmat.GetBatches<SparsePage>().begin(), cuts, dmat.IsDense());
+    ASSERT_EQ(page.Size(), dmat.Info().num_row_);
+    ASSERT_EQ(page.row_ptr, expected.row_ptr);
+    ASSERT_EQ(page.hit_count, expected.hit_count);
+    for (size_t i = 0; i < expected.index.Size(); ++i) {
+      ASSERT_EQ(page.index[i], expected.index[i]);
+    }
+  };
+
+  std::vector<float> more {0.5, 9, 10, 1.5};
+  data::DenseAdapter more_adapter(more.data(), 2, kCols);
+  dmat.Append(&more_adapter, std::numeric_limits<float>::quiet_NaN(), 1);
+  ASSERT_EQ(dmat.Info().num_row_, 6);
+  ASSERT_EQ(dmat.Info().num_nonzero_, 12);
+  // the appended rows come without labels
+  ASSERT_EQ(dmat.Info().labels_.Size(), 0);
+  check_page();
+
+  labels = {0, 1, 2, 3, 4, 5};
+  dmat.Info().SetInfo("label", labels.data(), DataType::kFloat32, labels.size());
+  dmat.DropRows(0, 2);
+  ASSERT_EQ(dmat.Info().num_row_, 4);
+  ASSERT_EQ(dmat.Info().labels_.HostVector(), std::vector<float>({2, 3, 4, 5}));
+  auto const& page = *dmat.GetBatches<SparsePage>().begin();
+  ASSERT_EQ(page[0][0].fvalue, 5);
+  ASSERT_EQ(page[3][1].fvalue, 1.5);
+  check_page();
+}
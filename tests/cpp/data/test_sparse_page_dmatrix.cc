@@ -2,6 +2,11 @@
 #include <dmlc/filesystem.h>
 #include <gtest/gtest.h>
 #include <xgboost/data.h>
+#include <xgboost/c_api.h>
+
+#include <thread>
+#include <vector>
+
 #include "../../../src/data/adapter.h"
 #include "../../../src/data/sparse_page_dmatrix.h"
 #include "../helpers.h"
@@ -286,3 +291,130 @@ TEST(SparsePageDMatrix, FromFile) {
     }
   }
 }
+
+namespace {
+/*! \brief Hands out the rows of a dense matrix in batches of kBatchRows. */
+struct DenseBatches {
+  static size_t constexpr kRows = 320, kCols = 8, kBatchRows = 16;
+  DenseBatches() {
+    for (size_t i = 0; i < kRows; ++i) {
+      for (size_t j = 0; j < kCols; ++j) {
+        index.push_back(static_cast<int>(j));
+        value.push_back(static_cast<float>(i * kCols + j));
+      }
+    }
+    for (size_t i = 0; i <= kBatchRows; ++i) {
+      offset.push_back(i * kCols);
+    }
+  }
+  static int Next(DataIterHandle handle, XGBCallbackSetData* set_function,
+                  DataHolderHandle set_function_handle) {
+    auto* self = static_cast<DenseBatches*>(handle);
+    if (self->begin >= kRows) {
+      return 0;
+    }
+    XGBoostBatchCSR batch;
+    batch.size = kBatchRows;
+    batch.columns = kCols;
+    batch.offset = self->offset.data();
+    batch.label = nullptr;
+    batch.weight = nullptr;
+    batch.index = self->index.data() + self->begin * kCols;
+    batch.value = self->value.data() + self->begin * kCols;
+    set_function(set_function_handle, batch);
+    self->begin += kBatchRows;
+    return 1;
+  }
+  static void Reset(DataIterHandle handle) { static_cast<DenseBatches*>(handle)->begin = 0; }
+
+  size_t begin {0};
+  std::vector<int64_t> offset;
+  std::vector<int> index;
+  std::vector<float> value;
+};
+size_t constexpr DenseBatches::kRows;
+size_t constexpr DenseBatches::kCols;
+size_t constexpr DenseBatches::kBatchRows;
+
+void CheckRows(DMatrix* dmat, size_t max_pages) {
+  size_t row = 0, n_pages = 0;
+  for (auto const& page : dmat->GetBatches<SparsePage>()) {
+    ASSERT_EQ(page.base_rowid, row);
+    for (size_t i = 0; i < page.Size(); ++i, ++row) {
+      auto inst = page[i];
+      ASSERT_EQ(inst.size(), DenseBatches::kCols);
+      for (size_t j = 0; j < inst.size(); ++j) {
+        ASSERT_EQ(inst[j].index, j);
+        ASSERT_EQ(inst[j].fvalue, static_cast<float>(row * DenseBatches::kCols + j));
+      }
+    }
+    if (++n_pages == max_pages) {
+      return;
+    }
+  }
+  ASSERT_EQ(row, DenseBatches::kRows);
+}
+}  // anonymous namespace
+
+TEST(SparsePageDMatrix, MemoryBudget) {
+  size_t constexpr kPageSize = 256;
+  size_t constexpr kPageBytes = (DenseBatches::kBatchRows + 1) * sizeof(size_t) +
+                                DenseBatches::kBatchRows * DenseBatches::kCols * sizeof(Entry);
+  // no budget, part of the pages or all of them
+  for (size_t n_pages : {size_t(0), size_t(3), size_t(1000)}) {
+    dmlc::TemporaryDirectory tempdir;
+    DenseBatches batches;
+    data::IteratorAdapter adapter(&batches, &DenseBatches::Next, &DenseBatches::Reset);
+    data::SparsePageDMatrix dmat(&adapter, std::numeric_limits<float>::quiet_NaN(), 1,
+                                 tempdir.path + "/cache", kPageSize, n_pages * kPageBytes);
+    CheckRows(&dmat, 0);
+    // stop in the middle of the pinned pages, then go on pinning in the next pass
+    CheckRows(&dmat, 2);
+    CheckRows(&dmat, 0);
+    CheckRows(&dmat, 0);
+
+    size_t n_entries = 0;
+    for (int32_t pass = 0; pass < 2; ++pass) {
+      for (auto const& page : dmat.GetBatches<SortedCSCPage>()) {
+        ASSERT_EQ(page.Size(), DenseBatches::kCols);
+        n_entries += page.data.Size();
+      }
+    }
+    ASSERT_EQ(n_entries, 2 * DenseBatches::kRows * DenseBatches::kCols);
+  }
+}
+
+TEST(SparsePageDMatrix, MultipleCursors) {
+  size_t constexpr kPageSize = 256;
+  size_t constexpr kPageBytes = (DenseBatches::kBatchRows + 1) * sizeof(size_t) +
+                                DenseBatches::kBatchRows * DenseBatches::kCols * sizeof(Entry);
+  for (size_t n_pages : {size_t(0), size_t(3)}) {
+    dmlc::TemporaryDirectory tempdir;
+    DenseBatches batches;
+    data::IteratorAdapter adapter(&batches, &DenseBatches::Next, &DenseBatches::Reset);
+    data::SparsePageDMatrix dmat(&adapter, std::numeric_limits<float>::quiet_NaN(), 1,
+                                 tempdir.path + "/cache", kPageSize, n_pages * kPageBytes);
+    // interleaved passes on one thread
+    auto first = dmat.GetBatches<SparsePage>().begin();
+    auto second = dmat.GetBatches<SparsePage>().begin();
+    size_t n_rows = 0;
+    for (; !first.AtEnd(); ++first, ++second) {
+      ASSERT_FALSE(second.AtEnd());
+      ASSERT_EQ((*first).base_rowid, n_rows);
+      ASSERT_EQ((*second).base_rowid, n_rows);
+      ASSERT_EQ((*first).data.HostVector(), (*second).data.HostVector());
+      n_rows += (*first).Size();
+    }
+    ASSERT_TRUE(second.AtEnd());
+    ASSERT_EQ(n_rows, DenseBatches::kRows);
+
+    // concurrent passes, some of them stopping early
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < 4; ++i) {
+      workers.emplace_back([&dmat, i]() { CheckRows(&dmat, i % 2 == 0 ? 0 : 2); });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+}
@@ -182,4 +182,29 @@ TEST(SparsePageDMatrix, EllpackPageMultipleLoops) {
   }
 }
 
+TEST(SparsePageDMatrix, EllpackPageDoubleBuffer) {
+  constexpr size_t kRows = 1024;
+  constexpr size_t kCols = 16;
+  constexpr int kMaxBins = 256;
+  constexpr size_t kPageSize = 4096;
+
+  dmlc::TemporaryDirectory tmpdir;
+  std::unique_ptr<DMatrix>
+      dmat_ext(CreateSparsePageDMatrixWithRC(kRows, kCols, kPageSize, true, tmpdir));
+
+  BatchParam param{0, kMaxBins, 0, kPageSize};
+  // The next page is copied while the current one is in use, so consecutive
+  // pages live in different device buffers.
+  std::vector<common::CompressedByteT const*> buffers;
+  for (int loop = 0; loop < 2; ++loop) {
+    for (auto& page : dmat_ext->GetBatches<EllpackPage>(param)) {
+      buffers.push_back(page.Impl()->gidx_buffer.data());
+    }
+  }
+  ASSERT_GT(buffers.size(), 4);
+  for (size_t i = 1; i < buffers.size() / 2; ++i) {
+    ASSERT_NE(buffers[i], buffers[i - 1]);
+  }
+}
+
 }  // namespace xgboost
@@ -0,0 +1,119 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <dmlc/filesystem.h>
+#include <xgboost/data.h>
+
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../../src/data/sparse_page_writer.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+template <typename PageT>
+PageT MakePage(size_t rows, size_t cols, size_t n_values) {
+  std::mt19937 rng(1994);
+  std::bernoulli_distribution present(0.6);
+  std::uniform_int_distribution<size_t> value(0, n_values - 1);
+  PageT page;
+  auto& offset = page.offset.HostVector();
+  auto& data = page.data.HostVector();
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      if (present(rng)) {
+        data.emplace_back(static_cast<bst_uint>(j),
+                          static_cast<float>(value(rng)) * 0.25f - 3.0f);
+      }
+    }
+    offset.push_back(data.size());
+  }
+  return page;
+}
+
+/*! \brief Write the page in `format', read it back and return the file size. */
+template <typename PageT>
+size_t RoundTrip(std::string const& format, PageT const& page, std::string const& path,
+                 PageT* out) {
+  std::unique_ptr<SparsePageFormat<PageT>> fmt{CreatePageFormat<PageT>(format)};
+  {
+    std::unique_ptr<dmlc::Stream> fo{dmlc::Stream::Create(path.c_str(), "w")};
+    fmt->Write(page, fo.get());
+  }
+  fmt.reset(CreatePageFormat<PageT>(format));
+  std::unique_ptr<dmlc::SeekStream> fi{dmlc::SeekStream::CreateForRead(path.c_str())};
+  EXPECT_TRUE(fmt->Read(out, fi.get()));
+  std::ifstream fin(path, std::ios::binary | std::ios::ate);
+  return static_cast<size_t>(fin.tellg());
+}
+
+template <typename PageT>
+void CheckEqual(PageT const& lhs, PageT const& rhs) {
+  ASSERT_EQ(lhs.offset.ConstHostVector(), rhs.offset.ConstHostVector());
+  auto const& l = lhs.data.ConstHostVector();
+  auto const& r = rhs.data.ConstHostVector();
+  ASSERT_EQ(l.size(), r.size());
+  for (size_t i = 0; i < l.size(); ++i) {
+    ASSERT_EQ(l[i].index, r[i].index);
+    ASSERT_EQ(l[i].fvalue, r[i].fvalue);
+  }
+}
+}  // anonymous namespace
+
+TEST(SparsePagePackedFormat, RowPage) {
+  dmlc::TemporaryDirectory tmpdir;
+  std::string path = tmpdir.path + "/page";
+  for (size_t n_values : {size_t(1), size_t(7), size_t(100000)}) {
+    auto page = MakePage<SparsePage>(1000, 37, n_values);
+    SparsePage raw, packed, packed_raw;
+    size_t raw_bytes = RoundTrip("raw", page, path, &raw);
+    size_t packed_bytes = RoundTrip("packed", page, path, &packed);
+    size_t packed_raw_bytes = RoundTrip("packedraw", page, path, &packed_raw);
+    CheckEqual(page, raw);
+    CheckEqual(page, packed);
+    CheckEqual(page, packed_raw);
+    ASSERT_LT(packed_raw_bytes, raw_bytes);
+    ASSERT_LE(packed_bytes, packed_raw_bytes);
+    if (n_values < 100) {
+      ASSERT_LT(packed_bytes, packed_raw_bytes);
+    }
+  }
+}
+
+TEST(SparsePagePackedFormat, ColumnSubset) {
+  dmlc::TemporaryDirectory tmpdir;
+  std::string path = tmpdir.path + "/page";
+  size_t constexpr kCols = 23;
+  auto rows = MakePage<SparsePage>(2000, kCols, 16);
+  SortedCSCPage page(rows.GetTranspose(kCols));
+  page.SortRows();
+  std::unique_ptr<SparsePageFormat<SortedCSCPage>> fmt{
+      CreatePageFormat<SortedCSCPage>("packed")};
+  {
+    std::unique_ptr<dmlc::Stream> fo{dmlc::Stream::Create(path.c_str(), "w")};
+    fmt->Write(page, fo.get());
+    fmt->Write(page, fo.get());
+  }
+  std::vector<bst_uint> subset{0, 3, 4, 22};
+  std::unique_ptr<dmlc::SeekStream> fi{dmlc::SeekStream::CreateForRead(path.c_str())};
+  SortedCSCPage whole, partial;
+  ASSERT_TRUE(fmt->Read(&whole, fi.get()));
+  CheckEqual(page, whole);
+  ASSERT_TRUE(fmt->Read(&partial, fi.get(), subset));
+  ASSERT_FALSE(fmt->Read(&whole, fi.get()));
+  ASSERT_EQ(partial.Size(), subset.size());
+  for (size_t i = 0; i < subset.size(); ++i) {
+    auto expected = page[subset[i]];
+    auto got = partial[i];
+    ASSERT_EQ(expected.size(), got.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      ASSERT_EQ(expected[j].index, got[j].index);
+      ASSERT_EQ(expected[j].fvalue, got[j].fvalue);
+    }
+  }
+}
+}  // namespace data
+}  // namespace xgboost
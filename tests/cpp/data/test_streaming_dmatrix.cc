@@ -0,0 +1,167 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <xgboost/data.h>
+#include <xgboost/learner.h>
+
+#include <memory>
+#include <vector>
+
+#include "../../../src/data/adapter.h"
+#include "../../../src/data/simple_dmatrix.h"
+#include "../../../src/data/streaming_dmatrix.h"
+#include "../helpers.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+/*! \brief Hands out fixed size batches of a CSR matrix, like a user iterator would. */
+class CSRBatches {
+ public:
+  CSRBatches(size_t rows, size_t cols, size_t batch_size)
+      : cols_{cols}, batch_size_{batch_size} {
+    offset_.push_back(0);
+    for (size_t i = 0; i < rows; ++i) {
+      // the last row of some batches is empty
+      if (i % 7 != 6) {
+        for (size_t j = i % 2; j < cols; j += 2) {
+          index_.push_back(static_cast<int>(j));
+          value_.push_back(static_cast<float>(i * cols + j));
+        }
+      }
+      offset_.push_back(value_.size());
+      label_.push_back(static_cast<float>(i % 2));
+    }
+  }
+
+  static int Next(DataIterHandle handle, XGBCallbackSetData* set_function,
+                  DataHolderHandle set_function_handle) {
+    auto* self = static_cast<CSRBatches*>(handle);
+    size_t const rows = self->label_.size();
+    if (self->begin_ >= rows) {
+      return 0;
+    }
+    size_t const end = std::min(rows, self->begin_ + self->batch_size_);
+    XGBoostBatchCSR batch;
+    batch.size = end - self->begin_;
+    batch.columns = self->cols_;
+    batch.offset = self->offset_.data() + self->begin_;
+    batch.label = self->label_.data() + self->begin_;
+    batch.weight = nullptr;
+    batch.index = self->index_.data();
+    batch.value = self->value_.data();
+    set_function(set_function_handle, batch);
+    self->begin_ = end;
+    ++self->n_batches_;
+    return 1;
+  }
+  static void Reset(DataIterHandle handle) {
+    auto* self = static_cast<CSRBatches*>(handle);
+    self->begin_ = 0;
+    ++self->n_resets_;
+  }
+
+  std::unique_ptr<DMatrix> Whole() {
+    CSRAdapter adapter(reinterpret_cast<size_t*>(offset_.data()),
+                       reinterpret_cast<unsigned*>(index_.data()), value_.data(),
+                       label_.size(), value_.size(), cols_);
+    std::unique_ptr<DMatrix> dmat{new SimpleDMatrix(&adapter, std::nanf(""), 1)};
+    dmat->Info().labels_.HostVector() = label_;
+    return dmat;
+  }
+
+  size_t n_batches_ {0};
+  size_t n_resets_ {0};
+
+ private:
+  size_t cols_;
+  size_t batch_size_;
+  size_t begin_ {0};
+  std::vector<int64_t> offset_;
+  std::vector<int> index_;
+  std::vector<float> value_;
+  std::vector<float> label_;
+};
+}  // anonymous namespace
+
+TEST(StreamingDMatrix, RowBatches) {
+  size_t constexpr kRows = 100, kCols = 5, kBatchSize = 14;
+  CSRBatches batches(kRows, kCols, kBatchSize);
+  std::unique_ptr<IteratorAdapter> adapter{
+      new IteratorAdapter(&batches, &CSRBatches::Next, &CSRBatches::Reset)};
+  StreamingDMatrix dmat(std::move(adapter), std::nanf(""));
+  auto whole = batches.Whole();
+  ASSERT_EQ(dmat.Info().num_row_, kRows);
+  ASSERT_EQ(dmat.Info().num_col_, kCols);
+  ASSERT_EQ(dmat.Info().num_nonzero_, whole->Info().num_nonzero_);
+  ASSERT_EQ(dmat.Info().labels_.ConstHostVector(), whole->Info().labels_.ConstHostVector());
+  ASSERT_FALSE(dmat.SingleColBlock());
+
+  auto const& expected = *whole->GetBatches<SparsePage>().begin();
+  for (int32_t pass = 0; pass < 2; ++pass) {
+    size_t n_pages = 0;
+    size_t row = 0;
+    for (auto const& page : dmat.GetBatches<SparsePage>()) {
+      ASSERT_EQ(page.base_rowid, row);
+      for (size_t i = 0; i < page.Size(); ++i, ++row) {
+        auto lhs = expected[row];
+        auto rhs = page[i];
+        ASSERT_EQ(lhs.size(), rhs.size());
+        for (size_t j = 0; j < lhs.size(); ++j) {
+          ASSERT_EQ(lhs[j].index, rhs[j].index);
+          ASSERT_EQ(lhs[j].fvalue, rhs[j].fvalue);
+        }
+      }
+      ++n_pages;
+    }
+    ASSERT_EQ(row, kRows);
+    ASSERT_EQ(n_pages, common::DivRoundUp(kRows, kBatchSize));
+  }
+  // read again from the iterator on every pass, once for the meta info
+  ASSERT_EQ(batches.n_batches_, 3 * common::DivRoundUp(kRows, kBatchSize));
+  ASSERT_EQ(batches.n_resets_, 2);
+
+  size_t n_entries = 0;
+  for (auto const& page : dmat.GetBatches<SortedCSCPage>()) {
+    ASSERT_EQ(page.Size(), kCols);
+    for (size_t c = 0; c < page.Size(); ++c) {
+      auto column = page[c];
+      for (size_t j = 1; j < column.size(); ++j) {
+        ASSERT_LE(column[j - 1].fvalue, column[j].fvalue);
+      }
+      n_entries += column.size();
+    }
+  }
+  ASSERT_EQ(n_entries, whole->Info().num_nonzero_);
+}
+
+TEST(StreamingDMatrix, Train) {
+  size_t constexpr kRows = 256, kCols = 4, kBatchSize = 64;
+  CSRBatches batches(kRows, kCols, kBatchSize);
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromCallback(&batches, &CSRBatches::Reset, &CSRBatches::Next,
+                                        std::nanf(""), &handle),
+            0);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  ASSERT_EQ(dmat->Info().num_row_, kRows);
+
+  BatchParam param{GenericParameter::kCpuId, 16, 0};
+  size_t rows = 0;
+  for (auto const& page : dmat->GetBatches<common::GHistIndexMatrix>(param)) {
+    ASSERT_EQ(page.base_rowid, rows);
+    rows += page.Size();
+  }
+  ASSERT_EQ(rows, kRows);
+
+  std::unique_ptr<Learner> learner{Learner::Create({dmat})};
+  learner->SetParams(Args{{"tree_method", "hist"}, {"max_bin", "16"}});
+  for (int32_t iter = 0; iter < 2; ++iter) {
+    learner->UpdateOneIter(iter, dmat);
+  }
+  HostDeviceVector<float> predictions;
+  learner->Predict(dmat, false, &predictions);
+  ASSERT_EQ(predictions.Size(), kRows);
+  ASSERT_EQ(XGDMatrixFree(handle), 0);
+}
+}  // namespace data
+}  // namespace xgboost
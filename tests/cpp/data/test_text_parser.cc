@@ -0,0 +1,142 @@
+/*!
+ * Copyright 2020 by XGBoost Contributors
+ */
+#include <gtest/gtest.h>
+#include <dmlc/data.h>
+#include <dmlc/filesystem.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../../src/data/text_parser.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+struct Rows {
+  std::vector<size_t> offset {0};
+  std::vector<float> label, weight;
+  std::vector<uint64_t> qid;
+  std::vector<uint32_t> index;
+  std::vector<float> value;
+};
+
+Rows ReadAll(std::string const& uri, std::string const& format) {
+  std::unique_ptr<dmlc::Parser<uint32_t>> parser {
+    dmlc::Parser<uint32_t>::Create(uri.c_str(), 0, 1, format.c_str())};
+  Rows rows;
+  while (parser->Next()) {
+    auto const& block = parser->Value();
+    for (size_t i = 0; i < block.size; ++i) {
+      auto row = block[i];
+      for (size_t j = 0; j < row.length; ++j) {
+        rows.index.push_back(row.get_index(j));
+        rows.value.push_back(row.get_value(j));
+      }
+      rows.offset.push_back(rows.index.size());
+      rows.label.push_back(row.get_label());
+      rows.weight.push_back(row.get_weight());
+      rows.qid.push_back(block.qid ? block.qid[i] : 0);
+    }
+  }
+  return rows;
+}
+
+void CheckEqual(Rows const& expected, Rows const& got) {
+  ASSERT_EQ(expected.offset, got.offset);
+  ASSERT_EQ(expected.qid, got.qid);
+  ASSERT_EQ(expected.index, got.index);
+  // dmlc-core doesn't always round to the nearest float
+  auto check_floats = [](std::vector<float> const& lhs, std::vector<float> const& rhs) {
+    ASSERT_EQ(lhs.size(), rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      ASSERT_FLOAT_EQ(lhs[i], rhs[i]);
+    }
+  };
+  check_floats(expected.label, got.label);
+  check_floats(expected.weight, got.weight);
+  check_floats(expected.value, got.value);
+}
+}  // anonymous namespace
+
+TEST(TextParser, ParseFloat) {
+  for (std::string str : {"0", "-1.5", "+2.25", "1e-3", "3.4028235E38", ".5", "7.",
+                          "0.1000000000000000055511151231257827", "-0"}) {
+    float v {0};
+    auto end = ParseTextFloat(str.data(), str.data() + str.size(), &v);
+    ASSERT_EQ(end, str.data() + str.size()) << str;
+    ASSERT_EQ(v, std::strtof(str.c_str(), nullptr)) << str;
+  }
+  std::string str {"1.5:2"};
+  float v {0};
+  ASSERT_EQ(ParseTextFloat(str.data(), str.data() + str.size(), &v), str.data() + 3);
+  ASSERT_EQ(v, 1.5f);
+  str = "nan";
+  ParseTextFloat(str.data(), str.data() + str.size(), &v);
+  ASSERT_TRUE(std::isnan(v));
+  str = "abc";
+  ASSERT_EQ(ParseTextFloat(str.data(), str.data() + str.size(), &v), str.data());
+}
+
+TEST(TextParser, Format) {
+  ASSERT_EQ(TextParserFormat("train.txt", "auto"), "fast_libsvm");
+  ASSERT_EQ(TextParserFormat("train.txt?format=csv#cache", "auto"), "fast_csv");
+  ASSERT_EQ(TextParserFormat("train.txt", "csv"), "fast_csv");
+  ASSERT_EQ(TextParserFormat("train.txt?format=libfm", "auto"), "auto");
+}
+
+TEST(TextParser, LibSVM) {
+  dmlc::TemporaryDirectory tempdir;
+  std::string const path = tempdir.path + "/train.libsvm";
+  {
+    std::ofstream fo(path);
+    fo << "1 0:1.5 3:-2 10:1e-2\n"
+       << "0:2.5 qid:3 1:7 4:.25\r\n"
+       << "\n"
+       << "-1 2:3\n";
+    for (size_t i = 0; i < 20000; ++i) {
+      fo << i % 3 << " " << i % 7 << ":" << i * 0.5 << " " << 8 + i % 5 << ":" << -1.0 * i
+         << "\n";
+    }
+  }
+  auto expected = ReadAll(path, "libsvm");
+  auto got = ReadAll(path, "fast_libsvm");
+  CheckEqual(expected, got);
+  ASSERT_EQ(got.label.size(), 20003);
+
+  // comments and features without a value
+  {
+    std::ofstream fo(path);
+    fo << "# header\n"
+       << "1 2 5:3 # trailing\n";
+  }
+  got = ReadAll(path, "fast_libsvm");
+  ASSERT_EQ(got.label, std::vector<float>{1.0f});
+  ASSERT_EQ(got.index, (std::vector<uint32_t>{2, 5}));
+  ASSERT_EQ(got.value, (std::vector<float>{1.0f, 3.0f}));
+  got = ReadAll(path + "?indexing_mode=1", "fast_libsvm");
+  ASSERT_EQ(got.index, (std::vector<uint32_t>{1, 4}));
+}
+
+TEST(TextParser, CSV) {
+  dmlc::TemporaryDirectory tempdir;
+  std::string const path = tempdir.path + "/train.csv";
+  {
+    std::ofstream fo(path);
+    for (size_t i = 0; i < 20000; ++i) {
+      fo << i % 2 << "," << i * 0.25 << ", " << -static_cast<double>(i) << ",3e-2,\n";
+    }
+  }
+  for (std::string args : {"", "?label_column=0", "?label_column=0&weight_column=2"}) {
+    auto expected = ReadAll(path + args, "csv");
+    auto got = ReadAll(path + args, "fast_csv");
+    CheckEqual(expected, got);
+    ASSERT_EQ(got.label.size(), 20000);
+  }
+}
+}  // namespace data
+}  // namespace xgboost
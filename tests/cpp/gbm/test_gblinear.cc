@@ -45,5 +45,44 @@ TEST(GBLinear, JsonIO) {
   }
 }
 
+TEST(GBLinear, SparseWeights) {
+  size_t constexpr kRows = 16, kCols = 16;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  GenericParameter gparam;
+  gparam.Init(Args{});
+
+  std::unique_ptr<GradientBooster> gbm {
+    CreateTrainedGBM("gblinear", Args{}, kRows, kCols, &param, &gparam) };
+  Json model { Object() };
+  gbm->SaveModel(&model);
+  // keep only 3 features, below the density of the dense prediction path
+  auto& weights = get<Array>(model["model"]["weights"]);
+  for (size_t i = 0; i < kCols; ++i) {
+    weights[i] = Number{i % 5 == 0 ? static_cast<float>(i) + 1.0f : 0.0f};
+  }
+  gbm->LoadModel(model);
+
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3);
+  auto p_dmat = *pp_dmat;
+  PredictionCacheEntry predts;
+  gbm->PredictBatch(p_dmat.get(), &predts, false, 0);
+  auto const& h_predts = predts.predictions.ConstHostVector();
+  ASSERT_EQ(h_predts.size(), kRows);
+
+  std::vector<float> row_predt(1);
+  for (auto const& batch : p_dmat->GetBatches<SparsePage>()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      gbm->PredictRow(batch[i], common::Span<float>{row_predt}, 0);
+      ASSERT_EQ(h_predts[batch.base_rowid + i], row_predt[0]);
+    }
+  }
+  delete pp_dmat;
+}
+
 }  // namespace gbm
 }  // namespace xgboost
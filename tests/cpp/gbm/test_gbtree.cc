@@ -3,8 +3,15 @@
  */
 #include <gtest/gtest.h>
 #include <dmlc/filesystem.h>
+#include <dmlc/omp.h>
 #include <xgboost/generic_parameters.h>
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+
 #include "xgboost/base.h"
 #include "xgboost/host_device_vector.h"
 #include "xgboost/learner.h"
@@ -146,6 +153,29 @@ TEST(GBTree, JsonIO) {
   ASSERT_EQ(get<String>(j_train_param["num_parallel_tree"]), "1");
 }
 
+TEST(GBTree, LazyUpdaters) {
+  size_t constexpr kRows = 16, kCols = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  p_dmat->Info().labels_.Resize(kRows);
+
+  std::unique_ptr<Learner> learner {Learner::Create({p_dmat})};
+  learner->SetParams(Args{{"tree_method", "hist"}});
+  learner->Configure();
+  auto updaters = [&]() {
+    Json config {Object()};
+    learner->SaveConfig(&config);
+    return get<Object const>(config["learner"]["gradient_booster"]["updater"]).size();
+  };
+  // Prediction alone doesn't create the updaters.
+  HostDeviceVector<float> predt;
+  learner->Predict(p_dmat, false, &predt, 0, false);
+  ASSERT_EQ(updaters(), 0);
+  learner->UpdateOneIter(0, p_dmat);
+  ASSERT_EQ(updaters(), 1);
+  delete pp_dmat;
+}
+
 TEST(Dart, JsonIO) {
   size_t constexpr kRows = 16, kCols = 16;
 
@@ -217,4 +247,365 @@ TEST(Dart, Prediction) {
 
   delete pp_dmat;
 }
+
+TEST(Dart, PredictionCache) {
+  size_t constexpr kRows = 64, kCols = 10;
+
+  auto pp_train = CreateDMatrix(kRows, kCols, 0);
+  auto pp_valid = CreateDMatrix(kRows, kCols, 0);
+  auto& p_train = *pp_train;
+  auto& p_valid = *pp_valid;
+  std::vector<bst_float> labels (kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 2;
+  }
+  p_train->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+  p_valid->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  for (auto normalize_type : {"tree", "forest"}) {
+    auto learner = std::unique_ptr<Learner>(Learner::Create({p_train, p_valid}));
+    learner->SetParam("booster", "dart");
+    learner->SetParam("rate_drop", "0.5");
+    learner->SetParam("normalize_type", normalize_type);
+    learner->Configure();
+
+    for (size_t i = 0; i < 16; ++i) {
+      learner->UpdateOneIter(i, p_train);
+      // The cached margin of the validation data sees both new trees and rescaled
+      // dropped trees.
+      learner->EvalOneIter(i, {p_train, p_valid}, {"train", "valid"});
+    }
+
+    for (auto const& p_mat : {p_train, p_valid}) {
+      HostDeviceVector<float> predts;
+      learner->Predict(p_mat, true, &predts, 0, false);
+      auto const& h_predts = predts.ConstHostVector();
+      ASSERT_EQ(h_predts.size(), kRows);
+      auto const& batch = *p_mat->GetBatches<SparsePage>().begin();
+      for (size_t i = 0; i < kRows; ++i) {
+        float expected {0};
+        learner->PredictRow(batch[i], true, common::Span<float>{&expected, 1}, 0);
+        ASSERT_NEAR(h_predts[i], expected, 1e-5);
+      }
+    }
+  }
+
+  delete pp_train;
+  delete pp_valid;
+}
+
+TEST(GBTree, MultiOutputTree) {
+  size_t constexpr kRows = 600, kCols = 4, kClasses = 3, kIters = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.1f, 3);
+  auto& p_mat = *pp_dmat;
+  // The class is given by the first feature, rows missing it belong to class 0.
+  std::vector<bst_float> labels(kRows, 0.0f);
+  auto const& page = *p_mat->GetBatches<SparsePage>().begin();
+  for (size_t i = 0; i < kRows; ++i) {
+    for (auto const& entry : page[i]) {
+      if (entry.index == 0) {
+        labels[i] = std::min(std::floor(entry.fvalue * kClasses), kClasses - 1.0f);
+      }
+    }
+  }
+  p_mat->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  std::unique_ptr<Learner> learner{Learner::Create({p_mat})};
+  learner->SetParams(Args{{"objective", "multi:softprob"},
+                          {"num_class", std::to_string(kClasses)},
+                          {"multi_strategy", "multi_output_tree"},
+                          {"max_depth", "3"}});
+  for (size_t i = 0; i < kIters; ++i) {
+    learner->UpdateOneIter(i, p_mat);
+  }
+  // a single tree for all classes in every iteration
+  FeatureMap fmap;
+  ASSERT_EQ(learner->DumpModel(fmap, false, "text").size(), kIters);
+
+  HostDeviceVector<float> predts;
+  learner->Predict(p_mat, false, &predts);
+  auto const& h_predts = predts.ConstHostVector();
+  ASSERT_EQ(h_predts.size(), kRows * kClasses);
+  size_t n_correct = 0;
+  for (size_t i = 0; i < kRows; ++i) {
+    auto begin = h_predts.cbegin() + i * kClasses;
+    auto predicted = std::max_element(begin, begin + kClasses) - begin;
+    n_correct += static_cast<float>(predicted) == labels[i];
+  }
+  ASSERT_GT(n_correct, kRows * 0.95);
+
+  // predict from the trees, the prediction cache of the training matrix is not used
+  Json model{Object()};
+  learner->SaveModel(&model);
+  std::unique_ptr<Learner> loaded{Learner::Create({})};
+  loaded->LoadModel(model);
+  HostDeviceVector<float> loaded_predts;
+  loaded->Predict(p_mat, false, &loaded_predts);
+  auto const& h_loaded = loaded_predts.ConstHostVector();
+  ASSERT_EQ(h_loaded.size(), h_predts.size());
+  for (size_t i = 0; i < h_predts.size(); ++i) {
+    ASSERT_NEAR(h_loaded[i], h_predts[i], 1e-5);
+  }
+
+  learner.reset(Learner::Create({p_mat}));
+  learner->SetParams(Args{{"objective", "multi:softprob"},
+                          {"num_class", std::to_string(kClasses)},
+                          {"multi_strategy", "multi_output_tree"},
+                          {"booster", "dart"}});
+  ASSERT_ANY_THROW(learner->UpdateOneIter(0, p_mat));
+
+  delete pp_dmat;
+}
+
+TEST(GBTree, Slice) {
+  size_t constexpr kRows = 16, kCols = 10;
+  int32_t constexpr kLayers = 4;
+
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto& p_mat = *pp_dmat;
+  std::vector<bst_float> labels (kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 2;
+  }
+  p_mat->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  for (std::string booster : {"gbtree", "dart"}) {
+    auto learner = std::unique_ptr<Learner>(Learner::Create({p_mat}));
+    learner->SetParams({{"booster", booster}, {"rate_drop", "0.5"}});
+    for (int32_t i = 0; i < kLayers; ++i) {
+      learner->UpdateOneIter(i, p_mat);
+    }
+    learner->SetAttr("best_iteration", "1");
+
+    bool out_of_bound = false;
+    ASSERT_EQ(learner->Slice(0, kLayers + 1, 1, &out_of_bound), nullptr);
+    ASSERT_TRUE(out_of_bound);
+
+    // the whole model
+    std::unique_ptr<Learner> whole{learner->Slice(0, 0, 1, &out_of_bound)};
+    ASSERT_FALSE(out_of_bound);
+    HostDeviceVector<float> expected, sliced;
+    learner->Predict(p_mat, true, &expected);
+    whole->Predict(p_mat, true, &sliced);
+    ASSERT_EQ(expected.HostVector(), sliced.HostVector());
+    std::string attr;
+    ASSERT_FALSE(whole->GetAttr("best_iteration", &attr));
+
+    // every other layer
+    std::unique_ptr<Learner> strided{learner->Slice(1, kLayers, 2, &out_of_bound)};
+    Json model {Object()};
+    strided->SaveModel(&model);
+    auto const& j_booster = booster == "dart" ? model["learner"]["gradient_booster"]["gbtree"]
+                                              : model["learner"]["gradient_booster"];
+    ASSERT_EQ(get<Array const>(j_booster["model"]["trees"]).size(), 2);
+    if (booster == "dart") {
+      ASSERT_EQ(get<F32Array const>(model["learner"]["gradient_booster"]["weight_drop"]).size(),
+                2);
+    }
+
+    // the model is shared, training the original one further leaves the slice intact
+    std::unique_ptr<Learner> head{learner->Slice(0, 2, 1, &out_of_bound)};
+    learner->UpdateOneIter(kLayers, p_mat);
+    if (booster == "gbtree") {
+      learner->Predict(p_mat, true, &expected, 2);
+      head->Predict(p_mat, true, &sliced);
+      ASSERT_EQ(expected.HostVector(), sliced.HostVector());
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(GBTree, LeafIndexCache) {
+  size_t constexpr kRows = 64, kCols = 10;
+  int32_t constexpr kIters = 4;
+
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto& p_mat = *pp_dmat;
+  std::vector<bst_float> labels (kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 2;
+  }
+  p_mat->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  // hist records the leaves while training, exact walks the trees on demand.
+  for (std::string tree_method : {"hist", "exact"}) {
+    auto learner = std::unique_ptr<Learner>(Learner::Create({p_mat}));
+    learner->SetParams({{"tree_method", tree_method}, {"subsample", "0.5"},
+                        {"cache_leaf_index", "true"}});
+    for (int32_t i = 0; i < kIters; ++i) {
+      learner->UpdateOneIter(i, p_mat);
+    }
+    size_t n_trees = 0;
+    auto const& h_leaf_indices = learner->PredictLeafIndex(p_mat, &n_trees).ConstHostVector();
+    ASSERT_EQ(n_trees, kIters);
+    ASSERT_EQ(h_leaf_indices.size(), kRows * n_trees);
+
+    HostDeviceVector<float> leaves;
+    learner->Predict(p_mat, false, &leaves, 0, false, true);
+    auto const& h_leaves = leaves.ConstHostVector();
+    for (size_t i = 0; i < kRows; ++i) {
+      for (size_t j = 0; j < n_trees; ++j) {
+        ASSERT_EQ(h_leaf_indices[j * kRows + i], static_cast<uint32_t>(h_leaves[i * n_trees + j]));
+      }
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(GBTree, FeatureScore) {
+  size_t constexpr kRows = 64, kCols = 10;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto& p_mat = *pp_dmat;
+  std::vector<bst_float> labels (kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 3;
+  }
+  p_mat->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+  auto learner = std::unique_ptr<Learner>(Learner::Create({p_mat}));
+  learner->SetParam("max_depth", "4");
+  for (int32_t i = 0; i < 8; ++i) {
+    learner->UpdateOneIter(i, p_mat);
+  }
+
+  // Expected scores from the text dump: "[f3<0.5] yes=..,gain=..,cover=.."
+  std::map<bst_feature_t, size_t> counts;
+  std::map<bst_feature_t, double> gains, covers;
+  for (auto const& tree : learner->DumpModel(FeatureMap{}, true, "text")) {
+    std::stringstream ss(tree);
+    std::string line;
+    while (std::getline(ss, line)) {
+      auto beg = line.find("[f");
+      if (beg == std::string::npos) {
+        continue;
+      }
+      auto fid = static_cast<bst_feature_t>(std::stoul(line.substr(beg + 2)));
+      counts[fid]++;
+      gains[fid] += std::stod(line.substr(line.find("gain=") + 5));
+      covers[fid] += std::stod(line.substr(line.find("cover=") + 6));
+    }
+  }
+
+  std::vector<bst_feature_t> features;
+  std::vector<float> scores;
+  learner->CalcFeatureScore("weight", &features, &scores);
+  ASSERT_EQ(features.size(), counts.size());
+  for (size_t i = 0; i < features.size(); ++i) {
+    ASSERT_EQ(scores[i], counts.at(features[i]));
+  }
+  for (auto const& type : {"gain", "total_gain", "cover", "total_cover"}) {
+    std::string importance_type{type};
+    learner->CalcFeatureScore(importance_type, &features, &scores);
+    ASSERT_EQ(features.size(), counts.size());
+    bool total = importance_type.find("total") == 0;
+    auto const& expected = importance_type.find("gain") != std::string::npos ? gains : covers;
+    for (size_t i = 0; i < features.size(); ++i) {
+      auto fid = features[i];
+      double value = total ? expected.at(fid) : expected.at(fid) / counts.at(fid);
+      ASSERT_NEAR(scores[i], value, 1e-3 * std::max(1.0, std::abs(value)));
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(GBTreeModel, Generation) {
+  LearnerModelParam param;
+  param.num_feature = 1;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  gbm::GBTreeModel other = CreateTestModel(&param);
+  ASSERT_NE(model.Generation(), other.Generation());
+
+  // appending trees keeps the generation
+  auto const generation = model.Generation();
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  model.CommitModel(std::move(trees), 0);
+  ASSERT_EQ(model.Generation(), generation);
+
+  // replacing them doesn't
+  Json json {Object()};
+  model.SaveModel(&json);
+  model.LoadModel(json);
+  ASSERT_NE(model.Generation(), generation);
+  auto const loaded = model.Generation();
+  model.InitTreesToUpdate();
+  ASSERT_NE(model.Generation(), loaded);
+}
+
+namespace gbm {
+TEST(GBTreeModel, ParallelJsonIO) {
+  LearnerModelParam param;
+  param.num_feature = 4;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  size_t constexpr kTrees = 64;
+  GBTreeModel model{&param};
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (size_t i = 0; i < kTrees; ++i) {
+    std::unique_ptr<RegTree> tree{new RegTree};
+    tree->ExpandNode(0, i % param.num_feature, static_cast<float>(i), i % 2 == 0,
+                     0.0f, static_cast<float>(i), -static_cast<float>(i), 0.0f, 1.0f);
+    trees.push_back(std::move(tree));
+  }
+  model.CommitModel(std::move(trees), 0);
+
+  Json json {Object()};
+  model.SaveModel(&json);
+  auto const& j_trees = get<Array const>(json["trees"]);
+  ASSERT_EQ(j_trees.size(), kTrees);
+  for (size_t i = 0; i < kTrees; ++i) {
+    ASSERT_EQ(get<Integer const>(j_trees[i]["id"]), static_cast<Integer::Int>(i));
+  }
+
+  GBTreeModel loaded{&param};
+  loaded.LoadModel(json);
+  ASSERT_EQ(loaded.trees.size(), kTrees);
+  for (size_t i = 0; i < kTrees; ++i) {
+    ASSERT_TRUE(*loaded.trees[i] == *model.trees[i]);
+  }
+
+  // an invalid tree is reported instead of terminating inside the parallel loop
+  json["trees"][7]["tree_param"]["num_nodes"] = String("5");
+  ASSERT_THROW(loaded.LoadModel(json), dmlc::Error);
+}
+
+TEST(GBTreeModel, StreamDumpModel) {
+  LearnerModelParam param;
+  param.num_feature = 4;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  // more trees than a single batch of dumps
+  size_t const kTrees = omp_get_max_threads() * 8 * 2 + 3;
+  GBTreeModel model{&param};
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (size_t i = 0; i < kTrees; ++i) {
+    std::unique_ptr<RegTree> tree{new RegTree};
+    tree->ExpandNode(0, i % param.num_feature, static_cast<float>(i), i % 2 == 0,
+                     0.0f, static_cast<float>(i), -static_cast<float>(i), 0.0f, 1.0f);
+    trees.push_back(std::move(tree));
+  }
+  model.CommitModel(std::move(trees), 0);
+
+  FeatureMap fmap;
+  for (auto format : {"text", "json"}) {
+    auto dump = model.DumpModel(fmap, true, format);
+    ASSERT_EQ(dump.size(), kTrees);
+    size_t n_visited = 0;
+    model.StreamDumpModel(fmap, true, format, [&](size_t i, std::string const& str) {
+      ASSERT_EQ(i, n_visited);
+      ASSERT_EQ(str, model.trees[i]->DumpModel(fmap, true, format));
+      ASSERT_EQ(str, dump[i]);
+      ++n_visited;
+    });
+    ASSERT_EQ(n_visited, kTrees);
+  }
+}
+}  // namespace gbm
 }  // namespace xgboost
@@ -7,6 +7,7 @@
 #include "../helpers.h"
 #include "test_json_io.h"
 #include "../../../src/gbm/gblinear_model.h"
+#include "../../../src/linear/coordinate_common.h"
 #include "xgboost/base.h"
 
 namespace xgboost {
@@ -77,6 +78,85 @@ TEST(Linear, coordinate) {
   delete pp_dmat;
 }
 
+TEST(Linear, ColumnCache) {
+  size_t constexpr kRows = 16;
+  size_t constexpr kCols = 8;
+
+  auto pp_dmat = xgboost::CreateDMatrix(kRows, kCols, 0.5);
+  auto p_fmat {*pp_dmat};
+
+  linear::ColumnCache columns;
+  ASSERT_FALSE(columns.Matches(p_fmat.get()));
+  columns.Init(p_fmat.get());
+  ASSERT_TRUE(columns.Matches(p_fmat.get()));
+  ASSERT_EQ(columns.Size(), kCols);
+
+  std::vector<GradientPair> gpair(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    gpair[i] = GradientPair(static_cast<float>(i) - 4.0f, 1.0f + i % 3);
+  }
+  for (auto const &batch : p_fmat->GetBatches<CSCPage>()) {
+    for (size_t fidx = 0; fidx < kCols; ++fidx) {
+      auto col = columns[fidx];
+      auto page_col = batch[fidx];
+      ASSERT_EQ(col.size, page_col.size());
+      for (size_t j = 0; j < col.size; ++j) {
+        ASSERT_EQ(col.index[j], page_col[j].index);
+        ASSERT_EQ(col.value[j], page_col[j].fvalue);
+      }
+      auto expected = linear::GetGradient(0, 1, fidx, gpair, p_fmat.get());
+      auto cached = linear::GetGradientParallel(0, 1, col, gpair);
+      ASSERT_NEAR(expected.first, cached.first, 1e-6);
+      ASSERT_NEAR(expected.second, cached.second, 1e-6);
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(Linear, TopKSelectors) {
+  size_t constexpr kRows = 32;
+  size_t constexpr kCols = 16;
+  int constexpr kTopK = 4;
+
+  auto pp_dmat = xgboost::CreateDMatrix(kRows, kCols, 0);
+  auto p_fmat {*pp_dmat};
+  LearnerModelParam mparam;
+  mparam.num_feature = kCols;
+  mparam.num_output_group = 1;
+  mparam.base_score = 0.5;
+  xgboost::gbm::GBLinearModel model{&mparam};
+  model.LazyInitModel();
+
+  std::vector<GradientPair> gpair(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    gpair[i] = GradientPair(static_cast<float>(i) - 12.0f, 1.0f + i % 3);
+  }
+
+  // the partially sorted top_k is the head of the fully sorted order
+  std::unique_ptr<linear::FeatureSelector> full(
+      linear::FeatureSelector::Create(linear::kThrifty));
+  std::unique_ptr<linear::FeatureSelector> top(
+      linear::FeatureSelector::Create(linear::kThrifty));
+  full->Setup(model, gpair, p_fmat.get(), 0.1f, 1.0f, 0);
+  top->Setup(model, gpair, p_fmat.get(), 0.1f, 1.0f, kTopK);
+  for (int i = 0; i < kTopK; ++i) {
+    ASSERT_EQ(top->NextFeature(i, model, 0, gpair, p_fmat.get(), 0.1f, 1.0f),
+              full->NextFeature(i, model, 0, gpair, p_fmat.get(), 0.1f, 1.0f));
+  }
+  ASSERT_EQ(top->NextFeature(kTopK, model, 0, gpair, p_fmat.get(), 0.1f, 1.0f), -1);
+
+  // both pick the largest weight change first
+  std::unique_ptr<linear::FeatureSelector> greedy(
+      linear::FeatureSelector::Create(linear::kGreedy));
+  greedy->Setup(model, gpair, p_fmat.get(), 0.1f, 1.0f, kTopK);
+  full->Setup(model, gpair, p_fmat.get(), 0.1f, 1.0f, 0);
+  ASSERT_EQ(greedy->NextFeature(0, model, 0, gpair, p_fmat.get(), 0.1f, 1.0f),
+            full->NextFeature(0, model, 0, gpair, p_fmat.get(), 0.1f, 1.0f));
+
+  delete pp_dmat;
+}
+
 TEST(Coordinate, JsonIO){
   TestUpdaterJsonIO("coord_descent");
 }
@@ -35,6 +35,38 @@ TEST(Linear, GPUCoordinate) {
   delete mat;
 }
 
+TEST(Linear, GPUCoordinateFeatureBlock) {
+  size_t constexpr kRows = 16;
+  size_t constexpr kCols = 10;
+
+  auto mat = xgboost::CreateDMatrix(kRows, kCols, 0);
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  LearnerModelParam mparam;
+  mparam.num_feature = kCols;
+  mparam.num_output_group = 1;
+  mparam.base_score = 0.5;
+
+  auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+      xgboost::LinearUpdater::Create("gpu_coord_descent", &lparam));
+  // blocks of 4, 4 and 2 features
+  updater->Configure({{"eta", "1."}, {"feature_block_size", "4"}});
+  xgboost::HostDeviceVector<xgboost::GradientPair> gpair(
+      (*mat)->Info().num_row_, xgboost::GradientPair(-5, 1.0));
+  xgboost::gbm::GBLinearModel model{&mparam};
+
+  model.LazyInitModel();
+  updater->Update(&gpair, (*mat).get(), &model, gpair.Size());
+
+  ASSERT_EQ(model.bias()[0], 5.0f);
+  // the bias step leaves no gradient, so no feature of any block moves
+  for (size_t i = 0; i < kCols; ++i) {
+    ASSERT_EQ(model[i][0], 0.0f);
+  }
+
+  delete mat;
+}
+
 TEST(GPUCoordinate, JsonIO) {
   TestUpdaterJsonIO("gpu_coord_descent");
 }
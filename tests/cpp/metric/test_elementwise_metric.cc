@@ -2,8 +2,15 @@
  * Copyright 2018-2019 XGBoost contributors
  */
 #include <xgboost/metric.h>
+#include <cmath>
 #include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "../helpers.h"
+#include "../../../src/metric/metric_common.h"
 
 TEST(Metric, DeclareUnifiedTest(RMSE)) {
   auto lparam = xgboost::CreateEmptyGenericParam(GPUIDX);
@@ -101,3 +108,48 @@ TEST(Metric, DeclareUnifiedTest(PoissionNegLogLik)) {
               1.1280f, 0.001f);
   delete metric;
 }
+
+#if !defined(__CUDACC__)
+TEST(Metric, ElementWiseFused) {
+  size_t constexpr kRows = 5000;
+  std::mt19937 rng(1994);
+  std::uniform_real_distribution<float> dist(0.01f, 0.99f);
+  xgboost::MetaInfo info;
+  info.num_row_ = kRows;
+  xgboost::HostDeviceVector<xgboost::bst_float> preds(kRows);
+  auto& h_preds = preds.HostVector();
+  auto& labels = info.labels_.HostVector();
+  auto& weights = info.weights_.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_preds[i] = dist(rng);
+    labels.push_back(dist(rng) > 0.5f ? 1.0f : 0.0f);
+    weights.push_back(dist(rng) * 2.0f);
+  }
+
+  auto lparam = xgboost::CreateEmptyGenericParam(-1);
+  std::vector<std::unique_ptr<xgboost::Metric>> metrics;
+  std::vector<xgboost::metric::ElementWiseMetric*> fused;
+  for (std::string name : {"rmse", "mae", "logloss", "error", "error@0.3"}) {
+    metrics.emplace_back(xgboost::Metric::Create(name, &lparam));
+    metrics.back()->Configure({});
+    fused.push_back(dynamic_cast<xgboost::metric::ElementWiseMetric*>(metrics.back().get()));
+    ASSERT_TRUE(fused.back());
+  }
+  auto results = xgboost::metric::EvalElementWise(fused, preds, info, false);
+  ASSERT_EQ(results.size(), metrics.size());
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    ASSERT_EQ(results[i], metrics[i]->Eval(preds, info, false)) << metrics[i]->Name();
+  }
+
+  // Statistics of the metrics are laid out one after another.
+  auto stats = xgboost::metric::ElementWiseStatistics(fused, preds, info);
+  ASSERT_EQ(stats.size(), metrics.size() * 2);
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    std::vector<double> own;
+    ASSERT_EQ(metrics[i]->EvalStatistics(preds, info, &own), 2);
+    ASSERT_NEAR(own[0], stats[i * 2], 1e-6 * std::abs(own[0]));
+    ASSERT_EQ(own[1], stats[i * 2 + 1]);
+    ASSERT_EQ(metrics[i]->EvalFromStatistics(stats.data() + i * 2), results[i]);
+  }
+}
+#endif  // !defined(__CUDACC__)
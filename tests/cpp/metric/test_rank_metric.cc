@@ -1,8 +1,12 @@
 // Copyright by Contributors
 #include <xgboost/metric.h>
 
+#include <memory>
+#include <vector>
+
 #include "../helpers.h"
 
+#if !defined(__CUDACC__)
 TEST(Metric, AMS) {
   auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
   EXPECT_ANY_THROW(xgboost::Metric::Create("ams", &tparam));
@@ -21,8 +25,9 @@ TEST(Metric, AMS) {
 
   delete metric;
 }
+#endif  // !defined(__CUDACC__)
 
-TEST(Metric, AUC) {
+TEST(Metric, DeclareUnifiedTest(AUC)) {
   auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
   xgboost::Metric * metric = xgboost::Metric::Create("auc", &tparam);
   ASSERT_STREQ(metric->Name(), "auc");
@@ -60,7 +65,54 @@ TEST(Metric, AUC) {
   delete metric;
 }
 
-TEST(Metric, AUCPR) {
+#if !defined(__CUDACC__)
+TEST(Metric, AUCHist) {
+  auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
+  EXPECT_ANY_THROW(xgboost::Metric::Create("auc@hist:0", &tparam));
+  EXPECT_ANY_THROW(xgboost::Metric::Create("auc@sort", &tparam));
+  std::unique_ptr<xgboost::Metric> exact{xgboost::Metric::Create("auc@exact", &tparam)};
+  ASSERT_STREQ(exact->Name(), "auc");
+  std::unique_ptr<xgboost::Metric> metric{xgboost::Metric::Create("auc@hist", &tparam)};
+  ASSERT_STREQ(metric->Name(), "auc@hist");
+  EXPECT_NEAR(GetMetricEval(metric.get(), {0, 1}, {0, 1}), 1, 1e-10);
+  EXPECT_NEAR(GetMetricEval(metric.get(),
+                            {0.1f, 0.9f, 0.1f, 0.9f},
+                            {  0,   0,   1,   1}),
+              0.5f, 0.001f);
+  EXPECT_ANY_THROW(GetMetricEval(metric.get(), {0, 0}, {0, 0}));
+  EXPECT_NEAR(GetMetricEval(metric.get(),
+                            {0.9f, 0.1f, 0.4f, 0.3f},
+                            {0,    0,    1,    1},
+                            {1.0f, 3.0f, 2.0f, 4.0f}),
+              0.75f, 0.001f);
+  // ranking groups are sorted
+  EXPECT_NEAR(GetMetricEval(metric.get(),
+                            {0.9f, 0.1f, 0.4f, 0.3f, 0.7f},
+                            {0.1f, 0.2f, 0.3f, 0.4f, 0.5f},
+                            {},
+                            {0, 2, 5}),
+              0.4741f, 0.001f);
+
+  size_t constexpr kRows = 10000;
+  xgboost::SimpleLCG lcg;
+  xgboost::SimpleRealUniformDistribution<float> dist(0.0f, 1.0f);
+  std::vector<float> h_preds(kRows), labels(kRows), weights(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_preds[i] = dist(&lcg);
+    labels[i] = dist(&lcg) < h_preds[i] ? 1.0f : 0.0f;
+    weights[i] = dist(&lcg) + 0.5f;
+  }
+  using Preds = xgboost::HostDeviceVector<float>;
+  auto expected = GetMetricEval(exact.get(), Preds(h_preds), labels, weights);
+  EXPECT_NEAR(GetMetricEval(metric.get(), Preds(h_preds), labels, weights), expected, 1e-4);
+  // coarse bins are less accurate
+  std::unique_ptr<xgboost::Metric> coarse{xgboost::Metric::Create("auc@hist:16", &tparam)};
+  ASSERT_STREQ(coarse->Name(), "auc@hist:16");
+  EXPECT_NEAR(GetMetricEval(coarse.get(), Preds(h_preds), labels, weights), expected, 0.02);
+}
+#endif  // !defined(__CUDACC__)
+
+TEST(Metric, DeclareUnifiedTest(AUCPR)) {
   auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
   xgboost::Metric *metric = xgboost::Metric::Create("aucpr", &tparam);
   ASSERT_STREQ(metric->Name(), "aucpr");
@@ -112,7 +164,7 @@ TEST(Metric, AUCPR) {
 }
 
 
-TEST(Metric, Precision) {
+TEST(Metric, DeclareUnifiedTest(Precision)) {
   // When the limit for precision is not given, it takes the limit at
   // std::numeric_limits<unsigned>::max(); hence all values are very small
   // NOTE(AbdealiJK): Maybe this should be fixed to be num_row by default.
@@ -139,7 +191,7 @@ TEST(Metric, Precision) {
   delete metric;
 }
 
-TEST(Metric, NDCG) {
+TEST(Metric, DeclareUnifiedTest(NDCG)) {
   auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
   xgboost::Metric * metric = xgboost::Metric::Create("ndcg", &tparam);
   ASSERT_STREQ(metric->Name(), "ndcg");
@@ -197,7 +249,7 @@ TEST(Metric, NDCG) {
   delete metric;
 }
 
-TEST(Metric, MAP) {
+TEST(Metric, DeclareUnifiedTest(MAP)) {
   auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
   xgboost::Metric * metric = xgboost::Metric::Create("map", &tparam);
   ASSERT_STREQ(metric->Name(), "map");
@@ -242,3 +294,15 @@ TEST(Metric, MAP) {
               0.25f, 0.001f);
   delete metric;
 }
+
+TEST(Metric, DeclareUnifiedTest(CoxNLogLik)) {
+  auto tparam = xgboost::CreateEmptyGenericParam(GPUIDX);
+  xgboost::Metric * metric = xgboost::Metric::Create("cox-nloglik", &tparam);
+  ASSERT_STREQ(metric->Name(), "cox-nloglik");
+  // rows with times 3 and -3 are tied, both belong to the risk set of the event at 3
+  EXPECT_NEAR(GetMetricEval(metric,
+                            {1.0f, 2.0f, 0.5f, 3.0f, 1.5f},
+                            {   1,   -2,    2,    3,   -3}),
+              1.70799f, 0.001f);
+  delete metric;
+}
@@ -3,6 +3,11 @@
  */
 #include <xgboost/objective.h>
 #include <xgboost/generic_parameters.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "../../src/common/common.h"
 #include "../helpers.h"
 
@@ -77,4 +82,81 @@ TEST(Objective, DeclareUnifiedTest(SoftprobMultiClassBasic)) {
     EXPECT_NEAR(preds[i], out_preds[i], 0.01f);
   }
 }
+
+TEST(Objective, DeclareUnifiedTest(SoftmaxMultiClassLarge)) {
+  // Enough classes for the vector kernels on CPU and the warp per row kernels on GPU.
+  size_t constexpr kRows = 37, kClasses = 203;
+  GenericParameter lparam = CreateEmptyGenericParam(GPUIDX);
+  std::vector<float> h_preds(kRows * kClasses);
+  SimpleLCG gen(7);
+  SimpleRealUniformDistribution<float> dist(-8.0f, 8.0f);
+  for (auto& v : h_preds) {
+    v = dist(&gen);
+  }
+  MetaInfo info;
+  info.num_row_ = kRows;
+  auto& labels = info.labels_.HostVector();
+  auto& weights = info.weights_.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    labels.push_back(static_cast<float>((i * 31) % kClasses));
+    weights.push_back(0.5f + static_cast<float>(i % 3));
+  }
+
+  // Reference values computed the same way as the scalar kernel.
+  std::vector<float> softmax(h_preds.size());
+  std::vector<float> grad(h_preds.size()), hess(h_preds.size());
+  for (size_t i = 0; i < kRows; ++i) {
+    float const* point = h_preds.data() + i * kClasses;
+    float wmax = std::numeric_limits<float>::min();
+    double wsum = 0;
+    for (size_t k = 0; k < kClasses; ++k) { wmax = std::fmax(point[k], wmax); }
+    for (size_t k = 0; k < kClasses; ++k) { wsum += std::exp(point[k] - wmax); }
+    for (size_t k = 0; k < kClasses; ++k) {
+      float p = std::exp(point[k] - wmax) / static_cast<float>(wsum);
+      softmax[i * kClasses + k] = p;
+      hess[i * kClasses + k] = std::fmax(2.0f * p * (1.0f - p) * weights[i], 1e-16f);
+      p = labels[i] == k ? p - 1.0f : p;
+      grad[i * kClasses + k] = p * weights[i];
+    }
+  }
+
+  for (auto fast : {"0", "1"}) {
+    float const tol = fast[0] == '1' ? 1e-5f : 1e-6f;
+    std::unique_ptr<ObjFunction> obj {ObjFunction::Create("multi:softprob", &lparam)};
+    obj->Configure({{"num_class", std::to_string(kClasses)}, {"fast_softmax", fast}});
+    HostDeviceVector<float> preds{h_preds};
+    HostDeviceVector<GradientPair> gpair;
+    obj->GetGradient(preds, info, 0, &gpair);
+    auto const& h_gpair = gpair.ConstHostVector();
+    ASSERT_EQ(h_gpair.size(), grad.size());
+    for (size_t i = 0; i < h_gpair.size(); ++i) {
+      ASSERT_NEAR(h_gpair[i].GetGrad(), grad[i], tol);
+      ASSERT_NEAR(h_gpair[i].GetHess(), hess[i], tol);
+    }
+
+    obj->PredTransform(&preds);
+    auto const& h_out = preds.ConstHostVector();
+    for (size_t i = 0; i < h_out.size(); ++i) {
+      ASSERT_NEAR(h_out[i], softmax[i], tol);
+    }
+
+    std::unique_ptr<ObjFunction> argmax {ObjFunction::Create("multi:softmax", &lparam)};
+    argmax->Configure({{"num_class", std::to_string(kClasses)}, {"fast_softmax", fast}});
+    HostDeviceVector<float> classes{h_preds};
+    argmax->PredTransform(&classes);
+    auto const& h_classes = classes.ConstHostVector();
+    ASSERT_EQ(h_classes.size(), kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      auto begin = h_preds.cbegin() + i * kClasses;
+      ASSERT_EQ(h_classes[i], std::max_element(begin, begin + kClasses) - begin);
+    }
+  }
+
+  labels[3] = static_cast<float>(kClasses);
+  std::unique_ptr<ObjFunction> obj {ObjFunction::Create("multi:softprob", &lparam)};
+  obj->Configure({{"num_class", std::to_string(kClasses)}});
+  HostDeviceVector<float> preds{h_preds};
+  HostDeviceVector<GradientPair> gpair;
+  EXPECT_ANY_THROW(obj->GetGradient(preds, info, 0, &gpair));
+}
 }  // namespace xgboost
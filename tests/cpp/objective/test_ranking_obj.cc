@@ -134,4 +134,31 @@ TEST(Objective, DeclareUnifiedTest(MAPRankingGPair)) {
   ASSERT_NO_THROW(obj->DefaultEvalMetric());
 }
 
+TEST(Objective, DeclareUnifiedTest(NDCGTruncation)) {
+  xgboost::GenericParameter lparam = xgboost::CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<ObjFunction> obj {ObjFunction::Create("rank:ndcg", &lparam)};
+  obj->Configure({{"lambdarank_truncation", "1"}});
+  // Only the pairs with the top item: (0, 1) and (0, 2), the last item has the same label
+  // as the top one.
+  CheckRankingObjFunction(obj,
+                          {0.3f, 0.2f, 0.1f, 0.0f},
+                          {0,    1,    1,    0},
+                          {},
+                          {0, 4},
+                          {1.0748f, -0.5250f, -0.5498f, 0.0f},
+                          {0.9938f,  0.4988f,  0.4950f, 0.0f});
+  // Every pair is used for a group within the truncation, num_pairsample has no effect.
+  obj->Configure({{"lambdarank_truncation", "4"}, {"num_pairsample", "3"}});
+  CheckRankingObjFunction(obj,
+                          {0.3f, 0.2f, 0.1f, 0.0f},
+                          {0,    1,    1,    0},
+                          {},
+                          {0, 4},
+                          {0.2874f, -0.1741f, -0.1888f, 0.0755f},
+                          {0.2646f,  0.1736f,  0.1730f, 0.0820f});
+
+  std::unique_ptr<ObjFunction> map {ObjFunction::Create("rank:map", &lparam)};
+  EXPECT_ANY_THROW(map->Configure({{"lambdarank_truncation", "1"}}));
+}
+
 }  // namespace xgboost
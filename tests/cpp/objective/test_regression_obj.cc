@@ -5,7 +5,10 @@
 #include <xgboost/objective.h>
 #include <xgboost/generic_parameters.h>
 #include <xgboost/json.h>
+#include <xgboost/metric.h>
+#include <random>
 #include "../helpers.h"
+#include "../../../src/metric/metric_common.h"
 namespace xgboost {
 
 TEST(Objective, DeclareUnifiedTest(LinearRegressionGPair)) {
@@ -331,9 +334,7 @@ TEST(Objective, DeclareUnifiedTest(TweedieRegressionBasic)) {
   }
 }
 
-// CoxRegression not implemented in GPU code, no need for testing.
-#if !defined(__CUDACC__)
-TEST(Objective, CoxRegressionGPair) {
+TEST(Objective, DeclareUnifiedTest(CoxRegressionGPair)) {
   GenericParameter lparam = CreateEmptyGenericParam(GPUIDX);
   std::vector<std::pair<std::string, std::string>> args;
   std::unique_ptr<ObjFunction> obj {
@@ -348,6 +349,152 @@ TEST(Objective, CoxRegressionGPair) {
                    { 0,    0,    0, -0.799f, -0.788f, -0.590f, 0.910f,  1.006f},
                    { 0,    0,    0,  0.160f,  0.186f,  0.348f, 0.610f,  0.639f});
 }
+
+TEST(Objective, DeclareUnifiedTest(CoxRegressionLarge)) {
+  // more rows than a scan block, with tied times across block boundaries
+  size_t constexpr kRows = 10000;
+  GenericParameter lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<ObjFunction> obj {
+    ObjFunction::Create("survival:cox", &lparam)
+  };
+  obj->Configure({});
+
+  std::mt19937 rng(1994);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> time(1, 50);
+  MetaInfo info;
+  info.num_row_ = kRows;
+  HostDeviceVector<bst_float> preds(kRows);
+  auto& h_labels = info.labels_.HostVector();
+  auto& h_weights = info.weights_.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    preds.HostVector()[i] = dist(rng);
+    h_labels.push_back(time(rng) * (dist(rng) > -0.5f ? 1.0f : -1.0f));
+    h_weights.push_back(dist(rng) + 1.5f);
+  }
+
+  // sequential pass of the original implementation
+  auto const& order = info.LabelAbsSort();
+  auto const& h_preds = preds.ConstHostVector();
+  double exp_p_sum = 0;
+  for (size_t i = 0; i < kRows; ++i) {
+    exp_p_sum += std::exp(h_preds[i]);
+  }
+  std::vector<GradientPair> expected(kRows);
+  double r_k = 0, s_k = 0, last_exp_p = 0, last_abs_y = 0, accumulated_sum = 0;
+  for (size_t i = 0; i < kRows; ++i) {
+    size_t const ind = order[i];
+    double const exp_p = std::exp(h_preds[ind]);
+    double const y = h_labels[ind];
+    accumulated_sum += last_exp_p;
+    if (last_abs_y < std::abs(y)) {
+      exp_p_sum -= accumulated_sum;
+      accumulated_sum = 0;
+    }
+    if (y > 0) {
+      r_k += 1.0 / exp_p_sum;
+      s_k += 1.0 / (exp_p_sum * exp_p_sum);
+    }
+    double const w = h_weights[ind];
+    expected[ind] = GradientPair((exp_p * r_k - (y > 0)) * w,
+                                 (exp_p * r_k - exp_p * exp_p * s_k) * w);
+    last_abs_y = std::abs(y);
+    last_exp_p = exp_p;
+  }
+
+  HostDeviceVector<GradientPair> gpair;
+  obj->GetGradient(preds, info, 0, &gpair);
+  auto const& h_gpair = gpair.ConstHostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    EXPECT_NEAR(h_gpair[i].GetGrad(), expected[i].GetGrad(), 1e-4);
+    EXPECT_NEAR(h_gpair[i].GetHess(), expected[i].GetHess(), 1e-4);
+  }
+}
+
+#if !defined(__CUDACC__)
+TEST(Objective, GradientWithMetrics) {
+  size_t constexpr kRows = 4100;
+  GenericParameter lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<ObjFunction> obj {ObjFunction::Create("binary:logistic", &lparam)};
+  obj->Configure({{"scale_pos_weight", "2"}});
+  auto* fused_obj = dynamic_cast<metric::FusedMetricObjective*>(obj.get());
+  ASSERT_TRUE(fused_obj);
+
+  std::mt19937 rng(1994);
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  MetaInfo info;
+  info.num_row_ = kRows;
+  HostDeviceVector<bst_float> preds(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    preds.HostVector()[i] = dist(rng);
+    info.labels_.HostVector().push_back(dist(rng) > 0 ? 1.0f : 0.0f);
+    info.weights_.HostVector().push_back(dist(rng) + 2.0f);
+  }
+
+  std::vector<std::unique_ptr<Metric>> metrics;
+  std::vector<metric::ElementWiseMetric*> fused;
+  for (auto name : {"logloss", "error"}) {
+    metrics.emplace_back(Metric::Create(name, &lparam));
+    metrics.back()->Configure({});
+    fused.push_back(dynamic_cast<metric::ElementWiseMetric*>(metrics.back().get()));
+  }
+  HostDeviceVector<GradientPair> fused_gpair;
+  std::vector<metric::PackedReduceResult> blocks;
+  fused_obj->GetGradientWithMetrics(preds, info, fused, &fused_gpair, &blocks);
+  auto results = metric::FinalizeElementWise(fused, blocks, false);
+
+  HostDeviceVector<GradientPair> gpair;
+  obj->GetGradient(preds, info, 0, &gpair);
+  ASSERT_EQ(gpair.ConstHostVector(), fused_gpair.ConstHostVector());
+  HostDeviceVector<bst_float> transformed;
+  transformed.Resize(kRows);
+  transformed.Copy(preds);
+  obj->EvalTransform(&transformed);
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    ASSERT_EQ(results[i], metrics[i]->Eval(transformed, info, false));
+  }
+}
+
+TEST(Objective, ElementWiseGradient) {
+  size_t constexpr kRows = 4100;
+  GenericParameter lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<ObjFunction> obj {ObjFunction::Create("binary:logistic", &lparam)};
+  obj->Configure({{"scale_pos_weight", "2"}});
+
+  std::mt19937 rng(1994);
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  MetaInfo info;
+  info.num_row_ = kRows;
+  HostDeviceVector<bst_float> preds(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    preds.HostVector()[i] = dist(rng);
+    info.labels_.HostVector().push_back(dist(rng) > 0 ? 1.0f : 0.0f);
+    info.weights_.HostVector().push_back(dist(rng) + 2.0f);
+  }
+  HostDeviceVector<GradientPair> gpair;
+  obj->GetGradient(preds, info, 0, &gpair);
+
+  auto grad = obj->GetElementWiseGradient(preds, info, 0);
+  ASSERT_TRUE(grad);
+  ASSERT_EQ(grad->Size(), kRows);
+  HostDeviceVector<GradientPair> lazy_gpair;
+  grad->ComputeAll(&lazy_gpair);
+  ASSERT_EQ(gpair.ConstHostVector(), lazy_gpair.ConstHostVector());
+  // blocks of rows
+  std::vector<GradientPair> block(10);
+  grad->Compute(100, 110, block.data());
+  for (size_t i = 0; i < block.size(); ++i) {
+    ASSERT_EQ(block[i], gpair.ConstHostVector()[100 + i]);
+  }
+  grad->Validate();
+
+  info.labels_.HostVector()[7] = 3.0f;
+  grad = obj->GetElementWiseGradient(preds, info, 0);
+  grad->Compute(0, 5, block.data());
+  ASSERT_NO_THROW(grad->Validate());
+  grad->Compute(5, 10, block.data());
+  ASSERT_THROW(grad->Validate(), dmlc::Error);
+}
 #endif
 
 }  // namespace xgboost
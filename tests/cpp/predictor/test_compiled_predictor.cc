@@ -0,0 +1,99 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/learner.h>
+#include <xgboost/predictor.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/gbm/gbtree_model.h"
+#include "../../../src/predictor/compiled_model.h"
+
+namespace xgboost {
+namespace predictor {
+TEST(CompiledPredictor, GenerateSource) {
+  LearnerModelParam param;
+  param.num_feature = 4;
+  param.base_score = 0.5;
+  param.num_output_group = 1;
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.emplace_back(new RegTree);
+  trees.back()->ExpandNode(0, 2, 0.5f, true, 0.0f, -1.0f, 2.0f, 0.0f, 0.0f);
+  model.CommitModel(std::move(trees), 0);
+
+  std::string const source = GenerateModelSource(model);
+  ASSERT_NE(source.find("static float tree_0(const float* f) {\n  return 1.5E0f;\n}"),
+            std::string::npos);
+  // missing values go left
+  ASSERT_NE(source.find("if (!(f[2] >= 5E-1f)) {\n    return (-1E0f);\n"
+                        "  } else {\n    return 2E0f;\n  }"),
+            std::string::npos);
+  ASSERT_NE(source.find("s[0] += tree_1(f);"), std::string::npos);
+}
+
+#if defined(__unix__)
+namespace {
+void TestCompiledPredictor(Args args, size_t n_classes) {
+  size_t constexpr kRows = 128, kCols = 8;
+  int32_t constexpr kIters = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 7);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_labels[i] = static_cast<float>(i % n_classes);
+  }
+
+  std::unique_ptr<Learner> learner {Learner::Create({p_dmat})};
+  learner->SetParams(args);
+  for (int32_t iter = 0; iter < kIters; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+
+  HostDeviceVector<float> expected, expected_limit;
+  learner->Predict(p_dmat, true, &expected, 0, false);
+  learner->Predict(p_dmat, true, &expected_limit, 2, false);
+
+  learner->SetParam("predictor", "compiled_predictor");
+  HostDeviceVector<float> predt, predt_limit;
+  learner->Predict(p_dmat, true, &predt, 0, false);
+  learner->Predict(p_dmat, true, &predt_limit, 2, false);
+
+  auto check = [](HostDeviceVector<float> const& lhs, HostDeviceVector<float> const& rhs) {
+    auto const& h_lhs = lhs.ConstHostVector();
+    auto const& h_rhs = rhs.ConstHostVector();
+    ASSERT_EQ(h_lhs.size(), h_rhs.size());
+    for (size_t i = 0; i < h_lhs.size(); ++i) {
+      ASSERT_NEAR(h_lhs[i], h_rhs[i], kRtEps);
+    }
+  };
+  check(expected, predt);
+  check(expected_limit, predt_limit);
+
+  // single rows
+  auto const& h_expected = expected.ConstHostVector();
+  auto& batch = *p_dmat->GetBatches<SparsePage>().begin();
+  std::vector<float> out(n_classes);
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    size_t n = learner->PredictRow(batch[i], true, common::Span<float>(out));
+    ASSERT_EQ(n, n_classes == 2 ? 1 : n_classes);
+    for (size_t k = 0; k < n; ++k) {
+      ASSERT_NEAR(out[k], h_expected[i * n + k], kRtEps);
+    }
+  }
+  delete pp_dmat;
+}
+}  // anonymous namespace
+
+TEST(CompiledPredictor, Predict) {
+  TestCompiledPredictor({{"objective", "binary:logistic"}}, 2);
+  TestCompiledPredictor({{"objective", "multi:softprob"}, {"num_class", "3"}}, 3);
+}
+#endif  // defined(__unix__)
+}  // namespace predictor
+}  // namespace xgboost
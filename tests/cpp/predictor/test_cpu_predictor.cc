@@ -2,10 +2,19 @@
  * Copyright 2017-2020 XGBoost contributors
  */
 #include <dmlc/filesystem.h>
+#include <dmlc/omp.h>
 #include <gtest/gtest.h>
+#include <xgboost/json.h>
 #include <xgboost/predictor.h>
 
+#include <limits>
+#include <memory>
+#include <string>
+
 #include "../helpers.h"
+#include "../../../src/data/adapter.h"
+#include "../../../src/data/dense_view_dmatrix.h"
+#include "../../../src/data/simple_dmatrix.h"
 #include "../../../src/gbm/gbtree_model.h"
 
 namespace xgboost {
@@ -78,6 +87,530 @@ TEST(CpuPredictor, Basic) {
   delete dmat;
 }
 
+namespace {
+// Small trees cycling through the features, every other tree with a second level.
+gbm::GBTreeModel CreateMultiClassModel(LearnerModelParam const* param, size_t rounds) {
+  gbm::GBTreeModel model(param);
+  size_t const n_classes = param->num_output_group;
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t gid = 0; gid < n_classes; ++gid) {
+      size_t const t = r * n_classes + gid;
+      std::vector<std::unique_ptr<RegTree>> trees;
+      trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+      trees.back()->ExpandNode(0, t % param->num_feature, 0.5f, t % 2 == 0, 0.0f,
+                               0.1f * (t + 1), -0.2f * (t + 1), 1.0f, 1.0f);
+      trees.back()->Stat(0).sum_hess = 2.0f;
+      trees.back()->Stat(1).sum_hess = 1.0f;
+      trees.back()->Stat(2).sum_hess = 1.0f;
+      if (t % 2 == 1) {
+        trees.back()->ExpandNode(2, (t + 1) % param->num_feature, 0.3f, t % 4 == 1, 0.0f,
+                                 0.05f * (t + 1), 0.3f, 1.0f, 1.0f);
+        trees.back()->Stat(3).sum_hess = 0.5f;
+        trees.back()->Stat(4).sum_hess = 0.5f;
+      }
+      model.CommitModel(std::move(trees), gid);
+    }
+  }
+  return model;
+}
+}  // anonymous namespace
+
+TEST(CpuPredictor, BlockedTraversal) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  // Neither the rows nor the trees are a multiple of the block sizes.
+  size_t constexpr kRows = 203;
+  size_t constexpr kCols = 5;
+  size_t constexpr kClasses = 3;
+  size_t constexpr kRounds = 7;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, kRounds);
+
+  auto dmat = CreateDMatrix(kRows, kCols, 0.3);
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+  ASSERT_EQ(out_predictions_h.size(), kRows * kClasses);
+
+  auto &batch = *(*dmat)->GetBatches<xgboost::SparsePage>().begin();
+  for (size_t i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    for (size_t gid = 0; gid < kClasses; ++gid) {
+      ASSERT_EQ(instance_out_predictions[gid], out_predictions_h[i * kClasses + gid]);
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(CpuPredictor, AdaptiveSchedule) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kCols = 5;
+  size_t constexpr kClasses = 3;
+  size_t constexpr kRounds = 100;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, kRounds);
+
+  int32_t const n_threads = omp_get_max_threads();
+  omp_set_num_threads(4);
+  // serial, split over trees without and with the flattened forest, split over rows
+  for (size_t rows : {1, 10, 60, 100, 300}) {
+    auto dmat = CreateDMatrix(rows, kCols, 0.3);
+    PredictionCacheEntry out_predictions;
+    cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+    auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+    ASSERT_EQ(out_predictions_h.size(), rows * kClasses);
+
+    auto &batch = *(*dmat)->GetBatches<xgboost::SparsePage>().begin();
+    for (size_t i = 0; i < batch.Size(); i++) {
+      std::vector<float> instance_out_predictions;
+      cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+      for (size_t gid = 0; gid < kClasses; ++gid) {
+        // summing chunks of trees reorders the floating point additions
+        ASSERT_NEAR(instance_out_predictions[gid], out_predictions_h[i * kClasses + gid],
+                    std::abs(instance_out_predictions[gid]) * 1e-5);
+      }
+    }
+    delete dmat;
+  }
+  omp_set_num_threads(n_threads);
+}
+
+TEST(CpuPredictor, Staged) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kRows = 100;
+  size_t constexpr kCols = 5;
+  size_t constexpr kClasses = 3;
+  size_t constexpr kRounds = 7;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, kRounds);
+  auto dmat = CreateDMatrix(kRows, kCols, 0.3);
+
+  // an empty stage, the base margin and all the trees
+  std::vector<uint32_t> const iterations {0, 2, 2, 5, kRounds};
+  std::vector<uint32_t> tree_ends;
+  for (auto iteration : iterations) {
+    tree_ends.push_back(iteration * kClasses);
+  }
+  HostDeviceVector<float> staged;
+  cpu_predictor->PredictStaged((*dmat).get(), model, tree_ends, &staged);
+  auto const& h_staged = staged.ConstHostVector();
+  size_t const n = kRows * kClasses;
+  ASSERT_EQ(h_staged.size(), n * iterations.size());
+  for (size_t s = 0; s < iterations.size(); ++s) {
+    if (iterations[s] == 0) {
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(h_staged[s * n + i], param.base_score);
+      }
+      continue;
+    }
+    PredictionCacheEntry out_predictions;
+    cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0, iterations[s]);
+    auto const& h_predictions = out_predictions.predictions.ConstHostVector();
+    for (size_t i = 0; i < n; ++i) {
+      // the stages are summed separately
+      ASSERT_NEAR(h_staged[s * n + i], h_predictions[i], kRtEps);
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(CpuPredictor, DenseTraversal) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kRows = 203;
+  size_t constexpr kCols = 6;
+  size_t constexpr kClasses = 2;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 5);
+  // A layer of chains too deep for the vector kernels, split alternately on both sides.
+  for (size_t gid = 0; gid < kClasses; ++gid) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    bst_node_t nid = 0;
+    for (size_t depth = 0; depth < 16; ++depth) {
+      trees.back()->ExpandNode(nid, (depth + gid) % kCols, 0.1f + 0.05f * depth, false,
+                               0.0f, 0.01f * depth, -0.01f * depth, 1.0f, 1.0f);
+      nid = depth % 2 == 0 ? (*trees.back())[nid].LeftChild()
+                           : (*trees.back())[nid].RightChild();
+    }
+    model.CommitModel(std::move(trees), gid);
+  }
+
+  auto dmat = CreateDMatrix(kRows, kCols, 0);
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+  ASSERT_EQ(out_predictions_h.size(), kRows * kClasses);
+
+  auto &batch = *(*dmat)->GetBatches<xgboost::SparsePage>().begin();
+  for (size_t i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    for (size_t gid = 0; gid < kClasses; ++gid) {
+      ASSERT_EQ(instance_out_predictions[gid], out_predictions_h[i * kClasses + gid]);
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(CpuPredictor, WideSparseTraversal) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kRows = 203;
+  size_t constexpr kCols = 1 << 17;
+  size_t constexpr kClasses = 3;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 7);
+
+  // A few values for each row, some rows with their entries out of order.
+  std::vector<float> data;
+  std::vector<unsigned> feature_idx;
+  std::vector<size_t> row_ptr {0};
+  for (size_t i = 0; i < kRows; ++i) {
+    if (i % 3 == 0) {
+      data.push_back(1.0f);
+      feature_idx.push_back(kCols - 1 - i);
+    }
+    for (size_t j = 0; j < 4; ++j) {
+      data.push_back(static_cast<float>((i * 7 + j * 3) % 11) / 11.0f);
+      feature_idx.push_back((i + j * 5) % 23);
+    }
+    row_ptr.push_back(data.size());
+  }
+  data::CSRAdapter adapter(row_ptr.data(), feature_idx.data(), data.data(), kRows,
+                           data.size(), kCols);
+  std::unique_ptr<DMatrix> dmat(
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1));
+
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+  ASSERT_EQ(out_predictions_h.size(), kRows * kClasses);
+
+  auto &batch = *dmat->GetBatches<xgboost::SparsePage>().begin();
+  for (size_t i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    for (size_t gid = 0; gid < kClasses; ++gid) {
+      ASSERT_EQ(instance_out_predictions[gid], out_predictions_h[i * kClasses + gid]);
+    }
+  }
+}
+
+TEST(CpuPredictor, DenseView) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kCols = 5;
+  size_t constexpr kClasses = 3;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 100);
+
+  int32_t const n_threads = omp_get_max_threads();
+  omp_set_num_threads(4);
+  for (size_t rows : {1, 10, 100, 300}) {
+    std::vector<float> values(rows * kCols);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<float>((i * 7) % 11) / 11.0f;
+    }
+    // a missing value in some of the row blocks only
+    for (size_t r = 3; r < rows; r += 150) {
+      values[r * kCols + 1] = std::numeric_limits<float>::quiet_NaN();
+    }
+    data::DenseAdapter adapter(values.data(), rows, kCols);
+    data::SimpleDMatrix simple(&adapter, std::numeric_limits<float>::quiet_NaN(), 1);
+    data::DenseViewDMatrix view(values.data(), rows, kCols,
+                                std::numeric_limits<float>::quiet_NaN(), 0);
+    ASSERT_EQ(view.Info().num_nonzero_, simple.Info().num_nonzero_);
+
+    PredictionCacheEntry expected, got;
+    cpu_predictor->PredictBatch(&simple, &expected, model, 0);
+    cpu_predictor->PredictBatch(&view, &got, model, 0);
+    // the rows are read in place
+    ASSERT_FALSE(view.PageExists<SparsePage>());
+    auto const& lhs = expected.predictions.ConstHostVector();
+    auto const& rhs = got.predictions.ConstHostVector();
+    ASSERT_EQ(lhs.size(), rhs.size());
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      ASSERT_NEAR(lhs[i], rhs[i], std::abs(lhs[i]) * 1e-6);
+    }
+
+    // other kinds of prediction copy the rows
+    std::vector<float> leaf_expected, leaf_got;
+    cpu_predictor->PredictLeaf(&simple, &leaf_expected, model);
+    cpu_predictor->PredictLeaf(&view, &leaf_got, model);
+    ASSERT_EQ(leaf_expected, leaf_got);
+    ASSERT_TRUE(view.PageExists<SparsePage>());
+  }
+  omp_set_num_threads(n_threads);
+}
+
+TEST(CpuPredictor, InplacePredict) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kCols = 5;
+  size_t constexpr kClasses = 3;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 100);
+
+  for (size_t rows : {1, 100, 300}) {
+    std::vector<float> values(rows * kCols);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<float>((i * 7) % 11) / 11.0f;
+    }
+    for (size_t r = 3; r < rows; r += 150) {
+      values[r * kCols + 1] = std::numeric_limits<float>::quiet_NaN();
+    }
+    data::DenseAdapter adapter(values.data(), rows, kCols);
+    data::SimpleDMatrix simple(&adapter, std::numeric_limits<float>::quiet_NaN(), 1);
+    PredictionCacheEntry expected;
+    cpu_predictor->PredictBatch(&simple, &expected, model, 0);
+    auto const& h_expected = expected.predictions.ConstHostVector();
+
+    Json j_interface {Object()};
+    j_interface["data"] = Array(std::vector<Json>{
+        Json{Integer(reinterpret_cast<int64_t>(values.data()))}, Json{Boolean(true)}});
+    j_interface["shape"] = Array(std::vector<Json>{
+        Json{Integer(static_cast<int64_t>(rows))}, Json{Integer(static_cast<int64_t>(kCols))}});
+    j_interface["typestr"] = String("<f4");
+    j_interface["version"] = Integer(static_cast<int64_t>(2));
+    std::string interface_str;
+    Json::Dump(j_interface, &interface_str);
+    std::shared_ptr<data::ArrayAdapter> dense {new data::ArrayAdapter(interface_str)};
+
+    auto const& page = *simple.GetBatches<SparsePage>().begin();
+    auto const& h_offset = page.offset.ConstHostVector();
+    std::vector<size_t> indptr(h_offset.cbegin(), h_offset.cend());
+    std::vector<unsigned> indices;
+    std::vector<float> csr_values;
+    for (auto const& entry : page.data.ConstHostVector()) {
+      indices.push_back(entry.index);
+      csr_values.push_back(entry.fvalue);
+    }
+    std::shared_ptr<data::CSRAdapter> csr {new data::CSRAdapter(
+        indptr.data(), indices.data(), csr_values.data(), rows, csr_values.size(), kCols)};
+
+    for (dmlc::any x : {dmlc::any{dense}, dmlc::any{csr}}) {
+      HostDeviceVector<float> got;
+      ASSERT_TRUE(cpu_predictor->InplacePredict(x, model,
+                                                std::numeric_limits<float>::quiet_NaN(),
+                                                &got));
+      auto const& h_got = got.ConstHostVector();
+      ASSERT_EQ(h_got.size(), h_expected.size());
+      for (size_t i = 0; i < h_got.size(); ++i) {
+        ASSERT_NEAR(h_got[i], h_expected[i], std::abs(h_expected[i]) * 1e-6);
+      }
+    }
+  }
+  HostDeviceVector<float> out;
+  ASSERT_FALSE(cpu_predictor->InplacePredict(dmlc::any{std::string{}}, model, 0, &out));
+}
+
+TEST(CpuPredictor, MultiClassContribution) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kRows = 16;
+  size_t constexpr kCols = 4;
+  size_t constexpr kClasses = 4;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 3);
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2);
+
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+
+  std::vector<float> out_contribution;
+  cpu_predictor->PredictContribution((*dmat).get(), &out_contribution, model);
+  ASSERT_EQ(out_contribution.size(), kRows * kClasses * (kCols + 1));
+  // Contributions of each class, including the bias, add up to its margin.
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t gid = 0; gid < kClasses; ++gid) {
+      float sum = 0;
+      for (size_t c = 0; c < kCols + 1; ++c) {
+        sum += out_contribution[(i * kClasses + gid) * (kCols + 1) + c];
+      }
+      ASSERT_NEAR(sum, out_predictions_h[i * kClasses + gid], 1e-5);
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(CpuPredictor, ApproxContribution) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  // more than one block of rows, and of trees
+  size_t constexpr kRows = 150;
+  size_t constexpr kCols = 4;
+  size_t constexpr kClasses = 3;
+  size_t constexpr kContribs = kCols + 1;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 4);
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2);
+
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  auto const& out_predictions_h = out_predictions.predictions.ConstHostVector();
+  std::vector<float> out_contribution;
+  cpu_predictor->PredictContribution((*dmat).get(), &out_contribution, model, 0, nullptr,
+                                     true);
+  ASSERT_EQ(out_contribution.size(), kRows * kClasses * kContribs);
+  for (size_t i = 0; i < kRows * kClasses; ++i) {
+    float sum = 0;
+    for (size_t c = 0; c < kContribs; ++c) {
+      sum += out_contribution[i * kContribs + c];
+    }
+    ASSERT_NEAR(sum, out_predictions_h[i], 1e-5);
+  }
+
+  // Reference: contributions of each tree on its own, scaled by the tree weight.
+  std::vector<float> tree_weights(model.trees.size());
+  for (size_t j = 0; j < tree_weights.size(); ++j) {
+    tree_weights[j] = 0.5f + 0.25f * j;
+  }
+  cpu_predictor->PredictContribution((*dmat).get(), &out_contribution, model, 0,
+                                     &tree_weights, true);
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  std::vector<float> tree_contribs(kContribs);
+  auto const& batch = *(*dmat)->GetBatches<SparsePage>().begin();
+  for (size_t i = 0; i < kRows; ++i) {
+    std::vector<float> expected(kClasses * kContribs, 0.0f);
+    for (size_t gid = 0; gid < kClasses; ++gid) {
+      expected[gid * kContribs + kCols] = param.base_score;
+    }
+    feats.Fill(batch[i]);
+    for (size_t j = 0; j < model.trees.size(); ++j) {
+      std::fill(tree_contribs.begin(), tree_contribs.end(), 0.0f);
+      model.trees[j]->CalculateContributionsApprox(feats, tree_contribs.data());
+      for (size_t c = 0; c < kContribs; ++c) {
+        expected[model.tree_info[j] * kContribs + c] += tree_contribs[c] * tree_weights[j];
+      }
+    }
+    feats.Drop(batch[i]);
+    for (size_t k = 0; k < expected.size(); ++k) {
+      ASSERT_NEAR(out_contribution[i * kClasses * kContribs + k], expected[k], 1e-5);
+    }
+  }
+
+  delete dmat;
+}
+
+TEST(CpuPredictor, InteractionContributions) {
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kRows = 16;
+  size_t constexpr kCols = 4;
+  size_t constexpr kClasses = 2;
+  size_t constexpr kContribs = kCols + 1;
+
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 3);
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2);
+
+  std::vector<float> out_interactions;
+  cpu_predictor->PredictInteractionContributions((*dmat).get(), &out_interactions, model);
+  ASSERT_EQ(out_interactions.size(), kRows * kClasses * kContribs * kContribs);
+
+  // Reference: condition the contributions of the whole forest on every feature.
+  std::vector<float> diag, on, off;
+  cpu_predictor->PredictContribution((*dmat).get(), &diag, model);
+  for (size_t f = 0; f < kContribs; ++f) {
+    cpu_predictor->PredictContribution((*dmat).get(), &off, model, 0, nullptr, false, -1, f);
+    cpu_predictor->PredictContribution((*dmat).get(), &on, model, 0, nullptr, false, 1, f);
+    for (size_t i = 0; i < kRows; ++i) {
+      for (size_t gid = 0; gid < kClasses; ++gid) {
+        size_t const c_offset = (i * kClasses + gid) * kContribs;
+        size_t const o_offset = (c_offset + f) * kContribs;
+        float main_effect = diag[c_offset + f];
+        for (size_t k = 0; k < kContribs; ++k) {
+          if (k == f) {
+            continue;
+          }
+          float const interaction = (on[c_offset + k] - off[c_offset + k]) / 2.0;
+          main_effect -= interaction;
+          ASSERT_NEAR(out_interactions[o_offset + k], interaction, 1e-5);
+        }
+        ASSERT_NEAR(out_interactions[o_offset + f], main_effect, 1e-5);
+      }
+    }
+  }
+
+  delete dmat;
+}
+
 TEST(CpuPredictor, ExternalMemory) {
   dmlc::TemporaryDirectory tmpdir;
   std::string filename = tmpdir.path + "/big.libsvm";
@@ -140,4 +673,41 @@ TEST(CpuPredictor, ExternalMemory) {
     }
   }
 }
+
+TEST(CpuPredictor, Stream) {
+  dmlc::TemporaryDirectory tmpdir;
+  std::string filename = tmpdir.path + "/big.libsvm";
+  // several pages of rows
+  std::unique_ptr<DMatrix> dmat = CreateSparsePageDMatrix(12, 64, filename);
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &lparam));
+
+  size_t constexpr kClasses = 3;
+  LearnerModelParam param;
+  param.num_feature = dmat->Info().num_col_;
+  param.base_score = 0.5;
+  param.num_output_group = kClasses;
+  gbm::GBTreeModel model = CreateMultiClassModel(&param, 4);
+
+  PredictionCacheEntry out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  auto const& h_predictions = out_predictions.predictions.ConstHostVector();
+
+  size_t next_row = 0, n_pages = 0;
+  cpu_predictor->PredictStream(
+      dmat.get(), model, model.trees.size(),
+      [&](size_t base_row, common::Span<bst_float const> preds) {
+        // pages arrive one at a time, in the order of the rows
+        ASSERT_EQ(base_row, next_row);
+        ASSERT_EQ(preds.size() % kClasses, 0u);
+        for (size_t i = 0; i < preds.size(); ++i) {
+          ASSERT_EQ(preds[i], h_predictions[base_row * kClasses + i]);
+        }
+        next_row += preds.size() / kClasses;
+        ++n_pages;
+      });
+  ASSERT_EQ(next_row, dmat->Info().num_row_);
+  ASSERT_GT(n_pages, 1u);
+}
 }  // namespace xgboost
@@ -0,0 +1,79 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <dmlc/filesystem.h>
+#include <gtest/gtest.h>
+#include <xgboost/learner.h>
+
+#include <memory>
+#include <string>
+
+#include "../helpers.h"
+#include "../../../src/predictor/flat_model.h"
+
+namespace xgboost {
+namespace predictor {
+namespace {
+void TestFlatModel(Args const& args, size_t n_classes) {
+  size_t constexpr kRows = 64, kCols = 8;
+  int32_t constexpr kIters = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 7);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_labels[i] = static_cast<float>(i % n_classes);
+  }
+
+  std::unique_ptr<Learner> learner {Learner::Create({p_dmat})};
+  learner->SetParams(args);
+  for (int32_t iter = 0; iter < kIters; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+
+  dmlc::TemporaryDirectory tempdir;
+  std::string const fname = tempdir.path + "/model.flat";
+  {
+    std::unique_ptr<dmlc::Stream> fo {dmlc::Stream::Create(fname.c_str(), "w")};
+    learner->SaveFlatModel(fo.get());
+  }
+  std::unique_ptr<FlatModel> flat {FlatModel::Load(fname)};
+#if defined(__unix__)
+  ASSERT_TRUE(flat->Mapped());
+#endif  // defined(__unix__)
+  ASSERT_EQ(flat->NumFeature(), kCols);
+
+  for (bool output_margin : {true, false}) {
+    HostDeviceVector<float> expected, predt;
+    learner->Predict(p_dmat, output_margin, &expected, 0, false);
+    flat->Predict(p_dmat.get(), output_margin, &predt);
+    auto const& h_expected = expected.ConstHostVector();
+    auto const& h_predt = predt.ConstHostVector();
+    ASSERT_EQ(h_expected.size(), h_predt.size());
+    for (size_t i = 0; i < h_expected.size(); ++i) {
+      ASSERT_NEAR(h_expected[i], h_predt[i], kRtEps);
+    }
+  }
+  delete pp_dmat;
+}
+}  // anonymous namespace
+
+TEST(FlatModel, Predict) {
+  TestFlatModel({{"objective", "binary:logistic"}}, 2);
+  TestFlatModel({{"objective", "multi:softprob"}, {"num_class", "3"}}, 3);
+  TestFlatModel({{"booster", "dart"}, {"objective", "reg:squarederror"},
+                 {"rate_drop", "0.5"}}, 2);
+}
+
+TEST(FlatModel, InvalidFile) {
+  dmlc::TemporaryDirectory tempdir;
+  std::string const fname = tempdir.path + "/model.flat";
+  {
+    std::unique_ptr<dmlc::Stream> fo {dmlc::Stream::Create(fname.c_str(), "w")};
+    std::string const content(128, 'x');
+    fo->Write(content.data(), content.size());
+  }
+  EXPECT_THROW(FlatModel::Load(fname), dmlc::Error);
+}
+}  // namespace predictor
+}  // namespace xgboost
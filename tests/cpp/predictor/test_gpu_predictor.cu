@@ -8,6 +8,7 @@
 #include <xgboost/learner.h>
 
 #include <string>
+#include <thread>
 #include "gtest/gtest.h"
 #include "../helpers.h"
 #include "../../../src/gbm/gbtree_model.h"
@@ -57,6 +58,253 @@ TEST(GPUPredictor, Basic) {
   }
 }
 
+TEST(GPUPredictor, ModelCache) {
+  auto cpu_lparam = CreateEmptyGenericParam(-1);
+  auto gpu_lparam = CreateEmptyGenericParam(0);
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor", &gpu_lparam));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &cpu_lparam));
+  gpu_predictor->Configure({});
+  cpu_predictor->Configure({});
+
+  size_t constexpr kRows = 16, kCols = 4;
+  auto dmat = CreateDMatrix(kRows, kCols, 0);
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  auto check = [&](gbm::GBTreeModel const& model) {
+    PredictionCacheEntry gpu_out_predictions;
+    PredictionCacheEntry cpu_out_predictions;
+    gpu_predictor->PredictBatch((*dmat).get(), &gpu_out_predictions, model, 0);
+    cpu_predictor->PredictBatch((*dmat).get(), &cpu_out_predictions, model, 0);
+    auto const& gpu_h = gpu_out_predictions.predictions.ConstHostVector();
+    auto const& cpu_h = cpu_out_predictions.predictions.ConstHostVector();
+    for (size_t i = 0; i < gpu_h.size(); ++i) {
+      ASSERT_NEAR(gpu_h[i], cpu_h[i], 1e-6);
+    }
+  };
+
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  check(model);
+  // trees appended after the device copy was made
+  for (size_t i = 0; i < 3; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i, 0.5f, true, 0.0f, 0.1f * i, -0.3f, 1.0f, 1.0f);
+    model.CommitModel(std::move(trees), 0);
+    check(model);
+  }
+  // a different model with as many trees
+  gbm::GBTreeModel other = CreateTestModel(&param);
+  for (size_t i = 0; i < 3; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i, 0.2f, false, 0.0f, -0.6f, 0.4f * i, 1.0f, 1.0f);
+    other.CommitModel(std::move(trees), 0);
+  }
+  check(other);
+  delete dmat;
+}
+
+TEST(GPUPredictor, WideData) {
+  auto cpu_lparam = CreateEmptyGenericParam(-1);
+  auto gpu_lparam = CreateEmptyGenericParam(0);
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor", &gpu_lparam));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &cpu_lparam));
+  gpu_predictor->Configure({});
+  cpu_predictor->Configure({});
+
+  size_t constexpr kRows = 300;
+  // rows of the widest matrix don't fit in shared memory even for a warp
+  for (size_t cols : {200, 20000}) {
+    auto dmat = CreateDMatrix(kRows, cols, 0.5);
+    LearnerModelParam param;
+    param.num_feature = cols;
+    param.num_output_group = 1;
+    param.base_score = 0.5;
+    gbm::GBTreeModel model = CreateTestModel(&param);
+    for (size_t i = 0; i < 4; ++i) {
+      std::vector<std::unique_ptr<RegTree>> trees;
+      trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+      trees.back()->ExpandNode(0, (i * 7919) % cols, 0.5f, i % 2 == 0, 0.0f, 0.1f * i,
+                               -0.3f, 1.0f, 1.0f);
+      trees.back()->ExpandNode(2, cols - 1 - i, 0.3f, i % 2 == 1, 0.0f, 0.2f, -0.1f * i,
+                               1.0f, 1.0f);
+      model.CommitModel(std::move(trees), 0);
+    }
+
+    PredictionCacheEntry gpu_out_predictions;
+    PredictionCacheEntry cpu_out_predictions;
+    gpu_predictor->PredictBatch((*dmat).get(), &gpu_out_predictions, model, 0);
+    cpu_predictor->PredictBatch((*dmat).get(), &cpu_out_predictions, model, 0);
+    auto const& gpu_h = gpu_out_predictions.predictions.ConstHostVector();
+    auto const& cpu_h = cpu_out_predictions.predictions.ConstHostVector();
+    ASSERT_EQ(gpu_h.size(), kRows);
+    for (size_t i = 0; i < gpu_h.size(); ++i) {
+      ASSERT_NEAR(gpu_h[i], cpu_h[i], 1e-6);
+    }
+    delete dmat;
+  }
+}
+
+TEST(GPUPredictor, Concurrent) {
+  auto gpu_lparam = CreateEmptyGenericParam(0);
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor", &gpu_lparam));
+  gpu_predictor->Configure({});
+
+  size_t constexpr kRows = 1000, kCols = 8, kThreads = 4;
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  for (size_t i = 0; i < 16; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % kCols, 0.3f, i % 2 == 0, 0.0f, 0.1f * i, -0.2f, 1.0f,
+                             1.0f);
+    model.CommitModel(std::move(trees), 0);
+  }
+
+  // each thread predicts its own matrix on its own stream
+  std::vector<std::shared_ptr<DMatrix>> dmats;
+  std::vector<std::vector<float>> expected(kThreads);
+  for (size_t t = 0; t < kThreads; ++t) {
+    auto pp_dmat = CreateDMatrix(kRows, kCols, 0.1 * t);
+    dmats.push_back(*pp_dmat);
+    delete pp_dmat;
+    PredictionCacheEntry predts;
+    gpu_predictor->PredictBatch(dmats.back().get(), &predts, model, 0);
+    expected[t] = predts.predictions.ConstHostVector();
+  }
+  std::vector<PredictionCacheEntry> got(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      gpu_predictor->PredictBatch(dmats[t].get(), &got[t], model, 0);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < kThreads; ++t) {
+    ASSERT_EQ(got[t].predictions.ConstHostVector(), expected[t]);
+  }
+}
+
+TEST(GPUPredictor, PredictWeighted) {
+  auto cpu_lparam = CreateEmptyGenericParam(-1);
+  auto gpu_lparam = CreateEmptyGenericParam(0);
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor", &gpu_lparam));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &cpu_lparam));
+  gpu_predictor->Configure({});
+  cpu_predictor->Configure({});
+
+  size_t constexpr kRows = 16, kCols = 4;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.25);
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.num_output_group = 1;
+  param.base_score = 0.5;
+
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  for (size_t i = 0; i < 3; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i, 0.2f, i % 2 == 0, 0.0f, -0.6f, 0.4f * i, 1.0f, 1.0f);
+    model.CommitModel(std::move(trees), 0);
+  }
+  // A subset of trees out of order, as the dart booster passes them.
+  std::vector<size_t> const trees {3, 0, 2};
+  std::vector<float> const weights {0.5f, -1.0f, 2.0f};
+  HostDeviceVector<float> gpu_out(kRows, 1.0f), cpu_out(kRows, 1.0f);
+  gpu_predictor->PredictWeighted((*dmat).get(), &gpu_out, model, trees, weights);
+  cpu_predictor->PredictWeighted((*dmat).get(), &cpu_out, model, trees, weights);
+  auto const& h_gpu_out = gpu_out.ConstHostVector();
+  auto const& h_cpu_out = cpu_out.ConstHostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    ASSERT_NEAR(h_gpu_out[i], h_cpu_out[i], kRtEps);
+  }
+  delete dmat;
+}
+
+TEST(GPUPredictor, Staged) {
+  auto cpu_lparam = CreateEmptyGenericParam(-1);
+  auto gpu_lparam = CreateEmptyGenericParam(0);
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor", &gpu_lparam));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor", &cpu_lparam));
+  gpu_predictor->Configure({});
+  cpu_predictor->Configure({});
+
+  size_t constexpr kRows = 64, kCols = 4, kClasses = 2, kRounds = 5;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.25);
+  LearnerModelParam param;
+  param.num_feature = kCols;
+  param.num_output_group = kClasses;
+  param.base_score = 0.5;
+  gbm::GBTreeModel model(&param);
+  for (size_t t = 0; t < kRounds * kClasses; ++t) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, t % kCols, 0.2f, t % 2 == 0, 0.0f, -0.1f * t, 0.3f, 1.0f,
+                             1.0f);
+    model.CommitModel(std::move(trees), t % kClasses);
+  }
+
+  std::vector<uint32_t> const tree_ends {0, 1 * kClasses, 3 * kClasses, kRounds * kClasses};
+  HostDeviceVector<float> gpu_out, cpu_out;
+  gpu_predictor->PredictStaged((*dmat).get(), model, tree_ends, &gpu_out);
+  cpu_predictor->PredictStaged((*dmat).get(), model, tree_ends, &cpu_out);
+  auto const& h_gpu_out = gpu_out.ConstHostVector();
+  auto const& h_cpu_out = cpu_out.ConstHostVector();
+  ASSERT_EQ(h_gpu_out.size(), kRows * kClasses * tree_ends.size());
+  ASSERT_EQ(h_gpu_out.size(), h_cpu_out.size());
+  for (size_t i = 0; i < h_gpu_out.size(); ++i) {
+    ASSERT_NEAR(h_gpu_out[i], h_cpu_out[i], kRtEps);
+  }
+  delete dmat;
+}
+
+TEST(GPUPredictor, Dart) {
+  size_t constexpr kRows = 64, kCols = 10;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0);
+  auto& p_dmat = *pp_dmat;
+  std::vector<bst_float> labels (kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 2;
+  }
+  p_dmat->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  auto learner = std::unique_ptr<Learner>(Learner::Create({p_dmat}));
+  learner->SetParams({{"booster", "dart"}, {"rate_drop", "0.5"},
+                      {"tree_method", "gpu_hist"}, {"predictor", "gpu_predictor"},
+                      {"gpu_id", "0"}});
+  for (size_t i = 0; i < 8; ++i) {
+    learner->UpdateOneIter(i, p_dmat);
+  }
+  HostDeviceVector<float> predts;
+  learner->Predict(p_dmat, true, &predts, 0, false);
+  auto const& h_predts = predts.ConstHostVector();
+  ASSERT_EQ(h_predts.size(), kRows);
+  auto const& batch = *p_dmat->GetBatches<SparsePage>().begin();
+  for (size_t i = 0; i < kRows; ++i) {
+    float expected {0};
+    learner->PredictRow(batch[i], true, common::Span<float>{&expected, 1}, 0);
+    ASSERT_NEAR(h_predts[i], expected, 1e-5);
+  }
+  delete pp_dmat;
+}
+
 TEST(GPUPredictor, EllpackBasic) {
   for (size_t bins = 2; bins < 258; bins += 16) {
     size_t rows = bins * 16;
@@ -105,5 +353,46 @@ TEST(GPUPredictor, ExternalMemoryTest) {
     }
   }
 }
+
+TEST(GPUPredictor, ShapValues) {
+  size_t constexpr kRows = 64;
+  size_t constexpr kCols = 8;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& labels = p_dmat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 3;
+  }
+
+  std::unique_ptr<Learner> learner{Learner::Create({p_dmat})};
+  learner->SetParams({{"objective", "multi:softprob"},
+                      {"num_class", "3"},
+                      {"max_depth", "6"},
+                      {"tree_method", "hist"},
+                      {"gpu_id", "0"}});
+  for (int32_t iter = 0; iter < 4; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+
+  for (bool approximate : {false, true}) {
+    for (bool interactions : {false, true}) {
+      HostDeviceVector<float> cpu_shap, gpu_shap;
+      learner->SetParam("predictor", "cpu_predictor");
+      learner->Predict(p_dmat, false, &cpu_shap, 0, false, false, !interactions,
+                       approximate, interactions);
+      learner->SetParam("predictor", "gpu_predictor");
+      learner->Predict(p_dmat, false, &gpu_shap, 0, false, false, !interactions,
+                       approximate, interactions);
+      auto const& cpu_shap_h = cpu_shap.ConstHostVector();
+      auto const& gpu_shap_h = gpu_shap.ConstHostVector();
+      ASSERT_EQ(cpu_shap_h.size(), gpu_shap_h.size());
+      for (size_t i = 0; i < cpu_shap_h.size(); ++i) {
+        ASSERT_NEAR(cpu_shap_h[i], gpu_shap_h[i], 1e-3);
+      }
+    }
+  }
+  delete pp_dmat;
+}
 }  // namespace predictor
 }  // namespace xgboost
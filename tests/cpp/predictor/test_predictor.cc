@@ -34,6 +34,42 @@ TEST(Predictor, PredictionCache) {
   EXPECT_ANY_THROW(container.Entry(m));
 }
 
+TEST(Predictor, BoundedPredictionCache) {
+  size_t constexpr kRows = 16, kCols = 4;
+  std::vector<std::shared_ptr<DMatrix>> matrices;
+  std::vector<std::shared_ptr<DMatrix>*> handles;
+  for (size_t i = 0; i < 3; ++i) {
+    handles.push_back(CreateDMatrix(kRows, kCols, 0));
+    matrices.push_back(*handles.back());
+  }
+
+  PredictionContainer container;
+  container.SetMaxBytes(2 * kRows * sizeof(float));
+  for (auto const& m : matrices) {
+    auto& entry = container.Cache(m, GenericParameter::kCpuId);
+    entry.predictions.Resize(kRows, 1.0f);
+    entry.version = 1;
+  }
+  // over the bound, the least recently used entry other than the looked up one is freed
+  container.Cache(matrices[0], GenericParameter::kCpuId);
+  ASSERT_EQ(container.Entry(matrices[0].get()).predictions.Size(), kRows);
+  ASSERT_EQ(container.Entry(matrices[1].get()).predictions.Size(), 0);
+  ASSERT_EQ(container.Entry(matrices[1].get()).version, 0);
+  ASSERT_EQ(container.Entry(matrices[2].get()).predictions.Size(), kRows);
+
+  container.Release(matrices[2].get());
+  ASSERT_EQ(container.Entry(matrices[2].get()).predictions.Size(), 0);
+  ASSERT_EQ(container.Entry(matrices[0].get()).predictions.Size(), kRows);
+  container.Release(nullptr);
+  ASSERT_EQ(container.Entry(matrices[0].get()).predictions.Size(), 0);
+  // entries are kept until their DMatrix expires
+  ASSERT_EQ(container.Container().size(), 3);
+
+  for (auto* handle : handles) {
+    delete handle;
+  }
+}
+
 // Only run this test when CUDA is enabled.
 void TestTrainingPrediction(size_t rows, std::string tree_method) {
   size_t constexpr kCols = 16;
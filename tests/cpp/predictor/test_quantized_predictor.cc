@@ -0,0 +1,115 @@
+/*!
+ * Copyright 2020 XGBoost contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/learner.h>
+#include <xgboost/predictor.h>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/gbm/gbtree_model.h"
+#include "../../../src/predictor/quantized_model.h"
+
+namespace xgboost {
+namespace predictor {
+TEST(QuantizedPredictor, Half) {
+  ASSERT_EQ(FloatToHalf(1.0f), 0x3c00);
+  ASSERT_EQ(FloatToHalf(-2.0f), 0xc000);
+  ASSERT_EQ(FloatToHalf(65504.0f), 0x7bff);
+  ASSERT_EQ(FloatToHalf(65520.0f), 0x7c00);  // rounds to infinity
+  ASSERT_EQ(FloatToHalf(std::ldexp(1.0f, -24)), 0x0001);
+  ASSERT_EQ(FloatToHalf(std::ldexp(1.0f, -26)), 0x0000);
+  // ties go to even
+  ASSERT_EQ(FloatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+  ASSERT_EQ(FloatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+  ASSERT_TRUE(std::isnan(HalfToFloat(FloatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+
+  for (uint32_t h = 0; h < 0x7c00; ++h) {
+    auto const half = static_cast<uint16_t>(h);
+    ASSERT_EQ(FloatToHalf(HalfToFloat(half)), half);
+    ASSERT_EQ(FloatToHalf(-HalfToFloat(half)), half | 0x8000);
+  }
+}
+
+TEST(QuantizedPredictor, Model) {
+  LearnerModelParam param;
+  param.num_feature = 4;
+  param.base_score = 0.5;
+  param.num_output_group = 1;
+  gbm::GBTreeModel model = CreateTestModel(&param);
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.emplace_back(new RegTree);
+  trees.back()->ExpandNode(0, 2, 0.5f, true, 0.0f, -1.0f, 2.0f, 0.0f, 0.0f);
+  trees.back()->ExpandNode(2, 2, 1.5f, false, 0.0f, 0.25f, 4.0f, 0.0f, 0.0f);
+  model.CommitModel(std::move(trees), 0);
+
+  QuantizedModel quantized {model};
+  ASSERT_EQ(quantized.NumUsedFeatures(), 1);
+  ASSERT_TRUE(quantized.Matches(model));
+
+  auto predict = [&](std::vector<Entry> const& row) {
+    std::vector<uint16_t> bins(quantized.NumUsedFeatures());
+    quantized.QuantizeRow({row.data(), row.size()}, bins.data());
+    bst_float out = 0;
+    quantized.PredictRow(bins.data(), 0, 2, &out);
+    return out;
+  };
+  ASSERT_EQ(predict({}), 1.5f - 1.0f);
+  ASSERT_EQ(predict({{2, 0.4f}}), 1.5f - 1.0f);
+  ASSERT_EQ(predict({{2, 0.5f}}), 1.5f + 0.25f);
+  ASSERT_EQ(predict({{2, 1.5f}}), 1.5f + 4.0f);
+  ASSERT_EQ(predict({{2, std::numeric_limits<float>::quiet_NaN()}}), 1.5f - 1.0f);
+  ASSERT_EQ(predict({{1, 100.0f}, {2, 1.0f}}), 1.5f + 0.25f);
+
+  std::vector<std::unique_ptr<RegTree>> more;
+  more.emplace_back(new RegTree);
+  model.CommitModel(std::move(more), 0);
+  ASSERT_FALSE(quantized.Matches(model));
+}
+
+TEST(QuantizedPredictor, Predict) {
+  size_t constexpr kRows = 128, kCols = 8;
+  int32_t constexpr kIters = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 7);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& h_labels = p_dmat->Info().labels_.HostVector();
+  h_labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    h_labels[i] = static_cast<float>(i % 3);
+  }
+
+  std::unique_ptr<Learner> learner {Learner::Create({p_dmat})};
+  learner->SetParams({{"objective", "multi:softprob"}, {"num_class", "3"},
+                      {"tree_method", "hist"}});
+  for (int32_t iter = 0; iter < kIters; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+
+  HostDeviceVector<float> expected, predt;
+  learner->Predict(p_dmat, true, &expected, 0, false);
+  learner->SetParam("predictor", "quantized_predictor");
+  learner->Predict(p_dmat, true, &predt, 0, false);
+  auto const& h_expected = expected.ConstHostVector();
+  auto const& h_predt = predt.ConstHostVector();
+  ASSERT_EQ(h_expected.size(), h_predt.size());
+  // Only the leaves are rounded, as each of them keeps 11 significant bits.
+  for (size_t i = 0; i < h_expected.size(); ++i) {
+    ASSERT_NEAR(h_expected[i], h_predt[i], 1e-2);
+  }
+
+  std::vector<float> out(3);
+  auto& batch = *p_dmat->GetBatches<SparsePage>().begin();
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    ASSERT_EQ(learner->PredictRow(batch[i], true, common::Span<float>(out)), 3);
+    for (size_t k = 0; k < out.size(); ++k) {
+      ASSERT_NEAR(out[k], h_predt[i * 3 + k], kRtEps);
+    }
+  }
+  delete pp_dmat;
+}
+}  // namespace predictor
+}  // namespace xgboost
@@ -2,14 +2,20 @@
  * Copyright 2017-2020 XGBoost contributors
  */
 #include <gtest/gtest.h>
+#include <future>
+#include <thread>
 #include <vector>
 #include "helpers.h"
 #include <dmlc/filesystem.h>
+#include <dmlc/omp.h>
 
 #include <xgboost/learner.h>
 #include <xgboost/version_config.h>
 #include "xgboost/json.h"
+#include "xgboost/json_io.h"
+#include "../../src/common/hist_util.h"
 #include "../../src/common/io.h"
+#include "../../src/common/telemetry.h"
 
 namespace xgboost {
 
@@ -53,6 +59,298 @@ TEST(Learner, ParameterValidation) {
   delete pp_mat;
 }
 
+TEST(Learner, EvalPeriod) {
+  auto pp_mat = CreateDMatrix(32, 4, 0);
+  auto& p_mat = *pp_mat;
+  p_mat->Info().labels_.HostVector().resize(32, 1.0f);
+  auto learner = std::unique_ptr<Learner>(Learner::Create({p_mat}));
+  learner->SetParams({{"eval_period", "2"}, {"eval_metric", "rmse"}, {"eval_metric", "mae"}});
+  for (int32_t iter = 0; iter < 4; ++iter) {
+    learner->UpdateOneIter(iter, p_mat);
+    auto msg = learner->EvalOneIter(iter, {p_mat}, {"train"});
+    if (iter % 2 == 0) {
+      ASSERT_NE(msg.find("train-rmse:"), std::string::npos);
+      ASSERT_LT(msg.find("train-rmse:"), msg.find("train-mae:"));
+    } else {
+      ASSERT_EQ(msg, "[" + std::to_string(iter) + "]");
+    }
+  }
+  delete pp_mat;
+}
+
+TEST(Learner, ConcurrentEvaluation) {
+  size_t constexpr kRows = 128;
+  std::vector<std::shared_ptr<DMatrix>*> pp_mats;
+  std::vector<std::shared_ptr<DMatrix>> mats;
+  for (size_t k = 0; k < 3; ++k) {
+    pp_mats.push_back(CreateDMatrix(kRows + k * 16, 5, 0.1, static_cast<int>(k)));
+    auto& labels = (*pp_mats.back())->Info().labels_.HostVector();
+    labels.resize(kRows + k * 16);
+    for (size_t i = 0; i < labels.size(); ++i) {
+      labels[i] = static_cast<float>((i + k) % 2);
+    }
+    mats.push_back(*pp_mats.back());
+  }
+  std::unique_ptr<Learner> learner{Learner::Create({mats[0]})};
+  learner->SetParams({{"objective", "binary:logistic"}, {"nthread", "4"},
+                      {"eval_metric", "auc"}, {"eval_metric", "logloss"}});
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, mats[0]);
+  }
+
+  // all sets at once are the same as evaluating them one by one
+  auto msg = learner->EvalOneIter(2, {mats[1], mats[0], mats[2]}, {"b", "a", "c"});
+  ASSERT_LT(msg.find("b-auc:"), msg.find("b-logloss:"));
+  ASSERT_LT(msg.find("b-logloss:"), msg.find("a-auc:"));
+  ASSERT_LT(msg.find("a-logloss:"), msg.find("c-auc:"));
+  std::vector<bst_float> together;
+  std::vector<std::string> names;
+  learner->EvalOneIterValues(2, {mats[1], mats[0], mats[2]}, &together, &names);
+  ASSERT_EQ(together.size(), 6u);
+  size_t pos = 0;
+  for (size_t k : {1u, 0u, 2u}) {
+    std::vector<bst_float> alone;
+    learner->EvalOneIterValues(2, {mats[k]}, &alone, &names);
+    ASSERT_EQ(alone.size(), 2u);
+    for (auto v : alone) {
+      EXPECT_NEAR(together[pos++], v, 1e-6);
+    }
+  }
+  for (auto pp_mat : pp_mats) {
+    delete pp_mat;
+  }
+}
+
+TEST(Learner, CrossValidate) {
+  size_t constexpr kRows = 256;
+  int32_t constexpr kFolds = 3, kRounds = 4;
+  auto pp_mat = CreateDMatrix(kRows, 6, 0.1);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  std::vector<int32_t> folds(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 2);
+    folds[i] = static_cast<int32_t>(i % kFolds);
+  }
+  Args args{{"objective", "binary:logistic"}, {"tree_method", "hist"},
+            {"eval_metric", "logloss"}, {"eval_metric", "error"}};
+  std::vector<bst_float> concurrent, serial;
+  std::vector<std::string> names;
+  args.emplace_back("nthread", "4");
+  CrossValidate(args, p_mat, folds, kRounds, &concurrent, &names);
+  ASSERT_EQ(names, (std::vector<std::string>{"logloss", "error"}));
+  ASSERT_EQ(concurrent.size(), kRounds * kFolds * 2 * names.size());
+  args.back().second = "1";
+  CrossValidate(args, p_mat, folds, kRounds, &serial, &names);
+  ASSERT_EQ(serial.size(), concurrent.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_NEAR(serial[i], concurrent[i], 1e-5);
+  }
+  // training logloss of every fold goes down
+  for (int32_t f = 0; f < kFolds; ++f) {
+    size_t const first = f * 2 * names.size();
+    size_t const last = ((kRounds - 1) * kFolds + f) * 2 * names.size();
+    EXPECT_LT(concurrent[last], concurrent[first]);
+  }
+  delete pp_mat;
+}
+
+TEST(Learner, TrainBatched) {
+  size_t constexpr kRows = 512;
+  int32_t constexpr kRounds = 3;
+  auto pp_mat = CreateDMatrix(kRows, 8, 0.1);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 3);
+  }
+  std::vector<Args> args{{{"eta", "0.3"}, {"max_depth", "3"}},
+                         {{"eta", "0.1"}, {"reg_lambda", "4"}},
+                         {{"eta", "0.5"}, {"max_depth", "5"}, {"tree_method", "approx"}}};
+  std::vector<std::unique_ptr<Learner>> batched, single;
+  std::vector<Learner*> learners;
+  for (auto& arg : args) {
+    if (arg.back().first != "tree_method") {
+      arg.emplace_back("tree_method", "hist");
+    }
+    arg.emplace_back("nthread", "4");
+    batched.emplace_back(Learner::Create({p_mat}));
+    single.emplace_back(Learner::Create({p_mat}));
+    batched.back()->SetParams(arg);
+    single.back()->SetParams(arg);
+    learners.push_back(batched.back().get());
+  }
+  TrainBatched(learners, p_mat, 0, kRounds);
+  for (size_t i = 0; i < args.size(); ++i) {
+    for (int32_t iter = 0; iter < kRounds; ++iter) {
+      single[i]->UpdateOneIter(iter, p_mat);
+    }
+    HostDeviceVector<float> lhs, rhs;
+    batched[i]->Predict(p_mat, false, &lhs);
+    single[i]->Predict(p_mat, false, &rhs);
+    auto const& h_lhs = lhs.ConstHostVector();
+    auto const& h_rhs = rhs.ConstHostVector();
+    ASSERT_EQ(h_lhs.size(), h_rhs.size());
+    for (size_t j = 0; j < h_lhs.size(); ++j) {
+      EXPECT_NEAR(h_lhs[j], h_rhs[j], 1e-5);
+    }
+    // threads of the batch are given back
+    ASSERT_EQ(batched[i]->GetConfigurationArguments().at("nthread"), "4");
+  }
+  delete pp_mat;
+}
+
+TEST(Learner, GradientFromEvaluation) {
+  size_t constexpr kRows = 64;
+  auto pp_mat = CreateDMatrix(kRows, 4, 0);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 2);
+  }
+  Args args{{"objective", "binary:logistic"}, {"eval_metric", "logloss"},
+            {"eval_metric", "error"}};
+  std::unique_ptr<Learner> evaluated{Learner::Create({p_mat})};
+  std::unique_ptr<Learner> plain{Learner::Create({p_mat})};
+  evaluated->SetParams(args);
+  plain->SetParams(args);
+  std::string last;
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    evaluated->UpdateOneIter(iter, p_mat);
+    // the gradient for the next iteration is computed by this evaluation
+    last = evaluated->EvalOneIter(iter, {p_mat}, {"train"});
+    plain->UpdateOneIter(iter, p_mat);
+  }
+  HostDeviceVector<float> lhs, rhs;
+  evaluated->Predict(p_mat, false, &lhs);
+  plain->Predict(p_mat, false, &rhs);
+  ASSERT_EQ(lhs.ConstHostVector(), rhs.ConstHostVector());
+  ASSERT_EQ(last, plain->EvalOneIter(2, {p_mat}, {"train"}));
+  delete pp_mat;
+}
+
+TEST(Learner, Telemetry) {
+  size_t constexpr kRows = 64;
+  auto pp_mat = CreateDMatrix(kRows, 4, 0);
+  auto& p_mat = *pp_mat;
+  p_mat->Info().labels_.HostVector().resize(kRows, 1.0f);
+  std::vector<common::IterationTelemetry> reports;
+  common::Telemetry::SetCallback(
+      [&](common::IterationTelemetry const& telemetry) { reports.push_back(telemetry); });
+  ASSERT_TRUE(common::Monitor::Enabled());
+
+  std::unique_ptr<Learner> learner{Learner::Create({p_mat})};
+  learner->SetParams({{"tree_method", "hist"}, {"eval_metric", "rmse"}});
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, p_mat);
+    learner->EvalOneIter(iter, {p_mat}, {"train"});
+  }
+  common::Telemetry::SetCallback(nullptr);
+  learner->UpdateOneIter(3, p_mat);
+
+  ASSERT_EQ(reports.size(), 3);
+  for (size_t i = 0; i < reports.size(); ++i) {
+    auto const& seconds = reports[i].seconds;
+    auto phase = [&](common::TelemetryPhase p) { return seconds[static_cast<size_t>(p)]; };
+    ASSERT_EQ(reports[i].iteration, static_cast<int32_t>(i));
+    ASSERT_GT(phase(common::TelemetryPhase::kDoBoost), 0);
+    ASSERT_GT(phase(common::TelemetryPhase::kBuildHist), 0);
+    ASSERT_LE(phase(common::TelemetryPhase::kBuildHist),
+              phase(common::TelemetryPhase::kDoBoost));
+    ASSERT_EQ(reports[i].allreduce_bytes, 0);
+  }
+  // Evaluation of the previous iteration is counted in the next report.
+  ASSERT_EQ(reports[0].seconds[static_cast<size_t>(common::TelemetryPhase::kEvaluation)], 0);
+  ASSERT_GT(reports[1].seconds[static_cast<size_t>(common::TelemetryPhase::kEvaluation)], 0);
+  delete pp_mat;
+}
+
+TEST(Learner, EvalAsync) {
+  size_t constexpr kRows = 64;
+  auto pp_mat = CreateDMatrix(kRows, 4, 0);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 2);
+  }
+  Args args{{"objective", "binary:logistic"}, {"eval_metric", "logloss"},
+            {"eval_metric", "auc"}};
+  std::unique_ptr<Learner> async{Learner::Create({p_mat})};
+  std::unique_ptr<Learner> sync{Learner::Create({p_mat})};
+  async->SetParams(args);
+  sync->SetParams(args);
+  std::shared_future<std::string> pending;
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    async->UpdateOneIter(iter, p_mat);
+    // the previous evaluation finishes while this round is being trained
+    if (pending.valid()) {
+      ASSERT_EQ(pending.get(), sync->EvalOneIter(iter - 1, {p_mat}, {"train"}));
+    }
+    pending = async->EvalOneIterAsync(iter, {p_mat}, {"train"});
+    sync->UpdateOneIter(iter, p_mat);
+  }
+  ASSERT_EQ(pending.get(), sync->EvalOneIter(2, {p_mat}, {"train"}));
+  delete pp_mat;
+}
+
+TEST(Learner, Deterministic) {
+  size_t constexpr kRows = 4096, kCols = 8;
+  auto pp_mat = CreateDMatrix(kRows, kCols, 0.2);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 3);
+  }
+  auto train = [&](std::string const& tree_method, std::string const& nthread,
+                   std::string* eval) {
+    std::unique_ptr<Learner> learner{Learner::Create({p_mat})};
+    learner->SetParams({{"objective", "multi:softprob"}, {"num_class", "3"},
+                        {"tree_method", tree_method}, {"nthread", nthread},
+                        {"deterministic", "1"}});
+    for (int32_t iter = 0; iter < 3; ++iter) {
+      learner->UpdateOneIter(iter, p_mat);
+    }
+    *eval = learner->EvalOneIter(2, {p_mat}, {"train"});
+    HostDeviceVector<float> predt;
+    learner->Predict(p_mat, false, &predt, 0, false);
+    return predt.ConstHostVector();
+  };
+  for (auto const& tree_method : {"hist", "approx"}) {
+    std::string single_eval, multi_eval;
+    auto single = train(tree_method, "1", &single_eval);
+    auto multi = train(tree_method, "4", &multi_eval);
+    ASSERT_EQ(single_eval, multi_eval);
+    ASSERT_EQ(single.size(), multi.size());
+    for (size_t i = 0; i < single.size(); ++i) {
+      ASSERT_EQ(single[i], multi[i]) << tree_method;
+    }
+  }
+  delete pp_mat;
+}
+
+TEST(Learner, ThreadsScope) {
+  size_t constexpr kRows = 64;
+  auto pp_mat = CreateDMatrix(kRows, 4, 0);
+  auto& p_mat = *pp_mat;
+  p_mat->Info().labels_.HostVector().resize(kRows, 1.0f);
+  int32_t const original = omp_get_max_threads();
+  std::unique_ptr<Learner> learner{Learner::Create({p_mat})};
+  learner->SetParams({{"nthread", std::to_string(original + 1)}});
+  learner->UpdateOneIter(0, p_mat);
+  HostDeviceVector<float> predt;
+  learner->Predict(p_mat, false, &predt, 0, false);
+  learner->EvalOneIter(0, {p_mat}, {"train"});
+  // The number of threads is only set while the learner is working.
+  ASSERT_EQ(omp_get_max_threads(), original);
+  ASSERT_EQ(learner->GetGenericParameter().Threads(), original + 1);
+  delete pp_mat;
+}
+
 TEST(Learner, CheckGroup) {
   using Arg = std::pair<std::string, std::string>;
   size_t constexpr kNumGroups = 4;
@@ -137,6 +435,37 @@ TEST(Learner, Configuration) {
   }
 }
 
+TEST(Learner, JsonConfigCache) {
+  size_t constexpr kRows = 16;
+  auto pp_dmat = CreateDMatrix(kRows, 4, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  p_dmat->Info().labels_.Resize(kRows);
+
+  std::unique_ptr<Learner> learner { Learner::Create({p_dmat}) };
+  learner->SetParams({{"max_depth", "3"}, {"eval_metric", "rmse"}});
+  learner->UpdateOneIter(0, p_dmat);
+  std::string config;
+  learner->SaveJsonConfig(&config);
+
+  // Saving the model checks that the learner is still configured.
+  Json model { Object() };
+  learner->SetParams({{"max_depth", "3"}, {"eval_metric", "rmse"}});
+  learner->SaveModel(&model);
+  learner->LoadJsonConfig(config);
+  learner->SaveModel(&model);
+  std::string same;
+  learner->SaveJsonConfig(&same);
+  ASSERT_EQ(same, config);
+
+  learner->SetParam("max_depth", "4");
+  EXPECT_THROW(learner->SaveModel(&model), dmlc::Error);
+  std::string changed;
+  learner->SaveJsonConfig(&changed);
+  ASSERT_NE(changed, config);
+  ASSERT_NE(changed.find("\"max_depth\":\"4\""), std::string::npos);
+  delete pp_dmat;
+}
+
 TEST(Learner, JsonModelIO) {
   // Test of comparing JSON object directly.
   size_t constexpr kRows = 8;
@@ -219,6 +548,278 @@ TEST(Learner, BinaryModelIO) {
   delete pp_dmat;
 }
 
+TEST(Learner, UBJSONModelIO) {
+  size_t constexpr kRows = 8;
+  int32_t constexpr kIters = 4;
+  auto pp_dmat = CreateDMatrix(kRows, 10, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  p_dmat->Info().labels_.Resize(kRows);
+
+  std::unique_ptr<Learner> learner{Learner::Create({p_dmat})};
+  for (int32_t iter = 0; iter < kIters; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+  Json model { Object() };
+  learner->SaveModel(&model);
+
+  // model
+  std::stringstream ss;
+  UBJWriter writer{&ss};
+  writer.Save(model);
+  std::string ubj = ss.str();
+  ASSERT_TRUE(IsUBJObject(ubj.c_str(), ubj.size()));
+  {
+    std::unique_ptr<Learner> loaded{Learner::Create({p_dmat})};
+    common::MemoryFixSizeBuffer fi(&ubj[0], ubj.size());
+    loaded->LoadModel(&fi);
+    Json loaded_model { Object() };
+    loaded->SaveModel(&loaded_model);
+    ASSERT_EQ(model, loaded_model);
+  }
+
+  // memory snapshot
+  std::string snapshot;
+  common::MemoryBufferStream fo(&snapshot);
+  learner->Save(&fo);
+  ASSERT_TRUE(IsUBJObject(snapshot.c_str(), snapshot.size()));
+  {
+    std::unique_ptr<Learner> loaded{Learner::Create({p_dmat})};
+    common::MemoryBufferStream fi(&snapshot);
+    loaded->Load(&fi);
+    Json loaded_model { Object() };
+    loaded->SaveModel(&loaded_model);
+    ASSERT_EQ(model, loaded_model);
+  }
+
+  std::string text;
+  Json::Dump(model, &text);
+  ASSERT_LT(ubj.size(), text.size());
+
+  delete pp_dmat;
+}
+
+TEST(Learner, TrainingCache) {
+  size_t constexpr kRows = 64;
+  auto pp_dmat = CreateDMatrix(kRows, 8, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& labels = p_dmat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 3);
+  }
+  std::unique_ptr<Learner> learner{Learner::Create({p_dmat})};
+  learner->SetParams({{"tree_method", "hist"}});
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, p_dmat);
+  }
+  std::string model_buf, cache_buf;
+  common::MemoryBufferStream model_fo(&model_buf);
+  learner->Save(&model_fo);
+  common::MemoryBufferStream cache_fo(&cache_buf);
+  learner->SaveTrainingCache(p_dmat, &cache_fo, false);
+
+  auto continue_training = [&](bool with_cache) {
+    std::unique_ptr<Learner> restarted{Learner::Create({p_dmat})};
+    common::MemoryBufferStream model_fi(&model_buf);
+    restarted->Load(&model_fi);
+    if (with_cache) {
+      common::MemoryBufferStream cache_fi(&cache_buf);
+      EXPECT_TRUE(restarted->LoadTrainingCache(p_dmat, &cache_fi));
+    }
+    for (int32_t iter = 3; iter < 5; ++iter) {
+      restarted->UpdateOneIter(iter, p_dmat);
+    }
+    HostDeviceVector<float> predt;
+    restarted->Predict(p_dmat, true, &predt);
+    return predt.HostVector();
+  };
+  ASSERT_EQ(continue_training(true), continue_training(false));
+
+  // the cache doesn't match the model after another round
+  learner->UpdateOneIter(3, p_dmat);
+  common::MemoryBufferStream cache_fi(&cache_buf);
+  ASSERT_FALSE(learner->LoadTrainingCache(p_dmat, &cache_fi));
+
+  // the quantized matrix is restored into the same data for any model
+  std::string quantized_buf;
+  common::MemoryBufferStream quantized_fo(&quantized_buf);
+  learner->SaveTrainingCache(p_dmat, &quantized_fo, true);
+  auto pp_fresh = CreateDMatrix(kRows, 8, 0);
+  std::shared_ptr<DMatrix> p_fresh {*pp_fresh};
+  int32_t max_bin {0};
+  ASSERT_EQ(p_fresh->GHistIndexPage(&max_bin), nullptr);
+  std::unique_ptr<Learner> recovered{Learner::Create({p_fresh})};
+  recovered->SetParams({{"tree_method", "hist"}});
+  common::MemoryBufferStream quantized_fi(&quantized_buf);
+  ASSERT_FALSE(recovered->LoadTrainingCache(p_fresh, &quantized_fi));
+  auto const* restored = p_fresh->GHistIndexPage(&max_bin);
+  ASSERT_TRUE(restored);
+  ASSERT_EQ(max_bin, 256);
+  auto const* page = p_dmat->GHistIndexPage(&max_bin);
+  ASSERT_EQ(restored->row_ptr, page->row_ptr);
+  ASSERT_EQ(restored->cut.Values(), page->cut.Values());
+  ASSERT_EQ(restored->index.Size(), page->index.Size());
+  for (size_t i = 0; i < page->index.Size(); ++i) {
+    ASSERT_EQ(restored->index[i], page->index[i]);
+  }
+
+  delete pp_fresh;
+  delete pp_dmat;
+}
+
+TEST(Learner, AppendOnlyCheckpoint) {
+  size_t constexpr kRows = 64;
+  auto pp_dmat = CreateDMatrix(kRows, 8, 0);
+  std::shared_ptr<DMatrix> p_dmat {*pp_dmat};
+  auto& labels = p_dmat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 3);
+  }
+  for (std::string booster : {"gbtree", "dart"}) {
+    std::unique_ptr<Learner> learner{Learner::Create({p_dmat})};
+    learner->SetParams({{"booster", booster}, {"num_class", "3"},
+                        {"objective", "multi:softprob"}});
+    std::string checkpoint;
+    common::MemoryBufferStream fo(&checkpoint);
+    std::vector<size_t> sizes;
+    for (int32_t iter = 0; iter < 6; ++iter) {
+      learner->UpdateOneIter(iter, p_dmat);
+      learner->SaveCheckpointSegment(&fo);
+      sizes.push_back(checkpoint.size());
+    }
+    // later segments hold only the new trees
+    std::string snapshot;
+    common::MemoryBufferStream snapshot_fo(&snapshot);
+    learner->Save(&snapshot_fo);
+    ASSERT_LT(sizes[5] - sizes[4], snapshot.size());
+
+    auto check = [&](std::string buffer, size_t n_expected) {
+      std::unique_ptr<Learner> loaded{Learner::Create({p_dmat})};
+      common::MemoryBufferStream fi(&buffer);
+      ASSERT_EQ(loaded->LoadCheckpoint(&fi), n_expected);
+      loaded->Configure();
+      Json expected{Object()}, got{Object()};
+      learner->SaveModel(&expected);
+      loaded->SaveModel(&got);
+      ASSERT_EQ(expected, got);
+    };
+    check(checkpoint, 6);
+    // An interrupted save leaves a truncated segment behind.
+    check(checkpoint + checkpoint.substr(sizes[4], sizes[5] - sizes[4] - 5), 6);
+
+    // Segments continue from a loaded checkpoint.
+    std::unique_ptr<Learner> resumed{Learner::Create({p_dmat})};
+    {
+      common::MemoryBufferStream fi(&checkpoint);
+      resumed->LoadCheckpoint(&fi);
+    }
+    resumed->UpdateOneIter(6, p_dmat);
+    resumed->SaveCheckpointSegment(&fo);
+    ASSERT_LT(checkpoint.size() - sizes[5], snapshot.size());
+    learner.reset(resumed.release());
+    check(checkpoint, 7);
+  }
+  delete pp_dmat;
+}
+
+TEST(Learner, ConcurrentPredict) {
+  size_t constexpr kRows = 256;
+  size_t constexpr kCols = 10;
+  size_t constexpr kMatrices = 4;
+  size_t constexpr kThreads = 8;
+  auto pp_train = CreateDMatrix(kRows, kCols, 0);
+  std::shared_ptr<DMatrix> p_train {*pp_train};
+  auto& labels = p_train->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 3;
+  }
+
+  std::vector<std::shared_ptr<DMatrix>*> pp_mats;
+  std::vector<std::shared_ptr<DMatrix>> mats;
+  for (size_t i = 0; i < kMatrices; ++i) {
+    pp_mats.emplace_back(CreateDMatrix(kRows, kCols, 0.2, i + 1));
+    mats.emplace_back(*pp_mats.back());
+  }
+
+  for (auto const& booster : {"gbtree", "dart"}) {
+    std::unique_ptr<Learner> learner{Learner::Create({p_train})};
+    learner->SetParams({{"booster", booster},
+                        {"objective", "multi:softmax"},
+                        {"num_class", "3"},
+                        {"rate_drop", "0.5"}});
+    for (int32_t iter = 0; iter < 4; ++iter) {
+      learner->UpdateOneIter(iter, p_train);
+    }
+
+    std::vector<std::vector<float>> expected(kMatrices);
+    for (size_t i = 0; i < kMatrices; ++i) {
+      HostDeviceVector<float> predts;
+      learner->Predict(mats[i], false, &predts);
+      expected[i] = predts.HostVector();
+    }
+
+    std::vector<std::vector<float>> results(kThreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        HostDeviceVector<float> predts;
+        for (int32_t rep = 0; rep < 4; ++rep) {
+          // Alternating the number of trees invalidates the prediction cache.
+          learner->Predict(mats[t % kMatrices], false, &predts, 2);
+          learner->Predict(mats[t % kMatrices], false, &predts);
+        }
+        results[t] = predts.HostVector();
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (size_t t = 0; t < kThreads; ++t) {
+      ASSERT_EQ(results[t], expected[t % kMatrices]) << booster;
+    }
+  }
+
+  for (auto pp_mat : pp_mats) {
+    delete pp_mat;
+  }
+  delete pp_train;
+}
+
+TEST(Learner, PredictionCacheBound) {
+  size_t constexpr kRows = 128;
+  size_t constexpr kCols = 10;
+  auto pp_train = CreateDMatrix(kRows, kCols, 0);
+  std::shared_ptr<DMatrix> p_train {*pp_train};
+  auto& labels = p_train->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = i % 2;
+  }
+  auto pp_test = CreateDMatrix(kRows, kCols, 0.2, 1);
+  std::shared_ptr<DMatrix> p_test {*pp_test};
+
+  std::unique_ptr<Learner> learner{Learner::Create({p_train})};
+  learner->SetParams({{"objective", "binary:logistic"}, {"prediction_cache_mb", "1"}});
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, p_train);
+  }
+  HostDeviceVector<float> cached, uncached;
+  learner->Predict(p_test, false, &cached);
+  // a one off prediction, then the cache is freed and rebuilt by the next prediction
+  learner->Predict(p_test, false, &uncached, 0, false, false, false, false, false, false);
+  ASSERT_EQ(cached.HostVector(), uncached.HostVector());
+  learner->ReleasePredictionCache(p_test.get());
+  learner->Predict(p_test, false, &uncached);
+  ASSERT_EQ(cached.HostVector(), uncached.HostVector());
+  learner->ReleasePredictionCache(nullptr);
+  learner->UpdateOneIter(3, p_train);
+
+  delete pp_test;
+  delete pp_train;
+}
+
 #if defined(XGBOOST_USE_CUDA)
 // Tests for automatic GPU configuration.
 TEST(Learner, GPUConfiguration) {
@@ -273,5 +874,42 @@ TEST(Learner, GPUConfiguration) {
 
   delete pp_dmat;
 }
+
+TEST(Learner, EvalOnCPU) {
+  size_t constexpr kRows = 256;
+  auto pp_mat = CreateDMatrix(kRows, 8, 0.1);
+  auto& p_mat = *pp_mat;
+  auto& labels = p_mat->Info().labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<float>(i % 2);
+  }
+  Args args{{"objective", "binary:logistic"}, {"tree_method", "gpu_hist"},
+            {"eval_metric", "logloss"}};
+  std::unique_ptr<Learner> hybrid{Learner::Create({p_mat})};
+  std::unique_ptr<Learner> device{Learner::Create({p_mat})};
+  hybrid->SetParams(args);
+  hybrid->SetParam("eval_on_cpu", "1");
+  device->SetParams(args);
+  auto value = [](std::string const& msg) {
+    auto pos = msg.find("train-logloss:");
+    EXPECT_NE(pos, std::string::npos);
+    return std::stof(msg.substr(pos + std::string{"train-logloss:"}.size()));
+  };
+  std::shared_future<std::string> pending;
+  for (int32_t iter = 0; iter < 3; ++iter) {
+    hybrid->UpdateOneIter(iter, p_mat);
+    if (pending.valid()) {
+      // the replica is one iteration behind
+      EXPECT_NEAR(value(pending.get()),
+                  value(device->EvalOneIter(iter - 1, {p_mat}, {"train"})), 1e-5);
+    }
+    pending = hybrid->EvalOneIterAsync(iter, {p_mat}, {"train"});
+    device->UpdateOneIter(iter, p_mat);
+  }
+  EXPECT_NEAR(value(pending.get()), value(device->EvalOneIter(2, {p_mat}, {"train"})), 1e-5);
+  ASSERT_EQ(hybrid->GetGenericParameter().gpu_id, 0);
+  delete pp_mat;
+}
 #endif  // defined(XGBOOST_USE_CUDA)
 }  // namespace xgboost
@@ -36,9 +36,26 @@ void VerifySampling(size_t page_size,
   auto sample = sampler.Sample(gpair.DeviceSpan(), dmat.get());
 
   if (fixed_size_sampling) {
-    EXPECT_EQ(sample.sample_rows, kRows);
+    // In-memory sampling keeps the page intact and lists the sampled rows instead.
     EXPECT_EQ(sample.page->matrix.n_rows, kRows);
     EXPECT_EQ(sample.gpair.size(), kRows);
+    if (sample.rows.empty()) {
+      EXPECT_EQ(sample.sample_rows, kRows);
+    } else {
+      EXPECT_EQ(sample.sample_rows, sample.rows.size());
+      EXPECT_NEAR(sample.sample_rows, sample_rows, kRows * 0.016f);
+      std::vector<bst_uint> rows_h(sample.rows.size());
+      dh::CopyDeviceSpanToVector(&rows_h, sample.rows);
+      std::vector<GradientPair> gpair_h(sample.gpair.size());
+      dh::CopyDeviceSpanToVector(&gpair_h, sample.gpair);
+      for (size_t i = 0; i < rows_h.size(); ++i) {
+        ASSERT_LT(rows_h[i], kRows);
+        if (i != 0) {
+          ASSERT_LT(rows_h[i - 1], rows_h[i]);
+        }
+        EXPECT_FALSE(gpair_h[rows_h[i]] == GradientPair());
+      }
+    }
   } else {
     EXPECT_NEAR(sample.sample_rows, sample_rows, kRows * 0.016f);
     EXPECT_NEAR(sample.page->matrix.n_rows, sample_rows, kRows * 0.016f);
@@ -96,6 +96,57 @@ void TestUpdatePosition() {
 
 TEST(RowPartitioner, Basic) { TestUpdatePosition(); }
 
+TEST(RowPartitioner, SampledRows) {
+  std::vector<RowPartitioner::RowIndexT> h_sampled{1, 4, 5, 8};
+  dh::device_vector<RowPartitioner::RowIndexT> sampled(h_sampled);
+  RowPartitioner rp(0, dh::ToSpan(sampled));
+  EXPECT_EQ(rp.GetRowsHost(0), h_sampled);
+  rp.UpdatePosition(0, 1, 2, [=] __device__(RowPartitioner::RowIndexT ridx) {
+    return ridx < 5 ? 1 : 2;
+  });
+  EXPECT_EQ(rp.GetRowsHost(1), std::vector<RowPartitioner::RowIndexT>({1, 4}));
+  EXPECT_EQ(rp.GetRowsHost(2), std::vector<RowPartitioner::RowIndexT>({5, 8}));
+}
+
+TEST(RowPartitioner, UpdatePositionBatch) {
+  const int kNumRows = 10;
+  RowPartitioner rp(0, kNumRows);
+  rp.UpdatePositionBatch({0}, {1}, {2},
+    [=] __device__(RowPartitioner::RowIndexT ridx, uint32_t node) {
+    return ridx > 4 ? 1 : 2;
+  });
+  EXPECT_EQ(rp.GetRowsHost(1), std::vector<RowPartitioner::RowIndexT>({5, 6, 7, 8, 9}));
+  EXPECT_EQ(rp.GetRowsHost(2), std::vector<RowPartitioner::RowIndexT>({0, 1, 2, 3, 4}));
+
+  // Split both children in one batch
+  rp.UpdatePositionBatch({1, 2}, {3, 5}, {4, 6},
+    [=] __device__(RowPartitioner::RowIndexT ridx, uint32_t node) {
+    if (node == 0) {
+      return ridx < 7 ? 3 : 4;
+    }
+    return ridx % 2 == 0 ? 5 : 6;
+  });
+  EXPECT_EQ(rp.GetRowsHost(3), std::vector<RowPartitioner::RowIndexT>({5, 6}));
+  EXPECT_EQ(rp.GetRowsHost(4), std::vector<RowPartitioner::RowIndexT>({7, 8, 9}));
+  EXPECT_EQ(rp.GetRowsHost(5), std::vector<RowPartitioner::RowIndexT>({0, 2, 4}));
+  EXPECT_EQ(rp.GetRowsHost(6), std::vector<RowPartitioner::RowIndexT>({1, 3}));
+  EXPECT_EQ(rp.GetPositionHost(), std::vector<bst_node_t>({3, 3, 4, 4, 4, 5, 5, 5, 6, 6}));
+
+  // Nodes without rows are skipped
+  rp.UpdatePositionBatch({3, 6}, {7, 9}, {8, 10},
+    [=] __device__(RowPartitioner::RowIndexT ridx, uint32_t node) {
+    return node == 0 ? 8 : 9;
+  });
+  EXPECT_EQ(rp.GetRows(7).size(), 0);
+  EXPECT_EQ(rp.GetRowsHost(8), std::vector<RowPartitioner::RowIndexT>({5, 6}));
+  EXPECT_EQ(rp.GetRowsHost(9), std::vector<RowPartitioner::RowIndexT>({1, 3}));
+  EXPECT_EQ(rp.GetRows(10).size(), 0);
+  // Rows of the nodes are held by both buffers, reading all of them gathers them.
+  EXPECT_EQ(rp.GetPositionHost(), std::vector<bst_node_t>({8, 8, 4, 4, 4, 5, 5, 5, 9, 9}));
+  EXPECT_EQ(rp.GetRowsHost(8), std::vector<RowPartitioner::RowIndexT>({5, 6}));
+  EXPECT_EQ(rp.GetRowsHost(4), std::vector<RowPartitioner::RowIndexT>({7, 8, 9}));
+}
+
 void TestFinalise() {
   const int kNumRows = 10;
   RowPartitioner rp(0, kNumRows);
@@ -54,6 +54,24 @@ TEST(CPUFeatureInteractionConstraint, Basic) {
 
   ASSERT_FALSE(constraints.Query(1, 0));
   ASSERT_FALSE(constraints.Query(1, 5));
+
+  // 2 and 1 are only allowed together by the first constraint
+  constraints.Split(/*node_id=*/1, /*feature_id=*/1, /*left_id=*/3, /*right_id=*/4);
+  for (bst_node_t nid : {3, 4}) {
+    ASSERT_TRUE(constraints.Query(nid, 1));
+    ASSERT_TRUE(constraints.Query(nid, 2));
+    ASSERT_FALSE(constraints.Query(nid, 3));
+    ASSERT_FALSE(constraints.Query(nid, 4));
+  }
+  // the other branch is unaffected
+  ASSERT_TRUE(constraints.Query(2, 3));
+
+  // a new tree starts with every feature permitted
+  constraints.Reset();
+  for (bst_feature_t f = 0; f < kFeatures; ++f) {
+    ASSERT_TRUE(constraints.Query(0, f));
+  }
+  ASSERT_FALSE(constraints.Query(0, kFeatures));
 }
 
 }  // namespace tree
@@ -152,6 +152,24 @@ TEST(GPUFeatureInteractionConstraint, Split) {
   }
 }
 
+TEST(GPUFeatureInteractionConstraint, NodeConstraints) {
+  tree::TrainParam param = GetParameter();
+  bst_feature_t constexpr kFeatures = 6;
+  FConstraintWrapper constraints(param, kFeatures);
+  // Root is unconstrained.
+  ASSERT_EQ(constraints.NodeConstraints(0).Size(), 0);
+
+  constraints.Split(/*node_id=*/0, /*feature_id=*/1, /*left_id=*/1, /*right_id=*/2);
+  constraints.Split(/*node_id=*/1, /*feature_id=*/0, /*left_id=*/3, /*right_id=*/4);
+  CompareBitField(constraints.NodeConstraints(2), {1, 2});
+  CompareBitField(constraints.NodeConstraints(3), {0, 1, 2});
+
+  tree::TrainParam no_constraint;
+  no_constraint.Init(Args{});
+  FConstraintWrapper empty(no_constraint, kFeatures);
+  ASSERT_EQ(empty.NodeConstraints(1).Size(), 0);
+}
+
 TEST(GPUFeatureInteractionConstraint, QueryNode) {
   tree::TrainParam param = GetParameter();
   bst_feature_t constexpr kFeatures = 6;
@@ -72,7 +72,7 @@ std::vector<GradientPairPrecise> GetHostHistGpair() {
 }
 
 template <typename GradientSumT>
-void TestBuildHist(bool use_shared_memory_histograms) {
+void TestBuildHist(bool use_shared_memory_histograms, size_t max_bins_in_smem = 0) {
   int const kNRows = 16, kNCols = 8;
 
   TrainParam param;
@@ -108,6 +108,10 @@ void TestBuildHist(bool use_shared_memory_histograms) {
   maker.gpair = gpair.DeviceSpan();
 
   maker.use_shared_memory_histograms = use_shared_memory_histograms;
+  if (max_bins_in_smem != 0) {
+    maker.feature_groups.Init(page->matrix.info, max_bins_in_smem * sizeof(GradientSumT),
+                              sizeof(GradientSumT));
+  }
   maker.BuildHist(0);
   DeviceHistogram<GradientSumT> d_hist = maker.hist;
 
@@ -139,6 +143,25 @@ TEST(GpuHist, BuildHistSharedMem) {
   TestBuildHist<GradientPair>(true);
 }
 
+TEST(GpuHist, BuildHistFeatureGroups) {
+  // 3 bins for each feature, 2 features for each group.
+  TestBuildHist<GradientPairPrecise>(true, 7);
+  TestBuildHist<GradientPair>(true, 7);
+  // No feature fits into shared memory.
+  TestBuildHist<GradientPairPrecise>(true, 2);
+
+  auto page = BuildEllpackPage(16, 8);
+  FeatureGroups feature_groups;
+  feature_groups.Init(page->matrix.info, 7 * sizeof(GradientPair), sizeof(GradientPair));
+  ASSERT_EQ(feature_groups.groups.size(), 4);
+  ASSERT_EQ(feature_groups.max_group_bins, 6);
+  for (size_t i = 0; i < feature_groups.groups.size(); ++i) {
+    ASSERT_EQ(feature_groups.groups[i].bin_begin, i * 6);
+    ASSERT_EQ(feature_groups.groups[i].bin_end, i * 6 + 6);
+    ASSERT_TRUE(feature_groups.groups[i].use_shared_memory);
+  }
+}
+
 HistogramCutsWrapper GetHostCutMatrix () {
   HistogramCutsWrapper cmat;
   cmat.SetPtrs({0, 3, 6, 9, 12, 15, 18, 21, 24});
@@ -272,11 +295,11 @@ void TestHistogramIndexImpl() {
 
   // Extract the device maker from the histogram makers and from that its compressed
   // histogram index
-  const auto &maker = hist_maker.maker;
+  const auto &maker = hist_maker.makers.front();
   std::vector<common::CompressedByteT> h_gidx_buffer(maker->page->gidx_buffer.size());
   dh::CopyDeviceSpanToVector(&h_gidx_buffer, maker->page->gidx_buffer);
 
-  const auto &maker_ext = hist_maker_ext.maker;
+  const auto &maker_ext = hist_maker_ext.makers.front();
   std::vector<common::CompressedByteT> h_gidx_buffer_ext(maker_ext->page->gidx_buffer.size());
   dh::CopyDeviceSpanToVector(&h_gidx_buffer_ext, maker_ext->page->gidx_buffer);
 
@@ -509,6 +532,120 @@ TEST(GpuHist, ExternalMemoryWithSampling) {
   }
 }
 
+RegTree BuildTreeWithBatch(DMatrix* dmat, HostDeviceVector<GradientPair>* gpair,
+                           std::string const& grow_policy, int32_t max_expand_batch) {
+  Args args{
+      {"max_depth", "6"},
+      {"max_leaves", "16"},
+      {"grow_policy", grow_policy},
+      {"max_expand_batch", std::to_string(max_expand_batch)},
+  };
+  tree::GPUHistMakerSpecialised<GradientPairPrecise> hist_maker;
+  GenericParameter generic_param(CreateEmptyGenericParam(0));
+  hist_maker.Configure(args, &generic_param);
+  RegTree tree;
+  hist_maker.Update(gpair, dmat, {&tree});
+  return tree;
+}
+
+TEST(GpuHist, ExpandBatch) {
+  constexpr size_t kRows = 2048;
+  constexpr size_t kCols = 16;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  auto gpair = GenerateRandomGradients(kRows);
+
+  // Expanding a whole level at once yields the same tree as node by node
+  // expansion.
+  RegTree sequential = BuildTreeWithBatch((*pp_dmat).get(), &gpair, "depthwise", 1);
+  RegTree batched = BuildTreeWithBatch((*pp_dmat).get(), &gpair, "depthwise", 0);
+  ASSERT_GT(sequential.NumExtraNodes(), 2);
+  ASSERT_TRUE(sequential == batched);
+
+  // Batches for lossguide may change the order of expansion, but not the
+  // number of leaves.
+  RegTree lossguide = BuildTreeWithBatch((*pp_dmat).get(), &gpair, "lossguide", 4);
+  int32_t n_leaves = 0;
+  for (int32_t nidx = 0; nidx < lossguide.param.num_nodes; ++nidx) {
+    n_leaves += lossguide[nidx].IsLeaf();
+  }
+  ASSERT_EQ(n_leaves, 16);
+  delete pp_dmat;
+}
+
+TEST(GpuHist, CudaGraph) {
+  constexpr size_t kRows = 2048;
+  constexpr size_t kCols = 16;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  auto gpair = GenerateRandomGradients(kRows);
+
+  auto build_trees = [&](std::string use_cuda_graph, size_t* n_graphs) -> std::vector<RegTree> {
+    Args args{{"max_depth", "0"},
+              {"max_leaves", "32"},
+              {"grow_policy", "lossguide"},
+              {"use_cuda_graph", use_cuda_graph}};
+    tree::GPUHistMakerSpecialised<GradientPairPrecise> hist_maker;
+    GenericParameter generic_param(CreateEmptyGenericParam(0));
+    hist_maker.Configure(args, &generic_param);
+    // The second tree replays the graphs captured by the first one.
+    std::vector<RegTree> trees(2);
+    for (auto& tree : trees) {
+      hist_maker.Update(&gpair, (*pp_dmat).get(), {&tree});
+    }
+    *n_graphs = hist_maker.makers.front()->graphs.Size();
+    return trees;
+  };
+  size_t n_graphs = 0;
+  auto eager = build_trees("0", &n_graphs);
+  ASSERT_EQ(n_graphs, 0);
+  auto graph = build_trees("1", &n_graphs);
+  ASSERT_GT(n_graphs, 0);
+  // The histogram grid is rounded up with graphs, which may change the
+  // summation order, so only the structure is compared.
+  for (size_t i = 0; i < eager.size(); ++i) {
+    ASSERT_EQ(eager[i].NumExtraNodes(), graph[i].NumExtraNodes());
+    for (int32_t nidx = 0; nidx < eager[i].param.num_nodes; ++nidx) {
+      ASSERT_EQ(eager[i][nidx].IsLeaf(), graph[i][nidx].IsLeaf());
+      if (!eager[i][nidx].IsLeaf()) {
+        ASSERT_EQ(eager[i][nidx].SplitIndex(), graph[i][nidx].SplitIndex());
+      }
+    }
+  }
+  delete pp_dmat;
+}
+
+TEST(GpuHist, MGPU_Basic) {
+  if (common::AllVisibleGPUs() < 2) {
+    LOG(WARNING) << "Not testing in multi-gpu environment.";
+    return;
+  }
+  constexpr size_t kRows = 2048;
+  constexpr size_t kCols = 16;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  auto gpair = GenerateRandomGradients(kRows);
+
+  auto build_tree = [&](std::string n_gpus) -> RegTree {
+    Args args{{"max_depth", "4"}, {"n_gpus", n_gpus}};
+    tree::GPUHistMakerSpecialised<GradientPairPrecise> hist_maker;
+    GenericParameter generic_param(CreateEmptyGenericParam(0));
+    hist_maker.Configure(args, &generic_param);
+    RegTree tree;
+    hist_maker.Update(&gpair, (*pp_dmat).get(), {&tree});
+    return tree;
+  };
+  RegTree single = build_tree("1");
+  RegTree multi = build_tree("2");
+  // Histograms are summed in a different order, so only the structure is
+  // compared.
+  ASSERT_EQ(single.NumExtraNodes(), multi.NumExtraNodes());
+  for (int32_t nidx = 0; nidx < single.param.num_nodes; ++nidx) {
+    ASSERT_EQ(single[nidx].IsLeaf(), multi[nidx].IsLeaf());
+    if (!single[nidx].IsLeaf()) {
+      ASSERT_EQ(single[nidx].SplitIndex(), multi[nidx].SplitIndex());
+    }
+  }
+  delete pp_dmat;
+}
+
 TEST(GpuHist, Config_IO) {
   GenericParameter generic_param(CreateEmptyGenericParam(0));
   std::unique_ptr<TreeUpdater> updater {TreeUpdater::Create("grow_gpu_hist", &generic_param) };
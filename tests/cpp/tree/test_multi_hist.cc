@@ -0,0 +1,84 @@
+/*!
+ * Copyright 2020 by Contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <xgboost/data.h>
+#include <xgboost/host_device_vector.h>
+#include <xgboost/tree_updater.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace xgboost {
+namespace tree {
+
+TEST(Updater, MultiHist) {
+  size_t constexpr kRows = 512, kCols = 4, kTargets = 3;
+  // Feature 2 takes two values or is missing, the others are noise.
+  float constexpr kMissing = -1.0f;
+  std::vector<float> data(kRows * kCols);
+  SimpleLCG gen(3);
+  SimpleRealUniformDistribution<float> dist(0.0f, 1.0f);
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t j = 0; j < kCols; ++j) {
+      data[i * kCols + j] = dist(&gen);
+    }
+    data[i * kCols + 2] = i % 7 == 0 ? kMissing : (i % 2 == 0 ? 0.25f : 0.75f);
+  }
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), kRows, kCols, kMissing, &handle), 0);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  auto p_dmat = *pp_dmat;
+  auto const& page = *p_dmat->GetBatches<SparsePage>().begin();
+
+  // The first output is pushed up by the large value of feature 2, the second one down
+  // and the third one doesn't depend on the data.
+  std::vector<GradientPair> h_gpair(kRows * kTargets);
+  for (size_t i = 0; i < kRows; ++i) {
+    float const sign = data[i * kCols + 2] > 0.5f ? -1.0f : 1.0f;
+    h_gpair[i * kTargets + 0] = GradientPair(sign, 1.0f);
+    h_gpair[i * kTargets + 1] = GradientPair(-sign, 1.0f);
+    h_gpair[i * kTargets + 2] = GradientPair(0.5f, 1.0f);
+  }
+  HostDeviceVector<GradientPair> gpair(h_gpair);
+
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  Args args{{"max_depth", "2"}, {"reg_lambda", "0"}, {"learning_rate", "1"}};
+  std::unique_ptr<TreeUpdater> updater{TreeUpdater::Create("grow_multi_hist", &lparam)};
+  updater->Configure(args);
+  RegTree tree;
+  tree.param.UpdateAllowUnknown(Args{{"num_feature", std::to_string(kCols)}});
+  tree.param.size_leaf_vector = kTargets;
+  updater->Update(&gpair, p_dmat.get(), {&tree});
+
+  ASSERT_FALSE(tree[0].IsLeaf());
+  ASSERT_EQ(tree[0].SplitIndex(), 2);
+  ASSERT_GT(tree.Stat(0).loss_chg, 0.0f);
+  ASSERT_FLOAT_EQ(tree.Stat(0).sum_hess, kRows * kTargets);
+
+  // Every leaf follows the sign of its rows, the last output is the same everywhere.
+  HostDeviceVector<float> cache(kRows * kTargets, 0.0f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(p_dmat.get(), &cache));
+  auto const& h_cache = cache.ConstHostVector();
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  for (size_t i = 0; i < kRows; ++i) {
+    feats.Fill(page[i]);
+    auto const* leaf = tree.LeafVector(tree.GetLeafIndex(feats));
+    feats.Drop(page[i]);
+    for (size_t k = 0; k < kTargets; ++k) {
+      ASSERT_EQ(h_cache[i * kTargets + k], leaf[k]);
+    }
+    ASSERT_NEAR(leaf[0], -leaf[1], 1e-6);
+    ASSERT_NEAR(leaf[2], -0.5f, 1e-6);
+    float const expected = h_gpair[i * kTargets].GetGrad() > 0 ? -1.0f : 1.0f;
+    ASSERT_NEAR(leaf[0], expected, 1e-6);
+  }
+  delete pp_dmat;
+}
+}  // namespace tree
+}  // namespace xgboost
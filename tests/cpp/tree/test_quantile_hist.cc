@@ -2,17 +2,24 @@
  * Copyright 2018-2019 by Contributors
  */
 #include <xgboost/host_device_vector.h>
+#include <xgboost/objective.h>
 #include <xgboost/tree_updater.h>
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 
 #include "../helpers.h"
 #include "../../../src/tree/param.h"
 #include "../../../src/tree/updater_quantile_hist.h"
 #include "../../../src/tree/split_evaluator.h"
+#include "../../../src/common/random.h"
+#include "../../../src/data/adapter.h"
 #include "xgboost/data.h"
 
 namespace xgboost {
@@ -21,15 +28,19 @@ namespace tree {
 class QuantileHistMock : public QuantileHistMaker {
   static double constexpr kEps = 1e-6;
 
-  struct BuilderMock : public QuantileHistMaker::Builder {
-    using RealImpl = QuantileHistMaker::Builder;
+  template <typename GradientSumT>
+  struct BuilderMock : public QuantileHistMaker::Builder<GradientSumT> {
+    using RealImpl = QuantileHistMaker::Builder<GradientSumT>;
+    using ExpandEntry = typename RealImpl::ExpandEntry;
 
     BuilderMock(const TrainParam& param,
-                std::unique_ptr<TreeUpdater> pruner,
+                const CPUHistMakerTrainParam& hist_maker_param,
+                std::unique_ptr<TreeUpdater> syncher,
                 std::unique_ptr<SplitEvaluator> spliteval,
                 FeatureInteractionConstraintHost int_constraint,
                 DMatrix const* fmat)
-        : RealImpl(param, std::move(pruner), std::move(spliteval), std::move(int_constraint), fmat) {}
+        : RealImpl(param, hist_maker_param, std::move(syncher), std::move(spliteval),
+                   std::move(int_constraint), fmat) {}
 
    public:
     void TestInitData(const GHistIndexMatrix& gmat,
@@ -37,7 +48,7 @@ class QuantileHistMock : public QuantileHistMaker {
                       DMatrix* p_fmat,
                       const RegTree& tree) {
       RealImpl::InitData(gmat, gpair, *p_fmat, tree);
-      ASSERT_EQ(data_layout_, kSparseData);
+      ASSERT_EQ(this->data_layout_, RealImpl::kSparseData);
 
       /* The creation of HistCutMatrix and GHistIndexMatrix are not technically
        * part of QuantileHist updater logic, but we include it here because
@@ -66,14 +77,15 @@ class QuantileHistMock : public QuantileHistMaker {
 
       /* Validate GHistIndexMatrix */
       ASSERT_EQ(gmat.row_ptr.size(), num_row + 1);
-      ASSERT_LT(*std::max_element(gmat.index.begin(), gmat.index.end()),
-                gmat.cut.Ptrs().back());
+      for (size_t i = 0; i < gmat.index.Size(); ++i) {
+        ASSERT_LT(gmat.index[i], gmat.cut.Ptrs().back());
+      }
       for (const auto& batch : p_fmat->GetBatches<xgboost::SparsePage>()) {
         for (size_t i = 0; i < batch.Size(); ++i) {
           const size_t rid = batch.base_rowid + i;
           ASSERT_LT(rid, num_row);
           const size_t gmat_row_offset = gmat.row_ptr[rid];
-          ASSERT_LT(gmat_row_offset, gmat.index.size());
+          ASSERT_LT(gmat_row_offset, gmat.index.Size());
           SparsePage::Inst inst = batch[i];
           ASSERT_EQ(gmat.row_ptr[rid] + inst.size(), gmat.row_ptr[rid + 1]);
           for (size_t j = 0; j < inst.size(); ++j) {
@@ -105,13 +117,13 @@ class QuantileHistMock : public QuantileHistMaker {
             {0.27f, 0.29f}, {0.37f, 0.39f}, {0.47f, 0.49f}, {0.57f, 0.59f} };
       RealImpl::InitData(gmat, gpair, fmat, tree);
       GHistIndexBlockMatrix dummy;
-      hist_.AddHistRow(nid);
-      BuildHist(gpair, row_set_collection_[nid],
-                gmat, dummy, hist_[nid]);
+      this->hist_.AddHistRow(nid);
+      this->BuildHist(gpair, this->row_set_collection_[nid],
+                      gmat, dummy, this->hist_[nid]);
 
       // Check if number of histogram bins is correct
-      ASSERT_EQ(hist_[nid].size(), gmat.cut.Ptrs().back());
-      std::vector<GradientPairPrecise> histogram_expected(hist_[nid].size());
+      ASSERT_EQ(this->hist_[nid].size(), gmat.cut.Ptrs().back());
+      std::vector<GradientPairPrecise> histogram_expected(this->hist_[nid].size());
 
       // Compute the correct histogram (histogram_expected)
       const size_t num_row = fmat.Info().num_row_;
@@ -126,10 +138,10 @@ class QuantileHistMock : public QuantileHistMaker {
       }
 
       // Now validate the computed histogram returned by BuildHist
-      for (size_t i = 0; i < hist_[nid].size(); ++i) {
+      for (size_t i = 0; i < this->hist_[nid].size(); ++i) {
         GradientPairPrecise sol = histogram_expected[i];
-        ASSERT_NEAR(sol.GetGrad(), hist_[nid][i].GetGrad(), kEps);
-        ASSERT_NEAR(sol.GetHess(), hist_[nid][i].GetHess(), kEps);
+        ASSERT_NEAR(sol.GetGrad(), this->hist_[nid][i].GetGrad(), kEps);
+        ASSERT_NEAR(sol.GetHess(), this->hist_[nid][i].GetHess(), kEps);
       }
     }
 
@@ -146,10 +158,10 @@ class QuantileHistMock : public QuantileHistMaker {
       gmat.Init((*dmat).get(), kMaxBins);
 
       RealImpl::InitData(gmat, row_gpairs, *(*dmat), tree);
-      hist_.AddHistRow(0);
+      this->hist_.AddHistRow(0);
 
-      BuildHist(row_gpairs, row_set_collection_[0],
-                gmat, quantile_index_block, hist_[0]);
+      this->BuildHist(row_gpairs, this->row_set_collection_[0],
+                      gmat, quantile_index_block, this->hist_[0]);
 
       RealImpl::InitNewNode(0, gmat, row_gpairs, *(*dmat), tree);
 
@@ -164,7 +176,7 @@ class QuantileHistMock : public QuantileHistMaker {
       }
       // Initialize split evaluator
       std::unique_ptr<SplitEvaluator> evaluator(SplitEvaluator::Create("elastic_net"));
-      evaluator->Init(&param_);
+      evaluator->Init(&this->param_);
 
       // Now enumerate all feature*threshold combination to get best split
       // To simplify logic, we make some assumptions:
@@ -212,10 +224,10 @@ class QuantileHistMock : public QuantileHistMaker {
 
       /* Now compare against result given by EvaluateSplit() */
       ExpandEntry node(ExpandEntry::kRootNid, ExpandEntry::kEmptyNid,
-          tree.GetDepth(0), snode_[0].best.loss_chg, 0);
-      RealImpl::EvaluateSplits({node}, gmat, hist_, tree);
-      ASSERT_EQ(snode_[0].best.SplitIndex(), best_split_feature);
-      ASSERT_EQ(snode_[0].best.split_value, gmat.cut.Values()[best_split_threshold]);
+          tree.GetDepth(0), this->snode_[0].best.loss_chg, 0);
+      RealImpl::EvaluateSplits({node}, gmat, this->hist_, tree);
+      ASSERT_EQ(this->snode_[0].best.SplitIndex(), best_split_feature);
+      ASSERT_EQ(this->snode_[0].best.split_value, gmat.cut.Values()[best_split_threshold]);
 
       delete dmat;
     }
@@ -227,12 +239,56 @@ class QuantileHistMock : public QuantileHistMaker {
       omp_set_num_threads(1);
     }
 
+    std::vector<size_t> TestSampleRows(const std::vector<GradientPair>& gpair,
+                                       int32_t n_threads) {
+      this->nthread_ = n_threads;
+      common::GlobalRandom().seed(1994);
+      std::vector<size_t> rows;
+      RealImpl::SampleRows(gpair, gpair.size(), &rows);
+      return rows;
+    }
+
+    const std::vector<GradientPair>& GetSampledGradients() const {
+      return this->gpair_sampled_;
+    }
+
+    std::vector<uint8_t> TestFeatureSplittable(const GHistIndexMatrix& gmat,
+                                               const std::vector<GradientPair>& gpair,
+                                               DMatrix* p_fmat) {
+      RegTree tree;
+      RealImpl::InitData(gmat, gpair, *p_fmat, tree);
+      return this->feature_splittable_;
+    }
+
+    std::vector<uint8_t> const& FeatureMissing() const {
+      return this->feature_missing_;
+    }
+
+    void TestLazyHistograms(const GHistIndexMatrix& gmat,
+                            HostDeviceVector<GradientPair>* gpair,
+                            DMatrix* p_fmat, RegTree* p_tree) {
+      ColumnMatrix column_matrix;
+      column_matrix.Init(gmat, this->param_.sparse_threshold);
+      GHistIndexBlockMatrix gmatb;
+      RealImpl::Update(gmat, gmatb, column_matrix, gpair, p_fmat, p_tree);
+      // nodes at the depth limit never get a histogram, so nothing is left at the end
+      size_t n_deepest = 0;
+      for (int nid = 0; nid < p_tree->param.num_nodes; ++nid) {
+        if (p_tree->GetDepth(nid) == this->param_.max_depth) {
+          ++n_deepest;
+        }
+        ASSERT_FALSE(this->hist_.RowExists(nid));
+      }
+      ASSERT_GT(n_deepest, 0);
+      ASSERT_EQ(this->hist_.NumRows(), 0);
+    }
   };
 
   int static constexpr kNRows = 8, kNCols = 16;
   std::shared_ptr<xgboost::DMatrix> *dmat_;
   const std::vector<std::pair<std::string, std::string> > cfg_;
-  std::shared_ptr<BuilderMock> builder_;
+  std::shared_ptr<BuilderMock<float> > float_builder_;
+  std::shared_ptr<BuilderMock<double> > double_builder_;
 
  public:
   explicit QuantileHistMock(
@@ -241,13 +297,25 @@ class QuantileHistMock : public QuantileHistMaker {
     QuantileHistMaker::Configure(args);
     spliteval_->Init(&param_);
     dmat_ = CreateDMatrix(kNRows, kNCols, 0.8, 3);
-    builder_.reset(
-        new BuilderMock(
-            param_,
-            std::move(pruner_),
-            std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
-            int_constraint_,
-            dmat_->get()));
+    if (hist_maker_param_.single_precision_histogram) {
+      float_builder_.reset(
+          new BuilderMock<float>(
+              param_,
+              hist_maker_param_,
+              std::move(syncher_),
+              std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
+              int_constraint_,
+              dmat_->get()));
+    } else {
+      double_builder_.reset(
+          new BuilderMock<double>(
+              param_,
+              hist_maker_param_,
+              std::move(syncher_),
+              std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
+              int_constraint_,
+              dmat_->get()));
+    }
   }
   ~QuantileHistMock() override { delete dmat_; }
 
@@ -265,7 +333,11 @@ class QuantileHistMock : public QuantileHistMaker {
         { {0.23f, 0.24f}, {0.23f, 0.24f}, {0.23f, 0.24f}, {0.23f, 0.24f},
           {0.27f, 0.29f}, {0.27f, 0.29f}, {0.27f, 0.29f}, {0.27f, 0.29f} };
 
-    builder_->TestInitData(gmat, gpair, dmat_->get(), tree);
+    if (double_builder_) {
+      double_builder_->TestInitData(gmat, gpair, dmat_->get(), tree);
+    } else {
+      float_builder_->TestInitData(gmat, gpair, dmat_->get(), tree);
+    }
   }
 
   void TestBuildHist() {
@@ -276,14 +348,128 @@ class QuantileHistMock : public QuantileHistMaker {
     common::GHistIndexMatrix gmat;
     gmat.Init((*dmat_).get(), kMaxBins);
 
-    builder_->TestBuildHist(0, gmat, *(*dmat_).get(), tree);
+    if (double_builder_) {
+      double_builder_->TestBuildHist(0, gmat, *(*dmat_).get(), tree);
+    } else {
+      float_builder_->TestBuildHist(0, gmat, *(*dmat_).get(), tree);
+    }
+  }
+
+  void TestSampleRows() {
+    constexpr size_t kRows = 100000;
+    std::vector<GradientPair> gpair(kRows, GradientPair(0.5f, 1.0f));
+    for (size_t i = 0; i < kRows; i += 10) {
+      gpair[i] = GradientPair(0.5f, -1.0f);
+    }
+    auto sample = [&](int32_t n_threads) {
+      return double_builder_ ? double_builder_->TestSampleRows(gpair, n_threads)
+                             : float_builder_->TestSampleRows(gpair, n_threads);
+    };
+    auto rows = sample(1);
+    // the sample doesn't depend on the number of threads
+    ASSERT_EQ(rows, sample(4));
+    ASSERT_TRUE(std::is_sorted(rows.cbegin(), rows.cend()));
+    for (auto rid : rows) {
+      ASSERT_GE(gpair[rid].GetHess(), 0.0f);
+    }
+    const double n_positive = kRows * 0.9;
+    ASSERT_NEAR(rows.size() / n_positive, param_.subsample, 0.02);
+  }
+
+  void TestGradientBasedSampling() {
+    constexpr size_t kRows = 100000;
+    std::vector<GradientPair> gpair(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      // a few rows with large gradients, the others small
+      gpair[i] = GradientPair(i % 100 == 0 ? 100.0f : 0.1f * std::sin(0.01f * i), 1.0f);
+    }
+    auto rows = double_builder_->TestSampleRows(gpair, 1);
+    auto const sampled = double_builder_->GetSampledGradients();
+    ASSERT_EQ(rows, double_builder_->TestSampleRows(gpair, 4));
+    ASSERT_EQ(sampled, double_builder_->GetSampledGradients());
+    ASSERT_TRUE(std::is_sorted(rows.cbegin(), rows.cend()));
+    ASSERT_NEAR(rows.size(), kRows * param_.subsample, kRows * 0.01);
+
+    // rows with large gradients are always selected at their own weight, the
+    // others are scaled by the inverse of their probability
+    double sum_grad = 0, sum_sampled = 0;
+    for (size_t i = 0; i < kRows; ++i) {
+      sum_grad += gpair[i].GetHess();
+    }
+    size_t n_large = 0;
+    for (auto rid : rows) {
+      sum_sampled += sampled[rid].GetHess();
+      if (rid % 100 == 0) {
+        ASSERT_EQ(sampled[rid], gpair[rid]);
+        ++n_large;
+      } else {
+        ASSERT_GT(sampled[rid].GetHess(), gpair[rid].GetHess());
+      }
+    }
+    ASSERT_EQ(n_large, kRows / 100);
+    ASSERT_NEAR(sum_sampled / sum_grad, 1.0, 0.05);
+  }
+
+  void TestFeatureSplittable() {
+    // feature 0 is constant, 1 is missing everywhere, 2 has a single value and missing
+    // ones, 3 is regular
+    constexpr size_t kRows = 64, kCols = 4;
+    const float kMissing = -1.0f;
+    std::vector<float> data(kRows * kCols);
+    for (size_t i = 0; i < kRows; ++i) {
+      data[i * kCols + 0] = 1.0f;
+      data[i * kCols + 1] = kMissing;
+      data[i * kCols + 2] = i % 2 == 0 ? 2.0f : kMissing;
+      data[i * kCols + 3] = static_cast<float>(i);
+    }
+    DMatrixHandle handle;
+    XGDMatrixCreateFromMat(data.data(), kRows, kCols, kMissing, &handle);
+    auto dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+    GHistIndexMatrix gmat;
+    gmat.Init(dmat->get(), 16);
+    std::vector<GradientPair> gpair(kRows, GradientPair(0.5f, 1.0f));
+    auto splittable = double_builder_
+        ? double_builder_->TestFeatureSplittable(gmat, gpair, dmat->get())
+        : float_builder_->TestFeatureSplittable(gmat, gpair, dmat->get());
+    std::vector<uint8_t> expected {0, 0, 1, 1};
+    ASSERT_EQ(splittable, expected);
+    // only features without missing values skip the backward enumeration
+    auto const& missing = double_builder_ ? double_builder_->FeatureMissing()
+                                          : float_builder_->FeatureMissing();
+    std::vector<uint8_t> expected_missing {0, 1, 1, 0};
+    ASSERT_EQ(missing, expected_missing);
+    delete dmat;
+  }
+
+  void TestLazyHistograms() {
+    constexpr size_t kRows = 2000, kCols = 6;
+    auto dmat = CreateDMatrix(kRows, kCols, 0.0, 3);
+    GHistIndexMatrix gmat;
+    gmat.Init(dmat->get(), 32);
+    HostDeviceVector<GradientPair> gpair(kRows);
+    auto& h_gpair = gpair.HostVector();
+    for (size_t i = 0; i < kRows; ++i) {
+      h_gpair[i] = GradientPair(std::cos(0.13f * i), 1.0f);
+    }
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(cfg_);
+    if (double_builder_) {
+      double_builder_->TestLazyHistograms(gmat, &gpair, dmat->get(), &tree);
+    } else {
+      float_builder_->TestLazyHistograms(gmat, &gpair, dmat->get(), &tree);
+    }
+    delete dmat;
   }
 
   void TestEvaluateSplit() {
     RegTree tree = RegTree();
     tree.param.UpdateAllowUnknown(cfg_);
 
-    builder_->TestEvaluateSplit(gmatb_, tree);
+    if (double_builder_) {
+      double_builder_->TestEvaluateSplit(gmatb_, tree);
+    } else {
+      float_builder_->TestEvaluateSplit(gmatb_, tree);
+    }
   }
 };
 
@@ -292,6 +478,41 @@ TEST(Updater, QuantileHist_InitData) {
       {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())}};
   QuantileHistMock maker(cfg);
   maker.TestInitData();
+  cfg.emplace_back("single_precision_histogram", "true");
+  QuantileHistMock maker_float(cfg);
+  maker_float.TestInitData();
+}
+
+TEST(Updater, QuantileHist_SampleRows) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())},
+       {"subsample", "0.5"}};
+  QuantileHistMock maker(cfg);
+  maker.TestSampleRows();
+}
+
+TEST(Updater, QuantileHist_GradientBasedSampling) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())},
+       {"subsample", "0.2"}, {"sampling_method", "gradient_based"}};
+  QuantileHistMock maker(cfg);
+  maker.TestGradientBasedSampling();
+}
+
+TEST(Updater, QuantileHist_FeatureSplittable) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", "4"}};
+  QuantileHistMock maker(cfg);
+  maker.TestFeatureSplittable();
+}
+
+TEST(Updater, QuantileHist_LazyHistograms) {
+  for (std::string grow_policy : {"depthwise", "lossguide"}) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", "6"}, {"max_depth", "3"}, {"grow_policy", grow_policy}};
+    QuantileHistMock maker(cfg);
+    maker.TestLazyHistograms();
+  }
 }
 
 TEST(Updater, QuantileHist_BuildHist) {
@@ -301,6 +522,9 @@ TEST(Updater, QuantileHist_BuildHist) {
        {"enable_feature_grouping", std::to_string(0)}};
   QuantileHistMock maker(cfg);
   maker.TestBuildHist();
+  cfg.emplace_back("single_precision_histogram", "true");
+  QuantileHistMock maker_float(cfg);
+  maker_float.TestBuildHist();
 }
 
 TEST(Updater, QuantileHist_EvalSplits) {
@@ -311,6 +535,523 @@ TEST(Updater, QuantileHist_EvalSplits) {
        {"min_child_weight", "0"}};
   QuantileHistMock maker(cfg);
   maker.TestEvaluateSplit();
+  // With float histograms the sum over all bins of a feature differs from the node
+  // total by rounding, so an empty child no longer has exactly zero hessian.
+  cfg.back().second = "1e-3";
+  cfg.emplace_back("single_precision_histogram", "true");
+  QuantileHistMock maker_float(cfg);
+  maker_float.TestEvaluateSplit();
+}
+
+TEST(Updater, QuantileHist_QuantizedGradient) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::sin(0.1f * i) + 0.01f * (i % 13), 0.5f + 0.001f * (i % 97));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string quantization, int n_threads) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+               {"gradient_quantization", quantization}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    omp_set_num_threads(n_threads);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    omp_set_num_threads(1);
+    return tree;
+  };
+
+  RegTree reference = train("none", 1);
+  for (auto quantization : {"int16", "int32"}) {
+    RegTree single = train(quantization, 1);
+    ASSERT_GT(single.NumExtraNodes(), 0);
+    // integer sums do not depend on the order of additions
+    ASSERT_TRUE(single == train(quantization, 4));
+    ASSERT_EQ(single[0].SplitIndex(), reference[0].SplitIndex());
+    ASSERT_EQ(single[0].SplitCond(), reference[0].SplitCond());
+    ASSERT_NEAR(single.Stat(0).sum_hess, reference.Stat(0).sum_hess, 1e-2);
+  }
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_SubsamplePredictionCache) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::sin(0.2f * i), 0.5f + 0.001f * (i % 71));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+             {"subsample", "0.5"}};
+  RegTree tree;
+  tree.param.UpdateAllowUnknown(args);
+  std::unique_ptr<TreeUpdater> updater(
+      TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+  updater->Configure(args);
+  updater->Update(&gpair, dmat->get(), {&tree});
+  ASSERT_GT(tree.NumExtraNodes(), 0);
+
+  // the cache covers the rows left out of the sample as well
+  HostDeviceVector<bst_float> preds(kRows, 0.0f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(dmat->get(), &preds));
+  auto const& h_preds = preds.ConstHostVector();
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  for (auto const& batch : (*dmat)->GetBatches<SparsePage>()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      feats.Fill(batch[i]);
+      ASSERT_EQ(h_preds[i], tree[tree.GetLeafIndex(feats)].LeafValue());
+      feats.Drop(batch[i]);
+    }
+  }
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_LossguideBatch) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::cos(0.7f * i), 0.5f + 0.001f * (i % 83));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string max_leaves, std::string batch_size) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"grow_policy", "lossguide"},
+               {"max_depth", "5"}, {"max_leaves", max_leaves},
+               {"gradient_quantization", "int32"}, {"lossguide_batch_size", batch_size}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    return tree;
+  };
+  auto leaf_values = [&](RegTree const& tree) {
+    std::vector<bst_float> values;
+    RegTree::FVec feats;
+    feats.Init(kCols);
+    for (auto const& batch : (*dmat)->GetBatches<SparsePage>()) {
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        feats.Fill(batch[i]);
+        values.push_back(tree[tree.GetLeafIndex(feats)].LeafValue());
+        feats.Drop(batch[i]);
+      }
+    }
+    return values;
+  };
+
+  // without a leaf limit every candidate is expanded, only node ids differ
+  RegTree single = train("0", "1");
+  RegTree batched = train("0", "8");
+  ASSERT_GT(single.NumExtraNodes(), 0);
+  ASSERT_EQ(single.NumExtraNodes(), batched.NumExtraNodes());
+  ASSERT_EQ(leaf_values(single), leaf_values(batched));
+
+  // the leaf limit holds for batches
+  RegTree limited = train("7", "4");
+  ASSERT_EQ(limited.NumExtraNodes(), 2 * (7 - 1));
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_MinSplitLoss) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::sin(0.9f * i), 0.5f + 0.001f * (i % 71));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string grow_policy, std::string gamma) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"grow_policy", grow_policy},
+               {"max_depth", "6"}, {"min_split_loss", gamma}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    return tree;
+  };
+  auto split_gains = [](RegTree const& tree) {
+    std::vector<float> gains;
+    for (int32_t nid = 0; nid < tree.param.num_nodes; ++nid) {
+      EXPECT_FALSE(tree[nid].IsDeleted());
+      if (!tree[nid].IsLeaf()) {
+        gains.push_back(tree.Stat(nid).loss_chg);
+      }
+    }
+    return gains;
+  };
+
+  for (auto const& grow_policy : {"depthwise", "lossguide"}) {
+    auto gains = split_gains(train(grow_policy, "0"));
+    ASSERT_GT(gains.size(), 4u);
+    std::sort(gains.begin(), gains.end());
+    std::string const gamma = std::to_string(gains[gains.size() / 2]);
+    // splits gaining less than gamma are never grown, no pruning is left to be done
+    auto pruned = split_gains(train(grow_policy, gamma));
+    ASSERT_FALSE(pruned.empty());
+    ASSERT_LT(pruned.size(), gains.size());
+    for (auto gain : pruned) {
+      ASSERT_GE(gain, std::stof(gamma));
+    }
+  }
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_MaxHistBytes) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::cos(0.3f * i), 0.5f + 0.001f * (i % 89));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string max_hist_bytes) {
+    // integer histograms make explicit builds and the subtraction trick agree exactly
+    Args args {{"num_feature", std::to_string(kCols)}, {"grow_policy", "lossguide"},
+               {"max_depth", "0"}, {"max_leaves", "32"}, {"min_child_weight", "0"},
+               {"gradient_quantization", "int32"}, {"max_hist_bytes", max_hist_bytes}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    return tree;
+  };
+
+  RegTree unlimited = train("0");
+  ASSERT_GT(unlimited.NumExtraNodes(), 32);
+  // only the histograms needed by a single split fit
+  RegTree limited = train("1");
+  ASSERT_TRUE(unlimited == limited);
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_FeatureBundling) {
+  // two dense features, then one-hot encoded features with 8 and 5 categories
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 2 + 8 + 5;
+  std::vector<float> data;
+  std::vector<unsigned> feature_idx;
+  std::vector<size_t> row_ptr {0};
+  for (size_t i = 0; i < kRows; ++i) {
+    data.push_back(std::sin(0.1f * i));
+    feature_idx.push_back(0);
+    data.push_back(static_cast<float>(i % 31));
+    feature_idx.push_back(1);
+    if (i % 9 != 0) {  // missing for some rows
+      data.push_back(1.0f);
+      feature_idx.push_back(2 + (i * 5) % 8);
+    }
+    data.push_back(1.0f);
+    feature_idx.push_back(2 + 8 + (i * 3) % 5);
+    row_ptr.push_back(data.size());
+  }
+  data::CSRAdapter adapter(row_ptr.data(), feature_idx.data(), data.data(), kRows,
+                           data.size(), kCols);
+  std::unique_ptr<DMatrix> dmat(
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1));
+
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::cos(0.7f * i) + 0.3f * ((i * 5) % 8),
+                              0.5f + 0.001f * (i % 83));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string feature_bundling) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "6"},
+               {"gradient_quantization", "int32"},
+               {"feature_bundling", feature_bundling}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat.get(), {&tree});
+    return tree;
+  };
+
+  RegTree plain = train("false");
+  RegTree bundled = train("true");
+  ASSERT_GT(plain.NumExtraNodes(), 0);
+  ASSERT_TRUE(plain == bundled);
+}
+
+TEST(Updater, QuantileHist_NumaAware) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::cos(0.3f * i), 0.5f + 0.001f * (i % 89));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string numa_aware) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "6"},
+               {"gradient_quantization", "int32"}, {"numa_aware", numa_aware}};
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    return tree;
+  };
+
+  RegTree plain = train("false");
+  RegTree pinned = train("true");
+  ASSERT_GT(plain.NumExtraNodes(), 0);
+  ASSERT_TRUE(plain == pinned);
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_PackedGradients) {
+  size_t constexpr kRows = 3000;
+  size_t constexpr kCols = 8;
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::sin(0.37f * i), 0.5f + 0.001f * (i % 71));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  for (float sparsity : {0.0f, 0.3f}) {
+    auto dmat = CreateDMatrix(kRows, kCols, sparsity, 3);
+    auto train = [&](std::string grow_policy, std::string packed_gradients) {
+      Args args {{"num_feature", std::to_string(kCols)}, {"grow_policy", grow_policy},
+                 {"max_depth", "6"}, {"max_leaves", "24"}, {"gradient_quantization", "int32"},
+                 {"packed_gradients", packed_gradients}};
+      RegTree tree;
+      tree.param.UpdateAllowUnknown(args);
+      std::unique_ptr<TreeUpdater> updater(
+          TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+      updater->Configure(args);
+      updater->Update(&gpair, dmat->get(), {&tree});
+      return tree;
+    };
+    for (std::string grow_policy : {"depthwise", "lossguide"}) {
+      RegTree plain = train(grow_policy, "false");
+      RegTree packed = train(grow_policy, "true");
+      ASSERT_GT(plain.NumExtraNodes(), 0);
+      ASSERT_TRUE(plain == packed);
+    }
+    delete dmat;
+  }
+}
+
+TEST(Updater, QuantileHist_FusedGradient) {
+  size_t constexpr kRows = 3000;
+  size_t constexpr kCols = 8;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  auto& info = (*dmat)->Info();
+  HostDeviceVector<bst_float> preds(kRows);
+  auto& labels = info.labels_.HostVector();
+  labels.resize(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    preds.HostVector()[i] = std::sin(0.37f * i);
+    labels[i] = std::cos(0.11f * i);
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<ObjFunction> obj {ObjFunction::Create("reg:squarederror", &lparam)};
+  obj->Configure({});
+
+  Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "6"}};
+  auto train = [&](bool fused) {
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(args);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    HostDeviceVector<GradientPair> gpair;
+    if (fused) {
+      auto grad = obj->GetElementWiseGradient(preds, info, 0);
+      EXPECT_TRUE(updater->UpdateWithGradient(grad.get(), &gpair, dmat->get(), {&tree}));
+    } else {
+      obj->GetGradient(preds, info, 0, &gpair);
+      updater->Update(&gpair, dmat->get(), {&tree});
+    }
+    return std::make_pair(tree, gpair.ConstHostVector());
+  };
+  auto expected = train(false);
+  auto fused = train(true);
+  ASSERT_GT(expected.first.NumExtraNodes(), 0);
+  ASSERT_TRUE(expected.first == fused.first);
+  ASSERT_EQ(expected.second, fused.second);
+
+  // sampled rows need the gradient beforehand
+  args.emplace_back("subsample", "0.5");
+  RegTree tree;
+  std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+  updater->Configure(args);
+  HostDeviceVector<GradientPair> gpair;
+  auto grad = obj->GetElementWiseGradient(preds, info, 0);
+  ASSERT_FALSE(updater->UpdateWithGradient(grad.get(), &gpair, dmat->get(), {&tree}));
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_ConcurrentTrees) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 10;
+  size_t constexpr kTrees = 4;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::cos(0.3f * i), 0.5f + 0.001f * (i % 89));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  auto train = [&](std::string concurrent_trees, std::string subsample) {
+    Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "6"},
+               {"gradient_quantization", "int32"}, {"subsample", subsample},
+               {"concurrent_trees", concurrent_trees}};
+    std::vector<RegTree> trees(kTrees);
+    std::vector<RegTree*> p_trees;
+    for (auto& tree : trees) {
+      tree.param.UpdateAllowUnknown(args);
+      p_trees.push_back(&tree);
+    }
+    common::GlobalRandom().seed(3);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+    updater->Configure(args);
+    updater->Update(&gpair, dmat->get(), p_trees);
+    return trees;
+  };
+
+  // without sampling every tree of the forest is the same
+  auto sequential = train("1", "1.0");
+  ASSERT_GT(sequential.front().NumExtraNodes(), 0);
+  for (auto concurrent_trees : {"3", "4"}) {
+    auto concurrent = train(concurrent_trees, "1.0");
+    for (size_t i = 0; i < kTrees; ++i) {
+      ASSERT_TRUE(sequential[i] == concurrent[i]);
+    }
+  }
+
+  // row samples don't depend on which group grows a tree
+  auto sampled = train("3", "0.6");
+  auto again = train("3", "0.6");
+  ASSERT_FALSE(sampled[0] == sampled[1]);
+  for (size_t i = 0; i < kTrees; ++i) {
+    ASSERT_TRUE(sampled[i] == again[i]);
+  }
+  delete dmat;
+}
+
+TEST(Updater, QuantileHist_Categorical) {
+  size_t constexpr kRows = 1000;
+  size_t constexpr kCols = 2;
+  size_t constexpr kCats = 8;
+  std::vector<float> x(kRows * kCols);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    size_t const cat = i % kCats;
+    x[i * kCols] = static_cast<float>(cat);
+    x[i * kCols + 1] = 0.1f * (i % 13);
+    // categories 1 and 5 are apart from their neighbours, no threshold isolates them
+    h_gpair[i] = GradientPair((cat == 1 || cat == 5) ? -1.0f : 1.0f, 1.0f);
+  }
+  data::DenseAdapter adapter(x.data(), kRows, kCols);
+  std::unique_ptr<DMatrix> dmat(
+      DMatrix::Create(&adapter, std::numeric_limits<float>::quiet_NaN(), 1));
+  std::vector<float> types {1.0f, 0.0f};
+  dmat->Info().SetInfo("feature_type", types.data(), DataType::kFloat32, kCols);
+
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  Args args {{"num_feature", std::to_string(kCols)}, {"max_depth", "2"}};
+  RegTree tree;
+  tree.param.UpdateAllowUnknown(args);
+  std::unique_ptr<TreeUpdater> updater(
+      TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+  updater->Configure(args);
+  updater->Update(&gpair, dmat.get(), {&tree});
+
+  ASSERT_EQ(tree[0].SplitIndex(), 0);
+  ASSERT_EQ(tree.NodeSplitType(0), FeatureType::kCategorical);
+  for (size_t cat = 0; cat < kCats; ++cat) {
+    bool const left = cat == 1 || cat == 5;
+    ASSERT_EQ(tree.GetNext(0, static_cast<float>(cat), false),
+              left ? tree[0].LeftChild() : tree[0].RightChild());
+  }
+
+  // rows are partitioned the same way as the tree predicts them
+  HostDeviceVector<bst_float> preds(kRows, 0.0f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(dmat.get(), &preds));
+  auto const& h_preds = preds.ConstHostVector();
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  for (auto const& batch : dmat->GetBatches<SparsePage>()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      feats.Fill(batch[i]);
+      ASSERT_EQ(h_preds[i], tree[tree.GetLeafIndex(feats)].LeafValue());
+      feats.Drop(batch[i]);
+    }
+  }
+}
+
+TEST(Updater, QuantileHist_SmallNodeEnumeration) {
+  size_t constexpr kRows = 3000;
+  size_t constexpr kCols = 8;
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(std::sin(0.23f * i), 0.5f + 0.001f * (i % 67));
+  }
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  for (float sparsity : {0.0f, 0.3f}) {
+    auto dmat = CreateDMatrix(kRows, kCols, sparsity, 3);
+    auto train = [&](std::string grow_policy, std::string small_node_ratio) {
+      Args args {{"num_feature", std::to_string(kCols)}, {"grow_policy", grow_policy},
+                 {"max_depth", "8"}, {"max_leaves", "48"}, {"min_child_weight", "0"},
+                 {"gradient_quantization", "int32"}, {"small_node_ratio", small_node_ratio}};
+      RegTree tree;
+      tree.param.UpdateAllowUnknown(args);
+      std::unique_ptr<TreeUpdater> updater(
+          TreeUpdater::Create("grow_quantile_histmaker", &lparam));
+      updater->Configure(args);
+      updater->Update(&gpair, dmat->get(), {&tree});
+      return tree;
+    };
+    for (std::string grow_policy : {"depthwise", "lossguide"}) {
+      RegTree plain = train(grow_policy, "0");
+      ASSERT_GT(plain.NumExtraNodes(), 0);
+      // some nodes enumerated, then every node but the root
+      for (std::string ratio : {"0.5", "1000"}) {
+        RegTree enumerated = train(grow_policy, ratio);
+        ASSERT_TRUE(plain == enumerated) << grow_policy << " " << ratio;
+      }
+    }
+    delete dmat;
+  }
 }
 
 }  // namespace tree
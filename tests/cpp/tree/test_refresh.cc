@@ -10,6 +10,7 @@
 #include <memory>
 
 #include "../helpers.h"
+#include "../../../src/common/hist_util.h"
 
 namespace xgboost {
 namespace tree {
@@ -52,5 +53,60 @@ TEST(Updater, Refresh) {
   delete dmat;
 }
 
+TEST(Updater, RefreshQuantized) {
+  size_t constexpr kNRows = 64, kNCols = 4;
+  std::vector<std::pair<std::string, std::string>> cfg {
+    {"num_feature", std::to_string(kNCols)},
+    {"reg_lambda", "1"}};
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+
+  std::vector<GradientPair> h_gpair(kNRows);
+  for (size_t i = 0; i < kNRows; ++i) {
+    h_gpair[i] = {static_cast<float>(i % 7) - 3.0f, 1.0f + static_cast<float>(i % 3)};
+  }
+  HostDeviceVector<GradientPair> gpair(h_gpair);
+
+  // same data, only the first one has a quantized matrix
+  auto quantized = CreateDMatrix(kNRows, kNCols, 0.2, 3);
+  auto raw = CreateDMatrix(kNRows, kNCols, 0.2, 3);
+  auto const& gmat = *(*quantized)->GetBatches<common::GHistIndexMatrix>(
+      BatchParam{GenericParameter::kCpuId, 16, 0}).begin();
+  auto const& ptrs = gmat.cut.Ptrs();
+  auto const& values = gmat.cut.Values();
+  ASSERT_GE(ptrs[2] - ptrs[1], 3);
+  ASSERT_GE(ptrs[3] - ptrs[2], 3);
+
+  auto make_tree = [&]() {
+    RegTree tree;
+    tree.param.UpdateAllowUnknown(cfg);
+    tree.ExpandNode(0, 1, values[ptrs[1] + 1], true, 0.0, 0.2f, 0.8f, 0.0f, 0.0f);
+    tree.ExpandNode(tree[0].LeftChild(), 2, values[ptrs[2]], false,
+                    0.0, 0.1f, 0.3f, 0.0f, 0.0f);
+    return tree;
+  };
+
+  RegTree expected = make_tree();
+  RegTree got = make_tree();
+  for (auto pair : std::vector<std::pair<DMatrix*, RegTree*>>{
+           {raw->get(), &expected}, {quantized->get(), &got}}) {
+    std::unique_ptr<TreeUpdater> refresher(TreeUpdater::Create("refresh", &lparam));
+    refresher->Configure(cfg);
+    refresher->Update(&gpair, pair.first, {pair.second});
+  }
+
+  bst_float constexpr kEps = 1e-6;
+  ASSERT_EQ(expected.param.num_nodes, got.param.num_nodes);
+  for (int32_t nid = 0; nid < got.param.num_nodes; ++nid) {
+    ASSERT_NEAR(expected.Stat(nid).sum_hess, got.Stat(nid).sum_hess, kEps);
+    ASSERT_NEAR(expected.Stat(nid).loss_chg, got.Stat(nid).loss_chg, kEps);
+    if (got[nid].IsLeaf()) {
+      ASSERT_NEAR(expected[nid].LeafValue(), got[nid].LeafValue(), kEps);
+    }
+  }
+
+  delete quantized;
+  delete raw;
+}
+
 }  // namespace tree
 }  // namespace xgboost
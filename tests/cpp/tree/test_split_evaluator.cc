@@ -0,0 +1,61 @@
+/*!
+ * Copyright 2020 by Contributors
+ */
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../../src/tree/param.h"
+#include "../../../src/tree/split_evaluator.h"
+
+namespace xgboost {
+namespace tree {
+
+TEST(SplitEvaluator, StaticComposition) {
+  TrainParam param;
+  param.UpdateAllowUnknown(Args{{"reg_alpha", "0.1"}, {"reg_lambda", "2"},
+                                {"monotone_constraints", "(1,-1,0)"}});
+  std::unique_ptr<SplitEvaluator> chain(SplitEvaluator::Create("elastic_net,monotonic"));
+  chain->Init(&param);
+  // bounds of the children of node 0, split on the increasing feature
+  chain->AddSplit(0, 1, 2, 0, -0.5f, 0.5f);
+
+  StaticEvaluatorState state;
+  ASSERT_TRUE(chain->GetStaticState(&state));
+  ASSERT_NE(state.lower, nullptr);
+  StaticSplitEvaluator<true> composed{state};
+
+  std::vector<GradStats> stats {GradStats{-2.0, 1.0}, GradStats{3.0, 4.0},
+                                GradStats{0.05, 0.5}, GradStats{-7.0, 2.0}};
+  for (bst_uint nid : {0u, 1u, 2u}) {
+    for (bst_uint fid : {0u, 1u, 2u, 5u}) {
+      for (auto const& left : stats) {
+        for (auto const& right : stats) {
+          ASSERT_FLOAT_EQ(composed.ComputeSplitScore(nid, fid, left, right),
+                          chain->ComputeSplitScore(nid, fid, left, right));
+        }
+      }
+    }
+    ASSERT_FLOAT_EQ(composed.ComputeWeight(nid, stats[3]),
+                    chain->ComputeWeight(nid, stats[3]));
+  }
+
+  // without constraints the chain is the elastic net alone
+  std::unique_ptr<SplitEvaluator> elastic_net(SplitEvaluator::Create("elastic_net"));
+  elastic_net->Init(&param);
+  ASSERT_TRUE(elastic_net->GetStaticState(&state));
+  ASSERT_EQ(state.lower, nullptr);
+  StaticSplitEvaluator<false> plain{state};
+  for (auto const& left : stats) {
+    for (auto const& right : stats) {
+      ASSERT_FLOAT_EQ(plain.ComputeSplitScore(0, 0, left, right),
+                      elastic_net->ComputeSplitScore(0, 0, left, right));
+    }
+  }
+}
+
+}  // namespace tree
+}  // namespace xgboost
@@ -0,0 +1,41 @@
+/*!
+ * Copyright 2020 by Contributors
+ */
+#include <gtest/gtest.h>
+#include <xgboost/tree_model.h>
+#include <xgboost/tree_updater.h>
+
+#include <memory>
+#include <vector>
+
+#include "../helpers.h"
+#include "../../../src/tree/updater_sync.h"
+
+namespace xgboost {
+namespace tree {
+
+TEST(Updater, TreeHash) {
+  RegTree tree;
+  tree.ExpandNode(0, 1, 0.5f, true, 0.0f, -1.0f, 1.0f, 2.0f, 4.0f);
+  RegTree same;
+  same.ExpandNode(0, 1, 0.5f, true, 0.0f, -1.0f, 1.0f, 2.0f, 4.0f);
+  ASSERT_EQ(TreeHash(tree), TreeHash(same));
+
+  RegTree other_cond;
+  other_cond.ExpandNode(0, 1, 0.25f, true, 0.0f, -1.0f, 1.0f, 2.0f, 4.0f);
+  ASSERT_NE(TreeHash(tree), TreeHash(other_cond));
+  RegTree other_stat;
+  other_stat.ExpandNode(0, 1, 0.5f, true, 0.0f, -1.0f, 1.0f, 2.0f, 5.0f);
+  ASSERT_NE(TreeHash(tree), TreeHash(other_stat));
+
+  // a single worker is always synchronized, and its trees are left alone
+  std::vector<RegTree*> trees {&tree};
+  ASSERT_TRUE(TreesSynchronized(trees));
+  auto lparam = CreateEmptyGenericParam(GPUIDX);
+  std::unique_ptr<TreeUpdater> syncher {TreeUpdater::Create("sync", &lparam)};
+  syncher->Configure({{"tree_sync", "full"}});
+  syncher->Update(nullptr, nullptr, trees);
+  ASSERT_EQ(TreeHash(tree), TreeHash(same));
+}
+}  // namespace tree
+}  // namespace xgboost
@@ -1,9 +1,16 @@
 // Copyright by Contributors
 #include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include <xgboost/tree_model.h>
 #include "../helpers.h"
 #include "dmlc/filesystem.h"
 #include "xgboost/json_io.h"
+#include "../../../src/common/io.h"
+#include "../../../src/common/categorical.h"
 
 namespace xgboost {
 // Manually construct tree in binary format
@@ -103,6 +110,52 @@ TEST(Tree, AllocateNode) {
   ASSERT_TRUE(nodes.at(2).IsLeaf());
 }
 
+TEST(Tree, Compact) {
+  RegTree tree;
+  tree.ExpandNode(0, 0, 0.0f, true, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+  auto const left = tree[0].LeftChild();
+  auto const right = tree[0].RightChild();
+  // both children of the left split predict the same value
+  tree.ExpandNode(left, 1, 1.0f, false, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f);
+  tree.ExpandNode(right, 2, 2.0f, false, 0.0f, 1.0f, 2.0f, 0.0f, 0.0f);
+  // a pruned split leaves deleted slots behind
+  tree.ExpandNode(tree[right].RightChild(), 1, 3.0f, true, 0.0f, 3.0f, 4.0f, 0.0f, 0.0f);
+  tree.CollapseToLeaf(tree[right].RightChild(), 2.0f);
+  ASSERT_EQ(tree.param.num_nodes, 9);
+  ASSERT_EQ(tree.param.num_deleted, 2);
+
+  auto predict = [](RegTree const& t, std::vector<float> const& x) {
+    bst_node_t nid = 0;
+    while (!t[nid].IsLeaf()) {
+      auto const fidx = t[nid].SplitIndex();
+      nid = t.GetNext(nid, x[fidx], std::isnan(x[fidx]));
+    }
+    return t[nid].LeafValue();
+  };
+  float const kNaN = std::numeric_limits<float>::quiet_NaN();
+  std::vector<std::vector<float>> rows {
+      {-1, 0, 0}, {-1, 2, 0}, {1, 0, 1}, {1, 0, 3}, {kNaN, kNaN, kNaN}, {1, 5, kNaN}};
+  RegTree original = tree;
+
+  ASSERT_EQ(tree.Compact(), 1);
+  ASSERT_EQ(tree.param.num_nodes, 5);
+  ASSERT_EQ(tree.param.num_deleted, 0);
+  ASSERT_EQ(tree.GetNodes().size(), 5);
+  // renumbered breadth first
+  ASSERT_EQ(tree[0].LeftChild(), 1);
+  ASSERT_EQ(tree[0].RightChild(), 2);
+  ASSERT_EQ(tree[2].LeftChild(), 3);
+  ASSERT_EQ(tree[3].Parent(), 2);
+  ASSERT_TRUE(tree[1].IsLeaf());
+  for (auto const& row : rows) {
+    ASSERT_EQ(predict(tree, row), predict(original, row));
+  }
+
+  // nothing left to fold
+  ASSERT_EQ(tree.Compact(), 0);
+  ASSERT_EQ(tree.param.num_nodes, 5);
+}
+
 RegTree ConstructTree() {
   RegTree tree;
   tree.ExpandNode(
@@ -233,16 +286,120 @@ TEST(Tree, JsonIO) {
   ASSERT_EQ(get<String>(tparam["num_nodes"]), "3");
   ASSERT_EQ(get<String>(tparam["size_leaf_vector"]), "0");
 
-  ASSERT_EQ(get<Array const>(j_tree["left_children"]).size(), 3);
-  ASSERT_EQ(get<Array const>(j_tree["right_children"]).size(), 3);
-  ASSERT_EQ(get<Array const>(j_tree["parents"]).size(), 3);
-  ASSERT_EQ(get<Array const>(j_tree["split_indices"]).size(), 3);
-  ASSERT_EQ(get<Array const>(j_tree["split_conditions"]).size(), 3);
+  ASSERT_EQ(get<I32Array const>(j_tree["left_children"]).size(), 3);
+  ASSERT_EQ(get<I32Array const>(j_tree["right_children"]).size(), 3);
+  ASSERT_EQ(get<I32Array const>(j_tree["parents"]).size(), 3);
+  ASSERT_EQ(get<I32Array const>(j_tree["split_indices"]).size(), 3);
+  ASSERT_EQ(get<F32Array const>(j_tree["split_conditions"]).size(), 3);
   ASSERT_EQ(get<Array const>(j_tree["default_left"]).size(), 3);
 
   RegTree loaded_tree;
   loaded_tree.LoadModel(j_tree);
   ASSERT_EQ(loaded_tree.param.num_nodes, 3);
+
+  // Text has the same schema, parsed either into typed arrays or into Json numbers.
+  std::string str = ss.str();
+  for (bool typed : {true, false}) {
+    Json j_loaded = Json::Load({str.c_str(), str.size()}, typed);
+    ASSERT_EQ(IsA<I64Array>(j_loaded["left_children"]), typed);
+    ASSERT_EQ(IsA<F32Array>(j_loaded["split_conditions"]), typed);
+    ASSERT_TRUE(IsA<Array>(j_loaded["default_left"]));
+    RegTree from_text;
+    from_text.LoadModel(j_loaded);
+    ASSERT_TRUE(from_text == tree);
+  }
+}
+
+TEST(Tree, MultiOutputIO) {
+  RegTree tree;
+  tree.param.size_leaf_vector = 3;
+  ASSERT_TRUE(tree.IsMultiOutput());
+  tree.ExpandNode(0, 1, 0.5f, true, 0.0f, 0.0f, 0.0f, 1.0f, 4.0f);
+  tree.SetLeafVector(tree[0].LeftChild(), {0.1f, -0.2f, 0.3f});
+  tree.SetLeafVector(tree[0].RightChild(), {-0.4f, 0.5f, -0.6f});
+  tree.ExpandNode(tree[0].RightChild(), 0, 0.25f, false, 0.0f, 0.0f, 0.0f, 1.0f, 2.0f);
+  auto right = tree[tree[0].RightChild()].LeftChild();
+  tree.SetLeafVector(right, {1.0f, 2.0f, 3.0f});
+  ASSERT_EQ(tree.LeafVector(right)[2], 3.0f);
+  ASSERT_EQ(tree.LeafVector(tree[0].LeftChild())[1], -0.2f);
+
+  std::string buffer;
+  {
+    common::MemoryBufferStream fo(&buffer);
+    tree.Save(&fo);
+  }
+  RegTree binary;
+  {
+    common::MemoryBufferStream fi(&buffer);
+    binary.Load(&fi);
+  }
+  ASSERT_TRUE(binary == tree);
+
+  Json j_tree{Object()};
+  tree.SaveModel(&j_tree);
+  ASSERT_EQ(get<F32Array const>(j_tree["leaf_vector"]).size(), 5 * 3);
+  RegTree loaded;
+  loaded.LoadModel(j_tree);
+  ASSERT_EQ(loaded.param.size_leaf_vector, 3);
+  ASSERT_EQ(loaded.param.num_nodes, tree.param.num_nodes);
+  for (bst_node_t nid = 0; nid < tree.param.num_nodes; ++nid) {
+    ASSERT_EQ(loaded[nid].IsLeaf(), tree[nid].IsLeaf());
+    for (int32_t k = 0; k < 3; ++k) {
+      ASSERT_EQ(loaded.LeafVector(nid)[k], tree.LeafVector(nid)[k]);
+    }
+  }
+
+  FeatureMap fmap;
+  auto str = tree.DumpModel(fmap, false, "text");
+  ASSERT_NE(str.find("leaf=[0.100000001,-0.200000003,0.300000012]"), std::string::npos);
+  str = tree.DumpModel(fmap, false, "json");
+  ASSERT_NE(str.find(R"("leaf": [1E0,2E0,3E0])"), std::string::npos);
+}
+
+TEST(Tree, CategoricalIO) {
+  RegTree tree;
+  // categories 1 and 3 go left
+  std::vector<uint64_t> split_cats(common::CatBitField::ComputeStorageSize(4), 0);
+  common::CatBitField bits{common::Span<uint64_t>{split_cats}};
+  bits.Set(1);
+  bits.Set(3);
+  tree.ExpandCategorical(0, 0, split_cats, 2.0f, true, 0.0f, -1.0f, 1.0f, 1.0f, 4.0f);
+  ASSERT_TRUE(tree.HasCategoricalSplit());
+  ASSERT_EQ(tree.NodeSplitType(0), FeatureType::kCategorical);
+  ASSERT_EQ(tree.NodeSplitType(tree[0].LeftChild()), FeatureType::kNumerical);
+
+  ASSERT_EQ(tree.GetNext(0, 1.0f, false), tree[0].LeftChild());
+  ASSERT_EQ(tree.GetNext(0, 3.0f, false), tree[0].LeftChild());
+  ASSERT_EQ(tree.GetNext(0, 2.0f, false), tree[0].RightChild());
+  // unseen categories go right, missing values to the default child
+  ASSERT_EQ(tree.GetNext(0, 100.0f, false), tree[0].RightChild());
+  ASSERT_EQ(tree.GetNext(0, -1.0f, false), tree[0].RightChild());
+  ASSERT_EQ(tree.GetNext(0, 0.0f, true), tree[0].LeftChild());
+
+  Json j_tree{Object()};
+  tree.SaveModel(&j_tree);
+  std::string str;
+  Json::Dump(j_tree, &str);
+  RegTree loaded;
+  loaded.LoadModel(Json::Load(StringView{str.c_str(), str.size()}));
+  ASSERT_TRUE(loaded == tree);
+
+  // binary format has no room for the categories
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  EXPECT_THROW(tree.Save(&fo), dmlc::Error);
+
+  FeatureMap fmap;
+  str = tree.DumpModel(fmap, false, "text");
+  ASSERT_NE(str.find("0:[f0:{1,3}]"), std::string::npos);
+  str = tree.DumpModel(fmap, false, "json");
+  ASSERT_NE(str.find(R"("split_condition": [1, 3])"), std::string::npos);
+
+  // numerical splits keep working next to categorical ones
+  tree.ExpandNode(tree[0].RightChild(), 1, 0.5f, false, 0.0f, 0.0f, 0.0f, 1.0f, 2.0f);
+  auto const right = tree[0].RightChild();
+  ASSERT_EQ(tree.GetNext(right, 0.25f, false), tree[right].LeftChild());
+  ASSERT_EQ(tree.NodeCats(right).size(), 0);
 }
 
 }  // namespace xgboost
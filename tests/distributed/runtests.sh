@@ -11,3 +11,18 @@ $submit --cluster=local --num-workers=3 python test_basic.py
 
 echo "====== 2. Regression test for issue #3402 ======"
 $submit --cluster=local --num-workers=2 --worker-cores=1 python test_issue3402.py
+
+echo "====== 3. Split evaluation shared by the workers ======"
+$submit --cluster=local --num-workers=3 python test_split_evaluation.py
+
+echo "====== 4. Compact histogram allreduce ======"
+$submit --cluster=local --num-workers=3 python test_hist_allreduce.py
+
+echo "====== 5. Pipelined histogram allreduce ======"
+$submit --cluster=local --num-workers=3 python test_pipelined_allreduce.py
+
+echo "====== 6. Column-wise data split ======"
+$submit --cluster=local --num-workers=3 python test_column_split.py
+
+echo "====== 7. Balanced row sampling over uneven workers ======"
+$submit --cluster=local --num-workers=3 python test_balanced_sampling.py
@@ -0,0 +1,43 @@
+#!/usr/bin/python
+import numpy as np
+import xgboost as xgb
+
+# Workers with uneven shares of the rows sample about the same number of rows each.
+xgb.rabit.init()
+rank = xgb.rabit.get_rank()
+world = xgb.rabit.get_world_size()
+
+# Rank 0 gets twice the rows of each other worker.
+labels = []
+rows = []
+with open('../../demo/data/agaricus.txt.train') as fd:
+    for line in fd:
+        tokens = line.split()
+        labels.append(float(tokens[0]))
+        rows.append([tuple(map(int, t.split(':'))) for t in tokens[1:]])
+n_features = max(fid for row in rows for fid, _ in row) + 1
+bounds = np.linspace(0, len(rows), world + 2).astype(int)
+begin = 0 if rank == 0 else bounds[rank + 1]
+end = bounds[rank + 2]
+data = np.full((end - begin, n_features), np.nan, dtype=np.float32)
+for i, row in enumerate(rows[begin:end]):
+    for fid, value in row:
+        data[i, fid] = value
+dtrain = xgb.DMatrix(data, label=labels[begin:end], missing=np.nan)
+
+param = {'max_depth': 6, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'hist', 'subsample': 0.5, 'balanced_sampling': 1}
+for method in ['uniform', 'gradient_based']:
+    result = {}
+    bst = xgb.train(dict(param, sampling_method=method), dtrain, 5, [(dtrain, 'train')],
+                    evals_result=result)
+    assert result['train']['error'][-1] < 0.05
+
+    # trees are the same on every worker
+    dump = bst.get_dump(with_stats=True)
+    assert xgb.rabit.broadcast(dump, 0) == dump
+
+if rank == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()
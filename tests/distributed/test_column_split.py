@@ -0,0 +1,40 @@
+#!/usr/bin/python
+import numpy as np
+import xgboost as xgb
+
+# Every worker has all rows but only its share of the features, the trees are grown
+# together with the worker owning each split feature partitioning the rows.
+xgb.rabit.init()
+rank = xgb.rabit.get_rank()
+world = xgb.rabit.get_world_size()
+
+# Read the rows here, as loading the file from DMatrix splits its rows over the workers.
+labels = []
+rows = []
+with open('../../demo/data/agaricus.txt.train') as fd:
+    for line in fd:
+        tokens = line.split()
+        labels.append(float(tokens[0]))
+        rows.append([tuple(map(int, t.split(':'))) for t in tokens[1:]])
+n_features = max(fid for row in rows for fid, _ in row) + 1
+data = np.full((len(rows), n_features), np.nan, dtype=np.float32)
+for i, row in enumerate(rows):
+    for fid, value in row:
+        if fid % world == rank:
+            data[i, fid] = value
+dtrain = xgb.DMatrix(data, label=labels, missing=np.nan)
+
+param = {'max_depth': 6, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'hist', 'dsplit': 'col'}
+result = {}
+bst = xgb.train(param, dtrain, 5, [(dtrain, 'train')], evals_result=result)
+assert result['train']['error'][-1] < 0.01
+
+# trees are the same on every worker
+dump = bst.get_dump(with_stats=True)
+assert xgb.rabit.broadcast(dump, 0) == dump
+
+if rank == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()
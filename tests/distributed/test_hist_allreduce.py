@@ -0,0 +1,27 @@
+#!/usr/bin/python
+import xgboost as xgb
+
+# Skipping empty features in the histogram allreduce is lossless, sending the histograms
+# in single precision only rounds them.
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+
+param = {'max_depth': 6, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'hist'}
+num_round = 5
+
+full = xgb.train(param, dtrain, num_round)
+skipped = xgb.train(dict(param, hist_allreduce_skip_empty=1), dtrain, num_round)
+assert full.get_dump(with_stats=True) == skipped.get_dump(with_stats=True)
+
+compact = xgb.train(dict(param, hist_allreduce_skip_empty=1, hist_allreduce_precision='float'),
+                    dtrain, num_round)
+preds_full = full.predict(dtrain)
+preds_compact = compact.predict(dtrain)
+assert max(abs(a - b) for a, b in zip(preds_full, preds_compact)) < 1e-3
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()
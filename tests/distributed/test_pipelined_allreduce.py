@@ -0,0 +1,25 @@
+#!/usr/bin/python
+import xgboost as xgb
+
+# Building and allreducing the histograms of a level in chunks gives the same trees.
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+
+param = {'max_depth': 6, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'hist'}
+num_round = 5
+
+whole = xgb.train(param, dtrain, num_round)
+for chunks in [2, 3, 64]:
+    pipelined = xgb.train(dict(param, hist_allreduce_chunks=chunks), dtrain, num_round)
+    assert whole.get_dump(with_stats=True) == pipelined.get_dump(with_stats=True)
+
+skipped = xgb.train(dict(param, hist_allreduce_chunks=2, hist_allreduce_skip_empty=1),
+                    dtrain, num_round)
+assert whole.get_dump(with_stats=True) == skipped.get_dump(with_stats=True)
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()
@@ -0,0 +1,20 @@
+#!/usr/bin/python
+import xgboost as xgb
+
+# Trees are the same whether or not each worker only evaluates its share of features.
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+
+param = {'max_depth': 4, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'hist'}
+num_round = 5
+
+replicated = xgb.train(param, dtrain, num_round)
+partitioned = xgb.train(dict(param, distributed_split_evaluation=1), dtrain, num_round)
+assert replicated.get_dump(with_stats=True) == partitioned.get_dump(with_stats=True)
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()
@@ -77,6 +77,25 @@ class TestBasic(unittest.TestCase):
         # assert they are the same
         assert np.sum(np.abs(preds2 - preds)) == 0
 
+    def test_inplace_predict(self):
+        import scipy.sparse
+        rows, cols = 1000, 10
+        X = rng.randn(rows, cols)
+        X[rng.rand(rows, cols) < 0.1] = np.nan
+        y = rng.randint(0, 3, size=rows)
+        dtrain = xgb.DMatrix(X, y)
+        bst = xgb.train({'objective': 'multi:softprob', 'num_class': 3,
+                         'tree_method': 'hist'}, dtrain, 4)
+        expected = bst.predict(dtrain)
+        np.testing.assert_allclose(bst.inplace_predict(X), expected, rtol=1e-6)
+        margin = bst.predict(dtrain, output_margin=True, ntree_limit=2)
+        np.testing.assert_allclose(
+            bst.inplace_predict(X, output_margin=True, ntree_limit=2), margin,
+            rtol=1e-6)
+        X_csr = scipy.sparse.csr_matrix(np.nan_to_num(X, nan=0.0))
+        np.testing.assert_allclose(bst.inplace_predict(X_csr),
+                                   bst.predict(xgb.DMatrix(X_csr)), rtol=1e-6)
+
     def test_record_results(self):
         dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
         dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
@@ -106,3 +106,53 @@ class TestEarlyStopping(unittest.TestCase):
             else:
                 assert np.all(df >= df.iloc[-1])
         assert num_iteration_history[:3] == num_iteration_history[3:]
+
+    def test_train_rounds(self):
+        X = rng.randn(200, 5)
+        y = X[:, 0] * 2 + rng.randn(200) * 0.1
+        dtrain = xgb.DMatrix(X[:150], label=y[:150])
+        dvalid = xgb.DMatrix(X[150:], label=y[150:])
+        params = [('max_depth', 2), ('eta', 0.3), ('eval_metric', 'mae'),
+                  ('eval_metric', 'rmse')]
+        evals = [(dtrain, 'train'), (dvalid, 'valid')]
+
+        expected = {}
+        xgb.train(params, dtrain, num_boost_round=8, evals=evals,
+                  evals_result=expected, verbose_eval=False)
+
+        history = {'train': {'mae': [], 'rmse': []},
+                   'valid': {'mae': [], 'rmse': []}}
+
+        def callback(iteration, results):
+            assert iteration == len(history['train']['mae'])
+            for name, metrics in results.items():
+                for metric, value in metrics.items():
+                    history[name][metric].append(value)
+            return False
+
+        checkpoints = []
+        bst = xgb.Booster(params, [dtrain, dvalid])
+        end = bst.train_rounds(dtrain, 8, evals=evals, callback=callback,
+                               checkpoint=lambda i, raw: checkpoints.append(i),
+                               checkpoint_period=3)
+        assert end == 8
+        assert checkpoints == [2, 5, 7]
+        for name in expected:
+            for metric in expected[name]:
+                np.testing.assert_allclose(history[name][metric],
+                                           expected[name][metric], atol=1e-6)
+
+        # the training error keeps going down, so maximizing it never improves
+        bst = xgb.Booster(params, [dtrain, dvalid])
+        end = bst.train_rounds(dtrain, 8, evals=[(dvalid, 'valid'), (dtrain, 'train')],
+                               early_stopping_rounds=3, maximize=True)
+        assert end == 4
+        assert bst.best_iteration == 0
+        assert int(bst.attr('best_iteration')) == 0
+
+        def failing(iteration, results):
+            raise ValueError('stop')
+
+        with pytest.raises(ValueError):
+            xgb.Booster(params, [dtrain]).train_rounds(
+                dtrain, 2, evals=[(dtrain, 'train')], callback=failing)